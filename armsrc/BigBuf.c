@@ -21,11 +21,13 @@
 #include "dbprint.h"
 #include "pm3_cmd.h"
 #include "util.h" // nbytes
+#include "cmd.h"  // reply_ng, reply_ng_async
+#include "perf.h"
 
 #define BIGBUF_ALIGN_BYTES (4)
 #define BIGBUF_ALIGN_MASK  (0xFFFF + 1 - BIGBUF_ALIGN_BYTES)
 
-extern uint32_t _stack_start[], __bss_end__[];
+extern uint32_t _stack_start[], _stack_end[], __data_start__[], __bss_end__[];
 
 // BigBuf is the large multi-purpose buffer, typically used to hold A/D samples or traces.
 // Also used to hold various smaller buffers and the Mifare Emulator Memory.
@@ -44,6 +46,10 @@ static uint32_t s_bigbuf_size = 0;
 // High memory mark
 static uint32_t s_bigbuf_hi = 0;
 
+// allocation statistics, lowest high memory mark seen and failed allocations
+static uint32_t s_bigbuf_hi_min = 0;
+static uint32_t s_bigbuf_failed = 0;
+
 // pointer to the emulator memory.
 static uint8_t *emulator_memory = NULL;
 
@@ -76,10 +82,28 @@ static dmabuf8_t dma_8 = {
 static uint32_t trace_len = 0;
 static bool tracing = true;
 
+// trace streaming.
+// The trace area is split in two halves. LogTrace fills one half while the
+// other one, once full, is drained to the client by trace_stream_poll().
+// A record which doesn't fit while the other half is still being sent is dropped.
+// With a sink set, the halves go to the sink instead of the client.
+static struct {
+    bool armed;
+    bool enabled;
+    trace_stream_sink_t sink;
+    uint8_t fill;            // half LogTrace is writing to
+    uint32_t half;           // size of one half
+    uint32_t pending;        // bytes waiting to be sent in the other half, 0 = none
+    uint32_t sent;           // bytes of the pending half already sent
+    trace_stream_stats_t stats;
+} trace_stream;
+
 // compute the available size for BigBuf
 void BigBuf_initialize(void) {
     s_bigbuf_size = (uint32_t)_stack_start - (uint32_t)__bss_end__;
     s_bigbuf_hi = s_bigbuf_size;
+    s_bigbuf_hi_min = s_bigbuf_size;
+    s_bigbuf_failed = 0;
     trace_len = 0;
 }
 
@@ -139,10 +163,14 @@ uint8_t *BigBuf_malloc(uint16_t chunksize) {
     chunksize = (chunksize + BIGBUF_ALIGN_BYTES - 1) & BIGBUF_ALIGN_MASK; // round up to next multiple of 4
 
     if (s_bigbuf_hi < chunksize) {
+        s_bigbuf_failed++;
         return NULL; // no memory left
     }
 
     s_bigbuf_hi -= chunksize;  // aligned to 4 Byte boundary
+    if (s_bigbuf_hi < s_bigbuf_hi_min) {
+        s_bigbuf_hi_min = s_bigbuf_hi;
+    }
     return (uint8_t *)BigBuf + s_bigbuf_hi;
 }
 
@@ -156,6 +184,84 @@ uint8_t *BigBuf_calloc(uint16_t chunksize) {
     return mem;
 }
 
+// Scoped allocations.
+// BigBuf_release(mark) gives back everything allocated since BigBuf_get_mark()
+// returned mark, older allocations are kept.
+//    uint32_t mark = BigBuf_get_mark();
+//    uint8_t *tmp = BigBuf_malloc(...);
+//    ...
+//    BigBuf_release(mark);
+uint32_t BigBuf_get_mark(void) {
+    return s_bigbuf_hi;
+}
+
+void BigBuf_release(uint32_t mark) {
+    if (mark < s_bigbuf_hi || mark > s_bigbuf_size) {
+        return;
+    }
+    s_bigbuf_hi = mark;
+
+    // buffers handed out by the getters below the mark are gone now
+    uint8_t *lim = (uint8_t *)BigBuf + mark;
+    if (emulator_memory != NULL && emulator_memory < lim)
+        emulator_memory = NULL;
+    if (toSend.buf != NULL && toSend.buf < lim)
+        toSend.buf = NULL;
+    if (dma_16.buf != NULL && (uint8_t *)dma_16.buf < lim)
+        dma_16.buf = NULL;
+    if (dma_8.buf != NULL && dma_8.buf < lim)
+        dma_8.buf = NULL;
+}
+
+// Fixed size block pool inside BigBuf.
+// Blocks are carved from one BigBuf chunk and can be freed and reused in any order,
+// free blocks are linked through their first word.
+bool BigBuf_pool_init(bigbuf_pool_t *pool, uint16_t blocksize, uint16_t count) {
+    blocksize = (MAX(blocksize, sizeof(uint8_t *)) + BIGBUF_ALIGN_BYTES - 1) & BIGBUF_ALIGN_MASK;
+    if ((uint32_t)blocksize * count > UINT16_MAX) {
+        return false;
+    }
+
+    uint8_t *mem = BigBuf_malloc(blocksize * count);
+    if (mem == NULL) {
+        return false;
+    }
+
+    pool->free = NULL;
+    for (uint16_t i = count; i > 0; i--) {
+        uint8_t *b = mem + (i - 1) * blocksize;
+        *(uint8_t **)b = pool->free;
+        pool->free = b;
+    }
+    pool->blocksize = blocksize;
+    pool->count = count;
+    pool->used = 0;
+    pool->used_max = 0;
+    return true;
+}
+
+void *BigBuf_pool_alloc(bigbuf_pool_t *pool) {
+    uint8_t *b = pool->free;
+    if (b == NULL) {
+        return NULL;
+    }
+    pool->free = *(uint8_t **)b;
+    pool->used++;
+    if (pool->used > pool->used_max) {
+        pool->used_max = pool->used;
+    }
+    return b;
+}
+
+void BigBuf_pool_free(bigbuf_pool_t *pool, void *p) {
+    if (p == NULL) {
+        return;
+    }
+    *(uint8_t **)p = pool->free;
+    pool->free = p;
+    pool->used--;
+}
+
 // free ALL allocated chunks. The whole BigBuf is available for traces or samples again.
 void BigBuf_free(void) {
     s_bigbuf_hi = s_bigbuf_size;
@@ -180,8 +286,15 @@ void BigBuf_free_keep_EM(void) {
 
 void BigBuf_print_status(void) {
     DbpString(_CYAN_("Memory"));
+#ifdef WITH_CAPTURE_PROFILE
+    Dbprintf("  Build profile........... capture");
+#endif
+    Dbprintf("  Static data + bss....... %d", (uint32_t)__bss_end__ - (uint32_t)__data_start__);
+    Dbprintf("  Stack size.............. %d", (uint32_t)_stack_end - (uint32_t)_stack_start);
     Dbprintf("  BigBuf_size............. %d", s_bigbuf_size);
     Dbprintf("  Available memory........ %d", s_bigbuf_hi);
+    Dbprintf("  Max allocated........... %d", s_bigbuf_size - s_bigbuf_hi_min);
+    Dbprintf("  Failed allocations...... %d", s_bigbuf_failed);
     DbpString(_CYAN_("Tracing"));
     Dbprintf("  tracing ................ %d", tracing);
     Dbprintf("  traceLen ............... %d", trace_len);
@@ -216,6 +329,114 @@ void clear_trace(void) {
     trace_len = 0;
 }
 
+// Arm trace streaming for the next sniff.  The sniff calls trace_stream_start()
+// once its buffers are allocated, which consumes the armed flag.
+void set_trace_stream(bool enable) {
+    trace_stream.armed = enable;
+}
+
+// Stays set until the stream stops,  arm the stream with set_trace_stream() as well.
+void set_trace_stream_sink(trace_stream_sink_t sink) {
+    trace_stream.sink = sink;
+}
+
+bool trace_stream_start(void) {
+    trace_stream.enabled = false;
+    if (trace_stream.armed == false) {
+        trace_stream.sink = NULL;
+        return false;
+    }
+    trace_stream.armed = false;
+
+    // both halves must be able to hold the largest record
+    uint32_t half = (BigBuf_max_traceLen() / 2) & BIGBUF_ALIGN_MASK;
+    if (half < TRACELOG_HDR_LEN + MAX_FRAME_SIZE + MAX_PARITY_SIZE) {
+        if (trace_stream.sink) {
+            trace_stream.sink(NULL, 0);
+            trace_stream.sink = NULL;
+        }
+        return false;
+    }
+
+    trace_stream.fill = 0;
+    trace_stream.half = half;
+    trace_stream.pending = 0;
+    trace_stream.sent = 0;
+    memset(&trace_stream.stats, 0, sizeof(trace_stream.stats));
+    trace_len = 0;
+    tracing = true;
+    trace_stream.enabled = true;
+    return true;
+}
+
+// Sends one chunk of a full half, if there is one.  Called by the sniff loops
+// when no frame is being received.  Returns false when the client has sent a
+// command, which stops the stream.
+bool RAMFUNC trace_stream_poll(void) {
+    if (trace_stream.enabled == false) {
+        return true;
+    }
+
+    if (trace_stream.pending) {
+        const uint8_t *half = BigBuf_get_addr() + ((trace_stream.fill ^ 1) * trace_stream.half);
+        uint32_t len;
+        if (trace_stream.sink) {
+            len = trace_stream.sink(half + trace_stream.sent, trace_stream.pending - trace_stream.sent);
+        } else {
+            len = MIN(trace_stream.pending - trace_stream.sent, PM3_CMD_DATA_SIZE);
+            // queued, USB drains it while the sniff keeps decoding
+            // PM3_EOPABORTED: previous chunk still draining, retry on the next poll
+            if (reply_ng_async(CMD_TRACE_STREAM, PM3_SUCCESS, half + trace_stream.sent, len) == PM3_EOPABORTED) {
+                return (data_available_fast() == false);
+            }
+        }
+        trace_stream.sent += len;
+        trace_stream.stats.bytes += len;
+        if (trace_stream.sent == trace_stream.pending) {
+            trace_stream.pending = 0;
+            trace_stream.sent = 0;
+        }
+    }
+    return (data_available_fast() == false);
+}
+
+// Sends what is left in both halves, followed by the stream statistics.
+void trace_stream_stop(void) {
+    if (trace_stream.enabled == false) {
+        return;
+    }
+
+    while (trace_stream.pending) {
+        trace_stream_poll();
+    }
+
+    // the half being filled goes out as the last part
+    uint32_t base = trace_stream.fill * trace_stream.half;
+    trace_stream.pending = trace_len - base;
+    trace_stream.fill ^= 1;
+    while (trace_stream.pending) {
+        trace_stream_poll();
+    }
+
+    trace_stream.enabled = false;
+    if (trace_stream.sink) {
+        trace_stream.sink(NULL, 0);
+        trace_stream.sink = NULL;
+    } else {
+        reply_ng(CMD_TRACE_STREAM, PM3_ENODATA, (uint8_t *)&trace_stream.stats, sizeof(trace_stream.stats));
+    }
+
+    if (g_dbglevel >= DBG_INFO) {
+        Dbprintf("Streamed " _YELLOW_("%u") " bytes, " _YELLOW_("%u") " records, dropped " _YELLOW_("%u")
+                 , trace_stream.stats.bytes
+                 , trace_stream.stats.records
+                 , trace_stream.stats.dropped
+                );
+    }
+    // the trace area only holds the tail of the stream
+    trace_len = 0;
+}
+
 void set_tracelen(uint32_t value) {
     trace_len = value;
 }
@@ -242,18 +463,29 @@ uint32_t BigBuf_get_traceLen(void) {
   by 'hf list -t raw', alternatively 'hf list -t <proto>' for protocol-specific
   annotation of commands/responses.
 **/
-bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_start, uint32_t timestamp_end, const uint8_t *parity, bool reader2tag) {
-    if (tracing == false) {
-        return false;
-    }
+static bool RAMFUNC LogTrace_impl(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_start, uint32_t timestamp_end, const uint8_t *parity, bool reader2tag) {
 
     uint8_t *trace = BigBuf_get_addr();
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + trace_len);
 
     uint16_t num_paritybytes = (iLen - 1) / 8 + 1; // number of valid paritybytes in *parity
 
-    // Return when trace is full
-    if (TRACELOG_HDR_LEN + iLen + num_paritybytes >= BigBuf_max_traceLen() - trace_len) {
+    if (trace_stream.enabled) {
+        uint32_t base = trace_stream.fill * trace_stream.half;
+        if (TRACELOG_HDR_LEN + iLen + num_paritybytes > trace_stream.half - (trace_len - base)) {
+            // other half not sent yet,  drop this record but keep sniffing
+            if (trace_stream.pending) {
+                trace_stream.stats.dropped++;
+                return true;
+            }
+            trace_stream.pending = trace_len - base;
+            trace_stream.fill ^= 1;
+            trace_len = trace_stream.fill * trace_stream.half;
+            hdr = (tracelog_hdr_t *)(trace + trace_len);
+        }
+        trace_stream.stats.records++;
+    } else if (TRACELOG_HDR_LEN + iLen + num_paritybytes >= BigBuf_max_traceLen() - trace_len) {
+        // Return when trace is full
         tracing = false;
         return false;
     }
@@ -298,6 +530,17 @@ bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_
     return true;
 }
 
+bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_start, uint32_t timestamp_end, const uint8_t *parity, bool reader2tag) {
+    if (tracing == false) {
+        return false;
+    }
+
+    uint32_t perf = PERF_START();
+    bool res = LogTrace_impl(btBytes, iLen, timestamp_start, timestamp_end, parity, reader2tag);
+    perf_record(PERF_LOGTRACE, perf);
+    return res;
+}
+
 // specific LogTrace function for ISO15693: the duration needs to be scaled because otherwise it won't fit into a uint16_t
 bool LogTrace_ISO15693(const uint8_t *bytes, uint16_t len, uint32_t ts_start, uint32_t ts_end, const uint8_t *parity, bool reader2tag) {
     uint32_t duration = ts_end - ts_start;
@@ -390,8 +633,86 @@ dmabuf16_t *get_dma16(void) {
 }
 
 dmabuf8_t *get_dma8(void) {
-    if (dma_8.buf == NULL)
-        dma_8.buf = BigBuf_malloc(DMA_BUFFER_SIZE);
+    return get_dma8_ex(DMA_BUFFER_SIZE);
+}
 
+// a mode can ask for a bigger ring,  the size only applies when the buffer is allocated.
+// Callers must use dma->size, not DMA_BUFFER_SIZE.
+dmabuf8_t *get_dma8_ex(uint16_t size) {
+    if (dma_8.buf == NULL) {
+        dma_8.buf = BigBuf_malloc(size);
+        dma_8.size = (dma_8.buf) ? size : 0;
+    }
     return &dma_8;
 }
+
+//=============================================================================
+// Precompiled response cache.
+// Simulators keep modulated answers, as produced by their encoder in the ToSend
+// buffer, keyed by what they depend on (block number, page, ...).  Entries are
+// encoded ahead of time or on first use, and sent from the cache afterwards.
+// The cache is direct mapped,  a key only lives in slot key % slots.
+//=============================================================================
+bool resp_cache_init(resp_cache_t *c, uint16_t slots, uint16_t slot_size) {
+    memset(c, 0, sizeof(resp_cache_t));
+    if (slots == 0 || slot_size == 0) {
+        return false;
+    }
+
+    c->mod = BigBuf_malloc(slots * slot_size);
+    c->keys = (uint32_t *)BigBuf_malloc(slots * sizeof(uint32_t));
+    c->lens = (uint16_t *)BigBuf_calloc(slots * sizeof(uint16_t));
+    if (c->mod == NULL || c->keys == NULL || c->lens == NULL) {
+        c->slots = 0;
+        return false;
+    }
+    c->slots = slots;
+    c->slot_size = slot_size;
+    return true;
+}
+
+const uint8_t *resp_cache_get(resp_cache_t *c, uint32_t key, uint16_t *len) {
+    if (c->slots == 0) {
+        return NULL;
+    }
+    uint16_t i = key % c->slots;
+    if (c->lens[i] == 0 || c->keys[i] != key) {
+        c->misses++;
+        return NULL;
+    }
+    c->hits++;
+    *len = c->lens[i];
+    return c->mod + (i * c->slot_size);
+}
+
+// Stores the current ToSend content under key, returns the cached copy
+const uint8_t *resp_cache_put_tosend(resp_cache_t *c, uint32_t key) {
+    if (c->slots == 0) {
+        return NULL;
+    }
+    if (toSend.max <= 0 || toSend.max > c->slot_size) {
+        return NULL;
+    }
+    uint16_t i = key % c->slots;
+    uint8_t *slot = c->mod + (i * c->slot_size);
+    memcpy(slot, toSend.buf, toSend.max);
+    c->keys[i] = key;
+    c->lens[i] = toSend.max;
+    return slot;
+}
+
+void resp_cache_invalidate(resp_cache_t *c, uint32_t key) {
+    if (c->slots == 0) {
+        return;
+    }
+    uint16_t i = key % c->slots;
+    if (c->keys[i] == key) {
+        c->lens[i] = 0;
+    }
+}
+
+void resp_cache_clear(resp_cache_t *c) {
+    if (c->slots) {
+        memset(c->lens, 0, c->slots * sizeof(uint16_t));
+    }
+}
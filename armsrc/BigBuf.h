@@ -28,6 +28,8 @@
 #define CARD_MEMORY_SIZE        4096
 //#define DMA_BUFFER_SIZE         (512 + 256)
 #define DMA_BUFFER_SIZE         512
+// ring used by the 14a sniffer,  gives the decoder room to catch up during dense traffic
+#define DMA_BUFFER_SIZE_SNIFF14A    2048
 
 // 8 data bits and 1 parity bit per payload byte, 1 correction bit, 1 SOC bit, 2 EOC bits
 #define TOSEND_BUFFER_SIZE (9 * MAX_FRAME_SIZE + 1 + 1 + 2)
@@ -46,6 +48,8 @@ void BigBuf_Clear_EM(void);
 uint8_t *BigBuf_malloc(uint16_t);
 uint8_t *BigBuf_calloc(uint16_t);
 void BigBuf_free(void);
+uint32_t BigBuf_get_mark(void);
+void BigBuf_release(uint32_t mark);
 void BigBuf_free_keep_EM(void);
 void BigBuf_print_status(void);
 uint32_t BigBuf_get_traceLen(void);
@@ -54,6 +58,16 @@ void set_tracing(bool enable);
 void set_tracelen(uint32_t value);
 bool get_tracing(void);
 
+// Destination for a trace stream other than the client.  Returns the number of
+// bytes it took,  called with len == 0 once the stream stops.
+typedef uint32_t (*trace_stream_sink_t)(const uint8_t *data, uint32_t len);
+
+void set_trace_stream(bool enable);
+void set_trace_stream_sink(trace_stream_sink_t sink);
+bool trace_stream_start(void);
+bool RAMFUNC trace_stream_poll(void);
+void trace_stream_stop(void);
+
 bool RAMFUNC LogTrace(const uint8_t *btBytes, uint16_t iLen, uint32_t timestamp_start, uint32_t timestamp_end, const uint8_t *parity, bool reader2tag);
 bool RAMFUNC LogTraceBits(const uint8_t *btBytes, uint16_t bitLen, uint32_t timestamp_start, uint32_t timestamp_end, bool reader2tag);
 bool LogTrace_ISO15693(const uint8_t *bytes, uint16_t len, uint32_t ts_start, uint32_t ts_end, const uint8_t *parity, bool reader2tag);
@@ -82,5 +96,34 @@ typedef struct {
 } dmabuf16_t;
 
 dmabuf8_t *get_dma8(void);
+dmabuf8_t *get_dma8_ex(uint16_t size);
 dmabuf16_t *get_dma16(void);
+
+typedef struct {
+    uint8_t *free;
+    uint16_t blocksize;
+    uint16_t count;
+    uint16_t used;
+    uint16_t used_max;
+} bigbuf_pool_t;
+
+bool BigBuf_pool_init(bigbuf_pool_t *pool, uint16_t blocksize, uint16_t count);
+void *BigBuf_pool_alloc(bigbuf_pool_t *pool);
+void BigBuf_pool_free(bigbuf_pool_t *pool, void *p);
+
+typedef struct {
+    uint8_t *mod;
+    uint32_t *keys;
+    uint16_t *lens;      // 0 = empty slot
+    uint16_t slots;
+    uint16_t slot_size;
+    uint32_t hits;
+    uint32_t misses;
+} resp_cache_t;
+
+bool resp_cache_init(resp_cache_t *c, uint16_t slots, uint16_t slot_size);
+const uint8_t *resp_cache_get(resp_cache_t *c, uint32_t key, uint16_t *len);
+const uint8_t *resp_cache_put_tosend(resp_cache_t *c, uint32_t key);
+void resp_cache_invalidate(resp_cache_t *c, uint32_t key);
+void resp_cache_clear(resp_cache_t *c);
 #endif /* __BIGBUF_H */
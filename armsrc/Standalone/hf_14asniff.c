@@ -32,6 +32,11 @@
  *
  * Once the data is saved, standalone mode will exit.
  *
+ * With flash, the trace is instead streamed while sniffing: each time half of
+ * the trace buffer fills up it is LZ4 packed and appended to hf_14asniff_lz4.trace,
+ * so a session is no longer limited by the size of BigBuf. `trace load`
+ * unpacks these files. Frames arriving during a flush may be lost.
+ *
  * LEDs:
  * - LED1: sniffing
  * - LED2: sniffed tag command, turns off when finished sniffing reader command
@@ -60,8 +65,8 @@
  * Caveats / notes:
  * - Trace buffer will be cleared on starting stand-alone mode. Data in flash
  *   will remain unless explicitly deleted.
- * - This module will terminate if the trace buffer is full (and save data to
- *   flash).
+ * - Without streaming, this module will terminate if the trace buffer is full
+ *   (and save data to flash).
  * - Like normal sniffing mode, timestamps overflow after 5 min 16 sec.
  *   However, the trace buffer is sequential, so will be in the correct order.
  */
@@ -77,12 +82,13 @@
 #include "BigBuf.h"
 
 #define HF_14ASNIFF_LOGFILE "hf_14asniff.trace"
+#define HF_14ASNIFF_STREAMFILE "hf_14asniff_lz4.trace"
 
 static void DownloadTraceInstructions(void) {
     Dbprintf("");
     Dbprintf("To get the trace from flash and display it:");
-    Dbprintf("1. mem spiffs dump -s "HF_14ASNIFF_LOGFILE" -d hf_14asniff.trace");
-    Dbprintf("2. trace load -f hf_14asniff.trace");
+    Dbprintf("1. mem spiffs dump -s "HF_14ASNIFF_STREAMFILE" -d hf_14asniff_lz4.trace");
+    Dbprintf("2. trace load -f hf_14asniff_lz4.trace");
     Dbprintf("3. trace list -t 14a -1");
 }
 
@@ -97,6 +103,12 @@ void RunMod(void) {
     Dbprintf(_YELLOW_("HF 14A SNIFF started"));
 #ifdef WITH_FLASH
     rdv40_spiffs_lazy_mount();
+
+    // stream the trace to flash as the buffer fills,  saving the RAM trace at the end is the fallback
+    bool streaming = (rdv40_spiffs_trace_stream(HF_14ASNIFF_STREAMFILE) == PM3_SUCCESS);
+    if (streaming) {
+        Dbprintf("Streaming trace to "HF_14ASNIFF_STREAMFILE);
+    }
 #endif
 
     SniffIso14443a(0);
@@ -111,7 +123,9 @@ void RunMod(void) {
         Dbprintf("[!] Trace length (bytes) = %u", trace_len);
 #else
     // Write stuff to spiffs logfile
-    if (trace_len > 0) {
+    if (streaming) {
+        Dbprintf("[!] Streamed trace to "HF_14ASNIFF_STREAMFILE);
+    } else if (trace_len > 0) {
         Dbprintf("[!] Trace length (bytes) = %u", trace_len);
 
         uint8_t *trace_buffer = BigBuf_get_addr();
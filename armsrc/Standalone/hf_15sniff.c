@@ -32,6 +32,11 @@
  *
  * Once the data is saved, standalone mode will exit.
  *
+ * With flash, the trace is instead streamed while sniffing: each time half of
+ * the trace buffer fills up it is LZ4 packed and appended to hf_15693sniff_lz4.trace,
+ * so a session is no longer limited by the size of BigBuf. `trace load`
+ * unpacks these files. Frames arriving during a flush may be lost.
+ *
  * LEDs:
  * - LED1: sniffing
  * - LED2: sniffed tag command, turns off when finished sniffing reader command
@@ -59,8 +64,8 @@
  * Caveats / notes:
  * - Trace buffer will be cleared on starting stand-alone mode. Data in flash
  *   will remain unless explicitly deleted.
- * - This module will terminate if the trace buffer is full (and save data to
- *   flash).
+ * - Without streaming, this module will terminate if the trace buffer is full
+ *   (and save data to flash).
  * - Like normal sniffing mode, timestamps overflow after 5 min 16 sec.
  *   However, the trace buffer is sequential, so will be in the correct order.
  */
@@ -81,12 +86,13 @@
 
 
 #define HF_15693SNIFF_LOGFILE "hf_15693sniff.trace"
+#define HF_15693SNIFF_STREAMFILE "hf_15693sniff_lz4.trace"
 
 static void DownloadTraceInstructions(void) {
     Dbprintf("");
     Dbprintf("To get the trace from flash and display it:");
-    Dbprintf("1. mem spiffs dump -s "HF_15693SNIFF_LOGFILE" -d hf_15693sniff.trace");
-    Dbprintf("2. trace load -f hf_15693sniff.trace");
+    Dbprintf("1. mem spiffs dump -s "HF_15693SNIFF_STREAMFILE" -d hf_15693sniff_lz4.trace");
+    Dbprintf("2. trace load -f hf_15693sniff_lz4.trace");
     Dbprintf("3. trace list -t 15 -1");
 }
 
@@ -101,6 +107,12 @@ void RunMod(void) {
     Dbprintf(_YELLOW_("HF 15693 SNIFF started"));
 #ifdef WITH_FLASH
     rdv40_spiffs_lazy_mount();
+
+    // stream the trace to flash as the buffer fills,  saving the RAM trace at the end is the fallback
+    bool streaming = (rdv40_spiffs_trace_stream(HF_15693SNIFF_STREAMFILE) == PM3_SUCCESS);
+    if (streaming) {
+        Dbprintf("Streaming trace to "HF_15693SNIFF_STREAMFILE);
+    }
 #endif
 
     SniffIso15693(0, NULL, false);
@@ -115,7 +127,9 @@ void RunMod(void) {
         Dbprintf("[!] Trace length (bytes) = %u", trace_len);
 #else
     // Write stuff to spiffs logfile
-    if (trace_len > 0) {
+    if (streaming) {
+        Dbprintf("[!] Streamed trace to "HF_15693SNIFF_STREAMFILE);
+    } else if (trace_len > 0) {
         Dbprintf("[!] Trace length (bytes) = %u", trace_len);
 
         uint8_t *trace_buffer = BigBuf_get_addr();
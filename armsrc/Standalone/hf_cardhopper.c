@@ -29,17 +29,29 @@
 #include "usart.h"
 #include "cmd.h"
 #include "usb_cdc.h"
+#include "perf.h"
 
 #ifdef CARDHOPPER_USB
 #define cardhopper_write usb_write
+#define cardhopper_write_async usb_write
 #define cardhopper_read usb_read_ng
 #define cardhopper_data_available usb_poll_validate_length
 #else
 #define cardhopper_write usart_writebuffer_sync
+#define cardhopper_write_async usart_writebuffer_async
 #define cardhopper_read usart_read_ng
 #define cardhopper_data_available usart_rxdata_available
 #endif
 
+// Waiting time extension multiplier asked from the reader when the link is slow.
+// Clamped so FWT * WTXM stays below the FWT of FWI 14.
+#ifndef CARDHOPPER_WTXM
+#define CARDHOPPER_WTXM 59
+#endif
+
+// FWT = 256 * 16 / fc * 2^FWI, in perf counter ticks
+#define CARDHOPPER_FWT_TICKS(fwi) ((uint32_t)((uint64_t)(256 * 16) * PERF_FREQ / 13560000) << (fwi))
+
 void ModInfo(void) {
     DbpString("  HF - Long-range relay 14a over serial<->IP -  a.k.a. CardHopper (Sam Haskins)");
 }
@@ -63,7 +75,9 @@ static void become_reader(void);
 static void select_card(void);
 
 static void become_card(void);
-static void prepare_emulation(uint8_t *, uint16_t *, uint8_t *, packet_t *);
+static void prepare_emulation(uint8_t *, uint16_t *, uint8_t *, packet_t *, uint8_t *);
+static void prepare_wtx(uint8_t);
+static bool wait_for_link(const packet_t *);
 static void cook_ats(packet_t *, uint8_t, uint8_t);
 static bool try_use_canned_response(const uint8_t *, int, tag_response_info_t *);
 static void reply_with_packet(packet_t *);
@@ -122,6 +136,7 @@ void RunMod(void) {
     }
 
     DbpString(_CYAN_("[@]") " exiting ...");
+    DbpString(_CYAN_("[@]") " see `" _YELLOW_("hw perf") "` for the relay hop latencies");
     FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
     LEDsoff();
 }
@@ -158,11 +173,13 @@ static void become_reader(void) {
             }
         }
 
+        uint32_t perf = PERF_START();
         memcpy(toCard, rx->dat, rx->len);
         AddCrc14A(toCard, rx->len);
         ReaderTransmit(toCard, rx->len + 2, NULL);
 
         tx->len = ReaderReceive(tx->dat, parity);
+        perf_record(PERF_RELAY_CARD, perf);
         if (tx->len == 0) {
             tx->len = sizeof(magicERR);
             memcpy(tx->dat, magicERR, sizeof(magicERR));
@@ -207,9 +224,11 @@ static void become_card(void) {
 
     uint8_t tagType;
     uint16_t flags;
+    uint8_t fwi;
     uint8_t data[PM3_CMD_DATA_SIZE] = { 0 };
     packet_t ats = { 0 };
-    prepare_emulation(&tagType, &flags, data, &ats);
+    prepare_emulation(&tagType, &flags, data, &ats, &fwi);
+    prepare_wtx(fwi);
 
     tag_response_info_t *canned;
     uint32_t cuid;
@@ -257,19 +276,29 @@ static void become_card(void) {
         }
 
         // Option 3: Relay the message
+        uint32_t perf = PERF_START();
         tx->len = fromReaderLen - 2; // cut off the crc
         memcpy(tx->dat, fromReaderDat, tx->len);
         write_packet(tx);
+        perf_record(PERF_RELAY_UPLINK, perf);
 
+        perf = PERF_START();
+        if (wait_for_link(tx) == false) {
+            continue;
+        }
         read_packet(rx);
+        perf_record(PERF_RELAY_REMOTE, perf);
+
         if (!no_reply && rx->len > 0) {
+            perf = PERF_START();
             reply_with_packet(rx);
+            perf_record(PERF_RELAY_DOWNLINK, perf);
         }
     }
 }
 
 
-static void prepare_emulation(uint8_t *tagType, uint16_t *flags, uint8_t *data, packet_t *ats) {
+static void prepare_emulation(uint8_t *tagType, uint16_t *flags, uint8_t *data, packet_t *ats, uint8_t *fwi_out) {
     packet_t tagTypeRx = { 0 };
     read_packet(&tagTypeRx);
     packet_t timeModeRx = { 0 };
@@ -296,6 +325,8 @@ static void prepare_emulation(uint8_t *tagType, uint16_t *flags, uint8_t *data,
         sfgi = 0xe;
     }
 
+    *fwi_out = fwi;
+
     memcpy(data, uidRx.dat, uidRx.len);
     *flags = (uidRx.len == 10 ? FLAG_10B_UID_IN_DATA : (uidRx.len == 7 ? FLAG_7B_UID_IN_DATA : FLAG_4B_UID_IN_DATA));
     DbpString(_CYAN_("[@]") " UID:");
@@ -436,6 +467,68 @@ static bool try_use_canned_response(const uint8_t *dat, int len, tag_response_in
 static uint8_t g_responseBuffer  [512 ] = { 0 };
 static uint8_t g_modulationBuffer[1024] = { 0 };
 
+// S(WTX) request, encoded once so asking for more time costs nothing on the critical path
+static uint8_t g_wtxResponse[4] = { 0 };
+static uint8_t g_wtxModulation[128] = { 0 };
+static tag_response_info_t g_wtx = { 0 };
+static uint32_t g_wtxBudget = 0;
+static uint32_t g_wtxBudgetExtended = 0;
+
+static void prepare_wtx(uint8_t fwi) {
+    uint8_t wtxm = MIN(CARDHOPPER_WTXM, (1 << 14) >> fwi);
+    if (wtxm == 0) wtxm = 1;
+
+    g_wtx.response = g_wtxResponse;
+    g_wtx.modulation = g_wtxModulation;
+    g_wtx.response[0] = 0xF2; // S(WTX), no CID
+    g_wtx.response[1] = wtxm;
+    AddCrc14A(g_wtx.response, 2);
+    g_wtx.response_n = 4;
+    prepare_tag_modulation(&g_wtx, sizeof(g_wtxModulation));
+
+    // ask for more time at 3/4 of the frame waiting time, leaves room for the frame itself
+    g_wtxBudget = CARDHOPPER_FWT_TICKS(fwi) / 4 * 3;
+    g_wtxBudgetExtended = g_wtxBudget * wtxm;
+    Dbprintf(_CYAN_("[@]") " WTX after %u us, WTXM %u", g_wtxBudget / (PERF_FREQ / 1000000), wtxm);
+}
+
+// Wait for the link to answer, keeping the reader at bay with S(WTX) when the
+// relayed frame is an ISO14443-4 I-block without CID. Returns false when the
+// wait got aborted (button, or the reader moved on).
+static bool wait_for_link(const packet_t *sent) {
+    bool can_wtx = (sent->len > 0 && (sent->dat[0] & 0xE2) == 0x02 && (sent->dat[0] & 0x08) == 0);
+    uint32_t start = GetCountPerf();
+    uint32_t budget = g_wtxBudget;
+
+    while (cardhopper_data_available() == 0) {
+        WDT_HIT();
+
+        if (BUTTON_PRESS()) {
+            return false;
+        }
+
+        if (can_wtx && (GetCountPerf() - start) > budget) {
+            EmSendPrecompiledCmd(&g_wtx);
+
+            // reader answers with S(WTX) response
+            uint8_t dat[MAX_FRAME_SIZE];
+            uint8_t par[MAX_PARITY_SIZE];
+            int len = 0;
+            if (GetIso14443aCommandFromReaderInterruptible(dat, par, &len)) {
+                if ((dat[0] & 0xF7) != ISO14443A_CMD_WTX) {
+                    if (g_dbglevel >= DBG_DEBUG) {
+                        Dbprintf(_YELLOW_("[!]") " reader did not accept WTX");
+                    }
+                    return false;
+                }
+            }
+            start = GetCountPerf();
+            budget = g_wtxBudgetExtended;
+        }
+    }
+    return true;
+}
+
 static void reply_with_packet(packet_t *packet) {
     tag_response_info_t response = { 0 };
     response.response = g_responseBuffer;
@@ -487,7 +580,8 @@ static void read_packet(packet_t *packet) {
             return;
         }
     }
-    cardhopper_write(magicACK, sizeof(magicACK));
+    // don't hold the answer to the reader hostage to the ACK going out
+    cardhopper_write_async(magicACK, sizeof(magicACK));
 }
 
 
@@ -31,6 +31,7 @@
 #include "iso14443a.h"
 #include "mifareutil.h"
 #include "mifaresim.h"
+#include "mifarecmd.h"
 #include "vtsend.h"
 #include "spiffs.h"
 #include "frozen.h"
@@ -462,7 +463,6 @@ void RunMod(void) {
         }
     }
 
-    int key = -1;
     bool err = 0;
     bool trapped = 0;
     bool allKeysFound = true;
@@ -563,75 +563,82 @@ failtag:
     // -----------------------------------------------------------------------------
     // also we could avoid first UID check for every block
 
+    // check the whole dictionary against all sectors at once, a dictionary in flash replaces the keys above
+    uint8_t *sectorkeys = BigBuf_malloc(sectorsCnt * 12);
+    uint8_t *found = BigBuf_malloc(sectorsCnt * 2);
+    int res = MifareChkKeys_dict(sectorsCnt, keyBlock, size, true, sectorkeys, found);
+    if (res < 0) {
+        err = 1; // Can't select card.
+        allKeysFound = false;
+    }
+
     // then let's expose this optimal case of well known vigik schemes :
     for (uint8_t type = 0; type < 2 && !err && !trapped; type++) {
         for (int sec = 0; sec < sectorsCnt && !err && !trapped; ++sec) {
-            key = cjat91_saMifareChkKeys(sec * 4, type, NULL, size, &keyBlock[0], &key64);
-
-            if (key == -1) {
-                err = 1;
+            if (found[(sec * 2) + type] == 0) {
                 allKeysFound = false;
                 // used in portable imlementation on microcontroller: it reports back the fail and open the
                 // standalone lock reply_ng(CMD_CJB_FSMSTATE_MENU, NULL, 0);
-                break;
-            } else if (key == -2) {
-                err = 1; // Can't select card.
-                allKeysFound = false;
-                // reply_old(CMD_CJB_FSMSTATE_MENU, 0, 0, 0, 0, 0);
-                break;
-            } else {
-                /*  BRACE YOURSELF : AS LONG AS WE TRAP A KNOWN KEY, WE STOP CHECKING AND ENFORCE KNOWN SCHEMES */
-                // uint8_t tosendkey[13];
-                char tosendkey[13];
-                num_to_bytes(key64, 6, foundKey[type][sec]);
-                cjSetCursRight();
-                DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %012" PRIx64 " ; TYP: %i", sec, key64, type);
-                /*reply_old(CMD_CJB_INFORM_CLIENT_KEY, 12, sec, type, tosendkey, 12);*/
-
-                for (int i = 0; i < colin_total_schemas; i++) {
-                    if (key64 == colin_Schemas[i].trigger) {
-
-                        cjSetCursLeft();
-                        DbprintfEx(FLAG_NEWLINE, "%s>>>>>>>>>>>>!*STOP*!<<<<<<<<<<<<<<%s", _XRED_, _XWHITE_);
-                        cjSetCursLeft();
-
-                        DbprintfEx(FLAG_NEWLINE, "    .TAG SEEMS %sDETERMINISTIC%s.     ", _XGREEN_, _XWHITE_);
-                        cjSetCursLeft();
-
-                        DbprintfEx(FLAG_NEWLINE, "%sDetected: %s %s%s", _XORANGE_, _XCYAN_, colin_Schemas[i].name, _XWHITE_);
-                        cjSetCursLeft();
-
-                        DbprintfEx(FLAG_NEWLINE, "...%s[%sKey_derivation_schemeTest%s]%s...", _XYELLOW_, _XGREEN_,
-                                   _XYELLOW_, _XGREEN_);
-                        cjSetCursLeft();
-
-                        DbprintfEx(FLAG_NEWLINE, "%s>>>>>>>>>>>>!*DONE*!<<<<<<<<<<<<<<%s", _XGREEN_, _XWHITE_);
-
-                        uint16_t t = 0;
-                        for (uint16_t s = 0; s < sectorsCnt; s++) {
-                            num_to_bytes(colin_Schemas[i].keysA[s], 6, foundKey[t][s]);
-                            sprintf(tosendkey, "%02x%02x%02x%02x%02x%02x", foundKey[t][s][0], foundKey[t][s][1],
-                                    foundKey[t][s][2], foundKey[t][s][3], foundKey[t][s][4], foundKey[t][s][5]);
-                            cjSetCursRight();
-                            DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %s ; TYP: %d", s, tosendkey, t);
-                        }
-                        t = 1;
-                        for (uint16_t s = 0; s < sectorsCnt; s++) {
-                            num_to_bytes(colin_Schemas[i].keysB[s], 6, foundKey[t][s]);
-                            sprintf(tosendkey, "%02x%02x%02x%02x%02x%02x", foundKey[t][s][0], foundKey[t][s][1],
-                                    foundKey[t][s][2], foundKey[t][s][3], foundKey[t][s][4], foundKey[t][s][5]);
-                            cjSetCursRight();
-                            DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %s ; TYP: %d", s, tosendkey, t);
-                        }
-                        trapped = 1;
-                        break;
+                continue;
+            }
+
+            memcpy(foundKey[type][sec], sectorkeys + (sec * 12) + (type * 6), 6);
+            key64 = bytes_to_num(foundKey[type][sec], 6);
+            /*  BRACE YOURSELF : AS LONG AS WE TRAP A KNOWN KEY, WE STOP CHECKING AND ENFORCE KNOWN SCHEMES */
+            // uint8_t tosendkey[13];
+            char tosendkey[13];
+            cjSetCursRight();
+            DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %012" PRIx64 " ; TYP: %i", sec, key64, type);
+            /*reply_old(CMD_CJB_INFORM_CLIENT_KEY, 12, sec, type, tosendkey, 12);*/
+
+            for (int i = 0; i < colin_total_schemas; i++) {
+                if (key64 == colin_Schemas[i].trigger) {
+
+                    cjSetCursLeft();
+                    DbprintfEx(FLAG_NEWLINE, "%s>>>>>>>>>>>>!*STOP*!<<<<<<<<<<<<<<%s", _XRED_, _XWHITE_);
+                    cjSetCursLeft();
+
+                    DbprintfEx(FLAG_NEWLINE, "    .TAG SEEMS %sDETERMINISTIC%s.     ", _XGREEN_, _XWHITE_);
+                    cjSetCursLeft();
+
+                    DbprintfEx(FLAG_NEWLINE, "%sDetected: %s %s%s", _XORANGE_, _XCYAN_, colin_Schemas[i].name, _XWHITE_);
+                    cjSetCursLeft();
+
+                    DbprintfEx(FLAG_NEWLINE, "...%s[%sKey_derivation_schemeTest%s]%s...", _XYELLOW_, _XGREEN_,
+                               _XYELLOW_, _XGREEN_);
+                    cjSetCursLeft();
+
+                    DbprintfEx(FLAG_NEWLINE, "%s>>>>>>>>>>>>!*DONE*!<<<<<<<<<<<<<<%s", _XGREEN_, _XWHITE_);
+
+                    uint16_t t = 0;
+                    for (uint16_t s = 0; s < sectorsCnt; s++) {
+                        num_to_bytes(colin_Schemas[i].keysA[s], 6, foundKey[t][s]);
+                        sprintf(tosendkey, "%02x%02x%02x%02x%02x%02x", foundKey[t][s][0], foundKey[t][s][1],
+                                foundKey[t][s][2], foundKey[t][s][3], foundKey[t][s][4], foundKey[t][s][5]);
+                        cjSetCursRight();
+                        DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %s ; TYP: %d", s, tosendkey, t);
+                    }
+                    t = 1;
+                    for (uint16_t s = 0; s < sectorsCnt; s++) {
+                        num_to_bytes(colin_Schemas[i].keysB[s], 6, foundKey[t][s]);
+                        sprintf(tosendkey, "%02x%02x%02x%02x%02x%02x", foundKey[t][s][0], foundKey[t][s][1],
+                                foundKey[t][s][2], foundKey[t][s][3], foundKey[t][s][4], foundKey[t][s][5]);
+                        cjSetCursRight();
+                        DbprintfEx(FLAG_NEWLINE, "SEC: %02x ; KEY : %s ; TYP: %d", s, tosendkey, t);
                     }
+                    trapped = 1;
+                    break;
                 }
-                /* etc etc for testing schemes quick schemes */
             }
+            /* etc etc for testing schemes quick schemes */
         }
     }
 
+    // a known scheme fills every key
+    if (trapped) {
+        allKeysFound = true;
+    }
+
     if (!allKeysFound) {
         cjSetCursLeft();
         cjTabulize();
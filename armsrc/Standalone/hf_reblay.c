@@ -28,6 +28,7 @@
 #include "iso14443a.h"
 #include "protocols.h"
 #include "cmd.h"
+#include "perf.h"
 
 #include "usart.h" // Bluetooth reading & writing
 
@@ -139,6 +140,23 @@ void RunMod() {
         .modulation_n = 0
     };
 
+    // S(WTX) asking for the maximum amount of time, encoded once up front since
+    // it is sent exactly when the Bluetooth side is already slow
+    uint8_t wtx_response_buffer[4] = { 0xf2, 0x0b };
+    uint8_t wtx_modulation_buffer[128] = {0};
+    tag_response_info_t wtx_response_info = {
+        .response = wtx_response_buffer,
+        .response_n = 4,
+        .modulation = wtx_modulation_buffer,
+        .modulation_n = 0
+    };
+    AddCrc14A(wtx_response_buffer, 2);
+    prepare_tag_modulation(&wtx_response_info, sizeof(wtx_modulation_buffer));
+
+    // relay hop timestamps, see `hw perf`
+    uint32_t perf_cmd = 0, perf_remote = 0;
+    bool answer_from_link = false;
+
 #define STATE_READ 0
 #define STATE_EMU 1
 
@@ -224,7 +242,9 @@ void RunMod() {
                                 DbpString(_YELLOW_("[ ") "Bluetooth data:" _YELLOW_(" ]"));
                                 Dbhexdump(lenpacket, rpacket, false);
 
+                                uint32_t perf = PERF_START();
                                 apdulen = iso14_apdu(rpacket, (uint16_t) lenpacket, false, apdubuffer, NULL);
+                                perf_record(PERF_RELAY_CARD, perf);
 
                                 DbpString(_YELLOW_("[ ") "Card response:" _YELLOW_(" ]"));
                                 Dbhexdump(apdulen - 2, apdubuffer, false);
@@ -306,6 +326,8 @@ void RunMod() {
 
                 tag_response_info_t *p_response = NULL;
                 LED_B_ON();
+                perf_cmd = PERF_START();
+                answer_from_link = false;
 
                 // dynamic_response_info will be in charge of responses
                 dynamic_response_info.response_n = 0;
@@ -315,8 +337,12 @@ void RunMod() {
                         lenpacket = usart_read_ng(rpacket, sizeof(rpacket));
 
                         if (lenpacket > 0) {
-                            DbpString(_YELLOW_("[ ") "Received Bluetooth data" _YELLOW_(" ]"));
-                            Dbhexdump(lenpacket, rpacket, false);
+                            perf_record(PERF_RELAY_REMOTE, perf_remote);
+                            if (g_dbglevel >= DBG_DEBUG) {
+                                DbpString(_YELLOW_("[ ") "Received Bluetooth data" _YELLOW_(" ]"));
+                                Dbhexdump(lenpacket, rpacket, false);
+                            }
+                            answer_from_link = true;
                             memcpy(&dynamic_response_info.response[1], rpacket, lenpacket);
                             dynamic_response_info.response[0] = prevcmd;
                             dynamic_response_info.response_n = lenpacket + 1;
@@ -346,9 +372,7 @@ void RunMod() {
                     DbpString(_YELLOW_("!!") " NACK - time extension request?");
                     if (resp == 2 && lenpacket == 0) {
                         DbpString(_YELLOW_("!!") " Requesting more time - WTX");
-                        dynamic_response_info.response_n = 2;
-                        dynamic_response_info.response[0] = 0xf2;
-                        dynamic_response_info.response[1] = 0x0b;  // Requesting the maximum amount of time
+                        p_response = &wtx_response_info;
                     } else if (lenpacket == 0) {
                         DbpString(_YELLOW_("!!") " NACK - ACK - Resend last command!"); // To burn some time as well
                         dynamic_response_info.response[0] = 0xa3;
@@ -372,15 +396,21 @@ void RunMod() {
                             resp = 2;
                         }
                         if (lenpacket > 0) {
-                            DbpString(_YELLOW_("[ ") "Answering using Bluetooth data!" _YELLOW_(" ]"));
+                            if (g_dbglevel >= DBG_DEBUG) {
+                                DbpString(_YELLOW_("[ ") "Answering using Bluetooth data!" _YELLOW_(" ]"));
+                            }
                             memcpy(&dynamic_response_info.response[1], rpacket, lenpacket);
                             dynamic_response_info.response[0] = receivedCmd[0];
                             dynamic_response_info.response_n = lenpacket + 1;
                             lenpacket = 0;
                             resp = 1;
                         } else {
-                            DbpString(_YELLOW_("[ ") "New command: sent it & waiting for Bluetooth response!" _YELLOW_(" ]"));
                             usart_writebuffer_sync(buffert, bufferlen + 1);
+                            perf_record(PERF_RELAY_UPLINK, perf_cmd);
+                            perf_remote = PERF_START();
+                            if (g_dbglevel >= DBG_DEBUG) {
+                                DbpString(_YELLOW_("[ ") "New command: sent it & waiting for Bluetooth response!" _YELLOW_(" ]"));
+                            }
                             p_response = NULL;
                         }
 
@@ -396,9 +426,11 @@ void RunMod() {
                 }
 
                 if (dynamic_response_info.response_n > 0) {
-                    DbpString("[ " _GREEN_("Proxmark3 answer") " ]");
-                    Dbhexdump(dynamic_response_info.response_n, dynamic_response_info.response, false);
-                    DbpString("----");
+                    if (g_dbglevel >= DBG_DEBUG) {
+                        DbpString("[ " _GREEN_("Proxmark3 answer") " ]");
+                        Dbhexdump(dynamic_response_info.response_n, dynamic_response_info.response, false);
+                        DbpString("----");
+                    }
                     if (lenpacket > 0) {
                         lenpacket = 0;
                         resp = 1;
@@ -418,6 +450,9 @@ void RunMod() {
 
                 if (p_response != NULL) {
                     EmSendPrecompiledCmd(p_response);
+                    if (answer_from_link) {
+                        perf_record(PERF_RELAY_DOWNLINK, perf_cmd);
+                    }
                 }
             }
 
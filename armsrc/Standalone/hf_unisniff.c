@@ -51,9 +51,12 @@
  * Settings here will override the compile-time options.
  *
  * Currently available options:
- *   save = [new|append|none]
+ *   save = [new|append|stream|none]
  *     new    = create a new file with a numbered name for each session.
  *     append = append to existing file, create if not existing.
+ *     stream = LZ4 pack the trace and append it to hf_unisniff_[protocol]_lz4.trace
+ *              while sniffing, so a session isn't limited by the trace buffer.
+ *              Frames arriving during a flush may be lost. 14b falls back to 'new'.
  *     none   = do not save to SPIFFS, leave in trace buffer only.
  *
  *   protocol = [14a|14b|15|iclass|user]
@@ -129,6 +132,7 @@
 #define HF_UNISNIFF_PROTOCOL            "14a"
 #define HF_UNISNIFF_LOGFILE             "hf_unisniff"
 #define HF_UNISNIFF_LOGEXT              ".trace"
+#define HF_UNISNIFF_STREAMSUFFIX        "_lz4"
 #define HF_UNISNIFF_CONFIG              "hf_unisniff.conf"
 #define HF_UNISNIFF_CONFIG_SIZE         128
 
@@ -144,6 +148,7 @@
 #define HF_UNISNIFF_SAVE_MODE_NEW       0
 #define HF_UNISNIFF_SAVE_MODE_APPEND    1
 #define HF_UNISNIFF_SAVE_MODE_NONE      2
+#define HF_UNISNIFF_SAVE_MODE_STREAM    3
 
 #ifdef WITH_FLASH
 static void UniSniff_DownloadTraceInstructions(char *fn, const char *proto) {
@@ -264,6 +269,10 @@ void RunMod(void) {
                     if (strcmp(value, "none") == 0) {
                         save_mode = HF_UNISNIFF_SAVE_MODE_NONE;
                     }
+
+                    if (strcmp(value, "stream") == 0) {
+                        save_mode = HF_UNISNIFF_SAVE_MODE_STREAM;
+                    }
                 }
             }
             d = token;
@@ -271,7 +280,7 @@ void RunMod(void) {
         }
 
         if (g_dbglevel >= DBG_DEBUG) {
-            const char *save_modes[] = {"new", "append", "none"};
+            const char *save_modes[] = {"new", "append", "none", "stream"};
             Dbprintf("Run-time configured protocol.... %s ( %u )", protocols[sniff_protocol], sniff_protocol);
             Dbprintf("Run-time configured save_mode... %s ( %u )", save_modes[save_mode], sniff_protocol);
         }
@@ -330,6 +339,24 @@ void RunMod(void) {
         }
     }
 
+#ifdef WITH_FLASH
+    bool streaming = false;
+    if (save_mode == HF_UNISNIFF_SAVE_MODE_STREAM) {
+        if (sniff_protocol == HF_UNISNIFF_PROTO_14B) {
+            Dbprintf("14b sniff can't stream, saving at the end");
+        } else {
+            sprintf(filename, "%s_%s%s%s", HF_UNISNIFF_LOGFILE, protocols[sniff_protocol], HF_UNISNIFF_STREAMSUFFIX, HF_UNISNIFF_LOGEXT);
+            streaming = (rdv40_spiffs_trace_stream(filename) == PM3_SUCCESS);
+            if (streaming) {
+                Dbprintf("Streaming trace to " _YELLOW_("%s"), filename);
+            }
+        }
+        if (streaming == false) {
+            save_mode = HF_UNISNIFF_SAVE_MODE_NEW;
+        }
+    }
+#endif
+
     switch (sniff_protocol) {
         case HF_UNISNIFF_PROTO_14A:
             SniffIso14443a(0);
@@ -363,7 +390,12 @@ void RunMod(void) {
 
 #else
     // Write stuff to spiffs logfile
-    if (trace_len == 0) {
+    if (streaming) {
+        // the sniff may have reused the filename buffer
+        sprintf(filename, "%s_%s%s%s", HF_UNISNIFF_LOGFILE, protocols[sniff_protocol], HF_UNISNIFF_STREAMSUFFIX, HF_UNISNIFF_LOGEXT);
+        Dbprintf("Streamed trace to " _YELLOW_("%s"), filename);
+        UniSniff_DownloadTraceInstructions(filename, protocols[sniff_protocol]);
+    } else if (trace_len == 0) {
         Dbprintf("Trace buffer is empty, nothing to write!");
     } else if (save_mode == HF_UNISNIFF_SAVE_MODE_NONE) {
         Dbprintf("Trace save to flash disabled in config!");
@@ -170,6 +170,9 @@ void RunMod(void) {
 
                 Dbprintf("[=] HID brute - starting decrementing card number");
 
+                // only the changed tail of the waveform is rebuilt per candidate
+                CmdHIDsimTAGReset();
+
                 while (cardnum > 0) {
 
                     // Needed for exiting from proxbrute when button is pressed
@@ -193,7 +196,7 @@ void RunMod(void) {
                     // Print actual code to brute
                     Dbprintf("[=] TAG ID: %x%08x (%d) - FC: %u - Card: %u", high[selected], low[selected], (low[selected] >> 1) & 0xFFFF, fc, cardnum);
 
-                    CmdHIDsimTAGEx(0, high[selected], low[selected], 0, 1, 50000);
+                    CmdHIDsimTAGFast(high[selected], low[selected], true, 50000);
                 }
 
                 cardnum = original_cardnum;
@@ -221,7 +224,7 @@ void RunMod(void) {
                     // Print actual code to brute
                     Dbprintf("[=] TAG ID: %x%08x (%d) - FC: %u - Card: %u", high[selected], low[selected], (low[selected] >> 1) & 0xFFFF, fc, cardnum);
 
-                    CmdHIDsimTAGEx(0, high[selected], low[selected], 0, 1, 50000);
+                    CmdHIDsimTAGFast(high[selected], low[selected], true, 50000);
                 }
 
                 DbpString("[=] done bruteforcing");
@@ -117,6 +117,9 @@ void RunMod(void) {
     // Buffer for HID data
     uint32_t high, low;
 
+    // only the changed tail of the waveform is rebuilt per candidate
+    CmdHIDsimTAGReset();
+
     for (uint32_t fc = 0; fc < 256; fc++) {
         // Hit the watchdog timer regularly
         WDT_HIT();
@@ -144,6 +147,7 @@ void RunMod(void) {
 
             sprintf((char *)entry, "FC: %"PRIu32"\n", fc);
             append(entry, strlen((char *)entry));
+            CmdHIDsimTAGReset();
         }
 
         // Calculate data required for a HID card
@@ -155,7 +159,7 @@ void RunMod(void) {
         LED_A_ON();
         LED_D_ON();
         StartTicks();
-        CmdHIDsimTAGEx(0, high, low, 0, 1, 40000);
+        CmdHIDsimTAGFast(high, low, true, 40000);
         LED_D_OFF();
         StartTicks();
         WaitMS(50);
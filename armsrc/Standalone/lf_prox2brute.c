@@ -69,6 +69,9 @@ void RunMod(void) {
     Dbprintf("[=] Starting HID ProxII Bruteforce from card %08x to %08x",
              CARDNUM_START, MIN(CARDNUM_END, 0xFFFF));
 
+    // only the changed tail of the waveform is rebuilt per candidate
+    CmdHIDsimTAGReset();
+
     for (cardnum = CARDNUM_START ; cardnum <= MIN(CARDNUM_END, 0xFFFF) ; cardnum++) {
         WDT_HIT();
 
@@ -87,7 +90,7 @@ void RunMod(void) {
                  fac, cardnum, high, low);
 
         // Start simulating an HID TAG, with high/low values, no led control and 20000 cycles timeout
-        CmdHIDsimTAGEx(0, high, low, 0, false, 20000);
+        CmdHIDsimTAGFast(high, low, false, 20000);
 
         // switch leds to be able to know (aproximatly) which card number worked (64 tries loop)
         LED_A_INV(); // switch led A every try
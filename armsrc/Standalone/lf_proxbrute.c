@@ -97,6 +97,9 @@ void RunMod(void) {
             DbpString("[=] entering ProxBrute mode");
             Dbprintf("[=] simulating | %08x%08x", high, low);
 
+            // only the changed tail of the waveform is rebuilt per candidate
+            CmdHIDsimTAGReset();
+
             for (uint16_t i = low - 1; i > 0; i--) {
 
                 if (data_available()) break;
@@ -108,7 +111,7 @@ void RunMod(void) {
                 Dbprintf("[=] trying Facility = %08x ID %08x", high, i);
 
                 // high, i, ledcontrol,  timelimit 20000
-                CmdHIDsimTAGEx(0, high, i, 0, false, 20000);
+                CmdHIDsimTAGFast(high, i, false, 20000);
 
                 SpinDelay(100);
             }
@@ -58,10 +58,13 @@
 #include "Standalone/standalone.h"
 #include "util.h"
 #include "ticks.h"
+#include "perf.h"
+#include "simstats.h"
 #include "commonutil.h"
 #include "crc16.h"
 #include "protocols.h"
 #include "mifareutil.h"
+#include "lz4.h"         // compressed bigbuf download
 #include "sam_picopass.h"
 #include "sam_seos.h"
 #include "sam_mfc.h"
@@ -572,6 +575,10 @@ static void SendCapabilities(void) {
     capabilities.compiled_with_zx8211 = false;
 #endif
 
+    capabilities.bulk_download = true;
+    capabilities.compressed_download = true;
+    capabilities.eml_upload = true;
+
     reply_ng(CMD_CAPABILITIES, PM3_SUCCESS, (uint8_t *)&capabilities, sizeof(capabilities));
 }
 
@@ -787,9 +794,28 @@ static void PacketReceived(PacketCommandNG *packet) {
     }
     */
 
+#ifdef WITH_ISO14443a
+    // anything else may reconfigure the FPGA or drop the field under the 14a session
+    if (packet->cmd != CMD_HF_ISO14443A_READER && packet->cmd != CMD_HF_ISO14443A_SESSION && packet->cmd != CMD_HF_DROPFIELD) {
+        iso14a_session_invalidate();
+    }
+#endif
+
     switch (packet->cmd) {
         case CMD_BREAK_LOOP:
             break;
+        case CMD_PERF: {
+            perf_report(packet->data.asBytes[0]);
+            break;
+        }
+        case CMD_SIM_STATS: {
+            sim_stats_report();
+            break;
+        }
+        case CMD_TRACE_STREAM: {
+            set_trace_stream(packet->data.asBytes[0]);
+            break;
+        }
         case CMD_QUIT_SESSION: {
             g_reply_via_fpc = false;
             g_reply_via_usb = false;
@@ -843,6 +869,12 @@ static void PacketReceived(PacketCommandNG *packet) {
         }
         // always available
         case CMD_HF_DROPFIELD: {
+#ifdef WITH_ISO14443a
+            // the client drops the field after every command,  a 14a session keeps it
+            if (iso14a_session_active()) {
+                break;
+            }
+#endif
             hf_field_off();
             break;
         }
@@ -905,6 +937,16 @@ static void PacketReceived(PacketCommandNG *packet) {
             }
             break;
         }
+        case CMD_LF_ACQ_WINDOWED: {
+            if (packet->length != sizeof(lf_window_payload_t)) {
+                reply_ng(CMD_LF_ACQ_WINDOWED, PM3_EINVARG, NULL, 0);
+                break;
+            }
+            lf_window_result_t res;
+            int status = ReadLF_windowed((lf_window_payload_t *)packet->data.asBytes, &res, true);
+            reply_ng(CMD_LF_ACQ_WINDOWED, status, (uint8_t *)&res, sizeof(res));
+            break;
+        }
         case CMD_LF_HID_WATCH: {
             uint32_t high, low;
             int res = lf_hid_watch(0, &high, &low, true);
@@ -936,6 +978,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             CmdNRZsimTAG(payload->invert, payload->separator, payload->clock, packet->length - sizeof(lf_nrzsim_t), payload->data, true);
             break;
         }
+        case CMD_LF_SIM_STREAM: {
+            SimulateTagLowFrequencyStream(packet->data.asBytes, packet->length, true);
+            break;
+        }
         case CMD_LF_HID_CLONE: {
             lf_hidsim_t *payload = (lf_hidsim_t *)packet->data.asBytes;
             CopyHIDtoT55x7(payload->hi2, payload->hi, payload->lo, payload->longFMT, payload->Q5, payload->EM, true);
@@ -948,9 +994,14 @@ static void PacketReceived(PacketCommandNG *packet) {
             break;
         }
         case CMD_LF_EM410X_WATCH: {
+            struct p {
+                uint32_t window;
+            } PACKED;
+            struct p *payload = (struct p *)packet->data.asBytes;
+            uint32_t window = (packet->length >= sizeof(struct p)) ? payload->window : 0;
             uint32_t high;
             uint64_t low;
-            int res = lf_em410x_watch(0, &high, &low, true);
+            int res = lf_em410x_watch_ex(0, window, &high, &low, true);
             reply_ng(CMD_LF_EM410X_WATCH, res, NULL, 0);
             break;
         }
@@ -1021,6 +1072,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             T55xxDangerousRawTest(packet->data.asBytes, true);
             break;
         }
+        case CMD_LF_T55XX_WRITE_BATCH: {
+            T55xxWriteBatch((t55xx_write_batch_t *)packet->data.asBytes, true);
+            break;
+        }
         case CMD_LF_T55XX_WAKEUP: {
             struct p {
                 uint32_t password;
@@ -1035,7 +1090,11 @@ static void PacketReceived(PacketCommandNG *packet) {
             break;
         }
         case CMD_LF_T55XX_CHK_PWDS: {
-            T55xx_ChkPwds(packet->data.asBytes[0] & 0xff, true);
+            if (packet->length == sizeof(t55xx_bruteforce_t)) {
+                T55xx_BrutePwds((t55xx_bruteforce_t *)packet->data.asBytes, true);
+            } else {
+                T55xx_ChkPwds(packet->data.asBytes[0] & 0xff, true);
+            }
             break;
         }
         case CMD_LF_PCF7931_READ: {
@@ -1071,6 +1130,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             EM4xBruteforce(payload->start_pwd, payload->n, true);
             break;
         }
+        case CMD_LF_EM4X_PWD_SEARCH: {
+            EM4xPwdSearch((em4x05_pwdsearch_t *)packet->data.asBytes, true);
+            break;
+        }
         case CMD_LF_EM4X_READWORD: {
             struct p {
                 uint32_t password;
@@ -1132,7 +1195,6 @@ static void PacketReceived(PacketCommandNG *packet) {
         case CMD_LF_HITAG_SNIFF: { // Eavesdrop Hitag tag, args = type
             SniffHitag2(true);
             //hitag_sniff();
-            reply_ng(CMD_LF_HITAG_SNIFF, PM3_SUCCESS, NULL, 0);
             break;
         }
         case CMD_LF_HITAG_SIMULATE: { // Simulate Hitag tag, args = memory content
@@ -1150,15 +1212,17 @@ static void PacketReceived(PacketCommandNG *packet) {
             break;
         }
         case CMD_LF_HITAG_READER: { // Reader for Hitag tags, args = type and function
-            lf_hitag_data_t *payload = (lf_hitag_data_t *) packet->data.asBytes;
+            // older clients send the payload without flags
+            lf_hitag_data_t payload = {0};
+            memcpy(&payload, packet->data.asBytes, MIN(packet->length, sizeof(payload)));
 
-            switch (payload->cmd) {
+            switch (payload.cmd) {
                 case RHT2F_UID_ONLY: {
                     ht2_read_uid(NULL, true, true, false);
                     break;
                 }
                 default: {
-                    ReaderHitag(payload, true);
+                    ReaderHitag(&payload, true);
                     break;
                 }
             }
@@ -1179,7 +1243,7 @@ static void PacketReceived(PacketCommandNG *packet) {
         }
         case CMD_LF_HITAGS_WRITE: {
             lf_hitag_data_t *payload = (lf_hitag_data_t *) packet->data.asBytes;
-            WritePageHitagS(payload, true);
+            WritePageHitagS(payload, packet->length, true);
             break;
         }
         case CMD_LF_HITAG2_WRITE: {
@@ -1251,7 +1315,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             // destroy the Emulator Memory.
             //-----------------------------------------------------------------------------
             FpgaDownloadAndGo(FPGA_BITSTREAM_LF);
-            em4x50_chk((const char *)packet->data.asBytes, true);
+            // older clients only send the filename
+            em4x50_chk_t chk = {0};
+            memcpy(&chk, packet->data.asBytes, MIN(packet->length, sizeof(chk)));
+            em4x50_chk(&chk, true);
             break;
         }
 #endif
@@ -1325,6 +1392,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             ReaderIso15693(NULL);
             break;
         }
+        case CMD_HF_ISO15693_INVENTORY: {
+            InventoryIso15693((iso15_inventory_req_t *)packet->data.asBytes);
+            break;
+        }
         case CMD_HF_ISO15693_EML_CLEAR: {
             //-----------------------------------------------------------------------------
             // Note: we call FpgaDownloadAndGo(FPGA_BITSTREAM_HF_15) here although FPGA is not
@@ -1517,6 +1588,15 @@ static void PacketReceived(PacketCommandNG *packet) {
             read_14b_st_block(payload->blockno);
             break;
         }
+        case CMD_HF_SRI_DUMP: {
+            iso14b_sr_dump_req_t *payload = (iso14b_sr_dump_req_t *) packet->data.asBytes;
+            read_14b_st_blocks(payload->start, payload->count);
+            break;
+        }
+        case CMD_HF_ISO14443B_DISCOVER: {
+            iso14443b_discover();
+            break;
+        }
         case CMD_HF_ISO14443B_SNIFF: {
             SniffIso14443b();
             reply_ng(CMD_HF_ISO14443B_SNIFF, PM3_SUCCESS, NULL, 0);
@@ -1542,6 +1622,18 @@ static void PacketReceived(PacketCommandNG *packet) {
             felica_sendraw(packet);
             break;
         }
+        case CMD_HF_FELICA_SEARCH_SERVICE: {
+            felica_search_service((felica_search_service_req_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_FELICA_READ_BLOCKS: {
+            felica_read_blocks((felica_read_blocks_req_t *)packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_FELICA_POLL: {
+            felica_poll((felica_poll_req_t *)packet->data.asBytes);
+            break;
+        }
         case CMD_HF_FELICALITE_SIMULATE: {
             struct p {
                 uint8_t uid[8];
@@ -1582,6 +1674,11 @@ static void PacketReceived(PacketCommandNG *packet) {
             HfSimulateTkm(payload->data, payload->modulation, payload->timeout);
             break;
         }
+        case CMD_HF_DISCOVER: {
+            const hf_discover_req_t *payload = (hf_discover_req_t *) packet->data.asBytes;
+            HfDiscover(payload->techs, true);
+            break;
+        }
 
 #endif
 
@@ -1622,6 +1719,31 @@ static void PacketReceived(PacketCommandNG *packet) {
             ReaderIso14443a(packet);
             break;
         }
+        case CMD_HF_ISO14443A_ENUMERATE: {
+            EnumerateIso14443a();
+            break;
+        }
+        case CMD_HF_ISO14443A_SEQUENCE: {
+            SequenceIso14443a(packet->data.asBytes, packet->length);
+            break;
+        }
+        case CMD_HF_ISO14443A_APDU_SWEEP: {
+            ApduSweepIso14443a((iso14a_sweep_req_t *) packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_ISO14443A_RFBENCH: {
+            RfBenchIso14443a((iso14a_rfbench_req_t *) packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_ISO14443A_COLLECT: {
+            MifareCollect((iso14a_collect_req_t *) packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_ISO14443A_SESSION: {
+            const iso14a_session_req_t *payload = (iso14a_session_req_t *) packet->data.asBytes;
+            Iso14443aSession(payload->action, payload->timeout_ms);
+            break;
+        }
         case CMD_HF_ISO14443A_SIMULATE: {
             struct p {
                 uint8_t tagtype;
@@ -1710,6 +1832,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareReadSector(packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
             break;
         }
+        case CMD_HF_MIFARE_READCARD: {
+            MifareReadCard(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_WRITEBL: {
             uint8_t block_no = packet->oldarg[0];
             uint8_t key_type = packet->oldarg[1];
@@ -1744,6 +1870,24 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareUWriteBlockCompat(packet->oldarg[0], packet->oldarg[1], packet->data.asBytes);
             break;
         }
+        case CMD_HF_MIFAREU_WRITEPAGES: {
+            struct p {
+                uint8_t keytype;
+                uint8_t key[16];
+                uint8_t uid[10];
+                uint8_t uidlen;
+                uint8_t start_page;
+                uint8_t pages;
+                uint8_t data[];
+            } PACKED;
+            struct p *payload = (struct p *) packet->data.asBytes;
+            if (packet->length < sizeof(struct p) + (payload->pages * 4) || payload->uidlen > sizeof(payload->uid)) {
+                reply_ng(CMD_HF_MIFAREU_WRITEPAGES, PM3_EINVARG, NULL, 0);
+                break;
+            }
+            MifareUWritePages(payload->keytype, payload->key, payload->uid, payload->uidlen, payload->start_page, payload->pages, payload->data);
+            break;
+        }
         case CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES: {
             MifareAcquireEncryptedNonces(packet->oldarg[0], packet->oldarg[1], packet->oldarg[2], packet->data.asBytes);
             break;
@@ -1785,6 +1929,18 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareChkKeys_fast(packet->oldarg[0], packet->oldarg[1], packet->oldarg[2], packet->data.asBytes);
             break;
         }
+        case CMD_HF_MIFARE_CHKKEYS_LIST: {
+            MifareChkKeys_list(packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS_STREAM: {
+            MifareChkKeys_stream(packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MIFARE_CHKKEYS_GEN: {
+            MifareChkKeys_gen(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_CHKKEYS_FILE: {
             struct p {
                 uint8_t filename[32];
@@ -1950,6 +2106,14 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareSendCommand(packet->data.asBytes);
             break;
         }
+        case CMD_HF_DESFIRE_CHKKEYS: {
+            MifareDesfireChkKeys(packet->data.asBytes);
+            break;
+        }
+        case CMD_HF_MFP_CHKKEYS: {
+            MifarePlusChkKeys(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_NACK_DETECT: {
             DetectNACKbug();
             break;
@@ -1972,6 +2136,10 @@ static void PacketReceived(PacketCommandNG *packet) {
             MifareHasStaticNonce();
             break;
         }
+        case CMD_HF_MIFARE_CAPS_PROBE: {
+            MifareCapsProbe(packet->data.asBytes);
+            break;
+        }
         case CMD_HF_MIFARE_STATIC_ENCRYPTED_NONCE: {
             struct p {
                 uint8_t block_no;
@@ -2074,11 +2242,17 @@ static void PacketReceived(PacketCommandNG *packet) {
                 uint32_t triggersToSkip;
                 uint8_t skipMode;
                 uint8_t skipRatio;
+                uint8_t realtime;
             } PACKED;
             struct p *payload = (struct p *) packet->data.asBytes;
 
             uint16_t len = 0;
-            int res = HfSniff(payload->samplesToSkip, payload->triggersToSkip, &len, payload->skipMode, payload->skipRatio);
+            int res = HfSniff(payload->samplesToSkip, payload->triggersToSkip, &len, payload->skipMode, payload->skipRatio, payload->realtime);
+
+            // real-time samples went out as raw usb data
+            if (payload->realtime) {
+                break;
+            }
 
             struct {
                 uint16_t len;
@@ -2370,14 +2544,41 @@ static void PacketReceived(PacketCommandNG *packet) {
 
             // arg0 = startindex
             // arg1 = length bytes to transfer
-            // arg2 = BigBuf tracelen
+            // arg2 = flags, see DOWNLOAD_BIGBUF_FLAG_*
             //Dbprintf("transfer to client parameters: %" PRIu32 " | %" PRIu32 " | %" PRIu32, startidx, numofbytes, packet->oldarg[2]);
 
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
-                int result = reply_old(CMD_DOWNLOADED_BIGBUF, i, len, BigBuf_get_traceLen(), mem + startidx + i, len);
+            if ((packet->oldarg[2] & DOWNLOAD_BIGBUF_FLAG_BULK) && g_reply_via_usb && (g_reply_via_fpc == false)) {
+                // bulk mode,  no per chunk frame header,  the client has switched to raw receive
+                // and expects exactly numofbytes bytes before the closing ACK frame
+                int result = usb_write(mem + startidx, numofbytes);
                 if (result != PM3_SUCCESS)
-                    Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+                    Dbprintf("bulk transfer to client failed :: %" PRIu32 " bytes | result: %d", numofbytes, result);
+            } else if (packet->oldarg[2] & DOWNLOAD_BIGBUF_FLAG_LZ4) {
+                // each frame carries as much input as fits in one compressed payload,
+                // input which doesn't shrink is sent as is
+                uint8_t cbuf[PM3_CMD_DATA_SIZE];
+                size_t i = 0;
+                while (i < numofbytes) {
+                    int srclen = MIN(numofbytes - i, DOWNLOAD_BIGBUF_LZ4_MAX_INPUT);
+                    int clen = LZ4_compress_destSize((const char *)(mem + startidx + i), (char *)cbuf, &srclen, sizeof(cbuf));
+                    int result;
+                    if (clen > 0 && srclen > clen) {
+                        result = reply_old(CMD_DOWNLOADED_BIGBUF_LZ4, i, clen, srclen, cbuf, clen);
+                    } else {
+                        srclen = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                        result = reply_old(CMD_DOWNLOADED_BIGBUF, i, srclen, BigBuf_get_traceLen(), mem + startidx + i, srclen);
+                    }
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + srclen, srclen, result);
+                    i += srclen;
+                }
+            } else {
+                for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+                    size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                    int result = reply_old(CMD_DOWNLOADED_BIGBUF, i, len, BigBuf_get_traceLen(), mem + startidx + i, len);
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+                }
             }
             // Trigger a finish downloading signal with an ACK frame
             // iceman,  when did sending samplingconfig array got attached here?!?
@@ -2433,19 +2634,71 @@ static void PacketReceived(PacketCommandNG *packet) {
 
             // arg0 = startindex
             // arg1 = length bytes to transfer
-            // arg2 = RFU
-
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
-                int result = reply_old(CMD_DOWNLOADED_EML_BIGBUF, i, len, 0, mem + startidx + i, len);
-                if (result != PM3_SUCCESS)
-                    Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+            // arg2 = flags, DOWNLOAD_BIGBUF_FLAG_LZ4
+
+            if (packet->oldarg[2] & DOWNLOAD_BIGBUF_FLAG_LZ4) {
+                uint8_t cbuf[PM3_CMD_DATA_SIZE];
+                size_t i = 0;
+                while (i < numofbytes) {
+                    int srclen = numofbytes - i;
+                    int clen = LZ4_compress_destSize((const char *)(mem + startidx + i), (char *)cbuf, &srclen, sizeof(cbuf));
+                    int result;
+                    if (clen > 0 && srclen > clen) {
+                        result = reply_old(CMD_DOWNLOADED_BIGBUF_LZ4, i, clen, srclen, cbuf, clen);
+                    } else {
+                        srclen = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                        result = reply_old(CMD_DOWNLOADED_EML_BIGBUF, i, srclen, 0, mem + startidx + i, srclen);
+                    }
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + srclen, srclen, result);
+                    i += srclen;
+                }
+            } else {
+                for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+                    size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                    int result = reply_old(CMD_DOWNLOADED_EML_BIGBUF, i, len, 0, mem + startidx + i, len);
+                    if (result != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d (%d) | result: %d", i, i + len, len, result);
+                }
             }
             // Trigger a finish downloading signal with an ACK frame
             reply_mix(CMD_ACK, 1, 0, 0, 0, 0);
             LED_B_OFF();
             break;
         }
+        case CMD_UPLOAD_EML_BIGBUF: {
+            upload_eml_t *payload = (upload_eml_t *)packet->data.asBytes;
+            if (packet->length < sizeof(upload_eml_t)) {
+                reply_ng(CMD_UPLOAD_EML_BIGBUF, PM3_EINVARG, NULL, 0);
+                break;
+            }
+
+            if ((payload->offset > CARD_MEMORY_SIZE) || (payload->len > CARD_MEMORY_SIZE - payload->offset)) {
+                reply_ng(CMD_UPLOAD_EML_BIGBUF, PM3_EOUTOFBOUND, NULL, 0);
+                break;
+            }
+
+            // loading the bitstream after the upload might destroy the emulator memory
+            if (payload->fpga) {
+                FpgaDownloadAndGo(payload->fpga);
+            }
+
+            int datalen = packet->length - sizeof(upload_eml_t);
+            int res = PM3_SUCCESS;
+            if (payload->flags & UPLOAD_EML_FLAG_LZ4) {
+                uint8_t *mem = BigBuf_get_EM_addr();
+                int n = LZ4_decompress_safe((const char *)payload->data, (char *)(mem + payload->offset), datalen, payload->len);
+                if (n != payload->len) {
+                    res = PM3_ESOFT;
+                }
+            } else if (datalen == payload->len) {
+                res = emlSet(payload->data, payload->offset, payload->len);
+            } else {
+                res = PM3_EINVARG;
+            }
+            reply_ng(CMD_UPLOAD_EML_BIGBUF, res, NULL, 0);
+            break;
+        }
         case CMD_READ_MEM: {
             if (packet->length != sizeof(uint32_t))
                 break;
@@ -2686,6 +2939,41 @@ static void PacketReceived(PacketCommandNG *packet) {
             LED_B_OFF();
             break;
         }
+        case CMD_SPIFFS_EML_BANK: {
+            eml_bank_req_t *payload = (eml_bank_req_t *)packet->data.asBytes;
+            eml_bank_resp_t resp = {0};
+            uint32_t sizes[EML_BANK_SLOTS];
+            int res = PM3_SUCCESS;
+
+            if (packet->length != sizeof(eml_bank_req_t)) {
+                reply_ng(CMD_SPIFFS_EML_BANK, PM3_EINVARG, NULL, 0);
+                break;
+            }
+
+            LED_B_ON();
+            if (payload->action == EML_BANK_LOAD) {
+                // loading the bitstream after the image might destroy the emulator memory
+                if (payload->fpga) {
+                    FpgaDownloadAndGo(payload->fpga);
+                }
+
+                uint32_t t = GetTickCount();
+                uint8_t *em = BigBuf_get_EM_addr();
+                uint32_t loaded = 0;
+                res = rdv40_spiffs_eml_bank_load(payload->slot, em, CARD_MEMORY_SIZE, &loaded);
+                memset(em + loaded, 0, CARD_MEMORY_SIZE - loaded);
+                resp.ms = GetTickCountDelta(t);
+                resp.loaded = loaded;
+                resp.slot = payload->slot;
+            }
+
+            // a LOAD answers from the index it just used, LIST rescans
+            resp.present = rdv40_spiffs_eml_bank_list(sizes, (payload->action != EML_BANK_LOAD));
+            memcpy(resp.sizes, sizes, sizeof(sizes));
+            reply_ng(CMD_SPIFFS_EML_BANK, res, (uint8_t *)&resp, sizeof(resp));
+            LED_B_OFF();
+            break;
+        }
         case CMD_FLASHMEM_SET_SPIBAUDRATE: {
             if (packet->length != sizeof(uint32_t))
                 break;
@@ -2757,7 +3045,10 @@ static void PacketReceived(PacketCommandNG *packet) {
         case CMD_FLASHMEM_DOWNLOAD: {
 
             LED_B_ON();
-            uint8_t *mem = BigBuf_malloc(PM3_CMD_DATA_SIZE);
+            // two buffers, the SPI DMA fills one while the other goes out over USB
+            uint8_t *mem[2];
+            mem[0] = BigBuf_malloc(PM3_CMD_DATA_SIZE);
+            mem[1] = BigBuf_malloc(PM3_CMD_DATA_SIZE);
             uint32_t startidx = packet->oldarg[0];
             uint32_t numofbytes = packet->oldarg[1];
             // arg0 = startindex
@@ -2768,16 +3059,30 @@ static void PacketReceived(PacketCommandNG *packet) {
                 break;
             }
 
-            for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
-                size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
-                Flash_CheckBusy(BUSY_TIMEOUT);
-                bool isok = Flash_ReadDataCont(startidx + i, mem, len);
-                if (isok == false)
-                    Dbprintf("reading flash memory failed ::  | bytes between %d - %d", i, len);
+            if (numofbytes && Flash_ReadBegin(startidx)) {
 
-                isok = reply_old(CMD_FLASHMEM_DOWNLOADED, i, len, 0, mem, len);
-                if (isok != 0)
-                    Dbprintf("transfer to client failed ::  | bytes between %d - %d", i, len);
+                uint8_t b = 0;
+                Flash_ReadDMAStart(mem[b], MIN(numofbytes, PM3_CMD_DATA_SIZE));
+
+                for (size_t i = 0; i < numofbytes; i += PM3_CMD_DATA_SIZE) {
+                    size_t len = MIN((numofbytes - i), PM3_CMD_DATA_SIZE);
+                    Flash_DMAWait();
+
+                    // one continuous read, next chunk is clocked in during the USB transfer
+                    size_t next = i + PM3_CMD_DATA_SIZE;
+                    if (next < numofbytes) {
+                        Flash_ReadDMAStart(mem[b ^ 1], MIN((numofbytes - next), PM3_CMD_DATA_SIZE));
+                    }
+
+                    int res = reply_old(CMD_FLASHMEM_DOWNLOADED, i, len, 0, mem[b], len);
+                    if (res != PM3_SUCCESS)
+                        Dbprintf("transfer to client failed ::  | bytes between %d - %d", i, len);
+
+                    b ^= 1;
+                }
+                Flash_ReadEnd();
+            } else if (numofbytes) {
+                Dbprintf("reading flash memory failed ::  | flash busy");
             }
             FlashStop();
 
@@ -2962,6 +3267,7 @@ void  __attribute__((noreturn)) AppMain(void) {
     FpgaDownloadAndGo(FPGA_BITSTREAM_HF);
 
     StartTickCount();
+    perf_init();
 
 #ifdef WITH_LCD
     LCDInit();
@@ -3007,6 +3313,10 @@ void  __attribute__((noreturn)) AppMain(void) {
     usb_disable();
     usb_enable();
 
+#ifdef WITH_FLASH
+    uint32_t last_rx_tick = GetTickCount();
+#endif
+
     for (;;) {
         WDT_HIT();
 
@@ -3025,7 +3335,21 @@ void  __attribute__((noreturn)) AppMain(void) {
         int ret = receive_ng(&rx);
         if (ret == PM3_SUCCESS) {
             PacketReceived(&rx);
-        } else if (ret != PM3_ENODATA) {
+#ifdef WITH_FLASH
+            last_rx_tick = GetTickCount();
+#endif
+        } else if (ret == PM3_ENODATA) {
+#ifdef WITH_ISO14443a
+            iso14a_session_tick();
+#endif
+#ifdef WITH_FLASH
+            // USB has been quiet for a while,  top up the erased block pool
+            if (GetTickCountDelta(last_rx_tick) > SPIFFS_IDLE_GC_DELAY_MS) {
+                rdv40_spiffs_idle_gc();
+                last_rx_tick = GetTickCount();
+            }
+#endif
+        } else {
 
             Dbprintf("Error in frame reception: %d %s", ret, (ret == PM3_EIO) ? "PM3_EIO" : "");
             // TODO if error, shall we resync ?
@@ -3039,6 +3363,9 @@ void  __attribute__((noreturn)) AppMain(void) {
             * All standalone mod "main loop" should be the RunMod() function.
             */
             allow_send_wtx = false;
+#ifdef WITH_ISO14443a
+            iso14a_session_invalidate();
+#endif
             RunMod();
             allow_send_wtx = true;
         }
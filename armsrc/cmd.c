@@ -19,6 +19,7 @@
 #include "crc16.h"
 #include "string.h"
 #include "BigBuf.h"
+#include "perf.h"
 
 // Flags to tell where to add CRC on sent replies
 bool g_reply_with_crc_on_usb = false;
@@ -54,7 +55,9 @@ int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const v
     // Send frame and make sure all bytes are transmitted
 
     if (g_reply_via_usb) {
+        uint32_t perf = PERF_START();
         resultusb = usb_write((uint8_t *)&txcmd, sizeof(PacketResponseOLD));
+        perf_record(PERF_USB_SEND, perf);
     }
 
     if (g_reply_via_fpc) {
@@ -72,40 +75,44 @@ int reply_old(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const v
     return PM3_SUCCESS;
 }
 
-static int reply_ng_internal(uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
-    PacketResponseNGRaw txBufferNG;
-    size_t txBufferNGLen;
+// Compose the outgoing frame in txBufferNG, returns the frame length
+static size_t compose_ng(PacketResponseNGRaw *txBufferNG, uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
 
     // Compose the outgoing command frame
-    txBufferNG.pre.magic = RESPONSENG_PREAMBLE_MAGIC;
-    txBufferNG.pre.cmd = cmd;
-    txBufferNG.pre.status = status;
-    txBufferNG.pre.ng = ng;
+    txBufferNG->pre.magic = RESPONSENG_PREAMBLE_MAGIC;
+    txBufferNG->pre.cmd = cmd;
+    txBufferNG->pre.status = status;
+    txBufferNG->pre.ng = ng;
     if (len > PM3_CMD_DATA_SIZE) {
         len = PM3_CMD_DATA_SIZE;
         // overwrite status
-        txBufferNG.pre.status = PM3_EOVFLOW;
+        txBufferNG->pre.status = PM3_EOVFLOW;
     }
 
     // length is only 15bit (32768)
-    txBufferNG.pre.length = (len & 0x7FFF);
+    txBufferNG->pre.length = (len & 0x7FFF);
 
     // Add the (optional) content to the frame, with a maximum size of PM3_CMD_DATA_SIZE
     if (data && len) {
-        memcpy(txBufferNG.data, data, len);
+        memcpy(txBufferNG->data, data, len);
     }
 
-    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketResponseNGPreamble) + len);
+    PacketResponseNGPostamble *tx_post = (PacketResponseNGPostamble *)((uint8_t *)txBufferNG + sizeof(PacketResponseNGPreamble) + len);
 
     // Note: if we send to both FPC & USB, we'll set CRC for both if any of them require CRC
     if ((g_reply_via_fpc && g_reply_with_crc_on_fpc) || ((g_reply_via_usb) && g_reply_with_crc_on_usb)) {
         uint8_t first, second;
-        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketResponseNGPreamble) + len, &first, &second);
+        compute_crc(CRC_14443_A, (uint8_t *)txBufferNG, sizeof(PacketResponseNGPreamble) + len, &first, &second);
         tx_post->crc = ((first << 8) | second);
     } else {
         tx_post->crc = RESPONSENG_POSTAMBLE_MAGIC;
     }
-    txBufferNGLen = sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble);
+    return sizeof(PacketResponseNGPreamble) + len + sizeof(PacketResponseNGPostamble);
+}
+
+static int reply_ng_internal(uint16_t cmd, int16_t status, const uint8_t *data, size_t len, bool ng) {
+    PacketResponseNGRaw txBufferNG;
+    size_t txBufferNGLen = compose_ng(&txBufferNG, cmd, status, data, len, ng);
 
 #ifdef WITH_FPC_USART_HOST
     int resultfpc = PM3_EUNDEF;
@@ -114,7 +121,9 @@ static int reply_ng_internal(uint16_t cmd, int16_t status, const uint8_t *data,
     // Send frame and make sure all bytes are transmitted
 
     if (g_reply_via_usb) {
+        uint32_t perf = PERF_START();
         resultusb = usb_write((uint8_t *)&txBufferNG, txBufferNGLen);
+        perf_record(PERF_USB_SEND, perf);
     }
     if (g_reply_via_fpc) {
 #ifdef WITH_FPC_USART_HOST
@@ -140,6 +149,28 @@ int reply_ng(uint16_t cmd, int16_t status, const uint8_t *data, size_t len) {
     return reply_ng_internal(cmd, status, data, len, true);
 }
 
+// Frame for reply_ng_async, static since USB reads it after the call returns
+static PacketResponseNGRaw txBufferNGAsync;
+
+// Like reply_ng but only queues the frame on USB and returns, the data is
+// copied so the caller can reuse its buffer. The transfer is moved along by
+// usb_write_async_poll(), any blocking reply flushes it first.
+// Returns PM3_EOPABORTED while the previous frame is still draining.
+// FPC replies stay synchronous.
+int reply_ng_async(uint16_t cmd, int16_t status, const uint8_t *data, size_t len) {
+
+    if (g_reply_via_fpc || (g_reply_via_usb == false)) {
+        return reply_ng(cmd, status, data, len);
+    }
+
+    if (usb_write_async_poll()) {
+        return PM3_EOPABORTED;
+    }
+
+    size_t txlen = compose_ng(&txBufferNGAsync, cmd, status, data, len, true);
+    return usb_write_async((uint8_t *)&txBufferNGAsync, txlen);
+}
+
 int reply_mix(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len) {
     int16_t status = PM3_SUCCESS;
     uint64_t arg[3] = {arg0, arg1, arg2};
@@ -249,7 +280,10 @@ int receive_ng(PacketCommandNG *rx) {
 
     // Check if there is a packet available
     if (usb_poll_validate_length()) {
-        return receive_ng_internal(rx, usb_read_ng, true, false);
+        uint32_t perf = PERF_START();
+        int res = receive_ng_internal(rx, usb_read_ng, true, false);
+        perf_record(PERF_USB_RECEIVE, perf);
+        return res;
     }
 
 #ifdef WITH_FPC_USART_HOST
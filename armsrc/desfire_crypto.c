@@ -319,7 +319,11 @@ void cmac(const desfirekey_t key, uint8_t *ivect, const uint8_t *data, size_t le
         return;
     }
 
+    uint32_t mark = BigBuf_get_mark();
     uint8_t *buffer = BigBuf_malloc(padded_data_length(len, kbs));
+    if (buffer == NULL) {
+        return;
+    }
 
     memcpy(buffer, data, len);
 
@@ -336,7 +340,7 @@ void cmac(const desfirekey_t key, uint8_t *ivect, const uint8_t *data, size_t le
     mifare_cypher_blocks_chained(NULL, key, ivect, buffer, len, MCD_SEND, MCO_ENCYPHER);
 
     memcpy(cmac, ivect, kbs);
-    //free(buffer);
+    BigBuf_release(mark);
 }
 
 size_t key_block_size(const desfirekey_t key) {
@@ -736,68 +736,6 @@ void em4x50_brute(const em4x50_data_t *etd, bool ledcontrol) {
     reply_ng(CMD_LF_EM4X50_BRUTE, bsuccess ? PM3_SUCCESS : PM3_EFAILED, (uint8_t *)(&pwd), sizeof(pwd));
 }
 
-// check passwords from dictionary content in flash memory
-void em4x50_chk(const char *filename, bool ledcontrol) {
-    int status = PM3_EFAILED;
-    uint32_t pwd = 0x0;
-
-#ifdef WITH_FLASH
-
-    BigBuf_free();
-
-    int changed = rdv40_spiffs_lazy_mount();
-    uint16_t pwd_count = 0;
-    uint32_t size = size_in_spiffs(filename);
-    pwd_count = size / 4;
-    uint8_t *pwds = BigBuf_malloc(size);
-
-    rdv40_spiffs_read_as_filetype(filename, pwds, size, RDV40_SPIFFS_SAFETY_SAFE);
-
-    if (changed)
-        rdv40_spiffs_lazy_unmount();
-
-    em4x50_setup_read();
-
-    // set g_High and g_Low
-    if (ledcontrol) LED_C_ON();
-    if (get_signalproperties() && find_em4x50_tag()) {
-
-        if (ledcontrol) {
-            LED_C_OFF();
-            LED_D_ON();
-        }
-
-        // try to login with current password
-        for (int i = 0; i < pwd_count; i++) {
-
-            // manual interruption
-            if (BUTTON_PRESS()) {
-                status = PM3_EOPABORTED;
-                break;
-            }
-
-            // get next password
-            pwd = 0x0;
-            for (int j = 0; j < 4; j++)
-                pwd |= (*(pwds + 4 * i + j)) << ((3 - j) * 8);
-
-            if ((status = login(pwd)) == PM3_SUCCESS) {
-                SpinUp(50);
-                SpinDown(50);
-                break;
-            }
-        }
-    }
-
-    BigBuf_free();
-
-#endif
-
-    if (ledcontrol) LEDsoff();
-    lf_finalize(ledcontrol);
-    reply_ng(CMD_LF_EM4X50_CHK, status, (uint8_t *)&pwd, sizeof(pwd));
-}
-
 // resets EM4x50 tag (used by write function)
 static int reset(void) {
     if (request_receive_mode() == PM3_SUCCESS) {
@@ -876,6 +814,92 @@ static int selective_read(uint32_t addresses, uint32_t *words) {
     return status;
 }
 
+// check passwords from dictionary content in flash memory
+// calibrates once, optionally reports progress and reads all words after a hit
+void em4x50_chk(const em4x50_chk_t *chk, bool ledcontrol) {
+    int status = PM3_EFAILED;
+    em4x50_chk_resp_t resp = {0};
+    resp.pos = chk->start;
+
+#ifdef WITH_FLASH
+
+    BigBuf_free();
+
+    char filename[sizeof(chk->filename) + 1] = {0};
+    memcpy(filename, chk->filename, sizeof(chk->filename));
+
+    int changed = rdv40_spiffs_lazy_mount();
+    uint32_t size = size_in_spiffs(filename);
+    uint32_t pwd_count = size / 4;
+    uint8_t *pwds = BigBuf_malloc(size);
+
+    if (pwds == NULL) {
+        pwd_count = 0;
+        status = PM3_EMALLOC;
+    } else {
+        rdv40_spiffs_read_as_filetype(filename, pwds, size, RDV40_SPIFFS_SAFETY_SAFE);
+    }
+
+    if (changed)
+        rdv40_spiffs_lazy_unmount();
+
+    em4x50_setup_read();
+
+    // set g_High and g_Low
+    if (ledcontrol) LED_C_ON();
+    if (pwd_count && get_signalproperties() && find_em4x50_tag()) {
+
+        if (ledcontrol) {
+            LED_C_OFF();
+            LED_D_ON();
+        }
+
+        // try to login with current password
+        for (uint32_t i = chk->start; i < pwd_count; i++) {
+
+            // manual interruption
+            if (BUTTON_PRESS() || data_available()) {
+                status = PM3_EOPABORTED;
+                break;
+            }
+
+            if ((chk->flags & EM4X50_CHK_PROGRESS) && i != chk->start && ((i - chk->start) & 0x1F) == 0) {
+                reply_ng(CMD_LF_EM4X50_CHK, PM3_SUCCESS, (uint8_t *)&resp, sizeof(resp));
+            }
+
+            // get next password
+            uint32_t pwd = 0x0;
+            for (int j = 0; j < 4; j++)
+                pwd |= (*(pwds + 4 * i + j)) << ((3 - j) * 8);
+
+            resp.pos = i + 1;
+            if ((status = login(pwd)) == PM3_SUCCESS) {
+                resp.pwd = pwd;
+
+                // still logged in, read protected words are readable now
+                uint32_t words[EM4X50_NO_WORDS] = {0x0};
+                if ((chk->flags & EM4X50_CHK_DUMP) && selective_read(0x00002100, words) == PM3_SUCCESS) {
+                    memcpy(resp.words, words, sizeof(words));
+                    resp.count = EM4X50_NO_WORDS;
+                }
+
+                SpinUp(50);
+                SpinDown(50);
+                break;
+            }
+        }
+    }
+
+    BigBuf_free();
+
+#endif
+
+    if (ledcontrol) LEDsoff();
+    lf_finalize(ledcontrol);
+    resp.done = true;
+    reply_ng(CMD_LF_EM4X50_CHK, status, (uint8_t *)&resp, sizeof(resp));
+}
+
 // reads by using "selective read mode" -> bidirectional communication
 void em4x50_read(const em4x50_data_t *etd, bool ledcontrol) {
     int status = PM3_EFAILED;
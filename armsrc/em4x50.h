@@ -36,6 +36,6 @@ void em4x50_brute(const em4x50_data_t *etd, bool ledcontrol);
 void em4x50_login(const uint32_t *password, bool ledcontrol);
 void em4x50_sim(const uint32_t *password, bool ledcontrol);
 void em4x50_reader(bool ledcontrol);
-void em4x50_chk(const char *filename, bool ledcontrol);
+void em4x50_chk(const em4x50_chk_t *chk, bool ledcontrol);
 
 #endif /* EM4X50_H */
@@ -617,6 +617,263 @@ void felica_sendraw(const PacketCommandNG *c) {
     return;
 }
 
+// frameSpace holds sync (2), length (1) and `len` - 1 command bytes.
+// Fill in the length, append crc and send as reader.
+static bool felica_exchange(uint8_t len, uint8_t ack) {
+    frameSpace[0] = 0xb2;
+    frameSpace[1] = 0x4d;
+    frameSpace[2] = len;
+    AddCrc(frameSpace + 2, len);
+    TransmitFor18092_AsReader(frameSpace, len + 4, NULL, 1, 0);
+
+    if (WaitForFelicaReply(1024) == false) {
+        return false;
+    }
+
+    if (FelicaFrame.framebytes[3] != ack) {
+        return false;
+    }
+
+    return check_crc(CRC_FELICA, FelicaFrame.framebytes + 2, FelicaFrame.len - 2);
+}
+
+//-----------------------------------------------------------------------------
+// Enumerate areas and services with Search Service Code, starting at
+// `start`, until the card answers FFFFh or the reply buffer is full.
+//-----------------------------------------------------------------------------
+void felica_search_service(const felica_search_service_req_t *req) {
+
+    felica_search_service_t res;
+    memset(&res, 0, sizeof(res));
+
+    clear_trace();
+    set_tracing(true);
+    iso18092_setup(FPGA_HF_ISO18092_FLAG_READER | FPGA_HF_ISO18092_FLAG_NOMOD);
+
+    felica_card_select_t card;
+    if (felica_select_card(&card)) {
+        felica_reset_frame_mode();
+        reply_ng(CMD_HF_FELICA_SEARCH_SERVICE, PM3_ECARDEXCHANGE, NULL, 0);
+        return;
+    }
+    memcpy(res.IDm, card.IDm, sizeof(res.IDm));
+
+    int status = PM3_SUCCESS;
+    uint16_t idx = req->start;
+    uint8_t fails = 0;
+
+    while (res.count < FELICA_SEARCH_SERVICE_MAX) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        frameSpace[3] = FELICA_SRCHSYSCODE_REQ;
+        memcpy(frameSpace + 4, card.IDm, sizeof(card.IDm));
+        frameSpace[12] = idx & 0xFF;
+        frameSpace[13] = idx >> 8;
+
+        if (felica_exchange(12, FELICA_SRCHSYSCODE_ACK) == false) {
+            if (++fails > 3) {
+                status = PM3_ECARDEXCHANGE;
+                break;
+            }
+            continue;
+        }
+        fails = 0;
+
+        const uint8_t *fb = FelicaFrame.framebytes;
+        uint16_t code = fb[12] | (fb[13] << 8);
+        if (code == 0xFFFF) {
+            break;
+        }
+
+        felica_service_entry_t *e = &res.entries[res.count++];
+        e->code = code;
+        // area reply carries the end service code as well
+        e->end = (fb[2] >= 14) ? (fb[14] | (fb[15] << 8)) : 0;
+
+        if (idx == 0xFFFF) {
+            break;
+        }
+        idx++;
+    }
+
+    res.next = idx;
+    res.truncated = (res.count == FELICA_SEARCH_SERVICE_MAX);
+
+    reply_ng(CMD_HF_FELICA_SEARCH_SERVICE, status, (uint8_t *)&res, sizeof(res));
+    felica_reset_frame_mode();
+    set_tracing(false);
+}
+
+//-----------------------------------------------------------------------------
+// Read `count` blocks of one service with Read Without Encryption, packing as
+// many block list elements into each command as the card accepts. When the
+// card rejects a frame it's retried with half the blocks, so the caller
+// learns the card's maximum from `per_frame` in the reply.
+//-----------------------------------------------------------------------------
+void felica_read_blocks(const felica_read_blocks_req_t *req) {
+
+    felica_read_blocks_t res;
+    memset(&res, 0, sizeof(res));
+
+    uint8_t count = MIN(req->count, FELICA_READ_BLOCKS_MAX);
+    uint8_t per_frame = req->per_frame;
+    if (per_frame == 0 || per_frame > FELICA_BLOCKS_PER_FRAME_MAX) {
+        per_frame = FELICA_BLOCKS_PER_FRAME_MAX;
+    }
+
+    clear_trace();
+    set_tracing(true);
+    iso18092_setup(FPGA_HF_ISO18092_FLAG_READER | FPGA_HF_ISO18092_FLAG_NOMOD);
+
+    felica_card_select_t card;
+    if (felica_select_card(&card)) {
+        felica_reset_frame_mode();
+        reply_ng(CMD_HF_FELICA_READ_BLOCKS, PM3_ECARDEXCHANGE, NULL, 0);
+        return;
+    }
+    memcpy(res.IDm, card.IDm, sizeof(res.IDm));
+
+    int status = PM3_SUCCESS;
+    uint8_t fails = 0;
+
+    while (res.count < count) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        uint8_t n = MIN(per_frame, count - res.count);
+        uint8_t c = 3;
+
+        frameSpace[c++] = FELICA_RDBLK_REQ;
+        memcpy(frameSpace + c, card.IDm, sizeof(card.IDm));
+        c += sizeof(card.IDm);
+
+        // one service
+        frameSpace[c++] = 0x01;
+        frameSpace[c++] = req->service & 0xFF;
+        frameSpace[c++] = req->service >> 8;
+
+        frameSpace[c++] = n;
+        for (uint8_t i = 0; i < n; i++) {
+            uint16_t blk = req->block + res.count + i;
+            if (blk > 0xFF) {
+                // 3 byte block list element, block number little endian
+                frameSpace[c++] = 0x00;
+                frameSpace[c++] = blk & 0xFF;
+                frameSpace[c++] = blk >> 8;
+            } else {
+                frameSpace[c++] = 0x80;
+                frameSpace[c++] = blk;
+            }
+        }
+
+        if (felica_exchange(c - 2, FELICA_RDBLK_ACK) == false) {
+            if (++fails > 3) {
+                status = PM3_ECARDEXCHANGE;
+                break;
+            }
+            continue;
+        }
+        fails = 0;
+
+        const uint8_t *fb = FelicaFrame.framebytes;
+        if (fb[12] != 0x00 || fb[13] != 0x00) {
+            // card may not take this many blocks per command, back off
+            if (n > 1) {
+                per_frame = n / 2;
+                continue;
+            }
+            // past the end of the service or not readable
+            res.status_flag1 = fb[12];
+            res.status_flag2 = fb[13];
+            break;
+        }
+
+        uint8_t got = MIN(fb[14], n);
+        memcpy(res.data[res.count], fb + 15, got * 16);
+        res.count += got;
+    }
+
+    res.per_frame = per_frame;
+
+    reply_ng(CMD_HF_FELICA_READ_BLOCKS, status, (uint8_t *)&res, sizeof(res));
+    felica_reset_frame_mode();
+    set_tracing(false);
+}
+
+//-----------------------------------------------------------------------------
+// Polling with time slots. After one Polling command every card answers in
+// a slot picked at random, so keep listening until the field is quiet and
+// repeat a few times to catch cards that collided in the same slot.
+//-----------------------------------------------------------------------------
+void felica_poll(const felica_poll_req_t *req) {
+
+    felica_poll_t res;
+    memset(&res, 0, sizeof(res));
+
+    clear_trace();
+    set_tracing(true);
+    iso18092_setup(FPGA_HF_ISO18092_FLAG_READER | FPGA_HF_ISO18092_FLAG_NOMOD);
+
+    for (uint8_t round = 0; round < 4; round++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            break;
+        }
+
+        WDT_HIT();
+
+        frameSpace[3] = FELICA_POLL_REQ;
+        frameSpace[4] = req->system_code >> 8;
+        frameSpace[5] = req->system_code & 0xFF;
+        frameSpace[6] = req->request_code;
+        frameSpace[7] = req->timeslots;
+
+        frameSpace[0] = 0xb2;
+        frameSpace[1] = 0x4d;
+        frameSpace[2] = 6;
+        AddCrc(frameSpace + 2, 6);
+        TransmitFor18092_AsReader(frameSpace, 10, NULL, 1, 0);
+
+        // slots follow each other, one reply per WaitForFelicaReply
+        while (WaitForFelicaReply(1024)) {
+
+            const uint8_t *fb = FelicaFrame.framebytes;
+            if (fb[3] != FELICA_POLL_ACK) {
+                continue;
+            }
+
+            if (check_crc(CRC_FELICA, FelicaFrame.framebytes + 2, FelicaFrame.len - 2) == false) {
+                continue;
+            }
+
+            bool seen = false;
+            for (uint8_t i = 0; i < res.count; i++) {
+                if (memcmp(res.cards[i].IDm, fb + 4, 8) == 0) {
+                    seen = true;
+                    break;
+                }
+            }
+
+            if (seen == false && res.count < FELICA_POLL_MAX_CARDS) {
+                memcpy(res.cards[res.count].IDm, fb + 4, 8);
+                memcpy(res.cards[res.count].PMm, fb + 12, 8);
+                res.count++;
+            }
+        }
+    }
+
+    reply_ng(CMD_HF_FELICA_POLL, PM3_SUCCESS, (uint8_t *)&res, sizeof(res));
+    felica_reset_frame_mode();
+    set_tracing(false);
+}
+
 void felica_sniff(uint32_t samplesToSkip, uint32_t triggersToSkip) {
 
     clear_trace();
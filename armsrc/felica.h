@@ -20,8 +20,12 @@
 
 #include "common.h"
 #include "cmd.h"
+#include "iso18.h"
 
 void felica_sendraw(const PacketCommandNG *c);
+void felica_search_service(const felica_search_service_req_t *req);
+void felica_read_blocks(const felica_read_blocks_req_t *req);
+void felica_poll(const felica_poll_req_t *req);
 void felica_sniff(uint32_t samplesToSkip, uint32_t triggersToSkip);
 void felica_sim_lite(const uint8_t *uid);
 void felica_dump_lite_s(void);
@@ -45,7 +45,6 @@ static int downloaded_bitstream = 0;
 extern uint32_t _binary_obj_fpga_all_bit_z_start[], _binary_obj_fpga_all_bit_z_end[];
 
 static uint8_t *fpga_image_ptr = NULL;
-static uint32_t uncompressed_bytes_cnt;
 
 //-----------------------------------------------------------------------------
 // Set up the Serial Peripheral Interface as master
@@ -199,8 +198,11 @@ bool FpgaSetupSscDma(uint8_t *buf, uint16_t len) {
 //----------------------------------------------------------------------------
 // Uncompress (inflate) the FPGA data. Returns one decompressed byte with each call.
 //----------------------------------------------------------------------------
-static int get_from_fpga_combined_stream(lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
+static int get_from_fpga_stream(lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
     if (fpga_image_ptr == output_buffer + FPGA_RING_BUFFER_BYTES) { // need more data
+        if (compressed_fpga_stream->avail_in <= 0) {
+            return -1;
+        }
         fpga_image_ptr = output_buffer;
         int cmp_bytes;
         memcpy(&cmp_bytes, compressed_fpga_stream->next_in, sizeof(int));
@@ -217,35 +219,32 @@ static int get_from_fpga_combined_stream(lz4_streamp_t compressed_fpga_stream, u
         }
         compressed_fpga_stream->next_in += cmp_bytes;
     }
-    uncompressed_bytes_cnt++;
     return *fpga_image_ptr++;
 }
 
 //----------------------------------------------------------------------------
-// Undo the interleaving of several FPGA config files. FPGA config files
-// are combined into one big file:
-// 288 bytes from FPGA file 1, followed by 288 bytes from FGPA file 2, etc.
-//----------------------------------------------------------------------------
-static int get_from_fpga_stream(int bitstream_version, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
-    while ((uncompressed_bytes_cnt / FPGA_INTERLEAVE_SIZE) % g_fpga_bitstream_num != (bitstream_version - 1)) {
-        // skip undesired data belonging to other bitstream_versions
-        get_from_fpga_combined_stream(compressed_fpga_stream, output_buffer);
-    }
-
-    return get_from_fpga_combined_stream(compressed_fpga_stream, output_buffer);
-}
-
-//----------------------------------------------------------------------------
-// Initialize decompression of the respective (HF or LF) FPGA stream
+// Initialize decompression of the respective (HF or LF) FPGA stream.
+// Each bitstream is compressed on its own, the index at the start of
+// fpga_all.bit.z tells where, so only the wanted one gets decompressed.
 //----------------------------------------------------------------------------
 static bool reset_fpga_stream(int bitstream_version, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
     uint8_t header[FPGA_BITSTREAM_FIXED_HEADER_SIZE];
 
-    uncompressed_bytes_cnt = 0;
+    const uint8_t *all = (const uint8_t *)_binary_obj_fpga_all_bit_z_start;
+    uint32_t all_len = (uint32_t)_binary_obj_fpga_all_bit_z_end - (uint32_t)_binary_obj_fpga_all_bit_z_start;
+
+    fpga_index_t index;
+    memcpy(&index, all, sizeof(fpga_index_t));
+    if (index.magic != FPGA_INDEX_MAGIC || bitstream_version < 1 || bitstream_version > index.count)
+        return false;
+
+    fpga_index_entry_t entry;
+    memcpy(&entry, all + sizeof(fpga_index_t) + (bitstream_version - 1) * sizeof(fpga_index_entry_t), sizeof(fpga_index_entry_t));
+    if (entry.offset + entry.length > all_len)
+        return false;
 
-    // initialize z_stream structure for inflate:
-    compressed_fpga_stream->next_in = (char *)_binary_obj_fpga_all_bit_z_start;
-    compressed_fpga_stream->avail_in = (uint32_t)_binary_obj_fpga_all_bit_z_end - (uint32_t)_binary_obj_fpga_all_bit_z_start;
+    compressed_fpga_stream->next_in = (char *)all + entry.offset;
+    compressed_fpga_stream->avail_in = entry.length;
 
     int res = LZ4_setStreamDecode(compressed_fpga_stream->lz4StreamDecode, NULL, 0);
     if (res == 0)
@@ -254,7 +253,7 @@ static bool reset_fpga_stream(int bitstream_version, lz4_streamp_t compressed_fp
     fpga_image_ptr = output_buffer + FPGA_RING_BUFFER_BYTES;
 
     for (uint16_t i = 0; i < FPGA_BITSTREAM_FIXED_HEADER_SIZE; i++)
-        header[i] = get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer);
+        header[i] = get_from_fpga_stream(compressed_fpga_stream, output_buffer);
 
     // Check for a valid .bit file (starts with bitparse_fixed_header)
     if (memcmp(bitparse_fixed_header, header, FPGA_BITSTREAM_FIXED_HEADER_SIZE) == 0)
@@ -276,7 +275,7 @@ static void DownloadFPGA_byte(uint8_t w) {
 }
 
 // Download the fpga image starting at current stream position with length FpgaImageLen bytes
-static void DownloadFPGA(int bitstream_version, int FpgaImageLen, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
+static void DownloadFPGA(int FpgaImageLen, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
     int i = 0;
 #if !defined XC3
     AT91C_BASE_PIOA->PIO_OER = GPIO_FPGA_ON;
@@ -354,7 +353,7 @@ static void DownloadFPGA(int bitstream_version, int FpgaImageLen, lz4_streamp_t
 #endif
 
     for (i = 0; i < FpgaImageLen; i++) {
-        int b = get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer);
+        int b = get_from_fpga_stream(compressed_fpga_stream, output_buffer);
         if (b < 0) {
             Dbprintf("Error %d during FpgaDownload", b);
             break;
@@ -383,14 +382,14 @@ static void DownloadFPGA(int bitstream_version, int FpgaImageLen, lz4_streamp_t
  * (big endian), <length> bytes content. Except for section 'e' which has 4 bytes
  * length.
  */
-static int bitparse_find_section(int bitstream_version, char section_name, uint32_t *section_length, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
+static int bitparse_find_section(char section_name, uint32_t *section_length, lz4_streamp_t compressed_fpga_stream, uint8_t *output_buffer) {
 
 #define MAX_FPGA_BIT_STREAM_HEADER_SEARCH 100  // maximum number of bytes to search for the requested section
 
     int result = 0;
     uint16_t numbytes = 0;
     while (numbytes < MAX_FPGA_BIT_STREAM_HEADER_SEARCH) {
-        char current_name = get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer);
+        char current_name = get_from_fpga_stream(compressed_fpga_stream, output_buffer);
         numbytes++;
         uint32_t current_length = 0;
         if (current_name < 'a' || current_name > 'e') {
@@ -401,10 +400,10 @@ static int bitparse_find_section(int bitstream_version, char section_name, uint3
         switch (current_name) {
             case 'e':
                 /* Four byte length field */
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 24;
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 16;
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 8;
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 0;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 24;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 16;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 8;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 0;
                 numbytes += 4;
                 if (current_length > 300 * 1024) {
                     /* section e should never exceed about 300KB, if the length is too big limit it but still send the bitstream just in case */
@@ -412,8 +411,8 @@ static int bitparse_find_section(int bitstream_version, char section_name, uint3
                 }
                 break;
             default: /* Two byte length field */
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 8;
-                current_length += get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer) << 0;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 8;
+                current_length += get_from_fpga_stream(compressed_fpga_stream, output_buffer) << 0;
                 numbytes += 2;
                 if (current_length > 64) {
                     /* if text field is too long, keep it but truncate it */
@@ -429,7 +428,7 @@ static int bitparse_find_section(int bitstream_version, char section_name, uint3
         }
 
         for (uint32_t i = 0; i < current_length && numbytes < MAX_FPGA_BIT_STREAM_HEADER_SEARCH; i++) {
-            get_from_fpga_stream(bitstream_version, compressed_fpga_stream, output_buffer);
+            get_from_fpga_stream(compressed_fpga_stream, output_buffer);
             numbytes++;
         }
     }
@@ -510,8 +509,8 @@ void FpgaDownloadAndGo(int bitstream_version) {
         return;
 
     uint32_t bitstream_length;
-    if (bitparse_find_section(bitstream_version, 'e', &bitstream_length, &compressed_fpga_stream, output_buffer)) {
-        DownloadFPGA(bitstream_version, bitstream_length, &compressed_fpga_stream, output_buffer);
+    if (bitparse_find_section('e', &bitstream_length, &compressed_fpga_stream, output_buffer)) {
+        DownloadFPGA(bitstream_length, &compressed_fpga_stream, output_buffer);
         downloaded_bitstream = bitstream_version;
     }
 
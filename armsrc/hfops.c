@@ -29,6 +29,11 @@
 #include "util.h"
 #include "commonutil.h"
 #include "lfsampling.h"
+#include "iso14443a.h"
+#include "iso14443b.h"
+#include "iso15693.h"
+#include "iclass.h"
+#include "iso15.h"
 
 int HfReadADC(uint32_t samplesCount, bool ledcontrol) {
     if (ledcontrol) LEDsoff();
@@ -271,3 +276,126 @@ int HfSimulateTkm(const uint8_t *uid, uint8_t modulation, uint32_t timeout) {
 
     return PM3_SUCCESS;
 }
+
+static hf_discover_tag_t *hf_discover_add(hf_discover_t *d, uint8_t tech, const uint8_t *uid, uint8_t uidlen) {
+    if (d->count >= HF_DISCOVER_MAX_TAGS) {
+        return NULL;
+    }
+
+    hf_discover_tag_t *t = &d->tags[d->count++];
+    memset(t, 0, sizeof(hf_discover_tag_t));
+    t->tech = tech;
+    t->uidlen = MIN(uidlen, sizeof(t->uid));
+    memcpy(t->uid, uid, t->uidlen);
+    return t;
+}
+
+// 14a and 14b,  FPGA_BITSTREAM_HF
+static void hf_discover_hf(hf_discover_t *d, uint8_t techs) {
+
+#ifdef WITH_ISO14443a
+    if (techs & HF_DISCOVER_14A) {
+        iso14443a_setup(FPGA_HF_ISO14443A_READER_MOD);
+
+        iso14a_card_select_t card;
+        memset(&card, 0, sizeof(card));
+        // no RATS,  anything beyond the UID is left to `hf 14a info`
+        int res = iso14443a_select_card(NULL, &card, NULL, true, 0, true);
+        if (res) {
+            // res 3 = proprietary anticollision (Topaz),  ATQA only
+            hf_discover_tag_t *t = hf_discover_add(d, HF_DISCOVER_14A, card.uid, (res == 3) ? 0 : card.uidlen);
+            if (t) {
+                memcpy(t->atqa, card.atqa, sizeof(t->atqa));
+                t->sak = card.sak;
+            }
+        }
+        d->polled |= HF_DISCOVER_14A;
+    }
+#endif
+
+#ifdef WITH_ISO14443b
+    if (techs & HF_DISCOVER_14B) {
+        iso14443b_setup();
+
+        iso14b_card_select_t card;
+        memset(&card, 0, sizeof(card));
+        if (iso14443b_select_card(&card) == PM3_SUCCESS) {
+            hf_discover_tag_t *t = hf_discover_add(d, HF_DISCOVER_14B, card.uid, card.uidlen);
+            if (t) {
+                memcpy(t->atqb, card.atqb, sizeof(t->atqb));
+            }
+        }
+        d->polled |= HF_DISCOVER_14B;
+    }
+#endif
+    (void)d;
+    (void)techs;
+}
+
+// 15693 and iCLASS,  FPGA_BITSTREAM_HF_15.  Both are polled in the same field
+static void hf_discover_hf15(hf_discover_t *d, uint8_t techs) {
+
+    if ((techs & (HF_DISCOVER_15 | HF_DISCOVER_ICLASS)) == 0) {
+        return;
+    }
+
+#if defined WITH_ISO15693 || defined WITH_ICLASS
+    // tags answer within a few ms,  no need for the 250 ms given by Iso15693InitReader
+    Iso15693InitReaderEx(20);
+#endif
+
+#ifdef WITH_ISO15693
+    if (techs & HF_DISCOVER_15) {
+        uint8_t uid[8] = {0};
+        if (Iso15693Identify(uid)) {
+            hf_discover_add(d, HF_DISCOVER_15, uid, sizeof(uid));
+        }
+        d->polled |= HF_DISCOVER_15;
+    }
+#endif
+
+#ifdef WITH_ICLASS
+    if (techs & HF_DISCOVER_ICLASS) {
+        picopass_hdr_t hdr = {0};
+        uint32_t eof_time = 0;
+        if (select_iclass_tag(&hdr, false, &eof_time, false)) {
+            hf_discover_add(d, HF_DISCOVER_ICLASS, hdr.csn, sizeof(hdr.csn));
+        }
+        d->polled |= HF_DISCOVER_ICLASS;
+    }
+#endif
+    (void)d;
+}
+
+// One polling pass over the requested technologies,  all found tags are sent in one reply.
+// The technologies of the FPGA image already loaded go first,  so there is at most one image swap.
+int HfDiscover(uint8_t techs, bool ledcontrol) {
+
+    if (ledcontrol) LEDsoff();
+
+    hf_discover_t d;
+    memset(&d, 0, sizeof(d));
+
+    uint32_t start_time = GetTickCount();
+
+    clear_trace();
+    set_tracing(true);
+
+    if (FpgaGetCurrent() == FPGA_BITSTREAM_HF_15) {
+        hf_discover_hf15(&d, techs);
+        hf_discover_hf(&d, techs);
+    } else {
+        hf_discover_hf(&d, techs);
+        hf_discover_hf15(&d, techs);
+    }
+
+    switch_off();
+    set_tracing(false);
+
+    d.ms = GetTickCountDelta(start_time);
+
+    if (ledcontrol) LEDsoff();
+
+    reply_ng(CMD_HF_DISCOVER, (d.count) ? PM3_SUCCESS : PM3_ENODATA, (uint8_t *)&d, sizeof(d));
+    return PM3_SUCCESS;
+}
@@ -23,5 +23,6 @@
 
 int HfReadADC(uint32_t samplesCount, bool ledcontrol);
 int HfSimulateTkm(const uint8_t *uid, uint8_t modulation, uint32_t timeout);
+int HfDiscover(uint8_t techs, bool ledcontrol);
 
 #endif
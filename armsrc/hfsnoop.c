@@ -25,6 +25,7 @@
 #include "fpga.h"
 #include "appmain.h"
 #include "cmd.h"
+#include "usb_cdc.h"
 
 static void RAMFUNC optimizedSniff(uint16_t *dest, uint16_t dsize) {
     while (dsize > 0) {
@@ -85,11 +86,105 @@ static void RAMFUNC skipSniff(uint8_t *dest, uint16_t dsize, uint8_t skipMode, u
     }
 }
 
-int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint8_t skipMode, uint8_t skipRatio) {
+// Real-time mode,  the samples go straight to the usb IN endpoint instead of BigBuf.
+// Runs until the button is pressed or the client sends anything.  When the host
+// doesn't empty the endpoint in time, samples are lost while waiting for it.
+static int RAMFUNC streamSniff(uint8_t skipMode, uint8_t skipRatio) {
+
+    int res = async_usb_write_start();
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    uint32_t accum = (skipMode == HF_SNOOP_SKIP_MIN) ? 0xffffffff : 0;
+    uint8_t ratioindx = 0;
+    uint8_t fifo = 0;
+
+    for (;;) {
+
+        if ((AT91C_BASE_SSC->SSC_SR & AT91C_SSC_RXRDY) == 0) {
+            continue;
+        }
+
+        uint16_t val = (uint16_t)(AT91C_BASE_SSC->SSC_RHR);
+
+        if (skipMode == HF_SNOOP_SKIP_NONE) {
+            // same byte order as the BigBuf capture
+            async_usb_write_pushByte(val & 0xff);
+            async_usb_write_pushByte(val >> 8);
+            fifo += 2;
+        } else {
+
+            switch (skipMode) {
+                case HF_SNOOP_SKIP_MAX:
+                    if (accum < (val & 0xff))
+                        accum = val & 0xff;
+                    if (accum < (val >> 8))
+                        accum = val >> 8;
+                    break;
+                case HF_SNOOP_SKIP_MIN:
+                    if (accum > (val & 0xff))
+                        accum = val & 0xff;
+                    if (accum > (val >> 8))
+                        accum = val >> 8;
+                    break;
+                case HF_SNOOP_SKIP_AVG:
+                    accum += (val & 0xff) + (val & 0xff);
+                    break;
+                default: { // HF_SNOOP_SKIP_DROP and the rest
+                    if (ratioindx == 0)
+                        accum = val & 0xff;
+                }
+            }
+
+            ratioindx++;
+            if (ratioindx < skipRatio) {
+                continue;
+            }
+
+            if (skipMode == HF_SNOOP_SKIP_AVG && skipRatio > 0) {
+                accum = accum / (skipRatio * 2);
+            }
+
+            async_usb_write_pushByte((accum <= 0xff) ? accum : 0xff);
+            fifo++;
+
+            accum = (skipMode == HF_SNOOP_SKIP_MIN) ? 0xffffffff : 0;
+            ratioindx = 0;
+        }
+
+        if (fifo < AT91C_USB_EP_IN_SIZE) {
+            continue;
+        }
+        fifo = 0;
+
+        // other bank still on its way to the host
+        while (async_usb_write_requestWrite() == false) {
+            WDT_HIT();
+        }
+
+        if (BUTTON_PRESS()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        if (data_available_fast()) {
+            break;
+        }
+    }
+
+    int ret = async_usb_write_stop();
+    return (res != PM3_SUCCESS) ? res : ret;
+}
+
+int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint8_t skipMode, uint8_t skipRatio, bool realtime) {
     BigBuf_free();
     BigBuf_Clear_ext(false);
 
-    Dbprintf("Skipping first %d sample pairs, Skipping %d triggers", samplesToSkip, triggersToSkip);
+    // in real-time mode the usb carries raw samples only,  no prints
+    if (realtime == false) {
+        Dbprintf("Skipping first %d sample pairs, Skipping %d triggers", samplesToSkip, triggersToSkip);
+    }
 
     LED_D_ON();
 
@@ -106,8 +201,12 @@ int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_SNIFF);
     SpinDelay(100);
 
-    *len = BigBuf_max_traceLen();
-    uint8_t *mem = BigBuf_malloc(*len);
+    *len = 0;
+    uint8_t *mem = NULL;
+    if (realtime == false) {
+        *len = BigBuf_max_traceLen();
+        mem = BigBuf_malloc(*len);
+    }
 
     uint32_t trigger_cnt = 0;
     uint16_t r = 0, interval = 0;
@@ -144,6 +243,8 @@ int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint
         pressed = BUTTON_PRESS();
     }
 
+    int res = PM3_SUCCESS;
+
     if (pressed == false) {
 
         // skip samples loop
@@ -154,12 +255,14 @@ int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint
             }
         }
 
-        if (skipMode == 0)
+        if (realtime)
+            res = streamSniff(skipMode, skipRatio);
+        else if (skipMode == 0)
             optimizedSniff((uint16_t *)mem, *len);
         else
             skipSniff(mem, *len, skipMode, skipRatio);
 
-        if (g_dbglevel >= DBG_INFO) {
+        if (realtime == false && g_dbglevel >= DBG_INFO) {
             Dbprintf("Trigger kicked in (%d >= 180)", r);
             Dbprintf("Collected %u samples", *len);
         }
@@ -170,7 +273,7 @@ int HfSniff(uint32_t samplesToSkip, uint32_t triggersToSkip, uint16_t *len, uint
     LED_D_OFF();
     FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
     BigBuf_free();
-    return (pressed) ? PM3_EOPABORTED : PM3_SUCCESS;
+    return (pressed) ? PM3_EOPABORTED : res;
 }
 
 void HfPlotDownload(void) {
@@ -24,6 +24,7 @@
 #include "BigBuf.h"
 #include "fpgaloader.h"
 #include "ticks.h"
+#include "simstats.h"
 #include "dbprint.h"
 #include "util.h"
 #include "lfadc.h"
@@ -87,6 +88,36 @@ static uint8_t *auth_table;
 static size_t auth_table_pos = 0;
 static size_t auth_table_len = AUTH_TABLE_LENGTH;
 
+// keep each nR aR pair only once, readers tend to retry with the same challenge
+static void hitag2_store_nrar(const uint8_t *nrar) {
+    for (size_t i = 0; i < auth_table_len; i += 8) {
+        if (memcmp(auth_table + i, nrar, 8) == 0) {
+            return;
+        }
+    }
+
+    if (auth_table_len < (AUTH_TABLE_LENGTH - 8)) {
+        memcpy(auth_table + auth_table_len, nrar, 8);
+        auth_table_len += 8;
+    }
+}
+
+// send the collected pairs back, ready for ht2crack4 / ht2crack5
+static void hitag2_reply_nrar(uint16_t cmd, const uint8_t *uid) {
+    lf_hitag2_nrar_t out;
+    memset(&out, 0, sizeof(out));
+
+    if (uid) {
+        memcpy(out.uid, uid, sizeof(out.uid));
+    }
+
+    out.total = auth_table_len / 8;
+    out.count = MIN(out.total, HITAG2_NRAR_MAX);
+    memcpy(out.nrar, auth_table, out.count * 8);
+
+    reply_ng(cmd, PM3_SUCCESS, (uint8_t *)&out, sizeof(out));
+}
+
 static uint8_t password[4];
 static uint8_t NrAr[8];
 static uint8_t key[8];
@@ -287,10 +318,7 @@ static void hitag2_handle_reader_command(uint8_t *rx, const size_t rxlen, uint8_
         // Received RWD authentication challenge and response
         case 64: {
             // Store the authentication attempt
-            if (auth_table_len < (AUTH_TABLE_LENGTH - 8)) {
-                memcpy(auth_table + auth_table_len, rx, 8);
-                auth_table_len += 8;
-            }
+            hitag2_store_nrar(rx);
 
             // Reset the cipher state
             ht2_hitag2_cipher_reset(&tag, rx);
@@ -1249,6 +1277,9 @@ void SniffHitag2(bool ledcontrol) {
 
     auth_table = (uint8_t *)BigBuf_calloc(AUTH_TABLE_LENGTH);
 
+    uint8_t uid[4] = {0};
+    bool have_uid = false, uid_next = false;
+
     while (BUTTON_PRESS() == false) {
 
         WDT_HIT();
@@ -1363,10 +1394,18 @@ void SniffHitag2(bool ledcontrol) {
             // Check if we recognize a valid authentication attempt
             if (rxlen == 64) {
                 // Store the authentication attempt
-                if (auth_table_len < (AUTH_TABLE_LENGTH - 8)) {
-                    memcpy(auth_table + auth_table_len, rx, 8);
-                    auth_table_len += 8;
+                hitag2_store_nrar(rx);
+            }
+
+            // The first tag frame answering a 5 bit START_AUTH is the UID
+            if (reader_frame && rxlen == 5) {
+                uid_next = (have_uid == false);
+            } else {
+                if (uid_next && reader_frame == false && rxlen == 32) {
+                    memcpy(uid, rx, sizeof(uid));
+                    have_uid = true;
                 }
+                uid_next = false;
             }
 
             if (ledcontrol) {
@@ -1410,6 +1449,7 @@ void SniffHitag2(bool ledcontrol) {
     Dbprintf("Auth attempts... %d", (auth_table_len / 8));
 
     switch_off();
+    hitag2_reply_nrar(CMD_LF_HITAG_SNIFF, have_uid ? uid : NULL);
     BigBuf_free();
 }
 
@@ -1431,14 +1471,16 @@ void SimulateHitag2(bool ledcontrol) {
 
     auth_table_len = 0;
     auth_table_pos = 0;
-//    auth_table = BigBuf_malloc(AUTH_TABLE_LENGTH);
-//    memset(auth_table, 0x00, AUTH_TABLE_LENGTH);
+    // the sample buffer is re-allocated every round, which only keeps emulator memory.
+    // Park the table behind the 64 pages an eload can fill.
+    auth_table = BigBuf_get_EM_addr() + (4 * 64);
 
     // Reset the received frame, frame count and timing info
 //    memset(rx, 0x00, sizeof(rx));
 //    memset(tx, 0x00, sizeof(tx));
 
     DbpString("Starting Hitag2 simulation");
+    sim_stats_start(SIM_STATS_HITAG2, SIM_STATS_BUDGET_HITAG2_US);
 
     // hitag2 state machine?
     hitag2_init();
@@ -1583,6 +1625,7 @@ void SimulateHitag2(bool ledcontrol) {
         // Verify if the header consists of five consecutive ones
         if (nrzs < 5) {
             Dbprintf("Detected unexpected number of manchester decoded samples [%d]", nrzs);
+            sim_stats_frame_error();
             continue;
         } else {
             for (size_t i = 0; i < 5; i++) {
@@ -1602,10 +1645,14 @@ void SimulateHitag2(bool ledcontrol) {
         // Check if frame was captured
         if (rxlen > 4) {
 
+            sim_stats_frame();
             LogTraceBits(rx, rxlen, response, response, true);
 
             // Process the incoming frame (rx) and prepare the outgoing frame (tx)
             hitag2_handle_reader_command(rx, rxlen, tx, &txlen);
+            if (txlen) {
+                sim_stats_answer();
+            }
 
             // Wait for HITAG_T_WAIT_1 carrier periods after the last reader bit,
             // not that since the clock counts since the rising edge, but T_Wait1 is
@@ -1634,12 +1681,14 @@ void SimulateHitag2(bool ledcontrol) {
 
     lf_finalize(ledcontrol);
 
-    // release allocated memory from BigBuff.
-    BigBuf_free();
-
     DbpString("Sim stopped");
+    Dbprintf("Auth attempts... %d", (auth_table_len / 8));
+    sim_stats_stop();
 
-//    reply_ng(CMD_LF_HITAG_SIMULATE, (checked == -1) ? PM3_EOPABORTED : PM3_SUCCESS, (uint8_t *)tag.sectors, tag_size);
+    hitag2_reply_nrar(CMD_LF_HITAG_SIMULATE, tag.sectors[0]);
+
+    // release allocated memory from BigBuff.
+    BigBuf_free();
 }
 
 void ReaderHitag(const lf_hitag_data_t *payload, bool ledcontrol) {
@@ -1797,6 +1846,10 @@ void ReaderHitag(const lf_hitag_data_t *payload, bool ledcontrol) {
     int16_t checked = 0;
     uint32_t signal_size = 10000;
 
+    // Hitag 2 pages already handed to the client
+    bool stream = (payload->flags & HITAG_READER_STREAM_PAGES) && (payload->cmd > HT1_LAST_CMD) && (payload->cmd <= HT2_LAST_CMD);
+    int16_t streamed = blocknr;
+
     while (bStop == false && BUTTON_PRESS() == false) {
 
         // use malloc
@@ -1848,6 +1901,13 @@ void ReaderHitag(const lf_hitag_data_t *payload, bool ledcontrol) {
             }
         }
 
+        // hand over freshly read pages, the tag keeps its state until the next command
+        for (; stream && streamed < blocknr && streamed < 8; streamed++) {
+            lf_hitag_page_t page = { .page = streamed };
+            memcpy(page.data, tag.sectors[streamed], sizeof(page.data));
+            reply_ng(CMD_LF_HITAG_READER_PAGE, PM3_SUCCESS, (uint8_t *)&page, sizeof(page));
+        }
+
         if (bStop) {
             break;
         }
@@ -2464,6 +2524,9 @@ static bool ht2_receive(uint32_t *resp_start, uint32_t *resp_duration, uint8_t *
     // Use the current modulation state as starting point
     uint8_t tag_modulation = lf_get_tag_modulation();
 
+    // Let the PDC collect the samples, falls back to polling when the ring can't be had
+    lf_capture_start();
+
     // Raw demodulation/decoding by sampling edge periods
 
     while (nrzs < HT2_MAX_NRSZ) {
@@ -2537,6 +2600,8 @@ static bool ht2_receive(uint32_t *resp_start, uint32_t *resp_duration, uint8_t *
         }
     }
 
+    lf_capture_stop();
+
     // Make sure we always have an even number of samples. This fixes the problem
     // of ending the manchester decoding with a zero. See the example below where
     // the '|' character is end of modulation
@@ -1485,24 +1485,75 @@ void ReadHitagS(const lf_hitag_data_t *payload, bool ledcontrol) {
     reply_ng(CMD_LF_HITAGS_READ, PM3_SUCCESS, (uint8_t *)tag.pages, sizeof(tag.pages));
 }
 
+static int hitagS_write_page(uint8_t page, const uint8_t *pagedata, uint8_t *tx, size_t sizeoftx, uint8_t *rx, size_t sizeofrx, int t_wait, bool ledcontrol) {
+
+    size_t rxlen = 0;
+    size_t txlen = 0;
+
+    //send write page request
+    uint8_t cmd = 0x08;
+    txlen = concatbits(tx, txlen, &cmd, 8 - 4, 4);
+
+    txlen = concatbits(tx, txlen, &page, 0, 8);
+
+    uint8_t crc = CRC8Hitag1Bits(tx, txlen);
+    txlen = concatbits(tx, txlen, &crc, 0, 8);
+
+    sendReceiveHitagS(tx, txlen, rx, sizeofrx, &rxlen, t_wait, ledcontrol, false);
+
+    if ((rxlen != 2) || (rx[0] >> (8 - 2) != 0x1)) {
+        Dbprintf("no write access on page " _YELLOW_("%d"), page);
+        return PM3_ESOFT;
+    }
+
+    //ACK received to write the page. send data
+    uint8_t data[4];
+    data[0] = pagedata[3];
+    data[1] = pagedata[2];
+    data[2] = pagedata[1];
+    data[3] = pagedata[0];
+
+    txlen = 0;
+    txlen = concatbits(tx, txlen, data, 0, 32);
+    crc = CRC8Hitag1Bits(tx, txlen);
+    txlen = concatbits(tx, txlen, &crc, 0, 8);
+
+    sendReceiveHitagS(tx, txlen, rx, sizeofrx, &rxlen, t_wait, ledcontrol, false);
+
+    if ((rxlen != 2) || (rx[0] >> (8 - 2) != 0x1)) {
+        return PM3_ESOFT; //  write failed
+    }
+    return PM3_SUCCESS;
+}
+
 /*
  * Authenticates to the Tag with the given Key or Challenge.
  * Writes the given 32Bit data into page_
+ * Data for the following pages can be appended after the payload,  4 bytes per page.
+ * They are written in the same session,  without selecting and authenticating again.
  */
-void WritePageHitagS(const lf_hitag_data_t *payload, bool ledcontrol) {
+void WritePageHitagS(const lf_hitag_data_t *payload, uint16_t len, bool ledcontrol) {
 
     //check for valid input
-    if (payload->page == 0) {
+    if (payload->page <= 0) {
         Dbprintf("Error, invalid page");
         reply_ng(CMD_LF_HITAGS_WRITE, PM3_EINVARG, NULL, 0);
         return;
     }
 
-    uint8_t rx[HITAG_FRAME_LEN];
-    size_t rxlen = 0;
+    if (payload->cmd != WHTSF_CHALLENGE && payload->cmd != WHTSF_KEY) {
+        reply_ng(CMD_LF_HITAGS_WRITE, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    const uint8_t *more = (const uint8_t *)payload + sizeof(lf_hitag_data_t);
+    int pages = 1;
+    if (len > sizeof(lf_hitag_data_t)) {
+        pages += (len - sizeof(lf_hitag_data_t)) / 4;
+    }
 
+    uint8_t rx[HITAG_FRAME_LEN];
     uint8_t tx[HITAG_FRAME_LEN];
-    size_t txlen = 0;
 
     int t_wait = HITAG_T_WAIT_MAX;
 
@@ -1513,65 +1564,27 @@ void WritePageHitagS(const lf_hitag_data_t *payload, bool ledcontrol) {
         goto write_end;
     }
 
-    //check if the given page exists
-    if (payload->page > tag.max_page) {
+    //check if the given pages exist
+    if (payload->page + pages - 1 > tag.max_page) {
         Dbprintf("Error, page number too large");
         res = PM3_EINVARG;
         goto write_end;
     }
 
-    //send write page request
-    txlen = 0;
+    for (int i = 0; i < pages; i++) {
 
-    uint8_t cmd = 0x08;
-    txlen = concatbits(tx, txlen, &cmd, 8 - 4, 4);
-
-    uint8_t addr = payload->page;
-    txlen = concatbits(tx, txlen, &addr, 0, 8);
-
-    uint8_t crc = CRC8Hitag1Bits(tx, txlen);
-    txlen = concatbits(tx, txlen, &crc, 0, 8);
-
-    sendReceiveHitagS(tx, txlen, rx, ARRAYLEN(rx), &rxlen, t_wait, ledcontrol, false);
-
-    if ((rxlen != 2) || (rx[0] >> (8 - 2) != 0x1)) {
-        Dbprintf("no write access on page " _YELLOW_("%d"), payload->page);
-        res = PM3_ESOFT;
-        goto write_end;
-    }
+        WDT_HIT();
 
-    //ACK received to write the page. send data
-    uint8_t data[4] = {0, 0, 0, 0};
-    switch (payload->cmd) {
-        case WHTSF_CHALLENGE:
-            data[0] = payload->data[3];
-            data[1] = payload->data[2];
-            data[2] = payload->data[1];
-            data[3] = payload->data[0];
-            break;
-        case WHTSF_KEY:
-            data[0] = payload->data[3];
-            data[1] = payload->data[2];
-            data[2] = payload->data[1];
-            data[3] = payload->data[0];
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
             break;
-        default: {
-            res = PM3_EINVARG;
-            goto write_end;
         }
-    }
-
-    txlen = 0;
-    txlen = concatbits(tx, txlen, data, 0, 32);
-    crc = CRC8Hitag1Bits(tx, txlen);
-    txlen = concatbits(tx, txlen, &crc, 0, 8);
-
-    sendReceiveHitagS(tx, txlen, rx, ARRAYLEN(rx), &rxlen, t_wait, ledcontrol, false);
 
-    if ((rxlen != 2) || (rx[0] >> (8 - 2) != 0x1)) {
-        res = PM3_ESOFT; //  write failed
-    } else {
-        res = PM3_SUCCESS;
+        const uint8_t *pagedata = (i == 0) ? payload->data : more + ((i - 1) * 4);
+        res = hitagS_write_page(payload->page + i, pagedata, tx, ARRAYLEN(tx), rx, ARRAYLEN(rx), t_wait, ledcontrol);
+        if (res != PM3_SUCCESS) {
+            break;
+        }
     }
 
 write_end:
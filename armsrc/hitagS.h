@@ -26,6 +26,6 @@
 
 void SimulateHitagSTag(bool tag_mem_supplied, const uint8_t *data, bool ledcontrol);
 void ReadHitagS(const lf_hitag_data_t *payload, bool ledcontrol);
-void WritePageHitagS(const lf_hitag_data_t *payload, bool ledcontrol);
+void WritePageHitagS(const lf_hitag_data_t *payload, uint16_t len, bool ledcontrol);
 void Hitag_check_challenges(const uint8_t *data, uint32_t datalen, bool ledcontrol);
 #endif
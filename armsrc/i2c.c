@@ -24,6 +24,7 @@
 #include "dbprint.h"
 #include "util.h"
 #include "string.h"
+#include "protocols.h"
 
 #define GPIO_RST AT91C_PIO_PA1
 #define GPIO_SCL AT91C_PIO_PA5
@@ -187,19 +188,23 @@ static bool WaitSCL_L(void) {
     return WaitSCL_L_delay(5000);
 }
 
-// Wait max 1800ms or until SCL goes LOW.
+// Wait max 1200ms or until SCL goes LOW.
 // It timeout reading response from card
-// Which ever comes first
+// Which ever comes first.
+// SCL is polled every I2C_DELAY_1CLK against a ticks deadline, polling once per ms added up
+// to 1ms latency to every answer from the module.
+#define I2C_WAIT_SIM_TICKS (1200 * 1500)
+#define I2C_WAIT_SIM_SPIN  (1200 * 1000 * 100 / 307)  // same in I2C_DELAY_1CLK steps
 static bool WaitSCL_L_timeout(void) {
-    volatile uint32_t delay = 1200;
-    while (delay--) {
+    uint32_t start = GetTicks();
+    while (GetTicksDelta(start) < I2C_WAIT_SIM_TICKS) {
         // exit on SCL LOW
         if (SCL_read == false)
             return true;
 
-        WaitMS(1);
+        I2C_DELAY_1CLK;
     }
-    return (delay == 0);
+    return false;
 }
 
 static bool I2C_Start(void) {
@@ -748,13 +753,19 @@ int I2C_get_version(uint8_t *major, uint8_t *minor) {
 }
 
 // Will read response from smart card module,  retries 3 times to get the data.
-bool sc_rx_bytes(uint8_t *dest, uint16_t *destlen, uint32_t wait) {
+// busy_seen,  the module was already seen busy (SCL low) by sc_tx_begin
+static bool sc_rx_bytes_ex(uint8_t *dest, uint16_t *destlen, uint32_t wait, bool busy_seen) {
 
     uint8_t i = 10;
     int16_t len = 0;
     while (i--) {
 
-        I2C_WaitForSim(wait);
+        if (busy_seen) {
+            WaitSCL_H_delay(wait);
+            busy_seen = false;
+        } else {
+            I2C_WaitForSim(wait);
+        }
 
         len = I2C_BufferRead(dest, *destlen, I2C_DEVICE_CMD_READ, I2C_DEVICE_ADDRESS_MAIN);
 
@@ -777,6 +788,28 @@ bool sc_rx_bytes(uint8_t *dest, uint16_t *destlen, uint32_t wait) {
     return true;
 }
 
+bool sc_rx_bytes(uint8_t *dest, uint16_t *destlen, uint32_t wait) {
+    return sc_rx_bytes_ex(dest, destlen, wait, false);
+}
+
+// Split phase exchange.  Sends the command and returns once the module holds SCL low, busy with the
+// card.  Only spin delays are used, no ticks, so a running RF session keeps its ssp clock and the
+// caller can talk to its tag meanwhile.  Collect the answer with sc_rx_bytes_ready.
+bool sc_tx_begin(const uint8_t *data, uint16_t len, uint8_t device_cmd) {
+    if (I2C_BufferWrite(data, len, device_cmd, I2C_DEVICE_ADDRESS_MAIN) == false) {
+        return false;
+    }
+
+    // like sc_rx_bytes,  a module which never shows busy is left to the read
+    WaitSCL_L_delay(I2C_WAIT_SIM_SPIN);
+    return true;
+}
+
+// answer to sc_tx_begin,  needs the ticks running again
+bool sc_rx_bytes_ready(uint8_t *dest, uint16_t *destlen, uint32_t wait) {
+    return sc_rx_bytes_ex(dest, destlen, wait, true);
+}
+
 bool GetATR(smart_card_atr_t *card_ptr, bool verbose) {
 
     if (card_ptr == NULL) {
@@ -854,11 +887,79 @@ void SmartCardAtr(void) {
 //    StopTicks();
 }
 
+// Handle T=0 response chaining on device, saves a usb round trip per part.
+//  6Cxx  -> resend the command with Le = xx
+//  61xx  -> GET RESPONSE xx bytes, repeated until the card stops asking
+// Returns the total length of data + final SW in resp.
+static uint16_t smart_chain_t0(const smart_card_raw_t *p, uint8_t *resp, uint16_t len, uint16_t maxlen, uint32_t wait) {
+
+    if (len == 2 && resp[0] == 0x6C && p->len >= 5) {
+
+        uint8_t cmd[5];
+        memcpy(cmd, p->data, sizeof(cmd));
+        cmd[4] = resp[1];
+
+        LogTrace(cmd, 5, 0, 0, NULL, true);
+        if (I2C_BufferWrite(cmd, 5, I2C_DEVICE_CMD_SEND_T0, I2C_DEVICE_ADDRESS_MAIN) == false) {
+            return len;
+        }
+
+        len = ISO7816_MAX_FRAME;
+        if (sc_rx_bytes(resp, &len, wait) == false) {
+            return 0;
+        }
+        LogTrace(resp, len, 0, 0, NULL, false);
+    }
+
+    while (len >= 2 && (resp[len - 2] == 0x61 || resp[len - 2] == 0x9F)) {
+
+        uint8_t le = resp[len - 1];
+
+        // Don't discard data we already received except the SW code.
+        // If we only received 1 byte, this is the echo of INS, we discard it.
+        uint16_t ofs = len - 2;
+        if (ofs == 1) {
+            ofs = 0;
+        }
+
+        // next part wouldn't fit in the reply, let the client pick it up
+        uint16_t need = (le == 0) ? 256 : le;
+        if (ofs + need + 2 > maxlen) {
+            break;
+        }
+
+        uint8_t cmd_getresp[] = {0x00, ISO7816_GET_RESPONSE, 0x00, 0x00, le};
+        LogTrace(cmd_getresp, sizeof(cmd_getresp), 0, 0, NULL, true);
+        if (I2C_BufferWrite(cmd_getresp, sizeof(cmd_getresp), I2C_DEVICE_CMD_SEND_T0, I2C_DEVICE_ADDRESS_MAIN) == false) {
+            break;
+        }
+
+        uint16_t more = ISO7816_MAX_FRAME;
+        if (sc_rx_bytes(resp + ofs, &more, wait) == false) {
+            break;
+        }
+        LogTrace(resp + ofs, more, 0, 0, NULL, false);
+
+        // strip the ACK byte (INS echo) if present
+        if (more == need + 3 && resp[ofs] == ISO7816_GET_RESPONSE) {
+            more--;
+            memmove(resp + ofs, resp + ofs + 1, more);
+        }
+
+        len = ofs + more;
+        if (len > maxlen) {
+            len = maxlen;
+            break;
+        }
+    }
+    return len;
+}
+
 void SmartCardRaw(const smart_card_raw_t *p) {
     LED_D_ON();
 
     uint16_t len = 0;
-    uint8_t *resp = BigBuf_malloc(ISO7816_MAX_FRAME);
+    uint8_t *resp = BigBuf_malloc(SC_RAW_CHAIN_MAX + ISO7816_MAX_FRAME);
     // check if alloacted...
     smartcard_command_t flags = p->flags;
 
@@ -915,6 +1016,10 @@ void SmartCardRaw(const smart_card_raw_t *p) {
         } else {
             len = 0;
         }
+
+        if ((flags & SC_CHAINING) == SC_CHAINING) {
+            len = smart_chain_t0(p, resp, len, SC_RAW_CHAIN_MAX, wait);
+        }
     }
 
     reply_ng(CMD_SMART_RAW, PM3_SUCCESS, resp, len);
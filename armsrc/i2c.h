@@ -33,6 +33,9 @@
 // The SIM module v4 supports up to 384 bytes for the length.
 #define  ISO7816_MAX_FRAME 270
 
+// device side T=0 chaining collects up to one usb reply worth of data
+#define SC_RAW_CHAIN_MAX PM3_CMD_DATA_SIZE
+
 // 8051 speaks with smart card.
 // 1000*50*3.07   = 153.5ms
 // 1 byte transfer == 1ms with max frame being 256 bytes
@@ -58,6 +61,8 @@ int16_t I2C_ReadFW(uint8_t *data, uint8_t len, uint8_t msb, uint8_t lsb, uint8_t
 bool I2C_WriteFW(const uint8_t *data, uint8_t len, uint8_t msb, uint8_t lsb, uint8_t device_address);
 
 bool sc_rx_bytes(uint8_t *dest, uint16_t *destlen, uint32_t wait);
+bool sc_tx_begin(const uint8_t *data, uint16_t len, uint8_t device_cmd);
+bool sc_rx_bytes_ready(uint8_t *dest, uint16_t *destlen, uint32_t wait);
 //
 bool GetATR(smart_card_atr_t *card_ptr, bool verbose);
 
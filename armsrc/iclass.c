@@ -35,6 +35,8 @@
 #include "dbprint.h"
 #include "protocols.h"
 #include "ticks.h"
+#include "simstats.h"
+#include "rfretry.h"
 #include "iso15693.h"
 #include "iclass_cmd.h"              // iclass_card_select_t struct
 #include "i2c.h"                     // i2c defines (SIM module access)
@@ -48,6 +50,24 @@ uint8_t get_pagemap(const picopass_hdr_t *hdr) {
 #define ICLASS_16KS_SIZE       0x100 * 8
 #endif
 
+// simulator block read cache,  answer is 8 bytes + 2 CRC, modulated to 22 bytes
+#define ICLASS_RESP_CACHE_SLOTS      32
+#define ICLASS_RESP_CACHE_SLOT_SIZE  24
+
+// Reader attack modes (sim 2 / 4) only differ by CSN between sessions,
+// so the CSN dependent answers are encoded for every CSN before the reader shows up.
+// 22: Takes 2 bytes for SOF/EOF and 10 * 2 = 20 bytes (2 bytes/byte)
+typedef struct {
+    uint8_t csn_data[10];
+    uint8_t anticoll_data[10];
+    uint8_t resp_csn[22];
+    uint8_t resp_anticoll[22];
+    uint8_t resp_csn_len;
+    uint8_t resp_anticoll_len;
+} iclass_sim_csn_t;
+
+static int do_iclass_simulation_ex(int simulationMode, uint8_t *reader_mac_buf, const iclass_sim_csn_t *pre);
+
 /*
 * CARD TO READER
 * in ISO15693-2 mode -  Manchester
@@ -139,6 +159,38 @@ void SimulateIClass(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_t *datain
     iclass_simulate(arg0, arg1, arg2, datain, NULL, NULL);
 }
 
+// CSN followed by two CRC bytes,  the anticollision CSN likewise
+static void iclass_sim_prepare_csn(const uint8_t *csn, uint8_t *csn_data, uint8_t *anticoll_data) {
+    memcpy(csn_data, csn, 8);
+    rotateCSN(csn_data, anticoll_data);
+    AddCrc(anticoll_data, 8);
+    AddCrc(csn_data, 8);
+}
+
+// returns NULL if BigBuf can't hold the table,  the simulation then encodes per CSN as before
+static iclass_sim_csn_t *iclass_sim_prepare_csns(const uint8_t *csns, uint8_t num_csns) {
+
+    iclass_sim_csn_t *table = (iclass_sim_csn_t *)BigBuf_malloc(num_csns * sizeof(iclass_sim_csn_t));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    tosend_t *ts = get_tosend();
+    for (uint8_t i = 0; i < num_csns; i++) {
+        iclass_sim_csn_t *e = &table[i];
+        iclass_sim_prepare_csn(csns + (i * 8), e->csn_data, e->anticoll_data);
+
+        CodeIso15693AsTag(e->anticoll_data, sizeof(e->anticoll_data));
+        memcpy(e->resp_anticoll, ts->buf, ts->max);
+        e->resp_anticoll_len = ts->max;
+
+        CodeIso15693AsTag(e->csn_data, sizeof(e->csn_data));
+        memcpy(e->resp_csn, ts->buf, ts->max);
+        e->resp_csn_len = ts->max;
+    }
+    return table;
+}
+
 void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_t *datain, uint8_t *dataout, uint16_t *dataoutlen) {
 
     LEDsoff();
@@ -150,6 +202,8 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
     // only logg if we are called from the client.
     set_tracing(send_reply);
 
+    sim_stats_start(SIM_STATS_ICLASS, SIM_STATS_BUDGET_ICLASS_US);
+
     //Use the emulator memory for SIM
     uint8_t *emulator = BigBuf_get_EM_addr();
     uint8_t mac_responses[PM3_CMD_DATA_SIZE] = { 0 };
@@ -173,12 +227,15 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
         // in order to collect MAC's from the reader. This can later be used in an offlne-attack
         // in order to obtain the keys, as in the "dismantling iclass"-paper.
 #define EPURSE_MAC_SIZE 16
+        BigBuf_free_keep_EM();
+        iclass_sim_csn_t *pre = iclass_sim_prepare_csns(datain, num_csns);
+
         int i = 0;
         for (; i < num_csns && i * EPURSE_MAC_SIZE + 8 < PM3_CMD_DATA_SIZE; i++) {
 
             memcpy(emulator, datain + (i * 8), 8);
 
-            if (do_iclass_simulation(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + i * EPURSE_MAC_SIZE)) {
+            if (do_iclass_simulation_ex(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + i * EPURSE_MAC_SIZE, pre ? &pre[i] : NULL)) {
 
                 if (dataoutlen)
                     *dataoutlen = i * EPURSE_MAC_SIZE;
@@ -226,6 +283,9 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
 
         // keyroll mode,   reader swaps between old key and new key alternatively when fail a authentication.
         // attack below is same as SIM 2, but we run the CSN twice to collected the mac for both keys.
+        BigBuf_free_keep_EM();
+        iclass_sim_csn_t *pre = iclass_sim_prepare_csns(datain, num_csns);
+
         int i = 0;
         // The usb data is 512 bytes, fitting 65 8-byte CSNs in there.  iceman fork uses 9 CSNS
         for (; i < num_csns && i * EPURSE_MAC_SIZE + 8 < PM3_CMD_DATA_SIZE; i++) {
@@ -233,7 +293,7 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
             memcpy(emulator, datain + (i * 8), 8);
 
             // keyroll 1
-            if (do_iclass_simulation(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + i * EPURSE_MAC_SIZE)) {
+            if (do_iclass_simulation_ex(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + i * EPURSE_MAC_SIZE, pre ? &pre[i] : NULL)) {
 
                 if (dataoutlen)
                     *dataoutlen = i * EPURSE_MAC_SIZE * 2;
@@ -246,7 +306,7 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
             }
 
             // keyroll 2
-            if (do_iclass_simulation(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + (i + num_csns) * EPURSE_MAC_SIZE)) {
+            if (do_iclass_simulation_ex(ICLASS_SIM_MODE_EXIT_AFTER_MAC, mac_responses + (i + num_csns) * EPURSE_MAC_SIZE, pre ? &pre[i] : NULL)) {
 
                 if (dataoutlen)
                     *dataoutlen = i * EPURSE_MAC_SIZE * 2;
@@ -273,6 +333,8 @@ void iclass_simulate(uint8_t sim_type, uint8_t num_csns, bool send_reply, uint8_
     }
 
 out:
+    sim_stats_stop();
+
     if (dataout && dataoutlen)
         memcpy(dataout, mac_responses, *dataoutlen);
 
@@ -289,9 +351,22 @@ out:
  * @param breakAfterMacReceived if true, returns after reader MAC has been received.
  */
 int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
+    return do_iclass_simulation_ex(simulationMode, reader_mac_buf, NULL);
+}
 
-    // free eventually allocated BigBuf memory
-    BigBuf_free_keep_EM();
+/**
+ * @param pre - pre-encoded CSN answers,  or NULL to build them from the CSN in emulator memory.
+ *              BigBuf allocations below the table are kept.
+ */
+static int do_iclass_simulation_ex(int simulationMode, uint8_t *reader_mac_buf, const iclass_sim_csn_t *pre) {
+
+    // free eventually allocated BigBuf memory,  keeping a caller supplied CSN table alive
+    uint32_t mark = 0;
+    if (pre) {
+        mark = BigBuf_get_mark();
+    } else {
+        BigBuf_free_keep_EM();
+    }
 
     uint16_t page_size = 32 * 8;
     uint8_t current_page = 0;
@@ -307,14 +382,12 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
     // CSN followed by two CRC bytes
     uint8_t anticoll_data[10] = { 0 };
     uint8_t csn_data[10] = { 0 };
-    memcpy(csn_data, csn, sizeof(csn_data));
-
-    // Construct anticollision-CSN
-    rotateCSN(csn_data, anticoll_data);
-
-    // Compute CRC on both CSNs
-    AddCrc(anticoll_data, 8);
-    AddCrc(csn_data, 8);
+    if (pre) {
+        memcpy(csn_data, pre->csn_data, sizeof(csn_data));
+        memcpy(anticoll_data, pre->anticoll_data, sizeof(anticoll_data));
+    } else {
+        iclass_sim_prepare_csn(csn, csn_data, anticoll_data);
+    }
 
     uint8_t diversified_kd[8] = { 0 };
     uint8_t diversified_kc[8] = { 0 };
@@ -365,8 +438,14 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
     uint8_t max_page = ((conf_block[4] & 0x10) == 0x10) ? 0 : 7;
 
     // pre-calculate the cipher states, feeding it the CC
-    cipher_state_KD[0] = opt_doTagMAC_1(card_challenge_data, diversified_kd);
-    cipher_state_KC[0] = opt_doTagMAC_1(card_challenge_data, diversified_kc);
+    // Attack modes never answer CHECK,  they only need them once the reader updates a key
+    if (simulationMode == ICLASS_SIM_MODE_EXIT_AFTER_MAC) {
+        memset(cipher_state_KD, 0, sizeof(State_t));
+        memset(cipher_state_KC, 0, sizeof(State_t));
+    } else {
+        cipher_state_KD[0] = opt_doTagMAC_1(card_challenge_data, diversified_kd);
+        cipher_state_KC[0] = opt_doTagMAC_1(card_challenge_data, diversified_kc);
+    }
 
     if (simulationMode == ICLASS_SIM_MODE_FULL) {
 
@@ -389,7 +468,7 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
     // Reader 81 anticoll. CSN
     // Tag    CSN
 
-    uint8_t *modulated_response = NULL;
+    const uint8_t *modulated_response = NULL;
     int modulated_response_size;
     uint8_t *trace_data = NULL;
     int trace_data_size;
@@ -400,12 +479,12 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
 
     // Anticollision CSN (rotated CSN)
     // 22: Takes 2 bytes for SOF/EOF and 10 * 2 = 20 bytes (2 bytes/byte)
-    uint8_t *resp_anticoll = BigBuf_malloc(22);
+    const uint8_t *resp_anticoll;
     int resp_anticoll_len;
 
     // CSN (block 0)
     // 22: Takes 2 bytes for SOF/EOF and 10 * 2 = 20 bytes (2 bytes/byte)
-    uint8_t *resp_csn = BigBuf_malloc(22);
+    const uint8_t *resp_csn;
     int resp_csn_len;
 
     // configuration (blk 1) PICOPASS 2ks
@@ -438,15 +517,26 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
     memcpy(resp_sof, ts->buf, ts->max);
     resp_sof_len = ts->max;
 
-    // Anticollision CSN
-    CodeIso15693AsTag(anticoll_data, sizeof(anticoll_data));
-    memcpy(resp_anticoll, ts->buf, ts->max);
-    resp_anticoll_len = ts->max;
-
-    // CSN (block 0)
-    CodeIso15693AsTag(csn_data, sizeof(csn_data));
-    memcpy(resp_csn, ts->buf, ts->max);
-    resp_csn_len = ts->max;
+    if (pre) {
+        resp_anticoll = pre->resp_anticoll;
+        resp_anticoll_len = pre->resp_anticoll_len;
+        resp_csn = pre->resp_csn;
+        resp_csn_len = pre->resp_csn_len;
+    } else {
+        // Anticollision CSN
+        uint8_t *anticoll = BigBuf_malloc(22);
+        CodeIso15693AsTag(anticoll_data, sizeof(anticoll_data));
+        memcpy(anticoll, ts->buf, ts->max);
+        resp_anticoll = anticoll;
+        resp_anticoll_len = ts->max;
+
+        // CSN (block 0)
+        uint8_t *csn_resp = BigBuf_malloc(22);
+        CodeIso15693AsTag(csn_data, sizeof(csn_data));
+        memcpy(csn_resp, ts->buf, ts->max);
+        resp_csn = csn_resp;
+        resp_csn_len = ts->max;
+    }
 
     // Configuration (block 1)
     CodeIso15693AsTag(conf_block, sizeof(conf_block));
@@ -476,6 +566,22 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
     //Each bit is doubled when modulated for FPGA, and we also have SOF and EOF (2 bytes)
     uint8_t *data_response = BigBuf_malloc((34 * 2) + 3);
 
+    // Modulated answers to block reads, keyed by page << 8 | block.
+    // The blocks of the first page are encoded before the reader shows up,  others on first read.
+    // Writing a block drops its entry.
+    resp_cache_t block_cache = {0};
+    if (simulationMode == ICLASS_SIM_MODE_FULL && resp_cache_init(&block_cache, ICLASS_RESP_CACHE_SLOTS, ICLASS_RESP_CACHE_SLOT_SIZE)) {
+        for (uint8_t i = 0; i < MIN(ICLASS_RESP_CACHE_SLOTS, page_size / 8); i++) {
+            if (i == 3 || i == 4) {
+                continue;
+            }
+            memcpy(data_generic_trace, emulator + (i * 8), 8);
+            AddCrc(data_generic_trace, 8);
+            CodeIso15693AsTag(data_generic_trace, 10);
+            resp_cache_put_tosend(&block_cache, i);
+        }
+    }
+
     enum { IDLE, ACTIVATED, SELECTED, HALTED } chip_state = IDLE;
 
     bool button_pressed = false;
@@ -612,10 +718,21 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
                     AddCrc(data_generic_trace, 8);
                     trace_data = data_generic_trace;
                     trace_data_size = 10;
-                    CodeIso15693AsTag(trace_data, trace_data_size);
-                    memcpy(data_response, ts->buf, ts->max);
-                    modulated_response = data_response;
-                    modulated_response_size = ts->max;
+
+                    uint32_t key = (current_page << 8) | block;
+                    uint16_t cached_len = 0;
+                    modulated_response = resp_cache_get(&block_cache, key, &cached_len);
+                    if (modulated_response) {
+                        modulated_response_size = cached_len;
+                    } else {
+                        CodeIso15693AsTag(trace_data, trace_data_size);
+                        modulated_response = resp_cache_put_tosend(&block_cache, key);
+                        if (modulated_response == NULL) {
+                            memcpy(data_response, ts->buf, ts->max);
+                            modulated_response = data_response;
+                        }
+                        modulated_response_size = ts->max;
+                    }
                 }
                 goto send;
             }
@@ -743,6 +860,8 @@ int do_iclass_simulation(int simulationMode, uint8_t *reader_mac_buf) {
             // is chip in ReadOnly (RO)
             if ((block_wr_lock & 0x80) == 0) goto send;
 
+            resp_cache_invalidate(&block_cache, (current_page << 8) | block);
+
             if (block == 12 && (block_wr_lock & 0x40) == 0) goto send;
             if (block == 11 && (block_wr_lock & 0x20) == 0) goto send;
             if (block == 10 && (block_wr_lock & 0x10) == 0) goto send;
@@ -880,6 +999,9 @@ send:
     if (button_pressed)
         DbpString("button pressed");
 
+    if (pre) {
+        BigBuf_release(mark);
+    }
     return button_pressed;
 }
 
@@ -1236,8 +1358,15 @@ static bool iclass_send_cmd_with_retries(uint8_t *cmd, size_t cmdsize, uint8_t *
                                          uint8_t expected_size, uint8_t tries, uint32_t *start_time,
                                          uint16_t timeout, uint32_t *eof_time, bool shallow_mod) {
 
+    if (tries == 0) {
+        return false;
+    }
+
+    // a plain resend policy,  reselecting is up to the callers
+    rf_retry_policy_t rp = RF_RETRY_POLICY(tries - 1, 0, 0, false);
+
     uint16_t resp_len = 0;
-    while (tries-- > 0) {
+    while (true) {
 
         iclass_send_as_reader(cmd, cmdsize, start_time, eof_time, shallow_mod);
 
@@ -1250,13 +1379,22 @@ static bool iclass_send_cmd_with_retries(uint8_t *cmd, size_t cmdsize, uint8_t *
             return true;
         }
 
-        // Timed out waiting for the tag to reply, but perhaps the tag did hear the command and is attempting to reply
-        // So wait long enough for the tag to encode it's reply plus required frame delays on each side before retrying
-        // And then double it, because in practice it seems to make it much more likely to succeed
-        // Response time calculation from expected_size lifted from GetIso15693AnswerFromTag
-        *start_time = *eof_time + ((DELAY_ICLASS_VICC_TO_VCD_READER + DELAY_ISO15693_VCD_TO_VICC_READER + (expected_size * 8 * 8 * 16)) * 2);
+        rf_fail_t fail = (res == PM3_SUCCESS) ? RF_FAIL_LENGTH : rf_fail_from_status(res);
+        if (rf_retry_next(&rp, fail) != RF_RETRY_RESEND) {
+            return false;
+        }
+
+        if (fail == RF_FAIL_TIMEOUT) {
+            // Timed out waiting for the tag to reply, but perhaps the tag did hear the command and is attempting to reply
+            // So wait long enough for the tag to encode it's reply plus required frame delays on each side before retrying
+            // And then double it, because in practice it seems to make it much more likely to succeed
+            // Response time calculation from expected_size lifted from GetIso15693AnswerFromTag
+            *start_time = *eof_time + ((DELAY_ICLASS_VICC_TO_VCD_READER + DELAY_ISO15693_VCD_TO_VICC_READER + (expected_size * 8 * 8 * 16)) * 2);
+        } else {
+            // the tag did answer and is done,  the normal turnaround is enough
+            *start_time = *eof_time + DELAY_ICLASS_VICC_TO_VCD_READER;
+        }
     }
-    return false;
 }
 
 /**
@@ -1722,8 +1860,6 @@ void iClass_Dump(uint8_t *msg) {
         }
     }
 
-    switch_off();
-
     // copy diversified key back.
     if (req->do_auth) {
         if (req->use_credit_key)
@@ -1732,16 +1868,57 @@ void iClass_Dump(uint8_t *msg) {
             memcpy(dataout + (8 * 3), hdr.key_d, 8);
     }
 
+    // AA2,  reselect and authenticate with credit key while the tag stays powered
+    bool aa2_success = false;
+    uint16_t aa2_cnt = 0;
+    if (req->do_auth && cmd->aa2_end_block > cmd->end_block) {
+
+        iclass_auth_req_t aa2 = *req;
+        aa2.use_credit_key = true;
+        aa2.use_replay = false;
+        memcpy(aa2.key, cmd->credit_key, sizeof(aa2.key));
+
+        res = select_iclass_tag(&hdr, aa2.use_credit_key, &eof_time, shallow_mod);
+        if (res) {
+            start_time = eof_time + DELAY_ICLASS_VICC_TO_VCD_READER;
+            res = authenticate_iclass_tag(&aa2, &hdr, &start_time, &eof_time, NULL);
+        }
+
+        if (res) {
+            start_time = eof_time + DELAY_ICLASS_VICC_TO_VCD_READER;
+            aa2_success = true;
+
+            for (uint16_t j = cmd->end_block + 1; j <= cmd->aa2_end_block; j++) {
+                if (iclass_read_block(j, dataout + (8 * j), &start_time, &eof_time, shallow_mod)) {
+                    aa2_cnt++;
+                } else {
+                    Dbprintf("failed to read block %u ( 0x%02x)", j, j);
+                    aa2_success = false;
+                }
+            }
+
+            memcpy(dataout + (8 * 4), hdr.key_c, 8);
+        } else {
+            DbpString("failed AA2 auth");
+        }
+    }
+
+    switch_off();
+
     if (req->send_reply) {
         struct p {
             bool isOK;
             uint16_t block_cnt;
             uint32_t bb_offset;
+            bool aa2_isOK;
+            uint16_t aa2_block_cnt;
         } PACKED response;
 
         response.isOK = dumpsuccess;
         response.block_cnt = i - cmd->start_block;
         response.bb_offset = dataout - BigBuf_get_addr();
+        response.aa2_isOK = aa2_success;
+        response.aa2_block_cnt = aa2_cnt;
         reply_ng(CMD_HF_ICLASS_DUMP, PM3_SUCCESS, (uint8_t *)&response, sizeof(response));
     }
 
@@ -2112,27 +2289,20 @@ void iClass_Restore(iclass_restore_req_t *msg) {
         }
     }
 
+    // Unsecured tags uses CRC16,  secure tags uses MAC with the diversified key from the single auth above
+    bool use_mac = (get_pagemap(&hdr) != PICOPASS_NON_SECURE_PAGEMODE);
+    uint8_t *div_key = (msg->req.use_credit_key) ? hdr.key_c : hdr.key_d;
+
     // main loop
-    bool use_mac;
     for (uint8_t i = 0; i < msg->item_cnt; i++) {
 
         iclass_restore_item_t item = msg->blocks[i];
 
-        uint8_t pagemap = get_pagemap(&hdr);
-        if (pagemap == PICOPASS_NON_SECURE_PAGEMODE) {
-            // Unsecured tags uses CRC16
-            use_mac = false;
-        } else {
-            // Secure tags uses MAC
-            use_mac = true;
+        if (use_mac) {
             uint8_t wb[9] = {0};
             wb[0] = item.blockno;
             memcpy(wb + 1, item.data, 8);
-
-            if (msg->req.use_credit_key)
-                doMAC_N(wb, sizeof(wb), hdr.key_c, mac);
-            else
-                doMAC_N(wb, sizeof(wb), hdr.key_d, mac);
+            doMAC_N(wb, sizeof(wb), div_key, mac);
         }
 
         // data + mac
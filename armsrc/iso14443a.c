@@ -35,6 +35,8 @@
 #include "crc16.h"
 #include "protocols.h"
 #include "generator.h"
+#include "perf.h"
+#include "simstats.h"
 
 #define MAX_ISO14A_TIMEOUT 524288
 
@@ -307,7 +309,7 @@ void Uart14aInit(uint8_t *data, uint8_t *par) {
 }
 
 // use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
-RAMFUNC bool MillerDecoding(uint8_t bit, uint32_t non_real_time) {
+static RAMFUNC bool MillerDecoding_impl(uint8_t bit, uint32_t non_real_time) {
     Uart.fourBits = (Uart.fourBits << 8) | bit;
 
     if (Uart.state == STATE_14A_UNSYNCD) {                                           // not yet synced
@@ -480,8 +482,15 @@ void Demod14aInit(uint8_t *data, uint8_t *par) {
     Demod14aReset();
 }
 
+RAMFUNC bool MillerDecoding(uint8_t bit, uint32_t non_real_time) {
+    uint32_t perf = PERF_START();
+    bool res = MillerDecoding_impl(bit, non_real_time);
+    perf_record(PERF_MILLER_DECODING, perf);
+    return res;
+}
+
 // use parameter non_real_time to provide a timestamp. Set to 0 if the decoder should measure real time
-RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time) {
+static RAMFUNC int ManchesterDecoding_impl(uint8_t bit, uint16_t offset, uint32_t non_real_time) {
     Demod.twoBits = (Demod.twoBits << 8) | bit;
 
     if (Demod.state == DEMOD_14A_UNSYNCD) {
@@ -571,6 +580,13 @@ RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_t
 }
 
 
+RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_time) {
+    uint32_t perf = PERF_START();
+    int res = ManchesterDecoding_impl(bit, offset, non_real_time);
+    perf_record(PERF_MANCHESTER_DECODING, perf);
+    return res;
+}
+
 // Thinfilm, Kovio mangles ISO14443A in the way that they don't use start bit nor parity bits.
 static RAMFUNC int ManchesterDecoding_Thinfilm(uint8_t bit) {
     Demod.twoBits = (Demod.twoBits << 8) | bit;
@@ -693,11 +709,15 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
     }
 
     // The DMA buffer, used to stream samples from the FPGA
-    dmabuf8_t *dma = get_dma8();
+    dmabuf8_t *dma = get_dma8_ex(DMA_BUFFER_SIZE_SNIFF14A);
+    if (dma->buf == NULL) {
+        dma = get_dma8();
+    }
+    const int dma_size = dma->size;
     uint8_t *data = dma->buf;
 
     // Setup and start DMA.
-    if (FpgaSetupSscDma((uint8_t *) dma->buf, DMA_BUFFER_SIZE) == false) {
+    if (FpgaSetupSscDma((uint8_t *) dma->buf, dma_size) == false) {
         if (g_dbglevel > 1) Dbprintf("FpgaSetupSscDma failed. Exiting");
         return;
     }
@@ -710,24 +730,49 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
 
     uint32_t rx_samples = 0;
 
+    // overrun / lag statistics
+    uint32_t lag_count = 0;      // samples decoded while more than half a ring behind
+    uint32_t overrun_count = 0;  // times samples were skipped to catch up
+    uint32_t overrun_skipped = 0;
+    uint32_t rxempty_count = 0;  // times the DMA stopped, samples lost
+
+    trace_stream_start();
+
     // loop and listen
     while (BUTTON_PRESS() == false) {
         WDT_HIT();
         LED_A_ON();
 
         register int readBufDataP = data - dma->buf;
-        register int dmaBufDataP = DMA_BUFFER_SIZE - AT91C_BASE_PDC_SSC->PDC_RCR;
+        register int dmaBufDataP = dma_size - AT91C_BASE_PDC_SSC->PDC_RCR;
         if (readBufDataP <= dmaBufDataP)
             dataLen = dmaBufDataP - readBufDataP;
         else
-            dataLen = DMA_BUFFER_SIZE - readBufDataP + dmaBufDataP;
+            dataLen = dma_size - readBufDataP + dmaBufDataP;
 
-        // test for length of buffer
         if (dataLen > maxDataLen) {
             maxDataLen = dataLen;
-            if (dataLen > (9 * DMA_BUFFER_SIZE / 10)) {
-                Dbprintf("[!] blew circular buffer! | datalen %u", dataLen);
-                break;
+        }
+
+        // test for length of buffer
+        if (dataLen > (dma_size / 2)) {
+            lag_count++;
+
+            // about to blow the circular buffer,  drop what is behind instead of aborting.
+            // Skip an even number of samples to keep the reader / tag nibble pairs aligned
+            if (dataLen > (9 * dma_size / 10)) {
+                int skip = (dataLen - 16) & ~1;
+                data = dma->buf + ((readBufDataP + skip) % dma_size);
+                rx_samples += skip;
+                dataLen -= skip;
+                overrun_count++;
+                overrun_skipped += skip;
+
+                // a frame in progress is lost
+                Uart14aReset();
+                Demod14aReset();
+                TagIsActive = false;
+                ReaderIsActive = false;
             }
         }
         if (dataLen < 1) continue;
@@ -735,13 +780,13 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
         // primary buffer was stopped( <-- we lost data!
         if (!AT91C_BASE_PDC_SSC->PDC_RCR) {
             AT91C_BASE_PDC_SSC->PDC_RPR = (uint32_t) dma->buf;
-            AT91C_BASE_PDC_SSC->PDC_RCR = DMA_BUFFER_SIZE;
-            Dbprintf("[-] RxEmpty ERROR | data length %d", dataLen); // temporary
+            AT91C_BASE_PDC_SSC->PDC_RCR = dma_size;
+            rxempty_count++;
         }
         // secondary buffer sets as primary, secondary buffer was stopped
         if (!AT91C_BASE_PDC_SSC->PDC_RNCR) {
             AT91C_BASE_PDC_SSC->PDC_RNPR = (uint32_t) dma->buf;
-            AT91C_BASE_PDC_SSC->PDC_RNCR = DMA_BUFFER_SIZE;
+            AT91C_BASE_PDC_SSC->PDC_RNCR = dma_size;
         }
 
         LED_A_OFF();
@@ -804,15 +849,27 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
         previous_data = *data;
         rx_samples++;
         data++;
-        if (data == dma->buf + DMA_BUFFER_SIZE) {
+        if (data == dma->buf + dma_size) {
             data = dma->buf;
+
+            // drain streamed trace while the air is quiet and DMA has room to spare
+            if ((TagIsActive == false) && (ReaderIsActive == false) && (dataLen < dma_size / 4)) {
+                if (trace_stream_poll() == false) {
+                    break;
+                }
+            }
         }
     } // end main loop
 
     FpgaDisableTracing();
+    trace_stream_stop();
 
     if (g_dbglevel >= DBG_ERROR) {
         Dbprintf("trace len = " _YELLOW_("%d"), BigBuf_get_traceLen());
+        Dbprintf("dma ring " _YELLOW_("%d") " bytes, max lag " _YELLOW_("%d") ", samples decoded lagging " _YELLOW_("%u"), dma_size, maxDataLen, lag_count);
+        if (overrun_count || rxempty_count) {
+            Dbprintf(_RED_("overruns %u") " ( %u samples skipped ), dma stopped %u times", overrun_count, overrun_skipped, rxempty_count);
+        }
     }
     switch_off();
 }
@@ -820,56 +877,83 @@ void RAMFUNC SniffIso14443a(uint8_t param) {
 //-----------------------------------------------------------------------------
 // Prepare tag messages
 //-----------------------------------------------------------------------------
-static void CodeIso14443aAsTagPar(const uint8_t *cmd, uint16_t len, const uint8_t *par, bool collision) {
+//-----------------------------------------------------------------------------
+// Lookup tables for the frame encoders.  Each entry holds the four modulation
+// bytes of one data nibble, first bit in the lowest byte.  They are built on
+// first use and, like the encoders, live in RAM.
+//-----------------------------------------------------------------------------
+static uint32_t s_tag_nibble[16];
+static uint32_t s_reader_nibble[2][16];   // [last bit sent][nibble]
+static bool s_encode_tables_ready = false;
+
+static void build_encode_tables(void) {
+    for (uint8_t n = 0; n < 16; n++) {
+        uint32_t tag = 0;
+        uint32_t reader[2] = {0, 0};
+        for (uint8_t last = 0; last < 2; last++) {
+            uint8_t l = last;
+            for (uint8_t k = 0; k < 4; k++) {
+                uint8_t bit = (n >> k) & 1;
+                uint8_t seq = (bit) ? SEC_X : ((l) ? SEC_Y : SEC_Z);
+                reader[last] |= (uint32_t)seq << (k * 8);
+                l = bit;
+            }
+        }
+        for (uint8_t k = 0; k < 4; k++) {
+            tag |= (uint32_t)(((n >> k) & 1) ? SEC_D : SEC_E) << (k * 8);
+        }
+        s_tag_nibble[n] = tag;
+        s_reader_nibble[0][n] = reader[0];
+        s_reader_nibble[1][n] = reader[1];
+    }
+    s_encode_tables_ready = true;
+}
+
+static inline uint8_t *put_nibble(uint8_t *p, uint32_t w) {
+    p[0] = w;
+    p[1] = w >> 8;
+    p[2] = w >> 16;
+    p[3] = w >> 24;
+    return p + 4;
+}
+
+static void RAMFUNC CodeIso14443aAsTagPar(const uint8_t *cmd, uint16_t len, const uint8_t *par, bool collision) {
+
+    if (s_encode_tables_ready == false) {
+        build_encode_tables();
+    }
 
     tosend_reset();
 
     tosend_t *ts = get_tosend();
 
     // Correction bit, might be removed when not needed
-    tosend_stuffbit(0);
-    tosend_stuffbit(0);
-    tosend_stuffbit(0);
-    tosend_stuffbit(0);
-    tosend_stuffbit(1);  // <-----
-    tosend_stuffbit(0);
-    tosend_stuffbit(0);
-    tosend_stuffbit(0);
+    ts->buf[++ts->max] = 0x08;  // 00001000
 
     // Send startbit
     ts->buf[++ts->max] = SEC_D;
-    LastProxToAirDuration = 8 * ts->max - 4;
-
-    for (uint16_t i = 0; i < len; i++) {
-        uint8_t b = cmd[i];
 
-        // Data bits
-        for (uint16_t j = 0; j < 8; j++) {
-            if (collision) {
-                ts->buf[++ts->max] = SEC_COLL;
-            } else {
-                if (b & 1) {
-                    ts->buf[++ts->max] = SEC_D;
-                } else {
-                    ts->buf[++ts->max] = SEC_E;
-                }
-                b >>= 1;
-            }
+    uint8_t *p = ts->buf + ts->max + 1;
+    if (collision) {
+        // data and parity bits
+        memset(p, SEC_COLL, len * 9);
+        p += len * 9;
+    } else {
+        for (uint16_t i = 0; i < len; i++) {
+            uint8_t b = cmd[i];
+            p = put_nibble(p, s_tag_nibble[b & 0x0F]);
+            p = put_nibble(p, s_tag_nibble[b >> 4]);
+            // parity bit
+            *p++ = (par[i >> 3] & (0x80 >> (i & 0x0007))) ? SEC_D : SEC_E;
         }
+    }
+    ts->max = (p - ts->buf) - 1;
 
-        if (collision) {
-            ts->buf[++ts->max] = SEC_COLL;
-            LastProxToAirDuration = 8 * ts->max;
-        } else {
-            // Get the parity bit
-            if (par[i >> 3] & (0x80 >> (i & 0x0007))) {
-                ts->buf[++ts->max] = SEC_D;
-                LastProxToAirDuration = 8 * ts->max - 4;
-            } else {
-                ts->buf[++ts->max] = SEC_E;
-                LastProxToAirDuration = 8 * ts->max;
-            }
-        }
+    // the answer ends half a bit earlier when the last bit is a D
+    if (ts->buf[ts->max] == SEC_D) {
+        LastProxToAirDuration = 8 * ts->max - 4;
+    } else {
+        LastProxToAirDuration = 8 * ts->max;
     }
 
     // Send stopbit
@@ -930,7 +1014,7 @@ static void Code4bitAnswerAsTag(uint8_t cmd) {
 // stop when button is pressed or client usb connection resets
 // or return TRUE when command is captured
 //-----------------------------------------------------------------------------
-bool GetIso14443aCommandFromReader(uint8_t *received, uint8_t *par, int *len) {
+bool RAMFUNC_HOT_14A GetIso14443aCommandFromReader(uint8_t *received, uint8_t *par, int *len) {
     // Set FPGA mode to "simulated ISO 14443 tag", no modulation (listen
     // only, since we are receiving, not transmitting).
     // Signal field is off with the appropriate LED
@@ -972,6 +1056,7 @@ bool GetIso14443aCommandFromReader(uint8_t *received, uint8_t *par, int *len) {
             b = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
             if (MillerDecoding(b, 0)) {
                 *len = Uart.len;
+                sim_stats_frame();
                 return true;
             }
         }
@@ -1447,6 +1532,8 @@ void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_
     set_tracing(true);
     LED_A_ON();
 
+    sim_stats_start(SIM_STATS_14A, SIM_STATS_BUDGET_14A_US);
+
     // main loop
     bool finished = false;
     while (finished == false) {
@@ -1474,6 +1561,7 @@ void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_
                 EmSend4bit(CARD_ACK);
             } else {
                 // send NACK 0x1 == crc/parity error
+                sim_stats_frame_error();
                 EmSend4bit(CARD_NACK_PA);
             }
             order = ORDER_NONE; // back to work state
@@ -1632,6 +1720,7 @@ void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_
                 }
             } else {
                 // send NACK 0x1 == crc/parity error
+                sim_stats_frame_error();
                 EmSend4bit(CARD_NACK_PA);
             }
             p_response = NULL;
@@ -1650,6 +1739,7 @@ void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_
                 }
             } else {
                 // send NACK 0x1 == crc/parity error
+                sim_stats_frame_error();
                 EmSend4bit(CARD_NACK_PA);
             }
             p_response = NULL;
@@ -1888,6 +1978,7 @@ void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_
         EmSendPrecompiledCmd(p_response);
     }
 
+    sim_stats_stop();
     switch_off();
 
     set_tracing(false);
@@ -1976,15 +2067,20 @@ static void TransmitFor14443a(const uint8_t *cmd, uint16_t len, uint32_t *timing
 //-----------------------------------------------------------------------------
 // Prepare reader command (in bits, support short frames) to send to FPGA
 //-----------------------------------------------------------------------------
-static void CodeIso14443aBitsAsReaderPar(const uint8_t *cmd, uint16_t bits, const uint8_t *par) {
-    int last = 0;
+static void RAMFUNC CodeIso14443aBitsAsReaderPar(const uint8_t *cmd, uint16_t bits, const uint8_t *par) {
+
+    if (s_encode_tables_ready == false) {
+        build_encode_tables();
+    }
 
     tosend_reset();
     tosend_t *ts = get_tosend();
 
+    uint8_t *p = ts->buf;
+    uint8_t last = 0;
+
     // Start of Communication (Seq. Z)
-    ts->buf[++ts->max] = SEC_Z;
-    LastProxToAirDuration = 8 * (ts->max + 1) - 6;
+    *p++ = SEC_Z;
 
     size_t bytecount = nbytes(bits);
     // Generate send structure for the data bits
@@ -1992,62 +2088,44 @@ static void CodeIso14443aBitsAsReaderPar(const uint8_t *cmd, uint16_t bits, cons
         // Get the current byte to send
         uint8_t b = cmd[i];
         size_t bitsleft = MIN((bits - (i * 8)), 8);
-        int j;
-        for (j = 0; j < bitsleft; j++) {
-            if (b & 1) {
-                // Sequence X
-                ts->buf[++ts->max] = SEC_X;
-                LastProxToAirDuration = 8 * (ts->max + 1) - 2;
-                last = 1;
-            } else {
-                if (last == 0) {
-                    // Sequence Z
-                    ts->buf[++ts->max] = SEC_Z;
-                    LastProxToAirDuration = 8 * (ts->max + 1) - 6;
-                } else {
-                    // Sequence Y
-                    ts->buf[++ts->max] = SEC_Y;
-                    last = 0;
-                }
-            }
-            b >>= 1;
-        }
 
-        // Only transmit parity bit if we transmitted a complete byte
-        if (j == 8 && par != NULL) {
-            // Get the parity bit
-            if (par[i >> 3] & (0x80 >> (i & 0x0007))) {
-                // Sequence X
-                ts->buf[++ts->max] = SEC_X;
-                LastProxToAirDuration = 8 * (ts->max + 1) - 2;
-                last = 1;
-            } else {
-                if (last == 0) {
-                    // Sequence Z
-                    ts->buf[++ts->max] = SEC_Z;
-                    LastProxToAirDuration = 8 * (ts->max + 1) - 6;
-                } else {
-                    // Sequence Y
-                    ts->buf[++ts->max] = SEC_Y;
-                    last = 0;
-                }
+        if (bitsleft == 8) {
+            p = put_nibble(p, s_reader_nibble[last][b & 0x0F]);
+            last = (b >> 3) & 1;
+            p = put_nibble(p, s_reader_nibble[last][b >> 4]);
+            last = b >> 7;
+
+            // Only transmit parity bit if we transmitted a complete byte
+            if (par != NULL) {
+                uint8_t bit = (par[i >> 3] & (0x80 >> (i & 0x0007))) ? 1 : 0;
+                *p++ = (bit) ? SEC_X : ((last) ? SEC_Y : SEC_Z);
+                last = bit;
+            }
+        } else {
+            // short frame / last partial byte
+            for (int j = 0; j < bitsleft; j++) {
+                uint8_t bit = b & 1;
+                *p++ = (bit) ? SEC_X : ((last) ? SEC_Y : SEC_Z);
+                last = bit;
+                b >>= 1;
             }
         }
     }
 
     // End of Communication: Logic 0 followed by Sequence Y
-    if (last == 0) {
-        // Sequence Z
-        ts->buf[++ts->max] = SEC_Z;
-        LastProxToAirDuration = 8 * (ts->max + 1) - 6;
-    } else {
-        // Sequence Y
-        ts->buf[++ts->max] = SEC_Y;
-    }
-    ts->buf[++ts->max] = SEC_Y;
+    *p++ = (last) ? SEC_Y : SEC_Z;
+    *p++ = SEC_Y;
 
     // Convert to length of command:
-    ts->max++;
+    ts->max = p - ts->buf;
+
+    // the frame ends with the last X or Z,  Y is no modulation.  There is at most
+    // one Y between them and the closing Y, and the SOC is a Z.
+    int k = ts->max - 2;
+    while (ts->buf[k] == SEC_Y) {
+        k--;
+    }
+    LastProxToAirDuration = (ts->buf[k] == SEC_X) ? 8 * (k + 1) - 2 : 8 * (k + 1) - 6;
 }
 
 //-----------------------------------------------------------------------------
@@ -2155,6 +2233,8 @@ int EmSendCmd14443aRaw(const uint8_t *resp, uint16_t respLen) {
     uint32_t ThisTransferTime;
     bool correction_needed;
 
+    sim_stats_answer();
+
     // Modulate Manchester
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_ISO14443A | FPGA_HF_ISO14443A_TAGSIM_MOD);
 
@@ -2352,7 +2432,7 @@ bool GetIso14443aAnswerFromTag_Thinfilm(uint8_t *receivedResponse,  uint8_t *rec
 //  If a response is captured return TRUE
 //  If it takes too long return FALSE
 //-----------------------------------------------------------------------------
-static int GetIso14443aAnswerFromTag(uint8_t *receivedResponse, uint8_t *receivedResponsePar, uint16_t offset) {
+static RAMFUNC_HOT_14A int GetIso14443aAnswerFromTag(uint8_t *receivedResponse, uint8_t *receivedResponsePar, uint16_t offset) {
     if (g_hf_field_active == false) {
         Dbprintf("Warning: HF field is off");
         return false;
@@ -3045,6 +3125,61 @@ int iso14_apdu(uint8_t *cmd, uint16_t cmd_len, bool send_chaining, void *data, u
     return len;
 }
 
+// Same as iso14_apdu, but a chained I-block response is ACKed and collected here instead of
+// costing the client a round trip per block. Data is packed into as few replies as possible,
+// intermediate ones carry ISO14A_APDU_CHAINED_PART and no CRC, the last one looks like a plain APDU reply.
+// With desfire_af, a 91 AF status is answered with 90 AF 00 00 00 the same way, the 91 AF status words in between are dropped.
+static void iso14_apdu_chained(uint8_t *cmd, uint16_t cmd_len, bool send_chaining, uint8_t *out, bool desfire_af) {
+    uint8_t frame[MAX_FRAME_SIZE] = {0};
+    uint8_t af_cmd[] = { 0x90, 0xAF, 0x00, 0x00, 0x00 };
+    uint8_t res = 0;
+    uint16_t outlen = 0;
+
+    int len = iso14_apdu(cmd, cmd_len, send_chaining, frame, &res);
+
+    for (;;) {
+        // I-block with chaining bit, PCB+CRC already cut down to data+CRC
+        if (len >= 2 && (res & 0xC0) == 0 && (res & 0x10)) {
+            len -= 2;
+        } else if (desfire_af && len >= 4 && (res & 0xC0) == 0 && frame[len - 4] == 0x91 && frame[len - 3] == 0xAF) {
+            len -= 4;
+        } else {
+            break;
+        }
+
+        WDT_HIT();
+
+        if (outlen + len > PM3_CMD_DATA_SIZE_MIX) {
+            reply_mix(CMD_ACK, outlen, res, ISO14A_APDU_CHAINED_PART, out, outlen);
+            outlen = 0;
+        }
+        memcpy(out + outlen, frame, len);
+        outlen += len;
+
+        if ((res & 0x10)) {
+            len = iso14_apdu(NULL, 0, false, frame, &res);
+        } else {
+            len = iso14_apdu(af_cmd, sizeof(af_cmd), false, frame, &res);
+        }
+    }
+
+    if (len <= 0) {
+        if (outlen) {
+            reply_mix(CMD_ACK, outlen, res, ISO14A_APDU_CHAINED_PART, out, outlen);
+        }
+        reply_mix(CMD_ACK, len, res, 0, NULL, 0);
+        return;
+    }
+
+    if (outlen + len > PM3_CMD_DATA_SIZE_MIX) {
+        reply_mix(CMD_ACK, outlen, res, ISO14A_APDU_CHAINED_PART, out, outlen);
+        outlen = 0;
+    }
+    memcpy(out + outlen, frame, len);
+    outlen += len;
+    reply_mix(CMD_ACK, outlen, res, 0, out, outlen);
+}
+
 //-----------------------------------------------------------------------------
 // Read an ISO 14443a tag. Send out commands and store answers.
 //-----------------------------------------------------------------------------
@@ -3053,6 +3188,73 @@ int iso14_apdu(uint8_t *cmd, uint16_t cmd_len, bool send_chaining, void *data, u
 //             low  ::  len of commandbytes
 // arg2         timeout
 // d.asBytes command bytes to send
+// Reader session.  While active the field stays on after CMD_HF_ISO14443A_READER and a
+// connect asking for the same activation (with / without RATS) is answered from the selected card.
+// Any other command may touch the field,  appmain invalidates the selected card before running it.
+static struct {
+    bool active;
+    bool selected;
+    bool rats;
+    uint32_t arg0;
+    uint32_t timeout_ms;
+    uint32_t last;
+    uint32_t selects;
+    uint32_t reused;
+    iso14a_card_select_t card;
+} iso14a_session;
+
+bool iso14a_session_active(void) {
+    return iso14a_session.active;
+}
+
+void iso14a_session_invalidate(void) {
+    iso14a_session.selected = false;
+}
+
+// called from the main loop while idle
+void iso14a_session_tick(void) {
+    if (iso14a_session.active && GetTickCountDelta(iso14a_session.last) > iso14a_session.timeout_ms) {
+        if (g_dbglevel >= DBG_INFO) Dbprintf("14a session timed out");
+        memset(&iso14a_session, 0, sizeof(iso14a_session));
+        hf_field_off();
+    }
+}
+
+void Iso14443aSession(uint8_t action, uint32_t timeout_ms) {
+
+    switch (action) {
+        case ISO14A_SESSION_START: {
+            memset(&iso14a_session, 0, sizeof(iso14a_session));
+            iso14a_session.active = true;
+            iso14a_session.timeout_ms = (timeout_ms) ? timeout_ms : ISO14A_SESSION_TIMEOUT;
+            iso14a_session.last = GetTickCount();
+            break;
+        }
+        case ISO14A_SESSION_STOP: {
+            if (iso14a_session.active) {
+                hf_field_off();
+            }
+            iso14a_session.active = false;
+            iso14a_session.selected = false;
+            break;
+        }
+        case ISO14A_SESSION_STATUS:
+        default:
+            break;
+    }
+
+    iso14a_session_t s = {
+        .active = iso14a_session.active,
+        .selected = iso14a_session.selected,
+        .timeout_ms = iso14a_session.timeout_ms,
+        .idle_ms = (iso14a_session.active) ? GetTickCountDelta(iso14a_session.last) : 0,
+        .selects = iso14a_session.selects,
+        .reused = iso14a_session.reused,
+    };
+    memcpy(&s.card, &iso14a_session.card, sizeof(iso14a_card_select_t));
+    reply_ng(CMD_HF_ISO14443A_SESSION, PM3_SUCCESS, (uint8_t *)&s, sizeof(s));
+}
+
 void ReaderIso14443a(PacketCommandNG *c) {
     iso14a_command_t param = c->oldarg[0];
     size_t len = c->oldarg[1] & 0xffff;
@@ -3063,8 +3265,18 @@ void ReaderIso14443a(PacketCommandNG *c) {
 
     uint8_t buf[PM3_CMD_DATA_SIZE_MIX] = {0x00};
 
+    // the selected card can answer this connect
+    bool reuse = iso14a_session.active && iso14a_session.selected
+                 && (param & ISO14A_CONNECT) && ((param & ISO14A_NO_SELECT) == 0)
+                 && ((param & ISO14A_USE_CUSTOM_POLLING) == 0)
+                 && (iso14a_session.rats == ((param & ISO14A_NO_RATS) == 0))
+                 && (GetTickCountDelta(iso14a_session.last) <= iso14a_session.timeout_ms);
+
     if ((param & ISO14A_CONNECT)) {
-        iso14_pcb_blocknum = 0;
+        // a selected card keeps counting its blocks
+        if (reuse == false) {
+            iso14_pcb_blocknum = 0;
+        }
         clear_trace();
     }
 
@@ -3073,7 +3285,21 @@ void ReaderIso14443a(PacketCommandNG *c) {
     if ((param & ISO14A_REQUEST_TRIGGER))
         iso14a_set_trigger(true);
 
-    if ((param & ISO14A_CONNECT)) {
+    if ((param & ISO14A_CONNECT) && reuse) {
+
+        memcpy(buf, &iso14a_session.card, sizeof(iso14a_card_select_t));
+        iso14a_session.reused++;
+        reply_mix(CMD_ACK, iso14a_session.arg0, iso14a_session.card.uidlen, 0, buf, sizeof(iso14a_card_select_t));
+
+    } else if ((param & ISO14A_CONNECT)) {
+
+        // the card is in a state a new WUPA won't wake it from,  power cycle it
+        if (iso14a_session.active && g_hf_field_active) {
+            hf_field_off();
+            SpinDelay(5);
+        }
+        iso14a_session.selected = false;
+
         iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
 
         // notify client selecting status.
@@ -3091,6 +3317,14 @@ void ReaderIso14443a(PacketCommandNG *c) {
             reply_mix(CMD_ACK, arg0, card->uidlen, 0, buf, sizeof(iso14a_card_select_t));
             if (arg0 == 0)
                 goto OUT;
+
+            if (iso14a_session.active && ((param & ISO14A_USE_CUSTOM_POLLING) == 0)) {
+                memcpy(&iso14a_session.card, card, sizeof(iso14a_card_select_t));
+                iso14a_session.arg0 = arg0;
+                iso14a_session.rats = ((param & ISO14A_NO_RATS) == 0);
+                iso14a_session.selected = true;
+                iso14a_session.selects++;
+            }
         }
     }
     uint32_t save_iso14a_timeout = 0;
@@ -3099,12 +3333,20 @@ void ReaderIso14443a(PacketCommandNG *c) {
         iso14a_set_timeout(timeout);
     }
 
-    if ((param & ISO14A_APDU)) {
+    if ((param & ISO14A_APDU) && (param & (ISO14A_CHAIN_RESPONSE | ISO14A_DESFIRE_AF))) {
+        iso14_apdu_chained(cmd, len, (param & ISO14A_SEND_CHAINING), buf, (param & ISO14A_DESFIRE_AF));
+        FpgaDisableTracing();
+    } else if ((param & ISO14A_APDU)) {
         uint8_t res;
         arg0 = iso14_apdu(cmd, len, (param & ISO14A_SEND_CHAINING), buf, &res);
         FpgaDisableTracing();
 
         reply_mix(CMD_ACK, arg0, res, 0, buf, sizeof(buf));
+
+        // no answer,  don't trust the selected card anymore
+        if (arg0 == 0) {
+            iso14a_session.selected = false;
+        }
     }
 
     if ((param & ISO14A_RAW)) {
@@ -3174,6 +3416,11 @@ void ReaderIso14443a(PacketCommandNG *c) {
                 arg0 = ReaderReceive(buf, parity_array);
                 FpgaDisableTracing();
                 reply_mix(CMD_ACK, arg0, 0, 0, buf, sizeof(buf));
+
+                // no answer (HALT, wrong state..),  the selected card is gone
+                if (arg0 == 0) {
+                    iso14a_session.selected = false;
+                }
             }
         }
     }
@@ -3185,11 +3432,461 @@ void ReaderIso14443a(PacketCommandNG *c) {
         iso14a_set_timeout(save_iso14a_timeout);
     }
 
-    if ((param & ISO14A_NO_DISCONNECT)) {
+    if (iso14a_session.active) {
+        iso14a_session.last = GetTickCount();
+    }
+
+    if ((param & ISO14A_NO_DISCONNECT) || iso14a_session.active) {
         return;
     }
 
 OUT:
+    if (iso14a_session.active) {
+        iso14a_session.selected = false;
+        iso14a_session.last = GetTickCount();
+    }
+    hf_field_off();
+    set_tracing(false);
+}
+
+// Runs a ISO14A_SEQ_* program,  see mifare.h.  One reply when the program ends.
+void SequenceIso14443a(const uint8_t *prog, uint16_t len) {
+
+    iso14a_seq_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+
+    uint8_t rx[MAX_FRAME_SIZE] = {0};
+    uint8_t rxpar[MAX_PARITY_SIZE] = {0};
+    uint16_t rxlen = 0;
+    uint8_t tx[MAX_FRAME_SIZE] = {0};
+    uint8_t counter = 0;
+    uint16_t pc = 0;
+    int status = PM3_SUCCESS;
+
+    clear_trace();
+    set_tracing(true);
+
+// an op and its arguments must fit in the program
+#define SEQ_NEED(n) if (pc + (n) > len) { status = PM3_EINVARG; goto out; }
+#define SEQ_ADDR(p) (prog[(p)] | (prog[(p) + 1] << 8))
+
+    while (true) {
+
+        if (resp.steps++ >= ISO14A_SEQ_MAX_STEPS) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        if ((resp.steps & 0x3F) == 0) {
+            WDT_HIT();
+            if (BUTTON_PRESS() || data_available()) {
+                status = PM3_EOPABORTED;
+                break;
+            }
+        }
+
+        // running off the end is an END 0
+        if (pc >= len) {
+            break;
+        }
+
+        uint8_t op = prog[pc];
+        switch (op) {
+            case ISO14A_SEQ_END: {
+                SEQ_NEED(2);
+                resp.code = prog[pc + 1];
+                goto out;
+            }
+            case ISO14A_SEQ_CONNECT: {
+                SEQ_NEED(2);
+                iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+                iso14_pcb_blocknum = 0;
+                iso14a_card_select_t card;
+                bool rats = (prog[pc + 1] & ISO14A_SEQ_CONNECT_RATS);
+                resp.cond = (iso14443a_select_card(NULL, &card, NULL, true, 0, (rats == false)) != 0);
+                pc += 2;
+                break;
+            }
+            case ISO14A_SEQ_SEND: {
+                SEQ_NEED(3);
+                uint8_t flags = prog[pc + 1];
+                uint8_t n = prog[pc + 2];
+                SEQ_NEED(3 + n);
+                if (n == 0 || n + 2 > sizeof(tx)) {
+                    status = PM3_EINVARG;
+                    goto out;
+                }
+                memcpy(tx, prog + pc + 3, n);
+
+                if (flags & ISO14A_SEQ_SEND_7BIT) {
+                    ReaderTransmitBitsPar(tx, 7, NULL, NULL);
+                } else {
+                    if (flags & ISO14A_SEQ_SEND_CRC) {
+                        AddCrc14A(tx, n);
+                        n += 2;
+                    }
+                    ReaderTransmit(tx, n, NULL);
+                }
+
+                rxlen = 0;
+                if ((flags & ISO14A_SEQ_SEND_NORX) == 0) {
+                    rxlen = ReaderReceive(rx, rxpar);
+                }
+                resp.cond = (rxlen > 0);
+                pc += 3 + prog[pc + 2];
+                break;
+            }
+            case ISO14A_SEQ_EXPECT: {
+                SEQ_NEED(2);
+                uint8_t n = prog[pc + 1];
+                SEQ_NEED(2 + n);
+                resp.cond = (rxlen > 0) && (rxlen >= n) && (memcmp(rx, prog + pc + 2, n) == 0);
+                pc += 2 + n;
+                break;
+            }
+            case ISO14A_SEQ_JMP:
+            case ISO14A_SEQ_JT:
+            case ISO14A_SEQ_JF: {
+                SEQ_NEED(3);
+                bool jump = (op == ISO14A_SEQ_JMP) || ((op == ISO14A_SEQ_JT) == resp.cond);
+                pc = (jump) ? SEQ_ADDR(pc + 1) : pc + 3;
+                break;
+            }
+            case ISO14A_SEQ_SET: {
+                SEQ_NEED(2);
+                counter = prog[pc + 1];
+                pc += 2;
+                break;
+            }
+            case ISO14A_SEQ_DJNZ: {
+                SEQ_NEED(3);
+                if (counter) {
+                    counter--;
+                }
+                pc = (counter) ? SEQ_ADDR(pc + 1) : pc + 3;
+                break;
+            }
+            case ISO14A_SEQ_LOG: {
+                // a full log drops the entry,  the program keeps running
+                if (resp.loglen + 1 + rxlen <= sizeof(resp.log)) {
+                    resp.log[resp.loglen++] = rxlen;
+                    memcpy(resp.log + resp.loglen, rx, rxlen);
+                    resp.loglen += rxlen;
+                }
+                pc += 1;
+                break;
+            }
+            case ISO14A_SEQ_WAIT: {
+                SEQ_NEED(3);
+                SpinDelayUs(SEQ_ADDR(pc + 1));
+                pc += 3;
+                break;
+            }
+            case ISO14A_SEQ_OFF: {
+                hf_field_off();
+                pc += 1;
+                break;
+            }
+            default: {
+                status = PM3_EINVARG;
+                goto out;
+            }
+        }
+    }
+
+#undef SEQ_NEED
+#undef SEQ_ADDR
+
+out:
+    resp.pc = pc;
+    FpgaDisableTracing();
+    hf_field_off();
+    set_tracing(false);
+    reply_ng(CMD_HF_ISO14443A_SEQUENCE, status, (uint8_t *)&resp, sizeof(resp));
+}
+
+// power cycle and activate the card with RATS,  for the APDU sweep
+static bool apdu_sweep_select(void) {
+    hf_field_off();
+    SpinDelay(5);
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+    iso14_pcb_blocknum = 0;
+    iso14a_card_select_t card;
+    return (iso14443a_select_card(NULL, &card, NULL, true, 0, false) == 1);
+}
+
+// Sweeps INS over one CLA / P1 / P2 without a round trip to the client per APDU.
+// A card which stops answering is activated again and the APDU retried once.
+// The field is left on for the next call,  the client drops it.
+void ApduSweepIso14443a(const iso14a_sweep_req_t *req) {
+
+    iso14a_sweep_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+
+    uint8_t buf[MAX_FRAME_SIZE] = {0};
+    int status = PM3_SUCCESS;
+    uint16_t count = MIN(req->count, 256);
+
+    set_tracing(false);
+
+    if ((req->flags & ISO14A_SWEEP_CONNECT) || g_hf_field_active == false) {
+        if (apdu_sweep_select() == false) {
+            reply_ng(CMD_HF_ISO14443A_APDU_SWEEP, PM3_ECARDEXCHANGE, (uint8_t *)&resp, sizeof(resp));
+            hf_field_off();
+            return;
+        }
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        WDT_HIT();
+
+        uint8_t ins = req->ins + i;
+        if (req->skip[ins >> 3] & (1 << (ins & 7))) {
+            resp.tested++;
+            continue;
+        }
+
+        // a case 1 and a case 2S answer per INS at most
+        if (resp.count > ISO14A_SWEEP_MAX_HITS - 2) {
+            break;
+        }
+
+        uint8_t cmd[5] = {req->cla, ins, req->p1, req->p2, 0x00};
+        uint8_t cases = (req->flags & ISO14A_SWEEP_WITH_LE) ? 2 : 1;
+
+        for (uint8_t le = 0; le < cases; le++) {
+
+            int len = iso14_apdu(cmd, 4 + le, false, buf, NULL);
+            if (len < 4) {
+                resp.reselects++;
+                if (apdu_sweep_select() == false) {
+                    status = PM3_ECARDEXCHANGE;
+                    goto out;
+                }
+                len = iso14_apdu(cmd, 4 + le, false, buf, NULL);
+                if (len < 4) {
+                    status = PM3_ECARDEXCHANGE;
+                    goto out;
+                }
+            }
+            resp.sent++;
+
+            // len includes the CRC
+            uint16_t rlen = len - 2;
+            uint16_t sw = (buf[rlen - 2] << 8) | buf[rlen - 1];
+
+            if (sw == 0x6D00) {
+                resp.unsupported[ins >> 3] |= (1 << (ins & 7));
+                continue;
+            }
+
+            if (sw == 0x6E00) {
+                resp.cla_unsupported++;
+                continue;
+            }
+
+            iso14a_sweep_hit_t *hit = &resp.hits[resp.count++];
+            hit->ins = ins;
+            hit->le = le;
+            hit->sw = sw;
+            hit->datalen = MIN(rlen - 2, 0xFF);
+            memcpy(hit->data, buf, MIN(rlen - 2, ISO14A_SWEEP_DATA));
+        }
+        resp.tested++;
+    }
+
+out:
+    reply_ng(CMD_HF_ISO14443A_APDU_SWEEP, status, (uint8_t *)&resp, sizeof(resp));
+    if (status == PM3_ECARDEXCHANGE) {
+        hf_field_off();
+    }
+}
+
+// GetIso14443aAnswerFromTag() with the first Manchester sync noted,  so the tag wait
+// and the decode of the answer can be told apart.
+static bool rfbench_receive(uint8_t *resp, uint8_t *par, uint32_t *sync) {
+
+    LED_D_ON();
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_ISO14443A | FPGA_HF_ISO14443A_READER_LISTEN);
+    Demod14aInit(resp, par);
+
+    // clear RXRDY:
+    uint8_t b = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
+    (void)b;
+
+    *sync = 0;
+    uint32_t receive_timer = GetTickCount();
+    for (;;) {
+        WDT_HIT();
+
+        if (AT91C_BASE_SSC->SSC_SR & (AT91C_SSC_RXRDY)) {
+            b = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
+            if (ManchesterDecoding(b, 0, 0)) {
+                NextTransferTime = MAX(NextTransferTime, Demod.endTime - (DELAY_AIR2ARM_AS_READER + DELAY_ARM2AIR_AS_READER) / 16 + FRAME_DELAY_TIME_PICC_TO_PCD);
+                if (*sync == 0) {
+                    *sync = GetCountPerf();
+                }
+                return true;
+            }
+            if (*sync == 0 && Demod.state != DEMOD_14A_UNSYNCD) {
+                *sync = GetCountPerf();
+            }
+        }
+
+        if (GetTickCountDelta(receive_timer) > 20) {
+            return false;
+        }
+    }
+}
+
+// One round of `hw bench rf`: select the tag,  READ a block and report how long each phase took.
+// The field stays on between rounds so they measure the exchange,  not the FPGA start.
+void RfBenchIso14443a(const iso14a_rfbench_req_t *req) {
+
+    iso14a_rfbench_resp_t resp;
+    memset(&resp, 0, sizeof(resp));
+    resp.freq = PERF_FREQ;
+
+    // this request,  and our reply to the previous one
+    resp.usb_rx = perf_last(PERF_USB_RECEIVE);
+    resp.usb_tx = perf_last(PERF_USB_SEND);
+
+    set_tracing(false);
+
+    if ((req->flags & ISO14A_RFBENCH_CYCLE) && g_hf_field_active) {
+        hf_field_off();
+        SpinDelay(5);
+    }
+
+    uint32_t t = PERF_START();
+    if (g_hf_field_active == false) {
+        iso14443a_setup(FPGA_HF_ISO14443A_READER_MOD);
+        resp.fpga_setup = GetCountPerf() - t;
+    } else {
+        // back to IDLE / HALT so the WUPA below selects it again
+        uint8_t hlta[4] = { ISO14443A_CMD_HALT, 0x00, 0x00, 0x00 };
+        AddCrc14A(hlta, 2);
+        ReaderTransmit(hlta, sizeof(hlta), NULL);
+    }
+
+    t = PERF_START();
+    if (iso14443a_select_card(NULL, NULL, NULL, true, 0, true) == 0) {
+        reply_ng(CMD_HF_ISO14443A_RFBENCH, PM3_ECARDEXCHANGE, (uint8_t *)&resp, sizeof(resp));
+        hf_field_off();
+        return;
+    }
+    resp.select = GetCountPerf() - t;
+
+    uint8_t cmd[4] = { ISO14443A_CMD_READBLOCK, req->block, 0x00, 0x00 };
+    AddCrc14A(cmd, 2);
+
+    t = PERF_START();
+    GetParity(cmd, sizeof(cmd), parity_array);
+    CodeIso14443aBitsAsReaderPar(cmd, sizeof(cmd) * 8, parity_array);
+    uint32_t encoded = GetCountPerf();
+    resp.tx_encode = encoded - t;
+
+    tosend_t *ts = get_tosend();
+    TransmitFor14443a(ts->buf, ts->max, NULL);
+    uint32_t sent = GetCountPerf();
+    resp.tx = sent - encoded;
+
+    uint8_t buf[MAX_FRAME_SIZE] = {0};
+    uint8_t par[MAX_PARITY_SIZE] = {0};
+    uint32_t sync = 0;
+    int status = PM3_SUCCESS;
+    if (rfbench_receive(buf, par, &sync)) {
+        resp.tag_wait = sync - sent;
+        resp.rx_decode = GetCountPerf() - sync;
+        resp.len = MIN(Demod.len, ISO14A_RFBENCH_DATA);
+        memcpy(resp.data, buf, resp.len);
+    } else {
+        // no answer,  the whole timeout counts as waiting
+        resp.tag_wait = GetCountPerf() - sent;
+        status = PM3_ECARDEXCHANGE;
+    }
+
+    reply_ng(CMD_HF_ISO14443A_RFBENCH, status, (uint8_t *)&resp, sizeof(resp));
+
+    if (status != PM3_SUCCESS || (req->flags & ISO14A_RFBENCH_FIELD_OFF)) {
+        hf_field_off();
+    }
+}
+
+// Walk the anticollision tree: select the tag that wins the bit-collisions,
+// record it, HALT it so it stops answering REQA, and repeat until the field
+// is quiet. All UIDs are returned in a single reply.
+void EnumerateIso14443a(void) {
+
+    iso14a_enum_t res;
+    memset(&res, 0, sizeof(res));
+    iso14a_card_select_t card;
+    uint8_t hlta[4] = { ISO14443A_CMD_HALT, 0x00, 0x00, 0x00 };
+    AddCrc14A(hlta, 2);
+
+    clear_trace();
+    set_tracing(true);
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_MOD);
+
+    uint8_t misses = 0;
+    while (misses < 3) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            break;
+        }
+
+        WDT_HIT();
+
+        // REQA only wakes IDLE tags, so the ones we halted stay quiet
+        int sel = iso14443a_select_cardEx(NULL, &card, NULL, true, 0, true, &REQA_POLLING_PARAMETERS);
+        if (sel == 0) {
+            misses++;
+            continue;
+        }
+
+        // proprietary anticollision, can't be walked
+        if (sel != 1) {
+            break;
+        }
+
+        misses = 0;
+
+        // a tag that ignores HLTA would win every round; stop rather than spin
+        bool seen = false;
+        for (uint8_t i = 0; i < res.count; i++) {
+            if (res.tags[i].uidlen == card.uidlen && memcmp(res.tags[i].uid, card.uid, card.uidlen) == 0) {
+                seen = true;
+                break;
+            }
+        }
+        if (seen) {
+            break;
+        }
+
+        if (res.count == ISO14A_ENUM_MAX_TAGS) {
+            res.truncated = 1;
+            break;
+        }
+
+        iso14a_enum_tag_t *tag = &res.tags[res.count++];
+        memcpy(tag->uid, card.uid, sizeof(tag->uid));
+        tag->uidlen = card.uidlen;
+        memcpy(tag->atqa, card.atqa, sizeof(tag->atqa));
+        tag->sak = card.sak;
+
+        ReaderTransmit(hlta, sizeof(hlta), NULL);
+        LED_B_INV();
+    }
+
+    FpgaDisableTracing();
+    reply_ng(CMD_HF_ISO14443A_ENUMERATE, PM3_SUCCESS, (uint8_t *)&res, sizeof(res));
+
     hf_field_off();
     set_tracing(false);
 }
@@ -3292,8 +3989,8 @@ void ReaderMifare(bool first_try, uint8_t block, uint8_t keytype) {
 
         WDT_HIT();
 
-        // Test if the action was cancelled
-        if (checkbtn_cnt == 1000) {
+        // Test if the action was cancelled,  often enough for the client to stop a sample collected ahead
+        if (checkbtn_cnt == 16) {
             if (BUTTON_PRESS() || data_available()) {
                 isOK = -1;
                 return_status = PM3_EOPABORTED;
@@ -140,9 +140,17 @@ RAMFUNC int ManchesterDecoding(uint8_t bit, uint16_t offset, uint32_t non_real_t
 void RAMFUNC SniffIso14443a(uint8_t param);
 void SimulateIso14443aTag(uint8_t tagType, uint16_t flags, uint8_t *data, uint8_t exitAfterNReads);
 bool SimulateIso14443aInit(uint8_t tagType, uint16_t flags, uint8_t *data, tag_response_info_t **responses, uint32_t *cuid, uint32_t counters[3], uint8_t tearings[3], uint8_t *pages);
-bool GetIso14443aCommandFromReader(uint8_t *received, uint8_t *par, int *len);
+bool RAMFUNC_HOT_14A GetIso14443aCommandFromReader(uint8_t *received, uint8_t *par, int *len);
 void iso14443a_antifuzz(uint32_t flags);
 void ReaderIso14443a(PacketCommandNG *c);
+void Iso14443aSession(uint8_t action, uint32_t timeout_ms);
+bool iso14a_session_active(void);
+void iso14a_session_invalidate(void);
+void iso14a_session_tick(void);
+void EnumerateIso14443a(void);
+void ApduSweepIso14443a(const iso14a_sweep_req_t *req);
+void SequenceIso14443a(const uint8_t *prog, uint16_t len);
+void RfBenchIso14443a(const iso14a_rfbench_req_t *req);
 void ReaderTransmit(uint8_t *frame, uint16_t len, uint32_t *timing);
 void ReaderTransmitBitsPar(uint8_t *frame, uint16_t bits, uint8_t *par, uint32_t *timing);
 void ReaderTransmitPar(uint8_t *frame, uint16_t len, uint8_t *par, uint32_t *timing);
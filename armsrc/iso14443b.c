@@ -35,6 +35,7 @@
 #include "ticks.h"
 #include "iso14b.h"       // defines for ETU conversions
 #include "iclass.h"       // picopass buffer defines
+#include "rfretry.h"      // rf_retry_next
 
 /*
 * Current timing issues with ISO14443-b implementation
@@ -671,7 +672,7 @@ static RAMFUNC int Handle14443bSampleFromReader(uint8_t bit) {
 // Assume that we're called with the SSC (to the FPGA) and ADC path set
 // correctly.
 //-----------------------------------------------------------------------------
-static bool GetIso14443bCommandFromReader(uint8_t *received, uint16_t *len) {
+static RAMFUNC_HOT_14B bool GetIso14443bCommandFromReader(uint8_t *received, uint16_t *len) {
     // Set FPGA mode to "simulated ISO 14443B tag", no modulation (listen
     // only, since we are receiving, not transmitting).
     // Signal field is off with the appropriate LED
@@ -1309,7 +1310,7 @@ static RAMFUNC int Handle14443bSamplesFromTag(int ci, int cq) {
 /*
  *  Demodulate the samples we received from the tag, also log to tracebuffer
  */
-static int Get14443bAnswerFromTag(uint8_t *response, uint16_t max_len, uint32_t timeout, uint32_t *eof_time, uint16_t *retlen) {
+static RAMFUNC_HOT_14B int Get14443bAnswerFromTag(uint8_t *response, uint16_t max_len, uint32_t timeout, uint32_t *eof_time, uint16_t *retlen) {
 
     // Set up the demodulator for tag -> reader responses.
     Demod14bInit(response, max_len);
@@ -2343,6 +2344,105 @@ out:
     switch_off();
 }
 
+// SRx / ST25TB,  `count` blocks from `start` on a single selection.  Failed blocks are resent,
+// then reselected,  the reply carries the blocks read up to the first one that kept failing.
+void read_14b_st_blocks(uint8_t start, uint8_t count) {
+    iso14443b_setup();
+
+    set_tracing(true);
+
+    int res = PM3_SUCCESS;
+    uint16_t n = 0;
+    uint8_t *data = NULL;
+
+    if (count == 0 || count > (PM3_CMD_DATA_SIZE / ISO14B_BLOCK_SIZE)) {
+        res = PM3_EINVARG;
+        goto out;
+    }
+
+    data = BigBuf_calloc(count * ISO14B_BLOCK_SIZE);
+    iso14b_card_select_t *card = (iso14b_card_select_t *) BigBuf_calloc(sizeof(iso14b_card_select_t));
+
+    res = iso14443b_select_srx_card(card);
+    if (res != PM3_SUCCESS) {
+        goto out;
+    }
+
+    for (; n < count && (start + n) <= 0xFF; n++) {
+
+        // SRx has no session state,  resend first and only select again when that doesn't help
+        rf_retry_policy_t rp = RF_RETRY_POLICY(2, 1, 0, false);
+        while ((res = read_14b_srx_block(start + n, data + (n * ISO14B_BLOCK_SIZE))) != PM3_SUCCESS) {
+            rf_retry_t next = rf_retry_next(&rp, rf_fail_from_status(res));
+            if (next == RF_RETRY_RESELECT && iso14443b_select_srx_card(card) == PM3_SUCCESS) {
+                continue;
+            }
+            if (next != RF_RETRY_RESEND) {
+                break;
+            }
+        }
+
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
+            n++;
+            break;
+        }
+    }
+
+out:
+    reply_ng(CMD_HF_SRI_DUMP, res, data, n * ISO14B_BLOCK_SIZE);
+    set_tracing(false);
+    BigBuf_free_keep_EM();
+    switch_off();
+}
+
+// one field on,  tries the tag types in the order `hf 14b reader` prints them
+void iso14443b_discover(void) {
+    iso14443b_setup();
+
+    set_tracing(true);
+
+    iso14b_discover_t d;
+    memset(&d, 0, sizeof(d));
+    d.type = ISO14B_NONE;
+
+    const uint8_t empty[10] = {0};
+
+    if (iso14443b_select_card(&d.card.std) == PM3_SUCCESS && memcmp(d.card.std.uid, empty, d.card.std.uidlen)) {
+        d.type = ISO14B_STANDARD;
+        goto out;
+    }
+
+    memset(&d.card, 0, sizeof(d.card));
+    if (iso14443b_select_srx_card(&d.card.std) == PM3_SUCCESS && d.card.std.uidlen == 8 && memcmp(d.card.std.uid, empty, 8)) {
+        d.type = ISO14B_SR;
+        goto out;
+    }
+
+    memset(&d.card, 0, sizeof(d.card));
+    picopass_hdr_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    if (iso14443b_select_picopass_card(&hdr) == PM3_SUCCESS) {
+        memcpy(d.card.csn, hdr.csn, sizeof(d.card.csn));
+        d.type = ISO14B_PICOPASS;
+        goto out;
+    }
+
+    memset(&d.card, 0, sizeof(d.card));
+    if (iso14443b_select_cts_card(&d.card.cts) == PM3_SUCCESS) {
+        d.type = ISO14B_CT;
+    }
+
+out:
+    reply_ng(CMD_HF_ISO14443B_DISCOVER, (d.type == ISO14B_NONE) ? PM3_ENODATA : PM3_SUCCESS, (uint8_t *)&d, sizeof(d));
+    set_tracing(false);
+    switch_off();
+}
+
 //=============================================================================
 // Finally, the `sniffer' combines elements from both the reader and
 // simulated tag, to show both sides of the conversation.
@@ -2360,7 +2460,7 @@ out:
  * DMA Buffer - ISO14443B_DMA_BUFFER_SIZE
  * Demodulated samples received - all the rest
  */
-void SniffIso14443b(void) {
+void RAMFUNC_HOT_14B SniffIso14443b(void) {
 
     LEDsoff();
     LED_A_ON();
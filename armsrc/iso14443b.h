@@ -45,7 +45,9 @@ int iso14443b_select_card(iso14b_card_select_t *card);
 
 void SimulateIso14443bTag(const uint8_t *pupi);
 void read_14b_st_block(uint8_t blocknr);
-void SniffIso14443b(void);
+void read_14b_st_blocks(uint8_t start, uint8_t count);
+void iso14443b_discover(void);
+void RAMFUNC_HOT_14B SniffIso14443b(void);
 void SendRawCommand14443B(iso14b_raw_cmd_t *p);
 
 // States for 14B SIM command
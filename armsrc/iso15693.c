@@ -71,6 +71,7 @@
 #include "fpgaloader.h"
 #include "commonutil.h"
 #include "ticks.h"
+#include "simstats.h"
 #include "BigBuf.h"
 #include "crc16.h"
 
@@ -117,6 +118,19 @@
 #define CMD_INV_RESP        12
 #define CMD_SYSINFO_RESP    17
 
+// simulator READBLOCK answer cache
+#define ISO15_RESP_CACHE_SLOTS      32
+#define ISO15_RESP_CACHE_MAX_BLOCK  32  // block size in bytes
+
+// simulator answers which don't depend on the request,  sysinfo is the largest
+enum {
+    ISO15_RESP_INVENTORY = 0,
+    ISO15_RESP_SYSINFO,
+    ISO15_RESP_NOERROR,
+    ISO15_RESP_INFO_SLOTS
+};
+#define ISO15_RESP_INFO_SLOT_SIZE   ((CMD_SYSINFO_RESP * 2) + 3)
+
 //#define Crc(data, len)        Crc(CRC_15693, (data), (len))
 #define CheckCrc15(data, len)   check_crc(CRC_15693, (data), (len))
 #define AddCrc15(data, len)     compute_crc(CRC_15693, (data), (len), (data)+(len), (data)+(len)+1)
@@ -133,40 +147,43 @@ static void BuildIdentifyRequest(uint8_t *cmd);
 // resulting data rate is 26.48 kbit/s (fc/512)
 // cmd ... data
 // n ... length of data
-static uint8_t encode15_lut[] = {
-    0x40, // 01000000
-    0x10, // 00010000
-    0x04, // 00000100
-    0x01  // 00000001
+// bit pairs 00, 01, 10, 11 are sent as
+//    0x40 // 01000000
+//    0x10 // 00010000
+//    0x04 // 00000100
+//    0x01 // 00000001
+// one entry per nibble,  the low byte is the first pair
+static uint16_t encode15_nibble_lut[16] = {
+    0x4040, 0x4010, 0x4004, 0x4001,
+    0x1040, 0x1010, 0x1004, 0x1001,
+    0x0440, 0x0410, 0x0404, 0x0401,
+    0x0140, 0x0110, 0x0104, 0x0101
 };
 
-void CodeIso15693AsReader(const uint8_t *cmd, int n) {
+void RAMFUNC CodeIso15693AsReader(const uint8_t *cmd, int n) {
 
     tosend_reset();
     tosend_t *ts = get_tosend();
 
+    uint8_t *p = ts->buf;
+
     // SOF for 1of4
-    ts->buf[++ts->max] = 0x84; //10000100
+    *p++ = 0x84; //10000100
 
     // data
     for (int i = 0; i < n; i++) {
-
-        volatile uint8_t b = (cmd[i] >> 0) & 0x03;
-        ts->buf[++ts->max] = encode15_lut[b];
-
-        b = (cmd[i] >> 2) & 0x03;
-        ts->buf[++ts->max] = encode15_lut[b];
-
-        b = (cmd[i] >> 4) & 0x03;
-        ts->buf[++ts->max] = encode15_lut[b];
-
-        b = (cmd[i] >> 6) & 0x03;
-        ts->buf[++ts->max] = encode15_lut[b];
+        uint16_t lo = encode15_nibble_lut[cmd[i] & 0x0F];
+        uint16_t hi = encode15_nibble_lut[cmd[i] >> 4];
+        p[0] = lo;
+        p[1] = lo >> 8;
+        p[2] = hi;
+        p[3] = hi >> 8;
+        p += 4;
     }
 
     // EOF
-    ts->buf[++ts->max] = 0x20; //0010 + 0000 padding
-    ts->max++;
+    *p++ = 0x20; //0010 + 0000 padding
+    ts->max = p - ts->buf;
 }
 
 // Encode EOF only
@@ -340,6 +357,8 @@ void TransmitTo15693Tag(const uint8_t *cmd, int len, uint32_t *start_time, bool
 //-----------------------------------------------------------------------------
 void TransmitTo15693Reader(const uint8_t *cmd, size_t len, uint32_t *start_time, uint32_t slot_time, bool slow) {
 
+    sim_stats_answer();
+
     // don't use the FPGA_HF_SIMULATOR_MODULATE_424K_8BIT minor mode. It would spoil GetCountSspClk()
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_SIMULATOR | FPGA_HF_SIMULATOR_MODULATE_424K);
 
@@ -972,7 +991,9 @@ static int RAMFUNC Handle15693FSKSamplesFromTag(uint8_t freq, DecodeTagFSK_t *De
 /*
  *  Receive and decode the tag response, also log to tracebuffer
  */
-int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeout, uint32_t *eof_time, bool fsk, bool recv_speed, uint16_t *resp_len) {
+// heard, if not NULL, tells if a SOF was seen at all, also when the frame itself
+// could not be decoded (typically several tags answering in the same slot)
+static RAMFUNC_HOT_15 int GetIso15693AnswerFromTagEx(uint8_t *response, uint16_t max_len, uint16_t timeout, uint32_t *eof_time, bool fsk, bool recv_speed, uint16_t *resp_len, bool *heard) {
 
     int samples = 0, ret = PM3_SUCCESS;
     if (resp_len) {
@@ -1011,6 +1032,8 @@ int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeo
     uint32_t dma_start_time = 0;
     const uint16_t *upTo = dma->buf;
 
+    trace_stream_start();
+
     for (;;) {
 
         volatile uint16_t behindBy = ((uint16_t *)AT91C_BASE_PDC_SSC->PDC_RPR - upTo) & (DMA_BUFFER_SIZE - 1);
@@ -1074,6 +1097,10 @@ int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeo
 
         } else {
 
+            if (heard && dt->state >= STATE_TAG_RECEIVING_DATA) {
+                *heard = true;
+            }
+
             if (Handle15693SamplesFromTag(tagdata & 0x3FFF, dt, recv_speed)) {
 
                 *eof_time = dma_start_time + (samples * 16) - DELAY_TAG_TO_ARM; // end of EOF
@@ -1110,6 +1137,10 @@ int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeo
                     + (dt->lastBit != SOF_PART2 ? (32 * 16) : 0); // time for EOF transfer
     }
 
+    if (heard && (fsk ? dtf->len : dt->len) > 0) {
+        *heard = true;
+    }
+
     if (ret != PM3_SUCCESS) {
         *resp_len = 0;
         return ret;
@@ -1125,6 +1156,10 @@ int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeo
     return PM3_SUCCESS;
 }
 
+int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeout, uint32_t *eof_time, bool fsk, bool recv_speed, uint16_t *resp_len) {
+    return GetIso15693AnswerFromTagEx(response, max_len, timeout, eof_time, fsk, recv_speed, resp_len, NULL);
+}
+
 
 //=============================================================================
 // An ISO15693 decoder for reader commands.
@@ -1477,7 +1512,7 @@ static int RAMFUNC Handle15693SampleFromReader(bool bit, DecodeReader_t *reader)
 // correctly.
 //-----------------------------------------------------------------------------
 
-int GetIso15693CommandFromReader(uint8_t *received, size_t max_len, uint32_t *eof_time) {
+int RAMFUNC_HOT_15 GetIso15693CommandFromReader(uint8_t *received, size_t max_len, uint32_t *eof_time) {
     int samples = 0;
     bool gotFrame = false;
 
@@ -1538,6 +1573,7 @@ int GetIso15693CommandFromReader(uint8_t *received, size_t max_len, uint32_t *eo
         }
 
         if (gotFrame) {
+            sim_stats_frame();
             break;
         }
 
@@ -1626,7 +1662,7 @@ void AcquireRawAdcSamplesIso15693(void) {
     LEDsoff();
 }
 
-void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool iclass) {
+void RAMFUNC_HOT_15 SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool iclass) {
 
     LEDsoff();
     LED_A_ON();
@@ -1683,6 +1719,8 @@ void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool icla
 
     const uint16_t *upTo = dma->buf;
 
+    trace_stream_start();
+
     for (;;) {
 
         volatile int behind_by = ((uint16_t *)AT91C_BASE_PDC_SSC->PDC_RPR - upTo) & (DMA_BUFFER_SIZE - 1);
@@ -1723,6 +1761,13 @@ void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool icla
                     break;
                 }
             }
+
+            // drain streamed trace while the air is quiet
+            if ((tag_is_active == false) && (reader_is_active == false)) {
+                if (trace_stream_poll() == false) {
+                    break;
+                }
+            }
         }
 
         // no need to try decoding reader data if the tag is sending
@@ -1831,6 +1876,7 @@ void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool icla
 
     FpgaDisableTracing();
     switch_off();
+    trace_stream_stop();
 
     DbpString("");
     if (g_dbglevel > DBG_ERROR) {
@@ -1851,6 +1897,11 @@ void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool icla
 
 // Initialize Proxmark3 as ISO15693 reader
 void Iso15693InitReader(void) {
+    Iso15693InitReaderEx(250);
+}
+
+// energize_ms,  time given to the tags to power up after the field is switched on
+void Iso15693InitReaderEx(uint32_t energize_ms) {
 
     LEDsoff();
     FpgaDownloadAndGo(FPGA_BITSTREAM_HF_15);
@@ -1870,11 +1921,32 @@ void Iso15693InitReader(void) {
     set_tracing(true);
 
     // give tags some time to energize
-    SpinDelay(250);
+    SpinDelay(energize_ms);
 
     StartCountSspClk();
 }
 
+// one inventory round with the reader already set up,  no reply to the client.
+// uid is returned MSB first,  like CMD_HF_ISO15693_READER does
+bool Iso15693Identify(uint8_t *uid) {
+
+    uint8_t answer[32] = {0};
+    uint8_t cmd[5] = {0};
+    BuildIdentifyRequest(cmd);
+
+    uint32_t eof_time = 0;
+    uint16_t recvlen = 0;
+    int res = SendDataTag(cmd, sizeof(cmd), false, true, answer, sizeof(answer), GetCountSspClk(), ISO15693_READER_TIMEOUT, &eof_time, &recvlen);
+    if (res != PM3_SUCCESS || recvlen < 12) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < 8; i++) {
+        uid[i] = answer[9 - i];
+    }
+    return true;
+}
+
 ///////////////////////////////////////////////////////////////////////
 // ISO 15693 Part 3 - Air Interface
 // This section basically contains transmission and receiving of bits
@@ -2125,6 +2197,29 @@ void EmlClearIso15693(void) {
     reply_ng(CMD_HF_ISO15693_EML_CLEAR, PM3_SUCCESS, NULL, 0);
 }
 
+// fills the answer for one of the ISO15_RESP_* slots,  returns its length without CRC
+static uint16_t iso15_sim_info_answer(const iso15_tag_t *tag, uint8_t key, uint8_t *out) {
+    out[0] = ISO15_NOERROR;
+    switch (key) {
+        case ISO15_RESP_INVENTORY:
+            out[1] = tag->dsfid;
+            memcpy(&out[2], tag->uid, 8);
+            return 10;
+        case ISO15_RESP_SYSINFO:
+            out[1] = 0x0f; // sysinfo contain all info
+            memcpy(&out[2], tag->uid, 8);
+            out[10] = tag->dsfid;
+            out[11] = tag->afi;
+            out[12] = tag->pagesCount - 1;
+            out[13] = tag->bytesPerPage - 1;
+            out[14] = tag->ic;
+            return 15;
+        case ISO15_RESP_NOERROR:
+        default:
+            return 1;
+    }
+}
+
 // Simulate an ISO15693 TAG, perform anti-collision and then print any reader commands
 // all demodulation performed in arm rather than host. - greg
 void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
@@ -2199,6 +2294,36 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
 
     LED_C_ON();
 
+    // Modulated READBLOCK answers, keyed by block | option flag << 8.
+    // The first blocks are encoded before the reader shows up,  writes and locks drop the entry.
+    resp_cache_t block_cache = {0};
+    if ((tag->bytesPerPage <= ISO15_RESP_CACHE_MAX_BLOCK) &&
+            resp_cache_init(&block_cache, ISO15_RESP_CACHE_SLOTS, ((tag->bytesPerPage + 4) * 2) + 3)) {
+        uint8_t answer[1 + ISO15_RESP_CACHE_MAX_BLOCK + 2] = {ISO15_NOERROR};
+        for (uint8_t i = 0; i < MIN(ISO15_RESP_CACHE_SLOTS, tag->pagesCount); i++) {
+            memcpy(answer + 1, tag->data + (i * tag->bytesPerPage), tag->bytesPerPage);
+            AddCrc15(answer, 1 + tag->bytesPerPage);
+            CodeIso15693AsTag(answer, 3 + tag->bytesPerPage);
+            resp_cache_put_tosend(&block_cache, i);
+        }
+    }
+    int32_t cache_key = -1;
+
+    // Inventory, system info and plain NOERROR answers,  DSFID / AFI writes drop the entries.
+    resp_cache_t info_cache = {0};
+    if (resp_cache_init(&info_cache, ISO15_RESP_INFO_SLOTS, ISO15_RESP_INFO_SLOT_SIZE)) {
+        uint8_t answer[CMD_SYSINFO_RESP] = {0};
+        for (uint8_t i = 0; i < ISO15_RESP_INFO_SLOTS; i++) {
+            uint16_t n = iso15_sim_info_answer(tag, i, answer);
+            AddCrc15(answer, n);
+            CodeIso15693AsTag(answer, n + 2);
+            resp_cache_put_tosend(&info_cache, i);
+        }
+    }
+    int32_t info_key = -1;
+
+    sim_stats_start(SIM_STATS_15, SIM_STATS_BUDGET_15_US);
+
     bool button_pressed = false;
     int vHf; // in mV
 
@@ -2269,6 +2394,7 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                 crc = CalculateCrc15(cmd, ++cmd_len - 2); // if crc end with 00 00
                 if (((crc & 0xff) != cmd[cmd_len - 2]) || ((crc >> 8) != cmd[cmd_len - 1])) {
                     if (g_dbglevel >= DBG_DEBUG) Dbprintf("CrcFail!, expected CRC=%02X%02X", crc & 0xff, crc >> 8);
+                    sim_stats_frame_error();
                     continue;
                 } else if (g_dbglevel >= DBG_DEBUG)
                     Dbprintf("CrcOK");
@@ -2279,6 +2405,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
 
         cmd_len -= 2; // remove the CRC from the cmd
         recvLen = 0;
+        cache_key = -1;
+        info_key = -1;
 
         tag->expectFast = ((cmd[0] & ISO15_REQ_DATARATE_HIGH) == ISO15_REQ_DATARATE_HIGH);
         tag->expectFsk = ((cmd[0] & ISO15_REQ_SUBCARRIER_TWO) == ISO15_REQ_SUBCARRIER_TWO);
@@ -2343,10 +2471,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                 continue;
 
             // No error: Answer
-            recv[0] = ISO15_NOERROR;
-            recv[1] = tag->dsfid;
-            memcpy(&recv[2], tag->uid, 8);
-            recvLen = 10;
+            info_key = ISO15_RESP_INVENTORY;
+            recvLen = iso15_sim_info_answer(tag, info_key, recv);
         } else {
             if ((cmd[0] & ISO15_REQ_SELECT) == ISO15_REQ_SELECT) {
                 if (g_dbglevel >= DBG_DEBUG) Dbprintf("Selected Request");
@@ -2380,10 +2506,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
             switch (cmd[1]) {
                 case ISO15693_INVENTORY:
                     if (g_dbglevel >= DBG_DEBUG) Dbprintf("Inventory cmd");
-                    recv[0] = ISO15_NOERROR;
-                    recv[1] = tag->dsfid;
-                    memcpy(&recv[2], tag->uid, 8);
-                    recvLen = 10;
+                    info_key = ISO15_RESP_INVENTORY;
+                    recvLen = iso15_sim_info_answer(tag, info_key, recv);
                     break;
                 case ISO15693_STAYQUIET:
                     if (g_dbglevel >= DBG_DEBUG) Dbprintf("StayQuiet cmd");
@@ -2397,9 +2521,11 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                     else {
                         recv[0] = ISO15_NOERROR;
                         recvLen = 1;
+                        cache_key = pageNum;
                         if ((cmd[0] & ISO15_REQ_OPTION) == ISO15_REQ_OPTION) { // ask for lock status
                             recv[1] = tag->locks[pageNum];
                             recvLen++;
+                            cache_key |= 0x100;
                         }
                         for (uint8_t i = 0 ; i < tag->bytesPerPage ; i++)
                             recv[recvLen + i] = tag->data[(pageNum * tag->bytesPerPage) + i];
@@ -2414,6 +2540,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                     else {
                         for (uint8_t i = 0 ; i < tag->bytesPerPage ; i++)
                             tag->data[(pageNum * tag->bytesPerPage) + i] = cmd[i + cmdCpt];
+                        resp_cache_invalidate(&block_cache, pageNum);
+                        resp_cache_invalidate(&block_cache, pageNum | 0x100);
                         recv[0] = ISO15_NOERROR;
                         recvLen = 1;
                     }
@@ -2427,6 +2555,7 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                         error = ISO15_ERROR_BLOCK_LOCKED_ALREADY;
                     else {
                         tag->locks[pageNum] = 1;
+                        resp_cache_invalidate(&block_cache, pageNum | 0x100);
                         recv[0] = ISO15_NOERROR;
                         recvLen = 1;
                     }
@@ -2456,6 +2585,7 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                         error = ISO15_ERROR_BLOCK_LOCKED;
                     else {
                         tag->afi = cmd[cmdCpt++];
+                        resp_cache_invalidate(&info_cache, ISO15_RESP_SYSINFO);
                         recv[0] = ISO15_NOERROR;
                         recvLen = 1;
                     }
@@ -2476,6 +2606,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                         error = ISO15_ERROR_BLOCK_LOCKED;
                     else {
                         tag->dsfid = cmd[cmdCpt++];
+                        resp_cache_invalidate(&info_cache, ISO15_RESP_INVENTORY);
+                        resp_cache_invalidate(&info_cache, ISO15_RESP_SYSINFO);
                         recv[0] = ISO15_NOERROR;
                         recvLen = 1;
                     }
@@ -2504,15 +2636,8 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                     break;
                 case ISO15693_GET_SYSTEM_INFO:
                     if (g_dbglevel >= DBG_DEBUG) Dbprintf("GetSystemInfo cmd");
-                    recv[0] = ISO15_NOERROR;
-                    recv[1] = 0x0f; // sysinfo contain all info
-                    memcpy(&recv[2], tag->uid, 8);
-                    recv[10] = tag->dsfid;
-                    recv[11] = tag->afi;
-                    recv[12] = tag->pagesCount - 1;
-                    recv[13] = tag->bytesPerPage - 1;
-                    recv[14] = tag->ic;
-                    recvLen = 15;
+                    info_key = ISO15_RESP_SYSINFO;
+                    recvLen = iso15_sim_info_answer(tag, info_key, recv);
                     break;
                 case ISO15693_READ_MULTI_SECSTATUS:
                     if (g_dbglevel >= DBG_DEBUG) Dbprintf("ReadMultiSecStatus cmd");
@@ -2572,28 +2697,52 @@ void SimTagIso15693(const uint8_t *uid, uint8_t block_size) {
                 recv[1] = error;
                 recvLen = 2;
                 error = 0;
+                cache_key = -1;
+                info_key = -1;
                 if (g_dbglevel >= DBG_DEBUG)
                     Dbprintf("ERROR 0x%2X in received request", error);
             }
         }
 
         if (recvLen > 0) { // We need to answer
+            if (recvLen == 1 && recv[0] == ISO15_NOERROR) {
+                info_key = ISO15_RESP_NOERROR;
+            }
+
             AddCrc15(recv, recvLen);
             recvLen += 2;
-            CodeIso15693AsTag(recv, recvLen);
-            const tosend_t *ts = get_tosend();
+
+            uint16_t mod_len = 0;
+            const uint8_t *mod = NULL;
+            if (cache_key >= 0) {
+                mod = resp_cache_get(&block_cache, cache_key, &mod_len);
+            } else if (info_key >= 0) {
+                mod = resp_cache_get(&info_cache, info_key, &mod_len);
+            }
+            if (mod == NULL) {
+                CodeIso15693AsTag(recv, recvLen);
+                const tosend_t *ts = get_tosend();
+                mod = ts->buf;
+                mod_len = ts->max;
+                if (cache_key >= 0) {
+                    resp_cache_put_tosend(&block_cache, cache_key);
+                } else if (info_key >= 0) {
+                    resp_cache_put_tosend(&info_cache, info_key);
+                }
+            }
             uint32_t response_time = reader_eof_time + DELAY_ISO15693_VCD_TO_VICC_SIM;
 
             if (tag->expectFsk) { // Not suppoted yet
                 if (g_dbglevel >= DBG_DEBUG) Dbprintf("%ERROR: FSK answers are not supported yet");
-                //TransmitTo15693ReaderFSK(ts->buf,ts->max, &response_time, 0, !tag->expectFast);
+                //TransmitTo15693ReaderFSK(mod, mod_len, &response_time, 0, !tag->expectFast);
             } else
-                TransmitTo15693Reader(ts->buf, ts->max, &response_time, 0, !tag->expectFast);
+                TransmitTo15693Reader(mod, mod_len, &response_time, 0, !tag->expectFast);
 
-            LogTrace_ISO15693(recv, recvLen, response_time * 32, (response_time * 32) + (ts->max * 32 * 64), NULL, false);
+            LogTrace_ISO15693(recv, recvLen, response_time * 32, (response_time * 32) + (mod_len * 32 * 64), NULL, false);
         }
     }
 
+    sim_stats_stop();
     switch_off();
 
     if (button_pressed) {
@@ -2767,6 +2916,128 @@ void SendRawCommand15693(iso15_raw_cmd_t *packet) {
     LED_A_OFF();
 }
 
+// Send an inventory request (cmd != NULL) or the EOF that opens the next slot,
+// and listen for the slot answer. start_time is moved to the earliest time
+// the reader may send again.
+static int inventory_slot_15693(const uint8_t *cmd, uint8_t cmdlen, uint32_t *start_time, uint8_t *answer, uint16_t max_len, uint16_t *answer_len, bool *heard) {
+    if (cmd) {
+        CodeIso15693AsReader(cmd, cmdlen);
+    } else {
+        CodeIso15693AsReaderEOF();
+    }
+
+    const tosend_t *ts = get_tosend();
+    TransmitTo15693Tag(ts->buf, ts->max, start_time, false);
+    uint32_t eof_time = *start_time + 32 * ((8 * ts->max) - 4); // subtract the 4 padding bits after EOF
+    LogTrace_ISO15693(cmd, (cmd ? cmdlen : 0), (*start_time * 4), (eof_time * 4), NULL, true);
+
+    *heard = false;
+    int res = GetIso15693AnswerFromTagEx(answer, max_len, ISO15693_READER_TIMEOUT, &eof_time, false, true, answer_len, heard);
+    if (res == PM3_SUCCESS) {
+        *start_time = eof_time + DELAY_ISO15693_VICC_TO_VCD_READER;
+    } else {
+        // the timeout already covers the no-answer slot time, send right away
+        *start_time = GetCountSspClk();
+    }
+    return res;
+}
+
+// ISO 15693-3 anticollision, 16 slots per inventory round.
+// A slot with an undecodable answer holds several tags, it is searched
+// again with the slot number appended to the mask (4 bits per level).
+#define ISO15_INVENTORY_MASK_STACK   64
+void InventoryIso15693(const iso15_inventory_req_t *req) {
+
+    LED_A_ON();
+
+    iso15_inventory_t out;
+    memset(&out, 0, sizeof(out));
+
+    struct {
+        uint64_t mask;
+        uint8_t len;
+    } stack[ISO15_INVENTORY_MASK_STACK];
+    uint8_t sp = 0;
+
+    if (req->flags & ISO15_CONNECT) {
+        Iso15693InitReader();
+    }
+
+    uint8_t answer[32] = {0};
+    uint32_t start_time = GetCountSspClk();
+
+    stack[sp].mask = 0;
+    stack[sp++].len = 0;
+
+    while (sp > 0) {
+
+        WDT_HIT();
+
+        if (BUTTON_PRESS()) {
+            out.truncated = 1;
+            break;
+        }
+
+        sp--;
+        uint64_t mask = stack[sp].mask;
+        uint8_t masklen = stack[sp].len;
+
+        uint8_t cmd[3 + 8 + 2] = {0};
+        uint8_t cmdlen = 0;
+        cmd[cmdlen++] = ISO15_REQ_SUBCARRIER_SINGLE | ISO15_REQ_DATARATE_HIGH | ISO15_REQ_INVENTORY | ISO15_REQINV_SLOT16;
+        cmd[cmdlen++] = ISO15693_INVENTORY;
+        cmd[cmdlen++] = masklen;
+        for (uint8_t i = 0; i < (masklen + 7) / 8; i++) {
+            cmd[cmdlen++] = (mask >> (8 * i)) & 0xFF;
+        }
+        AddCrc15(cmd, cmdlen);
+        cmdlen += 2;
+
+        for (uint8_t slot = 0; slot < 16; slot++) {
+            uint16_t len = 0;
+            bool heard = false;
+            int res = inventory_slot_15693((slot == 0) ? cmd : NULL, cmdlen, &start_time, answer, sizeof(answer), &len, &heard);
+
+            if (res == PM3_SUCCESS && len == 12 && CheckCrc15(answer, 12) && (answer[0] & ISO15_RES_ERROR) == 0) {
+
+                bool known = false;
+                for (uint8_t i = 0; i < out.count; i++) {
+                    if (memcmp(out.uid[i], answer + 2, 8) == 0) {
+                        known = true;
+                        break;
+                    }
+                }
+
+                if (known == false) {
+                    if (out.count < ISO15_INVENTORY_MAX_TAGS) {
+                        memcpy(out.uid[out.count++], answer + 2, 8);
+                    } else {
+                        out.truncated = 1;
+                    }
+                }
+
+            } else if (len > 0 || heard) {
+
+                // collision, a 60 bit mask leaves a single nibble and can't be split further
+                if (masklen + 4 <= 60 && sp < ISO15_INVENTORY_MASK_STACK) {
+                    stack[sp].mask = mask | ((uint64_t)slot << masklen);
+                    stack[sp++].len = masklen + 4;
+                } else {
+                    out.truncated = 1;
+                }
+            }
+        }
+    }
+
+    reply_ng(CMD_HF_ISO15693_INVENTORY, PM3_SUCCESS, (uint8_t *)&out, sizeof(out));
+
+    if ((req->flags & ISO15_NO_DISCONNECT) == 0) {
+        switch_off();
+    }
+
+    LED_A_OFF();
+}
+
 /*
 SLIx functions from official master forks.
 
@@ -34,12 +34,14 @@
 #define DELAY_ISO15693_VICC_TO_VCD_READER 1024 // 1024/3.39MHz = 302.1us between end of tag response and next reader command
 
 void Iso15693InitReader(void);
+void Iso15693InitReaderEx(uint32_t energize_ms);
+bool Iso15693Identify(uint8_t *uid);
 void Iso15693InitTag(void);
-void CodeIso15693AsReader(const uint8_t *cmd, int n);
+void RAMFUNC CodeIso15693AsReader(const uint8_t *cmd, int n);
 void CodeIso15693AsTag(const uint8_t *cmd, size_t len);
 
 void TransmitTo15693Reader(const uint8_t *cmd, size_t len, uint32_t *start_time, uint32_t slot_time, bool slow);
-int GetIso15693CommandFromReader(uint8_t *received, size_t max_len, uint32_t *eof_time);
+int RAMFUNC_HOT_15 GetIso15693CommandFromReader(uint8_t *received, size_t max_len, uint32_t *eof_time);
 void TransmitTo15693Tag(const uint8_t *cmd, int len, uint32_t *start_time, bool shallow_mod);
 int GetIso15693AnswerFromTag(uint8_t *response, uint16_t max_len, uint16_t timeout, uint32_t *eof_time, bool fsk, bool recv_speed, uint16_t *resp_len);
 
@@ -50,8 +52,9 @@ void EmlClearIso15693(void);
 void SimTagIso15693(const uint8_t *uid, uint8_t block_size); // simulate an ISO15693 tag
 void BruteforceIso15693Afi(uint32_t flags); // find an AFI of a tag
 void SendRawCommand15693(iso15_raw_cmd_t *packet); // send arbitrary commands from CLI
+void InventoryIso15693(const iso15_inventory_req_t *req); // 16 slot anticollision
 
-void SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool iclass);
+void RAMFUNC_HOT_15 SniffIso15693(uint8_t jam_search_len, uint8_t *jam_search_string, bool iclass);
 
 int SendDataTag(const uint8_t *send, int sendlen, bool init, bool speed_fast, uint8_t *recv,
                 uint16_t max_recv_len, uint32_t start_time, uint16_t timeout, uint32_t *eof_time, uint16_t *resp_len);
@@ -63,6 +63,7 @@ static uint32_t last_frame_end; /* ts of last bit of previews rx or tx frame */
 
 #define LEGIC_CARD_MEMSIZE 1024 /* The largest Legic Prime card is 1k */
 #define WRITE_LOWERLIMIT      4 /* UID and MCC are not writable */
+#define LEGIC_READ_RETRIES    3 /* reads of one byte before giving up on crc errors */
 
 static uint32_t input_threshold = 8; /* heuristically determined, lower values */
 /* lead to detecting false ack during write */
@@ -166,6 +167,10 @@ static void tx_bit(bool bit) {
 static void tx_frame(uint32_t frame, uint8_t len) {
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_MODE_SEND_FULL_MOD);
 
+    // keystream for the whole frame, computed while we wait for the timeslot
+    // so the bit loop below only has to keep the timing
+    uint32_t ks = legic_prng_get_bits(len);
+
     // wait for next tx timeslot
     last_frame_end += RWD_FRAME_WAIT;
     while (GET_TICKS < last_frame_end) { };
@@ -174,10 +179,9 @@ static void tx_frame(uint32_t frame, uint8_t len) {
     uint32_t last_frame_start = last_frame_end;
 
     // transmit frame, MSB first
+    uint32_t obfuscated = frame ^ ks;
     for (uint8_t i = 0; i < len; ++i) {
-        bool bit = (frame >> i) & 0x01;
-        tx_bit(bit ^ legic_prng_get_bit());
-        legic_prng_forward(1);
+        tx_bit((obfuscated >> i) & 0x01);
     };
 
     // add pause to mark end of the frame
@@ -194,6 +198,9 @@ static void tx_frame(uint32_t frame, uint8_t len) {
 static uint32_t rx_frame(uint8_t len) {
     FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_READER | FPGA_HF_READER_SUBCARRIER_212_KHZ | FPGA_HF_READER_MODE_RECEIVE_IQ);
 
+    // keystream for the whole frame, see tx_frame
+    uint32_t ks = legic_prng_get_bits(len);
+
     // hold sampling until card is expected to respond
     last_frame_end += TAG_FRAME_WAIT;
     while (GET_TICKS < last_frame_end) { };
@@ -203,13 +210,13 @@ static uint32_t rx_frame(uint8_t len) {
 
     uint32_t frame = 0;
     for (uint8_t i = 0; i < len; ++i) {
-        frame |= (rx_bit() ^ legic_prng_get_bit()) << i;
-        legic_prng_forward(1);
+        frame |= rx_bit() << i;
 
         // rx_bit runs only 95us, resync to TAG_BIT_PERIOD
         last_frame_end += TAG_BIT_PERIOD;
         while (GET_TICKS < last_frame_end) { };
     }
+    frame ^= ks;
 
     // log
     uint8_t cmdbytes[] = {len, BYTEx(frame, 0), BYTEx(frame, 1)};
@@ -230,10 +237,11 @@ static bool rx_ack(void) {
     uint32_t last_frame_start = last_frame_end;
 
     uint32_t ack = 0;
-    for (uint8_t i = 0; i < TAG_WRITE_TIMEOUT; ++i) {
+    uint8_t i = 0;
+    while (i < TAG_WRITE_TIMEOUT) {
         // sample bit
         ack = rx_bit();
-        legic_prng_forward(1);
+        i++;
 
         // rx_bit runs only 95us, resync to TAG_BIT_PERIOD
         last_frame_end += TAG_BIT_PERIOD;
@@ -245,6 +253,9 @@ static bool rx_ack(void) {
         }
     }
 
+    // the prng ran one step per sampled bit
+    legic_prng_forward(i);
+
     // log
     uint8_t cmdbytes[] = {1, BYTEx(ack, 0)};
     LogTrace(cmdbytes, sizeof(cmdbytes), last_frame_start, last_frame_end, NULL, false);
@@ -361,31 +372,38 @@ static uint8_t calc_crc4(uint16_t cmd, uint8_t cmd_sz, uint8_t value) {
     return crc_finish(&legic_crc);
 }
 
+// A corrupted reply doesn't desync the prng, every exchange takes the same
+// number of steps. So the same byte is just asked for again instead of
+// giving up the whole read.
 static int16_t read_byte(uint16_t index, uint8_t cmd_sz) {
     uint16_t cmd = (index << 1) | LEGIC_READ;
 
-    // read one byte
-    LED_B_ON();
-    legic_prng_forward(2);
-    tx_frame(cmd, cmd_sz);
-    legic_prng_forward(2);
-    uint32_t frame = rx_frame(12);
-    LED_B_OFF();
+    for (uint8_t tries = 0; tries < LEGIC_READ_RETRIES; tries++) {
+
+        // read one byte
+        LED_B_ON();
+        legic_prng_forward(2);
+        tx_frame(cmd, cmd_sz);
+        legic_prng_forward(2);
+        uint32_t frame = rx_frame(12);
+        LED_B_OFF();
+
+        legic_prng_forward(1);
 
-    // split frame into data and crc
-    uint8_t byte = BYTEx(frame, 0);
-    uint8_t crc = BYTEx(frame, 1);
+        // split frame into data and crc
+        uint8_t byte = BYTEx(frame, 0);
+        uint8_t crc = BYTEx(frame, 1);
+
+        // check received against calculated crc
+        uint8_t calc_crc = calc_crc4(cmd, cmd_sz, byte);
+        if (calc_crc == crc) {
+            return byte;
+        }
 
-    // check received against calculated crc
-    uint8_t calc_crc = calc_crc4(cmd, cmd_sz, byte);
-    if (calc_crc != crc) {
         Dbprintf("!!! crc mismatch: %x != %x !!!",  calc_crc, crc);
-        return -1;
     }
 
-    legic_prng_forward(1);
-
-    return byte;
+    return -1;
 }
 
 // Transmit write command, wait until (3.6ms) the tag sends back an unencrypted
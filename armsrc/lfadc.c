@@ -22,6 +22,7 @@
 #include "ticks.h"
 #include "dbprint.h"
 #include "appmain.h"
+#include "BigBuf.h"
 
 // Sam7s has several timers, we will use the source TIMER_CLOCK1 (aka AT91C_TC_CLKS_TIMER_DIV1_CLOCK)
 // TIMER_CLOCK1 = MCK/2, MCK is running at 48 MHz, Timer is running at 48/2 = 24 MHz
@@ -49,6 +50,10 @@ bool g_logging = true;
 static bool rising_edge = false;
 static bool reader_mode = false;
 
+// ring the SSC PDC fills while a capture is running, NULL when samples are polled
+static dmabuf8_t *capture_dma = NULL;
+static uint16_t capture_pos = 0;
+
 //////////////////////////////////////////////////////////////////////////////
 // Auxiliary functions
 //////////////////////////////////////////////////////////////////////////////
@@ -86,6 +91,70 @@ void lf_sample_mean(void) {
     }
 }
 
+//////////////////////////////////////////////////////////////////////////////
+// DMA sample capture
+//////////////////////////////////////////////////////////////////////////////
+// Between lf_capture_start and lf_capture_stop the PDC streams the ADC samples,  one per carrier period,
+// into the dma8 ring and the edge counters consume the ring instead of polling the SSC.  Samples arriving
+// while the caller decodes or logs are kept,  periods stay exact.
+
+bool lf_capture_start(void) {
+
+    dmabuf8_t *dma = get_dma8();
+    if (dma->buf == NULL) {
+        return false;
+    }
+
+    if (FpgaSetupSscDma(dma->buf, dma->size) == false) {
+        return false;
+    }
+
+    capture_pos = 0;
+    capture_dma = dma;
+    return true;
+}
+
+void lf_capture_stop(void) {
+    if (capture_dma == NULL) {
+        return;
+    }
+
+    FpgaDisableSscDma();
+    capture_dma = NULL;
+}
+
+static bool lf_capture_sample(uint8_t *adc_val) {
+
+    // primary buffer was stopped,  the ring was overrun and its tail is stale
+    if (AT91C_BASE_PDC_SSC->PDC_RCR == 0) {
+        AT91C_BASE_PDC_SSC->PDC_RPR = (uint32_t) capture_dma->buf;
+        AT91C_BASE_PDC_SSC->PDC_RCR = capture_dma->size;
+        capture_pos = 0;
+        if (g_dbglevel >= DBG_EXTENDED) {
+            DbpString("LF capture overrun");
+        }
+    }
+
+    // secondary buffer became primary, chain it back to the ring
+    if (AT91C_BASE_PDC_SSC->PDC_RNCR == 0) {
+        AT91C_BASE_PDC_SSC->PDC_RNPR = (uint32_t) capture_dma->buf;
+        AT91C_BASE_PDC_SSC->PDC_RNCR = capture_dma->size;
+    }
+
+    uint16_t dma_pos = capture_dma->size - AT91C_BASE_PDC_SSC->PDC_RCR;
+    if (dma_pos == capture_pos) {
+        return false;
+    }
+
+    *adc_val = capture_dma->buf[capture_pos];
+
+    capture_pos++;
+    if (capture_pos == capture_dma->size) {
+        capture_pos = 0;
+    }
+    return true;
+}
+
 static size_t lf_count_edge_periods_ex(size_t max, bool wait, bool detect_gap) {
 
 #define LIMIT_DEV  20
@@ -109,15 +178,24 @@ static size_t lf_count_edge_periods_ex(size_t max, bool wait, bool detect_gap) {
             continue;
         }
 
-        if (AT91C_BASE_SSC->SSC_SR & (AT91C_SSC_RXRDY)) {
+        uint8_t adc_val = 0;
+        bool have_sample;
+        if (capture_dma) {
+            have_sample = lf_capture_sample(&adc_val);
+        } else {
+            have_sample = (AT91C_BASE_SSC->SSC_SR & (AT91C_SSC_RXRDY));
+            if (have_sample) {
+                adc_val = AT91C_BASE_SSC->SSC_RHR;
+            }
+        }
+
+        if (have_sample) {
 
             periods++;
 
             // reset timeout
             timeout = 100000;
 
-            volatile uint8_t adc_val = AT91C_BASE_SSC->SSC_RHR;
-
             if (g_logging) {
                 logSampleSimple(adc_val);
             }
@@ -276,6 +354,8 @@ void lf_init(bool reader, bool simulate, bool ledcontrol) {
 }
 
 void lf_finalize(bool ledcontrol) {
+    lf_capture_stop();
+
     // Disable timers
     AT91C_BASE_TC0->TC_CCR = AT91C_TC_CLKDIS;
     AT91C_BASE_TC1->TC_CCR = AT91C_TC_CLKDIS;
@@ -34,6 +34,9 @@ size_t lf_count_edge_periods(size_t max);
 size_t lf_detect_gap(size_t max);
 void lf_reset_counter(void);
 
+bool lf_capture_start(void);
+void lf_capture_stop(void);
+
 bool lf_get_tag_modulation(void);
 bool lf_get_reader_modulation(void);
 
@@ -835,9 +835,7 @@ void WriteTItag(uint32_t idhi, uint32_t idlo, uint16_t crc, bool ledcontrol) {
     StopTicks();
 }
 
-// note:   a call to FpgaDownloadAndGo(FPGA_BITSTREAM_LF) must be done before, but
-//  this may destroy the bigbuf so be sure this is called before calling SimulateTagLowFrequencyEx
-void SimulateTagLowFrequencyEx(int period, int gap, bool ledcontrol, int numcycles) {
+static void sim_lf_setup(void) {
 
     // start us timer
     StartTicks();
@@ -846,9 +844,6 @@ void SimulateTagLowFrequencyEx(int period, int gap, bool ledcontrol, int numcycl
     FpgaWriteConfWord(FPGA_MAJOR_MODE_LF_EDGE_DETECT);
     WaitMS(20);
 
-    int i = 0, x = 0;
-    uint8_t *buf = BigBuf_get_addr();
-
     // set frequency,  get values from 'lf config' command
     sample_config *sc = getSamplingConfig();
 
@@ -862,7 +857,13 @@ void SimulateTagLowFrequencyEx(int period, int gap, bool ledcontrol, int numcycl
     AT91C_BASE_PIOA->PIO_PER = GPIO_SSC_DOUT | GPIO_SSC_CLK;
     AT91C_BASE_PIOA->PIO_OER = GPIO_SSC_DOUT;
     AT91C_BASE_PIOA->PIO_ODR = GPIO_SSC_CLK;
+}
 
+// returns true when numcycles ran out and the field is still set up
+static bool sim_lf_run(int period, int gap, bool ledcontrol, int numcycles) {
+
+    int i = 0, x = 0;
+    uint8_t *buf = BigBuf_get_addr();
     uint16_t check = 0;
 
     for (;;) {
@@ -872,7 +873,7 @@ void SimulateTagLowFrequencyEx(int period, int gap, bool ledcontrol, int numcycl
                 ++x;
             } else {
                 // exit without turning off field
-                return;
+                return true;
             }
         }
 
@@ -923,6 +924,14 @@ OUT:
     StopTicks();
     FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
     if (ledcontrol) LED_D_OFF();
+    return false;
+}
+
+// note:   a call to FpgaDownloadAndGo(FPGA_BITSTREAM_LF) must be done before, but
+//  this may destroy the bigbuf so be sure this is called before calling SimulateTagLowFrequencyEx
+void SimulateTagLowFrequencyEx(int period, int gap, bool ledcontrol, int numcycles) {
+    sim_lf_setup();
+    sim_lf_run(period, gap, ledcontrol, numcycles);
 }
 
 void SimulateTagLowFrequency(int period, int gap, bool ledcontrol) {
@@ -1008,6 +1017,71 @@ void CmdHIDsimTAG(uint32_t hi2, uint32_t hi, uint32_t lo, uint8_t longFMT, bool
     reply_ng(CMD_LF_HID_SIMULATE, PM3_EOPABORTED, NULL, 0);
 }
 
+// HID 44bit waveform kept in BigBuf between bruteforce candidates.
+// fc8 does not divide rf/50, so each bit starts at an offset / remainder that depends on all
+// bits before it. We remember both per bit and only re-render from the first changed bit on.
+#define HID_TMPL_BITS   (8 + 44 * 2)
+static struct {
+    bool valid;
+    bool armed;         // field still configured by the previous burst
+    uint8_t bits[HID_TMPL_BITS];
+    uint16_t start[HID_TMPL_BITS + 1];
+    int8_t remainder[HID_TMPL_BITS + 1];
+} hid_tmpl;
+
+void CmdHIDsimTAGReset(void) {
+    hid_tmpl.valid = false;
+    hid_tmpl.armed = false;
+}
+
+// Same as CmdHIDsimTAGEx for 44bit ids, but meant to be called back to back with changing ids.
+// Call CmdHIDsimTAGReset() first, and again whenever BigBuf or the FPGA was used in between.
+void CmdHIDsimTAGFast(uint32_t hi, uint32_t lo, bool ledcontrol, int numcycles) {
+
+    if (hi > 0xFFF) {
+        DbpString("[!] tags can only have 44 bits. - USE lf simfsk for larger tags");
+        return;
+    }
+
+    uint8_t bits[HID_TMPL_BITS] = { 0, 0, 0, 1, 1, 1, 0, 1 };
+    uint16_t n = 8;
+    manchesterEncodeUint32(hi, 12, bits, &n);
+    manchesterEncodeUint32(lo, 32, bits, &n);
+
+    uint16_t first = 0;
+    if (hid_tmpl.valid) {
+        while (first < HID_TMPL_BITS && bits[first] == hid_tmpl.bits[first]) {
+            first++;
+        }
+    } else {
+        FpgaDownloadAndGo(FPGA_BITSTREAM_LF);
+        BigBuf_free();
+        clear_trace();
+        set_tracing(false);
+        hid_tmpl.start[0] = 0;
+        hid_tmpl.remainder[0] = 0;
+        hid_tmpl.armed = false;
+    }
+
+    int pos = hid_tmpl.start[first];
+    int16_t remainder = hid_tmpl.remainder[first];
+    for (uint16_t i = first; i < HID_TMPL_BITS; i++) {
+        fcAll(bits[i] ? 10 : 8, &pos, 50, &remainder);
+        hid_tmpl.start[i + 1] = pos;
+        hid_tmpl.remainder[i + 1] = remainder;
+    }
+    memcpy(hid_tmpl.bits, bits, sizeof(bits));
+    hid_tmpl.valid = true;
+
+    if (hid_tmpl.armed == false) {
+        sim_lf_setup();
+    }
+
+    if (ledcontrol) LED_A_ON();
+    hid_tmpl.armed = sim_lf_run(hid_tmpl.start[HID_TMPL_BITS], 0, ledcontrol, numcycles);
+    if (ledcontrol) LED_A_OFF();
+}
+
 // prepare a waveform pattern in the buffer based on the ID given then
 // simulate a FSK tag until the button is pressed
 // arg1 contains fcHigh and fcLow, arg2 contains STT marker and clock
@@ -1264,6 +1338,236 @@ void CmdNRZsimTAG(uint8_t invert, uint8_t separator, uint8_t clk, uint16_t size,
     reply_ng(CMD_LF_NRZ_SIMULATE, PM3_EOPABORTED, NULL, 0);
 }
 
+// CMD_LF_SIM_STREAM,  expand a compact descriptor one field clock at a time
+typedef struct {
+    const lf_simstream_t *d;
+    uint16_t bit;           // current bit
+    uint16_t pos;           // field clock within current bit
+    uint16_t ticks;         // field clocks in current bit
+    uint8_t value;
+    uint8_t fc;
+    uint8_t half;
+    uint8_t wave;           // field clock within current FSK / PSK wave
+    uint8_t phase;          // biphase / PSK phase
+    int16_t remainder;      // FSK carry, see fcAll
+} simstream_state_t;
+
+static void simstream_start_bit(simstream_state_t *st) {
+    const lf_simstream_t *d = st->d;
+    st->value = ((d->bits[st->bit >> 3] >> (7 - (st->bit & 7))) & 1) ^ d->invert;
+    st->pos = 0;
+    st->wave = 0;
+
+    switch (d->modulation) {
+        case LF_SIMSTREAM_FSK: {
+            st->fc = st->value ? d->fchigh : d->fclow;
+            st->half = st->fc >> 1;
+            uint16_t waves = (d->clock + st->remainder) / st->fc;
+            st->remainder = (d->clock + st->remainder) % st->fc;
+            if (st->remainder > st->half) {
+                waves++;
+                st->remainder -= st->fc;
+            }
+            st->ticks = waves * st->fc;
+            break;
+        }
+        case LF_SIMSTREAM_PSK1: {
+            st->fc = d->fchigh;
+            st->half = st->fc / 2;
+            // a phase change wave is just a normal wave in the new phase
+            if (st->value != st->phase) {
+                st->phase ^= 1;
+            }
+            st->ticks = ((d->clock + st->fc - 1) / st->fc) * st->fc;
+            break;
+        }
+        default: {
+            st->half = d->clock / 2;
+            st->ticks = d->clock;
+            break;
+        }
+    }
+}
+
+static void simstream_init(simstream_state_t *st, const lf_simstream_t *d) {
+    memset(st, 0, sizeof(simstream_state_t));
+    st->d = d;
+    simstream_start_bit(st);
+}
+
+static uint8_t simstream_next(simstream_state_t *st) {
+    uint8_t out;
+
+    switch (st->d->modulation) {
+        case LF_SIMSTREAM_ASK_MAN:
+            out = (st->pos < st->half) ? st->value : st->value ^ 1;
+            break;
+        case LF_SIMSTREAM_ASK_BI:
+            if (st->value) {
+                out = (st->pos < st->half) ? st->phase : st->phase ^ 1;
+            } else {
+                out = st->phase;
+            }
+            break;
+        case LF_SIMSTREAM_FSK:
+            out = (st->wave < (st->fc - st->half)) ? 0 : 1;
+            if (++st->wave == st->fc) {
+                st->wave = 0;
+            }
+            break;
+        case LF_SIMSTREAM_PSK1:
+            out = (st->wave < st->half) ? st->phase : st->phase ^ 1;
+            if (++st->wave == st->fc) {
+                st->wave = 0;
+            }
+            break;
+        case LF_SIMSTREAM_NRZ:
+        default:
+            out = st->value;
+            break;
+    }
+
+    if (++st->pos == st->ticks) {
+        // biphase zero flips the phase for the next bit
+        if (st->d->modulation == LF_SIMSTREAM_ASK_BI && st->value == 0) {
+            st->phase ^= 1;
+        }
+        if (++st->bit == st->d->bitlen) {
+            st->bit = 0;
+        }
+        simstream_start_bit(st);
+    }
+    return out;
+}
+
+static bool simstream_valid(const lf_simstream_t *d, uint16_t len) {
+    if (len < sizeof(lf_simstream_t) || d->bitlen == 0 || d->clock == 0) {
+        return false;
+    }
+    if (len < sizeof(lf_simstream_t) + ((d->bitlen + 7) / 8)) {
+        return false;
+    }
+    if (d->modulation > LF_SIMSTREAM_PSK1) {
+        return false;
+    }
+    if (d->modulation == LF_SIMSTREAM_FSK && (d->fchigh < 2 || d->fclow < 2)) {
+        return false;
+    }
+    if (d->modulation == LF_SIMSTREAM_PSK1 && d->fchigh < 2) {
+        return false;
+    }
+    return true;
+}
+
+// new descriptor from the client swaps the credential, anything else stops the simulation
+static bool simstream_poll(lf_simstream_t *d, simstream_state_t *st) {
+    PacketCommandNG rx;
+    if (receive_ng(&rx) != PM3_SUCCESS || rx.cmd != CMD_LF_SIM_STREAM) {
+        return false;
+    }
+
+    const lf_simstream_t *incoming = (const lf_simstream_t *)rx.data.asBytes;
+    if (simstream_valid(incoming, rx.length) == false) {
+        reply_ng(CMD_LF_SIM_STREAM, PM3_EINVARG, NULL, 0);
+        return true;
+    }
+
+    memcpy(d, rx.data.asBytes, rx.length);
+    simstream_init(st, d);
+    reply_ng(CMD_LF_SIM_STREAM, PM3_SUCCESS, NULL, 0);
+    return true;
+}
+
+void SimulateTagLowFrequencyStream(const uint8_t *data, uint16_t len, bool ledcontrol) {
+
+    if (simstream_valid((const lf_simstream_t *)data, len) == false) {
+        reply_ng(CMD_LF_SIM_STREAM, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    FpgaDownloadAndGo(FPGA_BITSTREAM_LF);
+    BigBuf_free();
+    set_tracing(false);
+
+    // keep our own copy, the packet buffer gets reused by simstream_poll
+    lf_simstream_t *d = (lf_simstream_t *)BigBuf_malloc(PM3_CMD_DATA_SIZE);
+    if (d == NULL) {
+        reply_ng(CMD_LF_SIM_STREAM, PM3_EMALLOC, NULL, 0);
+        return;
+    }
+    memcpy(d, data, len);
+
+    simstream_state_t st;
+    simstream_init(&st, d);
+
+    Dbprintf("Stream simulating with rf/%d, modulation %d, fc %d/%d, invert %d, bits %d"
+             , d->clock
+             , d->modulation
+             , d->fchigh
+             , d->fclow
+             , d->invert
+             , d->bitlen
+            );
+
+    reply_ng(CMD_LF_SIM_STREAM, PM3_SUCCESS, NULL, 0);
+
+    sim_lf_setup();
+    if (ledcontrol) LED_A_ON();
+
+    uint16_t check = 0;
+    for (;;) {
+
+        // compute the next sample while the previous one is on air
+        uint8_t out = simstream_next(&st);
+
+        if (ledcontrol) LED_D_ON();
+
+        // wait until SSC_CLK goes HIGH
+        while ((AT91C_BASE_PIOA->PIO_PDSR & GPIO_SSC_CLK) == 0) {
+            WDT_HIT();
+            if (check == 1000) {
+                if (BUTTON_PRESS()) {
+                    goto OUT;
+                }
+                if (data_available() && simstream_poll(d, &st) == false) {
+                    goto OUT;
+                }
+                check = 0;
+            }
+            ++check;
+        }
+
+        if (ledcontrol) LED_D_OFF();
+
+        if (out)
+            OPEN_COIL();
+        else
+            SHORT_COIL();
+
+        check = 0;
+
+        // wait until SSC_CLK goes LOW
+        while (AT91C_BASE_PIOA->PIO_PDSR & GPIO_SSC_CLK) {
+            WDT_HIT();
+            if (check == 2000) {
+                if (BUTTON_PRESS() || data_available()) {
+                    // let the HIGH wait above handle the packet
+                    break;
+                }
+                check = 0;
+            }
+            ++check;
+        }
+    }
+
+OUT:
+    StopTicks();
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    if (ledcontrol) LEDsoff();
+    BigBuf_free();
+    reply_ng(CMD_LF_SIM_STREAM, PM3_EOPABORTED, NULL, 0);
+}
+
 // loop to get raw HID waveform then FSK demodulate the TAG ID from it
 int lf_hid_watch(int findone, uint32_t *high, uint32_t *low, bool ledcontrol) {
 
@@ -1467,13 +1771,57 @@ int lf_awid_watch(int findone, uint32_t *high, uint32_t *low, bool ledcontrol) {
     return res;
 }
 
+// ids seen lately by the em410x watch,  an id is printed again only after it was gone for the window
+#define EM410X_WATCH_RECENT 8
+
+typedef struct {
+    bool used;
+    uint32_t hi;
+    uint64_t lo;
+    uint32_t last_seen;
+} em410x_seen_t;
+
+static bool em410x_watch_is_new(em410x_seen_t *recent, uint32_t hi, uint64_t lo, uint32_t window_ms) {
+
+    uint32_t now = GetTickCount();
+    uint8_t slot = 0;
+
+    for (uint8_t i = 0; i < EM410X_WATCH_RECENT; i++) {
+
+        if (recent[i].used && recent[i].hi == hi && recent[i].lo == lo) {
+            bool is_new = ((now - recent[i].last_seen) > window_ms);
+            recent[i].last_seen = now;
+            return is_new;
+        }
+
+        // free slot, else the one seen longest ago
+        if (recent[slot].used && (recent[i].used == false || recent[i].last_seen < recent[slot].last_seen)) {
+            slot = i;
+        }
+    }
+
+    recent[slot].used = true;
+    recent[slot].hi = hi;
+    recent[slot].lo = lo;
+    recent[slot].last_seen = now;
+    return true;
+}
+
 int lf_em410x_watch(int findone, uint32_t *high, uint64_t *low, bool ledcontrol) {
+    return lf_em410x_watch_ex(findone, 0, high, low, ledcontrol);
+}
+
+// window_ms > 0,  a tag staying on the antenna is reported once instead of on every read
+int lf_em410x_watch_ex(int findone, uint32_t window_ms, uint32_t *high, uint64_t *low, bool ledcontrol) {
 
     size_t size, idx = 0;
     int clk = 0, invert = 0, maxErr = 20;
     uint32_t hi = 0;
     uint64_t lo = 0;
 
+    em410x_seen_t recent[EM410X_WATCH_RECENT];
+    memset(recent, 0, sizeof(recent));
+
     uint8_t *dest = BigBuf_get_addr();
     clear_trace();
     set_tracing(false);
@@ -1490,9 +1838,9 @@ int lf_em410x_watch(int findone, uint32_t *high, uint64_t *low, bool ledcontrol)
             break;
         }
 
-        DoAcquisition_default(-1, false, ledcontrol);
-
+        // only sample what gets demodulated,  keeps the turn around short
         size = MIN(16385, BigBuf_max_traceLen());
+        DoAcquisition(1, 8, 0, -1, false, size, 0, 0, ledcontrol);
 
         //askdemod and manchester decode
         int errCnt = askdemod(dest, &size, &clk, &invert, maxErr, 0, 1);
@@ -1501,6 +1849,10 @@ int lf_em410x_watch(int findone, uint32_t *high, uint64_t *low, bool ledcontrol)
         WDT_HIT();
 
         int type = Em410xDecode(dest, &size, &idx, &hi, &lo);
+        if (type > 0 && window_ms && em410x_watch_is_new(recent, hi, lo, window_ms) == false) {
+            type = 0;
+        }
+
         if (type > 0) {
             if (type & 0x1) {
                 Dbprintf("EM TAG ID: " _GREEN_("%02x%08x") " - ( %05d_%03d_%08d )",
@@ -1906,30 +2258,15 @@ void T55xxDangerousRawTest(const uint8_t *data, bool ledcontrol) {
     if (ledcontrol) LED_A_OFF();
 }
 
-// Write one card block in page 0, no lock
-//void T55xxWriteBlockExt(uint32_t data, uint8_t blockno, uint32_t pwd, uint8_t flags) {
-void T55xxWriteBlock(uint8_t *data, bool ledcontrol) {
-
-    /*
-    flag bits
-    xxxxxxx1 0x01 PwdMode
-    xxxxxx1x 0x02 Page
-    xxxxx1xx 0x04 testMode
-    xxx11xxx 0x18 downlink mode
-    xx1xxxxx 0x20 !reg_readmode
-    x1xxxxxx 0x40 called for a read, so no data packet
-    1xxxxxxx 0x80 reset
-    */
-
-    t55xx_write_block_t *c = (t55xx_write_block_t *)data;
-    // c->data, c->blockno, c->pwd, c->flags
+// same as T55xxWriteBlock, without the reply
+static void T55xxWriteBlockRaw(uint32_t data, uint8_t blockno, uint32_t pwd, uint8_t flags, bool ledcontrol) {
 
-    bool testMode = ((c->flags & 0x04) == 0x04);
+    bool testMode = ((flags & 0x04) == 0x04);
 
-    c->flags &= (0xff ^ 0x40); // Called for a write, so ensure it is clear/0
+    flags &= (0xff ^ 0x40); // Called for a write, so ensure it is clear/0
 
     if (ledcontrol) LED_A_ON();
-    T55xx_SendCMD(c->data, c->pwd, c->flags | (c->blockno << 9));
+    T55xx_SendCMD(data, pwd, flags | (blockno << 9));
 
     // Perform write (nominal is 5.6 ms for T55x7 and 18ms for E5550,
     // so wait a little more)
@@ -1960,6 +2297,27 @@ void T55xxWriteBlock(uint8_t *data, bool ledcontrol) {
     }
     // turn field off
     FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+}
+
+// Write one card block in page 0, no lock
+//void T55xxWriteBlockExt(uint32_t data, uint8_t blockno, uint32_t pwd, uint8_t flags) {
+void T55xxWriteBlock(uint8_t *data, bool ledcontrol) {
+
+    /*
+    flag bits
+    xxxxxxx1 0x01 PwdMode
+    xxxxxx1x 0x02 Page
+    xxxxx1xx 0x04 testMode
+    xxx11xxx 0x18 downlink mode
+    xx1xxxxx 0x20 !reg_readmode
+    x1xxxxxx 0x40 called for a read, so no data packet
+    1xxxxxxx 0x80 reset
+    */
+
+    t55xx_write_block_t *c = (t55xx_write_block_t *)data;
+    // c->data, c->blockno, c->pwd, c->flags
+
+    T55xxWriteBlockRaw(c->data, c->blockno, c->pwd, c->flags, ledcontrol);
 
     reply_ng(CMD_LF_T55XX_WRITEBL, PM3_SUCCESS, NULL, 0);
     if (ledcontrol) LED_A_OFF();
@@ -2027,24 +2385,8 @@ bool brute_mem = (flags & 0x0100) >> 8;
     }
 }
 */
-// Read one card block in page [page]
-void T55xxReadBlock(uint8_t page, bool pwd_mode, bool brute_mem, uint8_t block, uint32_t pwd, uint8_t downlink_mode, bool ledcontrol) {
-    /*
-    flag bits
-    xxxx xxxxxxx1 0x0001 PwdMode
-    xxxx xxxxxx1x 0x0002 Page
-    xxxx xxxxx1xx 0x0004 testMode
-    xxxx xxx11xxx 0x0018 downlink mode
-    xxxx xx1xxxxx 0x0020 !reg_readmode
-    xxxx x1xxxxxx 0x0040 called for a read, so no data packet
-    xxxx 1xxxxxxx 0x0080 reset
-    xxx1 xxxxxxxx 0x0100 brute / leave field on
-    */
-    uint16_t flags        = 0x0040; // read packet
-    if (pwd_mode)  flags |= 0x0001;
-    if (page)      flags |= 0x0002;
-    flags                |= (downlink_mode & 3) << 3;
-    if (brute_mem) flags |= 0x0100;
+// sends the read command and samples the answer into BigBuf, leaves the field on
+static void T55xxReadBlockRaw(uint16_t flags, uint8_t block, uint32_t pwd, size_t samples, bool ledcontrol) {
 
     sample_config old_config;
     sample_config *curr_config = getSamplingConfig();
@@ -2053,12 +2395,8 @@ void T55xxReadBlock(uint8_t page, bool pwd_mode, bool brute_mem, uint8_t block,
 
     setDefaultSamplingConfig();
 
-    size_t samples = 12000;
-
     if (ledcontrol) LED_A_ON();
 
-    if (brute_mem) samples = 2048;
-
     //-- Set Read Flag to ensure SendCMD does not add "data" to the packet
     //-- flags |= 0x40;
 
@@ -2084,21 +2422,80 @@ void T55xxReadBlock(uint8_t page, bool pwd_mode, bool brute_mem, uint8_t block,
     // Now do the acquisition
     DoPartialAcquisition(0, false, samples, 1000, ledcontrol);
 
+    // reset back to old / save config
+    setSamplingConfig(&old_config);
+}
+
+// Read one card block in page [page]
+void T55xxReadBlock(uint8_t page, bool pwd_mode, bool brute_mem, uint8_t block, uint32_t pwd, uint8_t downlink_mode, bool ledcontrol) {
+    /*
+    flag bits
+    xxxx xxxxxxx1 0x0001 PwdMode
+    xxxx xxxxxx1x 0x0002 Page
+    xxxx xxxxx1xx 0x0004 testMode
+    xxxx xxx11xxx 0x0018 downlink mode
+    xxxx xx1xxxxx 0x0020 !reg_readmode
+    xxxx x1xxxxxx 0x0040 called for a read, so no data packet
+    xxxx 1xxxxxxx 0x0080 reset
+    xxx1 xxxxxxxx 0x0100 brute / leave field on
+    */
+    uint16_t flags        = 0x0040; // read packet
+    if (pwd_mode)  flags |= 0x0001;
+    if (page)      flags |= 0x0002;
+    flags                |= (downlink_mode & 3) << 3;
+    if (brute_mem) flags |= 0x0100;
+
+    T55xxReadBlockRaw(flags, block, pwd, (brute_mem) ? 2048 : 12000, ledcontrol);
+
     // Turn the field off
     if (brute_mem == false) {
         FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
         reply_ng(CMD_LF_T55XX_READBL, PM3_SUCCESS, NULL, 0);
         if (ledcontrol) LED_A_OFF();
     }
-
-    // reset back to old / save config
-    setSamplingConfig(&old_config);
 }
 
 
-void T55xx_ChkPwds(uint8_t flags, bool ledcontrol) {
 
 #define CHK_SAMPLES_SIGNAL 2048
+#define CHK_BASELINE_READS 32
+
+// signal energy of a block 0 read, a valid password changes what the tag sends back
+static uint64_t T55xx_ChkSignal(bool pwd_mode, uint32_t pwd, uint8_t downlink_mode, bool ledcontrol) {
+    uint8_t *buf = BigBuf_get_addr();
+    T55xxReadBlock(0, pwd_mode, true, 0, pwd, downlink_mode, ledcontrol);
+
+    uint64_t sum = 0;
+    for (uint16_t j = 0; j < CHK_SAMPLES_SIGNAL; ++j) {
+        sum += (buf[j] * buf[j]);
+    }
+    sum *= sum;
+    sum >>= 8;
+    return sum;
+}
+
+// collect baseline for failed attempt  ( should give me block1 )
+// noise gets the largest deviation seen over the baseline reads
+static uint64_t T55xx_ChkBaseline(uint8_t downlink_mode, uint64_t *noise, bool ledcontrol) {
+    uint64_t reads[CHK_BASELINE_READS];
+    uint64_t baseline = 0;
+    for (uint8_t i = 0; i < CHK_BASELINE_READS; i++) {
+        reads[i] = T55xx_ChkSignal(false, 0, downlink_mode, ledcontrol);
+        baseline += reads[i];
+    }
+    baseline /= CHK_BASELINE_READS;
+
+    if (noise) {
+        *noise = 0;
+        for (uint8_t i = 0; i < CHK_BASELINE_READS; i++) {
+            int64_t d = (int64_t)(reads[i] - baseline);
+            *noise = MAX(*noise, (uint64_t)ABS(d));
+        }
+    }
+    return baseline;
+}
+
+void T55xx_ChkPwds(uint8_t flags, bool ledcontrol) {
 
 #ifdef WITH_FLASH
     DbpString(_CYAN_("T55XX Check pwds using flashmemory starting"));
@@ -2107,25 +2504,11 @@ void T55xx_ChkPwds(uint8_t flags, bool ledcontrol) {
 #endif
 
     // First get baseline and setup LF mode.
-    uint8_t *buf = BigBuf_get_addr();
     uint8_t downlink_mode = (flags >> 3) & 0x03;
-    uint64_t b1, baseline_faulty = 0;
 
     DbpString("Determine baseline...");
 
-    // collect baseline for failed attempt  ( should give me block1 )
-    uint8_t x = 32;
-    while (x--) {
-        b1 = 0;
-        T55xxReadBlock(0, 0, true, 0, 0, downlink_mode, ledcontrol);
-        for (uint16_t j = 0; j < CHK_SAMPLES_SIGNAL; ++j) {
-            b1 += (buf[j] * buf[j]);
-        }
-        b1 *= b1;
-        b1 >>= 8;
-        baseline_faulty += b1;
-    }
-    baseline_faulty >>= 5;
+    uint64_t baseline_faulty = T55xx_ChkBaseline(downlink_mode, NULL, ledcontrol);
 
     if (g_dbglevel >= DBG_DEBUG)
         Dbprintf("Baseline " _YELLOW_("%llu"), baseline_faulty);
@@ -2177,14 +2560,7 @@ void T55xx_ChkPwds(uint8_t flags, bool ledcontrol) {
 
         uint32_t pwd = bytes_to_num(pwds + (i * 4), 4);
 
-        T55xxReadBlock(0, true, true, 0, pwd, downlink_mode, ledcontrol);
-
-        uint64_t sum = 0;
-        for (uint16_t j = 0; j < CHK_SAMPLES_SIGNAL; ++j) {
-            sum += (buf[j] * buf[j]);
-        }
-        sum *= sum;
-        sum >>= 8;
+        uint64_t sum = T55xx_ChkSignal(true, pwd, downlink_mode, ledcontrol);
 
         int64_t tmp_dist = (baseline_faulty - sum);
         curr = ABS(tmp_dist);
@@ -2213,6 +2589,62 @@ OUT:
     BigBuf_free();
 }
 
+// Scans a password range on device, no samples leave the device.
+// Stops at the first password whose signal stands out of the baseline noise, the client verifies it.
+void T55xx_BrutePwds(const t55xx_bruteforce_t *c, bool ledcontrol) {
+
+    uint8_t downlink_mode = (c->flags >> 3) & 0x03;
+
+    t55xx_bruteforce_resp_t payload = {
+        .found = false,
+        .candidate = c->start,
+        .baseline = c->baseline,
+        .threshold = c->threshold,
+    };
+
+    if (payload.baseline == 0) {
+        uint64_t noise = 0;
+        payload.baseline = T55xx_ChkBaseline(downlink_mode, &noise, ledcontrol);
+        payload.threshold = MAX(noise * 2, 1);
+
+        if (g_dbglevel >= DBG_DEBUG)
+            Dbprintf("Baseline " _YELLOW_("%llu") " threshold " _YELLOW_("%llu"), payload.baseline, payload.threshold);
+    }
+
+    int res = PM3_SUCCESS;
+    for (uint32_t pwd = c->start; ; pwd++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        WDT_HIT();
+
+        payload.candidate = pwd;
+
+        uint64_t sum = T55xx_ChkSignal(true, pwd, downlink_mode, ledcontrol);
+        int64_t tmp_dist = (payload.baseline - sum);
+        uint64_t curr = ABS(tmp_dist);
+
+        if (g_dbglevel >= DBG_DEBUG)
+            Dbprintf("%08x has distance " _YELLOW_("%llu"), pwd, curr);
+
+        if (curr > payload.threshold) {
+            payload.found = true;
+            break;
+        }
+
+        if (pwd == c->end)
+            break;
+    }
+
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    if (ledcontrol) LEDsoff();
+    reply_ng(CMD_LF_T55XX_CHK_PWDS, res, (uint8_t *)&payload, sizeof(payload));
+    BigBuf_free();
+}
+
 void T55xxWakeUp(uint32_t pwd, uint8_t flags, bool ledcontrol) {
 
     flags |= 0x01 | 0x40 | 0x20; //Password | Read Call (no data) | reg_read no block
@@ -2252,6 +2684,119 @@ static void WriteT55xx(const uint32_t *blockdata, uint8_t startblock, uint8_t nu
     }
 }
 
+// Demodulates a block read sampled into BigBuf the way the configuration block describes
+// and looks for the expected data, either polarity. Extended mode, PSK2/3 and anything the
+// samples don't give up are left unverified.
+static bool T55xxVerifySamples(uint32_t block0, uint32_t want, size_t size) {
+
+    static const uint8_t bitrates[] = {8, 16, 32, 40, 50, 64, 100, 128};
+
+    uint8_t safer = block0 >> 28;
+    if ((block0 & T55x7_X_MODE) && (safer == 6 || safer == 9))
+        return false;
+
+    uint8_t *bits = BigBuf_get_addr();
+    int clk = bitrates[(block0 & T55x7_BITRATE_RF_128) >> 18];
+    int invert = 0;
+    int start = 0;
+    int res = -1;
+
+    switch (block0 & 0x0001F000) {
+        case T55x7_MODULATION_MANCHESTER:
+            res = askdemod(bits, &size, &clk, &invert, 50, 0, 1);
+            break;
+        case T55x7_MODULATION_BIPHASE:
+        case T55x7_MODULATION_DIPHASE:
+            res = askdemod(bits, &size, &clk, &invert, 50, 0, 0);
+            if (res >= 0) {
+                res = BiphaseRawDecode(bits, &size, &start, ((block0 & 0x0001F000) == T55x7_MODULATION_DIPHASE));
+            }
+            break;
+        case T55x7_MODULATION_FSK1:
+        case T55x7_MODULATION_FSK1a:
+            invert = ((block0 & 0x0001F000) == T55x7_MODULATION_FSK1);
+            size = fskdemod(bits, size, clk, invert, 8, 5, &start);
+            res = (size > 0) ? 0 : -1;
+            break;
+        case T55x7_MODULATION_FSK2:
+        case T55x7_MODULATION_FSK2a:
+            invert = ((block0 & 0x0001F000) == T55x7_MODULATION_FSK2a);
+            size = fskdemod(bits, size, clk, invert, 10, 8, &start);
+            res = (size > 0) ? 0 : -1;
+            break;
+        case T55x7_MODULATION_PSK1:
+            res = pskRawDemod(bits, &size, &clk, &invert);
+            break;
+        case T55x7_MODULATION_DIRECT:
+            res = nrzRawDemod(bits, &size, &clk, &invert, &start);
+            break;
+        default:
+            return false;
+    }
+
+    if (res < 0 || size < 64)
+        return false;
+
+    for (size_t i = 0; i + 32 <= size; i++) {
+        uint32_t got = bytebits_to_byte(bits + i, 32);
+        if (got == want || got == ~want)
+            return true;
+    }
+    return false;
+}
+
+// Writes a set of page 0 blocks, then reads each one back and verifies it on device.
+// Blocks are written in reverse order like WriteT55xx, block 0 last.
+void T55xxWriteBatch(const t55xx_write_batch_t *c, bool ledcontrol) {
+
+    if (c->numblocks == 0 || (c->startblock + c->numblocks) > 8) {
+        reply_ng(CMD_LF_T55XX_WRITE_BATCH, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    uint8_t flags = c->flags & 0x19;
+
+    for (uint8_t i = c->numblocks; i > 0; i--) {
+        WDT_HIT();
+        T55xxWriteBlockRaw(c->data[i - 1], c->startblock + i - 1, c->pwd, flags, ledcontrol);
+    }
+
+    // the configuration just written decides if the reads need a password, and which one
+    bool pwd_mode = (flags & 0x01);
+    uint32_t pwd = c->pwd;
+    if (c->startblock == 0) {
+        pwd_mode = (c->data[0] & T55x7_PWD);
+    }
+    if (pwd_mode && (c->startblock + c->numblocks) == 8) {
+        pwd = c->data[7 - c->startblock];
+    }
+
+    uint16_t rflags = 0x0040 | (flags & 0x18) | (pwd_mode ? 0x01 : 0x00);
+    uint8_t verified = 0;
+    int res = PM3_SUCCESS;
+
+    for (uint8_t i = 0; i < c->numblocks; i++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        WDT_HIT();
+
+        T55xxReadBlockRaw(rflags, c->startblock + i, pwd, 12000, ledcontrol);
+        FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+
+        if (T55xxVerifySamples(c->config, c->data[i], 12000)) {
+            verified |= (1 << i);
+        }
+    }
+
+    if (ledcontrol) LEDsoff();
+    reply_ng(CMD_LF_T55XX_WRITE_BATCH, res, &verified, sizeof(verified));
+    BigBuf_free();
+}
+
 static void WriteEM4x05(uint32_t *blockdata, uint8_t startblock, uint8_t numblocks, bool ledcontrol) {
     if (g_dbglevel == DBG_DEBUG) {
         Dbprintf("# | data ( EM4x05 )");
@@ -2629,6 +3174,21 @@ static void EM4xLoginEx(uint32_t pwd) {
     // 0000 0001 fail
 }
 
+// Sends a login and looks for the answer in the sampled signal, can give false positives
+static bool EM4xLoginProbe(uint32_t pwd, bool ledcontrol) {
+    clear_trace();
+
+    forward_ptr = forwardLink_data;
+    uint8_t len = Prepare_Cmd(FWD_CMD_LOGIN);
+    len += Prepare_Data(pwd & 0xFFFF, pwd >> 16);
+    SendForward(len, true);
+
+    WaitUS(400);
+    DoPartialAcquisition(0, false, 350, 1000, ledcontrol);
+    uint8_t *mem = BigBuf_get_addr();
+    return (mem[334] < 128);
+}
+
 void EM4xBruteforce(uint32_t start_pwd, uint32_t n, bool ledcontrol) {
     // With current timing, 18.6 ms per test = 53.8 pwds/s
     reply_ng(CMD_LF_EM4X_BF, PM3_SUCCESS, NULL, 0);
@@ -2650,17 +3210,7 @@ void EM4xBruteforce(uint32_t start_pwd, uint32_t n, bool ledcontrol) {
         if (((pwd - start_pwd) & 0xFF) == 0x00) {
             Dbprintf("Trying: %06Xxx", pwd >> 8);
         }
-        clear_trace();
-
-        forward_ptr = forwardLink_data;
-        uint8_t len = Prepare_Cmd(FWD_CMD_LOGIN);
-        len += Prepare_Data(pwd & 0xFFFF, pwd >> 16);
-        SendForward(len, true);
-
-        WaitUS(400);
-        DoPartialAcquisition(0, false, 350, 1000, ledcontrol);
-        uint8_t *mem = BigBuf_get_addr();
-        if (mem[334] < 128) {
+        if (EM4xLoginProbe(pwd, ledcontrol)) {
             candidates_found++;
             Dbprintf("Password candidate: " _GREEN_("%08X"), pwd);
             if ((n != 0) && (candidates_found == n)) {
@@ -2676,6 +3226,60 @@ void EM4xBruteforce(uint32_t start_pwd, uint32_t n, bool ledcontrol) {
     if (ledcontrol) LEDsoff();
 }
 
+// Tests a password range or a dictionary chunk. A progress reply with done == false is sent
+// every 64 tests, the final reply holds the candidates and the position to resume from.
+void EM4xPwdSearch(const em4x05_pwdsearch_t *c, bool ledcontrol) {
+
+    em4x05_pwdsearch_resp_t resp = {0};
+    resp.pos = c->pos;
+
+    if (c->mode > EM4X05_PWDSEARCH_DICT || (c->mode == EM4X05_PWDSEARCH_DICT && c->count > EM4X05_PWDSEARCH_MAX_DICT)) {
+        resp.done = true;
+        reply_ng(CMD_LF_EM4X_PWD_SEARCH, PM3_EINVARG, (uint8_t *)&resp, sizeof(resp));
+        return;
+    }
+
+    StartTicks();
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    WaitMS(20);
+    if (ledcontrol) LED_A_ON();
+    LFSetupFPGAForADC(LF_DIVISOR_125, true);
+
+    int status = PM3_SUCCESS;
+    for (uint32_t i = 0; i < c->count; i++) {
+
+        if ((i & 0x3F) == 0x00) {
+            WDT_HIT();
+            if (BUTTON_PRESS() || data_available()) {
+                status = PM3_EOPABORTED;
+                break;
+            }
+            if (i) {
+                reply_ng(CMD_LF_EM4X_PWD_SEARCH, PM3_SUCCESS, (uint8_t *)&resp, sizeof(resp));
+            }
+        }
+
+        uint32_t pwd = (c->mode == EM4X05_PWDSEARCH_DICT) ? c->pwds[i] : c->start_pwd + i;
+        bool hit = EM4xLoginProbe(pwd, ledcontrol);
+        resp.pos++;
+
+        if (hit) {
+            resp.candidates[resp.found++] = pwd;
+            if (resp.found == EM4X05_PWDSEARCH_MAX_CANDIDATES || ((c->n != 0) && (resp.found == c->n))) {
+                break;
+            }
+        }
+        // Beware: if smaller, tag might not have time to be back in listening state yet
+        WaitMS(1);
+    }
+
+    StopTicks();
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    resp.done = true;
+    reply_ng(CMD_LF_EM4X_PWD_SEARCH, status, (uint8_t *)&resp, sizeof(resp));
+    if (ledcontrol) LEDsoff();
+}
+
 void EM4xLogin(uint32_t pwd, bool ledcontrol) {
 
     StartTicks();
@@ -36,6 +36,8 @@ void SimulateTagLowFrequencyBidir(int divisor, int max_bitlen);
 
 void CmdHIDsimTAGEx(uint32_t hi2, uint32_t hi, uint32_t lo, uint8_t longFMT, bool ledcontrol, int numcycles);
 void CmdHIDsimTAG(uint32_t hi2, uint32_t hi, uint32_t lo, uint8_t longFMT, bool ledcontrol);
+void CmdHIDsimTAGReset(void);
+void CmdHIDsimTAGFast(uint32_t hi, uint32_t lo, bool ledcontrol, int numcycles);
 
 void CmdFSKsimTAGEx(uint8_t fchigh, uint8_t fclow, uint8_t separator, uint8_t clk, uint16_t bitslen,
                     const uint8_t *bits, bool ledcontrol, int numcycles);
@@ -47,10 +49,12 @@ void CmdPSKsimTAG(uint8_t carrier, uint8_t invert, uint8_t clk, uint16_t size,
                   const uint8_t *bits, bool ledcontrol);
 void CmdNRZsimTAG(uint8_t invert, uint8_t separator, uint8_t clk, uint16_t size,
                   const uint8_t *bits, bool ledcontrol);
+void SimulateTagLowFrequencyStream(const uint8_t *data, uint16_t len, bool ledcontrol);
 
 int lf_hid_watch(int findone, uint32_t *high, uint32_t *low, bool ledcontrol);
 int lf_awid_watch(int findone, uint32_t *high, uint32_t *low, bool ledcontrol); // Realtime demodulation mode for AWID26
 int lf_em410x_watch(int findone, uint32_t *high, uint64_t *low, bool ledcontrol);
+int lf_em410x_watch_ex(int findone, uint32_t window_ms, uint32_t *high, uint64_t *low, bool ledcontrol);
 int lf_io_watch(int findone, uint32_t *high, uint32_t *low, bool ledcontrol);
 
 void CopyHIDtoT55x7(uint32_t hi2, uint32_t hi, uint32_t lo, uint8_t longFMT, bool q5, bool em, bool ledcontrol); // Clone an HID card to T5557/T5567
@@ -66,6 +70,8 @@ void T55xxReadBlock(uint8_t page, bool pwd_mode, bool brute_mem, uint8_t block,
                     uint8_t downlink_mode, bool ledcontrol);
 void T55xxWakeUp(uint32_t pwd, uint8_t flags, bool ledcontrol);
 void T55xx_ChkPwds(uint8_t flags, bool ledcontrol);
+void T55xx_BrutePwds(const t55xx_bruteforce_t *c, bool ledcontrol);
+void T55xxWriteBatch(const t55xx_write_batch_t *c, bool ledcontrol);
 void T55xxDangerousRawTest(const uint8_t *data, bool ledcontrol);
 
 void turn_read_lf_on(uint32_t delay);
@@ -73,6 +79,7 @@ void turn_read_lf_off(uint32_t delay);
 
 void EM4xLogin(uint32_t pwd, bool ledcontrol);
 void EM4xBruteforce(uint32_t start_pwd, uint32_t n, bool ledcontrol);
+void EM4xPwdSearch(const em4x05_pwdsearch_t *c, bool ledcontrol);
 void EM4xReadWord(uint8_t addr, uint32_t pwd, uint8_t usepwd, bool ledcontrol);
 void EM4xWriteWord(uint8_t addr, uint32_t data, uint32_t pwd, uint8_t usepwd, bool ledcontrol);
 void EM4xProtectWord(uint32_t data, uint32_t pwd, uint8_t usepwd, bool ledcontrol);
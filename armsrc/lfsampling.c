@@ -422,6 +422,160 @@ uint32_t DoPartialAcquisition(int trigger_threshold, bool verbose, uint32_t samp
                          , ledcontrol);  // samples to skip
 }
 
+/**
+ * Windowed acquisition. Only the samples around modulation bursts are stored,  so sparse tag
+ * responses don't fill BigBuf with silence. Each window is a lf_window_hdr_t followed by its samples.
+ * Bursts are detected on every raw sample,  the config decimation / averaging applies to the stored ones.
+ * @param p - capture parameters
+ * @param res - BigBuf bytes used,  number of windows and the covered span
+ * @return PM3_SUCCESS,  PM3_EOPABORTED if stopped by button or a new command
+ */
+int ReadLF_windowed(const lf_window_payload_t *p, lf_window_result_t *res, bool ledcontrol) {
+
+    memset(res, 0, sizeof(lf_window_result_t));
+
+    const uint16_t pre = MIN(p->pre, LF_WINDOW_MAX_PRE);
+    const uint16_t hold = MAX(p->hold, 1);
+    const uint8_t threshold = MAX(p->threshold, 1);
+    const uint8_t decimation = MAX(config.decimation, 1);
+    const bool avg = config.averaging;
+
+    BigBuf_Clear_ext(false);
+    BigBuf_free_keep_EM();
+    uint8_t *dest = BigBuf_get_addr();
+    uint32_t bufsize = BigBuf_max_traceLen();
+
+    if (p->verbose) {
+        printLFConfig();
+    }
+
+    LFSetupFPGAForADC(config.divisor, p->reader_field);
+
+    // the last samples before a burst
+    uint8_t ring[LF_WINDOW_MAX_PRE];
+    uint16_t ring_pos = 0, ring_fill = 0;
+
+    lf_window_hdr_t hdr = {0};
+    uint32_t hdr_off = 0;
+    bool in_window = false;
+    uint16_t quiet = 0;
+
+    uint32_t seen = 0, stamp = 0, pos = 0, sum = 0;
+    uint8_t dec_counter = 0;
+    bool burst = false;
+    uint16_t checked = 0;
+    int status = PM3_SUCCESS;
+
+    while (true) {
+
+        if (checked == 4000) {
+            if (BUTTON_PRESS() || data_available()) {
+                status = PM3_EOPABORTED;
+                break;
+            }
+            checked = 0;
+        }
+        ++checked;
+
+        WDT_HIT();
+
+        if (ledcontrol && (AT91C_BASE_SSC->SSC_SR & AT91C_SSC_TXRDY)) {
+            LED_D_ON();
+        }
+
+        if ((AT91C_BASE_SSC->SSC_SR & AT91C_SSC_RXRDY) == 0) {
+            continue;
+        }
+
+        uint8_t sample = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
+        if (ledcontrol) LED_D_OFF();
+
+        seen++;
+        if (ABS((int)sample - 128) >= threshold) {
+            burst = true;
+        }
+
+        sum += sample;
+        if (++dec_counter < decimation) {
+            if (p->samples && seen >= p->samples) break;
+            continue;
+        }
+        if (avg && decimation > 1) {
+            sample = sum / decimation;
+        }
+        sum = 0;
+        dec_counter = 0;
+
+        if (in_window == false) {
+            if (burst == false) {
+                if (pre) {
+                    ring[ring_pos] = sample;
+                    ring_pos = (ring_pos + 1) % pre;
+                    if (ring_fill < pre) {
+                        ring_fill++;
+                    }
+                }
+            } else if (pos + sizeof(lf_window_hdr_t) + ring_fill + 1 > bufsize) {
+                // no room for another window
+                break;
+            } else {
+                hdr.start = stamp - ring_fill;
+                hdr.len = ring_fill;
+                hdr_off = pos;
+                pos += sizeof(lf_window_hdr_t);
+
+                // oldest first,  the ring only wrapped once it is full
+                uint16_t idx = (ring_fill < pre) ? 0 : ring_pos;
+                for (uint16_t i = 0; i < ring_fill; i++) {
+                    dest[pos++] = ring[idx];
+                    idx = (idx + 1) % pre;
+                }
+                ring_fill = 0;
+                ring_pos = 0;
+                quiet = 0;
+                in_window = true;
+            }
+        }
+
+        if (in_window) {
+            dest[pos++] = sample;
+            hdr.len++;
+            quiet = (burst) ? 0 : quiet + 1;
+
+            if (quiet >= hold || hdr.len == UINT16_MAX || pos >= bufsize) {
+                memcpy(dest + hdr_off, &hdr, sizeof(lf_window_hdr_t));
+                res->windows++;
+                in_window = false;
+                if (pos >= bufsize) {
+                    break;
+                }
+            }
+        }
+
+        burst = false;
+        stamp++;
+
+        if (p->samples && seen >= p->samples) break;
+    }
+
+    if (in_window) {
+        memcpy(dest + hdr_off, &hdr, sizeof(lf_window_hdr_t));
+        res->windows++;
+    }
+
+    StopTicks();
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    if (ledcontrol) LED_D_OFF();
+
+    res->bytes = pos;
+    res->span = stamp;
+
+    if (p->verbose) {
+        Dbprintf("Done, " _YELLOW_("%u") " windows in " _YELLOW_("%u") " bytes, covering " _YELLOW_("%u") " samples", res->windows, res->bytes, res->span);
+    }
+    return status;
+}
+
 static uint32_t ReadLF(bool reader_field, bool verbose, uint32_t sample_size, bool ledcontrol) {
     if (verbose)
         printLFConfig();
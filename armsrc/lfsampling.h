@@ -61,6 +61,16 @@ uint32_t SampleLF(bool verbose, uint32_t sample_size, bool ledcontrol);
 **/
 int ReadLF_realtime(bool reader_field);
 
+// samples kept ahead of a burst by the windowed acquisition,  at most
+#define LF_WINDOW_MAX_PRE 256
+
+/**
+ * Windowed acquisition,  only the samples around modulation bursts are stored.
+ * BigBuf holds lf_window_hdr_t + samples,  back to back
+ * @return PM3_SUCCESS,  PM3_EOPABORTED if stopped by button or a new command
+**/
+int ReadLF_windowed(const lf_window_payload_t *p, lf_window_result_t *res, bool ledcontrol);
+
 /**
 * Initializes the FPGA for sniff-mode (field off), and acquires the samples.
 * @return number of bits sampled
@@ -37,6 +37,8 @@
 #include "usb_cdc.h"  // usb_poll_validate_length
 #include "spiffs.h"   // spiffs
 #include "appmain.h"  // print_stack_usage
+#include "rfretry.h"  // rf_retry_next
+#include "bruteforce.h"
 
 #ifndef HARDNESTED_AUTHENTICATION_TIMEOUT
 # define HARDNESTED_AUTHENTICATION_TIMEOUT  848     // card times out 1ms after wrong authentication (according to NXP documentation)
@@ -249,6 +251,161 @@ void MifareReadSector(uint8_t sector_no, uint8_t key_type, uint8_t *key) {
     reply_old(CMD_ACK, retval == PM3_SUCCESS, 0, 0, outbuf, 16 * num_blocks);
 }
 
+// C1C2C3 of a sector's data area (0..2) or trailer (3), taken from the sector trailer
+static uint8_t mf_trailer_rights(const uint8_t *trailer, uint8_t area) {
+    return (((trailer[7] >> (4 + area)) & 1) << 2) | (((trailer[8] >> area) & 1) << 1) | ((trailer[8] >> (4 + area)) & 1);
+}
+
+static uint8_t mf_readcard_count(const uint8_t *readmask, uint8_t first, uint8_t num_blocks) {
+    uint8_t n = 0;
+    for (uint16_t blk = first; blk < first + num_blocks; blk++) {
+        n += ((readmask[blk / 8] >> (blk % 8)) & 1);
+    }
+    return n;
+}
+
+// One select + auth, then read every block of the sector this key may read.
+// The trailer goes first, its access bits tell which data blocks to skip.
+// Returns true if the key authenticated.
+static bool mf_readcard_sector(uint8_t sector_no, uint8_t key_type, uint8_t *key, uint8_t *rights, uint8_t *image, uint8_t *readmask) {
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs = &mpcs;
+    uint32_t cuid = 0;
+
+    uint8_t first = FirstBlockOfSector(sector_no);
+    uint8_t num_blocks = NumBlocksPerSector(sector_no);
+
+    if (iso14443a_select_cardEx(NULL, NULL, &cuid, true, 0, true, &WUPA_POLLING_PARAMETERS) == 0) {
+        return false;
+    }
+
+    if (mifare_classic_authex_cmd(pcs, cuid, first, MIFARE_AUTH_KEYA + (key_type & 1), bytes_to_num(key, 6), AUTH_FIRST, NULL, NULL, NULL)) {
+        crypto1_deinit(pcs);
+        return false;
+    }
+
+    bool session_ok = true;
+    for (uint8_t i = 0; i < num_blocks; i++) {
+        uint8_t b = (i == 0) ? num_blocks - 1 : i - 1;
+        uint8_t blk = first + b;
+
+        if (readmask[blk / 8] & (1 << (blk % 8))) {
+            continue;
+        }
+
+        if (b != num_blocks - 1) {
+            uint8_t r = rights[(sector_no < 32) ? b : b / 5];
+            // never readable / key B only
+            if (r == 0x07 || (key_type == MF_KEY_A && (r == 0x03 || r == 0x05))) {
+                continue;
+            }
+        }
+
+        // a NACK ends the crypto session, leave the rest to the next pass
+        if (mifare_classic_readblock(pcs, blk, image + (blk * 16))) {
+            session_ok = false;
+            break;
+        }
+
+        readmask[blk / 8] |= (1 << (blk % 8));
+
+        if (b == num_blocks - 1) {
+            for (uint8_t area = 0; area < 4; area++) {
+                rights[area] = mf_trailer_rights(image + (blk * 16), area);
+            }
+        }
+    }
+
+    if (session_ok) {
+        mifare_classic_halt(pcs);
+    }
+    crypto1_deinit(pcs);
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Read a whole MIFARE Classic card with a key table.
+// Every sector is read with one authentication per key, key A first, and
+// key B for whatever is left.  The field is set up once for the whole card.
+//-----------------------------------------------------------------------------
+void MifareReadCard(uint8_t *datain) {
+    mfc_readcard_t *payload = (mfc_readcard_t *)datain;
+    mfc_readcard_reply_t reply;
+    memset(&reply, 0, sizeof(reply));
+
+    uint8_t sectorcnt = MIN(payload->sectorcnt, ARRAYLEN(reply.authok));
+
+    LEDsoff();
+    LED_A_ON();
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+    clear_trace();
+    set_tracing(true);
+
+    uint8_t *image = BigBuf_calloc(CARD_MEMORY_SIZE);
+    if (image == NULL) {
+        reply_ng(CMD_HF_MIFARE_READCARD, PM3_EMALLOC, NULL, 0);
+        goto OUT;
+    }
+
+    uint32_t timeout = iso14a_get_timeout();
+
+    // frame waiting time (FWT) in 1/fc
+    uint32_t fwt = 256 * 16 * (1 << 7);
+    iso14a_set_timeout(fwt / (8 * 16));
+
+    int res = PM3_SUCCESS;
+    for (uint8_t s = 0; s < sectorcnt; s++) {
+
+        if (BUTTON_PRESS() || data_available()) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        WDT_HIT();
+
+        // without a readable trailer, assume transport configuration
+        uint8_t rights[4] = {0x00, 0x00, 0x00, 0x01};
+        uint8_t first = FirstBlockOfSector(s);
+        uint8_t num_blocks = NumBlocksPerSector(s);
+
+        for (uint8_t tries = 0; tries < 3; tries++) {
+            uint8_t before = mf_readcard_count(reply.readmask, first, num_blocks);
+
+            bool auth = false;
+            for (uint8_t kt = MF_KEY_A; kt <= MF_KEY_B; kt++) {
+                if (mf_readcard_count(reply.readmask, first, num_blocks) == num_blocks) {
+                    break;
+                }
+                if (mf_readcard_sector(s, kt, payload->keys[kt][s], rights, image, reply.readmask)) {
+                    reply.authok[s] |= (1 << kt);
+                    auth = true;
+                }
+            }
+
+            uint8_t after = mf_readcard_count(reply.readmask, first, num_blocks);
+            reply.blocks += (after - before);
+
+            // all done, or the card answered and denies the rest
+            if (after == num_blocks || (auth && after == before)) {
+                break;
+            }
+        }
+    }
+
+    iso14a_set_timeout(timeout);
+
+    reply.offset = image - BigBuf_get_addr();
+    reply_ng(CMD_HF_MIFARE_READCARD, res, (uint8_t *)&reply, sizeof(reply));
+
+OUT:
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    set_tracing(false);
+}
+
 void MifareUC_Auth(uint8_t arg0, uint8_t *keybytes) {
 
     bool turnOffField = (arg0 == 1);
@@ -373,11 +530,41 @@ void MifareUReadBlock(uint8_t arg0, uint8_t arg1, uint8_t *datain) {
     LEDsoff();
 }
 
-// arg0 = blockNo (start)
+static bool mifare_ultra_select_auth(bool useKey, bool usePwd, uint8_t *datain) {
+    int len = iso14443a_select_card(NULL, NULL, NULL, true, 0, true);
+    if (!len) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't select card (RC:%d)", len);
+        return false;
+    }
+
+    // UL-C authentication
+    if (useKey) {
+        uint8_t key[16] = {0x00};
+        memcpy(key, datain, sizeof(key));
+
+        if (!mifare_ultra_auth(key)) {
+            return false;
+        }
+    }
+
+    // UL-EV1 / NTAG authentication
+    if (usePwd) {
+        uint8_t pwd[4] = {0x00};
+        memcpy(pwd, datain, sizeof(pwd));
+        uint8_t pack[4] = {0, 0, 0, 0};
+
+        if (!mifare_ul_ev1_auth(pwd, pack)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// arg0 = blockNo (start) | MFU_READCARD_FASTREAD
 // arg1 = Pages (number of blocks)
 // arg2 = useKey
 // datain = KEY bytes
-void MifareUReadCard(uint8_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain) {
+void MifareUReadCard(uint16_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain) {
     LEDsoff();
     LED_A_ON();
     iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
@@ -389,7 +576,8 @@ void MifareUReadCard(uint8_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain)
     set_tracing(true);
 
     // params
-    uint8_t blockNo = arg0;
+    uint8_t blockNo = arg0 & 0xFF;
+    bool useFast = (arg0 & MFU_READCARD_FASTREAD);
     uint16_t blocks = arg1;
     bool useKey = (arg2 == 1); // UL_C
     bool usePwd = (arg2 == 2); // UL_EV1/NTAG
@@ -401,37 +589,36 @@ void MifareUReadCard(uint8_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain)
         return;
     }
 
-    int len = iso14443a_select_card(NULL, NULL, NULL, true, 0, true);
-    if (!len) {
-        if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't select card (RC:%d)", len);
+    if (mifare_ultra_select_auth(useKey, usePwd, datain) == false) {
         OnError(1);
         return;
     }
 
-    // UL-C authentication
-    if (useKey) {
-        uint8_t key[16] = {0x00};
-        memcpy(key, datain, sizeof(key));
+    int i = 0;
+    int len;
 
-        if (!mifare_ultra_auth(key)) {
-            OnError(1);
-            return;
+    // FAST_READ as many pages per frame as fit.  On the first failure
+    // (protected pages, no FAST_READ support) select the tag again and
+    // let the page by page loop below take over from there.
+    while (useFast && i < blocks) {
+        uint16_t n = MIN(blocks - i, (MAX_FRAME_SIZE - 2) / 4);
+        if ((i + n) * 4 > CARD_MEMORY_SIZE) {
+            break;
         }
-    }
 
-    // UL-EV1 / NTAG authentication
-    if (usePwd) {
-        uint8_t pwd[4] = {0x00};
-        memcpy(pwd, datain, sizeof(pwd));
-        uint8_t pack[4] = {0, 0, 0, 0};
-
-        if (!mifare_ul_ev1_auth(pwd, pack)) {
-            OnError(1);
-            return;
+        if (mifare_ultra_fastread(blockNo + i, blockNo + i + n - 1, dataout + (4 * i))) {
+            if (g_dbglevel >= DBG_INFO) Dbprintf("Fast read from block %d failed, falling back to read", i);
+            if (mifare_ultra_select_auth(useKey, usePwd, datain) == false) {
+                OnError(1);
+                return;
+            }
+            break;
         }
+        i += n;
+        countblocks += n;
     }
 
-    for (int i = 0; i < blocks; i++) {
+    for (; i < blocks; i++) {
         if ((i * 4) + 4 >= CARD_MEMORY_SIZE) {
             Dbprintf("Data exceeds buffer!!");
             break;
@@ -701,6 +888,72 @@ void MifareUWriteBlockCompat(uint8_t arg0, uint8_t arg1, uint8_t *datain) {
     set_tracing(false);
 }
 
+// Writes consecutive pages in one selected and authenticated session,
+// one reply for the whole range.
+// keytype : 0 = use no authentication.
+//           1 = use 0x1A authentication, 16 bytes key.
+//           2 = use 0x1B authentication, 4 bytes pwd.
+// uidlen  : when not zero, the selected tag must have this uid,  so a swapped
+//           tag isn't written with data built for another one.
+void MifareUWritePages(uint8_t keytype, uint8_t *key, const uint8_t *uid, uint8_t uidlen, uint8_t start_page, uint8_t pages, uint8_t *data) {
+    int res = PM3_SUCCESS;
+    uint8_t written = 0;
+
+    LEDsoff();
+    LED_A_ON();
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    clear_trace();
+    set_tracing(true);
+
+    iso14a_card_select_t card;
+    if (iso14443a_select_card(NULL, &card, NULL, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Can't select card");
+        res = PM3_ECARDEXCHANGE;
+        goto out;
+    }
+
+    if (uidlen && (card.uidlen != uidlen || memcmp(card.uid, uid, uidlen) != 0)) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Wrong card");
+        res = PM3_EWRONGANSWER;
+        goto out;
+    }
+
+    // UL-C authentication
+    if (keytype == 1 && mifare_ultra_auth(key) == 0) {
+        res = PM3_ESOFT;
+        goto out;
+    }
+
+    // UL-EV1 / NTAG authentication
+    if (keytype == 2) {
+        uint8_t pack[4] = {0, 0, 0, 0};
+        if (mifare_ul_ev1_auth(key, pack) == 0) {
+            res = PM3_ESOFT;
+            goto out;
+        }
+    }
+
+    for (; written < pages; written++) {
+        if (mifare_ultra_writeblock(start_page + written, data + (written * 4)) != PM3_SUCCESS) {
+            if (g_dbglevel >= DBG_INFO) Dbprintf("Write page %u error", start_page + written);
+            res = PM3_ESOFT;
+            goto out;
+        }
+        WDT_HIT();
+    }
+
+    mifare_ultra_halt();
+
+    if (g_dbglevel >= DBG_EXTENDED) Dbprintf("WRITE PAGES FINISHED, %u pages", written);
+
+out:
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    set_tracing(false);
+    reply_ng(CMD_HF_MIFAREU_WRITEPAGES, res, &written, sizeof(written));
+}
+
 void MifareUSetPwd(uint8_t arg0, uint8_t *datain) {
 
     uint8_t pwd[16] = {0x00};
@@ -881,6 +1134,169 @@ void MifareAcquireNonces(uint32_t arg0, uint32_t flags) {
     }
 }
 
+//-----------------------------------------------------------------------------
+// High rate sample collector for `hf 14a cuids`, UIDs or MIFARE Classic nonces.
+// Samples are packed into a chunk in BigBuf and every full chunk is sent right
+// away, the client never has to ask for the next batch. Runs until `count`
+// samples are taken, the button is pressed or the client sends anything.
+//-----------------------------------------------------------------------------
+void MifareCollect(const iso14a_collect_req_t *req) {
+
+    uint8_t uid[10] = {0x00};
+    uint8_t answer[MAX_MIFARE_FRAME_SIZE] = {0x00};
+    uint8_t par[1] = {0x00};
+    uint8_t hlta[4] = { ISO14443A_CMD_HALT, 0x00, 0x00, 0x00 };
+    AddCrc14A(hlta, 2);
+    uint8_t dcmd[4] = { MIFARE_AUTH_KEYA + (req->keytype & 0x01), req->block, 0x00, 0x00 };
+    AddCrc14A(dcmd, 2);
+
+    uint8_t cascade_levels = 0;
+    bool have_uid = false;
+    uint16_t recsize = (req->mode == ISO14A_COLLECT_NONCE) ? sizeof(iso14a_collect_nonce_t) : sizeof(iso14a_collect_uid_t);
+    uint32_t taken = 0;
+    uint16_t fails_row = 0;
+    int status = PM3_SUCCESS;
+
+    LED_A_ON();
+
+    // no trace, it would eat BigBuf long before we are done
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+    clear_trace();
+    set_tracing(false);
+
+    iso14a_collect_chunk_t *chunk = (iso14a_collect_chunk_t *)BigBuf_malloc(sizeof(iso14a_collect_chunk_t));
+    if (chunk == NULL) {
+        reply_ng(CMD_HF_ISO14443A_COLLECT, PM3_EMALLOC, NULL, 0);
+        LEDsoff();
+        return;
+    }
+    memset(chunk, 0, sizeof(iso14a_collect_chunk_t));
+    chunk->mode = req->mode;
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+    uint32_t last_reply = GetTickCount();
+
+    while (req->count == 0 || taken < req->count) {
+
+        WDT_HIT();
+
+        if (BUTTON_PRESS() || data_available()) {
+            status = PM3_EOPABORTED;
+            break;
+        }
+
+        if (fails_row >= ISO14A_COLLECT_MAX_FAILS) {
+            status = PM3_ECARDEXCHANGE;
+            break;
+        }
+
+        // nothing sent for a while,  flush what we have so the client knows we are alive
+        if (GetTickCountDelta(last_reply) > 1000) {
+            reply_ng(CMD_HF_ISO14443A_COLLECT, PM3_SUCCESS, (uint8_t *)chunk, sizeof(iso14a_collect_chunk_t) - ISO14A_COLLECT_DATA + chunk->len);
+            chunk->len = 0;
+            chunk->fails = 0;
+            last_reply = GetTickCount();
+        }
+
+        uint8_t *rec = chunk->data + chunk->len;
+
+        if (req->mode == ISO14A_COLLECT_UID) {
+
+            // power cycle so a random UID card rolls a new one
+            if (req->off_ms) {
+                FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+                SpinDelay(req->off_ms);
+                FpgaWriteConfWord(FPGA_MAJOR_MODE_HF_ISO14443A | FPGA_HF_ISO14443A_READER_LISTEN);
+                SpinDelay(5);
+            }
+
+            iso14a_card_select_t card_info;
+            if (iso14443a_select_card(NULL, &card_info, NULL, true, 0, true) == 0) {
+                chunk->fails++;
+                fails_row++;
+                continue;
+            }
+
+            iso14a_collect_uid_t *u = (iso14a_collect_uid_t *)rec;
+            u->uidlen = card_info.uidlen;
+            memcpy(u->uid, card_info.uid, sizeof(u->uid));
+            u->sak = card_info.sak;
+
+            // WUPA of the next select wakes it again
+            if (req->off_ms == 0) {
+                ReaderTransmit(hlta, sizeof(hlta), NULL);
+            }
+
+        } else {
+
+            if (have_uid == false) { // need a full select cycle to get the uid first
+                iso14a_card_select_t card_info;
+                if (iso14443a_select_card(uid, &card_info, NULL, true, 0, true) == 0) {
+                    chunk->fails++;
+                    fails_row++;
+                    continue;
+                }
+                switch (card_info.uidlen) {
+                    case 4 :
+                        cascade_levels = 1;
+                        break;
+                    case 7 :
+                        cascade_levels = 2;
+                        break;
+                    case 10:
+                        cascade_levels = 3;
+                        break;
+                    default:
+                        break;
+                }
+                have_uid = true;
+            } else if (iso14443a_fast_select_card(uid, cascade_levels) == 0) {
+                chunk->fails++;
+                fails_row++;
+                continue;
+            }
+
+            ReaderTransmit(dcmd, sizeof(dcmd), NULL);
+            uint32_t ts = GetCountSspClk();
+            int len = ReaderReceive(answer, par);
+
+            // wait for the card to become ready again
+            CHK_TIMEOUT();
+
+            if (len != 4) {
+                chunk->fails++;
+                fails_row++;
+                continue;
+            }
+
+            iso14a_collect_nonce_t *n = (iso14a_collect_nonce_t *)rec;
+            n->nt = bytes_to_num(answer, 4);
+            n->ts = ts;
+        }
+
+        fails_row = 0;
+        taken++;
+        chunk->len += recsize;
+
+        if (chunk->len + recsize > ISO14A_COLLECT_DATA) {
+            LED_B_ON();
+            reply_ng(CMD_HF_ISO14443A_COLLECT, PM3_SUCCESS, (uint8_t *)chunk, sizeof(iso14a_collect_chunk_t) - ISO14A_COLLECT_DATA + chunk->len);
+            LED_B_OFF();
+            chunk->len = 0;
+            chunk->fails = 0;
+            last_reply = GetTickCount();
+        }
+    }
+
+    chunk->last = 1;
+    reply_ng(CMD_HF_ISO14443A_COLLECT, status, (uint8_t *)chunk, sizeof(iso14a_collect_chunk_t) - ISO14A_COLLECT_DATA + chunk->len);
+
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    BigBuf_free();
+}
+
 //-----------------------------------------------------------------------------
 // acquire encrypted nonces in order to perform the attack described in
 // Carlo Meijer, Roel Verdult, "Ciphertext-only Cryptanalysis on Hardened
@@ -911,6 +1327,7 @@ void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags,
     bool initialize = flags & 0x0001;
     bool slow = flags & 0x0002;
     bool field_off = flags & 0x0004;
+    bool stream = flags & HARDNESTED_FLAG_STREAM;
     bool have_uid = false;
 
     LED_A_ON();
@@ -931,6 +1348,8 @@ void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags,
 
     for (uint16_t i = 0; i <= PM3_CMD_DATA_SIZE - 9;) {
 
+        WDT_HIT();
+
         // Test if the action was cancelled
         if (BUTTON_PRESS()) {
             isOK = PM3_EOPABORTED;
@@ -938,6 +1357,12 @@ void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags,
             break;
         }
 
+        // client has seen enough nonces
+        if (stream && data_available()) {
+            field_off = true;
+            break;
+        }
+
         if (have_uid == false) { // need a full select cycle to get the uid first
             iso14a_card_select_t card_info;
             if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
@@ -994,6 +1419,14 @@ void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags,
             memcpy(buf + i + 4, receivedAnswer, 4);
             memcpy(buf + i + 8, &nt_par_enc, 1);
             i += 9;
+
+            if (stream && i > PM3_CMD_DATA_SIZE - 9) {
+                LED_B_ON();
+                reply_old(CMD_ACK, PM3_SUCCESS, cuid, num_nonces, buf, sizeof(buf));
+                LED_B_OFF();
+                i = 0;
+                num_nonces = 0;
+            }
         }
 
 
@@ -1021,8 +1454,13 @@ void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags,
     LED_C_OFF();
     crypto1_deinit(pcs);
     LED_B_ON();
-    reply_old(CMD_ACK, isOK, cuid, num_nonces, buf, sizeof(buf));
-    LED_B_OFF();
+    if (stream) {
+        // last batch, only complete pairs
+        reply_old(CMD_ACK, isOK, cuid, (num_nonces & ~1) | HARDNESTED_STREAM_LAST, buf, sizeof(buf));
+    } else {
+        reply_old(CMD_ACK, isOK, cuid, num_nonces, buf, sizeof(buf));
+    }
+    LED_B_OFF();
 
     if (field_off) {
         FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
@@ -1545,6 +1983,214 @@ static void chkKey_loopBonly(struct chk_t *c, struct sector_t *k_sector, uint8_t
     }
 }
 
+// keychunks received from the client while a streamed key check is running
+static mfc_chk_stream_chunk_t *chk_stream_ring = NULL;
+static uint8_t chk_stream_head = 0;
+static uint8_t chk_stream_count = 0;
+static bool chk_stream_last = false;
+
+// move any key chunks the client has sent into the ring.
+// return false if the client wants us to stop.
+static bool chkKey_stream_poll(void) {
+
+    while (data_available()) {
+
+        PacketCommandNG rx;
+        if (receive_ng(&rx) != PM3_SUCCESS)
+            return false;
+
+        // CMD_BREAK_LOOP or anything else ends the stream
+        if (rx.cmd != CMD_HF_MIFARE_CHKKEYS_STREAM)
+            return false;
+
+        // client didn't respect the number of slots
+        if (chk_stream_count == MF_CHK_STREAM_SLOTS)
+            return false;
+
+        uint8_t slot = (chk_stream_head + chk_stream_count) % MF_CHK_STREAM_SLOTS;
+        memcpy(&chk_stream_ring[slot], rx.data.asBytes, sizeof(mfc_chk_stream_chunk_t));
+        chk_stream_ring[slot].keycnt = MIN(chk_stream_ring[slot].keycnt, MF_CHK_STREAM_KEYS);
+        chk_stream_count++;
+
+        if (chk_stream_ring[slot].flags & MF_CHK_STREAM_LAST)
+            chk_stream_last = true;
+    }
+    return true;
+}
+
+// test one keychunk against all sectors not found yet.
+// strategy 1 = depth first on one sector,  2 = width first on all sectors
+// return false if interrupted by button press or usb command
+static bool chkKey_chunk(struct chk_t *c, uint8_t strategy, uint8_t *keys, uint16_t keyCount, struct sector_t *k_sector,
+                         uint8_t *found, uint8_t *sectorcnt, uint8_t *foundkeys, bool use_flashmem, bool stream) {
+
+    uint8_t allkeys = *sectorcnt << 1;
+    uint8_t status;
+
+    if (strategy == 1) {
+
+        uint8_t newfound = *foundkeys;
+
+        uint16_t lastpos = 0;
+        uint16_t s_point = 0;
+        // Sector main loop
+        // keep track of how many sectors on card.
+        for (uint8_t s = 0; s < *sectorcnt; ++s) {
+
+            if (found[(s * 2)] && found[(s * 2) + 1])
+                continue;
+
+            for (uint16_t i = s_point; i < keyCount; ++i) {
+
+                // Allow button press / usb cmd to interrupt device
+                if (BUTTON_PRESS() || (stream ? (chkKey_stream_poll() == false) : data_available())) {
+                    return false;
+                }
+
+                // found all keys?
+                if (*foundkeys == allkeys)
+                    return true;
+
+                WDT_HIT();
+
+                // assume: block0,1,2 has more read rights in accessbits than the sectortrailer. authenticating against block0 in each sector
+                c->block = FirstBlockOfSector(s);
+
+                // new key
+                c->key = bytes_to_num(keys + i * 6, 6);
+
+                // skip already found A keys
+                if (!found[(s * 2)]) {
+                    c->keyType = 0;
+                    status = chkKey(c);
+                    if (status == 0) {
+                        memcpy(k_sector[s].keyA, keys + i * 6, 6);
+                        found[(s * 2)] = 1;
+                        ++*foundkeys;
+
+                        chkKey_scanA(c, k_sector, found, sectorcnt, foundkeys);
+
+                        // read Block B, if A is found.
+                        chkKey_loopBonly(c, k_sector, found, sectorcnt, foundkeys);
+
+                        c->keyType = 1;
+                        chkKey_scanB(c, k_sector, found, sectorcnt, foundkeys);
+
+                        c->keyType = 0;
+                        c->block = FirstBlockOfSector(s);
+
+                        if (use_flashmem) {
+                            if (lastpos != i && lastpos != 0) {
+                                if (i - lastpos < 0xF) {
+                                    s_point = i & 0xFFF0;
+                                }
+                            } else {
+                                lastpos = i;
+                            }
+                        }
+                    }
+                }
+
+                // skip already found B keys
+                if (!found[(s * 2) + 1]) {
+                    c->keyType = 1;
+                    status = chkKey(c);
+                    if (status == 0) {
+                        memcpy(k_sector[s].keyB, keys + i * 6, 6);
+                        found[(s * 2) + 1] = 1;
+                        ++*foundkeys;
+
+                        chkKey_scanB(c, k_sector, found, sectorcnt, foundkeys);
+
+                        if (use_flashmem) {
+                            if (lastpos != i && lastpos != 0) {
+
+                                if (i - lastpos < 0xF)
+                                    s_point = i & 0xFFF0;
+                            } else {
+                                lastpos = i;
+                            }
+                        }
+                    }
+                }
+
+                if (found[(s * 2)] && found[(s * 2) + 1])
+                    break;
+
+            } // end keys test loop - depth first
+
+            // assume1. if no keys found in first sector, get next keychunk from client
+            if (!use_flashmem && (newfound - *foundkeys == 0))
+                return true;
+
+        } // end loop - sector
+        return true;
+    } // end strategy 1
+
+    // Keychunk loop
+    for (uint16_t i = 0; i < keyCount; i++) {
+
+        // Allow button press / usb cmd to interrupt device
+        if (BUTTON_PRESS() || (stream ? (chkKey_stream_poll() == false) : data_available()))
+            return false;
+
+        // found all keys?
+        if (*foundkeys == allkeys)
+            return true;
+
+        WDT_HIT();
+
+        // new key
+        c->key = bytes_to_num(keys + i * 6, 6);
+
+        // Sector main loop
+        // keep track of how many sectors on card.
+        for (uint8_t s = 0; s < *sectorcnt; ++s) {
+
+            if (found[(s * 2)] && found[(s * 2) + 1]) continue;
+
+            // found all keys?
+            if (*foundkeys == allkeys)
+                return true;
+
+            // assume: block0,1,2 has more read rights in accessbits than the sectortrailer. authenticating against block0 in each sector
+            c->block = FirstBlockOfSector(s);
+
+            // skip already found A keys
+            if (!found[(s * 2)]) {
+                c->keyType = 0;
+                status = chkKey(c);
+                if (status == 0) {
+                    memcpy(k_sector[s].keyA, keys + i * 6, 6);
+                    found[(s * 2)] = 1;
+                    ++*foundkeys;
+
+                    chkKey_scanA(c, k_sector, found, sectorcnt, foundkeys);
+
+                    // read Block B, if A is found.
+                    chkKey_loopBonly(c, k_sector, found, sectorcnt, foundkeys);
+
+                    c->block = FirstBlockOfSector(s);
+                }
+            }
+
+            // skip already found B keys
+            if (!found[(s * 2) + 1]) {
+                c->keyType = 1;
+                status = chkKey(c);
+                if (status == 0) {
+                    memcpy(k_sector[s].keyB, keys + i * 6, 6);
+                    found[(s * 2) + 1] = 1;
+                    ++*foundkeys;
+
+                    chkKey_scanB(c, k_sector, found, sectorcnt, foundkeys);
+                }
+            }
+        } // end loop sectors
+    } // end loop keys
+    return true;
+}
+
 // get Chunks of keys, to test authentication against card.
 // arg0 = antal sectorer
 // arg0 = first time
@@ -1560,7 +2206,6 @@ void MifareChkKeys_fast(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_t *da
     uint8_t strategy = arg1 & 0xFF;
     uint8_t use_flashmem = (arg1 >> 8) & 0xFF;
     uint16_t keyCount = arg2 & 0xFF;
-    uint8_t status = 0;
 
     struct Crypto1State mpcs = {0, 0};
     struct Crypto1State *pcs;
@@ -1663,169 +2308,15 @@ void MifareChkKeys_fast(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_t *da
 
     // keychunk loop - depth first one sector.
     if (strategy == 1 || use_flashmem) {
-
-        uint8_t newfound = foundkeys;
-
-        uint16_t lastpos = 0;
-        uint16_t s_point = 0;
-        // Sector main loop
-        // keep track of how many sectors on card.
-        for (uint8_t s = 0; s < sectorcnt; ++s) {
-
-            if (found[(s * 2)] && found[(s * 2) + 1])
-                continue;
-
-            for (uint16_t i = s_point; i < keyCount; ++i) {
-
-                // Allow button press / usb cmd to interrupt device
-                if (BUTTON_PRESS() || data_available()) {
-                    goto OUT;
-                }
-
-                // found all keys?
-                if (foundkeys == allkeys)
-                    goto OUT;
-
-                WDT_HIT();
-
-                // assume: block0,1,2 has more read rights in accessbits than the sectortrailer. authenticating against block0 in each sector
-                chk_data.block = FirstBlockOfSector(s);
-
-                // new key
-                chk_data.key = bytes_to_num(datain + i * 6, 6);
-
-                // skip already found A keys
-                if (!found[(s * 2)]) {
-                    chk_data.keyType = 0;
-                    status = chkKey(&chk_data);
-                    if (status == 0) {
-                        memcpy(k_sector[s].keyA, datain + i * 6, 6);
-                        found[(s * 2)] = 1;
-                        ++foundkeys;
-
-                        chkKey_scanA(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        // read Block B, if A is found.
-                        chkKey_loopBonly(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        chk_data.keyType = 1;
-                        chkKey_scanB(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        chk_data.keyType = 0;
-                        chk_data.block = FirstBlockOfSector(s);
-
-                        if (use_flashmem) {
-                            if (lastpos != i && lastpos != 0) {
-                                if (i - lastpos < 0xF) {
-                                    s_point = i & 0xFFF0;
-                                }
-                            } else {
-                                lastpos = i;
-                            }
-                        }
-                    }
-                }
-
-                // skip already found B keys
-                if (!found[(s * 2) + 1]) {
-                    chk_data.keyType = 1;
-                    status = chkKey(&chk_data);
-                    if (status == 0) {
-                        memcpy(k_sector[s].keyB, datain + i * 6, 6);
-                        found[(s * 2) + 1] = 1;
-                        ++foundkeys;
-
-                        chkKey_scanB(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        if (use_flashmem) {
-                            if (lastpos != i && lastpos != 0) {
-
-                                if (i - lastpos < 0xF)
-                                    s_point = i & 0xFFF0;
-                            } else {
-                                lastpos = i;
-                            }
-                        }
-                    }
-                }
-
-                if (found[(s * 2)] && found[(s * 2) + 1])
-                    break;
-
-            } // end keys test loop - depth first
-
-            // assume1. if no keys found in first sector, get next keychunk from client
-            if (!use_flashmem && (newfound - foundkeys == 0))
-                goto OUT;
-
-        } // end loop - sector
+        if (chkKey_chunk(&chk_data, 1, datain, keyCount, k_sector, found, &sectorcnt, &foundkeys, use_flashmem, false) == false)
+            goto OUT;
     } // end strategy 1
 
     if (foundkeys == allkeys)
         goto OUT;
 
     if (strategy == 2 || use_flashmem) {
-
-        // Keychunk loop
-        for (uint16_t i = 0; i < keyCount; i++) {
-
-            // Allow button press / usb cmd to interrupt device
-            if (BUTTON_PRESS() || data_available()) break;
-
-            // found all keys?
-            if (foundkeys == allkeys)
-                goto OUT;
-
-            WDT_HIT();
-
-            // new key
-            chk_data.key = bytes_to_num(datain + i * 6, 6);
-
-            // Sector main loop
-            // keep track of how many sectors on card.
-            for (uint8_t s = 0; s < sectorcnt; ++s) {
-
-                if (found[(s * 2)] && found[(s * 2) + 1]) continue;
-
-                // found all keys?
-                if (foundkeys == allkeys)
-                    goto OUT;
-
-                // assume: block0,1,2 has more read rights in accessbits than the sectortrailer. authenticating against block0 in each sector
-                chk_data.block = FirstBlockOfSector(s);
-
-                // skip already found A keys
-                if (!found[(s * 2)]) {
-                    chk_data.keyType = 0;
-                    status = chkKey(&chk_data);
-                    if (status == 0) {
-                        memcpy(k_sector[s].keyA, datain + i * 6, 6);
-                        found[(s * 2)] = 1;
-                        ++foundkeys;
-
-                        chkKey_scanA(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        // read Block B, if A is found.
-                        chkKey_loopBonly(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-
-                        chk_data.block = FirstBlockOfSector(s);
-                    }
-                }
-
-                // skip already found B keys
-                if (!found[(s * 2) + 1]) {
-                    chk_data.keyType = 1;
-                    status = chkKey(&chk_data);
-                    if (status == 0) {
-                        memcpy(k_sector[s].keyB, datain + i * 6, 6);
-                        found[(s * 2) + 1] = 1;
-                        ++foundkeys;
-
-                        chkKey_scanB(&chk_data, k_sector, found, &sectorcnt, &foundkeys);
-                    }
-                }
-            } // end loop sectors
-        } // end loop keys
+        chkKey_chunk(&chk_data, 2, datain, keyCount, k_sector, found, &sectorcnt, &foundkeys, use_flashmem, false);
     } // end loop strategy 2
 OUT:
     LEDsoff();
@@ -1891,35 +2382,362 @@ OUT:
     g_dbglevel = oldbg;
 }
 
-void MifareChkKeys(uint8_t *datain, uint8_t reserved_mem) {
+static void chkKey_stream_status(mfc_chk_stream_status_t *p, const struct sector_t *k_sector, const uint8_t *found,
+                                 uint8_t sectorcnt, uint8_t foundkeys, uint16_t chunks, bool done) {
+    p->foundkeys = foundkeys;
+    p->done = done;
+    p->chunks = chunks;
+    memset(p->found, 0x00, sizeof(p->found));
+    for (uint8_t m = 0; m < (sectorcnt << 1); m++) {
+        if (found[m]) {
+            p->found[m >> 3] |= (1 << (m & 7));
+        }
+    }
+    memcpy(p->keys, k_sector, sectorcnt * sizeof(sector_t));
+}
 
-    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+// streamed version of MifareChkKeys_fast,  one call tests the whole dictionary.
+// The client keeps up to MF_CHK_STREAM_SLOTS keychunks queued in a BigBuf ring while
+// we are busy with the card. Every consumed chunk is answered with the keys found so far,
+// which also tells the client it can send the next chunk.
+// datain = first mfc_chk_stream_chunk_t
+void MifareChkKeys_stream(uint8_t *datain) {
+
+    mfc_chk_stream_chunk_t *first = (mfc_chk_stream_chunk_t *)datain;
+
+    // chunks still in flight when a stream ended,  nothing to do
+    if ((first->flags & MF_CHK_STREAM_FIRST) == 0)
+        return;
+
+    uint8_t sectorcnt = MIN(first->sectorcnt, 40);
+    uint8_t allkeys = sectorcnt << 1;
+    uint8_t foundkeys = 0;
+    uint16_t chunks = 0;
+    int res = PM3_SUCCESS;
 
     struct Crypto1State mpcs = {0, 0};
     struct Crypto1State *pcs;
     pcs = &mpcs;
+    struct chk_t chk_data;
 
     uint8_t uid[10] = {0x00};
-
-    uint64_t key = 0;
     uint32_t cuid = 0;
     uint8_t cascade_levels = 0;
-    struct {
-        uint8_t key[6];
-        bool found;
-    } PACKED keyresult;
-    keyresult.found = false;
-    memset(keyresult.key, 0x00, sizeof(keyresult.key));
 
-    bool have_uid = false;
+    int oldbg = g_dbglevel;
 
-    uint8_t keyType = datain[0];
-    uint8_t blockNo = datain[1];
-    bool clearTrace = datain[2];
-    uint16_t key_count = (datain[3] << 8) | datain[4];
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+    clear_trace();
+    set_tracing(false);
 
-    uint16_t key_mem_available;
-    if (reserved_mem)
+    chk_stream_ring = (mfc_chk_stream_chunk_t *)BigBuf_malloc(MF_CHK_STREAM_SLOTS * sizeof(mfc_chk_stream_chunk_t));
+    struct sector_t *k_sector = (struct sector_t *)BigBuf_calloc(40 * sizeof(sector_t));
+    uint8_t *found = BigBuf_calloc(80);
+    mfc_chk_stream_status_t *payload = (mfc_chk_stream_status_t *)BigBuf_calloc(sizeof(mfc_chk_stream_status_t));
+    if (chk_stream_ring == NULL || k_sector == NULL || found == NULL || payload == NULL) {
+        BigBuf_free();
+        reply_ng(CMD_HF_MIFARE_CHKKEYS_STREAM, PM3_EMALLOC, NULL, 0);
+        return;
+    }
+
+    memcpy(&chk_stream_ring[0], first, sizeof(mfc_chk_stream_chunk_t));
+    chk_stream_ring[0].keycnt = MIN(chk_stream_ring[0].keycnt, MF_CHK_STREAM_KEYS);
+    chk_stream_head = 0;
+    chk_stream_count = 1;
+    chk_stream_last = (first->flags & MF_CHK_STREAM_LAST);
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    LEDsoff();
+    LED_A_ON();
+
+    iso14a_card_select_t card_info;
+    if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("ChkKeys_stream: Can't select card (ALL)");
+        res = PM3_ECARDEXCHANGE;
+        goto OUT;
+    }
+
+    switch (card_info.uidlen) {
+        case 4 :
+            cascade_levels = 1;
+            break;
+        case 7 :
+            cascade_levels = 2;
+            break;
+        case 10:
+            cascade_levels = 3;
+            break;
+        default:
+            break;
+    }
+
+    CHK_TIMEOUT();
+
+    // clear debug level. We are expecting lots of authentication failures...
+    g_dbglevel = DBG_NONE;
+
+    // set check struct.
+    chk_data.uid = uid;
+    chk_data.cuid = cuid;
+    chk_data.cl = cascade_levels;
+    chk_data.pcs = pcs;
+    chk_data.block = 0;
+
+    uint32_t wait_start = GetTickCount();
+
+    while (foundkeys < allkeys) {
+
+        // ring empty,  waiting for the client
+        if (chk_stream_count == 0) {
+
+            if (BUTTON_PRESS() || chkKey_stream_poll() == false) {
+                res = PM3_EOPABORTED;
+                break;
+            }
+
+            if (GetTickCountDelta(wait_start) > 3000) {
+                res = PM3_ETIMEOUT;
+                break;
+            }
+
+            WDT_HIT();
+            continue;
+        }
+
+        mfc_chk_stream_chunk_t *chunk = &chk_stream_ring[chk_stream_head];
+
+        bool completed = chkKey_chunk(&chk_data, chunk->strategy, chunk->keys, chunk->keycnt, k_sector, found, &sectorcnt, &foundkeys, false, true);
+
+        bool lastchunk = (chunk->flags & MF_CHK_STREAM_LAST);
+        chk_stream_head = (chk_stream_head + 1) % MF_CHK_STREAM_SLOTS;
+        chk_stream_count--;
+        chunks++;
+
+        if (completed == false) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        if (lastchunk || foundkeys == allkeys)
+            break;
+
+        // frees one slot on client side
+        chkKey_stream_status(payload, k_sector, found, sectorcnt, foundkeys, chunks, false);
+        reply_ng(CMD_HF_MIFARE_CHKKEYS_STREAM, PM3_SUCCESS, (uint8_t *)payload, sizeof(mfc_chk_stream_status_t));
+
+        wait_start = GetTickCount();
+    }
+
+OUT:
+    LEDsoff();
+
+    crypto1_deinit(pcs);
+
+    chkKey_stream_status(payload, k_sector, found, sectorcnt, foundkeys, chunks, true);
+    reply_ng(CMD_HF_MIFARE_CHKKEYS_STREAM, res, (uint8_t *)payload, sizeof(mfc_chk_stream_status_t));
+
+    chk_stream_ring = NULL;
+    set_tracing(false);
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+
+    g_dbglevel = oldbg;
+}
+
+static void chkKey_gen_status(mfc_chk_gen_reply_t *p, const struct sector_t *k_sector, const uint8_t *found,
+                              uint8_t sectorcnt, uint8_t foundkeys, const generator_context_t *ctx, uint32_t tested, bool done) {
+    p->tested = tested;
+    p->stage = ctx->smart_mode_stage;
+    p->foundkeys = foundkeys;
+    p->done = done;
+    memset(p->found, 0x00, sizeof(p->found));
+    for (uint8_t m = 0; m < (sectorcnt << 1); m++) {
+        if (found[m]) {
+            p->found[m >> 3] |= (1 << (m & 7));
+        }
+    }
+    memcpy(p->keys, k_sector, sectorcnt * sizeof(sector_t));
+}
+
+// generator driven version of MifareChkKeys_fast.  The candidate keys come from the
+// bruteforce generators on device,  so nothing but the hits has to go over USB.
+// datain = mfc_chk_gen_t
+void MifareChkKeys_gen(uint8_t *datain) {
+
+    mfc_chk_gen_t *req = (mfc_chk_gen_t *)datain;
+
+    uint8_t sectorcnt = MIN(req->sectorcnt, 40);
+    uint8_t allkeys = sectorcnt << 1;
+    uint8_t foundkeys = 0;
+    uint32_t tested = 0;
+    int res = PM3_SUCCESS;
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs;
+    pcs = &mpcs;
+    struct chk_t chk_data;
+
+    uint8_t uid[10] = {0x00};
+    uint32_t cuid = 0;
+    uint8_t cascade_levels = 0;
+
+    int oldbg = g_dbglevel;
+
+    generator_context_t ctx;
+    bf_generator_init(&ctx, req->mode, BF_KEY_SIZE_48);
+    if (req->mode == BF_MODE_CHARSET) {
+        bf_generator_set_charset(&ctx, req->charset);
+    } else if (req->mode == BF_MODE_RANGE) {
+        ctx.range_low = req->range_low;
+        ctx.range_high = req->range_high;
+    }
+
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+    clear_trace();
+    set_tracing(false);
+
+    uint8_t *keys = BigBuf_malloc(MF_CHK_STREAM_KEYS * 6);
+    struct sector_t *k_sector = (struct sector_t *)BigBuf_calloc(40 * sizeof(sector_t));
+    uint8_t *found = BigBuf_calloc(80);
+    mfc_chk_gen_reply_t *payload = (mfc_chk_gen_reply_t *)BigBuf_calloc(sizeof(mfc_chk_gen_reply_t));
+    if (keys == NULL || k_sector == NULL || found == NULL || payload == NULL) {
+        BigBuf_free();
+        reply_ng(CMD_HF_MIFARE_CHKKEYS_GEN, PM3_EMALLOC, NULL, 0);
+        return;
+    }
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    LEDsoff();
+    LED_A_ON();
+
+    iso14a_card_select_t card_info;
+    if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("ChkKeys_gen: Can't select card (ALL)");
+        res = PM3_ECARDEXCHANGE;
+        goto OUT;
+    }
+
+    switch (card_info.uidlen) {
+        case 4 :
+            cascade_levels = 1;
+            break;
+        case 7 :
+            cascade_levels = 2;
+            break;
+        case 10:
+            cascade_levels = 3;
+            break;
+        default:
+            break;
+    }
+
+    CHK_TIMEOUT();
+
+    // clear debug level. We are expecting lots of authentication failures...
+    g_dbglevel = DBG_NONE;
+
+    // set check struct.
+    chk_data.uid = uid;
+    chk_data.cuid = cuid;
+    chk_data.cl = cascade_levels;
+    chk_data.pcs = pcs;
+    chk_data.block = 0;
+
+    uint32_t last_report = GetTickCount();
+    bool generator_end = false;
+
+    while (generator_end == false && foundkeys < allkeys) {
+
+        // next keychunk from the generator
+        uint16_t keycnt = 0;
+        while (keycnt < MF_CHK_STREAM_KEYS) {
+            int ret = bf_generate(&ctx);
+            if (ret == BF_GENERATOR_ERROR) {
+                res = PM3_EINVARG;
+                generator_end = true;
+                break;
+            }
+            if (ret == BF_GENERATOR_END) {
+                generator_end = true;
+                break;
+            }
+            num_to_bytes(bf_get_key48(&ctx), 6, keys + (keycnt * 6));
+            keycnt++;
+        }
+
+        if (keycnt == 0)
+            break;
+
+        uint8_t oldfound = foundkeys;
+
+        // width first on all sectors,  returns on button press or usb command
+        if (chkKey_chunk(&chk_data, 2, keys, keycnt, k_sector, found, &sectorcnt, &foundkeys, false, false) == false) {
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        tested += keycnt;
+
+        if (foundkeys == allkeys)
+            break;
+
+        if (foundkeys != oldfound || GetTickCountDelta(last_report) > MF_CHK_GEN_REPORT_MS) {
+            chkKey_gen_status(payload, k_sector, found, sectorcnt, foundkeys, &ctx, tested, false);
+            reply_ng(CMD_HF_MIFARE_CHKKEYS_GEN, PM3_SUCCESS, (uint8_t *)payload, sizeof(mfc_chk_gen_reply_t));
+            last_report = GetTickCount();
+        }
+    }
+
+OUT:
+    LEDsoff();
+
+    crypto1_deinit(pcs);
+
+    chkKey_gen_status(payload, k_sector, found, sectorcnt, foundkeys, &ctx, tested, true);
+    reply_ng(CMD_HF_MIFARE_CHKKEYS_GEN, res, (uint8_t *)payload, sizeof(mfc_chk_gen_reply_t));
+
+    set_tracing(false);
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+
+    g_dbglevel = oldbg;
+}
+
+void MifareChkKeys(uint8_t *datain, uint8_t reserved_mem) {
+
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs;
+    pcs = &mpcs;
+
+    uint8_t uid[10] = {0x00};
+
+    uint64_t key = 0;
+    uint32_t cuid = 0;
+    uint8_t cascade_levels = 0;
+    struct {
+        uint8_t key[6];
+        bool found;
+    } PACKED keyresult;
+    keyresult.found = false;
+    memset(keyresult.key, 0x00, sizeof(keyresult.key));
+
+    bool have_uid = false;
+
+    uint8_t keyType = datain[0];
+    uint8_t blockNo = datain[1];
+    bool clearTrace = datain[2];
+    uint16_t key_count = (datain[3] << 8) | datain[4];
+
+    uint16_t key_mem_available;
+    if (reserved_mem)
         key_mem_available = key_count * 6;
     else
         key_mem_available = MIN((PM3_CMD_DATA_SIZE - 5), key_count * 6);
@@ -1994,6 +2812,163 @@ void MifareChkKeys(uint8_t *datain, uint8_t reserved_mem) {
     g_dbglevel = oldbg;
 }
 
+// candidate list of CMD_HF_MIFARE_CHKKEYS_LIST,  kept in BigBuf between the upload chunks
+static uint8_t *chk_list_keys = NULL;
+static uint16_t chk_list_total = 0;
+
+// checks a list of keys against one block.
+// Most cards need a new select after a failed auth,  some take the next auth right away which saves
+// the select per key. The first auth without select tells which kind of card it is.
+static int chkKey_list(uint8_t block, uint8_t keytype, const uint8_t *keys, uint16_t total, bool reauth, mfc_chk_list_reply_t *reply) {
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs = &mpcs;
+
+    uint8_t uid[10] = {0x00};
+    uint32_t cuid = 0;
+    uint8_t cascade_levels = 0;
+    int res = PM3_SUCCESS;
+
+    reply->index = -1;
+    reply->tested = 0;
+    reply->reauth = 0;
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+    set_tracing(false);
+
+    iso14a_card_select_t card_info;
+    if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("ChkKeys_list: Can't select card (ALL)");
+        return PM3_ECARDEXCHANGE;
+    }
+
+    switch (card_info.uidlen) {
+        case 4 :
+            cascade_levels = 1;
+            break;
+        case 7 :
+            cascade_levels = 2;
+            break;
+        case 10:
+            cascade_levels = 3;
+            break;
+        default:
+            break;
+    }
+
+    // clear debug level. We are expecting lots of authentication failures...
+    int oldbg = g_dbglevel;
+    g_dbglevel = DBG_NONE;
+
+    bool selected = true;   // card waits for an auth
+    bool fresh = true;      // no failed auth since the select
+    uint8_t fails = 0;
+    uint16_t loops = 0;
+
+    for (uint16_t i = 0; i < total;) {
+
+        if ((++loops & 0x3F) == 0) {
+            WDT_HIT();
+            if (BUTTON_PRESS() || data_available()) {
+                res = PM3_EOPABORTED;
+                break;
+            }
+        }
+
+        if (selected == false) {
+            if (iso14443a_fast_select_card(uid, cascade_levels) == 0) {
+                if (++fails == 5) {
+                    res = PM3_ECARDEXCHANGE;
+                    break;
+                }
+                continue;
+            }
+            selected = true;
+            fresh = true;
+        }
+
+        uint64_t key = bytes_to_num(keys + (i * 6), 6);
+        int ares = mifare_classic_authex(pcs, cuid, block, keytype, key, AUTH_FIRST, NULL, NULL);
+        if (ares == 0) {
+            reply->index = i;
+            memcpy(reply->key, keys + (i * 6), 6);
+            reply->tested++;
+            break;
+        }
+
+        if (ares == 1) {
+            // no tag nonce,  this card wants a select after a failed auth.  Same key again
+            if (fresh == false) {
+                reauth = false;
+            } else if (++fails == 5) {
+                res = PM3_ECARDEXCHANGE;
+                break;
+            }
+            selected = false;
+            continue;
+        }
+
+        if (fresh == false) {
+            reply->reauth = 1;
+        }
+
+        // wrong key
+        i++;
+        reply->tested++;
+        fails = 0;
+        fresh = false;
+        selected = reauth;
+    }
+
+    crypto1_deinit(pcs);
+    g_dbglevel = oldbg;
+    return res;
+}
+
+void MifareChkKeys_list(uint8_t *datain) {
+
+    mfc_chk_list_chunk_t *chunk = (mfc_chk_list_chunk_t *)datain;
+
+    if (chunk->flags & MF_CHK_LIST_FIRST) {
+        BigBuf_free();
+        BigBuf_Clear_ext(false);
+        chk_list_total = chunk->total;
+        chk_list_keys = BigBuf_malloc(chk_list_total * 6);
+        if (chk_list_keys == NULL) {
+            chk_list_total = 0;
+            reply_ng(CMD_HF_MIFARE_CHKKEYS_LIST, PM3_EMALLOC, NULL, 0);
+            return;
+        }
+    }
+
+    if (chk_list_keys == NULL || chunk->keycnt > MF_CHK_LIST_KEYS || chunk->offset + chunk->keycnt > chk_list_total) {
+        reply_ng(CMD_HF_MIFARE_CHKKEYS_LIST, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    memcpy(chk_list_keys + (chunk->offset * 6), chunk->keys, chunk->keycnt * 6);
+
+    if ((chunk->flags & MF_CHK_LIST_LAST) == 0) {
+        reply_ng(CMD_HF_MIFARE_CHKKEYS_LIST, PM3_SUCCESS, NULL, 0);
+        return;
+    }
+
+    LEDsoff();
+    LED_A_ON();
+
+    mfc_chk_list_reply_t payload;
+    int res = chkKey_list(chunk->block, chunk->keytype, chk_list_keys, chk_list_total, (chunk->flags & MF_CHK_LIST_NO_REAUTH) == 0, &payload);
+
+    reply_ng(CMD_HF_MIFARE_CHKKEYS_LIST, res, (uint8_t *)&payload, sizeof(payload));
+
+    chk_list_keys = NULL;
+    chk_list_total = 0;
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    LEDsoff();
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+}
+
 void MifareChkKeys_file(uint8_t *fn) {
 
 #ifdef WITH_FLASH
@@ -2019,6 +2994,126 @@ void MifareChkKeys_file(uint8_t *fn) {
 #endif
 }
 
+// MifareChkKeys_fast for standalone modes, no replies to the client.
+// With use_flashmem and a dictionary uploaded to flash (`mem load --mfc`), the flash
+// dictionary replaces the given keys.  It is checked in the order it was uploaded,
+// so keep the most common keys first in the .dic file.
+// Depth first on the first sectors, then width first over all sectors left.
+// sectorkeys = sectorcnt * 12 bytes, keyA | keyB per sector
+// found      = sectorcnt * 2 flags, A | B per sector
+// return number of keys found, or negative PM3 error
+int MifareChkKeys_dict(uint8_t sectorcnt, uint8_t *keys, uint16_t keycnt, bool use_flashmem, uint8_t *sectorkeys, uint8_t *found) {
+
+    sectorcnt = MIN(sectorcnt, 40);
+    uint8_t allkeys = sectorcnt << 1;
+    uint8_t foundkeys = 0;
+    int res = PM3_SUCCESS;
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs;
+    pcs = &mpcs;
+    struct chk_t chk_data;
+
+    uint8_t uid[10] = {0x00};
+    uint32_t cuid = 0;
+    uint8_t cascade_levels = 0;
+
+    uint32_t mark = BigBuf_get_mark();
+
+#ifdef WITH_FLASH
+    if (use_flashmem) {
+        uint8_t size[2] = {0x00, 0x00};
+        uint16_t n = 0;
+        if (Flash_ReadData(DEFAULT_MF_KEYS_OFFSET, size, 2) == 2) {
+            n = size[1] << 8 | size[0];
+        }
+
+        // erased flash reads 0xFFFF
+        if (n == 0 || n > DEFAULT_MF_KEYS_MAX) {
+            use_flashmem = false;
+        } else {
+            uint8_t *mem = BigBuf_malloc(n * 6);
+            if (mem != NULL && Flash_ReadData(DEFAULT_MF_KEYS_OFFSET + 2, mem, n * 6) == n * 6) {
+                keys = mem;
+                keycnt = n;
+            } else {
+                use_flashmem = false;
+            }
+        }
+    }
+#else
+    use_flashmem = false;
+#endif
+
+    memset(sectorkeys, 0x00, sectorcnt * sizeof(sector_t));
+    memset(found, 0x00, allkeys);
+
+    if (keys == NULL || keycnt == 0) {
+        BigBuf_release(mark);
+        return PM3_EINVARG;
+    }
+
+    if (g_dbglevel >= DBG_INFO) Dbprintf("ChkKeys_dict: %u keys from %s", keycnt, use_flashmem ? "flash" : "fw");
+
+    int oldbg = g_dbglevel;
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+    set_tracing(false);
+
+    iso14a_card_select_t card_info;
+    if (iso14443a_select_card(uid, &card_info, &cuid, true, 0, true) == 0) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("ChkKeys_dict: Can't select card (ALL)");
+        res = PM3_ECARDEXCHANGE;
+        goto OUT;
+    }
+
+    switch (card_info.uidlen) {
+        case 4 :
+            cascade_levels = 1;
+            break;
+        case 7 :
+            cascade_levels = 2;
+            break;
+        case 10:
+            cascade_levels = 3;
+            break;
+        default:
+            break;
+    }
+
+    CHK_TIMEOUT();
+
+    // clear debug level. We are expecting lots of authentication failures...
+    g_dbglevel = DBG_NONE;
+
+    // set check struct.
+    chk_data.uid = uid;
+    chk_data.cuid = cuid;
+    chk_data.cl = cascade_levels;
+    chk_data.pcs = pcs;
+    chk_data.block = 0;
+
+    struct sector_t *k_sector = (struct sector_t *)sectorkeys;
+
+    if (chkKey_chunk(&chk_data, 1, keys, keycnt, k_sector, found, &sectorcnt, &foundkeys, true, false) == false) {
+        res = PM3_EOPABORTED;
+        goto OUT;
+    }
+
+    if (foundkeys < allkeys) {
+        if (chkKey_chunk(&chk_data, 2, keys, keycnt, k_sector, found, &sectorcnt, &foundkeys, true, false) == false) {
+            res = PM3_EOPABORTED;
+        }
+    }
+
+OUT:
+    g_dbglevel = oldbg;
+    crypto1_deinit(pcs);
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+    BigBuf_release(mark);
+    return (res == PM3_SUCCESS) ? foundkeys : res;
+}
+
 //-----------------------------------------------------------------------------
 // MIFARE Personalize UID. Only for Mifare Classic EV1 7Byte UID
 //-----------------------------------------------------------------------------
@@ -2205,15 +3300,17 @@ int MifareECardLoad(uint8_t sectorcnt, uint8_t keytype) {
         }
 
 
-#define MAX_RETRIES 2
-
         uint8_t data[16] = {0x00};
         for (uint8_t b = 0; b < NumBlocksPerSector(s); b++) {
 
             memset(data, 0x00, sizeof(data));
             uint8_t tb = FirstBlockOfSector(s) + b;
-            uint8_t r = 0;
-            for (; r < MAX_RETRIES; r++) {
+
+            // crypto1 session,  only a CRC error can be resent.  A lost or cut frame leaves the
+            // cipher streams out of step and needs select + auth again
+            rf_retry_policy_t rp = RF_RETRY_POLICY(1, 1, 0, true);
+            bool done = false;
+            while (true) {
 
                 int res = mifare_classic_readblock(pcs, tb, data);
                 if (res == 1) {
@@ -2221,32 +3318,47 @@ int MifareECardLoad(uint8_t sectorcnt, uint8_t keytype) {
                     if (g_dbglevel >= DBG_ERROR) {
                         Dbprintf("Error No rights reading sector %2d block %2d", s, b);
                     }
+                    done = true;
                     break;
                 }
-                // retry if wrong len.
-                if (res != 0) {
-                    continue;
-                }
 
-                // No need to copy empty
-                if (memcmp(data, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 16) == 0) {
+                if (res == 0) {
+                    done = true;
+
+                    // No need to copy empty
+                    if (memcmp(data, "\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00", 16) == 0) {
+                        break;
+                    }
+
+                    if (IsSectorTrailer(b)) {
+                        // sector trailer, keep the keys, set only the AC
+                        uint8_t st[16] = {0x00};
+                        emlGetMem(st, tb, 1);
+                        memcpy(st + 6, data + 6, 4);
+                        emlSetMem_xt(st,  tb, 1, 16);
+                    } else {
+                        emlSetMem_xt(data, tb, 1, 16);
+                    }
                     break;
                 }
 
-                if (IsSectorTrailer(b)) {
-                    // sector trailer, keep the keys, set only the AC
-                    uint8_t st[16] = {0x00};
-                    emlGetMem(st, tb, 1);
-                    memcpy(st + 6, data + 6, 4);
-                    emlSetMem_xt(st,  tb, 1, 16);
-                } else {
-                    emlSetMem_xt(data, tb, 1, 16);
+                rf_retry_t next = rf_retry_next(&rp, (res == 3) ? RF_FAIL_CRC : RF_FAIL_LENGTH);
+                if (next == RF_RETRY_RESEND) {
+                    continue;
+                }
+
+                if (next == RF_RETRY_RESELECT) {
+                    // the first WUPA only knocks an out of step card back to IDLE
+                    if ((iso14443a_fast_select_card(uid, cascade_levels) || iso14443a_fast_select_card(uid, cascade_levels)) &&
+                            mifare_classic_auth(pcs, cuid, FirstBlockOfSector(s), keytype, ui64Key, AUTH_FIRST) == 0) {
+                        continue;
+                    }
                 }
                 break;
             }
 
             // if we failed all retries,  notify client
-            if (r == MAX_RETRIES) {
+            if (done == false) {
                 retval |= PM3_EPARTIAL;
             }
         }
@@ -2485,6 +3597,20 @@ static void mf_reset_card(void) {
     iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
 }
 
+// wake the card again without dropping the field.  A card left in IDLE / HALT by a failed probe
+// answers WUPA straight away,  only fall back to a field reset when it doesn't
+static int mf_reselect_card(uint8_t *uid, iso14a_card_select_t *card, uint32_t *cuid, bool no_rats) {
+    int res = iso14443a_select_card(uid, card, cuid, true, 0, no_rats);
+    if (res == 0) {
+        mf_reset_card();
+        res = iso14443a_select_card(uid, card, cuid, true, 0, no_rats);
+    }
+    return res;
+}
+
+// Probes are ordered so one anticollision feeds the later decisions (SAK, ATS) and the field is
+// only reset where a probe leaves the card in a state WUPA can't get it out of:
+// gen1 backdoor,  ISO14443-4 after RATS.
 void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
     // variables
     uint8_t rec[1] = {0x00};
@@ -2501,6 +3627,7 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
     uint8_t *par = BigBuf_calloc(MAX_PARITY_SIZE);
     uint8_t *buf = BigBuf_calloc(PM3_CMD_DATA_SIZE);
     uint8_t *uid = BigBuf_calloc(10);
+    iso14a_card_select_t *card = (iso14a_card_select_t *)BigBuf_calloc(sizeof(iso14a_card_select_t));
     uint16_t flag = MAGIC_FLAG_NONE;
     uint32_t cuid = 0;
     int res = 0;
@@ -2522,12 +3649,26 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
         if (res > 1) {
             flag |= MAGIC_FLAG_GDM_WUP_40;
         }
+
+        // leave the backdoor mode
+        mf_reset_card();
+    }
+
+    // the only full anticollision,  everything below decides on this
+    int selected = iso14443a_select_card(uid, card, &cuid, true, 0, true);
+    if (selected == 0) {
+        mf_reset_card();
+        selected = iso14443a_select_card(uid, card, &cuid, true, 0, true);
     }
 
-    mf_reset_card();
+    // SAK says a MIFARE Classic (or Plus SL2) is answering,  crypto1 probes are pointless otherwise
+    bool sak_mfc = (card->sak & 0x18) || (card->sak == 0x01);
+
+    if (selected) {
+        if (cuid == 0xAA55C396) {
+            flag |= MAGIC_FLAG_GEN_UNFUSED;
+        }
 
-    res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
-    if (res) {
         // Check for Magic Gen4 GTU with default password:
         // Get config should return 30 or 32 bytes
         AddCrc14A(gen4GetConf, sizeof(gen4GetConf) - 2);
@@ -2536,20 +3677,14 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
         if (res == 32 || res == 34) {
             flag |= MAGIC_FLAG_GEN_4GTU;
         }
-    }
 
-    // reset card
-    mf_reset_card();
-
-    res = iso14443a_select_card(uid, NULL, &cuid, true, 0, false);
-    if (res) {
-        if (cuid == 0xAA55C396) {
-            flag |= MAGIC_FLAG_GEN_UNFUSED;
+        // a single RATS,  also catches the gen2 ones answering it with a MFC SAK
+        res = mf_reselect_card(uid, NULL, &cuid, true);
+        if (res) {
+            ReaderTransmit(rats, sizeof(rats), NULL);
+            res = ReaderReceive(buf, par);
         }
 
-        ReaderTransmit(rats, sizeof(rats), NULL);
-        res = ReaderReceive(buf, par);
-
         if (res) {
             if (memcmp(buf, "\x09\x78\x00\x91\x02\xDA\xBC\x19\x10", 9) == 0) {
                 // test for some MFC gen2
@@ -2602,11 +3737,12 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
             }
         }
 
+        // out of ISO14443-4,  the remaining probes only need a WUPA in between
+        mf_reset_card();
+
         if (is_mfc == false) {
             // magic ntag test
-            mf_reset_card();
-
-            res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+            res = mf_reselect_card(uid, NULL, &cuid, true);
             if (res == 2) {
                 ReaderTransmit(rdblf0, sizeof(rdblf0), NULL);
                 res = ReaderReceive(buf, par);
@@ -2614,39 +3750,14 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
                     flag |= MAGIC_FLAG_NTAG21X;
                 }
             }
-        } else {
+        } else if (sak_mfc) {
 
             struct Crypto1State mpcs = {0, 0};
             struct Crypto1State *pcs;
             pcs = &mpcs;
 
-            // CUID (with default sector 0 B key) test
-            // regular cards will NAK the WRITEBLOCK(0) command, while DirectWrite will ACK it
-            // if we do get an ACK, we immediately abort to ensure nothing is ever actually written
-            // only perform test if we haven't already identified Gen2.  No need test if we have a positive identification already
-            if (isGen2 == false) {
-                mf_reset_card();
-
-                res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
-                if (res) {
-
-                    uint64_t tmpkey = bytes_to_num(key, 6);
-                    if (mifare_classic_authex(pcs, cuid, 0, keytype, tmpkey, AUTH_FIRST, NULL, NULL) == 0) {
-
-                        if ((mifare_sendcmd_short(pcs, 1, ISO14443A_CMD_WRITEBLOCK, 0, buf, par, NULL) == 1) && (buf[0] == 0x0A)) {
-                            flag |= MAGIC_FLAG_GEN_2;
-                            // turn off immediately to ensure nothing ever accidentally writes to the block
-                            FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
-                        }
-                    }
-                    crypto1_deinit(pcs);
-                }
-            }
-
             // magic MFC Gen3 test 1
-            mf_reset_card();
-
-            res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+            res = mf_reselect_card(uid, NULL, &cuid, true);
             if (res) {
                 ReaderTransmit(rdbl00, sizeof(rdbl00), NULL);
                 res = ReaderReceive(buf, par);
@@ -2656,9 +3767,7 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
             }
 
             // magic MFC Gen4 GDM magic auth test
-            mf_reset_card();
-
-            res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+            res = mf_reselect_card(uid, NULL, &cuid, true);
             if (res) {
                 ReaderTransmit(gen4gdmAuth, sizeof(gen4gdmAuth), NULL);
                 res = ReaderReceive(buf, par);
@@ -2668,15 +3777,35 @@ void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key) {
             }
 
             // QL88 test
-            mf_reset_card();
-
-            res = iso14443a_select_card(uid, NULL, &cuid, true, 0, true);
+            res = mf_reselect_card(uid, NULL, &cuid, true);
             if (res) {
                 if (mifare_classic_authex(pcs, cuid, 68, MF_KEY_B, 0x707B11FC1481, AUTH_FIRST, NULL, NULL) == 0) {
                     flag |= MAGIC_FLAG_QL88;
                 }
                 crypto1_deinit(pcs);
             }
+
+            // CUID (with default sector 0 B key) test
+            // regular cards will NAK the WRITEBLOCK(0) command, while DirectWrite will ACK it
+            // if we do get an ACK, we immediately abort to ensure nothing is ever actually written
+            // only perform test if we haven't already identified Gen2.  No need test if we have a positive identification already
+            // last,  since an ACK drops the field
+            if (isGen2 == false) {
+                res = mf_reselect_card(uid, NULL, &cuid, true);
+                if (res) {
+
+                    uint64_t tmpkey = bytes_to_num(key, 6);
+                    if (mifare_classic_authex(pcs, cuid, 0, keytype, tmpkey, AUTH_FIRST, NULL, NULL) == 0) {
+
+                        if ((mifare_sendcmd_short(pcs, 1, ISO14443A_CMD_WRITEBLOCK, 0, buf, par, NULL) == 1) && (buf[0] == 0x0A)) {
+                            flag |= MAGIC_FLAG_GEN_2;
+                            // turn off immediately to ensure nothing ever accidentally writes to the block
+                            mf_reset_card();
+                        }
+                    }
+                    crypto1_deinit(pcs);
+                }
+            }
         }
     };
 
@@ -2757,6 +3886,78 @@ OUT:
     crypto1_deinit(pcs);
 }
 
+// The checks `hf 14a info` runs on every Classic,  static nonce, prng and the EV1 signature,
+// from one field on.  The card is woken with WUPA between the auth requests instead of a field
+// reset,  the last nonce doubles as the prng sample.
+// sigkey,  6 bytes key B of sector 17
+void MifareCapsProbe(const uint8_t *sigkey) {
+
+    FpgaWriteConfWord(FPGA_MAJOR_MODE_OFF);
+
+    mfc_caps_t caps = { .nonce = NONCE_FAIL };
+    int retval = PM3_SUCCESS;
+    uint32_t cuid = 0;
+    uint32_t nt = 0;
+    uint8_t *uid = BigBuf_calloc(10);
+
+    struct Crypto1State mpcs = {0, 0};
+    struct Crypto1State *pcs;
+    pcs = &mpcs;
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+
+    uint8_t counter = 0;
+    for (uint8_t i = 0; i < 3; i++) {
+
+        if (mf_reselect_card(uid, NULL, &cuid, true) == 0) {
+            retval = PM3_ESOFT;
+            goto OUT;
+        }
+
+        uint8_t rec[4] = {0x00};
+        uint8_t recpar[1] = {0x00};
+        // Transmit MIFARE_CLASSIC_AUTH 0x60, block 0
+        if (mifare_sendcmd_short(pcs, false, MIFARE_AUTH_KEYA, 0, rec, recpar, NULL) != 4) {
+            retval = PM3_ESOFT;
+            goto OUT;
+        }
+
+        if (nt == bytes_to_num(rec, 4)) {
+            counter++;
+        }
+        nt = bytes_to_num(rec, 4);
+
+        // no answer to the nonce,  the card falls back to IDLE
+        CHK_TIMEOUT();
+    }
+
+    if (counter) {
+        caps.nonce = NONCE_STATIC;
+    } else {
+        caps.nonce = NONCE_NORMAL;
+        caps.caps |= (validate_prng_nonce(nt)) ? MFC_CAPS_PRNG_WEAK : MFC_CAPS_PRNG_HARD;
+    }
+
+    // EV1 signature,  blocks 69 and 70 share sector 17
+    if (mf_reselect_card(uid, NULL, &cuid, true)) {
+        uint64_t key = bytes_to_num(sigkey, 6);
+        if (mifare_classic_authex(pcs, cuid, 69, MF_KEY_B, key, AUTH_FIRST, NULL, NULL) == 0) {
+            if (mifare_classic_readblock(pcs, 69, caps.signature) == 0 &&
+                    mifare_classic_readblock(pcs, 70, caps.signature + 16) == 0) {
+                caps.caps |= MFC_CAPS_SIGNATURE;
+            }
+        }
+        crypto1_deinit(pcs);
+    }
+
+OUT:
+    reply_ng(CMD_HF_MIFARE_CAPS_PROBE, retval, (uint8_t *)&caps, sizeof(caps));
+    // turns off
+    OnSuccessMagic();
+    BigBuf_free();
+    crypto1_deinit(pcs);
+}
+
 // FUDAN card w static encrypted nonces
 // 2B F9 1C 1B D5 08 48 48 03 A4 B1 B1 75 FF 2D 90
 //                         ^^                   ^^
@@ -19,28 +19,36 @@
 
 #include "common.h"
 #include "pm3_cmd.h"
+#include "mifare.h"
 
 int16_t mifare_cmd_readblocks(MifareWakeupType wakeup, uint8_t key_auth_cmd, uint8_t *key, uint8_t read_cmd, uint8_t block_no, uint8_t count, uint8_t *block_data);
 int16_t mifare_cmd_writeblocks(MifareWakeupType wakeup, uint8_t key_auth_cmd, uint8_t *key, uint8_t write_cmd, uint8_t block_no, uint8_t count, uint8_t *block_data);
 void MifareReadSector(uint8_t sector_no, uint8_t key_type, uint8_t *key);
+void MifareReadCard(uint8_t *datain);
 void MifareValue(uint8_t arg0, uint8_t arg1, uint8_t arg2, uint8_t *datain);
 
 void MifareUReadBlock(uint8_t arg0, uint8_t arg1, uint8_t *datain);
 void MifareUC_Auth(uint8_t arg0, uint8_t *keybytes);
 void MifareUL_AES_Auth(bool turn_off_field, uint8_t keyno, uint8_t *keybytes);
 
-void MifareUReadCard(uint8_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain);
+void MifareUReadCard(uint16_t arg0, uint16_t arg1, uint8_t arg2, uint8_t *datain);
 void MifareUWriteBlockCompat(uint8_t arg0, uint8_t arg1, uint8_t *datain);
 void MifareUWriteBlock(uint8_t arg0, uint8_t arg1, uint8_t *datain);
+void MifareUWritePages(uint8_t keytype, uint8_t *key, const uint8_t *uid, uint8_t uidlen, uint8_t start_page, uint8_t pages, uint8_t *data);
 
 void MifareNested(uint8_t blockNo, uint8_t keyType, uint8_t targetBlockNo, uint8_t targetKeyType, bool calibrate, uint8_t *key);
 void MifareStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t targetBlockNo, uint8_t targetKeyType, uint8_t *key);
 
 void MifareAcquireEncryptedNonces(uint32_t arg0, uint32_t arg1, uint32_t flags, uint8_t *datain);
 void MifareAcquireNonces(uint32_t arg0, uint32_t flags);
+void MifareCollect(const iso14a_collect_req_t *req);
 void MifareChkKeys(uint8_t *datain, uint8_t reserved_mem);
 void MifareChkKeys_fast(uint32_t arg0, uint32_t arg1, uint32_t arg2, uint8_t *datain);
+void MifareChkKeys_stream(uint8_t *datain);
+void MifareChkKeys_list(uint8_t *datain);
+void MifareChkKeys_gen(uint8_t *datain);
 void MifareChkKeys_file(uint8_t *fn);
+int MifareChkKeys_dict(uint8_t sectorcnt, uint8_t *keys, uint16_t keycnt, bool use_flashmem, uint8_t *sectorkeys, uint8_t *found);
 
 void MifareEMemClr(void);
 void MifareEMemGet(uint8_t blockno, uint8_t blockcnt);
@@ -52,6 +60,7 @@ void MifareCSetBlock(uint32_t arg0, uint32_t arg1, uint8_t *datain);  // Work wi
 void MifareCGetBlock(uint32_t arg0, uint32_t arg1, uint8_t *datain);
 void MifareCIdent(bool is_mfc, uint8_t keytype, uint8_t *key);  // is "magic chinese" card?
 void MifareHasStaticNonce(void);  // Has the tag a static nonce?
+void MifareCapsProbe(const uint8_t *sigkey);  // static nonce, prng and signature in one go
 void MifareHasStaticEncryptedNonce(uint8_t block_no, uint8_t key_type, uint8_t *key); // Has the tag a static encrypted nonce?
 
 // MFC GEN3
@@ -661,6 +661,291 @@ void MifareDES_Auth1(uint8_t *datain) {
 // cmd  =  cmd bytes to send
 // cmd_len = length of cmd
 // dataout = pointer to response data array
+// MIFARE Plus SL3 / DESFire EV1 dictionary check
+static uint8_t *chk_mfpdes_keys = NULL;
+static uint16_t chk_mfpdes_total = 0;
+
+static void chk_mfpdes_rnd(uint8_t *rnd, uint8_t len) {
+    for (uint8_t i = 0; i < len; i += 4) {
+        num_to_bytes(prng_successor(GetTickCount(), 32), 4, rnd + i);
+    }
+}
+
+static bool chk_mfpdes_select(bool desfire, const uint8_t *aid) {
+
+    pcb_blocknum = 0;
+
+    iso14a_card_select_t card;
+    if (iso14443a_select_card(NULL, &card, NULL, true, 0, false) == 0) {
+        return false;
+    }
+
+    if (desfire == false) {
+        return true;
+    }
+
+    uint8_t cmd[] = {0x90, MFDES_SELECT_APPLICATION, 0x00, 0x00, 0x03, aid[0], aid[1], aid[2], 0x00};
+    uint8_t resp[MAX_FRAME_SIZE] = {0};
+    int len = DesfireAPDU(cmd, sizeof(cmd), resp);
+    // PCB 91 00 CRC
+    return (len == 5 && resp[1] == 0x91 && resp[2] == MFDES_S_OPERATION_OK);
+}
+
+// 0 = valid key,  1 = wrong key,  2 = key not usable,  -1 = no answer
+static int chk_mfp_auth(uint16_t keynum, const uint8_t *key) {
+
+    uint8_t resp[MAX_FRAME_SIZE] = {0};
+    uint8_t cmd[1 + 32] = {0x70, keynum & 0xFF, keynum >> 8, 0x00};
+
+    // PCB 90 encRndB CRC
+    int len = DesfireAPDU(cmd, 4, resp);
+    if (len == 0) {
+        return -1;
+    }
+    if (len != 1 + 1 + 16 + 2 || resp[1] != 0x90) {
+        return 2;
+    }
+
+    uint8_t iv[16] = {0};
+    uint8_t rndb[16];
+    aes128_nxp_receive(resp + 2, rndb, 16, key, iv);
+
+    uint8_t raw[32];
+    uint8_t rnda[16];
+    chk_mfpdes_rnd(rnda, sizeof(rnda));
+    memcpy(raw, rnda, 16);
+    memcpy(raw + 16, rndb + 1, 15);
+    raw[31] = rndb[0];
+
+    cmd[0] = 0x72;
+    memset(iv, 0, sizeof(iv));
+    aes128_nxp_send(raw, cmd + 1, 32, key, iv);
+
+    // PCB 90 enc(TI PICCcap PCDcap rotRndA) CRC
+    len = DesfireAPDU(cmd, 33, resp);
+    if (len == 0) {
+        return -1;
+    }
+    if (len != 1 + 1 + 32 + 2 || resp[1] != 0x90) {
+        return 1;
+    }
+
+    memset(iv, 0, sizeof(iv));
+    aes128_nxp_receive(resp + 2, raw, 32, key, iv);
+    if (memcmp(raw + 4, rnda + 1, 15) || raw[19] != rnda[0]) {
+        return 1;
+    }
+    return 0;
+}
+
+static void chk_mfdes_dec(uint8_t algo, const uint8_t *key, const uint8_t *in, uint8_t *out, uint8_t len, uint8_t *iv) {
+    if (algo == MFDES_ALGO_AES) {
+        aes128_nxp_receive(in, out, len, key, iv);
+    } else {
+        tdes_nxp_receive(in, out, len, key, iv, (algo == MFDES_ALGO_3K3DES) ? 3 : 2);
+    }
+}
+
+static void chk_mfdes_enc(uint8_t algo, const uint8_t *key, uint8_t *in, uint8_t *out, uint8_t len, uint8_t *iv) {
+    if (algo == MFDES_ALGO_AES) {
+        aes128_nxp_send(in, out, len, key, iv);
+    } else {
+        tdes_nxp_send(in, out, len, key, iv, (algo == MFDES_ALGO_3K3DES) ? 3 : 2);
+    }
+}
+
+// EV1 ISO / AES authentication,  the IV is chained over all three crypto operations
+// 0 = valid key,  1 = wrong key,  2 = key not usable,  -1 = no answer
+static int chk_mfdes_auth(uint8_t algo, uint8_t keyno, const uint8_t *dictkey) {
+
+    // single DES is run as 2TDEA with K1 == K2
+    uint8_t key[24] = {0};
+    if (algo == MFDES_ALGO_DES) {
+        memcpy(key, dictkey, 8);
+        memcpy(key + 8, dictkey, 8);
+    } else {
+        memcpy(key, dictkey, (algo == MFDES_ALGO_3K3DES) ? 24 : 16);
+    }
+
+    uint8_t rndlen = (algo == MFDES_ALGO_AES || algo == MFDES_ALGO_3K3DES) ? 16 : 8;
+    uint8_t subcommand = (algo == MFDES_ALGO_AES) ? MFDES_AUTHENTICATE_AES : MFDES_AUTHENTICATE_ISO;
+
+    uint8_t resp[MAX_FRAME_SIZE] = {0};
+    uint8_t cmd[5 + 32 + 1] = {0x90, subcommand, 0x00, 0x00, 0x01, keyno, 0x00};
+
+    // PCB encRndB 91 AF CRC
+    int len = DesfireAPDU(cmd, 7, resp);
+    if (len == 0) {
+        return -1;
+    }
+    if (len != 1 + rndlen + 2 + 2 || resp[1 + rndlen] != 0x91 || resp[2 + rndlen] != MFDES_ADDITIONAL_FRAME) {
+        return 2;
+    }
+
+    uint8_t iv[16] = {0};
+    uint8_t rndb[16];
+    chk_mfdes_dec(algo, key, resp + 1, rndb, rndlen, iv);
+
+    uint8_t rnda[16];
+    uint8_t both[32];
+    chk_mfpdes_rnd(rnda, rndlen);
+    memcpy(both, rnda, rndlen);
+    memcpy(both + rndlen, rndb + 1, rndlen - 1);
+    both[rndlen * 2 - 1] = rndb[0];
+
+    cmd[1] = MFDES_ADDITIONAL_FRAME;
+    cmd[4] = rndlen * 2;
+    chk_mfdes_enc(algo, key, both, cmd + 5, rndlen * 2, iv);
+    cmd[5 + rndlen * 2] = 0x00;
+
+    // PCB encRndA' 91 00 CRC
+    len = DesfireAPDU(cmd, 5 + rndlen * 2 + 1, resp);
+    if (len == 0) {
+        return -1;
+    }
+    if (len != 1 + rndlen + 2 + 2 || resp[1 + rndlen] != 0x91 || resp[2 + rndlen] != MFDES_S_OPERATION_OK) {
+        return 1;
+    }
+
+    chk_mfdes_dec(algo, key, resp + 1, both, rndlen, iv);
+    if (memcmp(both, rnda + 1, rndlen - 1) || both[rndlen - 1] != rnda[0]) {
+        return 1;
+    }
+    return 0;
+}
+
+static int chk_mfpdes_run(uint16_t cmd, bool desfire, const mfpdes_chk_chunk_t *chunk) {
+
+    if (chk_mfpdes_select(desfire, chunk->aid) == false) {
+        return PM3_ECARDEXCHANGE;
+    }
+
+    for (uint8_t slot = 0; slot < 128; slot++) {
+
+        if ((chunk->slots[slot / 8] & (1 << (slot % 8))) == 0) {
+            continue;
+        }
+
+        mfpdes_chk_reply_t payload = { .done = 0, .slot = slot, .index = -1, .tested = 0 };
+
+        for (uint16_t i = 0; i < chk_mfpdes_total; i++) {
+
+            WDT_HIT();
+
+            if (BUTTON_PRESS() || data_available()) {
+                return PM3_EOPABORTED;
+            }
+
+            const uint8_t *key = chk_mfpdes_keys + (i * chunk->keylen);
+
+            int res = 0;
+            for (uint8_t retry = 0; retry < 4; retry++) {
+                if (desfire) {
+                    res = chk_mfdes_auth(chunk->algo, slot, key);
+                } else {
+                    res = chk_mfp_auth(0x4000 + slot, key);
+                }
+                if (res != -1) {
+                    break;
+                }
+                chk_mfpdes_select(desfire, chunk->aid);
+            }
+
+            if (res == -1) {
+                return PM3_ECARDEXCHANGE;
+            }
+
+            payload.tested++;
+
+            if (res == 0) {
+                payload.index = i;
+                if (g_dbglevel >= DBG_INFO) Dbprintf("slot %u, found key " _YELLOW_("%u"), slot, i);
+                break;
+            }
+
+            // key number does not exist or is not allowed,  no need to try the rest
+            if (res == 2) {
+                break;
+            }
+        }
+
+        reply_ng(cmd, PM3_SUCCESS, (uint8_t *)&payload, sizeof(payload));
+
+        // drop the authenticated state,  or the error state of a refused key number
+        if (payload.index != -1 || (desfire == false && payload.tested < chk_mfpdes_total)) {
+            if (chk_mfpdes_select(desfire, chunk->aid) == false) {
+                return PM3_ECARDEXCHANGE;
+            }
+        }
+    }
+    return PM3_SUCCESS;
+}
+
+static void chk_mfpdes_chunk(uint16_t cmd, bool desfire, uint8_t *datain) {
+
+    mfpdes_chk_chunk_t *chunk = (mfpdes_chk_chunk_t *)datain;
+
+    if (chunk->keylen != 8 && chunk->keylen != 16 && chunk->keylen != 24) {
+        reply_ng(cmd, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    if (chunk->flags & MFPDES_CHK_FIRST) {
+        BigBuf_free();
+        BigBuf_Clear_ext(false);
+        chk_mfpdes_keys = NULL;
+        chk_mfpdes_total = 0;
+        if ((uint32_t)chunk->total * chunk->keylen <= UINT16_MAX) {
+            chk_mfpdes_keys = BigBuf_malloc(chunk->total * chunk->keylen);
+        }
+        if (chk_mfpdes_keys == NULL) {
+            reply_ng(cmd, PM3_EMALLOC, NULL, 0);
+            return;
+        }
+        chk_mfpdes_total = chunk->total;
+    }
+
+    if (chk_mfpdes_keys == NULL
+            || chunk->keycnt * chunk->keylen > MFPDES_CHK_DATA
+            || chunk->offset + chunk->keycnt > chk_mfpdes_total) {
+        reply_ng(cmd, PM3_EINVARG, NULL, 0);
+        return;
+    }
+
+    memcpy(chk_mfpdes_keys + (chunk->offset * chunk->keylen), chunk->keys, chunk->keycnt * chunk->keylen);
+
+    if ((chunk->flags & MFPDES_CHK_LAST) == 0) {
+        reply_ng(cmd, PM3_SUCCESS, NULL, 0);
+        return;
+    }
+
+    LEDsoff();
+    LED_A_ON();
+
+    iso14443a_setup(FPGA_HF_ISO14443A_READER_LISTEN);
+    set_tracing(false);
+
+    int res = chk_mfpdes_run(cmd, desfire, chunk);
+
+    mfpdes_chk_reply_t payload = { .done = 1, .slot = 0, .index = -1, .tested = 0 };
+    reply_ng(cmd, res, (uint8_t *)&payload, sizeof(payload));
+
+    chk_mfpdes_keys = NULL;
+    chk_mfpdes_total = 0;
+    pcb_blocknum = 0;
+    switch_off();
+    BigBuf_free();
+    BigBuf_Clear_ext(false);
+}
+
+void MifarePlusChkKeys(uint8_t *datain) {
+    chk_mfpdes_chunk(CMD_HF_MFP_CHKKEYS, false, datain);
+}
+
+void MifareDesfireChkKeys(uint8_t *datain) {
+    chk_mfpdes_chunk(CMD_HF_DESFIRE_CHKKEYS, true, datain);
+}
+
 int DesfireAPDU(uint8_t *cmd, size_t cmd_len, uint8_t *dataout) {
 
     size_t len = 0;
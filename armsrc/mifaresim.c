@@ -43,24 +43,55 @@
 #include "util.h"
 #include "commonutil.h"
 #include "crc16.h"
+#include "parity.h"
 #include "dbprint.h"
 #include "ticks.h"
+#include "simstats.h"
 
-static bool IsKeyBReadable(uint8_t blockNo) {
+// Access conditions of every sector, decoded from the trailers in emulator memory.
+// Three bits C1 C2 C3 per block group, bits 0-2 group 0 ... bits 9-11 sector trailer.
+// Filled at simulation start and refreshed whenever a sector trailer is written.
+static uint16_t gs_sector_ac[MIFARE_4K_MAXSECTOR];
+
+static uint8_t SectorOfBlock(uint8_t blockNo) {
+    if (blockNo < MIFARE_2K_MAXBLOCK) {
+        return blockNo >> 2;
+    }
+    return MIFARE_2K_MAXSECTOR + ((blockNo - MIFARE_2K_MAXBLOCK) >> 4);
+}
+
+static void DecodeSectorAccess(uint8_t sectorNo) {
     uint8_t sector_trailer[16];
-    emlGetMem(sector_trailer, SectorTrailer(blockNo), 1);
-    uint8_t AC = ((sector_trailer[7] >> 5) & 0x04)
-                 | ((sector_trailer[8] >> 2) & 0x02)
-                 | ((sector_trailer[8] >> 7) & 0x01);
+    emlGetMem(sector_trailer, FirstBlockOfSector(sectorNo) + NumBlocksPerSector(sectorNo) - 1, 1);
+
+    uint16_t ac = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t c = (((sector_trailer[7] >> (4 + i)) & 0x01) << 2)
+                    | (((sector_trailer[8] >> i) & 0x01) << 1)
+                    | ((sector_trailer[8] >> (4 + i)) & 0x01);
+        ac |= (c << (3 * i));
+    }
+    gs_sector_ac[sectorNo] = ac;
+}
+
+static void DecodeAllSectorAccess(void) {
+    for (uint8_t i = 0; i < MIFARE_4K_MAXSECTOR; i++) {
+        DecodeSectorAccess(i);
+    }
+}
+
+// access bits of block group 0..2, or 3 for the sector trailer
+static uint8_t SectorAccessBits(uint8_t blockNo, uint8_t group) {
+    return (gs_sector_ac[SectorOfBlock(blockNo)] >> (3 * group)) & 0x07;
+}
+
+static bool IsKeyBReadable(uint8_t blockNo) {
+    uint8_t AC = SectorAccessBits(blockNo, 3);
     return (AC == 0x00 || AC == 0x01 || AC == 0x02);
 }
 
 static bool IsTrailerAccessAllowed(uint8_t blockNo, uint8_t keytype, uint8_t action) {
-    uint8_t sector_trailer[16];
-    emlGetMem(sector_trailer, blockNo, 1);
-    uint8_t AC = ((sector_trailer[7] >> 5) & 0x04)
-                 | ((sector_trailer[8] >> 2) & 0x02)
-                 | ((sector_trailer[8] >> 7) & 0x01);
+    uint8_t AC = SectorAccessBits(blockNo, 3);
     switch (action) {
         case AC_KEYA_READ: {
             if (g_dbglevel >= DBG_EXTENDED)
@@ -103,9 +134,6 @@ static bool IsTrailerAccessAllowed(uint8_t blockNo, uint8_t keytype, uint8_t act
 
 static bool IsDataAccessAllowed(uint8_t blockNo, uint8_t keytype, uint8_t action) {
 
-    uint8_t sector_trailer[16];
-    emlGetMem(sector_trailer, SectorTrailer(blockNo), 1);
-
     uint8_t sector_block;
     if (blockNo <= MIFARE_2K_MAXBLOCK) {
         sector_block = blockNo & 0x03;
@@ -113,38 +141,16 @@ static bool IsDataAccessAllowed(uint8_t blockNo, uint8_t keytype, uint8_t action
         sector_block = (blockNo & 0x0f) / 5;
     }
 
-    uint8_t AC;
-    switch (sector_block) {
-        case 0x00: {
-            AC = ((sector_trailer[7] >> 2) & 0x04)
-                 | ((sector_trailer[8] << 1) & 0x02)
-                 | ((sector_trailer[8] >> 4) & 0x01);
-            if (g_dbglevel >= DBG_EXTENDED)
-                Dbprintf("IsDataAccessAllowed: case 0x00 - %02x", AC);
-            break;
-        }
-        case 0x01: {
-            AC = ((sector_trailer[7] >> 3) & 0x04)
-                 | ((sector_trailer[8] >> 0) & 0x02)
-                 | ((sector_trailer[8] >> 5) & 0x01);
-            if (g_dbglevel >= DBG_EXTENDED)
-                Dbprintf("IsDataAccessAllowed: case 0x01 - %02x", AC);
-            break;
-        }
-        case 0x02: {
-            AC = ((sector_trailer[7] >> 4) & 0x04)
-                 | ((sector_trailer[8] >> 1) & 0x02)
-                 | ((sector_trailer[8] >> 6) & 0x01);
-            if (g_dbglevel >= DBG_EXTENDED)
-                Dbprintf("IsDataAccessAllowed: case 0x02  - %02x", AC);
-            break;
-        }
-        default:
-            if (g_dbglevel >= DBG_EXTENDED)
-                Dbprintf("IsDataAccessAllowed: Error");
-            return false;
+    if (sector_block > 0x02) {
+        if (g_dbglevel >= DBG_EXTENDED)
+            Dbprintf("IsDataAccessAllowed: Error");
+        return false;
     }
 
+    uint8_t AC = SectorAccessBits(blockNo, sector_block);
+    if (g_dbglevel >= DBG_EXTENDED)
+        Dbprintf("IsDataAccessAllowed: case 0x%02x - %02x", sector_block, AC);
+
     switch (action) {
         case AC_DATA_READ: {
             if (g_dbglevel >= DBG_EXTENDED)
@@ -183,6 +189,43 @@ static bool IsAccessAllowed(uint8_t blockNo, uint8_t keytype, uint8_t action) {
     }
 }
 
+// Crypto1 runs without feedback once authenticated, so the keystream of the next
+// reader frame and of the answer to it only depend on the current cipher state.
+// It is prepared between frames for the common case, a 4 byte command answered
+// by an 18 byte block, leaving just the XOR for when the command has arrived.
+typedef struct {
+    bool valid;
+    uint8_t ks[4 + MAX_MIFARE_FRAME_SIZE];
+    uint8_t par[MAX_MIFARE_PARITY_SIZE];  // filter bit after each answer byte
+    struct Crypto1State after_cmd;
+    struct Crypto1State after_answer;
+} mfsim_keystream_t;
+
+static void MifareSimPrepareKeystream(const struct Crypto1State *pcs, mfsim_keystream_t *k) {
+    struct Crypto1State s = *pcs;
+    for (uint8_t i = 0; i < 4; i++) {
+        k->ks[i] = crypto1_byte(&s, 0x00, 0);
+    }
+    k->after_cmd = s;
+
+    memset(k->par, 0, sizeof(k->par));
+    for (uint8_t i = 0; i < MAX_MIFARE_FRAME_SIZE; i++) {
+        k->ks[4 + i] = crypto1_byte(&s, 0x00, 0);
+        k->par[i >> 3] |= ((filter(s.odd) & 0x01) << (7 - (i & 0x07)));
+    }
+    k->after_answer = s;
+    k->valid = true;
+}
+
+// same result as mf_crypto1_encrypt() on an 18 byte answer
+static void MifareSimEncryptAnswer(const mfsim_keystream_t *k, uint8_t *data, uint8_t *par) {
+    memcpy(par, k->par, MAX_MIFARE_PARITY_SIZE);
+    for (uint8_t i = 0; i < MAX_MIFARE_FRAME_SIZE; i++) {
+        par[i >> 3] ^= ((oddparity8(data[i]) & 0x01) << (7 - (i & 0x07)));
+        data[i] ^= k->ks[4 + i];
+    }
+}
+
 static bool MifareSimInit(uint16_t flags, uint8_t *datain, uint16_t atqa, uint8_t sak, tag_response_info_t **responses, uint32_t *cuid, uint8_t *uid_len, uint8_t **rats, uint8_t *rats_len) {
 
     // SPEC: https://www.nxp.com/docs/en/application-note/AN10833.pdf
@@ -447,6 +490,7 @@ static bool MifareSimInit(uint16_t flags, uint8_t *datain, uint16_t atqa, uint8_
 #define UIDBCC2  8
 #define UIDBCC3  13
 
+    DecodeAllSectorAccess();
     return true;
 }
 
@@ -482,6 +526,7 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
     struct Crypto1State mpcs = {0, 0};
     struct Crypto1State *pcs;
     pcs = &mpcs;
+    mfsim_keystream_t next_ks = { .valid = false };
 
     uint32_t numReads = 0; //Counts numer of times reader reads a block
     uint8_t receivedCmd[MAX_MIFARE_FRAME_SIZE] = {0x00};
@@ -542,6 +587,8 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
     LED_D_ON();
     ResetSspClk();
 
+    sim_stats_start(SIM_STATS_MFC, SIM_STATS_BUDGET_14A_US);
+
     uint8_t *p_em = BigBuf_get_EM_addr();
     uint8_t cve_flipper = 0;
 
@@ -577,6 +624,13 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
                 }
                 */
 
+        // get the keystream ready before the reader talks
+        if (cardSTATE == MFEMUL_WORK && cardAUTHKEY != AUTHKEYNONE) {
+            MifareSimPrepareKeystream(pcs, &next_ks);
+        } else {
+            next_ks.valid = false;
+        }
+
         FpgaEnableTracing();
         //Now, get data
         int res = EmGetCmd(receivedCmd, &receivedCmd_len, receivedCmd_par);
@@ -753,7 +807,14 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
                 }
 
                 encrypted_data = (cardAUTHKEY != AUTHKEYNONE);
-                if (encrypted_data) {
+                if (encrypted_data && next_ks.valid && receivedCmd_len == 4) {
+                    // decrypt with the prepared keystream
+                    for (uint8_t i = 0; i < 4; i++) {
+                        receivedCmd_dec[i] = receivedCmd[i] ^ next_ks.ks[i];
+                    }
+                    *pcs = next_ks.after_cmd;
+                } else if (encrypted_data) {
+                    next_ks.valid = false;
                     // decrypt seqence
                     mf_crypto1_decryptEx(pcs, receivedCmd, receivedCmd_len, receivedCmd_dec);
                     if (g_dbglevel >= DBG_EXTENDED) Dbprintf("[MFEMUL_WORK] Decrypt sequence");
@@ -764,6 +825,7 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
 
                 // all commands must have a valid CRC
                 if (!CheckCrc14A(receivedCmd_dec, receivedCmd_len)) {
+                    sim_stats_frame_error();
                     EmSend4bit(encrypted_data ? mf_crypto1_encrypt4bit(pcs, CARD_NACK_NA) : CARD_NACK_NA);
                     FpgaDisableTracing();
 
@@ -983,7 +1045,13 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
                         }
                     }
                     AddCrc14A(response, 16);
-                    mf_crypto1_encrypt(pcs, response, MAX_MIFARE_FRAME_SIZE, response_par);
+                    if (next_ks.valid) {
+                        MifareSimEncryptAnswer(&next_ks, response, response_par);
+                        *pcs = next_ks.after_answer;
+                        next_ks.valid = false;
+                    } else {
+                        mf_crypto1_encrypt(pcs, response, MAX_MIFARE_FRAME_SIZE, response_par);
+                    }
                     EmSendCmdPar(response, MAX_MIFARE_FRAME_SIZE, response_par);
                     FpgaDisableTracing();
 
@@ -1057,6 +1125,9 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
                     blockNo = receivedCmd_dec[1];
                     if (g_dbglevel >= DBG_EXTENDED) Dbprintf("[MFEMUL_WORK] RECV 0x%02x transfer block %d (%02x)", receivedCmd_dec[0], blockNo, blockNo);
                     emlSetValBl(cardINTREG, cardINTBLOCK, receivedCmd_dec[1]);
+                    if (IsSectorTrailer(blockNo)) {
+                        DecodeSectorAccess(SectorOfBlock(blockNo));
+                    }
                     EmSend4bit(mf_crypto1_encrypt4bit(pcs, CARD_ACK));
                     FpgaDisableTracing();
                     break;
@@ -1277,6 +1348,9 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
                             }
                         }
                         emlSetMem_xt(receivedCmd_dec, cardWRBL, 1, 16);
+                        if (IsSectorTrailer(cardWRBL)) {
+                            DecodeSectorAccess(SectorOfBlock(cardWRBL));
+                        }
                         EmSend4bit(mf_crypto1_encrypt4bit(pcs, CARD_ACK)); // always ACK?
                         FpgaDisableTracing();
 
@@ -1398,6 +1472,7 @@ void Mifare1ksim(uint16_t flags, uint8_t exitAfterNReads, uint8_t *datain, uint1
     if (g_dbglevel >= DBG_ERROR) {
         Dbprintf("Emulator stopped. Tracing: %d  trace length: %d ", get_tracing(), BigBuf_get_traceLen());
     }
+    sim_stats_stop();
 
     if ((flags & FLAG_INTERACTIVE) == FLAG_INTERACTIVE) {  // Interactive mode flag, means we need to send ACK
         //Send the collected ar_nr in the response
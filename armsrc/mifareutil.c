@@ -29,6 +29,7 @@
 #include "crc16.h"
 #include "protocols.h"
 #include "desfire_crypto.h"
+#include "perf.h"
 
 // crypto1 helpers
 void mf_crypto1_decryptEx(struct Crypto1State *pcs, const uint8_t *data_in, int len, uint8_t *data_out) {
@@ -144,7 +145,7 @@ int mifare_classic_auth(struct Crypto1State *pcs, uint32_t uid, uint8_t blockNo,
 int mifare_classic_authex(struct Crypto1State *pcs, uint32_t uid, uint8_t blockNo, uint8_t keyType, uint64_t ui64Key, uint8_t isNested, uint32_t *ntptr, uint32_t *timing) {
     return mifare_classic_authex_cmd(pcs, uid, blockNo, (keyType & 1) ? MIFARE_AUTH_KEYB : MIFARE_AUTH_KEYA, ui64Key, isNested, ntptr, NULL, timing);
 }
-int mifare_classic_authex_cmd(struct Crypto1State *pcs, uint32_t uid, uint8_t blockNo, uint8_t cmd, uint64_t ui64Key, uint8_t isNested, uint32_t *ntptr, uint32_t *ntencptr, uint32_t *timing) {
+static int mifare_classic_authex_cmd_impl(struct Crypto1State *pcs, uint32_t uid, uint8_t blockNo, uint8_t cmd, uint64_t ui64Key, uint8_t isNested, uint32_t *ntptr, uint32_t *ntencptr, uint32_t *timing) {
 
     // "random" reader nonce:
     uint8_t nr[4];
@@ -233,6 +234,13 @@ int mifare_classic_authex_cmd(struct Crypto1State *pcs, uint32_t uid, uint8_t bl
     return 0;
 }
 
+int mifare_classic_authex_cmd(struct Crypto1State *pcs, uint32_t uid, uint8_t blockNo, uint8_t cmd, uint64_t ui64Key, uint8_t isNested, uint32_t *ntptr, uint32_t *ntencptr, uint32_t *timing) {
+    uint32_t perf = PERF_START();
+    int res = mifare_classic_authex_cmd_impl(pcs, uid, blockNo, cmd, ui64Key, isNested, ntptr, ntencptr, timing);
+    perf_record(PERF_MFC_AUTH, perf);
+    return res;
+}
+
 int mifare_classic_readblock(struct Crypto1State *pcs, uint8_t blockNo, uint8_t *blockData) {
     return mifare_classic_readblock_ex(pcs, blockNo, blockData, ISO14443A_CMD_READBLOCK);
 }
@@ -509,6 +517,38 @@ int mifare_ultra_readblock(uint8_t blockNo, uint8_t *blockData) {
     return res;
 }
 
+// FAST_READ (UL EV1 / NTAG) of pages startPage..endPage inclusive.
+// The answer must fit one frame, ie at most (MAX_FRAME_SIZE - 2) / 4 pages.
+// A NACK leaves the tag in IDLE, the caller has to select it again.
+int mifare_ultra_fastread(uint8_t startPage, uint8_t endPage, uint8_t *blockData) {
+    uint8_t receivedAnswer[MAX_FRAME_SIZE] = {0x00};
+    uint8_t receivedAnswerPar[MAX_PARITY_SIZE] = {0x00};
+    uint8_t range[2] = {startPage, endPage};
+
+    uint16_t bytes = ((endPage - startPage) + 1) * 4;
+    if (endPage < startPage || bytes + 2 > MAX_FRAME_SIZE) {
+        return 4;
+    }
+
+    uint16_t len = mifare_sendcmd(MIFARE_ULEV1_FASTREAD, range, sizeof(range), receivedAnswer, receivedAnswerPar, NULL);
+    if (len == 1) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Cmd Error: %02x", receivedAnswer[0]);
+        return 1;
+    }
+    if (len != bytes + 2) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Cmd Error: card timeout. len: %x", len);
+        return 2;
+    }
+
+    if (CheckCrc14A(receivedAnswer, len) == false) {
+        if (g_dbglevel >= DBG_ERROR) Dbprintf("Cmd CRC response error.");
+        return 3;
+    }
+
+    memcpy(blockData, receivedAnswer, bytes);
+    return 0;
+}
+
 int mifare_classic_writeblock(struct Crypto1State *pcs, uint8_t blockNo, uint8_t *blockData) {
     return mifare_classic_writeblock_ex(pcs, blockNo, blockData, ISO14443A_CMD_WRITEBLOCK);
 }
@@ -24,10 +24,29 @@
 #include "util.h"
 #include "lfsampling.h"
 #include "string.h"
+#include "lfdemod.h"
 
 #define T0_PCF 8 //period for the pcf7931 in us
 #define ALLOC 16
 
+// The samples are demodulated while they come in.  Sampling ends with the fourth block, on too many
+// detection errors or after PCF7931_MAX_SAMPLES, instead of filling BigBuf first and decoding after.
+// The samples are still kept in BigBuf.
+#define PCF7931_MAX_SAMPLES     18000
+// samples used to find the DC offset before the demodulation starts
+#define PCF7931_OFFSET_SAMPLES  1024
+
+static uint8_t pcf7931_shift(int sample, int offset) {
+    sample -= offset;
+    if (sample < 0) {
+        return 0;
+    }
+    if (sample > 255) {
+        return 255;
+    }
+    return sample;
+}
+
 size_t DemodPCF7931(uint8_t **outBlocks, bool ledcontrol) {
 
     // 2021 iceman, memor
@@ -37,128 +56,176 @@ size_t DemodPCF7931(uint8_t **outBlocks, bool ledcontrol) {
     uint8_t *dest = BigBuf_get_addr();
 
     int g_GraphTraceLen = BigBuf_max_traceLen();
-    if (g_GraphTraceLen > 18000) {
-        g_GraphTraceLen = 18000;
+    if (g_GraphTraceLen > PCF7931_MAX_SAMPLES) {
+        g_GraphTraceLen = PCF7931_MAX_SAMPLES;
     }
 
-    int i = 2, j, lastval, bitidx, half_switch;
+    int i = 2, j, lastval = 0, bitidx = 0, half_switch = 0;
     int clock = 64;
     int tolerance = clock / 8;
-    int pmc, block_done;
+    int pmc = 0, block_done = 0;
     int lc, warnings = 0;
     size_t num_blocks = 0;
     int lmin = 64, lmax = 192;
-    uint8_t dir;
+    uint8_t dir = 0;
+
+    // number of samples in dest,  the demodulator runs on dest[i] with i < filled
+    int filled = 0;
+    int offset = 0;
+    bool first_found = false;
+    // a PMC skipped ahead of the samples,  direction is taken once they arrive
+    bool resync_dir = false;
 
     BigBuf_Clear_keep_EM();
     LFSetupFPGAForADC(LF_DIVISOR_125, true);
-    DoAcquisition_default(0, true, ledcontrol);
 
-    /* Find first local max/min */
-    if (dest[1] > dest[0]) {
-        while (i < g_GraphTraceLen) {
-            if (!(dest[i] > dest[i - 1]) && dest[i] > lmax) {
-                break;
-            }
-            i++;
+    if (ledcontrol) LED_D_ON();
+
+    while (filled < g_GraphTraceLen && num_blocks < 4 && BUTTON_PRESS() == false) {
+
+        WDT_HIT();
+
+        if ((AT91C_BASE_SSC->SSC_SR & AT91C_SSC_RXRDY) == 0) {
+            continue;
         }
-        dir = 0;
-    } else {
-        while (i < g_GraphTraceLen) {
-            if (!(dest[i] < dest[i - 1]) && dest[i] < lmin) {
-                break;
+
+        uint8_t sample = (uint8_t)AT91C_BASE_SSC->SSC_RHR;
+
+        if (filled < PCF7931_OFFSET_SAMPLES) {
+            dest[filled++] = sample;
+
+            if (filled == PCF7931_OFFSET_SAMPLES) {
+                // same centering as the full acquisition did,  later samples get the same shift
+                for (int k = SIGNAL_IGNORE_FIRST_SAMPLES; k < filled; k++) {
+                    offset += dest[k] - 128;
+                }
+                offset /= (filled - SIGNAL_IGNORE_FIRST_SAMPLES);
+
+                for (int k = 0; k < filled; k++) {
+                    dest[k] = pcf7931_shift(dest[k], offset);
+                }
+            } else {
+                continue;
             }
-            i++;
+        } else {
+            dest[filled++] = pcf7931_shift(sample, offset);
         }
-        dir = 1;
-    }
 
-    lastval = i++;
-    half_switch = 0;
-    pmc = 0;
-    block_done = 0;
+        while (i < filled) {
 
-    for (bitidx = 0; i < g_GraphTraceLen; i++) {
+            /* Find first local max/min */
+            if (first_found == false) {
+                dir = (dest[1] > dest[0]) ? 0 : 1;
+                if ((dir == 0 && !(dest[i] > dest[i - 1]) && dest[i] > lmax) ||
+                        (dir == 1 && !(dest[i] < dest[i - 1]) && dest[i] < lmin)) {
+                    first_found = true;
+                    lastval = i;
+                }
+                i++;
+                continue;
+            }
 
-        if ((dest[i - 1] > dest[i] && dir == 1 && dest[i] > lmax) || (dest[i - 1] < dest[i] && dir == 0 && dest[i] < lmin)) {
-            lc = i - lastval;
-            lastval = i;
+            if (resync_dir) {
+                dir = (dest[i - 1] > dest[i]) ? 0 : 1;
+                resync_dir = false;
+                i++;
+                continue;
+            }
 
-            // Switch depending on lc length:
-            // Tolerance is 1/8 of clock rate (arbitrary)
-            if (ABS(lc - clock / 4) < tolerance) {
-                // 16T0
-                if ((i - pmc) == lc) { // 16T0 was previous one
-                    // It's a PMC
-                    i += (128 + 127 + 16 + 32 + 33 + 16) - 1;
-                    lastval = i;
-                    pmc = 0;
-                    block_done = 1;
+            if ((dest[i - 1] > dest[i] && dir == 1 && dest[i] > lmax) || (dest[i - 1] < dest[i] && dir == 0 && dest[i] < lmin)) {
+                lc = i - lastval;
+                lastval = i;
+
+                // Switch depending on lc length:
+                // Tolerance is 1/8 of clock rate (arbitrary)
+                if (ABS(lc - clock / 4) < tolerance) {
+                    // 16T0
+                    if ((i - pmc) == lc) { // 16T0 was previous one
+                        // It's a PMC
+                        i += (128 + 127 + 16 + 32 + 33 + 16) - 1;
+                        lastval = i;
+                        pmc = 0;
+                        block_done = 1;
+                    } else {
+                        pmc = i;
+                    }
+                } else if (ABS(lc - clock / 2) < tolerance) {
+                    // 32TO
+                    if ((i - pmc) == lc) { // 16T0 was previous one
+                        // It's a PMC !
+                        i += (128 + 127 + 16 + 32 + 33) - 1;
+                        lastval = i;
+                        pmc = 0;
+                        block_done = 1;
+                    } else if (half_switch == 1) {
+                        bits[bitidx++] = 0;
+                        half_switch = 0;
+                    } else
+                        half_switch++;
+                } else if (ABS(lc - clock) < tolerance) {
+                    // 64TO
+                    bits[bitidx++] = 1;
                 } else {
-                    pmc = i;
+                    // Error
+                    if (++warnings > 10) {
+
+                        if (g_dbglevel >= DBG_EXTENDED) {
+                            Dbprintf("Error: too many detection errors, aborting after %d samples", filled);
+                        }
+
+                        if (ledcontrol) LED_D_OFF();
+                        return 0;
+                    }
                 }
-            } else if (ABS(lc - clock / 2) < tolerance) {
-                // 32TO
-                if ((i - pmc) == lc) { // 16T0 was previous one
-                    // It's a PMC !
-                    i += (128 + 127 + 16 + 32 + 33) - 1;
-                    lastval = i;
-                    pmc = 0;
-                    block_done = 1;
-                } else if (half_switch == 1) {
-                    bits[bitidx++] = 0;
-                    half_switch = 0;
-                } else
-                    half_switch++;
-            } else if (ABS(lc - clock) < tolerance) {
-                // 64TO
-                bits[bitidx++] = 1;
-            } else {
-                // Error
-                if (++warnings > 10) {
 
-                    if (g_dbglevel >= DBG_EXTENDED) {
-                        Dbprintf("Error: too many detection errors, aborting");
+                if (block_done == 1) {
+                    if (bitidx == 128) {
+                        for (j = 0; j < 16; ++j) {
+                            blocks[num_blocks][j] =
+                                128 * bits[j * 8 + 7] +
+                                64 * bits[j * 8 + 6] +
+                                32 * bits[j * 8 + 5] +
+                                16 * bits[j * 8 + 4] +
+                                8 * bits[j * 8 + 3] +
+                                4 * bits[j * 8 + 2] +
+                                2 * bits[j * 8 + 1] +
+                                bits[j * 8]
+                                ;
+                        }
+                        num_blocks++;
                     }
+                    bitidx = 0;
+                    block_done = 0;
+                    half_switch = 0;
+                }
 
-                    return 0;
+                if (i < filled) {
+                    dir = (dest[i - 1] > dest[i]) ? 0 : 1;
+                } else {
+                    resync_dir = true;
                 }
             }
 
-            if (block_done == 1) {
-                if (bitidx == 128) {
-                    for (j = 0; j < 16; ++j) {
-                        blocks[num_blocks][j] =
-                            128 * bits[j * 8 + 7] +
-                            64 * bits[j * 8 + 6] +
-                            32 * bits[j * 8 + 5] +
-                            16 * bits[j * 8 + 4] +
-                            8 * bits[j * 8 + 3] +
-                            4 * bits[j * 8 + 2] +
-                            2 * bits[j * 8 + 1] +
-                            bits[j * 8]
-                            ;
-                    }
-                    num_blocks++;
-                }
+            if (bitidx == 255) {
                 bitidx = 0;
-                block_done = 0;
-                half_switch = 0;
             }
 
-            if (i < g_GraphTraceLen) {
-                dir = (dest[i - 1] > dest[i]) ? 0 : 1;
+            if (num_blocks == 4) {
+                break;
             }
-        }
 
-        if (bitidx == 255) {
-            bitidx = 0;
+            if (resync_dir == false) {
+                i++;
+            }
         }
+    }
 
-        if (num_blocks == 4) {
-            break;
-        }
+    if (ledcontrol) LED_D_OFF();
+
+    if (g_dbglevel >= DBG_EXTENDED) {
+        Dbprintf("PCF7931 demod, %zu blocks in %d samples", num_blocks, filled);
     }
+
     memcpy(outBlocks, blocks, 16 * num_blocks);
     return num_blocks;
 }
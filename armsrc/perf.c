@@ -0,0 +1,70 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Entry / exit duration counters for hot paths, reported by `hw perf`
+//-----------------------------------------------------------------------------
+#include "perf.h"
+
+#include "proxmark3_arm.h"
+#include "cmd.h"
+#include "string.h"
+
+static perf_counter_t perf_counters[PERF_MAX];
+static uint32_t perf_last_ticks[PERF_MAX];
+
+void perf_reset(void) {
+    memset(perf_counters, 0, sizeof(perf_counters));
+    for (uint8_t i = 0; i < PERF_MAX; i++) {
+        perf_counters[i].min = UINT32_MAX;
+    }
+}
+
+void perf_init(void) {
+    StartCountPerf();
+    perf_reset();
+}
+
+void RAMFUNC perf_record(uint8_t id, uint32_t start) {
+    // unsigned math handles the counter wrap
+    uint32_t d = GetCountPerf() - start;
+
+    perf_last_ticks[id] = d;
+
+    perf_counter_t *c = &perf_counters[id];
+    c->calls++;
+    c->total += d;
+    if (d < c->min) {
+        c->min = d;
+    }
+    if (d > c->max) {
+        c->max = d;
+    }
+}
+
+uint32_t perf_last(uint8_t id) {
+    return perf_last_ticks[id];
+}
+
+void perf_report(uint8_t flags) {
+    perf_report_t r;
+    r.freq = PERF_FREQ;
+    r.count = PERF_MAX;
+    memcpy(r.counters, perf_counters, sizeof(r.counters));
+
+    if (flags & PERF_FLAG_RESET) {
+        perf_reset();
+    }
+    reply_ng(CMD_PERF, PM3_SUCCESS, (uint8_t *)&r, sizeof(r));
+}
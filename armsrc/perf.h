@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Entry / exit duration counters for hot paths, reported by `hw perf`
+//-----------------------------------------------------------------------------
+
+#ifndef __PERF_H
+#define __PERF_H
+
+#include "common.h"
+#include "pm3_cmd.h"
+#include "ticks.h"
+
+// PIT based counter, MCK / 16
+#define PERF_FREQ   (MCK / 16)
+
+//   uint32_t start = PERF_START();
+//   ...
+//   perf_record(PERF_LOGTRACE, start);
+#define PERF_START() GetCountPerf()
+
+void perf_init(void);
+void perf_reset(void);
+void RAMFUNC perf_record(uint8_t id, uint32_t start);
+// duration of the most recent perf_record() of id, in ticks
+uint32_t perf_last(uint8_t id);
+void perf_report(uint8_t flags);
+
+#endif
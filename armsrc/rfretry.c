@@ -0,0 +1,83 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Retry policy for reader side exchanges,  picks the cheapest recovery for a failure
+//
+//   rf_retry_policy_t rp = RF_RETRY_POLICY(2, 1, 1, false);
+//   while ((res = exchange()) != PM3_SUCCESS) {
+//       switch (rf_retry_next(&rp, rf_fail_from_status(res))) {
+//           case RF_RETRY_RESEND:      continue;
+//           case RF_RETRY_RESELECT:    select(); continue;
+//           case RF_RETRY_FIELD_CYCLE: off(); on(); select(); continue;
+//           case RF_RETRY_GIVEUP:      return res;
+//       }
+//   }
+//-----------------------------------------------------------------------------
+#include "rfretry.h"
+
+#include "pm3_cmd.h"
+
+rf_fail_t rf_fail_from_status(int status) {
+    switch (status) {
+        case PM3_SUCCESS:
+            return RF_FAIL_NONE;
+        case PM3_ETIMEOUT:
+        case PM3_ECARDEXCHANGE:
+        case PM3_ENODATA:
+            return RF_FAIL_TIMEOUT;
+        case PM3_ECRC:
+            return RF_FAIL_CRC;
+        default:
+            return RF_FAIL_LENGTH;
+    }
+}
+
+void rf_retry_reset(rf_retry_policy_t *p) {
+    p->resend = 0;
+    p->reselect = 0;
+    p->cycle = 0;
+}
+
+rf_retry_t rf_retry_next(rf_retry_policy_t *p, rf_fail_t fail) {
+
+    if (fail == RF_FAIL_NONE) {
+        return RF_RETRY_GIVEUP;
+    }
+
+    // A CRC error means the tag heard us and answered in full,  it is still where we left it.
+    // Nothing heard or a cut frame is only worth a resend when no session state depends on it.
+    // A collision needs the anticollision again.
+    bool resend_ok = (fail == RF_FAIL_CRC) ||
+                     ((fail == RF_FAIL_TIMEOUT || fail == RF_FAIL_LENGTH) && p->stateful == false);
+
+    if (resend_ok && p->resend < p->max_resend) {
+        p->resend++;
+        return RF_RETRY_RESEND;
+    }
+
+    if (p->reselect < p->max_reselect) {
+        p->reselect++;
+        p->resend = 0;
+        return RF_RETRY_RESELECT;
+    }
+
+    if (p->cycle < p->max_cycle) {
+        p->cycle++;
+        p->reselect = 0;
+        p->resend = 0;
+        return RF_RETRY_FIELD_CYCLE;
+    }
+    return RF_RETRY_GIVEUP;
+}
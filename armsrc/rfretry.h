@@ -0,0 +1,61 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Retry policy for reader side exchanges,  picks the cheapest recovery for a failure
+//-----------------------------------------------------------------------------
+
+#ifndef __RFRETRY_H
+#define __RFRETRY_H
+
+#include "common.h"
+
+// what went wrong with the last exchange
+typedef enum {
+    RF_FAIL_NONE = 0,
+    RF_FAIL_TIMEOUT,        // nothing heard
+    RF_FAIL_CRC,            // complete frame, bad CRC / parity
+    RF_FAIL_LENGTH,         // partial or unexpected length frame
+    RF_FAIL_COLLISION,      // more than one tag answered
+} rf_fail_t;
+
+// what the caller should do next
+typedef enum {
+    RF_RETRY_GIVEUP = 0,
+    RF_RETRY_RESEND,        // same frame, same session
+    RF_RETRY_RESELECT,      // anticollision / select (and auth) again, field stays on
+    RF_RETRY_FIELD_CYCLE,   // field off / on, then select
+} rf_retry_t;
+
+typedef struct {
+    uint8_t max_resend;     // per selection
+    uint8_t max_reselect;   // per field cycle
+    uint8_t max_cycle;
+    // a lost or partial frame breaks the session (crypto1 stream),  only a CRC error may be resent
+    bool stateful;
+    // counters
+    uint8_t resend;
+    uint8_t reselect;
+    uint8_t cycle;
+} rf_retry_policy_t;
+
+#define RF_RETRY_POLICY(resends, reselects, cycles, is_stateful) { \
+    .max_resend = (resends), .max_reselect = (reselects), .max_cycle = (cycles), .stateful = (is_stateful), \
+    .resend = 0, .reselect = 0, .cycle = 0 }
+
+rf_fail_t rf_fail_from_status(int status);
+rf_retry_t rf_retry_next(rf_retry_policy_t *p, rf_fail_t fail);
+void rf_retry_reset(rf_retry_policy_t *p);
+
+#endif
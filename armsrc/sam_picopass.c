@@ -30,19 +30,23 @@
 #include "optimized_cipher.h"
 #include "fpgaloader.h"
 
-static int sam_rxtx(const uint8_t *data, uint16_t n, uint8_t *resp, uint16_t *resplen) {
-
-    StartTicks();
-
-    bool res = I2C_BufferWrite(data, n, I2C_DEVICE_CMD_SEND_T0, I2C_DEVICE_ADDRESS_MAIN);
+// first half of sam_rxtx,  returns while the SAM works on the command.
+// No ticks are used, the tag can be talked to before sam_rx collects the answer.
+static bool sam_tx(const uint8_t *data, uint16_t n) {
+    bool res = sc_tx_begin(data, n, I2C_DEVICE_CMD_SEND_T0);
     if (res == false) {
         DbpString("failed to send to SIM CARD");
-        goto out;
     }
+    return res;
+}
+
+static bool sam_rx(uint8_t *resp, uint16_t *resplen) {
+
+    StartTicks();
 
     *resplen = ISO7816_MAX_FRAME;
 
-    res = sc_rx_bytes(resp, resplen, SIM_WAIT_DELAY);
+    bool res = sc_rx_bytes_ready(resp, resplen, SIM_WAIT_DELAY);
     if (res == false) {
         DbpString("failed to receive from SIM CARD");
         goto out;
@@ -93,6 +97,13 @@ out:
     return res;
 }
 
+static bool sam_rxtx(const uint8_t *data, uint16_t n, uint8_t *resp, uint16_t *resplen) {
+    if (sam_tx(data, n) == false) {
+        return false;
+    }
+    return sam_rx(resp, resplen);
+}
+
 // using HID SAM to authenticate w PICOPASS
 int sam_picopass_get_pacs(void) {
 
@@ -163,6 +174,25 @@ int sam_picopass_get_pacs(void) {
     // store CSN
     memcpy(hdr.csn, resp, sizeof(hdr.csn));
 
+    // -----------------------------------------------------------------------------
+    // SAM comms
+    // -----------------------------------------------------------------------------
+    size_t sam_len = 0;
+    uint8_t *sam_apdu = BigBuf_calloc(ISO7816_MAX_FRAME);
+
+    // -----------------------------------------------------------------------------
+    // first
+    // a0 da 02 63 1a 44 0a 44 00 00 00 a0 12 ad 10 a0 0e 80 02 00 04 81 08 9b fc a4 00 fb ff 12 e0
+    // only needs the CSN,  the tag is read while the SAM works on it
+    hexstr_to_byte_array("a0da02631a440a44000000a012ad10a00e800200048108", sam_apdu, &sam_len);
+    memcpy(sam_apdu + sam_len, hdr.csn, sizeof(hdr.csn));
+    sam_len += sizeof(hdr.csn);
+
+    if (sam_tx(sam_apdu, sam_len) == false) {
+        res = PM3_ECARDEXCHANGE;
+        goto out;
+    }
+
     // card selected, now read config (block1) (only 8 bytes no CRC)
     start_time = eof_time + DELAY_ICLASS_VICC_TO_VCD_READER;
     iclass_send_as_reader(read_conf, sizeof(read_conf), &start_time, &eof_time, shallow_mod);
@@ -211,20 +241,8 @@ int sam_picopass_get_pacs(void) {
     // store EPURSE
     memcpy(hdr.epurse, resp, sizeof(hdr.epurse));
 
-    // -----------------------------------------------------------------------------
-    // SAM comms
-    // -----------------------------------------------------------------------------
-    size_t sam_len = 0;
-    uint8_t *sam_apdu = BigBuf_calloc(ISO7816_MAX_FRAME);
-
-    // -----------------------------------------------------------------------------
-    // first
-    // a0 da 02 63 1a 44 0a 44 00 00 00 a0 12 ad 10 a0 0e 80 02 00 04 81 08 9b fc a4 00 fb ff 12 e0
-    hexstr_to_byte_array("a0da02631a440a44000000a012ad10a00e800200048108", sam_apdu, &sam_len);
-    memcpy(sam_apdu + sam_len, hdr.csn, sizeof(hdr.csn));
-    sam_len += sizeof(hdr.csn);
-
-    if (sam_rxtx(sam_apdu, sam_len, resp, &resp_len) == false) {
+    // answer to the first SAM command
+    if (sam_rx(resp, &resp_len) == false) {
         res = PM3_ECARDEXCHANGE;
         goto out;
     }
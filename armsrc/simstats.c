@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Per session simulator counters, printed at exit and reported by `hw simstats`
+//-----------------------------------------------------------------------------
+#include "simstats.h"
+
+#include "proxmark3_arm.h"
+#include "perf.h"
+#include "cmd.h"
+#include "dbprint.h"
+#include "string.h"
+
+static sim_stats_t sim_stats;
+
+// perf tick of the last reader frame end,  0 once it got its answer
+static uint32_t frame_tick;
+static uint32_t budget_ticks;
+
+#define PERF_TICKS_PER_US   (PERF_FREQ / 1000000)
+
+void sim_stats_start(uint8_t sim, uint16_t budget_us) {
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    sim_stats.sim = sim;
+    sim_stats.budget_us = budget_us;
+    sim_stats.active = true;
+    budget_ticks = budget_us * PERF_TICKS_PER_US;
+    frame_tick = 0;
+}
+
+void RAMFUNC sim_stats_frame(void) {
+    if (sim_stats.active == false) {
+        return;
+    }
+    sim_stats.frames++;
+    frame_tick = GetCountPerf() | 1;
+}
+
+void RAMFUNC sim_stats_frame_error(void) {
+    if (sim_stats.active == false) {
+        return;
+    }
+    sim_stats.frame_errors++;
+}
+
+void RAMFUNC sim_stats_answer(void) {
+    if (sim_stats.active == false || frame_tick == 0) {
+        return;
+    }
+    // unsigned math handles the counter wrap
+    uint32_t d = GetCountPerf() - frame_tick;
+    frame_tick = 0;
+
+    sim_stats.answers++;
+    if (d > budget_ticks) {
+        sim_stats.late++;
+    }
+
+    uint32_t us = d / PERF_TICKS_PER_US;
+    uint8_t bin = 0;
+    while (bin < SIM_STATS_HIST_BINS - 1 && us >= (8U << bin)) {
+        bin++;
+    }
+    sim_stats.hist[bin]++;
+}
+
+void sim_stats_stop(void) {
+    if (sim_stats.active == false) {
+        return;
+    }
+    sim_stats.active = false;
+
+    if (g_dbglevel >= DBG_ERROR && sim_stats.frames) {
+        Dbprintf("Sim stats... frames %u  dropped %u  answers %u  late %u ( > %u us )"
+                 , sim_stats.frames
+                 , sim_stats.frame_errors
+                 , sim_stats.answers
+                 , sim_stats.late
+                 , sim_stats.budget_us
+                );
+    }
+    if (g_dbglevel >= DBG_INFO) {
+        for (uint8_t i = 0; i < SIM_STATS_HIST_BINS; i++) {
+            if (sim_stats.hist[i] == 0) {
+                continue;
+            }
+            if (i == SIM_STATS_HIST_BINS - 1) {
+                Dbprintf("   >= %4u us... %u", 8U << (i - 1), sim_stats.hist[i]);
+            } else {
+                Dbprintf("    < %4u us... %u", 8U << i, sim_stats.hist[i]);
+            }
+        }
+    }
+}
+
+void sim_stats_report(void) {
+    reply_ng(CMD_SIM_STATS, PM3_SUCCESS, (uint8_t *)&sim_stats, sizeof(sim_stats));
+}
@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Per session simulator counters, printed at exit and reported by `hw simstats`
+//-----------------------------------------------------------------------------
+
+#ifndef __SIMSTATS_H
+#define __SIMSTATS_H
+
+#include "common.h"
+#include "pm3_cmd.h"
+
+//   sim_stats_start(SIM_STATS_14A, 80);
+//   ...  frame / answer hooks in the protocol layer  ...
+//   sim_stats_stop();
+void sim_stats_start(uint8_t sim, uint16_t budget_us);
+void sim_stats_stop(void);
+void sim_stats_report(void);
+
+// frame end to answer ready,  beyond this the answer misses its window
+#define SIM_STATS_BUDGET_14A_US      80    // FDT 1172/fc = 86us, less filling the FPGA delay queue
+#define SIM_STATS_BUDGET_ICLASS_US   250   // DELAY_ICLASS_VCD_TO_VICC_SIM, ~270us
+#define SIM_STATS_BUDGET_15_US       300   // DELAY_ISO15693_VCD_TO_VICC_SIM, ~311us
+#define SIM_STATS_BUDGET_HITAG2_US   56    // T_wresp 199..206 T0, the wait only starts after processing
+
+// no-ops outside a session
+void RAMFUNC sim_stats_frame(void);
+void RAMFUNC sim_stats_frame_error(void);
+void RAMFUNC sim_stats_answer(void);
+
+#endif
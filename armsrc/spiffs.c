@@ -30,7 +30,12 @@
 // testing regarding power loss, page consistency checks, Garbage collector
 // Flushing handling... in doubt, use maximal safetylevel as, in most of the
 // case, will ensure a flush by rollbacking to previous Unmounted state
-#define RDV40_SPIFFS_CACHE_SZ ((LOG_PAGE_SIZE + 32) * 4)
+// Page count can be raised at build time (max 32) for the standalone modes
+// logging to flash, each page costs LOG_PAGE_SIZE + 32 bytes of static RAM
+#ifndef RDV40_SPIFFS_CACHE_PAGES
+#define RDV40_SPIFFS_CACHE_PAGES (4)
+#endif
+#define RDV40_SPIFFS_CACHE_SZ ((LOG_PAGE_SIZE + 32) * RDV40_SPIFFS_CACHE_PAGES)
 #define SPIFFS_FD_SIZE (32)
 #define RDV40_SPIFFS_MAX_FD (3)
 #define RDV40_SPIFFS_FDBUF_SZ (SPIFFS_FD_SIZE * RDV40_SPIFFS_MAX_FD)
@@ -57,6 +62,10 @@
 #include "spiffs.h"
 #include "BigBuf.h"
 #include "dbprint.h"
+#include "pm3_cmd.h"
+#include "proxmark3_arm.h"
+#include "util.h"
+#include "lz4.h"
 
 ///// FLASH LEVEL R/W/E operations  for feeding SPIFFS Driver/////////////////
 static s32_t rdv40_spiffs_llread(u32_t addr, u32_t size, u8_t *dst) {
@@ -115,6 +124,28 @@ static u8_t spiffs_cache_buf[RDV40_SPIFFS_CACHE_SZ] __attribute__((aligned));
 
 static spiffs fs;
 
+// cache / gc counters live in fs and are cleared on every mount,
+// these keep the totals since power up
+static struct {
+    uint32_t mounts;
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    uint32_t gc_runs;
+} spiffs_stats;
+
+static void spiffs_stats_collect(void) {
+#if SPIFFS_CACHE_STATS
+    spiffs_stats.cache_hits += fs.cache_hits;
+    spiffs_stats.cache_misses += fs.cache_misses;
+    fs.cache_hits = 0;
+    fs.cache_misses = 0;
+#endif
+#if SPIFFS_GC_STATS
+    spiffs_stats.gc_runs += fs.stats_gc_runs;
+    fs.stats_gc_runs = 0;
+#endif
+}
+
 static enum spiffs_mount_status {
     RDV40_SPIFFS_UNMOUNTED,
     RDV40_SPIFFS_MOUNTED,
@@ -164,6 +195,7 @@ int rdv40_spiffs_mount(void) {
 
     if (ret == SPIFFS_OK) {
         RDV40_SPIFFS_MOUNT_STATUS = RDV40_SPIFFS_MOUNTED;
+        spiffs_stats.mounts++;
     }
     return ret;
 }
@@ -174,6 +206,7 @@ int rdv40_spiffs_unmount(void) {
         return SPIFFS_ERR_NOT_MOUNTED;
     }
 
+    spiffs_stats_collect();
     SPIFFS_clearerr(&fs);
     SPIFFS_unmount(&fs);
 
@@ -192,6 +225,39 @@ int rdv40_spiffs_check(void) {
     rdv40_spiffs_lazy_mount();
     return SPIFFS_gc(&fs, 8192) == SPIFFS_OK;
 }
+
+// Set by operations which leave deleted pages behind, cleared once the idle gc
+// has nothing left to gain
+static bool spiffs_gc_pending = false;
+
+// Frees blocks until SPIFFS_GC_IDLE_FREE_BLOCKS are erased or nothing can be gained.
+// Filesystem must be mounted. With interruptible, returns as soon as a
+// command or the button is pending.
+static s32_t spiffs_gc_fill_pool(bool interruptible) {
+    s32_t res;
+    do {
+        WDT_HIT();
+        res = SPIFFS_gc_idle(&fs, SPIFFS_GC_IDLE_FREE_BLOCKS);
+    } while (res > 0 && (interruptible == false || (data_available() == false && BUTTON_PRESS() == false)));
+
+    if (res <= 0) {
+        spiffs_gc_pending = false;
+    }
+    return res;
+}
+
+// Idle time garbage collection, called from the main loop when USB is quiet.
+// Keeps a pool of erased blocks so the next write, a standalone flash log or
+// `mem spiffs upload`, doesn't stall in the inline gc.
+void rdv40_spiffs_idle_gc(void) {
+    if (spiffs_gc_pending == false) {
+        return;
+    }
+
+    int changed = rdv40_spiffs_lazy_mount();
+    spiffs_gc_fill_pool(true);
+    rdv40_spiffs_lazy_mount_rollback(changed);
+}
 ////////////////////////////////////////////////////////////////////////////////
 
 ///// Base RDV40_SPIFFS_SAFETY_NORMAL operations////////////////////////////////
@@ -203,6 +269,7 @@ void write_to_spiffs(const char *filename, const uint8_t *src, uint32_t size) {
         Dbprintf("wr errno %i\n", SPIFFS_errno(&fs));
     }
     SPIFFS_close(&fs, fd);
+    spiffs_gc_pending = true;
 }
 
 void append_to_spiffs(const char *filename, const uint8_t *src, uint32_t size) {
@@ -212,6 +279,7 @@ void append_to_spiffs(const char *filename, const uint8_t *src, uint32_t size) {
         Dbprintf("errno %i\n", SPIFFS_errno(&fs));
     }
     SPIFFS_close(&fs, fd);
+    spiffs_gc_pending = true;
 }
 
 void read_from_spiffs(const char *filename, uint8_t *dst, uint32_t size) {
@@ -226,12 +294,14 @@ static void rename_in_spiffs(const char *old_filename, const char *new_filename)
     if (SPIFFS_rename(&fs, old_filename, new_filename) < 0) {
         Dbprintf("errno %i\n", SPIFFS_errno(&fs));
     }
+    spiffs_gc_pending = true;
 }
 
 static void remove_from_spiffs(const char *filename) {
     if (SPIFFS_remove(&fs, filename) < 0) {
         Dbprintf("errno %i\n", SPIFFS_errno(&fs));
     }
+    spiffs_gc_pending = true;
 }
 
 uint32_t size_in_spiffs(const char *filename) {
@@ -624,6 +694,21 @@ void rdv40_spiffs_safe_print_fsinfo(void) {
              , fsinfo.usedPercent
             );
     DbpString("");
+
+    if (rdv40_spiffs_mounted()) {
+        spiffs_stats_collect();
+    }
+
+    uint32_t lookups = spiffs_stats.cache_hits + spiffs_stats.cache_misses;
+    Dbprintf("  Cache size........... " _YELLOW_("%d")" bytes ( %d pages )", sizeof(spiffs_cache_buf), RDV40_SPIFFS_CACHE_PAGES);
+    Dbprintf("  Cache hits / misses.. " _YELLOW_("%u")" / " _YELLOW_("%u")" ( %u%% hit )"
+             , spiffs_stats.cache_hits
+             , spiffs_stats.cache_misses
+             , (lookups) ? ((100 * spiffs_stats.cache_hits) + (lookups / 2)) / lookups : 0
+            );
+    Dbprintf("  GC runs.............. " _YELLOW_("%u"), spiffs_stats.gc_runs);
+    Dbprintf("  Mounts............... " _YELLOW_("%u"), spiffs_stats.mounts);
+    DbpString("");
 }
 
 // this function is safe and WILL rollback since it is only a PRINTING function,
@@ -699,6 +784,236 @@ void rdv40_spiffs_safe_wipe(void) {
     rdv40_spiffs_lazy_mount_rollback(changed);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Emulator image bank
+//
+// Slots are plain files named after EML_BANK_FILENAME. The object index page
+// of every slot is remembered when the bank is scanned, so switching slot opens
+// the file by page instead of walking all lookup pages for the name. A stale
+// page (slot rewritten, moved by the GC, fs wiped) fails to open or carries
+// another name, which triggers one rescan.
+typedef struct {
+    spiffs_page_ix pix;
+    uint32_t size;
+} eml_bank_slot_t;
+
+static eml_bank_slot_t eml_bank[EML_BANK_SLOTS];
+static bool eml_bank_scanned = false;
+
+// "eml_bank_NN.bin" -> NN,  -1 if not a bank file
+static int eml_bank_slot_of(const char *name) {
+    const char *prefix = "eml_bank_";
+    size_t plen = strlen(prefix);
+    if (strncmp(name, prefix, plen) != 0) {
+        return -1;
+    }
+    name += plen;
+    if (name[0] < '0' || name[0] > '9' || name[1] < '0' || name[1] > '9') {
+        return -1;
+    }
+    if (strcmp(name + 2, ".bin") != 0) {
+        return -1;
+    }
+    int slot = (name[0] - '0') * 10 + (name[1] - '0');
+    return (slot < EML_BANK_SLOTS) ? slot : -1;
+}
+
+static void eml_bank_scan(void) {
+    memset(eml_bank, 0, sizeof(eml_bank));
+
+    spiffs_DIR d;
+    struct spiffs_dirent e;
+    struct spiffs_dirent *pe = &e;
+
+    SPIFFS_opendir(&fs, "/", &d);
+    while ((pe = SPIFFS_readdir(&d, pe))) {
+        int slot = eml_bank_slot_of((const char *)pe->name);
+        if (slot < 0) {
+            continue;
+        }
+        eml_bank[slot].pix = pe->pix;
+        eml_bank[slot].size = pe->size;
+    }
+    SPIFFS_closedir(&d);
+    eml_bank_scanned = true;
+}
+
+static int eml_bank_read(uint8_t slot, uint8_t *dst, uint32_t maxlen, uint32_t *len) {
+
+    if (eml_bank[slot].size == 0) {
+        return PM3_ENODATA;
+    }
+
+    spiffs_file fd = SPIFFS_open_by_page(&fs, eml_bank[slot].pix, SPIFFS_RDONLY, 0);
+    if (fd < 0) {
+        return PM3_EFILE;
+    }
+
+    char fn[SPIFFS_OBJ_NAME_LEN];
+    sprintf(fn, EML_BANK_FILENAME, slot);
+
+    spiffs_stat s;
+    if (SPIFFS_fstat(&fs, fd, &s) < 0 || strcmp((const char *)s.name, fn) != 0) {
+        SPIFFS_close(&fs, fd);
+        return PM3_EFILE;
+    }
+
+    uint32_t n = MIN(s.size, maxlen);
+    int res = PM3_SUCCESS;
+    if (SPIFFS_read(&fs, fd, dst, n) < 0) {
+        Dbprintf("errno %i\n", SPIFFS_errno(&fs));
+        res = PM3_EFLASH;
+    }
+    SPIFFS_close(&fs, fd);
+
+    *len = n;
+    return res;
+}
+
+// Forget the remembered pages, next access rescans the bank
+void rdv40_spiffs_eml_bank_invalidate(void) {
+    eml_bank_scanned = false;
+}
+
+// Return a bitmap of the populated slots, rescanning first if asked to or never done.
+// sizes, if not NULL, gets the file size of each of the EML_BANK_SLOTS slots
+uint16_t rdv40_spiffs_eml_bank_list(uint32_t *sizes, bool rescan) {
+    if (rescan || eml_bank_scanned == false) {
+        int changed = rdv40_spiffs_lazy_mount();
+        eml_bank_scan();
+        rdv40_spiffs_lazy_mount_rollback(changed);
+    }
+
+    uint16_t present = 0;
+    for (uint8_t i = 0; i < EML_BANK_SLOTS; i++) {
+        if (eml_bank[i].size) {
+            present |= (1 << i);
+        }
+        if (sizes) {
+            sizes[i] = eml_bank[i].size;
+        }
+    }
+    return present;
+}
+
+// Next populated slot after `slot`, wrapping around. -1 if the bank is empty
+int rdv40_spiffs_eml_bank_next(uint8_t slot) {
+    rdv40_spiffs_eml_bank_list(NULL, false);
+    for (uint8_t i = 1; i <= EML_BANK_SLOTS; i++) {
+        uint8_t s = (slot + i) % EML_BANK_SLOTS;
+        if (eml_bank[s].size) {
+            return s;
+        }
+    }
+    return -1;
+}
+
+// Copy a slot image into dst (usually the emulator memory).
+// Does not touch dst beyond the file size, len gets the number of bytes copied
+int rdv40_spiffs_eml_bank_load(uint8_t slot, uint8_t *dst, uint32_t maxlen, uint32_t *len) {
+    *len = 0;
+    if (slot >= EML_BANK_SLOTS) {
+        return PM3_EINVARG;
+    }
+
+    int changed = rdv40_spiffs_lazy_mount();
+
+    if (eml_bank_scanned == false) {
+        eml_bank_scan();
+    }
+
+    int res = eml_bank_read(slot, dst, maxlen, len);
+    if (res == PM3_EFILE || res == PM3_ENODATA) {
+        // stale index, or the slot got uploaded since the last scan
+        eml_bank_scan();
+        res = eml_bank_read(slot, dst, maxlen, len);
+    }
+
+    rdv40_spiffs_lazy_mount_rollback(changed);
+    return res;
+}
+
+// Store src into a slot, replacing what was there
+int rdv40_spiffs_eml_bank_save(uint8_t slot, const uint8_t *src, uint32_t size) {
+    if (slot >= EML_BANK_SLOTS) {
+        return PM3_EINVARG;
+    }
+    char fn[SPIFFS_OBJ_NAME_LEN];
+    sprintf(fn, EML_BANK_FILENAME, slot);
+    rdv40_spiffs_write(fn, src, size, RDV40_SPIFFS_SAFETY_SAFE);
+    eml_bank_scanned = false;
+    return PM3_SUCCESS;
+}
+
+// Trace stream to a file,  see trace_lz4_block_t.
+// The file stays open while the sniff runs,  each poll of the stream packs up to
+// TRACE_LZ4_MAX_INPUT bytes of the trace into one block.
+static spiffs_file trace_fd = -1;
+static uint32_t trace_file_bytes;
+
+static uint32_t spiffs_trace_sink(const uint8_t *data, uint32_t len) {
+    if (len == 0) {
+        if (trace_fd >= 0) {
+            SPIFFS_close(&fs, trace_fd);
+            trace_fd = -1;
+            spiffs_gc_pending = true;
+            if (g_dbglevel >= DBG_INFO) {
+                Dbprintf("Trace file " _YELLOW_("%u") " bytes", trace_file_bytes);
+            }
+        }
+        return 0;
+    }
+
+    uint8_t buf[sizeof(trace_lz4_block_t) + TRACE_LZ4_MAX_BLOCK];
+    trace_lz4_block_t *blk = (trace_lz4_block_t *)buf;
+    uint8_t *out = buf + sizeof(trace_lz4_block_t);
+
+    int srclen = MIN(len, TRACE_LZ4_MAX_INPUT);
+    int clen = LZ4_compress_destSize((const char *)data, (char *)out, &srclen, TRACE_LZ4_MAX_BLOCK);
+    if (clen <= 0 || srclen <= clen) {
+        // doesn't shrink,  store as is
+        srclen = MIN(len, TRACE_LZ4_MAX_BLOCK);
+        memcpy(out, data, srclen);
+        clen = srclen;
+    }
+    blk->magic = TRACE_LZ4_MAGIC;
+    blk->clen = clen;
+    blk->rawlen = srclen;
+
+    // a failed write loses the block,  the stream goes on
+    if (trace_fd >= 0) {
+        if (SPIFFS_write(&fs, trace_fd, buf, sizeof(trace_lz4_block_t) + clen) < 0) {
+            Dbprintf("errno %i\n", SPIFFS_errno(&fs));
+        } else {
+            trace_file_bytes += sizeof(trace_lz4_block_t) + clen;
+        }
+    }
+    return srclen;
+}
+
+// Arms the trace stream of the next sniff to append to filename.
+// The filesystem must stay mounted until the sniff returns.
+int rdv40_spiffs_trace_stream(const char *filename) {
+    rdv40_spiffs_lazy_mount();
+
+    if (trace_fd >= 0) {
+        SPIFFS_close(&fs, trace_fd);
+    }
+    trace_fd = SPIFFS_open(&fs, filename, SPIFFS_CREAT | SPIFFS_APPEND | SPIFFS_RDWR, 0);
+    if (trace_fd < 0) {
+        Dbprintf("errno %i\n", SPIFFS_errno(&fs));
+        return PM3_EFILE;
+    }
+    trace_file_bytes = 0;
+
+    // erase ahead now,  so the appends while sniffing don't wait on the gc
+    spiffs_gc_fill_pool(false);
+
+    set_trace_stream_sink(spiffs_trace_sink);
+    set_trace_stream(true);
+    return PM3_SUCCESS;
+}
+
 // Selftest function
 void test_spiffs(void) {
     Dbprintf("----------------------------------------------");
@@ -49,6 +49,7 @@ typedef struct rdv40_spiffs_fsinfo {
 int rdv40_spiffs_read_as_filetype(const char *filename, uint8_t *dst, uint32_t size, RDV40SpiFFSSafetyLevel level);
 
 int rdv40_spiffs_check(void);
+void rdv40_spiffs_idle_gc(void);
 int rdv40_spiffs_lazy_unmount(void);
 int rdv40_spiffs_lazy_mount(void);
 int rdv40_spiffs_lazy_mount_rollback(int changed);
@@ -75,6 +76,14 @@ int exists_in_spiffs(const char *filename);
 
 void rdv40_spiffs_safe_wipe(void);
 
+void rdv40_spiffs_eml_bank_invalidate(void);
+uint16_t rdv40_spiffs_eml_bank_list(uint32_t *sizes, bool rescan);
+int rdv40_spiffs_eml_bank_next(uint8_t slot);
+int rdv40_spiffs_eml_bank_load(uint8_t slot, uint8_t *dst, uint32_t maxlen, uint32_t *len);
+int rdv40_spiffs_eml_bank_save(uint8_t slot, const uint8_t *src, uint32_t size);
+
+int rdv40_spiffs_trace_stream(const char *filename);
+
 #define SPIFFS_OK                       0
 #define SPIFFS_ERR_NOT_MOUNTED          -10000
 #define SPIFFS_ERR_FULL                 -10001
@@ -132,6 +141,9 @@ void rdv40_spiffs_safe_wipe(void);
 // Amount of data to write/append to a file in one go.
 #define SPIFFS_WRITE_CHUNK_SIZE 8192
 
+// Quiet time on USB before the main loop runs the idle gc
+#define SPIFFS_IDLE_GC_DELAY_MS 500
+
 // spiffs file descriptor index type. must be signed
 typedef s16_t spiffs_file;
 // spiffs file descriptor flags
@@ -738,6 +750,20 @@ s32_t SPIFFS_gc_quick(spiffs *fs, u16_t max_free_pages);
  */
 s32_t SPIFFS_gc(spiffs *fs, u32_t size);
 
+/**
+ * Performs one bounded step of background garbage collection: erases a fully
+ * deleted block, or cleans and erases one candidate block, while fewer than
+ * min_free_blocks blocks are free. Meant to be called repeatedly when the
+ * system is idle so that writes find erased blocks ready.
+ *
+ * Returns 1 if a block was freed and calling again may free more, 0 when
+ * nothing is left to gain, or an error code.
+ *
+ * @param fs              the file system struct
+ * @param min_free_blocks number of free blocks to keep ready
+ */
+s32_t SPIFFS_gc_idle(spiffs *fs, u32_t min_free_blocks);
+
 /**
  * Check if EOF reached.
  * @param fs            the file system struct
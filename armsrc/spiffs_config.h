@@ -122,9 +122,9 @@ typedef uint8_t u8_t;
 #define SPIFFS_CACHE_WR                 1
 #endif
 
-// Enable/disable statistics on caching. Debug/test purpose only.
+// Enable/disable statistics on caching. Reported by `mem spiffs info`
 #ifndef  SPIFFS_CACHE_STATS
-#define SPIFFS_CACHE_STATS              0
+#define SPIFFS_CACHE_STATS              1
 #endif
 #endif
 
@@ -139,9 +139,15 @@ typedef uint8_t u8_t;
 #define SPIFFS_GC_MAX_RUNS              10
 #endif
 
-// Enable/disable statistics on gc. Debug/test purpose only.
+// Number of erased blocks the idle time gc tries to keep ready, so writes
+// rarely have to collect inline. Inline gc kicks in at 3 free blocks or less.
+#ifndef SPIFFS_GC_IDLE_FREE_BLOCKS
+#define SPIFFS_GC_IDLE_FREE_BLOCKS      6
+#endif
+
+// Enable/disable statistics on gc. Reported by `mem spiffs info`
 #ifndef SPIFFS_GC_STATS
-#define SPIFFS_GC_STATS                 0
+#define SPIFFS_GC_STATS                 1
 #endif
 
 // Garbage collecting examines all pages in a block which and sums up
@@ -212,6 +212,61 @@ s32_t spiffs_gc_check(
     return res;
 }
 
+// One step of idle time garbage collection. If fewer than min_free_blocks
+// blocks are erased, either a fully deleted block is erased or one candidate
+// block is cleansed and erased. Returns 1 when a block was freed and more
+// steps may help, SPIFFS_OK when the pool is full or nothing can be gained.
+s32_t spiffs_gc_idle(
+    spiffs *fs,
+    u32_t min_free_blocks) {
+    s32_t res;
+
+    if (fs->free_blocks >= min_free_blocks || fs->stats_p_deleted == 0) {
+        return SPIFFS_OK;
+    }
+
+    // cheap first, a block holding only deleted pages needs no moving
+    res = spiffs_gc_quick(fs, 0);
+    if (res == SPIFFS_OK) {
+        return 1;
+    }
+    if (res != SPIFFS_ERR_NO_DELETED_BLOCKS) {
+        return res;
+    }
+
+    spiffs_block_ix *cands;
+    int count;
+    res = spiffs_gc_find_candidate(fs, &cands, &count, 0);
+    SPIFFS_CHECK_RES(res);
+    if (count == 0) {
+        return SPIFFS_OK;
+    }
+
+    u32_t prev_deleted = fs->stats_p_deleted;
+    spiffs_block_ix cand = cands[0];
+
+    SPIFFS_GC_DBG("gc_idle: cleaning block "_SPIPRIi", free_blocks:"_SPIPRIi" pdele:"_SPIPRIi"\n", cand, fs->free_blocks, fs->stats_p_deleted);
+#if SPIFFS_GC_STATS
+    fs->stats_gc_runs++;
+#endif
+    fs->cleaning = 1;
+    res = spiffs_gc_clean(fs, cand);
+    fs->cleaning = 0;
+    SPIFFS_CHECK_RES(res);
+
+    res = spiffs_gc_erase_page_stats(fs, cand);
+    SPIFFS_CHECK_RES(res);
+
+    res = spiffs_gc_erase_block(fs, cand);
+    SPIFFS_CHECK_RES(res);
+
+    // only wear leveling moves left, leave those to the inline gc
+    if (fs->stats_p_deleted >= prev_deleted) {
+        return SPIFFS_OK;
+    }
+    return 1;
+}
+
 // Updates page statistics for a block that is about to be erased
 s32_t spiffs_gc_erase_page_stats(
     spiffs *fs,
@@ -780,6 +780,10 @@ s32_t spiffs_gc_clean(
 s32_t spiffs_gc_quick(
     spiffs *fs, u16_t max_free_pages);
 
+s32_t spiffs_gc_idle(
+    spiffs *fs,
+    u32_t min_free_blocks);
+
 // ---------------
 
 s32_t spiffs_fd_find_new(
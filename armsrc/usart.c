@@ -17,6 +17,7 @@
 //-----------------------------------------------------------------------------
 #include "usart.h"
 #include "proxmark3_arm.h"
+#include "string.h"
 
 #define Dbprintf_usb(...) {\
         bool tmpfpc = g_reply_via_fpc;\
@@ -82,79 +83,67 @@ static uint8_t us_rxfifo[USART_FIFOLEN];
 static size_t us_rxfifo_low = 0;
 static size_t us_rxfifo_high = 0;
 
+static uint8_t us_out_a[USART_TXBUFFLEN];
+static uint8_t us_out_b[USART_TXBUFFLEN];
+static uint8_t *usart_cur_outbuf = NULL;
 
-static void usart_fill_rxfifo(void) {
-
-    uint16_t rxfifo_free;
 
-    if (pUS1->US_RNCR == 0) { // One buffer got filled, backup buffer being used
+static uint16_t usart_rxfifo_free(void) {
+    if (us_rxfifo_low > us_rxfifo_high) {
+        return us_rxfifo_low - us_rxfifo_high;
+    } else {
+        return sizeof(us_rxfifo) - us_rxfifo_high + us_rxfifo_low;
+    }
+}
 
-        if (us_rxfifo_low > us_rxfifo_high) {
-            rxfifo_free = us_rxfifo_low - us_rxfifo_high;
-        } else {
-            rxfifo_free = sizeof(us_rxfifo) - us_rxfifo_high + us_rxfifo_low;
+// Copy from the current PDC input bank into the rx fifo, at most two memcpy
+// because of the fifo wrap around
+static void usart_push_rxfifo(uint16_t len) {
+    while (len) {
+        uint16_t n = MIN(len, sizeof(us_rxfifo) - us_rxfifo_high);
+        memcpy(us_rxfifo + us_rxfifo_high, usart_cur_inbuf + usart_cur_inbuf_off, n);
+        us_rxfifo_high += n;
+        if (us_rxfifo_high == sizeof(us_rxfifo)) {
+            us_rxfifo_high = 0;
         }
+        usart_cur_inbuf_off += n;
+        len -= n;
+    }
+}
 
-        uint16_t available = USART_BUFFLEN - usart_cur_inbuf_off;
-
-        if (available <= rxfifo_free) {
-
-            for (uint16_t i = 0; i < available; i++) {
-                us_rxfifo[us_rxfifo_high++] = usart_cur_inbuf[usart_cur_inbuf_off + i];
-                if (us_rxfifo_high == sizeof(us_rxfifo)) {
-                    us_rxfifo_high = 0;
-                }
-            }
+static void usart_fill_rxfifo(void) {
 
-            // Give next buffer
-            pUS1->US_RNPR = (uint32_t)usart_cur_inbuf;
-            pUS1->US_RNCR = USART_BUFFLEN;
+    if (pUS1->US_RNCR == 0) { // One buffer got filled, backup buffer being used
 
-            // Swap current buff
-            if (usart_cur_inbuf == us_in_a) {
-                usart_cur_inbuf = us_in_b;
-            } else {
-                usart_cur_inbuf = us_in_a;
-            }
+        uint16_t rxfifo_free = usart_rxfifo_free();
+        uint16_t available = USART_BUFFLEN - usart_cur_inbuf_off;
 
-            usart_cur_inbuf_off = 0;
-        } else {
+        if (available > rxfifo_free) {
             // Take only what we have room for
-            available = rxfifo_free;
-            for (uint16_t i = 0; i < available; i++) {
-
-                us_rxfifo[us_rxfifo_high++] = usart_cur_inbuf[usart_cur_inbuf_off + i];
-
-                if (us_rxfifo_high == sizeof(us_rxfifo)) {
-                    us_rxfifo_high = 0;
-                }
-            }
-            usart_cur_inbuf_off += available;
+            usart_push_rxfifo(rxfifo_free);
             return;
         }
-    }
 
-    if (pUS1->US_RCR < USART_BUFFLEN - usart_cur_inbuf_off) { // Current buffer partially filled
+        usart_push_rxfifo(available);
 
-        if (us_rxfifo_low > us_rxfifo_high) {
-            rxfifo_free = (us_rxfifo_low - us_rxfifo_high);
+        // Give next buffer
+        pUS1->US_RNPR = (uint32_t)usart_cur_inbuf;
+        pUS1->US_RNCR = USART_BUFFLEN;
+
+        // Swap current buff
+        if (usart_cur_inbuf == us_in_a) {
+            usart_cur_inbuf = us_in_b;
         } else {
-            rxfifo_free = (sizeof(us_rxfifo) - us_rxfifo_high + us_rxfifo_low);
+            usart_cur_inbuf = us_in_a;
         }
 
-        uint16_t available = (USART_BUFFLEN - pUS1->US_RCR - usart_cur_inbuf_off);
+        usart_cur_inbuf_off = 0;
+    }
 
-        if (available > rxfifo_free) {
-            available = rxfifo_free;
-        }
+    if (pUS1->US_RCR < USART_BUFFLEN - usart_cur_inbuf_off) { // Current buffer partially filled
 
-        for (uint16_t i = 0; i < available; i++) {
-            us_rxfifo[us_rxfifo_high++] = usart_cur_inbuf[usart_cur_inbuf_off + i];
-            if (us_rxfifo_high == sizeof(us_rxfifo)) {
-                us_rxfifo_high = 0;
-            }
-        }
-        usart_cur_inbuf_off += available;
+        uint16_t available = (USART_BUFFLEN - pUS1->US_RCR - usart_cur_inbuf_off);
+        usart_push_rxfifo(MIN(available, usart_rxfifo_free()));
     }
 }
 
@@ -167,6 +156,20 @@ uint16_t usart_rxdata_available(void) {
     }
 }
 
+// Length prefixed frame ( 1 byte length + payload ) boundary detection.
+// Returns the size of the frame at the head of the rx fifo when it is completely
+// received, 0 while it is still coming in. The frame is left in the fifo.
+uint16_t usart_rxframe_available(void) {
+    uint16_t available = usart_rxdata_available();
+    if (available == 0) {
+        return 0;
+    }
+
+    size_t head = (us_rxfifo_low == sizeof(us_rxfifo)) ? 0 : us_rxfifo_low;
+    uint16_t framelen = us_rxfifo[head] + 1;
+    return (available >= framelen) ? framelen : 0;
+}
+
 uint32_t usart_read_ng(uint8_t *data, size_t len) {
 
     if (len == 0) {
@@ -185,7 +188,8 @@ uint32_t usart_read_ng(uint8_t *data, size_t len) {
     tryconstant = 50000;
 #endif
 
-    uint32_t maxtry = 10 * (3000000 / USART_BAUD_RATE) + tryconstant;
+    // use the current baudrate, "usart config" may have changed it at runtime
+    uint32_t maxtry = 10 * (3000000 / (g_usart_baudrate ? g_usart_baudrate : USART_BAUD_RATE)) + tryconstant;
 
     while (len) {
 
@@ -200,11 +204,15 @@ uint32_t usart_read_ng(uint8_t *data, size_t len) {
 
         len -= packetSize;
 
-        while (packetSize--) {
+        while (packetSize) {
             if (us_rxfifo_low == sizeof(us_rxfifo)) {
                 us_rxfifo_low = 0;
             }
-            data[bytes_rcv++] = us_rxfifo[us_rxfifo_low++];
+            uint32_t n = MIN(packetSize, sizeof(us_rxfifo) - us_rxfifo_low);
+            memcpy(data + bytes_rcv, us_rxfifo + us_rxfifo_low, n);
+            us_rxfifo_low += n;
+            bytes_rcv += n;
+            packetSize -= n;
         }
 
         if (try++ == maxtry) {
@@ -217,20 +225,58 @@ uint32_t usart_read_ng(uint8_t *data, size_t len) {
     return bytes_rcv;
 }
 
+static bool usart_tx_bank_busy(const uint8_t *bank) {
+    uint32_t lo = (uint32_t)bank;
+    uint32_t hi = lo + USART_TXBUFFLEN;
+    if (pUS1->US_TCR && (pUS1->US_TPR >= lo) && (pUS1->US_TPR < hi)) {
+        return true;
+    }
+    if (pUS1->US_TNCR && (pUS1->US_TNPR >= lo) && (pUS1->US_TNPR < hi)) {
+        return true;
+    }
+    return false;
+}
+
 // transfer from device to client
+// "data" is copied into one of the two tx banks and handed to the PDC, so we
+// only wait for a bank to be free, not for the line to drain. The caller can
+// reuse "data" as soon as we return.
 int usart_writebuffer_sync(uint8_t *data, size_t len) {
 
-    // Wait for current PDC bank to be free
-    // (and check next bank too, in case there will be a usart_writebuffer_async)
-    while (pUS1->US_TNCR || pUS1->US_TCR) {};
-    pUS1->US_TPR = (uint32_t)data;
-    pUS1->US_TCR = len;
-    // Wait until finishing all transfers to make sure "data" buffer can be discarded
-    // (if we don't wait here, bulk send as e.g. "hw status" will fail)
-    while (pUS1->US_TNCR || pUS1->US_TCR) {};
+    while (len) {
+        uint8_t *bank = (usart_cur_outbuf == us_out_a) ? us_out_b : us_out_a;
+        while (usart_tx_bank_busy(bank)) {};
+
+        size_t n = MIN(len, USART_TXBUFFLEN);
+        memcpy(bank, data, n);
+        usart_cur_outbuf = bank;
+        usart_writebuffer_async(bank, n);
+
+        data += n;
+        len -= n;
+    }
+    return PM3_SUCCESS;
+}
+
+// Queue data on the PDC and return without waiting for it to be sent.
+// Only waits when both PDC banks are busy. "data" must stay untouched until
+// usart_tx_done(), e.g. a static or constant buffer.
+int usart_writebuffer_async(const uint8_t *data, size_t len) {
+    while (pUS1->US_TNCR) {};
+    if (pUS1->US_TCR == 0) {
+        pUS1->US_TPR = (uint32_t)data;
+        pUS1->US_TCR = len;
+    } else {
+        pUS1->US_TNPR = (uint32_t)data;
+        pUS1->US_TNCR = len;
+    }
     return PM3_SUCCESS;
 }
 
+bool usart_tx_done(void) {
+    return (pUS1->US_TNCR == 0 && pUS1->US_TCR == 0);
+}
+
 void usart_init(uint32_t baudrate, uint8_t parity) {
 
     if (baudrate != 0) {
@@ -241,6 +287,12 @@ void usart_init(uint32_t baudrate, uint8_t parity) {
         g_usart_parity = parity;
     }
 
+    // let queued replies drain before touching the configuration
+    if (usart_cur_outbuf != NULL) {
+        while (usart_tx_done() == false) {};
+        while ((pUS1->US_CSR & AT91C_US_TXEMPTY) == 0) {};
+    }
+
     // For a nice detailed sample, interrupt driven but still relevant.
     // See https://www.sparkfun.com/datasheets/DevTools/SAM7/at91sam7%20serial%20communications.pdf
 
@@ -285,9 +337,10 @@ void usart_init(uint32_t baudrate, uint8_t parity) {
     pUS1->US_IDR = 0xFFFF;
 
     // http://ww1.microchip.com/downloads/en/DeviceDoc/doc6175.pdf
-    // note that for very large baudrates, error is not neglectible:
+    // note that for very large baudrates, error without FP is not neglectible:
     // b921600  => 8.6%
     // b1382400 => 8.6%
+    // with FP it drops to 0.2% and 0.8%, fine for the BT add-on at its higher speeds
     // FP, Fractional Part  (Datasheet p402, Supported in AT91SAM512 / 256) (31.6.1.3)
     // FP = 0 disabled;
     // FP = 1-7 Baudrate resolution,
@@ -315,6 +368,7 @@ void usart_init(uint32_t baudrate, uint8_t parity) {
     pUS1->US_TCR = 0;
     pUS1->US_TNPR = (uint32_t)0;
     pUS1->US_TNCR = 0;
+    usart_cur_outbuf = us_out_b;
     pUS1->US_RPR = (uint32_t)us_in_a;
     pUS1->US_RCR = USART_BUFFLEN;
     usart_cur_inbuf = us_in_a;
@@ -26,7 +26,10 @@ extern uint8_t g_usart_parity;
 
 void usart_init(uint32_t baudrate, uint8_t parity);
 int usart_writebuffer_sync(uint8_t *data, size_t len);
+int usart_writebuffer_async(const uint8_t *data, size_t len);
+bool usart_tx_done(void);
 uint32_t usart_read_ng(uint8_t *data, size_t len);
 uint16_t usart_rxdata_available(void);
+uint16_t usart_rxframe_available(void);
 
 #endif
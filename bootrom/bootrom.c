@@ -120,6 +120,18 @@ static uint32_t get_flash_size(void) {
     return flash_size_from_cidr(*AT91C_DBGU_CIDR);
 }
 
+// same as crc32_ex() in common/crc32.c,  bitwise to keep the bootrom small
+static uint32_t flash_crc32(const uint8_t *d, uint32_t n) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (uint32_t i = 0; i < n; i++) {
+        crc ^= d[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+        }
+    }
+    return crc;
+}
+
 static void UsbPacketReceived(uint8_t *packet) {
     bool ack = true;
     PacketCommandOLD *c = (PacketCommandOLD *)packet;
@@ -136,7 +148,8 @@ static void UsbPacketReceived(uint8_t *packet) {
                    DEVICE_INFO_FLAG_UNDERSTANDS_START_FLASH |
                    DEVICE_INFO_FLAG_UNDERSTANDS_CHIP_INFO |
                    DEVICE_INFO_FLAG_UNDERSTANDS_VERSION |
-                   DEVICE_INFO_FLAG_UNDERSTANDS_READ_MEM;
+                   DEVICE_INFO_FLAG_UNDERSTANDS_READ_MEM |
+                   DEVICE_INFO_FLAG_UNDERSTANDS_FLASH_CRC;
             if (g_common_area.flags.osimage_present)
                 arg0 |= DEVICE_INFO_FLAG_OSIMAGE_PRESENT;
 
@@ -153,11 +166,30 @@ static void UsbPacketReceived(uint8_t *packet) {
 
         case CMD_BL_VERSION: {
             ack = false;
-            arg0 = BL_VERSION_1_0_0;
+            arg0 = BL_VERSION_1_1_0;
             reply_old(CMD_BL_VERSION, arg0, 0, 0, 0, 0);
         }
         break;
 
+        case CMD_BL_FLASH_CRC: {
+            ack = false;
+            uint32_t address = (uint32_t) c->arg[0];
+            uint32_t count = MIN((uint32_t) c->arg[1], BL_FLASH_CRC_MAX_BLOCKS);
+            uint32_t crcs[BL_FLASH_CRC_MAX_BLOCKS];
+
+            // only whole blocks inside the flash
+            if ((address < (uint32_t)_flash_start) ||
+                    (address + (count * BL_FLASH_CRC_BLOCK) > (uint32_t)_flash_start + get_flash_size())) {
+                count = 0;
+            }
+
+            for (uint32_t i = 0; i < count; i++) {
+                crcs[i] = flash_crc32((uint8_t *)(address + (i * BL_FLASH_CRC_BLOCK)), BL_FLASH_CRC_BLOCK);
+            }
+            reply_old(CMD_BL_FLASH_CRC, address, count, 0, crcs, count * sizeof(uint32_t));
+        }
+        break;
+
         case CMD_READ_MEM_DOWNLOAD: {
             ack = false;
             LED_B_ON();
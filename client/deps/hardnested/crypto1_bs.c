@@ -0,0 +1,274 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1
+//
+// Each vector lane holds one key. The 48 bit LFSR is kept as one vector per bit
+// position in a sliding window, so a clock only writes the new feedback vector.
+// Position p of the LFSR maps to crapto1's odd (p even) / even (p odd) halves,
+// bit p / 2, the filter reads positions 0, 2, .. 38.
+//
+// Like hardnested_bf_core.c this file is compiled once per instruction set and
+// the NOSIMD build dispatches at runtime. Standalone tools may build a single
+// variant with CRYPTO1_BS_NO_DISPATCH.
+//-----------------------------------------------------------------------------
+
+#include "crypto1_bs.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if !defined(CRYPTO1_BS_NO_DISPATCH)
+#include "hardnested_bf_core.h"     // SIMD selection
+#endif
+
+#if defined(__AVX512F__)
+#define MAX_BITSLICES 512
+#elif defined(__AVX2__)
+#define MAX_BITSLICES 256
+#elif defined(__AVX__)
+#define MAX_BITSLICES 128
+#elif defined(__SSE2__)
+#define MAX_BITSLICES 128
+#elif defined(__ARM_NEON) && !defined(NOSIMD_BUILD)
+#define MAX_BITSLICES 128
+#else // MMX or SSE or NOSIMD
+#define MAX_BITSLICES 64
+#endif
+
+#define VECTOR_SIZE (MAX_BITSLICES/8)
+typedef uint32_t __attribute__((aligned(VECTOR_SIZE))) __attribute__((vector_size(VECTOR_SIZE))) bitslice_value_t;
+typedef union {
+    bitslice_value_t value;
+    uint64_t bytes64[MAX_BITSLICES / 64];
+} bitslice_t;
+
+// filter function (f20), see hardnested_bf_core.c
+#define f20a(a,b,c,d) (((a|b)^(a&d))^(c&((a^b)|d)))
+#define f20b(a,b,c,d) (((a&b)|c)^((a^b)&(c|d)))
+#define f20c(a,b,c,d,e) ((a|((b|e)&(d^e)))^((a^(b&d))&((c^d)|(b&e))))
+
+#define STATE_SIZE 48
+#define MAX_CLOCKS (32 * CRYPTO1_BS_MAX_WORDS + 8 * CRYPTO1_BS_MAX_BYTES)
+
+#if defined (CRYPTO1_BS_NO_DISPATCH)
+#define CRYPTO1_BS_RUN crypto1_bs_run
+#define CRYPTO1_BS_LANES crypto1_bs_lanes
+#elif defined (__AVX512F__)
+#define CRYPTO1_BS_RUN crypto1_bs_run_AVX512
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_AVX512
+#elif defined (__AVX2__)
+#define CRYPTO1_BS_RUN crypto1_bs_run_AVX2
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_AVX2
+#elif defined (__AVX__)
+#define CRYPTO1_BS_RUN crypto1_bs_run_AVX
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_AVX
+#elif defined (__SSE2__)
+#define CRYPTO1_BS_RUN crypto1_bs_run_SSE2
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_SSE2
+#elif defined (__MMX__)
+#define CRYPTO1_BS_RUN crypto1_bs_run_MMX
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_MMX
+#elif defined (__ARM_NEON) && !defined(NOSIMD_BUILD)
+#define CRYPTO1_BS_RUN crypto1_bs_run_NEON
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_NEON
+#else
+#define CRYPTO1_BS_RUN crypto1_bs_run_NOSIMD
+#define CRYPTO1_BS_LANES crypto1_bs_lanes_NOSIMD
+#endif
+
+typedef void crypto1_bs_run_t(const crypto1_bs_job_t *, const uint64_t *, uint32_t, uint32_t *, uint8_t *);
+typedef uint32_t crypto1_bs_lanes_t(void);
+#if !defined(CRYPTO1_BS_NO_DISPATCH)
+crypto1_bs_run_t CRYPTO1_BS_RUN;
+crypto1_bs_lanes_t CRYPTO1_BS_LANES;
+#endif
+
+#define lane_bit(v, k) (((v).bytes64[(k) >> 6] >> ((k) & 0x3f)) & 1)
+
+static void run_block(const crypto1_bs_job_t *job, const uint64_t *keys, uint32_t nkeys, uint32_t *words, uint8_t *bytes) {
+
+    const uint32_t clocks = 32 * job->nwords + 8 * job->nbytes;
+
+    // position p at clock t lives in state[clocks - t + p]
+    bitslice_t state[STATE_SIZE + MAX_CLOCKS];
+    bitslice_t ks[MAX_CLOCKS];
+
+    bitslice_t ones;
+    memset(&ones, 0xff, sizeof(ones));
+
+    bitslice_t *s = &state[clocks];
+    memset(s, 0, STATE_SIZE * sizeof(bitslice_t));
+    for (uint32_t k = 0; k < nkeys; k++) {
+        uint64_t key = keys[k];
+        for (uint32_t p = 0; p < STATE_SIZE; p++) {
+            if ((key >> (p ^ 7)) & 1) {
+                s[p].bytes64[k >> 6] |= 1ULL << (k & 0x3f);
+            }
+        }
+    }
+
+    for (uint32_t t = 0; t < clocks; t++, s--) {
+
+#define S(p) s[p].value
+        bitslice_value_t f = f20c(f20a(S(38), S(36), S(34), S(32)),
+                                  f20b(S(28), S(30), S(26), S(24)),
+                                  f20b(S(20), S(22), S(18), S(16)),
+                                  f20a(S(14), S(12), S(10), S(8)),
+                                  f20b(S(4),  S(6),  S(2),  S(0)));
+
+        // LF_POLY_ODD taps on even positions, LF_POLY_EVEN taps on odd ones
+        bitslice_value_t fb = S(4) ^ S(6) ^ S(8) ^ S(12) ^ S(18) ^ S(20) ^ S(22) ^ S(28) ^ S(30) ^ S(32) ^ S(38) ^ S(42)
+                              ^ S(5) ^ S(23) ^ S(33) ^ S(35) ^ S(37) ^ S(47);
+#undef S
+
+        ks[t].value = f;
+
+        if (t < 32u * job->nwords) {
+            uint8_t w = t / 32;
+            uint8_t b = t % 32;
+            // crypto1_word() feeds the input big endian byte wise
+            if ((job->in[w] >> (b ^ 24)) & 1) {
+                fb ^= ones.value;
+            }
+            if ((job->encrypted >> w) & 1) {
+                fb ^= f;
+            }
+        }
+
+        s[-1].value = fb;
+    }
+
+    // back to one key per lane
+    for (uint32_t k = 0; k < nkeys; k++) {
+        uint32_t t = 0;
+        for (uint8_t w = 0; w < job->nwords; w++) {
+            uint32_t v = 0;
+            for (uint8_t b = 0; b < 32; b++, t++) {
+                v |= (uint32_t)lane_bit(ks[t], k) << (b ^ 24);
+            }
+            if (words) {
+                words[k * job->nwords + w] = v;
+            }
+        }
+        for (uint8_t j = 0; j < job->nbytes; j++) {
+            uint8_t v = 0;
+            for (uint8_t b = 0; b < 8; b++, t++) {
+                v |= lane_bit(ks[t], k) << b;
+            }
+            if (bytes) {
+                bytes[k * job->nbytes + j] = v;
+            }
+        }
+    }
+}
+
+uint32_t CRYPTO1_BS_LANES(void) {
+    return MAX_BITSLICES;
+}
+
+void CRYPTO1_BS_RUN(const crypto1_bs_job_t *job, const uint64_t *keys, uint32_t nkeys, uint32_t *words, uint8_t *bytes) {
+
+    if (job->nwords > CRYPTO1_BS_MAX_WORDS || job->nbytes > CRYPTO1_BS_MAX_BYTES) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < nkeys; i += MAX_BITSLICES) {
+        uint32_t n = nkeys - i;
+        if (n > MAX_BITSLICES) {
+            n = MAX_BITSLICES;
+        }
+        run_block(job, keys + i,
+                  n,
+                  words ? words + (size_t)i * job->nwords : NULL,
+                  bytes ? bytes + (size_t)i * job->nbytes : NULL);
+    }
+}
+
+#if defined(NOSIMD_BUILD) && !defined(CRYPTO1_BS_NO_DISPATCH)
+
+crypto1_bs_run_t crypto1_bs_run_AVX512;
+crypto1_bs_run_t crypto1_bs_run_AVX2;
+crypto1_bs_run_t crypto1_bs_run_AVX;
+crypto1_bs_run_t crypto1_bs_run_SSE2;
+crypto1_bs_run_t crypto1_bs_run_MMX;
+crypto1_bs_run_t crypto1_bs_run_NEON;
+
+crypto1_bs_lanes_t crypto1_bs_lanes_AVX512;
+crypto1_bs_lanes_t crypto1_bs_lanes_AVX2;
+crypto1_bs_lanes_t crypto1_bs_lanes_AVX;
+crypto1_bs_lanes_t crypto1_bs_lanes_SSE2;
+crypto1_bs_lanes_t crypto1_bs_lanes_MMX;
+crypto1_bs_lanes_t crypto1_bs_lanes_NEON;
+
+// determine the available instruction set at runtime, follows `hf mf hardnested --if*`
+static void crypto1_bs_select(crypto1_bs_run_t **run, crypto1_bs_lanes_t **lanes) {
+    switch (GetSIMDInstrAuto()) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            *run = &crypto1_bs_run_AVX512;
+            *lanes = &crypto1_bs_lanes_AVX512;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        case SIMD_AVX2:
+            *run = &crypto1_bs_run_AVX2;
+            *lanes = &crypto1_bs_lanes_AVX2;
+            break;
+        case SIMD_AVX:
+            *run = &crypto1_bs_run_AVX;
+            *lanes = &crypto1_bs_lanes_AVX;
+            break;
+        case SIMD_SSE2:
+            *run = &crypto1_bs_run_SSE2;
+            *lanes = &crypto1_bs_lanes_SSE2;
+            break;
+        case SIMD_MMX:
+            *run = &crypto1_bs_run_MMX;
+            *lanes = &crypto1_bs_lanes_MMX;
+            break;
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            *run = &crypto1_bs_run_NEON;
+            *lanes = &crypto1_bs_lanes_NEON;
+            break;
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+        default:
+            *run = &crypto1_bs_run_NOSIMD;
+            *lanes = &crypto1_bs_lanes_NOSIMD;
+            break;
+    }
+}
+
+// Entries to dispatched function calls
+uint32_t crypto1_bs_lanes(void) {
+    crypto1_bs_run_t *run;
+    crypto1_bs_lanes_t *lanes;
+    crypto1_bs_select(&run, &lanes);
+    return (*lanes)();
+}
+
+void crypto1_bs_run(const crypto1_bs_job_t *job, const uint64_t *keys, uint32_t nkeys, uint32_t *words, uint8_t *bytes) {
+    crypto1_bs_run_t *run;
+    crypto1_bs_lanes_t *lanes;
+    crypto1_bs_select(&run, &lanes);
+    (*run)(job, keys, nkeys, words, bytes);
+}
+
+#endif
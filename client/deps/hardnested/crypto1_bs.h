@@ -0,0 +1,43 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Bitsliced Crypto1, many keys are clocked through the same sequence of
+// crypto1_word() / crypto1_byte() calls at once.
+//-----------------------------------------------------------------------------
+
+#ifndef CRYPTO1_BS_H__
+#define CRYPTO1_BS_H__
+
+#include <stdint.h>
+
+#define CRYPTO1_BS_MAX_WORDS    4
+#define CRYPTO1_BS_MAX_BYTES    32
+
+typedef struct {
+    uint8_t nwords;                         // crypto1_word(pcs, in[i], encrypted bit i) calls
+    uint8_t encrypted;                      // bit i set, word i is fed back encrypted
+    uint32_t in[CRYPTO1_BS_MAX_WORDS];
+    uint8_t nbytes;                         // followed by crypto1_byte(pcs, 0, 0) calls
+} crypto1_bs_job_t;
+
+// keys clocked per pass on this CPU
+uint32_t crypto1_bs_lanes(void);
+
+// Runs every key through job.
+// words[k * nwords + i] gets crypto1_word() number i of key k, bytes[k * nbytes + j] its keystream byte j.
+// words / bytes may be NULL when not needed.
+void crypto1_bs_run(const crypto1_bs_job_t *job, const uint64_t *keys, uint32_t nkeys, uint32_t *words, uint8_t *bytes);
+
+#endif
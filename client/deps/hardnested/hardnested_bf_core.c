@@ -558,13 +558,6 @@ bitslice_test_nonces_t *bitslice_test_nonces_function_p = &bitslice_test_nonces_
 
 static SIMDExecInstr intSIMDInstr = SIMD_AUTO;
 
-void SetSIMDInstr(SIMDExecInstr instr) {
-    intSIMDInstr = instr;
-
-    crack_states_bitsliced_function_p = &crack_states_bitsliced_dispatch;
-    bitslice_test_nonces_function_p = &bitslice_test_nonces_dispatch;
-}
-
 static SIMDExecInstr GetSIMDInstr(void) {
     SIMDExecInstr instr;
 
@@ -598,86 +591,82 @@ static SIMDExecInstr GetSIMDInstr(void) {
     return instr;
 }
 
+// the CPU doesn't change under us, ask it once
+SIMDExecInstr GetSIMDInstrCPU(void) {
+    static SIMDExecInstr cpu_instr = SIMD_AUTO;
+    if (cpu_instr == SIMD_AUTO)
+        cpu_instr = GetSIMDInstr();
+
+    return cpu_instr;
+}
+
 SIMDExecInstr GetSIMDInstrAuto(void) {
     SIMDExecInstr instr = intSIMDInstr;
     if (instr == SIMD_AUTO)
-        return GetSIMDInstr();
+        return GetSIMDInstrCPU();
 
     return instr;
 }
 
-// determine the available instruction set at runtime and call the correct function
-uint64_t crack_states_bitsliced_dispatch(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p,
-                                         uint32_t *keys_found, uint64_t *num_keys_tested,
-                                         uint32_t nonces_to_bruteforce, const uint8_t *bf_test_nonce_2nd_byte,
-                                         noncelist_t *nonces) {
+// point both cores at the selected instruction set
+static void bf_dispatch_resolve(void) {
     switch (GetSIMDInstrAuto()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
         case SIMD_AVX512:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_AVX512;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX512;
             break;
 #endif
 #if defined(COMPILER_HAS_SIMD_X86)
         case SIMD_AVX2:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_AVX2;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX2;
             break;
         case SIMD_AVX:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_AVX;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX;
             break;
         case SIMD_SSE2:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_SSE2;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_SSE2;
             break;
         case SIMD_MMX:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_MMX;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_MMX;
             break;
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
         case SIMD_NEON:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_NEON;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_NEON;
             break;
 #endif
         case SIMD_AUTO:
         case SIMD_NONE:
             crack_states_bitsliced_function_p = &crack_states_bitsliced_NOSIMD;
+            bitslice_test_nonces_function_p = &bitslice_test_nonces_NOSIMD;
             break;
     }
+}
 
+// resolved right away, the brute force threads only ever read the pointers
+void SetSIMDInstr(SIMDExecInstr instr) {
+    intSIMDInstr = instr;
+    bf_dispatch_resolve();
+}
+
+// nobody called SetSIMDInstr() yet: determine the available instruction set now and call the correct function
+uint64_t crack_states_bitsliced_dispatch(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p,
+                                         uint32_t *keys_found, uint64_t *num_keys_tested,
+                                         uint32_t nonces_to_bruteforce, const uint8_t *bf_test_nonce_2nd_byte,
+                                         noncelist_t *nonces) {
+    bf_dispatch_resolve();
     // call the most optimized function for this CPU
     return (*crack_states_bitsliced_function_p)(cuid, best_first_bytes, p, keys_found, num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, nonces);
 }
 
 void bitslice_test_nonces_dispatch(uint32_t nonces_to_bruteforce, const uint32_t *bf_test_nonce, const uint8_t *bf_test_nonce_par) {
-    switch (GetSIMDInstrAuto()) {
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        case SIMD_AVX512:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX512;
-            break;
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-        case SIMD_AVX2:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX2;
-            break;
-        case SIMD_AVX:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_AVX;
-            break;
-        case SIMD_SSE2:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_SSE2;
-            break;
-        case SIMD_MMX:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_MMX;
-            break;
-#endif
-#if defined(COMPILER_HAS_SIMD_NEON)
-        case SIMD_NEON:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_NEON;
-            break;
-#endif
-        case SIMD_AUTO:
-        case SIMD_NONE:
-            bitslice_test_nonces_function_p = &bitslice_test_nonces_NOSIMD;
-            break;
-    }
-
+    bf_dispatch_resolve();
     // call the most optimized function for this CPU
     (*bitslice_test_nonces_function_p)(nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par);
 }
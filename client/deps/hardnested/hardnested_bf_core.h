@@ -89,6 +89,7 @@ typedef enum {
 } SIMDExecInstr;
 void SetSIMDInstr(SIMDExecInstr instr);
 SIMDExecInstr GetSIMDInstrAuto(void);
+SIMDExecInstr GetSIMDInstrCPU(void);    // best set of this CPU, whatever SetSIMDInstr() said
 
 uint64_t crack_states_bitsliced(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found, uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce, uint8_t *bf_test_nonce_2nd_byte, noncelist_t *nonces);
 void bitslice_test_nonces(uint32_t nonces_to_bruteforce, uint32_t *bf_test_nonce, uint8_t *bf_test_nonce_par);
@@ -0,0 +1,384 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// OpenCL brute force backend for hardnested
+//
+// Each work item takes one odd/even state pair of a bucket and runs it through
+// the 2nd to 4th byte of the test nonces, the same early filter the bitsliced
+// code applies. The few survivors are handed back and checked with verify_key().
+//
+// The OpenCL runtime is loaded at run time, the client neither needs the SDK
+// to build nor a GPU to run. Headers are the ones shipped with ht2crack5opencl.
+//-----------------------------------------------------------------------------
+
+#include "hardnested_bf_opencl.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#define CL_TARGET_OPENCL_VERSION 120
+#define CL_USE_DEPRECATED_OPENCL_1_2_APIS
+#include <CL/cl.h>
+#include <CL/cl_function_types.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#define OCL_LIBNAME             "OpenCL.dll"
+#define ocl_dlopen(name)        ((void *)LoadLibraryA(name))
+#define ocl_dlsym(h, sym)       ((void *)GetProcAddress((HMODULE)(h), sym))
+#else
+#include <dlfcn.h>
+#if defined(__APPLE__)
+#define OCL_LIBNAME             "/System/Library/Frameworks/OpenCL.framework/OpenCL"
+#else
+#define OCL_LIBNAME             "libOpenCL.so.1"
+#endif
+#define ocl_dlopen(name)        dlopen(name, RTLD_NOW)
+#define ocl_dlsym(h, sym)       dlsym(h, sym)
+#endif
+
+#include "ui.h"
+#include "crapto1/crapto1.h"
+
+#define BF_OPENCL_MAX_PLATFORMS 8
+#define BF_OPENCL_MAX_NONCES    256
+#define BF_OPENCL_LAUNCH_SIZE   (1 << 24)   // work items per kernel launch
+#define BF_OPENCL_MIN_HITS      (1 << 16)
+
+typedef enum {
+    EVEN_STATE = 0,
+    ODD_STATE = 1
+} odd_even_t;
+
+static const char *bf_kernel_source =
+    "#define LF_POLY_ODD  (0x29CE5C)\n"
+    "#define LF_POLY_EVEN (0x870804)\n"
+    "#define BIT(x, n)    ((x) >> (n) & 1)\n"
+    "\n"
+    "uint filter(uint x) {\n"
+    "    uint f;\n"
+    "    f  = 0xf22c0 >> (x       & 0xf) & 16;\n"
+    "    f |= 0x6c9c0 >> (x >>  4 & 0xf) &  8;\n"
+    "    f |= 0x3c8b0 >> (x >>  8 & 0xf) &  4;\n"
+    "    f |= 0x1e458 >> (x >> 12 & 0xf) &  2;\n"
+    "    f |= 0x0d938 >> (x >> 16 & 0xf) &  1;\n"
+    "    return BIT(0xEC57E80A, f);\n"
+    "}\n"
+    "\n"
+    "__kernel void hardnested_bf(__global const uint *odd_states, __global const uint *even_states, const uint odd_base,\n"
+    "                            __constant uint *nonce_enc, __constant uchar *par_enc, const uint nonce_cnt,\n"
+    "                            __global uint *hits, __global volatile uint *hit_cnt, const uint hits_max) {\n"
+    "    const uint even_idx = get_global_id(0);\n"
+    "    const uint odd_idx = odd_base + get_global_id(1);\n"
+    "    const uint odd = odd_states[odd_idx];\n"
+    "    const uint even = even_states[even_idx];\n"
+    "\n"
+    "    for (uint i = 0; i < nonce_cnt; i++) {\n"
+    "        uint o = odd, e = even;\n"
+    "        // first byte is already shifted in, start with the 2nd one like the bitsliced code\n"
+    "        for (int byte_pos = 2; byte_pos >= 0; byte_pos--) {\n"
+    "            const uint enc = nonce_enc[i] >> (8 * byte_pos) & 0xff;\n"
+    "            uint dec = 0;\n"
+    "            for (uint b = 0; b < 8; b++) {\n"
+    "                const uint bit = BIT(enc, b) ^ filter(o);\n"
+    "                dec |= bit << b;\n"
+    "                e = e << 1 | ((popcount((o & LF_POLY_ODD) ^ (e & LF_POLY_EVEN)) & 1) ^ bit);\n"
+    "                const uint t = o;\n"
+    "                o = e;\n"
+    "                e = t;\n"
+    "            }\n"
+    "            if (BIT(par_enc[i], byte_pos) != (filter(o) ^ (popcount(dec) & 1)))\n"
+    "                return;\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    const uint idx = atomic_inc(hit_cnt);\n"
+    "    if (idx < hits_max) {\n"
+    "        hits[2 * idx] = odd_idx;\n"
+    "        hits[2 * idx + 1] = even_idx;\n"
+    "    }\n"
+    "}\n";
+
+#define OCL_FUNCS(X) \
+    X(clGetPlatformIDs) \
+    X(clGetDeviceIDs) \
+    X(clGetDeviceInfo) \
+    X(clCreateContext) \
+    X(clCreateCommandQueue) \
+    X(clCreateProgramWithSource) \
+    X(clBuildProgram) \
+    X(clGetProgramBuildInfo) \
+    X(clCreateKernel) \
+    X(clCreateBuffer) \
+    X(clReleaseMemObject) \
+    X(clSetKernelArg) \
+    X(clEnqueueWriteBuffer) \
+    X(clEnqueueReadBuffer) \
+    X(clEnqueueNDRangeKernel)
+
+static struct {
+#define X(fn) fn##_fn fn;
+    OCL_FUNCS(X)
+#undef X
+} ocl;
+
+static struct {
+    bool tried;
+    bool ready;
+    cl_context context;
+    cl_command_queue queue;
+    cl_kernel kernel;
+    cl_mem nonce_enc;
+    cl_mem par_enc;
+    cl_mem hit_cnt;
+    cl_mem odd_states;
+    size_t odd_size;
+    cl_mem even_states;
+    size_t even_size;
+    cl_mem hits;
+    size_t hits_size;
+} bf_cl;
+
+static bool ocl_load(void) {
+    void *lib = ocl_dlopen(OCL_LIBNAME);
+    if (lib == NULL) {
+        return false;
+    }
+#define X(fn) \
+    ocl.fn = (fn##_fn)ocl_dlsym(lib, #fn); \
+    if (ocl.fn == NULL) { \
+        PrintAndLogEx(DEBUG, "OpenCL runtime lacks " #fn); \
+        return false; \
+    }
+    OCL_FUNCS(X)
+#undef X
+    return true;
+}
+
+// grow a device buffer to hold at least size bytes, the contents are not kept
+static bool ocl_buffer_reserve(cl_mem *buf, size_t *cur_size, size_t size, cl_mem_flags flags) {
+    if (*buf != NULL && *cur_size >= size) {
+        return true;
+    }
+    if (*buf != NULL) {
+        ocl.clReleaseMemObject(*buf);
+        *buf = NULL;
+        *cur_size = 0;
+    }
+    cl_int err;
+    *buf = ocl.clCreateBuffer(bf_cl.context, flags, size, NULL, &err);
+    if (err != CL_SUCCESS) {
+        *buf = NULL;
+        PrintAndLogEx(WARNING, "OpenCL: can't allocate %zu bytes on device (%d)", size, err);
+        return false;
+    }
+    *cur_size = size;
+    return true;
+}
+
+bool bf_opencl_init(void) {
+
+    if (bf_cl.tried) {
+        return bf_cl.ready;
+    }
+    bf_cl.tried = true;
+
+    if (ocl_load() == false) {
+        PrintAndLogEx(WARNING, "OpenCL runtime not found, brute forcing on CPU");
+        return false;
+    }
+
+    cl_platform_id platforms[BF_OPENCL_MAX_PLATFORMS];
+    cl_uint platform_cnt = 0;
+    if (ocl.clGetPlatformIDs(BF_OPENCL_MAX_PLATFORMS, platforms, &platform_cnt) != CL_SUCCESS) {
+        platform_cnt = 0;
+    }
+
+    cl_device_id device = NULL;
+    for (cl_uint i = 0; i < platform_cnt && i < BF_OPENCL_MAX_PLATFORMS; i++) {
+        cl_uint device_cnt = 0;
+        if (ocl.clGetDeviceIDs(platforms[i], CL_DEVICE_TYPE_GPU, 1, &device, &device_cnt) == CL_SUCCESS && device_cnt) {
+            break;
+        }
+        device = NULL;
+    }
+    if (device == NULL) {
+        PrintAndLogEx(WARNING, "No OpenCL GPU found, brute forcing on CPU");
+        return false;
+    }
+
+    char name[0x100] = {0};
+    ocl.clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name) - 1, name, NULL);
+
+    cl_int err;
+    bf_cl.context = ocl.clCreateContext(NULL, 1, &device, NULL, NULL, &err);
+    if (err != CL_SUCCESS) {
+        PrintAndLogEx(WARNING, "OpenCL: clCreateContext() failed (%d)", err);
+        return false;
+    }
+    bf_cl.queue = ocl.clCreateCommandQueue(bf_cl.context, device, 0, &err);
+    if (err != CL_SUCCESS) {
+        PrintAndLogEx(WARNING, "OpenCL: clCreateCommandQueue() failed (%d)", err);
+        return false;
+    }
+
+    cl_program program = ocl.clCreateProgramWithSource(bf_cl.context, 1, &bf_kernel_source, NULL, &err);
+    if (err != CL_SUCCESS) {
+        PrintAndLogEx(WARNING, "OpenCL: clCreateProgramWithSource() failed (%d)", err);
+        return false;
+    }
+    err = ocl.clBuildProgram(program, 1, &device, NULL, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        char log[0x1000] = {0};
+        ocl.clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, sizeof(log) - 1, log, NULL);
+        PrintAndLogEx(WARNING, "OpenCL: clBuildProgram() failed (%d)", err);
+        PrintAndLogEx(DEBUG, "%s", log);
+        return false;
+    }
+    bf_cl.kernel = ocl.clCreateKernel(program, "hardnested_bf", &err);
+    if (err != CL_SUCCESS) {
+        PrintAndLogEx(WARNING, "OpenCL: clCreateKernel() failed (%d)", err);
+        return false;
+    }
+
+    size_t dummy = 0;
+    if (ocl_buffer_reserve(&bf_cl.nonce_enc, &dummy, BF_OPENCL_MAX_NONCES * sizeof(uint32_t), CL_MEM_READ_ONLY) == false ||
+            ocl_buffer_reserve(&bf_cl.par_enc, &dummy, BF_OPENCL_MAX_NONCES * sizeof(uint8_t), CL_MEM_READ_ONLY) == false ||
+            ocl_buffer_reserve(&bf_cl.hit_cnt, &dummy, sizeof(uint32_t), CL_MEM_READ_WRITE) == false) {
+        return false;
+    }
+
+    PrintAndLogEx(INFO, "Brute forcing on OpenCL device " _YELLOW_("%s"), name);
+    bf_cl.ready = true;
+    return true;
+}
+
+bool crack_states_opencl(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found,
+                         uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce,
+                         const uint32_t *bf_test_nonce, const uint8_t *bf_test_nonce_par,
+                         noncelist_t *nonces, uint64_t *key) {
+
+    *key = -1;
+    if (bf_cl.ready == false || nonces_to_bruteforce > BF_OPENCL_MAX_NONCES) {
+        return false;
+    }
+
+    const uint32_t odd_cnt = p->len[ODD_STATE];
+    const uint32_t even_cnt = p->len[EVEN_STATE];
+    if (odd_cnt == 0 || even_cnt == 0) {
+        return true;
+    }
+
+    cl_int err = CL_SUCCESS;
+    uint32_t *hits = NULL;
+
+    // a single row of odd states always fits, so halving the launch on overflow terminates
+    uint32_t hits_max = even_cnt < BF_OPENCL_MIN_HITS ? BF_OPENCL_MIN_HITS : even_cnt;
+    if (ocl_buffer_reserve(&bf_cl.odd_states, &bf_cl.odd_size, odd_cnt * sizeof(uint32_t), CL_MEM_READ_ONLY) == false ||
+            ocl_buffer_reserve(&bf_cl.even_states, &bf_cl.even_size, even_cnt * sizeof(uint32_t), CL_MEM_READ_ONLY) == false ||
+            ocl_buffer_reserve(&bf_cl.hits, &bf_cl.hits_size, (size_t)hits_max * 2 * sizeof(uint32_t), CL_MEM_WRITE_ONLY) == false) {
+        goto fail;
+    }
+    hits_max = bf_cl.hits_size / (2 * sizeof(uint32_t));
+
+    hits = calloc(hits_max, 2 * sizeof(uint32_t));
+    if (hits == NULL) {
+        PrintAndLogEx(WARNING, "Out of memory error in brute_force. Aborting...");
+        return false;
+    }
+
+    err |= ocl.clEnqueueWriteBuffer(bf_cl.queue, bf_cl.odd_states, CL_TRUE, 0, odd_cnt * sizeof(uint32_t), p->states[ODD_STATE], 0, NULL, NULL);
+    err |= ocl.clEnqueueWriteBuffer(bf_cl.queue, bf_cl.even_states, CL_TRUE, 0, even_cnt * sizeof(uint32_t), p->states[EVEN_STATE], 0, NULL, NULL);
+    err |= ocl.clEnqueueWriteBuffer(bf_cl.queue, bf_cl.nonce_enc, CL_TRUE, 0, nonces_to_bruteforce * sizeof(uint32_t), bf_test_nonce, 0, NULL, NULL);
+    err |= ocl.clEnqueueWriteBuffer(bf_cl.queue, bf_cl.par_enc, CL_TRUE, 0, nonces_to_bruteforce * sizeof(uint8_t), bf_test_nonce_par, 0, NULL, NULL);
+
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 0, sizeof(cl_mem), &bf_cl.odd_states);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 1, sizeof(cl_mem), &bf_cl.even_states);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 3, sizeof(cl_mem), &bf_cl.nonce_enc);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 4, sizeof(cl_mem), &bf_cl.par_enc);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 5, sizeof(uint32_t), &nonces_to_bruteforce);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 6, sizeof(cl_mem), &bf_cl.hits);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 7, sizeof(cl_mem), &bf_cl.hit_cnt);
+    err |= ocl.clSetKernelArg(bf_cl.kernel, 8, sizeof(uint32_t), &hits_max);
+    if (err != CL_SUCCESS) {
+        goto fail;
+    }
+
+    uint64_t bucket_states_tested = 0;
+    uint32_t rows = BF_OPENCL_LAUNCH_SIZE / even_cnt;
+    if (rows == 0) {
+        rows = 1;
+    }
+
+    for (uint32_t odd_base = 0; odd_base < odd_cnt && *keys_found == 0;) {
+
+        const uint32_t n = (odd_cnt - odd_base) < rows ? odd_cnt - odd_base : rows;
+        const uint32_t zero = 0;
+        uint32_t hit_cnt = 0;
+        size_t work_size[2] = { even_cnt, n };
+
+        err = ocl.clEnqueueWriteBuffer(bf_cl.queue, bf_cl.hit_cnt, CL_FALSE, 0, sizeof(uint32_t), &zero, 0, NULL, NULL);
+        err |= ocl.clSetKernelArg(bf_cl.kernel, 2, sizeof(uint32_t), &odd_base);
+        err |= ocl.clEnqueueNDRangeKernel(bf_cl.queue, bf_cl.kernel, 2, NULL, work_size, NULL, 0, NULL, NULL);
+        err |= ocl.clEnqueueReadBuffer(bf_cl.queue, bf_cl.hit_cnt, CL_TRUE, 0, sizeof(uint32_t), &hit_cnt, 0, NULL, NULL);
+        if (err != CL_SUCCESS) {
+            goto fail;
+        }
+
+        if (hit_cnt > hits_max) {
+            // too few test nonces to filter well, redo in smaller steps
+            rows = n / 2;
+            continue;
+        }
+
+        if (hit_cnt) {
+            err = ocl.clEnqueueReadBuffer(bf_cl.queue, bf_cl.hits, CL_TRUE, 0, (size_t)hit_cnt * 2 * sizeof(uint32_t), hits, 0, NULL, NULL);
+            if (err != CL_SUCCESS) {
+                goto fail;
+            }
+        }
+
+        for (uint32_t i = 0; i < hit_cnt; i++) {
+            const uint32_t odd = p->states[ODD_STATE][hits[2 * i]];
+            const uint32_t even = p->states[EVEN_STATE][hits[2 * i + 1]];
+            if (verify_key(cuid, nonces, best_first_bytes, odd, even)) {
+                struct Crypto1State pcs;
+                pcs.odd = odd;
+                pcs.even = even;
+                lfsr_rollback_byte(&pcs, (cuid >> 24) ^ best_first_bytes[0], true);
+                crypto1_get_lfsr(&pcs, key);
+                break;
+            }
+        }
+
+        bucket_states_tested += (uint64_t)n * even_cnt;
+        odd_base += n;
+
+        if (*key != -1) {
+            break;
+        }
+    }
+
+    free(hits);
+    __sync_fetch_and_add(num_keys_tested, bucket_states_tested);
+    return true;
+
+fail:
+    free(hits);
+    PrintAndLogEx(WARNING, "OpenCL device error (%d), brute forcing on CPU", err);
+    bf_cl.ready = false;
+    return false;
+}
@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// OpenCL brute force backend for hardnested
+//-----------------------------------------------------------------------------
+
+#ifndef HARDNESTED_BF_OPENCL_H__
+#define HARDNESTED_BF_OPENCL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hardnested_bruteforce.h" // statelist_t
+
+// Loads the OpenCL runtime and builds the kernel on the first GPU found.
+// Safe to call repeatedly, returns false if no usable device is available.
+bool bf_opencl_init(void);
+
+// Tests every odd/even pair of a bucket like crack_states_bitsliced(). Candidates are
+// filtered on the device and confirmed with verify_key() on the host.
+// Returns false on a device error, the bucket then has to be redone on the CPU.
+bool crack_states_opencl(uint32_t cuid, uint8_t *best_first_bytes, statelist_t *p, uint32_t *keys_found,
+                         uint64_t *num_keys_tested, uint32_t nonces_to_bruteforce,
+                         const uint32_t *bf_test_nonce, const uint8_t *bf_test_nonce_par,
+                         noncelist_t *nonces, uint64_t *key);
+
+#endif
@@ -318,307 +318,124 @@ count_bitarray_AND2_t *count_bitarray_AND2_function_p = &count_bitarray_AND2_dis
 count_bitarray_AND3_t *count_bitarray_AND3_function_p = &count_bitarray_AND3_dispatch;
 count_bitarray_AND4_t *count_bitarray_AND4_function_p = &count_bitarray_AND4_dispatch;
 
-// determine the available instruction set at runtime and call the correct function
-uint32_t *malloc_bitarray_dispatch(uint32_t x) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) malloc_bitarray_function_p = &malloc_bitarray_NEON;
-    else
-#endif
-
+// point all the bitarray functions at one instruction set. They go together: the arrays
+// from malloc_bitarray() are aligned for the set which works on them.
+#define BITARRAY_FUNCTIONS(SET) \
+    malloc_bitarray_function_p = &malloc_bitarray_##SET; \
+    free_bitarray_function_p = &free_bitarray_##SET; \
+    bitcount_function_p = &bitcount_##SET; \
+    count_states_function_p = &count_states_##SET; \
+    bitarray_AND_function_p = &bitarray_AND_##SET; \
+    bitarray_low20_AND_function_p = &bitarray_low20_AND_##SET; \
+    count_bitarray_AND_function_p = &count_bitarray_AND_##SET; \
+    count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_##SET; \
+    bitarray_AND4_function_p = &bitarray_AND4_##SET; \
+    bitarray_OR_function_p = &bitarray_OR_##SET; \
+    count_bitarray_AND2_function_p = &count_bitarray_AND2_##SET; \
+    count_bitarray_AND3_function_p = &count_bitarray_AND3_##SET; \
+    count_bitarray_AND4_function_p = &count_bitarray_AND4_##SET;
+
+// determine the available instruction set once, on the first call of any bitarray function.
+// SetSIMDInstr() doesn't apply here, arrays already allocated may not suit another set.
+static void bitarray_dispatch_resolve(void) {
+    switch (GetSIMDInstrCPU()) {
 #if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) malloc_bitarray_function_p = &malloc_bitarray_AVX512;
-        else
+        case SIMD_AVX512:
+            BITARRAY_FUNCTIONS(AVX512)
+            break;
 #endif
 #if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) malloc_bitarray_function_p = &malloc_bitarray_AVX2;
-            else if (__builtin_cpu_supports("avx")) malloc_bitarray_function_p = &malloc_bitarray_AVX;
-            else if (__builtin_cpu_supports("sse2")) malloc_bitarray_function_p = &malloc_bitarray_SSE2;
-            else if (__builtin_cpu_supports("mmx")) malloc_bitarray_function_p = &malloc_bitarray_MMX;
-            else
+        case SIMD_AVX2:
+            BITARRAY_FUNCTIONS(AVX2)
+            break;
+        case SIMD_AVX:
+            BITARRAY_FUNCTIONS(AVX)
+            break;
+        case SIMD_SSE2:
+            BITARRAY_FUNCTIONS(SSE2)
+            break;
+        case SIMD_MMX:
+            BITARRAY_FUNCTIONS(MMX)
+            break;
 #endif
-                malloc_bitarray_function_p = &malloc_bitarray_NOSIMD;
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            BITARRAY_FUNCTIONS(NEON)
+            break;
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+            BITARRAY_FUNCTIONS(NOSIMD)
+            break;
+    }
+}
 
-    // call the most optimized function for this CPU
+// resolve, then call the most optimized function for this CPU
+uint32_t *malloc_bitarray_dispatch(uint32_t x) {
+    bitarray_dispatch_resolve();
     return (*malloc_bitarray_function_p)(x);
 }
 
 void free_bitarray_dispatch(uint32_t *x) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) free_bitarray_function_p = &free_bitarray_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) free_bitarray_function_p = &free_bitarray_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) free_bitarray_function_p = &free_bitarray_AVX2;
-            else if (__builtin_cpu_supports("avx")) free_bitarray_function_p = &free_bitarray_AVX;
-            else if (__builtin_cpu_supports("sse2")) free_bitarray_function_p = &free_bitarray_SSE2;
-            else if (__builtin_cpu_supports("mmx")) free_bitarray_function_p = &free_bitarray_MMX;
-            else
-#endif
-                free_bitarray_function_p = &free_bitarray_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     (*free_bitarray_function_p)(x);
 }
 
 uint32_t bitcount_dispatch(uint32_t a) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) bitcount_function_p = &bitcount_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) bitcount_function_p = &bitcount_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) bitcount_function_p = &bitcount_AVX2;
-            else if (__builtin_cpu_supports("avx")) bitcount_function_p = &bitcount_AVX;
-            else if (__builtin_cpu_supports("sse2")) bitcount_function_p = &bitcount_SSE2;
-            else if (__builtin_cpu_supports("mmx")) bitcount_function_p = &bitcount_MMX;
-            else
-#endif
-                bitcount_function_p = &bitcount_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*bitcount_function_p)(a);
 }
 
 uint32_t count_states_dispatch(uint32_t *bitarray) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_states_function_p = &count_states_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_states_function_p = &count_states_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_states_function_p = &count_states_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_states_function_p = &count_states_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_states_function_p = &count_states_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_states_function_p = &count_states_MMX;
-            else
-#endif
-                count_states_function_p = &count_states_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_states_function_p)(bitarray);
 }
 
 void bitarray_AND_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) bitarray_AND_function_p = &bitarray_AND_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) bitarray_AND_function_p = &bitarray_AND_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) bitarray_AND_function_p = &bitarray_AND_AVX2;
-            else if (__builtin_cpu_supports("avx")) bitarray_AND_function_p = &bitarray_AND_AVX;
-            else if (__builtin_cpu_supports("sse2")) bitarray_AND_function_p = &bitarray_AND_SSE2;
-            else if (__builtin_cpu_supports("mmx")) bitarray_AND_function_p = &bitarray_AND_MMX;
-            else
-#endif
-                bitarray_AND_function_p = &bitarray_AND_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     (*bitarray_AND_function_p)(A, B);
 }
 
 void bitarray_low20_AND_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) bitarray_low20_AND_function_p = &bitarray_low20_AND_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX2;
-            else if (__builtin_cpu_supports("avx")) bitarray_low20_AND_function_p = &bitarray_low20_AND_AVX;
-            else if (__builtin_cpu_supports("sse2")) bitarray_low20_AND_function_p = &bitarray_low20_AND_SSE2;
-            else if (__builtin_cpu_supports("mmx")) bitarray_low20_AND_function_p = &bitarray_low20_AND_MMX;
-            else
-#endif
-                bitarray_low20_AND_function_p = &bitarray_low20_AND_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     (*bitarray_low20_AND_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_bitarray_AND_function_p = &count_bitarray_AND_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_bitarray_AND_function_p = &count_bitarray_AND_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_bitarray_AND_function_p = &count_bitarray_AND_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_bitarray_AND_function_p = &count_bitarray_AND_MMX;
-            else
-#endif
-                count_bitarray_AND_function_p = &count_bitarray_AND_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_bitarray_AND_function_p)(A, B);
 }
 
 uint32_t count_bitarray_low20_AND_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_MMX;
-            else
-#endif
-                count_bitarray_low20_AND_function_p = &count_bitarray_low20_AND_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_bitarray_low20_AND_function_p)(A, B);
 }
 
 void bitarray_AND4_dispatch(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) bitarray_AND4_function_p = &bitarray_AND4_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) bitarray_AND4_function_p = &bitarray_AND4_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) bitarray_AND4_function_p = &bitarray_AND4_AVX2;
-            else if (__builtin_cpu_supports("avx")) bitarray_AND4_function_p = &bitarray_AND4_AVX;
-            else if (__builtin_cpu_supports("sse2")) bitarray_AND4_function_p = &bitarray_AND4_SSE2;
-            else if (__builtin_cpu_supports("mmx")) bitarray_AND4_function_p = &bitarray_AND4_MMX;
-            else
-#endif
-                bitarray_AND4_function_p = &bitarray_AND4_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     (*bitarray_AND4_function_p)(A, B, C, D);
 }
 
 void bitarray_OR_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) bitarray_OR_function_p = &bitarray_OR_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) bitarray_OR_function_p = &bitarray_OR_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) bitarray_OR_function_p = &bitarray_OR_AVX2;
-            else if (__builtin_cpu_supports("avx")) bitarray_OR_function_p = &bitarray_OR_AVX;
-            else if (__builtin_cpu_supports("sse2")) bitarray_OR_function_p = &bitarray_OR_SSE2;
-            else if (__builtin_cpu_supports("mmx")) bitarray_OR_function_p = &bitarray_OR_MMX;
-            else
-#endif
-                bitarray_OR_function_p = &bitarray_OR_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     (*bitarray_OR_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND2_dispatch(uint32_t *A, uint32_t *B) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_bitarray_AND2_function_p = &count_bitarray_AND2_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_bitarray_AND2_function_p = &count_bitarray_AND2_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_bitarray_AND2_function_p = &count_bitarray_AND2_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_bitarray_AND2_function_p = &count_bitarray_AND2_MMX;
-            else
-#endif
-                count_bitarray_AND2_function_p = &count_bitarray_AND2_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_bitarray_AND2_function_p)(A, B);
 }
 
 uint32_t count_bitarray_AND3_dispatch(uint32_t *A, uint32_t *B, uint32_t *C) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_bitarray_AND3_function_p = &count_bitarray_AND3_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_bitarray_AND3_function_p = &count_bitarray_AND3_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_bitarray_AND3_function_p = &count_bitarray_AND3_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_bitarray_AND3_function_p = &count_bitarray_AND3_MMX;
-            else
-#endif
-                count_bitarray_AND3_function_p = &count_bitarray_AND3_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_bitarray_AND3_function_p)(A, B, C);
 }
 
 uint32_t count_bitarray_AND4_dispatch(uint32_t *A, uint32_t *B, uint32_t *C, uint32_t *D) {
-#if defined(COMPILER_HAS_SIMD_NEON)
-    if (arm_has_neon()) count_bitarray_AND4_function_p = &count_bitarray_AND4_NEON;
-    else
-#endif
-
-#if defined(COMPILER_HAS_SIMD_AVX512)
-        if (__builtin_cpu_supports("avx512f")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX512;
-        else
-#endif
-#if defined(COMPILER_HAS_SIMD_X86)
-            if (__builtin_cpu_supports("avx2")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX2;
-            else if (__builtin_cpu_supports("avx")) count_bitarray_AND4_function_p = &count_bitarray_AND4_AVX;
-            else if (__builtin_cpu_supports("sse2")) count_bitarray_AND4_function_p = &count_bitarray_AND4_SSE2;
-            else if (__builtin_cpu_supports("mmx")) count_bitarray_AND4_function_p = &count_bitarray_AND4_MMX;
-            else
-#endif
-                count_bitarray_AND4_function_p = &count_bitarray_AND4_NOSIMD;
-
-    // call the most optimized function for this CPU
+    bitarray_dispatch_resolve();
     return (*count_bitarray_AND4_function_p)(A, B, C, D);
 }
 
-
 ///////////////////////////////////////////////77
 // Entries to dispatched function calls
 
@@ -60,6 +60,7 @@ THE SOFTWARE.
 #include "proxmark3.h"
 #include "cmdhfmfhard.h"
 #include "hardnested_bf_core.h"
+#include "hardnested_bf_opencl.h"
 #include "ui.h"
 #include "util.h"
 #include "util_posix.h"
@@ -79,6 +80,10 @@ THE SOFTWARE.
 // #define DEBUG_BRUTE_FORCE
 
 #define MIN_BUCKETS_SIZE                128
+#define MAX_BUCKET_KEYS                 (1ULL << 34)  // larger buckets are sliced, gives load balancing and finer checkpoints
+#define CHECKPOINT_INTERVAL             60000         // ms between two checkpoint writes
+#define CHECKPOINT_MAGIC                "HNBF"
+#define CHECKPOINT_VERSION              1
 
 typedef enum {
     EVEN_STATE = 0,
@@ -95,6 +100,177 @@ static statelist_t **buckets = NULL;
 static uint32_t keys_found = 0;
 static uint64_t num_keys_tested;
 static uint64_t found_bs_key = 0;
+static bool bf_opencl = false;
+static int bf_num_threads;
+
+static statelist_t *bucket_slices = NULL;
+static uint64_t *bucket_hash = NULL;
+static char checkpoint_fn[FILE_PATH_SIZE] = {0};
+static uint8_t *checkpoint_header = NULL;
+static uint32_t checkpoint_header_len = 0;
+static uint64_t *buckets_done = NULL;      // hashes of the buckets already searched
+static uint32_t num_buckets_done = 0;
+static uint32_t buckets_done_allocated = 0;
+static uint64_t last_checkpoint = 0;
+static pthread_mutex_t checkpoint_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void SetBruteForceOpenCL(bool enable) {
+    bf_opencl = enable;
+}
+
+static int compare_uint64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// FNV-1a over the states, identifies a bucket independent of the order the candidates were generated in
+static uint64_t hash_bucket(const statelist_t *p) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (uint8_t oe = EVEN_STATE; oe <= ODD_STATE; oe++) {
+        h = (h ^ p->len[oe]) * 0x100000001b3ULL;
+        for (uint32_t i = 0; i < p->len[oe]; i++) {
+            h = (h ^ p->states[oe][i]) * 0x100000001b3ULL;
+        }
+    }
+    return h;
+}
+
+static void write_checkpoint(void) {
+    char tmp_fn[FILE_PATH_SIZE + 4];
+    snprintf(tmp_fn, sizeof(tmp_fn), "%s.tmp", checkpoint_fn);
+
+    FILE *f = fopen(tmp_fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "Could not write checkpoint file " _YELLOW_("%s"), tmp_fn);
+        return;
+    }
+    uint8_t version = CHECKPOINT_VERSION;
+    fwrite(CHECKPOINT_MAGIC, 1, 4, f);
+    fwrite(&version, 1, 1, f);
+    fwrite(&checkpoint_header_len, 1, sizeof(checkpoint_header_len), f);
+    fwrite(checkpoint_header, 1, checkpoint_header_len, f);
+    fwrite(&num_buckets_done, 1, sizeof(num_buckets_done), f);
+    fwrite(buckets_done, sizeof(uint64_t), num_buckets_done, f);
+    bool ok = (ferror(f) == 0);
+    fclose(f);
+
+    if (ok == false) {
+        remove(tmp_fn);
+        return;
+    }
+#if defined(_WIN32)
+    remove(checkpoint_fn);
+#endif
+    rename(tmp_fn, checkpoint_fn);
+}
+
+static void add_bucket_done(uint64_t hash) {
+    pthread_mutex_lock(&checkpoint_mutex);
+    if (num_buckets_done == buckets_done_allocated) {
+        uint32_t alloc_sz = (buckets_done_allocated == 0) ? MIN_BUCKETS_SIZE : buckets_done_allocated * 2;
+        uint64_t *new_done = realloc(buckets_done, alloc_sz * sizeof(uint64_t));
+        if (new_done == NULL) {
+            pthread_mutex_unlock(&checkpoint_mutex);
+            return;
+        }
+        buckets_done = new_done;
+        buckets_done_allocated = alloc_sz;
+    }
+    buckets_done[num_buckets_done++] = hash;
+
+    if (checkpoint_fn[0] != '\0' && msclock() - last_checkpoint > CHECKPOINT_INTERVAL) {
+        write_checkpoint();
+        last_checkpoint = msclock();
+    }
+    pthread_mutex_unlock(&checkpoint_mutex);
+}
+
+void SetBruteForceCheckpoint(const char *filename, const uint8_t *header, uint32_t header_len) {
+    free(checkpoint_header);
+    checkpoint_header = NULL;
+    checkpoint_header_len = 0;
+    checkpoint_fn[0] = '\0';
+
+    if (filename == NULL) {
+        return;
+    }
+
+    checkpoint_header = calloc(header_len, sizeof(uint8_t));
+    if (checkpoint_header == NULL && header_len) {
+        return;
+    }
+    memcpy(checkpoint_header, header, header_len);
+    checkpoint_header_len = header_len;
+    strncpy(checkpoint_fn, filename, sizeof(checkpoint_fn) - 1);
+    last_checkpoint = msclock();
+}
+
+int LoadBruteForceCheckpoint(const char *filename, uint8_t **header, uint32_t *header_len) {
+    FILE *f = fopen(filename, "rb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "Could not open checkpoint file " _YELLOW_("%s"), filename);
+        return PM3_EFILE;
+    }
+
+    char magic[4] = {0};
+    uint8_t version = 0;
+    uint32_t len = 0, num = 0;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, CHECKPOINT_MAGIC, 4) ||
+            fread(&version, 1, 1, f) != 1 || version != CHECKPOINT_VERSION ||
+            fread(&len, 1, sizeof(len), f) != sizeof(len)) {
+        PrintAndLogEx(WARNING, "File " _YELLOW_("%s") " is not a brute force checkpoint", filename);
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    uint8_t *hdr = calloc(len + 1, sizeof(uint8_t));
+    if (hdr == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+    if (fread(hdr, 1, len, f) != len || fread(&num, 1, sizeof(num), f) != sizeof(num)) {
+        PrintAndLogEx(WARNING, "Checkpoint file " _YELLOW_("%s") " is truncated", filename);
+        free(hdr);
+        fclose(f);
+        return PM3_EFILE;
+    }
+
+    uint64_t *done = calloc(num + 1, sizeof(uint64_t));
+    if (done == NULL) {
+        free(hdr);
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+    // a partially written list is still usable
+    num = fread(done, sizeof(uint64_t), num, f);
+    fclose(f);
+
+    pthread_mutex_lock(&checkpoint_mutex);
+    free(buckets_done);
+    buckets_done = done;
+    num_buckets_done = num;
+    buckets_done_allocated = num + 1;
+    pthread_mutex_unlock(&checkpoint_mutex);
+
+    *header = hdr;
+    *header_len = len;
+    return PM3_SUCCESS;
+}
+
+void ClearBruteForceCheckpoint(void) {
+    pthread_mutex_lock(&checkpoint_mutex);
+    if (checkpoint_fn[0] != '\0') {
+        remove(checkpoint_fn);
+    }
+    free(buckets_done);
+    buckets_done = NULL;
+    num_buckets_done = 0;
+    buckets_done_allocated = 0;
+    pthread_mutex_unlock(&checkpoint_mutex);
+    SetBruteForceCheckpoint(NULL, NULL, 0);
+}
 
 uint8_t trailing_zeros(uint8_t byte) {
     static const uint8_t trailing_zeros_LUT[256] = {
@@ -160,7 +336,6 @@ crack_states_thread(void *x) {
         uint8_t *best_first_bytes;
     } *thread_arg;
 
-    const int num_brute_force_threads = NUM_BRUTE_FORCE_THREADS;
     thread_arg = (struct arg *)x;
     const int thread_id = thread_arg->thread_ID;
     uint32_t current_bucket = thread_id;
@@ -170,7 +345,11 @@ crack_states_thread(void *x) {
 #if defined (DEBUG_BRUTE_FORCE)
             PrintAndLogEx(INFO, "Thread " _YELLOW_("%u") " starts working on bucket " _YELLOW_("%u") "\n", thread_id, current_bucket);
 #endif
-            const uint64_t key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
+            uint64_t key = -1;
+            if (bf_opencl == false ||
+                    crack_states_opencl(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par, thread_arg->nonces, &key) == false) {
+                key = crack_states_bitsliced(thread_arg->cuid, thread_arg->best_first_bytes, bucket, &keys_found, &num_keys_tested, nonces_to_bruteforce, bf_test_nonce_2nd_byte, thread_arg->nonces);
+            }
             if (key != -1) {
                 __atomic_fetch_add(&keys_found, 1, __ATOMIC_SEQ_CST);
                 __atomic_fetch_add(&found_bs_key, key, __ATOMIC_SEQ_CST);
@@ -185,6 +364,8 @@ crack_states_thread(void *x) {
                 break;
             } else {
                 if (!thread_arg->silent) {
+                    add_bucket_done(bucket_hash[current_bucket]);
+
                     char progress_text[80];
                     snprintf(progress_text, sizeof(progress_text), "Brute force phase: %6.02f%%  ", 100.0 * (float)num_keys_tested / (float)(thread_arg->maximum_states));
                     float remaining_bruteforce = thread_arg->nonces[thread_arg->best_first_bytes[0]].expected_num_brute_force - (float)num_keys_tested / 2;
@@ -192,7 +373,7 @@ crack_states_thread(void *x) {
                 }
             }
         }
-        current_bucket += num_brute_force_threads;
+        current_bucket += bf_num_threads;
     }
     return NULL;
 }
@@ -325,7 +506,9 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 #endif
     bool silent = (bf_rate != NULL);
 
-    const int num_brute_force_threads = NUM_BRUTE_FORCE_THREADS;
+    // a single thread feeds the GPU, it falls back to the CPU per bucket on device errors
+    bf_num_threads = (bf_opencl && bf_opencl_init()) ? 1 : NUM_BRUTE_FORCE_THREADS;
+    const int num_brute_force_threads = bf_num_threads;
 
     keys_found = 0;
     num_keys_tested = 0;
@@ -333,20 +516,67 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
 
     bitslice_test_nonces(nonces_to_bruteforce, bf_test_nonce, bf_test_nonce_par);
 
+    // split big buckets into slices of odd states
+    uint32_t num_slices = 0;
+    for (statelist_t *p = candidates; p != NULL; p = p->next) {
+        if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
+            num_slices += ((uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE]) / MAX_BUCKET_KEYS + 1;
+        }
+    }
+    bucket_slices = calloc(num_slices + 1, sizeof(statelist_t));
+    bucket_hash = calloc(num_slices + 1, sizeof(uint64_t));
+    if (bucket_slices == NULL || bucket_hash == NULL) {
+        PrintAndLogEx(ERR, "Can't allocate buckets, abort!");
+        free(bucket_slices);
+        free(bucket_hash);
+        bucket_slices = NULL;
+        bucket_hash = NULL;
+        return false;
+    }
+
+    pthread_mutex_lock(&checkpoint_mutex);
+    qsort(buckets_done, num_buckets_done, sizeof(uint64_t), compare_uint64);
+    pthread_mutex_unlock(&checkpoint_mutex);
+
     // count number of states to go
     bucket_count = 0;
+    uint32_t num_skipped = 0;
     for (statelist_t *p = candidates; p != NULL; p = p->next) {
         if (p->states[ODD_STATE] != NULL && p->states[EVEN_STATE] != NULL) {
-            if (!ensure_buckets_alloc(bucket_count + 1)) {
-                PrintAndLogEx(ERR, "Can't allocate buckets, abort!");
-                return false;
-            }
+            uint32_t n = ((uint64_t)p->len[ODD_STATE] * p->len[EVEN_STATE]) / MAX_BUCKET_KEYS + 1;
+            uint32_t slice_len = (p->len[ODD_STATE] + n - 1) / n;
+            for (uint32_t offset = 0; offset < p->len[ODD_STATE]; offset += slice_len) {
+                if (!ensure_buckets_alloc(bucket_count + 1)) {
+                    PrintAndLogEx(ERR, "Can't allocate buckets, abort!");
+                    return false;
+                }
 
-            buckets[bucket_count] = p;
-            bucket_count++;
+                statelist_t *slice = &bucket_slices[bucket_count];
+                slice->states[EVEN_STATE] = p->states[EVEN_STATE];
+                slice->len[EVEN_STATE] = p->len[EVEN_STATE];
+                slice->states[ODD_STATE] = p->states[ODD_STATE] + offset;
+                slice->len[ODD_STATE] = MIN(slice_len, p->len[ODD_STATE] - offset);
+
+                bucket_hash[bucket_count] = hash_bucket(slice);
+                if (num_buckets_done && bsearch(&bucket_hash[bucket_count], buckets_done, num_buckets_done, sizeof(uint64_t), compare_uint64)) {
+                    // searched before the checkpoint was written
+                    num_keys_tested += (uint64_t)slice->len[ODD_STATE] * slice->len[EVEN_STATE];
+                    buckets[bucket_count] = NULL;
+                    num_skipped++;
+                } else {
+                    buckets[bucket_count] = slice;
+                }
+                bucket_count++;
+            }
         }
     }
 
+    if (num_skipped && !silent) {
+        char progress_text[80];
+        snprintf(progress_text, sizeof(progress_text), "Skipping %u of %u buckets done before", num_skipped, bucket_count);
+        hardnested_print_progress(num_acquired_nonces, progress_text, nonces[best_first_bytes[0]].expected_num_brute_force - (float)num_keys_tested / 2, 0);
+    }
+
     uint64_t start_time = msclock();
 
 #if defined(__linux__) ||  defined(__APPLE__)
@@ -382,6 +612,10 @@ bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint
     free(buckets);
     buckets = NULL;
     buckets_allocated = 0;
+    free(bucket_slices);
+    bucket_slices = NULL;
+    free(bucket_hash);
+    bucket_hash = NULL;
 
     uint64_t elapsed_time = msclock() - start_time;
 
@@ -54,6 +54,14 @@ typedef struct {
 } statelist_t;
 
 void prepare_bf_test_nonces(noncelist_t *nonces, uint8_t best_first_byte);
+// brute force on an OpenCL GPU if one is available
+void SetBruteForceOpenCL(bool enable);
+// searched buckets are written to <filename> every minute, behind an opaque header. NULL disables it
+void SetBruteForceCheckpoint(const char *filename, const uint8_t *header, uint32_t header_len);
+// buckets listed in the checkpoint are skipped by the following brute force runs
+int LoadBruteForceCheckpoint(const char *filename, uint8_t **header, uint32_t *header_len);
+// deletes the checkpoint file and forgets all progress
+void ClearBruteForceCheckpoint(void);
 bool brute_force_bs(float *bf_rate, statelist_t *candidates, uint32_t cuid, uint32_t num_acquired_nonces, uint64_t maximum_states, noncelist_t *nonces, uint8_t *best_first_bytes, uint64_t *found_key);
 float brute_force_benchmark(void);
 uint8_t trailing_zeros(uint8_t byte);
@@ -0,0 +1,10 @@
+add_library(pm3rrg_rdv4_hitag2crack5 STATIC
+        hitag2crack5/ht2crack5.c
+)
+target_compile_options(    pm3rrg_rdv4_hitag2crack5 PRIVATE   -Wall -O3)
+target_include_directories(pm3rrg_rdv4_hitag2crack5 PRIVATE
+        ../../common
+        ../../include
+        ../src)
+target_include_directories(pm3rrg_rdv4_hitag2crack5 INTERFACE hitag2crack5)
+set_property(TARGET        pm3rrg_rdv4_hitag2crack5 PROPERTY  POSITION_INDEPENDENT_CODE ON)
@@ -0,0 +1,45 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Hitag2 key recovery from two nR/aR pairs, library version of
+// tools/hitag2crack/crack5 (bitsliced HiTag2 Hell CPU implementation)
+//-----------------------------------------------------------------------------
+
+#ifndef HT2CRACK5_H__
+#define HT2CRACK5_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+enum {
+    HT2CRACK5_FOUND = 0,
+    HT2CRACK5_NOT_FOUND,
+    HT2CRACK5_ABORTED,
+    HT2CRACK5_EMALLOC,
+};
+
+// Called about once per second from the calling thread while the workers run.
+// done / total count the layer 0 candidates processed so far.
+// Return false to abort the search.
+typedef bool (*ht2crack5_progress_t)(void *ctx, uint64_t done, uint64_t total);
+
+// uid, nr1 and nr2 as used by ht2_hitag2_init_ex() (bit reversed per byte, LE),
+// ar1 and ar2 as sniffed (BE).  On success key holds the shared key in the same
+// convention as ht2_hitag2_init_ex() expects.
+// threads == 0 uses one thread per logical CPU.
+int ht2crack5_find_key(uint32_t uid, uint32_t nr1, uint32_t ar1, uint32_t nr2, uint32_t ar2,
+                       uint32_t threads, ht2crack5_progress_t progress, void *ctx, uint64_t *key);
+
+#endif
@@ -198,6 +198,33 @@ bool id48lib_key_recovery_next(
     ID48LIB_KEY *potential_key_output
 );
 
+/// <summary>
+/// Finds all potential keys whose K₄₇..K₄₀ lie in the
+/// given range, in the same order as repeated calls to
+/// id48lib_key_recovery_next() would return them.
+/// Does not use the state of init() / next(), so calls
+/// for disjoint ranges can safely run concurrently.
+/// </summary>
+/// <param name="first_k47_to_k40">First value of K₄₇..K₄₀ to search</param>
+/// <param name="last_k47_to_k40">Last value of K₄₇..K₄₀ to search (inclusive)</param>
+/// <param name="potential_keys_output">
+/// Caller-provided array, filled with up to max_potential_keys keys.
+/// </param>
+/// <returns>
+/// The number of potential keys found, which may be
+/// larger than max_potential_keys.
+/// </returns>
+size_t id48lib_key_recovery_range(
+    const ID48LIB_KEY *input_partial_key,
+    const ID48LIB_NONCE *input_nonce,
+    const ID48LIB_FRN *input_frn,
+    const ID48LIB_GRN *input_grn,
+    uint8_t first_k47_to_k40,
+    uint8_t last_k47_to_k40,
+    ID48LIB_KEY *potential_keys_output,
+    size_t max_potential_keys
+);
+
 #if defined(__cplusplus)
 }
 #endif
@@ -11,6 +11,7 @@ target_compile_definitions(pm3rrg_rdv4_reveng PRIVATE PRESETS)
 target_include_directories(pm3rrg_rdv4_reveng PRIVATE
         cliparser
         ../src
+        ../../common
         ../../include)
 target_include_directories(pm3rrg_rdv4_reveng INTERFACE reveng)
 target_compile_options(pm3rrg_rdv4_reveng PRIVATE -Wall -O3)
@@ -102,7 +102,7 @@ int reveng_main(int argc, char *argv[]) {
     // Remember to consume always all the option string till getopt returns -1 !
     // else next invocations will be corrupted
     do {
-        c = getopt(argc, argv, "?A:BDFGLMP:SVXa:bcdefhi:k:lm:p:q:rstuvw:x:yz");
+        c = getopt(argc, argv, "?1A:BDFGLMP:SVXa:bcdefhi:k:lm:p:q:rstuvw:x:yz");
         switch (c) {
             case 'A': /* A: bits per output character */
             case 'a': /* a: bits per character */
@@ -138,6 +138,9 @@ int reveng_main(int argc, char *argv[]) {
                 }
                 mode = c;
                 break;
+            case '1': /* 1  stop searching at the first model found */
+                rflags |= R_FIRST;
+                break;
             case 'F': /* F  skip preset model check pass */
 #ifndef ALWPCK
                 uflags |= C_NOPCK;
@@ -612,7 +615,7 @@ usage(void) {
             "Usage:\t");
     fputs(myname, stderr);
     fprintf(stderr,
-            "\t-cdDesvhu? [-bBfFGlLMrStVXyz]\n"
+            "\t-cdDesvhu? [-1bBfFGlLMrStVXyz]\n"
             "\t\t[-a BITS] [-A OBITS] [-i INIT] [-k KPOLY] [-m MODEL] [-p POLY]\n"
             "\t\t[-p POLY] [-P RPOLY] [-q QPOLY] [-w WIDTH] [-x XOROUT] [STRING...]\n"
             "Options:\n"
@@ -636,7 +639,7 @@ usage(void) {
             "\t-r right-justified output\t-S print spaces between characters\n"
             "\t-t left-justified output\t-V reverse algorithm only\n"
             "\t-X print uppercase hexadecimal\t-y low bytes first in files\n"
-            "\t-z raw binary STRINGs\n");
+            "\t-z raw binary STRINGs\t\t-1 stop search at first model found\n");
     fprintf(stderr,
             "Mode switches:\n"
             "\t-c calculate CRCs\t\t-d dump algorithm parameters\n"
@@ -22,7 +22,8 @@
  * along with CRC RevEng.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-/* 2013-09-16: calini(), calout() work on shortest argument
+/* 2026-10-14: polynomial search split over worker threads, -1 early exit
+ * 2013-09-16: calini(), calout() work on shortest argument
  * 2013-06-11: added sequence number to uprog() calls
  * 2013-02-08: added polynomial range search
  * 2013-01-18: refactored model checking to pshres(); renamed chkres()
@@ -49,6 +50,11 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "util.h"         // num_CPUs, kbd_enter_pressed
+#include "util_posix.h"   // msleep
 
 #define FILE void
 #include "reveng.h"
@@ -61,13 +67,198 @@ static void chkres(int *resc, model_t **result, const poly_t divisor, const poly
 
 static const poly_t pzero = PZERO;
 
+/* Polynomial search workers.
+ * Candidate polys are dealt round robin, worker n tests every
+ * nth poly of the range. Each keeps its own results, merged in
+ * poly order afterwards so the output matches a serial search.
+ */
+#define R_MAXTHREADS 64
+
+typedef struct {
+    const model_t *guess;
+    const poly_t *qpoly;
+    int rflags;
+    int args;
+    const poly_t *argpolys;
+    const poly_t *pworks;
+    unsigned long id;
+    unsigned long nthreads;
+    int resc;
+    model_t *result;
+} rworker_t;
+
+static pthread_mutex_t rlock = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool rstop = false;
+static int rdone = 0;
+
+static void
+rtest(rworker_t *w, const poly_t gpoly) {
+    /* Try dividing all the differences by gpoly, if it divides
+     * them all it is a candidate. Search for an Init value for this
+     * poly or if Init is known, log the result.
+     */
+    const poly_t *wptr;
+    poly_t rem;
+    int rflags = w->rflags;
+    const model_t *guess = w->guess;
+
+    for (wptr = w->pworks; plen(*wptr); ++wptr) {
+        /* straight divide message by poly, don't multiply by x^n */
+        rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
+        if (ptst(rem)) {
+            pfree(&rem);
+            return;
+        } else
+            pfree(&rem);
+    }
+
+    /* gpoly is a candidate poly */
+    if (rflags & R_HAVEI && rflags & R_HAVEX)
+        chkres(&w->resc, &w->result, gpoly, guess->init, guess->flags, guess->xorout, w->args, w->argpolys);
+    else if (rflags & R_HAVEI)
+        calout(&w->resc, &w->result, gpoly, guess->init, guess->flags, w->args, w->argpolys);
+    else if (rflags & R_HAVEX)
+        calini(&w->resc, &w->result, gpoly, guess->flags, guess->xorout, w->args, w->argpolys);
+    else
+        engini(&w->resc, &w->result, gpoly, guess->flags, w->args, w->argpolys);
+
+    if (w->resc && rflags & R_FIRST)
+        rstop = true;
+}
+
+static void *
+rworker(void *arg) {
+    rworker_t *w = (rworker_t *)arg;
+    unsigned long spin = 0;
+
+    /* Initialise the guessed poly to the starting value. */
+    poly_t gpoly = pclone(w->guess->spoly);
+    /* Clear the least significant term, to be set in the
+     * loop. qpoly does not need fixing as it is only
+     * compared with odd polys.
+     */
+    if (plen(gpoly))
+        pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
+
+    while (!rstop && piter(&gpoly) && (~w->rflags & R_HAVEQ || pcmp(&gpoly, w->qpoly) < 0)) {
+        /* For each possible poly of this size handled by this
+         * worker, try dividing all the differences in the list.
+         */
+        if (spin % w->nthreads == w->id) {
+            if (!(spin & R_SPMASK)) {
+                pthread_mutex_lock(&rlock);
+                uprog(gpoly, w->guess->flags, spin / (R_SPMASK + 1UL));
+                pthread_mutex_unlock(&rlock);
+            }
+            rtest(w, gpoly);
+        }
+        spin++;
+        if (!piter(&gpoly))
+            break;
+    }
+    pfree(&gpoly);
+
+    pthread_mutex_lock(&rlock);
+    rdone++;
+    pthread_mutex_unlock(&rlock);
+    return NULL;
+}
+
+static void
+rsearch(int *resc, model_t **result, const model_t *guess, const poly_t *qpoly, int rflags, int args, const poly_t *argpolys, const poly_t *pworks) {
+    /* Run the poly search on all cores and merge the results. */
+    rworker_t workers[R_MAXTHREADS];
+    pthread_t threads[R_MAXTHREADS];
+    bool started[R_MAXTHREADS];
+    unsigned long i, n = num_CPUs();
+    int running = 0;
+
+    if (n < 1)
+        n = 1;
+    if (n > R_MAXTHREADS)
+        n = R_MAXTHREADS;
+
+    rstop = false;
+    rdone = 0;
+    for (i = 0; i < n; ++i) {
+        workers[i].guess = guess;
+        workers[i].qpoly = qpoly;
+        workers[i].rflags = rflags;
+        workers[i].args = args;
+        workers[i].argpolys = argpolys;
+        workers[i].pworks = pworks;
+        workers[i].id = i;
+        workers[i].nthreads = n;
+        workers[i].resc = 0;
+        workers[i].result = NULL;
+        started[i] = (n > 1 && pthread_create(&threads[i], NULL, rworker, &workers[i]) == 0);
+        if (started[i])
+            running++;
+    }
+
+    /* wait, the user may cut a long search short */
+    while (running) {
+        pthread_mutex_lock(&rlock);
+        bool done = (rdone >= running);
+        pthread_mutex_unlock(&rlock);
+        if (done)
+            break;
+        if (kbd_enter_pressed())
+            rstop = true;
+        msleep(50);
+    }
+
+    /* shares whose thread could not be started run here */
+    for (i = 0; i < n; ++i) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            rworker(&workers[i]);
+    }
+
+    /* merge, every worker's results are already in ascending poly order */
+    for (;;) {
+        rworker_t *next = NULL;
+        for (i = 0; i < n; ++i) {
+            rworker_t *w = &workers[i];
+            if (w->resc && (!next || pcmp(&w->result->spoly, &next->result->spoly) < 0))
+                next = w;
+        }
+        if (!next)
+            break;
+
+        /* move all models of this poly over */
+        poly_t spoly = next->result->spoly;
+        int cnt = 0;
+        while (cnt < next->resc && !pcmp(&next->result[cnt].spoly, &spoly))
+            cnt++;
+
+        model_t *grown = realloc(*result, (*resc + cnt) * sizeof(model_t));
+        if (!grown) {
+            uerror("cannot reallocate result array");
+            break;
+        }
+        *result = grown;
+        memcpy(*result + *resc, next->result, cnt * sizeof(model_t));
+        *resc += cnt;
+        next->resc -= cnt;
+        memmove(next->result, next->result + cnt, next->resc * sizeof(model_t));
+    }
+
+    for (i = 0; i < n; ++i) {
+        while (workers[i].resc)
+            mfree(&workers[i].result[--workers[i].resc]);
+        free(workers[i].result);
+    }
+    rstop = false;
+}
+
 model_t *
 reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const poly_t *argpolys) {
     /* Complete the parameters of a model by calculation or brute search. */
-    poly_t *pworks, *wptr, rem, gpoly;
+    poly_t *pworks, *wptr;
     model_t *result = NULL, *rptr;
     int resc = 0;
-    unsigned long spin = 0, seq = 0;
 
     if (~rflags & R_HAVEP) {
         /* The poly is not known.
@@ -78,52 +269,10 @@ reveng(const model_t *guess, const poly_t qpoly, int rflags, int args, const pol
             free(pworks);
             goto requit;
         }
-        /* Initialise the guessed poly to the starting value. */
-        gpoly = pclone(guess->spoly);
-        /* Clear the least significant term, to be set in the
-         * loop. qpoly does not need fixing as it is only
-         * compared with odd polys.
-         */
-        if (plen(gpoly))
-            pshift(&gpoly, gpoly, 0UL, 0UL, plen(gpoly) - 1UL, 1UL);
-
-        while (piter(&gpoly) && (~rflags & R_HAVEQ || pcmp(&gpoly, &qpoly) < 0)) {
-            /* For each possible poly of this size, try
-             * dividing all the differences in the list.
-             */
-            if (!(spin++ & R_SPMASK)) {
-                uprog(gpoly, guess->flags, seq++);
-            }
-            for (wptr = pworks; plen(*wptr); ++wptr) {
-                /* straight divide message by poly, don't multiply by x^n */
-                rem = pcrc(*wptr, gpoly, pzero, pzero, 0);
-                if (ptst(rem)) {
-                    pfree(&rem);
-                    break;
-                } else
-                    pfree(&rem);
-            }
-            /* If gpoly divides all the differences, it is a
-             * candidate.  Search for an Init value for this
-             * poly or if Init is known, log the result.
-             */
-            if (!plen(*wptr)) {
-                /* gpoly is a candidate poly */
-                if (rflags & R_HAVEI && rflags & R_HAVEX)
-                    chkres(&resc, &result, gpoly, guess->init, guess->flags, guess->xorout, args, argpolys);
-                else if (rflags & R_HAVEI)
-                    calout(&resc, &result, gpoly, guess->init, guess->flags, args, argpolys);
-                else if (rflags & R_HAVEX)
-                    calini(&resc, &result, gpoly, guess->flags, guess->xorout, args, argpolys);
-                else
-                    engini(&resc, &result, gpoly, guess->flags, args, argpolys);
-            }
-            if (!piter(&gpoly))
-                break;
-        }
-        /* Finished with gpoly and the differences list, free them.
+        rsearch(&resc, &result, guess, &qpoly, rflags, args, argpolys, pworks);
+
+        /* Finished with the differences list, free it.
          */
-        pfree(&gpoly);
         for (wptr = pworks; plen(*wptr); ++wptr)
             pfree(wptr);
         free(pworks);
@@ -498,6 +647,8 @@ chkres(int *resc, model_t **result, const poly_t divisor, const poly_t init, int
     /* compute check value for this model */
     mcheck(rptr);
 
-    /* callback to notify new model */
+    /* callback to notify new model, may be called from search workers */
+    pthread_mutex_lock(&rlock);
     ufound(rptr);
+    pthread_mutex_unlock(&rlock);
 }
@@ -215,6 +215,7 @@ void mmatch(model_t *model, int flags);
 #define R_HAVERO     8
 #define R_HAVEX     16
 #define R_HAVEQ     32
+#define R_FIRST     64
 
 #define R_SPMASK 0x7FFFFFFUL
 
@@ -16,10 +16,40 @@
 #ifndef LIBPM3_H
 #define LIBPM3_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 typedef struct pm3_device pm3;
 
+// Several devices can be open at once, commands go to the one given and
+// the others stay connected in the background
 pm3 *pm3_open(const char *port);
 int pm3_console(pm3 *dev, const char *cmd);
+// Runs a command without console output and returns its results as a JSON object
+// (malloc'd, caller frees). Always holds "cmd" and "status", commands supporting it
+// add their own fields, e.g. "hf 14a reader", "lf search", "hf mf dump"
+char *pm3_console_json(pm3 *dev, const char *cmd);
+// Asynchronous console: the command is queued and run on a worker thread, one at a time,
+// pm3_console_async returns at once. Completions are reported by pm3_async_poll, which
+// calls the callbacks on the caller's thread. pm3_async_fd is readable while completions
+// are pending, for select/poll based event loops (-1 where not supported)
+typedef void (*pm3_done_cb)(pm3 *dev, const char *cmd, int status, void *ctx);
+int pm3_console_async(pm3 *dev, const char *cmd, pm3_done_cb cb, void *ctx);
+int pm3_async_fd(void);
+int pm3_async_poll(void);
+// Binary batch of raw commands, bypassing the CLI parser and output formatting.
+// req:  records of  cmd:u16 reply_cmd:u16 flags:u8 len:u16 data[len]
+// resp: records of  cmd:u16 status:i16 ng:u8 oldarg:u64[3] len:u16 data[len]
+// all little endian, packed. Returns number of replies, or negative PM3_E* error
+int pm3_batch(pm3 *dev, const uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_max, size_t *resp_len, uint32_t ms_timeout);
+// Bulk memory access, straight into the caller's buffer without going through the console.
+// Return PM3_SUCCESS or a negative PM3_E* error
+int pm3_bigbuf_get(pm3 *dev, uint8_t *dest, size_t len, size_t offset);
+int pm3_emulator_get(pm3 *dev, uint8_t *dest, size_t len, size_t offset);
+// trace is copied up to max bytes, *len gets the full trace length on the device
+int pm3_trace_get(pm3 *dev, uint8_t *dest, size_t max, size_t *len);
+// client side graph buffer, valid until the next command changes it
+const int32_t *pm3_graph_get(pm3 *dev, size_t *len);
 const char *pm3_name_get(pm3 *dev);
 void pm3_close(pm3 *dev);
 pm3 *pm3_get_current_dev(void);
@@ -73,6 +73,18 @@ class pm3(object):
         return _pm3.pm3_console(self, cmd)
     name = property(_pm3.pm3_name_get)
 
+    def bigbuf(self, length, offset=0, out=None):
+        return _pm3.pm3_bigbuf(self, length, offset, out)
+
+    def emulator(self, length, offset=0, out=None):
+        return _pm3.pm3_emulator(self, length, offset, out)
+
+    def trace(self, out=None):
+        return _pm3.pm3_trace(self, out)
+
+    def graph(self, out=None):
+        return _pm3.pm3_graph(self, out)
+
 # Register pm3 in _pm3:
 _pm3.pm3_swigregister(pm3)
 
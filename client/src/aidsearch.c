@@ -21,7 +21,18 @@
 #include "fileutils.h"
 #include "pm3_cmd.h"
 
+// aidlist.json is parsed on first use and kept for the session,
+// with an AID string -> element index for the description lookups
+static json_t *aid_known_list = NULL;
+static json_t *aid_known_index = NULL;
+
 static int openAIDFile(json_t **root, bool verbose) {
+
+    if (aid_known_list) {
+        *root = aid_known_list;
+        return PM3_SUCCESS;
+    }
+
     json_error_t error;
 
     char *path;
@@ -48,16 +59,18 @@ static int openAIDFile(json_t **root, bool verbose) {
                   , path
                   , json_array_size(*root)
                  );
+
+    aid_known_list = *root;
+    aid_known_index = JsonIndexArray(aid_known_list, "AID", false);
 out:
+    if (retval != PM3_SUCCESS) {
+        json_decref(*root);
+        *root = NULL;
+    }
     free(path);
     return retval;
 }
 
-static int closeAIDFile(json_t *root) {
-    json_decref(root);
-    return PM3_SUCCESS;
-}
-
 json_t *AIDSearchInit(bool verbose) {
     json_t *root = NULL;
     int res = openAIDFile(&root, verbose);
@@ -77,7 +90,8 @@ json_t *AIDSearchGetElm(json_t *root, size_t elmindx) {
 }
 
 int AIDSearchFree(json_t *root) {
-    return closeAIDFile(root);
+    // the list stays loaded for the session
+    return PM3_SUCCESS;
 }
 
 static const char *jsonStrGet(json_t *data, const char *name) {
@@ -97,17 +111,6 @@ static const char *jsonStrGet(json_t *data, const char *name) {
     return cstr;
 }
 
-static bool aidCompare(const char *aidlarge, const char *aidsmall) {
-    if (strcmp(aidlarge, aidsmall) == 0)
-        return true;
-
-    if (strlen(aidlarge) > strlen(aidsmall))
-        if (strncmp(aidlarge, aidsmall, strlen(aidsmall)) == 0)
-            return true;
-
-    return false;
-}
-
 bool AIDGetFromElm(json_t *data, uint8_t *aid, size_t aidmaxlen, int *aidlen) {
     *aidlen = 0;
     const char *hexaid = jsonStrGet(data, "AID");
@@ -121,6 +124,16 @@ bool AIDGetFromElm(json_t *data, uint8_t *aid, size_t aidmaxlen, int *aidlen) {
     return true;
 }
 
+// false for the later copies of an AID listed more than once,  the index keeps the first
+bool AIDIsFirstEntry(json_t *data) {
+    const char *hexaid = jsonStrGet(data, "AID");
+    if (hexaid == NULL || aid_known_index == NULL)
+        return true;
+
+    json_t *first = json_object_get(aid_known_index, hexaid);
+    return (first == NULL || first == data);
+}
+
 int PrintAIDDescription(json_t *xroot, char *aid, bool verbose) {
     int retval = PM3_SUCCESS;
 
@@ -130,20 +143,17 @@ int PrintAIDDescription(json_t *xroot, char *aid, bool verbose) {
     if (root == NULL)
         goto out;
 
+    // longest dictionary AID the requested aid starts with
     json_t *elm = NULL;
-    size_t maxaidlen = 0;
-    for (size_t elmindx = 0; elmindx < json_array_size(root); elmindx++) {
-        json_t *data = AIDSearchGetElm(root, elmindx);
-        if (data == NULL)
-            continue;
-        const char *dictaid = jsonStrGet(data, "AID");
-        if (aidCompare(aid, dictaid)) {  // dictaid may be less length than requested aid
-            if (maxaidlen < strlen(dictaid) && strlen(dictaid) <= strlen(aid)) {
-                maxaidlen = strlen(dictaid);
-                elm = data;
-            }
-        }
+    char *prefix = strdup(aid);
+    if (prefix == NULL)
+        goto out;
+
+    for (size_t len = strlen(prefix); elm == NULL && len > 0; len--) {
+        prefix[len] = 0;
+        elm = json_object_get(aid_known_index, prefix);
     }
+    free(prefix);
 
     if (elm == NULL)
         goto out;
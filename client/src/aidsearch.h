@@ -30,6 +30,7 @@ int PrintAIDDescriptionBuf(json_t *root, uint8_t *aid, size_t aidlen, bool verbo
 json_t *AIDSearchInit(bool verbose);
 json_t *AIDSearchGetElm(json_t *root, size_t elmindx);
 bool AIDGetFromElm(json_t *data, uint8_t *aid, size_t aidmaxlen, int *aidlen);
+bool AIDIsFirstEntry(json_t *data);
 int AIDSearchFree(json_t *root);
 
 #endif
@@ -0,0 +1,342 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Host side benchmarks of the crypto and cracking cores
+//-----------------------------------------------------------------------------
+#include "bench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui.h"
+#include "util.h"                  // num_CPUs
+#include "util_posix.h"            // msclock
+#include "commonutil.h"            // ARRAYLEN
+#include "crapto1/crapto1.h"
+#include "hardnested_bf_core.h"    // SetSIMDInstr
+#include "hardnested_bruteforce.h" // brute_force_benchmark
+#include "loclass/cipher.h"        // doMAC
+#include "loclass/elite_crack.h"   // hash1, hash2
+#include "loclass/ikeys.h"         // diversifyKey
+#include "cmdhficlass.h"           // HFiClassCalcDivKey
+#include "hitag2/hitag2_crypto.h"
+#include "id48.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/des.h"
+#include "crypto/libpcrypto.h"     // aes_cmac
+
+// keeps the compiler from dropping the work
+static volatile uint64_t g_bench_sink;
+
+typedef struct {
+    const char *name;
+    const char *unit;
+    void (*fn)(uint64_t n);
+} bench_t;
+
+static void bench_crypto1_word(uint64_t n) {
+    struct Crypto1State s;
+    crypto1_init(&s, 0xA0A1A2A3A4A5);
+    uint32_t ks = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        ks ^= crypto1_word(&s, 0, 0);
+    }
+    g_bench_sink += ks;
+}
+
+static void bench_lfsr_recovery32(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        struct Crypto1State *s = lfsr_recovery32(0x5A920D85 + i, 0);
+        if (s == NULL) {
+            return;
+        }
+        g_bench_sink += s->odd;
+        free(s);
+    }
+}
+
+static void bench_lfsr_recovery32_mt(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        struct Crypto1State *s = lfsr_recovery32_mt(0x5A920D85 + i, 0, num_CPUs());
+        if (s == NULL) {
+            return;
+        }
+        g_bench_sink += s->odd;
+        free(s);
+    }
+}
+
+static void bench_lfsr_recovery64(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        struct Crypto1State *s = lfsr_recovery64(0x5A920D85 + i, 0x1011B8E2);
+        if (s == NULL) {
+            return;
+        }
+        g_bench_sink += s->odd;
+        free(s);
+    }
+}
+
+static void bench_iclass_elite_key(uint64_t n) {
+    uint8_t csn[8] = {0x01, 0x0A, 0x0F, 0xFF, 0xF7, 0xFF, 0x12, 0xE0};
+    uint8_t key[8] = {0xAE, 0xA6, 0x84, 0xA6, 0xDA, 0xB2, 0x32, 0x78};
+    uint8_t div_key[8];
+    for (uint64_t i = 0; i < n; i++) {
+        key[0] = i;
+        HFiClassCalcDivKey(csn, key, div_key, true);
+        g_bench_sink += div_key[0];
+    }
+}
+
+static void bench_iclass_hash1(uint64_t n) {
+    uint8_t csn[8] = {0x01, 0x0A, 0x0F, 0xFF, 0xF7, 0xFF, 0x12, 0xE0};
+    uint8_t k[8];
+    for (uint64_t i = 0; i < n; i++) {
+        csn[0] = i;
+        hash1(csn, k);
+        g_bench_sink += k[0];
+    }
+}
+
+static void bench_iclass_diversify(uint64_t n) {
+    uint8_t csn[8] = {0x01, 0x0A, 0x0F, 0xFF, 0xF7, 0xFF, 0x12, 0xE0};
+    uint8_t key[8] = {0xAE, 0xA6, 0x84, 0xA6, 0xDA, 0xB2, 0x32, 0x78};
+    uint8_t div_key[8];
+    for (uint64_t i = 0; i < n; i++) {
+        csn[0] = i;
+        diversifyKey(csn, key, div_key);
+        g_bench_sink += div_key[0];
+    }
+}
+
+static void bench_iclass_mac(uint64_t n) {
+    uint8_t cc_nr[12] = {0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_key[8] = {0xE0, 0x33, 0xCA, 0x41, 0x9A, 0xEE, 0x43, 0xF9};
+    uint8_t mac[4];
+    for (uint64_t i = 0; i < n; i++) {
+        cc_nr[8] = i;
+        doMAC(cc_nr, div_key, mac);
+        g_bench_sink += mac[0];
+    }
+}
+
+static void bench_iclass_mac_fast(uint64_t n) {
+    uint8_t cc_nr[12] = {0xFE, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00};
+    uint8_t div_key[8] = {0xE0, 0x33, 0xCA, 0x41, 0x9A, 0xEE, 0x43, 0xF9};
+    uint8_t mac[4];
+    for (uint64_t i = 0; i < n; i++) {
+        cc_nr[8] = i;
+        doMAC_fast(cc_nr, div_key, mac);
+        g_bench_sink += mac[0];
+    }
+}
+
+static void bench_hitag2_auth(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t state = ht2_hitag2_init(0x4F4E4D494B52, 0x2AB12BF2, i);
+        g_bench_sink += ht2_hitag2_word(&state, 32);
+    }
+}
+
+static void bench_id48_generator(uint64_t n) {
+    ID48LIB_KEY key = {{0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF, 0x01, 0x23, 0x45, 0x67}};
+    ID48LIB_NONCE nonce = {{0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE}};
+    ID48LIB_FRN frn;
+    ID48LIB_GRN grn;
+    for (uint64_t i = 0; i < n; i++) {
+        nonce.rn[0] = i;
+        id48lib_generator(&key, &nonce, &frn, &grn);
+        g_bench_sink += grn.grn[0];
+    }
+}
+
+// the DESFire benches run over 1 kB,  one op is one 16 / 8 byte block
+#define BENCH_CRYPT_LEN 1024
+
+static void bench_aes_cbc(uint64_t n) {
+    uint8_t key[16] = {0};
+    uint8_t iv[16] = {0};
+    uint8_t buf[BENCH_CRYPT_LEN] = {0};
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    mbedtls_aes_setkey_enc(&ctx, key, 128);
+    for (uint64_t i = 0; i < n; i += BENCH_CRYPT_LEN / 16) {
+        mbedtls_aes_crypt_cbc(&ctx, MBEDTLS_AES_ENCRYPT, sizeof(buf), iv, buf, buf);
+    }
+    mbedtls_aes_free(&ctx);
+    g_bench_sink += buf[0];
+}
+
+static void bench_3tdea_cbc(uint64_t n) {
+    uint8_t key[24] = {0};
+    uint8_t iv[8] = {0};
+    uint8_t buf[BENCH_CRYPT_LEN] = {0};
+    mbedtls_des3_context ctx;
+    mbedtls_des3_init(&ctx);
+    mbedtls_des3_set3key_enc(&ctx, key);
+    for (uint64_t i = 0; i < n; i += BENCH_CRYPT_LEN / 8) {
+        mbedtls_des3_crypt_cbc(&ctx, MBEDTLS_DES_ENCRYPT, sizeof(buf), iv, buf, buf);
+    }
+    mbedtls_des3_free(&ctx);
+    g_bench_sink += buf[0];
+}
+
+static void bench_aes_cmac(uint64_t n) {
+    uint8_t key[16] = {0};
+    uint8_t buf[32] = {0};
+    uint8_t mac[16];
+    for (uint64_t i = 0; i < n; i++) {
+        buf[0] = i;
+        aes_cmac(NULL, key, buf, mac, sizeof(buf));
+        g_bench_sink += mac[0];
+    }
+}
+
+static const bench_t bench_list[] = {
+    {"crapto1 crypto1_word",        "words",   bench_crypto1_word},
+    {"crapto1 lfsr_recovery32",     "recov",   bench_lfsr_recovery32},
+    {"crapto1 lfsr_recovery32_mt",  "recov",   bench_lfsr_recovery32_mt},
+    {"crapto1 lfsr_recovery64",     "recov",   bench_lfsr_recovery64},
+    {"loclass elite key",           "keys",    bench_iclass_elite_key},
+    {"loclass hash1",               "csns",    bench_iclass_hash1},
+    {"iclass diversify (DES)",      "keys",    bench_iclass_diversify},
+    {"iclass MAC",                  "macs",    bench_iclass_mac},
+    {"iclass MAC fast",             "macs",    bench_iclass_mac_fast},
+    {"hitag2 init + 32 bits",       "auths",   bench_hitag2_auth},
+    {"em4x70 id48 generator",       "auths",   bench_id48_generator},
+    {"desfire AES-128 CBC",         "blocks",  bench_aes_cbc},
+    {"desfire 3TDEA CBC",           "blocks",  bench_3tdea_cbc},
+    {"desfire AES CMAC 32 bytes",   "macs",    bench_aes_cmac},
+};
+
+// run fn with more and more work until one run takes about `ms`,  returns ops per second
+static double bench_rate(void (*fn)(uint64_t), uint32_t ms) {
+    uint64_t n = 1;
+    uint64_t t = 0;
+
+    // find a size that takes a measurable time
+    for (;;) {
+        uint64_t t0 = msclock();
+        fn(n);
+        t = msclock() - t0;
+        if (t >= 20) {
+            break;
+        }
+        n *= 4;
+    }
+
+    if (t < ms) {
+        n = (n * ms) / t;
+        uint64_t t0 = msclock();
+        fn(n);
+        t = msclock() - t0;
+    }
+    return (n * 1000.0) / (t ? t : 1);
+}
+
+static const char *bench_simd_name(SIMDExecInstr instr) {
+    switch (instr) {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+        case SIMD_AVX512:
+            return "AVX512F";
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+        case SIMD_AVX2:
+            return "AVX2";
+        case SIMD_AVX:
+            return "AVX";
+        case SIMD_SSE2:
+            return "SSE2";
+        case SIMD_MMX:
+            return "MMX";
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+        case SIMD_NEON:
+            return "NEON";
+#endif
+        case SIMD_AUTO:
+        case SIMD_NONE:
+        default:
+            return "no SIMD";
+    }
+}
+
+static void bench_print(const char *name, const char *unit, double rate) {
+    const char *prefix = "";
+    if (rate >= 1e9) {
+        rate /= 1e9;
+        prefix = "G";
+    } else if (rate >= 1e6) {
+        rate /= 1e6;
+        prefix = "M";
+    } else if (rate >= 1e3) {
+        rate /= 1e3;
+        prefix = "k";
+    }
+    PrintAndLogEx(SUCCESS, " %-30s | " _YELLOW_("%8.2f") " %s%s/s", name, rate, prefix, unit);
+}
+
+static bool bench_selected(const char *name, const char *filter) {
+    return (filter == NULL || filter[0] == '\0' || strstr(name, filter) != NULL);
+}
+
+int bench_run(uint32_t ms, const char *filter) {
+
+    SIMDExecInstr best = GetSIMDInstrAuto();
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Host benchmarks") " -----------------------------");
+    PrintAndLogEx(INFO, " CPU threads... " _YELLOW_("%d"), num_CPUs());
+    PrintAndLogEx(INFO, " SIMD.......... " _YELLOW_("%s"), bench_simd_name(best));
+    PrintAndLogEx(INFO, " run time...... " _YELLOW_("%u") " ms per bench", ms);
+    PrintAndLogEx(INFO, "--------------------------------+--------------------");
+
+    for (size_t i = 0; i < ARRAYLEN(bench_list); i++) {
+        if (bench_selected(bench_list[i].name, filter) == false) {
+            continue;
+        }
+        bench_print(bench_list[i].name, bench_list[i].unit, bench_rate(bench_list[i].fn, ms));
+    }
+
+    // hardnested brute force core,  once per SIMD level this CPU can run.
+    // The enum goes from the widest to none,  everything after the detected one works too
+    if (bench_selected("hardnested", filter)) {
+        const SIMDExecInstr levels[] = {
+#if defined(COMPILER_HAS_SIMD_AVX512)
+            SIMD_AVX512,
+#endif
+#if defined(COMPILER_HAS_SIMD_X86)
+            SIMD_AVX2, SIMD_AVX, SIMD_SSE2, SIMD_MMX,
+#endif
+#if defined(COMPILER_HAS_SIMD_NEON)
+            SIMD_NEON,
+#endif
+            SIMD_NONE,
+        };
+
+        for (size_t i = 0; i < ARRAYLEN(levels); i++) {
+            if (levels[i] < best) {
+                continue;
+            }
+            SetSIMDInstr(levels[i]);
+            char name[40];
+            snprintf(name, sizeof(name), "hardnested bitsliced %s", bench_simd_name(levels[i]));
+            bench_print(name, "states", brute_force_benchmark());
+        }
+        SetSIMDInstr(SIMD_AUTO);
+    }
+
+    PrintAndLogEx(INFO, "--------------------------------+--------------------");
+    return PM3_SUCCESS;
+}
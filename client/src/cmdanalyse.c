@@ -1036,6 +1036,9 @@ static int CmdAnalyseFoo(const char *Cmd) {
     PrintAndLogEx(INFO, "Got:  %s", data3);
 
     ClearGraph(false);
+    if (GraphReserve(15000) == false) {
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 15000;
 
     for (int i = 0; i < 4095; i++) {
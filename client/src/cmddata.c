@@ -22,7 +22,10 @@
 #include <math.h>                // pow
 #include <ctype.h>               // tolower
 #include <locale.h>              // number formatter..
+#include <pthread.h>
 #include "commonutil.h"          // ARRAYLEN
+#include "util.h"                // num_CPUs
+#include "util_posix.h"          // usclock
 #include "cmdparser.h"           // for command_t
 #include "ui.h"                  // for show graph controls
 #include "proxgui.h"
@@ -843,39 +846,211 @@ static int Cmdaskrawdemod(const char *Cmd) {
     return ASKDemod_ext(clk, invert, max_err, max_len, amplify, true, false, 0, &st);
 }
 
-int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose) {
-    // sanity check
-    if (window > len) {
-        window = len;
+typedef struct {
+    const double *dev;  // samples minus mean
+    double *sums;
+    size_t len;
+    size_t lags;
+    size_t thread_idx;
+    size_t thread_cnt;
+} autocorr_thread_arg_t;
+
+// Every lag is independent, the lags are interleaved over the threads since
+// the work per lag shrinks with the lag
+static void *autocorr_sums_thread(void *thread_arg) {
+    autocorr_thread_arg_t *arg = (autocorr_thread_arg_t *)thread_arg;
+
+    for (size_t i = arg->thread_idx; i < arg->lags; i += arg->thread_cnt) {
+        double sum = 0.0;
+        for (size_t j = 0; j < (arg->len - i); j++) {
+            sum += arg->dev[j] * arg->dev[j + i];
+        }
+        arg->sums[i] = sum;
     }
+    return NULL;
+}
 
-    //test
-    double autocv = 0.0;    // Autocovariance value
-    size_t correlation = 0;
-    int lastmax = 0;
+// In place radix-2 FFT, n a power of two.  inverse skips the 1/n scaling
+static void autocorr_fft(double *re, double *im, size_t n, const double *cs, const double *sn, bool inverse) {
+
+    // bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            double t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+
+    for (size_t half = 1; half < n; half <<= 1) {
+        size_t step = n / (half * 2);
+        for (size_t i = 0; i < n; i += half * 2) {
+            for (size_t k = 0; k < half; k++) {
+                double wr = cs[k * step];
+                double wi = (inverse) ? sn[k * step] : -sn[k * step];
+                size_t a = i + k;
+                size_t b = a + half;
+                double tr = (re[b] * wr) - (im[b] * wi);
+                double ti = (re[b] * wi) + (im[b] * wr);
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// Lag sums via the power spectrum, O(n log n) instead of O(n * lags).
+// Zero padded to len + lags so the circular correlation does not wrap into the wanted lags
+static int autocorr_sums_fft(const double *dev, size_t len, size_t lags, double *sums) {
+
+    size_t n = 1;
+    while (n < len + lags) {
+        n <<= 1;
+    }
+
+    double *re = calloc(n, sizeof(double));
+    double *im = calloc(n, sizeof(double));
+    double *cs = calloc(n / 2, sizeof(double));
+    double *sn = calloc(n / 2, sizeof(double));
+    if (re == NULL || im == NULL || cs == NULL || sn == NULL) {
+        free(re);
+        free(im);
+        free(cs);
+        free(sn);
+        return PM3_EMALLOC;
+    }
+
+    for (size_t i = 0; i < n / 2; i++) {
+        double a = (2.0 * M_PI * i) / n;
+        cs[i] = cos(a);
+        sn[i] = sin(a);
+    }
+
+    memcpy(re, dev, len * sizeof(double));
+
+    autocorr_fft(re, im, n, cs, sn, false);
+    for (size_t i = 0; i < n; i++) {
+        re[i] = (re[i] * re[i]) + (im[i] * im[i]);
+        im[i] = 0.0;
+    }
+    autocorr_fft(re, im, n, cs, sn, true);
+
+    for (size_t i = 0; i < lags; i++) {
+        sums[i] = re[i] / n;
+    }
+
+    free(re);
+    free(im);
+    free(cs);
+    free(sn);
+    return PM3_SUCCESS;
+}
+
+// Autocovariance of the first lags lags into autocv
+// Lag sums straight from their definition, the lags spread over all CPUs
+static void autocorr_sums_direct(const double *dev, size_t len, size_t lags, double *sums, size_t thread_cnt) {
+
+    pthread_t threads[thread_cnt];
+    autocorr_thread_arg_t args[thread_cnt];
+    for (size_t i = 0; i < thread_cnt; i++) {
+        args[i].dev = dev;
+        args[i].sums = sums;
+        args[i].len = len;
+        args[i].lags = lags;
+        args[i].thread_idx = i;
+        args[i].thread_cnt = thread_cnt;
+    }
+
+    size_t started = 0;
+    for (; started < thread_cnt; started++) {
+        if (pthread_create(&threads[started], NULL, autocorr_sums_thread, (void *)&args[started])) {
+            break;
+        }
+    }
+
+    // whatever share a thread could not be started for, is done here
+    for (size_t i = started; i < thread_cnt; i++) {
+        autocorr_sums_thread(&args[i]);
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Autocovariance of the first lags lags into autocv
+static int autocorr_compute(const int *in, size_t len, size_t lags, double *autocv, double *variance) {
 
-    // in, len, 4000
     double mean = compute_mean(in, len);
-    // Computed variance
-    double variance = compute_variance(in, len);
+    *variance = compute_variance(in, len);
 
-    int *correl_buf = calloc(MAX_GRAPH_TRACE_LEN, sizeof(int));
+    double *dev = calloc(len, sizeof(double));
+    double *sums = calloc(lags + 1, sizeof(double));
+    if (dev == NULL || sums == NULL) {
+        free(dev);
+        free(sums);
+        return PM3_EMALLOC;
+    }
 
-    uint8_t peak_cnt = 0;
-    size_t peaks[10] = {0};
+    for (size_t j = 0; j < len; j++) {
+        dev[j] = in[j] - mean;
+    }
 
-    for (size_t i = 0; i < len - window; ++i) {
+    size_t thread_cnt = num_CPUs();
+    if (thread_cnt > lags) {
+        thread_cnt = (lags) ? lags : 1;
+    }
 
-        for (size_t j = 0; j < (len - i); j++) {
-            autocv += (in[j] - mean) * (in[j + i] - mean);
+    // the direct sums only win for a handful of lags
+    double direct_cost = ((double)lags * (len - (lags / 2))) / thread_cnt;
+    double fft_cost = 8.0 * (len + lags) * log2((double)(len + lags) + 1);
+    if (direct_cost > fft_cost) {
+        int res = autocorr_sums_fft(dev, len, lags, sums);
+        if (res != PM3_SUCCESS) {
+            free(dev);
+            free(sums);
+            return res;
         }
-        autocv = (1.0 / (len - i)) * autocv;
+    } else {
+        autocorr_sums_direct(dev, len, lags, sums, thread_cnt);
+    }
+
+    // the running autocovariance carries over from lag to lag
+    double acc = 0.0;
+    for (size_t i = 0; i < lags; i++) {
+        acc = (1.0 / (len - i)) * (acc + sums[i]);
+        autocv[i] = acc;
+    }
+
+    free(dev);
+    free(sums);
+    return PM3_SUCCESS;
+}
 
-        correl_buf[i] = autocv;
+// Shortest distance between the correlation peaks within the first lags lags, or -1
+static int autocorr_distance(const double *autocv, size_t lags, double variance) {
+
+    size_t correlation = 0;
+    int lastmax = 0;
+
+    uint8_t peak_cnt = 0;
+    size_t peaks[10] = {0};
+
+    for (size_t i = 0; i < lags; ++i) {
 
         // Computed autocorrelation value to be returned
         // Autocorrelation is autocovariance divided by variance
-        double ac_value = autocv / variance;
+        double ac_value = autocv[i] / variance;
 
         // keep track of which distance is repeating.
         // A value near 1.0 or more indicates a correlation in the signal
@@ -907,28 +1082,89 @@ int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveG
             distance = peaks[i];
         }
     }
+    return distance;
+}
 
+int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose) {
+    // sanity check
+    if (window > len) {
+        window = len;
+    }
+
+    size_t lags = len - window;
+    double variance = 0.0;
+    double *autocv = calloc(lags + 1, sizeof(double));
+    if (autocv == NULL) {
+        return -1;
+    }
+
+    if (autocorr_compute(in, len, lags, autocv, &variance) != PM3_SUCCESS) {
+        free(autocv);
+        return -1;
+    }
+
+    int distance = autocorr_distance(autocv, lags, variance);
     if (distance > -1) {
         if (verbose) {
             PrintAndLogEx(SUCCESS, "Possible correlation at "_YELLOW_("%4d") " samples", distance);
         }
     } else {
         PrintAndLogEx(HINT, "No repeating pattern found, try increasing window size");
+        free(autocv);
         // return value -1, indication to increase window size
         return -1;
     }
 
     if (SaveGrph) {
         //g_GraphTraceLen = g_GraphTraceLen - window;
-        memcpy(out, correl_buf, len * sizeof(int));
+        memset(out, 0, len * sizeof(int));
+        for (size_t i = 0; i < lags; i++) {
+            out[i] = (int)autocv[i];
+        }
         setClockGrid(distance, 0);
         g_DemodBufferLen = 0;
         RepaintGraphWindow();
     }
-    free(correl_buf);
+    free(autocv);
     return distance;
 }
 
+int AutoCorrelateWindows(const int *in, size_t len, const size_t *windows, int *distances, size_t count) {
+
+    if (count == 0) {
+        return PM3_SUCCESS;
+    }
+
+    // the smallest window covers the most lags, every other window looks at a prefix of it
+    size_t lags = 0;
+    for (size_t w = 0; w < count; w++) {
+        size_t l = (windows[w] > len) ? 0 : len - windows[w];
+        if (l > lags) {
+            lags = l;
+        }
+    }
+
+    double variance = 0.0;
+    double *autocv = calloc(lags + 1, sizeof(double));
+    if (autocv == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    int res = autocorr_compute(in, len, lags, autocv, &variance);
+    if (res != PM3_SUCCESS) {
+        free(autocv);
+        return res;
+    }
+
+    for (size_t w = 0; w < count; w++) {
+        size_t l = (windows[w] > len) ? 0 : len - windows[w];
+        distances[w] = autocorr_distance(autocv, l, variance);
+    }
+
+    free(autocv);
+    return PM3_SUCCESS;
+}
+
 static int CmdAutoCorr(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "data autocorr",
@@ -987,6 +1223,10 @@ static int CmdBitsamples(const char *Cmd) {
         return PM3_ETIMEOUT;
     }
 
+    if (GraphReserve(ARRAYLEN(got) * 8) == false) {
+        return PM3_EMALLOC;
+    }
+
     for (size_t j = 0; j < ARRAYLEN(got); j++) {
         for (uint8_t k = 0; k < 8; k++) {
             if (got[j] & (1 << (7 - k)))
@@ -1089,6 +1329,11 @@ static int CmdUndecimate(const char *Cmd) {
         g_index++;
     }
 
+    if (GraphReserve(s_index) == false) {
+        free(swap);
+        return PM3_EMALLOC;
+    }
+
     memcpy(g_GraphBuffer, swap, s_index * sizeof(int));
     g_GraphTraceLen = s_index;
     RepaintGraphWindow();
@@ -1770,7 +2015,9 @@ static int CmdHexsamples(const char *Cmd) {
         return PM3_ESOFT;
     }
 
+    PrintAndLogBufferStart();
     print_hex_break(got, requested, breaks);
+    PrintAndLogBufferStop();
     return PM3_SUCCESS;
 }
 
@@ -1890,6 +2137,9 @@ int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_conf
 int getSamplesFromBufEx(uint8_t *data, size_t sample_num, uint8_t bits_per_sample, bool verbose) {
 
     size_t max_num = MIN(sample_num, MAX_GRAPH_TRACE_LEN);
+    if (GraphReserve(max_num) == false) {
+        return PM3_EMALLOC;
+    }
 
     if (bits_per_sample < 8) {
 
@@ -2001,6 +2251,9 @@ static int CmdLoad(const char *Cmd) {
     if (is_bin) {
         uint8_t val[2];
         while (fread(val, 1, 1, f)) {
+            if (GraphReserve(g_GraphTraceLen + 1) == false) {
+                break;
+            }
             g_GraphBuffer[g_GraphTraceLen] = val[0] - 127;
             g_GraphTraceLen++;
 
@@ -2010,6 +2263,9 @@ static int CmdLoad(const char *Cmd) {
     } else {
         char line[80];
         while (fgets(line, sizeof(line), f)) {
+            if (GraphReserve(g_GraphTraceLen + 1) == false) {
+                break;
+            }
             g_GraphBuffer[g_GraphTraceLen] = atoi(line);
             g_GraphTraceLen++;
 
@@ -2041,6 +2297,254 @@ static int CmdLoad(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// demodulator benchmark,  every entry gets a fresh copy of the samples and returns a bit count or an error
+typedef int (*bench_demod_fn)(uint8_t *bits, size_t size);
+
+static int bench_ask(uint8_t *bits, size_t size) {
+    int clk = 0, invert = 0, start = 0;
+    int ans = askdemod_ext(bits, &size, &clk, &invert, 100, 0, 0, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_askman(uint8_t *bits, size_t size) {
+    int clk = 0, invert = 0, start = 0;
+    int ans = askdemod_ext(bits, &size, &clk, &invert, 100, 0, 1, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_em410x(uint8_t *bits, size_t size) {
+    int clk = 0, invert = 0, start = 0;
+    if (askdemod_ext(bits, &size, &clk, &invert, 100, 0, 1, &start) < 0) {
+        return -1;
+    }
+    size_t idx = 0;
+    uint32_t hi = 0;
+    uint64_t lo = 0;
+    int ans = Em410xDecode(bits, &size, &idx, &hi, &lo);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_fsk(uint8_t *bits, size_t size) {
+    uint8_t fchigh = 10, fclow = 8;
+    uint16_t fcs = countFC(bits, size, true);
+    if (fcs) {
+        fchigh = (fcs >> 8) & 0xFF;
+        fclow = fcs & 0xFF;
+    }
+    int edge = 0;
+    uint8_t rfLen = detectFSKClk(bits, size, fchigh, fclow, &edge);
+    if (rfLen == 0) {
+        rfLen = 50;
+    }
+    int start = 0;
+    return (int)fskdemod(bits, size, rfLen, 0, fchigh, fclow, &start);
+}
+
+static int bench_psk(uint8_t *bits, size_t size) {
+    int clk = 0, invert = 0, start = 0;
+    int ans = pskRawDemod_ext(bits, &size, &clk, &invert, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_nrz(uint8_t *bits, size_t size) {
+    int clk = 0, invert = 0, start = 0;
+    int ans = nrzRawDemod(bits, &size, &clk, &invert, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_hid(uint8_t *bits, size_t size) {
+    uint32_t hi2 = 0, hi = 0, lo = 0;
+    int start = 0;
+    int ans = HIDdemodFSK(bits, &size, &hi2, &hi, &lo, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_awid(uint8_t *bits, size_t size) {
+    int start = 0;
+    int ans = detectAWID(bits, &size, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static int bench_io(uint8_t *bits, size_t size) {
+    int start = 0;
+    int ans = detectIOProx(bits, &size, &start);
+    return (ans < 0) ? ans : (int)size;
+}
+
+static const struct {
+    const char *name;
+    bench_demod_fn fn;
+} bench_demods[] = {
+    {"ask",    bench_ask},
+    {"askman", bench_askman},
+    {"em410x", bench_em410x},
+    {"fsk",    bench_fsk},
+    {"hid",    bench_hid},
+    {"awid",   bench_awid},
+    {"io",     bench_io},
+    {"psk",    bench_psk},
+    {"nrz",    bench_nrz},
+};
+
+typedef struct {
+    uint64_t samples;
+    uint64_t us;
+} bench_total_t;
+
+static void bench_print(const char *name, uint64_t samples, uint64_t us, uint32_t runs, const char *result) {
+    double msps = (us) ? ((double)samples / (double)us) : 0;
+    PrintAndLogEx(INFO, " %-8s | %10" PRIu64 " | %4u | %10.3f | %9.2f | %s"
+                  , name
+                  , samples / ((runs) ? runs : 1)
+                  , runs
+                  , (double)us / 1000.0
+                  , msps
+                  , result
+                 );
+}
+
+static int bench_graph(const char *demod, uint32_t runs, bench_total_t *totals) {
+
+    size_t size = g_GraphTraceLen;
+    uint8_t *samples = calloc(size, sizeof(uint8_t));
+    uint8_t *bits = calloc(size, sizeof(uint8_t));
+    if (samples == NULL || bits == NULL) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        free(samples);
+        free(bits);
+        return PM3_EMALLOC;
+    }
+
+    size = getFromGraphBuffer(samples);
+    computeSignalProperties(samples, size);
+
+    for (size_t i = 0; i < ARRAYLEN(bench_demods); i++) {
+
+        if (demod && strcmp(demod, bench_demods[i].name)) {
+            continue;
+        }
+
+        int ans = 0;
+        uint64_t us = 0;
+        for (uint32_t r = 0; r < runs; r++) {
+            memcpy(bits, samples, size);
+            uint64_t t1 = usclock();
+            ans = bench_demods[i].fn(bits, size);
+            us += usclock() - t1;
+        }
+
+        char result[30];
+        if (ans > 0) {
+            snprintf(result, sizeof(result), "%d bits", ans);
+        } else {
+            snprintf(result, sizeof(result), _YELLOW_("fail %d"), ans);
+        }
+        bench_print(bench_demods[i].name, (uint64_t)size * runs, us, runs, result);
+
+        totals[i].samples += (uint64_t)size * runs;
+        totals[i].us += us;
+    }
+
+    free(samples);
+    free(bits);
+    return PM3_SUCCESS;
+}
+
+static int CmdBench(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "data bench",
+                  "Times the lfdemod demodulators on the samples in graph buffer, or on the given pm3 files.\n"
+                  "Every run starts from a fresh copy of the samples, the demods never touch graph buffer.\n"
+                  "Speed is in million samples per second, summed up per demod when several files are given.",
+                  "data bench                                    -> graph buffer\n"
+                  "data bench -f lf_EM4102-1.pm3 -f lf_HID-weak-fob-11647.pm3 -n 20\n"
+                  "data bench -d fsk -f lf_AWID-15-259.pm3"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_strx0("f", "file", "<fn>", "pm3 file to load, can be given several times"),
+        arg_u64_0("n", "runs", "<dec>", "runs per demod (def 10)"),
+        arg_str0("d", "demod", "<name>", "only this demod, ask / askman / em410x / fsk / hid / awid / io / psk / nrz"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    struct arg_str *files = arg_get_str(ctx, 1);
+    uint32_t runs = arg_get_u32_def(ctx, 2, 10);
+
+    int dlen = 0;
+    char demod[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 3), (uint8_t *)demod, sizeof(demod) - 1, &dlen);
+
+    if (runs == 0) {
+        runs = 1;
+    }
+
+    if (dlen) {
+        bool found = false;
+        for (size_t i = 0; i < ARRAYLEN(bench_demods); i++) {
+            found |= (strcmp(demod, bench_demods[i].name) == 0);
+        }
+        if (found == false) {
+            PrintAndLogEx(WARNING, "unknown demod '%s'", demod);
+            CLIParserFree(ctx);
+            return PM3_EINVARG;
+        }
+    }
+
+    // g_debugMode would print from inside the timed demods
+    uint8_t dbg = g_debugMode;
+    g_debugMode = 0;
+
+    bench_total_t totals[ARRAYLEN(bench_demods)];
+    memset(totals, 0, sizeof(totals));
+
+    int res = PM3_SUCCESS;
+    int nfiles = files->count;
+    for (int f = 0; f < ((nfiles) ? nfiles : 1); f++) {
+
+        if (nfiles) {
+            char cmd[FILE_PATH_SIZE + 10] = {0};
+            snprintf(cmd, sizeof(cmd), "-f %s", files->sval[f]);
+            res = CmdLoad(cmd);
+            if (res != PM3_SUCCESS) {
+                break;
+            }
+        }
+
+        if (g_GraphTraceLen == 0) {
+            PrintAndLogEx(WARNING, "no samples in graph buffer, load a trace first");
+            res = PM3_ENODATA;
+            break;
+        }
+
+        PrintAndLogEx(INFO, " demod    |    samples | runs |    time ms |   MSa / s | result");
+        PrintAndLogEx(INFO, "----------+------------+------+------------+-----------+-------------");
+        res = bench_graph((dlen) ? demod : NULL, runs, totals);
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+        PrintAndLogEx(NORMAL, "");
+    }
+
+    if (res == PM3_SUCCESS && nfiles > 1) {
+        PrintAndLogEx(INFO, "Total over " _YELLOW_("%d") " files", nfiles);
+        PrintAndLogEx(INFO, " demod    |    samples | runs |    time ms |   MSa / s |");
+        PrintAndLogEx(INFO, "----------+------------+------+------------+-----------+");
+        for (size_t i = 0; i < ARRAYLEN(bench_demods); i++) {
+            if (totals[i].samples) {
+                bench_print(bench_demods[i].name, totals[i].samples, totals[i].us, runs, "");
+            }
+        }
+    }
+
+    CLIParserFree(ctx);
+    g_debugMode = dbg;
+    return res;
+}
+
 // trim graph from the end
 int CmdLtrim(const char *Cmd) {
     CLIParserContext *ctx;
@@ -2789,6 +3293,347 @@ static int CmdAsn1Decoder(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// first offset in [from, to) where a and b differ, or to. Compares a word at a time
+static size_t diff_mismatch(const uint8_t *a, const uint8_t *b, size_t from, size_t to) {
+    size_t i = from;
+    for (; i + sizeof(uint64_t) <= to; i += sizeof(uint64_t)) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, sizeof(wa));
+        memcpy(&wb, b + i, sizeof(wb));
+        if (wa != wb) {
+            break;
+        }
+    }
+    for (; i < to; i++) {
+        if (a[i] != b[i]) {
+            return i;
+        }
+    }
+    return to;
+}
+
+// number of differing bytes in [from, to)
+static size_t diff_count_bytes(const uint8_t *a, const uint8_t *b, size_t from, size_t to) {
+    size_t cnt = 0;
+    size_t i = from;
+    for (; i + sizeof(uint64_t) <= to; i += sizeof(uint64_t)) {
+        uint64_t wa, wb;
+        memcpy(&wa, a + i, sizeof(wa));
+        memcpy(&wb, b + i, sizeof(wb));
+        uint64_t x = wa ^ wb;
+        if (x == 0) {
+            continue;
+        }
+        // fold every byte onto its lowest bit, one bit per differing byte
+        x |= x >> 4;
+        x |= x >> 2;
+        x |= x >> 1;
+        cnt += __builtin_popcountll(x & 0x0101010101010101ULL);
+    }
+    for (; i < to; i++) {
+        cnt += (a[i] != b[i]);
+    }
+    return cnt;
+}
+
+typedef struct {
+    size_t lenA;
+    size_t lenB;
+    size_t bytes;     // differing bytes, a missing byte counts as differing
+    size_t lines;     // lines of <width> bytes with at least one difference
+    size_t first;
+    size_t last;
+} diff_stats_t;
+
+static void diff_compare(const uint8_t *inA, size_t lenA, const uint8_t *inB, size_t lenB, size_t width, diff_stats_t *st) {
+    memset(st, 0, sizeof(diff_stats_t));
+    st->lenA = lenA;
+    st->lenB = lenB;
+
+    size_t common = MIN(lenA, lenB);
+    size_t biggest = MAX(lenA, lenB);
+    size_t last_line = SIZE_MAX;
+
+    size_t i = 0;
+    while (i < common) {
+        i = diff_mismatch(inA, inB, i, common);
+        if (i == common) {
+            break;
+        }
+
+        size_t line_end = MIN(i - (i % width) + width, common);
+        if (st->bytes == 0) {
+            st->first = i;
+        }
+        st->bytes += diff_count_bytes(inA, inB, i, line_end);
+        st->lines++;
+        last_line = i / width;
+
+        for (size_t j = line_end; j > i; j--) {
+            if (inA[j - 1] != inB[j - 1]) {
+                st->last = j - 1;
+                break;
+            }
+        }
+        i = line_end;
+    }
+
+    // everything past the shorter input differs
+    if (biggest > common) {
+        if (st->bytes == 0) {
+            st->first = common;
+        }
+        st->bytes += biggest - common;
+        st->last = biggest - 1;
+
+        size_t from_line = common / width;
+        st->lines += ((biggest - 1) / width) - from_line + 1;
+        if (last_line == from_line) {
+            st->lines--;
+        }
+    }
+}
+
+static void diff_print_line(const uint8_t *inA, size_t datalenA, const uint8_t *inB, size_t datalenB, size_t i, int width) {
+    char dlnA[240] = {0};
+    char dlnB[240] = {0};
+    char dlnAii[180] = {0};
+    char dlnBii[180] = {0};
+    char line[880] = {0};
+
+    for (size_t j = i; j < i + width; j++) {
+        int dlnALen = strlen(dlnA);
+        int dlnBLen = strlen(dlnB);
+        int dlnAiiLen = strlen(dlnAii);
+        int dlnBiiLen = strlen(dlnBii);
+
+        //both files ended
+        if (j >= datalenA && j >= datalenB) {
+            snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "-- ");
+            snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, ".") ;
+            snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "-- ");
+            snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, ".") ;
+            continue ;
+        }
+
+        char ca, cb;
+
+        if (j >= datalenA) {
+            // file A ended. print B without colors
+            cb = inB[j];
+            snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "-- ");
+            snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, ".") ;
+            snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "%02X ", inB[j]);
+            snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, "%c", ((cb < 32) || (cb == 127)) ? '.' : cb);
+            continue ;
+        }
+        ca = inA[j];
+        if (j >= datalenB) {
+            // file B ended. print A without colors
+            snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "%02X ", inA[j]);
+            snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, "%c", ((ca < 32) || (ca == 127)) ? '.' : ca);
+            snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "-- ");
+            snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, ".") ;
+            continue ;
+        }
+        cb = inB[j];
+        if (inA[j] != inB[j]) {
+            // diff / add colors
+            snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, _GREEN_("%02X "), inA[j]);
+            snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, _RED_("%02X "), inB[j]);
+            snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, _GREEN_("%c"), ((ca < 32) || (ca == 127)) ? '.' : ca);
+            snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, _RED_("%c"), ((cb < 32) || (cb == 127)) ? '.' : cb);
+        } else {
+            // normal
+            snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "%02X ", inA[j]);
+            snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "%02X ", inB[j]);
+            snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, "%c", ((ca < 32) || (ca == 127)) ? '.' : ca);
+            snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, "%c", ((cb < 32) || (cb == 127)) ? '.' : cb);
+        }
+    }
+    snprintf(line, sizeof(line), "%s%s | %s%s", dlnA, dlnAii, dlnB, dlnBii);
+
+    PrintAndLogEx(INFO, "%03zX | %s", i, line);
+}
+
+static void diff_print_summary(const diff_stats_t *st) {
+    PrintAndLogEx(INFO, "   length A... %zu", st->lenA);
+    PrintAndLogEx(INFO, "   length B... %zu", st->lenB);
+    if (st->bytes == 0) {
+        PrintAndLogEx(SUCCESS, "   " _GREEN_("identical"));
+        return;
+    }
+    PrintAndLogEx(INFO, "   diff bytes. " _YELLOW_("%zu"), st->bytes);
+    PrintAndLogEx(INFO, "   diff lines. " _YELLOW_("%zu"), st->lines);
+    PrintAndLogEx(INFO, "   first...... 0x%03zX", st->first);
+    PrintAndLogEx(INFO, "   last....... 0x%03zX", st->last);
+}
+
+// load a dump without the per file "loaded" messages
+static int diff_load_quiet(const char *fn, uint8_t **pdump, size_t *dumplen) {
+    DumpFileType_t dt = get_filetype(fn);
+    if (dt == BIN) {
+        return loadFile_safeEx(fn, ".bin", (void **)pdump, dumplen, false);
+    }
+    if (dt == JSON) {
+        *pdump = calloc(MIFARE_4K_MAX_BYTES, sizeof(uint8_t));
+        if (*pdump == NULL) {
+            return PM3_EMALLOC;
+        }
+        int res = loadFileJSONex(fn, *pdump, MIFARE_4K_MAX_BYTES, dumplen, false, NULL);
+        if (res != PM3_SUCCESS) {
+            free(*pdump);
+            *pdump = NULL;
+        }
+        return res;
+    }
+    return pm3_load_dump(fn, (void **)pdump, dumplen, MIFARE_4K_MAX_BYTES);
+}
+
+typedef struct {
+    char fn[FILE_PATH_SIZE];
+    int res;
+    diff_stats_t st;
+} diff_result_t;
+
+typedef struct {
+    const uint8_t *ref;
+    size_t reflen;
+    size_t width;
+    diff_result_t *results;
+    size_t count;
+    size_t *next;
+    pthread_mutex_t *lock;
+} diff_thread_arg_t;
+
+static void *diff_many_thread(void *arg) {
+    diff_thread_arg_t *a = (diff_thread_arg_t *)arg;
+    for (;;) {
+        pthread_mutex_lock(a->lock);
+        size_t idx = (*a->next)++;
+        pthread_mutex_unlock(a->lock);
+        if (idx >= a->count) {
+            break;
+        }
+
+        diff_result_t *r = &a->results[idx];
+        uint8_t *d = NULL;
+        size_t dlen = 0;
+        r->res = diff_load_quiet(r->fn, &d, &dlen);
+        if (r->res == PM3_SUCCESS) {
+            diff_compare(a->ref, a->reflen, d, dlen, a->width, &r->st);
+        }
+        free(d);
+    }
+    return NULL;
+}
+
+// compare reference A against every dump named in a list file, one summary line per dump
+static int diff_many(const uint8_t *ref, size_t reflen, const char *listfn, size_t width) {
+
+    FILE *f = fopen(listfn, "r");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", listfn);
+        return PM3_EFILE;
+    }
+
+    size_t count = 0, cap = 64;
+    diff_result_t *results = calloc(cap, sizeof(diff_result_t));
+    if (results == NULL) {
+        fclose(f);
+        return PM3_EMALLOC;
+    }
+
+    char buf[FILE_PATH_SIZE];
+    while (fgets(buf, sizeof(buf), f)) {
+        buf[strcspn(buf, "\r\n")] = 0;
+        if (buf[0] == 0 || buf[0] == '#') {
+            continue;
+        }
+        if (count == cap) {
+            diff_result_t *tmp = realloc(results, 2 * cap * sizeof(diff_result_t));
+            if (tmp == NULL) {
+                free(results);
+                fclose(f);
+                return PM3_EMALLOC;
+            }
+            results = tmp;
+            cap *= 2;
+        }
+        memset(&results[count], 0, sizeof(diff_result_t));
+        snprintf(results[count].fn, sizeof(results[count].fn), "%s", buf);
+        count++;
+    }
+    fclose(f);
+
+    if (count == 0) {
+        PrintAndLogEx(WARNING, "no file names in `" _YELLOW_("%s") "`", listfn);
+        free(results);
+        return PM3_EINVARG;
+    }
+
+    size_t thread_cnt = num_CPUs();
+    if (thread_cnt > count) {
+        thread_cnt = count;
+    }
+
+    size_t next = 0;
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+    diff_thread_arg_t arg = {
+        .ref = ref,
+        .reflen = reflen,
+        .width = width,
+        .results = results,
+        .count = count,
+        .next = &next,
+        .lock = &lock,
+    };
+
+    pthread_t threads[thread_cnt];
+    size_t started = 0;
+    for (; started < thread_cnt; started++) {
+        if (pthread_create(&threads[started], NULL, diff_many_thread, (void *)&arg)) {
+            break;
+        }
+    }
+
+    // nothing could be started, do it all here
+    if (started == 0) {
+        diff_many_thread(&arg);
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&lock);
+
+    PrintAndLogEx(INFO, "");
+    PrintAndLogEx(INFO, "-------+-------+-------+-------+----------------------------");
+    PrintAndLogEx(INFO, " len   | bytes | lines | first | file");
+    PrintAndLogEx(INFO, "-------+-------+-------+-------+----------------------------");
+    size_t differ = 0, failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        diff_result_t *r = &results[i];
+        if (r->res != PM3_SUCCESS) {
+            PrintAndLogEx(INFO, "   --  |   --  |   --  |   --  | %s ( " _RED_("load failed") " )", r->fn);
+            failed++;
+            continue;
+        }
+        if (r->st.bytes == 0) {
+            PrintAndLogEx(INFO, " %5zu |     0 |     0 |   --  | %s ( " _GREEN_("identical") " )", r->st.lenB, r->fn);
+            continue;
+        }
+        differ++;
+        PrintAndLogEx(INFO, " %5zu | " _YELLOW_("%5zu") " | %5zu | %5zX | %s", r->st.lenB, r->st.bytes, r->st.lines, r->st.first, r->fn);
+    }
+    PrintAndLogEx(INFO, "-------+-------+-------+-------+----------------------------");
+    PrintAndLogEx(SUCCESS, "compared " _YELLOW_("%zu") " files, " _YELLOW_("%zu") " differ, %zu identical, %zu failed to load", count, differ, count - differ - failed, failed);
+    PrintAndLogEx(NORMAL, "");
+
+    free(results);
+    return PM3_SUCCESS;
+}
+
 static int CmdDiff(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -2800,6 +3645,9 @@ static int CmdDiff(const char *Cmd) {
                   "data diff -a fileA --eb\n"
                   "data diff --fa fileA -b fileB\n"
                   "data diff --fa fileA --fb fileB\n"
+                  "data diff -a fileA -b fileB -c      -> only lines that differ\n"
+                  "data diff -a fileA -b fileB -s      -> summary only\n"
+                  "data diff -a fileA --list dumps.txt -> compare A against every file in the list\n"
                  );
 
     void *argtable[] = {
@@ -2810,6 +3658,9 @@ static int CmdDiff(const char *Cmd) {
         arg_str0(NULL, "fa", "<fn>", "input spiffs file A"),
         arg_str0(NULL, "fb", "<fn>", "input spiffs file B"),
         arg_int0("w",  NULL, "<4|8|16>", "Width of data output"),
+        arg_lit0("c", "changed", "only print lines that differ"),
+        arg_lit0("s", "summary", "only print a summary of the differences"),
+        arg_str0(NULL, "list", "<fn>", "text file with dump file names, one per line, compared against A"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -2835,6 +3686,12 @@ static int CmdDiff(const char *Cmd) {
     CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)spnameB, FILE_PATH_SIZE, &splenB);
 
     int width = arg_get_int_def(ctx, 6, 16);
+    bool changed_only = arg_get_lit(ctx, 7);
+    bool summary = arg_get_lit(ctx, 8);
+
+    int listlen = 0;
+    char listfn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 9), (uint8_t *)listfn, FILE_PATH_SIZE, &listlen);
     CLIParserFree(ctx);
 
     // sanity check
@@ -2926,6 +3783,18 @@ static int CmdDiff(const char *Cmd) {
         }
     }
 
+    if (listlen) {
+        if (inA == NULL) {
+            PrintAndLogEx(WARNING, "a reference dump A is needed with `--list`");
+            free(inB);
+            return PM3_EINVARG;
+        }
+        res = diff_many(inA, datalenA, listfn, width);
+        free(inB);
+        free(inA);
+        return res;
+    }
+
     size_t biggest = (datalenA > datalenB) ? datalenA : datalenB;
     PrintAndLogEx(DEBUG, "data len:  %zu   A %zu  B %zu", biggest, datalenA, datalenB);
 
@@ -2937,6 +3806,18 @@ static int CmdDiff(const char *Cmd) {
         PrintAndLogEx(INFO, "inB null");
     }
 
+    if (summary) {
+        diff_stats_t st;
+        diff_compare(inA, datalenA, inB, datalenB, width, &st);
+        PrintAndLogEx(INFO, "");
+        PrintAndLogEx(INFO, "--- " _CYAN_("Diff summary"));
+        diff_print_summary(&st);
+        PrintAndLogEx(NORMAL, "");
+        free(inB);
+        free(inA);
+        return PM3_SUCCESS;
+    }
+
     char hdr0[400] = {0};
 
     int hdr_sln = (width * 4) + 2;
@@ -2979,73 +3860,29 @@ static int CmdDiff(const char *Cmd) {
     PrintAndLogEx(INFO, hdr0);
     PrintAndLogEx(INFO, hdr1);
 
-    char line[880] = {0};
+    size_t common = MIN(datalenA, datalenB);
 
     // print data diff loop
-    for (int i = 0 ; i < biggest ; i += width) {
-        char dlnA[240] = {0};
-        char dlnB[240] = {0};
-        char dlnAii[180] = {0};
-        char dlnBii[180] = {0};
-
-        memset(dlnA, 0, sizeof(dlnA));
-        memset(dlnB, 0, sizeof(dlnB));
-        memset(dlnAii, 0, sizeof(dlnAii));
-        memset(dlnBii, 0, sizeof(dlnBii));
-
-        for (int j = i; j < i + width; j++) {
-            int dlnALen = strlen(dlnA);
-            int dlnBLen = strlen(dlnB);
-            int dlnAiiLen = strlen(dlnAii);
-            int dlnBiiLen = strlen(dlnBii);
-
-            //both files ended
-            if (j >= datalenA && j >= datalenB) {
-                snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "-- ");
-                snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, ".") ;
-                snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "-- ");
-                snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, ".") ;
-                continue ;
-            }
-
-            char ca, cb;
+    for (size_t i = 0; i < biggest; i += width) {
 
-            if (j >= datalenA) {
-                // file A ended. print B without colors
-                cb = inB[j];
-                snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "-- ");
-                snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, ".") ;
-                snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "%02X ", inB[j]);
-                snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, "%c", ((cb < 32) || (cb == 127)) ? '.' : cb);
-                continue ;
+        if (changed_only) {
+            // jump to the line holding the next difference
+            size_t next = diff_mismatch(inA, inB, i, common);
+            if (next == biggest) {
+                next = biggest - (biggest % width) + width;
             }
-            ca = inA[j];
-            if (j >= datalenB) {
-                // file B ended. print A without colors
-                snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "%02X ", inA[j]);
-                snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, "%c", ((ca < 32) || (ca == 127)) ? '.' : ca);
-                snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "-- ");
-                snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, ".") ;
-                continue ;
-            }
-            cb = inB[j];
-            if (inA[j] != inB[j]) {
-                // diff / add colors
-                snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, _GREEN_("%02X "), inA[j]);
-                snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, _RED_("%02X "), inB[j]);
-                snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, _GREEN_("%c"), ((ca < 32) || (ca == 127)) ? '.' : ca);
-                snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, _RED_("%c"), ((cb < 32) || (cb == 127)) ? '.' : cb);
-            } else {
-                // normal
-                snprintf(dlnA + dlnALen, sizeof(dlnA) - dlnALen, "%02X ", inA[j]);
-                snprintf(dlnB + dlnBLen, sizeof(dlnB) - dlnBLen, "%02X ", inB[j]);
-                snprintf(dlnAii + dlnAiiLen, sizeof(dlnAii) - dlnAiiLen, "%c", ((ca < 32) || (ca == 127)) ? '.' : ca);
-                snprintf(dlnBii + dlnBiiLen, sizeof(dlnBii) - dlnBiiLen, "%c", ((cb < 32) || (cb == 127)) ? '.' : cb);
+            size_t line_start = next - (next % width);
+            if (line_start > i) {
+                size_t skipped = (MIN(line_start, biggest) - i + width - 1) / width;
+                PrintAndLogEx(INFO, "... | %zu identical line%s", skipped, (skipped == 1) ? "" : "s");
+                i = line_start;
+                if (i >= biggest) {
+                    break;
+                }
             }
         }
-        snprintf(line, sizeof(line), "%s%s | %s%s", dlnA, dlnAii, dlnB, dlnBii);
 
-        PrintAndLogEx(INFO, "%03X | %s", i, line);
+        diff_print_line(inA, datalenA, inB, datalenB, i, width);
     }
 
     // footer
@@ -3881,6 +4718,7 @@ static command_t CommandTable[] = {
     {"-----------",      CmdHelp,                 AlwaysAvailable, "------------------------- " _CYAN_("Operations") "-------------------------"},
     {"asn1",             CmdAsn1Decoder,          AlwaysAvailable,  "ASN1 decoder"},
     {"atr",              CmdAtrLookup,            AlwaysAvailable,  "ATR lookup"},
+    {"bench",            CmdBench,                AlwaysAvailable,  "Benchmark the demodulators on graph buffer or pm3 files"},
     {"bitsamples",       CmdBitsamples,           IfPm3Present,     "Get raw samples as bitstring"},
     {"bmap",             CmdBinaryMap,            AlwaysAvailable,  "Convert hex value according a binary template"},
     {"crypto",           CmdCryptography,         AlwaysAvailable,  "Encrypt and decrypt data"},
@@ -82,6 +82,9 @@ int printDemodBuff(uint8_t offset, bool strip_leading, bool invert, bool print_h
 void setDemodBuff(const uint8_t *buff, size_t size, size_t start_idx);
 bool getDemodBuff(uint8_t *buff, size_t *size);
 int AutoCorrelate(const int *in, int *out, size_t len, size_t window, bool SaveGrph, bool verbose);
+// AutoCorrelate() for several window sizes at once, the correlation is only computed once.
+// distances[] gets -1 where AutoCorrelate() would, nothing is printed.
+int AutoCorrelateWindows(const int *in, size_t len, const size_t *windows, int *distances, size_t count);
 
 int getSamples(uint32_t n, bool verbose);
 int getSamplesEx(uint32_t start, uint32_t end, bool verbose, bool ignore_lf_config);
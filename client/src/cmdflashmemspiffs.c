@@ -566,8 +566,120 @@ static int CmdFlashMemSpiFFSView(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static void flashmem_spiffs_bank_print(const eml_bank_resp_t *resp) {
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "slot | bytes | file");
+    PrintAndLogEx(INFO, "-----+-------+-------------------");
+    for (uint8_t i = 0; i < EML_BANK_SLOTS; i++) {
+        if ((resp->present & (1 << i)) == 0) {
+            continue;
+        }
+        char fn[32];
+        snprintf(fn, sizeof(fn), EML_BANK_FILENAME, i);
+        PrintAndLogEx(INFO, " %2u  | %5u | %s", i, resp->sizes[i], fn);
+    }
+    if (resp->present == 0) {
+        PrintAndLogEx(INFO, "<empty>");
+    }
+    PrintAndLogEx(NORMAL, "");
+}
+
+static int CmdFlashMemSpiFFSBank(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "mem spiffs bank",
+                  "Manage the emulator image bank on device SPIFFS.\n"
+                  "Slot n is the file `eml_bank_NN.bin`, the device remembers where each slot\n"
+                  "lives in flash so loading one into emulator memory takes a few milliseconds.\n"
+                  "Standalone mode hf_mfcsim cycles through the bank with the button.",
+                  "mem spiffs bank                                -> list slots\n"
+                  "mem spiffs bank --slot 2 -f hf-mf-01020304.bin -> upload dump to slot 2\n"
+                  "mem spiffs bank --slot 2 --load                -> load slot 2 for `hf mf sim`\n"
+                  "mem spiffs bank --slot 3 --load --15           -> load slot 3 for `hf 15 sim` / `hf iclass sim`"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_int0(NULL, "slot", "<dec>", "bank slot (0 - 15)"),
+        arg_str0("f", "file", "<fn>", "dump file to upload into slot"),
+        arg_lit0(NULL, "load", "load slot into emulator memory"),
+        arg_lit0(NULL, "15", "emulator memory is for the ISO15693 / iCLASS emulators"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    int slot = arg_get_int_def(ctx, 1, -1);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    bool load = arg_get_lit(ctx, 3);
+    bool use_15 = arg_get_lit(ctx, 4);
+    CLIParserFree(ctx);
+
+    if ((fnlen || load) && (slot < 0 || slot >= EML_BANK_SLOTS)) {
+        PrintAndLogEx(FAILED, "Slot must be between 0 and %u", EML_BANK_SLOTS - 1);
+        return PM3_EINVARG;
+    }
+
+    if (fnlen) {
+        uint8_t *data = NULL;
+        size_t datalen = 0;
+        int res = pm3_load_dump(filename, (void **)&data, &datalen, EML_BANK_MAX_SIZE);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+
+        char dest[32];
+        snprintf(dest, sizeof(dest), EML_BANK_FILENAME, slot);
+        res = flashmem_spiffs_load(dest, data, datalen);
+        free(data);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+        PrintAndLogEx(SUCCESS, "Wrote "_GREEN_("%zu") " bytes to slot " _GREEN_("%d"), datalen, slot);
+    }
+
+    eml_bank_req_t payload = {
+        .action = (load) ? EML_BANK_LOAD : EML_BANK_LIST,
+        .slot = (slot < 0) ? 0 : slot,
+        .fpga = (use_15) ? FPGA_BITSTREAM_HF_15 : FPGA_BITSTREAM_HF,
+    };
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_SPIFFS_EML_BANK, (uint8_t *)&payload, sizeof(payload));
+    if (WaitForResponseTimeout(CMD_SPIFFS_EML_BANK, &resp, 4000) == false) {
+        PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.length != sizeof(eml_bank_resp_t)) {
+        PrintAndLogEx(FAILED, "Wrong length of reply");
+        return PM3_EFAILED;
+    }
+    const eml_bank_resp_t *bank = (const eml_bank_resp_t *)resp.data.asBytes;
+
+    if (load) {
+        if (resp.status == PM3_ENODATA) {
+            PrintAndLogEx(FAILED, "Slot " _YELLOW_("%d") " is empty", slot);
+            return resp.status;
+        }
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "Loading slot " _YELLOW_("%d") " failed ( %d )", slot, resp.status);
+            return resp.status;
+        }
+        PrintAndLogEx(SUCCESS, "Loaded slot " _GREEN_("%u") ", " _GREEN_("%u") " bytes into emulator memory in " _GREEN_("%u") " ms", bank->slot, bank->loaded, bank->ms);
+        return PM3_SUCCESS;
+    }
+
+    flashmem_spiffs_bank_print(bank);
+    return PM3_SUCCESS;
+}
+
 static command_t CommandTable[] = {
     {"help",    CmdHelp,                  AlwaysAvailable, "This help"},
+    {"bank",    CmdFlashMemSpiFFSBank,    IfPm3Flash, "List, fill and load the emulator image bank"},
     {"copy",    CmdFlashMemSpiFFSCopy,    IfPm3Flash, "Copy a file to another (destructively) in SPIFFS file system"},
     {"check",   CmdFlashMemSpiFFSCheck,   IfPm3Flash, "Check/try to defrag faulty/fragmented file system"},
     {"dump",    CmdFlashMemSpiFFSDump,    IfPm3Flash, "Dump a file from SPIFFS file system"},
@@ -57,30 +57,91 @@
 #include "ui.h"
 #include "proxgui.h"
 #include "cmddata.h"
+#include "cmdhw.h"          // set_fpga_mode
+#include "fileutils.h"      // createMappedFile
 #include "graph.h"
 #include "fpga.h"
 
 static int CmdHelp(const char *Cmd);
 
+// one device side polling pass,  ISO14443-A/B, ISO15693 and iCLASS only
+static int hf_search_fast(void) {
+
+    hf_discover_req_t payload = { .techs = HF_DISCOVER_ALL };
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_DISCOVER, (uint8_t *)&payload, sizeof(payload));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_DISCOVER, &resp, 2500) == false) {
+        PrintAndLogEx(WARNING, "timeout while waiting for reply");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS && resp.status != PM3_ENODATA) {
+        PrintAndLogEx(WARNING, "discover failed ( %d )", resp.status);
+        return resp.status;
+    }
+
+    const hf_discover_t *d = (hf_discover_t *)resp.data.asBytes;
+    if (d->count == 0) {
+        PrintAndLogEx(WARNING, _RED_("No known/supported 13.56 MHz tags found") " ( %u ms )", d->ms);
+        return PM3_ESOFT;
+    }
+
+    for (uint8_t i = 0; i < MIN(d->count, HF_DISCOVER_MAX_TAGS); i++) {
+        const hf_discover_tag_t *t = &d->tags[i];
+        switch (t->tech) {
+            case HF_DISCOVER_14A:
+                if (t->uidlen == 0) {
+                    PrintAndLogEx(SUCCESS, _GREEN_("ISO 14443-A") " ATQA: " _GREEN_("%02X %02X") " ( proprietary anticollision, try " _YELLOW_("`hf topaz info`") " )", t->atqa[1], t->atqa[0]);
+                } else {
+                    PrintAndLogEx(SUCCESS, _GREEN_("ISO 14443-A") " UID: " _GREEN_("%s") " ATQA: %02X %02X SAK: %02X", sprint_hex_inrow(t->uid, t->uidlen), t->atqa[1], t->atqa[0], t->sak);
+                }
+                break;
+            case HF_DISCOVER_14B:
+                PrintAndLogEx(SUCCESS, _GREEN_("ISO 14443-B") " UID: " _GREEN_("%s") " ATQB: %s", sprint_hex_inrow(t->uid, t->uidlen), sprint_hex_inrow(t->atqb, sizeof(t->atqb)));
+                break;
+            case HF_DISCOVER_15:
+                PrintAndLogEx(SUCCESS, _GREEN_("ISO 15693") "   UID: " _GREEN_("%s"), sprint_hex_inrow(t->uid, t->uidlen));
+                break;
+            case HF_DISCOVER_ICLASS:
+                PrintAndLogEx(SUCCESS, _GREEN_("iCLASS") "      CSN: " _GREEN_("%s"), sprint_hex_inrow(t->uid, t->uidlen));
+                break;
+            default:
+                break;
+        }
+    }
+    PrintAndLogEx(INFO, "%u tag(s) found in " _YELLOW_("%u") " ms", d->count, d->ms);
+    return PM3_SUCCESS;
+}
+
 int CmdHFSearch(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf search",
                   "Will try to find a HF read out of the unknown tag.\n"
-                  "Continues to search for all different HF protocols.",
-                  "hf search"
+                  "Continues to search for all different HF protocols.\n"
+                  "With --fast the device polls ISO14443-A/B, ISO15693 and iCLASS in one pass and only UIDs are reported",
+                  "hf search\n"
+                  "hf search --fast"
                  );
     void *argtable[] = {
         arg_param_begin,
         arg_lit0("v", "verbose", "verbose output"),
+        arg_lit0("f", "fast", "single device side polling pass"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
 
     bool verbose = arg_get_lit(ctx, 1);
+    bool fast = arg_get_lit(ctx, 2);
 
     CLIParserFree(ctx);
 
+    if (fast) {
+        return hf_search_fast();
+    }
+
     int res = PM3_ESOFT;
 
     uint8_t success[20] = {0};
@@ -418,6 +479,73 @@ const CLIParserOption HFSnoopSkipModeOpts[] = {
     {0,    NULL},
 };
 
+// Real-time sniff,  the device streams raw 8 bit samples once the trigger hit.
+// With a filename they land in a memory mapped file, so the capture isn't bound by host RAM.
+// The graph gets the last MAX_GRAPH_TRACE_LEN samples.
+static int hf_sniff_realtime(uint8_t *params, size_t paramslen, uint64_t samples, const char *filename) {
+
+    mapped_file_t mf = {0};
+    uint8_t *buf = NULL;
+    if (filename) {
+        int res = createMappedFile(filename, ".bin", samples, &mf);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "failed to create capture file");
+            return res;
+        }
+        buf = mf.data;
+    } else {
+        buf = calloc(samples, sizeof(uint8_t));
+        if (buf == NULL) {
+            PrintAndLogEx(FAILED, "failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+    }
+
+    // the HF bitstream must be loaded before, else a CMD_WTX reply could end up in the raw data
+    int res = set_fpga_mode(FPGA_BITSTREAM_HF);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "failed to load HF bitstream to FPGA");
+        if (filename) {
+            closeMappedFile(&mf, 0);
+        } else {
+            free(buf);
+        }
+        return res;
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_SNIFF, params, paramslen);
+
+    // nothing arrives until the trigger hit
+    PrintAndLogEx(INFO, "Waiting for trigger, press " _GREEN_("<Enter>") " to abort");
+    size_t got = WaitForRawDataTimeout(buf, MIN(samples, 32), -1, false);
+    if (got < samples) {
+        got += WaitForRawDataTimeout(buf + got, samples - got, 1000, true);
+    }
+
+    PrintAndLogEx(INFO, "HF sniff (%zu samples)", got);
+
+    if (got) {
+        size_t start = 0;
+        if (got > MAX_GRAPH_TRACE_LEN) {
+            start = got - MAX_GRAPH_TRACE_LEN;
+            PrintAndLogEx(INFO, "Graph shows the last " _YELLOW_("%zu") " samples", got - start);
+        }
+        getSamplesFromBufEx(buf + start, got - start, 8, false);
+
+        PrintAndLogEx(HINT, "Use `" _YELLOW_("data hpf") "` to remove offset");
+        PrintAndLogEx(HINT, "Use `" _YELLOW_("data plot") "` to view");
+    }
+
+    if (filename) {
+        closeMappedFile(&mf, got);
+    } else {
+        free(buf);
+    }
+    PrintAndLogEx(INFO, "Done.");
+    return PM3_SUCCESS;
+}
+
 // Collects pars of u8,
 // uses 16bit transfers from FPGA for speed
 // Takes all available bigbuff memory
@@ -428,9 +556,11 @@ int CmdHFSniff(const char *Cmd) {
     CLIParserInit(&ctx, "hf sniff",
                   "The high frequency sniffer will assign all available memory on device for sniffed data.\n"
                   "Use `data samples` to download from device and `data plot` to visualize it.\n"
+                  "With `-s` the samples are streamed to the client in real-time instead, not bound by device memory.\n"
                   "Press button to quit the sniffing.",
                   "hf sniff\n"
-                  "hf sniff --sp 1000 --st 0   -> skip 1000 pairs, skip 0 triggers"
+                  "hf sniff --sp 1000 --st 0   -> skip 1000 pairs, skip 0 triggers\n"
+                  "hf sniff -s 2000000 -f hf_capture --smode avg --sratio 4  -> stream 2M averaged samples to file"
                  );
     void *argtable[] = {
         arg_param_begin,
@@ -438,6 +568,8 @@ int CmdHFSniff(const char *Cmd) {
         arg_u64_0(NULL, "st",    "<dec>", "skip number of triggers"),
         arg_str0(NULL,  "smode", "[none|drop|min|max|avg]", "Skip mode. It switches on the function that applies to several samples before they saved to memory"),
         arg_int0(NULL,  "sratio",  "<dec, ms>", "Skip ratio. It applied the function above to (ratio * 2) samples. For ratio = 1 it 2 samples."),
+        arg_u64_0("s", "samples", "<dec>", "stream this many samples in real-time"),
+        arg_str0("f", "file", "<fn>", "save the streamed samples to binary file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -447,6 +579,7 @@ int CmdHFSniff(const char *Cmd) {
         uint32_t triggersToSkip;
         uint8_t skipMode;
         uint8_t skipRatio;
+        uint8_t realtime;
     } PACKED params;
 
     params.samplesToSkip = arg_get_u32_def(ctx, 1, 0);
@@ -461,8 +594,21 @@ int CmdHFSniff(const char *Cmd) {
     params.skipMode = smode;
     params.skipRatio = arg_get_int_def(ctx, 4, 0);
 
+    uint64_t samples = arg_get_u64_def(ctx, 5, 0);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 6), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
     CLIParserFree(ctx);
 
+    if (fnlen && samples == 0) {
+        PrintAndLogEx(WARNING, "Streaming to file needs the number of samples, use " _YELLOW_("`-s`"));
+        return PM3_EINVARG;
+    }
+
+    params.realtime = (samples > 0);
+
     if (params.skipMode != HF_SNOOP_SKIP_NONE) {
         PrintAndLogEx(INFO, "Skip mode. Function: %s, each: %d sample",
                       CLIGetOptionListStr(HFSnoopSkipModeOpts, params.skipMode),
@@ -470,6 +616,10 @@ int CmdHFSniff(const char *Cmd) {
                      );
     }
 
+    if (params.realtime) {
+        return hf_sniff_realtime((uint8_t *)&params, sizeof(params), samples, (fnlen) ? filename : NULL);
+    }
+
     clearCommandBuffer();
     SendCommandNG(CMD_HF_SNIFF, (uint8_t *)&params, sizeof(params));
 
@@ -530,6 +680,10 @@ int handle_hf_plot(bool show_plot) {
         return PM3_ETIMEOUT;
     }
 
+    if (GraphReserve(FPGA_TRACE_SIZE) == false) {
+        return PM3_EMALLOC;
+    }
+
     for (size_t i = 0; i < FPGA_TRACE_SIZE; i++) {
         g_GraphBuffer[i] = ((int)buf[i]) - 128;
     }
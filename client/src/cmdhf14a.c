@@ -617,6 +617,14 @@ static int CmdHF14AReader(const char *Cmd) {
                 goto plot;
             }
 
+            uint8_t atqa[2] = {card.atqa[1], card.atqa[0]};
+            ResultAddHex("uid", card.uid, card.uidlen);
+            ResultAddHex("atqa", atqa, sizeof(atqa));
+            ResultAddInt("sak", card.sak);
+            if (card.ats_len >= 3) {
+                ResultAddHex("ats", card.ats, (card.ats_len == card.ats[0] + 2) ? card.ats[0] : card.ats_len);
+            }
+
             if ((card.uidlen == 4) && (card.uid[0] == 0x08)) {
                 PrintAndLogEx(SUCCESS, " UID: " _GREEN_("%s") " ( random )", sprint_hex(card.uid, card.uidlen));
             } else {
@@ -695,61 +703,556 @@ static int CmdHF14AInfo(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
-// Collect ISO14443 Type A UIDs
+// Collect ISO14443 Type A UIDs or MIFARE Classic nonces,  the device streams them back in chunks
 static int CmdHF14ACUIDs(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf 14a cuids",
-                  "Collect n>0 ISO14443-a UIDs in one go",
-                  "hf 14a cuids -n 5   --> Collect 5 UIDs");
+                  "Collect n>0 ISO14443-a UIDs in one go.\n"
+                  "The device samples at RF speed and streams the results back in bulk.\n"
+                  "With --nonces it collects MIFARE Classic tag nonces (nt) and the device clock of each auth,\n"
+                  "use -n 0 to run until aborted and -f to write the samples to a file",
+                  "hf 14a cuids -n 5                              --> Collect 5 UIDs\n"
+                  "hf 14a cuids -n 100000 --off 20 -f uids.txt    --> 100k UIDs, 20 ms field off between them\n"
+                  "hf 14a cuids --nonces -n 0 --blk 0 -f nt.txt   --> key A nonces of block 0 until aborted");
 
     void *argtable[] = {
         arg_param_begin,
-        arg_int0("n", "num", "<dec>", "Number of UIDs to collect"),
+        arg_int0("n", "num", "<dec>", "Number of samples to collect, 0 = until aborted (def 1)"),
+        arg_lit0(NULL, "nonces", "collect MIFARE Classic nonces instead of UIDs"),
+        arg_int0(NULL, "blk", "<dec>", "block to authenticate with --nonces (def 0)"),
+        arg_lit0("b", NULL, "use key B with --nonces"),
+        arg_int0(NULL, "off", "<ms>", "field off time between UIDs, 0 = no power cycle (def 10)"),
+        arg_str0("f", "file", "<fn>", "write samples to text file, one per line"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
 
-    // requested number of UIDs
-    // collect at least 1 (e.g. if no parameter was given)
-    int n = arg_get_int_def(ctx, 1, 1);
+    iso14a_collect_req_t req = {
+        .mode = arg_get_lit(ctx, 2) ? ISO14A_COLLECT_NONCE : ISO14A_COLLECT_UID,
+        .block = arg_get_int_def(ctx, 3, 0),
+        .keytype = arg_get_lit(ctx, 4),
+        .off_ms = arg_get_int_def(ctx, 5, 10),
+        .count = arg_get_u32_def(ctx, 1, 1),
+    };
 
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 6), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
-    uint64_t t1 =  msclock();
-    PrintAndLogEx(SUCCESS, "collecting %d UIDs", n);
+    FILE *f = NULL;
+    if (fnlen) {
+        f = fopen(filename, "w");
+        if (f == NULL) {
+            PrintAndLogEx(ERR, "could not create file " _YELLOW_("%s"), filename);
+            return PM3_EFILE;
+        }
+    }
 
-    // repeat n times
-    for (int i = 0; i < n; i++) {
+    const char *what = (req.mode == ISO14A_COLLECT_NONCE) ? "nonces" : "UIDs";
+    if (req.count) {
+        PrintAndLogEx(SUCCESS, "collecting %u %s", req.count, what);
+    } else {
+        PrintAndLogEx(SUCCESS, "collecting %s,  press " _GREEN_("<Enter>") " to stop", what);
+    }
 
-        if (kbd_enter_pressed()) {
-            PrintAndLogEx(WARNING, "aborted via keyboard!\n");
-            break;
-        }
+    uint64_t t1 = msclock();
+    uint64_t taken = 0, fails = 0;
+    int status = PM3_SUCCESS;
+    bool aborted = false;
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443A_COLLECT, (uint8_t *)&req, sizeof(req));
 
-        // execute anticollision procedure
-        SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_CONNECT | ISO14A_NO_RATS, 0, 0, NULL, 0);
+    for (;;) {
+
+        if (aborted == false && kbd_enter_pressed()) {
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            aborted = true;
+        }
 
         PacketResponseNG resp;
-        WaitForResponse(CMD_ACK, &resp);
+        if (WaitForResponseTimeout(CMD_HF_ISO14443A_COLLECT, &resp, 3000) == false) {
+            PrintAndLogEx(WARNING, "command execution time out");
+            status = PM3_ETIMEOUT;
+            break;
+        }
+
+        if (resp.length < sizeof(iso14a_collect_chunk_t) - ISO14A_COLLECT_DATA) {
+            status = (resp.status != PM3_SUCCESS) ? resp.status : PM3_ESOFT;
+            break;
+        }
 
-        iso14a_card_select_t *card = (iso14a_card_select_t *) resp.data.asBytes;
+        const iso14a_collect_chunk_t *chunk = (const iso14a_collect_chunk_t *)resp.data.asBytes;
+        fails += chunk->fails;
 
-        // check if command failed
-        if (resp.oldarg[0] == 0) {
-            PrintAndLogEx(WARNING, "card select failed.");
+        if (chunk->mode == ISO14A_COLLECT_NONCE) {
+            for (uint16_t i = 0; i + sizeof(iso14a_collect_nonce_t) <= chunk->len; i += sizeof(iso14a_collect_nonce_t)) {
+                const iso14a_collect_nonce_t *n = (const iso14a_collect_nonce_t *)(chunk->data + i);
+                if (f) {
+                    fprintf(f, "%08X %u\n", n->nt, n->ts);
+                } else {
+                    PrintAndLogEx(SUCCESS, "%08X  %10u", n->nt, n->ts);
+                }
+                taken++;
+            }
         } else {
-            char uid_string[20];
-            for (uint16_t m = 0; m < card->uidlen; m++) {
-                int offset = 2 * m;
-                snprintf(uid_string + offset, sizeof(uid_string) - offset, "%02X", card->uid[m]);
+            for (uint16_t i = 0; i + sizeof(iso14a_collect_uid_t) <= chunk->len; i += sizeof(iso14a_collect_uid_t)) {
+                const iso14a_collect_uid_t *u = (const iso14a_collect_uid_t *)(chunk->data + i);
+                uint8_t uidlen = MIN(u->uidlen, sizeof(u->uid));
+                if (f) {
+                    for (uint8_t m = 0; m < uidlen; m++) {
+                        fprintf(f, "%02X", u->uid[m]);
+                    }
+                    fprintf(f, " %02X\n", u->sak);
+                } else {
+                    PrintAndLogEx(SUCCESS, "%s", sprint_hex_inrow(u->uid, uidlen));
+                }
+                taken++;
             }
-            PrintAndLogEx(SUCCESS, "%s", uid_string);
         }
+
+        if (f) {
+            PrintAndLogEx(INPLACE, "%" PRIu64 " %s", taken, what);
+        }
+
+        if (chunk->last) {
+            status = resp.status;
+            break;
+        }
+    }
+
+    if (f) {
+        fclose(f);
+        PrintAndLogEx(NORMAL, "");
+        PrintAndLogEx(SUCCESS, "saved to " _YELLOW_("%s"), filename);
+    }
+
+    if (status == PM3_ECARDEXCHANGE) {
+        PrintAndLogEx(WARNING, "card select failed, stopped");
+    } else if (status == PM3_EOPABORTED) {
+        PrintAndLogEx(WARNING, "aborted");
+    }
+
+    uint64_t ms = msclock() - t1;
+    PrintAndLogEx(SUCCESS, "end: %" PRIu64 " %s, %" PRIu64 " failed, %" PRIu64 " ms ( %" PRIu64 " / s )"
+                  , taken
+                  , what
+                  , fails
+                  , ms
+                  , ms ? (taken * 1000) / ms : taken
+                 );
+
+    if (status == PM3_EOPABORTED || status == PM3_SUCCESS) {
+        return PM3_SUCCESS;
+    }
+    return status;
+}
+
+static int CmdHF14AEnum(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf 14a enum",
+                  "Enumerate all ISO14443-a tags in the field.\n"
+                  "The device walks the anticollision tree, halting each tag once it is found,\n"
+                  "and returns every UID with its ATQA and SAK in one reply",
+                  "hf 14a enum");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIParserFree(ctx);
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443A_ENUMERATE, NULL, 0);
+
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_ISO14443A_ENUMERATE, &resp, 2500) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "enumeration failed");
+        return resp.status;
+    }
+
+    const iso14a_enum_t *res = (const iso14a_enum_t *)resp.data.asBytes;
+    if (res->count == 0) {
+        PrintAndLogEx(WARNING, "no tag found");
+        return PM3_ECARDEXCHANGE;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, " #  | UID                  | ATQA  | SAK");
+    PrintAndLogEx(INFO, "----+----------------------+-------+-----");
+    for (uint8_t i = 0; i < res->count && i < ISO14A_ENUM_MAX_TAGS; i++) {
+        const iso14a_enum_tag_t *tag = &res->tags[i];
+        PrintAndLogEx(SUCCESS, " %2u | " _GREEN_("%-20s") " | %02X %02X |  %02X"
+                      , i + 1
+                      , sprint_hex_inrow(tag->uid, tag->uidlen)
+                      , tag->atqa[1], tag->atqa[0]
+                      , tag->sak
+                     );
+    }
+
+    PrintAndLogEx(SUCCESS, "found " _GREEN_("%u") " tag%s", res->count, (res->count == 1) ? "" : "s");
+    if (res->truncated) {
+        PrintAndLogEx(WARNING, "more tags in field, list truncated at %u", ISO14A_ENUM_MAX_TAGS);
+    }
+    PrintAndLogEx(NORMAL, "");
+    return PM3_SUCCESS;
+}
+
+#define SEQ_MAX_LABELS 32
+typedef struct {
+    char name[17];
+    int addr;
+} seq_label_t;
+
+static int seq_find_label(const seq_label_t *labels, int n, const char *name) {
+    for (int i = 0; i < n; i++) {
+        if (strcmp(labels[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// assembles the text form of a ISO14A_SEQ_* program,  one statement per line or separated by ';'
+//   label:  connect [rats]  send [crc] [7bit] [norx] <hex>  expect [<hex>]  jmp|jt|jf <label>
+//   set <n>  djnz <label>  log  wait <us>  off  end [code]       # comment
+// returns program length or -1
+static int seq_assemble(const char *src, uint8_t *out, int maxlen) {
+
+    seq_label_t labels[SEQ_MAX_LABELS];
+    int nlabels = 0;
+    struct {
+        char name[17];
+        int pos;
+        int line;
+    } fixups[SEQ_MAX_LABELS * 2];
+    int nfixups = 0;
+
+    char *text = strdup(src);
+    if (text == NULL) {
+        return -1;
+    }
+
+    int n = 0;
+    int line = 0;
+    int res = -1;
+    char *save_stmt = NULL;
+
+// room for the op
+#define SEQ_ROOM(x) if (n + (x) > maxlen) { PrintAndLogEx(ERR, "line %d: program too large", line); goto out; }
+
+    for (char *stmt = strtok_r(text, ";\n", &save_stmt); stmt; stmt = strtok_r(NULL, ";\n", &save_stmt)) {
+        line++;
+
+        char *hash = strchr(stmt, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+
+        // label
+        char *colon = strchr(stmt, ':');
+        if (colon) {
+            *colon = '\0';
+            char *name = stmt;
+            while (isspace((unsigned char)*name)) name++;
+            size_t nl = strlen(name);
+            while (nl && isspace((unsigned char)name[nl - 1])) name[--nl] = '\0';
+            if (strlen(name) == 0 || strlen(name) > 16 || nlabels >= SEQ_MAX_LABELS || seq_find_label(labels, nlabels, name) >= 0) {
+                PrintAndLogEx(ERR, "line %d: bad or duplicate label `%s`", line, name);
+                goto out;
+            }
+            strcpy(labels[nlabels].name, name);
+            labels[nlabels++].addr = n;
+            stmt = colon + 1;
+        }
+
+        char *save_tok = NULL;
+        char *op = strtok_r(stmt, " \t\r", &save_tok);
+        if (op == NULL) {
+            continue;
+        }
+
+        char *arg = strtok_r(NULL, " \t\r", &save_tok);
+
+        if (strcmp(op, "connect") == 0) {
+            SEQ_ROOM(2);
+            out[n++] = ISO14A_SEQ_CONNECT;
+            out[n++] = (arg && strcmp(arg, "rats") == 0) ? ISO14A_SEQ_CONNECT_RATS : 0;
+
+        } else if (strcmp(op, "send") == 0 || strcmp(op, "expect") == 0) {
+            bool send = (op[0] == 's');
+            uint8_t flags = 0;
+            while (send && arg) {
+                if (strcmp(arg, "crc") == 0) flags |= ISO14A_SEQ_SEND_CRC;
+                else if (strcmp(arg, "7bit") == 0) flags |= ISO14A_SEQ_SEND_7BIT;
+                else if (strcmp(arg, "norx") == 0) flags |= ISO14A_SEQ_SEND_NORX;
+                else break;
+                arg = strtok_r(NULL, " \t\r", &save_tok);
+            }
+
+            uint8_t data[256] = {0};
+            int dlen = 0;
+            if (arg) {
+                dlen = hex_to_bytes(arg, data, sizeof(data) - 2);
+            }
+            if (dlen < 0 || (send && dlen == 0)) {
+                PrintAndLogEx(ERR, "line %d: bad hex data", line);
+                goto out;
+            }
+
+            SEQ_ROOM(2 + send + dlen);
+            out[n++] = (send) ? ISO14A_SEQ_SEND : ISO14A_SEQ_EXPECT;
+            if (send) {
+                out[n++] = flags;
+            }
+            out[n++] = dlen;
+            memcpy(out + n, data, dlen);
+            n += dlen;
+
+        } else if (strcmp(op, "jmp") == 0 || strcmp(op, "jt") == 0 || strcmp(op, "jf") == 0 || strcmp(op, "djnz") == 0) {
+            if (arg == NULL || strlen(arg) > 16 || nfixups >= ARRAYLEN(fixups)) {
+                PrintAndLogEx(ERR, "line %d: missing label", line);
+                goto out;
+            }
+            SEQ_ROOM(3);
+            out[n++] = (strcmp(op, "jmp") == 0) ? ISO14A_SEQ_JMP :
+                       (strcmp(op, "jt") == 0) ? ISO14A_SEQ_JT :
+                       (strcmp(op, "jf") == 0) ? ISO14A_SEQ_JF : ISO14A_SEQ_DJNZ;
+            strcpy(fixups[nfixups].name, arg);
+            fixups[nfixups].pos = n;
+            fixups[nfixups++].line = line;
+            n += 2;
+
+        } else if (strcmp(op, "set") == 0 || strcmp(op, "end") == 0) {
+            unsigned long v = (arg) ? strtoul(arg, NULL, 0) : 0;
+            if (v > 0xFF) {
+                PrintAndLogEx(ERR, "line %d: value out of range", line);
+                goto out;
+            }
+            SEQ_ROOM(2);
+            out[n++] = (op[0] == 's') ? ISO14A_SEQ_SET : ISO14A_SEQ_END;
+            out[n++] = v;
+
+        } else if (strcmp(op, "wait") == 0) {
+            unsigned long v = (arg) ? strtoul(arg, NULL, 0) : 0;
+            if (v > 0xFFFF) {
+                PrintAndLogEx(ERR, "line %d: wait is max 65535 us", line);
+                goto out;
+            }
+            SEQ_ROOM(3);
+            out[n++] = ISO14A_SEQ_WAIT;
+            out[n++] = v & 0xFF;
+            out[n++] = (v >> 8) & 0xFF;
+
+        } else if (strcmp(op, "log") == 0) {
+            SEQ_ROOM(1);
+            out[n++] = ISO14A_SEQ_LOG;
+
+        } else if (strcmp(op, "off") == 0) {
+            SEQ_ROOM(1);
+            out[n++] = ISO14A_SEQ_OFF;
+
+        } else {
+            PrintAndLogEx(ERR, "line %d: unknown op `%s`", line, op);
+            goto out;
+        }
+    }
+
+    for (int i = 0; i < nfixups; i++) {
+        int l = seq_find_label(labels, nlabels, fixups[i].name);
+        if (l < 0) {
+            PrintAndLogEx(ERR, "line %d: unknown label `%s`", fixups[i].line, fixups[i].name);
+            goto out;
+        }
+        out[fixups[i].pos] = labels[l].addr & 0xFF;
+        out[fixups[i].pos + 1] = (labels[l].addr >> 8) & 0xFF;
+    }
+    res = n;
+
+#undef SEQ_ROOM
+
+out:
+    free(text);
+    return res;
+}
+
+static int CmdHF14ASequence(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf 14a seq",
+                  "Run a sequence of exchanges on the device, without a round trip per frame.\n"
+                  "Statements are separated by `;` or new lines, `#` starts a comment\n"
+                  "  connect [rats]                 field on + select, condition = selected\n"
+                  "  send [crc] [7bit] [norx] <hex> condition = got an answer\n"
+                  "  expect [<hex>]                 condition = last answer starts with <hex>\n"
+                  "  jmp | jt | jf <label>          jump always / if condition / if not\n"
+                  "  set <n>, djnz <label>          loop counter\n"
+                  "  log                            add the last answer to the output\n"
+                  "  wait <us>, off, end [code]\n"
+                  "  <label>:",
+                  "hf 14a seq -s \"connect; send crc norx 5000; send 7bit 40; expect 0a; jf no; send 43; expect 0a; jf no; end 1; no: end 0\"  -> gen1a backdoor\n"
+                  "hf 14a seq -s \"set 5; again: connect; send crc 3000; log; djnz again\"\n"
+                  "hf 14a seq -f myseq.txt -v");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str0("s", "seq", "<str>", "program text"),
+        arg_str0("f", "file", "<fn>", "program text file"),
+        arg_lit0("v", "verbose", "show the assembled program"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    struct arg_str *seq_arg = arg_get_str(ctx, 1);
+    char *src = NULL;
+    if (seq_arg->count) {
+        src = strdup(seq_arg->sval[0]);
+    }
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool verbose = arg_get_lit(ctx, 3);
+    CLIParserFree(ctx);
+
+    if ((src != NULL) == (fnlen > 0)) {
+        PrintAndLogEx(WARNING, "Use one of --seq or --file");
+        free(src);
+        return PM3_EINVARG;
+    }
+
+    if (fnlen) {
+        size_t bytes_read = 0;
+        uint8_t *data = NULL;
+        if (loadFile_safe(filename, "", (void **)&data, &bytes_read) != PM3_SUCCESS) {
+            return PM3_EFILE;
+        }
+        src = calloc(bytes_read + 1, 1);
+        if (src == NULL) {
+            free(data);
+            return PM3_EMALLOC;
+        }
+        memcpy(src, data, bytes_read);
+        free(data);
+    }
+
+    uint8_t prog[PM3_CMD_DATA_SIZE] = {0};
+    int plen = seq_assemble(src, prog, sizeof(prog));
+    free(src);
+    if (plen <= 0) {
+        PrintAndLogEx(FAILED, "Nothing to run");
+        return PM3_EINVARG;
+    }
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "program ( %d bytes ) %s", plen, sprint_hex_inrow(prog, plen));
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443A_SEQUENCE, prog, plen);
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_ISO14443A_SEQUENCE, &resp, 5000) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    const iso14a_seq_resp_t *r = (const iso14a_seq_resp_t *)resp.data.asBytes;
+
+    uint16_t off = 0;
+    uint16_t i = 0;
+    while (off < MIN(r->loglen, ISO14A_SEQ_LOG_SIZE)) {
+        uint8_t n = r->log[off++];
+        n = MIN(n, ISO14A_SEQ_LOG_SIZE - off);
+        PrintAndLogEx(SUCCESS, "%3u: %s", i++, (n) ? sprint_hex_inrow(r->log + off, n) : "<no answer>");
+        off += n;
+    }
+
+    if (resp.status == PM3_EINVARG) {
+        PrintAndLogEx(FAILED, "Bad op at offset %u", r->pc);
+    } else if (resp.status == PM3_EOPABORTED) {
+        PrintAndLogEx(WARNING, "Stopped after %u steps at offset %u", r->steps, r->pc);
+    }
+
+    PrintAndLogEx(INFO, "end code: " _YELLOW_("%u") "  condition: %u  steps: %u", r->code, r->cond, r->steps);
+    return resp.status;
+}
+
+static int CmdHF14ASession(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf 14a session",
+                  "Keep the field on and the card selected between 14a reader commands.\n"
+                  "While the session runs, a command selecting the card the same way (with / without RATS)\n"
+                  "gets the already selected card back instead of a new activation.\n"
+                  "Any non 14a reader command in between, a failed exchange or the idle timeout ends the selected state.\n"
+                  "Commands running their own selects on the device (hf mf rdbl...) are not affected",
+                  "hf 14a session --start           -> start, 5 s idle timeout\n"
+                  "hf 14a session --start -t 20000  -> start, 20 s idle timeout\n"
+                  "hf 14a session                   -> status\n"
+                  "hf 14a session --stop");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "start", "start a session"),
+        arg_lit0(NULL, "stop", "stop the session and drop the field"),
+        arg_u64_0("t", "timeout", "<ms>", "idle timeout (def 5000 ms)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool start = arg_get_lit(ctx, 1);
+    bool stop = arg_get_lit(ctx, 2);
+    uint32_t timeout = arg_get_u32_def(ctx, 3, ISO14A_SESSION_TIMEOUT);
+    CLIParserFree(ctx);
+
+    if (start && stop) {
+        PrintAndLogEx(WARNING, "Choose one of --start or --stop");
+        return PM3_EINVARG;
     }
-    PrintAndLogEx(SUCCESS, "end: %" PRIu64 " seconds", (msclock() - t1) / 1000);
-    return 1;
+
+    iso14a_session_req_t payload = {
+        .action = (start) ? ISO14A_SESSION_START : (stop) ? ISO14A_SESSION_STOP : ISO14A_SESSION_STATUS,
+        .timeout_ms = timeout,
+    };
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443A_SESSION, (uint8_t *)&payload, sizeof(payload));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_ISO14443A_SESSION, &resp, 1500) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        return resp.status;
+    }
+
+    const iso14a_session_t *s = (const iso14a_session_t *)resp.data.asBytes;
+    if (stop) {
+        PrintAndLogEx(SUCCESS, "session stopped, " _YELLOW_("%u") " activations, " _YELLOW_("%u") " reused", s->selects, s->reused);
+        return PM3_SUCCESS;
+    }
+
+    if (s->active == false) {
+        PrintAndLogEx(INFO, "no session");
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(SUCCESS, "session " _GREEN_("active") ", timeout %u ms, idle %u ms", s->timeout_ms, s->idle_ms);
+    if (s->selected) {
+        PrintAndLogEx(SUCCESS, "selected UID: " _GREEN_("%s"), sprint_hex_inrow(s->card.uid, s->card.uidlen));
+    }
+    PrintAndLogEx(INFO, "activations: %u  reused: %u", s->selects, s->reused);
+    return PM3_SUCCESS;
 }
 
+// reader attack,  most nonce pairs solved in one go
+#define HF14A_SIM_NONCE_BATCH 64
+
 // ## simulate iso14443a tag
 int CmdHF14ASim(const char *Cmd) {
     CLIParserContext *ctx;
@@ -863,8 +1366,23 @@ int CmdHF14ASim(const char *Cmd) {
         if ((flags & FLAG_NR_AR_ATTACK) != FLAG_NR_AR_ATTACK)
             break;
 
-        const nonces_t *data = (nonces_t *)resp.data.asBytes;
-        readerAttack(k_sector, k_sectors_cnt, data[0], setEmulatorMem, verbose);
+        // nonce pairs which came in meanwhile are solved together
+        nonces_t data[HF14A_SIM_NONCE_BATCH];
+        size_t n = 0;
+        bool stopped = false;
+        memcpy(&data[n++], resp.data.asBytes, sizeof(nonces_t));
+        while (n < ARRAYLEN(data) && WaitForResponseTimeout(CMD_HF_MIFARE_SIMULATE, &resp, 10)) {
+            if (resp.status != PM3_SUCCESS) {
+                stopped = true;
+                break;
+            }
+            memcpy(&data[n++], resp.data.asBytes, sizeof(nonces_t));
+        }
+
+        readerAttack(k_sector, k_sectors_cnt, data, n, setEmulatorMem, verbose);
+
+        if (stopped)
+            break;
 
         keypress = kbd_enter_pressed();
     }
@@ -890,13 +1408,17 @@ int CmdHF14ASniff(const char *Cmd) {
     CLIParserInit(&ctx, "hf 14a sniff",
                   "Sniff the communication between Hitag reader and tag.\n"
                   "Use `hf 14a list` to view collected data.",
-                  " hf 14a sniff -c -r"
+                  " hf 14a sniff -c -r\n"
+                  " hf 14a sniff --stream gate    -> stream trace to gate.trace while sniffing\n"
+                  " hf 14a sniff --stream gate --pcapng /tmp/pm3fifo    -> and live to wireshark -k -i /tmp/pm3fifo"
                  );
     void *argtable[] = {
         arg_param_begin,
         arg_lit0("c", "card", "triggered by first data from card"),
         arg_lit0("r", "reader", "triggered by first 7-bit request from reader (REQ, WUP)"),
         arg_lit0("i", "interactive", "Console will not be returned until sniff finishes or is aborted"),
+        arg_str0(NULL, "stream", "<fn>", "Stream trace to file while sniffing, not limited by device memory"),
+        arg_str0(NULL, "pcapng", "<fn>", "With --stream, also write PCAP-NG live to file or fifo (Wireshark)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -912,8 +1434,24 @@ int CmdHF14ASniff(const char *Cmd) {
     }
 
     bool interactive = arg_get_lit(ctx, 3);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int pcaplen = 0;
+    char pcapfn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)pcapfn, FILE_PATH_SIZE, &pcaplen);
     CLIParserFree(ctx);
 
+    if (pcaplen && fnlen == 0) {
+        PrintAndLogEx(FAILED, "--pcapng needs --stream");
+        return PM3_EINVARG;
+    }
+
+    if (fnlen) {
+        return TraceStreamSniff(CMD_HF_ISO14443A_SNIFF, (uint8_t *)&param, sizeof(uint8_t), filename, pcapfn, ISO_14443A);
+    }
+
     clearCommandBuffer();
     SendCommandNG(CMD_HF_ISO14443A_SNIFF, (uint8_t *)&param, sizeof(uint8_t));
 
@@ -1099,8 +1637,11 @@ int SelectCard14443A_4(bool disconnect, bool verbose, iso14a_card_select_t *card
     return SelectCard14443A_4_WithParameters(disconnect, verbose, card, NULL);
 }
 
-static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen, bool activateField, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, bool *chainingout) {
+// pendingin: the device is already sending the rest of a chained response, only wait for it.
+// pendingout: more of the response will arrive without us sending anything.
+static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen, bool activateField, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, bool *chainingout, bool pendingin, bool *pendingout, uint16_t flags) {
     *chainingout = false;
+    *pendingout = false;
 
     size_t timeout = 1500;
     if (activateField) {
@@ -1146,11 +1687,16 @@ static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen
     if (chainingin)
         cmdc = ISO14A_SEND_CHAINING;
 
+    // let the device collect chained response blocks, older firmware ignores the flag
+    cmdc |= ISO14A_CHAIN_RESPONSE | flags;
+
     // "Command APDU" length should be 5+255+1, but javacard's APDU buffer might be smaller - 133 bytes
     // https://stackoverflow.com/questions/32994936/safe-max-java-card-apdu-data-command-and-respond-size
     // here length PM3_CMD_DATA_SIZE=512
     // timeout must be authomatically set by "get ATS"
-    if (datain)
+    if (pendingin) {
+        // nothing to send
+    } else if (datain)
         SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_APDU | ISO14A_NO_DISCONNECT | cmdc, (datainlen & 0x1FF), 0, datain, datainlen & 0x1FF);
     else
         SendCommandMIX(CMD_HF_ISO14443A_READER, ISO14A_APDU | ISO14A_NO_DISCONNECT | cmdc, 0, 0, NULL, 0);
@@ -1162,6 +1708,19 @@ static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen
         int iLen = resp.oldarg[0];
         uint8_t res = resp.oldarg[1];
 
+        // part of a chained response collected by the device, no CRC
+        if (resp.oldarg[2] == ISO14A_APDU_CHAINED_PART) {
+            *dataoutlen += iLen;
+            if (maxdataoutlen && *dataoutlen > maxdataoutlen) {
+                PrintAndLogEx(DEBUG, "ERR: APDU: Buffer too small(%d), needs %d bytes", *dataoutlen, maxdataoutlen);
+                return PM3_EAPDU_FAIL;
+            }
+            memcpy(dataout, recv, iLen);
+            *chainingout = true;
+            *pendingout = true;
+            return PM3_SUCCESS;
+        }
+
         int dlen = iLen - 2;
         if (dlen < 0)
             dlen = 0;
@@ -1217,8 +1776,14 @@ static int CmdExchangeAPDU(bool chainingin, const uint8_t *datain, int datainlen
 }
 
 int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen) {
+    return ExchangeAPDU14aEx(datain, datainlen, activateField, leaveSignalON, dataout, maxdataoutlen, dataoutlen, 0);
+}
+
+// flags are extra ISO14A_* reader flags for the first exchange, e.g. ISO14A_DESFIRE_AF
+int ExchangeAPDU14aEx(const uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen, uint16_t flags) {
     *dataoutlen = 0;
     bool chaining = false;
+    bool pending = false;
     int res;
 
     // 3 byte here - 1b framing header, 2b crc16
@@ -1234,7 +1799,7 @@ int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bo
             bool chainBlockNotLast = ((clen + vlen) < datainlen);
 
             *dataoutlen = 0;
-            res = CmdExchangeAPDU(chainBlockNotLast, &datain[clen], vlen, vActivateField, dataout, maxdataoutlen, dataoutlen, &chaining);
+            res = CmdExchangeAPDU(chainBlockNotLast, &datain[clen], vlen, vActivateField, dataout, maxdataoutlen, dataoutlen, &chaining, false, &pending, 0);
             if (res != PM3_SUCCESS) {
                 if (leaveSignalON == false)
                     DropField();
@@ -1262,7 +1827,7 @@ int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bo
         } while (clen < datainlen);
 
     } else {
-        res = CmdExchangeAPDU(false, datain, datainlen, activateField, dataout, maxdataoutlen, dataoutlen, &chaining);
+        res = CmdExchangeAPDU(false, datain, datainlen, activateField, dataout, maxdataoutlen, dataoutlen, &chaining, false, &pending, flags);
         if (res != PM3_SUCCESS) {
             if (leaveSignalON == false) {
                 DropField();
@@ -1272,8 +1837,8 @@ int ExchangeAPDU14a(const uint8_t *datain, int datainlen, bool activateField, bo
     }
 
     while (chaining) {
-        // I-block with chaining
-        res = CmdExchangeAPDU(false, NULL, 0, false, &dataout[*dataoutlen], maxdataoutlen, dataoutlen, &chaining);
+        // I-block with chaining, either the device fetches the blocks itself or we ACK each one
+        res = CmdExchangeAPDU(false, NULL, 0, false, &dataout[*dataoutlen], maxdataoutlen, dataoutlen, &chaining, pending, &pending, 0);
         if (res != PM3_SUCCESS) {
             if (leaveSignalON == false) {
                 DropField();
@@ -2476,6 +3041,9 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
                     }
 
                     json_t *data = AIDSearchGetElm(root, elmindx);
+                    if (data == NULL || AIDIsFirstEntry(data) == false)
+                        continue;
+
                     uint8_t vaid[200] = {0};
                     int vaidlen = 0;
                     if (!AIDGetFromElm(data, vaid, sizeof(vaid), &vaidlen) || !vaidlen)
@@ -2486,6 +3054,11 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
                     size_t resultlen = 0;
                     int res = Iso7816Select(CC_CONTACTLESS, ActivateField, true, vaid, vaidlen, result, sizeof(result), &resultlen, &sw);
                     ActivateField = false;
+
+                    // card gone,  or no SELECT by name at all.  No point in trying the rest of the list
+                    if (res < 0 || sw == ISO7816_INS_NOT_SUPPORTED || sw == ISO7816_CLA_NOT_SUPPORTED)
+                        break;
+
                     if (res)
                         continue;
 
@@ -2572,22 +3145,23 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
     }
 
     if (isMifareClassic || isMifareMini) {
-        int res = detect_classic_static_nonce();
-        if (res == NONCE_STATIC) {
+        mfc_caps_t caps;
+        detect_classic_caps(&caps);
+
+        if (caps.nonce == NONCE_STATIC) {
             PrintAndLogEx(SUCCESS, "Static nonce......... " _YELLOW_("yes"));
         }
 
-        if (res == NONCE_FAIL && verbose) {
+        if (caps.nonce == NONCE_FAIL && verbose) {
             PrintAndLogEx(SUCCESS, "Static nonce......... " _RED_("read failed"));
         }
 
-        if (res == NONCE_NORMAL) {
+        if (caps.nonce == NONCE_NORMAL) {
 
             // not static
-            res = detect_classic_prng();
-            if (res == 1) {
+            if (caps.caps & MFC_CAPS_PRNG_WEAK) {
                 PrintAndLogEx(SUCCESS, "Prng detection....... " _GREEN_("weak"));
-            } else if (res == 0) {
+            } else if (caps.caps & MFC_CAPS_PRNG_HARD) {
                 PrintAndLogEx(SUCCESS, "Prng detection....... " _YELLOW_("hard"));
             } else {
                 PrintAndLogEx(FAILED, "Prng detection........ " _RED_("fail"));
@@ -2598,10 +3172,8 @@ int infoHF14A(bool verbose, bool do_nack_test, bool do_aid_search) {
             }
         }
 
-        uint8_t signature[32] = {0};
-        res = read_mfc_ev1_signature(signature);
-        if (res == PM3_SUCCESS) {
-            mfc_ev1_print_signature(card.uid, card.uidlen, signature, sizeof(signature));
+        if (caps.caps & MFC_CAPS_SIGNATURE) {
+            mfc_ev1_print_signature(card.uid, card.uidlen, caps.signature, sizeof(caps.signature));
         }
     }
 
@@ -2766,6 +3338,193 @@ static uint32_t inc_sw_error_occurrence(uint16_t sw, uint32_t *all_sw) {
     return all_sw[(sw1 * 256) + sw2];
 }
 
+// most used CLA first,  then the rest in order
+static const uint8_t apdufind_cla_priority[] = { 0x00, 0x80, 0x90, 0x84, 0x94, 0xA0, 0x0C, 0x04, 0x8C, 0xB0, 0xC0, 0xD0, 0xE0, 0xF0 };
+
+static uint16_t apdufind_cla_order(uint8_t start, bool priority, uint8_t *order) {
+    uint16_t n = 0;
+    bool used[256] = {false};
+    if (priority) {
+        for (uint8_t i = 0; i < ARRAYLEN(apdufind_cla_priority); i++) {
+            order[n++] = apdufind_cla_priority[i];
+            used[apdufind_cla_priority[i]] = true;
+        }
+    }
+    for (uint16_t i = 0; i < 256; i++) {
+        uint8_t c = (uint8_t)(start + i);
+        if (used[c] == false) {
+            order[n++] = c;
+        }
+    }
+    return n;
+}
+
+// INS sweeps run on the device.  INS answered 6D00 are dropped for the rest of the CLA,
+// a CLA answering only 6E00 is dropped after its first sweep.
+static int apdufind_device(uint8_t cla_start, uint8_t ins_start, uint8_t p1_start, uint8_t p2_start,
+                           const uint8_t *ignore_ins, int ignore_ins_len, bool with_le, bool priority,
+                           uint32_t error_limit, uint64_t reset_time, bool verbose) {
+
+    uint8_t clas[256];
+    uint16_t cla_cnt = apdufind_cla_order(cla_start, priority, clas);
+
+    uint32_t (*all_sw)[256] = calloc(256, sizeof(*all_sw));
+    if (all_sw == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    uint8_t skip_user[32] = {0};
+    for (int i = 0; i < ignore_ins_len; i++) {
+        skip_user[ignore_ins[i] >> 3] |= (1 << (ignore_ins[i] & 7));
+    }
+
+    int res = PM3_SUCCESS;
+    uint8_t flags = ISO14A_SWEEP_CONNECT;
+    uint64_t sent = 0, pruned_cla = 0;
+    uint64_t t_start = msclock();
+    uint64_t t_last_reset = msclock();
+
+    for (uint16_t ci = 0; ci < cla_cnt; ci++) {
+
+        uint8_t cla = clas[ci];
+        uint8_t p1 = p1_start, p2 = p2_start;
+        bool inc_p1 = false;
+        bool first = true;
+
+        iso14a_sweep_req_t req = {0};
+        memcpy(req.skip, skip_user, sizeof(req.skip));
+
+        PrintAndLogEx(INFO, "Status: [ CLA " _GREEN_("%02X") " INS " _GREEN_("%02X") " P1 " _GREEN_("%02X") " P2 " _GREEN_("%02X") " ]", cla, ins_start, p1, p2);
+
+        do {
+            uint16_t done = 0;
+            uint32_t cla_unsupported = 0, cla_sent = 0;
+
+            while (done < 256) {
+
+                if (kbd_enter_pressed()) {
+                    PrintAndLogEx(INFO, "User interrupted detected. Aborting");
+                    goto out;
+                }
+
+                req.flags = flags | (with_le ? ISO14A_SWEEP_WITH_LE : 0);
+                req.cla = cla;
+                req.p1 = p1;
+                req.p2 = p2;
+                req.ins = ins_start + done;
+                req.count = 256 - done;
+
+                clearCommandBuffer();
+                SendCommandNG(CMD_HF_ISO14443A_APDU_SWEEP, (uint8_t *)&req, sizeof(req));
+                PacketResponseNG resp;
+                if (WaitForResponseTimeout(CMD_HF_ISO14443A_APDU_SWEEP, &resp, 20000) == false) {
+                    PrintAndLogEx(WARNING, "command execution time out");
+                    res = PM3_ETIMEOUT;
+                    goto out;
+                }
+
+                if (resp.status != PM3_SUCCESS) {
+                    PrintAndLogEx(FAILED, "Tag stopped answering ( %d ). Aborting...", resp.status);
+                    res = resp.status;
+                    goto out;
+                }
+                flags = 0;
+
+                const iso14a_sweep_resp_t *sr = (const iso14a_sweep_resp_t *)resp.data.asBytes;
+                sent += sr->sent;
+                cla_sent += sr->sent;
+                cla_unsupported += sr->cla_unsupported;
+                if (sr->reselects && verbose) {
+                    PrintAndLogEx(INFO, "Tag was activated again %u time(s)", sr->reselects);
+                }
+
+                // INS not supported does not depend on P1 / P2
+                for (uint8_t i = 0; i < sizeof(req.skip); i++) {
+                    req.skip[i] |= sr->unsupported[i];
+                }
+
+                for (uint8_t i = 0; i < MIN(sr->count, ISO14A_SWEEP_MAX_HITS); i++) {
+                    const iso14a_sweep_hit_t *hit = &sr->hits[i];
+                    uint8_t command[5] = {cla, hit->ins, p1, p2, 0x00};
+
+                    if (inc_sw_error_occurrence(hit->sw, all_sw[0]) >= error_limit) {
+                        continue;
+                    }
+
+                    logLevel_t log_level = (hit->sw == ISO7816_OK) ? SUCCESS : INFO;
+                    PrintAndLogEx(log_level, "Got response for APDU \"%s\": %04X (%s)",
+                                  sprint_hex_inrow(command, 4 + hit->le),
+                                  hit->sw,
+                                  GetAPDUCodeDescription(hit->sw >> 8, hit->sw & 0xff)
+                                 );
+                    if (hit->datalen) {
+                        PrintAndLogEx(SUCCESS, "Response data is: %s%s | %s",
+                                      sprint_hex_inrow(hit->data, MIN(hit->datalen, ISO14A_SWEEP_DATA)),
+                                      (hit->datalen > ISO14A_SWEEP_DATA) ? "..." : "",
+                                      sprint_ascii(hit->data, MIN(hit->datalen, ISO14A_SWEEP_DATA))
+                                     );
+                    }
+                }
+
+                if (sr->tested == 0) {
+                    break;
+                }
+                done += sr->tested;
+            }
+
+            // nothing but 6E00,  the CLA is not supported at all
+            if (first && cla_sent && cla_unsupported == cla_sent) {
+                if (verbose) {
+                    PrintAndLogEx(INFO, "CLA %02X not supported, skipping", cla);
+                }
+                pruned_cla++;
+                break;
+            }
+            first = false;
+
+            // every INS pruned
+            bool all = true;
+            for (uint8_t i = 0; i < sizeof(req.skip); i++) {
+                if (req.skip[i] != 0xFF) {
+                    all = false;
+                    break;
+                }
+            }
+            if (all) {
+                break;
+            }
+
+            // Increment P1/P2 in an alternating fashion.
+            if (inc_p1) {
+                p1++;
+            } else {
+                p2++;
+            }
+            inc_p1 = !inc_p1;
+
+            uint64_t t_since_last_reset = ((msclock() - t_last_reset) / 1000);
+            if (t_since_last_reset > reset_time) {
+                flags = ISO14A_SWEEP_CONNECT;
+                t_last_reset = msclock();
+                PrintAndLogEx(INFO, "Last reset was %" PRIu64 " seconds ago. Resetting the tag to prevent timeout issues", t_since_last_reset);
+            }
+
+            if (verbose) {
+                PrintAndLogEx(INFO, "Status: [ CLA " _GREEN_("%02X") " P1 " _GREEN_("%02X") " P2 " _GREEN_("%02X") " ]", cla, p1, p2);
+            }
+
+        } while (p1 != p1_start || p2 != p2_start);
+    }
+
+out:
+    PrintAndLogEx(SUCCESS, "Sent " _YELLOW_("%" PRIu64) " APDUs, " _YELLOW_("%" PRIu64) " CLA pruned", sent, pruned_cla);
+    PrintAndLogEx(SUCCESS, "Runtime: %" PRIu64 " seconds\n", (msclock() - t_start) / 1000);
+    free(all_sw);
+    DropField();
+    return res;
+}
+
 static int CmdHf14AFindapdu(const char *Cmd) {
     // TODO: Option to select AID/File (and skip INS 0xA4).
     // TODO: Check all instructions with extended APDUs if the card support it.
@@ -2775,10 +3534,14 @@ static int CmdHf14AFindapdu(const char *Cmd) {
                   "Enumerate APDU's of ISO7816 protocol to find valid CLS/INS/P1/P2 commands.\n"
                   "It loops all 256 possible values for each byte.\n"
                   "The loop oder is INS -> P1/P2 (alternating) -> CLA.\n"
+                  "With --device the INS loop runs on the device. INS answering 6D00 are not tested again\n"
+                  "for that CLA and a CLA answering only 6E00 is skipped after its first INS loop.\n"
+                  "--priority tests the most used CLA values first.\n"
                   "Tag must be on antenna before running.",
                   "hf 14a apdufind\n"
                   "hf 14a apdufind --cla 80\n"
                   "hf 14a apdufind --cla 80 --error-limit 20 --skip-ins a4 --skip-ins b0 --with-le\n"
+                  "hf 14a apdufind --device --priority --with-le\n"
                  );
 
     void *argtable[] = {
@@ -2792,6 +3555,8 @@ static int CmdHf14AFindapdu(const char *Cmd) {
         arg_strx0("s", "skip-ins",      "<hex>",    "Do not test an instruction (can be specified multiple times)"),
         arg_lit0("l",  "with-le",                   "Search  for APDUs with Le=0 (case 2S) as well"),
         arg_lit0("v",  "verbose",                   "Verbose output"),
+        arg_lit0("d",  "device",                    "Run the INS loop on the device, prune unsupported INS / CLA"),
+        arg_lit0(NULL, "priority",                  "Test the most used CLA values first (with --device)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -2821,6 +3586,8 @@ static int CmdHf14AFindapdu(const char *Cmd) {
 
     bool with_le = arg_get_lit(ctx, 8);
     bool verbose = arg_get_lit(ctx, 9);
+    bool on_device = arg_get_lit(ctx, 10);
+    bool priority = arg_get_lit(ctx, 11);
 
     CLIParserFree(ctx);
 
@@ -2849,6 +3616,11 @@ static int CmdHf14AFindapdu(const char *Cmd) {
     PrintAndLogEx(NORMAL, "");
     PrintAndLogEx(SUCCESS, "Starting the APDU finder [ CLA " _GREEN_("%02X") " INS " _GREEN_("%02X") " P1 " _GREEN_("%02X") " P2 " _GREEN_("%02X") " ]", cla, ins, p1, p2);
 
+    if (on_device) {
+        DropField();
+        return apdufind_device(cla, ins, p1, p2, ignore_ins_arg, ignore_ins_len, with_le, priority, error_limit, reset_time, verbose);
+    }
+
     bool inc_p1 = false;
     bool skip_ins = false;
     uint32_t all_sw[256][256] = { { 0 } };
@@ -3610,11 +4382,14 @@ static command_t CommandTable[] = {
     {"antifuzz",    CmdHF14AAntiFuzz,     IfPm3Iso14443a,  "Fuzzing the anticollision phase.  Warning! Readers may react strange"},
     {"config",      CmdHf14AConfig,       IfPm3Iso14443a,  "Configure 14a settings (use with caution)"},
     {"cuids",       CmdHF14ACUIDs,        IfPm3Iso14443a,  "Collect n>0 ISO14443-a UIDs in one go"},
+    {"enum",        CmdHF14AEnum,         IfPm3Iso14443a,  "Enumerate all ISO14443-a tags in the field"},
     {"info",        CmdHF14AInfo,         IfPm3Iso14443a,  "Tag information"},
     {"sim",         CmdHF14ASim,          IfPm3Iso14443a,  "Simulate ISO 14443-a tag"},
     {"sniff",       CmdHF14ASniff,        IfPm3Iso14443a,  "sniff ISO 14443-a traffic"},
     {"raw",         CmdHF14ACmdRaw,       IfPm3Iso14443a,  "Send raw hex data to tag"},
     {"reader",      CmdHF14AReader,       IfPm3Iso14443a,  "Act like an ISO14443-a reader"},
+    {"session",     CmdHF14ASession,      IfPm3Iso14443a,  "Keep the card selected between 14a reader commands"},
+    {"seq",         CmdHF14ASequence,     IfPm3Iso14443a,  "Run a sequence of exchanges on the device"},
     {"-----------", CmdHelp,              IfPm3Iso14443a,  "------------------------- " _CYAN_("APDU") " -------------------------"},
     {"apdu",        CmdHF14AAPDU,         IfPm3Iso14443a,  "Send ISO 14443-4 APDU to tag"},
     {"apdufind",    CmdHf14AFindapdu,     IfPm3Iso14443a,  "Enumerate APDUs - CLA/INS/P1P2"},
@@ -319,6 +319,24 @@ static bool wait_cmd_14b(bool verbose, bool is_select, uint32_t timeout) {
     return true;
 }
 
+// one device call,  the first of std / SR / picopass / CT that answers
+static int discover_14b(iso14b_discover_t *d) {
+    memset(d, 0, sizeof(iso14b_discover_t));
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_ISO14443B_DISCOVER, NULL, 0);
+    if (WaitForResponseTimeout(CMD_HF_ISO14443B_DISCOVER, &resp, TIMEOUT) == false) {
+        PrintAndLogEx(WARNING, "timeout while waiting for reply");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status == PM3_SUCCESS) {
+        memcpy(d, resp.data.asBytes, MIN(resp.length, sizeof(iso14b_discover_t)));
+    }
+    return resp.status;
+}
+
 static bool get_14b_UID(uint8_t *d, iso14b_type_t *found_type) {
 
     // sanity checks
@@ -328,59 +346,26 @@ static bool get_14b_UID(uint8_t *d, iso14b_type_t *found_type) {
 
     *found_type = ISO14B_NONE;
 
-    iso14b_raw_cmd_t packet = {
-        .flags = (ISO14B_CONNECT | ISO14B_SELECT_SR | ISO14B_DISCONNECT),
-        .timeout = 0,
-        .rawlen = 0,
-    };
-
-    PacketResponseNG resp;
-    clearCommandBuffer();
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT)) {
-
-        if (resp.status == PM3_SUCCESS) {
-            memcpy(d, resp.data.asBytes, sizeof(iso14b_card_select_t));
-
-            iso14b_card_select_t *card = (iso14b_card_select_t *)d;
-            uint8_t empty[] =  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-            if (memcmp(card->uid, empty, card->uidlen) == 0) {
-                return false;
-            }
-            *found_type = ISO14B_SR;
-            return true;
-        }
-    }
-
-    // test 14b standard
-    packet.flags = (ISO14B_CONNECT | ISO14B_SELECT_STD | ISO14B_DISCONNECT);
-
-    clearCommandBuffer();
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT)) {
-
-        if (resp.status == PM3_SUCCESS) {
-            memcpy(d, resp.data.asBytes, sizeof(iso14b_card_select_t));
-            *found_type = ISO14B_STANDARD;
-            return true;
-        }
+    iso14b_discover_t disc;
+    if (discover_14b(&disc) != PM3_SUCCESS) {
+        return false;
     }
 
-    // test CT
-    packet.flags = (ISO14B_CONNECT | ISO14B_SELECT_CTS | ISO14B_DISCONNECT);
-    clearCommandBuffer();
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT)) {
-
-        if (resp.status == PM3_SUCCESS) {
-            memcpy(d, resp.data.asBytes, sizeof(iso14b_cts_card_select_t));
-            *found_type = ISO14B_CT;
-            return true;
-        }
+    switch (disc.type) {
+        case ISO14B_STANDARD:
+        case ISO14B_SR:
+            memcpy(d, &disc.card.std, sizeof(iso14b_card_select_t));
+            break;
+        case ISO14B_CT:
+            memcpy(d, &disc.card.cts, sizeof(iso14b_cts_card_select_t));
+            break;
+        default:
+            // picopass over 14b isn't a tag type the callers handle
+            return false;
     }
 
-    PrintAndLogEx(WARNING, "timeout while waiting for reply");
-    return false;
+    *found_type = disc.type;
+    return true;
 }
 
 /* extract uid from filename
@@ -1224,6 +1209,26 @@ static int read_sr_block(uint8_t blockno, uint8_t *out) {
     return resp.status;
 }
 
+// `count` blocks from `start` in one device call,  out gets count * 4 bytes
+static int read_sr_blocks(uint8_t start, uint8_t count, uint8_t *out) {
+    iso14b_sr_dump_req_t payload = {
+        .start = start,
+        .count = count,
+    };
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_SRI_DUMP, (uint8_t *)&payload, sizeof(payload));
+    if (WaitForResponseTimeout(CMD_HF_SRI_DUMP, &resp, TIMEOUT + (count * 20)) == false) {
+        return PM3_ETIMEOUT;
+    }
+
+    if (out) {
+        memcpy(out, resp.data.asBytes, MIN(resp.length, count * ST25TB_SR_BLOCK_SIZE));
+    }
+    return resp.status;
+}
+
 static int write_sr_block(uint8_t blockno, uint8_t datalen, uint8_t *data) {
 
     uint8_t psize = sizeof(iso14b_raw_cmd_t) + datalen + 2;
@@ -1255,186 +1260,33 @@ static int write_sr_block(uint8_t blockno, uint8_t datalen, uint8_t *data) {
     return PM3_SUCCESS;
 }
 
-static bool HF14B_st_reader(bool verbose) {
-
-    iso14b_raw_cmd_t packet = {
-        .flags = (ISO14B_CONNECT | ISO14B_SELECT_SR | ISO14B_DISCONNECT),
-        .timeout = 0,
-        .rawlen = 0,
-    };
-
-    // SRx get and print general info about SRx chip from UID
-    clearCommandBuffer();
-    PacketResponseNG resp;
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT) == false) {
-        if (verbose) {
-            PrintAndLogEx(WARNING, "timeout while waiting for reply");
-        }
-        return false;
-    }
-
-    switch (resp.status) {
-        case PM3_SUCCESS: {
-            iso14b_card_select_t card;
-            memcpy(&card, (iso14b_card_select_t *)resp.data.asBytes, sizeof(iso14b_card_select_t));
-
-            uint8_t empty[] =  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-            if ((card.uidlen != 8) || (memcmp(card.uid, empty, card.uidlen) == 0)) {
-                return false;
-            }
-            print_st_general_info(card.uid, card.uidlen);
-            return true;
-        }
-        case PM3_ELENGTH:
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 ST ATTRIB fail");
-            break;
-        case PM3_ECRC:
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 ST CRC fail");
-            break;
-        case PM3_EWRONGANSWER:
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 ST random chip id fail");
-            break;
-        default:
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-b ST select SRx failed");
-            break;
-    }
-    return false;
-}
-
-static bool HF14B_std_reader(bool verbose) {
-    iso14b_raw_cmd_t packet = {
-        .flags = (ISO14B_CONNECT | ISO14B_SELECT_STD | ISO14B_DISCONNECT),
-        .timeout = 0,
-        .rawlen = 0,
-    };
-
-    // 14b get and print UID only (general info)
-    clearCommandBuffer();
-    PacketResponseNG resp;
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT) == false) {
-        if (verbose) {
-            PrintAndLogEx(WARNING, "timeout while waiting for reply");
-        }
-        return false;
-    }
-
-    switch (resp.status) {
-        case PM3_SUCCESS: {
-            iso14b_card_select_t card;
-            memcpy(&card, (iso14b_card_select_t *)resp.data.asBytes, sizeof(iso14b_card_select_t));
-
-            uint8_t empty[] =  {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-            if (memcmp(card.uid, empty, card.uidlen) == 0) {
-                return false;
-            }
+static void print_14b_discover(const iso14b_discover_t *d) {
+    switch (d->type) {
+        case ISO14B_STANDARD: {
+            const iso14b_card_select_t *card = &d->card.std;
             PrintAndLogEx(NORMAL, "");
-            PrintAndLogEx(SUCCESS, " UID    : " _GREEN_("%s"), sprint_hex(card.uid, card.uidlen));
-            PrintAndLogEx(SUCCESS, " ATQB   : %s", sprint_hex(card.atqb, sizeof(card.atqb)));
-            PrintAndLogEx(SUCCESS, " CHIPID : %02X", card.chipid);
-            print_atqb_resp(card.atqb, card.cid);
-            return true;
-        }
-        case PM3_ELENGTH: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 ATTRIB fail");
-            break;
-        }
-        case PM3_ECRC: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 CRC fail");
+            PrintAndLogEx(SUCCESS, " UID    : " _GREEN_("%s"), sprint_hex(card->uid, card->uidlen));
+            PrintAndLogEx(SUCCESS, " ATQB   : %s", sprint_hex(card->atqb, sizeof(card->atqb)));
+            PrintAndLogEx(SUCCESS, " CHIPID : %02X", card->chipid);
+            print_atqb_resp((uint8_t *)card->atqb, card->cid);
             break;
         }
-        default: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-b card select failed");
+        case ISO14B_SR: {
+            print_st_general_info((uint8_t *)d->card.std.uid, d->card.std.uidlen);
             break;
         }
-    }
-    return false;
-}
-
-static bool HF14B_ask_ct_reader(bool verbose) {
-
-    iso14b_raw_cmd_t packet = {
-        .flags = (ISO14B_CONNECT | ISO14B_SELECT_CTS | ISO14B_DISCONNECT),
-        .timeout = 0,
-        .rawlen = 0,
-    };
-
-    // 14b get and print UID only (general info)
-    clearCommandBuffer();
-    PacketResponseNG resp;
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT) == false) {
-        if (verbose) PrintAndLogEx(WARNING, "timeout while waiting for reply");
-        return false;
-    }
-
-    switch (resp.status) {
-        case PM3_SUCCESS: {
-            print_ct_general_info(resp.data.asBytes);
-            return true;
-        }
-        case PM3_ELENGTH: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 CTS wrong length");
-            break;
-        }
-        case PM3_ECRC: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 CTS CRC fail");
-            break;
-        }
-        default: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-b CTS select failed");
-            break;
-        }
-    }
-    return false;
-}
-
-static bool HF14B_picopass_reader(bool verbose) {
-
-    iso14b_raw_cmd_t packet = {
-        .flags = (ISO14B_CONNECT | ISO14B_SELECT_PICOPASS | ISO14B_DISCONNECT),
-        .timeout = 0,
-        .rawlen = 0,
-    };
-
-    // 14b get and print UID only (general info)
-    clearCommandBuffer();
-    PacketResponseNG resp;
-    SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)&packet, sizeof(iso14b_raw_cmd_t));
-    if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, TIMEOUT) == false) {
-        if (verbose) PrintAndLogEx(WARNING, "timeout while waiting for reply");
-        return false;
-    }
-
-    switch (resp.status) {
-        case PM3_SUCCESS: {
-
-            picopass_hdr_t *card = calloc(1, sizeof(picopass_hdr_t));
-            if (card == NULL) {
-                PrintAndLogEx(FAILED, "failed to allocate memory");
-                return false;
-            }
-            memcpy(card, resp.data.asBytes, sizeof(picopass_hdr_t));
+        case ISO14B_PICOPASS: {
             PrintAndLogEx(NORMAL, "");
-            PrintAndLogEx(SUCCESS, "iCLASS / Picopass CSN: " _GREEN_("%s"), sprint_hex(card->csn, sizeof(card->csn)));
-            free(card);
-            return true;
-        }
-        case PM3_ELENGTH: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 wrong length");
+            PrintAndLogEx(SUCCESS, "iCLASS / Picopass CSN: " _GREEN_("%s"), sprint_hex(d->card.csn, sizeof(d->card.csn)));
             break;
         }
-        case PM3_ECRC: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-3 CRC fail");
+        case ISO14B_CT: {
+            print_ct_general_info((void *)&d->card.cts);
             break;
         }
-        default: {
-            if (verbose) PrintAndLogEx(FAILED, "ISO 14443-b Picopass select failed");
+        default:
             break;
-        }
     }
-    return false;
 }
 
 // test for other 14b type tags (mimic another reader - don't have tags to identify)
@@ -1767,88 +1619,19 @@ static int CmdHF14BDump(const char *Cmd) {
         uint8_t chipid = get_st_chipid(card.uid);
         PrintAndLogEx(SUCCESS, "found a " _GREEN_("%s") " tag", get_st_chip_model(chipid));
 
-        // detect blocksize from card :)
         PrintAndLogEx(INFO, "reading tag memory");
 
-        iso14b_raw_cmd_t *packet = (iso14b_raw_cmd_t *)calloc(1, sizeof(iso14b_raw_cmd_t) + 2);
-        if (packet == NULL) {
-            PrintAndLogEx(FAILED, "failed to allocate memory");
-            return PM3_EMALLOC;
-        }
-        packet->flags = (ISO14B_CONNECT | ISO14B_SELECT_SR);
-        packet->timeout = 0;
-        packet->rawlen = 0;
-
-        clearCommandBuffer();
-        SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)packet, sizeof(iso14b_raw_cmd_t));
-        PacketResponseNG resp;
-
-        // select SR tag
-        if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, 2000)) {
-            if (resp.status != PM3_SUCCESS) {
-                PrintAndLogEx(FAILED, "failed to select ( " _RED_("%d") " )", resp.status);
-                free(packet);
-                return switch_off_field_14b();
-            }
-        }
-
-        PrintAndLogEx(INFO, "." NOLF);
-
         uint8_t data[cardsize];
         memset(data, 0, sizeof(data));
-        uint16_t blocknum = 0;
-
-        for (int retry = 0; retry < 3; retry++) {
-
-            // set up the read command
-            packet->flags = (ISO14B_APPEND_CRC | ISO14B_RAW);
-            packet->rawlen = 2;
-            packet->raw[0] = ISO14443B_READ_BLK;
-            packet->raw[1] = blocknum & 0xFF;
-
-            clearCommandBuffer();
-            SendCommandNG(CMD_HF_ISO14443B_COMMAND, (uint8_t *)packet, sizeof(iso14b_raw_cmd_t) + 2);
-            if (WaitForResponseTimeout(CMD_HF_ISO14443B_COMMAND, &resp, 2000)) {
-
-                if (resp.status != PM3_SUCCESS) {
-                    PrintAndLogEx(FAILED, "retrying one more time");
-                    continue;
-                }
-
-                uint8_t *recv = resp.data.asBytes;
-
-                if (check_crc(CRC_14443_B, recv, resp.length) == false) {
-                    PrintAndLogEx(FAILED, "crc fail, retrying one more time");
-                    continue;
-                }
-
-                // last read
-                if (blocknum == 0xFF) {
-                    // we reserved space for this block after 0x0F and 0x7F,  ie 0x10, 0x80
-                    memcpy(data + ((lastblock + 1) * ST25TB_SR_BLOCK_SIZE), recv, ST25TB_SR_BLOCK_SIZE);
-                    break;
-                }
-                memcpy(data + (blocknum * ST25TB_SR_BLOCK_SIZE), recv, ST25TB_SR_BLOCK_SIZE);
 
-
-                retry = 0;
-                blocknum++;
-                if (blocknum > lastblock) {
-                    // read config block
-                    blocknum = 0xFF;
-                }
-
-                PrintAndLogEx(NORMAL, "." NOLF);
-                fflush(stdout);
-            }
+        // user blocks in one go,  the system block 0xFF lands in the slot reserved after them
+        int res = read_sr_blocks(0, lastblock + 1, data);
+        if (res == PM3_SUCCESS) {
+            res = read_sr_blocks(0xFF, 1, data + ((lastblock + 1) * ST25TB_SR_BLOCK_SIZE));
         }
-        free(packet);
-
-        PrintAndLogEx(NORMAL, "");
-        switch_off_field_14b();
 
-        if (blocknum != 0xFF) {
-            PrintAndLogEx(FAILED, "dump failed");
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "dump failed ( %d )", res);
             return PM3_ESOFT;
         }
 
@@ -2936,25 +2719,13 @@ int readHF14B(bool loop, bool verbose, bool read_plot) {
     do {
         found = false;
 
-        // try std 14b (atqb)
-        found |= HF14B_std_reader(verbose);
-        if (found)
-            goto plot;
-
-        // try ST Microelectronics 14b
-        found |= HF14B_st_reader(verbose);
-        if (found)
-            goto plot;
-
-        // Picopass
-        found |= HF14B_picopass_reader(verbose);
-        if (found)
-            goto plot;
-
-        // try ASK CT 14b
-        found |= HF14B_ask_ct_reader(verbose);
-        if (found)
+        // std 14b (atqb),  ST Microelectronics,  Picopass and ASK CT in one device pass
+        iso14b_discover_t d;
+        if (discover_14b(&d) == PM3_SUCCESS) {
+            print_14b_discover(&d);
+            found = true;
             goto plot;
+        }
 
         // try unknown 14b read commands (to be identified later)
         // could be read of calypso, CEPAS, moneo, or pico pass.
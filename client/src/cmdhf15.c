@@ -556,6 +556,83 @@ bool readHF15Uid(bool loop, bool verbose) {
     return true;
 }
 
+// 16 slot anticollision on device, lists every tag in the field.
+// Older firmware doesn't answer CMD_HF_ISO15693_INVENTORY, use the single slot getUID() then
+static int hf15_inventory(bool loop) {
+
+    iso15_inventory_req_t req = { .flags = (ISO15_CONNECT | ISO15_NO_DISCONNECT) };
+    iso15_inventory_t prev;
+    memset(&prev, 0, sizeof(prev));
+
+    int res = PM3_ESOFT;
+    do {
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_ISO15693_INVENTORY, (uint8_t *)&req, sizeof(req));
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(CMD_HF_ISO15693_INVENTORY, &resp, 2000) == false) {
+            if (req.flags & ISO15_CONNECT) {
+                DropField();
+                uint8_t uid[HF15_UID_LENGTH] = {0};
+                return getUID(true, loop, uid);
+            }
+            PrintAndLogEx(DEBUG, "iso15693 timeout");
+            res = PM3_ETIMEOUT;
+            break;
+        }
+
+        // keep the field on between rounds
+        req.flags = ISO15_NO_DISCONNECT;
+
+        if (resp.status != PM3_SUCCESS || resp.length != sizeof(iso15_inventory_t)) {
+            continue;
+        }
+
+        iso15_inventory_t *inv = (iso15_inventory_t *)resp.data.asBytes;
+        if (inv->count) {
+            res = PM3_SUCCESS;
+        }
+
+        bool printed = false;
+        for (uint8_t i = 0; i < MIN(inv->count, ISO15_INVENTORY_MAX_TAGS); i++) {
+
+            // in continuous mode only show tags which weren't there last round
+            bool seen = false;
+            for (uint8_t j = 0; loop && j < prev.count; j++) {
+                if (memcmp(prev.uid[j], inv->uid[i], HF15_UID_LENGTH) == 0) {
+                    seen = true;
+                    break;
+                }
+            }
+            if (seen) {
+                continue;
+            }
+
+            if (printed == false) {
+                PrintAndLogEx(NORMAL, "");
+                printed = true;
+            }
+            PrintAndLogEx(SUCCESS, "UID.... " _GREEN_("%s"), iso15693_sprintUID(NULL, inv->uid[i]));
+            PrintAndLogEx(SUCCESS, "TYPE... " _YELLOW_("%s"), getTagInfo_15(inv->uid[i]));
+        }
+
+        if (printed) {
+            if (loop == false && inv->count > 1) {
+                PrintAndLogEx(SUCCESS, "Found " _YELLOW_("%u") " tags", inv->count);
+            }
+            if (inv->truncated) {
+                PrintAndLogEx(WARNING, "More tags in the field than listed");
+            }
+            PrintAndLogEx(NORMAL, "");
+        }
+
+        memcpy(&prev, inv, sizeof(prev));
+
+    } while (loop && kbd_enter_pressed() == false);
+
+    DropField();
+    return res;
+}
+
 // adds 6
 static uint8_t arg_add_default(void *at[]) {
     at[0] = arg_param_begin;
@@ -1131,15 +1208,35 @@ static int CmdHF15Sniff(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf 15 sniff",
                   "Sniff activity without enabling carrier",
-                  "hf 15 sniff\n");
+                  "hf 15 sniff\n"
+                  "hf 15 sniff --stream gate    -> stream trace to gate.trace while sniffing\n"
+                  "hf 15 sniff --stream gate --pcapng /tmp/pm3fifo    -> and live to wireshark -k -i /tmp/pm3fifo\n");
 
     void *argtable[] = {
         arg_param_begin,
+        arg_str0(NULL, "stream", "<fn>", "Stream trace to file while sniffing, not limited by device memory"),
+        arg_str0(NULL, "pcapng", "<fn>", "With --stream, also write PCAP-NG live to file or fifo (Wireshark)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int pcaplen = 0;
+    char pcapfn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)pcapfn, FILE_PATH_SIZE, &pcaplen);
     CLIParserFree(ctx);
 
+    if (pcaplen && fnlen == 0) {
+        PrintAndLogEx(FAILED, "--pcapng needs --stream");
+        return PM3_EINVARG;
+    }
+
+    if (fnlen) {
+        return TraceStreamSniff(CMD_HF_ISO15693_SNIFF, NULL, 0, filename, pcapfn, ISO_15693);
+    }
+
     PacketResponseNG resp;
     clearCommandBuffer();
     SendCommandNG(CMD_HF_ISO15693_SNIFF, NULL, 0);
@@ -1155,7 +1252,8 @@ static int CmdHF15Sniff(const char *Cmd) {
 static int CmdHF15Reader(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf 15 reader",
-                  "Act as a ISO-15693 reader.  Look for ISO-15693 tags until Enter or the pm3 button is pressed\n",
+                  "Act as a ISO-15693 reader.  Look for ISO-15693 tags until Enter or the pm3 button is pressed\n"
+                  "Runs the 16 slot anticollision, all tags in the field are listed\n",
                   "hf 15 reader\n"
                   "hf 15 reader -@   -> Continuous mode");
 
@@ -1171,7 +1269,7 @@ static int CmdHF15Reader(const char *Cmd) {
     if (cm) {
         PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
     }
-    readHF15Uid(cm, true);
+    hf15_inventory(cm);
     return PM3_SUCCESS;
 }
 
@@ -1261,12 +1359,23 @@ static int CmdHF15ELoad(const char *Cmd) {
     PrintAndLogEx(INFO, "Uploading to emulator memory");
     PrintAndLogEx(INFO, "." NOLF);
 
-    // fast push mode
-    g_conn.block_after_ACK = true;
-
     size_t chuncksize = 256;
     size_t offset = 0;
 
+    // bulk upload, falls back to chunks on older firmware
+    res = UploadEmlToDevice((uint8_t *)tag, bytes_read, 0, FPGA_BITSTREAM_HF_15);
+    if (res == PM3_SUCCESS) {
+        offset = bytes_read;
+        bytes_read = 0;
+    } else if (res != PM3_ENOTIMPL) {
+        PrintAndLogEx(FAILED, "Can't set emulator memory");
+        free(tag);
+        return PM3_ESOFT;
+    }
+
+    // fast push mode
+    g_conn.block_after_ACK = true;
+
     while (bytes_read > 0) {
         if (bytes_read <= chuncksize) {
             // Disable fast mode on last packet
@@ -1955,6 +2064,60 @@ static int CmdHF15Dump(const char *Cmd) {
 
     int blocknum = 0;
 
+    // READ MULTIPLE BLOCKS as far as the tag goes along, a reply must fit in one response packet.
+    // Whatever is left (no support, end of memory inside a chunk) goes through READ SINGLE BLOCK below
+    uint8_t hdrlen = (used_uid) ? 10 : 2;
+    iso15_raw_cmd_t *mpacket = (iso15_raw_cmd_t *)calloc(1, sizeof(iso15_raw_cmd_t) + hdrlen + 2 + 2);
+    if (mpacket == NULL) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        free(packet);
+        free(tag);
+        return PM3_EMALLOC;
+    }
+
+    memcpy(mpacket->raw, packet->raw, hdrlen);
+    mpacket->raw[1] = ISO15693_READ_MULTI_BLOCK;
+    mpacket->flags = packet->flags;
+
+    int chunk = MIN(32, (PM3_CMD_DATA_SIZE - 3) / (tag->bytesPerPage + 1));
+
+    while (blocknum < tag->pagesCount) {
+
+        int cnt = MIN(chunk, tag->pagesCount - blocknum);
+        if ((blocknum + cnt) > ISO15693_TAG_MAX_PAGES || ((blocknum + cnt) * tag->bytesPerPage) > ISO15693_TAG_MAX_SIZE) {
+            break;
+        }
+
+        mpacket->raw[hdrlen] = (uint8_t)blocknum & 0xFF;
+        mpacket->raw[hdrlen + 1] = (uint8_t)(cnt - 1);
+        AddCrc15(mpacket->raw, hdrlen + 2);
+        mpacket->rawlen = hdrlen + 2 + 2;
+
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_ISO15693_COMMAND, (uint8_t *)mpacket, ISO15_RAW_LEN(mpacket->rawlen));
+        if (WaitForResponseTimeout(CMD_HF_ISO15693_COMMAND, &resp, 2000) == false) {
+            break;
+        }
+
+        d = resp.data.asBytes;
+
+        // status, lock + data per block, crc
+        if (resp.length != (1 + (cnt * (tag->bytesPerPage + 1)) + 2) || CheckCrc15(d, resp.length) == false || (d[0] & ISO15_RES_ERROR) == ISO15_RES_ERROR) {
+            PrintAndLogEx(DEBUG, "read multiple blocks stopped at block %d", blocknum);
+            break;
+        }
+
+        for (int i = 0; i < cnt; i++) {
+            uint8_t *b = d + 1 + (i * (tag->bytesPerPage + 1));
+            tag->locks[blocknum + i] = b[0];
+            memcpy(&tag->data[(blocknum + i) * tag->bytesPerPage], b + 1, tag->bytesPerPage);
+        }
+
+        blocknum += cnt;
+        PrintAndLogEx(INPLACE, "blk %3d", blocknum);
+    }
+    free(mpacket);
+
     for (int retry = 0; (retry < 2 && blocknum < tag->pagesCount); retry++) {
         if (used_uid) {
             packet->raw[10] = (uint8_t)blocknum & 0xFF;
@@ -51,6 +51,10 @@
 
 #define EMRTD_KMAC_LEN              16
 
+// Largest READ BINARY chunk whose secure messaging response
+// (DO87 + DO99 + DO8E + SW) still fits in a short Le of 256 bytes
+#define EMRTD_READ_CHUNK_SIZE       0xDF
+
 // DESKey Types
 static const uint8_t KENC_type[4] = {0x00, 0x00, 0x00, 0x01};
 static const uint8_t KMAC_type[4] = {0x00, 0x00, 0x00, 0x02};
@@ -483,7 +487,8 @@ static bool emrtd_check_cc(uint8_t *ssc, uint8_t *key, uint8_t *rapdu, int rapdu
     int length2 = 0;
 
     if (*(rapdu) == 0x87) {
-        length += 2 + (*(rapdu + 1));
+        // DO87 uses the long length form once the cryptogram exceeds 127 bytes
+        length += 1 + emrtd_get_asn1_field_length(rapdu, rapdulength, 1) + emrtd_get_asn1_data_length(rapdu, rapdulength, 1);
         memcpy(k + 8, rapdu, length);
         PrintAndLogEx(DEBUG, "len1: %i", length);
     }
@@ -624,9 +629,11 @@ static bool _emrtd_secure_read_binary_decrypt(uint8_t *kenc, uint8_t *kmac, uint
 
     PrintAndLogEx(DEBUG, "secreadbindec, offset %i on read %i: encrypted: %s", offset, bytes_to_read, sprint_hex_inrow(response, resplen));
 
-    cutat = ((int) response[1]) - 1;
+    // skip the DO87 tag, length and padding indicator
+    int fieldlen = emrtd_get_asn1_field_length(response, resplen, 1);
+    cutat = emrtd_get_asn1_data_length(response, resplen, 1) - 1;
 
-    des3_decrypt_cbc(iv, kenc, response + 3, cutat, temp);
+    des3_decrypt_cbc(iv, kenc, response + 2 + fieldlen, cutat, temp);
     memcpy(dataout, temp, bytes_to_read);
     PrintAndLogEx(DEBUG, "secreadbindec, offset %i on read %i: decrypted: %s", offset, bytes_to_read, sprint_hex_inrow(temp, cutat));
     PrintAndLogEx(DEBUG, "secreadbindec, offset %i on read %i: decrypted and cut: %s", offset, bytes_to_read, sprint_hex_inrow(dataout, bytes_to_read));
@@ -660,8 +667,8 @@ static int emrtd_read_file(uint8_t *dataout, size_t *dataoutlen, uint8_t *kenc,
     PrintAndLogEx(INFO, "." NOLF);
     while (readlen > 0) {
         toread = readlen;
-        if (readlen > 118) {
-            toread = 118;
+        if (readlen > EMRTD_READ_CHUNK_SIZE) {
+            toread = EMRTD_READ_CHUNK_SIZE;
         }
 
         if (use_secure) {
@@ -352,23 +352,83 @@ int read_felica_uid(bool loop, bool verbose) {
     return res;
 }
 
+/**
+ * Polls with time slots so several cards in the field answer the same
+ * Polling command, and lists every IDm the device collected.
+ */
+static int read_felica_slots(uint8_t slots, bool verbose) {
+
+    // TSN is the number of slots - 1, card accepts 1, 2, 4, 8 or 16 slots
+    uint8_t tsn = 0;
+    while ((tsn + 1) < slots && tsn < 0x0F) {
+        tsn = (tsn << 1) | 1;
+    }
+
+    felica_poll_req_t payload = {
+        .system_code = 0xFFFF,
+        .request_code = 0x00,
+        .timeslots = tsn,
+    };
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_FELICA_POLL, (uint8_t *)&payload, sizeof(payload));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_FELICA_POLL, &resp, 2500) == false) {
+        if (verbose) PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+        return PM3_ETIMEOUT;
+    }
+
+    const felica_poll_t *r = (const felica_poll_t *)resp.data.asBytes;
+    if (resp.status != PM3_SUCCESS || r->count == 0) {
+        if (verbose) PrintAndLogEx(WARNING, "FeliCa card select failed");
+        return PM3_EOPABORTED;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    for (uint8_t i = 0; i < r->count && i < FELICA_POLL_MAX_CARDS; i++) {
+        PrintAndLogEx(SUCCESS, "IDm: " _GREEN_("%s") "  PMm: %s"
+                      , sprint_hex_inrow(r->cards[i].IDm, sizeof(r->cards[i].IDm))
+                      , sprint_hex_inrow(r->cards[i].PMm, sizeof(r->cards[i].PMm))
+                     );
+    }
+
+    if (r->count == 1) {
+        memset(&last_known_card, 0, sizeof(last_known_card));
+        memcpy(last_known_card.IDm, r->cards[0].IDm, sizeof(last_known_card.IDm));
+        memcpy(last_known_card.PMm, r->cards[0].PMm, sizeof(last_known_card.PMm));
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdHFFelicaReader(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf felica reader",
                   "Act as a ISO 18092 / FeliCa reader. Look for FeliCa tags until Enter or the pm3 button is pressed",
-                  "hf felica reader -@    -> Continuous mode");
+                  "hf felica reader -@          -> Continuous mode\n"
+                  "hf felica reader --slots 16  -> Poll with 16 time slots, list every card in the field");
 
     void *argtable[] = {
         arg_param_begin,
         arg_lit0("s", "silent", "silent (no messages)"),
         arg_lit0("@", NULL, "optional - continuous reader mode"),
+        arg_int0(NULL, "slots", "<1-16>", "poll with time slots, lists all cards answering"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     bool verbose = (arg_get_lit(ctx, 1) == false);
     bool cm = arg_get_lit(ctx, 2);
+    int slots = arg_get_int_def(ctx, 3, 0);
     CLIParserFree(ctx);
 
+    if (slots < 0 || slots > 16) {
+        PrintAndLogEx(WARNING, "slots must be between 1 and 16");
+        return PM3_EINVARG;
+    }
+
+    if (slots) {
+        return read_felica_slots(slots, verbose);
+    }
+
     if (cm) {
         PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
     }
@@ -1123,6 +1183,73 @@ static int CmdHFFelicaWritePlain(const char *Cmd) {
  * @param Cmd input data of the user.
  * @return client result code.
  */
+/**
+ * Reads blocks `first`..`last` of one service with the device batching
+ * several block list elements per Read Without Encryption command.
+ * Stops at the first block the card refuses, which is the end of the service.
+ * @return PM3_ETIMEOUT if the firmware doesn't know the command.
+ */
+static int felica_read_blocks_device(uint16_t service, uint16_t first, uint16_t last) {
+
+    felica_read_blocks_req_t payload = {
+        .service = service,
+        .block = first,
+        .count = 0,
+        .per_frame = 0,
+    };
+
+    while (payload.block <= last) {
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            return PM3_EOPABORTED;
+        }
+
+        payload.count = MIN(FELICA_READ_BLOCKS_MAX, last - payload.block + 1);
+
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_FELICA_READ_BLOCKS, (uint8_t *)&payload, sizeof(payload));
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(CMD_HF_FELICA_READ_BLOCKS, &resp, 3000) == false) {
+            return PM3_ETIMEOUT;
+        }
+
+        if (resp.length < sizeof(felica_read_blocks_t)) {
+            PrintAndLogEx(ERR, "No response from card");
+            return PM3_ERFTRANS;
+        }
+
+        const felica_read_blocks_t *r = (const felica_read_blocks_t *)resp.data.asBytes;
+        for (uint8_t i = 0; i < r->count && i < FELICA_READ_BLOCKS_MAX; i++) {
+            uint16_t blk = payload.block + i;
+            if (blk > 0xFF) {
+                PrintAndLogEx(INFO, " %04X | %s  ", blk, sprint_hex(r->data[i], 16));
+            } else {
+                PrintAndLogEx(INFO, " %02X    | %s  ", blk, sprint_hex(r->data[i], 16));
+            }
+        }
+
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(ERR, "No response from card");
+            return resp.status;
+        }
+
+        payload.block += r->count;
+
+        if (r->count < payload.count) {
+            if (r->status_flag1 || r->status_flag2) {
+                PrintAndLogEx(INFO, "end of service at block %02X, status flags %02X %02X", payload.block, r->status_flag1, r->status_flag2);
+            }
+            break;
+        }
+
+        // remember what the card accepted for the next frames
+        payload.per_frame = r->per_frame;
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdHFFelicaReadPlain(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf felica rdbl",
@@ -1251,6 +1378,14 @@ static int CmdHFFelicaReadPlain(const char *Cmd) {
             last_blockno = 0xFFFF;
         }
 
+        // let the device batch the reads, old firmware falls back to one block per exchange
+        if (custom_IDm == false) {
+            res = felica_read_blocks_device(data[11] | (data[12] << 8), 0, last_blockno - 1);
+            if (res != PM3_ETIMEOUT) {
+                return res;
+            }
+        }
+
         for (uint16_t i = 0x00; i < last_blockno; i++) {
             data[15] = i;
             AddCrc(data, datalen);
@@ -1738,18 +1873,117 @@ static int CmdHFFelicaRequestService(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
-static int CmdHFFelicaNotImplementedYet(const char *Cmd) {
+static const char *felica_service_attribute(uint16_t code) {
+    switch (code & 0x3F) {
+        case 0x08:
+            return "Random, read/write, auth";
+        case 0x09:
+            return "Random, read/write";
+        case 0x0A:
+            return "Random, read only, auth";
+        case 0x0B:
+            return "Random, read only";
+        case 0x0C:
+            return "Cyclic, read/write, auth";
+        case 0x0D:
+            return "Cyclic, read/write";
+        case 0x0E:
+            return "Cyclic, read only, auth";
+        case 0x0F:
+            return "Cyclic, read only";
+        case 0x10:
+            return "Purse, direct, auth";
+        case 0x11:
+            return "Purse, direct";
+        case 0x12:
+            return "Purse, cashback, auth";
+        case 0x13:
+            return "Purse, cashback";
+        case 0x14:
+            return "Purse, decrement, auth";
+        case 0x15:
+            return "Purse, decrement";
+        case 0x16:
+            return "Purse, read only, auth";
+        case 0x17:
+            return "Purse, read only";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * Command parser for scsvcode.
+ * The whole Search Service Code sweep runs on the device, one reply per
+ * FELICA_SEARCH_SERVICE_MAX entries.
+ * @param Cmd input data of the user.
+ * @return client result code.
+ */
+static int CmdHFFelicaSearchService(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf felica scsvcode",
-                  "Feature not implemented yet.  Feel free to contribute!",
+                  "Use this command to acquire Area Code and Service Code of every Area and Service in the card.\n"
+                  "The card is asked with Search Service Code from index 0 until it answers FFFFh.\n"
+                  "Service codes are printed in the byte order `hf felica rdbl --scl` expects.",
                   "hf felica scsvcode"
                  );
     void *argtable[] = {
         arg_param_begin,
         arg_param_end
     };
-    CLIExecWithReturn(ctx, Cmd, argtable, false);
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
+
+    felica_search_service_req_t payload = { .start = 0 };
+    uint16_t total = 0;
+
+    PrintAndLogEx(INFO, "  #  | kind    | code | scl  | attributes");
+    PrintAndLogEx(INFO, "-----+---------+------+------+------------------------");
+
+    for (;;) {
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_FELICA_SEARCH_SERVICE, (uint8_t *)&payload, sizeof(payload));
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(CMD_HF_FELICA_SEARCH_SERVICE, &resp, 5000) == false) {
+            PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+            return PM3_ETIMEOUT;
+        }
+
+        if (resp.length < sizeof(felica_search_service_t)) {
+            PrintAndLogEx(WARNING, "FeliCa card select failed");
+            return PM3_ECARDEXCHANGE;
+        }
+
+        const felica_search_service_t *r = (const felica_search_service_t *)resp.data.asBytes;
+
+        for (uint8_t i = 0; i < r->count && i < FELICA_SEARCH_SERVICE_MAX; i++) {
+            const felica_service_entry_t *e = &r->entries[i];
+            if (e->end) {
+                PrintAndLogEx(SUCCESS, " %3u | Area    | %04X |      | ends at %04X", total, e->code, e->end);
+            } else {
+                PrintAndLogEx(SUCCESS, " %3u | " _GREEN_("Service") " | %04X | %02X%02X | %s"
+                              , total
+                              , e->code
+                              , e->code & 0xFF, e->code >> 8
+                              , felica_service_attribute(e->code)
+                             );
+            }
+            total++;
+        }
+
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "search stopped at index %u", r->next);
+            return resp.status;
+        }
+
+        if (r->truncated == 0) {
+            break;
+        }
+        payload.start = r->next;
+    }
+
+    PrintAndLogEx(SUCCESS, "found " _GREEN_("%u") " areas and services", total);
     return PM3_SUCCESS;
 }
 
@@ -2206,7 +2440,7 @@ static command_t CommandTable[] = {
     //{"dump",          CmdHFFelicaDump,                    IfPm3Felica,     "Wait for and try dumping FeliCa"},
     {"rqservice",       CmdHFFelicaRequestService,        IfPm3Felica,     "verify the existence of Area and Service, and to acquire Key Version."},
     {"rqresponse",      CmdHFFelicaRequestResponse,       IfPm3Felica,     "verify the existence of a card and its Mode."},
-    {"scsvcode",        CmdHFFelicaNotImplementedYet,     IfPm3Felica,     "acquire Area Code and Service Code."},
+    {"scsvcode",        CmdHFFelicaSearchService,         IfPm3Felica,     "acquire Area Code and Service Code."},
     {"rqsyscode",       CmdHFFelicaRequestSystemCode,     IfPm3Felica,     "acquire System Code registered to the card."},
     {"auth1",           CmdHFFelicaAuthentication1,       IfPm3Felica,     "authenticate a card. Start mutual authentication with Auth1"},
     {"auth2",           CmdHFFelicaAuthentication2,       IfPm3Felica,     "allow a card to authenticate a Reader/Writer. Complete mutual authentication"},
@@ -39,6 +39,7 @@
 #include "iclass_cmd.h"
 #include "crypto/asn1utils.h"       // ASN1 decoder
 #include "preferences.h"
+#include "crc32.h"                  // crc32_ex
 
 
 #define NUM_CSNS               9
@@ -139,9 +140,6 @@ static void iclass_upload_emul(uint8_t *d, uint16_t n, uint16_t offset, uint16_t
         uint8_t data[];
     } PACKED;
 
-    // fast push mode
-    g_conn.block_after_ACK = true;
-
     //Send to device
     *bytes_sent = 0;
     uint16_t bytes_remaining = n;
@@ -149,6 +147,16 @@ static void iclass_upload_emul(uint8_t *d, uint16_t n, uint16_t offset, uint16_t
     PrintAndLogEx(INFO, "Uploading to emulator memory");
     PrintAndLogEx(INFO, "." NOLF);
 
+    // bulk upload, falls back to packet chunks on older firmware
+    if (UploadEmlToDevice(d, n, offset, FPGA_BITSTREAM_HF_15) == PM3_SUCCESS) {
+        *bytes_sent = n;
+        PrintAndLogEx(NORMAL, "");
+        return;
+    }
+
+    // fast push mode
+    g_conn.block_after_ACK = true;
+
     while (bytes_remaining > 0) {
         uint32_t bytes_in_packet = MIN(PM3_CMD_DATA_SIZE - 4, bytes_remaining);
         if (bytes_in_packet == bytes_remaining) {
@@ -713,18 +721,34 @@ static int CmdHFiClassSniff(const char *Cmd) {
                   "Sniff the communication reader and tag",
                   "hf iclass sniff\n"
                   "hf iclass sniff -j    --> jam e-purse updates\n"
+                  "hf iclass sniff --stream gate    --> stream trace to gate.trace while sniffing\n"
+                  "hf iclass sniff --stream gate --pcapng /tmp/pm3fifo    --> and live to wireshark -k -i /tmp/pm3fifo\n"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_lit0("j",  "jam",    "Jam (prevent) e-purse updates"),
+        arg_str0(NULL, "stream", "<fn>", "Stream trace to file while sniffing, not limited by device memory"),
+        arg_str0(NULL, "pcapng", "<fn>", "With --stream, also write PCAP-NG live to file or fifo (Wireshark)"),
         arg_param_end
     };
 
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     bool jam_epurse_update = arg_get_lit(ctx, 1);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int pcaplen = 0;
+    char pcapfn[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 3), (uint8_t *)pcapfn, FILE_PATH_SIZE, &pcaplen);
     CLIParserFree(ctx);
 
+    if (pcaplen && fnlen == 0) {
+        PrintAndLogEx(FAILED, "--pcapng needs --stream");
+        return PM3_EINVARG;
+    }
+
     if (jam_epurse_update) {
         PrintAndLogEx(INFO, "Sniff with jam of iCLASS e-purse updates...");
     }
@@ -742,6 +766,10 @@ static int CmdHFiClassSniff(const char *Cmd) {
         memcpy(payload.jam_search_string, update_epurse_sequence, sizeof(payload.jam_search_string));
     }
 
+    if (fnlen) {
+        return TraceStreamSniff(CMD_HF_ICLASS_SNIFF, (uint8_t *)&payload, sizeof(payload), filename, pcapfn, ICLASS);
+    }
+
     PacketResponseNG resp;
     clearCommandBuffer();
     SendCommandNG(CMD_HF_ICLASS_SNIFF, (uint8_t *)&payload, sizeof(payload));
@@ -2022,6 +2050,13 @@ static int CmdHFiClassDump(const char *Cmd) {
         payload.start_block = 5;
     }
 
+    // AA2 Kc, Credit.  Device reselects and reads it in the same session
+    bool try_aa2 = (have_credit_key && pagemap != PICOPASS_NON_SECURE_PAGEMODE && app_limit2 > app_limit1);
+    if (try_aa2) {
+        payload.aa2_end_block = app_limit2;
+        memcpy(payload.credit_key, credit_key, 8);
+    }
+
     clearCommandBuffer();
     SendCommandNG(CMD_HF_ICLASS_DUMP, (uint8_t *)&payload, sizeof(payload));
 
@@ -2048,6 +2083,8 @@ static int CmdHFiClassDump(const char *Cmd) {
         bool isOK;
         uint16_t block_cnt;
         uint32_t bb_offset;
+        bool aa2_isOK;
+        uint16_t aa2_block_cnt;
     } PACKED;
     struct p_resp *packet = (struct p_resp *)resp.data.asBytes;
 
@@ -2061,7 +2098,7 @@ static int CmdHFiClassDump(const char *Cmd) {
 
     uint8_t tempbuf[0x100 * 8];
 
-    // response ok - now get bigbuf content of the dump
+    // response ok - now get bigbuf content of the dump,  AA1 and AA2 in one transfer
     if (!GetFromDevice(BIG_BUF, tempbuf, sizeof(tempbuf), startindex, NULL, 0, NULL, 2500, false)) {
         PrintAndLogEx(WARNING, "command execution time out");
         return PM3_ETIMEOUT;
@@ -2079,75 +2116,28 @@ static int CmdHFiClassDump(const char *Cmd) {
 
     uint16_t bytes_got = (app_limit1 + 1) * 8;
 
-    // try AA2 Kc, Credit
-    bool aa2_success = false;
-
-    if (have_credit_key && pagemap != PICOPASS_NON_SECURE_PAGEMODE && app_limit2 != 0) {
+    bool aa2_success = (try_aa2 && packet->aa2_isOK);
+    if (aa2_success) {
 
-        // AA2 authenticate credit key
-        memcpy(payload.req.key, credit_key, 8);
-
-        payload.req.use_credit_key = true;
-        payload.start_block = app_limit1 + 1;
-        payload.end_block = app_limit2;
-        payload.req.do_auth = true;
-
-        clearCommandBuffer();
-        SendCommandNG(CMD_HF_ICLASS_DUMP, (uint8_t *)&payload, sizeof(payload));
-
-        while (true) {
-            PrintAndLogEx(NORMAL, "." NOLF);
-            if (kbd_enter_pressed()) {
-                PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
-                DropField();
-                return PM3_EOPABORTED;
-            }
-
-            if (WaitForResponseTimeout(CMD_HF_ICLASS_DUMP, &resp, 2000))
-                break;
-        }
-        PrintAndLogEx(NORMAL, "");
-        if (resp.status != PM3_SUCCESS) {
-            PrintAndLogEx(ERR, "failed to communicate with card");
-            goto write_dump;
-        }
-
-        packet = (struct p_resp *)resp.data.asBytes;
-        if (packet->isOK == false) {
-            PrintAndLogEx(WARNING, "failed read block using credit key");
-            goto write_dump;
-        }
-
-        blocks_read = packet->block_cnt;
-        startindex = packet->bb_offset;
+        blocks_read = packet->aa2_block_cnt;
 
         if (blocks_read * 8 > sizeof(tag_data) - bytes_got) {
             PrintAndLogEx(WARNING, "data exceeded buffer size! ");
             blocks_read = (sizeof(tag_data) - bytes_got) / 8;
         }
 
-        // get dumped data from bigbuf
-        if (!GetFromDevice(BIG_BUF, tempbuf, sizeof(tempbuf), startindex, NULL, 0, NULL, 2500, false)) {
-            PrintAndLogEx(WARNING, "command execution time out");
-            goto write_dump;
-        }
-
         // div key KC
         memcpy(tag_data + (PICOPASS_BLOCK_SIZE * 4), tempbuf + (PICOPASS_BLOCK_SIZE * 4), PICOPASS_BLOCK_SIZE);
 
         // AA2 data
-        memcpy(tag_data + (PICOPASS_BLOCK_SIZE * payload.start_block),
-               tempbuf + (PICOPASS_BLOCK_SIZE * payload.start_block),
+        memcpy(tag_data + (PICOPASS_BLOCK_SIZE * (app_limit1 + 1)),
+               tempbuf + (PICOPASS_BLOCK_SIZE * (app_limit1 + 1)),
                blocks_read * PICOPASS_BLOCK_SIZE);
 
         bytes_got += (blocks_read * PICOPASS_BLOCK_SIZE);
-
-        aa2_success = true;
     }
 
-write_dump:
-
-    if (have_credit_key && pagemap != 0x01 && aa2_success == false) {
+    if (try_aa2 && aa2_success == false) {
         PrintAndLogEx(INFO, "Reading AA2 failed. dumping AA1 data to file");
     }
 
@@ -3916,15 +3906,12 @@ typedef struct {
     uint8_t csn[8];
     uint8_t cc_nr[12];
     uint8_t *keys;
-    union {
-        iclass_premac_t *premac;
-        iclass_prekey_t *prekey;
-    } list;
+    uint8_t *div_keys;
+    iclass_premac_t *macs;
 } PACKED iclass_thread_arg_t;
 
 static size_t iclass_tc = 1;
 
-static pthread_mutex_t generator_mutex = PTHREAD_MUTEX_INITIALIZER;
 static void *bf_generate_mac(void *thread_arg) {
 
     iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
@@ -3934,36 +3921,82 @@ static void *bf_generate_mac(void *thread_arg) {
     const uint32_t keycnt = targ->keycnt;
 
     uint8_t *keys = targ->keys;
-    iclass_premac_t *list = targ->list.premac;
+    uint8_t *div_keys = targ->div_keys;
+    iclass_premac_t *list = targ->macs;
 
     uint8_t csn[8];
     uint8_t cc_nr[12];
     memcpy(csn, targ->csn, sizeof(csn));
     memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
 
-    uint8_t key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
+    // each thread takes a contiguous slice, so the MACs can be done in one batch
+    uint32_t start = ((uint64_t)keycnt * idx) / iclass_tc;
+    uint32_t end = ((uint64_t)keycnt * (idx + 1)) / iclass_tc;
 
-        memcpy(key, keys + 8 * i, 8);
+    for (uint32_t i = start; i < end; i++) {
 
-        pthread_mutex_lock(&generator_mutex);
+        uint8_t *div_key = div_keys + 8 * i;
         if (use_raw)
-            memcpy(div_key, key, 8);
+            memcpy(div_key, keys + 8 * i, 8);
         else
-            HFiClassCalcDivKey(csn, key, div_key, use_elite);
-
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+            HFiClassCalcDivKey(csn, keys + 8 * i, div_key, use_elite);
     }
+
+    doMAC_fast_multi(cc_nr, div_keys + 8 * start, end - start, list[start].mac);
     return NULL;
 }
 
-// precalc diversified keys and their MAC
-void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
+// Diversified keys only depend on CSN, dictionary and mode, the MACs also on CC/NR.
+// Keep the last few cards around so re-checking the same card doesn't redo the work.
+#define ICLASS_DIVKEY_CACHE_SIZE 4
+
+typedef struct {
+    uint8_t csn[8];
+    uint8_t cc_nr[12];
+    bool use_raw;
+    bool use_elite;
+    uint32_t keycnt;
+    uint8_t dict_crc[4];
+    uint8_t *div_keys;
+    iclass_premac_t *macs;
+} iclass_divkey_cache_t;
+
+static iclass_divkey_cache_t iclass_divkey_cache[ICLASS_DIVKEY_CACHE_SIZE];
+static uint8_t iclass_divkey_cache_next = 0;
+
+// returns diversified keys and MACs for the dictionary, computed in parallel on a cache miss
+static iclass_divkey_cache_t *iclass_divkey_cache_get(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt) {
+
+    uint8_t dict_crc[4] = {0};
+    crc32_ex(keys, keycnt * 8, dict_crc);
+
+    iclass_divkey_cache_t *e = NULL;
+    for (uint8_t i = 0; i < ICLASS_DIVKEY_CACHE_SIZE; i++) {
+        iclass_divkey_cache_t *c = &iclass_divkey_cache[i];
+        if (c->div_keys != NULL && c->keycnt == keycnt && c->use_raw == use_raw && c->use_elite == use_elite &&
+                memcmp(c->csn, CSN, sizeof(c->csn)) == 0 && memcmp(c->dict_crc, dict_crc, sizeof(dict_crc)) == 0) {
+            e = c;
+            break;
+        }
+    }
+
+    if (e) {
+        // same card, only the MACs need an update if CC/NR changed
+        if (memcmp(e->cc_nr, CCNR, sizeof(e->cc_nr))) {
+            doMAC_fast_multi(CCNR, e->div_keys, keycnt, e->macs[0].mac);
+            memcpy(e->cc_nr, CCNR, sizeof(e->cc_nr));
+        }
+        PrintAndLogEx(DEBUG, "using cached diversified keys");
+        return e;
+    }
 
-    pthread_mutex_init(&generator_mutex, NULL);
+    uint8_t *div_keys = calloc(keycnt, 8);
+    iclass_premac_t *macs = calloc(keycnt, sizeof(iclass_premac_t));
+    if (div_keys == NULL || macs == NULL) {
+        free(div_keys);
+        free(macs);
+        return NULL;
+    }
 
     iclass_tc = num_CPUs();
     pthread_t threads[iclass_tc];
@@ -3975,90 +4008,71 @@ void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite,
         args[i].use_elite = use_elite;
         args[i].keycnt = keycnt;
         args[i].keys = keys;
-        args[i].list.premac = list;
+        args[i].div_keys = div_keys;
+        args[i].macs = macs;
 
         memcpy(args[i].csn, CSN, sizeof(args[i].csn));
         memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
     }
 
-    for (int i = 0; i < iclass_tc; i++) {
-        int res = pthread_create(&threads[i], NULL, bf_generate_mac, (void *)&args[i]);
+    size_t started = 0;
+    for (; started < iclass_tc; started++) {
+        int res = pthread_create(&threads[started], NULL, bf_generate_mac, (void *)&args[started]);
         if (res) {
             PrintAndLogEx(NORMAL, "");
             PrintAndLogEx(WARNING, "Failed to create pthreads. Quitting");
-            return;
+            break;
         }
     }
 
-    for (int i = 0; i < iclass_tc; i++)
+    for (size_t i = 0; i < started; i++)
         pthread_join(threads[i], NULL);
-}
-
-static void *bf_generate_mackey(void *thread_arg) {
-
-    iclass_thread_arg_t *targ = (iclass_thread_arg_t *)thread_arg;
-    const uint8_t idx = targ->thread_idx;
-    const uint8_t use_raw = targ->use_raw;
-    const uint8_t use_elite = targ->use_elite;
-    const uint32_t keycnt = targ->keycnt;
-
-    uint8_t *keys = targ->keys;
-    iclass_prekey_t *list = targ->list.prekey;
 
-    uint8_t csn[8];
-    uint8_t cc_nr[12];
-    memcpy(csn, targ->csn, sizeof(csn));
-    memcpy(cc_nr, targ->cc_nr, sizeof(cc_nr));
-
-    uint8_t div_key[8] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-
-    for (uint32_t i = idx; i < keycnt; i += iclass_tc) {
-
-        memcpy(list[i].key, keys + 8 * i, 8);
+    if (started != iclass_tc) {
+        free(div_keys);
+        free(macs);
+        return NULL;
+    }
+
+    // replace the oldest entry
+    e = &iclass_divkey_cache[iclass_divkey_cache_next];
+    iclass_divkey_cache_next = (iclass_divkey_cache_next + 1) % ICLASS_DIVKEY_CACHE_SIZE;
+    free(e->div_keys);
+    free(e->macs);
+
+    memcpy(e->csn, CSN, sizeof(e->csn));
+    memcpy(e->cc_nr, CCNR, sizeof(e->cc_nr));
+    e->use_raw = use_raw;
+    e->use_elite = use_elite;
+    e->keycnt = keycnt;
+    memcpy(e->dict_crc, dict_crc, sizeof(e->dict_crc));
+    e->div_keys = div_keys;
+    e->macs = macs;
+    return e;
+}
 
-        pthread_mutex_lock(&generator_mutex);
-        if (use_raw)
-            memcpy(div_key, list[i].key, 8);
-        else
-            HFiClassCalcDivKey(csn, list[i].key, div_key, use_elite);
+// precalc diversified keys and their MAC
+void GenerateMacFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_premac_t *list) {
 
-        doMAC(cc_nr, div_key, list[i].mac);
-        pthread_mutex_unlock(&generator_mutex);
+    iclass_divkey_cache_t *e = iclass_divkey_cache_get(CSN, CCNR, use_raw, use_elite, keys, keycnt);
+    if (e == NULL) {
+        return;
     }
-    return NULL;
+
+    memcpy(list, e->macs, keycnt * sizeof(iclass_premac_t));
 }
 
 void GenerateMacKeyFrom(uint8_t *CSN, uint8_t *CCNR, bool use_raw, bool use_elite, uint8_t *keys, uint32_t keycnt, iclass_prekey_t *list) {
 
-    pthread_mutex_init(&generator_mutex, NULL);
-    iclass_tc = num_CPUs();
-    pthread_t threads[iclass_tc];
-    iclass_thread_arg_t args[iclass_tc];
-    // init thread arguments
-    for (size_t i = 0; i < iclass_tc; i++) {
-        args[i].thread_idx = i;
-        args[i].use_raw = use_raw;
-        args[i].use_elite = use_elite;
-        args[i].keycnt = keycnt;
-        args[i].keys = keys;
-        args[i].list.prekey = list;
-
-        memcpy(args[i].csn, CSN, sizeof(args[i].csn));
-        memcpy(args[i].cc_nr, CCNR, sizeof(args[i].cc_nr));
+    iclass_divkey_cache_t *e = iclass_divkey_cache_get(CSN, CCNR, use_raw, use_elite, keys, keycnt);
+    if (e == NULL) {
+        return;
     }
 
-    for (size_t i = 0; i < iclass_tc; i++) {
-        int res = pthread_create(&threads[i], NULL, bf_generate_mackey, (void *)&args[i]);
-        if (res) {
-            PrintAndLogEx(NORMAL, "");
-            PrintAndLogEx(WARNING, "Failed to create pthreads. Quitting");
-            return;
-        }
+    for (uint32_t i = 0; i < keycnt; i++) {
+        memcpy(list[i].key, keys + 8 * i, 8);
+        memcpy(list[i].mac, e->macs[i].mac, 4);
     }
-
-    for (int i = 0; i < iclass_tc; i++)
-        pthread_join(threads[i], NULL);
-
 }
 
 // print diversified keys
@@ -28,6 +28,8 @@
 #include "ui.h"
 #include "crc16.h"
 #include "crapto1/crapto1.h"
+#include "crypto1_bs.h"
+#include "util.h"           // num_CPUs
 #include "protocols.h"
 #include "cmdhficlass.h"
 
@@ -52,6 +54,76 @@ void ClearAuthData(void) {
     AuthData.ks3 = 0;
 }
 
+// Keys recovered while decrypting a trace, per card and sector.
+// A nested authentication tries these before the dictionary.
+#define TRACE_KEY_CACHE_SIZE 256
+
+typedef struct {
+    uint32_t uid;
+    uint8_t sector;
+    uint8_t keytype;
+    uint64_t key;
+} trace_key_t;
+
+static trace_key_t gs_trace_keys[TRACE_KEY_CACHE_SIZE];
+static uint32_t gs_trace_keys_count = 0;
+
+void ClearTraceKeyCache(void) {
+    gs_trace_keys_count = 0;
+}
+
+static uint8_t trace_key_sector(uint8_t block) {
+    return (block < 128) ? (block / 4) : (32 + ((block - 128) / 16));
+}
+
+static void trace_key_add(const AuthData_t *ad, uint64_t key) {
+    uint8_t sector = trace_key_sector(ad->block);
+    for (uint32_t i = 0; i < gs_trace_keys_count; i++) {
+        trace_key_t *e = &gs_trace_keys[i];
+        if (e->uid == ad->uid && e->sector == sector && e->keytype == ad->keytype) {
+            e->key = key;
+            return;
+        }
+    }
+
+    // full, the oldest entry goes
+    if (gs_trace_keys_count == TRACE_KEY_CACHE_SIZE) {
+        memmove(&gs_trace_keys[0], &gs_trace_keys[1], (TRACE_KEY_CACHE_SIZE - 1) * sizeof(trace_key_t));
+        gs_trace_keys_count--;
+    }
+
+    trace_key_t *e = &gs_trace_keys[gs_trace_keys_count++];
+    e->uid = ad->uid;
+    e->sector = sector;
+    e->keytype = ad->keytype;
+    e->key = key;
+}
+
+// Cached keys of this card, the one of the authenticated sector / key type first.
+static uint64_t trace_key_find(AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
+    uint8_t sector = trace_key_sector(ad->block);
+    for (uint32_t i = 0; i < gs_trace_keys_count; i++) {
+        const trace_key_t *e = &gs_trace_keys[i];
+        if (e->uid == ad->uid && e->sector == sector && e->keytype == ad->keytype) {
+            if (NestedCheckKey(e->key, ad, cmd, cmdsize, parity)) {
+                return e->key;
+            }
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < gs_trace_keys_count; i++) {
+        const trace_key_t *e = &gs_trace_keys[i];
+        if (e->uid != ad->uid || (e->sector == sector && e->keytype == ad->keytype)) {
+            continue;
+        }
+        if (NestedCheckKey(e->key, ad, cmd, cmdsize, parity)) {
+            return e->key;
+        }
+    }
+    return UINT64_MAX;
+}
+
 
 static int gs_ntag_i2c_state = 0;
 static int gs_mfuc_state = 0;
@@ -312,6 +384,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                 if (cmdsize > 3) {
                     snprintf(exp, size, "AUTH-A(" _MAGENTA_("%d") ")", cmd[1]);
                     MifareAuthState = masNt;
+                    AuthData.block = cmd[1];
+                    AuthData.keytype = MIFARE_AUTH_KEYA;
                 } else {
                     // case MIFARE_ULEV1_VERSION :  both 0x60.
                     snprintf(exp, size, "EV1 VERSION");
@@ -320,6 +394,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
             }
             case MIFARE_AUTH_KEYB: {
                 MifareAuthState = masNt;
+                AuthData.block = cmd[1];
+                AuthData.keytype = MIFARE_AUTH_KEYB;
                 snprintf(exp, size, "AUTH-B(" _MAGENTA_("%d") ")", cmd[1]);
                 break;
             }
@@ -327,6 +403,8 @@ int applyIso14443a(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize, bool i
                 if (cmdsize > 3) {
                     snprintf(exp, size, "MAGIC AUTH (" _MAGENTA_("%d") ")", cmd[1]);
                     MifareAuthState = masNt;
+                    AuthData.block = cmd[1];
+                    AuthData.keytype = MIFARE_MAGIC_GDM_AUTH_KEY;
                 }
                 break;
             }
@@ -2148,6 +2226,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
             AuthData.ks3 = AuthData.at_enc ^ prng_successor(AuthData.nt, 96);
 
             mfLastKey = GetCrypto1ProbableKey(&AuthData);
+            trace_key_add(&AuthData, mfLastKey);
             PrintAndLogEx(NORMAL, "            |            |  *  |%49s " _GREEN_("%012" PRIX64) " prng %s |     |",
                           "key",
                           mfLastKey,
@@ -2166,20 +2245,32 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
             if (mfLastKey) {
                 if (NestedCheckKey(mfLastKey, &AuthData, cmd, cmdsize, parity)) {
                     PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "last used key", mfLastKey);
+                    trace_key_add(&AuthData, mfLastKey);
                     traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 };
             }
 
+            // check keys already recovered for this card
+            if (!traceCrypto1) {
+                uint64_t key = trace_key_find(&AuthData, cmd, cmdsize, parity);
+                if (key != UINT64_MAX) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "cached key", key);
+
+                    mfLastKey = key;
+                    trace_key_add(&AuthData, key);
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
+                }
+            }
+
             // check default keys
             if (!traceCrypto1 && dicKeys != NULL && dicKeysCount > 0) {
-                for (int i = 0; i < dicKeysCount; i++) {
-                    if (NestedCheckKey(dicKeys[i], &AuthData, cmd, cmdsize, parity)) {
-                        PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", dicKeys[i]);
+                uint64_t key = NestedFindKey(&AuthData, dicKeys, dicKeysCount, cmd, cmdsize, parity);
+                if (key != UINT64_MAX) {
+                    PrintAndLogEx(NORMAL, "            |            |  *  |%60s " _GREEN_("%012" PRIX64) "|     |", "key", key);
 
-                        mfLastKey = dicKeys[i];
-                        traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
-                        break;
-                    };
+                    mfLastKey = key;
+                    trace_key_add(&AuthData, key);
+                    traceCrypto1 = lfsr_recovery64(AuthData.ks2, AuthData.ks3);
                 }
             }
 
@@ -2202,6 +2293,7 @@ bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isRes
                             AuthData.ks3 = ks3;
                             AuthData.nt = ntx;
                             mfLastKey = GetCrypto1ProbableKey(&AuthData);
+                            trace_key_add(&AuthData, mfLastKey);
                             PrintAndLogEx(NORMAL, "            |            |  *  | nested probable key: " _GREEN_("%012" PRIX64) "     ks2:%08x ks3:%08x |     |",
                                           mfLastKey,
                                           AuthData.ks2,
@@ -2343,6 +2435,112 @@ bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize,
     return true;
 }
 
+// Dictionary version of NestedCheckKey.
+// The nested authentication is replayed for a batch of keys at once with the bitsliced Crypto1,
+// only keys matching ar and at go through the full check.
+// Large dictionaries are split over all CPUs, the threads only run the ar / at filter
+// and the candidates are checked afterwards in dictionary order.
+#define NESTED_FIND_BATCH       512
+#define NESTED_FIND_CANDIDATES  8
+#define NESTED_FIND_MIN_KEYS    (4 * NESTED_FIND_BATCH)
+
+typedef struct {
+    const AuthData_t *ad;
+    const uint64_t *keys;
+    uint32_t start;
+    uint32_t end;
+    uint32_t cand[NESTED_FIND_CANDIDATES];
+    uint32_t cand_cnt;
+} nested_find_arg_t;
+
+static void *nested_find_thread(void *arg) {
+    nested_find_arg_t *a = (nested_find_arg_t *)arg;
+    const AuthData_t *ad = a->ad;
+
+    crypto1_bs_job_t job = {
+        .nwords = 4,
+        .encrypted = 0x03,
+        .in = { ad->nt_enc ^ ad->uid, ad->nr_enc, 0, 0 },
+        .nbytes = 0,
+    };
+
+    uint32_t ks[NESTED_FIND_BATCH * 4];
+
+    a->cand_cnt = 0;
+    for (uint32_t i = a->start; i < a->end; i += NESTED_FIND_BATCH) {
+
+        uint32_t n = MIN(a->end - i, NESTED_FIND_BATCH);
+        crypto1_bs_run(&job, a->keys + i, n, ks, NULL);
+
+        for (uint32_t k = 0; k < n; k++) {
+            uint32_t nt1 = ks[k * 4] ^ ad->nt_enc;
+            if ((ks[k * 4 + 2] ^ ad->ar_enc) != prng_successor(nt1, 64))
+                continue;
+
+            if ((ks[k * 4 + 3] ^ ad->at_enc) != prng_successor(nt1, 96))
+                continue;
+
+            // 64 bit filter, more than one hit is a duplicated key
+            if (a->cand_cnt == NESTED_FIND_CANDIDATES)
+                return NULL;
+
+            a->cand[a->cand_cnt++] = i + k;
+        }
+    }
+    return NULL;
+}
+
+uint64_t NestedFindKey(AuthData_t *ad, const uint64_t *keys, uint32_t keycnt, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity) {
+
+    uint32_t thread_cnt = 1;
+    if (keycnt >= NESTED_FIND_MIN_KEYS) {
+        int cpus = num_CPUs();
+        thread_cnt = (cpus > 0) ? cpus : 1;
+        thread_cnt = MIN(thread_cnt, keycnt / NESTED_FIND_BATCH);
+    }
+
+    // slices on batch boundaries
+    uint32_t batches = (keycnt + NESTED_FIND_BATCH - 1) / NESTED_FIND_BATCH;
+    uint32_t per_thread = (batches + thread_cnt - 1) / thread_cnt;
+
+    pthread_t threads[thread_cnt];
+    nested_find_arg_t args[thread_cnt];
+    for (uint32_t t = 0; t < thread_cnt; t++) {
+        args[t].ad = ad;
+        args[t].keys = keys;
+        args[t].start = MIN(t * per_thread * NESTED_FIND_BATCH, keycnt);
+        args[t].end = MIN((t + 1) * per_thread * NESTED_FIND_BATCH, keycnt);
+        args[t].cand_cnt = 0;
+    }
+
+    uint32_t started = 0;
+    if (thread_cnt > 1) {
+        for (; started < thread_cnt; started++) {
+            if (pthread_create(&threads[started], NULL, nested_find_thread, (void *)&args[started])) {
+                break;
+            }
+        }
+    }
+
+    // whatever share a thread could not be started for, is done here
+    for (uint32_t t = started; t < thread_cnt; t++) {
+        nested_find_thread(&args[t]);
+    }
+
+    for (uint32_t t = 0; t < started; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (uint32_t t = 0; t < thread_cnt; t++) {
+        for (uint32_t c = 0; c < args[t].cand_cnt; c++) {
+            uint64_t key = keys[args[t].cand[c]];
+            if (NestedCheckKey(key, ad, cmd, cmdsize, parity))
+                return key;
+        }
+    }
+    return UINT64_MAX;
+}
+
 bool CheckCrypto1Parity(const uint8_t *cmd_enc, uint8_t cmdsize, uint8_t *cmd, const uint8_t *parity_enc) {
     for (int i = 0; i < cmdsize - 1; i++) {
         if (oddparity8(cmd[i]) ^ (cmd[i + 1] & 0x01) ^ ((parity_enc[i / 8] >> (7 - i % 8)) & 0x01) ^ (cmd_enc[i + 1] & 0x01))
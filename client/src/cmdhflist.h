@@ -34,9 +34,12 @@ typedef struct {
     bool first_auth;    // is first authentication
     uint32_t ks2;       // ar ^ ar_enc
     uint32_t ks3;       // at ^ at_enc
+    uint8_t block;      // block of the running authentication
+    uint8_t keytype;    // MIFARE_AUTH_KEYA / MIFARE_AUTH_KEYB
 } AuthData_t;
 
 void ClearAuthData(void);
+void ClearTraceKeyCache(void);
 
 uint8_t iso14443A_CRC_check(bool isResponse, uint8_t *d, uint8_t n);
 uint8_t iso14443B_CRC_check(uint8_t *d, uint8_t n);
@@ -71,6 +74,7 @@ void annotateSeos(char *exp, size_t size, uint8_t *cmd, uint8_t cmdsize);
 bool DecodeMifareData(uint8_t *cmd, uint8_t cmdsize, uint8_t *parity, bool isResponse, uint8_t *mfData, size_t *mfDataLen, const uint64_t *dicKeys, uint32_t dicKeysCount);
 bool NTParityChk(AuthData_t *ad, uint32_t ntx);
 bool NestedCheckKey(uint64_t key, AuthData_t *ad, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity);
+uint64_t NestedFindKey(AuthData_t *ad, const uint64_t *keys, uint32_t keycnt, uint8_t *cmd, uint8_t cmdsize, uint8_t *parity);
 bool CheckCrypto1Parity(const uint8_t *cmd_enc, uint8_t cmdsize, uint8_t *cmd, const uint8_t *parity_enc);
 uint64_t GetCrypto1ProbableKey(AuthData_t *ad);
 
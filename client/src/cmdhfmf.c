@@ -18,6 +18,7 @@
 
 #include "cmdhfmf.h"
 #include <ctype.h>
+#include <pthread.h>
 
 #include "bruteforce.h"
 #include "cmdparser.h"             // command_t
@@ -82,24 +83,12 @@ int mfc_ev1_print_signature(uint8_t *uid, uint8_t uidlen, uint8_t *signature, in
         {"TruST25 (ST) key 04?",           "04101E188A8B4CDDBC62D5BC3E0E6850F0C2730E744B79765A0E079907FBDB01BC"},
     };
 
-    uint8_t i;
-    bool is_valid = false;
-
-    for (i = 0; i < ARRAYLEN(nxp_mfc_public_keys); i++) {
-
-        int dl = 0;
-        uint8_t key[PUBLIC_MFCEV1_ECDA_KEYLEN];
-        param_gethex_to_eol(nxp_mfc_public_keys[i].value, 0, key, PUBLIC_MFCEV1_ECDA_KEYLEN, &dl);
-
-        int res = ecdsa_signature_r_s_verify(MBEDTLS_ECP_DP_SECP128R1, key, uid, uidlen, signature, signature_len, false);
-        is_valid = (res == 0);
-        if (is_valid)
-            break;
-    }
+    int i = ecdsa_signature_r_s_find_key(MBEDTLS_ECP_DP_SECP128R1, nxp_mfc_public_keys, ARRAYLEN(nxp_mfc_public_keys), uid, uidlen, signature, signature_len, false);
+    bool is_valid = (i >= 0);
 
     PrintAndLogEx(INFO, "");
     PrintAndLogEx(INFO, "--- " _CYAN_("Tag Signature"));
-    if (is_valid == false || i == ARRAYLEN(nxp_mfc_public_keys)) {
+    if (is_valid == false) {
         PrintAndLogEx(INFO, "    Elliptic curve parameters: NID_secp128r1");
         PrintAndLogEx(INFO, "             TAG IC Signature: %s", sprint_hex_inrow(signature, 32));
         PrintAndLogEx(SUCCESS, "       Signature verification: " _RED_("failed"));
@@ -151,6 +140,168 @@ static char *GenerateFilename(const char *prefix, const char *suffix) {
     return fptr;
 }
 
+// Key store, one key file per UID in the user cache directory.
+// Same layout as createMfcKeyDump (all key A, then all key B), unknown keys are FFFFFFFFFFFF.
+static char *mfc_keystore_path(const uint8_t *uid, uint8_t uidlen, bool create) {
+
+    if (uid == NULL || uidlen == 0 || uidlen > 10)
+        return NULL;
+
+    char *path = NULL;
+    if (create) {
+        if (searchHomeFilePath(&path, NULL, NULL, true) != PM3_SUCCESS)
+            return NULL;
+        free(path);
+        path = NULL;
+    }
+
+    char fn[40] = "hf-mf-";
+    FillFileNameByUID(fn, uid, "-key.bin", uidlen);
+
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, fn, create) != PM3_SUCCESS)
+        return NULL;
+
+    return path;
+}
+
+// returns number of sectors loaded, keys holds sectors * 2 keys
+static uint8_t mfc_keystore_load(const uint8_t *uid, uint8_t uidlen, uint8_t *keys) {
+
+    char *path = mfc_keystore_path(uid, uidlen, false);
+    if (path == NULL)
+        return 0;
+
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL)
+        return 0;
+
+    size_t n = fread(keys, 1, MIFARE_4K_MAXSECTOR * 2 * MIFARE_KEY_SIZE, f);
+    fclose(f);
+
+    if (n == 0 || (n % (2 * MIFARE_KEY_SIZE)) != 0)
+        return 0;
+
+    return n / (2 * MIFARE_KEY_SIZE);
+}
+
+static void mfc_keystore_update(const uint8_t *uid, uint8_t uidlen, uint8_t sectorsCnt, const sector_t *e_sector) {
+
+    if (e_sector == NULL || sectorsCnt == 0 || sectorsCnt > MIFARE_4K_MAXSECTOR)
+        return;
+
+    uint8_t old[MIFARE_4K_MAXSECTOR * 2 * MIFARE_KEY_SIZE];
+    uint8_t oldcnt = mfc_keystore_load(uid, uidlen, old);
+    uint8_t cnt = MAX(oldcnt, sectorsCnt);
+
+    // keep what earlier sessions learned about sectors not recovered this time
+    uint8_t keys[MIFARE_4K_MAXSECTOR * 2 * MIFARE_KEY_SIZE];
+    memset(keys, 0xFF, sizeof(keys));
+    memcpy(keys, old, oldcnt * MIFARE_KEY_SIZE);
+    memcpy(keys + (cnt * MIFARE_KEY_SIZE), old + (oldcnt * MIFARE_KEY_SIZE), oldcnt * MIFARE_KEY_SIZE);
+
+    bool changed = (cnt != oldcnt);
+    for (uint8_t i = 0; i < sectorsCnt; i++) {
+        for (uint8_t j = MF_KEY_A; j <= MF_KEY_B; j++) {
+            if (e_sector[i].foundKey[j] == 0)
+                continue;
+
+            uint8_t *dst = keys + (((j * cnt) + i) * MIFARE_KEY_SIZE);
+            if (bytes_to_num(dst, MIFARE_KEY_SIZE) != e_sector[i].Key[j]) {
+                num_to_bytes(e_sector[i].Key[j], MIFARE_KEY_SIZE, dst);
+                changed = true;
+            }
+        }
+    }
+
+    if (changed == false)
+        return;
+
+    char *path = mfc_keystore_path(uid, uidlen, true);
+    if (path == NULL)
+        return;
+
+    // write next to it and rename, a parallel client never reads a partial file
+    char tmppath[strlen(path) + 16];
+    snprintf(tmppath, sizeof(tmppath), "%s.%u", path, (unsigned int)(msclock() & 0xFFFFFF));
+
+    FILE *f = fopen(tmppath, "wb");
+    if (f == NULL) {
+        free(path);
+        return;
+    }
+
+    bool ok = (fwrite(keys, 2 * MIFARE_KEY_SIZE, cnt, f) == cnt);
+    ok &= (fclose(f) == 0);
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (ok == false || rename(tmppath, path) != 0) {
+        remove(tmppath);
+    } else {
+        PrintAndLogEx(INFO, "Updated key store `" _YELLOW_("%s") "`", path);
+    }
+    free(path);
+}
+
+// for commands that only know the card by the tag currently on the antenna
+static void mfc_keystore_update_current(uint8_t sectorsCnt, const sector_t *e_sector) {
+    uint8_t uid[10] = {0};
+    int uidlen = 0;
+    if (GetHFMF14AUID(uid, &uidlen) == PM3_SUCCESS && uidlen) {
+        mfc_keystore_update(uid, uidlen, sectorsCnt, e_sector);
+    }
+}
+
+// puts the unique stored keys for this UID in front of the key list, so the first check chunk verifies them
+static int mfc_keystore_prepend(const uint8_t *uid, uint8_t uidlen, uint8_t **pkeyBlock, uint32_t *pkeycnt) {
+
+    uint8_t keys[MIFARE_4K_MAXSECTOR * 2 * MIFARE_KEY_SIZE];
+    uint8_t cnt = mfc_keystore_load(uid, uidlen, keys);
+    if (cnt == 0)
+        return PM3_SUCCESS;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < (cnt * 2); i++) {
+        const uint8_t *k = keys + (i * MIFARE_KEY_SIZE);
+        if (bytes_to_num(k, MIFARE_KEY_SIZE) == 0xFFFFFFFFFFFF)
+            continue;
+
+        bool dup = false;
+        for (uint32_t j = 0; j < n; j++) {
+            if (memcmp(keys + (j * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE) == 0) {
+                dup = true;
+                break;
+            }
+        }
+        if (dup == false) {
+            memmove(keys + (n * MIFARE_KEY_SIZE), k, MIFARE_KEY_SIZE);
+            n++;
+        }
+    }
+
+    if (n == 0)
+        return PM3_SUCCESS;
+
+    uint8_t *p = calloc(*pkeycnt + n, MIFARE_KEY_SIZE);
+    if (p == NULL) {
+        PrintAndLogEx(FAILED, "cannot allocate memory for Keys");
+        return PM3_EMALLOC;
+    }
+
+    memcpy(p, keys, n * MIFARE_KEY_SIZE);
+    if (*pkeyBlock) {
+        memcpy(p + (n * MIFARE_KEY_SIZE), *pkeyBlock, *pkeycnt * MIFARE_KEY_SIZE);
+        free(*pkeyBlock);
+    }
+    *pkeyBlock = p;
+    *pkeycnt += n;
+
+    PrintAndLogEx(SUCCESS, "loaded " _GREEN_("%2u") " keys from key store", n);
+    return PM3_SUCCESS;
+}
+
 static int initSectorTable(sector_t **src, size_t items) {
 
     (*src) = calloc(items, sizeof(sector_t));
@@ -571,6 +722,83 @@ static int mf_analyse_st_block(uint8_t blockno, uint8_t *block, bool force) {
     return PM3_SUCCESS;
 }
 
+// Device side dump, one authentication per sector and key.
+// Returns PM3_ETIMEOUT when the firmware doesn't know CMD_HF_MIFARE_READCARD
+static int mfc_read_tag_device(uint8_t *carddata, uint8_t numSectors, uint8_t *keyA, uint8_t *keyB) {
+
+    mfc_readcard_t payload;
+    memset(&payload, 0, sizeof(payload));
+    payload.sectorcnt = MIN(numSectors, ARRAYLEN(payload.keys[0]));
+    for (uint8_t s = 0; s < payload.sectorcnt; s++) {
+        memcpy(payload.keys[MF_KEY_A][s], keyA + (s * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+        memcpy(payload.keys[MF_KEY_B][s], keyB + (s * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+    }
+
+    PrintAndLogEx(INFO, "Dumping all blocks from card...");
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_READCARD, (uint8_t *)&payload, sizeof(payload));
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_READCARD, &resp, 10000) == false) {
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status == PM3_EOPABORTED) {
+        PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+        return PM3_EOPABORTED;
+    }
+
+    if (resp.status != PM3_SUCCESS || resp.length != sizeof(mfc_readcard_reply_t)) {
+        PrintAndLogEx(FAILED, "Failed to dump card");
+        return PM3_ESOFT;
+    }
+
+    mfc_readcard_reply_t *reply = (mfc_readcard_reply_t *)resp.data.asBytes;
+
+    uint16_t bytes = MFBLOCK_SIZE * (mfFirstBlockOfSector(payload.sectorcnt - 1) + mfNumBlocksPerSector(payload.sectorcnt - 1));
+    uint8_t *image = calloc(bytes, sizeof(uint8_t));
+    if (image == NULL) {
+        PrintAndLogEx(WARNING, "Fail, cannot allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    if (GetFromDevice(BIG_BUF, image, bytes, reply->offset, NULL, 0, NULL, 2500, false) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        free(image);
+        return PM3_ETIMEOUT;
+    }
+
+    for (uint8_t sectorNo = 0; sectorNo < payload.sectorcnt; sectorNo++) {
+
+        // key A never authenticated, don't claim it for the dump
+        if ((reply->authok[sectorNo] & (1 << MF_KEY_A)) == 0) {
+            memset(keyA + (sectorNo * MIFARE_KEY_SIZE), 0x00, MIFARE_KEY_SIZE);
+        }
+
+        for (uint8_t blockNo = 0; blockNo < mfNumBlocksPerSector(sectorNo); blockNo++) {
+            uint16_t blk = mfFirstBlockOfSector(sectorNo) + blockNo;
+
+            if ((reply->readmask[blk / 8] & (1 << (blk % 8))) == 0) {
+                PrintAndLogEx(FAILED, "Sector... %2d Block... %2d ( " _RED_("fail") " )", sectorNo, blockNo);
+                continue;
+            }
+
+            uint8_t *data = image + (MFBLOCK_SIZE * blk);
+            if (mfIsSectorTrailerBasedOnBlocks(sectorNo, blockNo)) {
+                // sector trailer. Fill in the keys.
+                memcpy(data, keyA + (sectorNo * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+                memcpy(data + 10, keyB + (sectorNo * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+            }
+            memcpy(carddata + (MFBLOCK_SIZE * blk), data, MFBLOCK_SIZE);
+        }
+    }
+
+    free(image);
+    PrintAndLogEx(SUCCESS, "Read " _YELLOW_("%u") " blocks", reply->blocks);
+    PrintAndLogEx(SUCCESS, "Succeeded in dumping all blocks");
+    return PM3_SUCCESS;
+}
+
 /* Reads data from tag
  * @param card: (output) card info
  * @param carddata: (output) card data
@@ -606,23 +834,90 @@ static int mfc_read_tag(iso14a_card_select_t *card, uint8_t *carddata, uint8_t n
         keyfn = fptr ;
     }
 
-    PrintAndLogEx(INFO, "Using... %s", keyfn);
-
     size_t alen = 0, blen = 0;
     uint8_t *keyA, *keyB;
-    if (loadFileBinaryKey(keyfn, "", (void **)&keyA, (void **)&keyB, &alen, &blen) != PM3_SUCCESS) {
+    int res = loadFileBinaryKey(keyfn, "", (void **)&keyA, (void **)&keyB, &alen, &blen);
+
+    // no key file in the working directory, fall back to what earlier sessions stored for this UID
+    if (res != PM3_SUCCESS && fptr != NULL) {
+        char *store = mfc_keystore_path(card->uid, card->uidlen, false);
+        if (store != NULL) {
+            res = loadFileBinaryKey(store, "", (void **)&keyA, (void **)&keyB, &alen, &blen);
+            if (res == PM3_SUCCESS) {
+                free(fptr);
+                fptr = store;
+                keyfn = fptr;
+            } else {
+                free(store);
+            }
+        }
+    }
+
+    if (res != PM3_SUCCESS) {
         free(fptr);
         return PM3_ESOFT;
     }
 
+    PrintAndLogEx(INFO, "Using... %s", keyfn);
+
+    res = mfc_read_tag_device(carddata, numSectors, keyA, keyB);
+    if (res != PM3_ETIMEOUT) {
+        free(fptr);
+        free(keyA);
+        free(keyB);
+        return res;
+    }
+
+    // older firmware, read block by block
     PrintAndLogEx(INFO, "Reading sector access bits...");
     PrintAndLogEx(INFO, "." NOLF);
 
     uint8_t rights[40][4] = {0};
+    bool have_rights[40] = {false};
 
+    // first pass, keep several sector trailer reads with key A in flight
+    // to hide the USB round trip. Failed sectors are retried one by one below.
     mf_readblock_t payload;
+    uint8_t sent = 0, collected = 0;
+    uint32_t tags[40] = {0};
+    while (collected < numSectors) {
+
+        while (sent < numSectors && GetCommandPipelineInflight() < CMD_PIPELINE_DEPTH) {
+            payload.blockno = mfFirstBlockOfSector(sent) + mfNumBlocksPerSector(sent) - 1;
+            payload.keytype = MF_KEY_A;
+            memcpy(payload.key, keyA + (sent * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+            if (SendCommandNGPipelined(CMD_HF_MIFARE_READBL, (uint8_t *)&payload, sizeof(mf_readblock_t), &tags[sent]) != PM3_SUCCESS) {
+                break;
+            }
+            sent++;
+        }
+
+        if (WaitForPipelinedResponseTimeout(tags[collected], &resp, 1500) == false) {
+            // pipeline got flushed, leave the remaining sectors to the sequential path
+            break;
+        }
+
+        if (resp.status == PM3_SUCCESS) {
+            uint8_t *data = resp.data.asBytes;
+            rights[collected][0] = ((data[7] & 0x10) >> 2) | ((data[8] & 0x1) << 1) | ((data[8] & 0x10) >> 4); // C1C2C3 for data area 0
+            rights[collected][1] = ((data[7] & 0x20) >> 3) | ((data[8] & 0x2) << 0) | ((data[8] & 0x20) >> 5); // C1C2C3 for data area 1
+            rights[collected][2] = ((data[7] & 0x40) >> 4) | ((data[8] & 0x4) >> 1) | ((data[8] & 0x40) >> 6); // C1C2C3 for data area 2
+            rights[collected][3] = ((data[7] & 0x80) >> 5) | ((data[8] & 0x8) >> 2) | ((data[8] & 0x80) >> 7); // C1C2C3 for sector trailer
+            have_rights[collected] = true;
+        }
+        PrintAndLogEx(NORMAL, "." NOLF);
+        fflush(stdout);
+        collected++;
+    }
+    clearCommandPipeline();
+
     uint8_t current_key;
     for (uint8_t sectorNo = 0; sectorNo < numSectors; sectorNo++) {
+
+        if (have_rights[sectorNo]) {
+            continue;
+        }
+
         current_key = MF_KEY_A;
         for (uint8_t tries = 0; tries < MIFARE_SECTOR_RETRY; tries++) {
             PrintAndLogEx(NORMAL, "." NOLF);
@@ -830,6 +1125,9 @@ static int mf_load_keys(uint8_t **pkeyBlock, uint32_t *pkeycnt, uint8_t *userkey
             free(keyBlock_tmp);
         }
     }
+
+    // user supplied keys stay first
+    mfKeyHitsSort(*pkeyBlock + (userkeylen / MIFARE_KEY_SIZE) * MIFARE_KEY_SIZE, *pkeycnt - (userkeylen / MIFARE_KEY_SIZE));
     return PM3_SUCCESS;
 }
 
@@ -1311,6 +1609,13 @@ static int CmdHF14AMfDump(const char *Cmd) {
         mf_analyse_acl(block_cnt, mem);
     }
 
+    if (ResultIsOpen()) {
+        ResultAddHex("uid", card.uid, card.uidlen);
+        for (uint16_t i = 0; i < block_cnt; i++) {
+            ResultAppendHex("blocks", mem + (i * MFBLOCK_SIZE), MFBLOCK_SIZE);
+        }
+    }
+
     // Skip saving card data to file
     if (nosave) {
         PrintAndLogEx(INFO, "Called with no save option");
@@ -1331,6 +1636,7 @@ static int CmdHF14AMfDump(const char *Cmd) {
     }
 
     pm3_save_mf_dump(dataFilename, mem, bytes, jsfCardMemory);
+    ResultAddStr("file", dataFilename);
     free(mem);
     return PM3_SUCCESS;
 }
@@ -1914,6 +2220,8 @@ jumptoend:
         }
 
         // Create dump file
+        mfc_keystore_update_current(SectorsCnt, e_sector);
+
         if (createDumpFile) {
             char *fptr = GenerateFilename("hf-mf-", "-key.bin");
             if (createMfcKeyDump(fptr, SectorsCnt, e_sector) != PM3_SUCCESS) {
@@ -1937,7 +2245,8 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
                   "hf mf staticnested --mini --blk 0 -a -k FFFFFFFFFFFF\n"
                   "hf mf staticnested --1k --blk 0 -a -k FFFFFFFFFFFF\n"
                   "hf mf staticnested --2k --blk 0 -a -k FFFFFFFFFFFF\n"
-                  "hf mf staticnested --4k --blk 0 -a -k FFFFFFFFFFFF\n");
+                  "hf mf staticnested --4k --blk 0 -a -k FFFFFFFFFFFF\n"
+                  "hf mf staticnested --1k --blk 0 -a -k FFFFFFFFFFFF --resume\n");
 
     void *argtable[] = {
         arg_param_begin,
@@ -1951,6 +2260,7 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
         arg_lit0("b", NULL, "Input key specified is keyB"),
         arg_lit0("e", "emukeys", "Fill simulator keys from found keys"),
         arg_lit0(NULL, "dumpkeys", "Dump found keys to file"),
+        arg_lit0(NULL, "resume", "Continue interrupted key checks from `hf-mf-<UID>-staticnested-<blk><A|B>.ckpt`"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -1978,6 +2288,7 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
 
     bool transferToEml = arg_get_lit(ctx, 9);
     bool createDumpFile = arg_get_lit(ctx, 10);
+    bool resume = arg_get_lit(ctx, 11);
     CLIParserFree(ctx);
 
     //validations
@@ -2067,7 +2378,7 @@ static int CmdHF14AMfNestedStatic(const char *Cmd) {
 
                 if (e_sector[sectorNo].foundKey[trgKeyType]) continue;
 
-                int16_t isOK = mfStaticNested(blockNo, keyType, key, mfFirstBlockOfSector(sectorNo), trgKeyType, keyBlock);
+                int16_t isOK = mfStaticNested(blockNo, keyType, key, mfFirstBlockOfSector(sectorNo), trgKeyType, keyBlock, resume);
                 switch (isOK) {
                     case PM3_ETIMEOUT :
                         PrintAndLogEx(ERR, "Command execute timeout");
@@ -2163,6 +2474,8 @@ jumptoend:
     }
 
     // Create dump file
+    mfc_keystore_update_current(SectorsCnt, e_sector);
+
     if (createDumpFile) {
         char *fptr = GenerateFilename("hf-mf-", "-key.bin");
         if (createMfcKeyDump(fptr, SectorsCnt, e_sector) != PM3_SUCCESS) {
@@ -2186,6 +2499,9 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "if card is EV1, command can detect and use known key see example below\n"
                   " \n"
                   "`--i<X>`  set type of SIMD instructions. Without this flag programs autodetect it.\n"
+                  "`--gpu`   brute force on a GPU instead, needs an OpenCL runtime.\n"
+                  "`--stream` device keeps collecting nonces while the client analyzes them.\n"
+                  "`--resume` long brute force runs are checkpointed every minute, continue such a run.\n"
                   " or \n"
                   "    hf mf hardnested -r --tk [known target key]\n"
                   "Add the known target key to check if it is present in the remaining key space\n"
@@ -2198,6 +2514,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   "hf mf hardnested -r\n"
                   "hf mf hardnested -r --tk a0a1a2a3a4a5\n"
                   "hf mf hardnested -t --tk a0a1a2a3a4a5\n"
+                  "hf mf hardnested --resume\n"
                   "hf mf hardnested --blk 0 -a -k a0a1a2a3a4a5 --tblk 4 --ta --tk FFFFFFFFFFFF\n"
                  );
 
@@ -2217,6 +2534,9 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         arg_lit0("s",  "slow",           "Slower acquisition (required by some non standard cards)"),
         arg_lit0("t",  "tests",          "Run tests"),
         arg_lit0("w",  "wr",             "Acquire nonces and UID, and write them to file `hf-mf-<UID>-nonces.bin`"),
+        arg_lit0(NULL, "gpu",            "Brute force on an OpenCL GPU, falls back to CPU if none is found"),
+        arg_lit0(NULL, "stream",         "Device streams nonces while the client analyzes them"),
+        arg_lit0(NULL, "resume",         "Continue an interrupted brute force from `<file>.ckpt` (def `hardnested.ckpt`)"),
 
         arg_lit0(NULL, "in", "None (use CPU regular instruction set)"),
 #if defined(COMPILER_HAS_SIMD_X86)
@@ -2277,19 +2597,22 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     bool slow = arg_get_lit(ctx, 12);
     bool tests = arg_get_lit(ctx, 13);
     bool nonce_file_write = arg_get_lit(ctx, 14);
+    bool gpu = arg_get_lit(ctx, 15);
+    bool stream = arg_get_lit(ctx, 16);
+    bool resume = arg_get_lit(ctx, 17);
 
-    bool in = arg_get_lit(ctx, 15);
+    bool in = arg_get_lit(ctx, 18);
 #if defined(COMPILER_HAS_SIMD_X86)
-    bool im = arg_get_lit(ctx, 16);
-    bool is = arg_get_lit(ctx, 17);
-    bool ia = arg_get_lit(ctx, 18);
-    bool i2 = arg_get_lit(ctx, 19);
+    bool im = arg_get_lit(ctx, 19);
+    bool is = arg_get_lit(ctx, 20);
+    bool ia = arg_get_lit(ctx, 21);
+    bool i2 = arg_get_lit(ctx, 22);
 #endif
 #if defined(COMPILER_HAS_SIMD_AVX512)
-    bool i5 = arg_get_lit(ctx, 20);
+    bool i5 = arg_get_lit(ctx, 23);
 #endif
 #if defined(COMPILER_HAS_SIMD_NEON)
-    bool ie = arg_get_lit(ctx, 16);
+    bool ie = arg_get_lit(ctx, 19);
 #endif
     CLIParserFree(ctx);
 
@@ -2320,6 +2643,8 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     if (in)
         SetSIMDInstr(SIMD_NONE);
 
+    SetBruteForceOpenCL(gpu);
+
 
     bool known_target_key = (trg_keylen);
 
@@ -2345,7 +2670,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
         snprintf(filename, FILE_PATH_SIZE, "hf-mf-%s-nonces.bin", uid);
     }
 
-    if (g_session.pm3_present && !tests) {
+    if (g_session.pm3_present && !tests && !resume) {
         // detect MFC EV1 Signature
         if (detect_mfc_ev1_signature() && keylen == 0) {
             PrintAndLogEx(INFO, "MIFARE Classic EV1 card detected");
@@ -2383,7 +2708,7 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
                   tests);
 
     uint64_t foundkey = 0;
-    int16_t isOK = mfnestedhard(blockno, keytype, key, trg_blockno, trg_keytype, known_target_key ? trg_key : NULL, nonce_file_read, nonce_file_write, slow, tests, &foundkey, filename);
+    int16_t isOK = mfnestedhard(blockno, keytype, key, trg_blockno, trg_keytype, known_target_key ? trg_key : NULL, nonce_file_read, nonce_file_write, slow, stream, resume, tests, &foundkey, filename);
     switch (isOK) {
         case PM3_ETIMEOUT :
             PrintAndLogEx(ERR, "Error: No response from Proxmark3\n");
@@ -2408,6 +2733,132 @@ static int CmdHF14AMfNestedHard(const char *Cmd) {
     return isOK;
 }
 
+// Try a freshly found key on all sectors with missing keys
+static void mf_autopwn_reuse_key(uint8_t sector_cnt, sector_t *e_sector, uint8_t *tmp_key) {
+    uint64_t key64 = 0;
+    for (int i = 0; i < sector_cnt; i++) {
+        for (int j = MF_KEY_A; j <= MF_KEY_B; j++) {
+            // Check if the sector key is already broken
+            if (e_sector[i].foundKey[j])
+                continue;
+
+            // Check if the key works
+            if (mfCheckKeys(mfFirstBlockOfSector(i), j, true, 1, tmp_key, &key64) == PM3_SUCCESS) {
+                e_sector[i].Key[j] = bytes_to_num(tmp_key, MIFARE_KEY_SIZE);
+                e_sector[i].foundKey[j] = 'R';
+                PrintAndLogEx(SUCCESS, "target sector %3u key type %c -- found valid key [ " _GREEN_("%s") " ]",
+                              i,
+                              (j == MF_KEY_B) ? 'B' : 'A',
+                              sprint_hex_inrow(tmp_key, MIFARE_KEY_SIZE)
+                             );
+            }
+        }
+    }
+}
+
+// next key for the nested pipeline, all A keys first.
+// B keys of sectors with a known A key are left for the read B key attack
+static bool mf_autopwn_nested_next(uint8_t sector_cnt, const sector_t *e_sector, uint16_t *pos, uint8_t *sector, uint8_t *keytype) {
+    for (; *pos < (sector_cnt * 2); (*pos)++) {
+        uint8_t s = *pos % sector_cnt;
+        uint8_t k = (*pos < sector_cnt) ? MF_KEY_A : MF_KEY_B;
+
+        if (e_sector[s].foundKey[k])
+            continue;
+
+        if (k == MF_KEY_B && e_sector[s].foundKey[MF_KEY_A])
+            continue;
+
+        *sector = s;
+        *keytype = k;
+        (*pos)++;
+        return true;
+    }
+    return false;
+}
+
+static void *mf_autopwn_nested_thread(void *arg) {
+    mfNestedRecover(arg);
+    return NULL;
+}
+
+// Nested attack on all missing keys as a pipeline. While the candidates of one key are
+// calculated, the device already collects the nonces of the next one.
+// Keys not found here are left for the sequential attacks.
+static int mf_autopwn_nested_pipeline(uint8_t sector_cnt, sector_t *e_sector, uint8_t sectorno, uint8_t keytype,
+                                      uint8_t *key, bool *calibrate, bool verbose) {
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "======================= " _YELLOW_("START NESTED PIPELINE") " =======================");
+    }
+
+    mf_nested_job_t jobs[2];
+    uint8_t target_sector[2] = {0};
+    uint8_t target_keytype[2] = {0};
+    pthread_t thread;
+    int pending = -1;
+    uint16_t pos = 0;
+    int res = PM3_SUCCESS;
+
+    for (;;) {
+
+        // RF,  nonces for the next key
+        int slot = (pending == 0) ? 1 : 0;
+        bool acquired = false;
+        if (res == PM3_SUCCESS && mf_autopwn_nested_next(sector_cnt, e_sector, &pos, &target_sector[slot], &target_keytype[slot])) {
+
+            if (verbose) {
+                PrintAndLogEx(INFO, "collecting nonces for sector no %3d, target key type %c",
+                              target_sector[slot],
+                              (target_keytype[slot] == MF_KEY_B) ? 'B' : 'A');
+            }
+
+            res = mfNestedAcquire(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(target_sector[slot]), target_keytype[slot], *calibrate, &jobs[slot]);
+            if (res == PM3_SUCCESS) {
+                *calibrate = false;
+                acquired = true;
+            }
+        }
+
+        // offline part of the previous key done?  then test its candidates
+        if (pending >= 0) {
+            pthread_join(thread, NULL);
+
+            uint8_t s = target_sector[pending];
+            uint8_t k = target_keytype[pending];
+            uint8_t tmp_key[MIFARE_KEY_SIZE] = {0};
+
+            if (e_sector[s].foundKey[k]) {
+                mfNestedFree(&jobs[pending]);
+            } else if (mfNestedVerify(&jobs[pending], tmp_key) == PM3_SUCCESS) {
+                e_sector[s].Key[k] = bytes_to_num(tmp_key, MIFARE_KEY_SIZE);
+                e_sector[s].foundKey[k] = 'N';
+                PrintAndLogEx(SUCCESS, "target sector %3u key type %c -- found valid key [ " _GREEN_("%s") " ]",
+                              s,
+                              (k == MF_KEY_B) ? 'B' : 'A',
+                              sprint_hex_inrow(tmp_key, sizeof(tmp_key))
+                             );
+                mf_autopwn_reuse_key(sector_cnt, e_sector, tmp_key);
+            }
+            pending = -1;
+        }
+
+        if (acquired == false)
+            break;
+
+        // the key we just collected nonces for could have been found by reuse meanwhile
+        if (e_sector[target_sector[slot]].foundKey[target_keytype[slot]]) {
+            mfNestedFree(&jobs[slot]);
+            continue;
+        }
+
+        pthread_create(&thread, NULL, mf_autopwn_nested_thread, &jobs[slot]);
+        pending = slot;
+    }
+
+    return res;
+}
+
 static int CmdHF14AMfAutoPWN(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -2556,6 +3007,8 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
         SetSIMDInstr(SIMD_NONE);
     }
 
+    SetBruteForceOpenCL(false);
+
     // Nested and Hardnested parameter
     uint64_t key64 = 0;
     bool calibrate = true;
@@ -2714,6 +3167,13 @@ static int CmdHF14AMfAutoPWN(const char *Cmd) {
         return ret;
     }
 
+    ret = mfc_keystore_prepend(card.uid, card.uidlen, &keyBlock, &key_cnt);
+    if (ret != PM3_SUCCESS) {
+        free(keyBlock);
+        free(e_sector);
+        return ret;
+    }
+
     int32_t res = PM3_SUCCESS;
 
     // Use the dictionary to find sector keys on the card
@@ -2870,6 +3330,12 @@ noValidKeyFound:
     num_to_bytes(0, MIFARE_KEY_SIZE, tmp_key);
     bool nested_failed = false;
 
+    // Nested attack on all missing keys first,  with a predictable PRNG the device
+    // collects nonces for the next key while the client recovers the current one
+    if (prng_type && (has_staticnonce != NONCE_STATIC)) {
+        mf_autopwn_nested_pipeline(sector_cnt, e_sector, sectorno, keytype, key, &calibrate, verbose);
+    }
+
     // Iterate over each sector and key(A/B)
     for (current_sector_i = 0; current_sector_i < sector_cnt; current_sector_i++) {
 
@@ -2885,24 +3351,7 @@ noValidKeyFound:
                 if (bytes_to_num(tmp_key, MIFARE_KEY_SIZE) != 0) {
                     // <!> The fast check --> mfCheckKeys_fast(sector_cnt, true, true, 2, 1, tmp_key, e_sector, false, verbose);
                     // <!> Returns false keys, so we just stick to the slower mfchk.
-                    for (int i = 0; i < sector_cnt; i++) {
-                        for (int j = MF_KEY_A; j <= MF_KEY_B; j++) {
-                            // Check if the sector key is already broken
-                            if (e_sector[i].foundKey[j])
-                                continue;
-
-                            // Check if the key works
-                            if (mfCheckKeys(mfFirstBlockOfSector(i), j, true, 1, tmp_key, &key64) == PM3_SUCCESS) {
-                                e_sector[i].Key[j] = bytes_to_num(tmp_key, MIFARE_KEY_SIZE);
-                                e_sector[i].foundKey[j] = 'R';
-                                PrintAndLogEx(SUCCESS, "target sector %3u key type %c -- found valid key [ " _GREEN_("%s") " ]",
-                                              i,
-                                              (j == MF_KEY_B) ? 'B' : 'A',
-                                              sprint_hex_inrow(tmp_key, sizeof(tmp_key))
-                                             );
-                            }
-                        }
-                    }
+                    mf_autopwn_reuse_key(sector_cnt, e_sector, tmp_key);
                 }
                 // Clear the last found key
                 num_to_bytes(0, MIFARE_KEY_SIZE, tmp_key);
@@ -3044,7 +3493,7 @@ tryHardnested: // If the nested attack fails then we try the hardnested attack
                         }
 
                         foundkey = 0;
-                        isOK = mfnestedhard(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, NULL, false, false, slow, 0, &foundkey, NULL);
+                        isOK = mfnestedhard(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, NULL, false, false, slow, false, false, 0, &foundkey, NULL);
                         DropField();
                         if (isOK != PM3_SUCCESS) {
                             switch (isOK) {
@@ -3097,7 +3546,7 @@ tryStaticnested:
                                           (current_key_type_i == MF_KEY_B) ? 'B' : 'A');
                         }
 
-                        isOK = mfStaticNested(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key);
+                        isOK = mfStaticNested(mfFirstBlockOfSector(sectorno), keytype, key, mfFirstBlockOfSector(current_sector_i), current_key_type_i, tmp_key, false);
                         DropField();
                         switch (isOK) {
                             case PM3_ETIMEOUT: {
@@ -3150,6 +3599,7 @@ all_found:
     if (createMfcKeyDump(fptr, sector_cnt, e_sector) != PM3_SUCCESS) {
         PrintAndLogEx(ERR, "Failed to save keys to file");
     }
+    mfc_keystore_update(card.uid, card.uidlen, sector_cnt, e_sector);
 
     // clear emulator mem
     clearCommandBuffer();
@@ -3226,7 +3676,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
                   "hf mf fchk --1k -f mfc_default_keys.dic        --> Target 1K using default dictionary file\n"
                   "hf mf fchk --1k --emu                          --> Target 1K, write keys to emulator memory\n"
                   "hf mf fchk --1k --dump                         --> Target 1K, write keys to file\n"
-                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory");
+                  "hf mf fchk --1k --mem                          --> Target 1K, use dictionary from flash memory\n"
+                  "hf mf fchk --1k -f mfc_default_keys.dic --stream --> Target 1K, stream dictionary to device");
 
     void *argtable[] = {
         arg_param_begin,
@@ -3239,6 +3690,7 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
         arg_lit0(NULL, "dump", "Dump found keys to binary file"),
         arg_lit0(NULL, "mem", "Use dictionary from flashmemory"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_lit0(NULL, "stream", "Push keys to device while it checks them, no wait per keychunk"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -3260,10 +3712,17 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 9), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
 
+    bool use_stream = arg_get_lit(ctx, 10);
+
     CLIParserFree(ctx);
 
     //validations
 
+    if (use_flashmemory && use_stream) {
+        PrintAndLogEx(WARNING, "Can't stream dictionary from flash memory");
+        return PM3_EINVARG;
+    }
+
     if ((m0 + m1 + m2 + m4) > 1) {
         PrintAndLogEx(WARNING, "Only specify one MIFARE Type");
         return PM3_EINVARG;
@@ -3310,6 +3769,8 @@ static int CmdHF14AMfChk_fast(const char *Cmd) {
     if (use_flashmemory) {
         PrintAndLogEx(SUCCESS, "Using dictionary in flash memory");
         mfCheckKeys_fast(sectorsCnt, true, true, 1, 0, keyBlock, e_sector, use_flashmemory, false);
+    } else if (use_stream) {
+        mfCheckKeys_stream(sectorsCnt, keyBlock, keycnt, e_sector, false);
     } else {
 
         // strategys. 1= deep first on sector 0 AB,  2= width first on all sectors
@@ -3402,6 +3863,8 @@ out:
             }
         }
 
+        mfc_keystore_update_current(sectorsCnt, e_sector);
+
         if (createDumpFile) {
 
             char *fptr = GenerateFilename("hf-mf-", "-key.bin");
@@ -3421,13 +3884,16 @@ out:
 static int CmdHF14AMfSmartBrute(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hf mf brute",
-                  "This is a smart bruteforce, exploiting common patterns, bugs and bad designs in key generators.",
+                  "This is a smart bruteforce, exploiting common patterns, bugs and bad designs in key generators.\n"
+                  "The keys are generated and tested on the device, only found keys are sent back.",
                   "hf mf brute --mini           --> Key recovery against MIFARE Mini\n"
                   "hf mf brute --1k               --> Key recovery against MIFARE Classic 1k\n"
                   "hf mf brute --2k                --> Key recovery against MIFARE 2k\n"
                   "hf mf brute --4k                --> Key recovery against MIFARE 4k\n"
                   "hf mf brute --1k --emu                          --> Target 1K, write keys to emulator memory\n"
-                  "hf mf brute --1k --dump                         --> Target 1K, write keys to file\n");
+                  "hf mf brute --1k --dump                         --> Target 1K, write keys to file\n"
+                  "hf mf brute --1k --mode range --begin 00000000 --end 0000FFFF  --> Target 1K, try keys 0x000000000000 - 0x00000000FFFF\n"
+                  "hf mf brute --1k --mode charset --digits         --> Target 1K, try all keys made of ASCII digits\n");
 
     void *argtable[] = {
         arg_param_begin,
@@ -3437,6 +3903,12 @@ static int CmdHF14AMfSmartBrute(const char *Cmd) {
         arg_lit0(NULL, "4k", "MIFARE Classic 4k / S70"),
         arg_lit0(NULL, "emu", "Fill simulator keys from found keys"),
         arg_lit0(NULL, "dump", "Dump found keys to binary file"),
+        arg_str0(NULL, "mode", "<str>", "Bruteforce mode (range|charset|smart), default smart"),
+        arg_str0(NULL, "begin", "<hex>", "Range mode - start of the key range, 4 bytes"),
+        arg_str0(NULL, "end", "<hex>", "Range mode - end of the key range, 4 bytes"),
+        arg_lit0(NULL, "digits", "Charset mode - include ASCII codes for digits"),
+        arg_lit0(NULL, "uppercase", "Charset mode - include ASCII codes for uppercase letters"),
+        arg_lit0("v", "verbose", "verbose output"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -3450,6 +3922,26 @@ static int CmdHF14AMfSmartBrute(const char *Cmd) {
     bool transferToEml = arg_get_lit(ctx, 6);
     bool createDumpFile = arg_get_lit(ctx, 7);
 
+    char mode[64] = {0};
+    int mode_len = sizeof(mode) - 1;
+    CLIGetStrWithReturn(ctx, 8, (uint8_t *)mode, &mode_len);
+
+    int begin_len = 0;
+    uint8_t begin[4] = {0x0};
+    CLIGetHexWithReturn(ctx, 9, begin, &begin_len);
+
+    int end_len = 0;
+    uint8_t end[4] = {0x0};
+    CLIGetHexWithReturn(ctx, 10, end, &end_len);
+
+    uint8_t charset = 0;
+    if (arg_get_lit(ctx, 11))
+        charset |= BF_CHARSET_DIGITS;
+    if (arg_get_lit(ctx, 12))
+        charset |= BF_CHARSET_UPPERCASE;
+
+    bool verbose = arg_get_lit(ctx, 13);
+
     CLIParserFree(ctx);
 
     //validations
@@ -3475,88 +3967,62 @@ static int CmdHF14AMfSmartBrute(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    uint32_t chunksize = 100 > (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE) ? (PM3_CMD_DATA_SIZE / MIFARE_KEY_SIZE) : 100;
-    uint8_t *keyBlock = calloc(MIFARE_KEY_SIZE, chunksize);
+    uint8_t bf_mode = BF_MODE_SMART;
+    uint32_t range_low = 0, range_high = 0;
 
-    if (keyBlock == NULL)
-        return PM3_EMALLOC;
+    if (mode_len == 0 || strcmp(mode, "smart") == 0) {
+        bf_mode = BF_MODE_SMART;
+    } else if (strcmp(mode, "range") == 0) {
+        bf_mode = BF_MODE_RANGE;
+    } else if (strcmp(mode, "charset") == 0) {
+        bf_mode = BF_MODE_CHARSET;
+    } else {
+        PrintAndLogEx(FAILED, "Unknown bruteforce mode: %s", mode);
+        return PM3_EINVARG;
+    }
+
+    if (bf_mode == BF_MODE_RANGE) {
+        if (begin_len != 4 || end_len != 4) {
+            PrintAndLogEx(FAILED, "'begin' and 'end' parameters must be 4 bytes");
+            return PM3_EINVARG;
+        }
+        range_low = BYTES2UINT32_BE(begin);
+        range_high = BYTES2UINT32_BE(end);
+        if (range_low > range_high) {
+            PrintAndLogEx(FAILED, "'begin' must not be larger than 'end'");
+            return PM3_EINVARG;
+        }
+        PrintAndLogEx(INFO, "Trying " _YELLOW_("%u") " keys in range [ %012X, %012X ]", range_high - range_low + 1, range_low, range_high);
+    } else if (bf_mode == BF_MODE_CHARSET) {
+        if (charset == 0) {
+            PrintAndLogEx(FAILED, "Please enable at least one charset when using charset bruteforce mode.");
+            return PM3_EINVARG;
+        }
+        PrintAndLogEx(INFO, "Enabled charsets: %s%s",
+                      (charset & BF_CHARSET_DIGITS) ? "digits " : "",
+                      (charset & BF_CHARSET_UPPERCASE) ? "uppercase " : "");
+    }
 
     // create/initialize key storage structure
     sector_t *e_sector = NULL;
     if (initSectorTable(&e_sector, sectorsCnt) != PM3_SUCCESS) {
-        free(keyBlock);
         return PM3_EMALLOC;
     }
 
-    // initialize bruteforce engine
-    generator_context_t bctx;
-    bf_generator_init(&bctx, BF_MODE_SMART, BF_KEY_SIZE_48);
-
-    int i = 0, ret;
-    int smart_mode_stage = -1;
-    uint64_t generator_key;
-
-    // time
+    int i;
     uint64_t t0 = msclock();
-    uint64_t t1 = msclock();
-    uint64_t keys_checked = 0;
     uint64_t total_keys_checked = 0;
 
-    uint32_t keycnt = 0;
-    bool firstChunk = true, lastChunk = false;
-
-    while (!lastChunk) {
-        keycnt = 0;
-
-        // generate block of keys from generator
-        memset(keyBlock, 0, MIFARE_KEY_SIZE * chunksize);
-        for (i = 0; i < chunksize; i++) {
-            ret = bf_generate(&bctx);
-            if (ret == BF_GENERATOR_ERROR) {
-                PrintAndLogEx(ERR, "Internal bruteforce generator error");
-                free(keyBlock);
-                free(e_sector);
-                return PM3_EFAILED;
-            } else if (ret == BF_GENERATOR_END) {
-                lastChunk = true;
-                break;
-            } else if (ret == BF_GENERATOR_NEXT) {
-                generator_key = bf_get_key48(&bctx);
-                num_to_bytes(generator_key, MIFARE_KEY_SIZE, keyBlock + (i * MIFARE_KEY_SIZE));
-                keycnt++;
-
-                if (smart_mode_stage != bctx.smart_mode_stage) {
-                    smart_mode_stage = bctx.smart_mode_stage;
-                    PrintAndLogEx(INFO, "Running bruteforce stage %d", smart_mode_stage);
-
-                    if (msclock() - t1 > 0 && keys_checked > 0) {
-                        PrintAndLogEx(INFO, "Current cracking speed (keys/s): %lu",
-                                      keys_checked / ((msclock() - t1) / 1000));
-
-                        t1 = msclock();
-                        keys_checked = 0;
-                    }
-                }
-            }
-        }
-
-        int strategy = 2; // width first on all sectors
-        ret = mfCheckKeys_fast(sectorsCnt, firstChunk, lastChunk, strategy, keycnt, keyBlock, e_sector, false, false);
-
-        keys_checked += keycnt;
-        total_keys_checked += keycnt;
-
-        if (firstChunk)
-            firstChunk = false;
-
-        if (ret == PM3_SUCCESS || ret == 2)
-            goto out;
-
+    // keys are generated and tested width first on all sectors by the device
+    int ret = mfCheckKeys_gen(sectorsCnt, bf_mode, charset, range_low, range_high, e_sector, &total_keys_checked, verbose);
+    if (ret == PM3_EINVARG) {
+        PrintAndLogEx(ERR, "Internal bruteforce generator error");
+    } else if (ret == PM3_ECARDEXCHANGE) {
+        PrintAndLogEx(WARNING, "Can't select card");
     }
 
-out:
     PrintAndLogEx(INFO, "Time in brute mode: " _YELLOW_("%.1fs") "\n", (float)((msclock() - t0) / 1000.0));
-    PrintAndLogEx(INFO, "Total keys checked: " _YELLOW_("%lu") "\n", total_keys_checked);
+    PrintAndLogEx(INFO, "Total keys checked: " _YELLOW_("%" PRIu64) "\n", total_keys_checked);
     // check..
     uint8_t found_keys = 0;
     for (i = 0; i < sectorsCnt; ++i) {
@@ -3604,6 +4070,8 @@ out:
             }
         }
 
+        mfc_keystore_update_current(sectorsCnt, e_sector);
+
         if (createDumpFile) {
 
             char *fptr = GenerateFilename("hf-mf-", "-key.bin");
@@ -3615,7 +4083,6 @@ out:
         }
     }
 
-    free(keyBlock);
     free(e_sector);
     PrintAndLogEx(NORMAL, "");
     return PM3_SUCCESS;
@@ -3882,6 +4349,8 @@ out:
         PrintAndLogEx(SUCCESS, "Found keys have been transferred to the emulator memory");
     }
 
+    mfc_keystore_update_current(sectors_cnt, e_sector);
+
     if (createDumpFile) {
         char *fptr = GenerateFilename("hf-mf-", "-key.bin");
         if (createMfcKeyDump(fptr, sectors_cnt, e_sector) != PM3_SUCCESS) {
@@ -3912,7 +4381,7 @@ void showSectorTable(sector_t *k_sector, size_t k_sectors_cnt) {
     }
 }
 
-void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, nonces_t data, bool setEmulatorMem, bool verbose) {
+void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, const nonces_t *data, size_t count, bool setEmulatorMem, bool verbose) {
 
     // init if needed
     if (k_sector == NULL) {
@@ -3921,18 +4390,48 @@ void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, nonces_t data, bool
         }
     }
 
-    uint64_t key = 0;
-    if (mfkey32_moebius(&data, &key)) {
-        uint8_t sector = data.sector;
-        uint8_t keytype = data.keytype;
+    uint64_t *keys = calloc(count, sizeof(uint64_t));
+    bool *found = calloc(count, sizeof(bool));
+    if (keys == NULL || found == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        free(keys);
+        free(found);
+        free(k_sector);
+        return;
+    }
+
+    uint32_t solved = mfkey32_moebius_batch(data, count, keys, found);
+    if (verbose && count > 1) {
+        PrintAndLogEx(INFO, "Solved " _YELLOW_("%u") " of %zu nonce pairs", solved, count);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+
+        if (found[i] == false) {
+            if (verbose) {
+                PrintAndLogEx(INFO, "No key for sector %02d key %s nonce pair", data[i].sector, (data[i].keytype == MF_KEY_B) ? "B" : "A");
+            }
+            continue;
+        }
+
+        uint8_t sector = data[i].sector;
+        uint8_t keytype = data[i].keytype;
+        if (sector >= k_sectors_cnt) {
+            continue;
+        }
+
+        // same key already reported for this sector
+        if (k_sector[sector].foundKey[keytype] && k_sector[sector].Key[keytype] == keys[i]) {
+            continue;
+        }
 
         PrintAndLogEx(INFO, "Reader is trying authenticate with: Key %s, sector %02d: [%012" PRIx64 "]"
                       , (keytype == MF_KEY_B) ? "B" : "A"
                       , sector
-                      , key
+                      , keys[i]
                      );
 
-        k_sector[sector].Key[keytype] = key;
+        k_sector[sector].Key[keytype] = keys[i];
         k_sector[sector].foundKey[keytype] = true;
 
         //set emulator memory for keys
@@ -3949,6 +4448,8 @@ void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, nonces_t data, bool
         }
     }
 
+    free(keys);
+    free(found);
     free(k_sector);
 }
 
@@ -4142,9 +4643,22 @@ static int CmdHF14AMfSim(const char *Cmd) {
             if ((resp.oldarg[0] & 0xffff) != CMD_HF_MIFARE_SIMULATE)
                 break;
 
-            nonces_t data[1];
-            memcpy(data, resp.data.asBytes, sizeof(data));
-            readerAttack(k_sector, k_sectors_cnt, data[0], setEmulatorMem, verbose);
+            // nml pairs first,  moebius pairs after,  only the ones with both reader responses collected.
+            // The device packs the enum of nonces_t in one byte,  walk the entries with its stride
+            nonces_t data[MFSIM_ATTACK_KEY_COUNT * 2];
+            size_t stride = resp.length / ARRAYLEN(data);
+            size_t n = 0;
+            for (size_t i = 0; i < ARRAYLEN(data) && stride >= offsetof(nonces_t, state); i++) {
+                memset(&data[n], 0, sizeof(nonces_t));
+                memcpy(&data[n], resp.data.asBytes + (i * stride), offsetof(nonces_t, state));
+                if (data[n].ar == 0 || data[n].ar2 == 0)
+                    continue;
+                // same tag challenge for both responses
+                if (i < MFSIM_ATTACK_KEY_COUNT)
+                    data[n].nonce2 = data[n].nonce;
+                data[n++].state = SECOND;
+            }
+            readerAttack(k_sector, k_sectors_cnt, data, n, setEmulatorMem, verbose);
             break;
         }
         //iceman:  readerAttack call frees k_sector.  this call below is useless.
@@ -4582,12 +5096,24 @@ int CmdHF14AMfELoad(const char *Cmd) {
     PrintAndLogEx(INFO, "Uploading to emulator memory");
     PrintAndLogEx(INFO, "." NOLF);
 
-    // fast push mode
-    g_conn.block_after_ACK = true;
-
     size_t offset = 0;
     int cnt = 0;
 
+    // bulk upload, falls back to block chunks on older firmware
+    uint32_t n = MIN(bytes_read / block_width, (size_t)block_cnt) * block_width;
+    res = UploadEmlToDevice(data, n, 0, FPGA_BITSTREAM_HF);
+    if (res == PM3_SUCCESS) {
+        cnt = n / block_width;
+        bytes_read = 0;
+    } else if (res != PM3_ENOTIMPL) {
+        PrintAndLogEx(FAILED, "Can't set emulator mem");
+        free(data);
+        return PM3_ESOFT;
+    }
+
+    // fast push mode
+    g_conn.block_after_ACK = true;
+
     // 12 is the size of the struct the fct mfEmlSetMem_xt uses to transfer to device
     uint16_t max_avail_blocks = ((PM3_CMD_DATA_SIZE - 12) / block_width) * block_width;
 
@@ -7603,12 +8129,14 @@ static int CmdHF14AMfView(const char *Cmd) {
         PrintAndLogEx(INFO, "File size %zu bytes, file blocks %d (0x%x)", bytes_read, block_cnt, block_cnt);
     }
 
+    PrintAndLogBufferStart();
     mf_print_blocks(block_cnt, dump, verbose);
 
     if (verbose) {
         mf_print_keys(block_cnt, dump);
         mf_analyse_acl(block_cnt, dump);
     }
+    PrintAndLogBufferStop();
 
     if (save_keys) {
         mf_save_keys_from_arr(block_cnt, dump);
@@ -8460,13 +8988,24 @@ static int CmdHF14AGen4Save(const char *Cmd) {
     if (fill_emulator) {
         PrintAndLogEx(INFO, "uploading to emulator memory");
         PrintAndLogEx(INFO, "." NOLF);
-        // fast push mode
-        g_conn.block_after_ACK = true;
 
         size_t offset = 0;
         int cnt = 0;
         uint16_t bytes_left = bytes ;
 
+        // bulk upload, falls back to block chunks on older firmware
+        int ures = UploadEmlToDevice(dump, bytes, 0, FPGA_BITSTREAM_HF);
+        if (ures == PM3_SUCCESS) {
+            bytes_left = 0;
+        } else if (ures != PM3_ENOTIMPL) {
+            PrintAndLogEx(FAILED, "Can't set emulator mem");
+            free(dump);
+            return PM3_ESOFT;
+        }
+
+        // fast push mode
+        g_conn.block_after_ACK = true;
+
         // 12 is the size of the struct the fct mfEmlSetMem_xt uses to transfer to device
         uint16_t max_avail_blocks = ((PM3_CMD_DATA_SIZE - 12) / MFBLOCK_SIZE) * MFBLOCK_SIZE;
 
@@ -9474,10 +10013,16 @@ static int CmdHF14AMfInfo(const char *Cmd) {
 
     PrintAndLogEx(NORMAL, "");
     PrintAndLogEx(INFO, "--- " _CYAN_("Magic Tag Information"));
-    if (detect_mf_magic(true, MF_KEY_B, e_sector[0].Key[MF_KEY_B]) == MAGIC_FLAG_NONE) {
-        if (detect_mf_magic(true, MF_KEY_A, e_sector[0].Key[MF_KEY_A]) == MAGIC_FLAG_NONE) {
-            PrintAndLogEx(INFO, "<N/A>");
-        }
+    uint16_t magic = detect_mf_magic(true, MF_KEY_B, e_sector[0].Key[MF_KEY_B]);
+
+    // only the CUID write probe uses the key,  a second pass with key A is worth it only when it differs
+    if (magic == MAGIC_FLAG_NONE && e_sector[0].foundKey[MF_KEY_A] &&
+            (e_sector[0].foundKey[MF_KEY_B] == false || e_sector[0].Key[MF_KEY_A] != e_sector[0].Key[MF_KEY_B])) {
+        magic = detect_mf_magic(true, MF_KEY_A, e_sector[0].Key[MF_KEY_A]);
+    }
+
+    if (magic == MAGIC_FLAG_NONE) {
+        PrintAndLogEx(INFO, "<N/A>");
     }
 
     free(keyBlock);
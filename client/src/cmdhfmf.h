@@ -31,7 +31,10 @@ int CmdHFMFNDEFFormat(const char *Cmd);  // used by "nfc mf cformat"
 int CmdHFMFNDEFWrite(const char *Cmd);  // used by "nfc mf cwrite"
 
 void showSectorTable(sector_t *k_sector, size_t k_sectors_cnt);
-void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, nonces_t data, bool setEmulatorMem, bool verbose);
+// keep same as ATTACK_KEY_COUNT in armsrc/mifaresim.c
+#define MFSIM_ATTACK_KEY_COUNT  7
+
+void readerAttack(sector_t *k_sector, size_t k_sectors_cnt, const nonces_t *data, size_t count, bool setEmulatorMem, bool verbose);
 void printKeyTable(size_t sectorscnt, sector_t *e_sector);
 void printKeyTableEx(size_t sectorscnt, sector_t *e_sector, uint8_t start_sector);
 // void printKeyTableEx(size_t sectorscnt, sector_t *e_sector, uint8_t start_sector, bool singel_sector);
@@ -34,6 +34,7 @@
 #include "iso7816/iso7816core.h"    // APDU logging
 #include "util_posix.h"             // msleep
 #include "mifare/desfirecore.h"
+#include "mifare/mifare4.h"         // mfpdesCheckKeys
 #include "mifare/desfiretest.h"
 #include "mifare/desfiresecurechan.h"
 #include "mifare/mifaredefault.h"   // default keys
@@ -459,23 +460,11 @@ int desfire_print_signature(uint8_t *uid, uint8_t uidlen, uint8_t *signature, si
     };
 
 
-    uint32_t i;
-    bool is_valid = false;
-
-    for (i = 0; i < ARRAYLEN(nxp_desfire_public_keys); i++) {
-
-        int dl = 0;
-        uint8_t key[PUBLIC_DESFIRE_ECDA_KEYLEN];
-        param_gethex_to_eol(nxp_desfire_public_keys[i].value, 0, key, PUBLIC_DESFIRE_ECDA_KEYLEN, &dl);
-
-        int res = ecdsa_signature_r_s_verify(MBEDTLS_ECP_DP_SECP224R1, key, uid, uidlen, signature, signature_len, false);
-        is_valid = (res == 0);
-        if (is_valid)
-            break;
-    }
+    int i = ecdsa_signature_r_s_find_key(MBEDTLS_ECP_DP_SECP224R1, nxp_desfire_public_keys, ARRAYLEN(nxp_desfire_public_keys), uid, uidlen, signature, signature_len, false);
+    bool is_valid = (i >= 0);
 //    PrintAndLogEx(NORMAL, "");
 //    PrintAndLogEx(INFO, "--- " _CYAN_("Tag Signature"));
-    if (is_valid == false || i == ARRAYLEN(nxp_desfire_public_keys)) {
+    if (is_valid == false) {
         PrintAndLogEx(INFO, "    Elliptic curve parameters: NID_secp224r1");
         PrintAndLogEx(INFO, "             TAG IC Signature: %s", sprint_hex_inrow(signature, 16));
         PrintAndLogEx(INFO, "                             : %s", sprint_hex_inrow(signature + 16, 16));
@@ -969,6 +958,42 @@ static void DesFill2bPattern(
     (*startPattern)++;
 }
 
+// checks one key type of the selected application on the device.  Plain EV1 authentication only,
+// the key derivation and the other secure channels stay on the client.
+static int AuthCheckDesfireDevice(const uint8_t *aid, uint8_t algo, const char *algoname, const int *usedkeys,
+                                  const uint8_t *keys, uint8_t keylen, uint32_t keycnt,
+                                  uint8_t foundKeys[0xE][24 + 1], bool *result) {
+
+    uint32_t curaid = (aid[0] & 0xFF) + ((aid[1] & 0xFF) << 8) + ((aid[2] & 0xFF) << 16);
+
+    uint8_t slots[16] = {0};
+    int32_t found[128];
+    for (uint8_t i = 0; i < ARRAYLEN(found); i++) {
+        found[i] = -1;
+    }
+
+    for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
+        if (usedkeys[keyno] == 1 && foundKeys[keyno][0] == 0) {
+            slots[keyno / 8] |= (1 << (keyno % 8));
+        }
+    }
+
+    int res = mfpdesCheckKeys(CMD_HF_DESFIRE_CHKKEYS, algo, aid, slots, keys, keylen, keycnt, found, false);
+    PrintAndLogEx(NORMAL, "");
+
+    for (uint8_t keyno = 0; keyno < 0xE; keyno++) {
+        if (found[keyno] < 0) {
+            continue;
+        }
+        const uint8_t *key = keys + (found[keyno] * keylen);
+        PrintAndLogEx(SUCCESS, "AID 0x%06X, Found %-5s Key %02u        : " _GREEN_("%s"), curaid, algoname, keyno, sprint_hex(key, keylen));
+        foundKeys[keyno][0] = 0x01;
+        *result = true;
+        memcpy(&foundKeys[keyno][1], key, keylen);
+    }
+    return res;
+}
+
 static int AuthCheckDesfire(DesfireContext_t *dctx,
                             DesfireSecureChannel secureChannel,
                             const uint8_t *aid,
@@ -1058,6 +1083,32 @@ static int AuthCheckDesfire(DesfireContext_t *dctx,
         PrintAndLogEx(NORMAL, "");
     }
 
+    // run the dictionary on the device,  back to the client if the device can't take it
+    if (secureChannel == DACEV1 && cmdKdfAlgo == MFDES_KDF_ALGO_NONE) {
+        DropField();
+
+        res = PM3_SUCCESS;
+        if (des && res == PM3_SUCCESS)
+            res = AuthCheckDesfireDevice(aid, MFDES_ALGO_DES, "DES", usedkeys, deskeyList[0], 8, deskeyListLen, foundKeys[0], result);
+        if (tdes && res == PM3_SUCCESS)
+            res = AuthCheckDesfireDevice(aid, MFDES_ALGO_3DES, "2TDEA", usedkeys, aeskeyList[0], 16, aeskeyListLen, foundKeys[1], result);
+        if (aes && res == PM3_SUCCESS)
+            res = AuthCheckDesfireDevice(aid, MFDES_ALGO_AES, "AES", usedkeys, aeskeyList[0], 16, aeskeyListLen, foundKeys[2], result);
+        if (k3kdes && res == PM3_SUCCESS)
+            res = AuthCheckDesfireDevice(aid, MFDES_ALGO_3K3DES, "3TDEA", usedkeys, k3kkeyList[0], 24, k3kkeyListLen, foundKeys[3], result);
+
+        if (res == PM3_SUCCESS || res == PM3_EOPABORTED) {
+            return res;
+        }
+
+        PrintAndLogEx(WARNING, "Device check failed ( %d ), checking from the client", res);
+        res = DesfireSelectAIDHex(dctx, curaid, false, 0);
+        if (res != PM3_SUCCESS) {
+            DropField();
+            return res;
+        }
+    }
+
     bool badlen = false;
 
     if (des) {
@@ -5727,12 +5778,15 @@ static int CmdHF14ADesDump(const char *Cmd) {
         return res;
     }
 
+    PrintAndLogBufferStart();
+
     res = PM3_SUCCESS;
     for (int i = 0; i < filescount; i++) {
         if (res != PM3_SUCCESS) {
             DesfireSetCommMode(&dctx, DCMPlain);
             res = DesfireSelectAndAuthenticateAppW(&dctx, securechann, selectway, id, noauth, verbose);
             if (res != PM3_SUCCESS) {
+                PrintAndLogBufferStop();
                 DropField();
                 return res;
             }
@@ -5752,6 +5806,8 @@ static int CmdHF14ADesDump(const char *Cmd) {
         res = DesfileReadFileAndPrint(&dctx, FileList[i].fileNum, RFTAuto, 0, 0, maxlength, noauth, verbose);
     }
 
+    PrintAndLogBufferStop();
+
     DropField();
     return PM3_SUCCESS;
 }
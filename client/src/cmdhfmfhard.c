@@ -32,18 +32,25 @@
 #include <time.h> // MingW
 #include <lz4frame.h>
 #include <bzlib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "commonutil.h"  // ARRAYLEN
 #include "comms.h"
 #include "proxmark3.h"
 #include "ui.h"
 #include "util_posix.h"
+#include "util.h"           // kbd_enter_pressed
 #include "crapto1/crapto1.h"
 #include "parity.h"
 #include "hardnested_bruteforce.h"
 #include "hardnested_bf_core.h"
 #include "hardnested_bitarray_core.h"
 #include "fileutils.h"
+#include "memstats.h"
 
 #define NUM_CHECK_BITFLIPS_THREADS      (num_CPUs())
 #define NUM_REDUCTION_WORKING_THREADS   (num_CPUs())
@@ -55,6 +62,9 @@
 #define STATE_FILE_TEMPLATE_RAW         "bitflip_%d_%03" PRIx16 "_states.bin"
 #define STATE_FILE_TEMPLATE_LZ4         "bitflip_%d_%03" PRIx16 "_states.bin.lz4"
 #define STATE_FILE_TEMPLATE_BZ2         "bitflip_%d_%03" PRIx16 "_states.bin.bz2"
+#define STATE_CACHE_FILE                "hardnested_tables.bin"
+#define CHECKPOINT_FILE                 "hardnested"
+#define RESUMABLE_BRUTE_FORCE_TIME      60.0    // seconds. Longer brute force runs are prepared to be resumed
 
 #define DEBUG_KEY_ELIMINATION
 // #define DEBUG_REDUCTION
@@ -254,6 +264,229 @@ static void init_bunzip2(bz_stream *compressed_stream, char *input_buffer, uint3
 
 }
 
+//----------------------------------------------------------------------------
+// Uncompressed cache of the effective bitflip tables in ~/.proxmark3/cache.
+// Written after the first decompression, later runs map it instead.
+// Tables start on page boundaries so they can be used in place.
+//----------------------------------------------------------------------------
+#define BITFLIP_CACHE_MAGIC             0x4E483350  // "P3HN"
+#define BITFLIP_CACHE_VERSION           1
+#define BITFLIP_CACHE_ALIGN             4096
+#define BITFLIP_TABLE_SIZE              (sizeof(uint32_t) * (1 << 19))
+
+// bitarrays are accounted in `hw memstats`. All of them are BITFLIP_TABLE_SIZE,  except the candidates one
+static uint32_t *hn_malloc_bitarray(uint32_t x) {
+    uint32_t *p = malloc_bitarray(x);
+    if (p != NULL) {
+        memstats_alloc(MEMSTATS_HARDNESTED, x);
+    }
+    return p;
+}
+
+static void hn_free_bitarray_sized(uint32_t *p, uint32_t x) {
+    if (p == NULL) {
+        return;
+    }
+    free_bitarray(p);
+    memstats_free(MEMSTATS_HARDNESTED, x);
+}
+
+static void hn_free_bitarray(uint32_t *p) {
+    hn_free_bitarray_sized(p, BITFLIP_TABLE_SIZE);
+}
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t num_tables;
+    float threshold;
+    uint32_t table_size;
+} PACKED bitflip_cache_header_t;
+
+typedef struct {
+    uint16_t odd_even;
+    uint16_t bitflip;
+    uint32_t count;
+    uint64_t offset;
+} PACKED bitflip_cache_entry_t;
+
+static uint8_t *bitflip_cache_map = NULL;
+static size_t bitflip_cache_mapsize = 0;
+
+static size_t bitflip_cache_data_offset(uint16_t num_tables) {
+    size_t hdr = sizeof(bitflip_cache_header_t) + num_tables * sizeof(bitflip_cache_entry_t);
+    return (hdr + BITFLIP_CACHE_ALIGN - 1) & ~(size_t)(BITFLIP_CACHE_ALIGN - 1);
+}
+
+static void reset_bitflip_bitarrays(void) {
+    for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+        num_effective_bitflips[odd_even] = 0;
+        for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
+            bitflip_bitarrays[odd_even][bitflip] = NULL;
+            count_bitflip_bitarrays[odd_even][bitflip] = 1 << 24;
+        }
+    }
+}
+
+static bool load_bitflip_cache(void) {
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, STATE_CACHE_FILE, false) != PM3_SUCCESS) {
+        return false;
+    }
+
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL) {
+        return false;
+    }
+
+    bitflip_cache_header_t hdr;
+    bitflip_cache_entry_t entries[2 * 0x400];
+    bool ok = (fread(&hdr, sizeof(hdr), 1, f) == 1)
+              && hdr.magic == BITFLIP_CACHE_MAGIC
+              && hdr.version == BITFLIP_CACHE_VERSION
+              && hdr.threshold == (float)IGNORE_BITFLIP_THRESHOLD
+              && hdr.table_size == BITFLIP_TABLE_SIZE
+              && hdr.num_tables > 0
+              && hdr.num_tables <= ARRAYLEN(entries)
+              && fread(entries, sizeof(bitflip_cache_entry_t), hdr.num_tables, f) == hdr.num_tables;
+
+    long fsize = -1;
+    if (ok && fseek(f, 0, SEEK_END) == 0) {
+        fsize = ftell(f);
+    }
+
+    // entries must be sorted like the resource files were read
+    int prev = -1;
+    for (uint16_t i = 0; ok && i < hdr.num_tables; i++) {
+        int cur = entries[i].odd_even * 0x400 + entries[i].bitflip;
+        ok = entries[i].odd_even <= ODD_STATE
+             && entries[i].bitflip > 0 && entries[i].bitflip < 0x400
+             && cur > prev
+             && (entries[i].offset % BITFLIP_CACHE_ALIGN) == 0
+             && entries[i].offset >= bitflip_cache_data_offset(hdr.num_tables)
+             && fsize > 0
+             && entries[i].offset + BITFLIP_TABLE_SIZE <= (uint64_t)fsize;
+        prev = cur;
+    }
+
+    if (ok == false) {
+        fclose(f);
+        return false;
+    }
+
+#ifdef _WIN32
+    // no mmap, still saves the decompression
+    for (uint16_t i = 0; ok && i < hdr.num_tables; i++) {
+        uint32_t *bitset = (uint32_t *)hn_malloc_bitarray(BITFLIP_TABLE_SIZE);
+        ok = (bitset != NULL)
+             && fseek(f, (long)entries[i].offset, SEEK_SET) == 0
+             && fread(bitset, BITFLIP_TABLE_SIZE, 1, f) == 1;
+        bitflip_bitarrays[entries[i].odd_even][entries[i].bitflip] = bitset;
+    }
+    fclose(f);
+    if (ok == false) {
+        for (uint16_t i = 0; i < hdr.num_tables; i++) {
+            hn_free_bitarray(bitflip_bitarrays[entries[i].odd_even][entries[i].bitflip]);
+        }
+        reset_bitflip_bitarrays();
+        return false;
+    }
+#else
+    void *map = mmap(NULL, (size_t)fsize, PROT_READ, MAP_SHARED, fileno(f), 0);
+    fclose(f);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    bitflip_cache_map = map;
+    bitflip_cache_mapsize = (size_t)fsize;
+    for (uint16_t i = 0; i < hdr.num_tables; i++) {
+        bitflip_bitarrays[entries[i].odd_even][entries[i].bitflip] = (uint32_t *)(bitflip_cache_map + entries[i].offset);
+    }
+#endif
+
+    for (uint16_t i = 0; i < hdr.num_tables; i++) {
+        odd_even_t odd_even = entries[i].odd_even;
+        effective_bitflip[odd_even][num_effective_bitflips[odd_even]++] = entries[i].bitflip;
+        count_bitflip_bitarrays[odd_even][entries[i].bitflip] = entries[i].count;
+    }
+    effective_bitflip[EVEN_STATE][num_effective_bitflips[EVEN_STATE]] = 0x400; // EndOfList marker
+    effective_bitflip[ODD_STATE][num_effective_bitflips[ODD_STATE]] = 0x400;
+    return true;
+}
+
+static void save_bitflip_cache(void) {
+
+    bitflip_cache_header_t hdr = {
+        .magic = BITFLIP_CACHE_MAGIC,
+        .version = BITFLIP_CACHE_VERSION,
+        .num_tables = num_effective_bitflips[EVEN_STATE] + num_effective_bitflips[ODD_STATE],
+        .threshold = IGNORE_BITFLIP_THRESHOLD,
+        .table_size = BITFLIP_TABLE_SIZE,
+    };
+
+    if (hdr.num_tables == 0) {
+        return;
+    }
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, NULL, true) != PM3_SUCCESS) {
+        return;
+    }
+    free(path);
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, STATE_CACHE_FILE, true) != PM3_SUCCESS) {
+        return;
+    }
+
+    // write next to it and rename, parallel runs never see a partial file
+    char tmppath[strlen(path) + 16];
+    snprintf(tmppath, sizeof(tmppath), "%s.%u", path, (unsigned int)(msclock() & 0xFFFFFF));
+
+    FILE *f = fopen(tmppath, "wb");
+    if (f == NULL) {
+        free(path);
+        return;
+    }
+
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1);
+
+    uint64_t offset = bitflip_cache_data_offset(hdr.num_tables);
+    for (odd_even_t odd_even = EVEN_STATE; ok && odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t i = 0; ok && i < num_effective_bitflips[odd_even]; i++) {
+            uint16_t bitflip = effective_bitflip[odd_even][i];
+            bitflip_cache_entry_t e = {
+                .odd_even = odd_even,
+                .bitflip = bitflip,
+                .count = count_bitflip_bitarrays[odd_even][bitflip],
+                .offset = offset,
+            };
+            ok = (fwrite(&e, sizeof(e), 1, f) == 1);
+            offset += BITFLIP_TABLE_SIZE;
+        }
+    }
+
+    ok = ok && (fseek(f, (long)bitflip_cache_data_offset(hdr.num_tables), SEEK_SET) == 0);
+    for (odd_even_t odd_even = EVEN_STATE; ok && odd_even <= ODD_STATE; odd_even++) {
+        for (uint16_t i = 0; ok && i < num_effective_bitflips[odd_even]; i++) {
+            ok = (fwrite(bitflip_bitarrays[odd_even][effective_bitflip[odd_even][i]], BITFLIP_TABLE_SIZE, 1, f) == 1);
+        }
+    }
+
+    ok &= (fclose(f) == 0);
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (ok == false || rename(tmppath, path) != 0) {
+        remove(tmppath);
+    } else {
+        PrintAndLogEx(DEBUG, "Saved bitflip tables to " _YELLOW_("%s"), path);
+    }
+    free(path);
+}
+
 static void init_bitflip_bitarrays(void) {
 #if defined (DEBUG_REDUCTION)
     uint8_t line = 0;
@@ -263,6 +496,15 @@ static void init_bitflip_bitarrays(void) {
     char state_file_name[MAX(strlen(STATE_FILE_TEMPLATE_RAW), MAX(strlen(STATE_FILE_TEMPLATE_LZ4), strlen(STATE_FILE_TEMPLATE_BZ2))) + 1];
     char state_files_path[strlen(get_my_executable_directory()) + strlen(STATE_FILES_DIRECTORY) + sizeof(state_file_name)];
     uint16_t nraw = 0, nlz4 = 0, nbz2 = 0;
+
+    reset_bitflip_bitarrays();
+    if (load_bitflip_cache()) {
+        char progress_text[80];
+        snprintf(progress_text, sizeof(progress_text), "Loaded %u tables from cache in %"PRIu64" ms", num_effective_bitflips[EVEN_STATE] + num_effective_bitflips[ODD_STATE], msclock() - init_bitflip_bitarrays_starttime);
+        hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+        goto sort;
+    }
+
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
         num_effective_bitflips[odd_even] = 0;
         for (uint16_t bitflip = 0x001; bitflip < 0x400; bitflip++) {
@@ -324,7 +566,7 @@ static void init_bitflip_bitarrays(void) {
                 }
 
                 if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+                    uint32_t *bitset = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
                     if (bitset == NULL) {
                         PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
                         fclose(statesfile);
@@ -410,7 +652,7 @@ static void init_bitflip_bitarrays(void) {
                 memcpy(&count, uncompressed_data, sizeof(uint32_t));
 
                 if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+                    uint32_t *bitset = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
                     if (bitset == NULL) {
                         PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
                         free(uncompressed_data);
@@ -453,7 +695,7 @@ static void init_bitflip_bitarrays(void) {
                     exit(4);
                 }
                 if ((float)count / (1 << 24) < IGNORE_BITFLIP_THRESHOLD) {
-                    uint32_t *bitset = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+                    uint32_t *bitset = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
                     if (bitset == NULL) {
                         PrintAndLogEx(ERR, "Out of memory error in init_bitflip_statelists(). Aborting...\n");
                         BZ2_bzDecompressEnd(&compressed_stream);
@@ -490,6 +732,12 @@ static void init_bitflip_bitarrays(void) {
         snprintf(progress_text, sizeof(progress_text), "Loaded %u RAW / %u LZ4 / %u BZ2 in %"PRIu64" ms", nraw, nlz4, nbz2, msclock() - init_bitflip_bitarrays_starttime);
         hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
     }
+    if (nlz4 + nbz2 > 0) {
+        save_bitflip_cache();
+    }
+
+sort:
+    ;
     uint16_t i = 0;
     uint16_t j = 0;
     num_all_effective_bitflips = 0;
@@ -532,11 +780,20 @@ static void init_bitflip_bitarrays(void) {
 }
 
 static void free_bitflip_bitarrays(void) {
+#ifndef _WIN32
+    if (bitflip_cache_map != NULL) {
+        munmap(bitflip_cache_map, bitflip_cache_mapsize);
+        bitflip_cache_map = NULL;
+        bitflip_cache_mapsize = 0;
+        reset_bitflip_bitarrays();
+        return;
+    }
+#endif
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
-        free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
+        hn_free_bitarray(bitflip_bitarrays[ODD_STATE][bitflip]);
     }
     for (int16_t bitflip = 0x3ff; bitflip > 0x000; bitflip--) {
-        free_bitarray(bitflip_bitarrays[EVEN_STATE][bitflip]);
+        hn_free_bitarray(bitflip_bitarrays[EVEN_STATE][bitflip]);
     }
 }
 
@@ -573,7 +830,7 @@ static uint16_t PartialSumProperty(uint32_t state, odd_even_t odd_even) {
 static void init_part_sum_bitarrays(void) {
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
         for (uint16_t part_sum_a0 = 0; part_sum_a0 < NUM_PART_SUMS; part_sum_a0++) {
-            part_sum_a0_bitarrays[odd_even][part_sum_a0] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+            part_sum_a0_bitarrays[odd_even][part_sum_a0] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
             if (part_sum_a0_bitarrays[odd_even][part_sum_a0] == NULL) {
                 PrintAndLogEx(ERR, "Out of memory error in init_part_suma0_statelists(). Aborting...\n");
                 exit(4);
@@ -593,7 +850,7 @@ static void init_part_sum_bitarrays(void) {
 
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
         for (uint16_t part_sum_a8 = 0; part_sum_a8 < NUM_PART_SUMS; part_sum_a8++) {
-            part_sum_a8_bitarrays[odd_even][part_sum_a8] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+            part_sum_a8_bitarrays[odd_even][part_sum_a8] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
             if (part_sum_a8_bitarrays[odd_even][part_sum_a8] == NULL) {
                 PrintAndLogEx(ERR, "Out of memory error in init_part_suma8_statelists(). Aborting...\n");
                 exit(4);
@@ -614,23 +871,23 @@ static void init_part_sum_bitarrays(void) {
 
 static void free_part_sum_bitarrays(void) {
     for (int16_t part_sum_a8 = (NUM_PART_SUMS - 1); part_sum_a8 >= 0; part_sum_a8--) {
-        free_bitarray(part_sum_a8_bitarrays[ODD_STATE][part_sum_a8]);
+        hn_free_bitarray(part_sum_a8_bitarrays[ODD_STATE][part_sum_a8]);
     }
     for (int16_t part_sum_a8 = (NUM_PART_SUMS - 1); part_sum_a8 >= 0; part_sum_a8--) {
-        free_bitarray(part_sum_a8_bitarrays[EVEN_STATE][part_sum_a8]);
+        hn_free_bitarray(part_sum_a8_bitarrays[EVEN_STATE][part_sum_a8]);
     }
     for (int16_t part_sum_a0 = (NUM_PART_SUMS - 1); part_sum_a0 >= 0; part_sum_a0--) {
-        free_bitarray(part_sum_a0_bitarrays[ODD_STATE][part_sum_a0]);
+        hn_free_bitarray(part_sum_a0_bitarrays[ODD_STATE][part_sum_a0]);
     }
     for (int16_t part_sum_a0 = (NUM_PART_SUMS - 1); part_sum_a0 >= 0; part_sum_a0--) {
-        free_bitarray(part_sum_a0_bitarrays[EVEN_STATE][part_sum_a0]);
+        hn_free_bitarray(part_sum_a0_bitarrays[EVEN_STATE][part_sum_a0]);
     }
 }
 
 static void init_sum_bitarrays(void) {
     for (uint16_t sum_a0 = 0; sum_a0 < NUM_SUMS; sum_a0++) {
         for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-            sum_a0_bitarrays[odd_even][sum_a0] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+            sum_a0_bitarrays[odd_even][sum_a0] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
             if (sum_a0_bitarrays[odd_even][sum_a0] == NULL) {
                 PrintAndLogEx(ERR, "Out of memory error in init_sum_bitarrays(). Aborting...\n");
                 exit(4);
@@ -652,8 +909,8 @@ static void init_sum_bitarrays(void) {
 
 static void free_sum_bitarrays(void) {
     for (int8_t sum_a0 = NUM_SUMS - 1; sum_a0 >= 0; sum_a0--) {
-        free_bitarray(sum_a0_bitarrays[ODD_STATE][sum_a0]);
-        free_bitarray(sum_a0_bitarrays[EVEN_STATE][sum_a0]);
+        hn_free_bitarray(sum_a0_bitarrays[ODD_STATE][sum_a0]);
+        hn_free_bitarray(sum_a0_bitarrays[EVEN_STATE][sum_a0]);
     }
 }
 
@@ -742,14 +999,14 @@ static void init_nonce_memory(void) {
         for (uint16_t bitflip = 0x000; bitflip < 0x400; bitflip++) {
             nonces[i].BitFlips[bitflip] = 0;
         }
-        nonces[i].states_bitarray[EVEN_STATE] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+        nonces[i].states_bitarray[EVEN_STATE] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
         if (nonces[i].states_bitarray[EVEN_STATE] == NULL) {
             PrintAndLogEx(ERR, "Out of memory error in init_nonce_memory(). Aborting...\n");
             exit(4);
         }
         set_bitarray24(nonces[i].states_bitarray[EVEN_STATE]);
         nonces[i].num_states_bitarray[EVEN_STATE] = 1 << 24;
-        nonces[i].states_bitarray[ODD_STATE] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+        nonces[i].states_bitarray[ODD_STATE] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
         if (nonces[i].states_bitarray[ODD_STATE] == NULL) {
             PrintAndLogEx(ERR, "Out of memory error in init_nonce_memory(). Aborting...\n");
             exit(4);
@@ -777,8 +1034,8 @@ static void free_nonces_memory(void) {
         free_nonce_list(nonces[i].first);
     }
     for (int i = 255; i >= 0; i--) {
-        free_bitarray(nonces[i].states_bitarray[ODD_STATE]);
-        free_bitarray(nonces[i].states_bitarray[EVEN_STATE]);
+        hn_free_bitarray(nonces[i].states_bitarray[ODD_STATE]);
+        hn_free_bitarray(nonces[i].states_bitarray[EVEN_STATE]);
     }
 }
 
@@ -848,7 +1105,7 @@ static uint32_t part_sum_count[2][NUM_PART_SUMS][NUM_PART_SUMS];
 
 static void init_allbitflips_array(void) {
     for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-        uint32_t *bitset = all_bitflips_bitarray[odd_even] = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * (1 << 19));
+        uint32_t *bitset = all_bitflips_bitarray[odd_even] = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * (1 << 19));
         if (bitset == NULL) {
             PrintAndLogEx(WARNING, "Out of memory in init_allbitflips_array(). Aborting...");
             exit(4);
@@ -1198,7 +1455,52 @@ static void estimate_sum_a8(void) {
     }
 }
 
-static int read_nonce_file(char *filename) {
+// nonce file layout: cuid, target block and key type followed by pairs of encrypted nonces
+static int read_nonces(const uint8_t *buf, size_t len, uint8_t *trgBlockNo, uint8_t *trgKeyType, bool verbose) {
+
+    num_acquired_nonces = 0;
+    if (len < 6) {
+        PrintAndLogEx(ERR, "File reading error.");
+        return PM3_EFILE;
+    }
+
+    cuid = bytes_to_num(buf, 4);
+    *trgBlockNo = bytes_to_num(buf + 4, 1);
+    *trgKeyType = bytes_to_num(buf + 5, 1);
+
+    for (size_t i = 6; i + 9 <= len; i += 9) {
+        uint32_t nt_enc1 = bytes_to_num(buf + i, 4);
+        uint32_t nt_enc2 = bytes_to_num(buf + i + 4, 4);
+        uint8_t par_enc = bytes_to_num(buf + i + 8, 1);
+        add_nonce(nt_enc1, par_enc >> 4);
+        add_nonce(nt_enc2, par_enc & 0x0f);
+        num_acquired_nonces += 2;
+    }
+
+    if (verbose) {
+        char progress_string[80];
+        snprintf(progress_string, sizeof(progress_string), "Read %u nonces from file. cuid = %08x", num_acquired_nonces, cuid);
+        hardnested_print_progress(num_acquired_nonces, progress_string, (float)(1LL << 47), 0);
+        snprintf(progress_string, sizeof(progress_string), "Target Block=%d, Keytype=%c", *trgBlockNo, *trgKeyType == 0 ? 'A' : 'B');
+        hardnested_print_progress(num_acquired_nonces, progress_string, (float)(1LL << 47), 0);
+    }
+
+    bool got_match = false;
+    for (uint8_t i = 0; i < NUM_SUMS; i++) {
+        if (first_byte_Sum == sums[i]) {
+            first_byte_Sum = i;
+            got_match = true;
+            break;
+        }
+    }
+    if (got_match == false) {
+        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
+        return PM3_ESOFT;
+    }
+    return PM3_SUCCESS;
+}
+
+static int read_nonce_file(char *filename, uint8_t *trgBlockNo, uint8_t *trgKeyType) {
 
     if (filename == NULL) {
         PrintAndLogEx(WARNING, "Filename is NULL");
@@ -1206,9 +1508,7 @@ static int read_nonce_file(char *filename) {
     }
     FILE *fnonces = NULL;
     char progress_text[80] = "";
-    uint8_t read_buf[9];
 
-    num_acquired_nonces = 0;
     if ((fnonces = fopen(filename, "rb")) == NULL) {
         PrintAndLogEx(WARNING, "Could not open file " _YELLOW_("%s"), filename);
         return PM3_EFILE;
@@ -1216,47 +1516,70 @@ static int read_nonce_file(char *filename) {
 
     snprintf(progress_text, 80, "Reading nonces from file " _YELLOW_("%s"), filename);
     hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
-    size_t bytes_read = fread(read_buf, 1, 6, fnonces);
-    if (bytes_read != 6) {
+
+    fseek(fnonces, 0, SEEK_END);
+    long fsize = ftell(fnonces);
+    fseek(fnonces, 0, SEEK_SET);
+    if (fsize < 0) {
         PrintAndLogEx(ERR, "File reading error.");
         fclose(fnonces);
         return PM3_EFILE;
     }
-    cuid = bytes_to_num(read_buf, 4);
-    uint8_t trgBlockNo = bytes_to_num(read_buf + 4, 1);
-    uint8_t trgKeyType = bytes_to_num(read_buf + 5, 1);
 
-    bytes_read = fread(read_buf, 1, 9, fnonces);
-    while (bytes_read == 9) {
-        uint32_t nt_enc1 = bytes_to_num(read_buf, 4);
-        uint32_t nt_enc2 = bytes_to_num(read_buf + 4, 4);
-        uint8_t par_enc = bytes_to_num(read_buf + 8, 1);
-        add_nonce(nt_enc1, par_enc >> 4);
-        add_nonce(nt_enc2, par_enc & 0x0f);
-        num_acquired_nonces += 2;
-        bytes_read = fread(read_buf, 1, 9, fnonces);
+    uint8_t *buf = calloc(fsize + 1, sizeof(uint8_t));
+    if (buf == NULL) {
+        fclose(fnonces);
+        return PM3_EMALLOC;
     }
+    size_t bytes_read = fread(buf, 1, fsize, fnonces);
     fclose(fnonces);
 
-    char progress_string[80];
-    snprintf(progress_string, sizeof(progress_string), "Read %u nonces from file. cuid = %08x", num_acquired_nonces, cuid);
-    hardnested_print_progress(num_acquired_nonces, progress_string, (float)(1LL << 47), 0);
-    snprintf(progress_string, sizeof(progress_string), "Target Block=%d, Keytype=%c", trgBlockNo, trgKeyType == 0 ? 'A' : 'B');
-    hardnested_print_progress(num_acquired_nonces, progress_string, (float)(1LL << 47), 0);
+    int res = read_nonces(buf, bytes_read, trgBlockNo, trgKeyType, true);
+    free(buf);
+    return res;
+}
 
-    bool got_match = false;
-    for (uint8_t i = 0; i < NUM_SUMS; i++) {
-        if (first_byte_Sum == sums[i]) {
-            first_byte_Sum = i;
-            got_match = true;
-            break;
+// all distinct nonces in the nonce file layout, saved with the brute force checkpoint
+static uint8_t *nonce_image(uint8_t trgBlockNo, uint8_t trgKeyType, uint32_t *len) {
+    uint32_t num = 0;
+    for (uint16_t i = 0; i < 256; i++) {
+        for (noncelistentry_t *p = nonces[i].first; p != NULL; p = p->next) {
+            num++;
         }
     }
-    if (got_match == false) {
-        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-        return PM3_ESOFT;
+
+    *len = 6 + ((num + 1) / 2) * 9;
+    uint8_t *buf = calloc(*len, sizeof(uint8_t));
+    if (buf == NULL) {
+        *len = 0;
+        return NULL;
     }
-    return PM3_SUCCESS;
+    num_to_bytes(cuid, 4, buf);
+    buf[4] = trgBlockNo;
+    buf[5] = trgKeyType;
+
+    uint8_t *bufp = buf + 6;
+    noncelistentry_t *first = NULL;
+    for (uint16_t i = 0; i < 256; i++) {
+        for (noncelistentry_t *p = nonces[i].first; p != NULL; p = p->next) {
+            if (first == NULL) {
+                first = p;
+                continue;
+            }
+            num_to_bytes(first->nonce_enc, 4, bufp);
+            num_to_bytes(p->nonce_enc, 4, bufp + 4);
+            bufp[8] = (first->par_enc << 4) | (p->par_enc & 0x0f);
+            bufp += 9;
+            first = NULL;
+        }
+    }
+    // odd count, the duplicate is dropped again by add_nonce()
+    if (first) {
+        num_to_bytes(first->nonce_enc, 4, bufp);
+        num_to_bytes(first->nonce_enc, 4, bufp + 4);
+        bufp[8] = (first->par_enc << 4) | (first->par_enc & 0x0f);
+    }
+    return buf;
 }
 
 static noncelistentry_t *SearchFor2ndByte(uint8_t b1, uint8_t b2) {
@@ -1275,122 +1598,125 @@ static bool timeout(void) {
 }
 
 
-static void
-#ifdef __has_attribute
-#if __has_attribute(force_align_arg_pointer)
-__attribute__((force_align_arg_pointer))
-#endif
-#endif
-*check_for_BitFlipProperties_thread(void *args) {
-    uint8_t first_byte = ((uint8_t *)args)[0];
-    uint8_t last_byte = ((uint8_t *)args)[1];
-    uint8_t time_budget = ((uint8_t *)args)[2];
+// first bytes are handed out one at a time from a shared counter, so threads which got
+// cheap bytes keep pulling work instead of idling while others finish a long range
+static uint16_t bitflip_next_byte;
+static bool bitflip_stage_incomplete;
 
-    if (hardnested_stage & CHECK_1ST_BYTES) {
-        // for (uint16_t bitflip = 0x001; bitflip < 0x200; bitflip++) {
-        for (uint16_t bitflip_idx = 0; bitflip_idx < num_1st_byte_effective_bitflips; bitflip_idx++) {
-            uint16_t bitflip = all_effective_bitflip[bitflip_idx];
-            if (time_budget && timeout()) {
+static void check_1st_byte_bitflips(uint16_t i, bool time_budget) {
+    for (uint16_t bitflip_idx = 0; bitflip_idx < num_1st_byte_effective_bitflips; bitflip_idx++) {
+        uint16_t bitflip = all_effective_bitflip[bitflip_idx];
+        if (time_budget && timeout()) {
 #if defined (DEBUG_REDUCTION)
-                PrintAndLogEx(INFO, "break at bitflip_idx " _YELLOW_("%d") " ...", bitflip_idx);
+            PrintAndLogEx(INFO, "break at byte " _YELLOW_("%d") " bitflip_idx " _YELLOW_("%d") " ...", i, bitflip_idx);
 #endif
-                return NULL;
-            }
-            for (uint16_t i = first_byte; i <= last_byte; i++) {
+            __atomic_store_n(&bitflip_stage_incomplete, true, __ATOMIC_RELAXED);
+            return;
+        }
 
-                if (nonces[i].BitFlips[bitflip] == 0 && nonces[i].BitFlips[bitflip ^ 0x100] == 0
-                        && nonces[i].first != NULL && nonces[i ^ (bitflip & 0xff)].first != NULL) {
+        if (nonces[i].BitFlips[bitflip] == 0 && nonces[i].BitFlips[bitflip ^ 0x100] == 0
+                && nonces[i].first != NULL && nonces[i ^ (bitflip & 0xff)].first != NULL) {
 
-                    uint8_t parity1 = (nonces[i].first->par_enc) >> 3;                  // parity of first byte
-                    uint8_t parity2 = (nonces[i ^ (bitflip & 0xff)].first->par_enc) >> 3; // parity of nonce with bits flipped
+            uint8_t parity1 = (nonces[i].first->par_enc) >> 3;                  // parity of first byte
+            uint8_t parity2 = (nonces[i ^ (bitflip & 0xff)].first->par_enc) >> 3; // parity of nonce with bits flipped
 
-                    if ((parity1 == parity2 && !(bitflip & 0x100))          // bitflip
-                            || (parity1 != parity2 && (bitflip & 0x100))) {     // not bitflip
+            if ((parity1 == parity2 && !(bitflip & 0x100))          // bitflip
+                    || (parity1 != parity2 && (bitflip & 0x100))) {     // not bitflip
 
-                        nonces[i].BitFlips[bitflip] = 1;
+                nonces[i].BitFlips[bitflip] = 1;
 
-                        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+                for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
 
-                            if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
-                                uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
-                                nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(nonces[i].states_bitarray[odd_even], bitflip_bitarrays[odd_even][bitflip]);
-                                if (nonces[i].num_states_bitarray[odd_even] != old_count) {
-                                    nonces[i].all_bitflips_dirty[odd_even] = true;
-                                }
-                                // PrintAndLogEx(INFO, "bitflip: %d old: %d, new: %d ", bitflip, old_count, nonces[i].num_states_bitarray[odd_even]);
-                            }
+                    if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
+                        uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
+                        nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(nonces[i].states_bitarray[odd_even], bitflip_bitarrays[odd_even][bitflip]);
+                        if (nonces[i].num_states_bitarray[odd_even] != old_count) {
+                            nonces[i].all_bitflips_dirty[odd_even] = true;
                         }
+                        // PrintAndLogEx(INFO, "bitflip: %d old: %d, new: %d ", bitflip, old_count, nonces[i].num_states_bitarray[odd_even]);
                     }
                 }
             }
-            ((uint8_t *)args)[1] = num_1st_byte_effective_bitflips - bitflip_idx - 1;  // bitflips still to go in stage 1
         }
     }
+}
 
-    ((uint8_t *)args)[1] = 0;  // stage 1 definitely completed
-
-    if (hardnested_stage & CHECK_2ND_BYTES) {
-        for (uint16_t bitflip_idx = num_1st_byte_effective_bitflips; bitflip_idx < num_all_effective_bitflips; bitflip_idx++) {
-            uint16_t bitflip = all_effective_bitflip[bitflip_idx];
-            if (time_budget && timeout()) {
+static void check_2nd_byte_bitflips(uint16_t i, bool time_budget) {
+    for (uint16_t bitflip_idx = num_1st_byte_effective_bitflips; bitflip_idx < num_all_effective_bitflips; bitflip_idx++) {
+        uint16_t bitflip = all_effective_bitflip[bitflip_idx];
+        if (time_budget && timeout()) {
 #if defined (DEBUG_REDUCTION)
-                PrintAndLogEx(INFO, "break at bitflip_idx " _YELLOW_("%d") " ...", bitflip_idx);
+            PrintAndLogEx(INFO, "break at byte " _YELLOW_("%d") " bitflip_idx " _YELLOW_("%d") " ...", i, bitflip_idx);
 #endif
-                return NULL;
-            }
-            for (uint16_t i = first_byte; i <= last_byte; i++) {
-                // Check for Bit Flip Property of 2nd bytes
-                if (nonces[i].BitFlips[bitflip] == 0) {
-                    for (uint16_t j = 0; j < 256; j++) { // for each 2nd Byte
-                        noncelistentry_t *byte1 = SearchFor2ndByte(i, j);
-                        noncelistentry_t *byte2 = SearchFor2ndByte(i, j ^ (bitflip & 0xff));
-                        if (byte1 != NULL && byte2 != NULL) {
-                            uint8_t parity1 = byte1->par_enc >> 2 & 0x01; // parity of 2nd byte
-                            uint8_t parity2 = byte2->par_enc >> 2 & 0x01; // parity of 2nd byte with bits flipped
-                            if ((parity1 == parity2 && !(bitflip & 0x100)) // bitflip
-                                    || (parity1 != parity2 && (bitflip & 0x100))) { // not bitflip
-                                nonces[i].BitFlips[bitflip] = 1;
-                                for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
-                                    if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
-                                        uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
-                                        nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(nonces[i].states_bitarray[odd_even], bitflip_bitarrays[odd_even][bitflip]);
-                                        if (nonces[i].num_states_bitarray[odd_even] != old_count) {
-                                            nonces[i].all_bitflips_dirty[odd_even] = true;
-                                        }
-                                    }
+            __atomic_store_n(&bitflip_stage_incomplete, true, __ATOMIC_RELAXED);
+            return;
+        }
+        // Check for Bit Flip Property of 2nd bytes
+        if (nonces[i].BitFlips[bitflip] == 0) {
+            for (uint16_t j = 0; j < 256; j++) { // for each 2nd Byte
+                noncelistentry_t *byte1 = SearchFor2ndByte(i, j);
+                noncelistentry_t *byte2 = SearchFor2ndByte(i, j ^ (bitflip & 0xff));
+                if (byte1 != NULL && byte2 != NULL) {
+                    uint8_t parity1 = byte1->par_enc >> 2 & 0x01; // parity of 2nd byte
+                    uint8_t parity2 = byte2->par_enc >> 2 & 0x01; // parity of 2nd byte with bits flipped
+                    if ((parity1 == parity2 && !(bitflip & 0x100)) // bitflip
+                            || (parity1 != parity2 && (bitflip & 0x100))) { // not bitflip
+                        nonces[i].BitFlips[bitflip] = 1;
+                        for (odd_even_t odd_even = EVEN_STATE; odd_even <= ODD_STATE; odd_even++) {
+                            if (bitflip_bitarrays[odd_even][bitflip] != NULL) {
+                                uint32_t old_count = nonces[i].num_states_bitarray[odd_even];
+                                nonces[i].num_states_bitarray[odd_even] = count_bitarray_AND(nonces[i].states_bitarray[odd_even], bitflip_bitarrays[odd_even][bitflip]);
+                                if (nonces[i].num_states_bitarray[odd_even] != old_count) {
+                                    nonces[i].all_bitflips_dirty[odd_even] = true;
                                 }
-                                break;
                             }
                         }
+                        break;
                     }
                 }
-                // PrintAndLogEx(INFO, "states_bitarray[0][%" PRIu16 "] contains %d ones.\n", i, count_states(nonces[i].states_bitarray[EVEN_STATE]));
-                // PrintAndLogEx(INFO, "states_bitarray[1][%" PRIu16 "] contains %d ones.\n", i, count_states(nonces[i].states_bitarray[ODD_STATE]));
             }
         }
+        // PrintAndLogEx(INFO, "states_bitarray[0][%" PRIu16 "] contains %d ones.\n", i, count_states(nonces[i].states_bitarray[EVEN_STATE]));
+        // PrintAndLogEx(INFO, "states_bitarray[1][%" PRIu16 "] contains %d ones.\n", i, count_states(nonces[i].states_bitarray[ODD_STATE]));
     }
+}
 
+static void
+#ifdef __has_attribute
+#if __has_attribute(force_align_arg_pointer)
+__attribute__((force_align_arg_pointer))
+#endif
+#endif
+*check_for_BitFlipProperties_thread(void *args) {
+    uint8_t stage = ((uint8_t *)args)[0];
+    bool time_budget = ((uint8_t *)args)[1];
+
+    for (;;) {
+        uint16_t i = __atomic_fetch_add(&bitflip_next_byte, 1, __ATOMIC_RELAXED);
+        if (i > 255 || __atomic_load_n(&bitflip_stage_incomplete, __ATOMIC_RELAXED)) {
+            break;
+        }
+        if (stage == CHECK_1ST_BYTES) {
+            check_1st_byte_bitflips(i, time_budget);
+        } else {
+            check_2nd_byte_bitflips(i, time_budget);
+        }
+    }
     return NULL;
 }
 
-static void check_for_BitFlipProperties(bool time_budget) {
+static bool check_for_BitFlipProperties_stage(uint8_t stage, bool time_budget) {
     // create and run worker threads
     const size_t num_check_bitflip_threads = NUM_CHECK_BITFLIPS_THREADS;
     pthread_t thread_id[num_check_bitflip_threads];
+    uint8_t args[2] = { stage, time_budget };
 
-    uint8_t args[num_check_bitflip_threads][3];
-    uint16_t bytes_per_thread = (256 + (num_check_bitflip_threads / 2)) / num_check_bitflip_threads;
-    for (uint32_t i = 0; i < num_check_bitflip_threads; i++) {
-        args[i][0] = i * bytes_per_thread;
-        args[i][1] = MIN(args[i][0] + bytes_per_thread - 1, 255);
-        args[i][2] = time_budget;
-    }
-    // args[][] is uint8_t so max 255, no need to check it
-    // args[num_check_bitflip_threads - 1][1] = MAX(args[num_check_bitflip_threads - 1][1], 255);
+    bitflip_next_byte = 0;
+    bitflip_stage_incomplete = false;
 
     // start threads
     for (uint32_t i = 0; i < num_check_bitflip_threads; i++) {
-        pthread_create(&thread_id[i], NULL, check_for_BitFlipProperties_thread, args[i]);
+        pthread_create(&thread_id[i], NULL, check_for_BitFlipProperties_thread, args);
     }
 
     // wait for threads to terminate:
@@ -1398,13 +1724,24 @@ static void check_for_BitFlipProperties(bool time_budget) {
         pthread_join(thread_id[i], NULL);
     }
 
+    return (bitflip_stage_incomplete == false);
+}
+
+static void check_for_BitFlipProperties(bool time_budget) {
+
+    bool stage1_completed = true;
+    if (hardnested_stage & CHECK_1ST_BYTES) {
+        stage1_completed = check_for_BitFlipProperties_stage(CHECK_1ST_BYTES, time_budget);
+    }
+
+    if (stage1_completed && (hardnested_stage & CHECK_2ND_BYTES)) {
+        check_for_BitFlipProperties_stage(CHECK_2ND_BYTES, time_budget);
+    }
+
     if (hardnested_stage & CHECK_2ND_BYTES) {
         hardnested_stage &= ~CHECK_1ST_BYTES; // we are done with 1st stage, except...
-        for (uint32_t i = 0; i < num_check_bitflip_threads; i++) {
-            if (args[i][1] != 0) {
-                hardnested_stage |= CHECK_1ST_BYTES;  // ... when any of the threads didn't complete in time
-                break;
-            }
+        if (stage1_completed == false) {
+            hardnested_stage |= CHECK_1ST_BYTES;  // ... when any of the threads didn't complete in time
         }
     }
 #if defined (DEBUG_REDUCTION)
@@ -1546,6 +1883,297 @@ static int simulate_acquire_nonces(void) {
     return PM3_SUCCESS;
 }
 
+static void add_nonce_batch(uint16_t num_sampled_nonces, const uint8_t *bufp) {
+    for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
+        uint32_t nt_enc1 = bytes_to_num(bufp, 4);
+        uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
+        uint8_t par_enc = bytes_to_num(bufp + 8, 1);
+
+        //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
+        num_acquired_nonces += add_nonce(nt_enc1, par_enc >> 4);
+        //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
+        num_acquired_nonces += add_nonce(nt_enc2, par_enc & 0x0f);
+        bufp += 9;
+    }
+}
+
+static void write_nonce_batch(FILE *fnonces, uint16_t num_sampled_nonces, const uint8_t *bufp) {
+    fwrite(bufp, 9, num_sampled_nonces / 2, fnonces);
+    fflush(fnonces);
+}
+
+static int write_nonce_file_header(FILE **fnonces, const char *filename, uint8_t trgBlockNo, uint8_t trgKeyType) {
+    if ((*fnonces = fopen(filename, "wb")) == NULL) {
+        PrintAndLogEx(WARNING, "Could not create file " _YELLOW_("%s"), filename);
+        return PM3_EFILE;
+    }
+
+    char progress_text[80];
+    snprintf(progress_text, sizeof(progress_text), "Writing acquired nonces to binary file " _YELLOW_("%s"), filename);
+    hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+
+    uint8_t write_buf[4];
+    num_to_bytes(cuid, 4, write_buf);
+    fwrite(write_buf, 1, 4, *fnonces);
+    fwrite(&trgBlockNo, 1, 1, *fnonces);
+    fwrite(&trgKeyType, 1, 1, *fnonces);
+    fflush(*fnonces);
+    return PM3_SUCCESS;
+}
+
+// update the sums and estimates with everything added so far and check if we have enough nonces
+static int analyse_nonces(bool *reported_suma8, bool *acquisition_completed) {
+    float brute_force_depth;
+
+    if (first_byte_num == 256) {
+        if (hardnested_stage == CHECK_1ST_BYTES) {
+            bool got_match = false;
+            for (uint8_t i = 0; i < NUM_SUMS; i++) {
+                if (first_byte_Sum == sums[i]) {
+                    first_byte_Sum = i;
+                    got_match = true;
+                    break;
+                }
+            }
+
+            if (got_match == false) {
+                PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
+                return PM3_EWRONGANSWER;
+            }
+
+            hardnested_stage |= CHECK_2ND_BYTES;
+            apply_sum_a0();
+        }
+        update_nonce_data(true);
+        *acquisition_completed = shrink_key_space(&brute_force_depth);
+        if (*reported_suma8 == false) {
+            char progress_string[80];
+            snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
+            hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
+            *reported_suma8 = true;
+        } else {
+            hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+        }
+    } else {
+        update_nonce_data(true);
+        *acquisition_completed = shrink_key_space(&brute_force_depth);
+        hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+    }
+    return PM3_SUCCESS;
+}
+
+// Streaming acquisition. The device sends batches without waiting for the client while
+// a separate thread feeds them into the analysis. Batches that arrive during an analysis
+// round are queued and taken in one go by the next round.
+typedef struct nonce_batch_s {
+    uint16_t num;
+    uint8_t data[PM3_CMD_DATA_SIZE];
+    struct nonce_batch_s *next;
+} nonce_batch_t;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    nonce_batch_t *head;
+    nonce_batch_t *tail;
+    uint64_t period;        // average time between two batches
+    bool stop;              // reader is done, no more batches will come
+    bool completed;         // analysis has found enough nonces
+    int res;
+} nonce_stream = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+};
+
+static void nonce_stream_push(uint16_t num, const uint8_t *data) {
+    nonce_batch_t *b = calloc(1, sizeof(nonce_batch_t));
+    if (b == NULL) {
+        return;
+    }
+    b->num = MIN(num, (PM3_CMD_DATA_SIZE / 9) * 2);
+    memcpy(b->data, data, PM3_CMD_DATA_SIZE);
+
+    pthread_mutex_lock(&nonce_stream.mutex);
+    if (nonce_stream.tail) {
+        nonce_stream.tail->next = b;
+    } else {
+        nonce_stream.head = b;
+    }
+    nonce_stream.tail = b;
+    pthread_cond_signal(&nonce_stream.cond);
+    pthread_mutex_unlock(&nonce_stream.mutex);
+}
+
+static void *analyse_nonces_thread(void *args) {
+    (void)args;
+    bool reported_suma8 = false;
+
+    for (;;) {
+        pthread_mutex_lock(&nonce_stream.mutex);
+        while (nonce_stream.head == NULL && nonce_stream.stop == false) {
+            pthread_cond_wait(&nonce_stream.cond, &nonce_stream.mutex);
+        }
+        nonce_batch_t *batches = nonce_stream.head;
+        nonce_stream.head = nonce_stream.tail = NULL;
+        sample_period = nonce_stream.period;
+        pthread_mutex_unlock(&nonce_stream.mutex);
+
+        if (batches == NULL) {
+            break;
+        }
+
+        last_sample_clock = msclock();
+        while (batches) {
+            nonce_batch_t *b = batches;
+            add_nonce_batch(b->num, b->data);
+            batches = b->next;
+            free(b);
+        }
+
+        bool completed = false;
+        int res = analyse_nonces(&reported_suma8, &completed);
+
+        pthread_mutex_lock(&nonce_stream.mutex);
+        nonce_stream.res = res;
+        nonce_stream.completed = completed;
+        bool stop = nonce_stream.stop;
+        pthread_mutex_unlock(&nonce_stream.mutex);
+
+        if (res != PM3_SUCCESS || completed || stop) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static int acquire_nonces_stream(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
+
+    hardnested_stage = CHECK_1ST_BYTES;
+    num_acquired_nonces = 0;
+    last_sample_clock = msclock();
+
+    // initial rough estimate. Will be refined.
+    sample_period = 2000;
+
+    nonce_stream.head = nonce_stream.tail = NULL;
+    nonce_stream.period = sample_period;
+    nonce_stream.stop = false;
+    nonce_stream.completed = false;
+    nonce_stream.res = PM3_SUCCESS;
+
+    FILE *fnonces = NULL;
+    PacketResponseNG resp;
+
+    uint32_t flags = 0x0001 | HARDNESTED_FLAG_STREAM;
+    flags |= slow ? 0x0002 : 0;
+    clearCommandBuffer();
+    SendCommandMIX(CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES, blockNo + keyType * 0x100, trgBlockNo + trgKeyType * 0x100, flags, key, 6);
+
+    if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
+        DropField();
+        return PM3_ETIMEOUT;
+    }
+
+    // error during nested_hard
+    if (resp.oldarg[0]) {
+        DropField();
+        return resp.oldarg[0];
+    }
+
+    cuid = resp.oldarg[1];
+    if (nonce_file_write) {
+        if (write_nonce_file_header(&fnonces, filename, trgBlockNo, trgKeyType) != PM3_SUCCESS) {
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            DropField();
+            return PM3_EFILE;
+        }
+    }
+
+    pthread_t analysis_thread;
+    pthread_create(&analysis_thread, NULL, analyse_nonces_thread, NULL);
+
+    int res = PM3_SUCCESS;
+    bool break_sent = false;
+    uint64_t stream_start = msclock();
+    uint32_t num_batches = 0;
+
+    for (;;) {
+
+        uint16_t num = resp.oldarg[2] & 0xFFFF;
+        bool last = (resp.oldarg[2] & HARDNESTED_STREAM_LAST);
+
+        if (resp.oldarg[0] && res == PM3_SUCCESS) {
+            res = resp.oldarg[0];
+        }
+
+        // once the client has asked to stop, late batches are of no use anymore
+        if (break_sent == false && num > 0) {
+            if (nonce_file_write) {
+                write_nonce_batch(fnonces, num, resp.data.asBytes);
+            }
+            nonce_stream_push(num, resp.data.asBytes);
+        }
+
+        if (last || res != PM3_SUCCESS) {
+            break;
+        }
+
+        // batches may arrive in bursts, only the average rate is meaningful
+        num_batches++;
+        pthread_mutex_lock(&nonce_stream.mutex);
+        nonce_stream.period = MAX((msclock() - stream_start) / num_batches, 1);
+        bool done = nonce_stream.completed || nonce_stream.res != PM3_SUCCESS;
+        pthread_mutex_unlock(&nonce_stream.mutex);
+
+        if (done && break_sent == false) {
+            // any command ends the stream, the device answers with a last batch
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            break_sent = true;
+        }
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            break_sent = true;
+            res = PM3_EOPABORTED;
+        }
+
+        if (WaitForResponseTimeout(CMD_ACK, &resp, 3000) == false) {
+            res = PM3_ETIMEOUT;
+            break;
+        }
+    }
+
+    DropField();
+
+    pthread_mutex_lock(&nonce_stream.mutex);
+    nonce_stream.stop = true;
+    pthread_cond_signal(&nonce_stream.cond);
+    pthread_mutex_unlock(&nonce_stream.mutex);
+    pthread_join(analysis_thread, NULL);
+
+    while (nonce_stream.head) {
+        nonce_batch_t *b = nonce_stream.head;
+        nonce_stream.head = b->next;
+        free(b);
+    }
+    nonce_stream.tail = NULL;
+
+    if (fnonces) {
+        fclose(fnonces);
+    }
+
+    if (nonce_stream.res != PM3_SUCCESS) {
+        return nonce_stream.res;
+    }
+
+    if (nonce_stream.completed == false) {
+        // the device stopped early, make sure we did finish the analysis at least
+        return (res == PM3_SUCCESS) ? PM3_ESOFT : res;
+    }
+    return PM3_SUCCESS;
+}
+
 static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool nonce_file_write, bool slow, char *filename) {
 
     last_sample_clock = msclock();
@@ -1560,8 +2188,6 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
     bool acquisition_completed = false;
     bool reported_suma8 = false;
 
-    float brute_force_depth;
-
     FILE *fnonces = NULL;
 
     // init to ZERO
@@ -1578,9 +2204,6 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
     resp.oldarg[2] = 0;
     memset(resp.data.asBytes, 0, PM3_CMD_DATA_SIZE);
 
-    uint8_t write_buf[9];
-    char progress_text[80];
-
     do {
 
         if (field_off) {
@@ -1610,82 +2233,26 @@ static int acquire_nonces(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_
 
             cuid = resp.oldarg[1];
             if (nonce_file_write && fnonces == NULL) {
-
-                if ((fnonces = fopen(filename, "wb")) == NULL) {
-                    PrintAndLogEx(WARNING, "Could not create file " _YELLOW_("%s"), filename);
+                if (write_nonce_file_header(&fnonces, filename, trgBlockNo, trgKeyType) != PM3_SUCCESS) {
                     DropField();
                     return PM3_EFILE;
                 }
-
-                snprintf(progress_text, 80, "Writing acquired nonces to binary file " _YELLOW_("%s"), filename);
-                hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
-                num_to_bytes(cuid, 4, write_buf);
-                fwrite(write_buf, 1, 4, fnonces);
-                fwrite(&trgBlockNo, 1, 1, fnonces);
-                fwrite(&trgKeyType, 1, 1, fnonces);
-                fflush(fnonces);
             }
         }
 
         if (initialize == false) {
 
-            uint16_t num_sampled_nonces = resp.oldarg[2];
-            uint8_t *bufp = resp.data.asBytes;
-
-            for (uint16_t i = 0; i < num_sampled_nonces; i += 2) {
-                uint32_t nt_enc1 = bytes_to_num(bufp, 4);
-                uint32_t nt_enc2 = bytes_to_num(bufp + 4, 4);
-                uint8_t par_enc = bytes_to_num(bufp + 8, 1);
-
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc1, par_enc >> 4);
-                num_acquired_nonces += add_nonce(nt_enc1, par_enc >> 4);
-                //PrintAndLogEx(INFO, "Encrypted nonce: %08x, encrypted_parity: %02x\n", nt_enc2, par_enc & 0x0f);
-                num_acquired_nonces += add_nonce(nt_enc2, par_enc & 0x0f);
-
-                if (nonce_file_write) {
-                    fwrite(bufp, 1, 9, fnonces);
-                    fflush(fnonces);
-                }
-                bufp += 9;
+            add_nonce_batch(resp.oldarg[2], resp.data.asBytes);
+            if (nonce_file_write) {
+                write_nonce_batch(fnonces, resp.oldarg[2], resp.data.asBytes);
             }
-            //total_num_nonces += num_sampled_nonces;
-
-            if (first_byte_num == 256) {
-                if (hardnested_stage == CHECK_1ST_BYTES) {
-                    bool got_match = false;
-                    for (uint8_t i = 0; i < NUM_SUMS; i++) {
-                        if (first_byte_Sum == sums[i]) {
-                            first_byte_Sum = i;
-                            got_match = true;
-                            break;
-                        }
-                    }
 
-                    if (got_match == false) {
-                        PrintAndLogEx(FAILED, "No match for the First_Byte_Sum (%u), is the card a genuine MFC Ev1? ", first_byte_Sum);
-                        if (nonce_file_write) {
-                            fclose(fnonces);
-                        }
-                        return PM3_EWRONGANSWER;
-                    }
-
-                    hardnested_stage |= CHECK_2ND_BYTES;
-                    apply_sum_a0();
-                }
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                if (!reported_suma8) {
-                    char progress_string[80];
-                    snprintf(progress_string, sizeof(progress_string), "Apply Sum property. Sum(a0) = %d", sums[first_byte_Sum]);
-                    hardnested_print_progress(num_acquired_nonces, progress_string, brute_force_depth, 0);
-                    reported_suma8 = true;
-                } else {
-                    hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+            int res = analyse_nonces(&reported_suma8, &acquisition_completed);
+            if (res != PM3_SUCCESS) {
+                if (nonce_file_write) {
+                    fclose(fnonces);
                 }
-            } else {
-                update_nonce_data(true);
-                acquisition_completed = shrink_key_space(&brute_force_depth);
-                hardnested_print_progress(num_acquired_nonces, "Apply bit flip properties", brute_force_depth, 0);
+                return res;
             }
         }
 
@@ -1936,7 +2503,7 @@ static void add_matching_states(statelist_t *cands, uint8_t part_sum_a0, uint8_t
         exit(4);
     }
 
-    uint32_t *cands_bitarray = (uint32_t *)malloc_bitarray(sizeof(uint32_t) * worstcase_size);
+    uint32_t *cands_bitarray = (uint32_t *)hn_malloc_bitarray(sizeof(uint32_t) * worstcase_size);
     if (cands_bitarray == NULL) {
         PrintAndLogEx(ERR, "Out of memory error in add_matching_states() - bitarray.\n");
         free(cands->states[odd_even]);
@@ -1957,7 +2524,7 @@ static void add_matching_states(statelist_t *cands, uint8_t part_sum_a0, uint8_t
     } else if (cands->len[odd_even] + 1 < worstcase_size) {
         cands->states[odd_even] = realloc(cands->states[odd_even], sizeof(uint32_t) * (cands->len[odd_even] + 1));
     }
-    free_bitarray(cands_bitarray);
+    hn_free_bitarray_sized(cands_bitarray, sizeof(uint32_t) * worstcase_size);
 
     pthread_mutex_lock(&statelist_cache_mutex);
     sl_cache[part_sum_a0 / 2][part_sum_a8 / 2][odd_even].sl = cands->states[odd_even];
@@ -2054,6 +2621,12 @@ static bool TestIfKeyExists(uint64_t key) {
 
 static work_status_t book_of_work[NUM_PART_SUMS][NUM_PART_SUMS][NUM_PART_SUMS][NUM_PART_SUMS];
 
+// (p, q, r, s) combinations matching Sum(a0) and Sum(a8), shared by all worker threads
+static uint8_t candidate_tasks[NUM_PART_SUMS * NUM_PART_SUMS * NUM_PART_SUMS * NUM_PART_SUMS][4];
+static uint16_t num_candidate_tasks;
+static uint16_t candidate_task_next;  // all tasks before this one are taken
+static pthread_cond_t book_of_work_cond = PTHREAD_COND_INITIALIZER;
+
 static void init_book_of_work(void) {
     for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
         for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
@@ -2073,141 +2646,147 @@ __attribute__((force_align_arg_pointer))
 #endif
 #endif
 *generate_candidates_worker_thread(void *args) {
-    uint16_t *sum_args = (uint16_t *)args;
-    uint16_t sum_a0 = sums[sum_args[0]];
-    uint16_t sum_a8 = sums[sum_args[1]];
-    // uint16_t my_thread_number = sums[2];
-
-    bool there_might_be_more_work = true;
-    do {
-        there_might_be_more_work = false;
-        for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
-            for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
-                if (2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q == sum_a0) {
-                    // PrintAndLogEx(INFO, "Reducing Partial Statelists (p,q) = (%d,%d) with lengths %d, %d",
-                    // p, q, partial_statelist[p].len[ODD_STATE], partial_statelist[q].len[EVEN_STATE]);
-                    for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
-                        for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
-                            if (2 * r * (16 - 2 * s) + (16 - 2 * r) * 2 * s == sum_a8) {
-                                pthread_mutex_lock(&book_of_work_mutex);
-                                if (book_of_work[p][q][r][s] != TO_BE_DONE) {  // this has been done or is currently been done by another thread. Look for some other work.
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                    continue;
-                                }
+    (void)args;
+    // uint16_t my_thread_number = *(uint16_t *)args;
+
+    pthread_mutex_lock(&book_of_work_mutex);
+    for (;;) {
+        // pick the first task which is neither done nor blocked by a statelist another thread is computing
+        uint8_t p = 0, q = 0, r = 0, s = 0;
+        bool found = false;
+        bool blocked = false;
+        for (uint16_t t = candidate_task_next; t < num_candidate_tasks; t++) {
+            p = candidate_tasks[t][0];
+            q = candidate_tasks[t][1];
+            r = candidate_tasks[t][2];
+            s = candidate_tasks[t][3];
+            if (book_of_work[p][q][r][s] != TO_BE_DONE) {  // this has been done or is currently been done by another thread. Look for some other work.
+                if (t == candidate_task_next) {
+                    candidate_task_next++;
+                }
+                continue;
+            }
 
-                                pthread_mutex_lock(&statelist_cache_mutex);
-                                if (sl_cache[p][r][ODD_STATE].cache_status == WORK_IN_PROGRESS
-                                        || sl_cache[q][s][EVEN_STATE].cache_status == WORK_IN_PROGRESS) { // defer until not blocked by another thread.
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                    there_might_be_more_work = true;
-                                    continue;
-                                }
+            pthread_mutex_lock(&statelist_cache_mutex);
+            if (sl_cache[p][r][ODD_STATE].cache_status == WORK_IN_PROGRESS
+                    || sl_cache[q][s][EVEN_STATE].cache_status == WORK_IN_PROGRESS) { // defer until not blocked by another thread.
+                pthread_mutex_unlock(&statelist_cache_mutex);
+                blocked = true;
+                continue;
+            }
+            found = true;
+            break;
+        }
 
-                                // we finally can do some work.
-                                book_of_work[p][q][r][s] = WORK_IN_PROGRESS;
-                                statelist_t *current_candidates = add_more_candidates();
+        if (found == false) {
+            if (blocked == false) {
+                break;
+            }
+            // sleep until a running task completes instead of spinning over the book of work
+            pthread_cond_wait(&book_of_work_cond, &book_of_work_mutex);
+            continue;
+        }
 
-                                // Check for cached results and add them first
-                                bool odd_completed = false;
-                                if (sl_cache[p][r][ODD_STATE].cache_status == COMPLETED) {
-                                    add_cached_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                    odd_completed = true;
-                                }
-                                bool even_completed = false;
-                                if (sl_cache[q][s][EVEN_STATE].cache_status == COMPLETED) {
-                                    add_cached_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                    even_completed = true;
-                                }
+        // both mutexes are held here
+        // we finally can do some work.
+        book_of_work[p][q][r][s] = WORK_IN_PROGRESS;
+        statelist_t *current_candidates = add_more_candidates();
 
-                                bool work_required = true;
+        // Check for cached results and add them first
+        bool odd_completed = false;
+        if (sl_cache[p][r][ODD_STATE].cache_status == COMPLETED) {
+            add_cached_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
+            odd_completed = true;
+        }
+        bool even_completed = false;
+        if (sl_cache[q][s][EVEN_STATE].cache_status == COMPLETED) {
+            add_cached_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
+            even_completed = true;
+        }
 
-                                // if there had been two cached results, there is no more work to do
-                                if (even_completed && odd_completed) {
-                                    work_required = false;
-                                }
+        bool work_required = true;
 
-                                // if there had been one cached empty result, there is no need to calculate the other part:
-                                if (work_required) {
-                                    if (even_completed && !current_candidates->len[EVEN_STATE]) {
-                                        current_candidates->len[ODD_STATE] = 0;
-                                        current_candidates->states[ODD_STATE] = NULL;
-                                        work_required = false;
-                                    }
-                                    if (odd_completed && !current_candidates->len[ODD_STATE]) {
-                                        current_candidates->len[EVEN_STATE] = 0;
-                                        current_candidates->states[EVEN_STATE] = NULL;
-                                        work_required = false;
-                                    }
-                                }
+        // if there had been two cached results, there is no more work to do
+        if (even_completed && odd_completed) {
+            work_required = false;
+        }
 
-                                if (work_required == false) {
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-                                } else {
-                                    // we really need to calculate something
-                                    if (even_completed) { // we had one cache hit with non-zero even states
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on  odd states p=%2d, r=%2d...", my_thread_number, p, r);
-                                        sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        pthread_mutex_unlock(&book_of_work_mutex);
-                                        add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                        work_required = false;
-                                    } else if (odd_completed) { // we had one cache hit with non-zero odd_states
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
-                                        sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        pthread_mutex_unlock(&book_of_work_mutex);
-                                        add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                        work_required = false;
-                                    }
-                                }
+        // if there had been one cached empty result, there is no need to calculate the other part:
+        if (work_required) {
+            if (even_completed && !current_candidates->len[EVEN_STATE]) {
+                current_candidates->len[ODD_STATE] = 0;
+                current_candidates->states[ODD_STATE] = NULL;
+                work_required = false;
+            }
+            if (odd_completed && !current_candidates->len[ODD_STATE]) {
+                current_candidates->len[EVEN_STATE] = 0;
+                current_candidates->states[EVEN_STATE] = NULL;
+                work_required = false;
+            }
+        }
 
-                                if (work_required) { // we had no cached result. Need to calculate both odd and even
-                                    sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
-                                    sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
-                                    pthread_mutex_unlock(&statelist_cache_mutex);
-                                    pthread_mutex_unlock(&book_of_work_mutex);
-
-                                    add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
-                                    if (current_candidates->len[ODD_STATE]) {
-                                        // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
-                                        add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
-                                    } else { // no need to calculate even states yet
-                                        pthread_mutex_lock(&statelist_cache_mutex);
-                                        sl_cache[q][s][EVEN_STATE].cache_status = TO_BE_DONE;
-                                        pthread_mutex_unlock(&statelist_cache_mutex);
-                                        current_candidates->len[EVEN_STATE] = 0;
-                                        current_candidates->states[EVEN_STATE] = NULL;
-                                    }
-                                }
+        if (work_required == false) {
+            pthread_mutex_unlock(&statelist_cache_mutex);
+            pthread_mutex_unlock(&book_of_work_mutex);
+        } else {
+            // we really need to calculate something
+            if (even_completed) { // we had one cache hit with non-zero even states
+                // PrintAndLogEx(INFO, "Thread #%u: start working on  odd states p=%2d, r=%2d...", my_thread_number, p, r);
+                sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
+                pthread_mutex_unlock(&statelist_cache_mutex);
+                pthread_mutex_unlock(&book_of_work_mutex);
+                add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
+                work_required = false;
+            } else if (odd_completed) { // we had one cache hit with non-zero odd_states
+                // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
+                sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
+                pthread_mutex_unlock(&statelist_cache_mutex);
+                pthread_mutex_unlock(&book_of_work_mutex);
+                add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
+                work_required = false;
+            }
+        }
 
-                                // update book of work
-                                pthread_mutex_lock(&book_of_work_mutex);
-                                book_of_work[p][q][r][s] = COMPLETED;
-                                pthread_mutex_unlock(&book_of_work_mutex);
-
-                                // if ((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE]) {
-                                // PrintAndLogEx(INFO, "Candidates for p=%2u, q=%2u, r=%2u, s=%2u: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n",
-                                // 2*p, 2*q, 2*r, 2*s, current_candidates->len[ODD_STATE], current_candidates->len[EVEN_STATE],
-                                // (uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE],
-                                // log((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE])/log(2));
-                                // uint32_t estimated_odd = estimated_num_states_part_sum(best_first_bytes[0], p, r, ODD_STATE);
-                                // uint32_t estimated_even= estimated_num_states_part_sum(best_first_bytes[0], q, s, EVEN_STATE);
-                                // uint64_t estimated_total = (uint64_t)estimated_odd * estimated_even;
-                                // PrintAndLogEx(INFO, "Estimated: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n", estimated_odd, estimated_even, estimated_total, log(estimated_total) / log(2));
-                                // if (estimated_odd < current_candidates->len[ODD_STATE] || estimated_even < current_candidates->len[EVEN_STATE]) {
-                                // PrintAndLogEx(INFO, "############################################################################ERROR! ESTIMATED < REAL !!!\n");
-                                // //exit(2);
-                                // }
-                                // }
-                            }
-                        }
-                    }
-                }
+        if (work_required) { // we had no cached result. Need to calculate both odd and even
+            sl_cache[p][r][ODD_STATE].cache_status = WORK_IN_PROGRESS;
+            sl_cache[q][s][EVEN_STATE].cache_status = WORK_IN_PROGRESS;
+            pthread_mutex_unlock(&statelist_cache_mutex);
+            pthread_mutex_unlock(&book_of_work_mutex);
+
+            add_matching_states(current_candidates, 2 * p, 2 * r, ODD_STATE);
+            if (current_candidates->len[ODD_STATE]) {
+                // PrintAndLogEx(INFO, "Thread #%u: start working on even states q=%2d, s=%2d...", my_thread_number, q, s);
+                add_matching_states(current_candidates, 2 * q, 2 * s, EVEN_STATE);
+            } else { // no need to calculate even states yet
+                pthread_mutex_lock(&statelist_cache_mutex);
+                sl_cache[q][s][EVEN_STATE].cache_status = TO_BE_DONE;
+                pthread_mutex_unlock(&statelist_cache_mutex);
+                current_candidates->len[EVEN_STATE] = 0;
+                current_candidates->states[EVEN_STATE] = NULL;
             }
         }
-    } while (there_might_be_more_work);
+
+        // update book of work
+        pthread_mutex_lock(&book_of_work_mutex);
+        book_of_work[p][q][r][s] = COMPLETED;
+        pthread_cond_broadcast(&book_of_work_cond);
+
+        // if ((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE]) {
+        // PrintAndLogEx(INFO, "Candidates for p=%2u, q=%2u, r=%2u, s=%2u: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n",
+        // 2*p, 2*q, 2*r, 2*s, current_candidates->len[ODD_STATE], current_candidates->len[EVEN_STATE],
+        // (uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE],
+        // log((uint64_t)current_candidates->len[ODD_STATE] * current_candidates->len[EVEN_STATE])/log(2));
+        // uint32_t estimated_odd = estimated_num_states_part_sum(best_first_bytes[0], p, r, ODD_STATE);
+        // uint32_t estimated_even= estimated_num_states_part_sum(best_first_bytes[0], q, s, EVEN_STATE);
+        // uint64_t estimated_total = (uint64_t)estimated_odd * estimated_even;
+        // PrintAndLogEx(INFO, "Estimated: %" PRIu32 " * %" PRIu32 " = %" PRIu64 " (2^%0.1f)\n", estimated_odd, estimated_even, estimated_total, log(estimated_total) / log(2));
+        // if (estimated_odd < current_candidates->len[ODD_STATE] || estimated_even < current_candidates->len[EVEN_STATE]) {
+        // PrintAndLogEx(INFO, "############################################################################ERROR! ESTIMATED < REAL !!!\n");
+        // //exit(2);
+        // }
+        // }
+    }
+    pthread_mutex_unlock(&book_of_work_mutex);
 
     return NULL;
 }
@@ -2222,16 +2801,37 @@ static void generate_candidates(uint8_t sum_a0_idx, uint8_t sum_a8_idx) {
     init_statelist_cache();
     init_book_of_work();
 
+    // queue every combination of partial sums, threads take the next free one
+    uint16_t sum_a0 = sums[sum_a0_idx];
+    uint16_t sum_a8 = sums[sum_a8_idx];
+    num_candidate_tasks = 0;
+    candidate_task_next = 0;
+    for (uint8_t p = 0; p < NUM_PART_SUMS; p++) {
+        for (uint8_t q = 0; q < NUM_PART_SUMS; q++) {
+            if (2 * p * (16 - 2 * q) + (16 - 2 * p) * 2 * q == sum_a0) {
+                for (uint8_t r = 0; r < NUM_PART_SUMS; r++) {
+                    for (uint8_t s = 0; s < NUM_PART_SUMS; s++) {
+                        if (2 * r * (16 - 2 * s) + (16 - 2 * r) * 2 * s == sum_a8) {
+                            candidate_tasks[num_candidate_tasks][0] = p;
+                            candidate_tasks[num_candidate_tasks][1] = q;
+                            candidate_tasks[num_candidate_tasks][2] = r;
+                            candidate_tasks[num_candidate_tasks][3] = s;
+                            num_candidate_tasks++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
     // create and run worker threads
     const size_t num_reduction_working_threads = NUM_REDUCTION_WORKING_THREADS;
     pthread_t thread_id[num_reduction_working_threads];
 
-    uint16_t sums1[num_reduction_working_threads][3];
+    uint16_t thread_number[num_reduction_working_threads];
     for (uint32_t i = 0; i < num_reduction_working_threads; i++) {
-        sums1[i][0] = sum_a0_idx;
-        sums1[i][1] = sum_a8_idx;
-        sums1[i][2] = i + 1;
-        pthread_create(thread_id + i, NULL, generate_candidates_worker_thread, sums1[i]);
+        thread_number[i] = i + 1;
+        pthread_create(thread_id + i, NULL, generate_candidates_worker_thread, &thread_number[i]);
     }
 
     // wait for threads to terminate:
@@ -2282,6 +2882,14 @@ static void pre_XOR_nonces(void) {
     }
 }
 
+static float expected_brute_force_time(void) {
+    uint32_t num_odd = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[ODD_STATE];
+    uint32_t num_even = nonces[best_first_byte_smallest_bitarray].num_states_bitarray[EVEN_STATE];
+    float expected_brute_force1 = (float)num_odd * num_even / 2.0;
+    float expected_brute_force2 = nonces[best_first_bytes[0]].expected_num_brute_force;
+    return MIN(expected_brute_force1, expected_brute_force2) / brute_force_per_second;
+}
+
 static bool brute_force(uint64_t *found_key) {
     if (known_target_key != -1) {
         TestIfKeyExists(known_target_key);
@@ -2392,8 +3000,9 @@ static void init_it_all(void) {
     memset(sum_a0_bitarrays, 0, sizeof(sum_a0_bitarrays));
 }
 
-int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, int tests, uint64_t *foundkey, char *filename) {
+int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *trgkey, bool nonce_file_read, bool nonce_file_write, bool slow, bool stream, bool resume, int tests, uint64_t *foundkey, char *filename) {
     char progress_text[80];
+    char ckpt_fn[FILE_PATH_SIZE] = {0};
     char instr_set[12] = {0};
 
     get_SIMD_instruction_set(instr_set);
@@ -2406,6 +3015,11 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
     brute_force_per_second = brute_force_benchmark();
     write_stats = false;
 
+    // the checkpoint sits next to the nonce file, `<nonce file>.ckpt`
+    if (filename != NULL) {
+        snprintf(ckpt_fn, sizeof(ckpt_fn), "%s.ckpt", (filename[0] != '\0') ? filename : CHECKPOINT_FILE);
+    }
+
     if (tests) {
         // set the correct locale for the stats printing
         write_stats = true;
@@ -2522,8 +3136,8 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
 #endif
 
             free_nonces_memory();
-            free_bitarray(all_bitflips_bitarray[ODD_STATE]);
-            free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+            hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+            hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
             free_sum_bitarrays();
             free_part_sum_bitarrays();
         }
@@ -2543,13 +3157,37 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
         update_reduction_rate(0.0, true);
 
         int res;
-        if (nonce_file_read) {  // use pre-acquired data from file nonces.bin
-            res = read_nonce_file(filename);
+        uint8_t *image = NULL;
+        uint32_t image_len = 0;
+        if (resume) {  // nonces and progress of an interrupted run
+            res = LoadBruteForceCheckpoint(ckpt_fn, &image, &image_len);
+            if (res == PM3_SUCCESS) {
+                snprintf(progress_text, sizeof(progress_text), "Resuming from checkpoint " _YELLOW_("%s"), ckpt_fn);
+                hardnested_print_progress(0, progress_text, (float)(1LL << 47), 0);
+                res = read_nonces(image, image_len, &trgBlockNo, &trgKeyType, true);
+            }
+            free(image);
+            image = NULL;
+            if (res != PM3_SUCCESS) {
+                free_bitflip_bitarrays();
+                free_nonces_memory();
+                hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+                free_sum_bitarrays();
+                free_part_sum_bitarrays();
+                return res;
+            }
+            hardnested_stage = CHECK_1ST_BYTES | CHECK_2ND_BYTES;
+            update_nonce_data(false);
+            float brute_force_depth;
+            shrink_key_space(&brute_force_depth);
+        } else if (nonce_file_read) {  // use pre-acquired data from file nonces.bin
+            res = read_nonce_file(filename, &trgBlockNo, &trgKeyType);
             if (res != PM3_SUCCESS) {
                 free_bitflip_bitarrays();
                 free_nonces_memory();
-                free_bitarray(all_bitflips_bitarray[ODD_STATE]);
-                free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
                 free_sum_bitarrays();
                 free_part_sum_bitarrays();
                 return res;
@@ -2559,16 +3197,56 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             float brute_force_depth;
             shrink_key_space(&brute_force_depth);
         } else { // acquire nonces.
-            res = acquire_nonces(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename);
+            if (stream) {
+                res = acquire_nonces_stream(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename);
+            } else {
+                res = acquire_nonces(blockNo, keyType, key, trgBlockNo, trgKeyType, nonce_file_write, slow, filename);
+            }
             if (res != PM3_SUCCESS) {
                 free_bitflip_bitarrays();
                 free_nonces_memory();
-                free_bitarray(all_bitflips_bitarray[ODD_STATE]);
-                free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
                 free_sum_bitarrays();
                 free_part_sum_bitarrays();
                 return res;
             }
+
+            // The analysis during acquisition ran on a time budget. Redo it the way a resumed
+            // run will, so the candidates match the checkpoint.
+            if (ckpt_fn[0] != '\0' && expected_brute_force_time() > RESUMABLE_BRUTE_FORCE_TIME) {
+                image = nonce_image(trgBlockNo, trgKeyType, &image_len);
+            }
+            if (image != NULL) {
+                free_bitflip_bitarrays();
+                free_nonces_memory();
+                hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+                hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+                free_sum_bitarrays();
+                free_part_sum_bitarrays();
+                init_bitflip_bitarrays();
+                init_part_sum_bitarrays();
+                init_sum_bitarrays();
+                init_allbitflips_array();
+                init_nonce_memory();
+                memset(part_sum_count, 0, sizeof(part_sum_count));
+                update_reduction_rate(0.0, true);
+                uint32_t acquired = num_acquired_nonces;
+                read_nonces(image, image_len, &trgBlockNo, &trgKeyType, false);
+                num_acquired_nonces = acquired;
+                hardnested_stage = CHECK_1ST_BYTES | CHECK_2ND_BYTES;
+                update_nonce_data(false);
+                float brute_force_depth;
+                shrink_key_space(&brute_force_depth);
+            }
+        }
+
+        if (ckpt_fn[0] != '\0') {
+            if (image == NULL) {
+                image = nonce_image(trgBlockNo, trgKeyType, &image_len);
+            }
+            SetBruteForceCheckpoint(ckpt_fn, image, image_len);
+            free(image);
         }
 
         if (trgkey != NULL) {
@@ -2638,9 +3316,12 @@ int mfnestedhard(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBloc
             }
         }
 
+        // search is complete, nothing left to resume
+        ClearBruteForceCheckpoint();
+
         free_nonces_memory();
-        free_bitarray(all_bitflips_bitarray[ODD_STATE]);
-        free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
+        hn_free_bitarray(all_bitflips_bitarray[ODD_STATE]);
+        hn_free_bitarray(all_bitflips_bitarray[EVEN_STATE]);
         free_sum_bitarrays();
         free_part_sum_bitarrays();
 
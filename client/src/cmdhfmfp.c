@@ -199,25 +199,13 @@ static int plus_print_signature(uint8_t *uid, uint8_t uidlen, uint8_t *signature
         {"MIFARE Plus Troika", "040F732E0EA7DF2B38F791BF89425BF7DCDF3EE4D976669E3831F324FF15751BD52AFF1782F72FF2731EEAD5F63ABE7D126E03C856FFB942AF"}
     };
 
-    uint8_t i;
-    bool is_valid = false;
-
-    for (i = 0; i < ARRAYLEN(nxp_plus_public_keys); i++) {
-
-        int dl = 0;
-        uint8_t key[PUBLIC_PLUS_ECDA_KEYLEN];
-        param_gethex_to_eol(nxp_plus_public_keys[i].value, 0, key, PUBLIC_PLUS_ECDA_KEYLEN, &dl);
-
-        int res = ecdsa_signature_r_s_verify(MBEDTLS_ECP_DP_SECP224R1, key, uid, uidlen, signature, signature_len, false);
-        is_valid = (res == 0);
-        if (is_valid)
-            break;
-    }
+    int i = ecdsa_signature_r_s_find_key(MBEDTLS_ECP_DP_SECP224R1, nxp_plus_public_keys, ARRAYLEN(nxp_plus_public_keys), uid, uidlen, signature, signature_len, false);
+    bool is_valid = (i >= 0);
 
     PrintAndLogEx(NORMAL, "");
     PrintAndLogEx(INFO, "--- " _CYAN_("Tag Signature"));
 
-    if (is_valid == false || i == ARRAYLEN(nxp_plus_public_keys)) {
+    if (is_valid == false) {
         PrintAndLogEx(INFO, "    Elliptic curve parameters: NID_secp224r1");
         PrintAndLogEx(INFO, "             TAG IC Signature: %s", sprint_hex_inrow(signature, 16));
         PrintAndLogEx(INFO, "                             : %s", sprint_hex_inrow(signature + 16, 16));
@@ -1415,6 +1403,44 @@ static int plus_key_check(uint8_t startSector, uint8_t endSector, uint8_t startK
     return PM3_SUCCESS;
 }
 
+// same as plus_key_check,  the dictionary is checked on the device.  Keys found by an earlier
+// dictionary part are not checked again.
+static int plus_key_check_device(uint8_t startSector, uint8_t endSector, uint8_t startKeyAB, uint8_t endKeyAB,
+                                 uint8_t keyList[MAX_AES_KEYS_LIST_LEN][AES_KEY_LEN], size_t keyListLen, uint8_t foundKeys[2][64][AES_KEY_LEN + 1],
+                                 bool verbose) {
+
+    uint8_t slots[16] = {0};
+    int32_t found[128];
+    for (uint8_t i = 0; i < ARRAYLEN(found); i++) {
+        found[i] = -1;
+    }
+
+    for (uint8_t sector = startSector; sector <= endSector && sector < 64; sector++) {
+        for (uint8_t keyAB = startKeyAB; keyAB <= endKeyAB; keyAB++) {
+            if (foundKeys[keyAB][sector][0] == 0) {
+                uint8_t slot = sector * 2 + keyAB;
+                slots[slot / 8] |= (1 << (slot % 8));
+            }
+        }
+    }
+
+    int res = mfpdesCheckKeys(CMD_HF_MFP_CHKKEYS, 0, NULL, slots, (uint8_t *)keyList, AES_KEY_LEN, keyListLen, found, verbose);
+
+    for (uint8_t slot = 0; slot < ARRAYLEN(found); slot++) {
+        if (found[slot] < 0) {
+            continue;
+        }
+        foundKeys[slot % 2][slot / 2][0] = 0x01;
+        memcpy(&foundKeys[slot % 2][slot / 2][1], keyList[found[slot]], AES_KEY_LEN);
+    }
+
+    if (res == PM3_EMALLOC) {
+        PrintAndLogEx(WARNING, "\nDevice is short of memory, checking from the client");
+        return plus_key_check(startSector, endSector, startKeyAB, endKeyAB, keyList, keyListLen, foundKeys, verbose);
+    }
+    return res;
+}
+
 static void Fill2bPattern(uint8_t keyList[MAX_AES_KEYS_LIST_LEN][AES_KEY_LEN], uint32_t *keyListLen, uint32_t *startPattern) {
     for (uint32_t pt = *startPattern; pt < 0x10000; pt++) {
         keyList[*keyListLen][0] = (pt >> 8) & 0xff;
@@ -1585,7 +1611,7 @@ static int CmdHFMFPChk(const char *Cmd) {
     }
 
     while (true) {
-        res = plus_key_check(startSector, endSector, startKeyAB, endKeyAB, keyList, keyListLen, foundKeys, verbose);
+        res = plus_key_check_device(startSector, endSector, startKeyAB, endKeyAB, keyList, keyListLen, foundKeys, verbose);
         if (res == PM3_EOPABORTED) {
             break;
         }
@@ -35,6 +35,7 @@
 #include "fileutils.h"      // saveFile
 #include "cmdtrace.h"       // trace list
 #include "preferences.h"    // setDeviceDebugLevel
+#include "util_posix.h"     // msleep
 
 #define MAX_UL_BLOCKS       0x0F
 #define MAX_ULC_BLOCKS      0x2F
@@ -795,6 +796,18 @@ static int ndef_print_CC(uint8_t *data) {
     return PM3_SUCCESS;
 }
 
+// UL EV1 / NTAG21x / NTAG I2C answer FAST_READ (0x3A)
+static bool ul_supports_fastread(uint64_t tagtype) {
+    if (tagtype & MFU_TT_MAGIC) {
+        return false;
+    }
+    return (tagtype & (MFU_TT_UL_EV1_48 | MFU_TT_UL_EV1_128 | MFU_TT_UL_EV1 | MFU_TT_UL_NANO_40 |
+                       MFU_TT_NTAG_210 | MFU_TT_NTAG_210u | MFU_TT_NTAG_212 |
+                       MFU_TT_NTAG_213 | MFU_TT_NTAG_213_F | MFU_TT_NTAG_213_C | MFU_TT_NTAG_213_TT |
+                       MFU_TT_NTAG_215 | MFU_TT_NTAG_216 | MFU_TT_NTAG_216_F |
+                       MFU_TT_NTAG_I2C_1K | MFU_TT_NTAG_I2C_2K | MFU_TT_NTAG_I2C_1K_PLUS | MFU_TT_NTAG_I2C_2K_PLUS)) != 0;
+}
+
 int ul_print_type(uint64_t tagtype, uint8_t spaces) {
 
     if (spaces > 10) {
@@ -1309,36 +1322,17 @@ static int ulev1_print_signature(uint64_t tagtype, uint8_t *uid, uint8_t *signat
             }
         };
     */
-    uint8_t i;
+    int i = -1;
     bool is_valid = false;
     if (signature_len == 32) {
-        for (i = 0; i < ARRAYLEN(nxp_mfu_public_keys); i++) {
-
-            int dl = 0;
-            uint8_t key[PUBLIC_ECDA_KEYLEN] = {0};
-            param_gethex_to_eol(nxp_mfu_public_keys[i].value, 0, key, PUBLIC_ECDA_KEYLEN, &dl);
-
-            int res = ecdsa_signature_r_s_verify(MBEDTLS_ECP_DP_SECP128R1, key, uid, 7, signature, signature_len, false);
-
-            is_valid = (res == 0);
-            if (is_valid)
-                break;
-        }
+        i = ecdsa_signature_r_s_find_key(MBEDTLS_ECP_DP_SECP128R1, nxp_mfu_public_keys, ARRAYLEN(nxp_mfu_public_keys), uid, 7, signature, signature_len, false);
+        is_valid = (i >= 0);
     }
 
     bool is_192_valid = false;
     if (signature_len == 48) {
-        for (i = 0; i < ARRAYLEN(nxp_mfu_192_public_keys); i++) {
-            int dl = 0;
-            uint8_t key[PUBLIC_ECDA_192_KEYLEN] = {0};
-            param_gethex_to_eol(nxp_mfu_192_public_keys[i].value, 0, key, PUBLIC_ECDA_192_KEYLEN, &dl);
-
-            int res = ecdsa_signature_r_s_verify(MBEDTLS_ECP_DP_SECP192R1, key, uid, 7, signature, signature_len, false);
-
-            is_192_valid = (res == 0);
-            if (is_192_valid)
-                break;
-        }
+        i = ecdsa_signature_r_s_find_key(MBEDTLS_ECP_DP_SECP192R1, nxp_mfu_192_public_keys, ARRAYLEN(nxp_mfu_192_public_keys), uid, 7, signature, signature_len, false);
+        is_192_valid = (i >= 0);
     }
 
     PrintAndLogEx(NORMAL, "");
@@ -1507,7 +1501,7 @@ static int mfu_dump_tag(uint16_t pages, void **pdata, uint16_t *len) {
     num_to_bytes(ul_ev1_pwdgenB(card.uid), 4, key);
 
     clearCommandBuffer();
-    SendCommandMIX(CMD_HF_MIFAREU_READCARD, 0, pages, keytype, key, 4);
+    SendCommandMIX(CMD_HF_MIFAREU_READCARD, MFU_READCARD_FASTREAD, pages, keytype, key, 4);
     PacketResponseNG resp;
     if (WaitForResponseTimeout(CMD_ACK, &resp, 2500) == false) {
         PrintAndLogEx(WARNING, "Command execute time-out");
@@ -1794,7 +1788,7 @@ static int mfu_fingerprint(uint64_t tagtype, bool hasAuthKey, uint8_t *authkey,
     }
 
     clearCommandBuffer();
-    SendCommandMIX(CMD_HF_MIFAREU_READCARD, 0, pages, keytype, authkey, ak_len);
+    SendCommandMIX(CMD_HF_MIFAREU_READCARD, ul_supports_fastread(tagtype) ? MFU_READCARD_FASTREAD : 0, pages, keytype, authkey, ak_len);
 
     PacketResponseNG resp;
     if (WaitForResponseTimeout(CMD_ACK, &resp, 2500) == false) {
@@ -2988,7 +2982,7 @@ static int CmdHF14AMfUDump(const char *Cmd) {
     }
 
     clearCommandBuffer();
-    SendCommandMIX(CMD_HF_MIFAREU_READCARD, start_page, pages, keytype, authKeyPtr, ak_len);
+    SendCommandMIX(CMD_HF_MIFAREU_READCARD, start_page | (ul_supports_fastread(tagtype) ? MFU_READCARD_FASTREAD : 0), pages, keytype, authKeyPtr, ak_len);
     PacketResponseNG resp;
     if (WaitForResponseTimeout(CMD_ACK, &resp, 2500) == false) {
         PrintAndLogEx(WARNING, "Command execute time-out");
@@ -5452,6 +5446,187 @@ out:
     return PM3_SUCCESS;
 }
 
+static int CmdHF14MfuNDEFWrite(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf mfu ndefwrite",
+                  "Encode a NDEF URI or text record from a template and write it from page 4.\n"
+                  "Template placeholders:  {uid} tag UID as hex,  {ctr} running counter.\n"
+                  "Each tag is written in one device command. With `-c`, present the tags\n"
+                  "one after another,  press <Enter> to stop",
+                  "hf mfu ndefwrite --uri \"https://example.com/t/{uid}\"\n"
+                  "hf mfu ndefwrite --text \"tag #{ctr}\" --ctr 100 -c 50\n"
+                  "hf mfu ndefwrite --uri \"https://example.com/?id={uid}&n={ctr}\" -k FFFFFFFF -c 1000"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str0("u", "uri", "<str>", "URI record template"),
+        arg_str0("t", "text", "<str>", "Text record template"),
+        arg_str0("k", "key", "<hex>", "Authentication key (UL-C 16 bytes, EV1/NTAG 4 bytes)"),
+        arg_lit0("l", NULL, "Swap entered key's endianness"),
+        arg_u64_0("c", "count", "<dec>", "Number of tags to write (def 1)"),
+        arg_u64_0(NULL, "ctr", "<dec>", "Start value of {ctr} (def 0)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    char uri[256] = {0};
+    int urilen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)uri, sizeof(uri) - 1, &urilen);
+
+    char text[256] = {0};
+    int textlen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)text, sizeof(text) - 1, &textlen);
+
+    int keylen = 0;
+    uint8_t key[16] = {0x00};
+    CLIGetHexWithReturn(ctx, 3, key, &keylen);
+    bool swap_endian = arg_get_lit(ctx, 4);
+
+    uint32_t count = arg_get_u32_def(ctx, 5, 1);
+    uint32_t counter = arg_get_u32_def(ctx, 6, 0);
+    CLIParserFree(ctx);
+
+    if ((urilen > 0) == (textlen > 0)) {
+        PrintAndLogEx(WARNING, "Specify one of `--uri` or `--text`");
+        return PM3_EINVARG;
+    }
+
+    uint8_t keytype = 0;
+    if (keylen == 16) {
+        keytype = 1;
+    } else if (keylen == 4) {
+        keytype = 2;
+    } else if (keylen != 0) {
+        PrintAndLogEx(WARNING, "ERROR: Key is incorrect length\n");
+        return PM3_EINVARG;
+    }
+
+    uint8_t *p_key = key;
+    if (swap_endian && keytype) {
+        p_key = SwapEndian64(key, keylen, (keylen == 16) ? 8 : 4);
+    }
+
+    ndefTemplateType_t type = (urilen > 0) ? ndefTemplateURI : ndefTemplateText;
+    const char *tmpl = (urilen > 0) ? uri : text;
+
+    struct p {
+        uint8_t keytype;
+        uint8_t key[16];
+        uint8_t uid[10];
+        uint8_t uidlen;
+        uint8_t start_page;
+        uint8_t pages;
+        uint8_t data[];
+    } PACKED;
+
+    uint8_t buf[PM3_CMD_DATA_SIZE] = {0};
+    struct p *payload = (struct p *)buf;
+    payload->keytype = keytype;
+    memcpy(payload->key, p_key, keylen);
+    payload->start_page = 4;
+
+    if (count > 1) {
+        PrintAndLogEx(INFO, "Writing " _YELLOW_("%u") " tags,  press " _GREEN_("<Enter>") " to stop", count);
+    }
+
+    uint8_t last_uid[10] = {0};
+    uint8_t last_uidlen = 0;
+    uint32_t written = 0;
+    int res = PM3_SUCCESS;
+
+    while (written < count) {
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        iso14a_card_select_t card;
+        if (ul_select(&card) == false) {
+            if (count == 1) {
+                PrintAndLogEx(WARNING, "No tag found");
+                return PM3_ESOFT;
+            }
+            msleep(50);
+            continue;
+        }
+
+        // previous tag still on the antenna
+        if (card.uidlen == last_uidlen && memcmp(card.uid, last_uid, last_uidlen) == 0) {
+            DropField();
+            msleep(50);
+            continue;
+        }
+
+        // capability container gives the NDEF area size
+        uint8_t data[16] = {0};
+        int status = ul_read(0, data, sizeof(data));
+        DropField();
+
+        int maxsize = (status == 16) ? ndef_get_maxsize(data + 12) : 0;
+        if (maxsize == 0) {
+            PrintAndLogEx(FAILED, "UID %s no NDEF capability container, skipping", sprint_hex_inrow(card.uid, card.uidlen));
+            memcpy(last_uid, card.uid, card.uidlen);
+            last_uidlen = card.uidlen;
+            if (count == 1) {
+                return PM3_ESOFT;
+            }
+            continue;
+        }
+
+        size_t max_data = PM3_CMD_DATA_SIZE - sizeof(struct p);
+        size_t ndeflen = 0;
+        res = NDEFEncodeTemplate(type, tmpl, card.uid, card.uidlen, counter, payload->data, MIN((size_t)maxsize, max_data), &ndeflen);
+        if (res != PM3_SUCCESS) {
+            break;
+        }
+
+        payload->pages = (ndeflen + 3) / 4;
+        memset(payload->data + ndeflen, 0, (payload->pages * 4) - ndeflen);
+        memcpy(payload->uid, card.uid, card.uidlen);
+        payload->uidlen = card.uidlen;
+
+        PacketResponseNG resp;
+        clearCommandBuffer();
+        SendCommandNG(CMD_HF_MIFAREU_WRITEPAGES, buf, sizeof(struct p) + (payload->pages * 4));
+        if (WaitForResponseTimeout(CMD_HF_MIFAREU_WRITEPAGES, &resp, 2500) == false) {
+            PrintAndLogEx(WARNING, "command execute timeout");
+            res = PM3_ETIMEOUT;
+            break;
+        }
+
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "UID %s write ( " _RED_("fail") " ) after %u pages, present it again",
+                          sprint_hex_inrow(card.uid, card.uidlen), resp.data.asBytes[0]);
+            res = resp.status;
+            if (count == 1) {
+                break;
+            }
+            continue;
+        }
+
+        PrintAndLogEx(SUCCESS, "%3u | UID %s | ctr %u | %u bytes ( " _GREEN_("ok") " )",
+                      written + 1, sprint_hex_inrow(card.uid, card.uidlen), counter, (uint32_t)ndeflen);
+
+        memcpy(last_uid, card.uid, card.uidlen);
+        last_uidlen = card.uidlen;
+        written++;
+        counter++;
+        res = PM3_SUCCESS;
+    }
+
+    if (count > 1) {
+        PrintAndLogEx(INFO, "Wrote " _YELLOW_("%u") " tags,  next ctr %u", written, counter);
+    }
+    if (written) {
+        PrintAndLogEx(HINT, "Try `" _YELLOW_("hf mfu ndefread") "` to verify");
+    }
+    return res;
+}
+
 static command_t CommandTable[] = {
     {"help",     CmdHelp,                   AlwaysAvailable, "This help"},
     {"list",     CmdHF14AMfuList,           AlwaysAvailable, "List MIFARE Ultralight / NTAG history"},
@@ -5466,6 +5641,7 @@ static command_t CommandTable[] = {
     {"dump",     CmdHF14AMfUDump,           IfPm3Iso14443a,  "Dump MIFARE Ultralight family tag to binary file"},
     {"info",     CmdHF14AMfUInfo,           IfPm3Iso14443a,  "Tag information"},
     {"ndefread", CmdHF14MfuNDEFRead,        IfPm3Iso14443a,  "Prints NDEF records from card"},
+    {"ndefwrite", CmdHF14MfuNDEFWrite,      IfPm3Iso14443a,  "Encode NDEF URI / text templates onto one or many tags"},
     {"rdbl",     CmdHF14AMfURdBl,           IfPm3Iso14443a,  "Read block"},
     {"restore",  CmdHF14AMfURestore,        IfPm3Iso14443a,  "Restore a dump file onto a tag"},
     {"tamper",   CmdHF14MfUTamper,          IfPm3Iso14443a,  "NTAG 213TT - Configure the tamper feature"},
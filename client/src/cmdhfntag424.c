@@ -18,6 +18,8 @@
 
 #include "cmdhfntag424.h"
 #include <ctype.h>
+#include <stdlib.h>
+#include <pthread.h>
 #include "cmdparser.h"
 #include "commonutil.h"
 #include "comms.h"
@@ -28,6 +30,7 @@
 #include "fileutils.h"          // saveFile
 #include "crypto/libpcrypto.h"  // aes_decode
 #include "cmac.h"
+#include "aes.h"
 #include "cmdhf14a.h"
 #include "ui.h"
 #include "util.h"
@@ -1468,11 +1471,378 @@ static int CmdHF_ntag424_changekey(const char *Cmd) {
     return res;
 }
 
+// -------------- offline SUN message verification ---------------------------
+// AN12196, SDM in AES mode.  The PICC data is AES CBC encrypted with the SDMMetaReadKey,
+// the CMAC is MACt over the MAC input with a session key derived from the SDMFileReadKey.
+#define SUN_URL_MAX_LEN 1024
+
+typedef enum {
+    SUN_VALID = 0,
+    SUN_INVALID_MAC,
+    SUN_NO_PICC,
+    SUN_BAD_PICC,
+    SUN_NO_CMAC,
+} sun_status_t;
+
+typedef struct {
+    uint8_t metakey[16];
+    uint8_t filekey[16];
+    const char *piccname;
+    const char *cmacname;
+    const char *macin;
+} sun_params_t;
+
+typedef struct {
+    sun_status_t status;
+    sdm_picc_t picc;
+} sun_result_t;
+
+typedef struct {
+    const sun_params_t *params;
+    char **urls;
+    sun_result_t *results;
+    size_t count;
+    size_t first;
+    size_t step;
+} sun_worker_t;
+
+static int sun_hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// finds `name=` in the query of the url and decodes the hex value.
+// returns the number of bytes,  *value points to the value in the url
+static int sun_get_param(const char *url, const char *name, uint8_t *out, int maxlen, const char **value) {
+    size_t namelen = strlen(name);
+
+    for (const char *p = strchr(url, '?'); p != NULL; p = strchr(p + 1, '&')) {
+        if (strncmp(p + 1, name, namelen) || p[1 + namelen] != '=') {
+            continue;
+        }
+
+        const char *v = p + 1 + namelen + 1;
+        int len = 0;
+        while (len < maxlen && sun_hex_value(v[len * 2]) >= 0 && sun_hex_value(v[len * 2 + 1]) >= 0) {
+            out[len] = (sun_hex_value(v[len * 2]) << 4) | sun_hex_value(v[len * 2 + 1]);
+            len++;
+        }
+        if (value) {
+            *value = v;
+        }
+        return len;
+    }
+    return 0;
+}
+
+static sun_status_t sun_verify(const char *url, const sun_params_t *params, mbedtls_aes_context *metactx, sdm_picc_t *picc) {
+
+    memset(picc, 0, sizeof(sdm_picc_t));
+
+    uint8_t data[16] = {0};
+    if (sun_get_param(url, params->piccname, data, sizeof(data), NULL) == 16) {
+        uint8_t iv[16] = {0};
+        uint8_t plain[16] = {0};
+        mbedtls_aes_crypt_cbc(metactx, MBEDTLS_AES_DECRYPT, sizeof(data), iv, data, plain);
+
+        picc->tag = plain[0];
+        if ((picc->tag & 0x80) && (picc->tag & 0x0F) != 7) {
+            return SUN_BAD_PICC;
+        }
+
+        uint8_t pos = 1;
+        if (picc->tag & 0x80) {
+            memcpy(picc->uid, plain + pos, 7);
+            pos += 7;
+        }
+        if (picc->tag & 0x40) {
+            memcpy(picc->cnt, plain + pos, 3);
+        }
+    } else {
+        // plain mirroring,  the counter is printed MSB first
+        uint8_t cnt[3] = {0};
+        if (sun_get_param(url, "uid", picc->uid, 7, NULL) == 7) {
+            picc->tag |= 0x80 | 7;
+        }
+        if (sun_get_param(url, "ctr", cnt, 3, NULL) == 3) {
+            picc->tag |= 0x40;
+            picc->cnt[0] = cnt[2];
+            picc->cnt[1] = cnt[1];
+            picc->cnt[2] = cnt[0];
+        }
+        if ((picc->tag & 0xC0) == 0) {
+            return SUN_NO_PICC;
+        }
+    }
+    picc->cnt_int = MemLeToUint3byte(picc->cnt);
+
+    uint8_t cmac[8] = {0};
+    const char *cmacpos = NULL;
+    if (sun_get_param(url, params->cmacname, cmac, sizeof(cmac), &cmacpos) != sizeof(cmac)) {
+        return SUN_NO_CMAC;
+    }
+
+    // SV2 = 3Ch || C3h || 00h || 01h || 00h || 80h || UID || SDMReadCtr || zero padding
+    uint8_t sv2[16] = {0x3c, 0xc3, 0x00, 0x01, 0x00, 0x80};
+    uint8_t svlen = 6;
+    if (picc->tag & 0x80) {
+        memcpy(sv2 + svlen, picc->uid, 7);
+        svlen += 7;
+    }
+    if (picc->tag & 0x40) {
+        memcpy(sv2 + svlen, picc->cnt, 3);
+    }
+
+    uint8_t sessionkey[16] = {0};
+    mbedtls_aes_cmac_prf_128(params->filekey, 16, sv2, sizeof(sv2), sessionkey);
+
+    // MAC input runs from the given marker up to the CMAC value,  empty by default
+    const uint8_t *macin = (const uint8_t *)cmacpos;
+    size_t macinlen = 0;
+    if (params->macin && params->macin[0]) {
+        const char *start = strstr(url, params->macin);
+        if (start && start < cmacpos) {
+            macin = (const uint8_t *)start;
+            macinlen = cmacpos - start;
+        }
+    }
+
+    uint8_t mac[16] = {0};
+    mbedtls_aes_cmac_prf_128(sessionkey, 16, macin, macinlen, mac);
+
+    for (int i = 0; i < 8; i++) {
+        if (mac[i * 2 + 1] != cmac[i]) {
+            return SUN_INVALID_MAC;
+        }
+    }
+    return SUN_VALID;
+}
+
+// every worker takes each step'th url,  the AES and CMAC contexts are its own
+// so the workers don't queue up on the shared key schedule cache of libpcrypto
+static void *sun_verify_worker(void *arg) {
+    sun_worker_t *w = (sun_worker_t *)arg;
+
+    mbedtls_aes_context metactx;
+    mbedtls_aes_init(&metactx);
+    mbedtls_aes_setkey_dec(&metactx, w->params->metakey, 128);
+
+    for (size_t i = w->first; i < w->count; i += w->step) {
+        w->results[i].status = sun_verify(w->urls[i], w->params, &metactx, &w->results[i].picc);
+    }
+
+    mbedtls_aes_free(&metactx);
+    return NULL;
+}
+
+static const char *sun_status_str(sun_status_t status) {
+    switch (status) {
+        case SUN_VALID:
+            return _GREEN_("valid");
+        case SUN_INVALID_MAC:
+            return _RED_("invalid cmac");
+        case SUN_NO_PICC:
+            return _YELLOW_("no picc data");
+        case SUN_BAD_PICC:
+            return _RED_("bad picc data");
+        case SUN_NO_CMAC:
+            return _YELLOW_("no cmac");
+    }
+    return "";
+}
+
+static int CmdHF_ntag424_sunverify(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hf ntag424 sunverify",
+                  "Verify SUN messages (SDM, AES mode) offline. Decrypts the PICC data with the meta read key\n"
+                  "and checks the CMAC with the file read key. Plain mirrored `uid` / `ctr` values are used\n"
+                  "when there is no PICC data. A file is verified in parallel, one url per line.",
+                  "hf ntag424 sunverify -u \"https://choose.url.com/ntag424?e=EF963FF7828658A599F3041510671E88&c=94EED9EE65337086\"\n"
+                  "hf ntag424 sunverify -f urls.txt --metakey 00000000000000000000000000000000 --filekey 00000000000000000000000000000000");
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str0("u",  "url", "<str>", "SUN url to verify"),
+        arg_str0("f",  "file", "<fn>", "File with one SUN url per line"),
+        arg_str0(NULL, "metakey", "<hex>", "SDM meta read key (HEX 16 bytes), default 00.."),
+        arg_str0(NULL, "filekey", "<hex>", "SDM file read key (HEX 16 bytes), default 00.."),
+        arg_str0(NULL, "picc", "<str>", "Name of the PICC data parameter, default `e`"),
+        arg_str0(NULL, "cmac", "<str>", "Name of the CMAC parameter, default `c`"),
+        arg_str0(NULL, "macin", "<str>", "MAC input starts at this text, default empty MAC input"),
+        arg_lit0("v",  "verbose", "Verbose output"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    char url[SUN_URL_MAX_LEN] = {0};
+    int urllen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)url, sizeof(url) - 1, &urllen);
+
+    char fn[FILE_PATH_SIZE] = {0};
+    int fnlen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)fn, FILE_PATH_SIZE, &fnlen);
+
+    sun_params_t params = {0};
+
+    int keylen = 0;
+    if (CLIParamHexToBuf(arg_get_str(ctx, 3), params.metakey, sizeof(params.metakey), &keylen) || (keylen != 0 && keylen != 16)) {
+        PrintAndLogEx(ERR, "Meta read key must be 16 bytes");
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+    keylen = 0;
+    if (CLIParamHexToBuf(arg_get_str(ctx, 4), params.filekey, sizeof(params.filekey), &keylen) || (keylen != 0 && keylen != 16)) {
+        PrintAndLogEx(ERR, "File read key must be 16 bytes");
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+
+    char piccname[32] = {0};
+    int piccnamelen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)piccname, sizeof(piccname) - 1, &piccnamelen);
+    char cmacname[32] = {0};
+    int cmacnamelen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 6), (uint8_t *)cmacname, sizeof(cmacname) - 1, &cmacnamelen);
+    char macin[64] = {0};
+    int macinlen = 0;
+    CLIParamStrToBuf(arg_get_str(ctx, 7), (uint8_t *)macin, sizeof(macin) - 1, &macinlen);
+
+    bool verbose = arg_get_lit(ctx, 8);
+    CLIParserFree(ctx);
+
+    if ((urllen == 0) == (fnlen == 0)) {
+        PrintAndLogEx(ERR, "Specify either an url or a file");
+        return PM3_EINVARG;
+    }
+
+    params.piccname = (piccnamelen) ? piccname : "e";
+    params.cmacname = (cmacnamelen) ? cmacname : "c";
+    params.macin = macin;
+
+    char **urls = NULL;
+    size_t count = 0;
+
+    if (urllen) {
+        urls = calloc(1, sizeof(char *));
+        if (urls == NULL) {
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+        urls[0] = strdup(url);
+        count = 1;
+    } else {
+        FILE *f = fopen(fn, "r");
+        if (f == NULL) {
+            PrintAndLogEx(ERR, "Failed to open file " _YELLOW_("%s"), fn);
+            return PM3_EFILE;
+        }
+
+        size_t alloced = 0;
+        char line[SUN_URL_MAX_LEN];
+        while (fgets(line, sizeof(line), f)) {
+            line[strcspn(line, "\r\n")] = 0;
+            if (line[0] == 0 || line[0] == '#') {
+                continue;
+            }
+
+            if (count == alloced) {
+                alloced = (alloced) ? alloced * 2 : 256;
+                char **tmp = realloc(urls, alloced * sizeof(char *));
+                if (tmp == NULL) {
+                    break;
+                }
+                urls = tmp;
+            }
+            urls[count] = strdup(line);
+            if (urls[count] == NULL) {
+                break;
+            }
+            count++;
+        }
+        fclose(f);
+
+        PrintAndLogEx(INFO, "Loaded " _YELLOW_("%zu") " urls from " _YELLOW_("%s"), count, fn);
+    }
+
+    sun_result_t *results = calloc(count ? count : 1, sizeof(sun_result_t));
+    if (results == NULL) {
+        for (size_t i = 0; i < count; i++) {
+            free(urls[i]);
+        }
+        free(urls);
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    size_t thread_cnt = num_CPUs();
+    if (thread_cnt > count) {
+        thread_cnt = (count) ? count : 1;
+    }
+
+    pthread_t threads[thread_cnt];
+    sun_worker_t workers[thread_cnt];
+    size_t started = 0;
+    for (; started < thread_cnt; started++) {
+        workers[started] = (sun_worker_t) {
+            .params = &params,
+            .urls = urls,
+            .results = results,
+            .count = count,
+            .first = started,
+            .step = thread_cnt,
+        };
+        if (pthread_create(&threads[started], NULL, sun_verify_worker, &workers[started])) {
+            break;
+        }
+    }
+
+    // whatever a thread could not be started for,  do it here
+    if (started < thread_cnt) {
+        for (size_t i = started; i < thread_cnt; i++) {
+            sun_verify_worker(&workers[i]);
+        }
+    }
+
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size_t valid = 0;
+    PrintAndLogEx(INFO, "  #  | UID            | Counter | Result");
+    PrintAndLogEx(INFO, "-----+----------------+---------+-----------------");
+    for (size_t i = 0; i < count; i++) {
+        const sun_result_t *r = &results[i];
+        if (r->status == SUN_VALID) {
+            valid++;
+        }
+        PrintAndLogEx(INFO, "%4zu | %s | %7u | %s", i + 1,
+                      (r->picc.tag & 0x80) ? sprint_hex_inrow(r->picc.uid, 7) : "--------------",
+                      r->picc.cnt_int,
+                      sun_status_str(r->status)
+                     );
+        if (verbose) {
+            PrintAndLogEx(INFO, "       %s", urls[i]);
+        }
+    }
+    PrintAndLogEx(INFO, "-----+----------------+---------+-----------------");
+    PrintAndLogEx(SUCCESS, "Valid " _GREEN_("%zu") " / %zu", valid, count);
+
+    for (size_t i = 0; i < count; i++) {
+        free(urls[i]);
+    }
+    free(urls);
+    free(results);
+    return (valid == count) ? PM3_SUCCESS : PM3_ESOFT;
+}
+
 static command_t CommandTable[] = {
     {"help",         CmdHelp,                          AlwaysAvailable,  "This help"},
     {"-----------",  CmdHelp,                          IfPm3Iso14443a,   "----------------------- " _CYAN_("operations") " -----------------------"},
     {"info",         CmdHF_ntag424_info,               IfPm3Iso14443a,   "Tag information"},
     {"view",         CmdHF_ntag424_view,               AlwaysAvailable,  "Display content from tag dump file"},
+    {"sunverify",    CmdHF_ntag424_sunverify,          AlwaysAvailable,  "Verify SUN messages offline"},
     {"auth",         CmdHF_ntag424_auth,               IfPm3Iso14443a,   "Test authentication with key"},
     {"read",         CmdHF_ntag424_read,               IfPm3Iso14443a,   "Read file"},
     {"write",        CmdHF_ntag424_write,              IfPm3Iso14443a,   "Write file"},
@@ -35,8 +35,13 @@
 #include "pm3_cmd.h"
 #include "pmflash.h"        // rdv40validation_t
 #include "cmdflashmem.h"    // get_signature..
+#include "cmdlf.h"          // lf_config_apply_tuned
+#include "bench.h"          // bench_run
+#include "mifare.h"         // iso14a_rfbench_req_t
 #include "uart/uart.h"      // configure timeout
 #include "util_posix.h"
+#include "memstats.h"
+#include "throughput.h"
 #include "flash.h"          // reboot to bootloader mode
 #include "proxgui.h"
 #include "graph.h"          // for graph data
@@ -1068,6 +1073,9 @@ static int CmdTune(const char *Cmd) {
     // graph LF measurements
     // even here, these values has 3% error.
     uint16_t test1 = 0;
+    if (GraphReserve(256) == false) {
+        return PM3_EMALLOC;
+    }
     for (int i = 0; i < 256; i++) {
         g_GraphBuffer[i] = package->results[i] - 128;
         test1 += package->results[i];
@@ -1247,30 +1255,97 @@ static int CmdTia(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static void print_command_latency(void) {
+    size_t n = 0;
+    const cmd_latency_t *table = GetCommandLatencyTable(&n);
+
+    PrintAndLogEx(INFO, "  cmd  | reply  | samples |  srtt ms | var ms |  max ms | timeout ms");
+    PrintAndLogEx(INFO, "-------+--------+---------+----------+--------+---------+-----------");
+    uint16_t shown = 0;
+    for (size_t i = 0; i < n; i++) {
+        const cmd_latency_t *l = &table[i];
+        if (l->samples == 0) {
+            continue;
+        }
+        char deadline[20] = "learning";
+        if (l->samples >= ADAPTIVE_TIMEOUT_MIN_SAMPLES) {
+            snprintf(deadline, sizeof(deadline), "%zu", GetAdaptiveTimeout(l->cmd, l->reply_cmd, 0));
+        }
+        PrintAndLogEx(INFO, "0x%04x | 0x%04x | %7u | %8.2f | %6.2f | %7.2f | %s"
+                      , l->cmd
+                      , l->reply_cmd
+                      , l->samples
+                      , (float)l->srtt_us / 1000
+                      , (float)l->rttvar_us / 1000
+                      , (float)l->max_us / 1000
+                      , deadline
+                     );
+        shown++;
+    }
+    if (shown == 0) {
+        PrintAndLogEx(INFO, "no command latency learned yet");
+    }
+}
+
 static int CmdTimeout(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "hw timeout",
-                  "Set the communication timeout on the client side",
+                  "Set the communication timeout on the client side\n"
+                  "Reply latency is learned per command. Command timeouts are always extended when a link\n"
+                  "is slower than expected, with `--adaptive` they are also shortened on fast links",
                   "hw timeout            --> Show current timeout\n"
                   "hw timeout -m 20      --> Set the timeout to 20ms\n"
                   "hw timeout --ms 500   --> Set the timeout to 500ms\n"
+                  "hw timeout --adaptive --> Use learned command timeouts, also when shorter\n"
+                  "hw timeout --fixed    --> Only extend command timeouts from learned latency\n"
+                  "hw timeout --list     --> List learned command latency"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_int0("m", "ms", "<ms>", "timeout in micro seconds"),
+        arg_lit0(NULL, "adaptive", "use learned command timeouts"),
+        arg_lit0(NULL, "fixed", "keep command timeouts, only extend them"),
+        arg_lit0("l", "list", "list learned command latency"),
+        arg_lit0(NULL, "reset", "forget learned command latency"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     int32_t arg = arg_get_int_def(ctx, 1, -1);
+    bool adaptive = arg_get_lit(ctx, 2);
+    bool fixed = arg_get_lit(ctx, 3);
+    bool list = arg_get_lit(ctx, 4);
+    bool reset = arg_get_lit(ctx, 5);
     CLIParserFree(ctx);
 
+    if (adaptive && fixed) {
+        PrintAndLogEx(WARNING, "Can't use both `--adaptive` and `--fixed`");
+        return PM3_EINVARG;
+    }
+
+    if (adaptive || fixed) {
+        SetAdaptiveTimeouts(adaptive);
+        PrintAndLogEx(INFO, "Command timeouts... " _GREEN_("%s"), adaptive ? "adaptive" : "fixed");
+    }
+
+    if (reset) {
+        ResetCommandLatency();
+        PrintAndLogEx(INFO, "Learned command latency cleared");
+    }
+
+    if (list) {
+        print_command_latency();
+    }
+
     uint32_t oldTimeout = uart_get_timeouts();
 
     // timeout is not given/invalid, just show the current timeout then return
     if (arg < 0) {
-        PrintAndLogEx(INFO, "Current communication timeout... " _GREEN_("%u") " ms", oldTimeout);
+        if (adaptive == false && fixed == false && list == false && reset == false) {
+            PrintAndLogEx(INFO, "Current communication timeout... " _GREEN_("%u") " ms", oldTimeout);
+            PrintAndLogEx(INFO, "Command timeouts................ " _GREEN_("%s"), GetAdaptiveTimeouts() ? "adaptive" : "fixed");
+        }
         return PM3_SUCCESS;
     }
 
@@ -1340,6 +1415,654 @@ static int CmdPing(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static void print_comms_stats(void) {
+
+    comms_stats_t st;
+    GetCommsStats(&st);
+
+    uint64_t elapsed_us = usclock() - st.start_us;
+    double elapsed = (double)elapsed_us / 1000000.0;
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Transport") " ---------------------------");
+    PrintAndLogEx(INFO, "port............ " _YELLOW_("%s"), (g_session.pm3_present) ? g_conn.serial_port_name : "offline");
+    PrintAndLogEx(INFO, "measured for.... %.1f s", elapsed);
+    PrintAndLogEx(INFO, "TX frames....... %" PRIu64 " ( %" PRIu64 " bytes )", st.tx_frames, st.tx_bytes);
+    PrintAndLogEx(INFO, "RX frames....... %" PRIu64 " ( %" PRIu64 " bytes )", st.rx_frames, st.rx_bytes);
+    if (st.rx_errors) {
+        PrintAndLogEx(INFO, "RX errors....... " _RED_("%" PRIu64), st.rx_errors);
+    } else {
+        PrintAndLogEx(INFO, "RX errors....... %" PRIu64, st.rx_errors);
+    }
+    PrintAndLogEx(INFO, "timeouts........ %" PRIu64, st.timeouts);
+    if (elapsed > 0) {
+        PrintAndLogEx(INFO, "avg throughput.. %.0f bytes/s", (double)(st.tx_bytes + st.rx_bytes) / elapsed);
+    }
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Round trip") " --------------------------");
+    if (st.rtt_count == 0) {
+        PrintAndLogEx(INFO, "no round trip measured yet");
+        return;
+    }
+    PrintAndLogEx(INFO, "count........... %" PRIu64, st.rtt_count);
+    PrintAndLogEx(INFO, "min............. " _YELLOW_("%" PRIu64) " us", st.rtt_min_us);
+    PrintAndLogEx(INFO, "p50............. " _YELLOW_("%" PRIu64) " us", GetCommsStatsPercentile(&st, 50));
+    PrintAndLogEx(INFO, "p99............. " _YELLOW_("%" PRIu64) " us", GetCommsStatsPercentile(&st, 99));
+    PrintAndLogEx(INFO, "max............. " _YELLOW_("%" PRIu64) " us", st.rtt_max_us);
+    PrintAndLogEx(INFO, "avg............. %" PRIu64 " us", st.rtt_sum_us / st.rtt_count);
+    PrintAndLogEx(INFO, "");
+    PrintAndLogEx(INFO, "   <= us  | count");
+    PrintAndLogEx(INFO, "----------+--------");
+    for (uint8_t i = 0; i < COMMS_RTT_BUCKETS; i++) {
+        if (st.rtt_hist[i]) {
+            PrintAndLogEx(INFO, " %8" PRIu64 " | %u", (2ULL << i) - 1, st.rtt_hist[i]);
+        }
+    }
+}
+
+// ping round trips one by one, then the same amount with the pipeline kept full
+static int comms_bench(uint32_t count, uint32_t len) {
+
+    uint8_t data[PM3_CMD_DATA_SIZE] = {0};
+    for (uint16_t i = 0; i < len; i++) {
+        data[i] = i & 0xFF;
+    }
+
+    PrintAndLogEx(INFO, "Benchmark, " _YELLOW_("%u") " pings of " _YELLOW_("%u") " bytes", count, len);
+    clearCommandBuffer();
+
+    PacketResponseNG resp;
+    uint64_t t1 = usclock();
+    for (uint32_t i = 0; i < count; i++) {
+        SendCommandNG(CMD_PING, data, len);
+        if (WaitForResponseTimeout(CMD_PING, &resp, 1000) == false) {
+            PrintAndLogEx(WARNING, "Ping response " _RED_("timeout") " ( %u / %u )", i, count);
+            return PM3_ETIMEOUT;
+        }
+    }
+    t1 = usclock() - t1;
+
+    uint32_t tags[CMD_PIPELINE_DEPTH];
+    uint32_t sent = 0, done = 0;
+    uint64_t t2 = usclock();
+    while (done < count) {
+        while ((sent < count) && (sent - done < CMD_PIPELINE_DEPTH)) {
+            if (SendCommandNGPipelined(CMD_PING, data, len, &tags[sent % CMD_PIPELINE_DEPTH]) != PM3_SUCCESS) {
+                break;
+            }
+            sent++;
+        }
+        if (WaitForPipelinedResponseTimeout(tags[done % CMD_PIPELINE_DEPTH], &resp, 1000) == false) {
+            PrintAndLogEx(WARNING, "Pipelined ping response " _RED_("timeout") " ( %u / %u )", done, count);
+            return PM3_ETIMEOUT;
+        }
+        done++;
+    }
+    t2 = usclock() - t2;
+
+    // payload goes both ways
+    double payload = 2.0 * count * len;
+    PrintAndLogEx(SUCCESS, "sequential...... " _YELLOW_("%6.0f") " cmd/s  " _YELLOW_("%8.0f") " bytes/s", count * 1e6 / t1, payload * 1e6 / t1);
+    PrintAndLogEx(SUCCESS, "pipelined ( %u ) " _YELLOW_("%6.0f") " cmd/s  " _YELLOW_("%8.0f") " bytes/s", CMD_PIPELINE_DEPTH, count * 1e6 / t2, payload * 1e6 / t2);
+    PrintAndLogEx(NORMAL, "");
+    return PM3_SUCCESS;
+}
+
+static int CmdPerf(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw perf",
+                  "Show device side entry / exit durations of hot paths\n"
+                  "(trace logging, 14a decoders, MIFARE Classic auth, USB send / receive).\n"
+                  "Counters run since power up or last reset.",
+                  "hw perf\n"
+                  "hw perf --reset"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "reset", "reset counters after reporting"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool reset = arg_get_lit(ctx, 1);
+    CLIParserFree(ctx);
+
+    uint8_t flags = (reset) ? PERF_FLAG_RESET : 0;
+    clearCommandBuffer();
+    SendCommandNG(CMD_PERF, &flags, sizeof(flags));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_PERF, &resp, 1000) == false) {
+        PrintAndLogEx(WARNING, "command execution timeout");
+        return PM3_ETIMEOUT;
+    }
+    const perf_report_t *r = (const perf_report_t *)resp.data.asBytes;
+    if (resp.status != PM3_SUCCESS || resp.length < offsetof(perf_report_t, counters)) {
+        PrintAndLogEx(WARNING, "Device doesn't support performance counters");
+        return PM3_ENOTIMPL;
+    }
+
+    // older firmware reports fewer counters
+    if (r->freq == 0 || resp.length < offsetof(perf_report_t, counters) + r->count * sizeof(perf_counter_t)) {
+        return PM3_ESOFT;
+    }
+
+    static const char *names[PERF_MAX] = {
+        [PERF_LOGTRACE]            = "LogTrace",
+        [PERF_MILLER_DECODING]     = "MillerDecoding",
+        [PERF_MANCHESTER_DECODING] = "ManchesterDecoding",
+        [PERF_MFC_AUTH]            = "mifare_classic_auth",
+        [PERF_USB_SEND]            = "USB send",
+        [PERF_RELAY_UPLINK]        = "relay uplink",
+        [PERF_RELAY_REMOTE]        = "relay remote",
+        [PERF_RELAY_DOWNLINK]      = "relay downlink",
+        [PERF_RELAY_CARD]          = "relay card",
+        [PERF_USB_RECEIVE]         = "USB receive",
+    };
+
+    // ticks to microseconds
+    double tus = 1000000.0 / r->freq;
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Device performance counters") " ---------------------------------------------");
+    PrintAndLogEx(INFO, " function            |     calls |   total ms |  avg us |  min us |    max us");
+    PrintAndLogEx(INFO, "---------------------+-----------+------------+---------+---------+----------");
+    for (uint8_t i = 0; i < MIN(r->count, PERF_MAX); i++) {
+        const perf_counter_t *c = &r->counters[i];
+        if (c->calls == 0) {
+            PrintAndLogEx(INFO, " %-19s | %9u |          - |       - |       - |         -", names[i], 0);
+            continue;
+        }
+        PrintAndLogEx(INFO, " %-19s | %9u | %10.1f | %7.2f | %7.2f | %9.2f"
+                      , names[i]
+                      , c->calls
+                      , (c->total * tus) / 1000.0
+                      , (c->total * tus) / c->calls
+                      , c->min * tus
+                      , c->max * tus
+                     );
+    }
+    PrintAndLogEx(NORMAL, "");
+    if (reset) {
+        PrintAndLogEx(SUCCESS, "Counters reset");
+    }
+    return PM3_SUCCESS;
+}
+
+static int CmdSimStats(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw simstats",
+                  "Show counters of the running or last simulation session\n"
+                  "(hf 14a / mf / iclass / 15 sim, lf hitag sim).\n"
+                  "Answer time is from the end of the reader frame until the answer is ready to go out,\n"
+                  "answers slower than the protocol window are counted as late.",
+                  "hw simstats"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIParserFree(ctx);
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_SIM_STATS, NULL, 0);
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_SIM_STATS, &resp, 1000) == false) {
+        PrintAndLogEx(WARNING, "command execution timeout");
+        return PM3_ETIMEOUT;
+    }
+    if (resp.status != PM3_SUCCESS || resp.length < sizeof(sim_stats_t)) {
+        PrintAndLogEx(WARNING, "Device doesn't support simulation statistics");
+        return PM3_ENOTIMPL;
+    }
+
+    const sim_stats_t *st = (const sim_stats_t *)resp.data.asBytes;
+    if (st->sim == SIM_STATS_NONE) {
+        PrintAndLogEx(INFO, "No simulation session since power up");
+        return PM3_SUCCESS;
+    }
+
+    static const char *names[] = {
+        [SIM_STATS_NONE]   = "none",
+        [SIM_STATS_14A]    = "hf 14a sim",
+        [SIM_STATS_MFC]    = "hf mf sim",
+        [SIM_STATS_ICLASS] = "hf iclass sim",
+        [SIM_STATS_15]     = "hf 15 sim",
+        [SIM_STATS_HITAG2] = "lf hitag sim",
+    };
+    const char *name = (st->sim < ARRAYLEN(names)) ? names[st->sim] : "unknown";
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Simulation session") " ---------------------------");
+    PrintAndLogEx(INFO, " simulator...... " _YELLOW_("%s") "%s", name, st->active ? " ( running )" : "");
+    PrintAndLogEx(INFO, " reader frames.. %u", st->frames);
+    PrintAndLogEx(INFO, " dropped........ %u", st->frame_errors);
+    PrintAndLogEx(INFO, " answers........ %u", st->answers);
+    PrintAndLogEx(INFO, " late........... %u ( > %u us )", st->late, st->budget_us);
+
+    if (st->answers == 0) {
+        PrintAndLogEx(NORMAL, "");
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("Answer time") " ----------------------------------");
+    for (uint8_t i = 0; i < SIM_STATS_HIST_BINS; i++) {
+        if (st->hist[i] == 0) {
+            continue;
+        }
+        if (i == SIM_STATS_HIST_BINS - 1) {
+            PrintAndLogEx(INFO, " >= %4u us  %8u  %5.1f %%", 8U << (i - 1), st->hist[i], (st->hist[i] * 100.0) / st->answers);
+        } else {
+            PrintAndLogEx(INFO, "  < %4u us  %8u  %5.1f %%", 8U << i, st->hist[i], (st->hist[i] * 100.0) / st->answers);
+        }
+    }
+    PrintAndLogEx(NORMAL, "");
+    return PM3_SUCCESS;
+}
+
+typedef struct {
+    uint32_t n;
+    uint64_t total;
+    uint32_t min;
+    uint32_t max;
+} rfbench_phase_t;
+
+static void rfbench_add(rfbench_phase_t *p, uint32_t v) {
+    if (p->n == 0 || v < p->min) {
+        p->min = v;
+    }
+    if (v > p->max) {
+        p->max = v;
+    }
+    p->total += v;
+    p->n++;
+}
+
+static void rfbench_print(const char *name, const rfbench_phase_t *p, double tus) {
+    if (p->n == 0) {
+        PrintAndLogEx(INFO, " %-14s |       - |       - |         -", name);
+        return;
+    }
+    PrintAndLogEx(INFO, " %-14s | %7.1f | %7.1f | %9.1f", name, (p->total * tus) / p->n, p->min * tus, p->max * tus);
+}
+
+static int CmdBenchRF(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw bench rf",
+                  "Run select + READ rounds against an ISO14443-A tag (MIFARE Ultralight / NTAG) on the antenna\n"
+                  "and show how long the device spends in each phase of an exchange.\n"
+                  "host rtt is the client side round trip of a whole round,  the rest is timed on the device",
+                  "hw bench rf\n"
+                  "hw bench rf -n 500 --blk 4\n"
+                  "hw bench rf --cycle           -> restart the field every round,  times FPGA setup"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("n", NULL, "<dec>", "number of rounds (def 100)"),
+        arg_u64_0(NULL, "blk", "<dec>", "block to READ (def 0)"),
+        arg_lit0(NULL, "cycle", "field off / on between rounds"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t rounds = arg_get_u32_def(ctx, 1, 100);
+    uint8_t blk = arg_get_u32_def(ctx, 2, 0);
+    bool cycle = arg_get_lit(ctx, 3);
+    CLIParserFree(ctx);
+
+    if (IfPm3Present() == false) {
+        PrintAndLogEx(WARNING, "Proxmark3 not connected");
+        return PM3_ENOTTY;
+    }
+
+    if (IfPm3Iso14443a() == false) {
+        PrintAndLogEx(WARNING, "Device doesn't support ISO14443-A");
+        return PM3_EDEVNOTSUPP;
+    }
+
+    if (rounds == 0) {
+        rounds = 1;
+    }
+
+    enum { USB_RX, FPGA_SETUP, SELECT, TX_ENCODE, TX, TAG_WAIT, RX_DECODE, USB_TX, HOST_RTT, PHASES };
+    static const char *names[PHASES] = {
+        [USB_RX]     = "USB rx",
+        [FPGA_SETUP] = "FPGA setup",
+        [SELECT]     = "select",
+        [TX_ENCODE]  = "TX encode",
+        [TX]         = "TX",
+        [TAG_WAIT]   = "tag wait",
+        [RX_DECODE]  = "RX decode",
+        [USB_TX]     = "USB tx",
+        [HOST_RTT]   = "host rtt",
+    };
+    rfbench_phase_t phases[PHASES];
+    memset(phases, 0, sizeof(phases));
+
+    uint32_t freq = 0;
+    uint32_t done = 0;
+    int res = PM3_SUCCESS;
+
+    PrintAndLogEx(INFO, "Running " _YELLOW_("%u") " rounds, READ block " _YELLOW_("%u") "...", rounds, blk);
+
+    clearCommandBuffer();
+    for (uint32_t i = 0; i < rounds; i++) {
+
+        if (kbd_enter_pressed()) {
+            PrintAndLogEx(INFO, "aborted via keyboard");
+            res = PM3_EOPABORTED;
+            break;
+        }
+
+        iso14a_rfbench_req_t req = {
+            .flags = (cycle ? ISO14A_RFBENCH_CYCLE : 0) | ((i == rounds - 1) ? ISO14A_RFBENCH_FIELD_OFF : 0),
+            .block = blk,
+        };
+
+        PacketResponseNG resp;
+        uint64_t t = usclock();
+        SendCommandNG(CMD_HF_ISO14443A_RFBENCH, (uint8_t *)&req, sizeof(req));
+        if (WaitForResponseTimeout(CMD_HF_ISO14443A_RFBENCH, &resp, 2000) == false) {
+            PrintAndLogEx(WARNING, "command execution timeout");
+            res = PM3_ETIMEOUT;
+            break;
+        }
+        t = usclock() - t;
+
+        if (resp.length < sizeof(iso14a_rfbench_resp_t)) {
+            PrintAndLogEx(WARNING, "Device doesn't support RF benchmark");
+            res = PM3_ENOTIMPL;
+            break;
+        }
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "no tag answer in round %u", i + 1);
+            res = resp.status;
+            break;
+        }
+
+        const iso14a_rfbench_resp_t *r = (const iso14a_rfbench_resp_t *)resp.data.asBytes;
+        freq = r->freq;
+
+        rfbench_add(&phases[USB_RX], r->usb_rx);
+        if (r->fpga_setup) {
+            rfbench_add(&phases[FPGA_SETUP], r->fpga_setup);
+        }
+        rfbench_add(&phases[SELECT], r->select);
+        rfbench_add(&phases[TX_ENCODE], r->tx_encode);
+        rfbench_add(&phases[TX], r->tx);
+        rfbench_add(&phases[TAG_WAIT], r->tag_wait);
+        rfbench_add(&phases[RX_DECODE], r->rx_decode);
+        // our previous reply,  the first one is whatever the device sent before
+        if (i) {
+            rfbench_add(&phases[USB_TX], r->usb_tx);
+        }
+        // host side is in us,  stored as ticks of the device clock
+        rfbench_add(&phases[HOST_RTT], (uint32_t)((t * freq) / 1000000));
+
+        if (i == 0) {
+            PrintAndLogEx(INFO, "block %u: %s", blk, sprint_hex_inrow(r->data, MIN(r->len, 16)));
+        }
+        done++;
+    }
+
+    if (done == 0 || freq == 0) {
+        return res;
+    }
+
+    double tus = 1000000.0 / freq;
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "--- " _CYAN_("RF exchange phases") " (%u rounds) ----------------", done);
+    PrintAndLogEx(INFO, " phase          |  avg us |  min us |    max us");
+    PrintAndLogEx(INFO, "----------------+---------+---------+----------");
+    for (uint8_t i = 0; i < PHASES; i++) {
+        rfbench_print(names[i], &phases[i], tus);
+    }
+    PrintAndLogEx(NORMAL, "");
+    return res;
+}
+
+static int CmdBench(const char *Cmd) {
+
+    // `hw bench rf` times the device,  the rest of `hw bench` is host only
+    const char *p = Cmd;
+    while (*p == ' ') {
+        p++;
+    }
+    if (strncmp(p, "rf", 2) == 0 && (p[2] == '\0' || p[2] == ' ')) {
+        return CmdBenchRF(p + 2);
+    }
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw bench",
+                  "Benchmark the host side crypto and key recovery cores of the client.\n"
+                  "crapto1, hardnested (per SIMD level), loclass / iClass, Hitag2, EM4x70 id48 and DESFire ciphers.\n"
+                  "Doesn't need a Proxmark3,  use it to compare crack machines or to spot regressions",
+                  "hw bench\n"
+                  "hw bench -t 2000              -> 2 s per bench\n"
+                  "hw bench --only hardnested    -> only the hardnested cores\n"
+                  "hw bench rf                   -> device side RF exchange phases,  see `hw bench rf -h`"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_u64_0("t", "time", "<ms>", "run time per bench (def 500)"),
+        arg_str0(NULL, "only", "<str>", "only benches whose name contains <str>"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    uint32_t ms = arg_get_u32_def(ctx, 1, 500);
+    int flen = 0;
+    char filter[40] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)filter, sizeof(filter) - 1, &flen);
+    CLIParserFree(ctx);
+
+    if (ms < 50) {
+        ms = 50;
+    }
+    return bench_run(ms, filter);
+}
+
+static int CmdCommStats(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw commstats",
+                  "Show client side transport statistics, round trip latency distribution and throughput.\n"
+                  "The benchmark resets the counters so they only reflect the benchmark run.",
+                  "hw commstats\n"
+                  "hw commstats --reset\n"
+                  "hw commstats --bench -n 1000 -l 512"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "reset", "reset counters"),
+        arg_lit0("b", "bench", "run throughput benchmark"),
+        arg_u64_0("n", NULL, "<dec>", "number of benchmark pings (def 200)"),
+        arg_u64_0("l", "len", "<dec>", "benchmark payload length (def 512)"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool reset = arg_get_lit(ctx, 1);
+    bool bench = arg_get_lit(ctx, 2);
+    uint32_t count = arg_get_u32_def(ctx, 3, 200);
+    uint32_t len = arg_get_u32_def(ctx, 4, PM3_CMD_DATA_SIZE);
+    CLIParserFree(ctx);
+
+    if (len > PM3_CMD_DATA_SIZE)
+        len = PM3_CMD_DATA_SIZE;
+
+    if (reset || bench) {
+        ResetCommsStats();
+    }
+
+    if (reset && (bench == false)) {
+        PrintAndLogEx(SUCCESS, "Transport counters reset");
+        return PM3_SUCCESS;
+    }
+
+    if (bench) {
+        if (g_session.pm3_present == false) {
+            PrintAndLogEx(WARNING, "Benchmark needs a connected Proxmark3");
+            return PM3_ENOTTY;
+        }
+        int res = comms_bench(MAX(count, 1), len);
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+
+    print_comms_stats();
+    return PM3_SUCCESS;
+}
+
+static void print_mem_bytes(const char *label, uint64_t bytes) {
+    PrintAndLogEx(INFO, "%s " _YELLOW_("%.1f") " MB ( %" PRIu64 " bytes )", label, (double)bytes / (1024.0 * 1024.0), bytes);
+}
+
+static int CmdMemStats(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw memstats",
+                  "Show client memory usage of the big allocators per subsystem, current and peak,\n"
+                  "and the resident size of the whole client process.\n"
+                  "Dictionaries are owned by the commands loading them, only their largest load is shown.",
+                  "hw memstats\n"
+                  "hw memstats --reset"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "reset", "reset peaks to the current usage"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool reset = arg_get_lit(ctx, 1);
+    CLIParserFree(ctx);
+
+    if (reset) {
+        memstats_reset_peak();
+        PrintAndLogEx(SUCCESS, "Memory peaks reset");
+        return PM3_SUCCESS;
+    }
+
+    memstats_entry_t st[MEMSTATS_COUNT];
+    memstats_get(st);
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Subsystems") " --------------------------");
+    PrintAndLogEx(INFO, " subsystem  |  current MB |     peak MB |    total MB | allocs");
+    PrintAndLogEx(INFO, "------------+-------------+-------------+-------------+--------");
+    uint64_t current = 0, peak = 0;
+    for (uint8_t i = 0; i < MEMSTATS_COUNT; i++) {
+        char cur[16];
+        if (st[i].live) {
+            snprintf(cur, sizeof(cur), "%11.1f", (double)st[i].current / (1024.0 * 1024.0));
+            current += st[i].current;
+        } else {
+            snprintf(cur, sizeof(cur), "%11s", "-");
+        }
+        peak += st[i].peak;
+        PrintAndLogEx(INFO, " %-10s | %s | %11.1f | %11.1f | %" PRIu64,
+                      st[i].name,
+                      cur,
+                      (double)st[i].peak / (1024.0 * 1024.0),
+                      (double)st[i].total / (1024.0 * 1024.0),
+                      st[i].allocs
+                     );
+    }
+    PrintAndLogEx(INFO, "");
+    print_mem_bytes("tracked now.....", current);
+    print_mem_bytes("sum of peaks....", peak);
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Process") " -----------------------------");
+    uint64_t rss, peak_rss;
+    if (memstats_process(&rss, &peak_rss) == false) {
+        PrintAndLogEx(INFO, "not available on this platform");
+        return PM3_SUCCESS;
+    }
+    if (rss) {
+        print_mem_bytes("resident now....", rss);
+    }
+    if (peak_rss) {
+        print_mem_bytes("resident peak...", peak_rss);
+    }
+    return PM3_SUCCESS;
+}
+
+static int CmdThroughput(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw throughput",
+                  "Throughput session for production runs. While active, every command is timed and sorted into\n"
+                  "a per card phase: detect, auth, read, write, verify, save. A detect command after any other\n"
+                  "phase starts the next card, reads after a write of the same card count as verify.\n"
+                  "Shows cards/hour, where the time goes per phase and the transport counters of the session.",
+                  "hw throughput --start -n batch42\n"
+                  "hw throughput                         --> live stats\n"
+                  "hw throughput --next                  --> close the current card\n"
+                  "hw throughput --stop -f batch42       --> stop, csv report\n"
+                  "hw throughput --stop -f batch42 --json"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "start", "start a new session"),
+        arg_lit0(NULL, "stop", "stop the session"),
+        arg_lit0(NULL, "next", "close the current card"),
+        arg_str0("n", "name", "<str>", "session name"),
+        arg_str0("f", "file", "<fn>", "save per card report to file"),
+        arg_lit0(NULL, "json", "report as JSON instead of CSV"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool start = arg_get_lit(ctx, 1);
+    bool stop = arg_get_lit(ctx, 2);
+    bool next = arg_get_lit(ctx, 3);
+    int nlen = 0;
+    char name[64] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)name, sizeof(name) - 1, &nlen);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool json = arg_get_lit(ctx, 6);
+    CLIParserFree(ctx);
+
+    if (start && stop) {
+        PrintAndLogEx(WARNING, "Use either " _YELLOW_("`--start`") " or " _YELLOW_("`--stop`"));
+        return PM3_EINVARG;
+    }
+
+    if (start) {
+        if (throughput_active()) {
+            PrintAndLogEx(INFO, "Restarting the running session");
+        }
+        throughput_start(name);
+        PrintAndLogEx(SUCCESS, "Throughput session started");
+        return PM3_SUCCESS;
+    }
+
+    if (next) {
+        throughput_next_card();
+    }
+
+    if (stop) {
+        if (throughput_active() == false) {
+            PrintAndLogEx(WARNING, "No throughput session running");
+            return PM3_EINVARG;
+        }
+        throughput_stop();
+    }
+
+    if (next && stop == false) {
+        return PM3_SUCCESS;
+    }
+
+    throughput_print();
+
+    if (fnlen) {
+        return throughput_save(filename, json);
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdConnect(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1347,13 +2070,15 @@ static int CmdConnect(const char *Cmd) {
                   "Connects to a Proxmark3 device via specified serial port.\n"
                   "Baudrate here is only for physical UART or UART-BT, NOT for USB-CDC or blue shark add-on",
                   "hw connect -p "SERIAL_PORT_EXAMPLE_H"\n"
-                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" -b 115200"
+                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" -b 115200\n"
+                  "hw connect -p "SERIAL_PORT_EXAMPLE_H" --add   -> keep current device open, see `hw select`"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("p", "port", NULL, "Serial port to connect to, else retry the last used one"),
         arg_u64_0("b", "baud", "<dec>", "Baudrate"),
+        arg_lit0(NULL, "add", "keep the current device open in the background"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1362,6 +2087,7 @@ static int CmdConnect(const char *Cmd) {
     char port[FILE_PATH_SIZE] = {0};
     CLIGetStrWithReturn(ctx, 1, (uint8_t *)port, &p_len);
     uint32_t baudrate = arg_get_u32_def(ctx, 2, USART_BAUD_RATE);
+    bool add = arg_get_lit(ctx, 3);
     CLIParserFree(ctx);
 
     if (baudrate == 0) {
@@ -1378,8 +2104,23 @@ static int CmdConnect(const char *Cmd) {
         memcpy(port, g_conn.serial_port_name, sizeof(port));
     }
 
+    pm3_device_t *parked = NULL;
     if (g_session.pm3_present) {
-        CloseProxmark(g_session.current_device);
+        if (add) {
+            parked = g_session.current_device;
+            int res = ParkProxmark();
+            if (res == PM3_EOVFLOW) {
+                PrintAndLogEx(WARNING, "Too many open devices, max %u", PM3_MAX_DEVICES);
+                return res;
+            }
+            if (res != PM3_SUCCESS) {
+                parked = NULL;
+            }
+            // a new device context
+            g_session.current_device = NULL;
+        } else {
+            CloseProxmark(g_session.current_device);
+        }
     }
 
     // 10 second timeout
@@ -1388,8 +2129,80 @@ static int CmdConnect(const char *Cmd) {
     if (g_session.pm3_present && (TestProxmark(g_session.current_device) != PM3_SUCCESS)) {
         PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark3\n");
         CloseProxmark(g_session.current_device);
+        if (parked) {
+            SelectProxmark(parked);
+        }
         return PM3_ENOTTY;
     }
+
+    if (g_session.pm3_present == false && parked) {
+        SelectProxmark(parked);
+        return PM3_ENOTTY;
+    }
+
+    lf_config_apply_tuned();
+
+    if (add && g_session.current_device && g_session.current_device->id >= 0) {
+        PrintAndLogEx(SUCCESS, "Device id... " _GREEN_("%d"), g_session.current_device->id);
+    }
+    return PM3_SUCCESS;
+}
+
+static int CmdSelect(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "hw select",
+                  "List open Proxmark3 devices or select the one commands are sent to.\n"
+                  "Other devices stay connected in the background, replies to commands still running\n"
+                  "on them are kept by the OS until they are selected again.\n"
+                  "Use `hw connect --add` to open more devices",
+                  "hw select          -> list devices\n"
+                  "hw select -i 1     -> make device 1 the active one"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_int0("i", "id", "<dec>", "device id"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    int id = arg_get_int_def(ctx, 1, -1);
+    CLIParserFree(ctx);
+
+    if (id >= 0) {
+        pm3_device_t *dev = GetProxmarkDevice(id);
+        if (dev == NULL) {
+            PrintAndLogEx(WARNING, "No open device with id %d", id);
+            return PM3_EINVARG;
+        }
+        int res = SelectProxmark(dev);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "Failed to select device %d", id);
+            return res;
+        }
+        PrintAndLogEx(SUCCESS, "Using device " _GREEN_("%d") " on " _YELLOW_("%s"), id, g_conn.serial_port_name);
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(INFO, " id | state  | port");
+    PrintAndLogEx(INFO, "----+--------+-----------------");
+    uint8_t n = 0;
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        const pm3_device_t *dev = GetProxmarkDevice(i);
+        if (dev == NULL) {
+            continue;
+        }
+        bool parked = IsProxmarkParked(dev);
+        PrintAndLogEx(INFO, " %2d | %s | %s"
+                      , i
+                      , parked ? "parked" : _GREEN_("active")
+                      , dev->g_conn->serial_port_name
+                     );
+        n++;
+    }
+    if (n == 0) {
+        PrintAndLogEx(INFO, "no open device");
+    }
     return PM3_SUCCESS;
 }
 
@@ -1455,22 +2268,29 @@ static command_t CommandTable[] = {
     {"detectreader",  CmdDetectReader, IfPm3Present,     "Detect external reader field"},
     {"status",        CmdStatus,       IfPm3Present,     "Show runtime status information about the connected Proxmark3"},
     {"tearoff",       CmdTearoff,      IfPm3Present,     "Program a tearoff hook for the next command supporting tearoff"},
+    {"throughput",    CmdThroughput,   AlwaysAvailable,  "Per card phase timing and cards/hour of production runs"},
     {"timeout",       CmdTimeout,      AlwaysAvailable,  "Set the communication timeout on the client side"},
     {"version",       CmdVersion,      AlwaysAvailable,  "Show version information about the client and Proxmark3"},
     {"-------------", CmdHelp,         AlwaysAvailable,  "----------------------- " _CYAN_("Hardware") " -----------------------"},
+    {"bench",         CmdBench,        AlwaysAvailable,  "Benchmark the host side crypto and cracking cores"},
     {"break",         CmdBreak,        IfPm3Present,     "Send break loop usb command"},
     {"bootloader",    CmdBootloader,   IfPm3Present,     "Reboot into bootloader mode"},
+    {"commstats",     CmdCommStats,    AlwaysAvailable,  "Show transport latency and throughput statistics"},
     {"connect",       CmdConnect,      AlwaysAvailable,  "Connect to the device via serial port"},
     {"dbg",           CmdDbg,          IfPm3Present,     "Set device side debug level"},
     {"fpgaoff",       CmdFPGAOff,      IfPm3Present,     "Turn off FPGA on device"},
     {"lcd",           CmdLCD,          IfPm3Lcd,         "Send command/data to LCD"},
     {"lcdreset",      CmdLCDReset,     IfPm3Lcd,         "Hardware reset LCD"},
+    {"memstats",      CmdMemStats,     AlwaysAvailable,  "Show client memory usage per subsystem"},
+    {"perf",          CmdPerf,         IfPm3Present,     "Show device side hot path timing counters"},
     {"ping",          CmdPing,         IfPm3Present,     "Test if the Proxmark3 is responsive"},
     {"readmem",       CmdReadmem,      IfPm3Present,     "Read from MCU flash"},
     {"reset",         CmdReset,        IfPm3Present,     "Reset the device"},
+    {"select",        CmdSelect,       AlwaysAvailable,  "List or select open Proxmark3 devices"},
     {"setlfdivisor",  CmdSetDivisor,   IfPm3Present,     "Drive LF antenna at 12MHz / (divisor + 1)"},
     {"sethfthresh",   CmdSetHFThreshold, IfPm3Present,   "Set thresholds in HF/14a mode"},
     {"setmux",        CmdSetMux,       IfPm3Present,     "Set the ADC mux to a specific value"},
+    {"simstats",      CmdSimStats,     IfPm3Present,     "Show counters of the last simulation session"},
     {"standalone",    CmdStandalone,   IfPm3Present,     "Start installed standalone mode on device"},
     {"tia",           CmdTia,          IfPm3Present,     "Trigger a Timing Interval Acquisition to re-adjust the RealTimeCounter divider"},
     {"tune",          CmdTune,         IfPm3Present,     "Measure tuning of device antenna"},
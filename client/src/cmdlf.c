@@ -30,8 +30,10 @@
 #include "proxgui.h"
 #include "cliparser.h"      // args parsing
 #include "graph.h"          // for graph data
+#include "preferences.h"    // lf config --tune
 #include "cmddata.h"        // for `lf search`
 #include "cmdhw.h"          // for setting FPGA image
+#include "fileutils.h"      // for realtime capture to file
 #include "cmdlfawid.h"      // for awid menu
 #include "cmdlfem.h"        // for em menu
 #include "cmdlfem410x.h"      // for em4x menu
@@ -96,6 +98,58 @@ int lfsim_wait_check(uint32_t cmd) {
     return PM3_SUCCESS;
 }
 
+// send DemodBuffer as a compact descriptor, the device generates the waveform on the fly.
+// If a streamed simulation is already running it switches to the new data right away.
+static int lfsim_stream(uint8_t modulation, uint8_t clk, uint8_t fchigh, uint8_t fclow, bool invert) {
+
+    size_t maxbits = (PM3_CMD_DATA_SIZE - sizeof(lf_simstream_t)) * 8;
+    size_t bitlen = g_DemodBufferLen;
+    if (bitlen > maxbits) {
+        PrintAndLogEx(WARNING, "DemodBuffer too long for streaming - length: %zu - max: %zu", bitlen, maxbits);
+        PrintAndLogEx(INFO, "Continuing with trimmed down data");
+        bitlen = maxbits;
+    }
+
+    size_t datalen = sizeof(lf_simstream_t) + ((bitlen + 7) / 8);
+    lf_simstream_t *payload = calloc(1, datalen);
+    if (payload == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    payload->modulation = modulation;
+    payload->clock = clk;
+    payload->fchigh = fchigh;
+    payload->fclow = fclow;
+    payload->invert = invert;
+    payload->bitlen = bitlen;
+    for (size_t i = 0; i < bitlen; i++) {
+        if (g_DemodBuffer[i] & 1) {
+            payload->bits[i >> 3] |= 0x80 >> (i & 7);
+        }
+    }
+
+    PacketResponseNG resp;
+    clearCommandBuffer();
+    SendCommandNG(CMD_LF_SIM_STREAM, (uint8_t *)payload, datalen);
+    free(payload);
+    setClockGrid(clk, 0);
+
+    if (WaitForResponseTimeout(CMD_LF_SIM_STREAM, &resp, 2000) == false) {
+        PrintAndLogEx(WARNING, "timeout while waiting for reply");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "device refused the simulation descriptor");
+        return resp.status;
+    }
+
+    PrintAndLogEx(SUCCESS, "Streaming " _YELLOW_("%zu") " bits at rf/%u", bitlen, clk);
+    PrintAndLogEx(HINT, "Run it again with other data to switch, `" _YELLOW_("hw break") "` or " _GREEN_("pm3 button") " to stop");
+    return PM3_SUCCESS;
+}
+
 static int CmdLFTune(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -514,6 +568,10 @@ int CmdFlexdemod(const char *Cmd) {
 
     // iceman,  use g_DemodBuffer?  blue line?
     // HACK writing back to graphbuffer.
+    if (GraphReserve(32 * 64) == false) {
+        free(data);
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 32 * 64;
     i = 0;
     for (bit = 0; bit < 64; bit++) {
@@ -600,6 +658,104 @@ int lf_config(sample_config *config) {
     return PM3_SUCCESS;
 }
 
+// the tuned divisor / trigger threshold from preferences,  sent on connect
+int lf_config_apply_tuned(void) {
+    if (g_session.pm3_present == false)
+        return PM3_ENOTTY;
+
+    if (g_session.lf_tuned_divisor < 19 && g_session.lf_tuned_trigger < 0)
+        return PM3_SUCCESS;
+
+    sample_config config = {
+        .decimation = -1,
+        .bits_per_sample = -1,
+        .averaging = -1,
+        .divisor = (g_session.lf_tuned_divisor < 19) ? -1 : g_session.lf_tuned_divisor,
+        .trigger_threshold = g_session.lf_tuned_trigger,
+        .samples_to_skip = -1,
+        .verbose = false
+    };
+    PrintAndLogEx(DEBUG, "applying tuned LF config, divisor %d trigger %d", config.divisor, config.trigger_threshold);
+    return lf_config(&config);
+}
+
+// Reads the tag on the antenna at 125 and 134 kHz and keeps the carrier it answers loudest on.
+// The trigger threshold goes to a quarter of the peak to peak swing,  captures then start on the
+// tag modulation rather than on the field settling.  Result is kept in preferences.
+static int lf_config_tune(void) {
+
+    sample_config saved;
+    int res = lf_config_savereset(&saved);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    const int16_t divisors[] = { LF_DIVISOR_125, LF_DIVISOR_134 };
+    int16_t best_div = -1;
+    int best_swing = 0;
+
+    const size_t nsamples = 12000;
+    uint8_t *samples = calloc(nsamples, sizeof(uint8_t));
+    if (samples == NULL) {
+        lf_config(&saved);
+        return PM3_EMALLOC;
+    }
+
+    for (uint8_t i = 0; i < ARRAYLEN(divisors); i++) {
+
+        sample_config config = {
+            .decimation = -1,
+            .bits_per_sample = -1,
+            .averaging = -1,
+            .divisor = divisors[i],
+            .trigger_threshold = -1,
+            .samples_to_skip = -1,
+            .verbose = false
+        };
+        lf_config(&config);
+
+        if (lf_read(false, nsamples) != PM3_SUCCESS) {
+            continue;
+        }
+
+        size_t n = getFromGraphBufferEx(samples, nsamples);
+        computeSignalProperties(samples, n);
+        signal_t *sig = getSignalProperties();
+        int swing = sig->high - sig->low;
+
+        PrintAndLogEx(INFO, "%3.0f kHz... swing " _YELLOW_("%3d") " %s"
+                      , LF_DIV2FREQ(divisors[i])
+                      , swing
+                      , (sig->isnoise) ? _RED_("noise") : _GREEN_("signal")
+                     );
+
+        if (sig->isnoise == false && swing > best_swing) {
+            best_swing = swing;
+            best_div = divisors[i];
+        }
+    }
+    free(samples);
+
+    if (best_div == -1) {
+        PrintAndLogEx(FAILED, "no tag signal found, keeping the current config");
+        lf_config(&saved);
+        return PM3_ESOFT;
+    }
+
+    g_session.lf_tuned_divisor = best_div;
+    g_session.lf_tuned_trigger = MIN(best_swing / 4, 128);
+    PrintAndLogEx(SUCCESS, "tuned... " _GREEN_("%.0f") " kHz, trigger threshold " _GREEN_("%d")
+                  , LF_DIV2FREQ(g_session.lf_tuned_divisor)
+                  , g_session.lf_tuned_trigger
+                 );
+
+    // back to what the user had,  with the tuned values on top
+    lf_config(&saved);
+    lf_config_apply_tuned();
+    preferences_save();
+    return PM3_SUCCESS;
+}
+
 int CmdLFConfig(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf config",
@@ -612,6 +768,7 @@ int CmdLFConfig(const char *Cmd) {
                   "lf config -b 4 --134 --dec 3 --> samples at 134 kHz, averages three samples into one, stored with a resolution of 4 bits per sample\n"
                   "lf config --trig 20 -s 10000 --> trigger sampling when above 20, skip 10 000 first samples after triggered\n"
                   "lf config --reset            --> reset back to default values\n"
+                  "lf config --tune             --> pick frequency and trigger for the tag on the antenna, applied on every connect\n"
                  );
 
     char div_str[70] = {0};
@@ -629,6 +786,7 @@ int CmdLFConfig(const char *Cmd) {
         arg_lit0("r", "reset", "reset values to defaults"),
         arg_int0("s", "skip", "<dec>", "sets a number of samples to skip before capture (default 0)"),
         arg_int0("t", "trig", "<0-128>", "sets trigger threshold. 0 means no threshold"),
+        arg_lit0(NULL, "tune", "tune frequency / trigger threshold for the tag on the antenna and keep it in preferences"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -642,11 +800,16 @@ int CmdLFConfig(const char *Cmd) {
     bool reset = arg_get_lit(ctx, 8);
     int32_t skip = arg_get_int_def(ctx, 9, -1);
     int16_t trigg = arg_get_int_def(ctx, 10, -1);
+    bool tune = arg_get_lit(ctx, 11);
     CLIParserFree(ctx);
 
     if (g_session.pm3_present == false)
         return PM3_ENOTTY;
 
+    if (tune) {
+        return lf_config_tune();
+    }
+
     // if called with no params, just print the device config
     if (strlen(Cmd) == 0) {
         return lf_config(NULL);
@@ -714,6 +877,12 @@ int CmdLFConfig(const char *Cmd) {
     config.samples_to_skip = skip;
 
     if (reset) {
+        // forget the tuned values too
+        if (g_session.lf_tuned_divisor != -1 || g_session.lf_tuned_trigger != -1) {
+            g_session.lf_tuned_divisor = -1;
+            g_session.lf_tuned_trigger = -1;
+            preferences_save();
+        }
         config.decimation = 1;
         config.bits_per_sample = 8;
         config.averaging = 1,
@@ -725,7 +894,179 @@ int CmdLFConfig(const char *Cmd) {
     return lf_config(&config);
 }
 
-static int lf_read_internal(bool realtime, bool verbose, uint64_t samples) {
+// Real-time sampling,  the device streams raw samples until the requested amount is received.
+// With a filename the samples land straight in a memory mapped file, so the capture length
+// isn't bound by host RAM nor by the graph buffer. The graph then shows the last
+// MAX_GRAPH_TRACE_LEN samples of the capture.
+static int lf_realtime_capture(uint16_t cmd, lf_sample_payload_t *payload, uint8_t bits_per_sample, bool is_trigger_threshold_set, uint64_t samples, bool verbose, const char *filename) {
+
+    size_t sample_bytes = samples * bits_per_sample;
+    sample_bytes = (sample_bytes / 8) + (sample_bytes % 8 != 0);
+
+    mapped_file_t mf = {0};
+    uint8_t *realtimeBuf = NULL;
+    if (filename) {
+        int res = createMappedFile(filename, ".bin", sample_bytes, &mf);
+        if (res != PM3_SUCCESS) {
+            PrintAndLogEx(FAILED, "failed to create capture file");
+            return res;
+        }
+        realtimeBuf = mf.data;
+    } else {
+        realtimeBuf = calloc(sample_bytes, sizeof(uint8_t));
+        if (realtimeBuf == NULL) {
+            PrintAndLogEx(FAILED, "failed to allocate memory");
+            return PM3_EMALLOC;
+        }
+    }
+
+    // In real-time mode, the LF bitstream should be loaded before receiving raw data.
+    // Otherwise, the first batch of raw data might contain the response of CMD_WTX.
+    int result = set_fpga_mode(FPGA_BITSTREAM_LF);
+    if (result != PM3_SUCCESS) {
+        PrintAndLogEx(FAILED, "failed to load LF bitstream to FPGA");
+        if (filename) {
+            closeMappedFile(&mf, 0);
+        } else {
+            free(realtimeBuf);
+        }
+        return result;
+    }
+
+    SendCommandNG(cmd, (uint8_t *)payload, sizeof(lf_sample_payload_t));
+    if (is_trigger_threshold_set) {
+        size_t first_receive_len = 32;
+        // Wait until a bunch of data arrives
+        first_receive_len = WaitForRawDataTimeout(realtimeBuf, first_receive_len, -1, false);
+        sample_bytes = WaitForRawDataTimeout(realtimeBuf + first_receive_len, sample_bytes - first_receive_len, 1000, true);
+        sample_bytes += first_receive_len;
+    } else {
+        sample_bytes = WaitForRawDataTimeout(realtimeBuf, sample_bytes, 1000, true);
+    }
+    samples = sample_bytes * 8 / bits_per_sample;
+    PrintAndLogEx(INFO, "Done: %" PRIu64 " samples (%zu bytes)", samples, sample_bytes);
+    if (samples != 0) {
+        // keep the tail of long captures,  start on a byte boundary for packed samples
+        uint64_t start = 0;
+        if (samples > MAX_GRAPH_TRACE_LEN) {
+            start = ((samples - MAX_GRAPH_TRACE_LEN) + 7) & ~7ULL;
+            PrintAndLogEx(INFO, "Graph shows the last " _YELLOW_("%" PRIu64) " samples", samples - start);
+        }
+        getSamplesFromBufEx(realtimeBuf + (start * bits_per_sample / 8), samples - start, bits_per_sample, verbose);
+    }
+
+    if (filename) {
+        closeMappedFile(&mf, sample_bytes);
+    } else {
+        free(realtimeBuf);
+    }
+    return PM3_SUCCESS;
+}
+
+// windowed capture defaults,  ~10 s at 125 kHz
+#define LF_WINDOW_DEF_SAMPLES   1250000
+#define LF_WINDOW_DEF_THRESHOLD 20
+#define LF_WINDOW_DEF_PRE       64
+#define LF_WINDOW_DEF_HOLD      500
+#define LF_WINDOW_DEF_GAP       1000
+
+// Windowed capture,  the device only keeps the samples around modulation bursts.
+// `samples` raw samples are watched,  the graph gets the windows with at most max_gap quiet samples in between
+static int lf_windowed_capture(bool reader_field, bool verbose, uint64_t samples, uint16_t pre, uint16_t hold, int thr, uint32_t max_gap) {
+    if (g_session.pm3_present == false) return PM3_ENOTTY;
+
+    sample_config current_config;
+    int res = lf_getconfig(&current_config);
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(ERR, "failed to get current device config");
+        return res;
+    }
+
+    if (thr < 0) {
+        thr = (current_config.trigger_threshold > 0) ? current_config.trigger_threshold : LF_WINDOW_DEF_THRESHOLD;
+    }
+
+    lf_window_payload_t payload = {
+        .samples = (samples == 0 || samples > UINT32_MAX) ? LF_WINDOW_DEF_SAMPLES : samples,
+        .pre = pre,
+        .hold = hold,
+        .threshold = (thr > 127) ? 127 : thr,
+        .reader_field = reader_field,
+        .verbose = verbose,
+    };
+
+    // one sample per divisor period of the 12 MHz clock,  plus the field settle time
+    uint64_t timeout = ((uint64_t)payload.samples * (current_config.divisor + 1)) / 12000 + 3000;
+
+    PrintAndLogEx(INFO, "Watching " _YELLOW_("%u") " samples for bursts over " _YELLOW_("%u") ", press " _GREEN_("pm3 button") " to stop early", payload.samples, payload.threshold);
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_LF_ACQ_WINDOWED, (uint8_t *)&payload, sizeof(payload));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_LF_ACQ_WINDOWED, &resp, timeout) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    if ((resp.status != PM3_SUCCESS && resp.status != PM3_EOPABORTED) || resp.length != sizeof(lf_window_result_t)) {
+        PrintAndLogEx(FAILED, "windowed capture failed");
+        return PM3_ESOFT;
+    }
+
+    lf_window_result_t result;
+    memcpy(&result, resp.data.asBytes, sizeof(result));
+
+    if (resp.status == PM3_EOPABORTED) {
+        PrintAndLogEx(INFO, "capture stopped early");
+    }
+
+    if (result.windows == 0) {
+        ClearGraph(true);
+        PrintAndLogEx(INFO, "no burst found in " _YELLOW_("%u") " samples", result.span);
+        return PM3_SUCCESS;
+    }
+
+    uint8_t *got = calloc(result.bytes, sizeof(uint8_t));
+    if (got == NULL) {
+        PrintAndLogEx(FAILED, "failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    if (GetFromDevice(BIG_BUF, got, result.bytes, 0, NULL, 0, NULL, 10000, true) == false) {
+        PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+        free(got);
+        return PM3_ETIMEOUT;
+    }
+
+    if (verbose) {
+        PrintAndLogEx(INFO, "  # |      start |   len");
+        PrintAndLogEx(INFO, "----+------------+-------");
+        size_t off = 0;
+        for (uint32_t i = 0; i < result.windows && off + sizeof(lf_window_hdr_t) <= result.bytes; i++) {
+            lf_window_hdr_t hdr;
+            memcpy(&hdr, got + off, sizeof(hdr));
+            PrintAndLogEx(INFO, "%3u | %10u | %5u", i, hdr.start, hdr.len);
+            off += sizeof(hdr) + hdr.len;
+        }
+    }
+
+    uint32_t placed = setGraphFromWindows(got, result.bytes, max_gap);
+    free(got);
+
+    PrintAndLogEx(SUCCESS, "Got " _YELLOW_("%u") " windows, " _YELLOW_("%u") " bytes for a span of " _YELLOW_("%u") " samples ( %.1fx )",
+                  result.windows,
+                  result.bytes,
+                  result.span,
+                  (double)result.span / result.bytes
+                 );
+    if (placed != result.windows) {
+        PrintAndLogEx(INFO, "graph shows " _YELLOW_("%u") " of them", placed);
+    }
+    PrintAndLogEx(HINT, "Hint: window positions are temporary markers in " _YELLOW_("`data plot`"));
+    return PM3_SUCCESS;
+}
+
+static int lf_read_internal(bool realtime, bool verbose, uint64_t samples, const char *filename) {
     if (!g_session.pm3_present) return PM3_ENOTTY;
 
     lf_sample_payload_t payload = {0};
@@ -743,41 +1084,10 @@ static int lf_read_internal(bool realtime, bool verbose, uint64_t samples) {
     const bool is_trigger_threshold_set = (current_config.trigger_threshold > 0);
 
     if (realtime) {
-        uint8_t *realtimeBuf = calloc(samples, sizeof(uint8_t));
-        if (realtimeBuf == NULL) {
-            PrintAndLogEx(FAILED, "failed to allocate memory");
-            return PM3_EMALLOC;
-        }
-
-        size_t sample_bytes = samples * bits_per_sample;
-        sample_bytes = (sample_bytes / 8) + (sample_bytes % 8 != 0);
-
-        // In real-time mode, the LF bitstream should be loaded before receiving raw data.
-        // Otherwise, the first batch of raw data might contain the response of CMD_WTX.
-        int result = set_fpga_mode(FPGA_BITSTREAM_LF);
-        if (result != PM3_SUCCESS) {
-            PrintAndLogEx(FAILED, "failed to load LF bitstream to FPGA");
-            free(realtimeBuf);
-            return result;
-        }
-
-        SendCommandNG(CMD_LF_ACQ_RAW_ADC, (uint8_t *)&payload, sizeof(payload));
-        if (is_trigger_threshold_set) {
-            size_t first_receive_len = 32;
-            // Wait until a bunch of data arrives
-            first_receive_len = WaitForRawDataTimeout(realtimeBuf, first_receive_len, -1, false);
-            sample_bytes = WaitForRawDataTimeout(realtimeBuf + first_receive_len, sample_bytes - first_receive_len, 1000, true);
-            sample_bytes += first_receive_len;
-        } else {
-            sample_bytes = WaitForRawDataTimeout(realtimeBuf, sample_bytes, 1000, true);
-        }
-        samples = sample_bytes * 8 / bits_per_sample;
-        PrintAndLogEx(INFO, "Done: %" PRIu64 " samples (%zu bytes)", samples, sample_bytes);
-        if (samples != 0) {
-            getSamplesFromBufEx(realtimeBuf, samples, bits_per_sample, verbose);
+        int res = lf_realtime_capture(CMD_LF_ACQ_RAW_ADC, &payload, bits_per_sample, is_trigger_threshold_set, samples, verbose, filename);
+        if (res != PM3_SUCCESS) {
+            return res;
         }
-
-        free(realtimeBuf);
     } else {
         payload.samples = (samples > MAX_LF_SAMPLES) ? MAX_LF_SAMPLES : samples;
         SendCommandNG(CMD_LF_ACQ_RAW_ADC, (uint8_t *)&payload, sizeof(payload));
@@ -799,7 +1109,7 @@ static int lf_read_internal(bool realtime, bool verbose, uint64_t samples) {
 }
 
 int lf_read(bool verbose, uint64_t samples) {
-    return lf_read_internal(false, verbose, samples);
+    return lf_read_internal(false, verbose, samples, NULL);
 }
 
 int CmdLFRead(const char *Cmd) {
@@ -812,6 +1122,8 @@ int CmdLFRead(const char *Cmd) {
                   _CYAN_("it will try to use the real-time sampling mode."),
                   "lf read -v -s 12000   --> collect 12000 samples\n"
                   "lf read -s 3000 -@    --> oscilloscope style \n"
+                  "lf read -s 60000000 -f lf_capture  --> stream 60M samples to file\n"
+                  "lf read -w -s 2000000  --> keep only the bursts out of 2M samples\n"
                  );
 
     void *argtable[] = {
@@ -819,17 +1131,44 @@ int CmdLFRead(const char *Cmd) {
         arg_u64_0("s", "samples", "<dec>", "number of samples to collect"),
         arg_lit0("v", "verbose", "verbose output"),
         arg_lit0("@", NULL, "continuous reading mode"),
+        arg_str0("f", "file", "<fn>", "stream samples to binary file (real-time mode, no graph size limit)"),
+        arg_lit0("w", "window", "windowed capture, keep only the samples around modulation bursts"),
+        arg_int0(NULL, "thr", "<dec>", "window burst threshold (def lf config trigger, else 20)"),
+        arg_u64_0(NULL, "pre", "<dec>", "window samples kept before a burst (def 64)"),
+        arg_u64_0(NULL, "hold", "<dec>", "window quiet samples closing a window (def 500)"),
+        arg_u64_0(NULL, "gap", "<dec>", "window max quiet samples between windows in the graph (def 1000)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     uint64_t samples = arg_get_u64_def(ctx, 1, 0);
     bool verbose = arg_get_lit(ctx, 2);
     bool cm = arg_get_lit(ctx, 3);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool window = arg_get_lit(ctx, 5);
+    int thr = arg_get_int_def(ctx, 6, -1);
+    uint32_t pre = arg_get_u32_def(ctx, 7, LF_WINDOW_DEF_PRE);
+    uint32_t hold = arg_get_u32_def(ctx, 8, LF_WINDOW_DEF_HOLD);
+    uint32_t gap = arg_get_u32_def(ctx, 9, LF_WINDOW_DEF_GAP);
     CLIParserFree(ctx);
 
+    if (window) {
+        if (fnlen || cm) {
+            PrintAndLogEx(WARNING, "Windowed capture can't be combined with " _YELLOW_("`-f`") " or " _YELLOW_("`-@`"));
+            return PM3_EINVARG;
+        }
+        return lf_windowed_capture(true, verbose, samples, MIN(pre, UINT16_MAX), MIN(hold, UINT16_MAX), thr, gap);
+    }
+
+    if (fnlen && samples == 0) {
+        PrintAndLogEx(WARNING, "Streaming to file needs the number of samples, use " _YELLOW_("`-s`"));
+        return PM3_EINVARG;
+    }
+
     // the 40000 there should be the result of BigBuf_max_traceLen(),
     // but IDK how to get it.
-    bool realtime = samples > 40000;
+    bool realtime = (samples > 40000) || (fnlen > 0);
 
     if (g_session.pm3_present == false)
         return PM3_ENOTTY;
@@ -839,7 +1178,7 @@ int CmdLFRead(const char *Cmd) {
     }
     int ret = PM3_SUCCESS;
     do {
-        ret = lf_read_internal(realtime, verbose, samples);
+        ret = lf_read_internal(realtime, verbose, samples, (fnlen) ? filename : NULL);
     } while (cm && kbd_enter_pressed() == false);
 
     if (ret == PM3_SUCCESS) {
@@ -852,7 +1191,7 @@ int CmdLFRead(const char *Cmd) {
     return ret;
 }
 
-int lf_sniff(bool realtime, bool verbose, uint64_t samples) {
+static int lf_sniff_internal(bool realtime, bool verbose, uint64_t samples, const char *filename) {
     if (!g_session.pm3_present) return PM3_ENOTTY;
 
     lf_sample_payload_t payload = {0};
@@ -870,41 +1209,10 @@ int lf_sniff(bool realtime, bool verbose, uint64_t samples) {
     const bool is_trigger_threshold_set = (current_config.trigger_threshold > 0);
 
     if (realtime) {
-        uint8_t *realtimeBuf = calloc(samples, sizeof(uint8_t));
-        if (realtimeBuf == NULL) {
-            PrintAndLogEx(FAILED, "failed to allocate memory");
-            return PM3_EMALLOC;
-        }
-
-        size_t sample_bytes = samples * bits_per_sample;
-        sample_bytes = (sample_bytes / 8) + (sample_bytes % 8 != 0);
-
-        // In real-time mode, the LF bitstream should be loaded before receiving raw data.
-        // Otherwise, the first batch of raw data might contain the response of CMD_WTX.
-        int result = set_fpga_mode(FPGA_BITSTREAM_LF);
-        if (result != PM3_SUCCESS) {
-            PrintAndLogEx(FAILED, "failed to load LF bitstream to FPGA");
-            free(realtimeBuf);
-            return result;
+        int res = lf_realtime_capture(CMD_LF_SNIFF_RAW_ADC, &payload, bits_per_sample, is_trigger_threshold_set, samples, verbose, filename);
+        if (res != PM3_SUCCESS) {
+            return res;
         }
-
-        SendCommandNG(CMD_LF_SNIFF_RAW_ADC, (uint8_t *)&payload, sizeof(payload));
-        if (is_trigger_threshold_set) {
-            size_t first_receive_len = 32;
-            // Wait until a bunch of data arrives
-            first_receive_len = WaitForRawDataTimeout(realtimeBuf, first_receive_len, -1, false);
-            sample_bytes = WaitForRawDataTimeout(realtimeBuf + first_receive_len, sample_bytes - first_receive_len, 1000, true);
-            sample_bytes += first_receive_len;
-        } else {
-            sample_bytes = WaitForRawDataTimeout(realtimeBuf, sample_bytes, 1000, true);
-        }
-        samples = sample_bytes * 8 / bits_per_sample;
-        PrintAndLogEx(INFO, "Done: %" PRIu64 " samples (%zu bytes)", samples, sample_bytes);
-        if (samples != 0) {
-            getSamplesFromBufEx(realtimeBuf, samples, bits_per_sample, verbose);
-        }
-
-        free(realtimeBuf);
     } else {
         payload.samples = (samples > MAX_LF_SAMPLES) ? MAX_LF_SAMPLES : samples;
         SendCommandNG(CMD_LF_SNIFF_RAW_ADC, (uint8_t *)&payload, sizeof(payload));
@@ -925,6 +1233,10 @@ int lf_sniff(bool realtime, bool verbose, uint64_t samples) {
     return PM3_SUCCESS;
 }
 
+int lf_sniff(bool realtime, bool verbose, uint64_t samples) {
+    return lf_sniff_internal(realtime, verbose, samples, NULL);
+}
+
 int CmdLFSniff(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf sniff",
@@ -938,6 +1250,8 @@ int CmdLFSniff(const char *Cmd) {
                   _CYAN_("it will try to use the real-time sampling mode."),
                   "lf sniff -v\n"
                   "lf sniff -s 3000 -@    --> oscilloscope style \n"
+                  "lf sniff -s 60000000 -f lf_sniff  --> stream 60M samples to file\n"
+                  "lf sniff -w -s 5000000 --thr 30  --> keep only the bursts out of 5M samples\n"
                  );
 
     void *argtable[] = {
@@ -945,17 +1259,44 @@ int CmdLFSniff(const char *Cmd) {
         arg_u64_0("s", "samples", "<dec>", "number of samples to collect"),
         arg_lit0("v", "verbose", "verbose output"),
         arg_lit0("@", NULL, "continuous sniffing mode"),
+        arg_str0("f", "file", "<fn>", "stream samples to binary file (real-time mode, no graph size limit)"),
+        arg_lit0("w", "window", "windowed capture, keep only the samples around modulation bursts"),
+        arg_int0(NULL, "thr", "<dec>", "window burst threshold (def lf config trigger, else 20)"),
+        arg_u64_0(NULL, "pre", "<dec>", "window samples kept before a burst (def 64)"),
+        arg_u64_0(NULL, "hold", "<dec>", "window quiet samples closing a window (def 500)"),
+        arg_u64_0(NULL, "gap", "<dec>", "window max quiet samples between windows in the graph (def 1000)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     uint64_t samples = arg_get_u64_def(ctx, 1, 0);
     bool verbose = arg_get_lit(ctx, 2);
     bool cm = arg_get_lit(ctx, 3);
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool window = arg_get_lit(ctx, 5);
+    int thr = arg_get_int_def(ctx, 6, -1);
+    uint32_t pre = arg_get_u32_def(ctx, 7, LF_WINDOW_DEF_PRE);
+    uint32_t hold = arg_get_u32_def(ctx, 8, LF_WINDOW_DEF_HOLD);
+    uint32_t gap = arg_get_u32_def(ctx, 9, LF_WINDOW_DEF_GAP);
     CLIParserFree(ctx);
 
+    if (window) {
+        if (fnlen || cm) {
+            PrintAndLogEx(WARNING, "Windowed capture can't be combined with " _YELLOW_("`-f`") " or " _YELLOW_("`-@`"));
+            return PM3_EINVARG;
+        }
+        return lf_windowed_capture(false, verbose, samples, MIN(pre, UINT16_MAX), MIN(hold, UINT16_MAX), thr, gap);
+    }
+
+    if (fnlen && samples == 0) {
+        PrintAndLogEx(WARNING, "Streaming to file needs the number of samples, use " _YELLOW_("`-s`"));
+        return PM3_EINVARG;
+    }
+
     // the 40000 there should be the result of BigBuf_max_traceLen(),
     // but IDK how to get it.
-    bool realtime = samples > 40000;
+    bool realtime = (samples > 40000) || (fnlen > 0);
 
     if (g_session.pm3_present == false)
         return PM3_ENOTTY;
@@ -965,7 +1306,7 @@ int CmdLFSniff(const char *Cmd) {
     }
     int ret = PM3_SUCCESS;
     do {
-        ret = lf_sniff(realtime, verbose, samples);
+        ret = lf_sniff_internal(realtime, verbose, samples, (fnlen) ? filename : NULL);
     } while (cm && kbd_enter_pressed() == false);
     return ret;
 }
@@ -1093,7 +1434,8 @@ int CmdLFfskSim(const char *Cmd) {
                   "lf simfsk -c 64 --high 10 --low 8 -d 010203 --> FSK2  rf/64  data 010203\n"
                   "lf simfsk -c 64 --high 8 --low 10 -d 010203 --> FSK2a rf/64  data 010203\n\n"
                   "lf simfsk -c 50 --high 10 --low 8 -d 1D5559555569A9A555A59569        --> simulate HID Prox tag manually\n"
-                  "lf simfsk -c 50 --high 10 --low 8 --stt -d 011DB2487E8D811111111111  --> simulate AWID tag manually"
+                  "lf simfsk -c 50 --high 10 --low 8 --stt -d 011DB2487E8D811111111111  --> simulate AWID tag manually\n"
+                  "lf simfsk -c 50 --high 10 --low 8 --stream -d 1D5559555569A9A555A59569  --> stream, switch by running again"
                  );
 
     void *argtable[] = {
@@ -1104,6 +1446,7 @@ int CmdLFfskSim(const char *Cmd) {
         arg_lit0(NULL, "stt", "TBD! - STT to enable a gap between playback repetitions (default: no gap)"),
         arg_str0("d", "data", "<hex>", "data to sim - omit to use DemodBuffer"),
         arg_lit0("v", "verbose", "verbose output"),
+        arg_lit0(NULL, "stream", "generate waveform on device and return, rerun to switch data"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1116,6 +1459,7 @@ int CmdLFfskSim(const char *Cmd) {
     char raw[64] = {0};
     CLIGetStrWithReturn(ctx, 5, (uint8_t *)raw, &raw_len);
     bool verbose = arg_get_lit(ctx, 6);
+    bool stream = arg_get_lit(ctx, 7);
     CLIParserFree(ctx);
 
     // No args
@@ -1168,6 +1512,10 @@ int CmdLFfskSim(const char *Cmd) {
         PrintAndLogEx(DEBUG, "Autodetection of smaller clock failed, falling back to fc/%u", fclow);
     }
 
+    if (stream) {
+        return lfsim_stream(LF_SIMSTREAM_FSK, clk, fchigh, fclow, false);
+    }
+
     size_t size = g_DemodBufferLen;
     if (size > (PM3_CMD_DATA_SIZE - sizeof(lf_fsksim_t))) {
         PrintAndLogEx(WARNING, "DemodBuffer too long for current implementation - length: %zu - max: %zu", size, PM3_CMD_DATA_SIZE - sizeof(lf_fsksim_t));
@@ -1199,7 +1547,8 @@ int CmdLFaskSim(const char *Cmd) {
                   "lf simask --clk 32 --am -d 0102030405   --> simulate ASK/MAN rf/32\n"
                   "lf simask --clk 32 --bi -d 0102030405   --> simulate ASK/BIPHASE rf/32\n\n"
                   "lf simask --clk 64 --am -d ffbd8001686f1924               --> simulate a EM410x tag\n"
-                  "lf simask --clk 64 --am --stt -d 5649533200003F340000001B --> simulate a VISA2K tag"
+                  "lf simask --clk 64 --am --stt -d 5649533200003F340000001B --> simulate a VISA2K tag\n"
+                  "lf simask --clk 64 --am --stream -d ffbd8001686f1924      --> stream, switch by running again"
                  );
 
     void *argtable[] = {
@@ -1212,6 +1561,7 @@ int CmdLFaskSim(const char *Cmd) {
         arg_lit0(NULL, "stt", "add t55xx Sequence Terminator gap - default: no gaps (only manchester)"),
         arg_str0("d", "data", "<hex>", "data to sim - omit to use DemodBuffer"),
         arg_lit0("v", "verbose", "verbose output"),
+        arg_lit0(NULL, "stream", "generate waveform on device and return, rerun to switch data"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1226,6 +1576,7 @@ int CmdLFaskSim(const char *Cmd) {
     char raw[64] = {0};
     CLIGetStrWithReturn(ctx, 7, (uint8_t *)raw, &raw_len);
     bool verbose = arg_get_lit(ctx, 8);
+    bool stream = arg_get_lit(ctx, 9);
     CLIParserFree(ctx);
 
     if ((use_bi + use_am + use_ar) > 1) {
@@ -1233,6 +1584,11 @@ int CmdLFaskSim(const char *Cmd) {
         return PM3_EINVARG;
     }
 
+    if (stream && separator) {
+        PrintAndLogEx(ERR, "Sequence Terminator gap isn't available when streaming");
+        return PM3_EINVARG;
+    }
+
     uint8_t encoding = 1;
     if (use_bi)
         encoding = 2;
@@ -1279,6 +1635,11 @@ int CmdLFaskSim(const char *Cmd) {
         PrintAndLogEx(DEBUG, "ASK/RAW needs half rf. Using rf/%u", clk);
     }
 
+    if (stream) {
+        // ASK encodings 0/1/2 map straight onto the stream modulations
+        return lfsim_stream(encoding, clk, 0, 0, invert);
+    }
+
     size_t size = g_DemodBufferLen;
     if (size > (PM3_CMD_DATA_SIZE - sizeof(lf_asksim_t))) {
         PrintAndLogEx(WARNING, "DemodBuffer too long for current implementation - length: %zu - max: %zu", size, PM3_CMD_DATA_SIZE - sizeof(lf_asksim_t));
@@ -1309,7 +1670,8 @@ int CmdLFpskSim(const char *Cmd) {
     CLIParserInit(&ctx, "lf simpsk",
                   "Simulate PSK tag from DemodBuffer or input",
                   "lf simpsk -1 --clk 40 --fc 4 -d 01020304   --> simulate PSK1 rf/40 psksub fc/4, data 01020304\n\n"
-                  "lf simpsk -1 --clk 32 --fc 2 -d a0000000bd989a11   --> simulate a indala tag manually"
+                  "lf simpsk -1 --clk 32 --fc 2 -d a0000000bd989a11   --> simulate a indala tag manually\n"
+                  "lf simpsk -1 --clk 32 --fc 2 --stream -d a0000000bd989a11   --> stream, switch by running again"
                  );
 
     void *argtable[] = {
@@ -1322,6 +1684,7 @@ int CmdLFpskSim(const char *Cmd) {
         arg_u64_0(NULL, "fc", "<dec>", "2|4|8 are valid carriers (default 2)"),
         arg_str0("d", "data", "<hex>", "data to sim - omit to use DemodBuffer"),
         arg_lit0("v", "verbose", "verbose output"),
+        arg_lit0(NULL, "stream", "generate waveform on device and return, rerun to switch data"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1335,6 +1698,7 @@ int CmdLFpskSim(const char *Cmd) {
     char raw[64] = {0};
     CLIGetStrWithReturn(ctx, 7, (uint8_t *)raw, &raw_len);
     bool verbose = arg_get_lit(ctx, 8);
+    bool stream = arg_get_lit(ctx, 9);
     CLIParserFree(ctx);
 
     if ((use_psk1 + use_psk2 + use_psk3) > 1) {
@@ -1405,6 +1769,10 @@ int CmdLFpskSim(const char *Cmd) {
         PrintAndLogEx(INFO, "PSK3 not yet available. Falling back to PSK1");
     }
 
+    if (stream) {
+        return lfsim_stream(LF_SIMSTREAM_PSK1, clk, carrier, 0, invert);
+    }
+
     size_t size = g_DemodBufferLen;
     if (size > (PM3_CMD_DATA_SIZE - sizeof(lf_psksim_t))) {
         PrintAndLogEx(WARNING, "DemodBuffer too long for current implementation - length: %zu - max: %zu", size, PM3_CMD_DATA_SIZE - sizeof(lf_psksim_t));
@@ -1518,6 +1886,9 @@ int CmdVchDemod(const char *Cmd) {
 
     // clone
     if (strcmp(Cmd, "clone") == 0) {
+        if (GraphReserve(strlen(bits) * 16) == false) {
+            return PM3_EMALLOC;
+        }
         g_GraphTraceLen = 0;
         char *s;
         for (s = bits; *s; s++) {
@@ -1591,13 +1962,48 @@ out:
     return retval;
 }
 
-static int check_autocorrelate(const char *prefix, int clock) {
+#define AUTOCORR_WINDOWS 14
+
+// The modulation checks of lf search correlate the same graph buffer over and over,
+// the snapshot tells if the buffer is still the one the distances belong to
+typedef struct {
+    int *snapshot;
+    size_t len;
+    int distances[AUTOCORR_WINDOWS];
+} autocorr_cache_t;
+
+static int check_autocorrelate(const char *prefix, int clock, autocorr_cache_t *cache) {
 
     PrintAndLogEx(NORMAL, "");
     PrintAndLogEx(INFO, _CYAN_("%s - auto correlations"), prefix);
-    for (int win = 2000; win < 30000; win += 2000) {
-        int samples = AutoCorrelate(g_GraphBuffer, g_GraphBuffer, g_GraphTraceLen, win, false, false);
+
+    bool cached = (cache->snapshot && cache->len == g_GraphTraceLen &&
+                   memcmp(cache->snapshot, g_GraphBuffer, g_GraphTraceLen * sizeof(int)) == 0);
+    if (cached == false) {
+
+        // one correlation pass serves all window sizes
+        size_t windows[AUTOCORR_WINDOWS];
+        for (size_t w = 0; w < ARRAYLEN(windows); w++) {
+            windows[w] = 2000 + (w * 2000);
+        }
+
+        if (AutoCorrelateWindows(g_GraphBuffer, g_GraphTraceLen, windows, cache->distances, ARRAYLEN(windows)) != PM3_SUCCESS) {
+            return PM3_EMALLOC;
+        }
+
+        free(cache->snapshot);
+        cache->len = 0;
+        cache->snapshot = calloc(g_GraphTraceLen, sizeof(int));
+        if (cache->snapshot) {
+            memcpy(cache->snapshot, g_GraphBuffer, g_GraphTraceLen * sizeof(int));
+            cache->len = g_GraphTraceLen;
+        }
+    }
+
+    for (size_t w = 0; w < AUTOCORR_WINDOWS; w++) {
+        int samples = cache->distances[w];
         if (samples == -1) {
+            PrintAndLogEx(HINT, "No repeating pattern found, try increasing window size");
             continue;
         }
 
@@ -1630,6 +2036,26 @@ static int check_autocorrelate(const char *prefix, int clock) {
     return PM3_EFAILED;
 }
 
+// report a tag found by lf search, the demodulated bits go to the structured result too
+static void lf_search_found(const char *name, bool demod) {
+    PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("%s") " found!", name);
+    if (ResultIsOpen() == false) {
+        return;
+    }
+    ResultAppendStr("tags", name);
+    char *hex = NULL;
+    if (demod && g_DemodBufferLen) {
+        size_t hexlen = (g_DemodBufferLen / 4) + 2;
+        hex = calloc(hexlen, sizeof(char));
+        if (hex) {
+            binarray_2_hex(hex, hexlen, (char *)g_DemodBuffer, g_DemodBufferLen);
+        }
+    }
+    // "raw" is kept index aligned with "tags", empty when there is nothing demodulated
+    ResultAppendStr("raw", hex ? hex : "");
+    free(hex);
+}
+
 int CmdLFfind(const char *Cmd) {
 
     CLIParserContext *ctx;
@@ -1679,7 +2105,7 @@ int CmdLFfind(const char *Cmd) {
 
         if (IfPm3Hitag()) {
             if (readHitagUid() == PM3_SUCCESS) {
-                PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Hitag") " found!");
+                lf_search_found("Hitag", false);
                 if (search_cont) {
                     found++;
                 } else {
@@ -1691,7 +2117,7 @@ int CmdLFfind(const char *Cmd) {
 #if !defined ICOPYX
         if (IfPm3EM4x50()) {
             if (read_em4x50_uid() == PM3_SUCCESS) {
-                PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM4x50 ID") " found!");
+                lf_search_found("EM4x50 ID", false);
                 if (search_cont) {
                     found++;
                 } else {
@@ -1707,7 +2133,7 @@ int CmdLFfind(const char *Cmd) {
 
             PrintAndLogEx(INPLACE, "Searching for MOTOROLA tag...");
             if (readMotorolaUid()) {
-                PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Motorola FlexPass ID") " found!");
+                lf_search_found("Motorola FlexPass ID", false);
                 if (search_cont) {
                     found++;
                 } else {
@@ -1717,7 +2143,7 @@ int CmdLFfind(const char *Cmd) {
 
             PrintAndLogEx(INPLACE, "Searching for COTAG tag...");
             if (readCOTAGUid()) {
-                PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("COTAG ID") " found!");
+                lf_search_found("COTAG ID", false);
                 if (search_cont) {
                     found++;
                 } else {
@@ -1739,7 +2165,7 @@ int CmdLFfind(const char *Cmd) {
 
     // ask / man
     if (demodEM410x(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("EM410x ID") " found!");
+        lf_search_found("EM410x ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1747,7 +2173,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodDestron(true) == PM3_SUCCESS) { // to do before HID
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-A FECAVA Destron ID") " found!");
+        lf_search_found("FDX-A FECAVA Destron ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1755,7 +2181,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodGallagher(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("GALLAGHER ID") " found!");
+        lf_search_found("GALLAGHER ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1763,7 +2189,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodNoralsy(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Noralsy ID") " found!");
+        lf_search_found("Noralsy ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1771,7 +2197,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodPresco(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Presco ID") " found!");
+        lf_search_found("Presco ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1779,7 +2205,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodSecurakey(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Securakey ID") " found!");
+        lf_search_found("Securakey ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1787,7 +2213,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodViking(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Viking ID") " found!");
+        lf_search_found("Viking ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1795,7 +2221,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodVisa2k(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Visa2000 ID") " found!");
+        lf_search_found("Visa2000 ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1805,7 +2231,7 @@ int CmdLFfind(const char *Cmd) {
 
     // ask / bi
     if (demodFDXB(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("FDX-B ID") " found!");
+        lf_search_found("FDX-B ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1813,7 +2239,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodJablotron(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Jablotron ID") " found!");
+        lf_search_found("Jablotron ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1821,7 +2247,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodGuard(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Guardall G-Prox II ID") " found!");
+        lf_search_found("Guardall G-Prox II ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1829,7 +2255,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodNedap(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NEDAP ID") " found!");
+        lf_search_found("NEDAP ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1839,7 +2265,7 @@ int CmdLFfind(const char *Cmd) {
 
     // nrz
     if (demodPac(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("PAC/Stanley ID") " found!");
+        lf_search_found("PAC/Stanley ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1849,7 +2275,7 @@ int CmdLFfind(const char *Cmd) {
 
     // fsk
     if (demodHID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("HID Prox ID") " found!");
+        lf_search_found("HID Prox ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1857,7 +2283,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodAWID(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("AWID ID") " found!");
+        lf_search_found("AWID ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1865,7 +2291,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodIOProx(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("IO Prox ID") " found!");
+        lf_search_found("IO Prox ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1873,7 +2299,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodPyramid(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Pyramid ID") " found!");
+        lf_search_found("Pyramid ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1881,7 +2307,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodParadox(true, false) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Paradox ID") " found!");
+        lf_search_found("Paradox ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1891,7 +2317,7 @@ int CmdLFfind(const char *Cmd) {
 
     // psk
     if (demodIdteck(NULL, true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Idteck ID") " found!");
+        lf_search_found("Idteck ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1899,7 +2325,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodKeri(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("KERI ID") " found!");
+        lf_search_found("KERI ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1907,7 +2333,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodNexWatch(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("NexWatch ID") " found!");
+        lf_search_found("NexWatch ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1915,7 +2341,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodIndala(true) == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Indala ID") " found!");
+        lf_search_found("Indala ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1924,7 +2350,7 @@ int CmdLFfind(const char *Cmd) {
     }
     /*
     if (demodTI() == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Texas Instrument ID") " found!");
+        lf_search_found("Texas Instrument ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1932,7 +2358,7 @@ int CmdLFfind(const char *Cmd) {
         }
     }
     if (demodFermax() == PM3_SUCCESS) {
-        PrintAndLogEx(SUCCESS, "\nValid " _GREEN_("Fermax ID") " found!");
+        lf_search_found("Fermax ID", true);
         if (search_cont) {
             found++;
         } else {
@@ -1958,13 +2384,15 @@ int CmdLFfind(const char *Cmd) {
             1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
         };
 
+        autocorr_cache_t autocorr = { NULL, 0, {0} };
+
         // FSK
         PrintAndLogEx(INFO, "FSK clock.......... " NOLF);
         int clock = GetFskClock("", false);
         if (clock) {
             PrintAndLogEx(NORMAL, _GREEN_("detected"));
             if (FSKrawDemod(0, 0, 0, 0, true) == PM3_SUCCESS) {
-                check_autocorrelate("FSK", clock);
+                check_autocorrelate("FSK", clock, &autocorr);
                 found++;
             } else {
                 PrintAndLogEx(INFO, "FSK demodulation... " _RED_("failed"));
@@ -1983,7 +2411,7 @@ int CmdLFfind(const char *Cmd) {
                 PrintAndLogEx(NORMAL, "");
                 PrintAndLogEx(INFO, _GREEN_("ASK") " modulation / Manchester encoding detected!");
                 PrintAndLogEx(INFO, "   could also be ASK/Biphase - try " _YELLOW_("'data rawdemod --ab'"));
-                check_autocorrelate("ASK", clock);
+                check_autocorrelate("ASK", clock, &autocorr);
                 found++;
             } else {
                 PrintAndLogEx(INFO, "ASK demodulation... " _RED_("failed"));
@@ -2002,7 +2430,7 @@ int CmdLFfind(const char *Cmd) {
                 int min = MIN(g_DemodBufferLen, sizeof(ones));
                 // if demodulated binary is only 1,  skip autocorrect
                 if (memcmp(g_DemodBuffer, ones, min) != 0) {
-                    check_autocorrelate("NRZ", clock);
+                    check_autocorrelate("NRZ", clock, &autocorr);
                     found++;
                 } else {
                     PrintAndLogEx(INFO, "NRZ ............... " _RED_("false positive"));
@@ -2025,7 +2453,7 @@ int CmdLFfind(const char *Cmd) {
                 PrintAndLogEx(INFO, "    Could also be PSK2 - try " _YELLOW_("'data rawdemod --p2'"));
                 PrintAndLogEx(INFO, "    Could also be PSK3 - [currently not supported]");
                 PrintAndLogEx(INFO, "    Could also be  NRZ - try " _YELLOW_("'data rawdemod --nr"));
-                check_autocorrelate("PSK", clock);
+                check_autocorrelate("PSK", clock, &autocorr);
                 found++;
             } else {
                 PrintAndLogEx(INFO, "PSK demodulation... " _RED_("failed"));
@@ -2034,6 +2462,8 @@ int CmdLFfind(const char *Cmd) {
             PrintAndLogEx(NORMAL, _RED_("no"));
         }
 
+        free(autocorr.snapshot);
+
         if (found == 0) {
             PrintAndLogEx(FAILED, _RED_("Failed to demodulated signal"));
         }
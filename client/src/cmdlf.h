@@ -44,6 +44,7 @@ int lf_read(bool verbose, uint64_t samples);
 int lf_sniff(bool realtime, bool verbose, uint64_t samples);
 int lf_config(sample_config *config);
 int lf_getconfig(sample_config *config);
+int lf_config_apply_tuned(void);
 int lfsim_upload_gb(void);
 int lfsim_wait_check(uint32_t cmd);
 
@@ -313,20 +313,27 @@ static int CmdEM410xWatch(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf em 410x watch",
                   "Enables Electro Marine (EM) compatible reader mode printing details of scanned tags.\n"
+                  "A tag is printed again only once it was gone for the de-dup window.\n"
                   "Run until the button is pressed or another USB command is issued.",
-                  "lf em 410x watch"
+                  "lf em 410x watch\n"
+                  "lf em 410x watch -w 0      -> print every read"
                  );
 
     void *argtable[] = {
         arg_param_begin,
+        arg_u64_0("w", "window", "<ms>", "de-dup window in ms (default 2000, 0 = print every read)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
+    struct {
+        uint32_t window;
+    } PACKED payload;
+    payload.window = arg_get_u32_def(ctx, 1, 2000);
     CLIParserFree(ctx);
 
     PrintAndLogEx(SUCCESS, "Watching for EM410x cards - place tag on Proxmark3 antenna");
     clearCommandBuffer();
-    SendCommandNG(CMD_LF_EM410X_WATCH, NULL, 0);
+    SendCommandNG(CMD_LF_EM410X_WATCH, (uint8_t *)&payload, sizeof(payload));
     return lfsim_wait_check(CMD_LF_EM410X_WATCH);
 }
 
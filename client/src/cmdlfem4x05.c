@@ -480,6 +480,69 @@ static int em4x05_login_ext(uint32_t pwd) {
     return em4x05_demod_resp(&word, true);
 }
 
+// Runs one on-device login search job and shows its progress.
+// Returns PM3_ENOTIMPL when the firmware does not answer, so callers can fall back
+static int em4x05_pwd_search(uint8_t mode, uint32_t start_pwd, const uint8_t *pwds, uint32_t count, uint32_t n, uint32_t pos, uint32_t total, em4x05_pwdsearch_resp_t *out) {
+
+    uint8_t d[PM3_CMD_DATA_SIZE] = {0};
+    em4x05_pwdsearch_t *payload = (em4x05_pwdsearch_t *)d;
+    payload->mode = mode;
+    payload->start_pwd = start_pwd;
+    payload->n = n;
+    payload->pos = pos;
+    payload->count = count;
+
+    uint16_t len = sizeof(em4x05_pwdsearch_t);
+    if (mode == EM4X05_PWDSEARCH_DICT) {
+        for (uint32_t i = 0; i < count; i++) {
+            payload->pwds[i] = bytes_to_num(pwds + (4 * i), 4);
+        }
+        len += count * sizeof(uint32_t);
+    }
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_LF_EM4X_PWD_SEARCH, d, len);
+
+    bool first = true;
+    bool aborted = false;
+    PacketResponseNG resp;
+    for (;;) {
+
+        if (aborted == false && kbd_enter_pressed()) {
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            aborted = true;
+        }
+
+        // progress arrives every 64 tests, about 1.2 s
+        if (WaitForResponseTimeout(CMD_LF_EM4X_PWD_SEARCH, &resp, 3000) == false) {
+            if (first) {
+                return PM3_ENOTIMPL;
+            }
+            PrintAndLogEx(NORMAL, "");
+            PrintAndLogEx(WARNING, "(em4x05_pwd_search) timeout while waiting for reply.");
+            return PM3_ETIMEOUT;
+        }
+        first = false;
+
+        if (resp.length < sizeof(em4x05_pwdsearch_resp_t)) {
+            return PM3_ESOFT;
+        }
+
+        memcpy(out, resp.data.asBytes, sizeof(em4x05_pwdsearch_resp_t));
+
+        if (mode == EM4X05_PWDSEARCH_DICT) {
+            PrintAndLogEx(INPLACE, "tested %u / %u", out->pos, total);
+        } else {
+            PrintAndLogEx(INPLACE, "trying %08X", out->pos);
+        }
+
+        if (out->done) {
+            PrintAndLogEx(NORMAL, "");
+            return resp.status;
+        }
+    }
+}
+
 int em4x05_read_word_ext(uint8_t addr, uint32_t pwd, bool use_pwd, uint32_t *word) {
 
     struct {
@@ -1690,13 +1753,15 @@ int CmdEM4x05Chk(const char *Cmd) {
                   "This command uses a dictionary attack against EM4205/4305/4469/4569",
                   "lf em 4x05 chk\n"
                   "lf em 4x05 chk -e 000022B8            -> check password 000022B8\n"
-                  "lf em 4x05 chk -f t55xx_default_pwds  -> use T55xx default dictionary"
+                  "lf em 4x05 chk -f t55xx_default_pwds  -> use T55xx default dictionary\n"
+                  "lf em 4x05 chk --start 120            -> resume dictionary at position 120"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("f", "file", "<fn>", "loads a default keys dictionary file <*.dic>"),
         arg_str0("e", "em", "<EM4100>", "try the calculated password from some cloners based on EM4100 ID"),
+        arg_u64_0(NULL, "start", "<dec>", "resume dictionary at this position"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1716,6 +1781,7 @@ int CmdEM4x05Chk(const char *Cmd) {
         return PM3_EINVARG;
     }
 
+    uint32_t start_pos = arg_get_u32_def(ctx, 3, 0);
     CLIParserFree(ctx);
 
     if (strlen(filename) == 0) {
@@ -1758,7 +1824,35 @@ int CmdEM4x05Chk(const char *Cmd) {
 
         PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
 
-        for (uint32_t c = 0; c < keycount; ++c) {
+        // dictionary chunks are tested on device, candidates are confirmed here
+        bool on_device = true;
+        uint32_t pos = start_pos;
+        while (found == false && pos < keycount) {
+
+            em4x05_pwdsearch_resp_t r = { .pos = pos };
+            uint32_t chunk = MIN(keycount - pos, EM4X05_PWDSEARCH_MAX_DICT);
+            int status = em4x05_pwd_search(EM4X05_PWDSEARCH_DICT, 0, keyBlock + (4 * pos), chunk, 0, pos, keycount, &r);
+            if (status == PM3_ENOTIMPL && pos == start_pos) {
+                on_device = false;
+                break;
+            }
+
+            for (uint8_t i = 0; i < r.found && found == false; i++) {
+                if (em4x05_login_ext(r.candidates[i]) == PM3_SUCCESS) {
+                    PrintAndLogEx(SUCCESS, "found valid password [ " _GREEN_("%08"PRIX32) " ]", r.candidates[i]);
+                    found = true;
+                }
+            }
+
+            if (status != PM3_SUCCESS && found == false) {
+                PrintAndLogEx(INFO, "resume with `" _YELLOW_("lf em 4x05 chk -f %s --start %u") "`", filename, r.pos);
+                free(keyBlock);
+                return status;
+            }
+            pos = r.pos;
+        }
+
+        for (uint32_t c = start_pos; on_device == false && c < keycount; ++c) {
 
             if (!g_session.pm3_present) {
                 PrintAndLogEx(WARNING, "device offline\n");
@@ -1800,7 +1894,8 @@ int CmdEM4x05Brute(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf em 4x05 brute",
                   "This command tries to bruteforce the password of a EM4205/4305/4469/4569\n"
-                  "The loop is running on device side,  press Proxmark3 button to abort\n",
+                  "The loop is running on device side, press Proxmark3 button or <Enter> to abort\n"
+                  "Candidates are confirmed with a full login, abort prints where to resume\n",
                   "Note: if you get many false positives, change position on the antenna"
                   "lf em 4x05 brute\n"
                   "lf em 4x05 brute -n 1            -> stop after first candidate found\n"
@@ -1826,7 +1921,46 @@ int CmdEM4x05Brute(const char *Cmd) {
     CLIParserFree(ctx);
 
     PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to exit");
+
+    // range chunks on device, candidates are confirmed here between chunks
+    uint32_t pwd = start_pwd;
+    uint32_t candidates = 0;
+    while (pwd < 0xFFFFFFFF) {
+
+        em4x05_pwdsearch_resp_t r = { .pos = pwd };
+        uint32_t chunk = MIN(0xFFFFFFFF - pwd, 0x10000);
+        int status = em4x05_pwd_search(EM4X05_PWDSEARCH_RANGE, pwd, NULL, chunk, (n) ? n - candidates : 0, pwd, 0, &r);
+        if (status == PM3_ENOTIMPL && pwd == start_pwd) {
+            break;
+        }
+
+        for (uint8_t i = 0; i < r.found; i++) {
+            if (em4x05_login_ext(r.candidates[i]) == PM3_SUCCESS) {
+                PrintAndLogEx(SUCCESS, "found valid password [ " _GREEN_("%08"PRIX32) " ]", r.candidates[i]);
+            } else {
+                PrintAndLogEx(INFO, "password candidate [ " _YELLOW_("%08"PRIX32) " ]", r.candidates[i]);
+            }
+        }
+        candidates += r.found;
+
+        if (status != PM3_SUCCESS) {
+            PrintAndLogEx(INFO, "resume with `" _YELLOW_("lf em 4x05 brute -s %08X") "`", r.pos);
+            return status;
+        }
+
+        if ((n != 0) && (candidates >= n)) {
+            PrintAndLogEx(SUCCESS, "Bruteforce stopped, %u candidate%s found", candidates, (candidates > 1) ? "s" : "");
+            return PM3_SUCCESS;
+        }
+        pwd = r.pos;
+    }
+
+    if (pwd != start_pwd) {
+        return PM3_SUCCESS;
+    }
 
+    // firmware without CMD_LF_EM4X_PWD_SEARCH
     struct {
         uint32_t start_pwd;
         uint32_t n;
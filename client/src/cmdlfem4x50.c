@@ -134,6 +134,24 @@ static void em4x50_print_info_result(uint8_t *data, bool verbose) {
     PrintAndLogEx(NORMAL, "");
 }
 
+// saves all words, uses UID as filename when none is given
+static void em4x50_save_words(const em4x50_word_t *words, char *filename, int fnlen) {
+
+    // user supplied filename?
+    if (fnlen == 0) {
+        PrintAndLogEx(INFO, "Using UID as filename");
+        char *fptr = filename + snprintf(filename, FILE_PATH_SIZE, "lf-4x50-");
+        FillFileNameByUID(fptr, words[EM4X50_DEVICE_ID].byte, "-dump", 4);
+    }
+
+    uint8_t data[EM4X50_DUMP_FILESIZE] = {0};
+    for (int i = 0; i < EM4X50_NO_WORDS; i++) {
+        memcpy(data + (i * 4), words[i].byte, 4);
+    }
+
+    pm3_save_dump(filename, data, sizeof(data), jsfEM4x50);
+}
+
 static int em4x50_load_file(const char *filename, uint8_t *data, size_t data_len, size_t *bytes_read) {
 
     // read dump file
@@ -492,17 +510,66 @@ static int CmdEM4x50Brute(const char *Cmd) {
 
 // upload passwords from given dictionary to device and start check;
 // if no filename is given dictionary "t55xx_default_pwds.dic" is used
+// runs the firmware dictionary loop on a SPIFFS file, from position <start>
+static int em4x50_chk_spiffs(const char *fn, uint32_t start, uint8_t flags, em4x50_chk_resp_t *out) {
+
+    em4x50_chk_t payload = {
+        .start = start,
+        .flags = flags | EM4X50_CHK_PROGRESS,
+    };
+    strncpy((char *)payload.filename, fn, sizeof(payload.filename) - 1);
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_LF_EM4X50_CHK, (uint8_t *)&payload, sizeof(payload));
+
+    bool aborted = false;
+    PacketResponseNG resp;
+    for (;;) {
+
+        if (aborted == false && kbd_enter_pressed()) {
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            aborted = true;
+        }
+
+        if (WaitForResponseTimeoutW(CMD_LF_EM4X50_CHK, &resp, 1000, false) == false) {
+            continue;
+        }
+
+        memset(out, 0, sizeof(em4x50_chk_resp_t));
+        memcpy(out, resp.data.asBytes, MIN(resp.length, sizeof(em4x50_chk_resp_t)));
+
+        // older firmware only returns the password
+        if (resp.length < sizeof(em4x50_chk_resp_t)) {
+            out->done = true;
+        }
+
+        if (out->done) {
+            return resp.status;
+        }
+
+        PrintAndLogEx(INPLACE, "Testing key %u", out->pos);
+    }
+}
+
 static int CmdEM4x50Chk(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf em 4x50 chk",
-                  "Run dictionary key recovery against EM4x50 card.",
-                  "lf em 4x50 chk             -> uses T55xx default dictionary\n"
-                  "lf em 4x50 chk -f my.dic"
+                  "Run dictionary key recovery against EM4x50 card.\n"
+                  "The dictionary is uploaded to flash memory and tested on device,\n"
+                  "a dictionary already in flash (`mem spiffs upload`) can be used directly.",
+                  "lf em 4x50 chk                        -> uses T55xx default dictionary\n"
+                  "lf em 4x50 chk -f my.dic\n"
+                  "lf em 4x50 chk --spiffs my.bin        -> use dictionary in flash memory\n"
+                  "lf em 4x50 chk -f my.dic --start 1000 -> resume at key 1000\n"
+                  "lf em 4x50 chk --dump                 -> save all words after finding the password"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("f", "file", "<fn>", "specify dictionary filename"),
+        arg_str0(NULL, "spiffs", "<fn>", "dictionary filename in flash memory, binary 4 bytes per key"),
+        arg_u64_0(NULL, "start", "<dec>", "resume at this key position"),
+        arg_lit0(NULL, "dump", "read and save all words after a successful login"),
         arg_param_end
     };
 
@@ -510,6 +577,13 @@ static int CmdEM4x50Chk(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+
+    int slen = 0;
+    char spiffsfn[32] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)spiffsfn, sizeof(spiffsfn) - 1, &slen);
+
+    uint32_t start = arg_get_u32_def(ctx, 3, 0);
+    uint8_t flags = arg_get_lit(ctx, 4) ? EM4X50_CHK_DUMP : 0;
     CLIParserFree(ctx);
 
     if (IfPm3Flash() == false) {
@@ -517,63 +591,85 @@ static int CmdEM4x50Chk(const char *Cmd) {
         return PM3_EFLASH;
     }
 
-    // no filename -> default = t55xx_default_pwds
-    if (strlen(filename) == 0) {
-        snprintf(filename, sizeof(filename), "t55xx_default_pwds");
-        PrintAndLogEx(INFO, "treating file as T55xx keys");
-    }
-
-    // load keys
-    uint8_t *keys = NULL;
-    uint32_t key_count = 0;
-    int res = loadFileDICTIONARY_safe(filename, (void **)&keys, 4, &key_count);
-    if (res != PM3_SUCCESS || key_count == 0) {
-        free(keys);
-        return res;
+    if (fnlen && slen) {
+        PrintAndLogEx(WARNING, "use either a dictionary file or a flash memory file");
+        return PM3_EINVARG;
     }
 
-    uint8_t *pkeys = keys;
-
     uint64_t t1 = msclock();
 
-    PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
+    PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button or " _GREEN_("<Enter>"));
 
-    // block with 2000 bytes -> 500 keys
-    uint8_t destfn[32] = "em4x50_chk.bin";
-    PacketResponseNG resp;
-    int bytes_remaining = key_count * 4;
+    em4x50_chk_resp_t r = { .pos = start };
     int status = PM3_EFAILED;
 
-    while (bytes_remaining > 0) {
+    if (slen) {
+
+        // dictionary already in flash, no upload needed
+        status = em4x50_chk_spiffs(spiffsfn, start, flags, &r);
+
+    } else {
 
-        PrintAndLogEx(INPLACE, "Remaining keys: %i ", bytes_remaining / 4);
+        // no filename -> default = t55xx_default_pwds
+        if (strlen(filename) == 0) {
+            snprintf(filename, sizeof(filename), "t55xx_default_pwds");
+            PrintAndLogEx(INFO, "treating file as T55xx keys");
+        }
 
-        // upload to flash.
-        size_t n = MIN(bytes_remaining, 2000);
-        res = flashmem_spiffs_load((char *)destfn, keys, n);
-        if (res != PM3_SUCCESS) {
-            PrintAndLogEx(WARNING, "SPIFFS upload failed");
+        // load keys
+        uint8_t *keys = NULL;
+        uint32_t key_count = 0;
+        int res = loadFileDICTIONARY_safe(filename, (void **)&keys, 4, &key_count);
+        if (res != PM3_SUCCESS || key_count == 0) {
+            free(keys);
             return res;
         }
 
-        clearCommandBuffer();
-        SendCommandNG(CMD_LF_EM4X50_CHK, destfn, sizeof(destfn));
-        WaitForResponseTimeoutW(CMD_LF_EM4X50_CHK,  &resp, -1, false);
+        // block with 16 kB -> 4096 keys, one upload and calibration each
+        const char *destfn = "em4x50_chk.bin";
+        uint32_t pos = start;
 
-        status = resp.status;
-        if ((status == PM3_SUCCESS) || (status == PM3_EOPABORTED))
-            break;
+        while (pos < key_count) {
+
+            PrintAndLogEx(INPLACE, "Remaining keys: %u ", key_count - pos);
+
+            // upload to flash.
+            uint32_t n = MIN(key_count - pos, 4096);
+            res = flashmem_spiffs_load((char *)destfn, keys + (4 * pos), n * 4);
+            if (res != PM3_SUCCESS) {
+                PrintAndLogEx(WARNING, "SPIFFS upload failed");
+                free(keys);
+                return res;
+            }
+
+            status = em4x50_chk_spiffs(destfn, 0, flags, &r);
+            r.pos += pos;
+            if (status != PM3_EFAILED)
+                break;
 
-        bytes_remaining -= n;
-        keys += n;
+            pos += n;
+        }
+
+        free(keys);
     }
 
-    free(pkeys);
     PrintAndLogEx(NORMAL, "");
 
     if (status == PM3_SUCCESS) {
-        uint32_t pwd = BYTES2UINT32(resp.data.asBytes);
-        PrintAndLogEx(SUCCESS, "found valid password [ " _GREEN_("%08"PRIX32) " ]", pwd);
+        PrintAndLogEx(SUCCESS, "found valid password [ " _GREEN_("%08"PRIX32) " ]", r.pwd);
+
+        if (r.count == EM4X50_NO_WORDS) {
+            em4x50_word_t words[EM4X50_NO_WORDS];
+            em4x50_prepare_result((uint8_t *)r.words, 0, EM4X50_NO_WORDS - 1, words);
+            PrintAndLogEx(INFO, _YELLOW_("EM4x50 data:"));
+            em4x50_print_result(words, 0, EM4X50_NO_WORDS - 1);
+            char dumpfn[FILE_PATH_SIZE] = {0};
+            em4x50_save_words(words, dumpfn, 0);
+        } else if (flags & EM4X50_CHK_DUMP) {
+            PrintAndLogEx(WARNING, "Reading tag ( " _RED_("failed") " ), try `" _YELLOW_("lf em 4x50 dump -p %08"PRIX32) "`", r.pwd);
+        }
+    } else if (status == PM3_EOPABORTED) {
+        PrintAndLogEx(INFO, "resume with `" _YELLOW_("--start %u") "`", r.pos);
     } else {
         PrintAndLogEx(FAILED, "No key found");
     }
@@ -878,19 +974,7 @@ static int CmdEM4x50Dump(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    // user supplied filename?
-    if (fnLen == 0) {
-        PrintAndLogEx(INFO, "Using UID as filename");
-        char *fptr = filename + snprintf(filename, sizeof(filename), "lf-4x50-");
-        FillFileNameByUID(fptr, words[EM4X50_DEVICE_ID].byte, "-dump", 4);
-    }
-
-    uint8_t data[EM4X50_DUMP_FILESIZE] = {0};
-    for (int i = 0; i < EM4X50_NO_WORDS; i++) {
-        memcpy(data + (i * 4), words[i].byte, 4);
-    }
-
-    pm3_save_dump(filename, data, sizeof(data), jsfEM4x50);
+    em4x50_save_words(words, filename, fnLen);
     return PM3_SUCCESS;
 }
 
@@ -26,6 +26,8 @@
 #include "id48.h"
 #include "time.h"
 #include "util_posix.h" // msleep()
+#include "util.h"       // num_CPUs()
+#include <pthread.h>
 
 #define LOCKBIT_0 BITMASK(6)
 #define LOCKBIT_1 BITMASK(7)
@@ -394,25 +396,103 @@ static int setpin_em4x70(const em4x70_cmd_input_setpin_t *opts, em4x70_tag_info_
     return resp.status;
 }
 
+// one job per value of K47..K40, results are merged in that order afterwards
+typedef struct {
+    const em4x70_cmd_input_recover_t *opts;
+    pthread_mutex_t lock;
+    uint16_t next;
+    uint16_t done;
+    size_t found[0x100];
+    ID48LIB_KEY keys[0x100][MAXIMUM_ID48_RECOVERED_KEY_COUNT];
+} em4x70_recover_jobs_t;
+
+static void *recover_em4x70_thread(void *arg) {
+    em4x70_recover_jobs_t *jobs = (em4x70_recover_jobs_t *)arg;
+    const em4x70_cmd_input_recover_t *opts = jobs->opts;
+
+    for (;;) {
+        pthread_mutex_lock(&jobs->lock);
+        uint16_t k47_to_k40 = jobs->next;
+        if (k47_to_k40 < 0x100) {
+            jobs->next++;
+        }
+        pthread_mutex_unlock(&jobs->lock);
+
+        if (k47_to_k40 >= 0x100) {
+            break;
+        }
+
+        size_t n = id48lib_key_recovery_range(&opts->key, &opts->nonce, &opts->frn, &opts->grn,
+                                              k47_to_k40, k47_to_k40,
+                                              jobs->keys[k47_to_k40], MAXIMUM_ID48_RECOVERED_KEY_COUNT);
+
+        pthread_mutex_lock(&jobs->lock);
+        jobs->found[k47_to_k40] = n;
+        jobs->done++;
+        pthread_mutex_unlock(&jobs->lock);
+    }
+    return NULL;
+}
+
 static int recover_em4x70(const em4x70_cmd_input_recover_t *opts, em4x70_cmd_output_recover_t *data_out) {
     memset(data_out, 0, sizeof(em4x70_cmd_output_recover_t));
 
-    // The library is stateful.  First must initialize its internal context.
-    id48lib_key_recovery_init(&opts->key, &opts->nonce, &opts->frn, &opts->grn);
+    em4x70_recover_jobs_t *jobs = calloc(1, sizeof(em4x70_recover_jobs_t));
+    if (jobs == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+    jobs->opts = opts;
+    pthread_mutex_init(&jobs->lock, NULL);
+
+    // The partial keys K47..K40 are independent searches, spread them over all CPUs
+    int thread_cnt = num_CPUs();
+    pthread_t threads[thread_cnt];
+    int started = 0;
+    for (; started < thread_cnt; started++) {
+        if (pthread_create(&threads[started], NULL, recover_em4x70_thread, (void *)jobs)) {
+            break;
+        }
+    }
 
-    // repeatedly call id48lib_key_recovery_next() to get the next potential key
-    ID48LIB_KEY q;
-    int result = PM3_SUCCESS;
+    if (started == 0) {
+        recover_em4x70_thread(jobs);
+    }
+
+    bool shown = false;
+    for (;;) {
+        pthread_mutex_lock(&jobs->lock);
+        uint16_t done = jobs->done;
+        pthread_mutex_unlock(&jobs->lock);
+        if (done == 0x100) {
+            break;
+        }
+        PrintAndLogEx(INPLACE, "Recovering... %3u%%  ( %u threads )", (done * 100) / 0x100, started);
+        shown = true;
+        msleep(200);
+    }
+    if (shown) {
+        PrintAndLogEx(NORMAL, "");
+    }
 
-    while ((PM3_SUCCESS == result) && id48lib_key_recovery_next(&q)) {
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_mutex_destroy(&jobs->lock);
 
-        if (data_out->potential_key_count >= MAXIMUM_ID48_RECOVERED_KEY_COUNT) {
-            result = PM3_EOVFLOW;
-        } else {
-            data_out->potential_keys[data_out->potential_key_count] = q;
+    // merge in K47..K40 order, the same order a single sequential search yields
+    int result = PM3_SUCCESS;
+    for (uint16_t k = 0; (PM3_SUCCESS == result) && k < 0x100; k++) {
+        for (size_t i = 0; i < jobs->found[k]; i++) {
+            if ((data_out->potential_key_count >= MAXIMUM_ID48_RECOVERED_KEY_COUNT) || (i >= MAXIMUM_ID48_RECOVERED_KEY_COUNT)) {
+                result = PM3_EOVFLOW;
+                break;
+            }
+            data_out->potential_keys[data_out->potential_key_count] = jobs->keys[k][i];
             ++data_out->potential_key_count;
         }
     }
+    free(jobs);
 
     if ((PM3_SUCCESS == result) && (data_out->potential_key_count == 0)) {
         result = PM3_EFAILED;
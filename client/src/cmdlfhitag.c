@@ -32,6 +32,7 @@
 #include "pm3_cmd.h"    // return codes
 #include "hitag2/hitag2_crypto.h"
 #include "util_posix.h"             // msclock
+#include "ht2crack5.h"               // ht2crack5_find_key
 
 static int CmdHelp(const char *Cmd);
 
@@ -1157,6 +1158,7 @@ static int CmdLFHitagWriter(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf hitag wrbl",
                   "Write a page in Hitag memory. It support HitagS and Hitag 2\n"
+                  "HitagS takes several pages of data, written from the given page on in one session\n"
                   "  Password mode:\n"
                   "    - default key 4D494B52 (MIKR)\n\n"
                   "  Crypto mode: \n"
@@ -1166,7 +1168,8 @@ static int CmdLFHitagWriter(const char *Cmd) {
                   "  lf hitag wrbl --hts -p 6 -d 01020304                         -> HitagS, plain mode\n"
                   "  lf hitag wrbl --hts -p 6 -d 01020304 --nrar 0102030411223344 -> HitagS, challenge mode\n"
                   "  lf hitag wrbl --hts -p 6 -d 01020304 --crypto                -> HitagS, crypto mode, def key\n"
-                  "  lf hitag wrbl --hts -p 6 -d 01020304 -k 4F4E4D494B52         -> HitagS, crypto mode\n\n"
+                  "  lf hitag wrbl --hts -p 6 -d 01020304 -k 4F4E4D494B52         -> HitagS, crypto mode\n"
+                  "  lf hitag wrbl --hts -p 4 -d 0102030411121314 --crypto        -> HitagS, crypto mode, pages 4 and 5\n\n"
                   "  lf hitag wrbl --ht2 -p 6 -d 01020304 --pwd                   -> Hitag 2, pwd mode, def key\n"
                   "  lf hitag wrbl --ht2 -p 6 -d 01020304 -k 4D494B52             -> Hitag 2, pwd mode\n"
                   "  lf hitag wrbl --ht2 -p 6 -d 01020304 --nrar 0102030411223344 -> Hitag 2, challenge mode\n"
@@ -1183,7 +1186,7 @@ static int CmdLFHitagWriter(const char *Cmd) {
         arg_lit0(NULL, "crypto", "crypto mode"),
         arg_str0("k", "key", "<hex>", "key, 4 or 6 hex bytes"),
         arg_int1("p", "page", "<dec>", "page address to write to"),
-        arg_str1("d", "data", "<hex>", "data, 4 hex bytes"),
+        arg_str1("d", "data", "<hex>", "data, 4 hex bytes per page"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -1215,7 +1218,7 @@ static int CmdLFHitagWriter(const char *Cmd) {
 
     int page = arg_get_int_def(ctx, 7, 0);
 
-    uint8_t data[4];
+    uint8_t data[HITAG_MAX_BYTE_SIZE];
     int dlen = 0;
     res = CLIParamHexToBuf(arg_get_str(ctx, 8), data, sizeof(data), &dlen);
     if (res != 0) {
@@ -1240,8 +1243,8 @@ static int CmdLFHitagWriter(const char *Cmd) {
         return PM3_EINVARG;
     }
 
-    if (dlen != sizeof(data)) {
-        PrintAndLogEx(WARNING, "Wrong DATA len expected 4, got %d", dlen);
+    if (dlen == 0 || (dlen % HITAG_BLOCK_SIZE) != 0 || (use_hts == false && dlen != HITAG_BLOCK_SIZE)) {
+        PrintAndLogEx(WARNING, "Wrong DATA len expected %s, got %d", (use_hts) ? "multiple of 4" : "4", dlen);
         return PM3_EINVARG;
     }
 
@@ -1290,35 +1293,37 @@ static int CmdLFHitagWriter(const char *Cmd) {
         return PM3_EINVARG;
     }
 
+    // HitagS, the pages after the first one follow the packet
+    uint8_t buf[sizeof(lf_hitag_data_t) + HITAG_MAX_BYTE_SIZE] = {0};
     lf_hitag_data_t packet;
     memset(&packet, 0, sizeof(packet));
 
     if (use_hts && use_nrar) {
         packet.cmd = WHTSF_CHALLENGE;
+        packet.page = page;
         memcpy(packet.NrAr, nrar, sizeof(packet.NrAr));
-        memcpy(packet.data, data, sizeof(data));
-        // iceman:  No page in Hitag S ?
+        memcpy(packet.data, data, sizeof(packet.data));
         PrintAndLogEx(INFO, "Authenticating to " _YELLOW_("Hitag S") " in Challenge mode");
 
     } else if (use_hts && use_crypto) {
         packet.cmd = WHTSF_KEY;
+        packet.page = page;
         memcpy(packet.key, key, sizeof(packet.key));
-        memcpy(packet.data, data, sizeof(data));
-        // iceman:  No page in Hitag S ?
+        memcpy(packet.data, data, sizeof(packet.data));
         PrintAndLogEx(INFO, "Authenticating to " _YELLOW_("Hitag S") " in Crypto mode");
 
     } else if (use_ht2 && use_pwd) {
         packet.cmd = WHT2F_PASSWORD;
         packet.page = page;
         memcpy(packet.pwd, key, sizeof(packet.pwd));
-        memcpy(packet.data, data, sizeof(data));
+        memcpy(packet.data, data, sizeof(packet.data));
         PrintAndLogEx(INFO, "Authenticating to " _YELLOW_("Hitag 2") " in Password mode");
 
     } else if (use_ht2 && use_crypto) {
         packet.cmd = WHT2F_CRYPTO;
         packet.page = page;
         memcpy(packet.key, key, sizeof(packet.key));
-        memcpy(packet.data, data, sizeof(data));
+        memcpy(packet.data, data, sizeof(packet.data));
         PrintAndLogEx(INFO, "Authenticating to " _YELLOW_("Hitag 2") " in Crypto mode");
 
     } else {
@@ -1348,9 +1353,13 @@ static int CmdLFHitagWriter(const char *Cmd) {
 
     } else {
 
-        SendCommandNG(CMD_LF_HITAGS_WRITE, (uint8_t *)&packet, sizeof(packet));
+        memcpy(buf, &packet, sizeof(packet));
+        memcpy(buf + sizeof(packet), data + HITAG_BLOCK_SIZE, dlen - HITAG_BLOCK_SIZE);
+
+        SendCommandNG(CMD_LF_HITAGS_WRITE, buf, sizeof(packet) + dlen - HITAG_BLOCK_SIZE);
         PacketResponseNG resp;
-        if (WaitForResponseTimeout(CMD_LF_HITAGS_WRITE, &resp, 4000) == false) {
+        // about 50 ms per page,  on top of select and authentication
+        if (WaitForResponseTimeout(CMD_LF_HITAGS_WRITE, &resp, 4000 + (dlen / HITAG_BLOCK_SIZE) * 50) == false) {
             PrintAndLogEx(WARNING, "timeout while waiting for reply.");
             return PM3_ETIMEOUT;
         }
@@ -1587,13 +1596,31 @@ static int CmdLFHitag2Dump(const char *Cmd) {
         return PM3_ENOTIMPL;
     }
 
+    // pages are shown as the device reads them, the full memory follows at the end
+    packet.flags = HITAG_READER_STREAM_PAGES;
+
     clearCommandBuffer();
     SendCommandNG(CMD_LF_HITAG_READER, (uint8_t *) &packet, sizeof(packet));
 
-    if (WaitForResponseTimeout(CMD_LF_HITAG_READER, &resp, 5000) == false) {
-        PrintAndLogEx(WARNING, "timeout while waiting for reply.");
-        return PM3_ETIMEOUT;
+    uint64_t t1 = msclock();
+    for (;;) {
+        if (WaitForResponseTimeout(CMD_UNKNOWN, &resp, 5000) == false || (msclock() - t1) > 5000) {
+            PrintAndLogEx(WARNING, "timeout while waiting for reply.");
+            return PM3_ETIMEOUT;
+        }
+
+        if (resp.cmd == CMD_LF_HITAG_READER_PAGE) {
+            const lf_hitag_page_t *page = (const lf_hitag_page_t *)resp.data.asBytes;
+            PrintAndLogEx(INFO, "page %u | %s", page->page, sprint_hex_inrow(page->data, sizeof(page->data)));
+            t1 = msclock();
+            continue;
+        }
+
+        if (resp.cmd == CMD_LF_HITAG_READER) {
+            break;
+        }
     }
+
     if (resp.status != PM3_SUCCESS) {
         PrintAndLogEx(DEBUG, "DEBUG: Error - hitag failed");
         return resp.status;
@@ -1793,12 +1820,88 @@ static int CmdLFHitagEview(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// print and save nR aR pairs collected by sniff / sim, one `0xNR 0xAR` line each as ht2crack4 wants it
+static int hitag2_save_nrar(const PacketResponseNG *resp, const char *filename) {
+
+    if (resp->length < sizeof(lf_hitag2_nrar_t)) {
+        // older firmware doesn't send the pairs
+        return PM3_SUCCESS;
+    }
+
+    const lf_hitag2_nrar_t *d = (const lf_hitag2_nrar_t *)resp->data.asBytes;
+    if (d->count == 0) {
+        PrintAndLogEx(INFO, "No authentication attempts collected");
+        return PM3_SUCCESS;
+    }
+
+    uint32_t uid = bytes_to_num(d->uid, 4);
+    if (uid) {
+        PrintAndLogEx(SUCCESS, "UID... " _GREEN_("%08X"), uid);
+    }
+
+    PrintAndLogEx(SUCCESS, "Collected " _YELLOW_("%u") " unique nR aR pairs", d->total);
+    if (d->total > d->count) {
+        PrintAndLogEx(WARNING, "only the first " _YELLOW_("%u") " pairs are exported", d->count);
+    }
+
+    char *buf = calloc(d->count, 24);
+    if (buf == NULL) {
+        PrintAndLogEx(WARNING, "Failed to allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    size_t len = 0;
+    for (uint16_t i = 0; i < d->count; i++) {
+        uint32_t nr = bytes_to_num(d->nrar[i], 4);
+        uint32_t ar = bytes_to_num(d->nrar[i] + 4, 4);
+        PrintAndLogEx(INFO, "%3u | %08X | %08X", i, nr, ar);
+        len += snprintf(buf + len, 24, "0x%08x 0x%08x\n", nr, ar);
+    }
+
+    char fn[FILE_PATH_SIZE] = {0};
+    if (filename && strlen(filename)) {
+        strncpy(fn, filename, sizeof(fn) - 1);
+    } else if (uid) {
+        snprintf(fn, sizeof(fn), "lf-hitag-%08X-nrar", uid);
+    } else {
+        snprintf(fn, sizeof(fn), "lf-hitag-nrar");
+    }
+
+    int res = saveFile(fn, ".txt", buf, len);
+    free(buf);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    if (uid == 0) {
+        PrintAndLogEx(HINT, "UID not seen, get it with `" _YELLOW_("lf hitag info") "` before running ht2crack4 / ht2crack5");
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(HINT, "Try `" _YELLOW_("ht2crack4 -u %08X -n <file> -N %u") "`", uid, MIN(d->count, 32));
+    if (d->count > 1) {
+        // ht2crack5 only needs two pairs
+        PrintAndLogEx(HINT, "Try `" _YELLOW_("ht2crack5 %08X %08X %08X %08X %08X") "`"
+                      , uid
+                      , (uint32_t)bytes_to_num(d->nrar[0], 4)
+                      , (uint32_t)bytes_to_num(d->nrar[0] + 4, 4)
+                      , (uint32_t)bytes_to_num(d->nrar[1], 4)
+                      , (uint32_t)bytes_to_num(d->nrar[1] + 4, 4)
+                     );
+    }
+    return PM3_SUCCESS;
+}
+
 static int CmdLFHitagSim(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf hitag sim",
                   "Simulate Hitag transponder\n"
-                  "You need to `lf hitag eload` first",
-                  "lf hitag sim -2"
+                  "You need to `lf hitag eload` first\n"
+                  "With `--nrar` the client waits until the simulation stops and saves\n"
+                  "the nR aR pairs readers sent, ready for ht2crack4 / ht2crack5",
+                  "lf hitag sim -2\n"
+                  "lf hitag sim -2 --nrar            -> collect nR aR pairs\n"
+                  "lf hitag sim -2 --nrar -f pairs   -> collect into pairs.txt"
                  );
 
     void *argtable[] = {
@@ -1806,6 +1909,8 @@ static int CmdLFHitagSim(const char *Cmd) {
         arg_lit0("1", "ht1", "simulate Hitag 1"),
         arg_lit0("2", "ht2", "simulate Hitag 2"),
         arg_lit0("s", "hts", "simulate Hitag S"),
+        arg_lit0(NULL, "nrar", "collect reader nR aR pairs (Hitag 2)"),
+        arg_str0("f", "file", "<fn>", "save nR aR pairs to this file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1814,6 +1919,11 @@ static int CmdLFHitagSim(const char *Cmd) {
     bool use_ht2 = arg_get_lit(ctx, 2);
     bool use_hts = arg_get_lit(ctx, 3);
     bool use_htm = false; // not implemented yet
+    bool collect = arg_get_lit(ctx, 4);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
     if ((use_ht1 + use_ht2 + use_hts + use_htm) > 1) {
@@ -1832,24 +1942,45 @@ static int CmdLFHitagSim(const char *Cmd) {
     if (use_hts)
         cmd = CMD_LF_HITAGS_SIMULATE;
 
+    if ((collect || fnlen) && use_ht2 == false) {
+        PrintAndLogEx(ERR, "error, nR aR collection is only available for Hitag 2");
+        return PM3_EINVARG;
+    }
+
     clearCommandBuffer();
     SendCommandMIX(cmd, 0, 0, 0, NULL, 0);
-    return PM3_SUCCESS;
+
+    if (collect == false && fnlen == 0) {
+        return PM3_SUCCESS;
+    }
+
+    PrintAndLogEx(INFO, "Press " _GREEN_("pm3 button") " to stop the simulation and fetch the pairs");
+
+    PacketResponseNG resp;
+    WaitForResponse(CMD_LF_HITAG_SIMULATE, &resp);
+    return hitag2_save_nrar(&resp, filename);
 }
 
 static int CmdLFHitagSniff(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf hitag sniff",
                   "Sniff the communication between reader and tag.\n"
-                  "Use `lf hitag list` to view collected data.",
-                  " lf hitag sniff"
+                  "Use `lf hitag list` to view collected data.\n"
+                  "Unique Hitag 2 nR aR pairs are saved for ht2crack4 / ht2crack5.",
+                  " lf hitag sniff\n"
+                  " lf hitag sniff -f pairs    -> save nR aR pairs to pairs.txt"
                  );
 
     void *argtable[] = {
         arg_param_begin,
+        arg_str0("f", "file", "<fn>", "save nR aR pairs to this file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
     CLIParserFree(ctx);
 
     PrintAndLogEx(INFO, "Press " _GREEN_("pm3 button") " to abort sniffing");
@@ -1859,6 +1990,7 @@ static int CmdLFHitagSniff(const char *Cmd) {
     SendCommandNG(CMD_LF_HITAG_SNIFF, NULL, 0);
     WaitForResponse(CMD_LF_HITAG_SNIFF, &resp);
     PrintAndLogEx(INFO, "Done!");
+    hitag2_save_nrar(&resp, filename);
     PrintAndLogEx(HINT, "Try `" _YELLOW_("lf hitag list")"` to view captured tracelog");
     PrintAndLogEx(HINT, "Try `" _YELLOW_("trace save -h") "` to save tracelog for later analysing");
     return PM3_SUCCESS;
@@ -2229,6 +2361,119 @@ static int CmdLFHitag2Lookup(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static bool ht2crack5_progress(void *ctx, uint64_t done, uint64_t total) {
+    uint64_t t1 = *(uint64_t *)ctx;
+    uint64_t elapsed = msclock() - t1;
+
+    if (kbd_enter_pressed()) {
+        PrintAndLogEx(NORMAL, "");
+        return false;
+    }
+
+    // estimate the remaining time from the candidates processed so far
+    if (done && total) {
+        uint64_t eta = (elapsed * (total - done) / done) / 1000;
+        PrintAndLogEx(INPLACE, "Searching... %5.1f%%  elapsed %" PRIu64 "s  eta %" PRIu64 "s   "
+                      , (float)done * 100 / total
+                      , elapsed / 1000
+                      , eta
+                     );
+    } else {
+        PrintAndLogEx(INPLACE, "Searching... elapsed %" PRIu64 "s   ", elapsed / 1000);
+    }
+    return true;
+}
+
+static int CmdLFHitag2Crack5(const char *Cmd) {
+
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "lf hitag crack5",
+                  "Recover a Hitag2 crypto key from two sniffed authentications.\n"
+                  "A bitsliced state search on the first nR/aR pair, candidate keys are verified with the second pair.\n"
+                  "Runs on all logical CPUs, press <Enter> to abort",
+                  "lf hitag crack5 --uid 11223344 --nrar1 73AA5A62EAB8529C --nrar2 998C9A10F6A1D570"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_str1("u", "uid", "<hex>", "specify UID as 4 hex bytes"),
+        arg_str1(NULL, "nrar1", "<hex>", "specify first nonce / answer as 8 hex bytes"),
+        arg_str1(NULL, "nrar2", "<hex>", "specify second nonce / answer as 8 hex bytes"),
+        arg_int0("t", "threads", "<dec>", "number of threads (def: all logical CPUs)"),
+        arg_param_end
+    };
+
+    CLIExecWithReturn(ctx, Cmd, argtable, false);
+
+    int ulen = 0;
+    uint8_t uidarr[4] = {0};
+    CLIGetHexWithReturn(ctx, 1, uidarr, &ulen);
+
+    int n1len = 0;
+    uint8_t nrar1[8] = {0};
+    CLIGetHexWithReturn(ctx, 2, nrar1, &n1len);
+
+    int n2len = 0;
+    uint8_t nrar2[8] = {0};
+    CLIGetHexWithReturn(ctx, 3, nrar2, &n2len);
+
+    int threads = arg_get_int_def(ctx, 4, 0);
+    CLIParserFree(ctx);
+
+    if (threads < 0) {
+        PrintAndLogEx(INFO, "Threads must be positive, got %i", threads);
+        return PM3_EINVARG;
+    }
+
+    if (ulen != 4) {
+        PrintAndLogEx(INFO, "UID wrong length. expected 4, got %i", ulen);
+        return PM3_EINVARG;
+    }
+
+    if (n1len != 8 || n2len != 8) {
+        PrintAndLogEx(INFO, "NrAr wrong length. expected 8, got %i", (n1len != 8) ? n1len : n2len);
+        return PM3_EINVARG;
+    }
+
+    // same conventions as lf hitag lookup,  uid / nr LSB,  ar BE
+    rev_msb_array(uidarr, sizeof(uidarr));
+    rev_msb_array(nrar1, 4);
+    rev_msb_array(nrar2, 4);
+
+    uint32_t uid = MemLeToUint4byte(uidarr);
+    uint32_t nr1 = MemLeToUint4byte(nrar1);
+    uint32_t ar1 = MemBeToUint4byte(nrar1 + 4);
+    uint32_t nr2 = MemLeToUint4byte(nrar2);
+    uint32_t ar2 = MemBeToUint4byte(nrar2 + 4);
+
+    PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " to abort");
+
+    uint64_t t1 = msclock();
+    uint64_t key = 0;
+    int res = ht2crack5_find_key(uid, nr1, ar1, nr2, ar2, threads, ht2crack5_progress, &t1, &key);
+    t1 = msclock() - t1;
+    PrintAndLogEx(NORMAL, "");
+
+    switch (res) {
+        case HT2CRACK5_FOUND: {
+            uint8_t keyarr[HITAG_CRYPTOKEY_SIZE] = {0};
+            Uint6byteToMemLe(keyarr, REV64(key));
+            PrintAndLogEx(SUCCESS, "Found valid key [ " _GREEN_("%s") " ]", sprint_hex_inrow(keyarr, sizeof(keyarr)));
+            PrintAndLogEx(SUCCESS, "time in crack5 " _YELLOW_("%.1f") " seconds", (float)t1 / 1000.0);
+            return PM3_SUCCESS;
+        }
+        case HT2CRACK5_ABORTED:
+            PrintAndLogEx(WARNING, "\naborted via keyboard!");
+            return PM3_EOPABORTED;
+        case HT2CRACK5_EMALLOC:
+            PrintAndLogEx(WARNING, "Failed to allocate memory");
+            return PM3_EMALLOC;
+        default:
+            PrintAndLogEx(WARNING, "Key not found");
+            return PM3_ESOFT;
+    }
+}
+
 static int CmdLFHitag2Crack2(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf hitag crack2",
@@ -2483,6 +2728,7 @@ static command_t CommandTable[] = {
     {"-----------", CmdHelp,                    IfPm3Hitag,      "----------------------- " _CYAN_("Recovery") " -----------------------"},
     {"cc",          CmdLFHitagSCheckChallenges, IfPm3Hitag,      "Hitag S: test all provided challenges"},
     {"crack2",      CmdLFHitag2Crack2,          IfPm3Hitag,      "Recover 2048bits of crypto stream"},
+    {"crack5",      CmdLFHitag2Crack5,          AlwaysAvailable, "Recover key from two sniffed authentications"},
     {"chk",         CmdLFHitag2Chk,             IfPm3Hitag,      "Check keys"},
     {"lookup",      CmdLFHitag2Lookup,          AlwaysAvailable, "Uses authentication trace to check for key in dictionary file"},
     {"ta",          CmdLFHitag2CheckChallenges, IfPm3Hitag,      "Hitag 2: test all recorded authentications"},
@@ -579,6 +579,9 @@ static int CmdIndalaDemodAlt(const char *Cmd) {
     // Remodulating for tag cloning
     // HACK: 2015-01-04 this will have an impact on our new way of seening lf commands (demod)
     // since this changes graphbuffer data.
+    if (GraphReserve(32 * uidlen) == false) {
+        return PM3_EMALLOC;
+    }
     g_GraphTraceLen = 32 * uidlen;
     i = 0;
     int phase;
@@ -1270,36 +1273,28 @@ int detectIndala(uint8_t *dest, size_t *size, uint8_t *invert) {
     psk1TOpsk2(dest, *size);
     PrintAndLogEx(DEBUG, "DEBUG: detectindala Converting PSK1 -> PSK2");
 
-    idx = 0;
-    found_size = *size;
-    res = preambleSearch(dest, preamble64, sizeof(preamble64), &found_size, &idx);
-    if (res) {
-        PrintAndLogEx(DEBUG, "DEBUG: detectindala PSK2 found 64 preamble");
-        goto out;
-    }
-
-    idx = 0;
-    found_size = *size;
-    res = preambleSearch(dest, preamble224, sizeof(preamble224), &found_size, &idx);
-    if (res) {
-        PrintAndLogEx(DEBUG, "DEBUG: detectindala PSK2 found 224 preamble");
-        goto out;
-    }
-
-    idx = 0;
-    found_size = *size;
-    res = preambleSearch(dest, preamble64_i, sizeof(preamble64_i), &found_size, &idx);
-    if (res) {
-        PrintAndLogEx(DEBUG, "DEBUG: detectindala PSK2 found 64 inverted preamble");
-        goto inv;
-    }
+    // all four in one pass,  first one found in this order wins
+    preamble_match_t psk2[] = {
+        { preamble64, sizeof(preamble64), false, 0, 0 },
+        { preamble224, sizeof(preamble224), false, 0, 0 },
+        { preamble64_i, sizeof(preamble64_i), false, 0, 0 },
+        { preamble224_i, sizeof(preamble224_i), false, 0, 0 },
+    };
+    const char *psk2_names[] = { "64 preamble", "224 preamble", "64 inverted preamble", "224 inverted preamble" };
 
-    idx = 0;
-    found_size = *size;
-    res = preambleSearch(dest, preamble224_i, sizeof(preamble224_i), &found_size, &idx);
-    if (res) {
-        PrintAndLogEx(DEBUG, "DEBUG: detectindala PSK2 found 224 inverted preamble");
-        goto inv;
+    if (preambleSearchMulti(dest, *size, psk2, ARRAYLEN(psk2))) {
+        for (size_t k = 0; k < ARRAYLEN(psk2); k++) {
+            if (psk2[k].found == false) {
+                continue;
+            }
+            PrintAndLogEx(DEBUG, "DEBUG: detectindala PSK2 found %s", psk2_names[k]);
+            idx = psk2[k].start;
+            found_size = psk2[k].size;
+            if (k < 2) {
+                goto out;
+            }
+            goto inv;
+        }
     }
 
     return -4;
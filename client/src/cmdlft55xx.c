@@ -431,10 +431,36 @@ int clone_t55xx_tag(uint32_t *blockdata, uint8_t numblocks) {
 
     PacketResponseNG resp;
 
+    // write and read back the whole set on device, one round trip
+    t55xx_write_batch_t batch = {
+        .pwd = 0,
+        .config = blockdata[0],
+        .startblock = 0,
+        .numblocks = numblocks,
+        .flags = 0,
+    };
+    memcpy(batch.data, blockdata, numblocks * sizeof(uint32_t));
+
+    uint8_t verified = 0;
+    bool batched = false;
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_LF_T55XX_WRITE_BATCH, (uint8_t *)&batch, sizeof(batch));
+    if (WaitForResponseTimeout(CMD_LF_T55XX_WRITE_BATCH, &resp, T55XX_WRITE_TIMEOUT * 3)) {
+        if (resp.status == PM3_SUCCESS && resp.length == sizeof(verified)) {
+            verified = resp.data.asBytes[0];
+            batched = true;
+        } else if (resp.status == PM3_EOPABORTED) {
+            PrintAndLogEx(WARNING, "aborted via button or keyboard");
+            return PM3_EOPABORTED;
+        }
+    }
+
     // fast push mode
     g_conn.block_after_ACK = true;
 
-    for (int8_t i = 0; i < numblocks; i++) {
+    // firmware without the batch command
+    for (int8_t i = 0; i < numblocks && batched == false; i++) {
 
         // Disable fast mode on last packet
         if (i == numblocks - 1) {
@@ -455,12 +481,21 @@ int clone_t55xx_tag(uint32_t *blockdata, uint8_t numblocks) {
             return PM3_ETIMEOUT;
         }
     }
+    g_conn.block_after_ACK = false;
 
+    // blocks the device could not verify get the usual read and demod here
     uint8_t res = 0;
     for (int8_t i = 0; i < numblocks; i++) {
 
         if (i == 0) {
             SetConfigWithBlock0(blockdata[0]);
+        }
+
+        if (verified & (1 << i)) {
+            continue;
+        }
+
+        if (i == 0) {
             if (t55xxAcquireAndCompareBlock0(false, 0, blockdata[0], false))
                 continue;
         }
@@ -1146,6 +1181,202 @@ static int CmdT55xxWakeUp(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Detection cache, the last configurations `lf t55xx detect` found are tried first.
+// Only the configuration block pattern is kept, passwords are never written to disk.
+#define T55XX_DETECT_CACHE_FILE     "t55xx_detect.bin"
+#define T55XX_DETECT_CACHE_MAGIC    0x35355854 // "TX55"
+#define T55XX_DETECT_CACHE_VERSION  1
+#define T55XX_DETECT_CACHE_ITEMS    8
+
+typedef struct {
+    uint8_t modulation;
+    uint8_t bitrate;
+    uint8_t inverted;
+    uint8_t Q5;
+    uint8_t ST;
+    uint8_t downlink_mode;
+    uint32_t block0;
+} PACKED t55xx_detect_item_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    t55xx_detect_item_t items[T55XX_DETECT_CACHE_ITEMS];
+} PACKED t55xx_detect_cache_t;
+
+static t55xx_detect_cache_t detect_cache;
+static bool detect_cache_loaded = false;
+
+static void t55xx_detect_cache_load(void) {
+
+    if (detect_cache_loaded)
+        return;
+
+    detect_cache_loaded = true;
+    memset(&detect_cache, 0, sizeof(detect_cache));
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, T55XX_DETECT_CACHE_FILE, false) != PM3_SUCCESS)
+        return;
+
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL)
+        return;
+
+    t55xx_detect_cache_t tmp;
+    bool ok = (fread(&tmp, sizeof(tmp), 1, f) == 1)
+              && tmp.magic == T55XX_DETECT_CACHE_MAGIC
+              && tmp.version == T55XX_DETECT_CACHE_VERSION
+              && tmp.count <= T55XX_DETECT_CACHE_ITEMS;
+    fclose(f);
+
+    if (ok) {
+        memcpy(&detect_cache, &tmp, sizeof(detect_cache));
+    }
+}
+
+static void t55xx_detect_cache_save(void) {
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, NULL, true) != PM3_SUCCESS)
+        return;
+    free(path);
+    path = NULL;
+
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, T55XX_DETECT_CACHE_FILE, true) != PM3_SUCCESS)
+        return;
+
+    // write next to it and rename, parallel runs never see a partial file
+    char tmppath[strlen(path) + 16];
+    snprintf(tmppath, sizeof(tmppath), "%s.%u", path, (unsigned int)(msclock() & 0xFFFFFF));
+
+    FILE *f = fopen(tmppath, "wb");
+    if (f == NULL) {
+        free(path);
+        return;
+    }
+
+    bool ok = (fwrite(&detect_cache, sizeof(detect_cache), 1, f) == 1);
+    ok &= (fclose(f) == 0);
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (ok == false || rename(tmppath, path) != 0) {
+        remove(tmppath);
+    }
+    free(path);
+}
+
+// move the current configuration to the front of the cache
+static void t55xx_detect_cache_push(void) {
+
+    t55xx_detect_item_t item = {
+        .modulation = config.modulation,
+        .bitrate = config.bitrate,
+        .inverted = config.inverted,
+        .Q5 = config.Q5,
+        .ST = config.ST,
+        .downlink_mode = config.downlink_mode,
+        .block0 = config.block0,
+    };
+
+    t55xx_detect_cache_load();
+
+    uint16_t i = 0;
+    for (; i < detect_cache.count; i++) {
+        if (memcmp(&detect_cache.items[i], &item, sizeof(item)) == 0)
+            break;
+    }
+
+    // already the most recent one
+    if (i == 0 && detect_cache.count) {
+        return;
+    }
+
+    if (i == detect_cache.count) {
+        if (detect_cache.count < T55XX_DETECT_CACHE_ITEMS)
+            detect_cache.count++;
+        i = detect_cache.count - 1;
+    }
+
+    memmove(&detect_cache.items[1], &detect_cache.items[0], i * sizeof(item));
+    detect_cache.items[0] = item;
+    detect_cache.magic = T55XX_DETECT_CACHE_MAGIC;
+    detect_cache.version = T55XX_DETECT_CACHE_VERSION;
+    t55xx_detect_cache_save();
+}
+
+// demodulate the samples with a cached configuration and look for its configuration block
+static bool t55xx_detect_cache_match(const t55xx_detect_item_t *item) {
+
+    if (item->block0 == 0)
+        return false;
+
+    t55xx_conf_block_t saved = config;
+    config.modulation = item->modulation;
+    config.bitrate = item->bitrate;
+    config.inverted = item->inverted;
+    config.Q5 = item->Q5;
+    config.ST = item->ST;
+
+    // same offset window as test(), so the result matches a full detect
+    if (DecodeT55xxBlock() && g_DemodBufferLen >= 64) {
+        size_t last = MIN(g_DemodBufferLen - 32, 63);
+        for (size_t idx = 28; idx <= last; idx++) {
+            if (PackBits(idx, 32, g_DemodBuffer) == item->block0) {
+                config.offset = idx;
+                config.block0 = item->block0;
+                config.downlink_mode = item->downlink_mode;
+                return true;
+            }
+        }
+    }
+
+    config = saved;
+    return false;
+}
+
+// one acquisition per downlink mode found in the cache, most recent first.
+// dl_filter limits it to one downlink mode, -1 tries them all
+static bool t55xx_detect_cached(bool usepwd, uint64_t password, int dl_filter) {
+
+    t55xx_detect_cache_load();
+
+    bool tried[4] = {false};
+    for (uint16_t i = 0; i < detect_cache.count; i++) {
+
+        uint8_t dl = detect_cache.items[i].downlink_mode & 3;
+        if (tried[dl] || (dl_filter >= 0 && dl != dl_filter))
+            continue;
+
+        tried[dl] = true;
+
+        if (AcquireData(T55x7_PAGE0, T55x7_CONFIGURATION_BLOCK, usepwd, password, dl) == false)
+            continue;
+
+        for (uint16_t j = i; j < detect_cache.count; j++) {
+
+            if ((detect_cache.items[j].downlink_mode & 3) != dl)
+                continue;
+
+            if (t55xx_detect_cache_match(&detect_cache.items[j])) {
+                if (usepwd) {
+                    config.usepwd = true;
+                    config.pwd = password & 0xffffffff;
+                }
+                config.block0Status = AUTODETECT;
+                PrintAndLogEx(DEBUG, "detect cache hit, entry %u", j);
+                printConfiguration(config);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 static int CmdT55xxDetect(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "lf t55xx detect",
@@ -1220,7 +1451,12 @@ static int CmdT55xxDetect(const char *Cmd) {
     if (SanityOfflineCheck(use_gb) != PM3_SUCCESS)
         return PM3_ESOFT;
 
+    // a tag configured like one seen before needs a single read
     if (use_gb == false) {
+        found = t55xx_detect_cached(usepwd, password, try_all_dl_modes ? -1 : downlink_mode);
+    }
+
+    if (use_gb == false && found == false) {
 
         char wakecmd[20] = { 0x00 };
         snprintf(wakecmd, sizeof(wakecmd), "-p %08" PRIx64, password);
@@ -1281,7 +1517,11 @@ static int CmdT55xxDetect(const char *Cmd) {
             // Toggle so we loop back and try with wakeup.
             usewake = !usewake;
         } while (found == false && usewake);
-    } else {
+
+        if (found) {
+            t55xx_detect_cache_push();
+        }
+    } else if (use_gb) {
         found = t55xxTryDetectModulation(downlink_mode, T55XX_PrintConfig);
     }
 
@@ -3529,6 +3769,99 @@ out:
     return PM3_SUCCESS;
 }
 
+#define T55XX_BRUTE_CHUNK 256
+
+// Range scan on device, the firmware screens each password against the signal baseline
+// and only stops to report a candidate, which gets verified here with a full read and demod.
+// Returns PM3_ENOTIMPL if the firmware doesn't know the range mode.
+static int t55xx_bruteforce_device(uint32_t start, uint32_t end, uint8_t downlink_mode, bool try_all_dl_modes, uint32_t *last, uint8_t *found) {
+
+    uint64_t baseline[4] = {0};
+    uint64_t threshold[4] = {0};
+    uint8_t dl_last = try_all_dl_modes ? 3 : (downlink_mode & 3);
+
+    *found = 0;
+    *last = start;
+
+    uint32_t chunk_start = start;
+    for (;;) {
+
+        uint32_t chunk_end = ((end - chunk_start) >= T55XX_BRUTE_CHUNK) ? chunk_start + (T55XX_BRUTE_CHUNK - 1) : end;
+
+        for (uint8_t dl_mode = (downlink_mode & 3); dl_mode <= dl_last; dl_mode++) {
+
+            t55xx_bruteforce_t payload = {
+                .flags = dl_mode << 3,
+                .start = chunk_start,
+                .end = chunk_end,
+                .baseline = baseline[dl_mode],
+                .threshold = threshold[dl_mode],
+            };
+
+            while (true) {
+
+                if (IsCancelled()) {
+                    return PM3_EOPABORTED;
+                }
+
+                clearCommandBuffer();
+                SendCommandNG(CMD_LF_T55XX_CHK_PWDS, (uint8_t *)&payload, sizeof(payload));
+                PacketResponseNG resp;
+
+                uint8_t timeout = 0;
+                while (WaitForResponseTimeout(CMD_LF_T55XX_CHK_PWDS, &resp, 2000) == false) {
+                    timeout++;
+                    if (timeout > 30) {
+                        PrintAndLogEx(WARNING, "\nno response from Proxmark3. Aborting...");
+                        return PM3_ETIMEOUT;
+                    }
+                }
+
+                if (resp.length != sizeof(t55xx_bruteforce_resp_t)) {
+                    return PM3_ENOTIMPL;
+                }
+
+                const t55xx_bruteforce_resp_t *r = (t55xx_bruteforce_resp_t *)resp.data.asBytes;
+                baseline[dl_mode] = r->baseline;
+                threshold[dl_mode] = r->threshold;
+                *last = r->candidate;
+
+                if (resp.status != PM3_SUCCESS) {
+                    return resp.status;
+                }
+
+                if (r->found == false) {
+                    break;
+                }
+
+                PrintAndLogEx(NORMAL, "");
+                PrintAndLogEx(INFO, "candidate [ " _YELLOW_("%08X") " ]", r->candidate);
+                if (t55xx_try_one_password(r->candidate, dl_mode, false)) {
+                    *found = 1 + (dl_mode << 1);
+                    return PM3_SUCCESS;
+                }
+
+                // false positive, carry on after it
+                if (r->candidate == chunk_end) {
+                    break;
+                }
+                payload.start = r->candidate + 1;
+                payload.baseline = baseline[dl_mode];
+                payload.threshold = threshold[dl_mode];
+            }
+        }
+
+        PrintAndLogEx(NORMAL, "." NOLF);
+        fflush(stdout);
+
+        if (chunk_end == end) {
+            break;
+        }
+        chunk_start = chunk_end + 1;
+    }
+    return PM3_SUCCESS;
+}
+
 // Bruteforce - incremental password range search
 static int CmdT55xxBruteForce(const char *Cmd) {
     CLIParserContext *ctx;
@@ -3601,6 +3934,24 @@ static int CmdT55xxBruteForce(const char *Cmd) {
     PrintAndLogEx(INFO, "Search password range [%08X -> %08X]", start_password, end_password);
 
     uint64_t t1 = msclock();
+
+    res = t55xx_bruteforce_device(start_password, end_password, downlink_mode, ra, &curr, &found);
+    if (res != PM3_ENOTIMPL) {
+
+        PrintAndLogEx(NORMAL, "");
+        if (found) {
+            PrintAndLogEx(SUCCESS, "Found valid password: [ " _GREEN_("%08X") " ]", curr);
+            T55xx_Print_DownlinkMode((found >> 1) & 3);
+        } else if (res == PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "Bruteforce failed, last tried: [ " _YELLOW_("%08X") " ]", curr);
+        }
+
+        t1 = msclock() - t1;
+        PrintAndLogEx(SUCCESS, "\ntime in bruteforce " _YELLOW_("%.0f") " seconds\n", (float)t1 / 1000.0);
+        return res;
+    }
+
+    // firmware without the range mode, drive every attempt from here
     curr = start_password;
 
     while (found == 0) {
@@ -48,6 +48,7 @@
 #include "commonutil.h"   // ARRAYLEN
 #include "preferences.h"
 #include "cliparser.h"
+#include "throughput.h"   // per card phase timing
 
 static int CmdHelp(const char *Cmd);
 
@@ -362,7 +363,10 @@ static int CmdHelp(const char *Cmd) {
 // then presses Enter, which the full command line that they typed.
 //-----------------------------------------------------------------------------
 int CommandReceived(const char *Cmd) {
-    return CmdsParse(CommandTable, Cmd);
+    tp_token_t t = throughput_cmd_begin(Cmd);
+    int res = CmdsParse(CommandTable, Cmd);
+    throughput_cmd_end(&t, res);
+    return res;
 }
 
 command_t *getTopLevelCommandTable(void) {
@@ -503,18 +503,13 @@ static void PrintTLVFromBuffer(const uint8_t *buf, size_t len) {
     if (buf == NULL || len == 0) {
         return;
     }
-    struct tlvdb_root *root = calloc(1, sizeof(*root) + len);
-    if (root == NULL) {
-        return;
-    }
-    root->len = len;
-    memcpy(root->buf, buf, len);
-    if (tlvdb_parse_root_multi(root) == true) {
-        PrintTLV(&(root->db));
+    struct tlvdb *t = tlvdb_parse_multi(buf, len);
+    if (t) {
+        PrintTLV(t);
+        tlvdb_free(t);
     } else {
         PrintAndLogEx(WARNING, "TLV ERROR: Can't parse buffer as TLV tree.");
     }
-    tlvdb_root_free(root);
 }
 
 static int PivGetData(Iso7816CommandChannel channel, const uint8_t tag[], size_t tag_len, bool verbose, struct tlvdb_root **result, uint16_t *sw) {
@@ -242,6 +242,83 @@ static int CmdScriptList(const char *Cmd) {
 #endif
 }
 
+static bool gs_lua_keep_state = false;
+static lua_State *gs_lua_state = NULL;
+
+static lua_State *lua_new_pm3_state(void) {
+    // create new Lua state
+    lua_State *lua_state = luaL_newstate();
+
+    // load Lua libraries
+    luaL_openlibs(lua_state);
+
+    //Sets the pm3 core libraries, that go a bit 'under the hood'
+    set_pm3_libraries(lua_state);
+
+    //Add the 'bin' library
+    set_bin_library(lua_state);
+
+    //Add the 'bit' library
+    set_bit_library(lua_state);
+#ifdef HAVE_LUA_SWIG
+    luaL_requiref(lua_state, "pm3", luaopen_pm3, 1);
+#endif
+    return lua_state;
+}
+
+static void lua_drop_shared_state(void) {
+    if (gs_lua_state) {
+        lua_close(gs_lua_state);
+        gs_lua_state = NULL;
+    }
+}
+
+static int CmdScriptCache(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "script cache",
+                  "Lua scripts and the libraries they require are compiled once per session and rerun from cache\n"
+                  "until the file changes. With --keep, top level Lua scripts share one Lua state so lualibs\n"
+                  "modules stay loaded between runs. Each script still gets its own globals.",
+                  "script cache           -> show cache settings\n"
+                  "script cache --keep    -> keep one Lua state between script runs\n"
+                  "script cache --fresh   -> new Lua state for every script run (default)\n"
+                  "script cache --clear   -> drop compiled chunks and the shared Lua state"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "keep", "keep one Lua state between script runs"),
+        arg_lit0(NULL, "fresh", "new Lua state for every script run"),
+        arg_lit0(NULL, "clear", "drop compiled chunks and the shared Lua state"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool keep = arg_get_lit(ctx, 1);
+    bool fresh = arg_get_lit(ctx, 2);
+    bool clear = arg_get_lit(ctx, 3);
+    CLIParserFree(ctx);
+
+    if (keep && fresh) {
+        PrintAndLogEx(FAILED, "Select only one of --keep / --fresh");
+        return PM3_EINVARG;
+    }
+
+    if (keep) {
+        gs_lua_keep_state = true;
+    }
+    if (fresh) {
+        gs_lua_keep_state = false;
+        lua_drop_shared_state();
+    }
+    if (clear) {
+        lua_chunk_cache_clear();
+        lua_drop_shared_state();
+        PrintAndLogEx(SUCCESS, "Lua cache cleared");
+    }
+    PrintAndLogEx(INFO, "Lua state... %s", gs_lua_keep_state ? _GREEN_("kept between runs") : "fresh per run");
+    return PM3_SUCCESS;
+}
+
 /**
  * @brief CmdScriptRun - executes a script file.
  * @param argc
@@ -316,31 +393,37 @@ static int CmdScriptRun(const char *Cmd) {
         PrintAndLogEx(SUCCESS, "executing lua " _YELLOW_("%s"), script_path);
         PrintAndLogEx(SUCCESS, "args " _YELLOW_("'%s'"), arguments);
 
+        // nested scripts always get a fresh state
+        bool shared = (gs_lua_keep_state && (luascriptfile_idx == 0));
         luascriptfile_idx++;
 
-        // create new Lua state
         lua_State *lua_state;
-        lua_state = luaL_newstate();
-
-        // load Lua libraries
-        luaL_openlibs(lua_state);
-
-        //Sets the pm3 core libraries, that go a bit 'under the hood'
-        set_pm3_libraries(lua_state);
-
-        //Add the 'bin' library
-        set_bin_library(lua_state);
+        if (shared && gs_lua_state) {
+            lua_state = gs_lua_state;
+        } else {
+            lua_state = lua_new_pm3_state();
+            if (shared) {
+                gs_lua_state = lua_state;
+            }
+        }
 
-        //Add the 'bit' library
-        set_bit_library(lua_state);
-#ifdef HAVE_LUA_SWIG
-        luaL_requiref(lua_state, "pm3", luaopen_pm3, 1);
-#endif
-        error = luaL_loadfile(lua_state, script_path);
+        error = lua_loadfile_cached(lua_state, script_path);
         free(script_path);
         if (!error) {
-            lua_pushstring(lua_state, arguments);
-            lua_setglobal(lua_state, "args");
+            if (shared) {
+                // globals of the script go to its own environment, required modules stay loaded
+                lua_newtable(lua_state);
+                lua_newtable(lua_state);
+                lua_pushglobaltable(lua_state);
+                lua_setfield(lua_state, -2, "__index");
+                lua_setmetatable(lua_state, -2);
+                lua_pushstring(lua_state, arguments);
+                lua_setfield(lua_state, -2, "args");
+                lua_setupvalue(lua_state, -2, 1);
+            } else {
+                lua_pushstring(lua_state, arguments);
+                lua_setglobal(lua_state, "args");
+            }
 
             //Call it with 0 arguments
             error = lua_pcall(lua_state, 0, LUA_MULTRET, 0); // once again, returns non-0 on error,
@@ -358,7 +441,11 @@ static int CmdScriptRun(const char *Cmd) {
 
         //luaL_dofile(lua_state, buf);
         // close the Lua state
-        lua_close(lua_state);
+        if (shared) {
+            lua_settop(lua_state, 0);
+        } else {
+            lua_close(lua_state);
+        }
         luascriptfile_idx--;
         PrintAndLogEx(SUCCESS, "\nfinished " _YELLOW_("%s"), filename);
         return PM3_SUCCESS;
@@ -509,6 +596,7 @@ static command_t CommandTable[] = {
     {"help",  CmdHelp,          AlwaysAvailable, "This help"},
     {"list",  CmdScriptList,    AlwaysAvailable, "List available scripts"},
     {"run",   CmdScriptRun,     AlwaysAvailable, "<name> - execute a script"},
+    {"cache", CmdScriptCache,   AlwaysAvailable, "Lua script cache settings"},
     {NULL, NULL, NULL, NULL}
 };
 
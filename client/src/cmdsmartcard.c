@@ -476,7 +476,7 @@ static int CmdSmartRaw(const char *Cmd) {
 
     if (dlen > 0) {
         if (use_t0)
-            payload->flags |= SC_RAW_T0;
+            payload->flags |= (SC_RAW_T0 | SC_CHAINING);
         else
             payload->flags |= SC_RAW;
     }
@@ -1469,6 +1469,10 @@ int ExchangeAPDUSC(bool verbose, uint8_t *datain, int datainlen, bool activateCa
 
     smart_card_raw_t *payload = calloc(1, sizeof(smart_card_raw_t) + datainlen);
     payload->flags = (SC_RAW_T0 | SC_LOG);
+    // device side chaining may answer with a full usb frame
+    if (maxdataoutlen >= PM3_CMD_DATA_SIZE) {
+        payload->flags |= SC_CHAINING;
+    }
     if (activateCard) {
         payload->flags |= (SC_SELECT | SC_CONNECT);
     }
@@ -18,6 +18,9 @@
 #include "cmdtrace.h"
 
 #include <ctype.h>
+#include <pthread.h>
+#include <signal.h>
+#include <lz4.h>
 
 #include "cmdparser.h"    // command_t
 #include "protocols.h"
@@ -30,23 +33,263 @@
 #include "cmdlfhitag.h"         // annotate hitag
 #include "pm3_cmd.h"            // tracelog_hdr_t
 #include "cliparser.h"          // args..
+#include "util.h"               // kbd_enter_pressed, num_CPUs
 
 static int CmdHelp(const char *Cmd);
 
 // trace pointer
 static uint8_t *gs_trace;
-static uint16_t gs_traceLen = 0;
+static uint32_t gs_traceLen = 0;
+
+// Record index over gs_trace, built on first use after a load / download.
+// Only the record headers are walked, so a time window or command byte
+// filter in `trace list` skips records without decoding them.
+#define TRACE_IDX_RESPONSE   0x01
+
+typedef struct {
+    uint32_t offset;
+    uint64_t ts;        // timestamp unwrapped to 64 bit, never decreasing
+    uint8_t flags;
+    uint8_t cmd;        // first frame byte, 0 for empty frames
+} trace_idx_t;
+
+static trace_idx_t *gs_trace_idx = NULL;
+static uint32_t gs_trace_idx_count = 0;
+
+// Reader frame annotations of the protocols whose annotators keep no state,
+// computed up front over all CPUs, one slot per index record.
+#define TRACE_ANNOT_LEN          60      // printTraceLine explanation[]
+#define TRACE_ANNOT_MIN_RECORDS  1024
+
+static char (*gs_trace_annot)[TRACE_ANNOT_LEN] = NULL;
+static uint8_t gs_trace_annot_protocol = 0;
+
+static void trace_annot_free(void) {
+    free(gs_trace_annot);
+    gs_trace_annot = NULL;
+    gs_trace_annot_protocol = 0;
+}
+
+static void trace_index_free(void) {
+    trace_annot_free();
+    free(gs_trace_idx);
+    gs_trace_idx = NULL;
+    gs_trace_idx_count = 0;
+}
+
+static int trace_index_build(void) {
+
+    if (gs_trace_idx) {
+        return PM3_SUCCESS;
+    }
+
+    // worst case, every record header only
+    uint32_t max = (gs_traceLen / TRACELOG_HDR_LEN) + 1;
+    gs_trace_idx = calloc(max, sizeof(trace_idx_t));
+    if (gs_trace_idx == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace index");
+        return PM3_EMALLOC;
+    }
+
+    uint64_t epoch = 0;
+    uint64_t last = 0;
+    uint32_t prev_raw = 0;
+    uint32_t pos = 0;
+    uint32_t n = 0;
+
+    while ((pos + TRACELOG_HDR_LEN) <= gs_traceLen && n < max) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(gs_trace + pos);
+        uint32_t next = pos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (next > gs_traceLen) {
+            break;
+        }
+
+        // 32 bit timestamps wrap after a few minutes on long sniffs
+        if (n && hdr->timestamp < prev_raw && (prev_raw - hdr->timestamp) > 0x80000000) {
+            epoch += 0x100000000ULL;
+        }
+        prev_raw = hdr->timestamp;
+
+        uint64_t ts = epoch + hdr->timestamp;
+        if (ts < last) {
+            ts = last;
+        }
+        last = ts;
+
+        trace_idx_t *e = &gs_trace_idx[n++];
+        e->offset = pos;
+        e->ts = ts;
+        e->flags = (hdr->isResponse) ? TRACE_IDX_RESPONSE : 0;
+        e->cmd = (hdr->data_len) ? hdr->frame[0] : 0;
+        pos = next;
+    }
+
+    gs_trace_idx_count = n;
+    return PM3_SUCCESS;
+}
+
+// first record with offset >= pos
+static uint32_t trace_index_find_offset(uint32_t pos) {
+    uint32_t lo = 0, hi = gs_trace_idx_count;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (gs_trace_idx[mid].offset < pos) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Reader frame annotators without any state between frames, safe to run
+// out of order and from several threads. Returns false for other protocols,
+// keep in sync with the protocol list in trace_annot_build().
+static bool annotate_reader_stateless(uint8_t protocol, char *exp, size_t size, uint8_t *frame, uint16_t data_len) {
+    switch (protocol) {
+        case LEGIC:
+            annotateLegic(exp, size, frame, data_len);
+            return true;
+        case ISO_14443B:
+            annotateIso14443b(exp, size, frame, data_len);
+            return true;
+        case ISO_15693:
+            annotateIso15693(exp, size, frame, data_len);
+            return true;
+        case FELICA:
+            annotateFelica(exp, size, frame, data_len);
+            return true;
+        case LTO:
+            annotateLTO(exp, size, frame, data_len);
+            return true;
+        case PROTO_CRYPTORF:
+            annotateCryptoRF(exp, size, frame, data_len);
+            return true;
+        default:
+            return false;
+    }
+}
+
+typedef struct {
+    uint8_t protocol;
+    uint32_t thread_idx;
+    uint32_t thread_cnt;
+} trace_annot_arg_t;
+
+static void *trace_annot_thread(void *arg) {
+    const trace_annot_arg_t *a = (const trace_annot_arg_t *)arg;
+    for (uint32_t i = a->thread_idx; i < gs_trace_idx_count; i += a->thread_cnt) {
+        const trace_idx_t *e = &gs_trace_idx[i];
+        if (e->flags & TRACE_IDX_RESPONSE) {
+            continue;
+        }
+        tracelog_hdr_t *hdr = (tracelog_hdr_t *)(gs_trace + e->offset);
+        if (hdr->data_len == 0) {
+            continue;
+        }
+        annotate_reader_stateless(a->protocol, gs_trace_annot[i], TRACE_ANNOT_LEN, hdr->frame, hdr->data_len);
+    }
+    return NULL;
+}
+
+// Annotate all reader frames of a large trace ahead of the listing.
+// The listing itself stays sequential and picks the strings up in order.
+static void trace_annot_build(uint8_t protocol) {
+
+    if (gs_trace_annot && gs_trace_annot_protocol == protocol) {
+        return;
+    }
+    trace_annot_free();
+
+    switch (protocol) {
+        case LEGIC:
+        case ISO_14443B:
+        case ISO_15693:
+        case FELICA:
+        case LTO:
+        case PROTO_CRYPTORF:
+            break;
+        default:
+            return;
+    }
+
+    if (trace_index_build() != PM3_SUCCESS || gs_trace_idx_count < TRACE_ANNOT_MIN_RECORDS) {
+        return;
+    }
+
+    gs_trace_annot = calloc(gs_trace_idx_count, TRACE_ANNOT_LEN);
+    if (gs_trace_annot == NULL) {
+        // not fatal, lines are annotated one by one instead
+        PrintAndLogEx(DEBUG, "Cannot allocate memory for trace annotations");
+        return;
+    }
+    gs_trace_annot_protocol = protocol;
+
+    int cpus = num_CPUs();
+    uint32_t thread_cnt = (cpus > 0) ? cpus : 1;
+    pthread_t threads[thread_cnt];
+    trace_annot_arg_t args[thread_cnt];
+    for (uint32_t i = 0; i < thread_cnt; i++) {
+        args[i].protocol = protocol;
+        args[i].thread_idx = i;
+        args[i].thread_cnt = thread_cnt;
+    }
+
+    uint32_t started = 0;
+    for (; started < thread_cnt; started++) {
+        if (pthread_create(&threads[started], NULL, trace_annot_thread, (void *)&args[started])) {
+            break;
+        }
+    }
+
+    // whatever share a thread could not be started for, is done here
+    for (uint32_t i = started; i < thread_cnt; i++) {
+        trace_annot_thread(&args[i]);
+    }
 
-static bool is_last_record(uint16_t tracepos, uint16_t traceLen) {
+    for (uint32_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    PrintAndLogEx(DEBUG, "annotated %u records on %u threads", gs_trace_idx_count, thread_cnt);
+}
+
+// precomputed annotation of the record at tracepos, NULL if there is none
+static const char *trace_annot_lookup(uint32_t tracepos, uint8_t protocol) {
+    if (gs_trace_annot == NULL || gs_trace_annot_protocol != protocol) {
+        return NULL;
+    }
+    uint32_t i = trace_index_find_offset(tracepos);
+    if (i >= gs_trace_idx_count || gs_trace_idx[i].offset != tracepos) {
+        return NULL;
+    }
+    return gs_trace_annot[i];
+}
+
+// first record with ts >= value
+static uint32_t trace_index_lower_bound(uint64_t value) {
+    uint32_t lo = 0, hi = gs_trace_idx_count;
+    while (lo < hi) {
+        uint32_t mid = lo + ((hi - lo) / 2);
+        if (gs_trace_idx[mid].ts < value) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static bool is_last_record(uint32_t tracepos, uint32_t traceLen) {
     return ((tracepos + TRACELOG_HDR_LEN) >= traceLen);
 }
 
-static bool next_record_is_response(uint16_t tracepos, uint8_t *trace) {
+static bool next_record_is_response(uint32_t tracepos, uint8_t *trace) {
     const tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
     return (hdr->isResponse);
 }
 
-static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint16_t *tracepos, uint16_t traceLen,
+static bool merge_topaz_reader_frames(uint32_t timestamp, uint32_t *duration, uint32_t *tracepos, uint32_t traceLen,
                                       uint8_t *trace, const uint8_t *frame, uint8_t *topaz_reader_command, uint16_t *data_len) {
 
 #define MAX_TOPAZ_READER_CMD_LEN 16
@@ -93,12 +336,13 @@ static uint8_t calc_pos(const uint8_t *d) {
 
 // Copy an existing buffer into client trace buffer
 // I think this is cleaner than further globalizing gs_trace, and may lend itself to more modularity later?
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len) {
     if (trace_len == 0 || trace_src == NULL) return (false);
     if (gs_trace) {
         free(gs_trace);
         gs_traceLen = 0;
     }
+    trace_index_free();
     gs_trace = calloc(trace_len, sizeof(uint8_t));
     if (gs_trace == NULL) {
         return (false);
@@ -108,13 +352,329 @@ bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len) {
     return (true);
 }
 
+// PCAP-NG export of trace records, written record by record so neither a saved trace
+// nor a live stream has to be converted as a whole. A fifo works as well, e.g.
+// `mkfifo /tmp/pm3 && wireshark -k -i /tmp/pm3`.
+// ISO14443 based protocols use LINKTYPE_ISO_14443 with the pseudo header from
+// https://www.kaiser.cx/pcap-iso14443.html, anything else gets the raw frame as LINKTYPE_USER0.
+#define PCAPNG_BT_SHB          0x0A0D0D0A
+#define PCAPNG_BT_IDB          0x00000001
+#define PCAPNG_BT_EPB          0x00000006
+#define PCAPNG_BYTE_ORDER      0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT    0
+#define PCAPNG_OPT_TSRESOL     9
+#define PCAPNG_OPT_EPB_FLAGS   2
+#define PCAPNG_EPB_INBOUND     0x01
+#define PCAPNG_EPB_OUTBOUND    0x02
+#define LINKTYPE_USER0         147
+#define LINKTYPE_ISO_14443     264
+
+#define PCAPNG_RECORD_MAX      (TRACELOG_HDR_LEN + 0x7FFF + (0x7FFF / 8) + 1)
+
+typedef struct {
+    FILE *f;
+    uint16_t linktype;
+    uint64_t epoch;
+    uint32_t prev_ts;
+    uint32_t records;
+    // a stream chunk may end in the middle of a record
+    uint8_t partial[PCAPNG_RECORD_MAX];
+    uint32_t partial_len;
+} trace_pcapng_t;
+
+// `-t` protocol names of `trace list` / `trace save`, empty and "raw" mean no protocol
+static bool trace_protocol_from_str(const char *type, uint8_t *protocol) {
+    if (strcmp(type, "14a") == 0)      *protocol = ISO_14443A;
+    else if (strcmp(type, "14b") == 0)      *protocol = ISO_14443B;
+    else if (strcmp(type, "15") == 0)       *protocol = ISO_15693;
+    else if (strcmp(type, "7816") == 0)     *protocol = ISO_7816_4;
+    else if (strcmp(type, "cryptorf") == 0) *protocol = PROTO_CRYPTORF;
+    else if (strcmp(type, "des") == 0)      *protocol = MFDES;
+    else if (strcmp(type, "felica") == 0)   *protocol = FELICA;
+    else if (strcmp(type, "hitag1") == 0)   *protocol = PROTO_HITAG1;
+    else if (strcmp(type, "hitag2") == 0)   *protocol = PROTO_HITAG2;
+    else if (strcmp(type, "hitags") == 0)   *protocol = PROTO_HITAGS;
+    else if (strcmp(type, "iclass") == 0)   *protocol = ICLASS;
+    else if (strcmp(type, "legic") == 0)    *protocol = LEGIC;
+    else if (strcmp(type, "lto") == 0)      *protocol = LTO;
+    else if (strcmp(type, "mf") == 0)       *protocol = PROTO_MIFARE;
+    else if (strcmp(type, "raw") == 0)      *protocol = -1;
+    else if (strcmp(type, "seos") == 0)     *protocol = SEOS;
+    else if (strcmp(type, "thinfilm") == 0) *protocol = THINFILM;
+    else if (strcmp(type, "topaz") == 0)    *protocol = TOPAZ;
+    else if (strcmp(type, "mfp") == 0)      *protocol = PROTO_MFPLUS;
+    else if (strcmp(type, "") == 0)         *protocol = -1;
+    else return false;
+    return true;
+}
+
+static uint16_t pcapng_linktype(uint8_t protocol) {
+    switch (protocol) {
+        case ISO_14443A:
+        case ISO_14443B:
+        case TOPAZ:
+        case ISO_7816_4:
+        case MFDES:
+        case PROTO_MIFARE:
+        case PROTO_MFPLUS:
+        case SEOS:
+        case LTO:
+            return LINKTYPE_ISO_14443;
+        default:
+            return LINKTYPE_USER0;
+    }
+}
+
+static bool pcapng_write_u32(FILE *f, uint32_t v) {
+    return fwrite(&v, sizeof(v), 1, f) == 1;
+}
+
+static trace_pcapng_t *trace_pcapng_open(const char *fn, uint8_t protocol) {
+
+    trace_pcapng_t *w = calloc(1, sizeof(trace_pcapng_t));
+    if (w == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for pcapng writer");
+        return NULL;
+    }
+
+    w->f = fopen(fn, "wb");
+    if (w->f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+        free(w);
+        return NULL;
+    }
+    w->linktype = pcapng_linktype(protocol);
+
+    // section header, host byte order as announced by the byte order magic
+    uint32_t shb[] = { PCAPNG_BT_SHB, 28, PCAPNG_BYTE_ORDER, 0x00000001, 0xFFFFFFFF, 0xFFFFFFFF, 28 };
+    // interface description,  if_tsresol 9 -> nanoseconds
+    uint32_t idb[] = { PCAPNG_BT_IDB, 32, w->linktype, 0x0000FFFF,
+                       PCAPNG_OPT_TSRESOL | (1 << 16), 9, PCAPNG_OPT_ENDOFOPT, 32
+                     };
+    if (fwrite(shb, sizeof(shb), 1, w->f) != 1 || fwrite(idb, sizeof(idb), 1, w->f) != 1) {
+        PrintAndLogEx(WARNING, "failed writing to `" _YELLOW_("%s") "`", fn);
+        fclose(w->f);
+        free(w);
+        return NULL;
+    }
+    fflush(w->f);
+    return w;
+}
+
+static int trace_pcapng_record(trace_pcapng_t *w, const tracelog_hdr_t *hdr) {
+
+    // 32 bit carrier cycle timestamps, unwrapped like the record index does
+    if (w->records && hdr->timestamp < w->prev_ts && (w->prev_ts - hdr->timestamp) > 0x80000000) {
+        w->epoch += 0x100000000ULL;
+    }
+    w->prev_ts = hdr->timestamp;
+    w->records++;
+
+    // 13.56 MHz carrier cycles to ns
+    uint64_t ts = ((w->epoch + hdr->timestamp) * 100000ULL) / 1356ULL;
+
+    uint8_t pseudo[4] = { 0x00, (hdr->isResponse) ? 0xFF : 0xFE, hdr->data_len >> 8, hdr->data_len & 0xFF };
+    uint32_t pseudo_len = (w->linktype == LINKTYPE_ISO_14443) ? sizeof(pseudo) : 0;
+    uint32_t caplen = pseudo_len + hdr->data_len;
+    uint32_t padded = (caplen + 3) & ~3U;
+    // block header + 5 fields + data + epb_flags option + end of options + trailing length
+    uint32_t total = 12 + 16 + padded + 8 + 4 + 4;
+
+    bool ok = pcapng_write_u32(w->f, PCAPNG_BT_EPB)
+              && pcapng_write_u32(w->f, total)
+              && pcapng_write_u32(w->f, 0)
+              && pcapng_write_u32(w->f, (uint32_t)(ts >> 32))
+              && pcapng_write_u32(w->f, (uint32_t)ts)
+              && pcapng_write_u32(w->f, caplen)
+              && pcapng_write_u32(w->f, caplen);
+
+    if (ok && pseudo_len) {
+        ok = fwrite(pseudo, pseudo_len, 1, w->f) == 1;
+    }
+    if (ok && hdr->data_len) {
+        ok = fwrite(hdr->frame, hdr->data_len, 1, w->f) == 1;
+    }
+    if (ok && padded != caplen) {
+        uint8_t zero[3] = {0};
+        ok = fwrite(zero, padded - caplen, 1, w->f) == 1;
+    }
+
+    ok = ok
+         && pcapng_write_u32(w->f, PCAPNG_OPT_EPB_FLAGS | (4 << 16))
+         && pcapng_write_u32(w->f, (hdr->isResponse) ? PCAPNG_EPB_INBOUND : PCAPNG_EPB_OUTBOUND)
+         && pcapng_write_u32(w->f, PCAPNG_OPT_ENDOFOPT)
+         && pcapng_write_u32(w->f, total);
+
+    return (ok) ? PM3_SUCCESS : PM3_EFILE;
+}
+
+// feed raw tracelog bytes, complete records are written, a trailing partial one is kept
+static int trace_pcapng_feed(trace_pcapng_t *w, const uint8_t *data, uint32_t len) {
+
+    while (len) {
+        uint32_t need = TRACELOG_HDR_LEN;
+        if (w->partial_len >= TRACELOG_HDR_LEN) {
+            const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)w->partial;
+            need = TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        }
+
+        uint32_t n = MIN(need - w->partial_len, len);
+        memcpy(w->partial + w->partial_len, data, n);
+        w->partial_len += n;
+        data += n;
+        len -= n;
+
+        if (w->partial_len < need || need == TRACELOG_HDR_LEN) {
+            continue;
+        }
+
+        int res = trace_pcapng_record(w, (const tracelog_hdr_t *)w->partial);
+        w->partial_len = 0;
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+
+    fflush(w->f);
+    return PM3_SUCCESS;
+}
+
+static void trace_pcapng_close(trace_pcapng_t *w) {
+    if (w == NULL) {
+        return;
+    }
+    if (w->partial_len) {
+        PrintAndLogEx(WARNING, "pcapng, incomplete last record dropped");
+    }
+    fclose(w->f);
+    free(w);
+}
+
+// Runs a sniff command with trace streaming armed and writes the streamed trace
+// log to a .trace file as it arrives, so the capture is not limited by BigBuf.
+// With pcapng_fn the records also go out live as PCAP-NG, to a file or fifo.
+// Enter or the pm3 button stops the sniff.
+int TraceStreamSniff(uint16_t cmd, uint8_t *data, uint16_t datalen, const char *preferredName, const char *pcapng_fn, uint8_t protocol) {
+
+    char *fn = newfilenamemcopyEx(preferredName, ".trace", spTrace);
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", fn);
+        free(fn);
+        return PM3_EFILE;
+    }
+
+    trace_pcapng_t *pcap = NULL;
+    if (pcapng_fn && strlen(pcapng_fn)) {
+        // opening a fifo blocks until the other end, e.g. wireshark, is reading
+        PrintAndLogEx(INFO, "PCAP-NG to `" _YELLOW_("%s") "`", pcapng_fn);
+        pcap = trace_pcapng_open(pcapng_fn, protocol);
+        if (pcap == NULL) {
+            fclose(f);
+            free(fn);
+            return PM3_EFILE;
+        }
+    }
+
+#ifndef _WIN32
+    // a closed fifo must end the pcapng output, not the client
+    void (*old_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+#endif
+
+    clearCommandBuffer();
+    uint8_t enable = 1;
+    SendCommandNG(CMD_TRACE_STREAM, &enable, sizeof(enable));
+    SendCommandNG(cmd, data, datalen);
+
+    PrintAndLogEx(INFO, "Streaming trace to `" _YELLOW_("%s") "`", fn);
+    PrintAndLogEx(INFO, "Press " _GREEN_("<Enter>") " or " _GREEN_("pm3 button") " to stop sniffing");
+
+    trace_stream_stats_t stats = {0};
+    size_t total = 0;
+    bool stopped = false;
+    int res = PM3_SUCCESS;
+
+    PacketResponseNG resp;
+    while (true) {
+
+        if (IsCommunicationThreadDead()) {
+            res = PM3_EIO;
+            break;
+        }
+
+        if (stopped == false && kbd_enter_pressed()) {
+            // any command ends the stream,  the device then flushes what it has
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            stopped = true;
+        }
+
+        if (WaitForResponseTimeout(CMD_UNKNOWN, &resp, 500) == false) {
+            continue;
+        }
+
+        if (resp.cmd == cmd) {
+            break;
+        }
+
+        if (resp.cmd != CMD_TRACE_STREAM) {
+            continue;
+        }
+
+        if (resp.status == PM3_ENODATA) {
+            memcpy(&stats, resp.data.asBytes, MIN(resp.length, sizeof(stats)));
+            continue;
+        }
+
+        if (fwrite(resp.data.asBytes, 1, resp.length, f) != resp.length) {
+            PrintAndLogEx(WARNING, "failed writing to `" _YELLOW_("%s") "`", fn);
+            res = PM3_EFILE;
+        }
+        if (pcap && trace_pcapng_feed(pcap, resp.data.asBytes, resp.length) != PM3_SUCCESS) {
+            // reader went away, keep streaming to the trace file
+            PrintAndLogEx(WARNING, "failed writing to `" _YELLOW_("%s") "`, PCAP-NG output stopped", pcapng_fn);
+            trace_pcapng_close(pcap);
+            pcap = NULL;
+        }
+        total += resp.length;
+        PrintAndLogEx(INPLACE, "Streamed " _YELLOW_("%zu") " bytes", total);
+    }
+    fclose(f);
+    trace_pcapng_close(pcap);
+#ifndef _WIN32
+    signal(SIGPIPE, old_sigpipe);
+#endif
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%zu") " bytes, " _YELLOW_("%u") " records to `" _YELLOW_("%s") "`", total, stats.records, fn);
+    if (stats.dropped) {
+        PrintAndLogEx(WARNING, "Dropped " _RED_("%u") " records, host didn't keep up", stats.dropped);
+    }
+
+    // keep the capture in the trace buffer as well, for `trace list`
+    if (total) {
+        uint8_t *trace = NULL;
+        size_t len = 0;
+        if (loadFile_safeEx(fn, ".trace", (void **)&trace, &len, false) == PM3_SUCCESS) {
+            ImportTraceBuffer(trace, len);
+            free(trace);
+        }
+    }
+    PrintAndLogEx(HINT, "Try `" _YELLOW_("trace load -f %s") "` and `" _YELLOW_("trace list -1 -t ...") "` to view it", fn);
+    free(fn);
+    return res;
+}
+
 static uint8_t extract_uid[10] = {0};
 static uint8_t extract_uidlen = 0;
 static uint8_t extract_epurse[8] = {0};
 
 #define SKIP_TO_NEXT(a)  (TRACELOG_HDR_LEN + (a)->data_len + TRACELOG_PARITY_LEN((a)))
 
-static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
+static uint32_t extractChall_ev2(uint32_t tracepos, uint8_t *trace, uint8_t cmdpos, uint8_t long_jmp) {
     tracelog_hdr_t *next_hdr = (tracelog_hdr_t *)(trace + tracepos);
     if (next_hdr->data_len != 21) {
         return 0;
@@ -135,7 +695,7 @@ static uint16_t extractChall_ev2(uint16_t tracepos, uint8_t *trace, uint8_t cmdp
     return tracepos;
 }
 
-static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t *trace) {
+static uint32_t extractChallenges(uint32_t tracepos, uint32_t traceLen, uint8_t *trace) {
 
     // sanity check
     if (is_last_record(tracepos, traceLen)) {
@@ -404,7 +964,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2F: {
                 PrintAndLogEx(INFO, "AUTH EV2 First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -413,7 +973,7 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
             }
             case MFDES_AUTHENTICATE_EV2NF: {
                 PrintAndLogEx(INFO, "AUTH EV2 Non First");
-                uint16_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
+                uint32_t tmp = extractChall_ev2(tracepos, trace, pos, long_jmp);
                 if (tmp == 0)
                     break;
                 else
@@ -425,13 +985,13 @@ static uint16_t extractChallenges(uint16_t tracepos, uint16_t traceLen, uint8_t
     return tracepos;
 }
 
-static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol) {
+static uint32_t printHexLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol) {
     // sanity check
     if (is_last_record(tracepos, traceLen)) return traceLen;
 
     tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
 
-    if (TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
+    if (tracepos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
         return traceLen;
     }
 
@@ -443,7 +1003,7 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
         return tracepos;
     }
 
-    uint16_t ret;
+    uint32_t ret;
 
     switch (protocol) {
         case ISO_14443A: {
@@ -491,56 +1051,18 @@ static uint16_t printHexLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trac
     return ret;
 }
 
-static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
-                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
-    // sanity check
-    if (is_last_record(tracepos, traceLen)) {
-        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
-        return traceLen;
-    }
-
-    uint32_t end_of_transmission_timestamp = 0;
-    uint8_t topaz_reader_command[9];
-    char explanation[60] = {0};
-    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
-    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
-
-    uint32_t duration = hdr->duration;
-    uint16_t data_len = hdr->data_len;
-
-    if (tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
-        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %u",
-                      tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr),
-                      traceLen
-                     );
-        return traceLen;
-    }
-
-    // adjust for different time scales
-    if (protocol == ICLASS || protocol == ISO_15693) {
-        duration *= 32;
-    }
-
-    uint8_t *frame = hdr->frame;
-    uint8_t *parityBytes = hdr->frame + data_len;
-
-    tracepos += TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr);
-
-    if (protocol == TOPAZ && !hdr->isResponse) {
-        // topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
-        // merge them:
-        if (merge_topaz_reader_frames(hdr->timestamp, &duration, &tracepos, traceLen, trace, frame, topaz_reader_command, &data_len)) {
-            frame = topaz_reader_command;
-        }
-    }
-
-    //Check the CRC status
+// CRC status of a frame as shown in the CRC column
+//0 CRC-command, CRC not ok
+//1 CRC-command, CRC ok
+//2 Not crc-command
+//3 / 4 ISO7816, CRC ok as 14a / 14b block
+static uint8_t trace_crc_status(uint8_t protocol, bool isResponse, uint8_t *frame, uint16_t data_len, const uint8_t *parityBytes) {
     uint8_t crcStatus = 2;
 
     if (data_len > 2) {
         switch (protocol) {
             case ICLASS:
-                crcStatus = iclass_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = iclass_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_14443B:
             case TOPAZ:
@@ -551,16 +1073,16 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                 break;
             case PROTO_MIFARE:
             case PROTO_MFPLUS:
-                crcStatus = mifare_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = mifare_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_14443A:
             case MFDES:
             case LTO:
             case SEOS:
-                crcStatus = iso14443A_CRC_check(hdr->isResponse, frame, data_len);
+                crcStatus = iso14443A_CRC_check(isResponse, frame, data_len);
                 break;
             case ISO_7816_4:
-                crcStatus = iso14443A_CRC_check(hdr->isResponse, frame, data_len) == 1 ? 3 : 0;
+                crcStatus = iso14443A_CRC_check(isResponse, frame, data_len) == 1 ? 3 : 0;
                 crcStatus = iso14443B_CRC_check(frame, data_len) == 1 ? 4 : crcStatus;
                 break;
             case THINFILM:
@@ -584,9 +1106,54 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
                 break;
         }
     }
-    //0 CRC-command, CRC not ok
-    //1 CRC-command, CRC ok
-    //2 Not crc-command
+    return crcStatus;
+}
+
+static uint32_t printTraceLine(uint32_t tracepos, uint32_t traceLen, uint8_t *trace, uint8_t protocol, bool showWaitCycles, bool markCRCBytes, uint32_t *prev_eot, bool use_us,
+                               const uint64_t *mfDicKeys, uint32_t mfDicKeysCount) {
+    // sanity check
+    if (is_last_record(tracepos, traceLen)) {
+        PrintAndLogEx(DEBUG, "last record triggered.  t-pos: %u  t-len %u", tracepos, traceLen);
+        return traceLen;
+    }
+
+    uint32_t end_of_transmission_timestamp = 0;
+    uint8_t topaz_reader_command[9];
+    char explanation[60] = {0};
+    tracelog_hdr_t *first_hdr = (tracelog_hdr_t *)(trace);
+    tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + tracepos);
+
+    uint32_t duration = hdr->duration;
+    uint16_t data_len = hdr->data_len;
+
+    if (tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr) > traceLen) {
+        PrintAndLogEx(DEBUG, "trace pos offset %"PRIu64 " larger than reported tracelen %u",
+                      tracepos + TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr),
+                      traceLen
+                     );
+        return traceLen;
+    }
+
+    // adjust for different time scales
+    if (protocol == ICLASS || protocol == ISO_15693) {
+        duration *= 32;
+    }
+
+    uint8_t *frame = hdr->frame;
+    uint8_t *parityBytes = hdr->frame + data_len;
+
+    tracepos += TRACELOG_HDR_LEN + data_len + TRACELOG_PARITY_LEN(hdr);
+
+    if (protocol == TOPAZ && !hdr->isResponse) {
+        // topaz reader commands come in 1 or 9 separate frames with 7 or 8 Bits each.
+        // merge them:
+        if (merge_topaz_reader_frames(hdr->timestamp, &duration, &tracepos, traceLen, trace, frame, topaz_reader_command, &data_len)) {
+            frame = topaz_reader_command;
+        }
+    }
+
+    //Check the CRC status
+    uint8_t crcStatus = trace_crc_status(protocol, hdr->isResponse, frame, data_len, parityBytes);
 
     // Draw the data column
 #define TRACE_MAX_LINES      36
@@ -801,38 +1368,23 @@ static uint16_t printTraceLine(uint16_t tracepos, uint16_t traceLen, uint8_t *tr
             break;
     }
 
-    if (hdr->isResponse == false) {
+    const char *precomputed = (hdr->isResponse) ? NULL : trace_annot_lookup((uint32_t)((uint8_t *)hdr - trace), protocol);
+    if (precomputed) {
+        strncpy(explanation, precomputed, sizeof(explanation) - 1);
+    } else if (hdr->isResponse == false && annotate_reader_stateless(protocol, explanation, sizeof(explanation), frame, data_len) == false) {
         switch (protocol) {
-            case LEGIC:
-                annotateLegic(explanation, sizeof(explanation), frame, data_len);
-                break;
             case MFDES:
                 annotateMfDesfire(explanation, sizeof(explanation), frame, data_len);
                 break;
             case PROTO_MFPLUS:
                 annotateMfPlus(explanation, sizeof(explanation), frame, data_len);
                 break;
-            case ISO_14443B:
-                annotateIso14443b(explanation, sizeof(explanation), frame, data_len);
-                break;
             case TOPAZ:
                 annotateTopaz(explanation, sizeof(explanation), frame, data_len);
                 break;
             case ISO_7816_4:
                 annotateIso7816(explanation, sizeof(explanation), frame, data_len);
                 break;
-            case ISO_15693:
-                annotateIso15693(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case FELICA:
-                annotateFelica(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case LTO:
-                annotateLTO(explanation, sizeof(explanation), frame, data_len);
-                break;
-            case PROTO_CRYPTORF:
-                annotateCryptoRF(explanation, sizeof(explanation), frame, data_len);
-                break;
             case SEOS:
                 annotateSeos(explanation, sizeof(explanation), frame, data_len);
                 break;
@@ -1079,6 +1631,7 @@ static int download_trace(void) {
     }
 
     gs_traceLen = 0;
+    trace_index_free();
 
     gs_trace = calloc(PM3_CMD_DATA_SIZE, sizeof(uint8_t));
     if (gs_trace == NULL) {
@@ -1162,7 +1715,7 @@ static int CmdTraceExtract(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     while (tracepos < gs_traceLen) {
         tracepos = extractChallenges(tracepos, gs_traceLen, gs_trace);
@@ -1174,12 +1727,54 @@ static int CmdTraceExtract(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Standalone sniffers streaming to flash write trace_lz4_block_t blocks,
+// unpack them into a plain trace log.  A damaged tail is cut off.
+static int trace_unpack_lz4(uint8_t **trace, size_t *len) {
+    const uint8_t *src = *trace;
+    size_t n = *len;
+
+    // a block never unpacks to more than TRACE_LZ4_MAX_INPUT bytes
+    size_t blocks = n / sizeof(trace_lz4_block_t) + 1;
+    uint8_t *out = calloc(blocks, TRACE_LZ4_MAX_INPUT);
+    if (out == NULL) {
+        PrintAndLogEx(WARNING, "Fail, cannot allocate memory");
+        return PM3_EMALLOC;
+    }
+
+    size_t pos = 0, outlen = 0, nblocks = 0;
+    while (pos + sizeof(trace_lz4_block_t) <= n) {
+        trace_lz4_block_t blk;
+        memcpy(&blk, src + pos, sizeof(blk));
+        if (blk.magic != TRACE_LZ4_MAGIC || blk.rawlen > TRACE_LZ4_MAX_INPUT || pos + sizeof(blk) + blk.clen > n) {
+            PrintAndLogEx(WARNING, "Damaged block at offset %zu, rest of the file ignored", pos);
+            break;
+        }
+        pos += sizeof(blk);
+
+        if (blk.clen == blk.rawlen) {
+            memcpy(out + outlen, src + pos, blk.rawlen);
+        } else if (LZ4_decompress_safe((const char *)src + pos, (char *)out + outlen, blk.clen, blk.rawlen) != blk.rawlen) {
+            PrintAndLogEx(WARNING, "Damaged block at offset %zu, rest of the file ignored", pos - sizeof(blk));
+            break;
+        }
+        pos += blk.clen;
+        outlen += blk.rawlen;
+        nblocks++;
+    }
+
+    PrintAndLogEx(INFO, "Unpacked " _YELLOW_("%zu") " blocks, %zu -> %zu bytes", nblocks, n, outlen);
+    free(*trace);
+    *trace = out;
+    *len = outlen;
+    return PM3_SUCCESS;
+}
+
 static int CmdTraceLoad(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace load",
                   "Load protocol data from binary file to trace buffer\n"
-                  "File extension is <.trace>",
+                  "File extension is <.trace>,  LZ4 packed traces streamed by standalone sniffers are unpacked",
                   "trace load -f mytracefile    -> w/o file extension"
                  );
 
@@ -1200,6 +1795,7 @@ static int CmdTraceLoad(const char *Cmd) {
         gs_trace = NULL;
         gs_traceLen = 0;
     }
+    trace_index_free();
 
     size_t len = 0;
     if (loadFile_safe(filename, ".trace", (void **)&gs_trace, &len) != PM3_SUCCESS) {
@@ -1207,7 +1803,26 @@ static int CmdTraceLoad(const char *Cmd) {
         return PM3_EIO;
     }
 
-    gs_traceLen = (long)len;
+    uint32_t magic = 0;
+    if (len >= sizeof(magic)) {
+        memcpy(&magic, gs_trace, sizeof(magic));
+    }
+    if (magic == TRACE_LZ4_MAGIC) {
+        int res = trace_unpack_lz4(&gs_trace, &len);
+        if (res != PM3_SUCCESS) {
+            free(gs_trace);
+            gs_trace = NULL;
+            return res;
+        }
+    }
+
+    if (len > UINT32_MAX) {
+        PrintAndLogEx(FAILED, "Trace file too large");
+        free(gs_trace);
+        gs_trace = NULL;
+        return PM3_EOVFLOW;
+    }
+    gs_traceLen = (uint32_t)len;
 
     PrintAndLogEx(SUCCESS, "Recorded Activity (TraceLen = " _YELLOW_("%u") " bytes)", gs_traceLen);
     PrintAndLogEx(HINT, "try " _YELLOW_("`trace list -1 -t ...`") " to view trace.  Remember the " _YELLOW_("`-1`") " param");
@@ -1219,13 +1834,17 @@ static int CmdTraceSave(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "trace save",
                   "Save protocol data from trace buffer to binary file\n"
-                  "File extension is <.trace>",
-                  "trace save -f mytracefile    -> w/o file extension"
+                  "File extension is <.trace>, or <.pcapng> for Wireshark",
+                  "trace save -f mytracefile                 -> w/o file extension\n"
+                  "trace save -f mytracefile --pcapng        -> ISO14443 pcapng\n"
+                  "trace save -f mytracefile --pcapng -t 15  -> raw frames, LINKTYPE_USER0"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str1("f", "file", "<fn>", "Specify trace file to save"),
+        arg_lit0(NULL, "pcapng", "save as PCAP-NG"),
+        arg_str0("t", "type", NULL, "protocol of the trace, selects the pcapng link type (def 14a)"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, false);
@@ -1233,6 +1852,12 @@ static int CmdTraceSave(const char *Cmd) {
     int fnlen = 0;
     char filename[FILE_PATH_SIZE] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 1), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    bool pcapng = arg_get_lit(ctx, 2);
+
+    int tlen = 0;
+    char type[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 3), (uint8_t *)type, sizeof(type), &tlen);
+    str_lower(type);
     CLIParserFree(ctx);
 
     if (gs_traceLen == 0) {
@@ -1243,8 +1868,49 @@ static int CmdTraceSave(const char *Cmd) {
         }
     }
 
-    saveFile(filename, ".trace", gs_trace, gs_traceLen);
-    return PM3_SUCCESS;
+    if (pcapng == false) {
+        saveFile(filename, ".trace", gs_trace, gs_traceLen);
+        return PM3_SUCCESS;
+    }
+
+    uint8_t protocol = ISO_14443A;
+    if (tlen && trace_protocol_from_str(type, &protocol) == false) {
+        PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
+        return PM3_EINVARG;
+    }
+
+    char *fn = newfilenamemcopy(filename, ".pcapng");
+    if (fn == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    trace_pcapng_t *w = trace_pcapng_open(fn, protocol);
+    if (w == NULL) {
+        free(fn);
+        return PM3_EFILE;
+    }
+
+    int res = PM3_SUCCESS;
+    uint32_t tracepos = 0;
+    while (res == PM3_SUCCESS && (tracepos + TRACELOG_HDR_LEN) <= gs_traceLen) {
+        const tracelog_hdr_t *hdr = (const tracelog_hdr_t *)(gs_trace + tracepos);
+        uint32_t next = tracepos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (next > gs_traceLen) {
+            break;
+        }
+        res = trace_pcapng_record(w, hdr);
+        tracepos = next;
+    }
+    uint32_t records = w->records;
+    trace_pcapng_close(w);
+
+    if (res != PM3_SUCCESS) {
+        PrintAndLogEx(WARNING, "failed writing to `" _YELLOW_("%s") "`", fn);
+    } else {
+        PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%u") " records to `" _YELLOW_("%s") "`", records, fn);
+    }
+    free(fn);
+    return res;
 }
 
 int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol) {
@@ -1274,12 +1940,15 @@ int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol)
         arg_lit0("x", NULL, "show hexdump to convert to pcap(ng)\n"
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "only records from this time on, clock units as in the Start column"),
+        arg_u64_0(NULL, "end", "<dec>", "only records up to this time"),
+        arg_str0(NULL, "cmd", "<hex>", "only reader frames starting with this byte, and their replies"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
     CLIParserFree(ctx);
 
-    char args[128] = {0};
+    char args[256] = {0};
     snprintf(args, sizeof(args), "-t %s ", protocol);
     strncat(args, Cmd, sizeof(args) - strlen(args) - 1);
     return CmdTraceList(args);
@@ -1313,7 +1982,9 @@ int CmdTraceList(const char *Cmd) {
                   "\n"
                   "trace list -t mf -f mfc_default_keys.dic     -> use default dictionary file\n"
                   "trace list -t 14a --frame                    -> show frame delay times\n"
-                  "trace list -t 14a -1                         -> use trace buffer "
+                  "trace list -t 14a -1                         -> use trace buffer \n"
+                  "trace list -t 14a -1 --start 1000000 --end 2000000 -> only records in this time window\n"
+                  "trace list -t 14a -1 --cmd 60                -> only AUTH A frames and their replies"
                  );
 
     void *argtable[] = {
@@ -1327,6 +1998,9 @@ int CmdTraceList(const char *Cmd) {
                  "                                   or to import into Wireshark using encapsulation type \"ISO 14443\""),
         arg_str0("t", "type", NULL, "protocol to annotate the trace"),
         arg_str0("f", "file", "<fn>", "filename of dictionary"),
+        arg_u64_0(NULL, "start", "<dec>", "only records from this time on, clock units as in the Start column"),
+        arg_u64_0(NULL, "end", "<dec>", "only records up to this time"),
+        arg_str0(NULL, "cmd", "<hex>", "only reader frames starting with this byte, and their replies"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -1350,35 +2024,32 @@ int CmdTraceList(const char *Cmd) {
         diclen = 0;
     }
 
+    bool use_window = (arg_get_u64_count(ctx, 9) || arg_get_u64_count(ctx, 10));
+    uint64_t win_start = arg_get_u64_def(ctx, 9, 0);
+    uint64_t win_end = arg_get_u64_def(ctx, 10, UINT64_MAX);
+
+    uint8_t filter_cmd[1] = {0};
+    int filter_cmd_len = 0;
+    if (CLIParamHexToBuf(arg_get_str(ctx, 11), filter_cmd, sizeof(filter_cmd), &filter_cmd_len)) {
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+    bool use_filter = (filter_cmd_len == 1);
+
     CLIParserFree(ctx);
 
+    if (win_end < win_start) {
+        PrintAndLogEx(FAILED, "End of the time window is before its start");
+        return PM3_EINVARG;
+    }
+
     clearCommandBuffer();
 
     // no crc, no annotations
     uint8_t protocol = -1;
 
     // validate type of output
-    if (strcmp(type, "14a") == 0)      protocol = ISO_14443A;
-    else if (strcmp(type, "14b") == 0)      protocol = ISO_14443B;
-    else if (strcmp(type, "15") == 0)       protocol = ISO_15693;
-    else if (strcmp(type, "7816") == 0)     protocol = ISO_7816_4;
-    else if (strcmp(type, "cryptorf") == 0) protocol = PROTO_CRYPTORF;
-    else if (strcmp(type, "des") == 0)      protocol = MFDES;
-    else if (strcmp(type, "felica") == 0)   protocol = FELICA;
-    else if (strcmp(type, "hitag1") == 0)   protocol = PROTO_HITAG1;
-    else if (strcmp(type, "hitag2") == 0)   protocol = PROTO_HITAG2;
-    else if (strcmp(type, "hitags") == 0)   protocol = PROTO_HITAGS;
-    else if (strcmp(type, "iclass") == 0)   protocol = ICLASS;
-    else if (strcmp(type, "legic") == 0)    protocol = LEGIC;
-    else if (strcmp(type, "lto") == 0)      protocol = LTO;
-    else if (strcmp(type, "mf") == 0)       protocol = PROTO_MIFARE;
-    else if (strcmp(type, "raw") == 0)      protocol = -1;
-    else if (strcmp(type, "seos") == 0)     protocol = SEOS;
-    else if (strcmp(type, "thinfilm") == 0) protocol = THINFILM;
-    else if (strcmp(type, "topaz") == 0)    protocol = TOPAZ;
-    else if (strcmp(type, "mfp") == 0)      protocol = PROTO_MFPLUS;
-    else if (strcmp(type, "") == 0)         protocol = -1;
-    else {
+    if (trace_protocol_from_str(type, &protocol) == false) {
         PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
         return PM3_EINVARG;
     }
@@ -1396,7 +2067,7 @@ int CmdTraceList(const char *Cmd) {
         return PM3_SUCCESS;
     }
 
-    uint16_t tracepos = 0;
+    uint32_t tracepos = 0;
 
     /*
     if (protocol == FELICA) {
@@ -1514,6 +2185,8 @@ int CmdTraceList(const char *Cmd) {
             }
         }
 
+        PrintAndLogBufferStart();
+
         PrintAndLogEx(NORMAL, "");
         if (use_relative) {
             PrintAndLogEx(NORMAL, "        Gap |   Duration | Src | Data (! denotes parity error, ' denotes short bytes)                    | CRC | Annotation");
@@ -1525,6 +2198,7 @@ int CmdTraceList(const char *Cmd) {
         // clean authentication data used with the mifare classic decrypt fct
         if (protocol == ISO_14443A || protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS) {
             ClearAuthData();
+            ClearTraceKeyCache();
         }
 
         // reset hitag state  machine
@@ -1538,14 +2212,67 @@ int CmdTraceList(const char *Cmd) {
             prev_EOT = &previous_EOT;
         }
 
-        while (tracepos < gs_traceLen) {
-            tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+        // a full listing of a large trace gets its annotations up front
+        if (use_window == false && use_filter == false) {
+            trace_annot_build(protocol);
+        }
 
-            if (kbd_enter_pressed()) {
-                break;
+        if (use_window || use_filter) {
+
+            if (trace_index_build() != PM3_SUCCESS) {
+                PrintAndLogBufferStop();
+                if (dictionaryLoad)  {
+                    free((void *) dicKeys);
+                }
+                return PM3_EMALLOC;
+            }
+
+            uint32_t first = trace_index_lower_bound(win_start);
+            uint32_t last = (win_end == UINT64_MAX) ? gs_trace_idx_count : trace_index_lower_bound(win_end + 1);
+            PrintAndLogEx(DEBUG, "index %u records, window %u - %u", gs_trace_idx_count, first, last);
+
+            if (use_filter == false) {
+                // a window is one contiguous run of records
+                uint32_t end_pos = (last < gs_trace_idx_count) ? gs_trace_idx[last].offset : gs_traceLen;
+                tracepos = (first < gs_trace_idx_count) ? gs_trace_idx[first].offset : gs_traceLen;
+                while (tracepos < end_pos) {
+                    tracepos = printTraceLine(tracepos, end_pos, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+
+                    if (kbd_enter_pressed()) {
+                        break;
+                    }
+                }
+            } else {
+                // reader frames with the command byte, and the replies following them
+                bool keep = false;
+                for (uint32_t i = first; i < last; i++) {
+                    const trace_idx_t *e = &gs_trace_idx[i];
+                    if ((e->flags & TRACE_IDX_RESPONSE) == 0) {
+                        keep = (e->cmd == filter_cmd[0]);
+                    }
+                    if (keep == false) {
+                        continue;
+                    }
+
+                    printTraceLine(e->offset, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+
+                    if (kbd_enter_pressed()) {
+                        break;
+                    }
+                }
+            }
+        } else {
+            while (tracepos < gs_traceLen) {
+                tracepos = printTraceLine(tracepos, gs_traceLen, gs_trace, protocol, show_wait_cycles, mark_crc, prev_EOT, use_us, dicKeys, dicKeysCount);
+
+                if (kbd_enter_pressed()) {
+                    break;
+                }
             }
         }
 
+        PrintAndLogBufferStop();
+
         if (dictionaryLoad)  {
             free((void *) dicKeys);
         }
@@ -1558,12 +2285,379 @@ int CmdTraceList(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Statistics over one or more traces, `trace stats`.
+// Latency is the gap between the end of a reader frame and the start of the first tag frame after it.
+#define TRACE_STATS_BUCKETS  16     // log2 of us, 1 = 2 us, last one open ended
+
+typedef struct {
+    uint32_t count;
+    uint32_t answered;
+    uint64_t latency_sum;
+    uint32_t latency_min;
+    uint32_t latency_max;
+} trace_cmd_stats_t;
+
+typedef struct {
+    uint32_t files;
+    uint32_t failed_files;
+    uint32_t records;
+    uint32_t reader;
+    uint32_t tag;
+    uint32_t crc_checked;
+    uint32_t crc_errors;
+    uint32_t parity_errors;
+    uint32_t unanswered;
+    uint64_t span;                   // sum of first to last record, carrier cycles
+    uint32_t histogram[TRACE_STATS_BUCKETS];
+    trace_cmd_stats_t cmds[256];
+} trace_stats_t;
+
+static void trace_stats_collect(uint8_t *trace, uint32_t len, uint8_t protocol, trace_stats_t *st) {
+
+    // MIFARE crypto state is not tracked here, CRC is checked as plain 14a
+    uint8_t crc_protocol = (protocol == PROTO_MIFARE || protocol == PROTO_MFPLUS) ? ISO_14443A : protocol;
+    bool check_parity = (protocol == ISO_14443A || protocol == MFDES || protocol == SEOS || protocol == TOPAZ);
+    uint32_t scale = (protocol == ICLASS || protocol == ISO_15693) ? 32 : 1;
+
+    uint64_t epoch = 0, first = 0, last = 0;
+    uint32_t prev_raw = 0;
+    bool pending = false;
+    uint8_t pending_cmd = 0;
+    uint64_t pending_end = 0;
+    uint32_t n = 0;
+
+    uint32_t pos = 0;
+    while ((pos + TRACELOG_HDR_LEN) <= len) {
+        tracelog_hdr_t *hdr = (tracelog_hdr_t *)(trace + pos);
+        uint32_t next = pos + TRACELOG_HDR_LEN + hdr->data_len + TRACELOG_PARITY_LEN(hdr);
+        if (next > len) {
+            break;
+        }
+        pos = next;
+
+        if (n && hdr->timestamp < prev_raw && (prev_raw - hdr->timestamp) > 0x80000000) {
+            epoch += 0x100000000ULL;
+        }
+        prev_raw = hdr->timestamp;
+        uint64_t ts = epoch + hdr->timestamp;
+        if (n == 0) {
+            first = ts;
+        }
+        last = MAX(last, ts + ((uint64_t)hdr->duration * scale));
+        n++;
+
+        uint8_t *frame = hdr->frame;
+        uint16_t data_len = hdr->data_len;
+        uint8_t *parity = hdr->frame + data_len;
+
+        if (protocol != 0xFF) {
+            uint8_t crc = trace_crc_status(crc_protocol, hdr->isResponse, frame, data_len, parity);
+            if (crc != 2) {
+                st->crc_checked++;
+                if (crc == 0) {
+                    st->crc_errors++;
+                }
+            }
+        }
+
+        if (check_parity) {
+            for (uint16_t j = 0; j < data_len; j++) {
+                if (oddparity8(frame[j]) != ((parity[j >> 3] >> (7 - (j & 0x0007))) & 0x01)) {
+                    st->parity_errors++;
+                    break;
+                }
+            }
+        }
+
+        if (hdr->isResponse == false) {
+            st->reader++;
+            if (pending) {
+                st->unanswered++;
+            }
+            if (data_len == 0) {
+                pending = false;
+                continue;
+            }
+            pending = true;
+            pending_cmd = frame[0];
+            pending_end = ts + ((uint64_t)hdr->duration * scale);
+            st->cmds[pending_cmd].count++;
+            continue;
+        }
+
+        st->tag++;
+        if (pending == false) {
+            continue;
+        }
+        pending = false;
+
+        uint32_t latency = (ts > pending_end) ? (uint32_t)MIN(ts - pending_end, UINT32_MAX) : 0;
+        trace_cmd_stats_t *c = &st->cmds[pending_cmd];
+        if (c->answered == 0 || latency < c->latency_min) {
+            c->latency_min = latency;
+        }
+        c->latency_max = MAX(c->latency_max, latency);
+        c->latency_sum += latency;
+        c->answered++;
+
+        uint32_t us = latency / 13.56;
+        uint8_t bucket = 0;
+        while (us > 1 && bucket < (TRACE_STATS_BUCKETS - 1)) {
+            us >>= 1;
+            bucket++;
+        }
+        st->histogram[bucket]++;
+    }
+
+    if (pending) {
+        st->unanswered++;
+    }
+    st->records += n;
+    if (n) {
+        st->span += last - first;
+    }
+}
+
+static void trace_stats_merge(trace_stats_t *dst, const trace_stats_t *src) {
+    dst->files += src->files;
+    dst->failed_files += src->failed_files;
+    dst->records += src->records;
+    dst->reader += src->reader;
+    dst->tag += src->tag;
+    dst->crc_checked += src->crc_checked;
+    dst->crc_errors += src->crc_errors;
+    dst->parity_errors += src->parity_errors;
+    dst->unanswered += src->unanswered;
+    dst->span += src->span;
+    for (int i = 0; i < TRACE_STATS_BUCKETS; i++) {
+        dst->histogram[i] += src->histogram[i];
+    }
+    for (int i = 0; i < 256; i++) {
+        trace_cmd_stats_t *d = &dst->cmds[i];
+        const trace_cmd_stats_t *c = &src->cmds[i];
+        if (c->answered && (d->answered == 0 || c->latency_min < d->latency_min)) {
+            d->latency_min = c->latency_min;
+        }
+        d->latency_max = MAX(d->latency_max, c->latency_max);
+        d->latency_sum += c->latency_sum;
+        d->answered += c->answered;
+        d->count += c->count;
+    }
+}
+
+typedef struct {
+    struct arg_str *files;
+    uint8_t protocol;
+    uint32_t thread_idx;
+    uint32_t thread_cnt;
+    trace_stats_t *stats;
+} trace_stats_arg_t;
+
+static void *trace_stats_thread(void *arg) {
+    trace_stats_arg_t *a = (trace_stats_arg_t *)arg;
+    for (int f = a->thread_idx; f < a->files->count; f += a->thread_cnt) {
+        uint8_t *trace = NULL;
+        size_t len = 0;
+        if (loadFile_safeEx(a->files->sval[f], ".trace", (void **)&trace, &len, false) != PM3_SUCCESS || len > UINT32_MAX) {
+            free(trace);
+            a->stats->failed_files++;
+            continue;
+        }
+        trace_stats_collect(trace, len, a->protocol, a->stats);
+        a->stats->files++;
+        free(trace);
+    }
+    return NULL;
+}
+
+static void trace_stats_print(const trace_stats_t *st) {
+
+    PrintAndLogEx(NORMAL, "");
+    if (st->files || st->failed_files) {
+        PrintAndLogEx(INFO, "Files............ " _YELLOW_("%u"), st->files);
+        if (st->failed_files) {
+            PrintAndLogEx(WARNING, "Not loaded....... " _RED_("%u"), st->failed_files);
+        }
+    }
+    PrintAndLogEx(INFO, "Records.......... " _YELLOW_("%u") " ( reader %u / tag %u )", st->records, st->reader, st->tag);
+    PrintAndLogEx(INFO, "Capture time..... " _YELLOW_("%.1f") " ms", st->span / 13560.0);
+    if (st->crc_checked) {
+        PrintAndLogEx(INFO, "CRC errors....... " _YELLOW_("%u") " / %u ( %.2f %% )", st->crc_errors, st->crc_checked, (100.0 * st->crc_errors) / st->crc_checked);
+    }
+    if (st->parity_errors) {
+        PrintAndLogEx(INFO, "Parity errors.... " _YELLOW_("%u") " frames", st->parity_errors);
+    }
+    if (st->reader) {
+        PrintAndLogEx(INFO, "Unanswered....... " _YELLOW_("%u") " / %u ( %.2f %% )", st->unanswered, st->reader, (100.0 * st->unanswered) / st->reader);
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, " cmd |    count | answered |   min us |   avg us |   max us");
+    PrintAndLogEx(INFO, "-----+----------+----------+----------+----------+----------");
+    for (int i = 0; i < 256; i++) {
+        const trace_cmd_stats_t *c = &st->cmds[i];
+        if (c->count == 0) {
+            continue;
+        }
+        if (c->answered) {
+            PrintAndLogEx(INFO, "  %02X | %8u | %8u | %8.1f | %8.1f | %8.1f",
+                          i, c->count, c->answered,
+                          c->latency_min / 13.56,
+                          (c->latency_sum / (double)c->answered) / 13.56,
+                          c->latency_max / 13.56
+                         );
+        } else {
+            PrintAndLogEx(INFO, "  %02X | %8u | %8u |          |          |", i, c->count, 0);
+        }
+    }
+
+    // only the used range of buckets
+    uint32_t max = 0;
+    int lo = -1, hi = -1;
+    for (int i = 0; i < TRACE_STATS_BUCKETS; i++) {
+        max = MAX(max, st->histogram[i]);
+        if (st->histogram[i]) {
+            if (lo < 0) {
+                lo = i;
+            }
+            hi = i;
+        }
+    }
+    if (max == 0) {
+        return;
+    }
+
+    PrintAndLogEx(NORMAL, "");
+    PrintAndLogEx(INFO, "Reader to tag latency");
+    for (int i = lo; i <= hi; i++) {
+        char bar[41] = {0};
+        memset(bar, '#', (st->histogram[i] * 40ULL + max - 1) / max);
+        if (i == (TRACE_STATS_BUCKETS - 1)) {
+            PrintAndLogEx(INFO, "       >= %6u us | %8u | %s", 1U << i, st->histogram[i], bar);
+        } else {
+            PrintAndLogEx(INFO, " %6u - %6u us | %8u | %s", (i) ? (1U << i) : 0, (2U << i) - 1, st->histogram[i], bar);
+        }
+    }
+}
+
+static int CmdTraceStats(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "trace stats",
+                  "Command counts, reader to tag latencies and error rates of the trace buffer,\n"
+                  "or summed over a set of trace files, which are processed in parallel.\n"
+                  "Latencies are in microseconds, 13.56 MHz carrier based.\n"
+                  "Encrypted MIFARE Classic frames count as CRC errors",
+                  "trace stats -1 -t 14a\n"
+                  "trace stats -t 14a -f gate1 -f gate2 -f gate3"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0("1", "buffer", "use data from trace buffer"),
+        arg_str0("t", "type", NULL, "protocol for CRC checks, as `trace list -t`"),
+        arg_strn("f", "file", "<fn>", 0, 1024, "trace file(s) to process instead of the trace buffer"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+
+    bool use_buffer = arg_get_lit(ctx, 1);
+
+    int tlen = 0;
+    char type[10] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 2), (uint8_t *)type, sizeof(type), &tlen);
+    str_lower(type);
+
+    uint8_t protocol = -1;
+    if (trace_protocol_from_str(type, &protocol) == false) {
+        PrintAndLogEx(FAILED, "Unknown protocol \"%s\"", type);
+        CLIParserFree(ctx);
+        return PM3_EINVARG;
+    }
+
+    struct arg_str *files = arg_get_str(ctx, 3);
+
+    trace_stats_t *total = calloc(1, sizeof(trace_stats_t));
+    if (total == NULL) {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace statistics");
+        CLIParserFree(ctx);
+        return PM3_EMALLOC;
+    }
+
+    if (files->count == 0) {
+        CLIParserFree(ctx);
+
+        if (use_buffer == false) {
+            download_trace();
+        }
+        if (gs_traceLen == 0 || gs_trace == NULL) {
+            PrintAndLogEx(FAILED, "There is no trace, consider using `" _YELLOW_("trace load") "` and `" _YELLOW_("-1") "`");
+            free(total);
+            return PM3_EINVARG;
+        }
+
+        trace_stats_collect(gs_trace, gs_traceLen, protocol, total);
+        trace_stats_print(total);
+        free(total);
+        return PM3_SUCCESS;
+    }
+
+    int cpus = num_CPUs();
+    uint32_t thread_cnt = MIN((uint32_t)((cpus > 0) ? cpus : 1), (uint32_t)files->count);
+
+    pthread_t threads[thread_cnt];
+    trace_stats_arg_t args[thread_cnt];
+    int res = PM3_SUCCESS;
+    for (uint32_t i = 0; i < thread_cnt; i++) {
+        args[i].files = files;
+        args[i].protocol = protocol;
+        args[i].thread_idx = i;
+        args[i].thread_cnt = thread_cnt;
+        args[i].stats = calloc(1, sizeof(trace_stats_t));
+        if (args[i].stats == NULL) {
+            res = PM3_EMALLOC;
+        }
+    }
+
+    if (res == PM3_SUCCESS) {
+        uint32_t started = 0;
+        for (; started < thread_cnt; started++) {
+            if (pthread_create(&threads[started], NULL, trace_stats_thread, (void *)&args[started])) {
+                break;
+            }
+        }
+
+        // whatever share a thread could not be started for, is done here
+        for (uint32_t i = started; i < thread_cnt; i++) {
+            trace_stats_thread(&args[i]);
+        }
+
+        for (uint32_t i = 0; i < started; i++) {
+            pthread_join(threads[i], NULL);
+        }
+
+        for (uint32_t i = 0; i < thread_cnt; i++) {
+            trace_stats_merge(total, args[i].stats);
+        }
+        trace_stats_print(total);
+    } else {
+        PrintAndLogEx(FAILED, "Cannot allocate memory for trace statistics");
+    }
+
+    for (uint32_t i = 0; i < thread_cnt; i++) {
+        free(args[i].stats);
+    }
+    free(total);
+    CLIParserFree(ctx);
+    return res;
+}
+
 static command_t CommandTable[] = {
     {"help",    CmdHelp,          AlwaysAvailable, "This help"},
     {"extract", CmdTraceExtract,  AlwaysAvailable, "Extract authentication challenges found in trace"},
     {"list",    CmdTraceList,     AlwaysAvailable, "List protocol data in trace buffer"},
     {"load",    CmdTraceLoad,     AlwaysAvailable, "Load trace from file"},
     {"save",    CmdTraceSave,     AlwaysAvailable, "Save trace buffer to file"},
+    {"stats",   CmdTraceStats,    AlwaysAvailable, "Command counts, latencies and error rates of traces"},
     {NULL, NULL, NULL, NULL}
 };
 
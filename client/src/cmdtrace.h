@@ -24,6 +24,7 @@
 int CmdTrace(const char *Cmd);
 int CmdTraceList(const char *Cmd);
 int CmdTraceListAlias(const char *Cmd, const char *alias, const char *protocol);
-bool ImportTraceBuffer(const uint8_t *trace_src, uint16_t trace_len);
+bool ImportTraceBuffer(const uint8_t *trace_src, uint32_t trace_len);
+int TraceStreamSniff(uint16_t cmd, uint8_t *data, uint16_t datalen, const char *preferredName, const char *pcapng_fn, uint8_t protocol);
 
 #endif
@@ -30,6 +30,8 @@
 #include "wiegand_formats.h"
 #include "wiegand_formatutils.h"
 #include "util.h"
+#include "fileutils.h"
+#include "ui.h"
 
 static int CmdHelp(const char *Cmd);
 
@@ -52,26 +54,224 @@ int CmdWiegandList(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+// Batch mode, one credential per line in, one CSV row per line out, either to a file
+// or the console. Rows also go to the structured result, for libpm3 users.
+typedef struct {
+    FILE *out;
+    size_t rows;
+} wiegand_batch_t;
+
+static void wiegand_batch_row(wiegand_batch_t *b, const char *row) {
+    if (b->out) {
+        fprintf(b->out, "%s\n", row);
+    } else {
+        PrintAndLogEx(NORMAL, "%s", row);
+    }
+    ResultAppendStr("rows", row);
+    b->rows++;
+}
+
+static void wiegand_hex(wiegand_message_t *packed, char *s, size_t slen) {
+    if (packed->Top != 0) {
+        snprintf(s, slen, "%X%08X%08X", packed->Top, packed->Mid, packed->Bot);
+    } else {
+        snprintf(s, slen, "%X%08X", packed->Mid, packed->Bot);
+    }
+}
+
+static int wiegand_batch_open(wiegand_batch_t *b, const char *infile, const char *outfile, FILE **in) {
+    memset(b, 0, sizeof(wiegand_batch_t));
+    *in = fopen(infile, "r");
+    if (*in == NULL) {
+        PrintAndLogEx(ERR, "Can't open " _YELLOW_("%s"), infile);
+        return PM3_EFILE;
+    }
+    if (strlen(outfile)) {
+        b->out = fopen(outfile, "w");
+        if (b->out == NULL) {
+            PrintAndLogEx(ERR, "Can't create " _YELLOW_("%s"), outfile);
+            fclose(*in);
+            return PM3_EFILE;
+        }
+    }
+    return PM3_SUCCESS;
+}
+
+static void wiegand_batch_close(wiegand_batch_t *b, FILE *in, const char *outfile) {
+    fclose(in);
+    if (b->out) {
+        fclose(b->out);
+        PrintAndLogEx(SUCCESS, "saved " _YELLOW_("%zu") " rows to " _YELLOW_("%s"), b->rows, outfile);
+    }
+    ResultAddInt("count", b->rows);
+}
+
+// strips comments and blanks, returns false for empty lines
+static bool wiegand_batch_line(char *line) {
+    char *c = strchr(line, '#');
+    if (c) {
+        *c = '\0';
+    }
+    str_cleanrn(line, strlen(line));
+    size_t l = strlen(line);
+    while (l && isspace((unsigned char)line[l - 1])) {
+        line[--l] = '\0';
+    }
+    return (l > 0);
+}
+
+// lines: fc,cn[,issue[,oem]]
+static int wiegand_encode_file(int idx, bool preamble, const char *infile, const char *outfile) {
+    FILE *in;
+    wiegand_batch_t b;
+    int res = wiegand_batch_open(&b, infile, outfile, &in);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    wiegand_batch_row(&b, "fc,cn,issue,oem,wiegand");
+    char line[256];
+    size_t lineno = 0, failed = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        if (wiegand_batch_line(line) == false) {
+            continue;
+        }
+        wiegand_card_t card;
+        memset(&card, 0, sizeof(wiegand_card_t));
+        uint64_t cn = 0;
+        if (sscanf(line, "%u%*[ ,;\t]%" SCNu64 "%*[ ,;\t]%u%*[ ,;\t]%u", &card.FacilityCode, &cn, &card.IssueLevel, &card.OEM) < 2) {
+            PrintAndLogEx(WARNING, "line %zu: expected fc,cn", lineno);
+            failed++;
+            continue;
+        }
+        card.CardNumber = cn;
+
+        wiegand_message_t packed;
+        char hex[40] = {0};
+        if (HIDPack(idx, &card, &packed, preamble)) {
+            wiegand_hex(&packed, hex, sizeof(hex));
+        } else {
+            failed++;
+        }
+        char row[128];
+        snprintf(row, sizeof(row), "%u,%" PRIu64 ",%u,%u,%s", card.FacilityCode, card.CardNumber, card.IssueLevel, card.OEM, hex);
+        wiegand_batch_row(&b, row);
+    }
+
+    wiegand_batch_close(&b, in, outfile);
+    if (failed) {
+        PrintAndLogEx(WARNING, _YELLOW_("%zu") " lines could not be encoded", failed);
+    }
+    return PM3_SUCCESS;
+}
+
+// lines: raw hex, or a binary string ( only 0/1 and at least 20 chars )
+static int wiegand_decode_file(const char *infile, const char *outfile) {
+    FILE *in;
+    wiegand_batch_t b;
+    int res = wiegand_batch_open(&b, infile, outfile, &in);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+
+    cardformat_t none = HIDGetCardFormat(-1);
+    int maxfmt = 0;
+    while (HIDGetCardFormat(maxfmt).Name) {
+        maxfmt++;
+    }
+    int *idx = calloc(maxfmt, sizeof(int));
+    wiegand_card_t *cards = calloc(maxfmt, sizeof(wiegand_card_t));
+    if ((idx == NULL) || (cards == NULL)) {
+        free(idx);
+        free(cards);
+        wiegand_batch_close(&b, in, outfile);
+        return PM3_EMALLOC;
+    }
+
+    wiegand_batch_row(&b, "raw,format,fc,cn,issue,oem,parity");
+    char line[256];
+    size_t lineno = 0, unknown = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        if (wiegand_batch_line(line) == false) {
+            continue;
+        }
+
+        size_t l = strlen(line);
+        bool is_bin = (l >= 20) && (strspn(line, "01") == l);
+        uint32_t top = 0, mid = 0, bot = 0;
+        int blen = 0;
+        if (is_bin) {
+            if (l > 96) {
+                PrintAndLogEx(WARNING, "line %zu: too long", lineno);
+                continue;
+            }
+            uint8_t bits[96];
+            for (size_t i = 0; i < l; i++) {
+                bits[i] = line[i] - '0';
+            }
+            blen = l;
+            binarray_to_u96(&top, &mid, &bot, bits, blen);
+        } else if (hexstring_to_u96(&top, &mid, &bot, line) != (int)l) {
+            PrintAndLogEx(WARNING, "line %zu: not hex", lineno);
+            continue;
+        }
+
+        wiegand_message_t packed = initialize_message_object(top, mid, bot, blen);
+        int n = HIDUnpackMatches(&packed, idx, cards, maxfmt);
+        if (n == 0) {
+            unknown++;
+            char row[128];
+            snprintf(row, sizeof(row), "%s,%s,,,,,", line, none.Name ? none.Name : "");
+            wiegand_batch_row(&b, row);
+            continue;
+        }
+        for (int i = 0; i < n; i++) {
+            cardformat_t fmt = HIDGetCardFormat(idx[i]);
+            char row[256];
+            snprintf(row, sizeof(row), "%s,%s,%u,%" PRIu64 ",%u,%u,%s",
+                     line, fmt.Name, cards[i].FacilityCode, cards[i].CardNumber,
+                     cards[i].IssueLevel, cards[i].OEM,
+                     fmt.Fields.hasParity ? (cards[i].ParityValid ? "ok" : "fail") : ""
+                    );
+            wiegand_batch_row(&b, row);
+        }
+    }
+
+    free(idx);
+    free(cards);
+    wiegand_batch_close(&b, in, outfile);
+    if (unknown) {
+        PrintAndLogEx(INFO, _YELLOW_("%zu") " credentials without a matching format", unknown);
+    }
+    return PM3_SUCCESS;
+}
+
 int CmdWiegandEncode(const char *Cmd) {
 
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "wiegand encode",
                   "Encode wiegand formatted number to raw hex",
                   "wiegand encode --fc 101 --cn 1337               ->  show all formats\n"
-                  "wiegand encode -w H10301 --fc 101 --cn 1337     ->  H10301 format "
+                  "wiegand encode -w H10301 --fc 101 --cn 1337     ->  H10301 format\n"
+                  "wiegand encode -w H10301 -f cards.csv -o out.csv ->  H10301 format, one fc,cn[,issue[,oem]] per line"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_u64_0(NULL, "fc", "<dec>", "facility number"),
-        arg_u64_1(NULL, "cn", "<dec>", "card number"),
+        arg_u64_0(NULL, "cn", "<dec>", "card number"),
         arg_u64_0(NULL, "issue", "<dec>", "issue level"),
         arg_u64_0(NULL, "oem", "<dec>", "OEM code"),
         arg_str0("w", "wiegand", "<format>", "see `wiegand list` for available formats"),
         arg_lit0(NULL, "pre", "add HID ProxII preamble to wiegand output"),
+        arg_str0("f", "file", "<fn>", "batch, file with one fc,cn[,issue[,oem]] per line"),
+        arg_str0("o", "out", "<fn>", "batch, save CSV to file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool has_cn = arg_get_u64_def(ctx, 2, UINT64_MAX) != UINT64_MAX;
 
     wiegand_card_t data;
     memset(&data, 0, sizeof(wiegand_card_t));
@@ -85,6 +285,13 @@ int CmdWiegandEncode(const char *Cmd) {
     char format[16] = {0};
     CLIParamStrToBuf(arg_get_str(ctx, 5), (uint8_t *)format, sizeof(format), &len);
     bool preamble = arg_get_lit(ctx, 6);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 7), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int olen = 0;
+    char outname[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 8), (uint8_t *)outname, FILE_PATH_SIZE, &olen);
     CLIParserFree(ctx);
 
     int idx = -1;
@@ -96,6 +303,19 @@ int CmdWiegandEncode(const char *Cmd) {
         }
     }
 
+    if (fnlen) {
+        if (idx == -1) {
+            PrintAndLogEx(ERR, "Batch encoding needs a format, see `wiegand list`");
+            return PM3_EINVARG;
+        }
+        return wiegand_encode_file(idx, preamble, filename, outname);
+    }
+
+    if (has_cn == false) {
+        PrintAndLogEx(ERR, "Missing card number");
+        return PM3_EINVARG;
+    }
+
     if (idx != -1) {
         wiegand_message_t packed;
         memset(&packed, 0, sizeof(wiegand_message_t));
@@ -116,13 +336,16 @@ int CmdWiegandDecode(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "wiegand decode",
                   "Decode raw hex or binary to wiegand format",
-                  "wiegand decode --raw 2006f623ae"
+                  "wiegand decode --raw 2006f623ae\n"
+                  "wiegand decode -f creds.txt -o out.csv    -> one raw hex or binary string per line"
                  );
 
     void *argtable[] = {
         arg_param_begin,
         arg_str0("r", "raw", "<hex>", "raw hex to be decoded"),
         arg_str0("b", "bin", "<bin>", "binary string to be decoded"),
+        arg_str0("f", "file", "<fn>", "batch, file with one raw hex or binary string per line"),
+        arg_str0("o", "out", "<fn>", "batch, save CSV to file"),
         arg_param_end
     };
     CLIExecWithReturn(ctx, Cmd, argtable, true);
@@ -133,8 +356,19 @@ int CmdWiegandDecode(const char *Cmd) {
     int blen = 0;
     uint8_t binarr[100] = {0x00};
     int res = CLIParamBinToBuf(arg_get_str(ctx, 2), binarr, sizeof(binarr), &blen);
+
+    int fnlen = 0;
+    char filename[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 3), (uint8_t *)filename, FILE_PATH_SIZE, &fnlen);
+    int olen = 0;
+    char outname[FILE_PATH_SIZE] = {0};
+    CLIParamStrToBuf(arg_get_str(ctx, 4), (uint8_t *)outname, FILE_PATH_SIZE, &olen);
     CLIParserFree(ctx);
 
+    if (fnlen) {
+        return wiegand_decode_file(filename, outname);
+    }
+
     if (res) {
         PrintAndLogEx(FAILED, "Error parsing binary string");
         return PM3_EINVARG;
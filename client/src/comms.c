@@ -19,9 +19,11 @@
 #include "comms.h"
 
 #include <inttypes.h>
+#include <stddef.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <lz4.h>
 
 #include "uart/uart.h"
 #include "ui.h"
@@ -50,17 +52,30 @@ static bool comm_raw_mode = false;
 static uint8_t *comm_raw_data = NULL;
 static size_t comm_raw_len = 0;
 static size_t comm_raw_pos = 0;
+// leave raw mode as soon as the raw buffer is full, used by bulk downloads
+static bool comm_raw_autostop = false;
+// comm thread leaves the port open when stopped, see ParkProxmark()
+static bool comm_park = false;
 
 // Transmit buffer.
 static PacketCommandOLD txBuffer;
-static PacketCommandNGRaw txBufferNG;
+// NG frames waiting to be written. On TCP links, frames queued while the comm thread
+// is busy are coalesced and go out in a single write.
+static uint8_t txBufferNG[CMD_PIPELINE_DEPTH * sizeof(PacketCommandNGRaw)];
 static size_t txBufferNGLen;
+static uint16_t txBufferNGFrames;
+static uint16_t txBufferNGLastCmd;
 static bool txBuffer_pending = false;
+// last command handed to the comm thread, the one a reply is awaited for
+static uint16_t last_queued_cmd = 0;
 static pthread_mutex_t txBufferMutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t txBufferSig = PTHREAD_COND_INITIALIZER;
 
 // Used by PacketResponseReceived as a ring buffer for messages that are yet to be
 // processed by a command handler (WaitForResponse{,Timeout})
+// Single producer (uart_communication thread) / single consumer (main thread),
+// cmd_head is only written by the producer and cmd_tail only by the consumer,
+// so the indexes are shared with atomics instead of a mutex.
 static PacketResponseNG rxBuffer[CMD_BUFFER_SIZE];
 
 // Points to the next empty position to write to
@@ -69,8 +84,27 @@ static int cmd_head = 0;
 // Points to the position of the last unread command
 static int cmd_tail = 0;
 
-// to lock rxBuffer operations from different threads
-static pthread_mutex_t rxBufferMutex = PTHREAD_MUTEX_INITIALIZER;
+// In-flight NG commands sent with SendCommandNGPipelined().
+// The device handles commands one after another, so the Nth reply of a given cmd
+// always belongs to the Nth submitted command with that cmd.
+typedef struct {
+    bool used;
+    bool received;
+    uint16_t cmd;
+    uint32_t tag;
+    PacketResponseNG resp;
+} pipeline_slot_t;
+
+static pipeline_slot_t pipeline[CMD_PIPELINE_DEPTH];
+static uint32_t pipeline_next_tag = 1;
+static pthread_mutex_t pipelineMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Transport statistics, see `hw commstats`
+static comms_stats_t comms_stats;
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+// time the last command left the client, used to measure round trips
+static uint64_t last_tx_us;
+static bool rtt_pending = false;
 
 // Global start time for WaitForResponseTimeout & dl_it, so we can reset timeout when we get packets
 // as sending lot of these packets can slow down things wuite a lot on slow links (e.g. hw status or lf read at 9600)
@@ -79,6 +113,8 @@ static uint64_t timeout_start_time;
 static uint64_t last_packet_time;
 
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd);
+static bool bulk_download_available(void);
+static bool dl_bulk(uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 
 // Simple alias to track usages linked to the Bootloader, these commands must not be migrated.
 // - commands sent to enter bootloader mode as we might have to talk to old firmwares
@@ -122,12 +158,15 @@ void SendCommandOLD(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
 
     txBuffer = c;
     txBuffer_pending = true;
+    __atomic_store_n(&last_queued_cmd, (uint16_t)cmd, __ATOMIC_SEQ_CST);
 
     // tell communication thread that a new command can be send
     pthread_cond_signal(&txBufferSig);
 
     pthread_mutex_unlock(&txBufferMutex);
 
+    uart_wakeup();
+
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
 
@@ -145,45 +184,59 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
         return;
     }
 
-    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)((uint8_t *)&txBufferNG + sizeof(PacketCommandNGPreamble) + len);
+    PacketCommandNGRaw frame;
+    PacketCommandNGPostamble *tx_post = (PacketCommandNGPostamble *)((uint8_t *)&frame + sizeof(PacketCommandNGPreamble) + len);
 
-    pthread_mutex_lock(&txBufferMutex);
-    /**
-    This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
-    but comm thread just spins here. Not good.../holiman
-    **/
-    while (txBuffer_pending) {
-        // wait for communication thread to complete sending a previous command
-        pthread_cond_wait(&txBufferSig, &txBufferMutex);
-    }
-
-    txBufferNG.pre.magic = COMMANDNG_PREAMBLE_MAGIC;
-    txBufferNG.pre.ng = ng;
-    txBufferNG.pre.length = len;
-    txBufferNG.pre.cmd = cmd;
+    frame.pre.magic = COMMANDNG_PREAMBLE_MAGIC;
+    frame.pre.ng = ng;
+    frame.pre.length = len;
+    frame.pre.cmd = cmd;
     if (len > 0 && data)
-        memcpy(&txBufferNG.data, data, len);
+        memcpy(&frame.data, data, len);
 
     if ((g_conn.send_via_fpc_usart && g_conn.send_with_crc_on_fpc) || ((!g_conn.send_via_fpc_usart) && g_conn.send_with_crc_on_usb)) {
         uint8_t first = 0, second = 0;
-        compute_crc(CRC_14443_A, (uint8_t *)&txBufferNG, sizeof(PacketCommandNGPreamble) + len, &first, &second);
+        compute_crc(CRC_14443_A, (uint8_t *)&frame, sizeof(PacketCommandNGPreamble) + len, &first, &second);
         tx_post->crc = (first << 8) + second;
     } else {
         tx_post->crc = COMMANDNG_POSTAMBLE_MAGIC;
     }
 
-    txBufferNGLen = sizeof(PacketCommandNGPreamble) + len + sizeof(PacketCommandNGPostamble);
+    size_t frame_len = sizeof(PacketCommandNGPreamble) + len + sizeof(PacketCommandNGPostamble);
 
 #ifdef COMMS_DEBUG_RAW
-    print_hex_break((uint8_t *)&txBufferNG.pre, sizeof(PacketCommandNGPreamble), 32);
+    print_hex_break((uint8_t *)&frame.pre, sizeof(PacketCommandNGPreamble), 32);
     if (ng) {
-        print_hex_break((uint8_t *)&txBufferNG.data, len, 32);
+        print_hex_break((uint8_t *)&frame.data, len, 32);
     } else {
-        print_hex_break((uint8_t *)&txBufferNG.data, 3 * sizeof(uint64_t), 32);
-        print_hex_break((uint8_t *)&txBufferNG.data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
+        print_hex_break((uint8_t *)&frame.data, 3 * sizeof(uint64_t), 32);
+        print_hex_break((uint8_t *)&frame.data + 3 * sizeof(uint64_t), len - 3 * sizeof(uint64_t), 32);
     }
     print_hex_break((uint8_t *)tx_post, sizeof(PacketCommandNGPostamble), 32);
 #endif
+
+    bool coalesce = (g_conn.send_via_ip == PM3_TCPv4) || (g_conn.send_via_ip == PM3_TCPv6);
+
+    pthread_mutex_lock(&txBufferMutex);
+    /**
+    This causes hangups at times, when the pm3 unit is unresponsive or disconnected. The main console thread is alive,
+    but comm thread just spins here. Not good.../holiman
+    **/
+    while (txBuffer_pending) {
+        // append to the NG frames not sent yet, if there is room
+        if (coalesce && txBufferNGLen && (txBufferNGLen + frame_len <= sizeof(txBufferNG))) {
+            break;
+        }
+        // wait for communication thread to complete sending a previous command
+        pthread_cond_wait(&txBufferSig, &txBufferMutex);
+    }
+
+    memcpy(txBufferNG + txBufferNGLen, &frame, frame_len);
+    txBufferNGLen += frame_len;
+    txBufferNGFrames++;
+    txBufferNGLastCmd = cmd;
+    __atomic_store_n(&last_queued_cmd, cmd, __ATOMIC_SEQ_CST);
+
     txBuffer_pending = true;
 
     // tell communication thread that a new command can be send
@@ -191,6 +244,8 @@ static void SendCommandNG_internal(uint16_t cmd, uint8_t *data, size_t len, bool
 
     pthread_mutex_unlock(&txBufferMutex);
 
+    uart_wakeup();
+
 //__atomic_test_and_set(&txcmd_pending, __ATOMIC_SEQ_CST);
 }
 
@@ -212,6 +267,293 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
 }
 
 
+// Reserve a pipeline slot waiting for a reply with cmd reply_cmd
+static int pipeline_register(uint16_t reply_cmd, uint32_t *tag) {
+
+    pthread_mutex_lock(&pipelineMutex);
+    pipeline_slot_t *slot = NULL;
+    for (uint8_t i = 0; i < CMD_PIPELINE_DEPTH; i++) {
+        if (pipeline[i].used == false) {
+            slot = &pipeline[i];
+            break;
+        }
+    }
+
+    if (slot == NULL) {
+        pthread_mutex_unlock(&pipelineMutex);
+        return PM3_EOVFLOW;
+    }
+
+    // register before sending, the reply can be faster than us
+    slot->used = true;
+    slot->received = false;
+    slot->cmd = reply_cmd;
+    slot->tag = pipeline_next_tag++;
+    if (pipeline_next_tag == 0) {
+        pipeline_next_tag = 1;
+    }
+
+    if (tag) {
+        *tag = slot->tag;
+    }
+    pthread_mutex_unlock(&pipelineMutex);
+    return PM3_SUCCESS;
+}
+
+/**
+ * @brief Send a NG command without waiting for the previous ones to be answered.
+ *  The reply (same cmd) is kept aside from the rxBuffer ring and collected with
+ *  WaitForPipelinedResponseTimeout(), in any order.
+ * @param tag is set to the sequence tag identifying this command
+ * @return PM3_SUCCESS, or PM3_EOVFLOW if CMD_PIPELINE_DEPTH commands are already in flight
+ */
+int SendCommandNGPipelined(uint16_t cmd, uint8_t *data, size_t len, uint32_t *tag) {
+    int res = pipeline_register(cmd, tag);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    SendCommandNG(cmd, data, len);
+    return PM3_SUCCESS;
+}
+
+/**
+ * @brief Same as SendCommandNGPipelined() for MIX commands, which usually answer with another cmd (CMD_ACK)
+ * @param reply_cmd the cmd of the single reply frame this command produces
+ */
+int SendCommandMIXPipelined(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len, uint16_t reply_cmd, uint32_t *tag) {
+    int res = pipeline_register(reply_cmd, tag);
+    if (res != PM3_SUCCESS) {
+        return res;
+    }
+    SendCommandMIX(cmd, arg0, arg1, arg2, data, len);
+    return PM3_SUCCESS;
+}
+
+/**
+ * @brief Drop all in-flight pipelined commands. Replies still on their way will end up in the rxBuffer ring.
+ */
+void clearCommandPipeline(void) {
+    pthread_mutex_lock(&pipelineMutex);
+    memset(pipeline, 0, sizeof(pipeline));
+    pthread_mutex_unlock(&pipelineMutex);
+}
+
+size_t GetCommandPipelineInflight(void) {
+    size_t n = 0;
+    pthread_mutex_lock(&pipelineMutex);
+    for (uint8_t i = 0; i < CMD_PIPELINE_DEPTH; i++) {
+        if (pipeline[i].used) {
+            n++;
+        }
+    }
+    pthread_mutex_unlock(&pipelineMutex);
+    return n;
+}
+
+// hand a reply to the oldest in-flight pipelined command waiting for this cmd
+static bool storePipelinedReply(const PacketResponseNG *packet) {
+
+    pthread_mutex_lock(&pipelineMutex);
+    pipeline_slot_t *slot = NULL;
+    for (uint8_t i = 0; i < CMD_PIPELINE_DEPTH; i++) {
+        pipeline_slot_t *p = &pipeline[i];
+        if (p->used == false || p->received || p->cmd != packet->cmd) {
+            continue;
+        }
+        // tags are monotonic, signed difference copes with wrap around
+        if (slot == NULL || (int32_t)(p->tag - slot->tag) < 0) {
+            slot = p;
+        }
+    }
+
+    if (slot) {
+        memcpy(&slot->resp, packet, sizeof(PacketResponseNG));
+        slot->received = true;
+    }
+    pthread_mutex_unlock(&pipelineMutex);
+    return (slot != NULL);
+}
+
+static void stats_add_tx(size_t frames, size_t bytes) {
+    pthread_mutex_lock(&statsMutex);
+    comms_stats.tx_frames += frames;
+    comms_stats.tx_bytes += bytes;
+    pthread_mutex_unlock(&statsMutex);
+    __atomic_store_n(&last_tx_us, usclock(), __ATOMIC_SEQ_CST);
+    __atomic_store_n(&rtt_pending, true, __ATOMIC_SEQ_CST);
+}
+
+static void stats_add_rx(size_t frames, size_t bytes, size_t errors) {
+    pthread_mutex_lock(&statsMutex);
+    comms_stats.rx_frames += frames;
+    comms_stats.rx_bytes += bytes;
+    comms_stats.rx_errors += errors;
+    pthread_mutex_unlock(&statsMutex);
+}
+
+// first awaited reply after a transmission closes the round trip
+static uint64_t stats_add_rtt(void) {
+    if (__atomic_exchange_n(&rtt_pending, false, __ATOMIC_SEQ_CST) == false) {
+        return 0;
+    }
+
+    uint64_t rtt = usclock() - __atomic_load_n(&last_tx_us, __ATOMIC_SEQ_CST);
+
+    uint8_t bucket = 0;
+    while ((bucket < COMMS_RTT_BUCKETS - 1) && ((rtt >> (bucket + 1)) != 0)) {
+        bucket++;
+    }
+
+    pthread_mutex_lock(&statsMutex);
+    if (comms_stats.rtt_count == 0 || rtt < comms_stats.rtt_min_us) {
+        comms_stats.rtt_min_us = rtt;
+    }
+    if (rtt > comms_stats.rtt_max_us) {
+        comms_stats.rtt_max_us = rtt;
+    }
+    comms_stats.rtt_count++;
+    comms_stats.rtt_sum_us += rtt;
+    comms_stats.rtt_hist[bucket]++;
+    pthread_mutex_unlock(&statsMutex);
+    return rtt;
+}
+
+static void stats_add_timeout(void) {
+    pthread_mutex_lock(&statsMutex);
+    comms_stats.timeouts++;
+    pthread_mutex_unlock(&statsMutex);
+}
+
+void GetCommsStats(comms_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&statsMutex);
+    memcpy(stats, &comms_stats, sizeof(comms_stats_t));
+    pthread_mutex_unlock(&statsMutex);
+}
+
+void ResetCommsStats(void) {
+    pthread_mutex_lock(&statsMutex);
+    memset(&comms_stats, 0, sizeof(comms_stats_t));
+    comms_stats.start_us = usclock();
+    pthread_mutex_unlock(&statsMutex);
+    __atomic_store_n(&rtt_pending, false, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Approximate round trip percentile from the log2 histogram
+ * @return upper bound of the bucket holding the percentile, in us, clamped to the max seen
+ */
+uint64_t GetCommsStatsPercentile(const comms_stats_t *stats, uint8_t percent) {
+    if (stats == NULL || stats->rtt_count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (stats->rtt_count * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (uint8_t i = 0; i < COMMS_RTT_BUCKETS; i++) {
+        seen += stats->rtt_hist[i];
+        if (seen >= target) {
+            uint64_t upper = (2ULL << i) - 1;
+            return MIN(upper, stats->rtt_max_us);
+        }
+    }
+    return stats->rtt_max_us;
+}
+
+// Learned per command latency, smoothed like TCP retransmit timers (RFC 6298).
+// Only touched from the thread waiting for replies.
+static cmd_latency_t cmd_latency[CMD_LATENCY_SLOTS];
+static bool adaptive_timeouts = false;
+
+static cmd_latency_t *latency_slot(uint16_t cmd, uint16_t reply_cmd) {
+    return &cmd_latency[(cmd ^ (reply_cmd << 3)) % CMD_LATENCY_SLOTS];
+}
+
+static void latency_add(uint16_t cmd, uint16_t reply_cmd, uint64_t rtt_us) {
+    if (rtt_us == 0 || rtt_us > UINT32_MAX) {
+        return;
+    }
+
+    cmd_latency_t *l = latency_slot(cmd, reply_cmd);
+    if (l->samples == 0 || l->cmd != cmd || l->reply_cmd != reply_cmd) {
+        l->cmd = cmd;
+        l->reply_cmd = reply_cmd;
+        l->samples = 1;
+        l->srtt_us = rtt_us;
+        l->rttvar_us = rtt_us / 2;
+        l->max_us = rtt_us;
+        return;
+    }
+
+    uint32_t rtt = (uint32_t)rtt_us;
+    uint32_t err = (rtt > l->srtt_us) ? rtt - l->srtt_us : l->srtt_us - rtt;
+    l->rttvar_us = l->rttvar_us - (l->rttvar_us >> 2) + (err >> 2);
+    l->srtt_us = l->srtt_us - (l->srtt_us >> 3) + (rtt >> 3);
+    if (rtt > l->max_us) {
+        l->max_us = rtt;
+    }
+    if (l->samples < UINT32_MAX) {
+        l->samples++;
+    }
+}
+
+/**
+ * @brief Deadline for a reply, from the caller timeout and what this command took so far.
+ *  A learned deadline longer than the caller's is always used, so slow links (BT, remote TCP) don't fail.
+ *  A shorter one is only used when adaptive timeouts are enabled, so lost frames are detected early.
+ * @return timeout in ms
+ */
+size_t GetAdaptiveTimeout(uint16_t cmd, uint16_t reply_cmd, size_t ms_timeout) {
+    if (ms_timeout == (size_t) - 1) {
+        return ms_timeout;
+    }
+
+    const cmd_latency_t *l = latency_slot(cmd, reply_cmd);
+    if (l->samples < ADAPTIVE_TIMEOUT_MIN_SAMPLES || l->cmd != cmd || l->reply_cmd != reply_cmd) {
+        return ms_timeout;
+    }
+
+    uint64_t learned_us = MAX(4 * ((uint64_t)l->srtt_us + 4 * (uint64_t)l->rttvar_us), 2 * (uint64_t)l->max_us);
+    size_t learned = MAX((size_t)(learned_us / 1000), ADAPTIVE_TIMEOUT_MIN_MS);
+
+    if (learned > ms_timeout || adaptive_timeouts) {
+        return learned;
+    }
+    return ms_timeout;
+}
+
+bool GetCommandLatency(uint16_t cmd, uint16_t reply_cmd, cmd_latency_t *latency) {
+    const cmd_latency_t *l = latency_slot(cmd, reply_cmd);
+    if (l->samples == 0 || l->cmd != cmd || l->reply_cmd != reply_cmd) {
+        return false;
+    }
+    if (latency) {
+        memcpy(latency, l, sizeof(cmd_latency_t));
+    }
+    return true;
+}
+
+const cmd_latency_t *GetCommandLatencyTable(size_t *count) {
+    if (count) {
+        *count = CMD_LATENCY_SLOTS;
+    }
+    return cmd_latency;
+}
+
+void ResetCommandLatency(void) {
+    memset(cmd_latency, 0, sizeof(cmd_latency));
+}
+
+void SetAdaptiveTimeouts(bool enable) {
+    adaptive_timeouts = enable;
+}
+
+bool GetAdaptiveTimeouts(void) {
+    return adaptive_timeouts;
+}
+
 /**
  * @brief This method should be called when sending a new command to the pm3. In case any old
  *  responses from previous commands are stored in the buffer, a call to this method should clear them.
@@ -220,29 +562,35 @@ void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, c
  */
 void clearCommandBuffer(void) {
     //This is a very simple operation
-    pthread_mutex_lock(&rxBufferMutex);
-    cmd_tail = cmd_head;
-    pthread_mutex_unlock(&rxBufferMutex);
+    int head = __atomic_load_n(&cmd_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&cmd_tail, head, __ATOMIC_RELEASE);
 }
+
+// Only copy the header and the used part of the payload,
+// most replies are a few bytes long and don't need the full PM3_CMD_DATA_SIZE moved around.
+static void copyReply(PacketResponseNG *dst, const PacketResponseNG *src) {
+    memcpy(dst, src, offsetof(PacketResponseNG, data) + MIN(src->length, PM3_CMD_DATA_SIZE));
+    dst->ng = src->ng;
+}
+
 /**
  * @brief storeCommand stores a USB command in a circular buffer
  * @param UC
  */
 static void storeReply(const PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
-    if ((cmd_head + 1) % CMD_BUFFER_SIZE == cmd_tail) {
+    int head = __atomic_load_n(&cmd_head, __ATOMIC_RELAXED);
+    int next = (head + 1) % CMD_BUFFER_SIZE;
+    if (next == __atomic_load_n(&cmd_tail, __ATOMIC_ACQUIRE)) {
         //If these two are equal, we're about to overwrite in the
         // circular buffer.
         PrintAndLogEx(FAILED, "WARNING: Command buffer about to overwrite command! This needs to be fixed!");
         fflush(stdout);
     }
     //Store the command at the 'head' location
-    PacketResponseNG *destination = &rxBuffer[cmd_head];
-    memcpy(destination, packet, sizeof(PacketResponseNG));
+    copyReply(&rxBuffer[head], packet);
 
-    //increment head and wrap
-    cmd_head = (cmd_head + 1) % CMD_BUFFER_SIZE;
-    pthread_mutex_unlock(&rxBufferMutex);
+    //increment head and wrap, publishes the slot to the consumer
+    __atomic_store_n(&cmd_head, next, __ATOMIC_RELEASE);
 }
 /**
  * @brief getCommand gets a command from an internal circular buffer.
@@ -250,20 +598,17 @@ static void storeReply(const PacketResponseNG *packet) {
  * @return 1 if response was returned, 0 if nothing has been received
  */
 static int getReply(PacketResponseNG *packet) {
-    pthread_mutex_lock(&rxBufferMutex);
+    int tail = __atomic_load_n(&cmd_tail, __ATOMIC_RELAXED);
     //If head == tail, there's nothing to read, or if we just got initialized
-    if (cmd_head == cmd_tail)  {
-        pthread_mutex_unlock(&rxBufferMutex);
+    if (__atomic_load_n(&cmd_head, __ATOMIC_ACQUIRE) == tail)  {
         return 0;
     }
 
     //Pick out the next unread command
-    memcpy(packet, &rxBuffer[cmd_tail], sizeof(PacketResponseNG));
+    copyReply(packet, &rxBuffer[tail]);
 
     //Increment tail - this is a circular buffer, so modulo buffer size
-    cmd_tail = (cmd_tail + 1) % CMD_BUFFER_SIZE;
-
-    pthread_mutex_unlock(&rxBufferMutex);
+    __atomic_store_n(&cmd_tail, (tail + 1) % CMD_BUFFER_SIZE, __ATOMIC_RELEASE);
     return 1;
 }
 
@@ -279,6 +624,14 @@ static void PacketResponseReceived(PacketResponseNG *packet) {
     __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
     __atomic_store_n(&last_packet_time, clk, __ATOMIC_SEQ_CST);
     (void) prev_clk;
+
+    if (packet->ng) {
+        stats_add_rx(1, sizeof(PacketResponseNGPreamble) + packet->length + sizeof(PacketResponseNGPostamble), 0);
+    } else if (packet->magic == RESPONSENG_PREAMBLE_MAGIC) {
+        stats_add_rx(1, sizeof(PacketResponseNGPreamble) + (3 * sizeof(uint64_t)) + packet->length + sizeof(PacketResponseNGPostamble), 0);
+    } else {
+        stats_add_rx(1, sizeof(PacketResponseOLD), 0);
+    }
 //    PrintAndLogEx(NORMAL, "[%07"PRIu64"] RECV %s magic %08x length %04x status %04x crc %04x cmd %04x",
 //                clk - prev_clk, packet->ng ? "NG" : "OLD", packet->magic, packet->length, packet->status, packet->crc, packet->cmd);
 
@@ -340,7 +693,9 @@ static void PacketResponseReceived(PacketResponseNG *packet) {
         // CMD_DOWNLOAD_BIGBUF packages which is not dealt with. I wonder if simply ignoring them will
         // work. lets try it.
         default: {
-            storeReply(packet);
+            if (storePipelinedReply(packet) == false) {
+                storeReply(packet);
+            }
             break;
         }
     }
@@ -450,6 +805,12 @@ __attribute__((force_align_arg_pointer))
                     uint64_t clk = msclock();
                     __atomic_store_n(&timeout_start_time,  clk, __ATOMIC_SEQ_CST);
                     __atomic_store_n(&comm_raw_pos, bufferPos + rxlen, __ATOMIC_SEQ_CST);
+                    stats_add_rx(0, rxlen, 0);
+                    // bulk download,  the closing frame follows the raw block right away
+                    if ((bufferPos + rxlen >= bufferLen) && __atomic_load_n(&comm_raw_autostop, __ATOMIC_SEQ_CST)) {
+                        __atomic_store_n(&comm_raw_autostop, false, __ATOMIC_SEQ_CST);
+                        __atomic_store_n(&comm_raw_mode, false, __ATOMIC_SEQ_CST);
+                    }
                 } else if (res != PM3_ENODATA) {
                     PrintAndLogEx(WARNING, "Error when reading raw data: %zu/%zu, %d", bufferPos, bufferLen, res);
                     error = true;
@@ -471,7 +832,12 @@ __attribute__((force_align_arg_pointer))
                 // comm_raw_data == NULL is used in SetCommunicationReceiveMode()
                 __atomic_store_n(&comm_raw_data, NULL, __ATOMIC_SEQ_CST);
             }
-            res = uart_receive(sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
+            // wait for a frame start, a queued command wakes us up so it doesn't sit out the rx timeout
+            rxlen = 0;
+            res = uart_wait_rx(sp);
+            if (res == PM3_SUCCESS) {
+                res = uart_receive(sp, (uint8_t *)&rx_raw.pre, sizeof(PacketResponseNGPreamble), &rxlen);
+            }
 
             if ((res == PM3_SUCCESS) && (rxlen == sizeof(PacketResponseNGPreamble))) {
                 rx.magic = rx_raw.pre.magic;
@@ -604,6 +970,9 @@ __attribute__((force_align_arg_pointer))
 
         is_receiving_raw_last = is_receiving_raw;
         // TODO if error, shall we resync ?
+        if (error) {
+            stats_add_rx(0, 0, 1);
+        }
 
         pthread_mutex_lock(&txBufferMutex);
 
@@ -622,18 +991,21 @@ __attribute__((force_align_arg_pointer))
 
         if (txBuffer_pending) {
 
-            if (txBufferNGLen) { // NG packet
-                res = uart_send(sp, (uint8_t *) &txBufferNG, txBufferNGLen);
+            if (txBufferNGLen) { // NG packet(s)
+                res = uart_send(sp, txBufferNG, txBufferNGLen);
                 if (res == PM3_EIO) {
                     commfailed = true;
                 }
-                g_conn.last_command = txBufferNG.pre.cmd;
+                stats_add_tx(txBufferNGFrames, txBufferNGLen);
+                g_conn.last_command = txBufferNGLastCmd;
                 txBufferNGLen = 0;
+                txBufferNGFrames = 0;
             } else {
                 res = uart_send(sp, (uint8_t *) &txBuffer, sizeof(PacketCommandOLD));
                 if (res == PM3_EIO) {
                     commfailed = true;
                 }
+                stats_add_tx(1, sizeof(PacketCommandOLD));
                 g_conn.last_command = txBuffer.cmd;
             }
 
@@ -649,8 +1021,11 @@ __attribute__((force_align_arg_pointer))
     }
 
     // when thread dies, we close the serial port.
-    uart_close(sp);
-    sp = NULL;
+    // A parked device keeps it, its pending replies wait in the OS buffers.
+    if (__atomic_load_n(&comm_park, __ATOMIC_SEQ_CST) == false) {
+        uart_close(sp);
+        sp = NULL;
+    }
 
 #if defined(__MACH__) && defined(__APPLE__)
     enableAppNap();
@@ -706,6 +1081,169 @@ size_t GetCommunicationRawReceiveNum(void) {
     return __atomic_load_n(&comm_raw_pos, __ATOMIC_SEQ_CST);
 }
 
+// Several devices can be open at once. Only one of them is active and uses the
+// globals above (g_conn, g_pm3_capabilities, reply ring, ...), the others are parked:
+// their port stays open but no comm thread runs for them.
+typedef struct {
+    pm3_device_t *dev;      // NULL = free slot
+    bool parked;
+    serial_port sp;
+    communication_arg_t conn;
+    capabilities_t capabilities;
+    comms_stats_t stats;
+    cmd_latency_t latency[CMD_LATENCY_SLOTS];
+    uint32_t uart_timeout;
+} device_slot_t;
+
+static device_slot_t device_slots[PM3_MAX_DEVICES];
+
+static device_slot_t *device_slot(const pm3_device_t *dev) {
+    if (dev == NULL || dev->id < 0 || dev->id >= PM3_MAX_DEVICES) {
+        return NULL;
+    }
+    if (device_slots[dev->id].dev != dev) {
+        return NULL;
+    }
+    return &device_slots[dev->id];
+}
+
+static void register_device(pm3_device_t *dev) {
+    if (device_slot(dev)) {
+        return;
+    }
+    dev->id = -1;
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        if (device_slots[i].dev == NULL) {
+            memset(&device_slots[i], 0, sizeof(device_slot_t));
+            device_slots[i].dev = dev;
+            dev->id = i;
+            return;
+        }
+    }
+    PrintAndLogEx(WARNING, "Too many open devices, this one can't be parked");
+}
+
+/**
+ * @brief Stops the comm thread of the active device but keeps its port open,
+ * so another device can be opened or selected. Replies not read yet are dropped.
+ * @return PM3_SUCCESS, PM3_ENOTTY when no device is active, PM3_EOVFLOW when it has no slot
+ */
+int ParkProxmark(void) {
+    pm3_device_t *dev = g_session.current_device;
+    device_slot_t *slot = device_slot(dev);
+
+    if (g_session.pm3_present == false || dev == NULL) {
+        return PM3_ENOTTY;
+    }
+
+    if (slot == NULL) {
+        return PM3_EOVFLOW;
+    }
+
+    if (IsCommunicationThreadDead()) {
+        CloseProxmark(dev);
+        return PM3_ENOTTY;
+    }
+
+    // let the comm thread finish sending what is queued
+    pthread_mutex_lock(&txBufferMutex);
+    while (txBuffer_pending && IsCommunicationThreadDead() == false) {
+        pthread_mutex_unlock(&txBufferMutex);
+        msleep(1);
+        pthread_mutex_lock(&txBufferMutex);
+    }
+    pthread_mutex_unlock(&txBufferMutex);
+
+    __atomic_store_n(&comm_park, true, __ATOMIC_SEQ_CST);
+    g_conn.run = false;
+    pthread_join(communication_thread, NULL);
+    memset(&communication_thread, 0, sizeof(pthread_t));
+    __atomic_store_n(&comm_park, false, __ATOMIC_SEQ_CST);
+
+    if (sp == NULL) {
+        // comm thread died while stopping
+        memset(slot, 0, sizeof(device_slot_t));
+        dev->id = -1;
+        g_session.pm3_present = false;
+        return PM3_ENOTTY;
+    }
+
+    slot->sp = sp;
+    memcpy(&slot->conn, &g_conn, sizeof(communication_arg_t));
+    memcpy(&slot->capabilities, &g_pm3_capabilities, sizeof(capabilities_t));
+    GetCommsStats(&slot->stats);
+    memcpy(slot->latency, cmd_latency, sizeof(cmd_latency));
+    slot->uart_timeout = uart_get_timeouts();
+    slot->parked = true;
+    dev->g_conn = &slot->conn;
+
+    sp = NULL;
+    clearCommandPipeline();
+    clearCommandBuffer();
+    g_session.pm3_present = false;
+    return PM3_SUCCESS;
+}
+
+/**
+ * @brief Makes dev the active device, the current one is parked.
+ * @return PM3_SUCCESS, PM3_EINVARG if dev isn't an open device
+ */
+int SelectProxmark(pm3_device_t *dev) {
+    device_slot_t *slot = device_slot(dev);
+    if (slot == NULL) {
+        return PM3_EINVARG;
+    }
+
+    if (slot->parked == false) {
+        // already the active one
+        return (g_session.pm3_present && g_session.current_device == dev) ? PM3_SUCCESS : PM3_EINVARG;
+    }
+
+    if (g_session.pm3_present) {
+        ParkProxmark();
+    }
+
+    sp = slot->sp;
+    memcpy(&g_conn, &slot->conn, sizeof(communication_arg_t));
+    memcpy(&g_pm3_capabilities, &slot->capabilities, sizeof(capabilities_t));
+    pthread_mutex_lock(&statsMutex);
+    memcpy(&comms_stats, &slot->stats, sizeof(comms_stats_t));
+    pthread_mutex_unlock(&statsMutex);
+    memcpy(cmd_latency, slot->latency, sizeof(cmd_latency));
+    uart_reconfigure_timeouts(slot->uart_timeout);
+    slot->parked = false;
+    slot->sp = NULL;
+
+    dev->g_conn = &g_conn;
+    g_session.current_device = dev;
+
+    g_conn.run = true;
+    pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
+    __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
+    g_session.pm3_present = true;
+    return PM3_SUCCESS;
+}
+
+pm3_device_t *GetProxmarkDevice(int id) {
+    if (id < 0 || id >= PM3_MAX_DEVICES) {
+        return NULL;
+    }
+    return device_slots[id].dev;
+}
+
+bool IsProxmarkParked(const pm3_device_t *dev) {
+    const device_slot_t *slot = device_slot(dev);
+    return slot && slot->parked;
+}
+
+void CloseParkedProxmarks(void) {
+    for (int i = 0; i < PM3_MAX_DEVICES; i++) {
+        if (device_slots[i].dev && device_slots[i].parked) {
+            CloseProxmark(device_slots[i].dev);
+        }
+    }
+}
+
 bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
 
     sp = uart_open(port, speed, true);
@@ -732,6 +1270,8 @@ bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
         // "Session" flag, to tell via which interface next msgs should be sent: USB or FPC USART
         g_conn.send_via_fpc_usart = false;
 
+        ResetCommsStats();
+        ResetCommandLatency();
         pthread_create(&communication_thread, NULL, &uart_communication, &g_conn);
         __atomic_clear(&comm_thread_dead, __ATOMIC_SEQ_CST);
         __atomic_clear(&reconnect_ok, __ATOMIC_SEQ_CST);
@@ -743,6 +1283,7 @@ bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed) {
             *dev = calloc(sizeof(pm3_device_t), sizeof(uint8_t));
         }
         (*dev)->g_conn = &g_conn; // TODO g_conn shouldn't be global
+        register_device(*dev);
         return true;
     }
 }
@@ -801,6 +1342,7 @@ bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int
             *dev = calloc(sizeof(pm3_device_t), sizeof(uint8_t));
         }
         (*dev)->g_conn = &g_conn; // TODO g_conn shouldn't be global
+        register_device(*dev);
         return true;
     }
 }
@@ -884,6 +1426,19 @@ int TestProxmark(pm3_device_t *dev) {
 }
 
 void CloseProxmark(pm3_device_t *dev) {
+    device_slot_t *slot = device_slot(dev);
+    if (slot && slot->parked) {
+        uart_close(slot->sp);
+        memset(slot, 0, sizeof(device_slot_t));
+        dev->id = -1;
+        dev->g_conn = &g_conn;
+        return;
+    }
+    if (slot) {
+        memset(slot, 0, sizeof(device_slot_t));
+        dev->id = -1;
+    }
+
     dev->g_conn->run = false;
 
 #ifdef __BIONIC__
@@ -1033,6 +1588,9 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
     if (ms_timeout != (size_t) - 1)
         ms_timeout += communication_delay();
 
+    uint16_t sent_cmd = __atomic_load_n(&last_queued_cmd, __ATOMIC_SEQ_CST);
+    ms_timeout = GetAdaptiveTimeout(sent_cmd, cmd, ms_timeout);
+
     __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
 
     // Wait until the command is received
@@ -1045,6 +1603,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
 
         while (getReply(response)) {
             if (cmd == CMD_UNKNOWN || response->cmd == cmd) {
+                latency_add(sent_cmd, cmd, stats_add_rtt());
                 return true;
             }
 
@@ -1070,6 +1629,7 @@ bool WaitForResponseTimeoutW(uint32_t cmd, PacketResponseNG *response, size_t ms
         // just to avoid CPU busy loop:
         msleep(1);
     }
+    stats_add_timeout();
     return false;
 }
 
@@ -1077,10 +1637,183 @@ bool WaitForResponseTimeout(uint32_t cmd, PacketResponseNG *response, size_t ms_
     return WaitForResponseTimeoutW(cmd, response, ms_timeout, true);
 }
 
+/**
+ * @brief Waits for the reply of a command sent with SendCommandNGPipelined().
+ *  On timeout, all in-flight commands are dropped since the order of later replies can't be trusted anymore.
+ *
+ * @param tag sequence tag returned by SendCommandNGPipelined()
+ * @param response struct to copy received command into.
+ * @param ms_timeout timeout in milliseconds, restarted on each received packet
+ * @return true if command was returned, otherwise false
+ */
+bool WaitForPipelinedResponseTimeout(uint32_t tag, PacketResponseNG *response, size_t ms_timeout) {
+
+    // Add delay depending on the communication channel & speed
+    if (ms_timeout != (size_t) - 1)
+        ms_timeout += communication_delay();
+
+    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+
+    while (true) {
+
+        if (IsCommunicationThreadDead()) {
+            break;
+        }
+
+        pthread_mutex_lock(&pipelineMutex);
+        pipeline_slot_t *slot = NULL;
+        for (uint8_t i = 0; i < CMD_PIPELINE_DEPTH; i++) {
+            if (pipeline[i].used && pipeline[i].tag == tag) {
+                slot = &pipeline[i];
+                break;
+            }
+        }
+
+        if (slot == NULL) {
+            // unknown tag or dropped by clearCommandPipeline()
+            pthread_mutex_unlock(&pipelineMutex);
+            return false;
+        }
+
+        if (slot->received) {
+            if (response) {
+                memcpy(response, &slot->resp, sizeof(PacketResponseNG));
+            }
+            slot->used = false;
+            pthread_mutex_unlock(&pipelineMutex);
+            return true;
+        }
+        pthread_mutex_unlock(&pipelineMutex);
+
+        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        if ((ms_timeout != (size_t) - 1) && (msclock() - tmp_clk > ms_timeout)) {
+            break;
+        }
+
+        // just to avoid CPU busy loop:
+        msleep(1);
+    }
+
+    clearCommandPipeline();
+    return false;
+}
+
 bool WaitForResponse(uint32_t cmd, PacketResponseNG *response) {
     return WaitForResponseTimeoutW(cmd, response, -1, true);
 }
 
+/**
+ * @brief Runs a batch of raw commands, keeping up to CMD_PIPELINE_DEPTH of them in flight.
+ *  No CLI parsing nor output formatting, meant for scripts issuing many small exchanges.
+ *  Each request must produce exactly one reply frame with cmd (or reply_cmd when set).
+ *
+ * @param req concatenated batch_request_t records
+ * @param resp buffer receiving concatenated batch_response_t records, in request order
+ * @param resp_max size of resp
+ * @param resp_len number of bytes written to resp, also on error
+ * @param ms_timeout timeout in milliseconds for each reply
+ * @return number of answered requests, or a negative PM3_E* error
+ */
+int SendCommandBatch(const uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_max, size_t *resp_len, size_t ms_timeout) {
+
+    if (resp_len) {
+        *resp_len = 0;
+    }
+
+    if (req == NULL || resp == NULL) {
+        return PM3_EINVARG;
+    }
+
+    clearCommandBuffer();
+    clearCommandPipeline();
+
+    uint32_t tags[CMD_PIPELINE_DEPTH];
+    uint8_t head = 0, inflight = 0;
+    size_t rpos = 0, wpos = 0;
+    int done = 0;
+
+    while (true) {
+
+        // keep the pipeline full
+        while ((inflight < CMD_PIPELINE_DEPTH) && (rpos < req_len)) {
+
+            if (req_len - rpos < sizeof(batch_request_t)) {
+                return PM3_EINVARG;
+            }
+
+            batch_request_t hdr;
+            memcpy(&hdr, req + rpos, sizeof(hdr));
+            const uint8_t *data = req + rpos + sizeof(hdr);
+
+            if ((hdr.len > PM3_CMD_DATA_SIZE) || (req_len - rpos - sizeof(hdr) < hdr.len)) {
+                PrintAndLogEx(WARNING, "batch request %d, invalid length %u", done + inflight, hdr.len);
+                clearCommandPipeline();
+                return PM3_EINVARG;
+            }
+
+            uint16_t reply_cmd = (hdr.reply_cmd) ? hdr.reply_cmd : hdr.cmd;
+            uint32_t tag = 0;
+            int res;
+            if (hdr.flags & BATCH_FLAG_MIX) {
+                uint64_t arg[3];
+                if (hdr.len < sizeof(arg) || (hdr.len - sizeof(arg)) > PM3_CMD_DATA_SIZE_MIX) {
+                    PrintAndLogEx(WARNING, "batch request %d, invalid MIX length %u", done + inflight, hdr.len);
+                    clearCommandPipeline();
+                    return PM3_EINVARG;
+                }
+                memcpy(arg, data, sizeof(arg));
+                res = SendCommandMIXPipelined(hdr.cmd, arg[0], arg[1], arg[2], data + sizeof(arg), hdr.len - sizeof(arg), reply_cmd, &tag);
+            } else {
+                res = SendCommandNGPipelined(hdr.cmd, (uint8_t *)data, hdr.len, &tag);
+            }
+
+            if (res != PM3_SUCCESS) {
+                clearCommandPipeline();
+                return res;
+            }
+
+            tags[(head + inflight) % CMD_PIPELINE_DEPTH] = tag;
+            inflight++;
+            rpos += sizeof(hdr) + hdr.len;
+        }
+
+        if (inflight == 0) {
+            break;
+        }
+
+        // collect the oldest one
+        PacketResponseNG rx;
+        if (WaitForPipelinedResponseTimeout(tags[head], &rx, ms_timeout) == false) {
+            PrintAndLogEx(WARNING, "batch request %d, no response from the device", done);
+            return PM3_ETIMEOUT;
+        }
+        head = (head + 1) % CMD_PIPELINE_DEPTH;
+        inflight--;
+
+        batch_response_t rhdr = {
+            .cmd = rx.cmd,
+            .status = rx.status,
+            .ng = rx.ng,
+            .oldarg = {rx.oldarg[0], rx.oldarg[1], rx.oldarg[2]},
+            .len = MIN(rx.length, PM3_CMD_DATA_SIZE),
+        };
+
+        if (resp_max - wpos < sizeof(rhdr) + rhdr.len) {
+            clearCommandPipeline();
+            return PM3_EOVFLOW;
+        }
+
+        memcpy(resp + wpos, &rhdr, sizeof(rhdr));
+        memcpy(resp + wpos + sizeof(rhdr), rx.data.asBytes, rhdr.len);
+        wpos += sizeof(rhdr) + rhdr.len;
+        if (resp_len) {
+            *resp_len = wpos;
+        }
+        done++;
+    }
+    return done;
+}
+
 /**
 * Data transfer from Proxmark to client. This method times out after
 * ms_timeout milliseconds.
@@ -1125,11 +1858,20 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
 
     switch (memtype) {
         case BIG_BUF: {
+            if (bulk_download_available()) {
+                return dl_bulk(dest, bytes, start_index, response, ms_timeout, show_warning);
+            }
+            if (g_pm3_capabilities.compressed_download) {
+                // slow links, BT / FPC usart / TCP.  LF samples and sparse traces shrink a lot
+                SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, DOWNLOAD_BIGBUF_FLAG_LZ4, NULL, 0);
+                return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF);
+            }
             SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, 0, NULL, 0);
             return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_BIGBUF);
         }
         case BIG_BUF_EML: {
-            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, 0, NULL, 0);
+            uint32_t flags = (g_pm3_capabilities.eml_upload) ? DOWNLOAD_BIGBUF_FLAG_LZ4 : 0;
+            SendCommandMIX(CMD_DOWNLOAD_EML_BIGBUF, start_index, bytes, flags, NULL, 0);
             return dl_it(dest, bytes, response, ms_timeout, show_warning, CMD_DOWNLOADED_EML_BIGBUF);
         }
         case SPIFFS: {
@@ -1159,6 +1901,129 @@ bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint3
     return false;
 }
 
+// Bulk download needs a device which supports it and a plain USB-CDC link,
+// BT / FPC usart keeps using the framed chunks.
+static bool bulk_download_available(void) {
+    return g_pm3_capabilities.bulk_download &&
+           g_pm3_capabilities.via_usb &&
+           (g_conn.send_via_fpc_usart == false) &&
+           (g_conn.send_via_ip == PM3_NONE);
+}
+
+// Device streams the requested bytes as one raw block instead of 512 byte
+// CMD_DOWNLOADED_BIGBUF frames, followed by the usual closing CMD_ACK frame.
+// The comm thread is put in raw mode *before* the command is sent and leaves
+// it on its own as soon as the block is complete, so the ACK is parsed normally.
+/**
+* Data transfer from client to Proxmark3 emulator memory.
+* Each frame carries as much of the data as fits LZ4 compressed, or plain when it doesn't shrink,
+* and up to CMD_PIPELINE_DEPTH frames are in flight before the first answer is waited for.
+* @param src data to upload
+* @param bytes number of bytes to upload
+* @param start_index offset into emulator memory
+* @param fpga bitstream the emulator runs with, FPGA_BITSTREAM_HF / FPGA_BITSTREAM_HF_15 etc
+* @return PM3_SUCCESS, PM3_ENOTIMPL if the firmware lacks CMD_UPLOAD_EML_BIGBUF, or the device error
+*/
+int UploadEmlToDevice(const uint8_t *src, uint32_t bytes, uint32_t start_index, uint8_t fpga) {
+
+    if (g_pm3_capabilities.eml_upload == false) {
+        return PM3_ENOTIMPL;
+    }
+
+    uint8_t buf[PM3_CMD_DATA_SIZE];
+    upload_eml_t *payload = (upload_eml_t *)buf;
+    const int maxdata = sizeof(buf) - sizeof(upload_eml_t);
+
+    uint32_t tags[CMD_PIPELINE_DEPTH];
+    uint8_t head = 0, inflight = 0;
+    uint32_t pos = 0;
+    int res = PM3_SUCCESS;
+
+    clearCommandBuffer();
+
+    while (pos < bytes || inflight) {
+
+        if (pos < bytes && inflight < CMD_PIPELINE_DEPTH) {
+            int srclen = bytes - pos;
+            int clen = LZ4_compress_destSize((const char *)(src + pos), (char *)payload->data, &srclen, maxdata);
+            if (clen > 0 && srclen > clen) {
+                payload->flags = UPLOAD_EML_FLAG_LZ4;
+            } else {
+                srclen = MIN(bytes - pos, (uint32_t)maxdata);
+                clen = srclen;
+                memcpy(payload->data, src + pos, srclen);
+                payload->flags = 0;
+            }
+            payload->offset = start_index + pos;
+            payload->len = srclen;
+            payload->fpga = fpga;
+
+            res = SendCommandNGPipelined(CMD_UPLOAD_EML_BIGBUF, buf, sizeof(upload_eml_t) + clen, &tags[(head + inflight) % CMD_PIPELINE_DEPTH]);
+            if (res != PM3_SUCCESS) {
+                break;
+            }
+            inflight++;
+            pos += srclen;
+            continue;
+        }
+
+        PacketResponseNG resp;
+        if (WaitForPipelinedResponseTimeout(tags[head], &resp, 2000) == false) {
+            PrintAndLogEx(WARNING, "no response from the device when uploading to emulator memory");
+            res = PM3_ETIMEOUT;
+            break;
+        }
+        head = (head + 1) % CMD_PIPELINE_DEPTH;
+        inflight--;
+
+        if (resp.status != PM3_SUCCESS) {
+            PrintAndLogEx(WARNING, "uploading to emulator memory failed ( %d )", resp.status);
+            res = resp.status;
+            break;
+        }
+    }
+
+    if (res != PM3_SUCCESS) {
+        clearCommandPipeline();
+    }
+    return res;
+}
+
+static bool dl_bulk(uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning) {
+
+    SetCommunicationRawReceiveBuffer(dest, bytes);
+    __atomic_store_n(&comm_raw_autostop, true, __ATOMIC_SEQ_CST);
+    SetCommunicationReceiveMode(true);
+
+    SendCommandMIX(CMD_DOWNLOAD_BIGBUF, start_index, bytes, DOWNLOAD_BIGBUF_FLAG_BULK, NULL, 0);
+
+    __atomic_store_n(&timeout_start_time,  msclock(), __ATOMIC_SEQ_CST);
+
+    if (ms_timeout != (size_t) - 1)
+        ms_timeout += communication_delay();
+
+    while (__atomic_load_n(&comm_raw_mode, __ATOMIC_SEQ_CST)) {
+
+        uint64_t tmp_clk = __atomic_load_n(&timeout_start_time, __ATOMIC_SEQ_CST);
+        if (msclock() - tmp_clk > ms_timeout) {
+            __atomic_store_n(&comm_raw_autostop, false, __ATOMIC_SEQ_CST);
+            SetCommunicationReceiveMode(false);
+            PrintAndLogEx(FAILED, "Timed out while trying to download data from device ( %zu / %u bytes )", GetCommunicationRawReceiveNum(), bytes);
+            return false;
+        }
+
+        if (msclock() - tmp_clk > 3000 && show_warning) {
+            PrintAndLogEx(INFO, "Waiting for a response from the Proxmark3...");
+            PrintAndLogEx(INFO, "You can cancel this operation by pressing the pm3 button");
+            show_warning = false;
+        }
+        msleep(1);
+    }
+
+    // raw block done,  wait for the closing ACK
+    return WaitForResponseTimeout(CMD_ACK, response, ms_timeout);
+}
+
 static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, size_t ms_timeout, bool show_warning, uint32_t rec_cmd) {
 
     uint32_t bytes_completed = 0;
@@ -1202,6 +2067,26 @@ static bool dl_it(uint8_t *dest, uint32_t bytes, PacketResponseNG *response, siz
 
                 memcpy(dest + offset, response->data.asBytes, copy_bytes);
                 bytes_completed += copy_bytes;
+            } else if (response->cmd == CMD_DOWNLOADED_BIGBUF_LZ4 && (rec_cmd == CMD_DOWNLOADED_BIGBUF || rec_cmd == CMD_DOWNLOADED_EML_BIGBUF)) {
+
+                // arg0 = offset in transfer
+                // arg1 = compressed length
+                // arg2 = uncompressed length
+                uint32_t offset = response->oldarg[0];
+                uint32_t clen = MIN(response->oldarg[1], PM3_CMD_DATA_SIZE);
+                uint32_t plain_len = response->oldarg[2];
+
+                if ((offset > bytes) || (plain_len > bytes - offset)) {
+                    PrintAndLogEx(FAILED, "ERROR: Out of bounds when downloading from device,  offset %u | len %u | total len %u > buf_size %u", offset, plain_len,  offset + plain_len,  bytes);
+                    break;
+                }
+
+                int res = LZ4_decompress_safe((const char *)response->data.asBytes, (char *)(dest + offset), clen, plain_len);
+                if (res != (int)plain_len) {
+                    PrintAndLogEx(FAILED, "ERROR: LZ4 decompression failed when downloading from device,  offset %u | got %d of %u bytes", offset, res, plain_len);
+                    break;
+                }
+                bytes_completed += plain_len;
             } else if (response->cmd == CMD_WTX && response->length == sizeof(uint16_t)) {
                 uint16_t wtx = response->data.asDwords[0] & 0xFFFF;
                 PrintAndLogEx(DEBUG, "Got Waiting Time eXtension request %i ms", wtx);
@@ -45,6 +45,11 @@ extern "C" {
 #define CMD_BUFFER_SIZE 100
 #endif
 
+// Max number of NG commands in flight, see SendCommandNGPipelined()
+#ifndef CMD_PIPELINE_DEPTH
+#define CMD_PIPELINE_DEPTH 8
+#endif
+
 #define COMM_RAW_RECEIVE_LEN (1024)
 
 typedef enum {
@@ -58,6 +63,58 @@ typedef enum {
     MCU_MEM,
 } DeviceMemType_t;
 
+// Transport statistics, round trips are kept in log2 buckets of microseconds
+#define COMMS_RTT_BUCKETS 24
+
+typedef struct {
+    uint64_t start_us;
+    uint64_t tx_frames;
+    uint64_t tx_bytes;
+    uint64_t rx_frames;
+    uint64_t rx_bytes;
+    uint64_t rx_errors;
+    uint64_t timeouts;
+    uint64_t rtt_count;
+    uint64_t rtt_min_us;
+    uint64_t rtt_max_us;
+    uint64_t rtt_sum_us;
+    uint32_t rtt_hist[COMMS_RTT_BUCKETS];
+} comms_stats_t;
+
+// learned reply latency of a command, see GetAdaptiveTimeout()
+#define CMD_LATENCY_SLOTS               64
+#define ADAPTIVE_TIMEOUT_MIN_SAMPLES    8
+#define ADAPTIVE_TIMEOUT_MIN_MS         100
+
+typedef struct {
+    uint16_t cmd;
+    uint16_t reply_cmd;
+    uint32_t samples;
+    uint32_t srtt_us;       // smoothed round trip
+    uint32_t rttvar_us;     // smoothed deviation
+    uint32_t max_us;
+} cmd_latency_t;
+
+// SendCommandBatch() records, little endian, packed
+#define BATCH_FLAG_MIX  0x01    // data starts with the three 64b oldargs, sent as MIX frame
+
+typedef struct {
+    uint16_t cmd;
+    uint16_t reply_cmd;         // cmd of the reply frame, 0 = same as cmd
+    uint8_t flags;
+    uint16_t len;
+//    uint8_t data[len];
+} PACKED batch_request_t;
+
+typedef struct {
+    uint16_t cmd;
+    int16_t status;
+    uint8_t ng;
+    uint64_t oldarg[3];
+    uint16_t len;
+//    uint8_t data[len];
+} PACKED batch_response_t;
+
 typedef enum {
     PM3_TCPv4,
     PM3_TCPv6,
@@ -86,9 +143,13 @@ typedef struct {
 
 extern communication_arg_t g_conn;
 
+// devices which can be open at once, see ParkProxmark() / SelectProxmark()
+#define PM3_MAX_DEVICES 8
+
 typedef struct pm3_device {
     communication_arg_t *g_conn;
     int script_embedded;
+    int id;     // slot in the device table, -1 if none
 } pm3_device_t;
 
 
@@ -101,6 +162,23 @@ void SendCommandNG(uint16_t cmd, uint8_t *data, size_t len);
 void SendCommandMIX(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len);
 void clearCommandBuffer(void);
 
+int SendCommandNGPipelined(uint16_t cmd, uint8_t *data, size_t len, uint32_t *tag);
+int SendCommandMIXPipelined(uint64_t cmd, uint64_t arg0, uint64_t arg1, uint64_t arg2, const void *data, size_t len, uint16_t reply_cmd, uint32_t *tag);
+bool WaitForPipelinedResponseTimeout(uint32_t tag, PacketResponseNG *response, size_t ms_timeout);
+void clearCommandPipeline(void);
+size_t GetCommandPipelineInflight(void);
+void GetCommsStats(comms_stats_t *stats);
+void ResetCommsStats(void);
+uint64_t GetCommsStatsPercentile(const comms_stats_t *stats, uint8_t percent);
+
+size_t GetAdaptiveTimeout(uint16_t cmd, uint16_t reply_cmd, size_t ms_timeout);
+bool GetCommandLatency(uint16_t cmd, uint16_t reply_cmd, cmd_latency_t *latency);
+const cmd_latency_t *GetCommandLatencyTable(size_t *count);
+void ResetCommandLatency(void);
+void SetAdaptiveTimeouts(bool enable);
+bool GetAdaptiveTimeouts(void);
+int SendCommandBatch(const uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_max, size_t *resp_len, size_t ms_timeout);
+
 #define FLASHMODE_SPEED 460800
 
 bool IsReconnectedOk(void);
@@ -113,6 +191,11 @@ bool OpenProxmarkSilent(pm3_device_t **dev, const char *port, uint32_t speed);
 bool OpenProxmark(pm3_device_t **dev, const char *port, bool wait_for_port, int timeout, bool flash_mode, uint32_t speed);
 int TestProxmark(pm3_device_t *dev);
 void CloseProxmark(pm3_device_t *dev);
+int ParkProxmark(void);
+int SelectProxmark(pm3_device_t *dev);
+pm3_device_t *GetProxmarkDevice(int id);
+bool IsProxmarkParked(const pm3_device_t *dev);
+void CloseParkedProxmarks(void);
 void StartReconnectProxmark(void);
 
 size_t WaitForRawDataTimeout(uint8_t *buffer, size_t len, size_t ms_timeout, bool show_process);
@@ -122,6 +205,7 @@ bool WaitForResponse(uint32_t cmd, PacketResponseNG *response);
 
 //bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
 bool GetFromDevice(DeviceMemType_t memtype, uint8_t *dest, uint32_t bytes, uint32_t start_index, uint8_t *data, uint32_t datalen, PacketResponseNG *response, size_t ms_timeout, bool show_warning);
+int UploadEmlToDevice(const uint8_t *src, uint32_t bytes, uint32_t start_index, uint8_t fpga);
 
 #ifdef __cplusplus
 }
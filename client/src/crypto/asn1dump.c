@@ -285,32 +285,37 @@ cleanup:
     free(hex);
 }
 
+// `oids.json` is parsed on first use and kept for the session
+static json_t *asn1_known_oids = NULL;
+
 static char *asn1_oid_description(const char *oid, bool with_group_desc) {
-    json_error_t error;
-    json_t *root = NULL;
     static char res[300];
     memset(res, 0x00, sizeof(res));
 
-    char *path;
-    if (searchFile(&path, RESOURCES_SUBDIR, "oids", ".json", false) != PM3_SUCCESS) {
-        return NULL;
-    }
+    if (asn1_known_oids == NULL) {
+        char *path;
+        if (searchFile(&path, RESOURCES_SUBDIR, "oids", ".json", false) != PM3_SUCCESS) {
+            return NULL;
+        }
 
-    // load `oids.json`
-    root = json_load_file(path, 0, &error);
-    free(path);
+        json_error_t error;
+        json_t *root = json_load_file(path, 0, &error);
+        free(path);
 
-    if (!root || !json_is_object(root)) {
-        goto error;
+        if (!root || !json_is_object(root)) {
+            json_decref(root);
+            return NULL;
+        }
+        asn1_known_oids = root;
     }
 
-    json_t *elm = json_object_get(root, oid);
+    json_t *elm = json_object_get(asn1_known_oids, oid);
     if (!elm) {
-        goto error;
+        return NULL;
     }
 
     if (JsonLoadStr(elm, "$.d", res))
-        goto error;
+        return NULL;
 
     char strext[300] = {0};
     if (!JsonLoadStr(elm, "$.c", strext)) {
@@ -319,13 +324,7 @@ static char *asn1_oid_description(const char *oid, bool with_group_desc) {
         strcat(res, ")");
     }
 
-    json_decref(root);
     return res;
-
-error:
-    if (root)
-        json_decref(root);
-    return NULL;
 }
 
 static void asn1_tag_dump_object_id(const struct tlv *tlv, const struct asn1_tag *tag, int level) {
@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <pthread.h>
 #include <mbedtls/asn1.h>
 #include <mbedtls/des.h>
 #include <mbedtls/aes.h>
@@ -40,18 +41,148 @@
 #include "ui.h"
 #include "math.h"
 
+// Key schedule cache.
+// Secure messaging encrypts / MACs block after block under the same session keys, so
+// keep the last few expanded keys around instead of running setkey on every call.
+typedef enum {
+    KS_DES_ENC,
+    KS_DES_DEC,
+    KS_DES3_2KEY_ENC,
+    KS_DES3_2KEY_DEC,
+    KS_DES3_3KEY_ENC,
+    KS_DES3_3KEY_DEC,
+    KS_AES128_ENC,
+    KS_AES128_DEC,
+} ks_type_t;
+
+typedef struct {
+    bool used;
+    ks_type_t type;
+    uint8_t key[24];
+    union {
+        mbedtls_des_context des;
+        mbedtls_des3_context des3;
+        mbedtls_aes_context aes;
+    } ctx;
+} ks_entry_t;
+
+#define KS_CACHE_SIZE 8
+static ks_entry_t gs_ks_cache[KS_CACHE_SIZE];
+static uint8_t gs_ks_next = 0;
+static pthread_mutex_t gs_ks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t ks_keylen(ks_type_t type) {
+    switch (type) {
+        case KS_DES_ENC:
+        case KS_DES_DEC:
+            return 8;
+        case KS_DES3_3KEY_ENC:
+        case KS_DES3_3KEY_DEC:
+            return 24;
+        case KS_DES3_2KEY_ENC:
+        case KS_DES3_2KEY_DEC:
+        case KS_AES128_ENC:
+        case KS_AES128_DEC:
+        default:
+            return 16;
+    }
+}
+
+static void ks_free(ks_entry_t *e) {
+    if (e->used == false) {
+        return;
+    }
+
+    switch (e->type) {
+        case KS_DES_ENC:
+        case KS_DES_DEC:
+            mbedtls_des_free(&e->ctx.des);
+            break;
+        case KS_DES3_2KEY_ENC:
+        case KS_DES3_2KEY_DEC:
+        case KS_DES3_3KEY_ENC:
+        case KS_DES3_3KEY_DEC:
+            mbedtls_des3_free(&e->ctx.des3);
+            break;
+        case KS_AES128_ENC:
+        case KS_AES128_DEC:
+            mbedtls_aes_free(&e->ctx.aes);
+            break;
+    }
+    memset(e->key, 0, sizeof(e->key));
+    e->used = false;
+}
+
+// returns with gs_ks_lock held, call ks_put() when done with the context
+static ks_entry_t *ks_get(ks_type_t type, const void *key) {
+    size_t keylen = ks_keylen(type);
+
+    pthread_mutex_lock(&gs_ks_lock);
+    for (int i = 0; i < KS_CACHE_SIZE; i++) {
+        ks_entry_t *e = &gs_ks_cache[i];
+        if (e->used && e->type == type && memcmp(e->key, key, keylen) == 0) {
+            return e;
+        }
+    }
+
+    ks_entry_t *e = &gs_ks_cache[gs_ks_next];
+    gs_ks_next = (gs_ks_next + 1) % KS_CACHE_SIZE;
+    ks_free(e);
+
+    switch (type) {
+        case KS_DES_ENC:
+            mbedtls_des_init(&e->ctx.des);
+            mbedtls_des_setkey_enc(&e->ctx.des, key);
+            break;
+        case KS_DES_DEC:
+            mbedtls_des_init(&e->ctx.des);
+            mbedtls_des_setkey_dec(&e->ctx.des, key);
+            break;
+        case KS_DES3_2KEY_ENC:
+            mbedtls_des3_init(&e->ctx.des3);
+            mbedtls_des3_set2key_enc(&e->ctx.des3, key);
+            break;
+        case KS_DES3_2KEY_DEC:
+            mbedtls_des3_init(&e->ctx.des3);
+            mbedtls_des3_set2key_dec(&e->ctx.des3, key);
+            break;
+        case KS_DES3_3KEY_ENC:
+            mbedtls_des3_init(&e->ctx.des3);
+            mbedtls_des3_set3key_enc(&e->ctx.des3, key);
+            break;
+        case KS_DES3_3KEY_DEC:
+            mbedtls_des3_init(&e->ctx.des3);
+            mbedtls_des3_set3key_dec(&e->ctx.des3, key);
+            break;
+        case KS_AES128_ENC:
+            mbedtls_aes_init(&e->ctx.aes);
+            mbedtls_aes_setkey_enc(&e->ctx.aes, key, 128);
+            break;
+        case KS_AES128_DEC:
+            mbedtls_aes_init(&e->ctx.aes);
+            mbedtls_aes_setkey_dec(&e->ctx.aes, key, 128);
+            break;
+    }
+    e->type = type;
+    memcpy(e->key, key, keylen);
+    e->used = true;
+    return e;
+}
+
+static void ks_put(void) {
+    pthread_mutex_unlock(&gs_ks_lock);
+}
+
 void des_encrypt(void *out, const void *in, const void *key) {
-    mbedtls_des_context ctx;
-    mbedtls_des_setkey_enc(&ctx, key);
-    mbedtls_des_crypt_ecb(&ctx, in, out);
-    mbedtls_des_free(&ctx);
+    ks_entry_t *e = ks_get(KS_DES_ENC, key);
+    mbedtls_des_crypt_ecb(&e->ctx.des, in, out);
+    ks_put();
 }
 
 void des_decrypt(void *out, const void *in, const void *key) {
-    mbedtls_des_context ctx;
-    mbedtls_des_setkey_dec(&ctx, key);
-    mbedtls_des_crypt_ecb(&ctx, in, out);
-    mbedtls_des_free(&ctx);
+    ks_entry_t *e = ks_get(KS_DES_DEC, key);
+    mbedtls_des_crypt_ecb(&e->ctx.des, in, out);
+    ks_put();
 }
 
 void des_encrypt_ecb(void *out, const void *in, const int length, const void *key) {
@@ -65,15 +196,15 @@ void des_decrypt_ecb(void *out, const void *in, const int length, const void *ke
 }
 
 void des_encrypt_cbc(void *out, const void *in, const int length, const void *key, uint8_t *iv) {
-    mbedtls_des_context ctx;
-    mbedtls_des_setkey_enc(&ctx, key);
-    mbedtls_des_crypt_cbc(&ctx, MBEDTLS_DES_ENCRYPT, length, iv, in, out);
+    ks_entry_t *e = ks_get(KS_DES_ENC, key);
+    mbedtls_des_crypt_cbc(&e->ctx.des, MBEDTLS_DES_ENCRYPT, length, iv, in, out);
+    ks_put();
 }
 
 void des_decrypt_cbc(void *out, const void *in, const int length, const void *key, uint8_t *iv) {
-    mbedtls_des_context ctx;
-    mbedtls_des_setkey_dec(&ctx, key);
-    mbedtls_des_crypt_cbc(&ctx, MBEDTLS_DES_DECRYPT, length, iv, in, out);
+    ks_entry_t *e = ks_get(KS_DES_DEC, key);
+    mbedtls_des_crypt_cbc(&e->ctx.des, MBEDTLS_DES_DECRYPT, length, iv, in, out);
+    ks_put();
 }
 
 void des3_encrypt(void *out, const void *in, const void *key, uint8_t keycount) {
@@ -82,17 +213,15 @@ void des3_encrypt(void *out, const void *in, const void *key, uint8_t keycount)
             des_encrypt(out, in, key);
             break;
         case 2: {
-            mbedtls_des3_context ctx3;
-            mbedtls_des3_set2key_enc(&ctx3, key);
-            mbedtls_des3_crypt_ecb(&ctx3, in, out);
-            mbedtls_des3_free(&ctx3);
+            ks_entry_t *e = ks_get(KS_DES3_2KEY_ENC, key);
+            mbedtls_des3_crypt_ecb(&e->ctx.des3, in, out);
+            ks_put();
             break;
         }
         case 3: {
-            mbedtls_des3_context ctx3;
-            mbedtls_des3_set3key_enc(&ctx3, key);
-            mbedtls_des3_crypt_ecb(&ctx3, in, out);
-            mbedtls_des3_free(&ctx3);
+            ks_entry_t *e = ks_get(KS_DES3_3KEY_ENC, key);
+            mbedtls_des3_crypt_ecb(&e->ctx.des3, in, out);
+            ks_put();
             break;
         }
         default:
@@ -106,17 +235,15 @@ void des3_decrypt(void *out, const void *in, const void *key, uint8_t keycount)
             des_encrypt(out, in, key);
             break;
         case 2: {
-            mbedtls_des3_context ctx3;
-            mbedtls_des3_set2key_dec(&ctx3, key);
-            mbedtls_des3_crypt_ecb(&ctx3, in, out);
-            mbedtls_des3_free(&ctx3);
+            ks_entry_t *e = ks_get(KS_DES3_2KEY_DEC, key);
+            mbedtls_des3_crypt_ecb(&e->ctx.des3, in, out);
+            ks_put();
             break;
         }
         case 3: {
-            mbedtls_des3_context ctx3;
-            mbedtls_des3_set3key_dec(&ctx3, key);
-            mbedtls_des3_crypt_ecb(&ctx3, in, out);
-            mbedtls_des3_free(&ctx3);
+            ks_entry_t *e = ks_get(KS_DES3_3KEY_DEC, key);
+            mbedtls_des3_crypt_ecb(&e->ctx.des3, in, out);
+            ks_put();
             break;
         }
         default:
@@ -131,15 +258,12 @@ int aes_encode(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *output, int l
         memcpy(iiv, iv, 16);
     }
 
-    mbedtls_aes_context aes;
-    mbedtls_aes_init(&aes);
-    if (mbedtls_aes_setkey_enc(&aes, key, 128)) {
-        return 1;
-    }
-    if (mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_ENCRYPT, length, iiv, input, output)) {
+    ks_entry_t *e = ks_get(KS_AES128_ENC, key);
+    int res = mbedtls_aes_crypt_cbc(&e->ctx.aes, MBEDTLS_AES_ENCRYPT, length, iiv, input, output);
+    ks_put();
+    if (res) {
         return 2;
     }
-    mbedtls_aes_free(&aes);
     return PM3_SUCCESS;
 }
 
@@ -149,25 +273,69 @@ int aes_decode(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *output, int l
         memcpy(iiv, iv, 16);
     }
 
-    mbedtls_aes_context aes;
-    mbedtls_aes_init(&aes);
-    if (mbedtls_aes_setkey_dec(&aes, key, 128)) {
-        return 1;
-    }
-    if (mbedtls_aes_crypt_cbc(&aes, MBEDTLS_AES_DECRYPT, length, iiv, input, output)) {
+    ks_entry_t *e = ks_get(KS_AES128_DEC, key);
+    int res = mbedtls_aes_crypt_cbc(&e->ctx.aes, MBEDTLS_AES_DECRYPT, length, iiv, input, output);
+    ks_put();
+    if (res) {
         return 2;
     }
-    mbedtls_aes_free(&aes);
     return PM3_SUCCESS;
 }
 
+// CMAC subkey doubling in GF(2^128)
+static void cmac_dbl(uint8_t *out, const uint8_t *in) {
+    uint8_t carry = 0;
+    for (int i = 15; i >= 0; i--) {
+        uint8_t b = in[i];
+        out[i] = (b << 1) | carry;
+        carry = b >> 7;
+    }
+    if (carry) {
+        out[15] ^= 0x87;
+    }
+}
+
 // NIST Special Publication 800-38B — Recommendation for block cipher modes of operation: The CMAC mode for authentication.
 // https://csrc.nist.gov/CSRC/media/Projects/Cryptographic-Standards-and-Guidelines/documents/examples/AES_CMAC.pdf
 int aes_cmac(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *mac, int length) {
     memset(mac, 0x00, 16);
+    if (length < 0) {
+        return PM3_EINVARG;
+    }
+
+    //  NIST 800-38B, on the cached key schedule
+    ks_entry_t *e = ks_get(KS_AES128_ENC, key);
 
-    //  NIST 800-38B
-    return mbedtls_aes_cmac_prf_128(key, MBEDTLS_AES_BLOCK_SIZE, input, length, mac);
+    uint8_t k[16] = {0};
+    mbedtls_aes_crypt_ecb(&e->ctx.aes, MBEDTLS_AES_ENCRYPT, k, k);
+    cmac_dbl(k, k);
+
+    int n = (length + 15) / 16;
+    bool complete = (n > 0) && ((length % 16) == 0);
+    if (n == 0) {
+        n = 1;
+    }
+
+    uint8_t x[16] = {0};
+    for (int i = 0; i < n - 1; i++) {
+        bin_xor(x, input + (i * 16), 16);
+        mbedtls_aes_crypt_ecb(&e->ctx.aes, MBEDTLS_AES_ENCRYPT, x, x);
+    }
+
+    uint8_t last[16] = {0};
+    int rest = length - ((n - 1) * 16);
+    memcpy(last, input + ((n - 1) * 16), rest);
+    if (complete == false) {
+        last[rest] = 0x80;
+        cmac_dbl(k, k);
+    }
+    bin_xor(last, k, 16);
+    bin_xor(x, last, 16);
+    mbedtls_aes_crypt_ecb(&e->ctx.aes, MBEDTLS_AES_ENCRYPT, x, mac);
+
+    ks_put();
+    memset(k, 0, sizeof(k));
+    return PM3_SUCCESS;
 }
 
 int aes_cmac8(uint8_t *iv, uint8_t *key, uint8_t *input, uint8_t *mac, int length) {
@@ -513,6 +681,238 @@ int ecdsa_signature_r_s_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, ui
 }
 
 
+// Originality checks verify one signature against a whole list of public keys.
+// The curve groups are loaded once (so the fixed point comb table for G is kept
+// between calls) and u1*G is computed once per signature, leaving one scalar
+// multiplication per candidate key. Verdicts are remembered per uid/signature.
+#define ECDSA_GRP_CACHE_SIZE     4
+#define ECDSA_RES_CACHE_SIZE     16
+#define ECDSA_RES_MAX_INPUT      32
+#define ECDSA_RES_MAX_RS         (2 * MBEDTLS_ECP_MAX_BYTES)
+
+typedef struct {
+    bool used;
+    mbedtls_ecp_group grp;
+} ecdsa_grp_entry_t;
+
+typedef struct {
+    bool used;
+    mbedtls_ecp_group_id curveid;
+    bool hash;
+    uint32_t keys_fp;
+    uint8_t input[ECDSA_RES_MAX_INPUT];
+    uint8_t input_len;
+    uint8_t r_s[ECDSA_RES_MAX_RS];
+    uint8_t r_s_len;
+    int index;
+} ecdsa_res_entry_t;
+
+static ecdsa_grp_entry_t gs_ecdsa_grp[ECDSA_GRP_CACHE_SIZE];
+static ecdsa_res_entry_t gs_ecdsa_res[ECDSA_RES_CACHE_SIZE];
+static uint8_t gs_ecdsa_res_next = 0;
+static pthread_mutex_t gs_ecdsa_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// caller holds gs_ecdsa_lock
+static mbedtls_ecp_group *ecdsa_grp_get(mbedtls_ecp_group_id curveid) {
+    for (int i = 0; i < ECDSA_GRP_CACHE_SIZE; i++) {
+        if (gs_ecdsa_grp[i].used && gs_ecdsa_grp[i].grp.id == curveid) {
+            return &gs_ecdsa_grp[i].grp;
+        }
+    }
+
+    for (int i = 0; i < ECDSA_GRP_CACHE_SIZE; i++) {
+        if (gs_ecdsa_grp[i].used == false) {
+            mbedtls_ecp_group_init(&gs_ecdsa_grp[i].grp);
+            if (mbedtls_ecp_group_load(&gs_ecdsa_grp[i].grp, curveid)) {
+                mbedtls_ecp_group_free(&gs_ecdsa_grp[i].grp);
+                return NULL;
+            }
+            gs_ecdsa_grp[i].used = true;
+            return &gs_ecdsa_grp[i].grp;
+        }
+    }
+    return NULL;
+}
+
+// FNV-1a over the key values, distinguishes key lists sharing a curve
+static uint32_t ecdsa_keys_fingerprint(const ecdsa_publickey_t *keys, size_t keycount) {
+    uint32_t h = 0x811C9DC5;
+    for (size_t i = 0; i < keycount; i++) {
+        for (const char *c = keys[i].value; *c; c++) {
+            h = (h ^ (uint8_t)*c) * 0x01000193;
+        }
+        h = (h ^ 0xFF) * 0x01000193;
+    }
+    return h;
+}
+
+// caller holds gs_ecdsa_lock
+static ecdsa_res_entry_t *ecdsa_res_find(mbedtls_ecp_group_id curveid, uint32_t keys_fp, const uint8_t *input, int length, const uint8_t *r_s, size_t r_s_len, bool hash) {
+    for (int i = 0; i < ECDSA_RES_CACHE_SIZE; i++) {
+        ecdsa_res_entry_t *e = &gs_ecdsa_res[i];
+        if (e->used && e->curveid == curveid && e->hash == hash && e->keys_fp == keys_fp &&
+                e->input_len == length && e->r_s_len == r_s_len &&
+                memcmp(e->input, input, length) == 0 && memcmp(e->r_s, r_s, r_s_len) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// caller holds gs_ecdsa_lock
+static int ecdsa_find_key_calc(mbedtls_ecp_group *grp, const ecdsa_publickey_t *keys, size_t keycount, uint8_t *input, int length, uint8_t *r_s, size_t r_s_len, bool hash) {
+    uint8_t shahash[32] = {0};
+    if (hash && sha256hash(input, length, shahash)) {
+        return -1;
+    }
+    const uint8_t *buf = hash ? shahash : input;
+    size_t blen = hash ? sizeof(shahash) : (size_t)length;
+
+    int found = -1;
+    mbedtls_mpi r, s, e, s_inv, u1, u2, one;
+    mbedtls_ecp_point u1g, Q, R;
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+    mbedtls_mpi_init(&e);
+    mbedtls_mpi_init(&s_inv);
+    mbedtls_mpi_init(&u1);
+    mbedtls_mpi_init(&u2);
+    mbedtls_mpi_init(&one);
+    mbedtls_ecp_point_init(&u1g);
+    mbedtls_ecp_point_init(&Q);
+    mbedtls_ecp_point_init(&R);
+
+    // same steps as mbedtls_ecdsa_verify(), but with u1*G hoisted out of the key loop
+    if (mbedtls_mpi_read_binary(&r, r_s, r_s_len / 2) ||
+            mbedtls_mpi_read_binary(&s, r_s + r_s_len / 2, r_s_len / 2)) {
+        goto out;
+    }
+
+    if (mbedtls_mpi_cmp_int(&r, 1) < 0 || mbedtls_mpi_cmp_mpi(&r, &grp->N) >= 0 ||
+            mbedtls_mpi_cmp_int(&s, 1) < 0 || mbedtls_mpi_cmp_mpi(&s, &grp->N) >= 0) {
+        goto out;
+    }
+
+    size_t n_size = (grp->nbits + 7) / 8;
+    size_t use_size = blen > n_size ? n_size : blen;
+    if (mbedtls_mpi_read_binary(&e, buf, use_size)) {
+        goto out;
+    }
+    if (use_size * 8 > grp->nbits) {
+        mbedtls_mpi_shift_r(&e, use_size * 8 - grp->nbits);
+    }
+    if (mbedtls_mpi_cmp_mpi(&e, &grp->N) >= 0) {
+        mbedtls_mpi_sub_mpi(&e, &e, &grp->N);
+    }
+
+    if (mbedtls_mpi_inv_mod(&s_inv, &s, &grp->N) ||
+            mbedtls_mpi_mul_mpi(&u1, &e, &s_inv) ||
+            mbedtls_mpi_mod_mpi(&u1, &u1, &grp->N) ||
+            mbedtls_mpi_mul_mpi(&u2, &r, &s_inv) ||
+            mbedtls_mpi_mod_mpi(&u2, &u2, &grp->N) ||
+            mbedtls_mpi_lset(&one, 1)) {
+        goto out;
+    }
+
+    if (mbedtls_ecp_mul(grp, &u1g, &u1, &grp->G, NULL, NULL)) {
+        goto out;
+    }
+
+    size_t keylen = n_size * 2 + 1;
+    for (size_t i = 0; i < keycount; i++) {
+        uint8_t key[2 * MBEDTLS_ECP_MAX_BYTES + 1] = {0};
+        if (hex_to_bytes(keys[i].value, key, sizeof(key)) != (int)keylen) {
+            continue;
+        }
+        if (mbedtls_ecp_point_read_binary(grp, &Q, key, keylen)) {
+            continue;
+        }
+
+        // R = 1 * (u1 G) + u2 Q
+        if (mbedtls_ecp_muladd(grp, &R, &one, &u1g, &u2, &Q)) {
+            continue;
+        }
+        if (mbedtls_ecp_is_zero(&R)) {
+            continue;
+        }
+        if (mbedtls_mpi_mod_mpi(&R.X, &R.X, &grp->N)) {
+            continue;
+        }
+        if (mbedtls_mpi_cmp_mpi(&R.X, &r) == 0) {
+            found = i;
+            break;
+        }
+    }
+
+out:
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+    mbedtls_mpi_free(&e);
+    mbedtls_mpi_free(&s_inv);
+    mbedtls_mpi_free(&u1);
+    mbedtls_mpi_free(&u2);
+    mbedtls_mpi_free(&one);
+    mbedtls_ecp_point_free(&u1g);
+    mbedtls_ecp_point_free(&Q);
+    mbedtls_ecp_point_free(&R);
+    return found;
+}
+
+// checks a r||s signature against a list of public keys (hex, uncompressed)
+// returns the index of the first key that verifies, or -1
+int ecdsa_signature_r_s_find_key(mbedtls_ecp_group_id curveid, const ecdsa_publickey_t *keys, size_t keycount, uint8_t *input, int length, uint8_t *r_s, size_t r_s_len, bool hash) {
+    if (keys == NULL || keycount == 0 || input == NULL || length < 0 || r_s == NULL || r_s_len < 2) {
+        return -1;
+    }
+
+    bool cacheable = (length <= ECDSA_RES_MAX_INPUT) && (r_s_len <= ECDSA_RES_MAX_RS);
+    uint32_t keys_fp = cacheable ? ecdsa_keys_fingerprint(keys, keycount) : 0;
+
+    pthread_mutex_lock(&gs_ecdsa_lock);
+
+    if (cacheable) {
+        ecdsa_res_entry_t *e = ecdsa_res_find(curveid, keys_fp, input, length, r_s, r_s_len, hash);
+        if (e) {
+            int index = e->index;
+            pthread_mutex_unlock(&gs_ecdsa_lock);
+            return index;
+        }
+    }
+
+    int index = -1;
+    mbedtls_ecp_group *grp = ecdsa_grp_get(curveid);
+    if (grp) {
+        index = ecdsa_find_key_calc(grp, keys, keycount, input, length, r_s, r_s_len, hash);
+    } else {
+        // group cache full, fall back to one full verify per key
+        for (size_t i = 0; i < keycount && index < 0; i++) {
+            uint8_t key[2 * MBEDTLS_ECP_MAX_BYTES + 1] = {0};
+            if (hex_to_bytes(keys[i].value, key, sizeof(key)) > 0 &&
+                    ecdsa_signature_r_s_verify(curveid, key, input, length, r_s, r_s_len, hash) == 0) {
+                index = i;
+            }
+        }
+    }
+
+    if (cacheable) {
+        ecdsa_res_entry_t *e = &gs_ecdsa_res[gs_ecdsa_res_next];
+        gs_ecdsa_res_next = (gs_ecdsa_res_next + 1) % ECDSA_RES_CACHE_SIZE;
+        e->curveid = curveid;
+        e->hash = hash;
+        e->keys_fp = keys_fp;
+        memcpy(e->input, input, length);
+        e->input_len = length;
+        memcpy(e->r_s, r_s, r_s_len);
+        e->r_s_len = r_s_len;
+        e->index = index;
+        e->used = true;
+    }
+
+    pthread_mutex_unlock(&gs_ecdsa_lock);
+    return index;
+}
+
+
 #define T_PRIVATE_KEY "C477F9F65C22CCE20657FAA5B2D1D8122336F851A508A1ED04E479C34985BF96"
 #define T_Q_X         "B7E08AFDFE94BAD3F1DC8C734798BA1C62B3A0AD1E9EA2A38201CD0889BC7A19"
 #define T_Q_Y         "3603F747959DBF7A4BB226E41928729063ADC7AE43529E61B563BBC606CC5E09"
@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <mbedtls/pk.h>
+#include "pm3_cmd.h"
 
 #define CRYPTO_AES_BLOCK_SIZE 16
 #define CRYPTO_AES128_KEY_SIZE 16
@@ -50,6 +51,7 @@ int ecdsa_public_key_from_pk(mbedtls_pk_context *pk, mbedtls_ecp_group_id curvei
 int ecdsa_signature_create(mbedtls_ecp_group_id curveid, uint8_t *key_d, uint8_t *key_xy, uint8_t *input, int length, uint8_t *signature, size_t *signaturelen, bool hash);
 int ecdsa_signature_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, uint8_t *input, int length, uint8_t *signature, size_t signaturelen, bool hash);
 int ecdsa_signature_r_s_verify(mbedtls_ecp_group_id curveid, uint8_t *key_xy, uint8_t *input, int length, uint8_t *r_s, size_t r_s_len, bool hash);
+int ecdsa_signature_r_s_find_key(mbedtls_ecp_group_id curveid, const ecdsa_publickey_t *keys, size_t keycount, uint8_t *input, int length, uint8_t *r_s, size_t r_s_len, bool hash);
 
 char *ecdsa_get_error(int ret);
 
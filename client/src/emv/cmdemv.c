@@ -1475,7 +1475,7 @@ static int CmdEMVExec(const char *Cmd) {
     }
 
     if (decodeTLV) {
-        TLVPrintFromBuffer(buf, len);
+        TLVPrintResponse(tlvRoot, buf, len);
     }
     PrintAndLogEx(INFO, "* Selected.");
 
@@ -1563,7 +1563,7 @@ static int CmdEMVExec(const char *Cmd) {
                 }
 
                 if (decodeTLV) {
-                    TLVPrintFromBuffer(buf, len);
+                    TLVPrintResponse(tlvRoot, buf, len);
                     PrintAndLogEx(NORMAL, "");
                 }
 
@@ -1729,7 +1729,7 @@ static int CmdEMVExec(const char *Cmd) {
             }
 
             if (decodeTLV) {
-                TLVPrintFromBuffer(buf, len);
+                TLVPrintResponse(tlvRoot, buf, len);
             }
 
             // CDA
@@ -1826,7 +1826,7 @@ static int CmdEMVExec(const char *Cmd) {
                 }
 
                 // Mastercard compute cryptographic checksum result
-                TLVPrintFromBuffer(buf, len);
+                TLVPrintResponse(tlvRoot, buf, len);
                 PrintAndLogEx(NORMAL, "");
 
                 free(udol_data_tlv);
@@ -2192,7 +2192,7 @@ static int CmdEMVScan(const char *Cmd) {
     }
 
     if (decodeTLV)
-        TLVPrintFromBuffer(buf, len);
+        TLVPrintResponse(tlvRoot, buf, len);
 
     // save mode
     if (tlvdb_get(tlvRoot, 0x9f38, NULL)) {
@@ -2321,7 +2321,7 @@ static int CmdEMVScan(const char *Cmd) {
                 }
 
                 if (decodeTLV) {
-                    TLVPrintFromBuffer(buf, len);
+                    TLVPrintResponse(tlvRoot, buf, len);
                     PrintAndLogEx(NORMAL, "");
                 }
 
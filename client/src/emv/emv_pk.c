@@ -414,18 +414,40 @@ void emv_pk_free(struct emv_pk *pk) {
     free(pk);
 }
 
-static struct emv_pk *emv_pk_get_ca_pk_from_file(const char *fname,
-                                                 const unsigned char *rid,
-                                                 unsigned char idx) {
-    if (!fname)
+static struct emv_pk *emv_pk_dup(const struct emv_pk *pk) {
+    struct emv_pk *r = emv_pk_new(pk->mlen, pk->elen);
+    if (!r)
         return NULL;
 
+    unsigned char *modulus = r->modulus;
+    memcpy(r, pk, sizeof(*r));
+    r->modulus = modulus;
+    memcpy(r->modulus, pk->modulus, pk->mlen);
+    return r;
+}
+
+// CA public keys from capk.txt, parsed once per client run and looked up
+// by RID + index. The hash check is done the first time a key is used.
+typedef struct {
+    struct emv_pk *pk;
+    int verified;   // -1 not checked yet, 0 failed, 1 ok
+} emv_capk_entry_t;
+
+static emv_capk_entry_t *capk_cache = NULL;
+static size_t capk_cache_count = 0;
+static bool capk_cache_loaded = false;
+
+static bool emv_pk_load_ca_cache(const char *fname) {
+    if (!fname)
+        return false;
+
     FILE *f = fopen(fname, "r");
     if (!f) {
         PrintAndLogEx(ERR, "Error: can't open file %s.", fname);
-        return NULL;
+        return false;
     }
 
+    size_t capacity = capk_cache_count;
     while (!feof(f)) {
         char buf[2048];
         if (fgets(buf, sizeof(buf), f) == NULL)
@@ -435,16 +457,41 @@ static struct emv_pk *emv_pk_get_ca_pk_from_file(const char *fname,
         if (!pk)
             continue;
 
-        if (memcmp(pk->rid, rid, 5) || pk->index != idx) {
-            emv_pk_free(pk);
-            continue;
+        if (capk_cache_count == capacity) {
+            capacity = (capacity) ? capacity * 2 : 64;
+            emv_capk_entry_t *tmp = realloc(capk_cache, capacity * sizeof(emv_capk_entry_t));
+            if (!tmp) {
+                emv_pk_free(pk);
+                break;
+            }
+            capk_cache = tmp;
         }
 
-        fclose(f);
-        return pk;
+        capk_cache[capk_cache_count].pk = pk;
+        capk_cache[capk_cache_count].verified = -1;
+        capk_cache_count++;
     }
 
     fclose(f);
+    return true;
+}
+
+static emv_capk_entry_t *emv_pk_find_ca_cache(const unsigned char *rid, unsigned char idx) {
+    if (capk_cache_loaded == false) {
+        char *path;
+        if (searchFile(&path, RESOURCES_SUBDIR, "capk", ".txt", false) != PM3_SUCCESS) {
+            return NULL;
+        }
+        capk_cache_loaded = emv_pk_load_ca_cache(path);
+        free(path);
+    }
+
+    for (size_t i = 0; i < capk_cache_count; i++) {
+        const struct emv_pk *pk = capk_cache[i].pk;
+        if (memcmp(pk->rid, rid, 5) == 0 && pk->index == idx) {
+            return &capk_cache[i];
+        }
+    }
     return NULL;
 }
 
@@ -506,17 +553,16 @@ struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx) {
             }
         }
     */
-    char *path;
-    if (searchFile(&path, RESOURCES_SUBDIR, "capk", ".txt", false) != PM3_SUCCESS) {
+    emv_capk_entry_t *e = emv_pk_find_ca_cache(rid, idx);
+    if (!e)
         return NULL;
-    }
-    pk = emv_pk_get_ca_pk_from_file(path, rid, idx);
-    free(path);
 
-    if (!pk)
-        return NULL;
+    if (e->verified < 0) {
+        e->verified = emv_pk_verify(e->pk);
+    }
 
-    bool isok = emv_pk_verify(pk);
+    pk = e->pk;
+    bool isok = (e->verified == 1);
 
     PrintAndLogEx(INFO, "Verifying CA PK for %02hhx:%02hhx:%02hhx:%02hhx:%02hhx IDX %02hhx %zu bits.  ( %s )",
                   pk->rid[0],
@@ -530,9 +576,9 @@ struct emv_pk *emv_pk_get_ca_pk(const unsigned char *rid, unsigned char idx) {
                  );
 
     if (isok) {
-        return pk;
+        // callers own and free what they get back, the cache keeps its copy
+        return emv_pk_dup(pk);
     }
 
-    emv_pk_free(pk);
     return NULL;
 }
@@ -155,6 +155,14 @@ enum CardPSVendor GetCardPSVendor(uint8_t *AID, size_t AIDlen) {
     return CV_NA;
 }
 
+// Last card response parsed into a transaction tree. Printing the response
+// right after the exchange reuses these nodes instead of parsing it again.
+static struct {
+    const struct tlvdb *root;
+    const struct tlvdb *db;
+    size_t top;     // top level elements which belong to the response
+} emv_last_response;
+
 static void emv_print_cb(void *data, const struct tlv *tlv, int level, bool is_leaf) {
     emv_tag_dump(tlv, level);
     if (is_leaf) {
@@ -176,6 +184,20 @@ bool TLVPrintFromBuffer(uint8_t *data, int datalen) {
     return false;
 }
 
+bool TLVPrintResponse(const struct tlvdb *root, uint8_t *data, int datalen) {
+    const struct tlvdb *t = EMVGetLastResponse(root, data, datalen);
+    if (t == NULL) {
+        return TLVPrintFromBuffer(data, datalen);
+    }
+
+    PrintAndLogEx(INFO, "-------------------- " _CYAN_("TLV decoded") " --------------------");
+    for (size_t i = 0; t && i < emv_last_response.top; i++, t = t->next) {
+        emv_print_cb(NULL, &t->tag, 0, (t->children == NULL));
+        tlvdb_visit(t->children, emv_print_cb, NULL, 1);
+    }
+    return true;
+}
+
 void TLVPrintFromTLVLev(struct tlvdb *tlv, int level) {
     if (tlv == NULL)
         return;
@@ -274,12 +296,51 @@ struct tlvdb *GetdCVVRawFromTrack2(const struct tlv *track2) {
     return tlvdb_fixed(0x02, dCVVlen, dCVV);
 }
 
+static void emv_add_response(struct tlvdb *tlv, const uint8_t *data, size_t datalen) {
+    struct tlvdb *t = tlvdb_parse_multi(data, datalen);
+    if (t == NULL) {
+        return;
+    }
+
+    size_t top = 0;
+    for (const struct tlvdb *e = t; e; e = e->next) {
+        top++;
+    }
+
+    tlvdb_add(tlv, t);
+
+    emv_last_response.root = tlv;
+    emv_last_response.db = t;
+    emv_last_response.top = top;
+}
+
+const struct tlvdb *EMVGetLastResponse(const struct tlvdb *root, const uint8_t *data, size_t datalen) {
+    if (root == NULL || root != emv_last_response.root || emv_last_response.db == NULL) {
+        return NULL;
+    }
+
+    // still linked into this tree? then it hasn't been freed
+    const struct tlvdb *e = root;
+    while (e && e != emv_last_response.db) {
+        e = e->next;
+    }
+    if (e == NULL) {
+        return NULL;
+    }
+
+    // tlvdb_parse_multi keeps a copy of the raw bytes in front of the first node
+    const struct tlvdb_root *r = (const struct tlvdb_root *)emv_last_response.db;
+    if (r->len != datalen || memcmp(r->buf, data, datalen)) {
+        return NULL;
+    }
+    return emv_last_response.db;
+}
+
 static int EMVExchangeEx(Iso7816CommandChannel channel, bool ActivateField, bool LeaveFieldON, sAPDU_t apdu, bool IncludeLe, uint8_t *Result, size_t MaxResultLen, size_t *ResultLen, uint16_t *sw, struct tlvdb *tlv) {
     int res = Iso7816ExchangeEx(channel, ActivateField, LeaveFieldON, apdu, IncludeLe, 0, Result, MaxResultLen, ResultLen, sw);
     // add to tlv tree
     if ((res == PM3_SUCCESS) && tlv) {
-        struct tlvdb *t = tlvdb_parse_multi(Result, *ResultLen);
-        tlvdb_add(tlv, t);
+        emv_add_response(tlv, Result, *ResultLen);
     }
     return res;
 }
@@ -288,8 +349,7 @@ int EMVExchange(Iso7816CommandChannel channel, bool LeaveFieldON, sAPDU_t apdu,
     int res = Iso7816Exchange(channel, LeaveFieldON, apdu, Result, MaxResultLen, ResultLen, sw);
     // add to tlv tree
     if ((res == PM3_SUCCESS) && tlv) {
-        struct tlvdb *t = tlvdb_parse_multi(Result, *ResultLen);
-        tlvdb_add(tlv, t);
+        emv_add_response(tlv, Result, *ResultLen);
     }
     return res;
 }
@@ -298,8 +358,7 @@ int EMVSelect(Iso7816CommandChannel channel, bool ActivateField, bool LeaveField
     int res = Iso7816Select(channel, ActivateField, LeaveFieldON, AID, AIDLen, Result, MaxResultLen, ResultLen, sw);
     // add to tlv tree
     if ((res == PM3_SUCCESS) && tlv) {
-        struct tlvdb *t = tlvdb_parse_multi(Result, *ResultLen);
-        tlvdb_add(tlv, t);
+        emv_add_response(tlv, Result, *ResultLen);
     }
     return res;
 }
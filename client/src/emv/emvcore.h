@@ -51,6 +51,9 @@ enum CardPSVendor {
 enum CardPSVendor GetCardPSVendor(uint8_t *AID, size_t AIDlen);
 
 bool TLVPrintFromBuffer(uint8_t *data, int datalen);
+// prints a response EMVExchange/EMVSelect already parsed into `root`, parses `data` otherwise
+bool TLVPrintResponse(const struct tlvdb *root, uint8_t *data, int datalen);
+const struct tlvdb *EMVGetLastResponse(const struct tlvdb *root, const uint8_t *data, size_t datalen);
 void TLVPrintFromTLV(struct tlvdb *tlv);
 void TLVPrintFromTLVLev(struct tlvdb *tlv, int level);
 void TLVPrintAIDlistFromSelectTLV(struct tlvdb *tlv);
@@ -306,6 +306,36 @@ int JsonLoadBufAsHex(json_t *elm, const char *path, uint8_t *data, size_t maxbuf
     return 0;
 }
 
+// maps the string `field` of each array element to the element, first occurrence wins.
+// elements are shared with root, the index holds its own reference to them.
+json_t *JsonIndexArray(json_t *root, const char *field, bool lowercase) {
+    if (!json_is_array(root))
+        return NULL;
+
+    json_t *index = json_object();
+    if (index == NULL)
+        return NULL;
+
+    for (size_t idx = 0; idx < json_array_size(root); idx++) {
+        json_t *data = json_array_get(root, idx);
+        if (!json_is_object(data))
+            continue;
+
+        const char *val = json_string_value(json_object_get(data, field));
+        if (val == NULL || strlen(val) == 0)
+            continue;
+
+        char key[strlen(val) + 1];
+        strcpy(key, val);
+        if (lowercase)
+            str_lower(key);
+
+        if (json_object_get(index, key) == NULL)
+            json_object_set(index, key, data);
+    }
+    return index;
+}
+
 bool ParamLoadFromJson(struct tlvdb *tlv) {
     json_t *root;
     json_error_t error;
@@ -48,6 +48,8 @@ int JsonSaveTLVTree(json_t *root, json_t *elm, const char *path, struct tlvdb *t
 int JsonLoadStr(json_t *root, const char *path, char *value);
 int JsonLoadBufAsHex(json_t *elm, const char *path, uint8_t *data, size_t maxbufferlen, size_t *datalen);
 
+json_t *JsonIndexArray(json_t *root, const char *field, bool lowercase);
+
 bool ParamLoadFromJson(struct tlvdb *tlv);
 
 #endif
@@ -107,12 +107,97 @@ bool tlv_parse_tl(const unsigned char **buf, size_t *len, struct tlv *tlv) {
     return true;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent);
+// Node storage for one parse. tlvdb_parse() and tlvdb_parse_multi() count the
+// elements first and put all nodes in the same allocation as the root and its
+// copy of the buffer, so a whole response is a single calloc / free.
+typedef struct {
+    struct tlvdb *nodes;
+    size_t used;
+    size_t count;
+} tlvdb_arena_t;
+
+#define TLVDB_ALIGN(x) (((x) + 15) & ~(size_t)15)
+
+static struct tlvdb *tlvdb_node_new(tlvdb_arena_t *arena) {
+    if (arena == NULL) {
+        return calloc(1, sizeof(struct tlvdb));
+    }
+    if (arena->used >= arena->count) {
+        return NULL;
+    }
+    struct tlvdb *tlvdb = &arena->nodes[arena->used++];
+    tlvdb->in_root = true;
+    return tlvdb;
+}
+
+// same walk as tlvdb_parse_one() without building anything
+static bool tlv_count_one(const unsigned char **tmp, size_t *left, size_t *count) {
+    struct tlv tlv;
+
+    tlv.tag = tlv_parse_tag(tmp, left);
+    if (tlv.tag == TLV_TAG_INVALID)
+        return false;
+
+    tlv.len = tlv_parse_len(tmp, left);
+    if (tlv.len == TLV_LEN_INVALID)
+        return false;
+
+    if (tlv.len > *left)
+        return false;
+
+    const unsigned char *value = *tmp;
+    *tmp += tlv.len;
+    *left -= tlv.len;
+    (*count)++;
+
+    if (tlv_is_constructed(&tlv) && (tlv.len != 0)) {
+        size_t cleft = tlv.len;
+        while (cleft != 0) {
+            if (tlv_count_one(&value, &cleft, count) == false)
+                return false;
+        }
+    }
+    return true;
+}
+
+static struct tlvdb_root *tlvdb_root_alloc(const unsigned char *buf, size_t len, bool multi, tlvdb_arena_t *arena) {
+    const unsigned char *tmp = buf;
+    size_t left = len;
+    size_t count = 0;
+
+    if (tlv_count_one(&tmp, &left, &count) == false)
+        return NULL;
+
+    while (multi && left != 0) {
+        if (tlv_count_one(&tmp, &left, &count) == false)
+            return NULL;
+    }
+
+    if (left)
+        return NULL;
+
+    // the first element is the root node itself
+    size_t offset = TLVDB_ALIGN(sizeof(struct tlvdb_root) + len);
+    struct tlvdb_root *root = calloc(1, offset + (count - 1) * sizeof(struct tlvdb));
+    if (root == NULL)
+        return NULL;
+
+    root->len = len;
+    memcpy(root->buf, buf, len);
+
+    arena->nodes = (struct tlvdb *)((uint8_t *)root + offset);
+    arena->used = 0;
+    arena->count = count - 1;
+    return root;
+}
+
+static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent, tlvdb_arena_t *arena);
 
 static bool tlvdb_parse_one(struct tlvdb *tlvdb,
                             struct tlvdb *parent,
                             const unsigned char **tmp,
-                            size_t *left) {
+                            size_t *left,
+                            tlvdb_arena_t *arena) {
     tlvdb->next = tlvdb->children = NULL;
     tlvdb->parent = parent;
 
@@ -133,7 +218,7 @@ static bool tlvdb_parse_one(struct tlvdb *tlvdb,
     *left -= tlvdb->tag.len;
 
     if (tlv_is_constructed(&tlvdb->tag) && (tlvdb->tag.len != 0)) {
-        tlvdb->children = tlvdb_parse_children(tlvdb);
+        tlvdb->children = tlvdb_parse_children(tlvdb, arena);
         if (!tlvdb->children)
             goto err;
     } else {
@@ -146,20 +231,23 @@ err:
     return false;
 }
 
-static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent) {
+static struct tlvdb *tlvdb_parse_children(struct tlvdb *parent, tlvdb_arena_t *arena) {
     const unsigned char *tmp = parent->tag.value;
     size_t left = parent->tag.len;
     struct tlvdb *tlvdb, *first = NULL, *prev = NULL;
 
     while (left != 0) {
-        tlvdb = calloc(1, sizeof(*tlvdb));
+        tlvdb = tlvdb_node_new(arena);
+        if (tlvdb == NULL)
+            goto err;
+
         if (prev)
             prev->next = tlvdb;
         else
             first = tlvdb;
         prev = tlvdb;
 
-        if (!tlvdb_parse_one(tlvdb, parent, &tmp, &left))
+        if (!tlvdb_parse_one(tlvdb, parent, &tmp, &left, arena))
             goto err;
 
         tlvdb->parent = parent;
@@ -177,18 +265,19 @@ struct tlvdb *tlvdb_parse(const unsigned char *buf, size_t len) {
     struct tlvdb_root *root;
     const unsigned char *tmp;
     size_t left;
+    tlvdb_arena_t arena;
 
     if (!len || !buf)
         return NULL;
 
-    root = calloc(1, sizeof(*root) + len);
-    root->len = len;
-    memcpy(root->buf, buf, len);
+    root = tlvdb_root_alloc(buf, len, false, &arena);
+    if (root == NULL)
+        return NULL;
 
     tmp = root->buf;
     left = len;
 
-    if (!tlvdb_parse_one(&root->db, NULL, &tmp, &left))
+    if (!tlvdb_parse_one(&root->db, NULL, &tmp, &left, &arena))
         goto err;
 
     if (left)
@@ -205,34 +294,31 @@ struct tlvdb *tlvdb_parse_multi(const unsigned char *buf, size_t len) {
     struct tlvdb_root *root;
     const unsigned char *tmp;
     size_t left;
+    tlvdb_arena_t arena;
 
     if (len == 0 || buf == NULL) {
         return NULL;
     }
 
-    root = calloc(1, sizeof(*root) + len);
+    root = tlvdb_root_alloc(buf, len, true, &arena);
     if (root == NULL) {
         return NULL;
     }
 
-    root->len = len;
-    memcpy(root->buf, buf, len);
-
     tmp = root->buf;
     left = len;
 
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == false) {
+    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left, &arena) == false) {
         goto err;
     }
 
     while (left != 0) {
-        struct tlvdb *db = calloc(1, sizeof(*db));
+        struct tlvdb *db = tlvdb_node_new(&arena);
         if (db == NULL) {
             goto err;
         }
 
-        if (tlvdb_parse_one(db, NULL, &tmp, &left) == false) {
-            free(db);
+        if (tlvdb_parse_one(db, NULL, &tmp, &left, &arena) == false) {
             goto err;
         }
 
@@ -256,7 +342,7 @@ bool tlvdb_parse_root(struct tlvdb_root *root) {
 
     tmp = root->buf;
     left = root->len;
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == true) {
+    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left, NULL) == true) {
         if (left == 0) {
             return true;
         }
@@ -274,10 +360,10 @@ bool tlvdb_parse_root_multi(struct tlvdb_root *root) {
 
     tmp = root->buf;
     left = root->len;
-    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left) == true) {
+    if (tlvdb_parse_one(&root->db, NULL, &tmp, &left, NULL) == true) {
         while (left > 0) {
             struct tlvdb *db = calloc(1, sizeof(*db));
-            if (tlvdb_parse_one(db, NULL, &tmp, &left) == true) {
+            if (tlvdb_parse_one(db, NULL, &tmp, &left, NULL) == true) {
                 tlvdb_add(&root->db, db);
             } else {
                 free(db);
@@ -323,10 +409,21 @@ void tlvdb_free(struct tlvdb *tlvdb) {
         return;
     }
 
+    // nodes parsed into a root are freed together with it. Roots are released
+    // after the walk, the siblings that follow may live in the same block
+    struct tlvdb *pending = NULL;
     for (; tlvdb; tlvdb = next) {
         next = tlvdb->next;
         tlvdb_free(tlvdb->children);
-        free(tlvdb);
+        if (tlvdb->in_root == false) {
+            tlvdb->next = pending;
+            pending = tlvdb;
+        }
+    }
+
+    for (; pending; pending = next) {
+        next = pending->next;
+        free(pending);
     }
 }
 
@@ -37,6 +37,7 @@ struct tlvdb {
     struct tlvdb *next;
     struct tlvdb *parent;
     struct tlvdb *children;
+    bool in_root;   // node lives in the allocation of the tlvdb_root it was parsed into
 };
 
 struct tlvdb_root {
@@ -21,6 +21,7 @@
 
 #include <dirent.h>
 #include <ctype.h>
+#include <pthread.h>
 
 #include "pm3_cmd.h"
 #include "commonutil.h"
@@ -29,10 +30,16 @@
 #include "cmdhficlass.h"  // pagemap
 #include "iclass_cmd.h"
 #include "iso15.h"
+#include "util_posix.h"
+#include "memstats.h"
 
 #ifdef _WIN32
 #include "scandir.h"
 #include <direct.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
 #endif
 
 #define PATH_MAX_LENGTH 200
@@ -285,6 +292,96 @@ int saveFile(const char *preferredName, const char *suffix, const void *data, si
     return PM3_SUCCESS;
 }
 
+int createMappedFile(const char *preferredName, const char *suffix, size_t size, mapped_file_t *mf) {
+
+    if (mf == NULL || size == 0) {
+        return PM3_EINVARG;
+    }
+
+    memset(mf, 0, sizeof(mapped_file_t));
+    mf->fd = -1;
+
+    mf->filename = newfilenamemcopyEx(preferredName, suffix, spTrace);
+    if (mf->filename == NULL) {
+        return PM3_EMALLOC;
+    }
+
+#ifdef _WIN32
+    mf->data = calloc(size, sizeof(uint8_t));
+    if (mf->data == NULL) {
+        free(mf->filename);
+        mf->filename = NULL;
+        return PM3_EMALLOC;
+    }
+#else
+    mf->fd = open(mf->filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mf->fd < 0) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", mf->filename);
+        free(mf->filename);
+        mf->filename = NULL;
+        return PM3_EFILE;
+    }
+
+    if (ftruncate(mf->fd, size) != 0) {
+        PrintAndLogEx(WARNING, "failed to resize `" _YELLOW_("%s") "` to %zu bytes", mf->filename, size);
+        close(mf->fd);
+        free(mf->filename);
+        mf->filename = NULL;
+        return PM3_EFILE;
+    }
+
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mf->fd, 0);
+    if (p == MAP_FAILED) {
+        PrintAndLogEx(WARNING, "failed to map `" _YELLOW_("%s") "`", mf->filename);
+        close(mf->fd);
+        free(mf->filename);
+        mf->filename = NULL;
+        return PM3_EMALLOC;
+    }
+    mf->data = p;
+#endif
+    mf->size = size;
+    return PM3_SUCCESS;
+}
+
+int closeMappedFile(mapped_file_t *mf, size_t used) {
+
+    if (mf == NULL || mf->data == NULL) {
+        return PM3_EINVARG;
+    }
+
+    used = MIN(used, mf->size);
+    int res = PM3_SUCCESS;
+
+#ifdef _WIN32
+    FILE *f = fopen(mf->filename, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "file not found or locked `" _YELLOW_("%s") "`", mf->filename);
+        res = PM3_EFILE;
+    } else {
+        fwrite(mf->data, 1, used, f);
+        fflush(f);
+        fclose(f);
+    }
+    free(mf->data);
+#else
+    munmap(mf->data, mf->size);
+    if (ftruncate(mf->fd, used) != 0) {
+        res = PM3_EFILE;
+    }
+    close(mf->fd);
+#endif
+
+    if (res == PM3_SUCCESS) {
+        PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%zu") " bytes to binary file `" _YELLOW_("%s") "`", used, mf->filename);
+    }
+
+    free(mf->filename);
+    memset(mf, 0, sizeof(mapped_file_t));
+    mf->fd = -1;
+    return res;
+}
+
 // dump file (normally,  we also got preference file, etc)
 int saveFileJSON(const char *preferredName, JSONFileType ftype, uint8_t *data, size_t datalen, void (*callback)(json_t *)) {
     return saveFileJSONex(preferredName, ftype, data, datalen, true, callback, spDump);
@@ -1379,6 +1476,31 @@ static int load_file_sanity(char *s, uint32_t datalen, int i, size_t len) {
     return true;
 }
 
+// Dump blocks are read straight from the `blocks` object and decoded in place.
+// Anything the plain hex decoder does not take (spaces, bad hex, too long) goes
+// through JsonLoadBufAsHex as before, for the same result and messages.
+static void json_load_block(json_t *root, int i, uint8_t *dst, size_t maxlen, size_t *len) {
+
+    char key[12];
+    snprintf(key, sizeof(key), "%d", i);
+
+    *len = 0;
+    const char *hex = json_string_value(json_object_get(json_object_get(root, "blocks"), key));
+    if (hex == NULL) {
+        return;
+    }
+
+    size_t n = strlen(hex) >> 1;
+    if (n > 0 && n <= maxlen && hexstr_to_byte_array(hex, dst, &n)) {
+        *len = n;
+        return;
+    }
+
+    char path[24];
+    snprintf(path, sizeof(path), "$.blocks.%d", i);
+    JsonLoadBufAsHex(root, path, dst, maxlen, len);
+}
+
 int loadFileJSON(const char *preferredName, void *data, size_t maxdatalen, size_t *datalen, void (*callback)(json_t *)) {
     return loadFileJSONex(preferredName, data, maxdatalen, datalen, true, callback);
 }
@@ -1444,9 +1566,8 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
             uint8_t block[MFBLOCK_SIZE] = {0}; // ensure zero-filled when partial block of data read
-            JsonLoadBufAsHex(root, blocks, block, MFBLOCK_SIZE, &len);
+            json_load_block(root, i, block, MFBLOCK_SIZE, &len);
             if (load_file_sanity(ctype, MFBLOCK_SIZE, i, len) == false) {
                 break;
             }
@@ -1478,9 +1599,8 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
             uint8_t block[MFBLOCK_SIZE] = {0}; // ensure zero-filled when partial block of data read
-            JsonLoadBufAsHex(root, blocks, block, MFBLOCK_SIZE, &len);
+            json_load_block(root, i, block, MFBLOCK_SIZE, &len);
 
             if (load_file_sanity(ctype, MFBLOCK_SIZE, i, len) == false) {
                 break;
@@ -1503,8 +1623,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
 
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
@@ -1538,8 +1657,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.mfu->data[sptr], MFU_BLOCK_SIZE, &len);
+            json_load_block(root, i, &udata.mfu->data[sptr], MFU_BLOCK_SIZE, &len);
 
             if (load_file_sanity(ctype, MFU_BLOCK_SIZE, i, len) == false) {
                 break;
@@ -1564,8 +1682,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -1586,8 +1703,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], PICOPASS_BLOCK_SIZE, &len);
+            json_load_block(root, i, &udata.bytes[sptr], PICOPASS_BLOCK_SIZE, &len);
             if (load_file_sanity(ctype, PICOPASS_BLOCK_SIZE, i, len) == false) {
                 break;
             }
@@ -1607,8 +1723,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -1628,8 +1743,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -1649,8 +1763,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -1670,8 +1783,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -1861,8 +1973,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &tag->data[sptr], tag->bytesPerPage, &len);
+            json_load_block(root, i, &tag->data[sptr], tag->bytesPerPage, &len);
             if (load_file_sanity(ctype, tag->bytesPerPage, i, len) == false) {
                 break;
             }
@@ -1882,8 +1993,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 16, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 16, &len);
             if (load_file_sanity(ctype, 16, i, len) == false) {
                 break;
             }
@@ -1915,8 +2025,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.topaz->data_blocks[sptr][0], TOPAZ_BLOCK_SIZE, &len);
+            json_load_block(root, i, &udata.topaz->data_blocks[sptr][0], TOPAZ_BLOCK_SIZE, &len);
             if (load_file_sanity(ctype, TOPAZ_BLOCK_SIZE, i, len) == false) {
                 break;
             }
@@ -2014,8 +2123,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 4, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 4, &len);
             if (load_file_sanity(ctype, 4, i, len) == false) {
                 break;
             }
@@ -2035,8 +2143,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 32, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 32, &len);
             if (load_file_sanity(ctype, 32, i, len) == false) {
                 break;
             }
@@ -2056,8 +2163,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 8, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 8, &len);
             if (load_file_sanity(ctype, 8, i, len) == false) {
                 break;
             }
@@ -2088,8 +2194,7 @@ int loadFileJSONex(const char *preferredName, void *data, size_t maxdatalen, siz
                 goto out;
             }
 
-            snprintf(blocks, sizeof(blocks), "$.blocks.%d", i);
-            JsonLoadBufAsHex(root, blocks, &udata.bytes[sptr], 16, &len);
+            json_load_block(root, i, &udata.bytes[sptr], 16, &len);
             if (load_file_sanity(ctype, 16, i, len) == false) {
                 break;
             }
@@ -2248,6 +2353,202 @@ out:
     return retval;
 }
 
+//----------------------------------------------------------------------------
+// Binary cache of parsed dictionaries in ~/.proxmark3/cache.
+// One file per dictionary path and key length, keys de-duplicated in file order.
+// Rebuilt when the size or modification time of the .dic file changes.
+//----------------------------------------------------------------------------
+#define DICT_CACHE_MAGIC    0x44334D50  // "PM3D"
+#define DICT_CACHE_VERSION  1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t keylen;
+    uint64_t src_size;
+    int64_t src_mtime;
+    uint32_t keycnt;
+    uint32_t pathlen;   // source path follows the header, then the keys
+} PACKED dict_cache_header_t;
+
+static uint64_t dict_fnv1a(const uint8_t *d, size_t n) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ d[i]) * 0x100000001B3ULL;
+    }
+    return h;
+}
+
+static bool dict_source_stat(const char *path, uint64_t *size, int64_t *mtime) {
+#ifdef _WIN32
+    struct _stat st;
+    if (_stat(path, &st) != 0)
+        return false;
+#else
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return false;
+#endif
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+static char *dict_cache_path(const char *src, uint8_t keylen, bool create) {
+
+    char *path = NULL;
+    if (create) {
+        if (searchHomeFilePath(&path, NULL, NULL, true) != PM3_SUCCESS)
+            return NULL;
+        free(path);
+        path = NULL;
+    }
+
+    char fn[40];
+    snprintf(fn, sizeof(fn), "dic_%016" PRIx64 "_%u.bin", dict_fnv1a((const uint8_t *)src, strlen(src)), keylen);
+
+    if (searchHomeFilePath(&path, CACHE_SUBDIR, fn, create) != PM3_SUCCESS)
+        return NULL;
+
+    return path;
+}
+
+// drops repeated keys in place, first occurrence wins so the dictionary order is kept
+static uint32_t dict_dedup(uint8_t *data, uint8_t keylen, uint32_t keycnt) {
+
+    if (keycnt < 2)
+        return keycnt;
+
+    uint32_t slots = 1;
+    while (slots < keycnt * 2) {
+        slots <<= 1;
+    }
+
+    // slot value is key index + 1, zero is empty
+    uint32_t *table = calloc(slots, sizeof(uint32_t));
+    if (table == NULL)
+        return keycnt;
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < keycnt; i++) {
+        const uint8_t *key = data + (i * keylen);
+        uint32_t h = (uint32_t)dict_fnv1a(key, keylen) & (slots - 1);
+        bool dup = false;
+        while (table[h]) {
+            if (memcmp(data + ((table[h] - 1) * keylen), key, keylen) == 0) {
+                dup = true;
+                break;
+            }
+            h = (h + 1) & (slots - 1);
+        }
+
+        if (dup)
+            continue;
+
+        if (n != i) {
+            memmove(data + (n * keylen), key, keylen);
+        }
+        table[h] = ++n;
+    }
+    free(table);
+    return n;
+}
+
+static bool dict_cache_load(const char *src, uint8_t keylen, void **pdata, uint32_t *keycnt) {
+
+    uint64_t src_size;
+    int64_t src_mtime;
+    if (dict_source_stat(src, &src_size, &src_mtime) == false)
+        return false;
+
+    char *path = dict_cache_path(src, keylen, false);
+    if (path == NULL)
+        return false;
+
+    FILE *f = fopen(path, "rb");
+    free(path);
+    if (f == NULL)
+        return false;
+
+    dict_cache_header_t hdr;
+    char srcpath[strlen(src) + 1];
+    bool ok = (fread(&hdr, sizeof(hdr), 1, f) == 1)
+              && hdr.magic == DICT_CACHE_MAGIC
+              && hdr.version == DICT_CACHE_VERSION
+              && hdr.keylen == keylen
+              && hdr.src_size == src_size
+              && hdr.src_mtime == src_mtime
+              && hdr.keycnt > 0
+              && hdr.pathlen == strlen(src)
+              && fread(srcpath, hdr.pathlen, 1, f) == 1
+              && memcmp(srcpath, src, hdr.pathlen) == 0;
+
+    uint8_t *data = NULL;
+    if (ok) {
+        data = calloc(hdr.keycnt, keylen);
+        ok = (data != NULL) && (fread(data, keylen, hdr.keycnt, f) == hdr.keycnt);
+    }
+    fclose(f);
+
+    if (ok == false) {
+        free(data);
+        return false;
+    }
+
+    *pdata = data;
+    *keycnt = hdr.keycnt;
+    return true;
+}
+
+static void dict_cache_save(const char *src, uint8_t keylen, const uint8_t *data, uint32_t keycnt) {
+
+    dict_cache_header_t hdr = {
+        .magic = DICT_CACHE_MAGIC,
+        .version = DICT_CACHE_VERSION,
+        .keylen = keylen,
+        .keycnt = keycnt,
+        .pathlen = strlen(src),
+    };
+
+    uint64_t src_size;
+    int64_t src_mtime;
+    if (keycnt == 0 || dict_source_stat(src, &src_size, &src_mtime) == false)
+        return;
+
+    hdr.src_size = src_size;
+    hdr.src_mtime = src_mtime;
+
+    char *path = dict_cache_path(src, keylen, true);
+    if (path == NULL)
+        return;
+
+    // write next to it and rename, parallel runs never see a partial file
+    char tmppath[strlen(path) + 16];
+    snprintf(tmppath, sizeof(tmppath), "%s.%u", path, (unsigned int)(msclock() & 0xFFFFFF));
+
+    FILE *f = fopen(tmppath, "wb");
+    if (f == NULL) {
+        free(path);
+        return;
+    }
+
+    bool ok = (fwrite(&hdr, sizeof(hdr), 1, f) == 1)
+              && (fwrite(src, hdr.pathlen, 1, f) == 1)
+              && (fwrite(data, keylen, keycnt, f) == keycnt);
+
+    ok &= (fclose(f) == 0);
+
+#ifdef _WIN32
+    remove(path);
+#endif
+    if (ok == false || rename(tmppath, path) != 0) {
+        remove(tmppath);
+    } else {
+        PrintAndLogEx(DEBUG, "Saved dictionary cache to " _YELLOW_("%s"), path);
+    }
+    free(path);
+}
+
 int loadFileDICTIONARY_safe(const char *preferredName, void **pdata, uint8_t keylen, uint32_t *keycnt) {
 
     int retval = PM3_SUCCESS;
@@ -2266,6 +2567,14 @@ int loadFileDICTIONARY_safe(const char *preferredName, void **pdata, uint8_t key
         keylen = 6;
     }
 
+    if (dict_cache_load(path, keylen, pdata, keycnt)) {
+        PrintAndLogEx(SUCCESS, "Loaded " _GREEN_("%2d") " keys from dictionary file `" _YELLOW_("%s") "`", *keycnt, path);
+        PrintAndLogEx(DEBUG, "using dictionary cache");
+        memstats_note(MEMSTATS_DICTIONARY, (size_t)*keycnt * keylen);
+        free(path);
+        return PM3_SUCCESS;
+    }
+
     size_t mem_size;
     size_t block_size = 10 * keylen;
 
@@ -2330,6 +2639,15 @@ int loadFileDICTIONARY_safe(const char *preferredName, void **pdata, uint8_t key
         memset(line, 0, sizeof(line));
     }
     fclose(f);
+
+    uint32_t unique = dict_dedup((uint8_t *)*pdata, keylen >> 1, *keycnt);
+    if (unique != *keycnt) {
+        PrintAndLogEx(DEBUG, "skipped " _YELLOW_("%u") " duplicate keys", *keycnt - unique);
+        *keycnt = unique;
+    }
+    dict_cache_save(path, keylen >> 1, (uint8_t *)*pdata, *keycnt);
+    memstats_note(MEMSTATS_DICTIONARY, mem_size);
+
     PrintAndLogEx(SUCCESS, "Loaded " _GREEN_("%2d") " keys from dictionary file `" _YELLOW_("%s") "`", *keycnt, path);
 
 out:
@@ -2935,6 +3253,9 @@ int searchFile(char **foundpath, const char *pm3dir, const char *searchname, con
     if (is_directory(searchname))
         return PM3_EINVARG;
 
+    // a dump still queued for writing must land before anyone looks for it
+    pm3_save_dump_flush();
+
     char *filename = filenamemcopy(searchname, suffix);
     if (filename == NULL)
         return PM3_EMALLOC;
@@ -3023,25 +3344,13 @@ int pm3_load_dump(const char *fn, void **pdump, size_t *dumplen, size_t maxdumpl
     return res;
 }
 
-int pm3_save_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
-    if (fn == NULL || strlen(fn) == 0) {
-        return PM3_EINVARG;
-    }
-    if (d == NULL || n == 0) {
-        PrintAndLogEx(INFO, "No data to save, skipping...");
-        return PM3_EINVARG;
-    }
+static void save_dump_now(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
     saveFile(fn, ".bin", d, n);
     saveFileJSON(fn, jsft, d, n, NULL);
-    return PM3_SUCCESS;
 }
 
-int pm3_save_mf_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
+static void save_mf_dump_now(const char *fn, uint8_t *d, size_t n) {
 
-    if (fn == NULL || d == NULL || n == 0) {
-        PrintAndLogEx(INFO, "No data to save, skipping...");
-        return PM3_EINVARG;
-    }
     saveFile(fn, ".bin", d, n);
 
     iso14a_mf_extdump_t jd = {0};
@@ -3066,6 +3375,150 @@ int pm3_save_mf_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
     jd.dump = d;
     jd.dumplen = n;
     saveFileJSON(fn, jsfMfc_v2, (uint8_t *)&jd, sizeof(jd), NULL);
+}
+
+// Dump writer queue. Dumps are copied and written in order by one background thread,
+// so the command returns as soon as the card is read. Loading a file waits for the queue.
+typedef struct dump_job_s {
+    struct dump_job_s *next;
+    char *fn;
+    uint8_t *d;
+    size_t n;
+    JSONFileType jsft;
+    bool mfc;
+} dump_job_t;
+
+static pthread_mutex_t dump_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dump_queue_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t dump_queue_idle = PTHREAD_COND_INITIALIZER;
+static dump_job_t *dump_queue_head = NULL;
+static dump_job_t *dump_queue_tail = NULL;
+static bool dump_writer_busy = false;
+static bool dump_writer_started = false;
+static pthread_t dump_writer;
+
+static void *dump_writer_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&dump_queue_lock);
+    for (;;) {
+        while (dump_queue_head == NULL) {
+            pthread_cond_wait(&dump_queue_wake, &dump_queue_lock);
+        }
+
+        dump_job_t *job = dump_queue_head;
+        dump_queue_head = job->next;
+        if (dump_queue_head == NULL) {
+            dump_queue_tail = NULL;
+        }
+        dump_writer_busy = true;
+        pthread_mutex_unlock(&dump_queue_lock);
+
+        if (job->mfc) {
+            save_mf_dump_now(job->fn, job->d, job->n);
+        } else {
+            save_dump_now(job->fn, job->d, job->n, job->jsft);
+        }
+        free(job->fn);
+        free(job->d);
+        free(job);
+
+        pthread_mutex_lock(&dump_queue_lock);
+        dump_writer_busy = false;
+        if (dump_queue_head == NULL) {
+            pthread_cond_broadcast(&dump_queue_idle);
+        }
+    }
+    return NULL;
+}
+
+// caller holds dump_queue_lock
+static bool dump_writer_start(void) {
+    if (dump_writer_started) {
+        return true;
+    }
+    if (pthread_create(&dump_writer, NULL, dump_writer_thread, NULL) != 0) {
+        return false;
+    }
+    pthread_detach(dump_writer);
+    dump_writer_started = true;
+    atexit(pm3_save_dump_flush);
+    return true;
+}
+
+static int dump_queue_push(const char *fn, const uint8_t *d, size_t n, JSONFileType jsft, bool mfc) {
+
+    dump_job_t *job = calloc(1, sizeof(dump_job_t));
+    if (job) {
+        job->fn = strdup(fn);
+        job->d = calloc(n, sizeof(uint8_t));
+    }
+    if (job == NULL || job->fn == NULL || job->d == NULL) {
+        if (job) {
+            free(job->fn);
+            free(job->d);
+            free(job);
+        }
+        return PM3_EMALLOC;
+    }
+
+    memcpy(job->d, d, n);
+    job->n = n;
+    job->jsft = jsft;
+    job->mfc = mfc;
+
+    pthread_mutex_lock(&dump_queue_lock);
+    if (dump_writer_start() == false) {
+        pthread_mutex_unlock(&dump_queue_lock);
+        free(job->fn);
+        free(job->d);
+        free(job);
+        return PM3_ESOFT;
+    }
+
+    if (dump_queue_tail) {
+        dump_queue_tail->next = job;
+    } else {
+        dump_queue_head = job;
+    }
+    dump_queue_tail = job;
+    pthread_cond_signal(&dump_queue_wake);
+    pthread_mutex_unlock(&dump_queue_lock);
+    return PM3_SUCCESS;
+}
+
+void pm3_save_dump_flush(void) {
+    pthread_mutex_lock(&dump_queue_lock);
+    if (dump_writer_started && pthread_equal(pthread_self(), dump_writer) == 0) {
+        while (dump_queue_head || dump_writer_busy) {
+            pthread_cond_wait(&dump_queue_idle, &dump_queue_lock);
+        }
+    }
+    pthread_mutex_unlock(&dump_queue_lock);
+}
+
+int pm3_save_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
+    if (fn == NULL || strlen(fn) == 0) {
+        return PM3_EINVARG;
+    }
+    if (d == NULL || n == 0) {
+        PrintAndLogEx(INFO, "No data to save, skipping...");
+        return PM3_EINVARG;
+    }
+    if (dump_queue_push(fn, d, n, jsft, false) != PM3_SUCCESS) {
+        save_dump_now(fn, d, n, jsft);
+    }
+    return PM3_SUCCESS;
+}
+
+int pm3_save_mf_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft) {
+    (void)jsft;
+    if (fn == NULL || d == NULL || n == 0) {
+        PrintAndLogEx(INFO, "No data to save, skipping...");
+        return PM3_EINVARG;
+    }
+    if (dump_queue_push(fn, d, n, jsfMfc_v2, true) != PM3_SUCCESS) {
+        save_mf_dump_now(fn, d, n);
+    }
     return PM3_SUCCESS;
 }
 
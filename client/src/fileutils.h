@@ -101,6 +101,14 @@ typedef enum {
     NFC_DF_PICOPASS,
 } nfc_df_e;
 
+// file backed buffer, see createMappedFile()
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    char *filename;
+    int fd;
+} mapped_file_t;
+
 int fileExists(const char *filename);
 
 // set a path in the path list g_session.defaultPaths
@@ -124,6 +132,28 @@ void truncate_filename(char *fn,  uint16_t maxlen);
  */
 int saveFile(const char *preferredName, const char *suffix, const void *data, size_t datalen);
 
+/**
+ * @brief Utility function to create a file of a given size and map it in memory for writing.
+ * Large captures can be written straight into the file without holding them all in RAM.
+ * On platforms without mmap a heap buffer is used and written out by closeMappedFile().
+ *
+ * @param preferredName
+ * @param suffix the file suffix. Including the ".".
+ * @param size number of bytes to map
+ * @param mf the mapping, mf->data points to the writable buffer
+ * @return PM3_SUCCESS for ok, PM3_E* for failz
+ */
+int createMappedFile(const char *preferredName, const char *suffix, size_t size, mapped_file_t *mf);
+
+/**
+ * @brief Unmaps a file created by createMappedFile() and truncates it to the used length.
+ *
+ * @param mf the mapping
+ * @param used number of bytes actually written
+ * @return PM3_SUCCESS for ok, PM3_E* for failz
+ */
+int closeMappedFile(mapped_file_t *mf, size_t used);
+
 /** STUB
  * @brief Utility function to save JSON data to a file. This method takes a preferred name, but if that
  * file already exists, it tries with another name until it finds something suitable.
@@ -269,6 +299,8 @@ int loadFileDICTIONARYEx(const char *preferredName, void *data, size_t maxdatale
 /**
  * @brief  Utility function to load data safely from a DICTIONARY textfile. This method takes a preferred name.
  * E.g. mfc_default_keys.dic
+ * Duplicate keys are dropped. The parsed keys are cached in ~/.proxmark3/cache and reused
+ * until the dictionary file changes.
  *
  * @param preferredName
  * @param pdata A pointer to a pointer  (for reverencing the loaded dictionary)
@@ -344,4 +376,10 @@ int pm3_save_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft);
  * @return PM3_SUCCESS if OK
  */
 int pm3_save_mf_dump(const char *fn, uint8_t *d, size_t n, JSONFileType jsft);
+
+/**
+ * @brief Wait until every dump queued by pm3_save_dump / pm3_save_mf_dump is written.
+ * The dump functions copy the data and write it from a background thread.
+ */
+void pm3_save_dump_flush(void);
 #endif // FILEUTILS_H
@@ -30,6 +30,7 @@
 #include "util_posix.h"
 #include "comms.h"
 #include "commonutil.h"
+#include "crc32.h"
 
 #define FLASH_START            0x100000
 
@@ -38,7 +39,12 @@
 
 #define BLOCK_SIZE             0x200
 
-#define FLASHER_VERSION        BL_VERSION_1_0_0
+#define FLASHER_VERSION        BL_VERSION_1_1_0
+
+// CMD_FINISH_WRITE sent before waiting for the oldest ACK
+#define WRITE_WINDOW           4
+
+static bool gs_bl_flash_crc = false;
 
 static const uint8_t elf_ident[] = {
     0x7f, 'E', 'L', 'F',
@@ -522,6 +528,8 @@ int flash_start_flashing(int enable_bl_writes, char *serial_port_name, uint32_t
     if (ret != PM3_SUCCESS)
         return ret;
 
+    gs_bl_flash_crc = (state & DEVICE_INFO_FLAG_UNDERSTANDS_FLASH_CRC) == DEVICE_INFO_FLAG_UNDERSTANDS_FLASH_CRC;
+
     if (state & DEVICE_INFO_FLAG_UNDERSTANDS_CHIP_INFO) {
         SendCommandBL(CMD_CHIP_INFO, 0, 0, 0, NULL, 0);
         PacketResponseNG resp;
@@ -607,16 +615,19 @@ int flash_reboot_bootloader(char *serial_port_name, bool wait_appear) {
     return enter_bootloader(serial_port_name, wait_appear);
 }
 
-static int write_block(uint32_t address, uint8_t *data, uint32_t length) {
+static void send_block(uint32_t address, uint8_t *data, uint32_t length) {
     uint8_t block_buf[BLOCK_SIZE];
     memset(block_buf, 0xFF, BLOCK_SIZE);
     memcpy(block_buf, data, length);
-    PacketResponseNG resp;
 #if defined ICOPYX
     SendCommandBL(CMD_FINISH_WRITE, address, 0xff, 0x1fd, block_buf, length);
 #else
     SendCommandBL(CMD_FINISH_WRITE, address, 0, 0, block_buf, length);
 #endif
+}
+
+static int wait_block_ack(void) {
+    PacketResponseNG resp;
     int ret = wait_for_ack(&resp);
     if (ret && resp.oldarg[0]) {
         uint32_t lock_bits = resp.oldarg[0] >> 16;
@@ -631,6 +642,29 @@ static int write_block(uint32_t address, uint8_t *data, uint32_t length) {
     return ret;
 }
 
+// Ask the bootloader for the CRC of every block of a segment.
+// Returns false if it can't,  then every block gets written
+static bool get_flash_crcs(uint32_t address, uint32_t blocks, uint32_t *crcs) {
+    if (gs_bl_flash_crc == false)
+        return false;
+
+    for (uint32_t done = 0; done < blocks;) {
+        uint32_t n = MIN(blocks - done, BL_FLASH_CRC_MAX_BLOCKS);
+        SendCommandBL(CMD_BL_FLASH_CRC, address + (done * BLOCK_SIZE), n, 0, NULL, 0);
+
+        PacketResponseNG resp;
+        if (WaitForResponseTimeout(CMD_BL_FLASH_CRC, &resp, 2000) == false)
+            return false;
+
+        if (resp.oldarg[1] != n)
+            return false;
+
+        memcpy(crcs + done, resp.data.asBytes, n * sizeof(uint32_t));
+        done += n;
+    }
+    return true;
+}
+
 static const char ice[] =
     "...................................................................\n        @@@  @@@@@@@ @@@@@@@@ @@@@@@@@@@   @@@@@@  @@@  @@@\n"
     "        @@! !@@      @@!      @@! @@! @@! @@!  @@@ @@!@!@@@\n        !!@ !@!      @!!!:!   @!! !!@ @!@ @!@!@!@! @!@@!!@!\n"
@@ -642,6 +676,8 @@ static const char ice[] =
     ;
 
 // Write a file's segments to Flash
+// Blocks the bootloader reports with the same CRC are skipped,  the others are sent
+// WRITE_WINDOW ahead of their ACKs so USB transfers overlap with the page programming.
 int flash_write(flash_file_t *ctx) {
     int len = 0;
 
@@ -658,7 +694,15 @@ int flash_write(flash_file_t *ctx) {
 
         PrintAndLogEx(SUCCESS, " 0x%08x..0x%08x [0x%x / %u blocks]", seg->start, end - 1, length, blocks);
         fflush(stdout);
-        int block = 0;
+
+        uint32_t *crcs = calloc(blocks, sizeof(uint32_t));
+        bool have_crcs = (crcs != NULL) && get_flash_crcs(seg->start, blocks, crcs);
+
+        uint32_t block = 0;
+        uint32_t skipped = 0;
+        uint32_t pending = 0;
+        uint32_t inflight[WRITE_WINDOW];    // block numbers waiting for their ACK,  oldest at sent - pending
+        uint32_t sent = 0;
         uint8_t *data = seg->data;
         uint32_t baddr = seg->start;
 
@@ -667,9 +711,31 @@ int flash_write(flash_file_t *ctx) {
             if (block_size > BLOCK_SIZE)
                 block_size = BLOCK_SIZE;
 
-            if (write_block(baddr, data, block_size) < 0) {
-                PrintAndLogEx(ERR, "Error writing block %d of %u", block, blocks);
-                return PM3_EFATAL;
+            bool unchanged = false;
+            if (have_crcs) {
+                // the device holds the block padded with 0xFF,  as send_block() writes it
+                uint8_t block_buf[BLOCK_SIZE];
+                memset(block_buf, 0xFF, BLOCK_SIZE);
+                memcpy(block_buf, data, block_size);
+                uint8_t crc[4];
+                crc32_ex(block_buf, BLOCK_SIZE, crc);
+                unchanged = (MemLeToUint4byte(crc) == crcs[block]);
+            }
+
+            if (unchanged) {
+                skipped++;
+            } else {
+                if (pending == WRITE_WINDOW) {
+                    if (wait_block_ack() < 0) {
+                        PrintAndLogEx(ERR, "Error writing block %u of %u", inflight[(sent - pending) % WRITE_WINDOW], blocks);
+                        free(crcs);
+                        return PM3_EFATAL;
+                    }
+                    pending--;
+                }
+                send_block(baddr, data, block_size);
+                inflight[sent++ % WRITE_WINDOW] = block;
+                pending++;
             }
 
             data += block_size;
@@ -687,7 +753,22 @@ int flash_write(flash_file_t *ctx) {
             }
             fflush(stdout);
         }
-        PrintAndLogEx(NORMAL, " " _GREEN_("ok"));
+
+        while (pending) {
+            if (wait_block_ack() < 0) {
+                PrintAndLogEx(ERR, "Error writing block %u of %u", inflight[(sent - pending) % WRITE_WINDOW], blocks);
+                free(crcs);
+                return PM3_EFATAL;
+            }
+            pending--;
+        }
+        free(crcs);
+
+        if (skipped) {
+            PrintAndLogEx(NORMAL, " " _GREEN_("ok") " ( %u unchanged blocks skipped )", skipped);
+        } else {
+            PrintAndLogEx(NORMAL, " " _GREEN_("ok"));
+        }
         fflush(stdout);
     }
     return PM3_SUCCESS;
@@ -16,6 +16,7 @@
 // Graph utilities
 //-----------------------------------------------------------------------------
 #include "graph.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "ui.h"
@@ -24,11 +25,13 @@
 #include "lfdemod.h"
 #include "cmddata.h"        // for g_debugmode
 #include "commonutil.h"     // Uint4bytetomemle
+#include "memstats.h"
+#include "pm3_cmd.h"        // lf_window_hdr_t
 
 
-int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+int32_t *g_GraphBuffer = NULL;
+int32_t *g_OperationBuffer = NULL;
+int32_t *g_OverlayBuffer = NULL;
 bool    g_useOverlays = false;
 size_t  g_GraphTraceLen;
 buffer_savestate_t g_saveState_gb;
@@ -36,6 +39,133 @@ marker_t g_MarkerA, g_MarkerB, g_MarkerC, g_MarkerD;
 marker_t *g_TempMarkers;
 uint8_t g_TempMarkerSize = 0;
 
+// Clock detection results for the current graph buffer.
+// Most writers poke g_GraphBuffer directly, so the entries are keyed on a fingerprint
+// of the samples the detectors get to see, and not on who wrote the buffer last.
+typedef enum {
+    CLOCK_CACHE_ASK,
+    CLOCK_CACHE_PSK,
+    CLOCK_CACHE_NRZ,
+    CLOCK_CACHE_FSK,
+    CLOCK_CACHE_PSK_FC,
+    CLOCK_CACHE_MAX
+} clock_cache_kind_t;
+
+typedef struct {
+    bool     valid;
+    size_t   size;
+    uint64_t hash;
+    int      clock;
+    int      start;     // best start / first phase shift / first clock edge
+    uint16_t fc;        // countFC() answer
+} clock_cache_t;
+
+static clock_cache_t clock_cache[CLOCK_CACHE_MAX];
+
+// the detectors also read the signal properties (hi / lo / mean), they are part of the key
+static uint64_t graph_fingerprint(const uint8_t *samples, size_t size) {
+    const signal_t *sp = getSignalProperties();
+    uint64_t h = 0xcbf29ce484222325ULL ^ size;
+    h = (h ^ (uint32_t)sp->high) * 0x100000001b3ULL;
+    h = (h ^ (uint32_t)sp->low) * 0x100000001b3ULL;
+    h = (h ^ (uint32_t)sp->mean) * 0x100000001b3ULL;
+    h = (h ^ (uint32_t)sp->amplitude) * 0x100000001b3ULL;
+    h = (h ^ sp->isnoise) * 0x100000001b3ULL;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t w;
+        memcpy(&w, samples + i, sizeof(w));
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < size; i++) {
+        h = (h ^ samples[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static const clock_cache_t *clock_cache_get(clock_cache_kind_t kind, size_t size, uint64_t hash) {
+    // keep the debug output of the detectors
+    if (g_debugMode) {
+        return NULL;
+    }
+    const clock_cache_t *e = &clock_cache[kind];
+    if (e->valid && e->size == size && e->hash == hash) {
+        return e;
+    }
+    return NULL;
+}
+
+static void clock_cache_set(clock_cache_kind_t kind, size_t size, uint64_t hash, int clock, int start, uint16_t fc) {
+    clock_cache_t *e = &clock_cache[kind];
+    e->valid = true;
+    e->size = size;
+    e->hash = hash;
+    e->clock = clock;
+    e->start = start;
+    e->fc = fc;
+}
+
+// Smallest allocation, one plain lf trace.  Some demods read a little past g_GraphTraceLen
+#define GRAPH_MIN_CAPACITY (MAX_GRAPH_TRACE_LEN / 32)
+
+static size_t graph_capacity = 0;
+
+static int32_t *graph_grow(int32_t *buf, size_t old_cap, size_t new_cap) {
+    int32_t *tmp = realloc(buf, new_cap * sizeof(int32_t));
+    if (tmp == NULL) {
+        return NULL;
+    }
+    memset(tmp + old_cap, 0x00, (new_cap - old_cap) * sizeof(int32_t));
+    memstats_alloc(MEMSTATS_GRAPH, (new_cap - old_cap) * sizeof(int32_t));
+    return tmp;
+}
+
+// make room for len samples in all three graph buffers
+bool GraphReserve(size_t len) {
+
+    if (len > MAX_GRAPH_TRACE_LEN) {
+        return false;
+    }
+
+    if (len <= graph_capacity) {
+        return true;
+    }
+
+    size_t cap = (graph_capacity) ? graph_capacity * 2 : GRAPH_MIN_CAPACITY;
+    while (cap < len) {
+        cap *= 2;
+    }
+    if (cap > MAX_GRAPH_TRACE_LEN) {
+        cap = MAX_GRAPH_TRACE_LEN;
+    }
+
+    int32_t *gb = graph_grow(g_GraphBuffer, graph_capacity, cap);
+    if (gb == NULL) {
+        PrintAndLogEx(WARNING, "failed to allocate memory for the graph buffer");
+        return false;
+    }
+    g_GraphBuffer = gb;
+
+    int32_t *ob = graph_grow(g_OperationBuffer, graph_capacity, cap);
+    if (ob == NULL) {
+        PrintAndLogEx(WARNING, "failed to allocate memory for the graph buffer");
+        return false;
+    }
+    g_OperationBuffer = ob;
+
+    int32_t *ov = graph_grow(g_OverlayBuffer, graph_capacity, cap);
+    if (ov == NULL) {
+        PrintAndLogEx(WARNING, "failed to allocate memory for the graph buffer");
+        return false;
+    }
+    g_OverlayBuffer = ov;
+
+    graph_capacity = cap;
+    return true;
+}
+
 /* write a manchester bit to the graph
 */
 void AppendGraph(bool redraw, uint16_t clock, int bit) {
@@ -57,6 +187,10 @@ void AppendGraph(bool redraw, uint16_t clock, int bit) {
         end = MAX_GRAPH_TRACE_LEN - g_GraphTraceLen;
     }
 
+    if (GraphReserve(g_GraphTraceLen + end) == false) {
+        return;
+    }
+
     //set first half the clock bit (all 1's or 0's for a 0 or 1 bit)
     for (i = 0; i < half; ++i) {
         g_GraphBuffer[g_GraphTraceLen++] = bit;
@@ -76,15 +210,18 @@ void AppendGraph(bool redraw, uint16_t clock, int bit) {
 size_t ClearGraph(bool redraw) {
     size_t gtl = g_GraphTraceLen;
 
-    memset(g_GraphBuffer, 0x00, g_GraphTraceLen);
-    memset(g_OperationBuffer, 0x00, g_GraphTraceLen);
-    memset(g_OverlayBuffer, 0x00, g_GraphTraceLen);
+    if (g_GraphTraceLen) {
+        memset(g_GraphBuffer, 0x00, g_GraphTraceLen * sizeof(int32_t));
+        memset(g_OperationBuffer, 0x00, g_GraphTraceLen * sizeof(int32_t));
+        memset(g_OverlayBuffer, 0x00, g_GraphTraceLen * sizeof(int32_t));
+    }
 
     g_GraphTraceLen = 0;
     g_GraphStart = 0;
     g_GraphStop = 0;
     g_DemodBufferLen = 0;
     g_useOverlays = false;
+    memset(clock_cache, 0, sizeof(clock_cache));
 
     remove_temporary_markers();
     g_MarkerA.pos = 0;
@@ -110,6 +247,10 @@ void setGraphBuffer(const uint8_t *src, size_t size) {
         size = MAX_GRAPH_TRACE_LEN;
     }
 
+    if (GraphReserve(size) == false) {
+        return;
+    }
+
     for (size_t i = 0; i < size; ++i) {
         g_GraphBuffer[i] = src[i] - 128;
         g_OperationBuffer[i] = src[i] - 128;
@@ -120,6 +261,83 @@ void setGraphBuffer(const uint8_t *src, size_t size) {
     RepaintGraphWindow();
 }
 
+// Rebuild the graph from a windowed lf capture,  lf_window_hdr_t + 8 bit samples back to back.
+// Silence between two windows shrinks to at most max_gap samples,  the real position of every
+// window goes into a temporary marker. Returns the number of windows placed
+uint32_t setGraphFromWindows(const uint8_t *src, size_t len, uint32_t max_gap) {
+
+    ClearGraph(false);
+
+    if (src == NULL) {
+        return 0;
+    }
+
+    size_t pos = 0, off = 0;
+    uint32_t windows = 0;
+    uint64_t prev_end = 0;
+
+    while (off + sizeof(lf_window_hdr_t) <= len) {
+
+        lf_window_hdr_t hdr;
+        memcpy(&hdr, src + off, sizeof(hdr));
+        off += sizeof(hdr);
+
+        if (hdr.len == 0 || off + hdr.len > len) {
+            break;
+        }
+
+        uint64_t gap = 0;
+        if (windows && hdr.start > prev_end) {
+            gap = MIN(hdr.start - prev_end, max_gap);
+        }
+
+        if (pos + gap + hdr.len > MAX_GRAPH_TRACE_LEN) {
+            PrintAndLogEx(WARNING, "Graph full, showing the first " _YELLOW_("%u") " windows", windows);
+            break;
+        }
+
+        if (GraphReserve(pos + gap + hdr.len) == false) {
+            break;
+        }
+
+        for (uint64_t i = 0; i < gap; i++, pos++) {
+            g_GraphBuffer[pos] = 0;
+            g_OperationBuffer[pos] = 0;
+        }
+
+        // marker count is an uint8_t
+        if (g_TempMarkerSize < UINT8_MAX) {
+            char label[30];
+            snprintf(label, sizeof(label), "@%u", hdr.start);
+            add_temporary_marker(pos, label);
+        }
+
+        for (uint16_t i = 0; i < hdr.len; i++, pos++) {
+            g_GraphBuffer[pos] = ((int)src[off + i]) - 127;
+            g_OperationBuffer[pos] = g_GraphBuffer[pos];
+        }
+
+        off += hdr.len;
+        prev_end = (uint64_t)hdr.start + hdr.len;
+        windows++;
+    }
+
+    g_GraphTraceLen = pos;
+
+    if (pos) {
+        uint8_t *bits = calloc(pos, sizeof(uint8_t));
+        if (bits != NULL) {
+            size_t size = getFromGraphBuffer(bits);
+            // set signal properties low/high/mean/amplitude and is_noise detection
+            computeSignalProperties(bits, size);
+            free(bits);
+        }
+    }
+
+    RepaintGraphWindow();
+    return windows;
+}
+
 // This function assumes that the length of dest array >= g_GraphTraceLen.
 // If the length of dest array is less than g_GraphTraceLen, use getFromGraphBufferEx(dest, maxLen) instead.
 size_t getFromGraphBuffer(uint8_t *dest) {
@@ -264,11 +482,21 @@ int GetAskClock(const char *str, bool verbose) {
         return -1;
     }
 
-    size_t ststart = 0, stend = 0;
-    bool st = DetectST(bits, &size, &clock1, &ststart, &stend);
-    int idx = stend;
-    if (st == false) {
-        idx = DetectASKClock(bits, size, &clock1, 20);
+    int idx = 0;
+    uint64_t hash = graph_fingerprint(bits, size);
+    const clock_cache_t *cached = clock_cache_get(CLOCK_CACHE_ASK, size, hash);
+    if (cached) {
+        clock1 = cached->clock;
+        idx = cached->start;
+    } else {
+        size_t cache_size = size;
+        size_t ststart = 0, stend = 0;
+        bool st = DetectST(bits, &size, &clock1, &ststart, &stend);
+        idx = stend;
+        if (st == false) {
+            idx = DetectASKClock(bits, size, &clock1, 20);
+        }
+        clock_cache_set(CLOCK_CACHE_ASK, cache_size, hash, clock1, idx, 0);
     }
 
     if (clock1 > 0) {
@@ -301,7 +529,15 @@ int GetPskCarrier(bool verbose) {
         return -1;
     }
 
-    uint16_t fc = countFC(bits, size, false);
+    uint16_t fc = 0;
+    uint64_t hash = graph_fingerprint(bits, size);
+    const clock_cache_t *cached = clock_cache_get(CLOCK_CACHE_PSK_FC, size, hash);
+    if (cached) {
+        fc = cached->fc;
+    } else {
+        fc = countFC(bits, size, false);
+        clock_cache_set(CLOCK_CACHE_PSK_FC, size, hash, 0, 0, fc);
+    }
     free(bits);
 
     uint8_t carrier = fc & 0xFF;
@@ -346,8 +582,16 @@ int GetPskClock(const char *str, bool verbose) {
     }
 
     size_t firstPhaseShiftLoc = 0;
-    uint8_t curPhase = 0, fc = 0;
-    clock1 = DetectPSKClock(bits, size, 0, &firstPhaseShiftLoc, &curPhase, &fc);
+    uint64_t hash = graph_fingerprint(bits, size);
+    const clock_cache_t *cached = clock_cache_get(CLOCK_CACHE_PSK, size, hash);
+    if (cached) {
+        clock1 = cached->clock;
+        firstPhaseShiftLoc = cached->start;
+    } else {
+        uint8_t curPhase = 0, fc = 0;
+        clock1 = DetectPSKClock(bits, size, 0, &firstPhaseShiftLoc, &curPhase, &fc);
+        clock_cache_set(CLOCK_CACHE_PSK, size, hash, clock1, firstPhaseShiftLoc, 0);
+    }
 
     if (clock1 >= 0) {
         setClockGrid(clock1, firstPhaseShiftLoc);
@@ -388,7 +632,15 @@ int GetNrzClock(const char *str, bool verbose) {
     }
 
     size_t clkStartIdx = 0;
-    clock1 = DetectNRZClock(bits, size, 0, &clkStartIdx);
+    uint64_t hash = graph_fingerprint(bits, size);
+    const clock_cache_t *cached = clock_cache_get(CLOCK_CACHE_NRZ, size, hash);
+    if (cached) {
+        clock1 = cached->clock;
+        clkStartIdx = cached->start;
+    } else {
+        clock1 = DetectNRZClock(bits, size, 0, &clkStartIdx);
+        clock_cache_set(CLOCK_CACHE_NRZ, size, hash, clock1, clkStartIdx, 0);
+    }
     setClockGrid(clock1, clkStartIdx);
     // Only print this message if we're not looping something
     if (verbose) {
@@ -448,16 +700,31 @@ bool fskClocks(uint8_t *fc1, uint8_t *fc2, uint8_t *rf1, int *firstClockEdge) {
         return false;
     }
 
-    uint16_t ans = countFC(bits, size, true);
+    uint16_t ans = 0;
+    uint64_t hash = graph_fingerprint(bits, size);
+    const clock_cache_t *cached = clock_cache_get(CLOCK_CACHE_FSK, size, hash);
+    if (cached) {
+        ans = cached->fc;
+    } else {
+        ans = countFC(bits, size, true);
+    }
+
     if (ans == 0) {
         PrintAndLogEx(DEBUG, "DEBUG: No data found");
+        clock_cache_set(CLOCK_CACHE_FSK, size, hash, 0, 0, 0);
         free(bits);
         return false;
     }
 
     *fc1 = (ans >> 8) & 0xFF;
     *fc2 = ans & 0xFF;
-    *rf1 = detectFSKClk(bits, size, *fc1, *fc2, firstClockEdge);
+    if (cached) {
+        *rf1 = cached->clock;
+        *firstClockEdge = cached->start;
+    } else {
+        *rf1 = detectFSKClk(bits, size, *fc1, *fc2, firstClockEdge);
+        clock_cache_set(CLOCK_CACHE_FSK, size, hash, *rf1, *firstClockEdge, ans);
+    }
 
     free(bits);
 
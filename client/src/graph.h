@@ -39,10 +39,12 @@ typedef struct {
     char label[30];
 } marker_t;
 
+bool GraphReserve(size_t len);
 void AppendGraph(bool redraw, uint16_t clock, int bit);
 size_t ClearGraph(bool redraw);
 bool HasGraphData(void);
 void setGraphBuffer(const uint8_t *src, size_t size);
+uint32_t setGraphFromWindows(const uint8_t *src, size_t len, uint32_t max_gap);
 size_t getFromGraphBuffer(uint8_t *dest);
 size_t getFromGraphBufferEx(uint8_t *dest, size_t maxLen);
 size_t getGraphBufferChunk(uint8_t *dest, size_t start, size_t end);
@@ -71,9 +73,11 @@ size_t restore_buffer8(buffer_savestate_t saveState, uint8_t *dest);
 #define GRAPH_SAVE 1
 #define GRAPH_RESTORE 0
 
-extern int32_t g_GraphBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OperationBuffer[MAX_GRAPH_TRACE_LEN];
-extern int32_t g_OverlayBuffer[MAX_GRAPH_TRACE_LEN];
+// Allocated on first use and grown by GraphReserve(), NULL while no graph was ever loaded.
+// Anything writing past g_GraphTraceLen has to reserve first.
+extern int32_t *g_GraphBuffer;
+extern int32_t *g_OperationBuffer;
+extern int32_t *g_OverlayBuffer;
 extern bool    g_useOverlays;
 extern size_t  g_GraphTraceLen;
 
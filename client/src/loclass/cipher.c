@@ -38,6 +38,7 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include "commonutil.h"     // MemLeToUint4byte
 #ifndef ON_DEVICE
 #include "fileutils.h"
 #endif
@@ -276,6 +277,187 @@ void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_ke
     free(address_data);
 }
 
+/*
+ * Iterative version of doMAC(),  same technique as armsrc/optimized_cipher.c.
+ * Bits are taken LSB first,  so neither input nor output bytes need reversing.
+ * The loclass attack calculates a MAC for every key candidate, this is its hot path.
+ */
+static const uint8_t opt_select_LUT[256] = {
+    00, 03, 02, 01, 02, 03, 00, 01, 04, 07, 07, 04, 06, 07, 05, 04,
+    01, 02, 03, 00, 02, 03, 00, 01, 05, 06, 06, 05, 06, 07, 05, 04,
+    06, 05, 04, 07, 04, 05, 06, 07, 06, 05, 05, 06, 04, 05, 07, 06,
+    07, 04, 05, 06, 04, 05, 06, 07, 07, 04, 04, 07, 04, 05, 07, 06,
+    06, 05, 04, 07, 04, 05, 06, 07, 02, 01, 01, 02, 00, 01, 03, 02,
+    03, 00, 01, 02, 00, 01, 02, 03, 07, 04, 04, 07, 04, 05, 07, 06,
+    00, 03, 02, 01, 02, 03, 00, 01, 00, 03, 03, 00, 02, 03, 01, 00,
+    05, 06, 07, 04, 06, 07, 04, 05, 05, 06, 06, 05, 06, 07, 05, 04,
+    02, 01, 00, 03, 00, 01, 02, 03, 06, 05, 05, 06, 04, 05, 07, 06,
+    03, 00, 01, 02, 00, 01, 02, 03, 07, 04, 04, 07, 04, 05, 07, 06,
+    02, 01, 00, 03, 00, 01, 02, 03, 02, 01, 01, 02, 00, 01, 03, 02,
+    03, 00, 01, 02, 00, 01, 02, 03, 03, 00, 00, 03, 00, 01, 03, 02,
+    04, 07, 06, 05, 06, 07, 04, 05, 00, 03, 03, 00, 02, 03, 01, 00,
+    01, 02, 03, 00, 02, 03, 00, 01, 05, 06, 06, 05, 06, 07, 05, 04,
+    04, 07, 06, 05, 06, 07, 04, 05, 04, 07, 07, 04, 06, 07, 05, 04,
+    01, 02, 03, 00, 02, 03, 00, 01, 01, 02, 02, 01, 02, 03, 01, 00
+};
+
+static inline void opt_successor(const uint8_t *k, State_t *s, uint8_t y) {
+    uint16_t Tt = s->t & 0xc533;
+    Tt = Tt ^ (Tt >> 1);
+    Tt = Tt ^ (Tt >> 4);
+    Tt = Tt ^ (Tt >> 10);
+    Tt = Tt ^ (Tt >> 8);
+
+    s->t = (s->t >> 1);
+    s->t |= (Tt ^ (s->r >> 7) ^ (s->r >> 3)) << 15;
+
+    uint8_t opt_B = s->b;
+    opt_B ^= s->b >> 6;
+    opt_B ^= s->b >> 5;
+    opt_B ^= s->b >> 4;
+
+    s->b = s->b >> 1;
+    s->b |= (opt_B ^ s->r) << 7;
+
+    uint8_t opt_select = opt_select_LUT[s->r] & 0x04;
+    opt_select |= (opt_select_LUT[s->r] ^ ((Tt ^ y) << 1)) & 0x02;
+    opt_select |= (opt_select_LUT[s->r] ^ Tt) & 0x01;
+
+    uint8_t r = s->r;
+    s->r = (k[opt_select] ^ s->b) + s->l ;
+    s->l = s->r + r;
+}
+
+void doMAC_fast(const uint8_t *cc_nr, const uint8_t *div_key, uint8_t mac[4]) {
+    State_t s = {
+        ((div_key[0] ^ 0x4c) + 0xEC) & 0xFF,// l
+        ((div_key[0] ^ 0x4c) + 0x21) & 0xFF,// r
+        0x4c, // b
+        0xE012 // t
+    };
+
+    for (uint8_t i = 0; i < 12; i++) {
+        uint8_t head = cc_nr[i];
+        for (uint8_t j = 0; j < 8; j++) {
+            opt_successor(div_key, &s, head);
+            head >>= 1;
+        }
+    }
+
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t bout = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            bout |= ((s.r >> 2) & 1) << j;
+            opt_successor(div_key, &s, 0);
+        }
+        mac[i] = bout;
+    }
+}
+
+/*
+ * Same cipher as doMAC_fast(),  but for LOCLASS_MAC_LANES keys with a shared CC/NR at once.
+ * The state is kept per lane in arrays and the select() table lookup is replaced by its
+ * boolean expression,  so every step is plain arithmetic the compiler can vectorize.
+ */
+typedef struct {
+    uint32_t l[LOCLASS_MAC_LANES];
+    uint32_t r[LOCLASS_MAC_LANES];
+    uint32_t b[LOCLASS_MAC_LANES];
+    uint32_t t[LOCLASS_MAC_LANES];
+    // key bytes 0-3 and 4-7 as little endian words
+    uint32_t klo[LOCLASS_MAC_LANES];
+    uint32_t khi[LOCLASS_MAC_LANES];
+} lanes_state_t;
+
+static inline void opt_successor_lanes(lanes_state_t *s, uint32_t y) {
+    for (int n = 0; n < LOCLASS_MAC_LANES; n++) {
+
+        uint32_t tt = s->t[n] & 0xc533;
+        tt ^= tt >> 1;
+        tt ^= tt >> 4;
+        tt ^= tt >> 10;
+        tt ^= tt >> 8;
+        tt &= 1;
+
+        uint32_t r = s->r[n];
+        s->t[n] = (s->t[n] >> 1) | (((tt ^ (r >> 7) ^ (r >> 3)) & 1) << 15);
+
+        uint32_t ob = s->b[n] ^ (s->b[n] >> 6) ^ (s->b[n] >> 5) ^ (s->b[n] >> 4);
+        s->b[n] = ((s->b[n] >> 1) | (ob ^ r) << 7) & 0xFF;
+
+        // select(), see opt_select_LUT
+        uint32_t r_ls2 = (r << 2) & 0xFF;
+        uint32_t r_and_ls2 = r & r_ls2;
+        uint32_t r_or_ls2 = r | r_ls2;
+        uint32_t r_andn_ls2 = r & ~r_ls2;
+        uint32_t z0 = (r_and_ls2 >> 5) ^ (r_andn_ls2 >> 4) ^ (r_or_ls2 >> 3);
+        uint32_t z1 = (r_or_ls2 >> 6) ^ (r_or_ls2 >> 1) ^ (r >> 5) ^ r ^ ((tt ^ y) << 1);
+        uint32_t z2 = (r_andn_ls2 >> 4) ^ (r_and_ls2 >> 3) ^ r ^ tt;
+
+        // k[z0 z1 z2] as three masked muxes,  SSE2 has no per lane variable shift
+        uint32_t m0 = 0 - ((z0 >> 2) & 1);
+        uint32_t m1 = 0 - ((z1 >> 1) & 1);
+        uint32_t m2 = 0 - (z2 & 1);
+        uint32_t kw = (s->klo[n] & ~m0) | (s->khi[n] & m0);
+        kw = (kw & ~m1) | ((kw >> 16) & m1);
+        uint32_t kb = ((kw & ~m2) | ((kw >> 8) & m2)) & 0xFF;
+
+        s->r[n] = ((kb ^ s->b[n]) + s->l[n]) & 0xFF;
+        s->l[n] = (s->r[n] + r) & 0xFF;
+    }
+}
+
+static void doMAC_lanes(const uint8_t *cc_nr, lanes_state_t *s, uint32_t *out) {
+
+    for (int n = 0; n < LOCLASS_MAC_LANES; n++) {
+        uint32_t k0 = (s->klo[n] & 0xFF) ^ 0x4c;
+        s->l[n] = (k0 + 0xEC) & 0xFF;
+        s->r[n] = (k0 + 0x21) & 0xFF;
+        s->b[n] = 0x4c;
+        s->t[n] = 0xE012;
+        out[n] = 0;
+    }
+
+    for (int i = 0; i < 12 * 8; i++) {
+        opt_successor_lanes(s, (cc_nr[i >> 3] >> (i & 7)) & 1);
+    }
+
+    for (int i = 0; i < 32; i++) {
+        for (int n = 0; n < LOCLASS_MAC_LANES; n++) {
+            out[n] |= ((s->r[n] >> 2) & 1) << i;
+        }
+        opt_successor_lanes(s, 0);
+    }
+}
+
+// div_keys holds count * 8 bytes,  macs receives count * 4 bytes
+void doMAC_fast_multi(const uint8_t *cc_nr, const uint8_t *div_keys, uint32_t count, uint8_t *macs) {
+    lanes_state_t s;
+    uint32_t out[LOCLASS_MAC_LANES];
+
+    for (uint32_t i = 0; i < count; i += LOCLASS_MAC_LANES) {
+
+        uint32_t cnt = count - i;
+        if (cnt > LOCLASS_MAC_LANES)
+            cnt = LOCLASS_MAC_LANES;
+
+        // unused lanes of the last batch run on a zero key
+        memset(s.klo, 0, sizeof(s.klo));
+        memset(s.khi, 0, sizeof(s.khi));
+        for (uint32_t n = 0; n < cnt; n++) {
+            const uint8_t *dk = div_keys + (i + n) * 8;
+            s.klo[n] = MemLeToUint4byte(dk);
+            s.khi[n] = MemLeToUint4byte(dk + 4);
+        }
+
+        doMAC_lanes(cc_nr, &s, out);
+
+        for (uint32_t n = 0; n < cnt; n++) {
+            Uint4byteToMemLe(macs + (i + n) * 4, out[n]);
+        }
+    }
+}
+
 #ifndef ON_DEVICE
 int testMAC(void) {
     PrintAndLogEx(SUCCESS, "Testing MAC calculation...");
@@ -297,6 +479,40 @@ int testMAC(void) {
         printarr("    Correct_MAC   ", correct_MAC, 4);
         return PM3_ESOFT;
     }
+
+    memset(calculated_mac, 0, sizeof(calculated_mac));
+    doMAC_fast(cc_nr, div_key, calculated_mac);
+
+    if (memcmp(calculated_mac, correct_MAC, 4) == 0) {
+        PrintAndLogEx(SUCCESS, "    MAC calculation fast ( %s )", _GREEN_("ok"));
+    } else {
+        PrintAndLogEx(FAILED, "    MAC calculation fast ( %s )", _RED_("fail"));
+        printarr("    Calculated_MAC", calculated_mac, 4);
+        printarr("    Correct_MAC   ", correct_MAC, 4);
+        return PM3_ESOFT;
+    }
+
+    // more keys than lanes,  to cover a partial batch. First one is the paper key
+    uint8_t div_keys[(LOCLASS_MAC_LANES + 3) * 8];
+    uint8_t macs[(LOCLASS_MAC_LANES + 3) * 4];
+    for (uint8_t i = 0; i < LOCLASS_MAC_LANES + 3; i++) {
+        memcpy(div_keys + i * 8, div_key, 8);
+        div_keys[i * 8 + (i & 7)] ^= i;
+    }
+    doMAC_fast_multi(cc_nr, div_keys, LOCLASS_MAC_LANES + 3, macs);
+
+    bool multi_ok = (memcmp(macs, correct_MAC, 4) == 0);
+    for (uint8_t i = 1; i < LOCLASS_MAC_LANES + 3; i++) {
+        doMAC_fast(cc_nr, div_keys + i * 8, calculated_mac);
+        multi_ok &= (memcmp(macs + i * 4, calculated_mac, 4) == 0);
+    }
+
+    if (multi_ok) {
+        PrintAndLogEx(SUCCESS, "    MAC calculation multi ( %s )", _GREEN_("ok"));
+    } else {
+        PrintAndLogEx(FAILED, "    MAC calculation multi ( %s )", _RED_("fail"));
+        return PM3_ESOFT;
+    }
     return PM3_SUCCESS;
 }
 #endif
@@ -38,6 +38,11 @@
 #include "pm3_cmd.h"
 
 void doMAC(uint8_t *cc_nr_p, uint8_t *div_key_p, uint8_t mac[4]);
+void doMAC_fast(const uint8_t *cc_nr, const uint8_t *div_key, uint8_t mac[4]);
+
+// number of keys doMAC_fast_multi() processes side by side
+#define LOCLASS_MAC_LANES 16
+void doMAC_fast_multi(const uint8_t *cc_nr, const uint8_t *div_keys, uint32_t count, uint8_t *macs);
 void doMAC_N(uint8_t *address_data_p, uint8_t address_data_size, uint8_t *div_key_p, uint8_t mac[4]);
 
 #ifndef ON_DEVICE
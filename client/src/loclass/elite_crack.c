@@ -172,21 +172,23 @@ static void rk(const uint8_t *key, uint8_t n, uint8_t *outp_key) {
     }
 }
 
-static mbedtls_des_context ctx_enc;
-static mbedtls_des_context ctx_dec;
-
+// contexts are local, hash2() is called from several threads at once
 static void desdecrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_dec;
     mbedtls_des_setkey_dec(&ctx_dec, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_dec, input, output);
+    mbedtls_des_free(&ctx_dec);
 }
 
 static void desencrypt_iclass(uint8_t *iclass_key, uint8_t *input, uint8_t *output) {
     uint8_t key_std_format[8] = {0};
     permutekey_rev(iclass_key, key_std_format);
+    mbedtls_des_context ctx_enc;
     mbedtls_des_setkey_enc(&ctx_enc, key_std_format);
     mbedtls_des_crypt_ecb(&ctx_enc, input, output);
+    mbedtls_des_free(&ctx_enc);
 }
 
 /**
@@ -360,7 +362,7 @@ static void *bf_thread(void *thread_arg) {
 
         // Calc mac
         uint8_t calculated_MAC[4] = {0};
-        doMAC(cc_nr, div_key, calculated_MAC);
+        doMAC_fast(cc_nr, div_key, calculated_MAC);
 
         // success
         if (memcmp(calculated_MAC, mac, 4) == 0) {
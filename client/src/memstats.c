@@ -0,0 +1,128 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Client memory accounting of the big allocators,  per subsystem
+//-----------------------------------------------------------------------------
+#include "memstats.h"
+
+#include <stdio.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+typedef struct {
+    uint64_t current;
+    uint64_t peak;
+    uint64_t total;
+    uint64_t allocs;
+} memstats_counter_t;
+
+static memstats_counter_t counters[MEMSTATS_COUNT];
+
+static const struct {
+    const char *name;
+    bool live;
+} subsys_info[MEMSTATS_COUNT] = {
+    [MEMSTATS_HARDNESTED] = { "hardnested", true },
+    [MEMSTATS_NESTED]     = { "nested",     true },
+    [MEMSTATS_GRAPH]      = { "graph",      true },
+    [MEMSTATS_DICTIONARY] = { "dictionary", false },
+};
+
+static void raise_peak(memstats_counter_t *c, uint64_t v) {
+    uint64_t peak = __atomic_load_n(&c->peak, __ATOMIC_RELAXED);
+    while (v > peak) {
+        if (__atomic_compare_exchange_n(&c->peak, &peak, v, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+}
+
+void memstats_alloc(memstats_subsys_t s, size_t bytes) {
+    if (s >= MEMSTATS_COUNT || bytes == 0) {
+        return;
+    }
+    memstats_counter_t *c = &counters[s];
+    uint64_t now = __atomic_add_fetch(&c->current, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->total, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+    raise_peak(c, now);
+}
+
+void memstats_free(memstats_subsys_t s, size_t bytes) {
+    if (s >= MEMSTATS_COUNT || bytes == 0) {
+        return;
+    }
+    __atomic_sub_fetch(&counters[s].current, bytes, __ATOMIC_RELAXED);
+}
+
+void memstats_note(memstats_subsys_t s, size_t bytes) {
+    if (s >= MEMSTATS_COUNT || bytes == 0) {
+        return;
+    }
+    memstats_counter_t *c = &counters[s];
+    __atomic_add_fetch(&c->total, bytes, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&c->allocs, 1, __ATOMIC_RELAXED);
+    raise_peak(c, bytes);
+}
+
+void memstats_get(memstats_entry_t out[MEMSTATS_COUNT]) {
+    for (int i = 0; i < MEMSTATS_COUNT; i++) {
+        out[i].name = subsys_info[i].name;
+        out[i].live = subsys_info[i].live;
+        out[i].current = __atomic_load_n(&counters[i].current, __ATOMIC_RELAXED);
+        out[i].peak = __atomic_load_n(&counters[i].peak, __ATOMIC_RELAXED);
+        out[i].total = __atomic_load_n(&counters[i].total, __ATOMIC_RELAXED);
+        out[i].allocs = __atomic_load_n(&counters[i].allocs, __ATOMIC_RELAXED);
+    }
+}
+
+void memstats_reset_peak(void) {
+    for (int i = 0; i < MEMSTATS_COUNT; i++) {
+        __atomic_store_n(&counters[i].peak, __atomic_load_n(&counters[i].current, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+}
+
+bool memstats_process(uint64_t *rss, uint64_t *peak_rss) {
+    *rss = 0;
+    *peak_rss = 0;
+#ifdef _WIN32
+    return false;
+#else
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) {
+        return false;
+    }
+#ifdef __APPLE__
+    *peak_rss = (uint64_t)ru.ru_maxrss;
+#else
+    *peak_rss = (uint64_t)ru.ru_maxrss * 1024;
+#endif
+
+#ifdef __linux__
+    // second field is the resident size in pages
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f != NULL) {
+        unsigned long size = 0, resident = 0;
+        if (fscanf(f, "%lu %lu", &size, &resident) == 2) {
+            *rss = (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+        }
+        fclose(f);
+    }
+#endif
+    return (*rss || *peak_rss);
+#endif
+}
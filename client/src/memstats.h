@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Client memory accounting of the big allocators,  per subsystem
+//-----------------------------------------------------------------------------
+#ifndef MEMSTATS_H__
+#define MEMSTATS_H__
+
+#include "common.h"
+
+typedef enum {
+    MEMSTATS_HARDNESTED = 0,    // hardnested bitarrays
+    MEMSTATS_NESTED,            // nested / static nested key candidate lists
+    MEMSTATS_GRAPH,             // graph, operation and overlay buffers
+    MEMSTATS_DICTIONARY,        // loaded dictionaries
+    MEMSTATS_COUNT
+} memstats_subsys_t;
+
+typedef struct {
+    const char *name;
+    bool live;          // false, buffer is handed over to callers which free() it. Only loads are seen
+    uint64_t current;   // bytes held now
+    uint64_t peak;      // high water mark since start / last reset
+    uint64_t total;     // bytes allocated since start
+    uint64_t allocs;    // number of allocations since start
+} memstats_entry_t;
+
+// accounting only,  the caller does the actual allocation. Thread safe
+void memstats_alloc(memstats_subsys_t s, size_t bytes);
+void memstats_free(memstats_subsys_t s, size_t bytes);
+// a buffer of `bytes` handed over to a caller,  counts towards the peak but not the current usage
+void memstats_note(memstats_subsys_t s, size_t bytes);
+
+void memstats_get(memstats_entry_t out[MEMSTATS_COUNT]);
+// peaks drop to the current usage
+void memstats_reset_peak(void);
+
+// resident set size of the whole process,  false if the platform doesn't tell
+bool memstats_process(uint64_t *rss, uint64_t *peak_rss);
+
+#endif
@@ -217,10 +217,15 @@ const char *nxp_cluster_to_text(uint8_t cluster) {
     return "reserved";
 }
 
+// aid_desfire.json is parsed on first use and kept for the session
 static json_t *df_known_aids = NULL;
+static json_t *df_known_aids_index = NULL;
 
 static int open_aiddf_file(json_t **root, bool verbose) {
 
+    if (*root)
+        return PM3_SUCCESS;
+
     char *path;
     int res = searchFile(&path, RESOURCES_SUBDIR, "aid_desfire", ".json", true);
     if (res != PM3_SUCCESS) {
@@ -250,16 +255,16 @@ static int open_aiddf_file(json_t **root, bool verbose) {
                      );
     }
 
+    df_known_aids_index = JsonIndexArray(*root, "AID", true);
 out:
+    if (retval != PM3_SUCCESS) {
+        json_decref(*root);
+        *root = NULL;
+    }
     free(path);
     return retval;
 }
 
-static int close_aiddf_file(json_t *root) {
-    json_decref(root);
-    return PM3_SUCCESS;
-}
-
 static const char *aiddf_json_get_str(json_t *data, const char *name) {
 
     json_t *jstr = json_object_get(data, name);
@@ -278,27 +283,11 @@ static const char *aiddf_json_get_str(json_t *data, const char *name) {
     return cstr;
 }
 
-static int print_aiddf_description(json_t *root, uint8_t aid[3], char *fmt, bool verbose) {
+static int print_aiddf_description(json_t *index, uint8_t aid[3], char *fmt, bool verbose) {
     char laid[7] = {0};
     snprintf(laid, sizeof(laid), "%02x%02x%02x", aid[2], aid[1], aid[0]); // must be lowercase
 
-    json_t *elm = NULL;
-
-    for (uint32_t idx = 0; idx < json_array_size(root); idx++) {
-        json_t *data = json_array_get(root, idx);
-        if (!json_is_object(data)) {
-            PrintAndLogEx(ERR, "data [%d] is not an object\n", idx);
-            continue;
-        }
-        const char *faid = aiddf_json_get_str(data, "AID");
-        char lfaid[strlen(faid) + 1];
-        strcpy(lfaid, faid);
-        str_lower(lfaid);
-        if (strcmp(laid, lfaid) == 0) {
-            elm = data;
-            break;
-        }
-    }
+    json_t *elm = json_object_get(index, laid);
 
     if (elm == NULL) {
         PrintAndLogEx(INFO, fmt, " (unknown)");
@@ -339,7 +328,6 @@ int AIDDFDecodeAndPrint(uint8_t aid[3]) {
 
     char fmt[80];
     snprintf(fmt, sizeof(fmt), "  DF AID Function... %02X%02X%02X  :" _YELLOW_("%s"), aid[2], aid[1], aid[0], "%s");
-    print_aiddf_description(df_known_aids, aid, fmt, false);
-    close_aiddf_file(df_known_aids);
+    print_aiddf_description(df_known_aids_index, aid, fmt, false);
     return PM3_SUCCESS;
 }
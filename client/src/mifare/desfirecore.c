@@ -430,7 +430,7 @@ void DesfirePrintContext(DesfireContext_t *ctx) {
     }
 }
 
-static int DESFIRESendApduEx(bool activate_field, sAPDU_t apdu, uint16_t le, uint8_t *result, uint32_t max_result_len, uint32_t *result_len, uint16_t *sw) {
+static int DESFIRESendApduEx(bool activate_field, sAPDU_t apdu, uint16_t le, uint16_t flags, uint8_t *result, uint32_t max_result_len, uint32_t *result_len, uint16_t *sw) {
     if (result_len) *result_len = 0;
     if (sw) *sw = 0;
 
@@ -454,7 +454,7 @@ static int DESFIRESendApduEx(bool activate_field, sAPDU_t apdu, uint16_t le, uin
     if (GetAPDULogging())
         PrintAndLogEx(SUCCESS, ">>>> %s", sprint_hex(data, datalen));
 
-    res = ExchangeAPDU14a(data, datalen, activate_field, true, result, max_result_len, (int *)result_len);
+    res = ExchangeAPDU14aEx(data, datalen, activate_field, true, result, max_result_len, (int *)result_len, flags);
     if (res != PM3_SUCCESS) {
         return res;
     }
@@ -490,7 +490,7 @@ static int DESFIRESendApduEx(bool activate_field, sAPDU_t apdu, uint16_t le, uin
 }
 
 static int DESFIRESendApdu(bool activate_field, sAPDU_t apdu, uint8_t *result, uint32_t max_result_len, uint32_t *result_len, uint16_t *sw) {
-    return DESFIRESendApduEx(activate_field, apdu, APDU_INCLUDE_LE_00, result, max_result_len, result_len, sw);
+    return DESFIRESendApduEx(activate_field, apdu, APDU_INCLUDE_LE_00, 0, result, max_result_len, result_len, sw);
 }
 
 static int DESFIRESendRaw(bool activate_field, uint8_t *data, size_t datalen, uint8_t *result, uint32_t max_result_len, uint32_t *result_len, uint8_t *respcode) {
@@ -694,6 +694,13 @@ static int DesfireExchangeISONative(bool activate_field, DesfireContext_t *ctx,
         .P2 = 0,
     };
 
+    // a single frame command whose 0xAF frames are plain data can have them fetched by the device,
+    // which saves a round trip per frame. Older firmware ignores the flag and we loop below as usual.
+    uint16_t flags = 0;
+    if (enable_chaining && splitbysize == 0 && datalen <= DESFIRE_TX_FRAME_MAX_LEN) {
+        flags = ISO14A_DESFIRE_AF;
+    }
+
     int res;
     // tx chaining
     size_t sentdatalen = 0;
@@ -710,7 +717,7 @@ static int DesfireExchangeISONative(bool activate_field, DesfireContext_t *ctx,
             apdu.INS = MFDES_ADDITIONAL_FRAME;
         }
 
-        res = DESFIRESendApdu(activate_field, apdu, buf, DESFIRE_BUFFER_SIZE, &buflen, &sw);
+        res = DESFIRESendApduEx(activate_field, apdu, APDU_INCLUDE_LE_00, flags, buf, DESFIRE_BUFFER_SIZE, &buflen, &sw);
         if (res != PM3_SUCCESS) {
             PrintAndLogEx(DEBUG, "error DESFIRESendApdu %s", DesfireGetErrorString(res, &sw));
             free(buf);
@@ -806,7 +813,7 @@ static int DesfireExchangeISO(bool activate_field, DesfireContext_t *ctx, sAPDU_
     }
 
     uint32_t datalen = 0;
-    int res = DESFIRESendApduEx(activate_field, apdu, le, data, DESFIRE_BUFFER_SIZE, &datalen, sw);
+    int res = DESFIRESendApduEx(activate_field, apdu, le, 0, data, DESFIRE_BUFFER_SIZE, &datalen, sw);
 
     if (res == PM3_SUCCESS) {
         DesfireSecureChannelDecode(ctx, data, datalen, 0, resp, resplen);
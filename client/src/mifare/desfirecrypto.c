@@ -211,41 +211,23 @@ static void DesfireCryptoEncDecSingleBlock(uint8_t *key, DesfireCryptoAlgorithm
                 des_decrypt(edata, sdata, key);
             break;
         case T_3DES:
-            if (encode) {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set2key_enc(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            } else {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set2key_dec(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            }
+            if (encode)
+                des3_encrypt(edata, sdata, key, 2);
+            else
+                des3_decrypt(edata, sdata, key, 2);
             break;
         case T_3K3DES:
-            if (encode) {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set3key_enc(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            } else {
-                mbedtls_des3_context ctx3;
-                mbedtls_des3_set3key_dec(&ctx3, key);
-                mbedtls_des3_crypt_ecb(&ctx3, sdata, edata);
-            }
+            if (encode)
+                des3_encrypt(edata, sdata, key, 3);
+            else
+                des3_decrypt(edata, sdata, key, 3);
             break;
         case T_AES:
-            if (encode) {
-                mbedtls_aes_context actx;
-                mbedtls_aes_init(&actx);
-                mbedtls_aes_setkey_enc(&actx, key, 128);
-                mbedtls_aes_crypt_ecb(&actx, MBEDTLS_AES_ENCRYPT, sdata, edata);
-                mbedtls_aes_free(&actx);
-            } else {
-                mbedtls_aes_context actx;
-                mbedtls_aes_init(&actx);
-                mbedtls_aes_setkey_dec(&actx, key, 128);
-                mbedtls_aes_crypt_ecb(&actx, MBEDTLS_AES_DECRYPT, sdata, edata);
-                mbedtls_aes_free(&actx);
-            }
+            // single block CBC with a zero IV is ECB
+            if (encode)
+                aes_encode(NULL, key, sdata, edata, CRYPTO_AES_BLOCK_SIZE);
+            else
+                aes_decode(NULL, key, sdata, edata, CRYPTO_AES_BLOCK_SIZE);
             break;
     }
 
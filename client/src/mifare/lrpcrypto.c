@@ -40,13 +40,56 @@ void LRPClearContext(LRPContext_t *ctx) {
     ctx->useUpdatedKeyNum = 0;
 }
 
+// The plaintexts, updated keys and CMAC subkeys depend on the key only. A secure messaging session
+// sets up a context with the same session keys for every command, so keep the tables of the last
+// few keys instead of running 20 (53 with the subkeys) AES operations each time.
+#define LRP_TABLE_CACHE_SIZE 4
+
+typedef struct {
+    bool valid;
+    bool subkeysValid;
+    uint8_t key[CRYPTO_AES128_KEY_SIZE];
+    uint8_t plaintexts[LRP_MAX_PLAINTEXTS_SIZE][CRYPTO_AES128_KEY_SIZE];
+    uint8_t updatedKeys[LRP_MAX_UPDATED_KEYS_SIZE][CRYPTO_AES128_KEY_SIZE];
+    uint8_t sk1[CRYPTO_AES128_KEY_SIZE];
+    uint8_t sk2[CRYPTO_AES128_KEY_SIZE];
+} LRPTableCache_t;
+
+static LRPTableCache_t lrpTableCache[LRP_TABLE_CACHE_SIZE];
+static size_t lrpTableCacheNext = 0;
+
+static LRPTableCache_t *LRPGetTables(const uint8_t *key) {
+    for (int i = 0; i < LRP_TABLE_CACHE_SIZE; i++) {
+        if (lrpTableCache[i].valid && memcmp(lrpTableCache[i].key, key, CRYPTO_AES128_KEY_SIZE) == 0)
+            return &lrpTableCache[i];
+    }
+
+    LRPTableCache_t *tables = &lrpTableCache[lrpTableCacheNext];
+    lrpTableCacheNext = (lrpTableCacheNext + 1) % LRP_TABLE_CACHE_SIZE;
+
+    LRPContext_t ctx = {0};
+    memcpy(ctx.key, key, CRYPTO_AES128_KEY_SIZE);
+    LRPGeneratePlaintexts(&ctx, LRP_MAX_PLAINTEXTS_SIZE);
+    LRPGenerateUpdatedKeys(&ctx, LRP_MAX_UPDATED_KEYS_SIZE);
+
+    memset(tables, 0, sizeof(LRPTableCache_t));
+    memcpy(tables->key, key, CRYPTO_AES128_KEY_SIZE);
+    memcpy(tables->plaintexts, ctx.plaintexts, sizeof(tables->plaintexts));
+    memcpy(tables->updatedKeys, ctx.updatedKeys, sizeof(tables->updatedKeys));
+    tables->valid = true;
+    return tables;
+}
+
 void LRPSetKey(LRPContext_t *ctx, uint8_t *key, size_t updatedKeyNum, bool useBitPadding) {
     LRPClearContext(ctx);
 
     memcpy(ctx->key, key, CRYPTO_AES128_KEY_SIZE);
 
-    LRPGeneratePlaintexts(ctx, 16);
-    LRPGenerateUpdatedKeys(ctx, 4);
+    const LRPTableCache_t *tables = LRPGetTables(key);
+    memcpy(ctx->plaintexts, tables->plaintexts, sizeof(ctx->plaintexts));
+    ctx->plaintextsCount = LRP_MAX_PLAINTEXTS_SIZE;
+    memcpy(ctx->updatedKeys, tables->updatedKeys, sizeof(ctx->updatedKeys));
+    ctx->updatedKeysCount = LRP_MAX_UPDATED_KEYS_SIZE;
 
     ctx->useUpdatedKeyNum = updatedKeyNum;
     ctx->useBitPadding = useBitPadding;
@@ -224,17 +267,25 @@ static void mulPolyX(uint8_t *data) {
 }
 
 void LRPGenSubkeys(uint8_t *key, uint8_t *sk1, uint8_t *sk2) {
-    LRPContext_t ctx = {0};
-    LRPSetKey(&ctx, key, 0, true);
+    LRPTableCache_t *tables = LRPGetTables(key);
 
-    uint8_t y[CRYPTO_AES128_KEY_SIZE] = {0};
-    LRPEvalLRP(&ctx, const00, CRYPTO_AES128_KEY_SIZE * 2, true, y);
+    if (tables->subkeysValid == false) {
+        LRPContext_t ctx = {0};
+        LRPSetKey(&ctx, key, 0, true);
+
+        uint8_t y[CRYPTO_AES128_KEY_SIZE] = {0};
+        LRPEvalLRP(&ctx, const00, CRYPTO_AES128_KEY_SIZE * 2, true, y);
 
-    mulPolyX(y);
-    memcpy(sk1, y, CRYPTO_AES128_KEY_SIZE);
+        mulPolyX(y);
+        memcpy(tables->sk1, y, CRYPTO_AES128_KEY_SIZE);
+
+        mulPolyX(y);
+        memcpy(tables->sk2, y, CRYPTO_AES128_KEY_SIZE);
+        tables->subkeysValid = true;
+    }
 
-    mulPolyX(y);
-    memcpy(sk2, y, CRYPTO_AES128_KEY_SIZE);
+    memcpy(sk1, tables->sk1, CRYPTO_AES128_KEY_SIZE);
+    memcpy(sk2, tables->sk2, CRYPTO_AES128_KEY_SIZE);
 }
 
 // https://www.nxp.com/docs/en/application-note/AN12304.pdf
@@ -27,7 +27,9 @@
 #include "mifaredefault.h"
 
 // https://www.nxp.com/docs/en/application-note/AN10787.pdf
+// mad.json is parsed on first use and kept for the session
 static json_t *mad_known_aids = NULL;
+static json_t *mad_known_aids_index = NULL;
 
 static const char *holder_info_type[] = {
     "Surname",
@@ -47,6 +49,9 @@ static const char *aid_admin[] = {
 
 static int open_mad_file(json_t **root, bool verbose) {
 
+    if (*root)
+        return PM3_SUCCESS;
+
     char *path;
     int res = searchFile(&path, RESOURCES_SUBDIR, "mad", ".json", true);
     if (res != PM3_SUCCESS) {
@@ -71,16 +76,17 @@ static int open_mad_file(json_t **root, bool verbose) {
 
     if (verbose)
         PrintAndLogEx(SUCCESS, "Loaded file " _YELLOW_("`%s`") " (%s) %zu records.", path,  _GREEN_("ok"), json_array_size(*root));
+
+    mad_known_aids_index = JsonIndexArray(*root, "mad", true);
 out:
+    if (retval != PM3_SUCCESS) {
+        json_decref(*root);
+        *root = NULL;
+    }
     free(path);
     return retval;
 }
 
-static int close_mad_file(json_t *root) {
-    json_decref(root);
-    return PM3_SUCCESS;
-}
-
 static const char *mad_json_get_str(json_t *data, const char *name) {
 
     json_t *jstr = json_object_get(data, name);
@@ -99,27 +105,11 @@ static const char *mad_json_get_str(json_t *data, const char *name) {
     return cstr;
 }
 
-static int print_aid_description(json_t *root, uint16_t aid, char *fmt, bool verbose) {
+static int print_aid_description(json_t *index, uint16_t aid, char *fmt, bool verbose) {
     char lmad[7] = {0};
     snprintf(lmad, sizeof(lmad), "0x%04x", aid); // must be lowercase
 
-    json_t *elm = NULL;
-
-    for (uint32_t idx = 0; idx < json_array_size(root); idx++) {
-        json_t *data = json_array_get(root, idx);
-        if (!json_is_object(data)) {
-            PrintAndLogEx(ERR, "data [%d] is not an object\n", idx);
-            continue;
-        }
-        const char *fmad = mad_json_get_str(data, "mad");
-        char lfmad[strlen(fmad) + 1];
-        strcpy(lfmad, fmad);
-        str_lower(lfmad);
-        if (strcmp(lmad, lfmad) == 0) {
-            elm = data;
-            break;
-        }
-    }
+    json_t *elm = json_object_get(index, lmad);
 
     if (elm == NULL) {
         PrintAndLogEx(INFO, fmt, " (unknown)");
@@ -349,11 +339,10 @@ int MAD1DecodeAndPrint(uint8_t *sector, bool swapmad, bool verbose, bool *haveMA
         } else {
             char fmt[60];
             snprintf(fmt, sizeof(fmt), (ibs == i) ? _MAGENTA_(" %02d [%04X]%s") : " %02d [" _GREEN_("%04X") "]%s", i, aid, "%s");
-            print_aid_description(mad_known_aids, aid, fmt, verbose);
+            print_aid_description(mad_known_aids_index, aid, fmt, verbose);
             prev_aid = aid;
         }
     }
-    close_mad_file(mad_known_aids);
     return PM3_SUCCESS;
 }
 
@@ -402,11 +391,10 @@ int MAD2DecodeAndPrint(uint8_t *sector, bool swapmad, bool verbose) {
         } else {
             char fmt[60];
             snprintf(fmt, sizeof(fmt), (ibs == i) ? _MAGENTA_(" %02d [%04X]%s") : " %02d [" _GREEN_("%04X") "]%s", i + 16, aid, "%s");
-            print_aid_description(mad_known_aids, aid, fmt, verbose);
+            print_aid_description(mad_known_aids_index, aid, fmt, verbose);
             prev_aid = aid;
         }
     }
-    close_mad_file(mad_known_aids);
 
     return PM3_SUCCESS;
 }
@@ -416,8 +404,7 @@ int MADDFDecodeAndPrint(uint32_t short_aid, bool verbose) {
 
     char fmt[128];
     snprintf(fmt, sizeof(fmt), "  MAD AID Function 0x%04X    :" _YELLOW_("%s"), short_aid, "%s");
-    print_aid_description(mad_known_aids, short_aid, fmt, verbose);
-    close_mad_file(mad_known_aids);
+    print_aid_description(mad_known_aids_index, short_aid, fmt, verbose);
     return PM3_SUCCESS;
 }
 
@@ -18,7 +18,14 @@
 //-----------------------------------------------------------------------------
 #include "mfkey.h"
 
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bucketsort.h"  // radix_sort_u64
+#include "commonutil.h" // ARRAYLEN
 #include "crapto1/crapto1.h"
+#include "util.h"       // num_CPUs
 
 // MIFARE
 int inline compare_uint64(const void *a, const void *b) {
@@ -27,26 +34,25 @@ int inline compare_uint64(const void *a, const void *b) {
     return -1;
 }
 
+// sort a key candidate list in ascending order,  radix sort with qsort as fallback
+void sort_uint64(uint64_t *list, size_t len) {
+    if (radix_sort_u64(list, len, UINT64_MAX, false) == false) {
+        qsort(list, len, sizeof(uint64_t), compare_uint64);
+    }
+}
+
 // create the intersection (common members) of two sorted lists. Lists are terminated by -1. Result will be in list1. Number of elements is returned.
 uint32_t intersection(uint64_t *listA, uint64_t *listB) {
     if (listA == NULL || listB == NULL)
         return 0;
 
-    uint64_t *p1, *p2, *p3;
-    p1 = p3 = listA;
-    p2 = listB;
-
-    while (*p1 != UINT64_C(-1) && *p2 != UINT64_C(-1)) {
-        if (compare_uint64(p1, p2) == 0) {
-            *p3++ = *p1++;
-            p2++;
-        } else {
-            while (compare_uint64(p1, p2) < 0) ++p1;
-            while (compare_uint64(p1, p2) > 0) ++p2;
-        }
-    }
-    *p3 = UINT64_C(-1);
-    return p3 - listA;
+    size_t lenA = 0, lenB = 0;
+    while (listA[lenA] != UINT64_C(-1)) lenA++;
+    while (listB[lenB] != UINT64_C(-1)) lenB++;
+
+    size_t n = intersect_sorted_u64(listA, lenA, listB, lenB);
+    listA[n] = UINT64_C(-1);
+    return n;
 }
 
 // Darkside attack (hf mf mifare)
@@ -78,7 +84,7 @@ uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t
         par[7 - pos][7] = (bt >> 7) & 1;
     }
 
-    unionstate.states = lfsr_common_prefix(nr, ar, ks3x, par, (par_info == 0));
+    unionstate.states = lfsr_common_prefix_mt(nr, ar, ks3x, par, (par_info == 0), num_CPUs());
 
     if (!unionstate.states) {
         *keys = NULL;
@@ -106,7 +112,7 @@ bool mfkey32(nonces_t *data, uint64_t *outputkey) {
 
     uint32_t p640 = prng_successor(data->nonce, 64);
 
-    s = lfsr_recovery32(data->ar ^ p640, 0);
+    s = lfsr_recovery32_mt(data->ar ^ p640, 0, num_CPUs());
 
     for (t = s; t->odd | t->even; ++t) {
         lfsr_rollback_word(t, 0, 0);
@@ -127,18 +133,18 @@ bool mfkey32(nonces_t *data, uint64_t *outputkey) {
     return isSuccess;
 }
 
-// recover key from 2 reader responses on 2 different tag challenges
-// skip "several found keys".  Only return true if ONE key is found
-bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
+// candidate keys of one nonce pair,  recovered from the first reader response and filtered by the second one.
+// Returns the number of candidates,  at most max
+static uint32_t mfkey32_candidates(const nonces_t *data, int threads, uint64_t *keys, uint32_t max) {
     struct Crypto1State *s, *t;
-    uint64_t outkey  = 0;
-    uint64_t key     = 0; // recovered key
-    bool isSuccess = false;
-    int counter = 0;
+    uint64_t key = 0;
+    uint32_t counter = 0;
     uint32_t p640 = prng_successor(data->nonce, 64);
     uint32_t p641 = prng_successor(data->nonce2, 64);
 
-    s = lfsr_recovery32(data->ar ^ p640, 0);
+    s = lfsr_recovery32_mt(data->ar ^ p640, 0, threads);
+    if (s == NULL)
+        return 0;
 
     for (t = s; t->odd | t->even; ++t) {
         lfsr_rollback_word(t, 0, 0);
@@ -149,17 +155,194 @@ bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
         crypto1_word(t, data->cuid ^ data->nonce2, 0);
         crypto1_word(t, data->nr2, 1);
         if (data->ar2 == (crypto1_word(t, 0, 0) ^ p641)) {
-            outkey = key;
-            ++counter;
-            if (counter == 20) break;
+            keys[counter++] = key;
+            if (counter == max) break;
         }
     }
-    isSuccess  = (counter == 1);
-    *outputkey = (isSuccess) ? outkey : 0;
     crypto1_destroy(s);
+    return counter;
+}
+
+// recover key from 2 reader responses on 2 different tag challenges
+// skip "several found keys".  Only return true if ONE key is found
+bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey) {
+    uint64_t keys[MFKEY32_MAX_CANDIDATES];
+    bool isSuccess = (mfkey32_candidates(data, num_CPUs(), keys, ARRAYLEN(keys)) == 1);
+    *outputkey = (isSuccess) ? keys[0] : 0;
     return isSuccess;
 }
 
+// check a key against both reader responses of a nonce pair,  a few crypto1 words instead of a recovery
+static bool mfkey32_verify(const nonces_t *data, uint64_t key) {
+    struct Crypto1State s;
+
+    crypto1_init(&s, key);
+    crypto1_word(&s, data->cuid ^ data->nonce, 0);
+    crypto1_word(&s, data->nr, 1);
+    if (data->ar != (crypto1_word(&s, 0, 0) ^ prng_successor(data->nonce, 64)))
+        return false;
+
+    crypto1_init(&s, key);
+    crypto1_word(&s, data->cuid ^ data->nonce2, 0);
+    crypto1_word(&s, data->nr2, 1);
+    return (data->ar2 == (crypto1_word(&s, 0, 0) ^ prng_successor(data->nonce2, 64)));
+}
+
+static bool mfkey32_same_group(const nonces_t *a, const nonces_t *b) {
+    return (a->cuid == b->cuid) && (a->sector == b->sector) && (a->keytype == b->keytype);
+}
+
+typedef struct {
+    const nonces_t *data;
+    const uint32_t *jobs;
+    uint32_t njobs;
+    uint32_t next;
+    int threads;
+    uint64_t (*candidates)[MFKEY32_MAX_CANDIDATES];
+    uint32_t *ncandidates;
+    pthread_mutex_t lock;
+} mfkey32_batch_t;
+
+static void *mfkey32_batch_thread(void *arg) {
+    mfkey32_batch_t *b = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        uint32_t i = b->next++;
+        pthread_mutex_unlock(&b->lock);
+
+        if (i >= b->njobs)
+            break;
+
+        b->ncandidates[i] = mfkey32_candidates(&b->data[b->jobs[i]], b->threads, b->candidates[i], MFKEY32_MAX_CANDIDATES);
+    }
+    return NULL;
+}
+
+// recover keys of many nonce pairs at once (mfkey32_moebius on each),  result of data[i] in keys[i] / found[i].
+// Pairs with the same UID,  sector and key type are a group:  a key recovered for one pair of the group is only
+// verified against the others,  and when a pair returns several candidates the other pairs of its group pick the
+// right one. Recoveries of different groups run in parallel. Returns the number of pairs solved.
+uint32_t mfkey32_moebius_batch(const nonces_t *data, uint32_t count, uint64_t *keys, bool *found) {
+
+    if (count == 0)
+        return 0;
+
+    uint8_t *state = calloc(count, sizeof(uint8_t));     // 0 pending,  1 solved,  2 failed
+    uint32_t *jobs = calloc(count, sizeof(uint32_t));
+    uint64_t (*candidates)[MFKEY32_MAX_CANDIDATES] = calloc(count, sizeof(*candidates));
+    uint32_t *ncandidates = calloc(count, sizeof(uint32_t));
+    if (state == NULL || jobs == NULL || candidates == NULL || ncandidates == NULL) {
+        free(state);
+        free(jobs);
+        free(candidates);
+        free(ncandidates);
+        return 0;
+    }
+
+    memset(found, 0, count * sizeof(bool));
+    uint32_t solved = 0;
+
+    for (;;) {
+        // a key of the group settles the pair without a recovery
+        for (uint32_t i = 0; i < count; i++) {
+            if (state[i] != 0)
+                continue;
+            for (uint32_t j = 0; j < count; j++) {
+                if (state[j] == 1 && mfkey32_same_group(&data[i], &data[j]) && mfkey32_verify(&data[i], keys[j])) {
+                    keys[i] = keys[j];
+                    found[i] = true;
+                    state[i] = 1;
+                    solved++;
+                    break;
+                }
+            }
+        }
+
+        // one recovery per group and round
+        uint32_t njobs = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            if (state[i] != 0)
+                continue;
+            bool taken = false;
+            for (uint32_t j = 0; j < njobs && taken == false; j++) {
+                taken = mfkey32_same_group(&data[i], &data[jobs[j]]);
+            }
+            if (taken == false) {
+                jobs[njobs++] = i;
+            }
+        }
+
+        if (njobs == 0)
+            break;
+
+        int cpus = num_CPUs();
+        int workers = MIN(MIN((int)njobs, cpus), MFKEY32_BATCH_MAX_JOBS);
+
+        mfkey32_batch_t b = {
+            .data = data,
+            .jobs = jobs,
+            .njobs = njobs,
+            .next = 0,
+            .threads = MAX(1, cpus / workers),
+            .candidates = candidates,
+            .ncandidates = ncandidates,
+        };
+        pthread_mutex_init(&b.lock, NULL);
+
+        pthread_t thread_id[MFKEY32_BATCH_MAX_JOBS];
+        int started = 0;
+        for (; started < workers - 1; started++) {
+            if (pthread_create(&thread_id[started], NULL, mfkey32_batch_thread, &b) != 0)
+                break;
+        }
+        mfkey32_batch_thread(&b);
+        for (int i = 0; i < started; i++) {
+            pthread_join(thread_id[i], NULL);
+        }
+        pthread_mutex_destroy(&b.lock);
+
+        for (uint32_t j = 0; j < njobs; j++) {
+            uint32_t i = jobs[j];
+            uint32_t n = ncandidates[j];
+            int pick = (n == 1) ? 0 : -1;
+
+            // several candidates,  keep the one and only which another pair of the group agrees with
+            for (uint32_t k = 0; n > 1 && k < count && pick < 0; k++) {
+                if (k == i || state[k] != 0 || mfkey32_same_group(&data[i], &data[k]) == false)
+                    continue;
+
+                int match = -1;
+                uint32_t matches = 0;
+                for (uint32_t c = 0; c < n; c++) {
+                    if (mfkey32_verify(&data[k], candidates[j][c])) {
+                        match = c;
+                        matches++;
+                    }
+                }
+                if (matches == 1) {
+                    pick = match;
+                }
+            }
+
+            if (pick < 0) {
+                state[i] = 2;
+                continue;
+            }
+            keys[i] = candidates[j][pick];
+            found[i] = true;
+            state[i] = 1;
+            solved++;
+        }
+    }
+
+    free(state);
+    free(jobs);
+    free(candidates);
+    free(ncandidates);
+    return solved;
+}
+
 // recover key from reader response and tag response of one authentication sequence
 int mfkey64(nonces_t *data, uint64_t *outputkey) {
     uint64_t key = 0;  // recovered key
@@ -170,7 +353,7 @@ int mfkey64(nonces_t *data, uint64_t *outputkey) {
     // Extract the keystream from the messages
     ks2 = data->ar ^ prng_successor(data->nonce, 64);
     ks3 = data->at ^ prng_successor(data->nonce, 96);
-    revstate = lfsr_recovery64(ks2, ks3);
+    revstate = lfsr_recovery64_mt(ks2, ks3, num_CPUs());
     lfsr_rollback_word(revstate, 0, 0);
     lfsr_rollback_word(revstate, 0, 0);
     lfsr_rollback_word(revstate, data->nr, 1);
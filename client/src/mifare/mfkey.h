@@ -23,12 +23,19 @@
 #include "common.h"
 #include "mifare.h"
 
+// more candidates than this for one nonce pair is a failed recovery
+#define MFKEY32_MAX_CANDIDATES  20
+// recoveries running at once in mfkey32_moebius_batch,  each one allocates some 50 MB of tables
+#define MFKEY32_BATCH_MAX_JOBS  8
+
 uint32_t nonce2key(uint32_t uid, uint32_t nt, uint32_t nr, uint32_t ar, uint64_t par_info, uint64_t ks_info, uint64_t **keys);
 bool mfkey32(nonces_t *data, uint64_t *outputkey);
 bool mfkey32_moebius(nonces_t *data, uint64_t *outputkey);
+uint32_t mfkey32_moebius_batch(const nonces_t *data, uint32_t count, uint64_t *keys, bool *found);
 int mfkey64(nonces_t *data, uint64_t *outputkey);
 
 int compare_uint64(const void *a, const void *b);
+void sort_uint64(uint64_t *list, size_t len);
 uint32_t intersection(uint64_t *listA, uint64_t *listB);
 
 #endif
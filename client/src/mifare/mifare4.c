@@ -23,6 +23,8 @@
 #include "cmdhf14a.h"
 #include "ui.h"
 #include "crypto/libpcrypto.h"
+#include "util.h"       // kbd_enter_pressed
+#include "util_posix.h" // msclock
 
 static bool g_verbose_mode = false;
 void mfpSetVerboseMode(bool verbose) {
@@ -362,6 +364,119 @@ int MifareAuth4(mf4Session_t *mf4session, const uint8_t *keyn, uint8_t *key, boo
     return PM3_SUCCESS;
 }
 
+// uploads one run of the dictionary into BigBuf and collects the per slot replies
+static int mfpdesCheckKeys_run(uint16_t cmd, uint8_t algo, const uint8_t *aid, const uint8_t *slots, const uint8_t *keys, uint8_t keylen, uint16_t keycnt, int32_t *found, uint16_t base, bool verbose) {
+
+    mfpdes_chk_chunk_t chunk;
+    PacketResponseNG resp;
+    clearCommandBuffer();
+
+    uint16_t perchunk = MFPDES_CHK_DATA / keylen;
+    for (uint16_t offset = 0; offset < keycnt; offset += perchunk) {
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.keycnt = MIN(perchunk, keycnt - offset);
+        if (offset == 0)
+            chunk.flags |= MFPDES_CHK_FIRST;
+        if (offset + chunk.keycnt == keycnt)
+            chunk.flags |= MFPDES_CHK_LAST;
+        chunk.keylen = keylen;
+        chunk.algo = algo;
+        chunk.total = keycnt;
+        chunk.offset = offset;
+        if (aid)
+            memcpy(chunk.aid, aid, sizeof(chunk.aid));
+        memcpy(chunk.slots, slots, sizeof(chunk.slots));
+        memcpy(chunk.keys, keys + (offset * keylen), chunk.keycnt * keylen);
+        SendCommandNG(cmd, (uint8_t *)&chunk, sizeof(chunk));
+
+        if (chunk.flags & MFPDES_CHK_LAST)
+            break;
+
+        if (WaitForResponseTimeout(cmd, &resp, 2000) == false)
+            return PM3_ETIMEOUT;
+
+        if (resp.status != PM3_SUCCESS)
+            return resp.status;
+    }
+
+    // two exchanges per key at worst,  one reply per slot
+    uint64_t timeout = 2000 + (keycnt * 40);
+    uint64_t t_last = msclock();
+    while (true) {
+
+        if (kbd_enter_pressed()) {
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            WaitForResponseTimeout(cmd, &resp, 2000);
+            PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+            return PM3_EOPABORTED;
+        }
+
+        if (WaitForResponseTimeout(cmd, &resp, 200) == false) {
+            if (msclock() - t_last > timeout) {
+                SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+                return PM3_ETIMEOUT;
+            }
+            continue;
+        }
+        t_last = msclock();
+
+        if (resp.status != PM3_SUCCESS)
+            return resp.status;
+
+        const mfpdes_chk_reply_t *reply = (const mfpdes_chk_reply_t *)resp.data.asBytes;
+        if (reply->done)
+            return PM3_SUCCESS;
+
+        if (reply->slot < 128 && reply->index >= 0 && reply->index < keycnt) {
+            found[reply->slot] = base + reply->index;
+            if (verbose)
+                PrintAndLogEx(INFO, "Found key for slot %u [%s]", reply->slot, sprint_hex_inrow(keys + (reply->index * keylen), keylen));
+            else
+                PrintAndLogEx(NORMAL, "+" NOLF);
+        } else if (verbose == false) {
+            PrintAndLogEx(NORMAL, "." NOLF);
+        }
+    }
+}
+
+// Check a dictionary on the device against MIFARE Plus SL3 keys 0x4000 + slot (CMD_HF_MFP_CHKKEYS) or
+// DESFire EV1 keys of one application (CMD_HF_DESFIRE_CHKKEYS).  Slots already found are skipped,
+// found[slot] gets the dictionary index of the valid key.  The dictionary is sent in runs which fit
+// into BigBuf,  smaller ones if the device is short of room.
+int mfpdesCheckKeys(uint16_t cmd, uint8_t algo, const uint8_t *aid, const uint8_t *slots, const uint8_t *keys, uint8_t keylen, uint32_t keycnt, int32_t *found, bool verbose) {
+
+    if (keylen != 8 && keylen != 16 && keylen != 24)
+        return PM3_EINVARG;
+
+    uint32_t runlen = UINT16_MAX / keylen;
+
+    for (uint32_t i = 0; i < keycnt;) {
+
+        uint8_t todo[16] = {0};
+        bool any = false;
+        for (uint8_t slot = 0; slot < 128; slot++) {
+            if ((slots[slot / 8] & (1 << (slot % 8))) && found[slot] < 0) {
+                todo[slot / 8] |= (1 << (slot % 8));
+                any = true;
+            }
+        }
+        if (any == false)
+            break;
+
+        uint16_t n = MIN(runlen, keycnt - i);
+        int res = mfpdesCheckKeys_run(cmd, algo, aid, todo, keys + (i * keylen), keylen, n, found, i, verbose);
+        if (res == PM3_EMALLOC && n > (MFPDES_CHK_DATA / keylen)) {
+            runlen = n / 2;
+            continue;
+        }
+        if (res != PM3_SUCCESS)
+            return res;
+
+        i += n;
+    }
+    return PM3_SUCCESS;
+}
+
 static int intExchangeRAW14aPlus(uint8_t *datain, int datainlen, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen) {
     if (g_verbose_mode) {
         PrintAndLogEx(INFO, ">>> %s", sprint_hex(datain, datainlen));
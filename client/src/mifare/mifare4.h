@@ -61,6 +61,7 @@ const char *mfpGetErrorDescription(uint8_t errorCode);
 
 int CalculateMAC(mf4Session_t *mf4session, MACType_t mtype, uint8_t blockNum, uint8_t blockCount, uint8_t *data, int datalen, uint8_t *mac, bool verbose);
 int MifareAuth4(mf4Session_t *mf4session, const uint8_t *keyn, uint8_t *key, bool activateField, bool leaveSignalON, bool dropFieldIfError, bool verbose, bool silentMode);
+int mfpdesCheckKeys(uint16_t cmd, uint8_t algo, const uint8_t *aid, const uint8_t *slots, const uint8_t *keys, uint8_t keylen, uint32_t keycnt, int32_t *found, bool verbose);
 
 int MFPWritePerso(const uint8_t *keyNum, const uint8_t *key, bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen);
 int MFPCommitPerso(bool activateField, bool leaveSignalON, uint8_t *dataout, int maxdataoutlen, int *dataoutlen);
@@ -30,6 +30,10 @@
 #include "ui.h"                 // PrintAndLog...
 #include "crapto1/crapto1.h"
 #include "crc16.h"
+#include "bucketsort.h"         // radix_sort_u64
+#include "nestedrecover.h"      // nested_recover_keys
+#include "memstats.h"
+#include "bruteforce.h"         // BF_MODE_SMART
 #include "protocols.h"
 #include "mfkey.h"
 #include "util_posix.h"         // msclock
@@ -43,28 +47,43 @@
 #include "cmdhf14a.h"
 #include "gen4.h"
 
+static void mfDarksideRequest(bool first_run, uint8_t blockno, uint8_t key_type) {
+    struct {
+        uint8_t first_run;
+        uint8_t blockno;
+        uint8_t key_type;
+    } PACKED payload;
+    payload.first_run = first_run;
+    payload.blockno = blockno;
+    payload.key_type = key_type;
+    SendCommandNG(CMD_HF_MIFARE_READER, (uint8_t *)&payload, sizeof(payload));
+}
+
+// stop the sample the device collects ahead and drop its reply,  aborted or complete
+static void mfDarksideCancel(void) {
+    SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+    WaitForResponseTimeout(CMD_HF_MIFARE_READER, NULL, 5000);
+}
+
 int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key) {
     uint32_t uid = 0;
     uint32_t nt = 0, nr = 0, ar = 0;
     uint64_t par_list = 0, ks_list = 0;
     uint64_t *keylist = NULL, *last_keylist = NULL;
     bool first_run = true;
+    // the device already collects the next sample
+    bool ahead = false;
 
     // message
     PrintAndLogEx(INFO, "Expected execution time is about 25seconds on average");
     PrintAndLogEx(INFO, "Press " _GREEN_("pm3 button") " to abort");
 
     while (true) {
-        clearCommandBuffer();
-        struct {
-            uint8_t first_run;
-            uint8_t blockno;
-            uint8_t key_type;
-        } PACKED payload;
-        payload.first_run = first_run;
-        payload.blockno = blockno;
-        payload.key_type = key_type;
-        SendCommandNG(CMD_HF_MIFARE_READER, (uint8_t *)&payload, sizeof(payload));
+        if (ahead == false) {
+            clearCommandBuffer();
+            mfDarksideRequest(first_run, blockno, key_type);
+        }
+        ahead = false;
 
         //flush queue
         while (kbd_enter_pressed()) {
@@ -127,6 +146,11 @@ int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key) {
         }
         first_run = false;
 
+        // the device collects the next sample while the candidates are computed,
+        // it is the one needed next whenever this sample gives no candidates
+        mfDarksideRequest(false, blockno, key_type);
+        ahead = true;
+
         uint32_t keycount = nonce2key(uid, nt, nr, ar, par_list, ks_list, &keylist);
 
         if (keycount == 0) {
@@ -138,7 +162,7 @@ int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key) {
 
         // only parity zero attack
         if (par_list == 0) {
-            qsort(keylist, keycount, sizeof(*keylist), compare_uint64);
+            sort_uint64(keylist, keycount);
             keycount = intersection(last_keylist, keylist);
             if (keycount == 0) {
                 free(last_keylist);
@@ -150,6 +174,10 @@ int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key) {
 
         PrintAndLogEx(SUCCESS, "found " _YELLOW_("%u") " candidate key%s", keycount, (keycount > 1) ? "s" : "");
 
+        // candidates are checked on the device
+        mfDarksideCancel();
+        ahead = false;
+
         *key = UINT64_C(-1);
         uint8_t keyBlock[PM3_CMD_DATA_SIZE];
         uint32_t max_keys = KEYS_IN_BLOCK;
@@ -159,9 +187,9 @@ int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key) {
             register uint8_t j;
             for (j = 0; j < size; j++) {
                 if (par_list == 0) {
-                    num_to_bytes(last_keylist[i * max_keys + j], 6, keyBlock + (j * 6));
+                    num_to_bytes(last_keylist[i + j], 6, keyBlock + (j * 6));
                 } else {
-                    num_to_bytes(keylist[i * max_keys + j], 6, keyBlock + (j * 6));
+                    num_to_bytes(keylist[i + j], 6, keyBlock + (j * 6));
                 }
             }
 
@@ -217,10 +245,271 @@ int mfCheckKeys(uint8_t blockNo, uint8_t keyType, bool clear_trace, uint8_t keyc
     return PM3_SUCCESS;
 }
 
+// uploads one candidate list into BigBuf and has the device check it
+static int mfCheckKeys_list_run(uint8_t blockNo, uint8_t keyType, const uint8_t *keys, uint16_t keycnt, uint8_t flags, mfc_chk_list_reply_t *reply) {
+
+    mfc_chk_list_chunk_t chunk;
+    PacketResponseNG resp;
+    clearCommandBuffer();
+
+    for (uint16_t offset = 0; offset < keycnt; offset += MF_CHK_LIST_KEYS) {
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.keycnt = MIN(MF_CHK_LIST_KEYS, keycnt - offset);
+        chunk.flags = flags;
+        if (offset == 0)
+            chunk.flags |= MF_CHK_LIST_FIRST;
+        if (offset + chunk.keycnt == keycnt)
+            chunk.flags |= MF_CHK_LIST_LAST;
+        chunk.block = blockNo;
+        chunk.keytype = keyType;
+        chunk.total = keycnt;
+        chunk.offset = offset;
+        memcpy(chunk.keys, keys + (offset * 6), chunk.keycnt * 6);
+        SendCommandNG(CMD_HF_MIFARE_CHKKEYS_LIST, (uint8_t *)&chunk, sizeof(chunk));
+
+        if (chunk.flags & MF_CHK_LIST_LAST)
+            break;
+
+        if (WaitForResponseTimeout(CMD_HF_MIFARE_CHKKEYS_LIST, &resp, 2000) == false)
+            return PM3_ETIMEOUT;
+
+        if (resp.status != PM3_SUCCESS)
+            return resp.status;
+    }
+
+    // a select and an auth per key at worst
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_CHKKEYS_LIST, &resp, 2000 + (keycnt * 10)) == false) {
+        SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.status != PM3_SUCCESS)
+        return resp.status;
+
+    memcpy(reply, resp.data.asBytes, sizeof(mfc_chk_list_reply_t));
+    return PM3_SUCCESS;
+}
+
+// Check a list of candidate keys against one block.  The device checks the list from BigBuf in runs of
+// up to MF_CHK_LIST_MAX keys,  fewer if BigBuf is short of room.
+// return PM3_SUCCESS and the key if found,  PM3_ESOFT if no key was valid
+int mfCheckKeys_list(uint8_t blockNo, uint8_t keyType, const uint8_t *keys, uint32_t keycnt, uint64_t *key) {
+    *key = -1;
+    uint32_t runlen = MF_CHK_LIST_MAX;
+
+    for (uint32_t i = 0; i < keycnt;) {
+
+        uint16_t n = MIN(runlen, keycnt - i);
+        mfc_chk_list_reply_t reply;
+
+        int res = mfCheckKeys_list_run(blockNo, keyType, keys + (i * 6), n, 0, &reply);
+        if (res == PM3_EMALLOC && n > MF_CHK_LIST_KEYS) {
+            runlen = n / 2;
+            continue;
+        }
+        if (res != PM3_SUCCESS)
+            return res;
+
+        // auths without select found nothing,  don't trust a card which only pretends to take them
+        if (reply.index < 0 && reply.reauth) {
+            res = mfCheckKeys_list_run(blockNo, keyType, keys + (i * 6), n, MF_CHK_LIST_NO_REAUTH, &reply);
+            if (res != PM3_SUCCESS)
+                return res;
+        }
+
+        if (reply.index >= 0) {
+            *key = bytes_to_num(reply.key, sizeof(reply.key));
+            return PM3_SUCCESS;
+        }
+        i += n;
+    }
+    return PM3_ESOFT;
+}
+
 // Sends chunks of keys to device.
 // 0 == ok all keys found
 // 1 ==
 // 2 == Time-out, aborting
+// Found key statistics,  one "<key> <hits>" line per key in the user directory.
+// Only used when enabled with `prefs set keyhits --on`
+#define MF_KEY_HITS_FILE  "mfc_key_hits.txt"
+
+typedef struct {
+    uint64_t key;
+    uint32_t hits;
+    uint32_t idx;
+} mf_key_hit_t;
+
+static int mf_key_hit_cmp_key(const void *a, const void *b) {
+    const mf_key_hit_t *x = a;
+    const mf_key_hit_t *y = b;
+    if (x->key < y->key) return -1;
+    if (x->key > y->key) return 1;
+    return 0;
+}
+
+// most hits first,  otherwise keep dictionary order
+static int mf_key_hit_cmp_hits(const void *a, const void *b) {
+    const mf_key_hit_t *x = a;
+    const mf_key_hit_t *y = b;
+    if (x->hits != y->hits) return (x->hits > y->hits) ? -1 : 1;
+    if (x->idx < y->idx) return -1;
+    if (x->idx > y->idx) return 1;
+    return 0;
+}
+
+// returns number of entries,  sorted by key.  Caller frees *hits
+static uint32_t mf_key_hits_load(mf_key_hit_t **hits) {
+
+    *hits = NULL;
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, MF_KEY_HITS_FILE, false) != PM3_SUCCESS) {
+        return 0;
+    }
+
+    FILE *f = fopen(path, "r");
+    free(path);
+    if (f == NULL) {
+        return 0;
+    }
+
+    uint32_t cnt = 0, cap = 0;
+    char line[64];
+    while (fgets(line, sizeof(line), f)) {
+
+        uint64_t key = 0;
+        uint32_t n = 0;
+        if (sscanf(line, "%012" SCNx64 " %" SCNu32, &key, &n) != 2) {
+            continue;
+        }
+
+        if (cnt == cap) {
+            cap = (cap) ? cap * 2 : 64;
+            mf_key_hit_t *tmp = realloc(*hits, cap * sizeof(mf_key_hit_t));
+            if (tmp == NULL) {
+                break;
+            }
+            *hits = tmp;
+        }
+        (*hits)[cnt].key = key;
+        (*hits)[cnt].hits = n;
+        (*hits)[cnt].idx = cnt;
+        cnt++;
+    }
+    fclose(f);
+
+    if (cnt) {
+        qsort(*hits, cnt, sizeof(mf_key_hit_t), mf_key_hit_cmp_key);
+    }
+    return cnt;
+}
+
+// count one hit for each key
+void mfKeyHitsAdd(const uint64_t *keys, uint32_t keycnt) {
+
+    if (g_session.mf_key_hits == false || g_session.incognito || keycnt == 0) {
+        return;
+    }
+
+    mf_key_hit_t *hits = NULL;
+    uint32_t cnt = mf_key_hits_load(&hits);
+
+    mf_key_hit_t *tmp = realloc(hits, (cnt + keycnt) * sizeof(mf_key_hit_t));
+    if (tmp == NULL) {
+        free(hits);
+        return;
+    }
+    hits = tmp;
+
+    uint32_t known = cnt;
+    for (uint32_t i = 0; i < keycnt; i++) {
+
+        mf_key_hit_t k = { .key = keys[i] };
+        mf_key_hit_t *h = bsearch(&k, hits, known, sizeof(mf_key_hit_t), mf_key_hit_cmp_key);
+        if (h == NULL) {
+            // same key twice in this batch?
+            for (uint32_t j = known; j < cnt; j++) {
+                if (hits[j].key == keys[i]) {
+                    h = &hits[j];
+                    break;
+                }
+            }
+        }
+
+        if (h) {
+            h->hits++;
+        } else {
+            hits[cnt].key = keys[i];
+            hits[cnt].hits = 1;
+            cnt++;
+        }
+    }
+
+    char *path = NULL;
+    if (searchHomeFilePath(&path, NULL, MF_KEY_HITS_FILE, true) != PM3_SUCCESS) {
+        free(hits);
+        return;
+    }
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        PrintAndLogEx(DEBUG, "failed to write key hits to " _YELLOW_("%s"), path);
+        free(path);
+        free(hits);
+        return;
+    }
+
+    for (uint32_t i = 0; i < cnt; i++) {
+        fprintf(f, "%012" PRIX64 " %" PRIu32 "\n", hits[i].key, hits[i].hits);
+    }
+    fclose(f);
+    free(path);
+    free(hits);
+}
+
+// reorder keys so the ones found most often are tried first
+void mfKeyHitsSort(uint8_t *keyBlock, uint32_t keycnt) {
+
+    if (g_session.mf_key_hits == false || keycnt < 2) {
+        return;
+    }
+
+    mf_key_hit_t *hits = NULL;
+    uint32_t cnt = mf_key_hits_load(&hits);
+    if (cnt == 0) {
+        return;
+    }
+
+    mf_key_hit_t *order = calloc(keycnt, sizeof(mf_key_hit_t));
+    if (order == NULL) {
+        free(hits);
+        return;
+    }
+
+    uint32_t known = 0;
+    for (uint32_t i = 0; i < keycnt; i++) {
+        order[i].key = bytes_to_num(keyBlock + (i * MIFARE_KEY_SIZE), MIFARE_KEY_SIZE);
+        order[i].idx = i;
+
+        mf_key_hit_t *h = bsearch(&order[i], hits, cnt, sizeof(mf_key_hit_t), mf_key_hit_cmp_key);
+        if (h) {
+            order[i].hits = h->hits;
+            known++;
+        }
+    }
+    free(hits);
+
+    if (known) {
+        qsort(order, keycnt, sizeof(mf_key_hit_t), mf_key_hit_cmp_hits);
+        for (uint32_t i = 0; i < keycnt; i++) {
+            num_to_bytes(order[i].key, MIFARE_KEY_SIZE, keyBlock + (i * MIFARE_KEY_SIZE));
+        }
+        PrintAndLogEx(SUCCESS, "ordered " _GREEN_("%u") " keys by previous hits", known);
+    }
+    free(order);
+}
+
 int mfCheckKeys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk, uint8_t strategy,
                      uint32_t size, uint8_t *keyBlock, sector_t *e_sector, bool use_flashmemory, bool verbose) {
 
@@ -286,20 +575,31 @@ int mfCheckKeys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk,
 
         memcpy(tmp, resp.data.asBytes, sectorsCnt * sizeof(icesector_t));
 
+        uint64_t hits[80];
+        uint32_t hitcnt = 0;
+
         for (int i = 0; i < sectorsCnt; i++) {
             // key A
             if (!e_sector[i].foundKey[0]) {
                 e_sector[i].Key[0] =  bytes_to_num(tmp[i].keyA, 6);
                 e_sector[i].foundKey[0] = arr[(i * 2) ];
+                if (e_sector[i].foundKey[0]) {
+                    hits[hitcnt++] = e_sector[i].Key[0];
+                }
             }
             // key B
             if (!e_sector[i].foundKey[1]) {
                 e_sector[i].Key[1] =  bytes_to_num(tmp[i].keyB, 6);
                 e_sector[i].foundKey[1] = arr[(i * 2) + 1 ];
+                if (e_sector[i].foundKey[1]) {
+                    hits[hitcnt++] = e_sector[i].Key[1];
+                }
             }
         }
         free(tmp);
 
+        mfKeyHitsAdd(hits, hitcnt);
+
         // if all keys where found
         if (curr_keys == sectorsCnt * 2) {
             return PM3_SUCCESS;
@@ -317,6 +617,270 @@ int mfCheckKeys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk,
     return PM3_ESOFT;
 }
 
+static void mf_chk_stream_send(uint32_t idx, uint32_t chunks_per_pass, uint8_t sectorsCnt, const uint8_t *keyBlock, uint32_t keycnt) {
+
+    mfc_chk_stream_chunk_t chunk;
+    memset(&chunk, 0, sizeof(chunk));
+
+    uint32_t offset = (idx % chunks_per_pass) * MF_CHK_STREAM_KEYS;
+
+    chunk.sectorcnt = sectorsCnt;
+    chunk.strategy = (idx < chunks_per_pass) ? 1 : 2;
+    chunk.keycnt = MIN(keycnt - offset, MF_CHK_STREAM_KEYS);
+    if (idx == 0) {
+        chunk.flags |= MF_CHK_STREAM_FIRST;
+    }
+    if (idx == (chunks_per_pass * 2) - 1) {
+        chunk.flags |= MF_CHK_STREAM_LAST;
+    }
+    memcpy(chunk.keys, keyBlock + (offset * MIFARE_KEY_SIZE), chunk.keycnt * MIFARE_KEY_SIZE);
+
+    SendCommandNG(CMD_HF_MIFARE_CHKKEYS_STREAM, (uint8_t *)&chunk, sizeof(chunk));
+}
+
+// Same as looping mfCheckKeys_fast over the dictionary with both strategies,  but the keychunks
+// are pushed to the device while it is busy.  Found keys are reported as soon as the device has them.
+int mfCheckKeys_stream(uint8_t sectorsCnt, uint8_t *keyBlock, uint32_t keycnt, sector_t *e_sector, bool verbose) {
+
+    if (keycnt == 0) {
+        return PM3_EINVARG;
+    }
+
+    if (sectorsCnt > MIFARE_4K_MAXSECTOR) {
+        sectorsCnt = MIFARE_4K_MAXSECTOR;
+    }
+
+    uint32_t chunks_per_pass = (keycnt + MF_CHK_STREAM_KEYS - 1) / MF_CHK_STREAM_KEYS;
+    uint32_t total = chunks_per_pass * 2;
+    uint32_t sent = 0;
+
+    clearCommandBuffer();
+
+    // fill the ring on device side
+    while (sent < total && sent < MF_CHK_STREAM_SLOTS) {
+        mf_chk_stream_send(sent++, chunks_per_pass, sectorsCnt, keyBlock, keycnt);
+    }
+
+    uint64_t t1 = msclock();
+    bool aborted = false;
+    uint32_t timeout = 0;
+    PacketResponseNG resp;
+    mfc_chk_stream_status_t st;
+
+    for (;;) {
+
+        if (aborted == false && kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            aborted = true;
+        }
+
+        if (WaitForResponseTimeout(CMD_HF_MIFARE_CHKKEYS_STREAM, &resp, 2000) == false) {
+
+            PrintAndLogEx((timeout) ? NORMAL : INFO, "." NOLF);
+            fflush(stdout);
+
+            // same margin as for one keychunk in mfCheckKeys_fast
+            if (++timeout > 180) {
+                PrintAndLogEx(WARNING, "\nNo response from Proxmark3. Aborting...");
+                SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+                return PM3_ETIMEOUT;
+            }
+            continue;
+        }
+
+        if (timeout) {
+            PrintAndLogEx(NORMAL, "");
+            timeout = 0;
+        }
+
+        if (resp.length < sizeof(mfc_chk_stream_status_t)) {
+            return (resp.status != PM3_SUCCESS) ? resp.status : PM3_ESOFT;
+        }
+
+        memcpy(&st, resp.data.asBytes, sizeof(st));
+        const icesector_t *keys = (const icesector_t *)st.keys;
+
+        uint64_t hits[80];
+        uint32_t hitcnt = 0;
+
+        for (uint8_t i = 0; i < sectorsCnt; i++) {
+            for (uint8_t j = MF_KEY_A; j <= MF_KEY_B; j++) {
+
+                uint8_t m = (i * 2) + j;
+                if (e_sector[i].foundKey[j] || ((st.found[m >> 3] >> (m & 7)) & 1) == 0) {
+                    continue;
+                }
+
+                e_sector[i].Key[j] = bytes_to_num((j == MF_KEY_A) ? keys[i].keyA : keys[i].keyB, MIFARE_KEY_SIZE);
+                e_sector[i].foundKey[j] = 1;
+                hits[hitcnt++] = e_sector[i].Key[j];
+
+                PrintAndLogEx(SUCCESS, "found valid key sector %3u key %c [ " _GREEN_("%012" PRIX64) " ]"
+                              , i
+                              , (j == MF_KEY_B) ? 'B' : 'A'
+                              , e_sector[i].Key[j]
+                             );
+            }
+        }
+
+        mfKeyHitsAdd(hits, hitcnt);
+
+        if (verbose) {
+            PrintAndLogEx(INFO, "Chunk %u/%u %.1fs | found %u/%u keys", st.chunks, total, (float)((msclock() - t1) / 1000.0), st.foundkeys, (sectorsCnt << 1));
+        }
+
+        if (st.done) {
+            break;
+        }
+
+        // one slot free on device
+        if (aborted == false && sent < total) {
+            mf_chk_stream_send(sent++, chunks_per_pass, sectorsCnt, keyBlock, keycnt);
+        }
+    }
+
+    if (aborted) {
+        return PM3_EOPABORTED;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        return resp.status;
+    }
+
+    if (st.foundkeys == (sectorsCnt << 1)) {
+        return PM3_SUCCESS;
+    }
+
+    return (st.foundkeys) ? PM3_EPARTIAL : PM3_ESOFT;
+}
+
+// Let the device generate the candidate keys itself with the bruteforce generators (BF_MODE_*).
+// Only hits and a keep-alive get reported back,  found keys are reported as soon as the device has them.
+int mfCheckKeys_gen(uint8_t sectorsCnt, uint8_t mode, uint8_t charset, uint32_t range_low, uint32_t range_high,
+                    sector_t *e_sector, uint64_t *tested, bool verbose) {
+
+    if (sectorsCnt > MIFARE_4K_MAXSECTOR) {
+        sectorsCnt = MIFARE_4K_MAXSECTOR;
+    }
+
+    mfc_chk_gen_t payload = {
+        .sectorcnt = sectorsCnt,
+        .mode = mode,
+        .charset = charset,
+        .range_low = range_low,
+        .range_high = range_high,
+    };
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_CHKKEYS_GEN, (uint8_t *)&payload, sizeof(payload));
+
+    uint64_t t1 = msclock();
+    bool aborted = false;
+    uint32_t timeout = 0;
+    int stage = -1;
+    PacketResponseNG resp;
+    mfc_chk_gen_reply_t st;
+
+    for (;;) {
+
+        if (aborted == false && kbd_enter_pressed()) {
+            PrintAndLogEx(WARNING, "\naborted via keyboard!\n");
+            SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+            aborted = true;
+        }
+
+        if (WaitForResponseTimeout(CMD_HF_MIFARE_CHKKEYS_GEN, &resp, 2000) == false) {
+
+            PrintAndLogEx((timeout) ? NORMAL : INFO, "." NOLF);
+            fflush(stdout);
+
+            // device reports at least every MF_CHK_GEN_REPORT_MS plus one keychunk
+            if (++timeout > 180) {
+                PrintAndLogEx(WARNING, "\nNo response from Proxmark3. Aborting...");
+                SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
+                return PM3_ETIMEOUT;
+            }
+            continue;
+        }
+
+        if (timeout) {
+            PrintAndLogEx(NORMAL, "");
+            timeout = 0;
+        }
+
+        if (resp.length < sizeof(mfc_chk_gen_reply_t)) {
+            return (resp.status != PM3_SUCCESS) ? resp.status : PM3_ESOFT;
+        }
+
+        memcpy(&st, resp.data.asBytes, sizeof(st));
+        const icesector_t *keys = (const icesector_t *)st.keys;
+
+        if (tested) {
+            *tested = st.tested;
+        }
+
+        if (mode == BF_MODE_SMART && stage != st.stage && st.done == false) {
+            stage = st.stage;
+            PrintAndLogEx(INFO, "Running bruteforce stage %d", stage);
+        }
+
+        uint64_t hits[80];
+        uint32_t hitcnt = 0;
+
+        for (uint8_t i = 0; i < sectorsCnt; i++) {
+            for (uint8_t j = MF_KEY_A; j <= MF_KEY_B; j++) {
+
+                uint8_t m = (i * 2) + j;
+                if (e_sector[i].foundKey[j] || ((st.found[m >> 3] >> (m & 7)) & 1) == 0) {
+                    continue;
+                }
+
+                e_sector[i].Key[j] = bytes_to_num((j == MF_KEY_A) ? keys[i].keyA : keys[i].keyB, MIFARE_KEY_SIZE);
+                e_sector[i].foundKey[j] = 1;
+                hits[hitcnt++] = e_sector[i].Key[j];
+
+                PrintAndLogEx(SUCCESS, "found valid key sector %3u key %c [ " _GREEN_("%012" PRIX64) " ]"
+                              , i
+                              , (j == MF_KEY_B) ? 'B' : 'A'
+                              , e_sector[i].Key[j]
+                             );
+            }
+        }
+
+        mfKeyHitsAdd(hits, hitcnt);
+
+        uint64_t dt = msclock() - t1;
+        if (verbose && dt > 0) {
+            PrintAndLogEx(INFO, "Tested %u keys %.1fs ( %" PRIu64 " keys/s ) | found %u/%u keys"
+                          , st.tested
+                          , (float)(dt / 1000.0)
+                          , ((uint64_t)st.tested * 1000) / dt
+                          , st.foundkeys
+                          , (sectorsCnt << 1)
+                         );
+        }
+
+        if (st.done) {
+            break;
+        }
+    }
+
+    if (aborted) {
+        return PM3_EOPABORTED;
+    }
+
+    if (resp.status != PM3_SUCCESS) {
+        return resp.status;
+    }
+
+    if (st.foundkeys == (sectorsCnt << 1)) {
+        return PM3_SUCCESS;
+    }
+
+    return (st.foundkeys) ? PM3_EPARTIAL : PM3_ESOFT;
+}
+
 // Trigger device to use a binary file on flash mem as keylist for mfCheckKeys.
 // As of now,  255 keys possible in the file
 // 6 * 255 = 1500 bytes
@@ -409,40 +973,10 @@ int mfKeyBrute(uint8_t blockNo, uint8_t keyType, const uint8_t *key, uint64_t *r
     return found;
 }
 
-// Compare 16 Bits out of cryptostate
-inline static int Compare16Bits(const void *a, const void *b) {
-    if ((*(uint64_t *)b & 0x00ff000000ff0000) == (*(uint64_t *)a & 0x00ff000000ff0000)) return 0;
-    if ((*(uint64_t *)b & 0x00ff000000ff0000) > (*(uint64_t *)a & 0x00ff000000ff0000)) return 1;
-    return -1;
-}
-
-// wrapper function for multi-threaded lfsr_recovery32
-static void
-#ifdef __has_attribute
-#if __has_attribute(force_align_arg_pointer)
-__attribute__((force_align_arg_pointer))
-#endif
-#endif
-*nested_worker_thread(void *arg) {
-    struct Crypto1State *p1;
-    StateList_t *statelist = arg;
-    statelist->head.slhead = lfsr_recovery32(statelist->ks1, statelist->nt_enc ^ statelist->uid);
+// nested attack,  RF part.  Collects the two encrypted nonces for the target block
+int mfNestedAcquire(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool calibrate, mf_nested_job_t *job) {
 
-    for (p1 = statelist->head.slhead; p1->odd | p1->even; p1++) {};
-
-    statelist->len = p1 - statelist->head.slhead;
-    statelist->tail.sltail = --p1;
-
-    qsort(statelist->head.slhead, statelist->len, sizeof(uint64_t), Compare16Bits);
-
-    return statelist->head.slhead;
-}
-
-int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
-
-    uint32_t uid;
-    StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
+    memset(job, 0, sizeof(mf_nested_job_t));
 
     struct {
         uint8_t block;
@@ -484,79 +1018,59 @@ int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo,
     if (package->isOK != PM3_SUCCESS)
         return package->isOK;
 
+    uint32_t uid;
     memcpy(&uid, package->cuid, sizeof(package->cuid));
 
     for (uint8_t i = 0; i < 2; i++) {
-        statelists[i].blockNo = package->block;
-        statelists[i].keyType = package->keytype;
-        statelists[i].uid = uid;
+        job->statelists[i].blockNo = package->block;
+        job->statelists[i].keyType = package->keytype;
+        job->statelists[i].uid = uid;
     }
 
-    memcpy(&statelists[0].nt_enc,  package->nt_a, sizeof(package->nt_a));
-    memcpy(&statelists[0].ks1, package->ks_a, sizeof(package->ks_a));
+    memcpy(&job->statelists[0].nt_enc,  package->nt_a, sizeof(package->nt_a));
+    memcpy(&job->statelists[0].ks1, package->ks_a, sizeof(package->ks_a));
 
-    memcpy(&statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
-    memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
-
-    // calc keys
-    pthread_t thread_id[2];
+    memcpy(&job->statelists[1].nt_enc,  package->nt_b, sizeof(package->nt_b));
+    memcpy(&job->statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
+    return PM3_SUCCESS;
+}
 
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
+// key candidate lists are accounted in `hw memstats`
+static uint32_t nested_recover_tracked(uint32_t uid, const uint32_t nt_enc[2], const uint32_t ks1[2], uint64_t **keys) {
+    uint32_t keycnt = nested_recover_keys(uid, nt_enc, ks1, num_CPUs(), keys);
+    memstats_alloc(MEMSTATS_NESTED, keycnt * sizeof(uint64_t));
+    return keycnt;
+}
 
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
+static void nested_keys_free(uint64_t *keys, uint32_t keycnt) {
+    if (keys == NULL) {
+        return;
+    }
+    free(keys);
+    memstats_free(MEMSTATS_NESTED, keycnt * sizeof(uint64_t));
+}
 
-    // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
-    p1 = p3 = statelists[0].head.slhead;
-    p2 = p4 = statelists[1].head.slhead;
+// nested attack,  offline part.  No device communication,  safe to run in a thread
+// while the device is busy with the next target.
+void mfNestedRecover(mf_nested_job_t *job) {
 
-    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-        if (Compare16Bits(p1, p2) == 0) {
+    const StateList_t *statelists = job->statelists;
+    uint32_t nt_enc[2] = { statelists[0].nt_enc, statelists[1].nt_enc };
+    uint32_t ks1[2] = { statelists[0].ks1, statelists[1].ks1 };
 
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
-                *p4 = *p2;
-                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
-                p4++;
-                p2++;
-            }
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
-        }
-    }
+    job->keycnt = nested_recover_tracked(statelists[0].uid, nt_enc, ks1, &job->keys);
+}
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
-    statelists[0].len = p3 - statelists[0].head.slhead;
-    statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
+void mfNestedFree(mf_nested_job_t *job) {
+    nested_keys_free(job->keys, job->keycnt);
+    job->keys = NULL;
+}
 
-    // the statelists now contain possible keys. The key we are searching for must be in the
-    // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
+// nested attack,  RF part again.  Tests the candidates of mfNestedRecover against the card
+int mfNestedVerify(mf_nested_job_t *job, uint8_t *resultKey) {
 
-    //statelists[0].tail.keytail = --p7;
-    uint32_t keycnt = statelists[0].len;
+    StateList_t *statelists = job->statelists;
+    uint32_t keycnt = job->keycnt;
     if (keycnt == 0) goto out;
 
     PrintAndLogEx(SUCCESS, "Found " _YELLOW_("%u") " key candidates", keycnt);
@@ -564,55 +1078,113 @@ int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo,
     memset(resultKey, 0, 6);
     uint64_t key64 = -1;
 
-    // The list may still contain several key candidates. Test each of them with mfCheckKeys
-    uint32_t max_keys = keycnt > KEYS_IN_BLOCK ? KEYS_IN_BLOCK : keycnt;
-    uint8_t keyBlock[PM3_CMD_DATA_SIZE] = {0x00};
-
-    for (uint32_t i = 0; i < keycnt; i += max_keys) {
-
-        uint64_t start_time = msclock();
+    // The list may still contain several key candidates. The device tests them from BigBuf
+    uint8_t *keys = calloc(keycnt, 6);
+    if (keys == NULL) {
+        mfNestedFree(job);
+        return PM3_EMALLOC;
+    }
 
-        uint8_t size = keycnt - i > max_keys ? max_keys : keycnt - i;
+    for (uint32_t i = 0; i < keycnt; i++) {
+        num_to_bytes(job->keys[i], 6, keys + i * 6);
+    }
 
-        register uint8_t j;
-        for (j = 0; j < size; j++) {
-            crypto1_get_lfsr(statelists[0].head.slhead + i, &key64);
-            num_to_bytes(key64, 6, keyBlock + j * 6);
-        }
+    int res = mfCheckKeys_list(statelists[0].blockNo, statelists[0].keyType, keys, keycnt, &key64);
+    free(keys);
 
-        if (mfCheckKeys(statelists[0].blockNo, statelists[0].keyType, false, size, keyBlock, &key64) == PM3_SUCCESS) {
-            free(statelists[0].head.slhead);
-            free(statelists[1].head.slhead);
-            num_to_bytes(key64, 6, resultKey);
-
-            PrintAndLogEx(SUCCESS, "\nTarget block %4u key type %c -- found valid key [ " _GREEN_("%s") " ]",
-                          package->block,
-                          package->keytype ? 'B' : 'A',
-                          sprint_hex_inrow(resultKey, 6)
-                         );
-            return PM3_SUCCESS;
-        }
+    if (res == PM3_SUCCESS) {
+        mfNestedFree(job);
+        num_to_bytes(key64, 6, resultKey);
 
-        float bruteforce_per_second = (float)(i + max_keys) / ((msclock() - start_time) / 1000.0);
-        PrintAndLogEx(INPLACE, "%6d/%u keys | %5.1f keys/sec | worst case %6.1f seconds remaining", i, keycnt, bruteforce_per_second, (keycnt - i) / bruteforce_per_second);
+        PrintAndLogEx(SUCCESS, "\nTarget block %4u key type %c -- found valid key [ " _GREEN_("%s") " ]",
+                      statelists[0].blockNo,
+                      statelists[0].keyType ? 'B' : 'A',
+                      sprint_hex_inrow(resultKey, 6)
+                     );
+        return PM3_SUCCESS;
     }
 
 out:
     PrintAndLogEx(SUCCESS, "\nTarget block %4u key type %c",
-                  package->block,
-                  package->keytype ? 'B' : 'A'
+                  statelists[0].blockNo,
+                  statelists[0].keyType ? 'B' : 'A'
                  );
 
-    free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
+    mfNestedFree(job);
     return PM3_ESOFT;
 }
 
-int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey) {
+int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate) {
+
+    mf_nested_job_t job;
+    int res = mfNestedAcquire(blockNo, keyType, key, trgBlockNo, trgKeyType, calibrate, &job);
+    if (res != PM3_SUCCESS)
+        return res;
+
+    mfNestedRecover(&job);
+    return mfNestedVerify(&job, resultKey);
+}
+
+typedef struct {
+    uint8_t block;
+    uint8_t keytype;
+    uint8_t cuid[4];
+    uint8_t nt_a[4];
+    uint8_t ks_a[4];
+    uint8_t nt_b[4];
+    uint8_t ks_b[4];
+} PACKED static_nested_nonces_t;
+
+// nonces of the run and the first candidate not checked yet
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    static_nested_nonces_t nonces;
+    uint32_t next;
+} PACKED static_nested_checkpoint_t;
+
+#define STATIC_NESTED_CHECKPOINT_MAGIC      "SNCP"
+#define STATIC_NESTED_CHECKPOINT_INTERVAL   60000   // ms
+
+static void static_nested_checkpoint_save(const char *fn, const static_nested_nonces_t *nonces, uint32_t next) {
+    static_nested_checkpoint_t cp = { .version = 1, .next = next };
+    memcpy(cp.magic, STATIC_NESTED_CHECKPOINT_MAGIC, sizeof(cp.magic));
+    memcpy(&cp.nonces, nonces, sizeof(cp.nonces));
+
+    FILE *f = fopen(fn, "wb");
+    if (f == NULL) {
+        PrintAndLogEx(WARNING, "Could not write checkpoint file " _YELLOW_("%s"), fn);
+        return;
+    }
+    fwrite(&cp, 1, sizeof(cp), f);
+    fclose(f);
+}
+
+// returns the candidate to continue with, 0 if there is no usable checkpoint
+static uint32_t static_nested_checkpoint_load(const char *fn, static_nested_nonces_t *nonces) {
+    static_nested_checkpoint_t cp;
+    FILE *f = fopen(fn, "rb");
+    if (f == NULL) {
+        PrintAndLogEx(INFO, "No checkpoint " _YELLOW_("%s") " for this target, starting over", fn);
+        return 0;
+    }
+    size_t bytes_read = fread(&cp, 1, sizeof(cp), f);
+    fclose(f);
+
+    if (bytes_read != sizeof(cp) || memcmp(cp.magic, STATIC_NESTED_CHECKPOINT_MAGIC, sizeof(cp.magic)) || cp.version != 1 ||
+            memcmp(cp.nonces.cuid, nonces->cuid, sizeof(nonces->cuid)) ||
+            cp.nonces.block != nonces->block || cp.nonces.keytype != nonces->keytype) {
+        PrintAndLogEx(WARNING, "Checkpoint " _YELLOW_("%s") " doesn't match, starting over", fn);
+        return 0;
+    }
+
+    memcpy(nonces, &cp.nonces, sizeof(cp.nonces));
+    return cp.next;
+}
+
+int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool resume) {
 
     uint32_t uid;
-    StateList_t statelists[2];
-    struct Crypto1State *p1, *p2, *p3, *p4;
 
     struct {
         uint8_t block;
@@ -637,221 +1209,90 @@ int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBl
     if (resp.status != PM3_SUCCESS)
         return resp.status;
 
-    struct p {
-        uint8_t block;
-        uint8_t keytype;
-        uint8_t cuid[4];
-        uint8_t nt_a[4];
-        uint8_t ks_a[4];
-        uint8_t nt_b[4];
-        uint8_t ks_b[4];
-    } PACKED;
-    struct p *package = (struct p *)resp.data.asBytes;
+    static_nested_nonces_t *package = (static_nested_nonces_t *)resp.data.asBytes;
 
     memcpy(&uid, package->cuid, sizeof(package->cuid));
 
-    for (uint8_t i = 0; i < 2; i++) {
-        statelists[i].blockNo = package->block;
-        statelists[i].keyType = package->keytype;
-        statelists[i].uid = uid;
-    }
-
-    memcpy(&statelists[0].nt_enc, package->nt_a, sizeof(package->nt_a));
-    memcpy(&statelists[0].ks1, package->ks_a, sizeof(package->ks_a));
-
-    memcpy(&statelists[1].nt_enc, package->nt_b, sizeof(package->nt_b));
-    memcpy(&statelists[1].ks1, package->ks_b, sizeof(package->ks_b));
-
-    // calc keys
-    pthread_t thread_id[2];
-
-    // create and run worker threads
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_create(thread_id + i, NULL, nested_worker_thread, &statelists[i]);
-
-    // wait for threads to terminate:
-    for (uint8_t i = 0; i < 2; i++)
-        pthread_join(thread_id[i], (void *)&statelists[i].head.slhead);
-
-    // the first 16 Bits of the cryptostate already contain part of our key.
-    // Create the intersection of the two lists based on these 16 Bits and
-    // roll back the cryptostate
-    p1 = p3 = statelists[0].head.slhead;
-    p2 = p4 = statelists[1].head.slhead;
-
-    while (p1 <= statelists[0].tail.sltail && p2 <= statelists[1].tail.sltail) {
-        if (Compare16Bits(p1, p2) == 0) {
-
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-            savestate = *p2;
-            while (Compare16Bits(p2, &savestate) == 0 && p2 <= statelists[1].tail.sltail) {
-                *p4 = *p2;
-                lfsr_rollback_word(p4, statelists[1].nt_enc ^ statelists[1].uid, 0);
-                p4++;
-                p2++;
-            }
-        } else {
-            while (Compare16Bits(p1, p2) == -1) p1++;
-            while (Compare16Bits(p1, p2) == 1) p2++;
-        }
+    // The candidate list depends on the nonces, a resumed run has to use the ones of the
+    // interrupted run instead of the fresh ones
+    char ckpt_fn[64];
+    snprintf(ckpt_fn, sizeof(ckpt_fn), "hf-mf-%08X-staticnested-%03u%c.ckpt", uid, package->block, package->keytype ? 'B' : 'A');
+    uint32_t start_idx = 0;
+    if (resume) {
+        start_idx = static_nested_checkpoint_load(ckpt_fn, package);
     }
 
-    p3->odd = -1;
-    p3->even = -1;
-    p4->odd = -1;
-    p4->even = -1;
-    statelists[0].len = p3 - statelists[0].head.slhead;
-    statelists[1].len = p4 - statelists[1].head.slhead;
-    statelists[0].tail.sltail = --p3;
-    statelists[1].tail.sltail = --p4;
-
-    // the statelists now contain possible keys. The key we are searching for must be in the
-    // intersection of both lists
-    qsort(statelists[0].head.keyhead, statelists[0].len, sizeof(uint64_t), compare_uint64);
-    qsort(statelists[1].head.keyhead, statelists[1].len, sizeof(uint64_t), compare_uint64);
-    // Create the intersection
-    statelists[0].len = intersection(statelists[0].head.keyhead, statelists[1].head.keyhead);
+    uint32_t nt_enc[2], ks1[2];
+    memcpy(&nt_enc[0], package->nt_a, sizeof(package->nt_a));
+    memcpy(&ks1[0], package->ks_a, sizeof(package->ks_a));
+    memcpy(&nt_enc[1], package->nt_b, sizeof(package->nt_b));
+    memcpy(&ks1[1], package->ks_b, sizeof(package->ks_b));
 
-
-    /*
-
-        memcpy(&uid, package->cuid, sizeof(package->cuid));
-
-        statelists[0].blockNo = package->block;
-        statelists[0].keyType = package->keytype;
-        statelists[0].uid = uid;
-
-        memcpy(&statelists[0].nt_enc, package->nt, sizeof(package->nt));
-        memcpy(&statelists[0].ks1, package->ks, sizeof(package->ks));
-
-        // calc keys
-        pthread_t t;
-
-        // create and run worker thread
-        pthread_create(&t, NULL, nested_worker_thread, &statelists[0]);
-
-        // wait for thread to terminate:
-        pthread_join(t, (void *)&statelists[0].head.slhead);
-
-        // the first 16 Bits of the cryptostate already contain part of our key.
-        p1 = p3 = statelists[0].head.slhead;
-
-        // create key candidates.
-        while (p1 <= statelists[0].tail.sltail) {
-            struct Crypto1State savestate;
-            savestate = *p1;
-            while (Compare16Bits(p1, &savestate) == 0 && p1 <= statelists[0].tail.sltail) {
-                *p3 = *p1;
-                lfsr_rollback_word(p3, statelists[0].nt_enc ^ statelists[0].uid, 0);
-                p3++;
-                p1++;
-            }
-        }
-
-        p3->odd = -1;
-        p3->even = -1;
-        statelists[0].len = p3 - statelists[0].head.slhead;
-        statelists[0].tail.sltail = --p3;
-    */
-
-    uint32_t keycnt = statelists[0].len;
+    uint64_t *keys = NULL;
+    uint32_t keycnt = nested_recover_tracked(uid, nt_enc, ks1, &keys);
     if (keycnt == 0) goto out;
 
     PrintAndLogEx(SUCCESS, "Found " _YELLOW_("%u") " key candidates", keycnt);
+    if (start_idx >= keycnt) {
+        start_idx = 0;
+    } else if (start_idx) {
+        PrintAndLogEx(SUCCESS, "Resuming at candidate " _YELLOW_("%u"), start_idx);
+    }
 
     memset(resultKey, 0, 6);
 
-    // The list may still contain several key candidates. Test each of them with mfCheckKeys
-    uint32_t maxkeysinblock = IfPm3Flash() ? 1000 : KEYS_IN_BLOCK;
-    uint32_t max_keys_chunk = keycnt > maxkeysinblock ? maxkeysinblock : keycnt;
-
-    uint8_t *mem = NULL;
-    uint8_t *p_keyblock = NULL;
+    // The list may still contain several key candidates. The device tests them from BigBuf,
+    // a run at a time so progress and checkpoints keep going
+    uint32_t max_keys_chunk = keycnt > MF_CHK_LIST_MAX ? MF_CHK_LIST_MAX : keycnt;
 
-    // if RDV4 and more than 10 candidate keys
-    if (IfPm3Flash() && keycnt > 70) {
-
-        // used for mfCheckKeys_file, which needs a header
-        mem = calloc((maxkeysinblock * 6) + 5, sizeof(uint8_t));
-        if (mem == NULL) {
-            free(statelists[0].head.slhead);
-            return PM3_EMALLOC;
-        }
-
-        mem[0] = statelists[0].keyType;
-        mem[1] = statelists[0].blockNo;
-        mem[2] = 1;
-        mem[3] = ((max_keys_chunk >> 8) & 0xFF);
-        mem[4] = (max_keys_chunk & 0xFF);
-
-        p_keyblock = mem + 5;
-    } else {
-
-        // used for mfCheckKeys, which adds its own header.
-        mem = calloc((maxkeysinblock * 6), sizeof(uint8_t));
-        if (mem == NULL) {
-            free(statelists[0].head.slhead);
-            return PM3_EMALLOC;
-        }
-        p_keyblock = mem;
+    uint8_t *mem = calloc(max_keys_chunk * 6, sizeof(uint8_t));
+    if (mem == NULL) {
+        nested_keys_free(keys, keycnt);
+        return PM3_EMALLOC;
     }
-
-    uint8_t fn[32] = "static_nested_000.bin";
+    uint8_t *p_keyblock = mem;
 
     uint64_t start_time = msclock();
-    for (uint32_t i = 0; i < keycnt; i += max_keys_chunk) {
+    uint64_t last_checkpoint = start_time;
+    for (uint32_t i = start_idx; i < keycnt; i += max_keys_chunk) {
 
         //flush queue
         while (kbd_enter_pressed()) {
             SendCommandNG(CMD_BREAK_LOOP, NULL, 0);
             PrintAndLogEx(NORMAL, "");
+            static_nested_checkpoint_save(ckpt_fn, package, i);
+            PrintAndLogEx(INFO, "Progress saved, continue with " _YELLOW_("`hf mf staticnested --resume`"));
+            nested_keys_free(keys, keycnt);
             free(mem);
             return PM3_EOPABORTED;
         }
 
-        int res = 0;
+        if (msclock() - last_checkpoint > STATIC_NESTED_CHECKPOINT_INTERVAL) {
+            static_nested_checkpoint_save(ckpt_fn, package, i);
+            last_checkpoint = msclock();
+        }
+
         uint64_t key64 = 0;
         uint32_t chunk = keycnt - i > max_keys_chunk ? max_keys_chunk : keycnt - i;
 
         // copy x keys to device.
         for (uint32_t j = 0; j < chunk; j++) {
-            crypto1_get_lfsr(statelists[0].head.slhead + i + j, &key64);
-            num_to_bytes(key64, 6, p_keyblock + j * 6);
+            num_to_bytes(keys[i + j], 6, p_keyblock + j * 6);
         }
 
         // check a block of generated key candidates.
-        if (IfPm3Flash() && keycnt > 70) {
-
-            mem[3] = ((chunk >> 8) & 0xFF);
-            mem[4] = (chunk & 0xFF);
-
-            // upload to flash.
-            res = flashmem_spiffs_load((char *)fn, mem, 5 + (chunk * 6));
-            if (res != PM3_SUCCESS) {
-                PrintAndLogEx(WARNING, "\nSPIFFS upload failed");
-                free(mem);
-                return res;
-            }
-            res = mfCheckKeys_file(fn, &key64);
-        } else {
-            res = mfCheckKeys(statelists[0].blockNo, statelists[0].keyType, true, chunk, mem, &key64);
-        }
+        int res = mfCheckKeys_list(package->block, package->keytype, p_keyblock, chunk, &key64);
 
         if (res == PM3_SUCCESS) {
             p_keyblock = NULL;
-            free(statelists[0].head.slhead);
+            nested_keys_free(keys, keycnt);
             free(mem);
+            remove(ckpt_fn);
 
             num_to_bytes(key64, 6, resultKey);
 
-            if (IfPm3Flash() && keycnt > 70)
+            // after the in place progress line
+            if (i > start_idx)
                 PrintAndLogEx(NORMAL, "");
 
             PrintAndLogEx(SUCCESS, "target block %4u key type %c -- found valid key [ " _GREEN_("%s") " ]",
@@ -862,16 +1303,19 @@ int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBl
             return PM3_SUCCESS;
         } else if (res == PM3_ETIMEOUT || res == PM3_EOPABORTED) {
             PrintAndLogEx(NORMAL, "");
+            static_nested_checkpoint_save(ckpt_fn, package, i);
+            nested_keys_free(keys, keycnt);
             free(mem);
             return res;
         }
 
-        float bruteforce_per_second = (float)(i + max_keys_chunk) / ((msclock() - start_time) / 1000.0);
+        float bruteforce_per_second = (float)(i - start_idx + max_keys_chunk) / ((msclock() - start_time) / 1000.0);
         PrintAndLogEx(INPLACE, "%6u/%u keys | %5.1f keys/sec | worst case %6.1f seconds", i, keycnt, bruteforce_per_second, (keycnt - i) / bruteforce_per_second);
     }
 
     p_keyblock = NULL;
     free(mem);
+    remove(ckpt_fn);
 
 out:
 
@@ -880,8 +1324,7 @@ out:
                   package->keytype ? 'B' : 'A'
                  );
 
-    free(statelists[0].head.slhead);
-    free(statelists[1].head.slhead);
+    nested_keys_free(keys, keycnt);
     return PM3_ESOFT;
 }
 
@@ -1213,7 +1656,7 @@ int tryDecryptWord(uint32_t nt, uint32_t ar_enc, uint32_t at_enc, uint8_t *data,
     uint32_t ks2 = ar_enc ^ prng_successor(nt, 64);
     uint32_t ks3 = at_enc ^ prng_successor(nt, 96);
 
-    struct Crypto1State *s = lfsr_recovery64(ks2, ks3);
+    struct Crypto1State *s = lfsr_recovery64_mt(ks2, ks3, num_CPUs());
     mf_crypto1_decrypt(s, data, len, false);
     PrintAndLogEx(SUCCESS, "decrypted data... " _YELLOW_("%s"), sprint_hex(data, len));
     PrintAndLogEx(NORMAL, "");
@@ -1363,6 +1806,28 @@ int detect_classic_static_nonce(void) {
     return NONCE_FAIL;
 }
 
+/* Static nonce,  prng and EV1 signature in one device side probe
+returns PM3_SUCCESS with caps filled in,  caps->nonce is NONCE_FAIL when no nonce could be read
+*/
+int detect_classic_caps(mfc_caps_t *caps) {
+
+    memset(caps, 0, sizeof(mfc_caps_t));
+    caps->nonce = NONCE_FAIL;
+
+    clearCommandBuffer();
+    SendCommandNG(CMD_HF_MIFARE_CAPS_PROBE, (uint8_t *)g_mifare_signature_key_b, sizeof(g_mifare_signature_key_b));
+    PacketResponseNG resp;
+    if (WaitForResponseTimeout(CMD_HF_MIFARE_CAPS_PROBE, &resp, 1500) == false) {
+        PrintAndLogEx(WARNING, "command execution time out");
+        return PM3_ETIMEOUT;
+    }
+
+    if (resp.length == sizeof(mfc_caps_t)) {
+        memcpy(caps, resp.data.asBytes, sizeof(mfc_caps_t));
+    }
+    return PM3_SUCCESS;
+}
+
 /* Detect Mifare Classic static encrypted nonce
 detects special magic cards that has a static / fixed nonce
 returns:
@@ -24,6 +24,7 @@
 
 #include "util.h"       // FILE_PATH_SIZE
 #include "protocol_vigik.h"
+#include "pm3_cmd.h"    // mfc_caps_t
 
 #define MIFARE_SECTOR_RETRY     10
 
@@ -65,17 +66,36 @@ typedef struct {
     //uint8_t foundKey[2];
 } icesector_t;
 
+// one nested attack split in its RF and offline parts,  see mfnested()
+typedef struct {
+    StateList_t statelists[2];
+    uint64_t *keys;         // key candidates,  see mfNestedRecover()
+    uint32_t keycnt;
+} mf_nested_job_t;
+
 #define KEYS_IN_BLOCK   ((PM3_CMD_DATA_SIZE - 5) / 6)
 #define KEYBLOCK_SIZE   (KEYS_IN_BLOCK * 6)
+// candidate keys checked on the device in one CMD_HF_MIFARE_CHKKEYS_LIST run
+#define MF_CHK_LIST_MAX 2048
 #define CANDIDATE_SIZE  (0xFFFF * 6)
 
 int mfDarkside(uint8_t blockno, uint8_t key_type, uint64_t *key);
+int mfNestedAcquire(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, bool calibrate, mf_nested_job_t *job);
+void mfNestedRecover(mf_nested_job_t *job);
+int mfNestedVerify(mf_nested_job_t *job, uint8_t *resultKey);
+void mfNestedFree(mf_nested_job_t *job);
 int mfnested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool calibrate);
-int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey);
+int mfStaticNested(uint8_t blockNo, uint8_t keyType, uint8_t *key, uint8_t trgBlockNo, uint8_t trgKeyType, uint8_t *resultKey, bool resume);
 int mfCheckKeys(uint8_t blockNo, uint8_t keyType, bool clear_trace, uint8_t keycnt, uint8_t *keyBlock, uint64_t *key);
+int mfCheckKeys_list(uint8_t blockNo, uint8_t keyType, const uint8_t *keys, uint32_t keycnt, uint64_t *key);
 int mfCheckKeys_fast(uint8_t sectorsCnt, uint8_t firstChunk, uint8_t lastChunk,
                      uint8_t strategy, uint32_t size, uint8_t *keyBlock, sector_t *e_sector,
                      bool use_flashmemory, bool verbose);
+void mfKeyHitsAdd(const uint64_t *keys, uint32_t keycnt);
+void mfKeyHitsSort(uint8_t *keyBlock, uint32_t keycnt);
+int mfCheckKeys_stream(uint8_t sectorsCnt, uint8_t *keyBlock, uint32_t keycnt, sector_t *e_sector, bool verbose);
+int mfCheckKeys_gen(uint8_t sectorsCnt, uint8_t mode, uint8_t charset, uint32_t range_low, uint32_t range_high,
+                    sector_t *e_sector, uint64_t *tested, bool verbose);
 
 int mfCheckKeys_file(uint8_t *destfn, uint64_t *key);
 
@@ -103,6 +123,7 @@ int detect_classic_prng(void);
 int detect_classic_nackbug(bool verbose);
 uint16_t detect_mf_magic(bool is_mfc, uint8_t key_type, uint64_t key);
 int detect_classic_static_nonce(void);
+int detect_classic_caps(mfc_caps_t *caps);
 int detect_classic_static_encrypted_nonce(uint8_t block_no, uint8_t key_type, uint8_t *key);
 bool detect_mfc_ev1_signature(void);
 int read_mfc_ev1_signature(uint8_t *signature);
@@ -1368,3 +1368,118 @@ int NDEFGetTotalLength(uint8_t *ndef, size_t ndeflen, size_t *outlen) {
     *outlen = idx;
     return PM3_SUCCESS;
 }
+
+// Expands {uid} to the uid as uppercase hex and {ctr} to the decimal counter
+static int ndefExpandTemplate(const char *tmpl, const uint8_t *uid, size_t uidlen, uint32_t counter, char *out, size_t maxlen) {
+    size_t n = 0;
+    while (*tmpl) {
+        char field[32] = {0};
+        size_t skip = 1;
+
+        if (strncmp(tmpl, "{uid}", 5) == 0) {
+            for (size_t i = 0; i < uidlen && (i * 2) < sizeof(field) - 2; i++) {
+                snprintf(field + (i * 2), 3, "%02X", uid[i]);
+            }
+            skip = 5;
+        } else if (strncmp(tmpl, "{ctr}", 5) == 0) {
+            snprintf(field, sizeof(field), "%u", counter);
+            skip = 5;
+        } else {
+            field[0] = *tmpl;
+        }
+
+        size_t flen = strlen(field);
+        if (n + flen >= maxlen) {
+            return -1;
+        }
+        memcpy(out + n, field, flen);
+        n += flen;
+        tmpl += skip;
+    }
+    out[n] = 0;
+    return n;
+}
+
+// Builds a NDEF message TLV (03 <len> <record> FE) holding one URI or text
+// record from a template. Meant for encoding many tags, only the
+// substituted uid / counter differ between calls.
+int NDEFEncodeTemplate(ndefTemplateType_t type, const char *tmpl, const uint8_t *uid, size_t uidlen, uint32_t counter, uint8_t *out, size_t maxlen, size_t *outlen) {
+
+    *outlen = 0;
+
+    char text[512] = {0};
+    int textlen = ndefExpandTemplate(tmpl, uid, uidlen, counter, text, sizeof(text));
+    if (textlen < 0) {
+        PrintAndLogEx(ERR, "expanded template too long");
+        return PM3_EOVFLOW;
+    }
+
+    uint8_t payload[sizeof(text) + 3] = {0};
+    size_t plen = 0;
+    uint8_t rtype;
+
+    if (type == ndefTemplateURI) {
+        // longest matching abbreviation wins
+        uint8_t prefix = 0;
+        size_t prefixlen = 0;
+        for (uint8_t i = 1; i < ARRAYLEN(URI_s); i++) {
+            size_t l = strlen(URI_s[i]);
+            if (l > prefixlen && strncmp(text, URI_s[i], l) == 0) {
+                prefix = i;
+                prefixlen = l;
+            }
+        }
+        rtype = 'U';
+        payload[plen++] = prefix;
+        memcpy(payload + plen, text + prefixlen, textlen - prefixlen);
+        plen += textlen - prefixlen;
+    } else {
+        // UTF-8, language code "en"
+        rtype = 'T';
+        payload[plen++] = 0x02;
+        payload[plen++] = 'e';
+        payload[plen++] = 'n';
+        memcpy(payload + plen, text, textlen);
+        plen += textlen;
+    }
+
+    // record,  MB | ME | SR for short payloads,  TNF well known
+    uint8_t record[sizeof(payload) + 7];
+    size_t rlen = 0;
+    if (plen < 0x100) {
+        record[rlen++] = 0xD0 | tnfWellKnownRecord;
+        record[rlen++] = 1;
+        record[rlen++] = plen;
+    } else {
+        record[rlen++] = 0xC0 | tnfWellKnownRecord;
+        record[rlen++] = 1;
+        Uint4byteToMemBe(record + rlen, plen);
+        rlen += 4;
+    }
+    record[rlen++] = rtype;
+    memcpy(record + rlen, payload, plen);
+    rlen += plen;
+
+    // message TLV + terminator TLV
+    size_t need = rlen + ((rlen < 0xFF) ? 2 : 4) + 1;
+    if (need > maxlen) {
+        PrintAndLogEx(ERR, "NDEF message too big, %zu bytes, max %zu", need, maxlen);
+        return PM3_EOVFLOW;
+    }
+
+    size_t n = 0;
+    out[n++] = 0x03;
+    if (rlen < 0xFF) {
+        out[n++] = rlen;
+    } else {
+        out[n++] = 0xFF;
+        Uint2byteToMemBe(out + n, rlen);
+        n += 2;
+    }
+    memcpy(out + n, record, rlen);
+    n += rlen;
+    out[n++] = 0xFE;
+
+    *outlen = n;
+    return PM3_SUCCESS;
+}
@@ -74,7 +74,13 @@ typedef struct {
     uint8_t *ID;
 } NDEFHeader_t;
 
+typedef enum {
+    ndefTemplateURI,
+    ndefTemplateText,
+} ndefTemplateType_t;
+
 int NDEFDecodeAndPrint(uint8_t *ndef, size_t ndefLen, bool verbose);
 int NDEFRecordsDecodeAndPrint(uint8_t *ndefRecord, size_t ndefRecordLen, bool verbose);
 int NDEFGetTotalLength(uint8_t *ndef, size_t ndeflen, size_t *outlen);
+int NDEFEncodeTemplate(ndefTemplateType_t type, const char *tmpl, const uint8_t *uid, size_t uidlen, uint32_t counter, uint8_t *out, size_t maxlen, size_t *outlen);
 #endif // _NDEF_H_
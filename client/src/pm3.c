@@ -19,6 +19,12 @@
 #include "pm3.h"
 
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 #include "proxmark3.h"
 #include "cmdmain.h"
@@ -26,9 +32,15 @@
 #include "usart_defs.h"
 #include "util_posix.h"
 #include "comms.h"
+#include "util.h"     // g_printAndLog
+#include "graph.h"
 
 pm3_device_t *pm3_open(const char *port) {
     pm3_init();
+    // several devices can be open, the previous one is parked
+    if (g_session.pm3_present && (ParkProxmark() == PM3_SUCCESS)) {
+        g_session.current_device = NULL;
+    }
     OpenProxmark(&g_session.current_device, port, false, 20, false, USART_BAUD_RATE);
     if (g_session.pm3_present && (TestProxmark(g_session.current_device) != PM3_SUCCESS)) {
         PrintAndLogEx(ERR, _RED_("ERROR:") " cannot communicate with the Proxmark3\n");
@@ -46,8 +58,11 @@ pm3_device_t *pm3_open(const char *port) {
 }
 
 void pm3_close(pm3_device_t *dev) {
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
     // Clean up the port
-    if (g_session.pm3_present) {
+    if (g_session.pm3_present && (g_session.current_device == dev)) {
         clearCommandBuffer();
         SendCommandNG(CMD_QUIT_SESSION, NULL, 0);
         msleep(100); // Make sure command is sent before killing client
@@ -56,11 +71,243 @@ void pm3_close(pm3_device_t *dev) {
 }
 
 int pm3_console(pm3_device_t *dev, const char *cmd) {
-    // For now, there is no real device context:
-    (void) dev;
+    // commands go to the active device, switch to the one asked for
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
     return CommandReceived(cmd);
 }
 
+char *pm3_console_json(pm3_device_t *dev, const char *cmd) {
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
+    // keep logging to file, but nothing on screen
+    uint8_t old_printAndLog = g_printAndLog;
+    g_printAndLog &= PRINTANDLOG_LOG;
+
+    ResultOpen();
+    ResultAddStr("cmd", cmd);
+    int res = CommandReceived(cmd);
+    ResultAddInt("status", res);
+
+    g_printAndLog = old_printAndLog;
+    return ResultClose(false);
+}
+
+// Async jobs. The client keeps its state in globals (current device, graph and demod
+// buffers), so jobs are run one after the other by a single worker thread
+typedef struct pm3_async_job_s {
+    pm3_device_t *dev;
+    char *cmd;
+    pm3_done_cb cb;
+    void *ctx;
+    int status;
+    struct pm3_async_job_s *next;
+} pm3_async_job_t;
+
+static pthread_mutex_t gs_async_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gs_async_cond = PTHREAD_COND_INITIALIZER;
+static pm3_async_job_t *gs_async_todo = NULL;
+static pm3_async_job_t *gs_async_done = NULL;
+static bool gs_async_running = false;
+static int gs_async_pipe[2] = {-1, -1};
+
+static void async_push(pm3_async_job_t **list, pm3_async_job_t *job) {
+    job->next = NULL;
+    while (*list) {
+        list = &(*list)->next;
+    }
+    *list = job;
+}
+
+static void *async_worker(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&gs_async_lock);
+        while (gs_async_todo == NULL) {
+            pthread_cond_wait(&gs_async_cond, &gs_async_lock);
+        }
+        pm3_async_job_t *job = gs_async_todo;
+        gs_async_todo = job->next;
+        pthread_mutex_unlock(&gs_async_lock);
+
+        job->status = pm3_console(job->dev, job->cmd);
+
+        pthread_mutex_lock(&gs_async_lock);
+        async_push(&gs_async_done, job);
+        pthread_mutex_unlock(&gs_async_lock);
+#if !defined(_WIN32)
+        if (gs_async_pipe[1] >= 0) {
+            char c = 1;
+            if (write(gs_async_pipe[1], &c, 1) < 0) {
+                // pipe full, the pending completions are collected anyway
+            }
+        }
+#endif
+    }
+    return NULL;
+}
+
+static int async_start(void) {
+    if (gs_async_running) {
+        return PM3_SUCCESS;
+    }
+#if !defined(_WIN32)
+    if (pipe(gs_async_pipe) == 0) {
+        fcntl(gs_async_pipe[0], F_SETFL, fcntl(gs_async_pipe[0], F_GETFL) | O_NONBLOCK);
+        fcntl(gs_async_pipe[1], F_SETFL, fcntl(gs_async_pipe[1], F_GETFL) | O_NONBLOCK);
+    } else {
+        gs_async_pipe[0] = gs_async_pipe[1] = -1;
+    }
+#endif
+    pthread_t worker;
+    if (pthread_create(&worker, NULL, &async_worker, NULL) != 0) {
+        return PM3_EFAILED;
+    }
+    pthread_detach(worker);
+    gs_async_running = true;
+    return PM3_SUCCESS;
+}
+
+int pm3_console_async(pm3_device_t *dev, const char *cmd, pm3_done_cb cb, void *ctx) {
+    if (cmd == NULL) {
+        return PM3_EINVARG;
+    }
+    pm3_async_job_t *job = calloc(1, sizeof(pm3_async_job_t));
+    if (job == NULL) {
+        return PM3_EMALLOC;
+    }
+    job->cmd = strdup(cmd);
+    if (job->cmd == NULL) {
+        free(job);
+        return PM3_EMALLOC;
+    }
+    job->dev = dev;
+    job->cb = cb;
+    job->ctx = ctx;
+
+    pthread_mutex_lock(&gs_async_lock);
+    int res = async_start();
+    if (res == PM3_SUCCESS) {
+        async_push(&gs_async_todo, job);
+        pthread_cond_signal(&gs_async_cond);
+    }
+    pthread_mutex_unlock(&gs_async_lock);
+
+    if (res != PM3_SUCCESS) {
+        free(job->cmd);
+        free(job);
+    }
+    return res;
+}
+
+int pm3_async_fd(void) {
+    pthread_mutex_lock(&gs_async_lock);
+    async_start();
+    int fd = gs_async_pipe[0];
+    pthread_mutex_unlock(&gs_async_lock);
+    return fd;
+}
+
+// Runs the callbacks of finished jobs, returns how many were reported
+int pm3_async_poll(void) {
+    pthread_mutex_lock(&gs_async_lock);
+    pm3_async_job_t *job = gs_async_done;
+    gs_async_done = NULL;
+#if !defined(_WIN32)
+    if (gs_async_pipe[0] >= 0) {
+        char c[32];
+        while (read(gs_async_pipe[0], c, sizeof(c)) > 0) {};
+    }
+#endif
+    pthread_mutex_unlock(&gs_async_lock);
+
+    int n = 0;
+    while (job) {
+        pm3_async_job_t *next = job->next;
+        if (job->cb) {
+            job->cb(job->dev, job->cmd, job->status, job->ctx);
+        }
+        free(job->cmd);
+        free(job);
+        job = next;
+        n++;
+    }
+    return n;
+}
+
+int pm3_batch(pm3_device_t *dev, const uint8_t *req, size_t req_len, uint8_t *resp, size_t resp_max, size_t *resp_len, uint32_t ms_timeout) {
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
+    if (g_session.pm3_present == false) {
+        return PM3_ENOTTY;
+    }
+    return SendCommandBatch(req, req_len, resp, resp_max, resp_len, ms_timeout);
+}
+
+static int pm3_mem_get(pm3_device_t *dev, DeviceMemType_t memtype, uint8_t *dest, size_t len, size_t offset) {
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
+    if (g_session.pm3_present == false) {
+        return PM3_ENOTTY;
+    }
+    if ((dest == NULL) || (len == 0)) {
+        return PM3_EINVARG;
+    }
+    if (GetFromDevice(memtype, dest, len, offset, NULL, 0, NULL, 2500, false) == false) {
+        return PM3_ETIMEOUT;
+    }
+    return PM3_SUCCESS;
+}
+
+int pm3_bigbuf_get(pm3_device_t *dev, uint8_t *dest, size_t len, size_t offset) {
+    return pm3_mem_get(dev, BIG_BUF, dest, len, offset);
+}
+
+int pm3_emulator_get(pm3_device_t *dev, uint8_t *dest, size_t len, size_t offset) {
+    return pm3_mem_get(dev, BIG_BUF_EML, dest, len, offset);
+}
+
+int pm3_trace_get(pm3_device_t *dev, uint8_t *dest, size_t max, size_t *len) {
+    if (IsProxmarkParked(dev)) {
+        SelectProxmark(dev);
+    }
+    if (g_session.pm3_present == false) {
+        return PM3_ENOTTY;
+    }
+    // the first chunk tells the trace length
+    uint8_t first[PM3_CMD_DATA_SIZE];
+    PacketResponseNG resp;
+    if (GetFromDevice(BIG_BUF, first, sizeof(first), 0, NULL, 0, &resp, 4000, false) == false) {
+        return PM3_ETIMEOUT;
+    }
+    size_t tracelen = resp.oldarg[2];
+    if (len) {
+        *len = tracelen;
+    }
+
+    size_t n = MIN(max, tracelen);
+    if ((dest == NULL) || (n == 0)) {
+        return PM3_SUCCESS;
+    }
+    memcpy(dest, first, MIN(n, sizeof(first)));
+    if (n > sizeof(first)) {
+        return pm3_mem_get(dev, BIG_BUF, dest + sizeof(first), n - sizeof(first), sizeof(first));
+    }
+    return PM3_SUCCESS;
+}
+
+const int32_t *pm3_graph_get(pm3_device_t *dev, size_t *len) {
+    (void)dev;
+    if (len) {
+        *len = g_GraphTraceLen;
+    }
+    return g_GraphBuffer;
+}
+
 const char *pm3_name_get(pm3_device_t *dev) {
     return dev->g_conn->serial_port_name;
 }
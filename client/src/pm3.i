@@ -32,8 +32,160 @@ typedef struct {
         }
         int console(char *cmd);
         char const * const name;
+#ifdef SWIGPYTHON
+        %pythoncode %{
+    def bigbuf(self, length, offset=0, out=None):
+        return _pm3.pm3_bigbuf(self, length, offset, out)
+
+    def emulator(self, length, offset=0, out=None):
+        return _pm3.pm3_emulator(self, length, offset, out)
+
+    def trace(self, out=None):
+        return _pm3.pm3_trace(self, out)
+
+    def graph(self, out=None):
+        return _pm3.pm3_graph(self, out)
+        %}
+#endif
     }
 } pm3;
 //%nodefaultctor device;
 //%nodefaultdtor device;
+#ifdef SWIGPYTHON
+%{
+// Bulk accessors: the data goes straight into a new bytes object, or into a caller
+// supplied writable buffer (bytearray, numpy array...) without per element conversion
+typedef int (*pm3_py_fill_t)(pm3 *dev, uint8_t *dest, size_t len, size_t offset);
+
+static PyObject *pm3_py_error(int status) {
+    PyErr_Format(PyExc_IOError, "pm3 error %d", status);
+    return NULL;
+}
+
+static pm3 *pm3_py_dev(PyObject *obj) {
+    void *argp = NULL;
+    if (!SWIG_IsOK(SWIG_ConvertPtr(obj, &argp, SWIGTYPE_p_pm3, 0))) {
+        PyErr_SetString(PyExc_TypeError, "expected a pm3 object");
+        return NULL;
+    }
+    return (pm3 *)argp;
+}
+
+static PyObject *pm3_py_fill(PyObject *args, pm3_py_fill_t fill) {
+    PyObject *obj, *out = Py_None;
+    Py_ssize_t len, offset = 0;
+    if (!PyArg_ParseTuple(args, "On|nO", &obj, &len, &offset, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+    if ((len <= 0) || (offset < 0)) {
+        PyErr_SetString(PyExc_ValueError, "invalid length or offset");
+        return NULL;
+    }
+
+    int status;
+    if (out == Py_None) {
+        PyObject *res = PyBytes_FromStringAndSize(NULL, len);
+        if (res == NULL) return NULL;
+        Py_BEGIN_ALLOW_THREADS
+        status = fill(dev, (uint8_t *)PyBytes_AS_STRING(res), len, offset);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) {
+            Py_DECREF(res);
+            return pm3_py_error(status);
+        }
+        return res;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    if (view.len < len) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small");
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    status = fill(dev, (uint8_t *)view.buf, len, offset);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (status != PM3_SUCCESS) return pm3_py_error(status);
+    return PyLong_FromSsize_t(len);
+}
+
+static PyObject *pm3_py_bigbuf(PyObject *self, PyObject *args) {
+    (void)self;
+    return pm3_py_fill(args, pm3_bigbuf_get);
+}
+
+static PyObject *pm3_py_emulator(PyObject *self, PyObject *args) {
+    (void)self;
+    return pm3_py_fill(args, pm3_emulator_get);
+}
+
+static PyObject *pm3_py_trace(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *obj, *out = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &obj, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+
+    int status;
+    size_t len = 0;
+    if (out == Py_None) {
+        Py_BEGIN_ALLOW_THREADS
+        status = pm3_trace_get(dev, NULL, 0, &len);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) return pm3_py_error(status);
+        PyObject *res = PyBytes_FromStringAndSize(NULL, len);
+        if ((res == NULL) || (len == 0)) return res;
+        Py_BEGIN_ALLOW_THREADS
+        status = pm3_trace_get(dev, (uint8_t *)PyBytes_AS_STRING(res), len, &len);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) {
+            Py_DECREF(res);
+            return pm3_py_error(status);
+        }
+        return res;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    status = pm3_trace_get(dev, (uint8_t *)view.buf, view.len, &len);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (status != PM3_SUCCESS) return pm3_py_error(status);
+    return PyLong_FromSize_t(len);
+}
+
+// graph samples as native int32, e.g. numpy.frombuffer(p.graph(), dtype=numpy.int32)
+static PyObject *pm3_py_graph(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *obj, *out = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &obj, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+
+    size_t len = 0;
+    const int32_t *graph = pm3_graph_get(dev, &len);
+    if (out == Py_None) {
+        return PyBytes_FromStringAndSize((const char *)graph, len * sizeof(int32_t));
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    if ((size_t)view.len < len * sizeof(int32_t)) {
+        len = view.len / sizeof(int32_t);
+    }
+    if (len) {
+        memcpy(view.buf, graph, len * sizeof(int32_t));
+    }
+    PyBuffer_Release(&view);
+    return PyLong_FromSize_t(len);
+}
+%}
+%native(pm3_bigbuf) PyObject *pm3_py_bigbuf(PyObject *self, PyObject *args);
+%native(pm3_emulator) PyObject *pm3_py_emulator(PyObject *self, PyObject *args);
+%native(pm3_trace) PyObject *pm3_py_trace(PyObject *self, PyObject *args);
+%native(pm3_graph) PyObject *pm3_py_graph(PyObject *self, PyObject *args);
+#endif
 /* Parse the header file to generate wrappers */
@@ -3305,6 +3305,136 @@ SWIG_FromCharPtr(const char *cptr) {
     return SWIG_FromCharPtrAndSize(cptr, (cptr ? strlen(cptr) : 0));
 }
 
+// Bulk accessors: the data goes straight into a new bytes object, or into a caller
+// supplied writable buffer (bytearray, numpy array...) without per element conversion
+typedef int (*pm3_py_fill_t)(pm3 *dev, uint8_t *dest, size_t len, size_t offset);
+
+static PyObject *pm3_py_error(int status) {
+    PyErr_Format(PyExc_IOError, "pm3 error %d", status);
+    return NULL;
+}
+
+static pm3 *pm3_py_dev(PyObject *obj) {
+    void *argp = NULL;
+    if (!SWIG_IsOK(SWIG_ConvertPtr(obj, &argp, SWIGTYPE_p_pm3, 0))) {
+        PyErr_SetString(PyExc_TypeError, "expected a pm3 object");
+        return NULL;
+    }
+    return (pm3 *)argp;
+}
+
+static PyObject *pm3_py_fill(PyObject *args, pm3_py_fill_t fill) {
+    PyObject *obj, *out = Py_None;
+    Py_ssize_t len, offset = 0;
+    if (!PyArg_ParseTuple(args, "On|nO", &obj, &len, &offset, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+    if ((len <= 0) || (offset < 0)) {
+        PyErr_SetString(PyExc_ValueError, "invalid length or offset");
+        return NULL;
+    }
+
+    int status;
+    if (out == Py_None) {
+        PyObject *res = PyBytes_FromStringAndSize(NULL, len);
+        if (res == NULL) return NULL;
+        Py_BEGIN_ALLOW_THREADS
+        status = fill(dev, (uint8_t *)PyBytes_AS_STRING(res), len, offset);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) {
+            Py_DECREF(res);
+            return pm3_py_error(status);
+        }
+        return res;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    if (view.len < len) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "buffer too small");
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    status = fill(dev, (uint8_t *)view.buf, len, offset);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (status != PM3_SUCCESS) return pm3_py_error(status);
+    return PyLong_FromSsize_t(len);
+}
+
+static PyObject *pm3_py_bigbuf(PyObject *self, PyObject *args) {
+    (void)self;
+    return pm3_py_fill(args, pm3_bigbuf_get);
+}
+
+static PyObject *pm3_py_emulator(PyObject *self, PyObject *args) {
+    (void)self;
+    return pm3_py_fill(args, pm3_emulator_get);
+}
+
+static PyObject *pm3_py_trace(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *obj, *out = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &obj, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+
+    int status;
+    size_t len = 0;
+    if (out == Py_None) {
+        Py_BEGIN_ALLOW_THREADS
+        status = pm3_trace_get(dev, NULL, 0, &len);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) return pm3_py_error(status);
+        PyObject *res = PyBytes_FromStringAndSize(NULL, len);
+        if ((res == NULL) || (len == 0)) return res;
+        Py_BEGIN_ALLOW_THREADS
+        status = pm3_trace_get(dev, (uint8_t *)PyBytes_AS_STRING(res), len, &len);
+        Py_END_ALLOW_THREADS
+        if (status != PM3_SUCCESS) {
+            Py_DECREF(res);
+            return pm3_py_error(status);
+        }
+        return res;
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    Py_BEGIN_ALLOW_THREADS
+    status = pm3_trace_get(dev, (uint8_t *)view.buf, view.len, &len);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (status != PM3_SUCCESS) return pm3_py_error(status);
+    return PyLong_FromSize_t(len);
+}
+
+// graph samples as native int32, e.g. numpy.frombuffer(p.graph(), dtype=numpy.int32)
+static PyObject *pm3_py_graph(PyObject *self, PyObject *args) {
+    (void)self;
+    PyObject *obj, *out = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O", &obj, &out)) return NULL;
+    pm3 *dev = pm3_py_dev(obj);
+    if (dev == NULL) return NULL;
+
+    size_t len = 0;
+    const int32_t *graph = pm3_graph_get(dev, &len);
+    if (out == Py_None) {
+        return PyBytes_FromStringAndSize((const char *)graph, len * sizeof(int32_t));
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(out, &view, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0) return NULL;
+    if ((size_t)view.len < len * sizeof(int32_t)) {
+        len = view.len / sizeof(int32_t);
+    }
+    if (len) {
+        memcpy(view.buf, graph, len * sizeof(int32_t));
+    }
+    PyBuffer_Release(&view);
+    return PyLong_FromSize_t(len);
+}
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -3473,6 +3603,10 @@ static PyMethodDef SwigMethods[] = {
     { "delete_pm3", _wrap_delete_pm3, METH_O, NULL},
     { "pm3_console", _wrap_pm3_console, METH_VARARGS, NULL},
     { "pm3_name_get", _wrap_pm3_name_get, METH_O, NULL},
+    { "pm3_bigbuf", pm3_py_bigbuf, METH_VARARGS, NULL},
+    { "pm3_emulator", pm3_py_emulator, METH_VARARGS, NULL},
+    { "pm3_trace", pm3_py_trace, METH_VARARGS, NULL},
+    { "pm3_graph", pm3_py_graph, METH_VARARGS, NULL},
     { "pm3_swigregister", pm3_swigregister, METH_O, NULL},
     { "pm3_swiginit", pm3_swiginit, METH_VARARGS, NULL},
     { NULL, NULL, 0, NULL }
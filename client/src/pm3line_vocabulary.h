@@ -49,6 +49,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "prefs get savepaths" },
     { 1, "prefs get emoji" },
     { 1, "prefs get hints" },
+    { 1, "prefs get keyhits" },
     { 1, "prefs get output" },
     { 1, "prefs get plotsliders" },
     { 1, "prefs set help" },
@@ -59,6 +60,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "prefs set color" },
     { 1, "prefs set emoji" },
     { 1, "prefs set hints" },
+    { 1, "prefs set keyhits" },
     { 1, "prefs set savepaths" },
     { 1, "prefs set output" },
     { 1, "prefs set plotsliders" },
@@ -112,6 +114,7 @@ const static vocabulary_t vocabulary[] = {
     { 1, "data zerocrossings" },
     { 1, "data asn1" },
     { 1, "data atr" },
+    { 1, "data bench" },
     { 0, "data bitsamples" },
     { 1, "data bmap" },
     { 1, "data crypto" },
@@ -423,6 +426,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hf mfu dump" },
     { 0, "hf mfu info" },
     { 0, "hf mfu ndefread" },
+    { 0, "hf mfu ndefwrite" },
     { 0, "hf mfu rdbl" },
     { 0, "hf mfu restore" },
     { 0, "hf mfu tamper" },
@@ -530,18 +534,22 @@ const static vocabulary_t vocabulary[] = {
     { 0, "hw detectreader" },
     { 0, "hw status" },
     { 0, "hw tearoff" },
+    { 1, "hw throughput" },
     { 1, "hw timeout" },
     { 1, "hw version" },
     { 0, "hw break" },
     { 0, "hw bootloader" },
+    { 1, "hw commstats" },
     { 1, "hw connect" },
     { 0, "hw dbg" },
     { 0, "hw fpgaoff" },
     { 0, "hw lcd" },
     { 0, "hw lcdreset" },
+    { 1, "hw memstats" },
     { 0, "hw ping" },
     { 0, "hw readmem" },
     { 0, "hw reset" },
+    { 1, "hw select" },
     { 0, "hw setlfdivisor" },
     { 0, "hw sethfthresh" },
     { 0, "hw setmux" },
@@ -663,6 +671,7 @@ const static vocabulary_t vocabulary[] = {
     { 0, "lf hitag sim" },
     { 0, "lf hitag cc" },
     { 0, "lf hitag crack2" },
+    { 1, "lf hitag crack5" },
     { 0, "lf hitag chk" },
     { 1, "lf hitag lookup" },
     { 0, "lf hitag ta" },
@@ -67,6 +67,9 @@ int preferences_load(void) {
     g_session.overlay_sliders = true;
     g_session.show_hints = true;
     g_session.dense_output = false;
+    g_session.mf_key_hits = false;
+    g_session.lf_tuned_divisor = -1;
+    g_session.lf_tuned_trigger = -1;
 
     g_session.bar_mode = STYLE_VALUE;
     setDefaultPath(spDefault, "");
@@ -194,6 +197,11 @@ void preferences_save_callback(json_t *root) {
 
     JsonSaveBoolean(root, "output.dense", g_session.dense_output);
 
+    JsonSaveBoolean(root, "mifare.key.hits", g_session.mf_key_hits);
+
+    JsonSaveInt(root, "lf.tuned.divisor", g_session.lf_tuned_divisor);
+    JsonSaveInt(root, "lf.tuned.trigger", g_session.lf_tuned_trigger);
+
     JsonSaveBoolean(root, "os.supports.colors", g_session.supports_colors);
 
     JsonSaveStr(root, "file.default.savepath", g_session.defaultPaths[spDefault]);
@@ -337,6 +345,15 @@ void preferences_load_callback(json_t *root) {
     if (json_unpack_ex(root, &up_error, 0, "{s:b}", "output.dense", &b1) == 0)
         g_session.dense_output = (bool)b1;
 
+    if (json_unpack_ex(root, &up_error, 0, "{s:b}", "mifare.key.hits", &b1) == 0)
+        g_session.mf_key_hits = (bool)b1;
+
+    if (json_unpack_ex(root, &up_error, 0, "{s:i}", "lf.tuned.divisor", &i1) == 0)
+        g_session.lf_tuned_divisor = i1;
+
+    if (json_unpack_ex(root, &up_error, 0, "{s:i}", "lf.tuned.trigger", &i1) == 0)
+        g_session.lf_tuned_trigger = i1;
+
     if (json_unpack_ex(root, &up_error, 0, "{s:b}", "os.supports.colors", &b1) == 0)
         g_session.supports_colors = (bool)b1;
 
@@ -550,6 +567,13 @@ static void showHintsState(prefShowOpt_t opt) {
                  );
 }
 
+static void showKeyHitsState(prefShowOpt_t opt) {
+    PrintAndLogEx(INFO, "   %s key hits................ %s"
+                  , pref_show_status_msg(opt)
+                  , (g_session.mf_key_hits) ? pref_show_value(opt, "on") : pref_show_value(opt, "off")
+                 );
+}
+
 static void showPlotSliderState(prefShowOpt_t opt) {
     PrintAndLogEx(INFO, "   %s show plot sliders....... %s"
                   , pref_show_status_msg(opt)
@@ -1005,6 +1029,51 @@ static int setCmdHint(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int setCmdKeyHits(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs set keyhits",
+                  "Set persistent preference of counting found MIFARE Classic keys.\n"
+                  "Keys found by `hf mf fchk` / `hf mf autopwn` are counted and dictionaries\n"
+                  "are tried in order of most hits first",
+                  "prefs set keyhits --on"
+                 );
+
+    void *argtable[] = {
+        arg_param_begin,
+        arg_lit0(NULL, "off", "don't count hits, use dictionary order"),
+        arg_lit0(NULL, "on", "count hits, try most found keys first"),
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    bool use_off = arg_get_lit(ctx, 1);
+    bool use_on = arg_get_lit(ctx, 2);
+    CLIParserFree(ctx);
+
+    if ((use_off + use_on) > 1) {
+        PrintAndLogEx(FAILED, "Can only set one option");
+        return PM3_EINVARG;
+    }
+
+    bool new_value = g_session.mf_key_hits;
+    if (use_off) {
+        new_value = false;
+    }
+    if (use_on) {
+        new_value = true;
+    }
+
+    if (g_session.mf_key_hits != new_value) {
+        showKeyHitsState(prefShowOLD);
+        g_session.mf_key_hits = new_value;
+        showKeyHitsState(prefShowNEW);
+        preferences_save();
+    } else {
+        showKeyHitsState(prefShowNone);
+    }
+
+    return PM3_SUCCESS;
+}
+
 static int setCmdPlotSliders(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs set plotsliders",
@@ -1207,6 +1276,22 @@ static int getCmdHint(const char *Cmd) {
     return PM3_SUCCESS;
 }
 
+static int getCmdKeyHits(const char *Cmd) {
+    CLIParserContext *ctx;
+    CLIParserInit(&ctx, "prefs get keyhits",
+                  "Get preference of ordering MIFARE Classic key dictionaries by hits",
+                  "prefs get keyhits"
+                 );
+    void *argtable[] = {
+        arg_param_begin,
+        arg_param_end
+    };
+    CLIExecWithReturn(ctx, Cmd, argtable, true);
+    CLIParserFree(ctx);
+    showKeyHitsState(prefShowNone);
+    return PM3_SUCCESS;
+}
+
 static int getCmdColor(const char *Cmd) {
     CLIParserContext *ctx;
     CLIParserInit(&ctx, "prefs get color",
@@ -1347,6 +1432,7 @@ static command_t CommandTableGet[] = {
     //  {"devicedebug",      getCmdDeviceDebug,   AlwaysAvailable, "Get device debug level"},
     {"emoji",            getCmdEmoji,         AlwaysAvailable, "Get emoji display preference"},
     {"hints",            getCmdHint,          AlwaysAvailable, "Get hint display preference"},
+    {"keyhits",          getCmdKeyHits,       AlwaysAvailable, "Get MIFARE key hit ordering preference"},
     {"output",           getCmdOutput,        AlwaysAvailable, "Get dump output style preference"},
     {"plotsliders",      getCmdPlotSlider,    AlwaysAvailable, "Get plot slider display preference"},
     {NULL, NULL, NULL, NULL}
@@ -1362,6 +1448,7 @@ static command_t CommandTableSet[] = {
     {"color",            setCmdColor,         AlwaysAvailable, "Set color support"},
     {"emoji",            setCmdEmoji,         AlwaysAvailable, "Set emoji display"},
     {"hints",            setCmdHint,          AlwaysAvailable, "Set hint display"},
+    {"keyhits",          setCmdKeyHits,       AlwaysAvailable, "Set MIFARE key hit ordering"},
     {"savepaths",        setCmdSavePaths,     AlwaysAvailable, "... to be adjusted next ... "},
     //  {"devicedebug",      setCmdDeviceDebug,   AlwaysAvailable, "Set device debug level"},
     {"output",           setCmdOutput,        AlwaysAvailable, "Set dump output style"},
@@ -1423,6 +1510,7 @@ static int CmdPrefShow(const char *Cmd) {
     showClientExeDelayState();
     showOutputState(prefShowNone);
     showClientTimeoutState();
+    showKeyHitsState(prefShowNone);
 
     PrintAndLogEx(NORMAL, "");
     return PM3_SUCCESS;
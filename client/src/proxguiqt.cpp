@@ -50,6 +50,7 @@ static uint32_t startMax; // Maximum offset in the graph (right side of graph)
 static uint32_t startMaxOld;
 static uint32_t PageWidth; // How many samples are currently visible on this 'page' / graph
 static int unlockStart = 0;
+static uint32_t gs_graphGeneration = 1; // bumped whenever the graph buffers may have changed
 
 void ProxGuiQT::ShowGraphWindow(void) {
     emit ShowGraphWindowSignal();
@@ -104,6 +105,8 @@ void ProxGuiQT::_RepaintGraphWindow(void) {
     if (!plotapp || !plotwidget)
         return;
 
+    gs_graphGeneration++;
+
     plotwidget->update();
 }
 
@@ -554,6 +557,122 @@ QColor Plot::getColor(int graphNum) {
     }
 }
 
+bool GraphLod::isCurrent(const int *buffer, size_t length, uint32_t gen) const {
+    return (buf == buffer && len == length && generation == gen);
+}
+
+void GraphLod::build(const int *buffer, size_t length, uint32_t gen) {
+    buf = buffer;
+    len = length;
+    generation = gen;
+    levels.clear();
+
+    // level 0 is the raw buffer itself, level 1 pairs of samples, and so on
+    size_t n = (len + 1) / 2;
+    if (len < 2) {
+        return;
+    }
+
+    std::vector<bin_t> first(n);
+    for (size_t i = 0; i < n; i++) {
+        int a = buffer[i * 2];
+        int b = (i * 2 + 1 < len) ? buffer[i * 2 + 1] : a;
+        first[i].min = (a < b) ? a : b;
+        first[i].max = (a > b) ? a : b;
+        first[i].sum = (i * 2 + 1 < len) ? (int64_t)a + b : a;
+    }
+    levels.push_back(std::move(first));
+
+    while (levels.back().size() > 1) {
+        const std::vector<bin_t> &prev = levels.back();
+        std::vector<bin_t> next((prev.size() + 1) / 2);
+        for (size_t i = 0; i < next.size(); i++) {
+            next[i] = prev[i * 2];
+            if (i * 2 + 1 < prev.size()) {
+                const bin_t &o = prev[i * 2 + 1];
+                if (o.min < next[i].min) next[i].min = o.min;
+                if (o.max > next[i].max) next[i].max = o.max;
+                next[i].sum += o.sum;
+            }
+        }
+        levels.push_back(std::move(next));
+    }
+}
+
+// exact min / max / sum over samples [from, to), walks up the pyramid
+// taking partial bins at each level, so O(log n) per query
+void GraphLod::query(size_t from, size_t to, int *vMin, int *vMax, int64_t *sum) const {
+
+    int mn = INT_MAX, mx = INT_MIN;
+    int64_t s = 0;
+
+    if (to > len) {
+        to = len;
+    }
+
+    while (from < to && (from & 1)) {
+        int v = buf[from++];
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+        s += v;
+    }
+    while (from < to && (to & 1)) {
+        int v = buf[--to];
+        if (v < mn) mn = v;
+        if (v > mx) mx = v;
+        s += v;
+    }
+
+    from >>= 1;
+    to >>= 1;
+    for (size_t lvl = 0; lvl < levels.size() && from < to; lvl++) {
+        const std::vector<bin_t> &bins = levels[lvl];
+        while (from < to && (from & 1)) {
+            const bin_t &b = bins[from++];
+            if (b.min < mn) mn = b.min;
+            if (b.max > mx) mx = b.max;
+            s += b.sum;
+        }
+        while (from < to && (to & 1)) {
+            const bin_t &b = bins[--to];
+            if (b.min < mn) mn = b.min;
+            if (b.max > mx) mx = b.max;
+            s += b.sum;
+        }
+        from >>= 1;
+        to >>= 1;
+    }
+
+    if (mn < *vMin) *vMin = mn;
+    if (mx > *vMax) *vMax = mx;
+    if (sum) *sum += s;
+}
+
+GraphLod *Plot::lodOf(int *buffer, size_t len) {
+    GraphLod *l = (buffer == g_GraphBuffer) ? &lod[0] : &lod[1];
+    if (l->isCurrent(buffer, len, gs_graphGeneration) == false) {
+        l->build(buffer, len, gs_graphGeneration);
+    }
+    return l;
+}
+
+// first sample index at or right of the plot area, same rule as xCoordOf() < right
+uint32_t Plot::visibleEnd(size_t len, QRect plotRect) {
+    if (g_GraphStart >= len) {
+        return g_GraphStart;
+    }
+
+    double n = ceil((plotRect.right() - plotRect.left()) / g_GraphPixelsPerPoint);
+    uint64_t i = g_GraphStart + ((n > 0) ? (uint64_t)n : 0);
+    while (i > g_GraphStart && xCoordOf(i - 1, plotRect) >= plotRect.right()) {
+        i--;
+    }
+    while (i < len && xCoordOf(i, plotRect) < plotRect.right()) {
+        i++;
+    }
+    return (i > len) ? len : i;
+}
+
 void Plot::setMaxAndStart(int *buffer, size_t len, QRect plotRect) {
     if (len == 0) {
         return;
@@ -577,12 +696,9 @@ void Plot::setMaxAndStart(int *buffer, size_t len, QRect plotRect) {
     }
 
     int vMin = INT_MAX, vMax = INT_MIN;
-    uint32_t sample_index = g_GraphStart ;
-    for (; sample_index < len && xCoordOf(sample_index, plotRect) < plotRect.right() ; sample_index++) {
-
-        int v = buffer[sample_index];
-        if (v < vMin) vMin = v;
-        if (v > vMax) vMax = v;
+    uint32_t stop = visibleEnd(len, plotRect);
+    if (stop > g_GraphStart) {
+        lodOf(buffer, len)->query(g_GraphStart, stop, &vMin, &vMax, NULL);
     }
 
     gs_absVMax = 0;
@@ -692,22 +808,46 @@ void Plot::PlotGraph(int *buffer, size_t len, QRect plotRect, QRect annotationRe
     int x = xCoordOf(g_GraphStart, plotRect);
     int y = yCoordOf(buffer[g_GraphStart], plotRect, gs_absVMax);
     penPath.moveTo(x, y);
-    for (i = g_GraphStart; i < len && xCoordOf(i, plotRect) < plotRect.right(); i++) {
 
-        x = xCoordOf(i, plotRect);
-        v = buffer[i];
-        y = yCoordOf(v, plotRect, gs_absVMax);
+    if (g_GraphPixelsPerPoint < 0.5) {
+        // zoomed out, several samples per pixel column. Draw one min/max bar per column
+        GraphLod *l = lodOf(buffer, len);
+        uint32_t stop = visibleEnd(len, plotRect);
+        i = g_GraphStart;
+        while (i < stop) {
+            x = xCoordOf(i, plotRect);
+            uint32_t next = i + 1;
+            while (next < stop && xCoordOf(next, plotRect) == x) {
+                next++;
+            }
 
-        penPath.lineTo(x, y);
+            int cMin = INT_MAX, cMax = INT_MIN;
+            l->query(i, next, &cMin, &cMax, &vMean);
+            penPath.lineTo(x, yCoordOf(cMax, plotRect, gs_absVMax));
+            penPath.lineTo(x, yCoordOf(cMin, plotRect, gs_absVMax));
 
-        if (g_GraphPixelsPerPoint > 10) {
-            QRect f(QPoint(x - 3, y - 3), QPoint(x + 3, y + 3));
-            painter->fillRect(f, GREEN);
+            if (cMin < vMin) vMin = cMin;
+            if (cMax > vMax) vMax = cMax;
+            i = next;
+        }
+    } else {
+        for (i = g_GraphStart; i < len && xCoordOf(i, plotRect) < plotRect.right(); i++) {
+
+            x = xCoordOf(i, plotRect);
+            v = buffer[i];
+            y = yCoordOf(v, plotRect, gs_absVMax);
+
+            penPath.lineTo(x, y);
+
+            if (g_GraphPixelsPerPoint > 10) {
+                QRect f(QPoint(x - 3, y - 3), QPoint(x + 3, y + 3));
+                painter->fillRect(f, GREEN);
+            }
+            // catch stats
+            if (v < vMin) vMin = v;
+            if (v > vMax) vMax = v;
+            vMean += v;
         }
-        // catch stats
-        if (v < vMin) vMin = v;
-        if (v > vMax) vMax = v;
-        vMean += v;
     }
 
     g_GraphStop = i;
@@ -822,7 +962,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
     uint32_t pos = 0, loc = 375;
     painter->setPen(WHITE);
 
-    if (g_MarkerA.pos > 0) {
+    if (g_MarkerA.pos > 0 && g_MarkerA.pos < g_GraphTraceLen) {
         free(annotation);
 
         length = (sizeof(markerText) + (sizeof(uint32_t) * 3) + sizeof(" ") + 1);
@@ -856,7 +996,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         free(textA);
     }
 
-    if (g_MarkerB.pos > 0) {
+    if (g_MarkerB.pos > 0 && g_MarkerB.pos < g_GraphTraceLen) {
         free(annotation);
 
         length = ((sizeof(markerText)) + (sizeof(uint32_t) * 2) + 1);
@@ -873,7 +1013,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         painter->drawText(loc, annotationRect.bottom() - 36, annotation);
     }
 
-    if (g_MarkerC.pos > 0) {
+    if (g_MarkerC.pos > 0 && g_MarkerC.pos < g_GraphTraceLen) {
         free(annotation);
 
         length = ((sizeof(markerText)) + (sizeof(uint32_t) * 2) + 1);
@@ -890,7 +1030,7 @@ void Plot::drawAnnotations(QRect annotationRect, QPainter *painter) {
         painter->drawText(loc, annotationRect.bottom() - 24, annotation);
     }
 
-    if (g_MarkerD.pos > 0) {
+    if (g_MarkerD.pos > 0 && g_MarkerD.pos < g_GraphTraceLen) {
         free(annotation);
 
         length = ((sizeof(markerText)) + (sizeof(uint32_t) * 2) + 1);
@@ -1000,16 +1140,33 @@ void Plot::plotOperations(int *buffer, size_t len, QPainter *painter, QRect plot
 #define HEIGHT_INFO 60
 #define WIDTH_AXES 80
 
-void Plot::paintEvent(QPaintEvent *event) {
-    QPainter painter(this);
-    QBrush brush(GREEN);
-    QPen pen(GREEN);
+// The expensive part of a repaint ( grid, graphs, demod ) is rendered once into a pixmap and
+// reused until something it depends on changes. Marker moves only re-composite
+void Plot::getBaseKey(base_key_t *key) {
+    memset(key, 0, sizeof(base_key_t));
+    key->generation = gs_graphGeneration;
+    key->start = g_GraphStart;
+    key->tracelen = g_GraphTraceLen;
+    key->demodlen = g_DemodBufferLen;
+    key->demodstart = g_DemodStartIdx;
+    key->ppp = g_GraphPixelsPerPoint;
+    key->gridx = g_PlotGridX;
+    key->gridy = g_PlotGridY;
+    key->gridoffset = g_GridOffset;
+    key->unlockstart = unlockStart;
+    key->w = width();
+    key->h = height();
+    key->locked = g_GridLocked;
+    key->overlays = g_useOverlays;
+}
 
-    painter.setFont(QFont("Courier New", 10));
+void Plot::renderBaseLayer(QRect plotRect, QRect infoRect) {
+    qreal dpr = devicePixelRatioF();
+    baseLayer = QPixmap(size() * dpr);
+    baseLayer.setDevicePixelRatio(dpr);
 
-    QRect plotRect(WIDTH_AXES, 0, width() - WIDTH_AXES, height() - HEIGHT_INFO);
-    QRect infoRect(0, height() - HEIGHT_INFO, width(), HEIGHT_INFO);
-    PageWidth = plotRect.width() / g_GraphPixelsPerPoint;
+    QPainter painter(&baseLayer);
+    painter.setFont(QFont("Courier New", 10));
 
     //Grey background
     painter.fillRect(rect(), GRAY60);
@@ -1043,6 +1200,25 @@ void Plot::paintEvent(QPaintEvent *event) {
         PlotGraph(g_OverlayBuffer, g_GraphTraceLen, plotRect, infoRect, &painter, 1);
     }
     // End graph drawing
+}
+
+void Plot::paintEvent(QPaintEvent *event) {
+
+    QRect plotRect(WIDTH_AXES, 0, width() - WIDTH_AXES, height() - HEIGHT_INFO);
+    QRect infoRect(0, height() - HEIGHT_INFO, width(), HEIGHT_INFO);
+    PageWidth = plotRect.width() / g_GraphPixelsPerPoint;
+
+    base_key_t key;
+    getBaseKey(&key);
+    if (baseLayer.isNull() || memcmp(&key, &baseKey, sizeof(base_key_t)) != 0) {
+        renderBaseLayer(plotRect, infoRect);
+        // rendering may clamp g_GraphStart, key it on what was drawn
+        getBaseKey(&baseKey);
+    }
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, baseLayer);
+    painter.setFont(QFont("Courier New", 10));
 
     //Draw the markers
     if (g_TempMarkerSize > 0) {
@@ -1070,6 +1246,11 @@ void Plot::paintEvent(QPaintEvent *event) {
     g_GraphStart_old = g_GraphStart;
 }
 
+// area touched by draw_marker(), line plus label
+QRect Plot::markerRect(uint32_t pos, QRect plotRect) {
+    return QRect(xCoordOf(pos, plotRect) - 1, plotRect.top(), 100, plotRect.height() + 1);
+}
+
 void Plot::draw_marker(marker_t marker, QRect plotRect, QColor color, QPainter *painter) {
     painter->setPen(color);
 
@@ -1279,14 +1460,18 @@ void Plot::mouseMoveEvent(QMouseEvent *event) {
         else if (x < (int)g_GraphStart) x = (int)g_GraphStart; // Bounds checking for the start of the Graph Window
         else if (x > (int)g_GraphStop)  x = (int)g_GraphStop; // Bounds checking for the end of the Graph Window
 
-        if ((event->buttons() & Qt::LeftButton)) { // True for left click, false otherwise
-            g_MarkerA.pos = x;
-        } else {
-            g_MarkerB.pos = x;
+        marker_t *m = (event->buttons() & Qt::LeftButton) ? &g_MarkerA : &g_MarkerB; // left click moves A, right click B
+        if (m->pos == (uint32_t)x) {
+            return;
         }
-    }
 
-    this->update();
+        // only the old and new marker columns and the annotation line need repainting
+        QRect plotRect(WIDTH_AXES, 0, width() - WIDTH_AXES, height() - HEIGHT_INFO);
+        update(markerRect(m->pos, plotRect));
+        m->pos = x;
+        update(markerRect(m->pos, plotRect));
+        update(QRect(0, height() - HEIGHT_INFO, width(), HEIGHT_INFO));
+    }
 }
 
 void Plot::keyPressEvent(QKeyEvent *event) {
@@ -1451,6 +1636,10 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Equal:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
+
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] += 5;
             } else {
@@ -1461,6 +1650,10 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Minus:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
+
             if (event->modifiers() & Qt::ControlModifier) {
                 g_OperationBuffer[g_MarkerA.pos] -= 5;
             } else {
@@ -1471,6 +1664,10 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Plus:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
+
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] += 5;
             } else {
@@ -1481,6 +1678,10 @@ void Plot::keyPressEvent(QKeyEvent *event) {
             break;
 
         case Qt::Key_Underscore:
+            if (g_MarkerA.pos >= g_GraphTraceLen) {
+                break;
+            }
+
             if (event->modifiers() & Qt::ControlModifier) {
                 g_GraphBuffer[g_MarkerA.pos] -= 5;
             } else {
@@ -21,6 +21,7 @@
 
 #include <stdint.h>
 #include <string.h>
+#include <vector>
 
 #include <QApplication>
 #include <QPushButton>
@@ -36,6 +37,28 @@
 
 class ProxWidget;
 
+/**
+ * @brief Min/max/sum pyramid over a sample buffer, level n holds bins of 2^n samples.
+ * Lets zoomed out views draw one min/max bar per pixel column instead of every sample.
+ */
+class GraphLod {
+  public:
+    bool isCurrent(const int *buffer, size_t len, uint32_t generation) const;
+    void build(const int *buffer, size_t len, uint32_t generation);
+    void query(size_t from, size_t to, int *vMin, int *vMax, int64_t *sum) const;
+
+  private:
+    struct bin_t {
+        int min;
+        int max;
+        int64_t sum;
+    };
+    std::vector<std::vector<bin_t>> levels;
+    const int *buf = NULL;
+    size_t len = 0;
+    uint32_t generation = 0;
+};
+
 /**
  * @brief The actual plot, black area were we paint the graph
  */
@@ -45,6 +68,32 @@ class Plot: public QWidget {
   private:
     QWidget *master;
     double g_GraphPixelsPerPoint; // How many visual pixels are between each sample point (x axis)
+    GraphLod lod[2];              // graph and overlay
+    GraphLod *lodOf(int *buffer, size_t len);
+    uint32_t visibleEnd(size_t len, QRect plotRect);
+
+    // everything the cached base layer ( background, grid, graphs, demod ) depends on
+    typedef struct {
+        uint32_t generation;
+        uint32_t start;
+        size_t tracelen;
+        size_t demodlen;
+        int32_t demodstart;
+        double ppp;
+        double gridx;
+        double gridy;
+        double gridoffset;
+        int unlockstart;
+        int w;
+        int h;
+        bool locked;
+        bool overlays;
+    } base_key_t;
+    QPixmap baseLayer;
+    base_key_t baseKey;
+    void getBaseKey(base_key_t *key);
+    void renderBaseLayer(QRect plotRect, QRect infoRect);
+    QRect markerRect(uint32_t pos, QRect plotRect);
     void PlotGraph(int *buffer, size_t len, QRect plotRect, QRect annotationRect, QPainter *painter, int graphNum);
     void PlotDemod(uint8_t *buffer, size_t len, QRect plotRect, QRect annotationRect, QPainter *painter, int graphNum, uint32_t plotOffset);
     void plotGridLines(QPainter *painter, QRect r);
@@ -21,6 +21,10 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <unistd.h>
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <fcntl.h>
+#endif
 #include <ctype.h>
 #include <libgen.h>        // basename
 #include <time.h>
@@ -32,11 +36,13 @@
 #include "cmdmain.h"
 #include "ui.h"
 #include "cmdhw.h"
+#include "cmdlf.h"          // lf_config_apply_tuned
 #include "whereami.h"
 #include "comms.h"
 #include "fileutils.h"
 #include "flash.h"
 #include "preferences.h"
+#include "server.h"
 #include "commonutil.h"
 
 #ifndef _WIN32
@@ -46,6 +52,49 @@
 
 static int mainret = PM3_ESOFT;
 
+// --startup-profile, time spent in each start up phase until the first command runs
+typedef struct {
+    const char *name;
+    uint64_t us;
+} startup_phase_t;
+
+static bool startup_profile = false;
+static uint64_t startup_clock = 0;
+static startup_phase_t startup_phases[12];
+static uint8_t startup_phase_cnt = 0;
+
+static void startup_add(const char *name, uint64_t us) {
+    if (startup_phase_cnt < ARRAYLEN(startup_phases)) {
+        startup_phases[startup_phase_cnt].name = name;
+        startup_phases[startup_phase_cnt].us = us;
+        startup_phase_cnt++;
+    }
+}
+
+static void startup_mark(const char *name) {
+    if (startup_profile == false)
+        return;
+
+    uint64_t now = usclock();
+    startup_add(name, now - startup_clock);
+    startup_clock = now;
+}
+
+static void startup_report(void) {
+    if (startup_profile == false)
+        return;
+
+    uint64_t total = 0;
+    PrintAndLogEx(INFO, "--- " _CYAN_("Start up profile") " ------------");
+    for (uint8_t i = 0; i < startup_phase_cnt; i++) {
+        PrintAndLogEx(INFO, " %-14s %9.3f ms", startup_phases[i].name, startup_phases[i].us / 1000.0);
+        total += startup_phases[i].us;
+    }
+    PrintAndLogEx(INFO, " %-14s " _YELLOW_("%9.3f") " ms", "total", total / 1000.0);
+    PrintAndLogEx(NORMAL, "");
+    startup_profile = false;
+}
+
 #ifndef LIBPM3
 #define BANNERMSG1 ""
 #define BANNERMSG2 "   [ :coffee: ]"
@@ -378,6 +427,115 @@ static bool pop_cmdscriptfile(void) {
         return true;
 }
 
+// Host only steps of cmd scripts. "@async <command>" runs the command in an offline
+// client process of its own, so it overlaps with the following (RF) commands,
+// "@wait" waits for all of them. Pending ones are waited for when the script is done.
+#define MAX_ASYNC_JOBS 8
+
+typedef struct {
+    int pid;
+    char *cmd;
+} async_job_t;
+
+static async_job_t async_jobs[MAX_ASYNC_JOBS] = {{0, NULL}};
+
+static void async_job_done(async_job_t *job, int status) {
+    PrintAndLogEx(INFO, "async " _YELLOW_("%s") " done ( %s )", job->cmd, (status == 0) ? _GREEN_("ok") : _RED_("fail"));
+    free(job->cmd);
+    job->cmd = NULL;
+    job->pid = 0;
+}
+
+static void async_jobs_reap(bool wait_all) {
+#if !defined(_WIN32)
+    for (int i = 0; i < MAX_ASYNC_JOBS; i++) {
+        if (async_jobs[i].pid <= 0) {
+            continue;
+        }
+        int wstatus = 0;
+        pid_t res = waitpid(async_jobs[i].pid, &wstatus, wait_all ? 0 : WNOHANG);
+        if (res == async_jobs[i].pid) {
+            async_job_done(&async_jobs[i], (WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1));
+        } else if (res < 0) {
+            async_job_done(&async_jobs[i], -1);
+        }
+    }
+#else
+    (void)wait_all;
+#endif
+}
+
+static int async_job_start(const char *cmd) {
+    while ((*cmd != '\0') && isspace(*cmd)) {
+        cmd++;
+    }
+    if (strlen(cmd) == 0) {
+        PrintAndLogEx(ERR, "@async needs a command");
+        return PM3_EINVARG;
+    }
+#if defined(_WIN32)
+    PrintAndLogEx(WARNING, "@async not supported on this platform, running " _YELLOW_("%s") " in line", cmd);
+    return CommandReceived(cmd);
+#else
+    const char *exe = get_my_executable_path();
+    if (exe == NULL) {
+        return CommandReceived(cmd);
+    }
+
+    int slot = -1;
+    while (slot < 0) {
+        async_jobs_reap(false);
+        for (int i = 0; i < MAX_ASYNC_JOBS; i++) {
+            if (async_jobs[i].pid == 0) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            msleep(100);
+        }
+    }
+
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid < 0) {
+        PrintAndLogEx(ERR, "can't start async job, running " _YELLOW_("%s") " in line", cmd);
+        return CommandReceived(cmd);
+    }
+    if (pid == 0) {
+        // offline client, it never touches the device
+        int fd = open("/dev/null", O_RDONLY);
+        if (fd >= 0) {
+            dup2(fd, STDIN_FILENO);
+            close(fd);
+        }
+        execl(exe, exe, "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+    async_jobs[slot].pid = pid;
+    async_jobs[slot].cmd = str_dup(cmd);
+    PrintAndLogEx(INFO, "async " _YELLOW_("%s") " started", cmd);
+    return PM3_SUCCESS;
+#endif
+}
+
+// returns true if cmd was a script pragma
+static bool script_pragma(const char *cmd, int *ret) {
+    if (cmd[0] != '@') {
+        return false;
+    }
+    if (strncmp(cmd, "@async", 6) == 0 && ((cmd[6] == '\0') || isspace(cmd[6]))) {
+        *ret = async_job_start(cmd + 6);
+    } else if (strcmp(cmd, "@wait") == 0) {
+        async_jobs_reap(true);
+        *ret = PM3_SUCCESS;
+    } else {
+        PrintAndLogEx(ERR, "unknown pragma " _YELLOW_("%s"), cmd);
+        *ret = PM3_EINVARG;
+    }
+    return true;
+}
+
 // Main thread of PM3 Client
 void
 #ifdef __has_attribute
@@ -398,12 +556,16 @@ main_loop(const char *script_cmds_file, char *script_cmd, bool stayInCommandLoop
     bool stdinOnPipe = !isatty(STDIN_FILENO);
     char script_cmd_buf[256] = {0x00};  // iceman, needs lua script the same file_path_buffer as the rest
 
+    startup_mark("gui");
+
     // cache Version information now:
     if (execCommand || script_cmds_file || stdinOnPipe)
         pm3_version(false, false);
     else
         pm3_version_short();
 
+    startup_mark("version");
+
     if (script_cmds_file) {
 
         char *path;
@@ -431,6 +593,9 @@ main_loop(const char *script_cmds_file, char *script_cmd, bool stayInCommandLoop
         }
     }
 
+    startup_mark("history");
+    startup_report();
+
     // loops every time enter is pressed...
     while (1) {
 
@@ -569,7 +734,10 @@ check_script:
                 }
                 // process cmd
                 g_pendingPrompt = false;
-                mainret = CommandReceived(cmd);
+                async_jobs_reap(false);
+                if (script_pragma(cmd, &mainret) == false) {
+                    mainret = CommandReceived(cmd);
+                }
 
                 // exit or quit
                 if (mainret == PM3_EFATAL)
@@ -591,6 +759,8 @@ check_script:
         }
     } // end while
 
+    async_jobs_reap(true);
+
     if (g_session.pm3_present) {
         clearCommandBuffer();
         SendCommandNG(CMD_QUIT_SESSION, NULL, 0);
@@ -738,9 +908,12 @@ static void show_help(bool showFullHelp, char *exec_name) {
         PrintAndLogEx(NORMAL, "      -y/--py <python_script_file>        execute Python script.");
 #endif // HAVE_PYTHON
         PrintAndLogEx(NORMAL, "      -s/--script-file <cmd_script_file>  script file with one Proxmark3 command per line");
+        PrintAndLogEx(NORMAL, "                                          `@async <command>` runs a host only step in parallel, `@wait` waits for them");
         PrintAndLogEx(NORMAL, "      -i/--interactive                    enter interactive mode after executing the script or the command");
         PrintAndLogEx(NORMAL, "      --incognito                         do not use history, prefs file nor log files");
         PrintAndLogEx(NORMAL, "      --ncpu <num_cores>                  override number of CPU cores");
+        PrintAndLogEx(NORMAL, "      --startup-profile                   report the time spent in each start up phase");
+        PrintAndLogEx(NORMAL, "      --server <socket>                   headless mode, serve commands from local clients on a Unix socket");
         PrintAndLogEx(NORMAL, "\nOptions in flasher mode:");
         PrintAndLogEx(NORMAL, "      --flash                             flash Proxmark3, requires at least one --image");
         PrintAndLogEx(NORMAL, "      --reboot-to-bootloader              reboot Proxmark3 into bootloader mode");
@@ -762,6 +935,7 @@ static void show_help(bool showFullHelp, char *exec_name) {
         PrintAndLogEx(NORMAL, "      %s "SERIAL_PORT_EXAMPLE_H" -c \"hf mf chk --1k\"   -- execute cmd and quit client", exec_name);
         PrintAndLogEx(NORMAL, "      %s "SERIAL_PORT_EXAMPLE_H" -l hf_read            -- execute Lua script `hf_read` and quit client", exec_name);
         PrintAndLogEx(NORMAL, "      %s "SERIAL_PORT_EXAMPLE_H" -s mycmds.txt         -- execute each pm3 cmd in file and quit client", exec_name);
+        PrintAndLogEx(NORMAL, "      %s "SERIAL_PORT_EXAMPLE_H" --server /tmp/pm3.sock -- keep the device open and serve commands, one JSON reply per line", exec_name);
         PrintAndLogEx(NORMAL, "\n  to flash fullimage and bootloader:\n");
         PrintAndLogEx(NORMAL, "      %s "SERIAL_PORT_EXAMPLE_H" --flash --unlock-bootloader --image bootrom.elf --image fullimage.elf", exec_name);
 #ifdef __linux__
@@ -1002,16 +1176,20 @@ void pm3_init(void) {
 
 #ifndef LIBPM3
 int main(int argc, char *argv[]) {
+    // the profile flag is only known after parsing, so take the early timestamps anyway
+    uint64_t start_clock = usclock();
     pm3_init();
     bool waitCOMPort = false;
     bool addScriptExec = false;
     bool stayInCommandLoop = false;
     char *script_cmds_file = NULL;
     char *script_cmd = NULL;
+    char *server_socket = NULL;
     char *port = NULL;
     uint32_t speed = 0;
 
     pm3line_init();
+    uint64_t init_clock = usclock();
 
     char exec_name[100] = {0};
     strncpy(exec_name, basename(argv[0]), sizeof(exec_name) - 1);
@@ -1229,6 +1407,23 @@ int main(int argc, char *argv[]) {
             continue;
         }
 
+        // headless, serve commands on a Unix socket
+        if (strcmp(argv[i], "--server") == 0) {
+            if (i + 1 == argc || strlen(argv[i + 1]) == 0) {
+                PrintAndLogEx(ERR, _RED_("ERROR:") " missing socket path after --server\n");
+                show_help(false, exec_name);
+                return 1;
+            }
+            server_socket = argv[++i];
+            continue;
+        }
+
+        // report start up timings
+        if (strcmp(argv[i], "--startup-profile") == 0) {
+            startup_profile = true;
+            continue;
+        }
+
         // go to dump mode
         if (strcmp(argv[i], "--dumpmem") == 0) {
             dumpmem_mode = true;
@@ -1314,7 +1509,7 @@ int main(int argc, char *argv[]) {
             }
             long int ncpus = strtol(argv[i + 1], NULL, 10);
             const int detected_cpus = detect_num_CPUs();
-            if (ncpus < 0 || ncpus >= detected_cpus) {
+            if (ncpus < 0 || ncpus > detected_cpus) {
                 PrintAndLogEx(ERR, _RED_("ERROR:") " invalid number of CPU cores: --ncpu " _YELLOW_("%s") " (available: %d)\n", argv[i + 1], detected_cpus);
                 return 1;
             }
@@ -1329,9 +1524,16 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
+    if (startup_profile) {
+        startup_clock = usclock();
+        startup_add("init", init_clock - start_clock);
+        startup_add("arguments", startup_clock - init_clock);
+    }
+
     // Load Settings and assign
     // This will allow the command line to override the settings.json values
     preferences_load();
+    startup_mark("preferences");
     // quick patch for debug level
     if (! debug_mode_forced)
         g_debugMode = g_session.client_debug_level;
@@ -1398,6 +1600,9 @@ int main(int argc, char *argv[]) {
         CloseProxmark(g_session.current_device);
     }
 
+    // lf config --tune result
+    lf_config_apply_tuned();
+
     if ((port != NULL) && (!g_session.pm3_present)) {
         exit(EXIT_FAILURE);
     }
@@ -1406,6 +1611,8 @@ int main(int argc, char *argv[]) {
         PrintAndLogEx(INFO, _YELLOW_("OFFLINE") " mode. Check " _YELLOW_("\"%s -h\"") " if it's not what you want.\n", exec_name);
     }
 
+    startup_mark("device");
+
     // ascii art only in interactive client
     if (!script_cmds_file && !script_cmd && g_session.stdinOnTTY && g_session.stdoutOnTTY && !dumpmem_mode && !flash_mode && !reboot_bootloader_mode) {
         showBanner();
@@ -1432,15 +1639,30 @@ int main(int argc, char *argv[]) {
     }
     */
 
+    startup_mark("session");
+
+    if (server_socket) {
+        mainret = server_run(server_socket);
+        goto out;
+    }
+
 #ifdef HAVE_GUI
 
+    // A one-shot -c / -s / -l run quits as soon as its commands are done, which closes any
+    // plot window with it. Skip the Qt start up (and its delayed worker start) for those.
+    bool one_shot = (script_cmd || script_cmds_file) && (stayInCommandLoop == false);
+
 #  if defined(_WIN32)
-    InitGraphics(argc, argv, script_cmds_file, script_cmd, stayInCommandLoop);
-    MainGraphics();
+    if (one_shot) {
+        main_loop(script_cmds_file, script_cmd, stayInCommandLoop);
+    } else {
+        InitGraphics(argc, argv, script_cmds_file, script_cmd, stayInCommandLoop);
+        MainGraphics();
+    }
 #  else
     // for *nix distro's,  check environment variable to verify a display
     const char *display = getenv("DISPLAY");
-    if (display && strlen(display) > 1) {
+    if ((one_shot == false) && display && strlen(display) > 1) {
         InitGraphics(argc, argv, script_cmds_file, script_cmd, stayInCommandLoop);
         MainGraphics();
     } else {
@@ -1452,10 +1674,15 @@ int main(int argc, char *argv[]) {
     main_loop(script_cmds_file, script_cmd, stayInCommandLoop);
 #endif
 
+out:
+    // queued dumps still being written
+    pm3_save_dump_flush();
+
     // Clean up the port
     if (g_session.pm3_present) {
         CloseProxmark(g_session.current_device);
     }
+    CloseParkedProxmarks();
 
     // Plot/Overlay moved or resized
     if (g_session.window_changed) {
@@ -20,6 +20,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
 
 #include "lauxlib.h"
 #include "cmdmain.h"
@@ -393,6 +394,53 @@ static int l_WaitForResponseTimeout(lua_State *L) {
     return 1;
 }
 
+/**
+ * @brief l_batch runs many raw commands in one call, see SendCommandBatch()
+ * @param reqs - binary string of batch_request_t records,  string.pack("<I2I2I1s2", cmd, reply_cmd, flags, data)
+ * @param timeout - optional, timeout in ms for each reply
+ * @return binary string of batch_response_t records, string.unpack("<I2i2I1I8I8I8s2") and the number of replies
+ */
+static int l_batch(lua_State *L) {
+
+    size_t ms_timeout = 2500;
+
+    int n = lua_gettop(L);
+    if (n == 0)
+        return returnToLuaWithError(L, "You need to supply the batch requests");
+
+    size_t req_len = 0;
+    const uint8_t *req = (const uint8_t *)luaL_checklstring(L, 1, &req_len);
+
+    if (n >= 2)
+        ms_timeout = luaL_checkunsigned(L, 2);
+
+    // worst case, every request gets a full payload back
+    size_t count = 0;
+    for (size_t pos = 0; pos + sizeof(batch_request_t) <= req_len; count++) {
+        batch_request_t hdr;
+        memcpy(&hdr, req + pos, sizeof(hdr));
+        pos += sizeof(hdr) + hdr.len;
+    }
+
+    size_t resp_max = count * (sizeof(batch_response_t) + PM3_CMD_DATA_SIZE);
+    uint8_t *resp = calloc(MAX(resp_max, 1), sizeof(uint8_t));
+    if (resp == NULL) {
+        return returnToLuaWithError(L, "Allocating memory failed");
+    }
+
+    size_t resp_len = 0;
+    int res = SendCommandBatch(req, req_len, resp, resp_max, &resp_len, ms_timeout);
+    if (res < 0) {
+        free(resp);
+        return returnToLuaWithError(L, "Batch failed, error %d", res);
+    }
+
+    lua_pushlstring(L, (const char *)resp, resp_len);
+    lua_pushinteger(L, res);
+    free(resp);
+    return 2;
+}
+
 static int l_mfDarkside(lua_State *L) {
 
     uint32_t blockno = 0;
@@ -863,7 +911,7 @@ static int l_hardnested(lua_State *L) {
     }
 
     uint64_t foundkey = 0;
-    int retval = mfnestedhard(blockNo, keyType, key, trgBlockNo, trgKeyType, haveTarget ? trgkey : NULL, nonce_file_read,  nonce_file_write,  slow,  tests, &foundkey, filename);
+    int retval = mfnestedhard(blockNo, keyType, key, trgBlockNo, trgKeyType, haveTarget ? trgkey : NULL, nonce_file_read,  nonce_file_write,  slow,  false,  false,  tests, &foundkey, filename);
     DropField();
 
     //Push the key onto the stack
@@ -1385,6 +1433,126 @@ static int setLuaPath(lua_State *L, const char *path) {
     return 0; // all done!
 }
 
+// Compiled chunks, keyed on path + mtime + size, so scripts and the lualibs they
+// require are only parsed once per session as long as the file doesn't change
+typedef struct lua_chunk_s {
+    char *path;
+    time_t mtime;
+    off_t size;
+    char *code;
+    size_t len;
+    struct lua_chunk_s *next;
+} lua_chunk_t;
+
+static lua_chunk_t *gs_lua_chunks = NULL;
+
+static int lua_chunk_writer(lua_State *L, const void *p, size_t sz, void *ud) {
+    (void)L;
+    lua_chunk_t *c = (lua_chunk_t *)ud;
+    char *tmp = realloc(c->code, c->len + sz);
+    if (tmp == NULL) {
+        return 1;
+    }
+    memcpy(tmp + c->len, p, sz);
+    c->code = tmp;
+    c->len += sz;
+    return 0;
+}
+
+static void lua_chunk_free(lua_chunk_t *c) {
+    free(c->path);
+    free(c->code);
+    free(c);
+}
+
+void lua_chunk_cache_clear(void) {
+    while (gs_lua_chunks) {
+        lua_chunk_t *next = gs_lua_chunks->next;
+        lua_chunk_free(gs_lua_chunks);
+        gs_lua_chunks = next;
+    }
+}
+
+// same as luaL_loadfile, pushes the chunk or the error message
+int lua_loadfile_cached(lua_State *L, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return luaL_loadfile(L, path);
+    }
+
+    lua_chunk_t **pc = &gs_lua_chunks;
+    while (*pc) {
+        lua_chunk_t *c = *pc;
+        if (strcmp(c->path, path) == 0) {
+            if ((c->mtime == st.st_mtime) && (c->size == st.st_size)) {
+                return luaL_loadbufferx(L, c->code, c->len, path, "b");
+            }
+            // stale
+            *pc = c->next;
+            lua_chunk_free(c);
+            break;
+        }
+        pc = &c->next;
+    }
+
+    int res = luaL_loadfile(L, path);
+    if (res != LUA_OK) {
+        return res;
+    }
+
+    lua_chunk_t *c = calloc(1, sizeof(lua_chunk_t));
+    if (c == NULL) {
+        return res;
+    }
+    c->path = strdup(path);
+    c->mtime = st.st_mtime;
+    c->size = st.st_size;
+    if ((c->path == NULL) || lua_dump(L, lua_chunk_writer, c) || (c->len == 0)) {
+        lua_chunk_free(c);
+        return res;
+    }
+    c->next = gs_lua_chunks;
+    gs_lua_chunks = c;
+    return res;
+}
+
+// package.searchers entry, like the stock Lua file searcher but going through the chunk cache
+static int l_cached_searcher(lua_State *L) {
+    const char *name = luaL_checkstring(L, 1);
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchpath");
+    lua_pushstring(L, name);
+    lua_getfield(L, -3, "path");
+    lua_call(L, 2, 2);
+    if (lua_isnil(L, -2)) {
+        // not found, hand back the message listing the tried paths
+        return 1;
+    }
+    lua_pop(L, 1);
+    const char *path = lua_tostring(L, -1);
+    if (lua_loadfile_cached(L, path) != LUA_OK) {
+        return luaL_error(L, "error loading module '%s' from file '%s':\n\t%s", name, path, lua_tostring(L, -1));
+    }
+    lua_pushstring(L, path);
+    return 2;
+}
+
+static void set_cached_searcher(lua_State *L) {
+    lua_getglobal(L, "package");
+    lua_getfield(L, -1, "searchers");
+    if (lua_istable(L, -1)) {
+        // right after the preload searcher
+        int n = luaL_len(L, -1);
+        for (int i = n; i >= 2; i--) {
+            lua_rawgeti(L, -1, i);
+            lua_rawseti(L, -2, i + 1);
+        }
+        lua_pushcfunction(L, l_cached_searcher);
+        lua_rawseti(L, -2, 2);
+    }
+    lua_pop(L, 2);
+}
+
 int set_pm3_libraries(lua_State *L) {
     static const luaL_Reg libs[] = {
         {"SendCommandMIX",              l_SendCommandMIX},
@@ -1393,6 +1561,7 @@ int set_pm3_libraries(lua_State *L) {
         {"GetFromFlashMem",             l_GetFromFlashMem},
         {"GetFromFlashMemSpiffs",       l_GetFromFlashMemSpiffs},
         {"WaitForResponseTimeout",      l_WaitForResponseTimeout},
+        {"batch",                       l_batch},
         {"mfDarkside",                  l_mfDarkside},
         {"foobar",                      l_foobar},
         {"kbd_enter_pressed",           l_kbd_enter_pressed},
@@ -1505,5 +1674,7 @@ int set_pm3_libraries(lua_State *L) {
         strcat(libraries_path, LUA_LIBRARIES_WILDCARD);
         setLuaPath(L, libraries_path);
     }
+
+    set_cached_searcher(L);
     return 1;
 }
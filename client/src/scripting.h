@@ -32,4 +32,8 @@
 
 int set_pm3_libraries(lua_State *L);
 
+// luaL_loadfile with a session cache of the compiled chunks, keyed on path and mtime
+int lua_loadfile_cached(lua_State *L, const char *path);
+void lua_chunk_cache_clear(void);
+
 #endif
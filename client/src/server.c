@@ -0,0 +1,299 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Headless server mode, serves client commands over a Unix socket
+//-----------------------------------------------------------------------------
+
+#include "server.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui.h"
+#include "util.h"       // g_printAndLog
+#include "cmdmain.h"    // CommandReceived
+#include "comms.h"
+#include "jansson.h"
+
+#if defined(_WIN32)
+
+int server_run(const char *socket_path) {
+    (void)socket_path;
+    PrintAndLogEx(ERR, "Server mode isn't supported on this platform");
+    return PM3_ENOTIMPL;
+}
+
+#else
+
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#define SERVER_MAX_CLIENTS   16
+#define SERVER_MAX_REQUEST   4096
+
+typedef struct {
+    int fd;
+    char buf[SERVER_MAX_REQUEST];
+    size_t len;
+} server_client_t;
+
+static volatile sig_atomic_t gs_server_stop = 0;
+
+static void server_signal(int sig) {
+    (void)sig;
+    gs_server_stop = 1;
+}
+
+static bool server_write(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void server_client_close(server_client_t *c) {
+    close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+}
+
+// Runs one request line, returns false if the connection is to be closed
+static bool server_request(server_client_t *c, char *line) {
+    json_t *id = NULL;
+    json_t *req = NULL;
+    const char *cmd = line;
+
+    if (line[0] == '{') {
+        json_error_t error;
+        req = json_loads(line, 0, &error);
+        const char *s = json_string_value(json_object_get(req, "cmd"));
+        if (s == NULL) {
+            json_decref(req);
+            const char *msg = "{\"status\":-1,\"error\":\"invalid request\"}\n";
+            return server_write(c->fd, msg, strlen(msg));
+        }
+        cmd = s;
+        id = json_object_get(req, "id");
+    }
+
+    if ((strcmp(cmd, "quit") == 0) || (strcmp(cmd, "exit") == 0)) {
+        json_decref(req);
+        return false;
+    }
+
+    uint8_t old_printAndLog = g_printAndLog;
+    g_printAndLog &= PRINTANDLOG_LOG;
+
+    ResultOpen();
+    ResultCaptureOutput();
+    ResultAddStr("cmd", cmd);
+    int res = CommandReceived(cmd);
+    ResultAddInt("status", res);
+    if (g_session.pm3_present && g_session.current_device && g_session.current_device->g_conn) {
+        ResultAddStr("device", g_session.current_device->g_conn->serial_port_name);
+    }
+
+    g_printAndLog = old_printAndLog;
+
+    char *reply = ResultClose(true);
+    if (reply == NULL) {
+        json_decref(req);
+        return false;
+    }
+
+    // put the request id back in front
+    if (id) {
+        json_t *obj = json_loads(reply, JSON_DECODE_ANY, NULL);
+        if (obj) {
+            json_t *out = json_object();
+            json_object_set(out, "id", id);
+            json_object_update(out, obj);
+            free(reply);
+            reply = json_dumps(out, JSON_COMPACT | JSON_PRESERVE_ORDER);
+            json_decref(out);
+            json_decref(obj);
+        }
+    }
+    json_decref(req);
+
+    bool ok = (reply != NULL) && server_write(c->fd, reply, strlen(reply)) && server_write(c->fd, "\n", 1);
+    free(reply);
+    return ok;
+}
+
+// Runs the first complete line buffered for this client, returns false if closed
+static bool server_client_step(server_client_t *c) {
+    char *nl = memchr(c->buf, '\n', c->len);
+    if (nl == NULL) {
+        return true;
+    }
+    *nl = '\0';
+    size_t linelen = nl - c->buf + 1;
+    if ((nl > c->buf) && (nl[-1] == '\r')) {
+        nl[-1] = '\0';
+    }
+
+    bool keep = true;
+    if (strlen(c->buf)) {
+        keep = server_request(c, c->buf);
+    }
+    memmove(c->buf, c->buf + linelen, c->len - linelen);
+    c->len -= linelen;
+    return keep;
+}
+
+int server_run(const char *socket_path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        PrintAndLogEx(ERR, "Socket path too long");
+        return PM3_EINVARG;
+    }
+    strcpy(addr.sun_path, socket_path);
+
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (lfd < 0) {
+        PrintAndLogEx(ERR, "Can't create socket: %s", strerror(errno));
+        return PM3_EFAILED;
+    }
+    unlink(socket_path);
+    if ((bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(lfd, SERVER_MAX_CLIENTS) < 0)) {
+        PrintAndLogEx(ERR, "Can't listen on " _YELLOW_("%s") ": %s", socket_path, strerror(errno));
+        close(lfd);
+        return PM3_EFAILED;
+    }
+    chmod(socket_path, S_IRUSR | S_IWUSR);
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, server_signal);
+    signal(SIGTERM, server_signal);
+
+    PrintAndLogEx(SUCCESS, "Serving on " _YELLOW_("%s"), socket_path);
+
+    server_client_t *clients = calloc(SERVER_MAX_CLIENTS, sizeof(server_client_t));
+    if (clients == NULL) {
+        close(lfd);
+        unlink(socket_path);
+        return PM3_EMALLOC;
+    }
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    struct pollfd fds[SERVER_MAX_CLIENTS + 1];
+    while (gs_server_stop == 0) {
+        // don't sleep while requests are still buffered
+        int timeout = 1000;
+        int nfds = 0;
+        fds[nfds].fd = lfd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            fds[nfds].fd = clients[i].fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            nfds++;
+            if ((clients[i].fd >= 0) && memchr(clients[i].buf, '\n', clients[i].len)) {
+                timeout = 0;
+            }
+        }
+
+        if (poll(fds, nfds, timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int cfd = accept(lfd, NULL, NULL);
+            if (cfd >= 0) {
+                int i = 0;
+                for (; i < SERVER_MAX_CLIENTS; i++) {
+                    if (clients[i].fd < 0) {
+                        clients[i].fd = cfd;
+                        clients[i].len = 0;
+                        break;
+                    }
+                }
+                if (i == SERVER_MAX_CLIENTS) {
+                    const char *msg = "{\"status\":-1,\"error\":\"too many clients\"}\n";
+                    server_write(cfd, msg, strlen(msg));
+                    close(cfd);
+                } else {
+                    PrintAndLogEx(INFO, "client %d connected", i);
+                }
+            }
+        }
+
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            server_client_t *c = &clients[i];
+            if ((c->fd < 0) || ((fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) == 0)) {
+                continue;
+            }
+            ssize_t n = read(c->fd, c->buf + c->len, sizeof(c->buf) - 1 - c->len);
+            if (n <= 0) {
+                PrintAndLogEx(INFO, "client %d disconnected", i);
+                server_client_close(c);
+                continue;
+            }
+            c->len += n;
+            if ((c->len == sizeof(c->buf) - 1) && (memchr(c->buf, '\n', c->len) == NULL)) {
+                const char *msg = "{\"status\":-1,\"error\":\"request too long\"}\n";
+                server_write(c->fd, msg, strlen(msg));
+                server_client_close(c);
+            }
+        }
+
+        // one request per client per round, RF access stays serialised
+        for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+            server_client_t *c = &clients[i];
+            if (c->fd < 0) {
+                continue;
+            }
+            if (server_client_step(c) == false) {
+                PrintAndLogEx(INFO, "client %d closed", i);
+                server_client_close(c);
+            }
+        }
+    }
+
+    for (int i = 0; i < SERVER_MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            close(clients[i].fd);
+        }
+    }
+    free(clients);
+    close(lfd);
+    unlink(socket_path);
+    PrintAndLogEx(INFO, "Server stopped");
+    return PM3_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,30 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Headless server mode, serves client commands over a Unix socket
+//-----------------------------------------------------------------------------
+#ifndef SERVER_H__
+#define SERVER_H__
+
+#include "common.h"
+
+// Protocol, one request / reply per line:
+//   request: a client command, or a JSON object {"id": <any>, "cmd": "<command>"}
+//   reply:   a JSON object {"id", "cmd", "status", "output", <command results>...}
+// Requests from all connections are executed one at a time, in arrival order.
+// "quit" / "exit" closes the connection, the server keeps running.
+int server_run(const char *socket_path);
+
+#endif
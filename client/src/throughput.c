@@ -0,0 +1,494 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Throughput sessions,  per card phase timing of production runs
+//
+// Every command going through CommandReceived() is sorted into a phase by its
+// name. A detect command after anything else starts the next card. Commands
+// run from within a classified command (scripts, autopwn, ...) are part of it,
+// so the time is only counted once.
+//-----------------------------------------------------------------------------
+#include "throughput.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "ui.h"
+#include "commonutil.h"     // ARRAYLEN
+#include "comms.h"          // GetCommsStats
+#include "util_posix.h"     // usclock
+#include "fileutils.h"      // newfilenamemcopy
+#include "memstats.h"       // memstats_process
+#include "jansson.h"
+
+typedef struct {
+    uint64_t phase_us[TP_PHASE_COUNT];
+    uint64_t start_us;
+    uint64_t end_us;
+    uint32_t commands;
+    uint32_t failures;
+    bool detect_only;   // nothing but detect commands yet
+    bool wrote;         // reads from now on are verifies
+} tp_card_t;
+
+static struct {
+    bool active;
+    bool claimed;       // a classified command is running
+    bool card_open;
+    char name[64];
+    uint64_t start_us;
+    uint64_t stop_us;
+    comms_stats_t comms_start;
+    comms_stats_t comms_stop;
+    tp_card_t *cards;
+    uint32_t count;
+    uint32_t cap;
+} tp;
+
+static const char *tp_phase_names[TP_PHASE_COUNT] = {
+    [TP_PHASE_DETECT] = "detect",
+    [TP_PHASE_AUTH]   = "auth",
+    [TP_PHASE_READ]   = "read",
+    [TP_PHASE_WRITE]  = "write",
+    [TP_PHASE_VERIFY] = "verify",
+    [TP_PHASE_SAVE]   = "save",
+};
+
+// last word of the command path,  before any option
+static const struct {
+    const char *word;
+    tp_phase_t phase;
+} tp_words[] = {
+    { "search",       TP_PHASE_DETECT },
+    { "reader",       TP_PHASE_DETECT },
+    { "info",         TP_PHASE_DETECT },
+    { "detect",       TP_PHASE_DETECT },
+    { "chk",          TP_PHASE_AUTH },
+    { "fchk",         TP_PHASE_AUTH },
+    { "nested",       TP_PHASE_AUTH },
+    { "hardnested",   TP_PHASE_AUTH },
+    { "staticnested", TP_PHASE_AUTH },
+    { "darkside",     TP_PHASE_AUTH },
+    { "autopwn",      TP_PHASE_AUTH },
+    { "auth",         TP_PHASE_AUTH },
+    { "login",        TP_PHASE_AUTH },
+    { "rdbl",         TP_PHASE_READ },
+    { "rdsc",         TP_PHASE_READ },
+    { "rdpg",         TP_PHASE_READ },
+    { "read",         TP_PHASE_READ },
+    { "dump",         TP_PHASE_READ },
+    { "wrbl",         TP_PHASE_WRITE },
+    { "wrpg",         TP_PHASE_WRITE },
+    { "write",        TP_PHASE_WRITE },
+    { "restore",      TP_PHASE_WRITE },
+    { "wipe",         TP_PHASE_WRITE },
+    { "clone",        TP_PHASE_WRITE },
+    { "ndefwrite",    TP_PHASE_WRITE },
+    { "setuid",       TP_PHASE_WRITE },
+    { "csetuid",      TP_PHASE_WRITE },
+    { "cload",        TP_PHASE_WRITE },
+    { "verify",       TP_PHASE_VERIFY },
+    { "save",         TP_PHASE_SAVE },
+    { "esave",        TP_PHASE_SAVE },
+    { "csave",        TP_PHASE_SAVE },
+};
+
+static tp_phase_t tp_classify(const char *cmd) {
+
+    char last[24] = {0};
+    const char *p = cmd;
+
+    while (*p) {
+        while (*p == ' ') p++;
+        if (*p == '\0' || *p == '-') {
+            break;
+        }
+
+        size_t n = 0;
+        while (p[n] && p[n] != ' ') n++;
+
+        if (n < sizeof(last)) {
+            for (size_t i = 0; i < n; i++) {
+                last[i] = tolower((unsigned char)p[i]);
+            }
+            last[n] = '\0';
+        } else {
+            last[0] = '\0';
+        }
+        p += n;
+    }
+
+    for (size_t i = 0; i < ARRAYLEN(tp_words); i++) {
+        if (strcmp(last, tp_words[i].word) == 0) {
+            return tp_words[i].phase;
+        }
+    }
+    return TP_PHASE_NONE;
+}
+
+static uint64_t tp_card_total(const tp_card_t *c) {
+    uint64_t sum = 0;
+    for (int i = 0; i < TP_PHASE_COUNT; i++) {
+        sum += c->phase_us[i];
+    }
+    return sum;
+}
+
+static double tp_cards_per_hour(uint64_t now) {
+    if (now <= tp.start_us) {
+        return 0;
+    }
+    return (double)tp.count * 3600.0 * 1000000.0 / (double)(now - tp.start_us);
+}
+
+static void tp_close_card(void) {
+    if (tp.card_open == false) {
+        return;
+    }
+    tp.card_open = false;
+
+    const tp_card_t *c = &tp.cards[tp.count - 1];
+    PrintAndLogEx(INFO, "card " _YELLOW_("%u") " done in %.2f s%s,  " _YELLOW_("%.0f") " cards/h",
+                  tp.count,
+                  (double)tp_card_total(c) / 1000000.0,
+                  (c->failures) ? _RED_(" with failures") : "",
+                  tp_cards_per_hour(usclock())
+                 );
+}
+
+static tp_card_t *tp_card_for(tp_phase_t phase) {
+
+    if (tp.card_open) {
+        tp_card_t *c = &tp.cards[tp.count - 1];
+        if (phase != TP_PHASE_DETECT || c->detect_only) {
+            return c;
+        }
+        tp_close_card();
+    }
+
+    if (tp.count == tp.cap) {
+        uint32_t cap = (tp.cap) ? tp.cap * 2 : 64;
+        tp_card_t *tmp = realloc(tp.cards, cap * sizeof(tp_card_t));
+        if (tmp == NULL) {
+            PrintAndLogEx(WARNING, "failed to allocate memory, throughput session stops counting cards");
+            return NULL;
+        }
+        tp.cards = tmp;
+        tp.cap = cap;
+    }
+
+    tp_card_t *c = &tp.cards[tp.count++];
+    memset(c, 0, sizeof(tp_card_t));
+    c->start_us = usclock();
+    c->detect_only = true;
+    tp.card_open = true;
+    return c;
+}
+
+tp_token_t throughput_cmd_begin(const char *cmd) {
+
+    tp_token_t t = { TP_PHASE_NONE, 0 };
+    if (tp.active == false || tp.claimed || cmd == NULL) {
+        return t;
+    }
+
+    tp_phase_t phase = tp_classify(cmd);
+    if (phase == TP_PHASE_NONE) {
+        return t;
+    }
+
+    tp_card_t *c = tp_card_for(phase);
+    if (c == NULL) {
+        return t;
+    }
+
+    if (phase == TP_PHASE_READ && c->wrote) {
+        phase = TP_PHASE_VERIFY;
+    }
+    if (phase != TP_PHASE_DETECT) {
+        c->detect_only = false;
+    }
+
+    tp.claimed = true;
+    t.phase = phase;
+    t.start_us = usclock();
+    return t;
+}
+
+void throughput_cmd_end(const tp_token_t *t, int res) {
+
+    if (t->phase == TP_PHASE_NONE) {
+        return;
+    }
+    tp.claimed = false;
+
+    if (tp.active == false || tp.card_open == false) {
+        return;
+    }
+
+    tp_card_t *c = &tp.cards[tp.count - 1];
+    uint64_t now = usclock();
+    c->phase_us[t->phase] += now - t->start_us;
+    c->end_us = now;
+    c->commands++;
+    if (res != PM3_SUCCESS) {
+        c->failures++;
+    }
+    if (t->phase == TP_PHASE_WRITE) {
+        c->wrote = true;
+    }
+}
+
+bool throughput_active(void) {
+    return tp.active;
+}
+
+void throughput_start(const char *name) {
+    free(tp.cards);
+    memset(&tp, 0, sizeof(tp));
+
+    if (name) {
+        strncpy(tp.name, name, sizeof(tp.name) - 1);
+    }
+    GetCommsStats(&tp.comms_start);
+    tp.start_us = usclock();
+    tp.active = true;
+}
+
+void throughput_next_card(void) {
+    tp_close_card();
+}
+
+void throughput_stop(void) {
+    if (tp.active == false) {
+        return;
+    }
+    tp_close_card();
+    GetCommsStats(&tp.comms_stop);
+    tp.stop_us = usclock();
+    tp.active = false;
+}
+
+static uint64_t tp_now(void) {
+    return (tp.active) ? usclock() : tp.stop_us;
+}
+
+// transport counters of the session,  a `hw commstats --reset` in between restarts them
+static void tp_comms_delta(comms_stats_t *d) {
+    comms_stats_t cur;
+    if (tp.active) {
+        GetCommsStats(&cur);
+    } else {
+        cur = tp.comms_stop;
+    }
+
+    *d = cur;
+    if (cur.start_us != tp.comms_start.start_us) {
+        return;
+    }
+    d->tx_frames -= tp.comms_start.tx_frames;
+    d->tx_bytes -= tp.comms_start.tx_bytes;
+    d->rx_frames -= tp.comms_start.rx_frames;
+    d->rx_bytes -= tp.comms_start.rx_bytes;
+    d->timeouts -= tp.comms_start.timeouts;
+    d->rtt_count -= tp.comms_start.rtt_count;
+    d->rtt_sum_us -= tp.comms_start.rtt_sum_us;
+}
+
+void throughput_print(void) {
+
+    if (tp.start_us == 0) {
+        PrintAndLogEx(INFO, "No throughput session, start one with " _YELLOW_("`hw throughput --start`"));
+        return;
+    }
+
+    uint64_t now = tp_now();
+    double elapsed = (double)(now - tp.start_us) / 1000000.0;
+
+    uint64_t phase_us[TP_PHASE_COUNT] = {0};
+    uint64_t busy_us = 0;
+    uint32_t failed = 0;
+    for (uint32_t i = 0; i < tp.count; i++) {
+        for (int p = 0; p < TP_PHASE_COUNT; p++) {
+            phase_us[p] += tp.cards[i].phase_us[p];
+        }
+        busy_us += tp_card_total(&tp.cards[i]);
+        if (tp.cards[i].failures) {
+            failed++;
+        }
+    }
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Session") " -----------------------------");
+    if (tp.name[0]) {
+        PrintAndLogEx(INFO, "name............ " _YELLOW_("%s"), tp.name);
+    }
+    PrintAndLogEx(INFO, "state........... %s", (tp.active) ? _GREEN_("running") : "stopped");
+    PrintAndLogEx(INFO, "duration........ %.1f s", elapsed);
+    PrintAndLogEx(INFO, "cards........... " _YELLOW_("%u"), tp.count);
+    if (failed) {
+        PrintAndLogEx(INFO, "with failures... " _RED_("%u"), failed);
+    }
+    PrintAndLogEx(INFO, "cards/hour...... " _YELLOW_("%.0f"), tp_cards_per_hour(now));
+    if (tp.count) {
+        PrintAndLogEx(INFO, "avg per card.... %.2f s", elapsed / tp.count);
+    }
+
+    PrintAndLogEx(INFO, "--- " _CYAN_("Phases") " ------------------------------");
+    PrintAndLogEx(INFO, " phase   |   total s | ms / card | share");
+    PrintAndLogEx(INFO, "---------+-----------+-----------+-------");
+
+    int top = -1;
+    for (int p = 0; p < TP_PHASE_COUNT; p++) {
+        if (top < 0 || phase_us[p] > phase_us[top]) {
+            top = p;
+        }
+        PrintAndLogEx(INFO, " %-7s | %9.2f | %9.1f | %4.1f %%",
+                      tp_phase_names[p],
+                      (double)phase_us[p] / 1000000.0,
+                      (tp.count) ? (double)phase_us[p] / 1000.0 / tp.count : 0.0,
+                      (elapsed > 0) ? (double)phase_us[p] / 10000.0 / elapsed : 0.0
+                     );
+    }
+
+    // handling the cards,  unclassified commands,  waiting
+    uint64_t wall_us = now - tp.start_us;
+    uint64_t other_us = (wall_us > busy_us) ? wall_us - busy_us : 0;
+    PrintAndLogEx(INFO, " %-7s | %9.2f | %9.1f | %4.1f %%",
+                  "other",
+                  (double)other_us / 1000000.0,
+                  (tp.count) ? (double)other_us / 1000.0 / tp.count : 0.0,
+                  (elapsed > 0) ? (double)other_us / 10000.0 / elapsed : 0.0
+                 );
+
+    comms_stats_t d;
+    tp_comms_delta(&d);
+    PrintAndLogEx(INFO, "--- " _CYAN_("Transport") " ---------------------------");
+    PrintAndLogEx(INFO, "TX frames....... %" PRIu64 " ( %" PRIu64 " bytes )", d.tx_frames, d.tx_bytes);
+    PrintAndLogEx(INFO, "RX frames....... %" PRIu64 " ( %" PRIu64 " bytes )", d.rx_frames, d.rx_bytes);
+    PrintAndLogEx(INFO, "timeouts........ %" PRIu64, d.timeouts);
+    PrintAndLogEx(INFO, "round trips..... %" PRIu64 " ( %.2f s )", d.rtt_count, (double)d.rtt_sum_us / 1000000.0);
+
+    uint64_t rss, peak_rss;
+    if (memstats_process(&rss, &peak_rss) && peak_rss) {
+        PrintAndLogEx(INFO, "--- " _CYAN_("Host") " --------------------------------");
+        PrintAndLogEx(INFO, "resident peak... %.1f MB", (double)peak_rss / (1024.0 * 1024.0));
+    }
+
+    if (top >= 0 && phase_us[top]) {
+        PrintAndLogEx(INFO, "");
+        if (other_us > phase_us[top]) {
+            PrintAndLogEx(HINT, "Hint: most time is spent outside of the card commands");
+        } else {
+            PrintAndLogEx(HINT, "Hint: most time is spent in " _YELLOW_("%s"), tp_phase_names[top]);
+        }
+    }
+}
+
+static int tp_save_csv(const char *fn) {
+
+    char *filename = newfilenamemcopy(fn, ".csv");
+    if (filename == NULL) {
+        return PM3_EMALLOC;
+    }
+
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        PrintAndLogEx(FAILED, "error, can't save the file `" _YELLOW_("%s") "`", filename);
+        free(filename);
+        return PM3_EFILE;
+    }
+
+    fprintf(f, "card,start_s,duration_ms");
+    for (int p = 0; p < TP_PHASE_COUNT; p++) {
+        fprintf(f, ",%s_ms", tp_phase_names[p]);
+    }
+    fprintf(f, ",commands,failures\n");
+
+    for (uint32_t i = 0; i < tp.count; i++) {
+        const tp_card_t *c = &tp.cards[i];
+        fprintf(f, "%u,%.3f,%.1f", i + 1, (double)(c->start_us - tp.start_us) / 1000000.0, (double)tp_card_total(c) / 1000.0);
+        for (int p = 0; p < TP_PHASE_COUNT; p++) {
+            fprintf(f, ",%.1f", (double)c->phase_us[p] / 1000.0);
+        }
+        fprintf(f, ",%u,%u\n", c->commands, c->failures);
+    }
+
+    fclose(f);
+    PrintAndLogEx(SUCCESS, "Saved " _YELLOW_("%u") " cards to csv file " _YELLOW_("%s"), tp.count, filename);
+    free(filename);
+    return PM3_SUCCESS;
+}
+
+static int tp_save_json(const char *fn) {
+
+    uint64_t now = tp_now();
+    uint64_t phase_us[TP_PHASE_COUNT] = {0};
+
+    json_t *root = json_object();
+    json_t *cards = json_array();
+
+    for (uint32_t i = 0; i < tp.count; i++) {
+        const tp_card_t *c = &tp.cards[i];
+        json_t *card = json_object();
+        json_object_set_new(card, "card", json_integer(i + 1));
+        json_object_set_new(card, "start_s", json_real((double)(c->start_us - tp.start_us) / 1000000.0));
+        json_object_set_new(card, "duration_ms", json_real((double)tp_card_total(c) / 1000.0));
+        for (int p = 0; p < TP_PHASE_COUNT; p++) {
+            char key[16];
+            snprintf(key, sizeof(key), "%s_ms", tp_phase_names[p]);
+            json_object_set_new(card, key, json_real((double)c->phase_us[p] / 1000.0));
+            phase_us[p] += c->phase_us[p];
+        }
+        json_object_set_new(card, "commands", json_integer(c->commands));
+        json_object_set_new(card, "failures", json_integer(c->failures));
+        json_array_append_new(cards, card);
+    }
+
+    json_t *phases = json_object();
+    for (int p = 0; p < TP_PHASE_COUNT; p++) {
+        json_object_set_new(phases, tp_phase_names[p], json_real((double)phase_us[p] / 1000.0));
+    }
+
+    comms_stats_t d;
+    tp_comms_delta(&d);
+    json_t *transport = json_object();
+    json_object_set_new(transport, "tx_bytes", json_integer(d.tx_bytes));
+    json_object_set_new(transport, "rx_bytes", json_integer(d.rx_bytes));
+    json_object_set_new(transport, "timeouts", json_integer(d.timeouts));
+    json_object_set_new(transport, "round_trips", json_integer(d.rtt_count));
+    json_object_set_new(transport, "round_trip_s", json_real((double)d.rtt_sum_us / 1000000.0));
+
+    json_object_set_new(root, "name", json_string(tp.name));
+    json_object_set_new(root, "duration_s", json_real((double)(now - tp.start_us) / 1000000.0));
+    json_object_set_new(root, "cards", json_integer(tp.count));
+    json_object_set_new(root, "cards_per_hour", json_real(tp_cards_per_hour(now)));
+    json_object_set_new(root, "phases_ms", phases);
+    json_object_set_new(root, "transport", transport);
+    json_object_set_new(root, "per_card", cards);
+
+    int res = saveFileJSONroot(fn, root, JSON_INDENT(2) | JSON_PRESERVE_ORDER, true);
+    json_decref(root);
+    return res;
+}
+
+int throughput_save(const char *fn, bool json) {
+    if (tp.start_us == 0) {
+        PrintAndLogEx(WARNING, "No throughput session to save");
+        return PM3_EINVARG;
+    }
+    return (json) ? tp_save_json(fn) : tp_save_csv(fn);
+}
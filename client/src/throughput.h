@@ -0,0 +1,52 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Throughput sessions,  per card phase timing of production runs
+//-----------------------------------------------------------------------------
+#ifndef THROUGHPUT_H__
+#define THROUGHPUT_H__
+
+#include "common.h"
+
+typedef enum {
+    TP_PHASE_NONE = -1,
+    TP_PHASE_DETECT = 0,    // hf / lf search, readers, info
+    TP_PHASE_AUTH,          // key checks and recovery, authentication
+    TP_PHASE_READ,          // block reads, dumps
+    TP_PHASE_WRITE,         // block writes, restores, clones
+    TP_PHASE_VERIFY,        // verify commands, reads after a write of the same card
+    TP_PHASE_SAVE,          // saving files
+    TP_PHASE_COUNT
+} tp_phase_t;
+
+typedef struct {
+    tp_phase_t phase;
+    uint64_t start_us;
+} tp_token_t;
+
+// around every command run by CommandReceived(),  no-ops while no session is active
+tp_token_t throughput_cmd_begin(const char *cmd);
+void throughput_cmd_end(const tp_token_t *t, int res);
+
+bool throughput_active(void);
+void throughput_start(const char *name);
+// closes the current card,  the next command starts a new one
+void throughput_next_card(void);
+void throughput_stop(void);
+
+void throughput_print(void);
+int throughput_save(const char *fn, bool json);
+
+#endif
@@ -1,5 +1,6 @@
 #include "ringbuffer.h"
 #include <stdlib.h>
+#include <string.h>
 
 RingBuffer *RingBuf_create(int capacity) {
     RingBuffer *buffer = (RingBuffer *)calloc(sizeof(RingBuffer), sizeof(uint8_t));
@@ -51,40 +52,45 @@ bool RingBuf_dequeue(RingBuffer *buffer, uint8_t *value) {
     return true;
 }
 
+// batch operations move at most two contiguous segments instead of a byte at a time
 int RingBuf_enqueueBatch(RingBuffer *buffer, const uint8_t *values, int count) {
-    int processed = 0;
 
     if (RingBuf_getAvailableSize(buffer) < count) {
         count = RingBuf_getAvailableSize(buffer);
     }
 
-    for (int i = 0; i < count; i++) {
-        buffer->data[buffer->rear] = values[i];
-        buffer->rear = (buffer->rear + 1) % buffer->capacity;
-        processed++;
+    int first = buffer->capacity - buffer->rear;
+    if (first > count) {
+        first = count;
     }
 
-    buffer->size += processed;
+    memcpy(buffer->data + buffer->rear, values, first);
+    memcpy(buffer->data, values + first, count - first);
 
-    return processed;
+    buffer->rear = (buffer->rear + count) % buffer->capacity;
+    buffer->size += count;
+
+    return count;
 }
 
 int RingBuf_dequeueBatch(RingBuffer *buffer, uint8_t *values, int count) {
-    int processed = 0;
 
     if (buffer->size < count) {
         count = buffer->size;
     }
 
-    for (int i = 0; i < count; i++) {
-        values[i] = buffer->data[buffer->front];
-        buffer->front = (buffer->front + 1) % buffer->capacity;
-        processed++;
+    int first = buffer->capacity - buffer->front;
+    if (first > count) {
+        first = count;
     }
 
-    buffer->size -= processed;
+    memcpy(values, buffer->data + buffer->front, first);
+    memcpy(values + first, buffer->data, count - first);
 
-    return processed;
+    buffer->front = (buffer->front + count) % buffer->capacity;
+    buffer->size -= count;
+
+    return count;
 }
 
 inline int RingBuf_getUsedSize(RingBuffer *buffer) {
@@ -116,3 +122,20 @@ inline void RingBuf_postEnqueueBatch(RingBuffer *buffer, int count) {
 inline uint8_t *RingBuf_getRearPtr(RingBuffer *buffer) {
     return buffer->data + buffer->rear;
 }
+
+// for direct read
+inline int RingBuf_getContinousUsedSize(RingBuffer *buffer) {
+    const int usedSize = RingBuf_getUsedSize(buffer);
+    const int continousSize = (buffer->capacity) - (buffer->front);
+    return (usedSize < continousSize) ? usedSize : continousSize;
+}
+
+inline void RingBuf_postDequeueBatch(RingBuffer *buffer, int count) {
+    // no check there
+    buffer->front = (buffer->front + count) % buffer->capacity;
+    buffer->size -= count;
+}
+
+inline uint8_t *RingBuf_getFrontPtr(RingBuffer *buffer) {
+    return buffer->data + buffer->front;
+}
@@ -28,4 +28,9 @@ int RingBuf_getContinousAvailableSize(RingBuffer *buffer);
 void RingBuf_postEnqueueBatch(RingBuffer *buffer, int count);
 uint8_t *RingBuf_getRearPtr(RingBuffer *buffer);
 
+// for direct read
+int RingBuf_getContinousUsedSize(RingBuffer *buffer);
+void RingBuf_postDequeueBatch(RingBuffer *buffer, int count);
+uint8_t *RingBuf_getFrontPtr(RingBuffer *buffer);
+
 #endif
@@ -62,6 +62,17 @@ void uart_close(const serial_port sp);
  */
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen);
 
+/* Waits up to the rx timeout for incoming data on the given port.
+ * Returns PM3_SUCCESS when data is available, PM3_ENODATA on timeout or
+ * when woken up by uart_wakeup().
+ */
+int uart_wait_rx(const serial_port sp);
+
+/* Wakes up a pending uart_wait_rx(), so a queued command is sent without
+ * waiting for the rx timeout. Safe to call from any thread.
+ */
+void uart_wakeup(void);
+
 /* Sends a buffer to a given serial port.
  *   pbtTx: A pointer to a buffer containing the data to send.
  *   len: The amount of data to be sent.
@@ -36,6 +36,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <errno.h>
+#include <pthread.h>
 
 #ifdef HAVE_BLUEZ
 #include <bluetooth/bluetooth.h>
@@ -71,6 +72,20 @@ static uint32_t newtimeout_value = 0;
 static bool newtimeout_pending = false;
 static uint8_t rx_empty_counter = 0;
 
+// self-pipe used to wake up uart_wait_rx() when a command is queued
+static int wakeup_pipe[2] = { -1, -1 };
+static pthread_once_t wakeup_once = PTHREAD_ONCE_INIT;
+
+static void wakeup_pipe_init(void) {
+    if (pipe(wakeup_pipe) != 0) {
+        wakeup_pipe[0] = -1;
+        wakeup_pipe[1] = -1;
+        return;
+    }
+    fcntl(wakeup_pipe[0], F_SETFL, fcntl(wakeup_pipe[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeup_pipe[1], F_SETFL, fcntl(wakeup_pipe[1], F_GETFL) | O_NONBLOCK);
+}
+
 int uart_reconfigure_timeouts(uint32_t value) {
     newtimeout_value = value;
     newtimeout_pending = true;
@@ -448,6 +463,57 @@ void uart_close(const serial_port sp) {
     free(sp);
 }
 
+void uart_wakeup(void) {
+    pthread_once(&wakeup_once, wakeup_pipe_init);
+    if (wakeup_pipe[1] < 0) {
+        return;
+    }
+    uint8_t b = 0;
+    // pipe full means a wakeup is already pending
+    if (write(wakeup_pipe[1], &b, 1) < 0) {
+        return;
+    }
+}
+
+int uart_wait_rx(const serial_port sp) {
+    const serial_port_unix_t_t *spu = (serial_port_unix_t_t *)sp;
+
+    if (spu->udpBuffer != NULL && RingBuf_getUsedSize(spu->udpBuffer) > 0) {
+        return PM3_SUCCESS;
+    }
+
+    pthread_once(&wakeup_once, wakeup_pipe_init);
+    if (wakeup_pipe[0] < 0) {
+        // no wakeup available, let uart_receive() do the waiting
+        return PM3_SUCCESS;
+    }
+
+    if (newtimeout_pending) {
+        timeout.tv_usec = newtimeout_value * 1000;
+        newtimeout_pending = false;
+    }
+
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(spu->fd, &rfds);
+    FD_SET(wakeup_pipe[0], &rfds);
+    struct timeval tv = timeout;
+    int res = select(MAX(spu->fd, wakeup_pipe[0]) + 1, &rfds, NULL, NULL, &tv);
+    if (res < 0) {
+        return (errno == EINTR) ? PM3_ENODATA : PM3_EIO;
+    }
+
+    if (FD_ISSET(wakeup_pipe[0], &rfds)) {
+        uint8_t dummy[16];
+        while (read(wakeup_pipe[0], dummy, sizeof(dummy)) > 0) {};
+    }
+
+    if (res > 0 && FD_ISSET(spu->fd, &rfds)) {
+        return PM3_SUCCESS;
+    }
+    return PM3_ENODATA;
+}
+
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
     uint32_t byteCount;  // FIONREAD returns size on 32b
     fd_set rfds;
@@ -363,6 +363,15 @@ uint32_t uart_get_speed(const serial_port sp) {
     return 0;
 }
 
+void uart_wakeup(void) {
+    // not implemented, uart_receive() timeouts bound the tx latency
+}
+
+int uart_wait_rx(const serial_port sp) {
+    (void)sp;
+    return PM3_SUCCESS;
+}
+
 int uart_receive(const serial_port sp, uint8_t *pbtRx, uint32_t pszMaxRxLen, uint32_t *pszRxLen) {
     const serial_port_windows_t *spw = (serial_port_windows_t *)sp;
     if (spw->hSocket == INVALID_SOCKET) {
@@ -37,6 +37,7 @@
 #include "proxmark3.h"  // PROXLOG
 #include "fileutils.h"
 #include "pm3_cmd.h"
+#include "jansson.h"
 
 #ifdef _WIN32
 # include <direct.h>    // _mkdir
@@ -63,6 +64,201 @@ pthread_mutex_t g_print_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static void fPrintAndLog(FILE *stream, const char *fmt, ...);
 
+// Batched output for bulk printing, see PrintAndLogBufferStart().
+// Lines going to stdout and to the logfile are collected and written in one go,
+// instead of one write + flush per line.
+#define PRINT_BATCH_SIZE (64 * 1024)
+
+typedef struct {
+    char data[PRINT_BATCH_SIZE];
+    size_t len;
+} print_batch_t;
+
+static int gs_print_batch_depth = 0;
+static print_batch_t gs_print_batch_out;
+static print_batch_t gs_print_batch_log;
+static FILE *gs_print_batch_logfile = NULL;
+
+// caller holds g_print_lock
+static void print_batch_flush(void) {
+    if (gs_print_batch_out.len) {
+        fwrite(gs_print_batch_out.data, 1, gs_print_batch_out.len, stdout);
+        fflush(stdout);
+        gs_print_batch_out.len = 0;
+    }
+    if (gs_print_batch_log.len) {
+        if (gs_print_batch_logfile) {
+            fwrite(gs_print_batch_log.data, 1, gs_print_batch_log.len, gs_print_batch_logfile);
+            fflush(gs_print_batch_logfile);
+        }
+        gs_print_batch_log.len = 0;
+    }
+}
+
+// caller holds g_print_lock
+static void print_batch_add(print_batch_t *b, const char *str, bool linefeed) {
+    size_t n = strlen(str) + (linefeed ? 1 : 0);
+    if (b->len + n > sizeof(b->data)) {
+        print_batch_flush();
+    }
+    memcpy(b->data + b->len, str, strlen(str));
+    b->len += strlen(str);
+    if (linefeed) {
+        b->data[b->len++] = '\n';
+    }
+}
+
+// Start collecting output, for commands printing many lines (listings, dumps).
+// Calls nest, the output is written when the outermost PrintAndLogBufferStop() is called
+// or when the batch is full. Errors on stderr and in-place lines flush the batch first.
+void PrintAndLogBufferStart(void) {
+    pthread_mutex_lock(&g_print_lock);
+    gs_print_batch_depth++;
+    pthread_mutex_unlock(&g_print_lock);
+}
+
+void PrintAndLogBufferStop(void) {
+    pthread_mutex_lock(&g_print_lock);
+    if (gs_print_batch_depth > 0) {
+        gs_print_batch_depth--;
+    }
+    if (gs_print_batch_depth == 0) {
+        print_batch_flush();
+    }
+    pthread_mutex_unlock(&g_print_lock);
+}
+
+// Structured results, filled by the commands which support it while a collector is open.
+// Library users get them as JSON instead of parsing the console output
+static json_t *gs_result = NULL;
+// console text, ANSI stripped, when the collector also captures the output
+static char *gs_result_out = NULL;
+static size_t gs_result_out_len = 0;
+static size_t gs_result_out_size = 0;
+
+static void result_out_free(void) {
+    free(gs_result_out);
+    gs_result_out = NULL;
+    gs_result_out_len = 0;
+    gs_result_out_size = 0;
+}
+
+// called with g_print_lock held
+static void result_out_add(const char *str, bool linefeed) {
+    if ((gs_result == NULL) || (gs_result_out == NULL)) {
+        return;
+    }
+    size_t n = strlen(str) + 1;
+    if (gs_result_out_len + n + 1 > gs_result_out_size) {
+        size_t size = (gs_result_out_size * 2) + n + 1;
+        char *tmp = realloc(gs_result_out, size);
+        if (tmp == NULL) {
+            return;
+        }
+        gs_result_out = tmp;
+        gs_result_out_size = size;
+    }
+    memcpy(gs_result_out + gs_result_out_len, str, n - 1);
+    gs_result_out_len += n - 1;
+    if (linefeed) {
+        gs_result_out[gs_result_out_len++] = '\n';
+    }
+    gs_result_out[gs_result_out_len] = '\0';
+}
+
+void ResultOpen(void) {
+    if (gs_result) {
+        json_decref(gs_result);
+    }
+    result_out_free();
+    gs_result = json_object();
+}
+
+// also keep the console text, returned in "output"
+void ResultCaptureOutput(void) {
+    if ((gs_result == NULL) || gs_result_out) {
+        return;
+    }
+    gs_result_out_size = 1024;
+    gs_result_out = calloc(gs_result_out_size, sizeof(char));
+    if (gs_result_out == NULL) {
+        gs_result_out_size = 0;
+    }
+}
+
+bool ResultIsOpen(void) {
+    return (gs_result != NULL);
+}
+
+// returns a malloc'd JSON string, or NULL if no collector was open
+char *ResultClose(bool compact) {
+    if (gs_result == NULL) {
+        return NULL;
+    }
+    pthread_mutex_lock(&g_print_lock);
+    if (gs_result_out) {
+        json_object_set_new(gs_result, "output", json_string(gs_result_out));
+        result_out_free();
+    }
+    pthread_mutex_unlock(&g_print_lock);
+    char *res = json_dumps(gs_result, (compact ? JSON_COMPACT : JSON_INDENT(2)) | JSON_PRESERVE_ORDER);
+    json_decref(gs_result);
+    gs_result = NULL;
+    return res;
+}
+
+static json_t *result_hex(const uint8_t *data, size_t len) {
+    char *s = calloc((len * 2) + 1, sizeof(char));
+    if (s == NULL) {
+        return json_null();
+    }
+    for (size_t i = 0; i < len; i++) {
+        snprintf(s + (i * 2), 3, "%02X", data[i]);
+    }
+    json_t *v = json_string(s);
+    free(s);
+    return v;
+}
+
+static void result_append(const char *key, json_t *value) {
+    json_t *arr = json_object_get(gs_result, key);
+    if (json_is_array(arr) == false) {
+        arr = json_array();
+        json_object_set_new(gs_result, key, arr);
+    }
+    json_array_append_new(arr, value);
+}
+
+void ResultAddStr(const char *key, const char *value) {
+    if (gs_result) {
+        json_object_set_new(gs_result, key, json_string(value));
+    }
+}
+
+void ResultAddHex(const char *key, const uint8_t *data, size_t len) {
+    if (gs_result) {
+        json_object_set_new(gs_result, key, result_hex(data, len));
+    }
+}
+
+void ResultAddInt(const char *key, int64_t value) {
+    if (gs_result) {
+        json_object_set_new(gs_result, key, json_integer(value));
+    }
+}
+
+void ResultAppendStr(const char *key, const char *value) {
+    if (gs_result) {
+        result_append(key, json_string(value));
+    }
+}
+
+void ResultAppendHex(const char *key, const uint8_t *data, size_t len) {
+    if (gs_result) {
+        result_append(key, result_hex(data, len));
+    }
+}
+
 #ifdef _WIN32
 #define MKDIR_CHK _mkdir(path)
 #else
@@ -303,6 +499,11 @@ void PrintAndLogEx(logLevel_t level, const char *fmt, ...) {
             char buffer4[sizeof(buffer2)] = {0};
             memcpy_filter_ansi(buffer3, buffer2, sizeof(buffer2), !g_session.supports_colors);
             memcpy_filter_emoji(buffer4, buffer3, sizeof(buffer3), g_session.emoji_mode);
+            if (gs_print_batch_depth) {
+                pthread_mutex_lock(&g_print_lock);
+                print_batch_flush();
+                pthread_mutex_unlock(&g_print_lock);
+            }
             fprintf(stream, "\r%s", buffer4);
             fflush(stream);
         } else {
@@ -356,6 +557,12 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
     // lock this section to avoid interlacing prints from different threads
     pthread_mutex_lock(&g_print_lock);
 
+    // batching only applies to stdout, anything else keeps its place in the output
+    bool batch = (gs_print_batch_depth > 0) && (stream == stdout);
+    if (gs_print_batch_depth > 0 && batch == false) {
+        print_batch_flush();
+    }
+
 // If there is an incoming message from the hardware (eg: lf hid read) in
 // the background (while the prompt is displayed and accepting user input),
 // stash the prompt and bring it back later.
@@ -381,13 +588,21 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
         linefeed = false;
         buffer[strlen(buffer) - 1] = 0;
     }
+    if (gs_result_out) {
+        memcpy_filter_ansi(buffer2, buffer, sizeof(buffer), true);
+        result_out_add(buffer2, linefeed);
+    }
     bool filter_ansi = !g_session.supports_colors;
     memcpy_filter_ansi(buffer2, buffer, sizeof(buffer), filter_ansi);
     if (g_printAndLog & PRINTANDLOG_PRINT) {
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), g_session.emoji_mode);
-        fprintf(stream, "%s", buffer3);
-        if (linefeed)
-            fprintf(stream, "\n");
+        if (batch) {
+            print_batch_add(&gs_print_batch_out, buffer3, linefeed);
+        } else {
+            fprintf(stream, "%s", buffer3);
+            if (linefeed)
+                fprintf(stream, "\n");
+        }
     }
 
 #ifdef RL_STATE_READCMD
@@ -403,18 +618,22 @@ static void fPrintAndLog(FILE *stream, const char *fmt, ...) {
 
     if ((g_printAndLog & PRINTANDLOG_LOG) && logging && logfile) {
         memcpy_filter_emoji(buffer3, buffer2, sizeof(buffer2), EMO_ALTTEXT);
-        if (filter_ansi) { // already done
-            fprintf(logfile, "%s", buffer3);
-        } else {
+        if (filter_ansi == false) {
             memcpy_filter_ansi(buffer, buffer3, sizeof(buffer3), true);
-            fprintf(logfile, "%s", buffer);
         }
-        if (linefeed)
-            fprintf(logfile, "\n");
-        fflush(logfile);
+        const char *logline = (filter_ansi) ? buffer3 : buffer; // ansi already filtered or not
+        if (batch) {
+            gs_print_batch_logfile = logfile;
+            print_batch_add(&gs_print_batch_log, logline, linefeed);
+        } else {
+            fprintf(logfile, "%s", logline);
+            if (linefeed)
+                fprintf(logfile, "\n");
+            fflush(logfile);
+        }
     }
 
-    if (flushAfterWrite)
+    if (flushAfterWrite && batch == false)
         fflush(stdout);
 
     //release lock
@@ -50,6 +50,7 @@ typedef struct {
     bool help_dump_mode;
     bool show_hints;
     bool dense_output;
+    bool mf_key_hits; // order MIFARE key dictionaries by previous hits
     bool window_changed; // track if plot/overlay pos/size changed to save on exit
     qtWindow_t plot;
     qtWindow_t overlay;
@@ -63,6 +64,8 @@ typedef struct {
     char *history_path;
     pm3_device_t *current_device;
     uint32_t timeout;
+    int16_t lf_tuned_divisor;   // lf config --tune result,  -1 when not tuned
+    int16_t lf_tuned_trigger;
 } session_arg_t;
 
 extern session_arg_t g_session;
@@ -75,6 +78,19 @@ extern session_arg_t g_session;
 #define PROMPT_CLEARLINE PrintAndLogEx(INPLACE, "                                          \r")
 void PrintAndLogOptions(const char *str[][2], size_t size, size_t space);
 void PrintAndLogEx(logLevel_t level, const char *fmt, ...);
+void PrintAndLogBufferStart(void);
+void PrintAndLogBufferStop(void);
+
+// Structured results, no-ops unless a collector is open
+void ResultOpen(void);
+void ResultCaptureOutput(void);
+bool ResultIsOpen(void);
+char *ResultClose(bool compact);
+void ResultAddStr(const char *key, const char *value);
+void ResultAddHex(const char *key, const uint8_t *data, size_t len);
+void ResultAddInt(const char *key, int64_t value);
+void ResultAppendStr(const char *key, const char *value);
+void ResultAppendHex(const char *key, const uint8_t *data, size_t len);
 void SetFlushAfterWrite(bool value);
 bool GetFlushAfterWrite(void);
 void memcpy_filter_ansi(void *dest, const void *src, size_t n, bool filter);
@@ -616,8 +616,13 @@ char *sprint_breakdown_bin(color_t color, const char *bs, int width, int padn, i
     return buf;
 }
 
+// value of a char that passed isxdigit()
+static uint8_t hexdigit_value(char c) {
+    return (c <= '9') ? (c - '0') : ((c | 0x20) - 'a' + 10);
+}
+
 int hex_to_bytes(const char *hexValue, uint8_t *bytesValue, size_t maxBytesValueLen) {
-    char buf[4] = {0};
+    int nibble = -1;
     int indx = 0;
     int bytesValueLen = 0;
     while (hexValue[indx]) {
@@ -626,9 +631,7 @@ int hex_to_bytes(const char *hexValue, uint8_t *bytesValue, size_t maxBytesValue
             continue;
         }
 
-        if (isxdigit(hexValue[indx])) {
-            buf[strlen(buf)] = hexValue[indx];
-        } else {
+        if (isxdigit(hexValue[indx]) == 0) {
             // if we have symbols other than spaces and hex
             return -1;
         }
@@ -638,18 +641,18 @@ int hex_to_bytes(const char *hexValue, uint8_t *bytesValue, size_t maxBytesValue
             return -2;
         }
 
-        if (strlen(buf) >= 2) {
-            uint32_t temp = 0;
-            sscanf(buf, "%x", &temp);
-            bytesValue[bytesValueLen] = (uint8_t)(temp & 0xff);
-            memset(buf, 0, sizeof(buf));
+        if (nibble < 0) {
+            nibble = hexdigit_value(hexValue[indx]);
+        } else {
+            bytesValue[bytesValueLen] = (uint8_t)((nibble << 4) | hexdigit_value(hexValue[indx]));
+            nibble = -1;
             bytesValueLen++;
         }
 
         indx++;
     }
 
-    if (strlen(buf) > 0) {
+    if (nibble >= 0) {
         //error when not completed hex bytes
         return -3;
     }
@@ -873,7 +876,7 @@ int param_gethex_to_eol(const char *line, int paramnum, uint8_t *data, int maxda
         return 1;
 
     *datalen = 0;
-    char buf[5] = {0};
+    int nibble = -1;
 
     int indx = bg;
     while (line[indx]) {
@@ -882,10 +885,7 @@ int param_gethex_to_eol(const char *line, int paramnum, uint8_t *data, int maxda
             continue;
         }
 
-        if (isxdigit(line[indx])) {
-            buf[strlen(buf) + 1] = 0x00;
-            buf[strlen(buf)] = line[indx];
-        } else {
+        if (isxdigit(line[indx]) == 0) {
             // if we have symbols other than spaces and hex
             return 1;
         }
@@ -895,18 +895,18 @@ int param_gethex_to_eol(const char *line, int paramnum, uint8_t *data, int maxda
             return 2;
         }
 
-        if (strlen(buf) >= 2) {
-            uint32_t temp = 0;
-            sscanf(buf, "%x", &temp);
-            data[*datalen] = (uint8_t)(temp & 0xFF);
-            *buf = 0;
+        if (nibble < 0) {
+            nibble = hexdigit_value(line[indx]);
+        } else {
+            data[*datalen] = (uint8_t)((nibble << 4) | hexdigit_value(line[indx]));
+            nibble = -1;
             (*datalen)++;
         }
 
         indx++;
     }
 
-    if (strlen(buf) > 0)
+    if (nibble >= 0)
         //error when not completed hex bytes
         return 3;
 
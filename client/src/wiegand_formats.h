@@ -45,6 +45,7 @@ typedef struct {
     bool (*Unpack)(wiegand_message_t *packed, wiegand_card_t *card);
     const char *Descrp;
     cardformatdescriptor_t Fields;
+    uint8_t Bits;   // message length the format decodes
 } cardformat_t;
 
 void HIDListFormats(void);
@@ -52,6 +53,7 @@ int HIDFindCardFormat(const char *format);
 cardformat_t HIDGetCardFormat(int idx);
 bool HIDPack(int format_idx, wiegand_card_t *card, wiegand_message_t *packed, bool preamble);
 bool HIDTryUnpack(wiegand_message_t *packed);
+int HIDUnpackMatches(wiegand_message_t *packed, int *idx, wiegand_card_t *cards, int max);
 void HIDPackTryAll(wiegand_card_t *card, bool preamble);
 void HIDUnpack(int idx, wiegand_message_t *packed);
 void print_wiegand_code(wiegand_message_t *packed);
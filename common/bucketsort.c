@@ -15,6 +15,9 @@
 //-----------------------------------------------------------------------------
 #include "bucketsort.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                                   uint32_t *const ostart, uint32_t *const ostop,
                                   bucket_info_t *bucket_info, bucket_array_t bucket) {
@@ -58,3 +61,122 @@ extern void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
         bucket_info->numbuckets = nonempty_bucket;
     }
 }
+
+bool radix_sort_u64(uint64_t *list, size_t len, uint64_t mask, bool descending) {
+    if (len < 2)
+        return true;
+
+    uint64_t *tmp = malloc(len * sizeof(uint64_t));
+    if (tmp == NULL)
+        return false;
+
+    // histograms of all the bytes in one go
+    size_t (*count)[0x100] = calloc(8, sizeof(*count));
+    if (count == NULL) {
+        free(tmp);
+        return false;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        uint64_t v = list[i] & mask;
+        for (uint8_t b = 0; b < 8; b++) {
+            count[b][(v >> (b * 8)) & 0xff]++;
+        }
+    }
+
+    // descending order is ascending order of the complemented bytes
+    uint8_t flip = descending ? 0xff : 0x00;
+
+    uint64_t *src = list, *dst = tmp;
+    for (uint8_t b = 0; b < 8; b++) {
+        uint8_t shift = b * 8;
+
+        // all values share this byte,  nothing to sort on
+        if (count[b][((src[0] & mask) >> shift) & 0xff] == len)
+            continue;
+
+        size_t pos = 0;
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            size_t c = count[b][j ^ flip];
+            count[b][j ^ flip] = pos;
+            pos += c;
+        }
+
+        for (size_t i = 0; i < len; i++) {
+            dst[count[b][((src[i] & mask) >> shift) & 0xff]++] = src[i];
+        }
+
+        uint64_t *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != list) {
+        memcpy(list, src, len * sizeof(uint64_t));
+    }
+
+    free(count);
+    free(tmp);
+    return true;
+}
+
+// first index from lo on with list[index] >= x,  exponential steps then binary search
+static size_t gallop_u64(const uint64_t *list, size_t lo, size_t len, uint64_t x) {
+    size_t hi = lo;
+    size_t step = 1;
+    while (hi < len && list[hi] < x) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > len)
+        hi = len;
+
+    while (lo < hi) {
+        size_t mid = lo + ((hi - lo) >> 1);
+        if (list[mid] < x)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// lists this many times longer than the other one are galloped through instead of merged
+#define INTERSECT_GALLOP_RATIO  16
+
+size_t intersect_sorted_u64(uint64_t *listA, size_t lenA, const uint64_t *listB, size_t lenB) {
+    size_t i = 0, j = 0, n = 0;
+
+    if (lenA > lenB * INTERSECT_GALLOP_RATIO) {
+        for (j = 0; j < lenB && i < lenA; j++) {
+            i = gallop_u64(listA, i, lenA, listB[j]);
+            if (i < lenA && listA[i] == listB[j]) {
+                listA[n++] = listA[i++];
+            }
+        }
+        return n;
+    }
+
+    if (lenB > lenA * INTERSECT_GALLOP_RATIO) {
+        for (i = 0; i < lenA && j < lenB; i++) {
+            j = gallop_u64(listB, j, lenB, listA[i]);
+            if (j < lenB && listB[j] == listA[i]) {
+                listA[n++] = listA[i];
+                j++;
+            }
+        }
+        return n;
+    }
+
+    // branchless merge,  the comparisons are unpredictable on random keys
+    while (i < lenA && j < lenB) {
+        uint64_t a = listA[i];
+        uint64_t b = listB[j];
+        listA[n] = a;
+        n += (a == b);
+        i += (a <= b);
+        j += (a >= b);
+    }
+    return n;
+}
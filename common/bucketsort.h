@@ -36,4 +36,12 @@ void bucket_sort_intersect(uint32_t *const estart, uint32_t *const estop,
                            uint32_t *const ostart, uint32_t *const ostop,
                            bucket_info_t *bucket_info, bucket_array_t bucket);
 
+// Stable LSD radix sort of 64-bit values in ascending (or descending) order of (value & mask),  one pass per
+// byte the values differ in. Returns false when the scratch buffer can't be allocated,  the list is then unchanged.
+bool radix_sort_u64(uint64_t *list, size_t len, uint64_t mask, bool descending);
+
+// Intersection (common members) of two ascending lists of lengths lenA and lenB. Result will be in listA.
+// Number of elements is returned.
+size_t intersect_sorted_u64(uint64_t *listA, size_t lenA, const uint64_t *listB, size_t lenB);
+
 #endif
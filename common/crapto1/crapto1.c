@@ -252,31 +252,17 @@ static const uint32_t T2[] = {  0x3C88B810, 0x5E445C08, 0x2982A580, 0x14C152C0,
                              };
 static const uint32_t C1[] = { 0x846B5, 0x4235A, 0x211AD};
 static const uint32_t C2[] = { 0x1A822E0, 0x21A822E0, 0x21A822E0};
-/** Reverse 64 bits of keystream into possible cipher states
- * Variation mentioned in the paper. Somewhat optimized version
+/** recovery64_range
+ * lfsr_recovery64 for the odd states i = from down to to, results are appended to sl
  */
-struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
-    struct Crypto1State *statelist, *sl;
-    uint8_t oks[32], eks[32], hi[32];
+static struct Crypto1State *recovery64_range(int from, int to, const uint8_t oks[32], const uint8_t eks[32],
+                                             uint32_t *table, struct Crypto1State *sl, const struct Crypto1State *sl_end) {
+    uint8_t hi[32];
     uint32_t low = 0,  win = 0;
-    uint32_t *tail, table[1 << 16];
+    uint32_t *tail;
     int i, j;
 
-    sl = statelist = calloc(1, sizeof(struct Crypto1State) << 4);
-    if (!sl)
-        return 0;
-    sl->odd = sl->even = 0;
-
-    for (i = 30; i >= 0; i -= 2) {
-        oks[i >> 1] = BEBIT(ks2, i);
-        oks[16 + (i >> 1)] = BEBIT(ks3, i);
-    }
-    for (i = 31; i >= 0; i -= 2) {
-        eks[i >> 1] = BEBIT(ks2, i);
-        eks[16 + (i >> 1)] = BEBIT(ks3, i);
-    }
-
-    for (i = 0xfffff; i >= 0; --i) {
+    for (i = from; i >= to; --i) {
         if (filter(i) != oks[0])
             continue;
 
@@ -310,6 +296,9 @@ struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
                     goto continue2;
             }
 
+            if (sl == sl_end)
+                return sl;
+
             *tail = *tail << 1 | (evenparity32(LF_POLY_EVEN & *tail));
             sl->odd = *tail ^ (evenparity32(LF_POLY_ODD & win));
             sl->even = win;
@@ -319,6 +308,36 @@ continue2:
             ;
         }
     }
+    return sl;
+}
+
+static void recovery64_split_ks(uint32_t ks2, uint32_t ks3, uint8_t oks[32], uint8_t eks[32]) {
+    for (int i = 30; i >= 0; i -= 2) {
+        oks[i >> 1] = BEBIT(ks2, i);
+        oks[16 + (i >> 1)] = BEBIT(ks3, i);
+    }
+    for (int i = 31; i >= 0; i -= 2) {
+        eks[i >> 1] = BEBIT(ks2, i);
+        eks[16 + (i >> 1)] = BEBIT(ks3, i);
+    }
+}
+
+#define RECOVERY64_MAX_STATES   (1 << 4)
+
+/** Reverse 64 bits of keystream into possible cipher states
+ * Variation mentioned in the paper. Somewhat optimized version
+ */
+struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3) {
+    struct Crypto1State *statelist;
+    uint8_t oks[32], eks[32];
+    uint32_t table[1 << 16];
+
+    statelist = calloc(1, sizeof(struct Crypto1State) * RECOVERY64_MAX_STATES);
+    if (!statelist)
+        return 0;
+
+    recovery64_split_ks(ks2, ks3, oks, eks);
+    recovery64_range(0xfffff, 0, oks, eks, table, statelist, statelist + RECOVERY64_MAX_STATES - 1);
     return statelist;
 }
 #endif
@@ -506,6 +525,21 @@ static struct Crypto1State *check_pfx_parity(uint32_t prefix, uint32_t rresp, ui
 }
 
 #if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+/** common_prefix_range
+ * lfsr_common_prefix for the odd candidates o up to o_end
+ */
+static struct Crypto1State *common_prefix_range(uint32_t pfx, uint32_t rr, uint8_t par[8][8], uint32_t no_par,
+                                                uint32_t *o, const uint32_t *o_end, uint32_t *even, struct Crypto1State *s) {
+    for (; o < o_end; ++o)
+        for (uint32_t *e = even; *e + 1; ++e)
+            for (uint32_t top = 0; top < 64; ++top) {
+                *o += 1 << 21;
+                *e += (!(top & 7) + 1) << 21;
+                s = check_pfx_parity(pfx, rr, par, *o, *e, s, no_par);
+            }
+    return s;
+}
+
 /** lfsr_common_prefix
  * Implementation of the common prefix attack.
  * Requires the 28 bit constant prefix used as reader nonce (pfx)
@@ -518,7 +552,7 @@ static struct Crypto1State *check_pfx_parity(uint32_t prefix, uint32_t rresp, ui
 
 struct Crypto1State *lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par) {
     struct Crypto1State *statelist, *s;
-    uint32_t *odd, *even, *o, *e, top;
+    uint32_t *odd, *even, *o;
 
     odd = lfsr_prefix_ks(ks, 1);
     even = lfsr_prefix_ks(ks, 0);
@@ -530,13 +564,8 @@ struct Crypto1State *lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8]
         goto out;
     }
 
-    for (o = odd; *o + 1; ++o)
-        for (e = even; *e + 1; ++e)
-            for (top = 0; top < 64; ++top) {
-                *o += 1 << 21;
-                *e += (!(top & 7) + 1) << 21;
-                s = check_pfx_parity(pfx, rr, par, *o, *e, s, no_par);
-            }
+    for (o = odd; *o + 1; ++o);
+    s = common_prefix_range(pfx, rr, par, no_par, odd, o, even, s);
 
     s->odd = s->even = 0;
 out:
@@ -545,3 +574,464 @@ out:
     return statelist;
 }
 #endif
+
+#if !defined(__arm__) || defined(__linux__) || defined(_WIN32) || defined(__APPLE__) // bare metal ARM Proxmark lacks malloc()/free()
+#include <pthread.h>
+#include <string.h>
+
+/** Multithreaded recovery
+ * Same states, in the same order, as the single threaded functions above.
+ * Every worker gets its own tables, they are allocated once per call.
+ */
+
+#define CRAPTO1_MAX_THREADS     64
+
+typedef struct {
+    uint32_t *head, *tail;
+    uint32_t ks, in;
+    int m1, m2;
+} recovery32_half_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    bucket_info_t *bi;
+    uint32_t next;
+    uint32_t oks, eks, in;
+    struct {
+        struct Crypto1State *head;
+        uint32_t len;
+    } res[0x100];
+} recovery32_ctx_t;
+
+typedef struct {
+    recovery32_ctx_t *ctx;
+    uint32_t *odd, *even;
+    struct Crypto1State *sl;
+    bucket_array_t bucket;
+} recovery32_worker_t;
+
+/** recovery32_half_thread
+ * setup one half of the lfsr_recovery32 tables up to the first bucket sort.
+ * Odd and even halves are independent until then.
+ */
+static void *recovery32_half_thread(void *arg) {
+    recovery32_half_t *h = arg;
+    uint8_t ks_b1 = h->ks & 1;
+
+    for (int i = 1 << 20; i >= 0; --i) {
+        if (filter(i) == ks_b1)
+            *++h->tail = i;
+    }
+
+    for (int i = 0; i < 4; i++)
+        extend_table_simple(h->head, &h->tail, (h->ks >>= 1) & 1);
+
+    // first round of recover()
+    for (int i = 0; i < 4 && h->head <= h->tail; i++) {
+        h->ks >>= 1;
+        h->in >>= 2;
+        extend_table(h->head, &h->tail, h->ks & 1, h->m1, h->m2, h->in & 3);
+    }
+    return NULL;
+}
+
+/** recovery32_worker_thread
+ * takes buckets of the first round and recovers them in private tables
+ */
+static void *recovery32_worker_thread(void *arg) {
+    recovery32_worker_t *w = arg;
+    recovery32_ctx_t *ctx = w->ctx;
+    struct Crypto1State *sl = w->sl;
+
+    for (;;) {
+        pthread_mutex_lock(&ctx->lock);
+        uint32_t i = ctx->next++;
+        pthread_mutex_unlock(&ctx->lock);
+
+        if (i >= ctx->bi->numbuckets)
+            break;
+
+        // recover() walks the buckets backwards
+        i = ctx->bi->numbuckets - 1 - i;
+
+        uint32_t olen = ctx->bi->bucket_info[1][i].tail - ctx->bi->bucket_info[1][i].head + 1;
+        uint32_t elen = ctx->bi->bucket_info[0][i].tail - ctx->bi->bucket_info[0][i].head + 1;
+        memcpy(w->odd, ctx->bi->bucket_info[1][i].head, olen * sizeof(uint32_t));
+        memcpy(w->even, ctx->bi->bucket_info[0][i].head, elen * sizeof(uint32_t));
+
+        ctx->res[i].head = sl;
+        sl = recover(w->odd, w->odd + olen - 1, ctx->oks,
+                     w->even, w->even + elen - 1, ctx->eks,
+                     11 - 4, sl, ctx->in, w->bucket);
+        ctx->res[i].len = sl - ctx->res[i].head;
+    }
+    return NULL;
+}
+
+/** lfsr_recovery32_mt
+ * lfsr_recovery32 on several threads
+ */
+struct Crypto1State *lfsr_recovery32_mt(uint32_t ks2, uint32_t in, int threads) {
+
+    if (threads <= 1)
+        return lfsr_recovery32(ks2, in);
+
+    if (threads > CRAPTO1_MAX_THREADS)
+        threads = CRAPTO1_MAX_THREADS;
+
+    struct Crypto1State *statelist = NULL;
+    recovery32_worker_t *workers = NULL;
+    int nworkers = 0;
+    bucket_info_t bucket_info;
+    bucket_array_t bucket = {{{0}}};
+
+    recovery32_half_t odd = { .in = 0, .m1 = LF_POLY_EVEN << 1 | 1, .m2 = LF_POLY_ODD << 1 };
+    recovery32_half_t even = { .m1 = LF_POLY_ODD, .m2 = LF_POLY_EVEN << 1 | 1 };
+
+    // split the keystream into an odd and even part
+    for (int i = 31; i >= 0; i -= 2)
+        odd.ks = odd.ks << 1 | BEBIT(ks2, i);
+    for (int i = 30; i >= 0; i -= 2)
+        even.ks = even.ks << 1 | BEBIT(ks2, i);
+
+    // Byte swapping, see lfsr_recovery32
+    even.in = ((in >> 16 & 0xff) | (in << 16) | (in & 0xff00)) << 1;
+
+    odd.head = odd.tail = calloc(1, sizeof(uint32_t) << 21);
+    even.head = even.tail = calloc(1, sizeof(uint32_t) << 21);
+    if (!odd.tail-- || !even.tail--)
+        goto out;
+
+    pthread_t odd_thread;
+    if (pthread_create(&odd_thread, NULL, recovery32_half_thread, &odd) != 0)
+        goto out;
+    recovery32_half_thread(&even);
+    pthread_join(odd_thread, NULL);
+
+    if (odd.head > odd.tail || even.head > even.tail) {
+        statelist = calloc(1, sizeof(struct Crypto1State));
+        goto out;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j <= 0xff; j++) {
+            bucket[i][j].head = malloc(sizeof(uint32_t) << 14);
+            if (!bucket[i][j].head)
+                goto out;
+        }
+    }
+
+    bucket_sort_intersect(even.head, even.tail, odd.head, odd.tail, &bucket_info, bucket);
+
+    recovery32_ctx_t *ctx = calloc(1, sizeof(recovery32_ctx_t));
+    if (!ctx)
+        goto out;
+
+    pthread_mutex_init(&ctx->lock, NULL);
+    ctx->bi = &bucket_info;
+    ctx->oks = odd.ks;
+    ctx->eks = even.ks;
+    ctx->in = even.in;
+
+    if (threads > (int)bucket_info.numbuckets)
+        threads = bucket_info.numbuckets;
+
+    workers = calloc(threads, sizeof(recovery32_worker_t));
+    if (!workers)
+        goto out_ctx;
+
+    // allocate per worker tables, go on with fewer workers if memory runs out
+    for (nworkers = 0; nworkers < threads; nworkers++) {
+        recovery32_worker_t *w = &workers[nworkers];
+        w->ctx = ctx;
+        w->odd = calloc(1, sizeof(uint32_t) << 21);
+        w->even = calloc(1, sizeof(uint32_t) << 21);
+        w->sl = calloc(1, sizeof(struct Crypto1State) << 18);
+        bool ok = w->odd && w->even && w->sl;
+        for (int i = 0; i < 2; i++) {
+            for (uint32_t j = 0; ok && j <= 0xff; j++) {
+                w->bucket[i][j].head = malloc(sizeof(uint32_t) << 14);
+                ok = (w->bucket[i][j].head != NULL);
+            }
+        }
+        if (!ok) {
+            nworkers++;     // free it below
+            break;
+        }
+    }
+
+    bool complete = (workers[0].bucket[1][0xff].head != NULL);
+    if (complete) {
+        int started = 0;
+        pthread_t thread_id[CRAPTO1_MAX_THREADS];
+        for (int t = 1; t < nworkers && workers[t].bucket[1][0xff].head; t++, started++) {
+            if (pthread_create(&thread_id[t - 1], NULL, recovery32_worker_thread, &workers[t]) != 0)
+                break;
+        }
+
+        // this thread is worker 0, it takes whatever is left
+        recovery32_worker_thread(&workers[0]);
+
+        for (int t = 0; t < started; t++)
+            pthread_join(thread_id[t], NULL);
+    }
+
+    if (complete) {
+        size_t total = 0;
+        for (uint32_t i = 0; i < bucket_info.numbuckets; i++)
+            total += ctx->res[i].len;
+
+        statelist = calloc(total + 1, sizeof(struct Crypto1State));
+        if (statelist) {
+            struct Crypto1State *sl = statelist;
+            for (int i = bucket_info.numbuckets - 1; i >= 0; i--) {
+                memcpy(sl, ctx->res[i].head, ctx->res[i].len * sizeof(struct Crypto1State));
+                sl += ctx->res[i].len;
+            }
+        }
+    }
+
+    for (int t = 0; t < nworkers; t++) {
+        recovery32_worker_t *w = &workers[t];
+        for (int i = 0; i < 2; i++)
+            for (uint32_t j = 0; j <= 0xff; j++)
+                free(w->bucket[i][j].head);
+        free(w->odd);
+        free(w->even);
+        free(w->sl);
+    }
+    free(workers);
+out_ctx:
+    pthread_mutex_destroy(&ctx->lock);
+    free(ctx);
+
+out:
+    for (int i = 0; i < 2; i++)
+        for (uint32_t j = 0; j <= 0xff; j++)
+            free(bucket[i][j].head);
+    free(odd.head);
+    free(even.head);
+    return statelist;
+}
+
+typedef struct {
+    int from, to;
+    const uint8_t *oks, *eks;
+    struct Crypto1State sl[RECOVERY64_MAX_STATES];
+    uint32_t len;
+} recovery64_worker_t;
+
+static void *recovery64_worker_thread(void *arg) {
+    recovery64_worker_t *w = arg;
+    uint32_t *table = malloc(sizeof(uint32_t) << 16);
+    if (table) {
+        struct Crypto1State *sl = recovery64_range(w->from, w->to, w->oks, w->eks, table, w->sl, w->sl + RECOVERY64_MAX_STATES - 1);
+        w->len = sl - w->sl;
+    }
+    free(table);
+    return NULL;
+}
+
+/** lfsr_recovery64_mt
+ * lfsr_recovery64 on several threads, the odd states are split into ranges
+ */
+struct Crypto1State *lfsr_recovery64_mt(uint32_t ks2, uint32_t ks3, int threads) {
+
+    if (threads <= 1)
+        return lfsr_recovery64(ks2, ks3);
+
+    if (threads > CRAPTO1_MAX_THREADS)
+        threads = CRAPTO1_MAX_THREADS;
+
+    uint8_t oks[32], eks[32];
+    recovery64_split_ks(ks2, ks3, oks, eks);
+
+    recovery64_worker_t *workers = calloc(threads, sizeof(recovery64_worker_t));
+    if (!workers)
+        return lfsr_recovery64(ks2, ks3);
+
+    pthread_t thread_id[CRAPTO1_MAX_THREADS];
+    bool started[CRAPTO1_MAX_THREADS] = {0};
+    int chunk = (1 << 20) / threads;
+
+    for (int t = 0; t < threads; t++) {
+        workers[t].from = 0xfffff - t * chunk;
+        workers[t].to = (t == threads - 1) ? 0 : workers[t].from - chunk + 1;
+        workers[t].oks = oks;
+        workers[t].eks = eks;
+        if (t)
+            started[t] = (pthread_create(&thread_id[t], NULL, recovery64_worker_thread, &workers[t]) == 0);
+    }
+
+    recovery64_worker_thread(&workers[0]);
+
+    for (int t = 1; t < threads; t++) {
+        if (started[t])
+            pthread_join(thread_id[t], NULL);
+        else
+            recovery64_worker_thread(&workers[t]);
+    }
+
+    struct Crypto1State *statelist = calloc(1, sizeof(struct Crypto1State) * RECOVERY64_MAX_STATES);
+    if (statelist) {
+        uint32_t len = 0;
+        for (int t = 0; t < threads; t++) {
+            for (uint32_t i = 0; i < workers[t].len && len < RECOVERY64_MAX_STATES - 1; i++)
+                statelist[len++] = workers[t].sl[i];
+        }
+    }
+    free(workers);
+    return statelist;
+}
+
+typedef struct {
+    const uint8_t *ks;
+    int isodd;
+    uint32_t *candidates;
+} prefix_ks_worker_t;
+
+static void *prefix_ks_worker_thread(void *arg) {
+    prefix_ks_worker_t *w = arg;
+    w->candidates = lfsr_prefix_ks(w->ks, w->isodd);
+    return NULL;
+}
+
+typedef struct {
+    uint32_t pfx, rr, no_par;
+    uint8_t (*par)[8];
+    uint32_t *o, *o_end;
+    const uint32_t *even;
+    size_t even_len;
+    struct Crypto1State *sl;
+    size_t len;
+    bool ok;
+} common_prefix_worker_t;
+
+static void *common_prefix_worker_thread(void *arg) {
+    common_prefix_worker_t *w = arg;
+    size_t cap = 0;
+
+    // the even candidates are modified while checking, every worker needs its own copy
+    uint32_t *even = malloc((w->even_len + 1) * sizeof(uint32_t));
+    if (!even)
+        return NULL;
+    memcpy(even, w->even, (w->even_len + 1) * sizeof(uint32_t));
+
+    w->ok = true;
+    for (uint32_t *o = w->o; o < w->o_end; ++o) {
+        // one odd candidate gives at most 64 states per even candidate, plus check_pfx_parity's scratch entry
+        size_t need = w->len + w->even_len * 64 + 1;
+        if (need > cap) {
+            size_t newcap = (cap * 2 > need) ? cap * 2 : need;
+            struct Crypto1State *p = realloc(w->sl, newcap * sizeof(struct Crypto1State));
+            if (!p) {
+                w->ok = false;
+                break;
+            }
+            w->sl = p;
+            cap = newcap;
+        }
+        w->len = common_prefix_range(w->pfx, w->rr, w->par, w->no_par, o, o + 1, even, w->sl + w->len) - w->sl;
+    }
+    free(even);
+    return NULL;
+}
+
+/** lfsr_common_prefix_mt
+ * lfsr_common_prefix on several threads, the odd candidates are split into ranges
+ */
+struct Crypto1State *lfsr_common_prefix_mt(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par, int threads) {
+
+    if (threads <= 1)
+        return lfsr_common_prefix(pfx, rr, ks, par, no_par);
+
+    if (threads > CRAPTO1_MAX_THREADS)
+        threads = CRAPTO1_MAX_THREADS;
+
+    struct Crypto1State *statelist = NULL;
+    common_prefix_worker_t *workers = NULL;
+
+    // odd and even candidates in parallel
+    prefix_ks_worker_t odd = { .ks = ks, .isodd = 1 };
+    prefix_ks_worker_t even = { .ks = ks, .isodd = 0 };
+    pthread_t odd_thread;
+    if (pthread_create(&odd_thread, NULL, prefix_ks_worker_thread, &odd) == 0) {
+        prefix_ks_worker_thread(&even);
+        pthread_join(odd_thread, NULL);
+    } else {
+        prefix_ks_worker_thread(&odd);
+        prefix_ks_worker_thread(&even);
+    }
+
+    if (!odd.candidates || !even.candidates)
+        goto out;
+
+    size_t odd_len = 0, even_len = 0;
+    while (odd.candidates[odd_len] + 1)
+        odd_len++;
+    while (even.candidates[even_len] + 1)
+        even_len++;
+
+    if ((size_t)threads > odd_len)
+        threads = odd_len ? odd_len : 1;
+
+    workers = calloc(threads, sizeof(common_prefix_worker_t));
+    if (!workers)
+        goto out;
+
+    pthread_t thread_id[CRAPTO1_MAX_THREADS];
+    bool started[CRAPTO1_MAX_THREADS] = {0};
+    size_t chunk = (odd_len + threads - 1) / threads;
+
+    for (int t = 0; t < threads; t++) {
+        common_prefix_worker_t *w = &workers[t];
+        w->pfx = pfx;
+        w->rr = rr;
+        w->no_par = no_par;
+        w->par = par;
+        w->o = odd.candidates + ((t * chunk < odd_len) ? t * chunk : odd_len);
+        w->o_end = odd.candidates + (((t + 1) * chunk < odd_len) ? (t + 1) * chunk : odd_len);
+        w->even = even.candidates;
+        w->even_len = even_len;
+        if (t)
+            started[t] = (pthread_create(&thread_id[t], NULL, common_prefix_worker_thread, w) == 0);
+    }
+
+    common_prefix_worker_thread(&workers[0]);
+
+    bool complete = workers[0].ok;
+    for (int t = 1; t < threads; t++) {
+        if (started[t])
+            pthread_join(thread_id[t], NULL);
+        else
+            common_prefix_worker_thread(&workers[t]);
+        complete &= workers[t].ok;
+    }
+
+    if (complete) {
+        size_t total = 0;
+        for (int t = 0; t < threads; t++)
+            total += workers[t].len;
+
+        statelist = calloc(total + 1, sizeof(struct Crypto1State));
+        if (statelist) {
+            struct Crypto1State *sl = statelist;
+            for (int t = 0; t < threads; t++) {
+                if (workers[t].len) {
+                    memcpy(sl, workers[t].sl, workers[t].len * sizeof(struct Crypto1State));
+                    sl += workers[t].len;
+                }
+            }
+        }
+    }
+
+    for (int t = 0; t < threads; t++)
+        free(workers[t].sl);
+    free(workers);
+
+out:
+    free(odd.candidates);
+    free(even.candidates);
+    return statelist;
+}
+#endif
@@ -39,6 +39,11 @@ struct Crypto1State *lfsr_recovery32(uint32_t ks2, uint32_t in);
 struct Crypto1State *lfsr_recovery64(uint32_t ks2, uint32_t ks3);
 struct Crypto1State *
 lfsr_common_prefix(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par);
+// multithreaded versions, same results in the same order. threads <= 1 runs the functions above
+struct Crypto1State *lfsr_recovery32_mt(uint32_t ks2, uint32_t in, int threads);
+struct Crypto1State *lfsr_recovery64_mt(uint32_t ks2, uint32_t ks3, int threads);
+struct Crypto1State *
+lfsr_common_prefix_mt(uint32_t pfx, uint32_t rr, uint8_t ks[8], uint8_t par[8][8], uint32_t no_par, int threads);
 #endif
 uint32_t *lfsr_prefix_ks(const uint8_t ks[8], int isodd);
 
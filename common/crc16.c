@@ -20,10 +20,85 @@
 #include <string.h>
 #include "commonutil.h"
 
+#ifndef ON_DEVICE
+#include <pthread.h>
+#endif
+
 static uint16_t crc_table[256];
 static bool crc_table_init = false;
 static CrcType_t current_crc_type = CRC_NONE;
 
+#ifndef ON_DEVICE
+// Slice-by-8 tables for the CCITT polynomial, MSB first and reflected.
+// Built once and never changed afterwards, unlike crc_table above which follows init_table(),
+// so the protocol CRCs need no init_table() call and are safe from several threads.
+static uint16_t crc_sb8_msb[8][256];
+static uint16_t crc_sb8_lsb[8][256];
+static pthread_once_t crc_sb8_once = PTHREAD_ONCE_INIT;
+
+static void crc_sb8_generate(void) {
+    for (uint16_t i = 0; i < 256; i++) {
+        uint16_t msb = i << 8;
+        uint16_t lsb = i;
+        for (uint8_t j = 0; j < 8; j++) {
+            msb = (msb & 0x8000) ? (msb << 1) ^ CRC16_POLY_CCITT : (msb << 1);
+            lsb = (lsb & 0x0001) ? (lsb >> 1) ^ CRC16_POLY_KERMIT : (lsb >> 1);
+        }
+        crc_sb8_msb[0][i] = msb;
+        crc_sb8_lsb[0][i] = lsb;
+    }
+    for (uint8_t k = 1; k < 8; k++) {
+        for (uint16_t i = 0; i < 256; i++) {
+            uint16_t msb = crc_sb8_msb[k - 1][i];
+            uint16_t lsb = crc_sb8_lsb[k - 1][i];
+            crc_sb8_msb[k][i] = (msb << 8) ^ crc_sb8_msb[0][msb >> 8];
+            crc_sb8_lsb[k][i] = (lsb >> 8) ^ crc_sb8_lsb[0][lsb & 0xFF];
+        }
+    }
+}
+
+// CCITT polynomial CRC, same semantics as crc16_fast() with the matching table
+static uint16_t crc16_ccitt_sb8(uint8_t const *d, size_t n, uint16_t initval, bool refin, bool refout) {
+
+    if (n == 0)
+        return (~initval);
+
+    pthread_once(&crc_sb8_once, crc_sb8_generate);
+
+    uint16_t crc = initval;
+
+    if (refin) {
+        crc = reflect16(crc);
+        for (; n >= 8; n -= 8, d += 8) {
+            uint16_t v = crc ^ (d[0] | (d[1] << 8));
+            crc = crc_sb8_lsb[7][v & 0xFF] ^ crc_sb8_lsb[6][v >> 8]
+                  ^ crc_sb8_lsb[5][d[2]] ^ crc_sb8_lsb[4][d[3]]
+                  ^ crc_sb8_lsb[3][d[4]] ^ crc_sb8_lsb[2][d[5]]
+                  ^ crc_sb8_lsb[1][d[6]] ^ crc_sb8_lsb[0][d[7]];
+        }
+        while (n--) crc = (crc >> 8) ^ crc_sb8_lsb[0][(crc & 0xFF) ^ *d++];
+    } else {
+        for (; n >= 8; n -= 8, d += 8) {
+            uint16_t v = crc ^ ((d[0] << 8) | d[1]);
+            crc = crc_sb8_msb[7][v >> 8] ^ crc_sb8_msb[6][v & 0xFF]
+                  ^ crc_sb8_msb[5][d[2]] ^ crc_sb8_msb[4][d[3]]
+                  ^ crc_sb8_msb[3][d[4]] ^ crc_sb8_msb[2][d[5]]
+                  ^ crc_sb8_msb[1][d[6]] ^ crc_sb8_msb[0][d[7]];
+        }
+        while (n--) crc = (crc << 8) ^ crc_sb8_msb[0][((crc >> 8) ^ *d++) & 0xFF];
+    }
+
+    if (refout ^ refin)
+        crc = reflect16(crc);
+
+    return crc;
+}
+#define CRC16_CCITT_FAST  crc16_ccitt_sb8
+#else
+// firmware keeps the 512 byte table, callers run init_table() first
+#define CRC16_CCITT_FAST  crc16_fast
+#endif
+
 void init_table(CrcType_t crctype) {
 
     // same crc algo, and initialised already
@@ -173,7 +248,9 @@ void compute_crc(CrcType_t ct, const uint8_t *d, size_t n, uint8_t *first, uint8
     // can't calc a crc on less than 1 byte
     if (n == 0) return;
 
+#ifdef ON_DEVICE
     init_table(ct);
+#endif
 
     uint16_t crc = 0;
     switch (ct) {
@@ -219,7 +296,9 @@ uint16_t Crc16ex(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return 0;
 
+#ifdef ON_DEVICE
     init_table(ct);
+#endif
     switch (ct) {
         case CRC_14443_A:
             return crc16_a(d, n);
@@ -265,7 +344,9 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
     // can't calc a crc on less than 3 byte. (1byte + 2 crc bytes)
     if (n < 3) return false;
 
+#ifdef ON_DEVICE
     init_table(ct);
+#endif
 
     switch (ct) {
         case CRC_14443_A:
@@ -301,24 +382,24 @@ bool check_crc(CrcType_t ct, const uint8_t *d, size_t n) {
 
 // poly=0x1021  init=0xffff  refin=false  refout=false  xorout=0x0000  check=0x29b1  residue=0x0000  name="CRC-16/CCITT-FALSE"
 uint16_t crc16_ccitt(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xffff, false, false);
+    return CRC16_CCITT_FAST(d, n, 0xffff, false, false);
 }
 
 // FDX-B ISO11784/85) uses KERMIT/CCITT
 // poly 0x xx  init=0x000  refin=false  refout=true  xorout=0x0000 ...
 uint16_t crc16_fdxb(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, true);
+    return CRC16_CCITT_FAST(d, n, 0x0000, false, true);
 }
 
 // poly=0x1021  init=0x0000  refin=true  refout=true  xorout=0x0000 name="KERMIT"
 uint16_t crc16_kermit(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, true, true);
+    return CRC16_CCITT_FAST(d, n, 0x0000, true, true);
 }
 
 // FeliCa uses XMODEM
 // poly=0x1021  init=0x0000  refin=false  refout=false  xorout=0x0000 name="XMODEM"
 uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x0000, false, false);
+    return CRC16_CCITT_FAST(d, n, 0x0000, false, false);
 }
 
 // Following standards uses X-25
@@ -327,14 +408,14 @@ uint16_t crc16_xmodem(uint8_t const *d, size_t n) {
 //   ISO/IEC 13239 (formerly ISO/IEC 3309)
 // poly=0x1021  init=0xffff  refin=true  refout=true  xorout=0xffff name="X-25"
 uint16_t crc16_x25(uint8_t const *d, size_t n) {
-    uint16_t crc = crc16_fast(d, n, 0xffff, true, true);
+    uint16_t crc = CRC16_CCITT_FAST(d, n, 0xffff, true, true);
     crc = ~crc;
     return crc;
 }
 // CRC-A (14443-3)
 // poly=0x1021 init=0xc6c6 refin=true refout=true xorout=0x0000 name="CRC-A"
 uint16_t crc16_a(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0xC6C6, true, true);
+    return CRC16_CCITT_FAST(d, n, 0xC6C6, true, true);
 }
 
 // iClass crc
@@ -342,7 +423,7 @@ uint16_t crc16_a(uint8_t const *d, size_t n) {
 // poly       0x1021 reflected 0x8408
 // poly=0x1021  init=0x4807  refin=true  refout=true  xorout=0x0BC3  check=0xF0B8  name="CRC-16/ICLASS"
 uint16_t crc16_iclass(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x4807, true, true);
+    return CRC16_CCITT_FAST(d, n, 0x4807, true, true);
 }
 
 // This CRC-16 is used in Legic Advant systems.
@@ -353,5 +434,5 @@ uint16_t crc16_legic(uint8_t const *d, size_t n, uint8_t uidcrc) {
 }
 
 uint16_t crc16_philips(uint8_t const *d, size_t n) {
-    return crc16_fast(d, n, 0x49A3, false, false);
+    return CRC16_CCITT_FAST(d, n, 0x49A3, false, false);
 }
@@ -45,7 +45,7 @@
 
 #include "lfdemod.h"
 #include <string.h>  // for memset, memcmp and size_t
-#include <stdlib.h>  // qsort
+#include <stdlib.h>
 #include "parity.h"  // for parity test
 #include "pm3_cmd.h" // error codes
 #include "commonutil.h"  // Arraylen
@@ -93,11 +93,24 @@ static void printSignal(void) {
 }
 
 #ifndef ON_DEVICE
-static int cmp_uint8(const void *a, const void *b) {
-    if (*(const uint8_t *)a < * (const uint8_t *)b)
-        return -1;
-    else
-        return *(const uint8_t *)a > *(const uint8_t *)b;
+// 8 bit samples, a histogram gives the order statistics without sorting a copy
+static void sample_histogram(const uint8_t *samples, uint32_t size, uint32_t hist[256]) {
+    memset(hist, 0, 256 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < size; i++) {
+        hist[samples[i]]++;
+    }
+}
+
+// n-th smallest sample (0 based), what a sorted copy would hold at index n
+static uint8_t histogram_nth(const uint32_t hist[256], uint32_t n) {
+    uint32_t acc = 0;
+    for (int v = 0; v < 256; v++) {
+        acc += hist[v];
+        if (acc > n) {
+            return v;
+        }
+    }
+    return 255;
 }
 #endif
 
@@ -110,23 +123,25 @@ void computeSignalProperties(const uint8_t *samples, uint32_t size) {
     uint32_t offset_size = size - SIGNAL_IGNORE_FIRST_SAMPLES;
 
 #ifndef ON_DEVICE
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
+    uint32_t hist[256];
+    sample_histogram(samples + SIGNAL_IGNORE_FIRST_SAMPLES, offset_size, hist);
 
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.1)] + tmp[(int)((offset_size - 1) * 0.1)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.9)] + tmp[(int)((offset_size - 1) * 0.9)]);
+    uint8_t low10 = 0.5 * (histogram_nth(hist, (int)(offset_size * 0.1)) + histogram_nth(hist, (int)((offset_size - 1) * 0.1)));
+    uint8_t hi90 =  0.5 * (histogram_nth(hist, (int)(offset_size * 0.9)) + histogram_nth(hist, (int)((offset_size - 1) * 0.9)));
     uint32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
+    for (int v = 0; v < 256; v++) {
 
-        if (samples[i] < signalprop.low) signalprop.low = samples[i];
-        if (samples[i] > signalprop.high) signalprop.high = samples[i];
+        if (hist[v] == 0)
+            continue;
+
+        if (v < signalprop.low) signalprop.low = v;
+        if (v > signalprop.high) signalprop.high = v;
 
-        if (samples[i] < low10 || samples[i] > hi90)
+        if (v < low10 || v > hi90)
             continue;
 
-        sum += samples[i];
-        cnt++;
+        sum += v * hist[v];
+        cnt += hist[v];
     }
     if (cnt > 0)
         signalprop.mean = sum / cnt;
@@ -159,20 +174,15 @@ void removeSignalOffset(uint8_t *samples, uint32_t size) {
 
 #ifndef ON_DEVICE
 
-    uint8_t tmp[offset_size];
-    memcpy(tmp, samples + SIGNAL_IGNORE_FIRST_SAMPLES, sizeof(tmp));
-    qsort(tmp, sizeof(tmp), sizeof(uint8_t), cmp_uint8);
+    uint32_t hist[256];
+    sample_histogram(samples + SIGNAL_IGNORE_FIRST_SAMPLES, offset_size, hist);
 
-    uint8_t low10 = 0.5 * (tmp[(int)(offset_size * 0.05)] + tmp[(int)((offset_size - 1) * 0.05)]);
-    uint8_t hi90 =  0.5 * (tmp[(int)(offset_size * 0.95)] + tmp[(int)((offset_size - 1) * 0.95)]);
+    uint8_t low10 = 0.5 * (histogram_nth(hist, (int)(offset_size * 0.05)) + histogram_nth(hist, (int)((offset_size - 1) * 0.05)));
+    uint8_t hi90 =  0.5 * (histogram_nth(hist, (int)(offset_size * 0.95)) + histogram_nth(hist, (int)((offset_size - 1) * 0.95)));
     int32_t cnt = 0;
-    for (uint32_t i = SIGNAL_IGNORE_FIRST_SAMPLES; i < size; i++) {
-
-        if (samples[i] < low10 || samples[i] > hi90)
-            continue;
-
-        acc_off += samples[i] - 128;
-        cnt++;
+    for (int v = low10; v <= hi90; v++) {
+        acc_off += (v - 128) * (int32_t)hist[v];
+        cnt += hist[v];
     }
     if (cnt > 0)
         acc_off /= cnt;
@@ -262,8 +272,6 @@ size_t removeParity(uint8_t *bits, size_t startIdx, uint8_t pLen, uint8_t pType,
 }
 
 static size_t removeEm410xParity(uint8_t *bits, size_t startIdx, size_t *size, bool *validShort, bool *validShortExtended, bool *validLong) {
-    uint32_t parityWd = 0;
-    size_t bitCnt = 0;
     bool validColParity = false;
     bool validRowParity = true;
     bool validRowParitySkipColP = true;
@@ -284,39 +292,41 @@ static size_t removeEm410xParity(uint8_t *bits, size_t startIdx, size_t *size, b
             break;
     }
 
-    uint16_t parityCol[4] = { 0, 0, 0, 0 };
+    // 5 bit rows, 4 data bits and a row parity bit each
+    uint8_t packed[(110 + 7) / 8] = {0};
+    if (bitpack(bits + startIdx, blen, packed) != blen) {
+        // manchester errors in the frame
+        return 0;
+    }
 
-    for (int word = 0; word < blen; word += 5) {
-        for (int bit = 0; bit < 5; bit++) {
+    uint8_t data[(88 + 7) / 8] = {0};
+    size_t bitCnt = 0;
+    uint8_t parityCol = 0;
 
-            if (word + bit >= blen) {
-                break;
-            }
-            parityWd = (parityWd << 1) | bits[startIdx + word + bit];
+    for (int word = 0; word < blen; word += 5) {
 
-            if ((word <= 50) && (bit < 4)) {
-                parityCol[bit] = (parityCol[bit] << 1) | bits[startIdx + word + bit];
-            }
+        uint8_t row = bitpack_get(packed, word, 5);
 
-            bits[bitCnt++] = (bits[startIdx + word + bit]);
+        // the column parity covers the first 11 rows, CCCC row included
+        if (word <= 50) {
+            parityCol ^= (row >> 1);
         }
 
-        if (word + 5 > blen) break;
+        data[bitCnt / 8] |= (row >> 1) << (4 - (bitCnt % 8));
+        bitCnt += 4;
 
-        bitCnt--; // overwrite parity with next data
-        validRowParity &= parityTest(parityWd, 5, 0) != 0;
+        validRowParity &= parityTest(row, 5, 0) != 0;
 
         if (word == 50) { // column parity nibble on short EM and on Electra
-            validColParity = parityTest(parityCol[0], 11, 0) != 0;
-            validColParity &= parityTest(parityCol[1], 11, 0) != 0;
-            validColParity &= parityTest(parityCol[2], 11, 0) != 0;
-            validColParity &= parityTest(parityCol[3], 11, 0) != 0;
+            validColParity = (parityCol == 0);
         } else {
-            validRowParitySkipColP &= parityTest(parityWd, 5, 0) != 0;
+            validRowParitySkipColP &= parityTest(row, 5, 0) != 0;
         }
-        parityWd = 0;
     }
 
+    // callers look at the data bits without the row parity
+    bitunpack(data, 0, bitCnt, bits);
+
     if ((blen != 128) && validRowParitySkipColP && validColParity) {
         *validShort = true;
     }
@@ -377,6 +387,69 @@ int bits_to_array(const uint8_t *bits, size_t size, uint8_t *dest) {
     return PM3_SUCCESS;
 }
 
+size_t bitpack(const uint8_t *bits, size_t n, uint8_t *dest) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8_t b = 0, bad = 0;
+        for (uint8_t j = 0; j < 8; j++) {
+            b = (b << 1) | (bits[i + j] & 1);
+            bad |= bits[i + j];
+        }
+        if (bad > 1) {
+            break;
+        }
+        dest[i / 8] = b;
+    }
+
+    // tail, and the byte holding a non 0/1 value
+    for (; i < n; i++) {
+        if (bits[i] > 1) {
+            return i;
+        }
+        uint8_t m = 0x80 >> (i % 8);
+        if (bits[i]) {
+            dest[i / 8] |= m;
+        } else {
+            dest[i / 8] &= ~m;
+        }
+    }
+    return n;
+}
+
+void bitunpack(const uint8_t *src, size_t idx, size_t n, uint8_t *bits) {
+    for (size_t i = 0; i < n; i++) {
+        size_t b = idx + i;
+        bits[i] = (src[b / 8] >> (7 - (b % 8))) & 1;
+    }
+}
+
+uint32_t bitpack_get(const uint8_t *src, size_t idx, uint8_t n) {
+    if (n == 0 || n > 32) {
+        return 0;
+    }
+
+    // the n bits are spread over 5 bytes at most
+    size_t first = idx / 8;
+    size_t last = (idx + n - 1) / 8;
+    uint64_t w = 0;
+    for (size_t i = first; i <= last; i++) {
+        w = (w << 8) | src[i];
+    }
+    w >>= (7 - ((idx + n - 1) % 8));
+    return (uint32_t)(w & ((n == 32) ? 0xFFFFFFFFULL : ((1ULL << n) - 1)));
+}
+
+uint8_t bitpack_parity(const uint8_t *src, size_t idx, size_t n) {
+    uint32_t x = 0;
+    for (; n >= 32; n -= 32, idx += 32) {
+        x ^= bitpack_get(src, idx, 32);
+    }
+    if (n) {
+        x ^= bitpack_get(src, idx, n);
+    }
+    return evenparity32(x);
+}
+
 uint32_t bytebits_to_byte(uint8_t *src, size_t numbits) {
     uint32_t num = 0;
     for (int i = 0 ; i < numbits ; i++) {
@@ -402,30 +475,161 @@ bool preambleSearch(uint8_t *bits, uint8_t *preamble, size_t pLen, size_t *size,
 // search for given preamble in given BitStream and return success=1 or fail=0 and startIndex (where it was found) and length if not fineone
 // fineone does not look for a repeating preamble for em4x05/4x69 sends preamble once, so look for it once in the first pLen bits
 // (iceman) FINDONE,  only finds start index. NOT SIZE!.  I see Em410xDecode (lfdemod.c) uses SIZE to determine success
+// packs a preamble of 0/1 bytes,  first bit is the most significant.  False if it doesn't fit
+static bool preamble_pack(const uint8_t *preamble, size_t pLen, uint64_t *pattern) {
+    if (pLen == 0 || pLen > 64) {
+        return false;
+    }
+    uint64_t p = 0;
+    for (size_t i = 0; i < pLen; i++) {
+        if (preamble[i] > 1) {
+            return false;
+        }
+        p = (p << 1) | preamble[i];
+    }
+    *pattern = p;
+    return true;
+}
+
+static inline uint64_t preamble_mask(size_t pLen) {
+    return (pLen >= 64) ? UINT64_MAX : ((1ULL << pLen) - 1);
+}
+
+// next start in [from, end) where the preamble matches, end if there is none
+static size_t preamble_find(const uint8_t *bits, size_t from, size_t end, const uint8_t *preamble, size_t pLen, bool packed, uint64_t pattern) {
+
+    if (packed == false) {
+        for (size_t idx = from; idx < end; idx++) {
+            if (memcmp(bits + idx, preamble, pLen) == 0) {
+                return idx;
+            }
+        }
+        return end;
+    }
+
+    // window over the last pLen bits, a window holding a byte other than 0/1 never matches
+    uint64_t mask = preamble_mask(pLen);
+    uint64_t window = 0;
+    size_t valid_from = from;
+    size_t j = from;
+
+    for (; j < from + pLen - 1; j++) {
+        window = (window << 1) | (bits[j] & 1);
+        if (bits[j] > 1) {
+            valid_from = j + 1;
+        }
+    }
+
+    for (size_t idx = from; idx < end; idx++, j++) {
+        window = (window << 1) | (bits[j] & 1);
+        if (bits[j] > 1) {
+            valid_from = j + 1;
+        }
+        if ((window & mask) == pattern && valid_from <= idx) {
+            return idx;
+        }
+    }
+    return end;
+}
+
 bool preambleSearchEx(uint8_t *bits, uint8_t *preamble, size_t pLen, size_t *size, size_t *startIdx, bool findone) {
     // Sanity check.  If preamble length is bigger than bits length.
     if (*size <= pLen)
         return false;
 
-    uint8_t foundCnt = 0;
-    for (size_t idx = 0; idx < *size - pLen; idx++) {
-        if (memcmp(bits + idx, preamble, pLen) == 0) {
-            //first index found
-            foundCnt++;
-            if (foundCnt == 1) {
-                if (g_debugMode >= 1) prnt("DEBUG: (preambleSearchEx) preamble found at %zu", idx);
-                *startIdx = idx;
-                if (findone)
-                    return true;
+    size_t end = *size - pLen;
+    uint64_t pattern = 0;
+    bool packed = preamble_pack(preamble, pLen, &pattern);
+
+    //first index found
+    size_t idx = preamble_find(bits, 0, end, preamble, pLen, packed, pattern);
+    if (idx == end) {
+        return false;
+    }
+
+    if (g_debugMode >= 1) prnt("DEBUG: (preambleSearchEx) preamble found at %zu", idx);
+    *startIdx = idx;
+    if (findone)
+        return true;
+
+    size_t idx2 = preamble_find(bits, idx + 1, end, preamble, pLen, packed, pattern);
+    if (idx2 < end) {
+        if (g_debugMode >= 1) prnt("DEBUG: (preambleSearchEx) preamble 2 found at %zu", idx2);
+        *size = idx2 - idx;
+    }
+    return true;
+}
+
+bool preambleSearchMulti(const uint8_t *bits, size_t size, preamble_match_t *m, size_t count) {
+
+    uint64_t patterns[count];
+    uint8_t found_cnt[count];
+    size_t pending = 0;
+
+    for (size_t k = 0; k < count; k++) {
+        m[k].found = false;
+        m[k].start = 0;
+        m[k].size = size;
+        found_cnt[k] = 0;
+
+        // too long for the window,  searched on its own
+        if (preamble_pack(m[k].preamble, m[k].len, &patterns[k]) == false) {
+            found_cnt[k] = 2;
+            m[k].found = preambleSearch((uint8_t *)bits, (uint8_t *)m[k].preamble, m[k].len, &m[k].size, &m[k].start);
+            continue;
+        }
+
+        // same sanity check as preambleSearchEx
+        if (size <= m[k].len) {
+            found_cnt[k] = 2;
+            continue;
+        }
+
+        pending++;
+    }
+
+    uint64_t window = 0, invalid = 0;
+    for (size_t j = 0; j < size && pending; j++) {
+        window = (window << 1) | (bits[j] & 1);
+        invalid = (invalid << 1) | (bits[j] > 1);
+
+        for (size_t k = 0; k < count; k++) {
+            size_t len = m[k].len;
+            if (found_cnt[k] >= 2 || j + 1 < len) {
+                continue;
             }
-            if (foundCnt == 2) {
+
+            size_t idx = j + 1 - len;
+            if (idx >= size - len) {
+                // past the last start preambleSearchEx looks at
+                found_cnt[k] = 2;
+                pending--;
+                continue;
+            }
+
+            uint64_t mask = preamble_mask(len);
+            if ((window & mask) != patterns[k] || (invalid & mask)) {
+                continue;
+            }
+
+            found_cnt[k]++;
+            if (found_cnt[k] == 1) {
+                if (g_debugMode >= 1) prnt("DEBUG: (preambleSearchEx) preamble found at %zu", idx);
+                m[k].found = true;
+                m[k].start = idx;
+            } else {
                 if (g_debugMode >= 1) prnt("DEBUG: (preambleSearchEx) preamble 2 found at %zu", idx);
-                *size = idx - *startIdx;
-                return true;
+                m[k].size = idx - m[k].start;
+                pending--;
             }
         }
     }
-    return (foundCnt > 0);
+
+    bool any = false;
+    for (size_t k = 0; k < count; k++) {
+        any |= m[k].found;
+    }
+    return any;
 }
 
 // find start of modulating data (for fsk and psk) in case of beginning noise or slow chip startup.
@@ -1897,26 +2101,111 @@ int nrzRawDemod(uint8_t *dest, size_t *size, int *clk, const int *invert, int *s
     return 0;
 }
 
-// translate wave to 11111100000 (1 for each short wave [higher freq] 0 for each long wave [lower freq])
-static size_t fsk_wave_demod(uint8_t *dest, size_t size, uint8_t fchigh, uint8_t fclow, int *startIdx) {
-
-    if (size < 1024) return 0;   // not enough samples
+void fsk_stream_init(fsk_stream_t *s, uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, int threshold, size_t first_pos) {
+    memset(s, 0, sizeof(fsk_stream_t));
 
     if (fchigh == 0) fchigh = 10;
     if (fclow == 0) fclow = 8;
 
-    //set the threshold close to 0 (graph) or 128 std to avoid static
-    size_t preLastSample, LastSample = 0;
-    size_t currSample = 0, last_transition = 0;
-    size_t idx, numBits = 0;
+    s->clk = rfLen;
+    s->invert = invert;
+    s->fchigh = fchigh;
+    s->fclow = fclow;
+    s->threshold = threshold;
+    s->pos = first_pos;
+}
 
-    //find start of modulating data in trace
-    idx = findModStart(dest, size, fchigh);
-    // Need to threshold first sample
-    dest[idx] = (dest[idx] < signalprop.mean) ? 0 : 1;
+static size_t fsk_stream_emit(fsk_stream_t *s, uint8_t bit, uint32_t n, uint8_t *out, size_t out_len, size_t *outpos) {
+    size_t room = out_len - *outpos;
+    if (n > room) {
+        n = room;
+    }
+    memset(out + *outpos, bit, n);
+    *outpos += n;
+    s->bits += n;
+    return n;
+}
+
+// translate 11111100000 to 10
+// one wave at a time,  a run of waves is turned into bits once the next run starts
+static void fsk_stream_aggregate(fsk_stream_t *s, uint8_t wave, uint8_t *out, size_t out_len, size_t *outpos) {
+
+    if (s->agg_waves == 0) {
+        s->agg_last = wave;
+        s->agg_prev = wave;
+        s->agg_n = 1;
+        s->agg_waves = 1;
+        return;
+    }
+
+    size_t i = s->agg_waves;
+    uint32_t n = s->agg_n + 1;
+    uint8_t clk = s->clk;
+    uint8_t hclk = clk / 2;
 
-    last_transition = idx;
-    idx++;
+    if (wave != s->agg_last) {
+
+        //find out how many bits (n) we collected (use 1/2 clk tolerance)
+
+        if (s->agg_prev == 1)
+            //if lastval was 1, we have a 1->0 crossing
+            n = (n * s->fclow + hclk) / clk;
+        else
+            // 0->1 crossing
+            n = (n * s->fchigh + hclk) / clk;
+
+        if (n == 0)
+            n = 1;
+
+        //first transition - save startidx
+        if (s->bits == 0) {
+            if (s->agg_last == 1) {  //high to low
+                s->agg_start += (s->fclow * i) - (n * clk);
+                if (g_debugMode == 2) prnt("DEBUG (aggregate_bits) FSK startIdx %i, fclow*idx %zu, n*clk %u", s->wave_start + s->agg_start, s->fclow * i, n * clk);
+            } else {
+                s->agg_start += (s->fchigh * i) - (n * clk);
+                if (g_debugMode == 2) prnt("DEBUG (aggregate_bits) FSK startIdx %i, fchigh*idx %zu, n*clk %u", s->wave_start + s->agg_start, s->fchigh * i, n * clk);
+            }
+        }
+
+        //add to our destination the bits we collected
+        fsk_stream_emit(s, s->agg_prev ^ s->invert, n, out, out_len, outpos);
+
+        n = 0;
+        s->agg_last = wave;
+    }
+
+    s->agg_n = n;
+    s->agg_prev2 = s->agg_prev;
+    s->agg_prev = wave;
+    s->agg_waves++;
+}
+
+// A wave is final once the next one is known (it can still be corrected to a short wave)
+// and once three waves are in (garbage at the start resets the decoder)
+static void fsk_stream_commit(fsk_stream_t *s, bool all, uint8_t *out, size_t out_len, size_t *outpos) {
+    while (s->pending_len) {
+        size_t oldest = s->waves - s->pending_len;
+        if (all == false && (s->waves < oldest + 2 || s->waves < 3)) {
+            break;
+        }
+        uint8_t wave = s->pending[0];
+        s->pending_len--;
+        memmove(s->pending, s->pending + 1, s->pending_len);
+        fsk_stream_aggregate(s, wave, out, out_len, outpos);
+    }
+}
+
+static void fsk_stream_wave(fsk_stream_t *s, uint8_t wave) {
+    s->pending[s->pending_len++] = wave;
+    s->waves++;
+}
+
+size_t fsk_stream_push(fsk_stream_t *s, const uint8_t *samples, size_t n, uint8_t *out, size_t out_len) {
+
+    size_t outpos = 0;
+    uint8_t fchigh = s->fchigh;
+    uint8_t fclow = s->fclow;
 
     // Definition:  cycles between consecutive lo-hi transitions
     // Lets define some expected lengths. FSK1 is easier since it has bigger differences between.
@@ -1948,118 +2237,116 @@ static size_t fsk_wave_demod(uint8_t *dest, size_t size, uint8_t fchigh, uint8_t
     // width should be divided with exp_one.  i:e 6+7+6+2=21,  21/5 = 4,
     // the 1-0 to 0-1  width should be divided with exp_zero.   Ie: 3+5+6+7 = 21/6 = 3
 
-    for (; idx < size - 20; idx++) {
+    for (size_t k = 0; k < n; k++, s->pos++) {
 
         // threshold current value
-        dest[idx] = (dest[idx] < signalprop.mean) ? 0 : 1;
+        uint8_t level = (samples[k] < s->threshold) ? 0 : 1;
+
+        // Need to threshold first sample
+        if (s->started == false) {
+            s->started = true;
+            s->level = level;
+            s->last_transition = s->pos;
+            continue;
+        }
+
+        size_t idx = s->pos;
 
         // Check for 0->1 transition
-        if (dest[idx - 1] < dest[idx]) {
-            preLastSample = LastSample;
-            LastSample = currSample;
-            currSample = idx - last_transition;
+        if (s->level < level) {
+            s->prelast_wave = s->last_wave;
+            s->last_wave = s->cur_wave;
+            s->cur_wave = idx - s->last_transition;
+
+            size_t currSample = s->cur_wave;
+            size_t LastSample = s->last_wave;
+            size_t preLastSample = s->prelast_wave;
+
             if (currSample < (fclow - 2)) {         //0-5 = garbage noise (or 0-3)
                 //do nothing with extra garbage
             } else if (currSample < (fchigh - 1)) {         //6-8 = 8 sample waves  (or 3-6 = 5)
                 //correct previous 9 wave surrounded by 8 waves (or 6 surrounded by 5)
-                if (numBits > 1 && LastSample > (fchigh - 2) && (preLastSample < (fchigh - 1))) {
-                    dest[numBits - 1] = 1;
+                if (s->waves > 1 && LastSample > (fchigh - 2) && (preLastSample < (fchigh - 1))) {
+                    s->pending[s->pending_len - 1] = 1;
                 }
-                dest[numBits++] = 1;
-
+                fsk_stream_wave(s, 1);
 
-                if (numBits > 0 && *startIdx == 0)
-                    *startIdx = idx - fclow;
+                if (s->wave_start == 0)
+                    s->wave_start = idx - fclow;
 
-            } else if (currSample > (fchigh + 1) && numBits < 3) { //12 + and first two bit = unusable garbage
+            } else if (currSample > (fchigh + 1) && s->waves < 3) { //12 + and first two bit = unusable garbage
                 //do nothing with beginning garbage and reset..  should be rare..
-                numBits = 0;
+                s->waves = 0;
+                s->pending_len = 0;
             } else if (currSample == (fclow + 1) && LastSample == (fclow - 1)) { // had a 7 then a 9 should be two 8's (or 4 then a 6 should be two 5's)
-                dest[numBits++] = 1;
-                if (numBits > 0 && *startIdx == 0) {
-                    *startIdx = idx - fclow;
+                fsk_stream_wave(s, 1);
+                if (s->wave_start == 0) {
+                    s->wave_start = idx - fclow;
                 }
             } else {                                        //9+ = 10 sample waves (or 6+ = 7)
-                dest[numBits++] = 0;
-                if (numBits > 0 && *startIdx == 0) {
-                    *startIdx = idx - fchigh;
+                fsk_stream_wave(s, 0);
+                if (s->wave_start == 0) {
+                    s->wave_start = idx - fchigh;
                 }
             }
-            last_transition = idx;
+            s->last_transition = idx;
+
+            fsk_stream_commit(s, false, out, out_len, &outpos);
         }
+        s->level = level;
     }
-    return numBits; //Actually, it returns the number of bytes, but each byte represents a bit: 1 or 0
+    return outpos;
 }
 
-// translate 11111100000 to 10
-//rfLen = clock, fchigh = larger field clock, fclow = smaller field clock
-static size_t aggregate_bits(uint8_t *dest, size_t size, uint8_t clk, uint8_t invert, uint8_t fchigh, uint8_t fclow, int *startIdx) {
-
-    uint8_t lastval = dest[0];
-    size_t i = 0;
-    size_t numBits = 0;
-    uint32_t n = 1;
-    uint8_t hclk = clk / 2;
-
-    for (i = 1; i < size; i++) {
-        n++;
-        if (dest[i] == lastval) continue; //skip until we hit a transition
-
-        //find out how many bits (n) we collected (use 1/2 clk tolerance)
-
-        if (dest[i - 1] == 1)
-            //if lastval was 1, we have a 1->0 crossing
-            n = (n * fclow + hclk) / clk;
-        else
-            // 0->1 crossing
-            n = (n * fchigh + hclk) / clk;
-
-        if (n == 0)
-            n = 1;
-
-        //first transition - save startidx
-        if (numBits == 0) {
-            if (lastval == 1) {  //high to low
-                *startIdx += (fclow * i) - (n * clk);
-                if (g_debugMode == 2) prnt("DEBUG (aggregate_bits) FSK startIdx %i, fclow*idx %zu, n*clk %u", *startIdx, fclow * i, n * clk);
-            } else {
-                *startIdx += (fchigh * i) - (n * clk);
-                if (g_debugMode == 2) prnt("DEBUG (aggregate_bits) FSK startIdx %i, fchigh*idx %zu, n*clk %u", *startIdx, fchigh * i, n * clk);
-            }
-        }
-
-        //add to our destination the bits we collected
-        memset(dest + numBits, dest[i - 1] ^ invert, n);
-
-        numBits += n;
-        n = 0;
-        lastval = dest[i];
-
-    }//end for
+size_t fsk_stream_finish(fsk_stream_t *s, uint8_t *out, size_t out_len) {
+    size_t outpos = 0;
+    fsk_stream_commit(s, true, out, out_len, &outpos);
 
     // if valid extra bits at the end were all the same frequency - add them in
-    if (n > clk / fchigh) {
-        if (dest[i - 2] == 1) {
-            n = (n * fclow + clk / 2) / clk;
+    uint32_t n = s->agg_n;
+    uint8_t clk = s->clk;
+    if (s->agg_waves > 1 && n > clk / s->fchigh) {
+        if (s->agg_prev2 == 1) {
+            n = (n * s->fclow + clk / 2) / clk;
         } else {
-            n = (n * fchigh + clk / 2) / clk;
+            n = (n * s->fchigh + clk / 2) / clk;
         }
-        memset(dest + numBits, dest[i - 1] ^ invert, n);
-        numBits += n;
+        fsk_stream_emit(s, s->agg_prev ^ s->invert, n, out, out_len, &outpos);
         if (g_debugMode == 2) prnt("DEBUG (aggregate_bits) extra bits in the end");
     }
-    return numBits;
+    s->agg_n = 0;
+    return outpos;
+}
+
+int fsk_stream_start_idx(const fsk_stream_t *s) {
+    return s->wave_start + s->agg_start;
 }
 
 // full fsk demod from GraphBuffer wave to decoded 1s and 0s (no mandemod)
 size_t fskdemod(uint8_t *dest, size_t size, uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, int *start_idx) {
     if (signalprop.isnoise) return 0;
-    // FSK demodulator
-    size = fsk_wave_demod(dest, size, fchigh, fclow, start_idx);
-    if (g_debugMode == 2) prnt("DEBUG (fskdemod) got %zu bits", size);
-    size = aggregate_bits(dest, size, rfLen, invert, fchigh, fclow, start_idx);
-    if (g_debugMode == 2) prnt("DEBUG (fskdemod) got %zu bits", size);
-    return size;
+
+    if (size < 1024) return 0;   // not enough samples
+
+    if (fchigh == 0) fchigh = 10;
+
+    //find start of modulating data in trace
+    size_t idx = findModStart(dest, size, fchigh);
+
+    // the last 20 samples are left out
+    size_t n = (idx < size - 20) ? (size - 20) - idx : 1;
+
+    // decoded bits never overtake the samples, so dest is decoded in place
+    fsk_stream_t s;
+    fsk_stream_init(&s, rfLen, invert, fchigh, fclow, signalprop.mean, idx);
+    s.wave_start = *start_idx;
+
+    size_t bits = fsk_stream_push(&s, dest + idx, n, dest, size);
+    bits += fsk_stream_finish(&s, dest + bits, size - bits);
+    if (g_debugMode == 2) prnt("DEBUG (fskdemod) got %zu waves, %zu bits", s.waves, bits);
+
+    *start_idx = fsk_stream_start_idx(&s);
+    return bits;
 }
 
 // convert psk1 demod to psk2 demod
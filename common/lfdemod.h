@@ -58,6 +58,17 @@ int BiphaseRawDecode(uint8_t *bits, size_t *size, int *offset, int invert);
 int bits_to_array(const uint8_t *bits, size_t size, uint8_t *dest);
 uint32_t bytebits_to_byte(uint8_t *src, size_t numbits);
 uint32_t bytebits_to_byteLSBF(uint8_t *src, size_t numbits);
+
+// Packed bitstreams, msb first.  Bit i sits in bit (7 - i % 8) of byte i / 8,  the layout bits_to_array() gives.
+// The demod buffers keep one bit per byte, since they also carry error markers (7) from the demods.
+// packs n 0/1 bytes into dest,  returns n,  or the index of the first byte that is no bit
+size_t bitpack(const uint8_t *bits, size_t n, uint8_t *dest);
+// n bits starting at bit idx back to one bit per byte
+void bitunpack(const uint8_t *src, size_t idx, size_t n, uint8_t *bits);
+// n <= 32 bits starting at bit idx, same result as bytebits_to_byte()
+uint32_t bitpack_get(const uint8_t *src, size_t idx, uint8_t n);
+// 1 when the n bits starting at bit idx hold an odd number of ones
+uint8_t bitpack_parity(const uint8_t *src, size_t idx, size_t n);
 uint16_t countFC(const uint8_t *bits, size_t size, bool fskAdj);
 int DetectASKClock(uint8_t *dest, size_t size, int *clock, int maxErr);
 bool DetectCleanAskWave(const uint8_t *dest, size_t size, uint8_t high, uint8_t low);
@@ -68,6 +79,45 @@ int DetectStrongAskClock(uint8_t *dest, size_t size, int high, int low, int *clo
 int DetectStrongNRZClk(const uint8_t *dest, size_t size, int peak, int low, bool *strong);
 bool DetectST(uint8_t *buffer, size_t *size, int *foundclock, size_t *ststart, size_t *stend);
 size_t fskdemod(uint8_t *dest, size_t size, uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, int *start_idx);
+
+// Streaming FSK demodulation, samples go in as they arrive and decoded bits come out
+// as soon as they are final.  Same decoder as fskdemod(), which runs on top of it.
+typedef struct {
+    uint8_t clk;
+    uint8_t invert;
+    uint8_t fchigh;
+    uint8_t fclow;
+    int threshold;          // sample >= threshold is high, usually the signal mean
+    // wave stage, cycle widths between 0->1 transitions to 1 (short) / 0 (long) waves
+    bool started;
+    uint8_t level;
+    size_t pos;             // sample index of the next pushed sample
+    size_t last_transition;
+    size_t cur_wave;
+    size_t last_wave;
+    size_t prelast_wave;
+    size_t waves;           // waves decoded so far
+    uint8_t pending[3];     // last waves, that can still be corrected or dropped
+    uint8_t pending_len;
+    int wave_start;
+    // aggregate stage, runs of waves to bits
+    size_t agg_waves;
+    uint8_t agg_last;
+    uint8_t agg_prev;
+    uint8_t agg_prev2;
+    uint32_t agg_n;
+    int agg_start;
+    size_t bits;            // bits decoded so far
+} fsk_stream_t;
+
+// first_pos is the sample index of the first pushed sample, start indexes are relative to it
+void fsk_stream_init(fsk_stream_t *s, uint8_t rfLen, uint8_t invert, uint8_t fchigh, uint8_t fclow, int threshold, size_t first_pos);
+// returns the number of bits written to out,  at most out_len
+size_t fsk_stream_push(fsk_stream_t *s, const uint8_t *samples, size_t n, uint8_t *out, size_t out_len);
+// flushes the bits held back at the end of the signal
+size_t fsk_stream_finish(fsk_stream_t *s, uint8_t *out, size_t out_len);
+// sample index where the first decoded bit starts
+int fsk_stream_start_idx(const fsk_stream_t *s);
 // void getHiLo(uint8_t *bits, size_t size, int *high, int *low, uint8_t fuzzHi, uint8_t fuzzLo);
 void getHiLo(int *high, int *low, uint8_t fuzzHi, uint8_t fuzzLo);
 uint32_t manchesterEncode2Bytes(uint16_t datain);
@@ -78,6 +128,17 @@ int nrzRawDemod(uint8_t *dest, size_t *size, int *clk, const int *invert, int *s
 bool parityTest(uint32_t bits, uint8_t bitLen, uint8_t pType);
 bool preambleSearch(uint8_t *bits, uint8_t *preamble, size_t pLen, size_t *size, size_t *startIdx);
 bool preambleSearchEx(uint8_t *bits, uint8_t *preamble, size_t pLen, size_t *size, size_t *startIdx, bool findone);
+
+// one preamble of a preambleSearchMulti() call,  found / start / size as preambleSearch() would give them
+typedef struct {
+    const uint8_t *preamble;
+    size_t len;
+    bool found;
+    size_t start;
+    size_t size;
+} preamble_match_t;
+// searches several preambles in one pass over the same bitstream, returns true if any was found
+bool preambleSearchMulti(const uint8_t *bits, size_t size, preamble_match_t *m, size_t count);
 int pskRawDemod(uint8_t *dest, size_t *size, int *clock, int *invert);
 int pskRawDemod_ext(uint8_t *dest, size_t *size, int *clock, const int *invert, int *startIdx);
 void psk2TOpsk1(uint8_t *bits, size_t size);
@@ -57,6 +57,10 @@
  * Comment to disable the use of assembly code.
  */
 //#define MBEDTLS_HAVE_ASM
+// only where AES-NI can be used, see MBEDTLS_AESNI_C
+#if defined(__GNUC__) && (defined(__amd64__) || defined(__x86_64__))
+#define MBEDTLS_HAVE_ASM
+#endif
 
 /**
  * \def MBEDTLS_NO_UDBL_DIVISION
@@ -2275,6 +2279,10 @@
  * This modules adds support for the AES-NI instructions on x86-64
  */
 //#define MBEDTLS_AESNI_C
+// runtime detected, falls back to the C implementation on CPUs without AES-NI
+#if defined(__GNUC__) && (defined(__amd64__) || defined(__x86_64__))
+#define MBEDTLS_AESNI_C
+#endif
 
 /**
  * \def MBEDTLS_AES_C
@@ -0,0 +1,174 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// MIFARE Classic nested / static nested key recovery from two encrypted nonces
+//-----------------------------------------------------------------------------
+#include "nestedrecover.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "crapto1/crapto1.h"
+#include "bucketsort.h"
+
+#define NESTED_16BITS_MASK  0x00ff000000ff0000
+
+typedef struct {
+    struct Crypto1State *head;
+    uint32_t len;
+    uint32_t in;        // uid ^ nt_enc
+    uint32_t ks1;
+    int threads;
+} nested_statelist_t;
+
+static int compare_uint64(const void *a, const void *b) {
+    if (*(uint64_t *)b == *(uint64_t *)a) return 0;
+    if (*(uint64_t *)b < * (uint64_t *)a) return 1;
+    return -1;
+}
+
+// Compare 16 Bits out of cryptostate,  descending
+static int compare16Bits(const void *a, const void *b) {
+    if ((*(uint64_t *)b & NESTED_16BITS_MASK) == (*(uint64_t *)a & NESTED_16BITS_MASK)) return 0;
+    if ((*(uint64_t *)b & NESTED_16BITS_MASK) > (*(uint64_t *)a & NESTED_16BITS_MASK)) return 1;
+    return -1;
+}
+
+static void sort_states(struct Crypto1State *sl, uint32_t len, uint64_t mask, bool descending) {
+    if (radix_sort_u64((uint64_t *)sl, len, mask, descending)) {
+        return;
+    }
+    qsort(sl, len, sizeof(uint64_t), descending ? compare16Bits : compare_uint64);
+}
+
+// wrapper function for multi-threaded lfsr_recovery32
+static void
+#ifdef __has_attribute
+#if __has_attribute(force_align_arg_pointer)
+__attribute__((force_align_arg_pointer))
+#endif
+#endif
+*nested_worker_thread(void *arg) {
+    nested_statelist_t *sl = arg;
+
+    sl->head = lfsr_recovery32_mt(sl->ks1, sl->in, sl->threads);
+    if (sl->head == NULL) {
+        sl->len = 0;
+        return NULL;
+    }
+
+    struct Crypto1State *p = sl->head;
+    while (p->odd | p->even) p++;
+    sl->len = p - sl->head;
+
+    // same order as the 16 bits compare,  descending
+    sort_states(sl->head, sl->len, NESTED_16BITS_MASK, true);
+    return NULL;
+}
+
+// roll back the states of two runs sharing the same 16 bits,  compacted to the front of the lists
+static uint32_t rollback_run(struct Crypto1State *sl, uint32_t from, uint32_t to, uint32_t dst, uint32_t in) {
+    for (uint32_t i = from; i < to; i++) {
+        sl[dst] = sl[i];
+        lfsr_rollback_word(&sl[dst], in, 0);
+        dst++;
+    }
+    return dst;
+}
+
+uint32_t nested_recover_keys(uint32_t uid, const uint32_t nt_enc[2], const uint32_t ks1[2], int threads, uint64_t **keys) {
+
+    *keys = NULL;
+
+    nested_statelist_t lists[2];
+    for (uint8_t i = 0; i < 2; i++) {
+        lists[i].head = NULL;
+        lists[i].len = 0;
+        lists[i].in = nt_enc[i] ^ uid;
+        lists[i].ks1 = ks1[i];
+        // two of these run side by side
+        lists[i].threads = MAX(1, threads / 2);
+    }
+
+    // second list on its own thread,  first one on ours
+    pthread_t thread_id;
+    bool threaded = (pthread_create(&thread_id, NULL, nested_worker_thread, &lists[1]) == 0);
+    nested_worker_thread(&lists[0]);
+    if (threaded) {
+        pthread_join(thread_id, NULL);
+    } else {
+        nested_worker_thread(&lists[1]);
+    }
+
+    uint32_t n = 0;
+    if (lists[0].head == NULL || lists[1].head == NULL) {
+        goto out;
+    }
+
+    // the first 16 Bits of the cryptostate already contain part of our key.
+    // Keep the runs both lists have in common and roll back their cryptostate
+    uint64_t *l0 = (uint64_t *)lists[0].head;
+    uint64_t *l1 = (uint64_t *)lists[1].head;
+    uint32_t i0 = 0, i1 = 0, n0 = 0, n1 = 0;
+
+    while (i0 < lists[0].len && i1 < lists[1].len) {
+        uint64_t v0 = l0[i0] & NESTED_16BITS_MASK;
+        uint64_t v1 = l1[i1] & NESTED_16BITS_MASK;
+
+        if (v0 > v1) {
+            i0++;
+            continue;
+        }
+        if (v0 < v1) {
+            i1++;
+            continue;
+        }
+
+        uint32_t e0 = i0, e1 = i1;
+        while (e0 < lists[0].len && (l0[e0] & NESTED_16BITS_MASK) == v0) e0++;
+        while (e1 < lists[1].len && (l1[e1] & NESTED_16BITS_MASK) == v0) e1++;
+
+        n0 = rollback_run(lists[0].head, i0, e0, n0, lists[0].in);
+        n1 = rollback_run(lists[1].head, i1, e1, n1, lists[1].in);
+        i0 = e0;
+        i1 = e1;
+    }
+
+    // the statelists now contain possible keys. The key we are searching for must be in the
+    // intersection of both lists
+    sort_states(lists[0].head, n0, UINT64_MAX, false);
+    sort_states(lists[1].head, n1, UINT64_MAX, false);
+    n = intersect_sorted_u64(l0, n0, l1, n1);
+    if (n == 0) {
+        goto out;
+    }
+
+    // the key list replaces the first statelist
+    for (uint32_t i = 0; i < n; i++) {
+        uint64_t key64 = 0;
+        crypto1_get_lfsr(&lists[0].head[i], &key64);
+        l0[i] = key64;
+    }
+
+    *keys = realloc(l0, n * sizeof(uint64_t));
+    if (*keys == NULL) {
+        *keys = l0;
+    }
+    lists[0].head = NULL;
+
+out:
+    free(lists[0].head);
+    free(lists[1].head);
+    return n;
+}
@@ -0,0 +1,29 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// MIFARE Classic nested / static nested key recovery from two encrypted nonces,
+// shared by the client and tools/mfkey/staticnested
+//-----------------------------------------------------------------------------
+#ifndef NESTEDRECOVER_H__
+#define NESTEDRECOVER_H__
+
+#include "common.h"
+
+// Key candidates of one key from two encrypted nonces (nt_enc, ks1) given by the same card.
+// Both lfsr recoveries run side by side and share `threads` worker threads.
+// Returns the number of candidates. *keys is allocated (NULL if none) and has to be freed by the caller.
+uint32_t nested_recover_keys(uint32_t uid, const uint32_t nt_enc[2], const uint32_t ks1[2], int threads, uint64_t **keys);
+
+#endif
@@ -0,0 +1,203 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Splitting the search space of the offline cracking tools across machines
+//-----------------------------------------------------------------------------
+#include "shard.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+static bool parse_u64(const char *s, char **end, uint64_t *out) {
+    if (s == NULL || *s == '\0' || *s == '-') {
+        return false;
+    }
+    *out = strtoull(s, end, 0);
+    return (*end != s);
+}
+
+bool shard_parse_args(shard_t *s, const char *tool, int *argc, char *argv[]) {
+
+    memset(s, 0, sizeof(shard_t));
+    s->tool = tool;
+
+    int n = 1;
+    for (int i = 1; i < *argc; i++) {
+
+        const char *opt = argv[i];
+        bool known = (strcmp(opt, "--range") == 0) || (strcmp(opt, "--shard") == 0) || (strcmp(opt, "--progress") == 0);
+        if (known == false) {
+            argv[n++] = argv[i];
+            continue;
+        }
+
+        if (i + 1 >= *argc) {
+            fprintf(stderr, "%s needs a value\n", opt);
+            return false;
+        }
+
+        const char *val = argv[++i];
+        char *e = NULL;
+
+        if (strcmp(opt, "--range") == 0) {
+            if (parse_u64(val, &e, &s->range_start) == false || *e != ':' ||
+                    parse_u64(e + 1, &e, &s->range_end) == false || *e != '\0' ||
+                    s->range_end <= s->range_start) {
+                fprintf(stderr, "invalid --range %s, expected <start>:<end> with start < end\n", val);
+                return false;
+            }
+            s->has_range = true;
+
+        } else if (strcmp(opt, "--shard") == 0) {
+            uint64_t a = 0, b = 0;
+            if (parse_u64(val, &e, &a) == false || *e != '/' ||
+                    parse_u64(e + 1, &e, &b) == false || *e != '\0' ||
+                    a == 0 || b == 0 || a > b || b > UINT32_MAX) {
+                fprintf(stderr, "invalid --shard %s, expected <i>/<n> with 1 <= i <= n\n", val);
+                return false;
+            }
+            s->shard = (uint32_t)a;
+            s->shards = (uint32_t)b;
+
+        } else {
+            s->progress_fn = val;
+        }
+    }
+
+    *argc = n;
+    argv[n] = NULL;
+    return true;
+}
+
+// returns the done watermark of a progress file written for the same slice, or start
+static uint64_t shard_resume(const shard_t *s) {
+
+    if (s->progress_fn == NULL) {
+        return s->start;
+    }
+
+    FILE *f = fopen(s->progress_fn, "r");
+    if (f == NULL) {
+        return s->start;
+    }
+
+    char line[256];
+    char tool[64] = {0};
+    uint64_t rs = 0, re = 0, done = 0;
+    bool has_range = false, has_done = false;
+
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, "tool=%63s", tool) == 1) {
+            continue;
+        }
+        if (sscanf(line, "range=%" SCNu64 ":%" SCNu64, &rs, &re) == 2) {
+            has_range = true;
+            continue;
+        }
+        if (sscanf(line, "done=%" SCNu64, &done) == 1) {
+            has_done = true;
+        }
+    }
+    fclose(f);
+
+    if (has_range == false || has_done == false || strcmp(tool, s->tool) ||
+            rs != s->start || re != s->end || done < s->start || done > s->end) {
+        fprintf(stderr, "ignoring progress file %s, it belongs to another job\n", s->progress_fn);
+        return s->start;
+    }
+
+    return done;
+}
+
+uint64_t shard_apply(shard_t *s, uint64_t start, uint64_t end) {
+
+    if (s->has_range) {
+        start = (s->range_start > start) ? s->range_start : start;
+        end = (s->range_end < end) ? s->range_end : end;
+        if (end < start) {
+            end = start;
+        }
+    }
+
+    if (s->shards > 1) {
+        // spread the remainder over the first shards, so the slices differ by one at most
+        uint64_t total = end - start;
+        uint64_t chunk = total / s->shards;
+        uint64_t rem = total % s->shards;
+        uint64_t i = s->shard - 1;
+        uint64_t first = start + (i * chunk) + ((i < rem) ? i : rem);
+        end = first + chunk + ((i < rem) ? 1 : 0);
+        start = first;
+    }
+
+    s->start = start;
+    s->end = end;
+
+    uint64_t pos = shard_resume(s);
+    if (s->has_range || s->shards > 1 || pos != s->start) {
+        printf("Search slice........... %" PRIu64 ":%" PRIu64, s->start, s->end);
+        if (s->shards) {
+            printf("  ( shard %u/%u )", s->shard, s->shards);
+        }
+        if (pos != s->start) {
+            printf("  resuming at %" PRIu64, pos);
+        }
+        printf("\n");
+    }
+    return pos;
+}
+
+void shard_progress(const shard_t *s, uint64_t done, const char *found) {
+
+    if (s->progress_fn == NULL) {
+        return;
+    }
+
+    // write aside and rename, so a killed run never leaves a torn file behind
+    char tmp[1024];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", s->progress_fn);
+
+    FILE *f = fopen(tmp, "w");
+    if (f == NULL) {
+        fprintf(stderr, "failed to write progress file %s\n", tmp);
+        return;
+    }
+
+    const char *status = (found) ? "found" : ((done >= s->end) ? "exhausted" : "running");
+
+    fprintf(f, "tool=%s\n", s->tool);
+    fprintf(f, "range=%" PRIu64 ":%" PRIu64 "\n", s->start, s->end);
+    fprintf(f, "shard=%u/%u\n", (s->shards) ? s->shard : 1, (s->shards) ? s->shards : 1);
+    fprintf(f, "done=%" PRIu64 "\n", (done > s->end) ? s->end : done);
+    fprintf(f, "status=%s\n", status);
+    fprintf(f, "found=%s\n", (found) ? found : "");
+    fclose(f);
+
+#if defined(_WIN32)
+    remove(s->progress_fn);
+#endif
+    if (rename(tmp, s->progress_fn) != 0) {
+        fprintf(stderr, "failed to write progress file %s\n", s->progress_fn);
+    }
+}
+
+void shard_usage(void) {
+    printf("options:\n");
+    printf("    --range <start>:<end>   only search [start, end)\n");
+    printf("    --shard <i>/<n>         search the i-th of n slices, e.g. one per machine\n");
+    printf("    --progress <file>       write progress to <file>, a rerun resumes from it\n");
+}
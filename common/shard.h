@@ -0,0 +1,76 @@
+//-----------------------------------------------------------------------------
+// Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// See LICENSE.txt for the text of the license.
+//-----------------------------------------------------------------------------
+// Splitting the search space of the offline cracking tools across machines
+//
+//   --range <start>:<end>   only search [start, end) of the tool's index space
+//   --shard <i>/<n>         search the i-th of n equal slices (1 based)
+//   --progress <file>       keep a progress file, a rerun resumes from it
+//
+// The progress file is plain key=value lines, so the files of all shards of one
+// job can be merged with cat / grep:
+//
+//   tool=mfd_aes_brute
+//   range=1629394800:1631200000
+//   shard=2/4
+//   done=1630747200
+//   status=running | exhausted | found
+//   found=<tool specific result>
+//
+// done is a watermark, every index below it has been checked.
+//-----------------------------------------------------------------------------
+
+#ifndef SHARD_H__
+#define SHARD_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    const char *tool;
+    bool has_range;
+    uint64_t range_start;   // --range, or the tool's full space
+    uint64_t range_end;
+    uint32_t shard;         // 1 based, 0 when not sharded
+    uint32_t shards;
+    uint64_t start;         // slice this process searches, set by shard_apply()
+    uint64_t end;
+    const char *progress_fn;
+} shard_t;
+
+// Parses --range / --shard / --progress and removes them from argv,
+// so the tools keep their positional arguments.  Returns false on a syntax error.
+bool shard_parse_args(shard_t *s, const char *tool, int *argc, char *argv[]);
+
+// Narrows [start, end) to --range and then to this shard.
+// Returns the position to start at, which is later than s->start when the
+// progress file of an earlier run of this same slice says so.
+uint64_t shard_apply(shard_t *s, uint64_t start, uint64_t end);
+
+// Rewrites the progress file, if any.  found is NULL while nothing was found.
+void shard_progress(const shard_t *s, uint64_t done, const char *found);
+
+// Prints the usage lines for the three options
+void shard_usage(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -65,6 +65,67 @@ bool Flash_ReadID_90(flash_device_type_90_t *result) {
     return true;
 }
 
+//-----------------------------------------------------------------------------
+// PDC (DMA) transfers
+// The SPI is in fixed peripheral mode with CSAAT, so chip select stays low
+// across the DMA part. The PDC can't set LASTXFER on the final byte, callers
+// send it with FlashSendLastByte() to release the chip select.
+//-----------------------------------------------------------------------------
+
+// Start clocking len bytes from flash into out, returns at once.
+// out is also the transmit buffer, filled with 0xFF dummy bytes. The transmitter
+// is always ahead of the receiver so a byte is sent before it is overwritten.
+void Flash_ReadDMAStart(uint8_t *out, uint16_t len) {
+    memset(out, 0xFF, len);
+
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_RXTDIS | AT91C_PDC_TXTDIS;
+    AT91C_BASE_PDC_SPI->PDC_RPR = (uint32_t) out;
+    AT91C_BASE_PDC_SPI->PDC_RCR = len;
+    AT91C_BASE_PDC_SPI->PDC_TPR = (uint32_t) out;
+    AT91C_BASE_PDC_SPI->PDC_TCR = len;
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_RXTEN | AT91C_PDC_TXTEN;
+}
+
+// Wait for the running read DMA to finish
+void Flash_DMAWait(void) {
+    while ((AT91C_BASE_SPI->SPI_SR & AT91C_SPI_ENDRX) == 0) {};
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_RXTDIS | AT91C_PDC_TXTDIS;
+}
+
+// Send len bytes with the PDC, received bytes are dropped
+static void Flash_WriteDMA(const uint8_t *in, uint16_t len) {
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_RXTDIS | AT91C_PDC_TXTDIS;
+    AT91C_BASE_PDC_SPI->PDC_TPR = (uint32_t) in;
+    AT91C_BASE_PDC_SPI->PDC_TCR = len;
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_TXTEN;
+
+    while ((AT91C_BASE_SPI->SPI_SR & AT91C_SPI_ENDTX) == 0) {};
+    while ((AT91C_BASE_SPI->SPI_SR & AT91C_SPI_TXEMPTY) == 0) {};
+    AT91C_BASE_PDC_SPI->PDC_PTCR = AT91C_PDC_TXTDIS;
+
+    // drop the last received byte, reading SR above cleared the overrun flag
+    if (AT91C_BASE_SPI->SPI_RDR == 0) {};
+}
+
+// Continuous read, chip select stays low until Flash_ReadEnd().
+// Used with Flash_ReadDMAStart / Flash_DMAWait to stream large areas.
+bool Flash_ReadBegin(uint32_t address) {
+
+    if (Flash_CheckBusy(BUSY_TIMEOUT)) return false;
+
+    FlashSendByte((FASTFLASH) ? FASTREAD : READDATA);
+    Flash_TransferAdresse(address);
+
+    if (FASTFLASH) {
+        FlashSendByte(DUMMYBYTE);
+    }
+    return true;
+}
+
+void Flash_ReadEnd(void) {
+    FlashSendLastByte(0xFF);
+}
+
 uint16_t Flash_ReadData(uint32_t address, uint8_t *out, uint16_t len) {
 
     if (!FlashInit()) return 0;
@@ -81,11 +142,11 @@ uint16_t Flash_ReadData(uint32_t address, uint8_t *out, uint16_t len) {
         FlashSendByte(DUMMYBYTE);
     }
 
-    uint16_t i = 0;
-    for (; i < (len - 1); i++)
-        out[i] = FlashSendByte(0xFF);
-
-    out[i] = FlashSendLastByte(0xFF);
+    if (len > 1) {
+        Flash_ReadDMAStart(out, len - 1);
+        Flash_DMAWait();
+    }
+    out[len - 1] = FlashSendLastByte(0xFF);
     FlashStop();
     return len;
 }
@@ -111,11 +172,11 @@ uint16_t Flash_ReadDataCont(uint32_t address, uint8_t *out, uint16_t len) {
         FlashSendByte(DUMMYBYTE);
     }
 
-    uint16_t i = 0;
-    for (; i < (len - 1); i++)
-        out[i] = FlashSendByte(0xFF);
-
-    out[i] = FlashSendLastByte(0xFF);
+    if (len > 1) {
+        Flash_ReadDMAStart(out, len - 1);
+        Flash_DMAWait();
+    }
+    out[len - 1] = FlashSendLastByte(0xFF);
     return len;
 }
 
@@ -154,11 +215,10 @@ uint16_t Flash_WriteData(uint32_t address, uint8_t *in, uint16_t len) {
     FlashSendByte((address >> 8) & 0xFF);
     FlashSendByte((address >> 0) & 0xFF);
 
-    uint16_t i = 0;
-    for (; i < (len - 1); i++)
-        FlashSendByte(in[i]);
-
-    FlashSendLastByte(in[i]);
+    if (len > 1) {
+        Flash_WriteDMA(in, len - 1);
+    }
+    FlashSendLastByte(in[len - 1]);
 
     FlashStop();
     return len;
@@ -187,11 +247,10 @@ uint16_t Flash_WriteDataCont(uint32_t address, uint8_t *in, uint16_t len) {
     FlashSendByte((address >> 8) & 0xFF);
     FlashSendByte((address >> 0) & 0xFF);
 
-    uint16_t i = 0;
-    for (; i < (len - 1); i++)
-        FlashSendByte(in[i]);
-
-    FlashSendLastByte(in[i]);
+    if (len > 1) {
+        Flash_WriteDMA(in, len - 1);
+    }
+    FlashSendLastByte(in[len - 1]);
     return len;
 }
 
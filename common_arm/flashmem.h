@@ -132,6 +132,11 @@ typedef struct {
 } flash_device_type_90_t; // to differentiate from JDEC ID via cmd 9F
 bool Flash_ReadID_90(flash_device_type_90_t *result);
 
+bool Flash_ReadBegin(uint32_t address);
+void Flash_ReadEnd(void);
+void Flash_ReadDMAStart(uint8_t *out, uint16_t len);
+void Flash_DMAWait(void);
+
 uint16_t Flash_ReadData(uint32_t address, uint8_t *out, uint16_t len);
 uint16_t Flash_ReadDataCont(uint32_t address, uint8_t *out, uint16_t len);
 uint16_t Flash_Write(uint32_t address, uint8_t *in, uint16_t len);
@@ -225,6 +225,21 @@ void WaitMS(uint32_t ms) {
     WaitTicks((ms & 0x1FFFFF) * 1500);
 }
 
+//  -------------------------------------------------------------------------
+//  Free running 32bit counter for profiling, MCK / 16 = 3MHz, wraps after ~23min
+//  Uses the Periodic Interval Timer, so it doesn't fight with the TC based
+//  timers above which are reconfigured by the protocol code.
+//  With the max period the image register (PICNT:CPIV) counts through all
+//  32 bits and reading it doesn't clear PICNT.
+//  -------------------------------------------------------------------------
+void StartCountPerf(void) {
+    AT91C_BASE_PITC->PITC_PIMR = AT91C_PITC_PITEN | AT91C_PITC_PIV;
+}
+
+uint32_t RAMFUNC GetCountPerf(void) {
+    return AT91C_BASE_PITC->PITC_PIIR;
+}
+
 #endif // #ifndef AS_BOOTROM
 
 //  -------------------------------------------------------------------------
@@ -58,6 +58,9 @@ uint32_t RAMFUNC GetCountSspClkDelta(uint32_t start);
 
 void WaitMS(uint32_t ms);
 
+void StartCountPerf(void);
+uint32_t RAMFUNC GetCountPerf(void);
+
 #endif // #ifndef AS_BOOTROM
 
 
@@ -112,6 +112,17 @@ AT91SAM7S256  USB Device Port
 #define SET_CONTROL_LINE_STATE        0x2221
 
 static bool isAsyncRequestFinished = false;
+
+#ifndef AS_BOOTROM
+// non blocking bulk IN transfer, see usb_write_async()
+static struct {
+    const uint8_t *data;
+    size_t remaining;
+    bool active;        // until the last packet is acknowledged
+    bool staged;        // other bank filled, TXPKTRDY not set yet
+    bool zlp;           // transfer ended on a full packet, a ZLP is owed
+} usb_async;
+#endif
 static AT91PS_UDP pUdp = AT91C_BASE_UDP;
 static uint8_t btConfiguration = 0;
 static uint8_t btConnection    = 0;
@@ -822,6 +833,16 @@ int usb_write(const uint8_t *data, const size_t len) {
         return PM3_EIO;
     }
 
+#ifndef AS_BOOTROM
+    // keep frames in order
+    if (usb_write_async_busy()) {
+        int res = usb_write_async_flush();
+        if (res != PM3_SUCCESS) {
+            return res;
+        }
+    }
+#endif
+
     // can we write?
     if ((pUdp->UDP_CSR[AT91C_EP_IN] & AT91C_UDP_TXPKTRDY) != 0) {
         return PM3_EIO;
@@ -886,6 +907,120 @@ int usb_write(const uint8_t *data, const size_t len) {
     return PM3_SUCCESS;
 }
 
+#ifndef AS_BOOTROM
+static void usb_async_fill(void) {
+    uint32_t cpt = MIN(usb_async.remaining, AT91C_USB_EP_IN_SIZE);
+    usb_async.remaining -= cpt;
+    while (cpt--) {
+        pUdp->UDP_FDR[AT91C_EP_IN] = *usb_async.data++;
+    }
+}
+
+/*
+ *----------------------------------------------------------------------------
+ * \fn     usb_write_async
+ * \brief  Queue a bulk IN transfer and return at once
+ * \return PM3_EIO if USB is invalid, PM3_EOPABORTED if a transfer is still queued
+ *
+ * Uses both banks of the IN endpoint: while one packet is on the bus the
+ * next one is loaded. The transfer advances in usb_write_async_poll(), the
+ * caller keeps data valid until usb_write_async_busy() returns false.
+ * usb_write() flushes a queued transfer first.
+ *
+ * Warning: don't mix with async_usb_write_start/pushByte/requestWrite/stop.
+ *----------------------------------------------------------------------------
+*/
+int usb_write_async(const uint8_t *data, const size_t len) {
+
+    if (len == 0) {
+        return PM3_EINVARG;
+    }
+
+    if (usb_check() == false) {
+        return PM3_EIO;
+    }
+
+    if (usb_write_async_busy()) {
+        return PM3_EOPABORTED;
+    }
+
+    usb_async.data = data;
+    usb_async.remaining = len;
+    usb_async.active = true;
+    usb_async.staged = false;
+    usb_async.zlp = ((len % AT91C_USB_EP_IN_SIZE) == 0);
+
+    usb_write_async_poll();
+    return PM3_SUCCESS;
+}
+
+/*
+ *----------------------------------------------------------------------------
+ * \fn     usb_write_async_poll
+ * \brief  Move a queued transfer along, never waits on the host
+ * \return true while the transfer isn't finished
+ *----------------------------------------------------------------------------
+*/
+bool usb_write_async_poll(void) {
+
+    if (usb_async.active == false) {
+        return false;
+    }
+
+    // one snapshot, TXCOMP is raised when TXPKTRDY drops
+    uint32_t csr = pUdp->UDP_CSR[AT91C_EP_IN];
+    if (csr & AT91C_UDP_TXCOMP) {
+        UDP_CLEAR_EP_FLAGS(AT91C_EP_IN, AT91C_UDP_TXCOMP);
+        while (pUdp->UDP_CSR[AT91C_EP_IN] & AT91C_UDP_TXCOMP) {};
+    }
+
+    // bank on the bus is done (or none was), hand over the next one
+    if ((csr & AT91C_UDP_TXPKTRDY) == 0) {
+        if (usb_async.staged) {
+            usb_async.staged = false;
+        } else if (usb_async.remaining) {
+            usb_async_fill();
+        } else if (usb_async.zlp) {
+            // zero length packet
+            usb_async.zlp = false;
+        } else {
+            // last packet acknowledged
+            usb_async.active = false;
+            return false;
+        }
+        UDP_SET_EP_FLAGS(AT91C_EP_IN, AT91C_UDP_TXPKTRDY);
+        while (!(pUdp->UDP_CSR[AT91C_EP_IN] & AT91C_UDP_TXPKTRDY)) {};
+    }
+
+    // one bank is queued, load the other one
+    if (usb_async.staged == false && usb_async.remaining) {
+        usb_async_fill();
+        usb_async.staged = true;
+    }
+
+    return true;
+}
+
+bool usb_write_async_busy(void) {
+    return usb_async.active;
+}
+
+// Blocks until the queued transfer is acknowledged by the host
+int usb_write_async_flush(void) {
+
+    while (usb_write_async_poll()) {
+        if (usb_check() == false) {
+            usb_async.active = false;
+            usb_async.remaining = 0;
+            usb_async.staged = false;
+            usb_async.zlp = false;
+            return PM3_EIO;
+        }
+    }
+    return PM3_SUCCESS;
+}
+#endif // AS_BOOTROM
+
 /*
  *----------------------------------------------------------------------------
  * \fn     async_usb_write_start
@@ -905,6 +1040,12 @@ int async_usb_write_start(void) {
         return PM3_EIO;
     }
 
+#ifndef AS_BOOTROM
+    if (usb_write_async_flush() != PM3_SUCCESS) {
+        return PM3_EIO;
+    }
+#endif
+
     while (pUdp->UDP_CSR[AT91C_EP_IN] & AT91C_UDP_TXPKTRDY) {
         if (usb_check() == false) {
             return PM3_EIO;
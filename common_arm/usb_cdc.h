@@ -35,6 +35,10 @@ uint16_t usb_available_length(void);
 bool usb_poll_validate_length(void);
 uint32_t usb_read(uint8_t *data, size_t len);
 int usb_write(const uint8_t *data, const size_t len);
+int usb_write_async(const uint8_t *data, const size_t len);
+bool usb_write_async_poll(void);
+bool usb_write_async_busy(void);
+int usb_write_async_flush(void);
 int async_usb_write_start(void);
 void async_usb_write_pushByte(uint8_t data);
 bool async_usb_write_requestWrite(void);
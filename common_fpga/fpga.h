@@ -32,6 +32,22 @@
 #define FPGA_RING_BUFFER_BYTES              (1024 * 30)
 #define FPGA_TRACE_SIZE                     3072
 
+// fpga_all.bit.z starts with an index, one entry per bitstream. Each bitstream is its own
+// LZ4 stream of [int length][block] chunks of FPGA_RING_BUFFER_BYTES, so it can be
+// decompressed without going through the others.
+#define FPGA_INDEX_MAGIC                    0x5A475046  // "FPGZ"
+typedef struct {
+    uint32_t offset;        // from the start of the file
+    uint32_t length;        // compressed
+    uint32_t size;          // uncompressed
+} fpga_index_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    fpga_index_entry_t entry[];
+} fpga_index_t;
+
 static const uint8_t bitparse_fixed_header[] = {0x00, 0x09, 0x0f, 0xf0, 0x0f, 0xf0, 0x0f, 0xf0, 0x0f, 0xf0, 0x00, 0x00, 0x01};
 extern const int g_fpga_bitstream_num;
 extern const char *const g_fpga_version_information[];
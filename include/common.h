@@ -46,6 +46,7 @@
 #define RESOURCES_SUBDIR     "resources" PATHSEP
 #define TRACES_SUBDIR        "traces" PATHSEP
 #define LOGS_SUBDIR          "logs" PATHSEP
+#define CACHE_SUBDIR         "cache" PATHSEP
 #define FIRMWARES_SUBDIR     "firmware" PATHSEP
 #define BOOTROM_SUBDIR       "bootrom" PATHSEP "obj" PATHSEP
 #define FULLIMAGE_SUBDIR     "armsrc" PATHSEP "obj" PATHSEP
@@ -94,6 +95,24 @@ extern bool g_tearoff_enabled;
 //#define RAMFUNC __attribute((long_call, section(".ramfunc")))
 #define RAMFUNC __attribute((long_call, section(".ramfunc"))) __attribute__((target("arm")))
 
+// Receive and sniff loops which only run from SRAM when the build asks for them,
+// make RAMFUNC_HOT="ISO14443a ISO15693". They take their size off BigBuf.
+#ifdef WITH_RAMFUNC_HOT_ISO14443a
+#define RAMFUNC_HOT_14A RAMFUNC
+#else
+#define RAMFUNC_HOT_14A
+#endif
+#ifdef WITH_RAMFUNC_HOT_ISO14443b
+#define RAMFUNC_HOT_14B RAMFUNC
+#else
+#define RAMFUNC_HOT_14B
+#endif
+#ifdef WITH_RAMFUNC_HOT_ISO15693
+#define RAMFUNC_HOT_15 RAMFUNC
+#else
+#define RAMFUNC_HOT_15
+#endif
+
 #ifndef ROTR
 # define ROTR(x,n) (((uintmax_t)(x) >> (n)) | ((uintmax_t)(x) << ((sizeof(x) * 8) - (n))))
 #endif
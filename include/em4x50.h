@@ -72,6 +72,24 @@ typedef struct {
     uint8_t byte[4];
 } PACKED em4x50_word_t;
 
+// lf em 4x50 chk, dictionary file in SPIFFS
+#define EM4X50_CHK_PROGRESS         0x01    // send progress replies with done == false
+#define EM4X50_CHK_DUMP             0x02    // read all words after a successful login
+
+typedef struct {
+    uint8_t filename[32];
+    uint32_t start;                 // first password in file to test
+    uint8_t flags;
+} PACKED em4x50_chk_t;
+
+typedef struct {
+    uint32_t pwd;
+    uint32_t pos;                   // next password in file to test
+    bool done;
+    uint8_t count;                  // words read when EM4X50_CHK_DUMP is set
+    uint32_t words[EM4X50_NO_WORDS];
+} PACKED em4x50_chk_resp_t;
+
 typedef struct {
     uint8_t count;
     uint32_t *words;
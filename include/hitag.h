@@ -55,8 +55,28 @@ typedef struct {
     uint8_t logdata_0[4];
     uint8_t logdata_1[4];
     uint8_t nonce[4];
+
+    uint8_t flags;
 } PACKED lf_hitag_data_t;
 
+// lf_hitag_data_t.flags
+#define HITAG_READER_STREAM_PAGES   0x01    // Hitag 2 reader sends each page as it is read
+
+// CMD_LF_HITAG_READER_PAGE
+typedef struct {
+    uint8_t page;
+    uint8_t data[4];
+} PACKED lf_hitag_page_t;
+
+// CMD_LF_HITAG_SNIFF / CMD_LF_HITAG_SIMULATE reply, unique nR aR pairs as transmitted
+#define HITAG2_NRAR_MAX             60
+typedef struct {
+    uint8_t uid[4];
+    uint16_t total;
+    uint16_t count;
+    uint8_t nrar[HITAG2_NRAR_MAX][8];
+} PACKED lf_hitag2_nrar_t;
+
 typedef struct {
     int status;
     uint8_t data[256];
@@ -78,6 +78,9 @@ typedef struct {
     iclass_auth_req_t req;
     uint8_t start_block;
     uint8_t end_block;
+    // AA2 is dumped in the same field session when aa2_end_block > end_block
+    uint8_t aa2_end_block;
+    uint8_t credit_key[8];
 } PACKED iclass_dump_req_t;
 
 // iCLASS write block request data structure
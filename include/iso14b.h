@@ -56,8 +56,25 @@ typedef enum ISO14B_TYPE {
     ISO14B_STANDARD = 1,
     ISO14B_SR = 2,
     ISO14B_CT = 4,
+    ISO14B_PICOPASS = 8,
 } iso14b_type_t;
 
+// CMD_HF_ISO14443B_DISCOVER reply,  first tag type that answered
+typedef struct {
+    uint8_t type;       // iso14b_type_t
+    union {
+        iso14b_card_select_t std;       // ISO14B_STANDARD, ISO14B_SR
+        iso14b_cts_card_select_t cts;   // ISO14B_CT
+        uint8_t csn[8];                 // ISO14B_PICOPASS
+    } card;
+} PACKED iso14b_discover_t;
+
+// CMD_HF_SRI_DUMP
+typedef struct {
+    uint8_t start;
+    uint8_t count;      // max PM3_CMD_DATA_SIZE / 4 blocks
+} PACKED iso14b_sr_dump_req_t;
+
 typedef struct {
     uint16_t flags;      // the ISO14B_COMMAND enum
     uint32_t timeout;
@@ -44,6 +44,19 @@ typedef struct {
     uint8_t raw[];      // First byte in raw,  raw[0] is ISO15693 protocol flag byte
 } PACKED iso15_raw_cmd_t;
 
+// CMD_HF_ISO15693_INVENTORY, 16 slot anticollision on device
+#define ISO15_INVENTORY_MAX_TAGS 32
+
+typedef struct {
+    uint8_t flags;      // ISO15_CONNECT / ISO15_NO_DISCONNECT, see iso15_command_t
+} PACKED iso15_inventory_req_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t truncated;  // more tags in the field than fit, or mask stack exhausted
+    uint8_t uid[ISO15_INVENTORY_MAX_TAGS][8];   // LSB first, as in the inventory response
+} PACKED iso15_inventory_t;
+
 #define ISO15693_TAG_MAX_PAGES 160 // in pages  (0xA0)
 #define ISO15693_TAG_MAX_SIZE 2048 // in byte (64 pages of 256 bits)
 
@@ -124,4 +124,60 @@ typedef struct {
     uint8_t PMi[8];
 } PACKED felica_auth2_response_t;
 
+// Device side Search Service Code sweep (CMD_HF_FELICA_SEARCH_SERVICE)
+#define FELICA_SEARCH_SERVICE_MAX 120
+typedef struct {
+    uint16_t start;             // first Search Service Code index
+} PACKED felica_search_service_req_t;
+
+typedef struct {
+    uint16_t code;              // area or service code
+    uint16_t end;               // end service code for an area, 0 for a service
+} PACKED felica_service_entry_t;
+
+typedef struct {
+    uint8_t IDm[8];
+    uint8_t count;
+    uint8_t truncated;          // buffer full, continue from `next`
+    uint16_t next;
+    felica_service_entry_t entries[FELICA_SEARCH_SERVICE_MAX];
+} PACKED felica_search_service_t;
+
+// Device side batched Read Without Encryption (CMD_HF_FELICA_READ_BLOCKS)
+#define FELICA_READ_BLOCKS_MAX      30
+#define FELICA_BLOCKS_PER_FRAME_MAX 15
+typedef struct {
+    uint16_t service;           // service code, as sent on the wire (little endian)
+    uint16_t block;             // first block number
+    uint8_t count;              // blocks to read, up to FELICA_READ_BLOCKS_MAX
+    uint8_t per_frame;          // blocks per command, 0 = FELICA_BLOCKS_PER_FRAME_MAX
+} PACKED felica_read_blocks_req_t;
+
+typedef struct {
+    uint8_t IDm[8];
+    uint8_t count;              // blocks read before the first error
+    uint8_t per_frame;          // blocks per command the card accepted
+    uint8_t status_flag1;       // status of the failing command, 0 if none
+    uint8_t status_flag2;
+    uint8_t data[FELICA_READ_BLOCKS_MAX][16];
+} PACKED felica_read_blocks_t;
+
+// Device side polling with time slots (CMD_HF_FELICA_POLL)
+#define FELICA_POLL_MAX_CARDS 16
+typedef struct {
+    uint16_t system_code;
+    uint8_t request_code;
+    uint8_t timeslots;          // TSN, number of slots - 1 (0, 1, 3, 7, 15)
+} PACKED felica_poll_req_t;
+
+typedef struct {
+    uint8_t IDm[8];
+    uint8_t PMm[8];
+} PACKED felica_poll_card_t;
+
+typedef struct {
+    uint8_t count;
+    felica_poll_card_t cards[FELICA_POLL_MAX_CARDS];
+} PACKED felica_poll_t;
+
 #endif // _ISO18_H_
@@ -34,6 +34,10 @@
 // Length must be aligned to 4 bytes (UL/NTAG page)
 #define MFU_DUMP_PREFIX_LENGTH 56
 
+// CMD_HF_MIFAREU_READCARD arg0 flag, start page stays in the low byte.
+// Tag supports FAST_READ (UL EV1 / NTAG), older firmware drops the bit.
+#define MFU_READCARD_FASTREAD 0x100
+
 typedef struct {
     uint8_t version[8];
     uint8_t tbo[2];
@@ -56,6 +60,21 @@ typedef struct {
     uint8_t ats[256];
 } PACKED iso14a_card_select_t;
 
+// Result of an on-device anticollision sweep (CMD_HF_ISO14443A_ENUMERATE)
+#define ISO14A_ENUM_MAX_TAGS 36
+typedef struct {
+    uint8_t uid[10];
+    uint8_t uidlen;
+    uint8_t atqa[2];
+    uint8_t sak;
+} PACKED iso14a_enum_tag_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t truncated;
+    iso14a_enum_tag_t tags[ISO14A_ENUM_MAX_TAGS];
+} PACKED iso14a_enum_t;
+
 typedef struct {
     uint8_t uid[10];
     uint8_t uidlen;
@@ -96,9 +115,161 @@ typedef enum ISO14A_COMMAND {
     ISO14A_SEND_CHAINING = (1 << 10),
     ISO14A_USE_ECP = (1 << 11),
     ISO14A_USE_MAGSAFE = (1 << 12),
-    ISO14A_USE_CUSTOM_POLLING = (1 << 13)
+    ISO14A_USE_CUSTOM_POLLING = (1 << 13),
+    ISO14A_CHAIN_RESPONSE = (1 << 14),
+    ISO14A_DESFIRE_AF = (1 << 15)
 } iso14a_command_t;
 
+// CMD_HF_ISO14443A_SESSION,  keeps the field on and the card selected between CMD_HF_ISO14443A_READER calls
+#define ISO14A_SESSION_STOP         0
+#define ISO14A_SESSION_START        1
+#define ISO14A_SESSION_STATUS       2
+#define ISO14A_SESSION_TIMEOUT      5000    // ms idle before the device drops the session
+typedef struct {
+    uint8_t action;
+    uint32_t timeout_ms;
+} PACKED iso14a_session_req_t;
+
+typedef struct {
+    bool active;
+    bool selected;
+    uint32_t timeout_ms;
+    uint32_t idle_ms;
+    uint32_t selects;   // card activations done in this session
+    uint32_t reused;    // connects answered from the selected card
+    iso14a_card_select_t card;
+} PACKED iso14a_session_t;
+
+// CMD_HF_ISO14443A_APDU_SWEEP,  device side INS sweep over one CLA / P1 / P2 for `hf 14a apdufind`.
+// Answers 6D00 (INS not supported) and 6E00 (CLA not supported) are only counted,  everything else is a hit.
+#define ISO14A_SWEEP_CONNECT        (1 << 0)    // activate the card first
+#define ISO14A_SWEEP_WITH_LE        (1 << 1)    // also send case 2S,  Le = 00
+#define ISO14A_SWEEP_MAX_HITS       32
+#define ISO14A_SWEEP_DATA           8
+typedef struct {
+    uint8_t flags;
+    uint8_t cla;
+    uint8_t p1;
+    uint8_t p2;
+    uint8_t ins;            // first INS
+    uint16_t count;         // INS to test,  up to 256
+    uint8_t skip[32];       // bitmap of INS not to test
+} PACKED iso14a_sweep_req_t;
+
+typedef struct {
+    uint8_t ins;
+    uint8_t le;             // sent with Le = 00
+    uint16_t sw;
+    uint8_t datalen;        // response data length,  without SW
+    uint8_t data[ISO14A_SWEEP_DATA];
+} PACKED iso14a_sweep_hit_t;
+
+typedef struct {
+    uint16_t tested;        // INS done,  a full hit list stops early. Continue at ins + tested
+    uint16_t sent;          // APDUs sent
+    uint16_t cla_unsupported;   // APDUs answered 6E00
+    uint8_t reselects;
+    uint8_t unsupported[32];    // bitmap of INS answered 6D00
+    uint8_t count;
+    iso14a_sweep_hit_t hits[ISO14A_SWEEP_MAX_HITS];
+} PACKED iso14a_sweep_resp_t;
+
+// CMD_HF_ISO14443A_SEQUENCE,  small bytecode run by the device to do exchange sequences at RF speed.
+// A program is a list of ops,  addresses are byte offsets into the program,  16bit little endian.
+// SEND / CONNECT set the condition flag to "got an answer" / "card selected",  EXPECT to "answer starts with".
+#define ISO14A_SEQ_END              0x00    // [code]                    stop,  code returned to the client
+#define ISO14A_SEQ_CONNECT          0x01    // [flags]                   field on + select,  ISO14A_SEQ_CONNECT_RATS
+#define ISO14A_SEQ_SEND             0x02    // [flags][len][data..]      ISO14A_SEQ_SEND_*
+#define ISO14A_SEQ_EXPECT           0x03    // [len][data..]             len 0 = any answer
+#define ISO14A_SEQ_JMP              0x04    // [addr]
+#define ISO14A_SEQ_JT               0x05    // [addr]                    jump if condition
+#define ISO14A_SEQ_JF               0x06    // [addr]                    jump if not condition
+#define ISO14A_SEQ_SET              0x07    // [n]                       loop counter = n
+#define ISO14A_SEQ_DJNZ             0x08    // [addr]                    --counter,  jump while not zero
+#define ISO14A_SEQ_LOG              0x09    //                           append the last answer to the log
+#define ISO14A_SEQ_WAIT             0x0A    // [us]                      16bit
+#define ISO14A_SEQ_OFF              0x0B    //                           field off
+
+#define ISO14A_SEQ_CONNECT_RATS     (1 << 0)
+#define ISO14A_SEQ_SEND_CRC         (1 << 0)    // append CRC
+#define ISO14A_SEQ_SEND_7BIT        (1 << 1)    // short frame,  7 bits of the first byte
+#define ISO14A_SEQ_SEND_NORX        (1 << 2)    // don't wait for an answer
+
+#define ISO14A_SEQ_MAX_STEPS        4096
+#define ISO14A_SEQ_LOG_SIZE         480
+
+typedef struct {
+    uint8_t code;           // ISO14A_SEQ_END argument
+    uint8_t cond;
+    uint16_t steps;
+    uint16_t pc;            // where it stopped
+    uint16_t loglen;
+    uint8_t log[ISO14A_SEQ_LOG_SIZE];   // [len][answer..] per LOG,  answer with CRC as received
+} PACKED iso14a_seq_resp_t;
+
+// CMD_HF_ISO14443A_COLLECT,  device side sample collector for `hf 14a cuids`.
+// The device keeps sampling at RF speed and streams full chunks back on its own,  the last one has `last` set
+// and its reply status tells why it stopped. Tracing is off,  BigBuf only holds the chunk being filled.
+#define ISO14A_COLLECT_UID          0       // select,  record UID + SAK
+#define ISO14A_COLLECT_NONCE        1       // MIFARE Classic auth,  record nt + ssp clock
+#define ISO14A_COLLECT_MAX_FAILS    250     // consecutive failed samples before giving up
+#define ISO14A_COLLECT_DATA         504     // PM3_CMD_DATA_SIZE - chunk header
+typedef struct {
+    uint8_t mode;
+    uint8_t block;          // ISO14A_COLLECT_NONCE
+    uint8_t keytype;        // ISO14A_COLLECT_NONCE,  0 = A,  1 = B
+    uint8_t off_ms;         // ISO14A_COLLECT_UID,  field off time between samples,  0 = HLTA + WUPA only
+    uint32_t count;         // samples,  0 = until aborted
+} PACKED iso14a_collect_req_t;
+
+typedef struct {
+    uint8_t uidlen;
+    uint8_t uid[10];
+    uint8_t sak;
+} PACKED iso14a_collect_uid_t;
+
+typedef struct {
+    uint32_t nt;
+    uint32_t ts;            // ssp clock when the auth was sent
+} PACKED iso14a_collect_nonce_t;
+
+typedef struct {
+    uint8_t last;
+    uint8_t mode;
+    uint16_t len;           // bytes used in data
+    uint32_t fails;         // failed samples since the previous chunk
+    uint8_t data[ISO14A_COLLECT_DATA];
+} PACKED iso14a_collect_chunk_t;
+
+// CMD_HF_ISO14443A_RFBENCH,  one select + READ round of `hw bench rf`.
+// Durations are in ticks of freq Hz. usb_tx is the send of the previous reply,  meaningless in the first round.
+// fpga_setup is 0 unless the field had to be (re)started. tx covers the guard time wait and the FPGA shift out,
+// tag_wait ends on the first Manchester sync and rx_decode runs from there to the end of the answer.
+#define ISO14A_RFBENCH_FIELD_OFF    (1 << 0)    // drop the field after the round
+#define ISO14A_RFBENCH_CYCLE        (1 << 1)    // restart the field and FPGA before the round
+#define ISO14A_RFBENCH_DATA         18          // READ answer,  16 bytes + CRC
+typedef struct {
+    uint8_t flags;
+    uint8_t block;
+} PACKED iso14a_rfbench_req_t;
+
+typedef struct {
+    uint32_t freq;
+    uint32_t usb_rx;
+    uint32_t usb_tx;
+    uint32_t fpga_setup;
+    uint32_t select;
+    uint32_t tx_encode;
+    uint32_t tx;
+    uint32_t tag_wait;
+    uint32_t rx_decode;
+    uint8_t len;
+    uint8_t data[ISO14A_RFBENCH_DATA];
+} PACKED iso14a_rfbench_resp_t;
+
+// reply arg2 with ISO14A_CHAIN_RESPONSE: response data without CRC, the device sends more on its own
+#define ISO14A_APDU_CHAINED_PART    1
+
 // Defines a frame that will be used in a polling sequence
 // ECP Frames are up to (7 + 16) bytes long, 24 bytes should cover future and other cases
 typedef struct {
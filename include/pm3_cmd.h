@@ -206,8 +206,12 @@ typedef struct {
     bool hw_available_flash            : 1;
     bool hw_available_smartcard        : 1;
     bool is_rdv4                       : 1;
+    // transport
+    bool bulk_download                 : 1;
+    bool compressed_download           : 1;
+    bool eml_upload                    : 1;
 } PACKED capabilities_t;
-#define CAPABILITIES_VERSION 6
+#define CAPABILITIES_VERSION 9
 extern capabilities_t g_pm3_capabilities;
 
 // For CMD_LF_T55XX_WRITEBL
@@ -224,6 +228,54 @@ typedef struct {
     uint32_t time;
 } PACKED t55xx_test_block_t;
 
+// For CMD_LF_T55XX_WRITE_BATCH
+// reply is a one byte bitmap, bit n set when block startblock + n was read back and matched
+typedef struct {
+    uint32_t data[8];
+    uint32_t pwd;
+    uint32_t config;        // block 0 describing how to demodulate the verify reads
+    uint8_t startblock;
+    uint8_t numblocks;
+    uint8_t flags;          // password mode | downlink mode << 3
+} PACKED t55xx_write_batch_t;
+
+// For CMD_LF_T55XX_CHK_PWDS, password range mode
+typedef struct {
+    uint8_t flags;          // downlink mode << 3
+    uint32_t start;
+    uint32_t end;           // inclusive
+    uint64_t baseline;      // 0, measure a new baseline
+    uint64_t threshold;
+} PACKED t55xx_bruteforce_t;
+
+typedef struct {
+    bool found;
+    uint32_t candidate;     // hit, or last password tried
+    uint64_t baseline;
+    uint64_t threshold;
+} PACKED t55xx_bruteforce_resp_t;
+
+// For CMD_LF_EM4X_PWD_SEARCH, EM4x05/EM4x69 login search
+#define EM4X05_PWDSEARCH_RANGE          0
+#define EM4X05_PWDSEARCH_DICT           1
+#define EM4X05_PWDSEARCH_MAX_DICT       120
+#define EM4X05_PWDSEARCH_MAX_CANDIDATES 8
+typedef struct {
+    uint8_t mode;           // EM4X05_PWDSEARCH_RANGE or EM4X05_PWDSEARCH_DICT
+    uint32_t start_pwd;     // range, first password
+    uint32_t n;             // stop after n candidates, 0 = never
+    uint32_t pos;           // position of the first test, echoed back incremented
+    uint32_t count;         // passwords to test, range length or entries in pwds
+    uint32_t pwds[];        // dictionary entries
+} PACKED em4x05_pwdsearch_t;
+
+typedef struct {
+    bool done;              // false for progress updates
+    uint32_t pos;           // next position to test, resume from here
+    uint8_t found;
+    uint32_t candidates[EM4X05_PWDSEARCH_MAX_CANDIDATES];
+} PACKED em4x05_pwdsearch_resp_t;
+
 // For CMD_LF_HID_SIMULATE (FSK)
 typedef struct {
     uint32_t hi2;
@@ -268,6 +320,23 @@ typedef struct {
     uint8_t data[];
 } PACKED lf_nrzsim_t;
 
+// For CMD_LF_SIM_STREAM, waveform is generated per field clock instead of pre-rendered into BigBuf.
+// Sending a new one while the simulation runs swaps the credential on the fly.
+#define LF_SIMSTREAM_NRZ        0   // also ASK/raw
+#define LF_SIMSTREAM_ASK_MAN    1
+#define LF_SIMSTREAM_ASK_BI     2
+#define LF_SIMSTREAM_FSK        3
+#define LF_SIMSTREAM_PSK1       4
+typedef struct {
+    uint8_t modulation;
+    uint8_t clock;
+    uint8_t fchigh;         // FSK high field clock, PSK carrier
+    uint8_t fclow;          // FSK low field clock
+    uint8_t invert;
+    uint16_t bitlen;
+    uint8_t bits[];         // packed, MSB first
+} PACKED lf_simstream_t;
+
 typedef struct {
     uint8_t type;
     uint16_t len;
@@ -286,6 +355,28 @@ uint32_t samples  :
     bool     verbose  : 1;
 } PACKED lf_sample_payload_t;
 
+// For CMD_LF_ACQ_WINDOWED.  Only the samples around modulation bursts are kept,
+// BigBuf then holds the windows back to back,  each a lf_window_hdr_t and `len` 8 bit samples
+typedef struct {
+    uint32_t samples;       // raw samples to watch,  0 = until BigBuf is full
+    uint16_t pre;           // samples kept ahead of a burst
+    uint16_t hold;          // quiet samples closing a window
+    uint8_t  threshold;     // a sample this far from 128 is a burst
+    bool     reader_field;
+    bool     verbose;
+} PACKED lf_window_payload_t;
+
+typedef struct {
+    uint32_t start;         // index of the first sample,  counted in (decimated) samples since the capture start
+    uint16_t len;
+} PACKED lf_window_hdr_t;
+
+typedef struct {
+    uint32_t bytes;         // BigBuf bytes used
+    uint32_t windows;
+    uint32_t span;          // (decimated) samples the capture covered
+} PACKED lf_window_result_t;
+
 typedef struct {
     uint8_t blockno;
     uint8_t keytype;
@@ -323,6 +414,119 @@ typedef struct {
     uint8_t keytype;
 } PACKED mfc_eload_t;
 
+// MIFARE Classic device side dump (CMD_HF_MIFARE_READCARD)
+typedef struct {
+    uint8_t sectorcnt;
+    uint8_t keys[2][40][6];     // key A table, key B table
+} PACKED mfc_readcard_t;
+
+// the card image itself is left in BigBuf, fetch it with GetFromDevice
+typedef struct {
+    uint32_t offset;            // BigBuf offset of the image
+    uint16_t blocks;            // number of blocks read
+    uint8_t readmask[32];       // one bit per block, LSB first
+    uint8_t authok[40];         // per sector, bit0 key A / bit1 key B authenticated
+} PACKED mfc_readcard_reply_t;
+
+// MIFARE Classic streamed key check (CMD_HF_MIFARE_CHKKEYS_STREAM)
+#define MF_CHK_STREAM_KEYS   84    // keys per chunk
+#define MF_CHK_STREAM_SLOTS  8     // chunks the device can queue, client may have this many unanswered
+#define MF_CHK_STREAM_FIRST  0x01
+#define MF_CHK_STREAM_LAST   0x02
+
+typedef struct {
+    uint8_t sectorcnt;
+    uint8_t strategy;
+    uint8_t flags;
+    uint8_t keycnt;
+    uint8_t keys[MF_CHK_STREAM_KEYS * 6];
+} PACKED mfc_chk_stream_chunk_t;
+
+// sent once per consumed chunk, done is set on the final reply
+typedef struct {
+    uint8_t foundkeys;
+    uint8_t done;
+    uint16_t chunks;
+    uint8_t found[10];     // bitmap,  bit (sector * 2 + keytype)
+    uint8_t keys[40 * 12]; // keyA / keyB per sector
+} PACKED mfc_chk_stream_status_t;
+
+// MIFARE Classic generator driven key check (CMD_HF_MIFARE_CHKKEYS_GEN)
+// The device generates the candidates itself (common/bruteforce.c) and tests them width first
+// on all sectors.  A reply is sent when new keys are found,  at least every MF_CHK_GEN_REPORT_MS
+// as keep-alive,  and once more with done set when the generator ran out or all keys are found.
+#define MF_CHK_GEN_REPORT_MS    2000
+
+typedef struct {
+    uint8_t sectorcnt;
+    uint8_t mode;           // BF_MODE_*
+    uint8_t charset;        // BF_CHARSET_*,  charset mode
+    uint8_t reserved;
+    uint32_t range_low;     // range mode
+    uint32_t range_high;
+} PACKED mfc_chk_gen_t;
+
+typedef struct {
+    uint32_t tested;        // keys generated and tested so far
+    uint16_t stage;         // smart mode stage of the generator
+    uint8_t foundkeys;
+    uint8_t done;
+    uint8_t found[10];      // bitmap,  bit (sector * 2 + keytype)
+    uint8_t keys[40 * 12];  // keyA / keyB per sector
+} PACKED mfc_chk_gen_reply_t;
+
+// MIFARE Classic candidate list key check (CMD_HF_MIFARE_CHKKEYS_LIST)
+// The list is uploaded in chunks into BigBuf,  the last chunk starts the check against one block.
+#define MF_CHK_LIST_KEYS        84    // keys per chunk
+#define MF_CHK_LIST_FIRST       0x01
+#define MF_CHK_LIST_LAST        0x02
+#define MF_CHK_LIST_NO_REAUTH   0x04  // select before every auth,  even if the card takes auths right after a failed one
+
+typedef struct {
+    uint8_t flags;
+    uint8_t block;
+    uint8_t keytype;
+    uint8_t keycnt;
+    uint16_t total;         // MF_CHK_LIST_FIRST,  keys in the whole list
+    uint16_t offset;        // index of the first key of this chunk
+    uint8_t keys[MF_CHK_LIST_KEYS * 6];
+} PACKED mfc_chk_list_chunk_t;
+
+typedef struct {
+    int32_t index;          // index of the valid key in the list,  -1 if none
+    uint16_t tested;
+    uint8_t key[6];
+    uint8_t reauth;         // the card took auths without a select in between
+} PACKED mfc_chk_list_reply_t;
+
+// MIFARE Plus SL3 / DESFire EV1 dictionary check (CMD_HF_MFP_CHKKEYS,  CMD_HF_DESFIRE_CHKKEYS)
+// The dictionary is uploaded in chunks into BigBuf,  the last chunk starts the check.
+// Every key slot is tried against the whole dictionary,  one reply per finished slot
+// and a last one with done set.
+#define MFPDES_CHK_DATA         480   // key bytes per chunk
+#define MFPDES_CHK_FIRST        0x01
+#define MFPDES_CHK_LAST         0x02
+
+typedef struct {
+    uint8_t flags;
+    uint8_t keylen;         // 8, 16 or 24
+    uint8_t keycnt;
+    uint8_t algo;           // DESFire MFDES_ALGO_*,  MIFARE Plus is always AES
+    uint16_t total;         // MFPDES_CHK_FIRST,  keys in the whole dictionary
+    uint16_t offset;        // index of the first key of this chunk
+    uint8_t aid[3];         // DESFire application,  LSB first
+    uint8_t reserved;
+    uint8_t slots[16];      // bitmap,  DESFire key number n / MIFARE Plus key 0x4000 + n
+    uint8_t keys[MFPDES_CHK_DATA];
+} PACKED mfpdes_chk_chunk_t;
+
+typedef struct {
+    uint8_t done;
+    uint8_t slot;
+    int16_t index;          // index of the valid key in the dictionary,  -1 if none
+    uint16_t tested;
+} PACKED mfpdes_chk_reply_t;
+
 typedef struct {
     uint8_t status;
     uint8_t CSN[8];
@@ -377,10 +581,11 @@ typedef enum SMARTCARD_COMMAND {
     SC_CLEARLOG = (1 << 5),
     SC_LOG = (1 << 6),
     SC_WAIT = (1 << 7),
+    SC_CHAINING = (1 << 8),
 } smartcard_command_t;
 
 typedef struct {
-    uint8_t flags;
+    uint16_t flags;
     uint32_t wait_delay;
     uint16_t len;
     uint8_t data[];
@@ -395,6 +600,7 @@ typedef struct {
 #define CMD_START_FLASH                                                   0x0005
 #define CMD_CHIP_INFO                                                     0x0006
 #define CMD_BL_VERSION                                                    0x0007
+#define CMD_BL_FLASH_CRC                                                  0x0008
 #define CMD_NACK                                                          0x00fe
 #define CMD_ACK                                                           0x00ff
 
@@ -422,6 +628,10 @@ typedef struct {
 #define CMD_BREAK_LOOP                                                    0x0118
 #define CMD_SET_TEAROFF                                                   0x0119
 #define CMD_GET_DBGMODE                                                   0x0120
+#define CMD_TRACE_STREAM                                                  0x011A
+#define CMD_PERF                                                          0x011B
+#define CMD_UPLOAD_EML_BIGBUF                                             0x011C
+#define CMD_SIM_STATS                                                     0x011D
 
 // RDV40, Flash memory operations
 #define CMD_FLASHMEM_WRITE                                                0x0121
@@ -469,6 +679,7 @@ typedef struct {
 #define CMD_SPIFFS_DOWNLOAD                                               0x2134
 #define CMD_SPIFFS_DOWNLOADED                                             0x2135
 #define CMD_SPIFFS_ELOAD                                                  0x2136
+#define CMD_SPIFFS_EML_BANK                                               0x2137
 #define CMD_SPIFFS_CHECK                                                  0x3000
 
 // RDV40,  Smart card operations
@@ -488,6 +699,7 @@ typedef struct {
 // For low-frequency tags
 #define CMD_LF_TI_READ                                                    0x0202
 #define CMD_LF_TI_WRITE                                                   0x0203
+#define CMD_DOWNLOADED_BIGBUF_LZ4                                         0x0204
 #define CMD_LF_ACQ_RAW_ADC                                                0x0205
 #define CMD_LF_MOD_THEN_ACQ_RAW_ADC                                       0x0206
 #define CMD_DOWNLOAD_BIGBUF                                               0x0207
@@ -546,6 +758,10 @@ typedef struct {
 
 #define CMD_LF_T55XX_CHK_PWDS                                             0x0230
 #define CMD_LF_T55XX_DANGERRAW                                            0x0231
+#define CMD_LF_T55XX_WRITE_BATCH                                          0x0233
+#define CMD_LF_EM4X_PWD_SEARCH                                            0x0234
+#define CMD_LF_SIM_STREAM                                                 0x0235
+#define CMD_LF_ACQ_WINDOWED                                               0x0236
 
 
 // ZX8211
@@ -557,12 +773,16 @@ typedef struct {
 // For the 13.56 MHz tags
 #define CMD_HF_ISO15693_ACQ_RAW_ADC                                       0x0300
 #define CMD_HF_ACQ_RAW_ADC                                                0x0301
+#define CMD_HF_DISCOVER                                                   0x0302
 #define CMD_HF_SRI_READ                                                   0x0303
+#define CMD_HF_SRI_DUMP                                                   0x0304
 #define CMD_HF_ISO14443B_COMMAND                                          0x0305
+#define CMD_HF_ISO14443B_DISCOVER                                         0x0306
 #define CMD_HF_ISO15693_READER                                            0x0310
 #define CMD_HF_ISO15693_SIMULATE                                          0x0311
 #define CMD_HF_ISO15693_SNIFF                                             0x0312
 #define CMD_HF_ISO15693_COMMAND                                           0x0313
+#define CMD_HF_ISO15693_INVENTORY                                         0x0314
 #define CMD_HF_ISO15693_FINDAFI                                           0x0315
 #define CMD_HF_ISO15693_SLIX_ENABLE_PRIVACY                               0x0867
 #define CMD_HF_ISO15693_SLIX_DISABLE_PRIVACY                              0x0317
@@ -589,6 +809,7 @@ typedef struct {
 #define CMD_LF_HITAG2_WRITE                                               0x0377
 #define CMD_LF_HITAG2_CRACK                                               0x0378
 #define CMD_LF_HITAG2_CRACK_2                                             0x0379
+#define CMD_LF_HITAG_READER_PAGE                                          0x037A
 
 // For HitagS
 #define CMD_LF_HITAGS_TEST_TRACES                                         0x0367
@@ -606,6 +827,12 @@ typedef struct {
 #define CMD_HF_ISO14443A_SIMULATE                                         0x0384
 
 #define CMD_HF_ISO14443A_READER                                           0x0385
+#define CMD_HF_ISO14443A_ENUMERATE                                        0x0386
+#define CMD_HF_ISO14443A_SESSION                                          0x038D
+#define CMD_HF_ISO14443A_APDU_SWEEP                                       0x038E
+#define CMD_HF_ISO14443A_SEQUENCE                                         0x0390
+#define CMD_HF_ISO14443A_COLLECT                                          0x0395
+#define CMD_HF_ISO14443A_RFBENCH                                          0x0399
 
 #define CMD_HF_LEGIC_SIMULATE                                             0x0387
 #define CMD_HF_LEGIC_READER                                               0x0388
@@ -636,6 +863,9 @@ typedef struct {
 #define CMD_HF_FELICA_SIMULATE                                            0x03A0
 #define CMD_HF_FELICA_SNIFF                                               0x03A1
 #define CMD_HF_FELICA_COMMAND                                             0x03A2
+#define CMD_HF_FELICA_SEARCH_SERVICE                                      0x03A3
+#define CMD_HF_FELICA_READ_BLOCKS                                         0x03A4
+#define CMD_HF_FELICA_POLL                                                0x03A5
 //temp
 #define CMD_HF_FELICALITE_DUMP                                            0x03AA
 #define CMD_HF_FELICALITE_SIMULATE                                        0x03AB
@@ -681,17 +911,22 @@ typedef struct {
 #define CMD_HF_MIFARE_READBL_EX                                           0x0628
 #define CMD_HF_MIFAREU_READBL                                             0x0720
 #define CMD_HF_MIFARE_READSC                                              0x0621
+#define CMD_HF_MIFARE_READCARD                                            0x062B
 #define CMD_HF_MIFAREU_READCARD                                           0x0721
 #define CMD_HF_MIFARE_WRITEBL                                             0x0622
 #define CMD_HF_MIFARE_WRITEBL_EX                                          0x0629
 #define CMD_HF_MIFARE_VALUE                                               0x0627
 #define CMD_HF_MIFAREU_WRITEBL                                            0x0722
 #define CMD_HF_MIFAREU_WRITEBL_COMPAT                                     0x0723
+#define CMD_HF_MIFAREU_WRITEPAGES                                         0x0735
 
 #define CMD_HF_MIFARE_CHKKEYS                                             0x0623
 #define CMD_HF_MIFARE_SETMOD                                              0x0624
 #define CMD_HF_MIFARE_CHKKEYS_FAST                                        0x0625
 #define CMD_HF_MIFARE_CHKKEYS_FILE                                        0x0626
+#define CMD_HF_MIFARE_CHKKEYS_STREAM                                      0x062A
+#define CMD_HF_MIFARE_CHKKEYS_LIST                                        0x062C
+#define CMD_HF_MIFARE_CHKKEYS_GEN                                         0x062D
 
 #define CMD_HF_MIFARE_SNIFF                                               0x0630
 #define CMD_HF_MIFARE_MFKEY                                               0x0631
@@ -712,10 +947,15 @@ typedef struct {
 #define CMD_HF_DESFIRE_READER                                             0x072c
 #define CMD_HF_DESFIRE_INFO                                               0x072d
 #define CMD_HF_DESFIRE_COMMAND                                            0x072e
+#define CMD_HF_DESFIRE_CHKKEYS                                            0x072f
 
 #define CMD_HF_MIFARE_NACK_DETECT                                         0x0730
 #define CMD_HF_MIFARE_STATIC_NONCE                                        0x0731
 #define CMD_HF_MIFARE_STATIC_ENCRYPTED_NONCE                              0x0732
+#define CMD_HF_MIFARE_CAPS_PROBE                                          0x0733
+
+// mifare plus
+#define CMD_HF_MFP_CHKKEYS                                                0x0734
 
 // MFU OTP TearOff
 #define CMD_HF_MFU_OTP_TEAROFF                                            0x0740
@@ -784,6 +1024,21 @@ typedef struct {
 #define NONCE_STATIC     0x03
 #define NONCE_STATIC_ENC 0x04
 
+// MIFARE Classic capability probe (CMD_HF_MIFARE_CAPS_PROBE)
+#define MFC_CAPS_PRNG_WEAK  0x01
+#define MFC_CAPS_PRNG_HARD  0x02
+#define MFC_CAPS_SIGNATURE  0x04
+
+typedef struct {
+    uint8_t nonce;          // NONCE_*
+    uint8_t caps;           // MFC_CAPS_*
+    uint8_t signature[32];  // blocks 69 + 70,  valid with MFC_CAPS_SIGNATURE
+} PACKED mfc_caps_t;
+
+// Hardnested nonce acquisition (CMD_HF_MIFARE_ACQ_ENCRYPTED_NONCES)
+#define HARDNESTED_FLAG_STREAM  0x0008   // device keeps sending batches until the client sends any command
+#define HARDNESTED_STREAM_LAST  0x10000  // set in arg1 of the final batch of a stream
+
 // Dbprintf flags
 #define FLAG_RAWPRINT    0x00
 #define FLAG_LOG         0x01
@@ -921,6 +1176,9 @@ typedef struct {
 /* Set if this device understands the read memory command */
 #define DEVICE_INFO_FLAG_UNDERSTANDS_READ_MEM        (1<<7)
 
+/* Set if this device understands the flash crc command */
+#define DEVICE_INFO_FLAG_UNDERSTANDS_FLASH_CRC       (1<<8)
+
 #define BL_VERSION_MAJOR(version) ((uint32_t)(version) >> 22)
 #define BL_VERSION_MINOR(version) (((uint32_t)(version) >> 12) & 0x3ff)
 #define BL_VERSION_PATCH(version) ((uint32_t)(version) & 0xfff)
@@ -931,10 +1189,172 @@ typedef struct {
 #define BL_VERSION_INVALID  0
 // Different versions here. Each version should increase the numbers
 #define BL_VERSION_1_0_0    BL_MAKE_VERSION(1, 0, 0)
+#define BL_VERSION_1_1_0    BL_MAKE_VERSION(1, 1, 0)
+
+/* CMD_BL_FLASH_CRC: arg0 = flash address, arg1 = number of blocks.
+ * Replies with one CRC32 (crc32_ex) per block of BL_FLASH_CRC_BLOCK bytes */
+#define BL_FLASH_CRC_BLOCK                          512
+#define BL_FLASH_CRC_MAX_BLOCKS                     (PM3_CMD_DATA_SIZE / 4)
 
 /* CMD_READ_MEM_DOWNLOAD flags */
 #define READ_MEM_DOWNLOAD_FLAG_RAW                   (1<<0)
 
+/* CMD_TRACE_STREAM
+   client -> device: uint8_t enable, arms streaming for the next sniff.
+   device -> client: PM3_SUCCESS frames carry the next bytes of the trace log,
+                     the PM3_ENODATA frame ending the stream carries trace_stream_stats_t. */
+typedef struct {
+    uint32_t bytes;
+    uint32_t records;
+    uint32_t dropped;
+} PACKED trace_stream_stats_t;
+
+/* Trace streamed to a SPIFFS file by the standalone sniffers.
+   The file is a sequence of blocks,  each one header followed by clen bytes.
+   A block is an independent LZ4 block,  or raw trace bytes when clen == rawlen.
+   The unpacked blocks concatenated give a normal trace log. */
+#define TRACE_LZ4_MAGIC              0x5A4C5254  // "TRLZ"
+#define TRACE_LZ4_MAX_INPUT          1024
+#define TRACE_LZ4_MAX_BLOCK          256   // one flash page,  keeps a flush short
+typedef struct {
+    uint32_t magic;
+    uint16_t clen;
+    uint16_t rawlen;
+} PACKED trace_lz4_block_t;
+
+/* CMD_PERF
+   client -> device: uint8_t flags, PERF_FLAG_RESET clears the counters after reporting.
+   device -> client: perf_report_t, durations are in ticks of perf_report_t.freq Hz */
+#define PERF_FLAG_RESET              (1<<0)
+
+#define PERF_LOGTRACE                0
+#define PERF_MILLER_DECODING         1
+#define PERF_MANCHESTER_DECODING     2
+#define PERF_MFC_AUTH                3
+#define PERF_USB_SEND                4
+// 14a relay hops, standalone hf_cardhopper / hf_reblay
+#define PERF_RELAY_UPLINK            5  // frame from the reader decoded -> handed to the link
+#define PERF_RELAY_REMOTE            6  // handed to the link -> answer back from the link
+#define PERF_RELAY_DOWNLINK          7  // answer back from the link -> modulated to the reader
+#define PERF_RELAY_CARD              8  // reader side, frame to the card -> card answer received
+#define PERF_USB_RECEIVE             9
+#define PERF_MAX                     10
+
+typedef struct {
+    uint32_t calls;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} PACKED perf_counter_t;
+
+typedef struct {
+    uint32_t freq;
+    uint8_t count;
+    perf_counter_t counters[PERF_MAX];
+} PACKED perf_report_t;
+
+/* CMD_SIM_STATS
+   client -> device: no payload
+   device -> client: sim_stats_t of the running or last simulation session */
+#define SIM_STATS_NONE               0
+#define SIM_STATS_14A                1
+#define SIM_STATS_MFC                2
+#define SIM_STATS_ICLASS             3
+#define SIM_STATS_15                 4
+#define SIM_STATS_HITAG2             5
+
+// bin i counts answers ready within (8 << i) us of the reader frame end,  the last bin all slower ones
+#define SIM_STATS_HIST_BINS          10
+
+typedef struct {
+    uint8_t sim;
+    bool active;
+    uint16_t budget_us;      // answers ready later than this are counted as late
+    uint32_t frames;         // reader frames received
+    uint32_t frame_errors;   // frames dropped on CRC / framing errors
+    uint32_t answers;
+    uint32_t late;
+    uint32_t hist[SIM_STATS_HIST_BINS];
+} PACKED sim_stats_t;
+
+/* CMD_DOWNLOAD_BIGBUF flags (oldarg[2])
+   BULK: payload is streamed as one raw, unframed block of exactly oldarg[1] bytes
+         followed by the usual CMD_ACK frame. Only honoured over USB-CDC. */
+#define DOWNLOAD_BIGBUF_FLAG_BULK                    (1<<0)
+/* LZ4:  chunks are sent as independent LZ4 blocks in CMD_DOWNLOADED_BIGBUF_LZ4 frames
+         arg0 = offset, arg1 = compressed length, arg2 = uncompressed length.
+         Chunks which don't compress are sent as plain CMD_DOWNLOADED_BIGBUF frames. */
+#define DOWNLOAD_BIGBUF_FLAG_LZ4                     (1<<1)
+#define DOWNLOAD_BIGBUF_LZ4_MAX_INPUT                8192
+
+/* CMD_DOWNLOAD_EML_BIGBUF honours DOWNLOAD_BIGBUF_FLAG_LZ4 in oldarg[2] the same way */
+
+/* CMD_UPLOAD_EML_BIGBUF
+   writes len bytes at offset into emulator memory, the payload is LZ4 compressed when flags has UPLOAD_EML_FLAG_LZ4.
+   fpga is the bitstream the emulator will run with, it is loaded first since loading it later can clobber the memory.
+   Every frame is answered with a status only reply. */
+#define UPLOAD_EML_FLAG_LZ4                          (1<<0)
+typedef struct {
+    uint16_t offset;
+    uint16_t len;
+    uint8_t flags;
+    uint8_t fpga;
+    uint8_t data[];
+} PACKED upload_eml_t;
+
+/* CMD_SPIFFS_EML_BANK
+   emulator image bank, slot n is the SPIFFS file EML_BANK_FILENAME.
+   LIST rescans the bank, LOAD copies slot into emulator memory (after loading fpga when not zero).
+   The reply carries the slot bitmap and sizes, and for LOAD how long the switch took. */
+#define EML_BANK_SLOTS                               16
+#define EML_BANK_FILENAME                            "eml_bank_%02u.bin"
+#define EML_BANK_MAX_SIZE                            4096    // one emulator memory, CARD_MEMORY_SIZE
+#define EML_BANK_LIST                                0
+#define EML_BANK_LOAD                                1
+typedef struct {
+    uint8_t action;
+    uint8_t slot;
+    uint8_t fpga;
+} PACKED eml_bank_req_t;
+
+typedef struct {
+    uint16_t present;
+    uint8_t slot;
+    uint32_t loaded;
+    uint32_t ms;
+    uint32_t sizes[EML_BANK_SLOTS];
+} PACKED eml_bank_resp_t;
+
+/* CMD_HF_DISCOVER
+   client -> device: hf_discover_req_t
+   device -> client: hf_discover_t,  one polling pass over the requested technologies.
+   Technologies sharing the loaded FPGA image are polled first, so a pass swaps image at most once. */
+#define HF_DISCOVER_14A                              (1<<0)
+#define HF_DISCOVER_14B                              (1<<1)
+#define HF_DISCOVER_15                               (1<<2)
+#define HF_DISCOVER_ICLASS                           (1<<3)
+#define HF_DISCOVER_ALL                              (HF_DISCOVER_14A | HF_DISCOVER_14B | HF_DISCOVER_15 | HF_DISCOVER_ICLASS)
+#define HF_DISCOVER_MAX_TAGS                         4
+typedef struct {
+    uint8_t techs;
+} PACKED hf_discover_req_t;
+
+typedef struct {
+    uint8_t tech;       // HF_DISCOVER_*
+    uint8_t uidlen;
+    uint8_t uid[10];    // 15693 MSB first,  iCLASS CSN
+    uint8_t atqa[2];    // 14a
+    uint8_t sak;        // 14a
+    uint8_t atqb[7];    // 14b
+} PACKED hf_discover_tag_t;
+
+typedef struct {
+    uint8_t count;
+    uint8_t polled;     // HF_DISCOVER_* actually polled
+    uint16_t ms;
+    hf_discover_tag_t tags[HF_DISCOVER_MAX_TAGS];
+} PACKED hf_discover_t;
+
 /* CMD_START_FLASH may have three arguments: start of area to flash,
    end of area to flash, optional magic.
    The bootrom will not allow to overwrite itself unless this magic
@@ -23,10 +23,18 @@
 // with some risk to overflow its internal buffers:
 //#define USART_BAUD_RATE 230400
 
+// Size of each of the two PDC receive banks and of the two PDC transmit banks.
+// Can be overridden at build time, e.g. for a larger rx ring on slow BT links.
+#ifndef USART_BUFFLEN
 #define USART_BUFFLEN 512
+#endif
+#ifndef USART_TXBUFFLEN
+#define USART_TXBUFFLEN USART_BUFFLEN
+#endif
 #define USART_FIFOLEN (2*USART_BUFFLEN)
 
-// Higher baudrates are pointless, only increasing overflow risk
+// Higher baudrates (460800 and up) can be set at runtime with "usart config",
+// if the add-on supports them
 
 #define USART_PARITY 'N'
 
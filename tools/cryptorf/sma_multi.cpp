@@ -34,6 +34,7 @@
 #include <mutex>
 #include "cryptolib.h"
 #include "util.h"
+#include "shard.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -255,6 +256,8 @@ static void init_lookup_right_subtraction() {
 static inline void previous_left(uint8_t in, vector<cs_t> *candidate_states) {
     pcs state;
     size_t size = candidate_states->size();
+    // every state can split in two, reserve up front so push_back never moves the states below
+    candidate_states->reserve(size * 2);
     for (size_t pos = 0; pos < size; pos++)  {
         state = &((*candidate_states)[pos]);
 
@@ -290,6 +293,7 @@ static inline void previous_left(uint8_t in, vector<cs_t> *candidate_states) {
 static inline void previous_right(uint8_t in, vector<cs_t> *candidate_states) {
     pcs state;
     size_t size = candidate_states->size();
+    candidate_states->reserve(size * 2);
     for (size_t pos = 0; pos < size; pos++) {
         state = &((*candidate_states)[pos]);
 
@@ -361,17 +365,46 @@ std::atomic<size_t> g_topbits{0};
 std::mutex g_ice_mtx;
 static uint32_t g_num_cpus = std::thread::hardware_concurrency();
 
+// Every worker fills its own arena, the arenas are merged after the join.
+// An entry is (bits << 56) | state, so sorting the entries orders them by bin.
+typedef struct {
+    vector<uint64_t> bins;
+    size_t topbits;
+    uint64_t topstate;
+    uint8_t mask[16];
+} ice_arena_t;
+
+static inline void ice_merge_arenas(vector<ice_arena_t> *arenas, vector<uint64_t> *bins) {
+    size_t total = 0;
+    for (auto &a : *arenas) {
+        total += a.bins.size();
+    }
+
+    bins->clear();
+    bins->reserve(total);
+    for (auto &a : *arenas) {
+        bins->insert(bins->end(), a.bins.begin(), a.bins.end());
+        vector<uint64_t>().swap(a.bins);
+    }
+
+    // highest bin comes first
+    sort(bins->begin(), bins->end(), greater<uint64_t>());
+}
+
 static void ice_sm_right_thread(
     uint8_t offset,
     uint8_t skips,
     const uint8_t *ks,
-    map<uint64_t, uint64_t> *bincstates,
-    uint8_t *mask
+    ice_arena_t *arena
 ) {
 
     uint8_t tmp_mask[16];
     uint8_t bt;
 
+    arena->topbits = 0;
+    arena->topstate = 0;
+    memset(arena->mask, 0, sizeof(arena->mask));
+
     for (uint64_t counter = offset; counter < 0x2000000; counter += skips) {
         // Reset the current bitcount of correct bits
         size_t bits = 0;
@@ -406,23 +439,17 @@ static void ice_sm_right_thread(
             if (((bt >> 7) & 0x01) == 0) bits++;
         }
 
-        g_ice_mtx.lock();
-        if (bits > g_topbits.load(std::memory_order_relaxed)) {
+        if (bits > arena->topbits) {
             // Copy the winning mask
-            g_topbits = bits;
-            memcpy(mask, tmp_mask, 16);
+            arena->topbits = bits;
+            arena->topstate = counter;
+            memcpy(arena->mask, tmp_mask, 16);
         }
-        g_ice_mtx.unlock();
 
         // Ignore states under 90
         if (bits >= 90) {
             //  Make sure the bits are used for ordering
-            g_ice_mtx.lock();
-            if (bincstates->find((((uint64_t)bits) << 56) | counter) != bincstates->end())
-                bincstates->at((((uint64_t)bits) << 56) | counter) = counter;
-            else
-                bincstates->insert(std::pair<uint64_t, uint64_t>((((uint64_t)bits) << 56) | counter, counter));
-            g_ice_mtx.unlock();
+            arena->bins.push_back((((uint64_t)bits) << 56) | counter);
         }
 
         if ((counter & 0xfffff) == 0) {
@@ -435,12 +462,12 @@ static void ice_sm_right_thread(
 }
 static uint32_t ice_sm_right(const uint8_t *ks, uint8_t *mask, vector<uint64_t> *pcrstates) {
 
-    map<uint64_t, uint64_t> bincstates;
+    vector<ice_arena_t> arenas(g_num_cpus);
     g_topbits = 0;
 
     std::vector<std::thread> threads(g_num_cpus);
     for (uint32_t m = 0; m < g_num_cpus; m++) {
-        threads[m] = std::thread(ice_sm_right_thread, m, g_num_cpus, ks, &bincstates, mask);
+        threads[m] = std::thread(ice_sm_right_thread, m, g_num_cpus, ks, &arenas[m]);
     }
     for (auto &t : threads) {
         t.join();
@@ -448,17 +475,22 @@ static uint32_t ice_sm_right(const uint8_t *ks, uint8_t *mask, vector<uint64_t>
 
     printf("\n");
 
-    // Clear the candidate state vector
-    pcrstates->clear();
-
-    // Copy the order the states from lowest-bin to highest-bin
-    map<uint64_t, uint64_t>::iterator it;
-    for (it = bincstates.begin(); it != bincstates.end(); ++it) {
-        pcrstates->push_back(it->second);
+    // The highest count wins, on a tie the lowest state, like a single worker would pick
+    uint32_t win = 0;
+    for (uint32_t m = 1; m < g_num_cpus; m++) {
+        if (arenas[m].topbits > arenas[win].topbits ||
+                (arenas[m].topbits == arenas[win].topbits && arenas[m].topstate < arenas[win].topstate)) {
+            win = m;
+        }
     }
+    g_topbits = arenas[win].topbits;
+    memcpy(mask, arenas[win].mask, 16);
 
-    // Reverse the vector order (so the highest bin comes first)
-    reverse(pcrstates->begin(), pcrstates->end());
+    // Order the states from the highest bin to the lowest bin and strip the bits again
+    ice_merge_arenas(&arenas, pcrstates);
+    for (auto &it : *pcrstates) {
+        it &= 0x00ffffffffffffffull;
+    }
 
     return g_topbits;
 }
@@ -467,7 +499,7 @@ static void ice_sm_left_thread(
     uint8_t offset,
     uint8_t skips,
     const uint8_t *ks,
-    map<uint64_t, cs_t> *bincstates,
+    ice_arena_t *arena,
     const uint8_t *mask
 ) {
 
@@ -476,11 +508,6 @@ static void ice_sm_left_thread(
     uint8_t bt;
     lookup_entry *lookup;
 
-    // Reset and initialize the cryptostate and vector
-    cs_t state;
-    memset(&state, 0x00, sizeof(cs_t));
-    state.invalid = false;
-
     for (uint64_t counter = offset; counter < 0x800000000ull; counter += skips) {
         uint64_t lstate = counter;
 
@@ -525,16 +552,12 @@ static void ice_sm_left_thread(
                 if (((bt >> 7) & 0x01) == 0) bits++;
             }
 
-            state.l = counter;
-
             //  Make sure the bits are used for ordering
+            arena->bins.push_back((((uint64_t)bits) << 56) | counter);
+
             g_ice_mtx.lock();
             printf(".");
             fflush(stdout);
-            if (bincstates->find((((uint64_t)bits) << 56) | counter) != bincstates->end())
-                bincstates->at((((uint64_t)bits) << 56) | counter) = state;
-            else
-                bincstates->insert(std::pair<uint64_t, cs_t>((((uint64_t)bits) << 56) | counter, state));
             g_ice_mtx.unlock();
 
         }
@@ -550,10 +573,10 @@ static void ice_sm_left_thread(
 
 static void ice_sm_left(const uint8_t *ks, uint8_t *mask, vector<cs_t> *pcstates) {
 
-    map<uint64_t, cs_t> bincstates;
+    vector<ice_arena_t> arenas(g_num_cpus);
     std::vector<std::thread> threads(g_num_cpus);
     for (uint32_t m = 0; m < g_num_cpus; m++) {
-        threads[m] = std::thread(ice_sm_left_thread, m, g_num_cpus, ks, &bincstates, mask);
+        threads[m] = std::thread(ice_sm_left_thread, m, g_num_cpus, ks, &arenas[m], mask);
     }
 
     for (auto &t : threads) {
@@ -562,16 +585,36 @@ static void ice_sm_left(const uint8_t *ks, uint8_t *mask, vector<cs_t> *pcstates
 
     printf("100%%\n");
 
-    // Clear the candidate state vector
+    // Order the states from the highest bin to the lowest bin
+    vector<uint64_t> bins;
+    ice_merge_arenas(&arenas, &bins);
+
+    // Only the left part is known, the rest of the cryptostate starts out zero
+    cs_t state;
+    memset(&state, 0x00, sizeof(cs_t));
+    state.invalid = false;
+
     pcstates->clear();
+    pcstates->reserve(bins.size());
+    for (auto &it : bins) {
+        state.l = it & 0x00ffffffffffffffull;
+        pcstates->push_back(state);
+    }
+}
+
+// Sorted (state, counter) pairs of the meet-in-the-middle attack, a flat array
+// instead of a tree of 2^20 nodes
+typedef vector<pair<uint64_t, uint64_t>> matchbox_t;
 
-    // Copy the order the states from lowest-bin to highest-bin
-    map<uint64_t, cs_t>::iterator it;
-    for (it = bincstates.begin(); it != bincstates.end(); ++it) {
-        pcstates->push_back(it->second);
+// Finds the highest counter that produced state
+static inline bool matchbox_find(const matchbox_t &matchbox, uint64_t state, uint64_t *counter) {
+    matchbox_t::const_iterator it = upper_bound(matchbox.begin(), matchbox.end(), state,
+    [](uint64_t v, const pair<uint64_t, uint64_t> &e) { return v < e.first; });
+    if (it == matchbox.begin() || (--it)->first != state) {
+        return false;
     }
-    // Reverse the vector order (so the highest bin comes first)
-    reverse(pcstates->begin(), pcstates->end());
+    *counter = it->second;
+    return true;
 }
 
 static inline void previous_all_input(vector<cs_t> *pcstates, uint32_t gc_byte_index, cipher_state_side css) {
@@ -580,6 +623,8 @@ static inline void previous_all_input(vector<cs_t> *pcstates, uint32_t gc_byte_i
     vector<cs_t> prev_ncstates;
     vector<cs_t>::iterator itnew;
 
+    prev_ncstates.reserve(pcstates->size() * 0x20);
+
     // Loop through the complete entryphy of 5 bits for each candidate
     // We ignore zero (xor 0x00) to avoid duplicates
     for (btGc = 0; btGc < 0x20; btGc++)  {
@@ -604,20 +649,21 @@ static inline void previous_all_input(vector<cs_t> *pcstates, uint32_t gc_byte_i
         }
     }
 
-    // Copy the previous states into the vector
-    *pcstates = prev_ncstates;
+    // Hand the previous states over to the vector
+    pcstates->swap(prev_ncstates);
 }
 
 static inline void search_gc_candidates_right(const uint64_t rstate_before_gc, const uint64_t rstate_after_gc, const uint8_t *Q, vector<cs_t> *pcstates) {
     vector<cs_t>::iterator it;
     vector<cs_t> csl_cand;
-    map<uint64_t, uint64_t> matchbox;
-    map<uint64_t, uint64_t>::iterator itmatch;
+    matchbox_t matchbox;
+    uint64_t match;
     uint64_t rstate;
     size_t counter;
     cs_t state;
 
     // Generate 2^20 different (5 bits) values for the first 4 Gc bytes (0,1,2,3)
+    matchbox.reserve(0x100000);
     for (counter = 0; counter < 0x100000; counter++) {
         rstate  = rstate_before_gc;
         next_right_fast((counter >> 12) & 0xf8, &rstate);
@@ -626,8 +672,9 @@ static inline void search_gc_candidates_right(const uint64_t rstate_before_gc, c
         next_right_fast((counter >> 2) & 0xf8, &rstate);
         next_right_fast((counter << 3) & 0xf8, &rstate);
         next_right_fast(Q[5], &rstate);
-        matchbox[rstate] = counter;
+        matchbox.push_back(make_pair(rstate, (uint64_t)counter));
     }
+    sort(matchbox.begin(), matchbox.end());
 
     // Reset and initialize the cryptostate and vecctor
     memset(&state, 0x00, sizeof(cs_t));
@@ -648,12 +695,11 @@ static inline void search_gc_candidates_right(const uint64_t rstate_before_gc, c
 
     // Take the intersection of the corresponding states ~2^15 values (40-25 = 15 bits)
     for (it = csl_cand.begin(); it != csl_cand.end(); ++it) {
-        itmatch = matchbox.find(it->r);
-        if (itmatch != matchbox.end()) {
-            it->Gc[0] = (itmatch->second >> 12) & 0xf8;
-            it->Gc[1] = (itmatch->second >>  7) & 0xf8;
-            it->Gc[2] = (itmatch->second >>  2) & 0xf8;
-            it->Gc[3] = (itmatch->second <<  3) & 0xf8;
+        if (matchbox_find(matchbox, it->r, &match)) {
+            it->Gc[0] = (match >> 12) & 0xf8;
+            it->Gc[1] = (match >>  7) & 0xf8;
+            it->Gc[2] = (match >>  2) & 0xf8;
+            it->Gc[3] = (match <<  3) & 0xf8;
 
             pcstates->push_back(*it);
         }
@@ -663,12 +709,13 @@ static inline void search_gc_candidates_right(const uint64_t rstate_before_gc, c
 static inline void search_gc_candidates_left(const uint64_t lstate_before_gc, const uint8_t *Q, vector<cs_t> *pcstates) {
     vector<cs_t> csl_cand, csl_search;
     vector<cs_t>::iterator itsearch, itcand;
-    map<uint64_t, uint64_t> matchbox;
-    map<uint64_t, uint64_t>::iterator itmatch;
+    matchbox_t matchbox;
+    uint64_t match;
     uint64_t lstate;
     size_t counter;
 
     // Generate 2^20 different (5 bits) values for the first 4 Gc bytes (0,1,2,3)
+    matchbox.reserve(0x100000);
     for (counter = 0; counter < 0x100000; counter++) {
         lstate  = lstate_before_gc;
         next_left_fast((counter >> 15) & 0x1f, &lstate);
@@ -677,8 +724,9 @@ static inline void search_gc_candidates_left(const uint64_t lstate_before_gc, co
         next_left_fast((counter >> 5) & 0x1f, &lstate);
         next_left_fast(counter & 0x1f, &lstate);
         next_left_fast(Q[5], &lstate);
-        matchbox[lstate] = counter;
+        matchbox.push_back(make_pair(lstate, (uint64_t)counter));
     }
+    sort(matchbox.begin(), matchbox.end());
 
     // Copy the input candidate states and clean the output vector
     csl_cand = *pcstates;
@@ -698,12 +746,11 @@ static inline void search_gc_candidates_left(const uint64_t lstate_before_gc, co
 
         // Take the intersection of the corresponding states ~2^15 values (40-25 = 15 bits)
         for (itsearch = csl_search.begin(); itsearch != csl_search.end(); ++itsearch) {
-            itmatch = matchbox.find(itsearch->l);
-            if (itmatch != matchbox.end()) {
-                itsearch->Gc[0] = (itmatch->second >> 15) & 0x1f;
-                itsearch->Gc[1] = (itmatch->second >> 10) & 0x1f;
-                itsearch->Gc[2] = (itmatch->second >>  5) & 0x1f;
-                itsearch->Gc[3] = itmatch->second & 0x1f;
+            if (matchbox_find(matchbox, itsearch->l, &match)) {
+                itsearch->Gc[0] = (match >> 15) & 0x1f;
+                itsearch->Gc[1] = (match >> 10) & 0x1f;
+                itsearch->Gc[2] = (match >>  5) & 0x1f;
+                itsearch->Gc[3] = match & 0x1f;
 
                 pcstates->push_back(*itsearch);
             }
@@ -714,45 +761,56 @@ static inline void search_gc_candidates_left(const uint64_t lstate_before_gc, co
     printf("\n");
 }
 
+// Gc of a candidate as packed big endian bytes
+static inline uint64_t cs_gc(const cs_t *state) {
+    uint64_t gc = 0;
+    for (size_t pos = 0; pos < 8; pos++) {
+        gc <<= 8;
+        gc |= state->Gc[pos];
+    }
+    return gc;
+}
+
 void combine_valid_left_right_states(vector<cs_t> *plcstates, vector<cs_t> *prcstates, vector<uint64_t> *pgc_candidates) {
-    vector<cs_t>::iterator itl, itr;
-    size_t pos;
-    uint64_t gc;
-    bool valid;
 
-    vector<cs_t> outer, inner;
+    // Left and right candidates share the overlapping bits (8 x 2bits of Gc)
+    const uint64_t overlap = 0x1818181818181818ull;
+
+    const vector<cs_t> *outer, *inner;
     if (plcstates->size() > prcstates->size()) {
-        outer = *plcstates;
-        inner = *prcstates;
+        outer = plcstates;
+        inner = prcstates;
     } else {
-        outer = *prcstates;
-        inner = *plcstates;
+        outer = prcstates;
+        inner = plcstates;
     }
 
-    printf("Outer  " _YELLOW_("%zu")" , inner " _YELLOW_("%zu") "\n", outer.size(), inner.size());
+    printf("Outer  " _YELLOW_("%zu")" , inner " _YELLOW_("%zu") "\n", outer->size(), inner->size());
 
-    // Clean up the candidate list
-    pgc_candidates->clear();
-    for (itl = outer.begin(); itl != outer.end(); ++itl) {
-        for (itr = inner.begin(); itr != inner.end(); ++itr) {
-            valid = true;
-            // Check for left and right candidates that share the overlapping bits (8 x 2bits of Gc)
-            for (pos = 0; pos < 8; pos++) {
-                if ((itl->Gc[pos] & 0x18) != (itr->Gc[pos] & 0x18)) {
-                    valid = false;
-                    break;
-                }
-            }
+    // Pull the Gc bytes out of the states into flat arrays, the inner one sorted on the
+    // overlapping bits so every outer candidate only visits its matching range.
+    // The sort is stable, so the candidates keep the order of the nested loops.
+    vector<uint64_t> outer_gc(outer->size());
+    for (size_t i = 0; i < outer->size(); i++) {
+        outer_gc[i] = cs_gc(&(*outer)[i]);
+    }
 
-            if (valid) {
-                gc = 0;
-                for (pos = 0; pos < 8; pos++) {
-                    gc <<= 8;
-                    gc |= (itl->Gc[pos] | itr->Gc[pos]);
-                }
+    vector<pair<uint64_t, uint64_t>> inner_gc(inner->size());
+    for (size_t i = 0; i < inner->size(); i++) {
+        uint64_t gc = cs_gc(&(*inner)[i]);
+        inner_gc[i] = make_pair(gc & overlap, gc);
+    }
+    stable_sort(inner_gc.begin(), inner_gc.end(),
+    [](const pair<uint64_t, uint64_t> &x, const pair<uint64_t, uint64_t> &y) { return x.first < y.first; });
 
-                pgc_candidates->push_back(gc);
-            }
+    // Clean up the candidate list
+    pgc_candidates->clear();
+    for (auto &gc : outer_gc) {
+        pair<uint64_t, uint64_t> k = make_pair(gc & overlap, 0);
+        auto range = equal_range(inner_gc.begin(), inner_gc.end(), k,
+        [](const pair<uint64_t, uint64_t> &x, const pair<uint64_t, uint64_t> &y) { return x.first < y.first; });
+        for (auto it = range.first; it != range.second; ++it) {
+            pgc_candidates->push_back(gc | it->second);
         }
     }
     printf("Found a total of " _YELLOW_("%llu")" combinations, ", ((unsigned long long)plcstates->size()) * prcstates->size());
@@ -802,7 +860,7 @@ static void ice_compare(
     return;
 }
 
-int main(int argc, const char *argv[]) {
+int main(int argc, char *argv[]) {
     size_t pos;
     crypto_state_t ostate;
     uint64_t rstate_before_gc, lstate_before_gc;
@@ -833,10 +891,17 @@ int main(int argc, const char *argv[]) {
     uint64_t nCh;   // Reader challenge
     uint64_t nCi_1; // Card answer
 
-    if ((argc != 2) && (argc != 5)) {
+    // --range / --shard / --progress over the right state bins
+    shard_t shard;
+    bool shard_ok = shard_parse_args(&shard, "sma_multi", &argc, argv);
+
+    if (shard_ok == false || ((argc != 2) && (argc != 5))) {
         printf("SecureMemory recovery - (c) Radboud University Nijmegen\n\n");
-        printf("syntax: sma_multi simulate\n");
-        printf("        sma_multi <Ci> <Q> <Ch> <Ci+1>\n\n");
+        printf("syntax: sma_multi simulate [options]\n");
+        printf("        sma_multi <Ci> <Q> <Ch> <Ci+1> [options]\n\n");
+        printf("the right state bins are the search index for --range\n");
+        shard_usage();
+        printf("\n");
         return 1;
     }
 
@@ -922,7 +987,9 @@ int main(int argc, const char *argv[]) {
         printf("\n" _RED_("WARNING!!!") ", better find another trace, the right top-bin is smaller than 96 bits\n\n");
     }
 
-    for (itrstates = rstates.begin(); itrstates != rstates.end(); ++itrstates) {
+    uint64_t first = shard_apply(&shard, 0, rstates.size());
+    uint64_t bin = first;
+    for (itrstates = rstates.begin() + first; bin < shard.end; ++itrstates, shard_progress(&shard, ++bin, NULL)) {
         uint64_t rstate_after_gc = *itrstates;
         sm_left_mask(ks, mask, rstate_after_gc);
         printf("Using the state from the top-right bin: " _YELLOW_("0x%07" PRIx64)"\n", rstate_after_gc);
@@ -962,11 +1029,19 @@ int main(int argc, const char *argv[]) {
 
         if (key_found) {
             printf("\nValid key found [ " _GREEN_("%016" PRIx64)" ]\n\n", key.load());
-            break;
+            char found[17];
+            snprintf(found, sizeof(found), "%016" PRIx64, key.load());
+            shard_progress(&shard, bin, found);
+            return 0;
         }
 
         printf(_RED_("\nCould not find key using this right cipher state.\n\n"));
     }
+
+    // the loop increment writes the progress, an empty slice still needs its file
+    if (bin == first) {
+        shard_progress(&shard, bin, NULL);
+    }
     return 0;
 }
 
@@ -27,102 +27,62 @@
 
 static void usage(void) {
     fprintf(stdout, "Usage: fpga_compress <infile1> <infile2> ... <infile_n> <outfile>\n");
-    fprintf(stdout, "          Combine n FPGA bitstream files and compress them into one.\n\n");
+    fprintf(stdout, "          Combine n FPGA bitstream files into one,  each compressed on its own behind an index.\n\n");
     fprintf(stdout, "       fpga_compress -v <infile1> <infile2> ... <infile_n> <outfile>\n");
     fprintf(stdout, "          Extract Version Information from FPGA bitstream files and write it to <outfile>\n\n");
     fprintf(stdout, "       fpga_compress -d <infile> <outfile(s)>\n");
     fprintf(stdout, "          Decompress <infile>. Write result to <outfile(s)>\n\n");
 }
 
-static bool all_feof(FILE *infile[], uint8_t num_infiles) {
-    for (uint16_t i = 0; i < num_infiles; i++) {
-        if (!feof(infile[i])) {
-            return false;
-        }
+// read a whole input file,  returns its size or -1 if it doesn't fit
+static long read_infile(FILE *infile, uint8_t *buf, long bufsize) {
+    long size = fread(buf, sizeof(uint8_t), bufsize, infile);
+    if (size == bufsize && fgetc(infile) != EOF) {
+        fprintf(stderr,
+                "Input file too big (> %li bytes). This is probably not a PM3 FPGA config file.\n"
+                , bufsize
+               );
+        return -1;
     }
-    return true;
+    return size;
 }
 
-static int zlib_compress(FILE *infile[], uint8_t num_infiles, FILE *outfile) {
-
-    uint8_t *fpga_config = calloc(num_infiles * FPGA_CONFIG_SIZE, sizeof(uint8_t));
-    if (fpga_config == NULL) {
-        fprintf(stderr, "failed to allocate memory");
-        return (EXIT_FAILURE);
-    }
-
-    // read the input files. Interleave them into fpga_config[]
-    uint32_t total_size = 0;
-    do {
+// compress one image into [int length][block] chunks of FPGA_RING_BUFFER_BYTES,
+// with a fresh stream so it decompresses on its own. Returns the bytes written or -1
+static long compress_stream(const uint8_t *in, long size, FILE *outfile) {
 
-        if (total_size > num_infiles * FPGA_CONFIG_SIZE) {
-            fprintf(stderr,
-                    "Input files too big (total > %li bytes). These are probably not PM3 FPGA config files.\n"
-                    , num_infiles * FPGA_CONFIG_SIZE
-                   );
-
-            free(fpga_config);
-            return (EXIT_FAILURE);
-        }
-
-        for (uint16_t j = 0; j < num_infiles; j++) {
-            for (uint16_t k = 0; k < FPGA_INTERLEAVE_SIZE; k++) {
-                uint8_t c = (uint8_t)fgetc(infile[j]);
-
-                if (!feof(infile[j])) {
-                    fpga_config[total_size++] = c;
-                } else if (num_infiles > 1) {
-                    fpga_config[total_size++] = '\0';
-                }
-            }
-        }
-
-    } while (all_feof(infile, num_infiles) == false);
-
-    uint32_t buffer_size = FPGA_RING_BUFFER_BYTES;
-
-    if (num_infiles == 1) {
-        // 1M bytes for now
-        buffer_size = 1024 * 1024;
-    }
-
-    uint32_t outsize_max = LZ4_compressBound(buffer_size);
+    uint32_t outsize_max = LZ4_compressBound(FPGA_RING_BUFFER_BYTES);
 
     char *outbuf = calloc(outsize_max, sizeof(char));
     if (outbuf == NULL) {
         fprintf(stderr, "failed to allocate memory");
-        free(fpga_config);
-        return (EXIT_FAILURE);
+        return -1;
     }
 
-    char *ring_buffer = calloc(buffer_size, sizeof(char));
+    char *ring_buffer = calloc(FPGA_RING_BUFFER_BYTES, sizeof(char));
     if (ring_buffer == NULL) {
         fprintf(stderr, "failed to allocate memory");
         free(outbuf);
-        free(fpga_config);
-        return (EXIT_FAILURE);
+        return -1;
     }
 
     LZ4_streamHC_t *lz4_streamhc = LZ4_createStreamHC();
     LZ4_resetStreamHC_fast(lz4_streamhc, LZ4HC_CLEVEL_MAX);
 
-    int current_in = 0;
-    int current_out = 0;
+    long current_in = 0;
+    long current_out = 0;
 
-    while (current_in < total_size) {
+    while (current_in < size) {
 
-        int bytes_to_copy = MIN(FPGA_RING_BUFFER_BYTES, (total_size - current_in));
+        int bytes_to_copy = MIN(FPGA_RING_BUFFER_BYTES, (size - current_in));
 
-        memcpy(ring_buffer, fpga_config + current_in, bytes_to_copy);
+        memcpy(ring_buffer, in + current_in, bytes_to_copy);
 
         int cmp_bytes = LZ4_compress_HC_continue(lz4_streamhc, ring_buffer, outbuf, bytes_to_copy, outsize_max);
         if (cmp_bytes < 0) {
-            fprintf(stderr, "(lz4 - zlib_compress) error,  got negative number of bytes from LZ4_compress_HC_continue call. got %d", cmp_bytes);
-            free(ring_buffer);
-            free(outbuf);
-            free(fpga_config);
-            LZ4_freeStreamHC(lz4_streamhc);
-            return (EXIT_FAILURE);
+            fprintf(stderr, "(lz4 - compress_stream) error,  got negative number of bytes from LZ4_compress_HC_continue call. got %d", cmp_bytes);
+            current_out = -1;
+            break;
         }
 
         // write size
@@ -132,42 +92,107 @@ static int zlib_compress(FILE *infile[], uint8_t num_infiles, FILE *outfile) {
         fwrite(outbuf, sizeof(char), cmp_bytes, outfile);
 
         current_in += bytes_to_copy;
-        current_out += cmp_bytes;
+        current_out += cmp_bytes + sizeof(int);
     }
 
     // free allocated buffers
     free(ring_buffer);
     free(outbuf);
-    free(fpga_config);
     LZ4_freeStreamHC(lz4_streamhc);
+    return current_out;
+}
+
+// One input file is compressed as a plain stream (used for the data section).
+// Several FPGA bitstreams get an fpga_index_t header and one stream each
+static int zlib_compress(FILE *infile[], uint8_t num_infiles, FILE *outfile) {
 
-    if (current_out == 0) {
-        fprintf(stderr, "error in lz4");
+    uint8_t *fpga_config = calloc(FPGA_CONFIG_SIZE, sizeof(uint8_t));
+    if (fpga_config == NULL) {
+        fprintf(stderr, "failed to allocate memory");
         return (EXIT_FAILURE);
-    } else {
-        fprintf(stdout, "compressed %u input bytes to %d output bytes\n", total_size, current_out);
     }
-    return (EXIT_SUCCESS);
-}
 
-typedef struct lz4_stream_s {
-    LZ4_streamDecode_t *lz4StreamDecode;
-    char *next_in;
-    int avail_in;
-} lz4_stream;
+    if (num_infiles == 1) {
+        long size = read_infile(infile[0], fpga_config, FPGA_CONFIG_SIZE);
+        long out = (size < 0) ? -1 : compress_stream(fpga_config, size, outfile);
+        free(fpga_config);
+        if (out <= 0) {
+            fprintf(stderr, "error in lz4");
+            return (EXIT_FAILURE);
+        }
+        fprintf(stdout, "compressed %li input bytes to %li output bytes\n", size, out);
+        return (EXIT_SUCCESS);
+    }
+
+    size_t index_size = sizeof(fpga_index_t) + num_infiles * sizeof(fpga_index_entry_t);
+    fpga_index_t *index = calloc(1, index_size);
+    if (index == NULL) {
+        fprintf(stderr, "failed to allocate memory");
+        free(fpga_config);
+        return (EXIT_FAILURE);
+    }
+    index->magic = FPGA_INDEX_MAGIC;
+    index->count = num_infiles;
 
+    // placeholder, written again once the offsets are known
+    fwrite(index, index_size, 1, outfile);
 
-// Call it either with opened infile + outsize=0
-// or with opened infile, opened outfiles, num_outfiles and valid outsize
-static int zlib_decompress(FILE *infile, FILE *outfiles[], uint8_t num_outfiles, long *outsize) {
+    uint32_t offset = index_size;
+    long total_in = 0;
+    for (uint16_t j = 0; j < num_infiles; j++) {
 
-    if (num_outfiles > 10) {
-        return (EXIT_FAILURE);
+        long size = read_infile(infile[j], fpga_config, FPGA_CONFIG_SIZE);
+        long out = (size < 0) ? -1 : compress_stream(fpga_config, size, outfile);
+        if (out <= 0) {
+            fprintf(stderr, "error in lz4");
+            free(index);
+            free(fpga_config);
+            return (EXIT_FAILURE);
+        }
+
+        index->entry[j].offset = offset;
+        index->entry[j].length = out;
+        index->entry[j].size = size;
+        offset += out;
+        total_in += size;
     }
 
+    fseek(outfile, 0L, SEEK_SET);
+    fwrite(index, index_size, 1, outfile);
+
+    fprintf(stdout, "compressed %li input bytes to %u output bytes\n", total_in, offset);
+    free(index);
+    free(fpga_config);
+    return (EXIT_SUCCESS);
+}
+
+// decompress one stream of [int length][block] chunks to outfile, returns the bytes written or -1
+static long decompress_stream(char *in, long avail_in, FILE *outfile) {
+
     LZ4_streamDecode_t lz4StreamDecode_body = {{ 0 }};
     char outbuf[FPGA_RING_BUFFER_BYTES] = {0};
 
+    long total_size = 0;
+    while (avail_in > 0) {
+        int cmp_bytes;
+        memcpy(&cmp_bytes, in, sizeof(int));
+        in += 4;
+        avail_in -= cmp_bytes + 4;
+
+        const int decBytes = LZ4_decompress_safe_continue(&lz4StreamDecode_body, in, outbuf, cmp_bytes, FPGA_RING_BUFFER_BYTES);
+        if (decBytes <= 0) {
+            return -1;
+        }
+
+        fwrite(outbuf, decBytes, sizeof(char), outfile);
+        total_size += decBytes;
+        in += cmp_bytes;
+    }
+    return total_size;
+}
+
+static int zlib_decompress(FILE *infile, FILE *outfiles[], uint8_t num_outfiles) {
+
     // file size
     fseek(infile, 0L, SEEK_END);
     long infile_size = ftell(infile);
@@ -178,102 +203,53 @@ static int zlib_decompress(FILE *infile, FILE *outfiles[], uint8_t num_outfiles,
         return (EXIT_FAILURE);
     }
 
-    char *outbufall = NULL;
-    if (*outsize >  0) {
-        outbufall = calloc(*outsize, sizeof(char));
-        if (outbufall == NULL) {
-            return (EXIT_FAILURE);
-        }
-    }
-
     char *inbuf = calloc(infile_size, sizeof(char));
     if (inbuf == NULL) {
-        if (outbufall) {
-            free(outbufall);
-        }
         return (EXIT_FAILURE);
     }
 
     size_t num_read = fread(inbuf, sizeof(char), infile_size, infile);
-
     if (num_read != infile_size) {
-        if (outbufall) {
-            free(outbufall);
-        }
         free(inbuf);
         return (EXIT_FAILURE);
     }
 
-    lz4_stream compressed_fpga_stream;
-    // initialize lz4 structures
-    compressed_fpga_stream.lz4StreamDecode = &lz4StreamDecode_body;
-    compressed_fpga_stream.next_in = inbuf;
-    compressed_fpga_stream.avail_in = infile_size;
-
+    const fpga_index_t *index = (const fpga_index_t *)inbuf;
     long total_size = 0;
-    while (compressed_fpga_stream.avail_in > 0) {
-        int cmp_bytes;
-        memcpy(&cmp_bytes, compressed_fpga_stream.next_in, sizeof(int));
-        compressed_fpga_stream.next_in += 4;
-        compressed_fpga_stream.avail_in -= cmp_bytes + 4;
 
-        const int decBytes = LZ4_decompress_safe_continue(compressed_fpga_stream.lz4StreamDecode, compressed_fpga_stream.next_in, outbuf, cmp_bytes, FPGA_RING_BUFFER_BYTES);
-        if (decBytes <= 0) {
-            break;
-        }
-
-        if (outbufall != NULL) {
-            memcpy(outbufall + total_size, outbuf, decBytes);
-        }
-
-        total_size += decBytes;
-        compressed_fpga_stream.next_in += cmp_bytes;
-    }
-
-    if (outbufall == NULL) {
-        *outsize = total_size;
-        fseek(infile, 0L, SEEK_SET);
-        return EXIT_SUCCESS;
+    if (infile_size < sizeof(fpga_index_t) || index->magic != FPGA_INDEX_MAGIC) {
+        // plain stream
+        total_size = decompress_stream(inbuf, infile_size, outfiles[0]);
     } else {
-
-        // seeking for trailing zeroes
-        long offset = 0;
-        long outfilesizes[10] = {0};
-        for (long k = 0; k < *outsize / (FPGA_INTERLEAVE_SIZE * num_outfiles); k++) {
-            for (uint16_t j = 0; j < num_outfiles; j++) {
-                for (long i = 0; i < FPGA_INTERLEAVE_SIZE; i++) {
-                    if (outbufall[offset + i]) {
-                        outfilesizes[j] = (k * FPGA_INTERLEAVE_SIZE) + i + 1;
-                    }
-                }
-                offset += FPGA_INTERLEAVE_SIZE;
-            }
-        }
-
-        total_size = 0;
-        // FPGA bit file ends with 16 zeroes
-        for (uint16_t j = 0; j < num_outfiles; j++) {
-            outfilesizes[j] += 16;
-            total_size += outfilesizes[j];
+        if (infile_size < sizeof(fpga_index_t) + index->count * sizeof(fpga_index_entry_t)) {
+            free(inbuf);
+            return (EXIT_FAILURE);
         }
 
-        offset = 0;
-        for (long k = 0; k < *outsize / (FPGA_INTERLEAVE_SIZE * num_outfiles); k++) {
-            for (uint16_t j = 0; j < num_outfiles; j++) {
-                if (k * FPGA_INTERLEAVE_SIZE < outfilesizes[j]) {
-                    uint16_t chunk = (outfilesizes[j] - (k * FPGA_INTERLEAVE_SIZE) < FPGA_INTERLEAVE_SIZE) ?
-                                     outfilesizes[j] - (k * FPGA_INTERLEAVE_SIZE) : FPGA_INTERLEAVE_SIZE;
+        for (uint16_t j = 0; j < MIN(num_outfiles, index->count); j++) {
+            const fpga_index_entry_t *e = &index->entry[j];
+            if ((long)e->offset + e->length > infile_size) {
+                total_size = -1;
+                break;
+            }
 
-                    fwrite(outbufall + offset, chunk, sizeof(char), outfiles[j]);
-                }
-                offset += FPGA_INTERLEAVE_SIZE;
+            long n = decompress_stream(inbuf + e->offset, e->length, outfiles[j]);
+            if (n != e->size) {
+                total_size = -1;
+                break;
             }
+            total_size += n;
         }
-        printf("uncompressed %li input bytes to %li output bytes\n", infile_size, total_size);
     }
 
-    free(outbufall);
     free(inbuf);
+
+    if (total_size < 0) {
+        fprintf(stderr, "error in lz4\n");
+        return (EXIT_FAILURE);
+    }
+
+    printf("uncompressed %li input bytes to %li output bytes\n", infile_size, total_size);
     return (EXIT_SUCCESS);
 }
 
@@ -483,14 +459,7 @@ int main(int argc, char **argv) {
             return (EXIT_FAILURE);
         }
 
-        long outsize = 0;
-        int ret = 0;
-        // First call to estimate output size
-        ret = zlib_decompress(infile, outfiles, num_output_files, &outsize);
-        if (ret == EXIT_SUCCESS) {
-            // Second call to create files
-            ret = zlib_decompress(infile, outfiles, num_output_files, &outsize);
-        }
+        int ret = zlib_decompress(infile, outfiles, num_output_files);
 
         // close file handlers
         fclose(infile);
@@ -30,6 +30,10 @@
 // 6 bytes of PRNG state.
 #define DATASIZE 10
 
+// sparse index next to each sorted file, see ht2crack2search.c
+#define INDEXBITS 12
+#define INDEXSIZE ((1 << INDEXBITS) + 1)
+
 int debug = 0;
 
 // table entry for a bucket
@@ -361,6 +365,38 @@ static int datacmp(const void *p1, const void *p2, void *dummy) {
     return memcmp(d_1, d_2, DATASIZE);
 }
 
+// write sorted/xx/yy.idx, entry k is the first record with top INDEXBITS bits >= k.
+// The search only has to read the records between entry k and k + 1
+static void writeindex(const char *file, const unsigned char *table, uint64_t numentries) {
+    uint32_t *idx = (uint32_t *)calloc(INDEXSIZE, sizeof(uint32_t));
+    if (!idx) {
+        printf("writeindex: cannot calloc index\n");
+        exit(1);
+    }
+
+    uint64_t e = 0;
+    for (uint32_t k = 0; k < INDEXSIZE - 1; k++) {
+        while ((e < numentries) &&
+                (uint32_t)((table[e * DATASIZE] << (INDEXBITS - 8)) | (table[e * DATASIZE + 1] >> (16 - INDEXBITS))) < k) {
+            e++;
+        }
+        idx[k] = e;
+    }
+    idx[INDEXSIZE - 1] = numentries;
+
+    int fdout = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fdout <= 0) {
+        printf("cannot create index file %s\n", file);
+        exit(1);
+    }
+    if (write(fdout, idx, INDEXSIZE * sizeof(uint32_t)) != INDEXSIZE * sizeof(uint32_t)) {
+        printf("writeindex cannot write all of the data\n");
+        exit(1);
+    }
+    close(fdout);
+    free(idx);
+}
+
 static void *sorttable(void *dd) {
     int i, j;
     int fdin;
@@ -430,12 +466,15 @@ static void *sorttable(void *dd) {
                 printf("cannot create outfile %s\n", outfile);
                 exit(1);
             }
-            if (write(fdout, table, numentries * DATASIZE)) {
+            if (write(fdout, table, numentries * DATASIZE) != (ssize_t)(numentries * DATASIZE)) {
                 printf("writetable cannot write all of the data\n");
                 exit(1);
             }
             close(fdout);
 
+            snprintf(outfile, sizeof(outfile), "sorted/%02x/%02x.idx", i, j);
+            writeindex(outfile, table, numentries);
+
             // remove input file
             if (unlink(infile)) {
                 printf("cannot remove file %s\n", infile);
@@ -447,10 +486,80 @@ static void *sorttable(void *dd) {
     return NULL;
 }
 
+// add the index to an existing sorted/ table
+static void *indextable(void *dd) {
+    int i, j;
+    int fdin;
+    char infile[64];
+    char outfile[64];
+    unsigned char *data = NULL;
+    struct stat filestat;
+    int index = (int)(long)dd;
+    int space = 0x100 / NUM_SORT_THREADS;
+
+    for (i = (index * space); i < ((index + 1) * space); i++) {
+        for (j = 0; j < 0x100; j++) {
+
+            snprintf(infile, sizeof(infile), "sorted/%02x/%02x.bin", i, j);
+
+            fdin = open(infile, O_RDONLY);
+            if (fdin <= 0) {
+                printf("cannot open file %s\n", infile);
+                exit(1);
+            }
+
+            if (fstat(fdin, &filestat)) {
+                printf("cannot stat file %s\n", infile);
+                exit(1);
+            }
+
+            uint64_t numentries = filestat.st_size / DATASIZE;
+            if (numentries) {
+                data = mmap((caddr_t)0, filestat.st_size, PROT_READ, MAP_PRIVATE, fdin, 0);
+                if (data == MAP_FAILED) {
+                    printf("cannot mmap file %s\n", infile);
+                    exit(1);
+                }
+            }
+
+            snprintf(outfile, sizeof(outfile), "sorted/%02x/%02x.idx", i, j);
+            writeindex(outfile, data, numentries);
+
+            if (numentries) {
+                munmap(data, filestat.st_size);
+            }
+            close(fdin);
+        }
+        printf("indextable: processed bytes 0x%02x/xx\n", i);
+    }
+
+    return NULL;
+}
+
 int main(int argc, char *argv[]) {
     pthread_t threads[NUM_BUILD_THREADS];
     void *status;
 
+    // only (re)build the index files of a table sorted by an older version
+    if ((argc > 1) && !strcmp(argv[1], "--index")) {
+        for (long i = 0; i < NUM_SORT_THREADS; i++) {
+            int ret = pthread_create(&(threads[i]), NULL, indextable, (void *)(i));
+            if (ret) {
+                printf("cannot start indextable thread %ld\n", i);
+                exit(1);
+            }
+        }
+
+        for (long i = 0; i < NUM_SORT_THREADS; i++) {
+            int ret = pthread_join(threads[i], &status);
+            if (ret) {
+                printf("cannot join indextable thread %ld\n", i);
+                exit(1);
+            }
+        }
+        return 0;
+    }
+
     // make the table of tables
     t = (struct table *)calloc(sizeof(struct table) * 65536, sizeof(uint8_t));
     if (!t) {
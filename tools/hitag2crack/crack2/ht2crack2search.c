@@ -9,6 +9,11 @@
 #define INPUTFILE "sorted/%02x/%02x.bin"
 #define DATASIZE 10
 
+// sparse index written by ht2crack2buildtable, (1 << INDEXBITS) + 1 uint32 entries.
+// Entry k is the first record whose top INDEXBITS bits (after the 2 bytes in the path) are >= k
+#define INDEXFILE "sorted/%02x/%02x.idx"
+#define INDEXBITS 12
+
 struct rngdata {
     unsigned char *data;
     int len;
@@ -152,20 +157,118 @@ static int testcand(const unsigned char *f, unsigned char *rt, int fwd) {
     }
 }
 
+// walk all entries equal to item around a bsearch hit and test them
+static int testmatches(unsigned char *data, size_t n, unsigned char *item, unsigned char *c, unsigned char *rt, int fwd, unsigned char *m, unsigned char *s) {
+    unsigned char *found = (unsigned char *)bsearch(item, data, n, DATASIZE, datacmp);
+    unsigned char *end = data + (n * DATASIZE);
+
+    if (!found) {
+        return 0;
+    }
+
+    // our candidate is in the table
+    // go backwards and see if there are other matches
+    while (((found - data) >= DATASIZE) && (!memcmp(found - DATASIZE, item, 4))) {
+        found = found - DATASIZE;
+    }
+
+    // now test all matches
+    while ((found < end) && (!memcmp(found, item, 4))) {
+        if (testcand(found, rt, fwd)) {
+            memcpy(m, c, 2);
+            memcpy(m + 2, found, 4);
+            memcpy(s, found + 4, 6);
+            return 1;
+        }
+
+        found = found + DATASIZE;
+    }
+
+    return 0;
+}
+
+// with an index only the bucket holding the candidate is read, a few KB instead of the whole file
+static int searchcand_index(const char *idxfile, unsigned char *c, unsigned char *rt, int fwd, unsigned char *m, unsigned char *s) {
+    int fd;
+    char file[64];
+    uint32_t range[2];
+    struct stat filestat;
+    unsigned char *bucket;
+    int ret;
+
+    fd = open(idxfile, O_RDONLY);
+    if (fd <= 0) {
+        return -1;
+    }
+
+    off_t pos = (off_t)((c[2] << (INDEXBITS - 8)) | (c[3] >> (16 - INDEXBITS))) * sizeof(uint32_t);
+    if (pread(fd, range, sizeof(range), pos) != sizeof(range)) {
+        printf("cannot read index file %s\n", idxfile);
+        exit(1);
+    }
+    close(fd);
+
+    if (range[1] <= range[0]) {
+        return 0;
+    }
+
+    snprintf(file, sizeof(file), INPUTFILE, c[0], c[1]);
+
+    fd = open(file, O_RDONLY);
+    if (fd <= 0) {
+        printf("cannot open table file %s\n", file);
+        exit(1);
+    }
+
+    if (fstat(fd, &filestat)) {
+        printf("cannot stat file %s\n", file);
+        exit(1);
+    }
+
+    if ((uint64_t)range[1] * DATASIZE > (uint64_t)filestat.st_size) {
+        printf("index file %s doesn't match %s, rebuild it with ht2crack2buildtable --index\n", idxfile, file);
+        exit(1);
+    }
+
+    size_t len = (size_t)(range[1] - range[0]) * DATASIZE;
+    bucket = (unsigned char *)malloc(len);
+    if (!bucket) {
+        printf("cannot malloc\n");
+        exit(1);
+    }
+
+    if (pread(fd, bucket, len, (off_t)range[0] * DATASIZE) != (ssize_t)len) {
+        printf("cannot read table file %s\n", file);
+        exit(1);
+    }
+    close(fd);
+
+    ret = testmatches(bucket, range[1] - range[0], c + 2, c, rt, fwd, m, s);
+
+    free(bucket);
+    return ret;
+}
+
 static int searchcand(unsigned char *c, unsigned char *rt, int fwd, unsigned char *m, unsigned char *s) {
     int fd;
     struct stat filestat;
     char file[64];
     unsigned char *data;
     unsigned char item[10];
-    unsigned char *found = NULL;
-
+    int ret;
 
     if (!c || !rt || !m || !s) {
         printf("searchcand: invalid params\n");
         return 0;
     }
 
+    snprintf(file, sizeof(file), INDEXFILE, c[0], c[1]);
+    ret = searchcand_index(file, c, rt, fwd, m, s);
+    if (ret >= 0) {
+        return ret;
+    }
+
+    // no index, binary search the whole file
     snprintf(file, sizeof(file), INPUTFILE, c[0], c[1]);
 
     fd = open(file, O_RDONLY);
@@ -187,36 +290,12 @@ static int searchcand(unsigned char *c, unsigned char *rt, int fwd, unsigned cha
 
     memcpy(item, c + 2, 4);
 
-    found = (unsigned char *)bsearch(item, data, filestat.st_size / DATASIZE, DATASIZE, datacmp);
-
-    if (found) {
-
-        // our candidate is in the table
-        // go backwards and see if there are other matches
-        while (((found - data) >= DATASIZE) && (!memcmp(found - DATASIZE, item, 4))) {
-            found = found - DATASIZE;
-        }
-
-        // now test all matches
-        while (((found - data) <= (filestat.st_size - DATASIZE)) && (!memcmp(found, item, 4))) {
-            if (testcand(found, rt, fwd)) {
-                memcpy(m, c, 2);
-                memcpy(m + 2, found, 4);
-                memcpy(s, found + 4, 6);
-
-                munmap(data, filestat.st_size);
-                close(fd);
-                return 1;
-            }
-
-            found = found + DATASIZE;
-        }
-    }
+    ret = testmatches(data, filestat.st_size / DATASIZE, item, c, rt, fwd, m, s);
 
     munmap(data, filestat.st_size);
     close(fd);
 
-    return 0;
+    return ret;
 
 }
 
@@ -32,9 +32,11 @@
  * a table size of about 3000000 and expect it to take around 4 mins to run, but
  * with a high likelihood of success.
  *
- * Setting table size to a large number (~32000000) will likely blow up the stack
- * during the recursive qsort().  This could be fixed by making the stack space
- * larger but really, you need a smaller table and more encrypted nonces.
+ * Each round only keeps the best half of the table, so the guesses are
+ * partitioned around the k-th best score instead of being fully sorted; only the
+ * last round is sorted.  Per-state filter probabilities come from lookup tables
+ * built at start up.  A very large table (~32000000) is still mostly a waste of
+ * memory; you need a smaller table and more encrypted nonces.
  *
  * The scoring of the guesses is controversial, having been tweaked over and again
  * to find a measure that provides the best results.  Feel free to tweak it yourself
@@ -87,6 +89,7 @@ struct thread_data {
 
 /* guess table and encrypted nonce/keystream table */
 struct guess *guesses = NULL;
+double *scratch_scores = NULL;
 unsigned int num_guesses;
 struct nonce nonces[MAX_NONCES];
 unsigned int num_nRaR;
@@ -231,6 +234,11 @@ static void create_guess_table(void) {
         printf("cannot allocate memory for guess table\n");
         exit(1);
     }
+    scratch_scores = (double *)calloc(1, sizeof(double) * maxtablesize);
+    if (!scratch_scores) {
+        printf("cannot allocate memory for score table\n");
+        exit(1);
+    }
 }
 
 
@@ -312,33 +320,13 @@ static void init_guess_table(char *filename, char *uidstr) {
 }
 
 
-/* bit_score calculates the ratio of partial states that could generate
- * the resulting bit b to all possible states
- * size is the number of confirmed bits in the state */
-static double bit_score(uint64_t s, uint64_t size, uint64_t b) {
-    uint64_t packed;
-    uint64_t chopped;
-    unsigned int n;
-    uint64_t b1;
+/* bit_prob1 calculates the ratio of partial states that could generate
+ * a 1 to all possible states.
+ * packed is the packed partial state, n is the number of relevant bits in it */
+static double bit_prob1(uint64_t packed, unsigned int n) {
     double nibprob1, nibprob0, prob;
     unsigned int fncinput;
 
-
-    // chop away any bits beyond size
-    chopped = s & ((1l << size) - 1);
-    // and pack the remaining bits
-    packed = packstate(chopped);
-
-    // calc size of packed version
-    n = packed_size[size];
-
-    b1 = b & 0x1;
-
-    // calc probability of getting b1
-
-    // start by calculating probability of getting a 1,
-    // then fix if b1==0 (subtract from 1)
-
     if (n == 0) {
         // catch the case where we have no relevant bits and return
         // the default probability
@@ -385,7 +373,54 @@ static double bit_score(uint64_t s, uint64_t size, uint64_t b) {
         prob = f20(packed);
     }
 
-    if (b1) {
+    return prob;
+}
+
+
+/* prob1_table[n] holds bit_prob1 for every packed partial state with n
+ * relevant bits (n < 20), so the scoring threads only do lookups.
+ * n == 20 is a complete state and f20 is cheaper than an 8MB table */
+double *prob1_table[20];
+
+static void init_prob_tables(void) {
+    for (unsigned int n = 1; n < 20; n++) {
+        prob1_table[n] = (double *)calloc(1, sizeof(double) << n);
+        if (!prob1_table[n]) {
+            printf("cannot allocate memory for probability tables\n");
+            exit(1);
+        }
+        for (uint64_t packed = 0; packed < (1l << n); packed++) {
+            prob1_table[n][packed] = bit_prob1(packed, n);
+        }
+    }
+}
+
+
+/* bit_score calculates the ratio of partial states that could generate
+ * the resulting bit b to all possible states
+ * size is the number of confirmed bits in the state */
+static double bit_score(uint64_t s, uint64_t size, uint64_t b) {
+    double prob;
+
+    // calc size of packed version
+    unsigned int n = packed_size[size];
+
+    // catch the case where we have no relevant bits and return
+    // the default probability
+    if (n == 0) {
+        return 0.5;
+    }
+
+    // chop away any bits beyond size and pack the remaining bits
+    uint64_t packed = packstate(s & ((1l << size) - 1));
+
+    if (n < 20) {
+        prob = prob1_table[n][packed];
+    } else {
+        prob = f20(packed);
+    }
+
+    if (b & 0x1) {
         return prob;
     } else {
         return (1.0 - prob);
@@ -399,32 +434,38 @@ static double bit_score(uint64_t s, uint64_t size, uint64_t b) {
  * multiplied by the number of relevant bits in the scored state
  * to give weight to more complete states. */
 static double score(uint64_t s, unsigned int size, uint64_t ks, unsigned int kssize) {
-    double sc;
+    double sc[48];
+    unsigned int n = 0;
 
-    if ((size == 1) || (kssize == 1)) {
-        sc = bit_score(s, size, ks & 0x1);
-        return (sc * (packed_size[size] + 1));
-    } else {
+    // walk the window instead of recursing; one bit_score per remaining bit
+    while (1) {
         // I've introduced a weighting for each score to
         // give more significance to bigger windows.
-
-        sc = bit_score(s, size, ks & 0x1);
+        double bs = bit_score(s, size, ks & 0x1);
 
         // if a bit_score returns a probability of 0 then this can't be a winner
-        if (sc == 0.0) {
+        if (bs == 0.0) {
             return 0.0;
-        } else {
+        }
 
-            double sc2 = score(s >> 1, size - 1, ks >> 1, kssize - 1);
+        sc[n++] = bs * (packed_size[size] + 1);
 
-            // if score returns a probability of 0 then this can't be a winner
-            if (sc2 == 0.0) {
-                return 0.0;
-            } else {
-                return (sc * (packed_size[size] + 1)) + sc2;
-            }
+        if ((size == 1) || (kssize == 1)) {
+            break;
         }
+
+        s >>= 1;
+        ks >>= 1;
+        size--;
+        kssize--;
+    }
+
+    // sum from the innermost window out, same order as the recursive version
+    double total = sc[--n];
+    while (n) {
+        total = sc[--n] + total;
     }
+    return total;
 }
 
 
@@ -548,6 +589,95 @@ static int cmp_guess(const void *a, const void *b) {
 }
 
 
+/* kth_score returns the k-th highest score (k counted from 1) using an
+ * in-place quickselect over a scratch copy of the scores */
+static double kth_score(double *sc, unsigned int n, unsigned int k) {
+    unsigned int lo = 0;
+    unsigned int hi = n - 1;
+    unsigned int target = k - 1;
+
+    while (lo < hi) {
+        double pivot = sc[lo + ((hi - lo) / 2)];
+        unsigned int i = lo;
+        unsigned int j = hi;
+
+        // partition descending around pivot
+        while (i <= j) {
+            while (sc[i] > pivot) i++;
+            while (sc[j] < pivot) j--;
+            if (i <= j) {
+                double tmp = sc[i];
+                sc[i] = sc[j];
+                sc[j] = tmp;
+                i++;
+                if (j == 0) {
+                    break;
+                }
+                j--;
+            }
+        }
+
+        if (target <= j) {
+            hi = j;
+        } else if (target >= i) {
+            lo = i;
+        } else {
+            break;
+        }
+    }
+    return sc[target];
+}
+
+
+static void swap_guess(struct guess *a, struct guess *b) {
+    struct guess tmp = *a;
+    *a = *b;
+    *b = tmp;
+}
+
+
+/* select_guesses moves the k best guesses to the front of the table
+ * without sorting it.  Afterwards the best guess is at index 0 and the
+ * k-th best at index k - 1, which is all expand_guesses and the metrics need */
+static void select_guesses(unsigned int k) {
+    unsigned int i, j;
+
+    for (i = 0; i < num_guesses; i++) {
+        scratch_scores[i] = guesses[i].score;
+    }
+    double threshold = kth_score(scratch_scores, num_guesses, k);
+
+    // everything better than the threshold goes first, then fill with ties
+    for (i = 0, j = 0; j < num_guesses; j++) {
+        if (guesses[j].score > threshold) {
+            if (i != j) {
+                swap_guess(&guesses[i], &guesses[j]);
+            }
+            i++;
+        }
+    }
+    for (j = i; (j < num_guesses) && (i < k); j++) {
+        if (guesses[j].score == threshold) {
+            if (i != j) {
+                swap_guess(&guesses[i], &guesses[j]);
+            }
+            i++;
+        }
+    }
+
+    // best guess to the front
+    unsigned int best = 0;
+    for (i = 1; i < k; i++) {
+        if (guesses[i].score > guesses[best].score) {
+            best = i;
+        }
+    }
+    if (best != 0) {
+        swap_guess(&guesses[0], &guesses[best]);
+    }
+}
+
+
 /* expand all guesses in first half of (sorted) table by
  * copying them into the second half and extending the copied
  * ones with an extra 1, leaving the first half with an extra 0 */
@@ -591,13 +721,6 @@ static void execute_round(unsigned int size) {
     // score all the current guesses
     score_all_traces(size);
 
-    // sort the guesses by score
-    qsort(guesses, num_guesses, sizeof(struct guess), cmp_guess);
-
-    if (supplied_testkey) {
-        check_supplied_testkey(size);
-    }
-
     // identify limit
     if (num_guesses < (maxtablesize / 2)) {
         halfsize = num_guesses;
@@ -605,6 +728,16 @@ static void execute_round(unsigned int size) {
         halfsize = (maxtablesize / 2);
     }
 
+    // keep the best halfsize guesses, only the last round needs them in order
+    select_guesses(halfsize);
+    if (size == 48) {
+        qsort(guesses, halfsize, sizeof(struct guess), cmp_guess);
+    }
+
+    if (supplied_testkey) {
+        check_supplied_testkey(size);
+    }
+
     // expand guesses
     expand_guesses(halfsize, size);
 
@@ -813,6 +946,8 @@ int main(int argc, char *argv[]) {
 
     create_guess_table();
 
+    init_prob_tables();
+
     init_guess_table(noncefilestr, uidstr);
 
     if ((tot_nRaR > 0) && (tot_nRaR <= num_nRaR)) {
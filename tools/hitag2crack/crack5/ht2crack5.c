@@ -18,7 +18,9 @@
 #include <stdlib.h>
 #include <inttypes.h>
 #include <pthread.h>
+#include <time.h>
 #include "ht2crackutils.h"
+#include "shard.h"
 
 const uint8_t bits[9] = {20, 14, 4, 3, 1, 1, 1, 1, 1};
 #define lfsr_inv(state) (((state)<<1) | (__builtin_parityll((state) & ((0xce0044c101cd>>1)|(1ull<<(47))))))
@@ -118,13 +120,33 @@ bitslice_t initial_bitslices[48];
 size_t filter_pos[20] = {4, 7, 9, 13, 16, 18, 22, 24, 27, 30, 32, 35, 45, 47  };
 size_t thread_count = 8;
 uint64_t layer_0_found;
+
+// --range / --shard / --progress over the layer 0 candidate index
+static shard_t g_shard;
+static uint64_t g_resume;
+static uint64_t *g_thread_pos;
+static size_t g_threads_done;
+
+// every candidate below the slowest thread has been searched
+static uint64_t progress_watermark(void) {
+    uint64_t low = g_shard.end;
+    for (size_t i = 0; i < thread_count; i++) {
+        uint64_t p = __atomic_load_n(&g_thread_pos[i], __ATOMIC_ACQUIRE);
+        if (p < low) {
+            low = p;
+        }
+    }
+    return low;
+}
 static void *find_state(void *thread_d);
 static void try_state(uint64_t s);
 
 int main(int argc, char *argv[]) {
 
-    if (argc < 6) {
-        printf("%s UID {nR1} {aR1} {nR2} {aR2}\n", argv[0]);
+    if (shard_parse_args(&g_shard, "ht2crack5", &argc, argv) == false || argc < 6) {
+        printf("%s UID {nR1} {aR1} {nR2} {aR2} [options]\n\n", argv[0]);
+        printf("layer 0 candidate indexes are the search index for --range\n");
+        shard_usage();
         exit(1);
     }
 
@@ -188,15 +210,33 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    g_resume = shard_apply(&g_shard, 0, layer_0_found);
+    g_thread_pos = calloc(thread_count, sizeof(uint64_t));
+    for (size_t thread = 0; thread < thread_count; thread++) {
+        g_thread_pos[thread] = g_resume;
+    }
+
     // start threads and wait on them
     pthread_t thread_handles[thread_count];
     for (size_t thread = 0; thread < thread_count; thread++) {
         pthread_create(&thread_handles[thread], NULL, find_state, (void *) thread);
     }
+
+    // refresh the progress file every minute while the threads run
+    time_t t_progress = time(NULL);
+    while (__atomic_load_n(&g_threads_done, __ATOMIC_SEQ_CST) < thread_count) {
+        usleep(100000);
+        if (time(NULL) - t_progress >= 60) {
+            shard_progress(&g_shard, progress_watermark(), NULL);
+            t_progress = time(NULL);
+        }
+    }
+
     for (size_t thread = 0; thread < thread_count; thread++) {
         pthread_join(thread_handles[thread], NULL);
     }
 
+    shard_progress(&g_shard, progress_watermark(), NULL);
     printf("Key not found\n");
     exit(1);
 }
@@ -204,10 +244,15 @@ int main(int argc, char *argv[]) {
 static void *find_state(void *thread_d) {
     uint64_t thread = (uint64_t)thread_d;
 
-    for (uint64_t index = thread; index < layer_0_found; index += thread_count) {
+    uint64_t first = g_resume + thread;
+    uint64_t count = g_shard.end - g_resume;
 
-        if (((index / thread_count) & 0xFF) == 0)
-            printf("Thread %" PRIu64 " slice %" PRIu64 "/%" PRIu64 "\n", thread, index / thread_count / 256 + 1, layer_0_found / thread_count / 256);
+    for (uint64_t index = first; index < g_shard.end; index += thread_count) {
+
+        __atomic_store_n(&g_thread_pos[thread], index, __ATOMIC_RELEASE);
+
+        if ((((index - first) / thread_count) & 0xFF) == 0)
+            printf("Thread %" PRIu64 " slice %" PRIu64 "/%" PRIu64 "\n", thread, (index - first) / thread_count / 256 + 1, count / thread_count / 256);
 
         uint64_t state0 = candidates[index];
         bitslice(state0 >> 2, &state[0], 46, false);
@@ -797,6 +842,9 @@ static void *find_state(void *thread_d) {
             } // 2
         } // 1
     } // 0
+
+    __atomic_store_n(&g_thread_pos[thread], g_shard.end, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&g_threads_done, 1, __ATOMIC_SEQ_CST);
     return NULL;
 }
 
@@ -822,12 +870,13 @@ static void try_state(uint64_t s) {
 
         uint64_t key = rev64(keyrev);
 
-        printf("Key: ");
+        char found[13] = {0};
         for (int i = 0; i < 6; i++) {
-            printf("%02X", (uint8_t)(key & 0xff));
+            snprintf(found + (i * 2), sizeof(found) - (i * 2), "%02X", (uint8_t)(key & 0xff));
             key = key >> 8;
         }
-        printf("\n");
+        printf("Key: %s\n", found);
+        shard_progress(&g_shard, progress_watermark(), found);
         exit(0);
     }
 }
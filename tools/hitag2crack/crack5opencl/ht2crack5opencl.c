@@ -1161,6 +1161,7 @@ int main(int argc, char **argv) {
         t_arg[z].nR1 = nR1;
         t_arg[z].nR2 = nR2;
         t_arg[z].max_slices = max_step;
+        t_arg[z].keys_per_slice = (1ULL << 48) / max_step; // the slices split the 48 bit state space
         t_arg[z].ocl_ctx = &ctx;
         t_arg[z].device_id = z;
         t_arg[z].thread_ctx = &th_ctx;
@@ -1291,6 +1292,12 @@ int main(int argc, char **argv) {
         printf("\n");
     }
 
+    // per device throughput, shows how the work was balanced
+    if (thread_count > 1 || verbose) {
+        thread_print_stats(&th_ctx, t_arg);
+        printf("\n");
+    }
+
     fflush(stdout);
 
 #if DEBUGME > 1
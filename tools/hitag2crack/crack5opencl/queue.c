@@ -237,6 +237,16 @@ int wu_queue_done(wu_queue_ctx_t *ctx) {
     return ERROR_QUEUE_TYPE_INVALID;
 }
 
+size_t wu_queue_size(wu_queue_ctx_t *ctx) {
+    if (!ctx || !ctx->init) return 0;
+
+    pthread_mutex_lock(&ctx->queue_mutex);
+    size_t size = ctx->queue_size;
+    pthread_mutex_unlock(&ctx->queue_mutex);
+
+    return size;
+}
+
 int wu_queue_push(wu_queue_ctx_t *ctx, size_t id, size_t off, size_t max) {
     if (!ctx) return ERROR_CTX_NULL;
     if (!ctx->init) return ERROR_CTX_IS_NOT_INIT;
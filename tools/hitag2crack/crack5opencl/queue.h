@@ -103,6 +103,7 @@ typedef struct wu_queue_ctx {
 // exports
 int wu_queue_init(wu_queue_ctx_t *ctx, wu_queue_type_t queue_type);
 int wu_queue_done(wu_queue_ctx_t *ctx);
+size_t wu_queue_size(wu_queue_ctx_t *ctx);
 int wu_queue_push(wu_queue_ctx_t *ctx, size_t id, size_t off, size_t max);
 int wu_queue_pop(wu_queue_ctx_t *ctx, wu_queue_data_t *wu, short remove);
 int wu_queue_destroy(wu_queue_ctx_t *ctx);
@@ -23,6 +23,7 @@ License: GNU General Public License v3 or any later version (see LICENSE.txt)
 ****************************************************************************/
 
 #include "threads.h"
+#include <sys/time.h>
 
 const char *thread_strerror(int error) {
     switch (error) {
@@ -63,6 +64,58 @@ const char *thread_strerror(int error) {
     return (const char *) "GENERIC";
 }
 
+static double thread_now(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + ((double) tv.tv_usec / 1000000.0);
+}
+
+// device throughput in Mkeys/s, 0 until the first slice is done
+static double thread_rate(const thread_args_t *a) {
+    if (a->slice_time <= 0) return 0;
+    return ((double) a->keys_per_slice / a->slice_time) / 1000000.0;
+}
+
+static void thread_update_rate(thread_args_t *a, double elapsed) {
+    // moving average, follows clock changes (thermal throttling) without jumping around
+    a->slice_time = (a->slice_time <= 0) ? elapsed : (a->slice_time * 0.75) + (elapsed * 0.25);
+    a->slices_done++;
+}
+
+// Near the end of the queue a slow device would still be busy with its slice when the
+// faster ones have drained the rest. Keep it waiting if the others finish the remaining
+// slices before it could finish one.
+static bool thread_hold_slow_device(thread_ctx_t *ctx, thread_args_t *t_arg, size_t z, wu_queue_ctx_t *queue_ctx) {
+    pthread_mutex_lock(&ctx->thread_mutexs[z]);
+    double slice_time = t_arg[z].slice_time;
+    pthread_mutex_unlock(&ctx->thread_mutexs[z]);
+
+    if (slice_time <= 0) return false;
+
+    double rate_others = 0;
+    for (size_t i = 0; i < ctx->thread_count; i++) {
+        if (i == z) continue;
+
+        pthread_mutex_lock(&ctx->thread_mutexs[i]);
+        if (t_arg[i].slice_time > 0 && (t_arg[i].status == TH_WAIT || t_arg[i].status == TH_PROCESSING)) {
+            rate_others += 1.0 / t_arg[i].slice_time;
+        }
+        pthread_mutex_unlock(&ctx->thread_mutexs[i]);
+    }
+
+    if (rate_others <= 0) return false;
+
+    size_t remain = wu_queue_size(queue_ctx);
+    return (slice_time > ((double) remain / rate_others));
+}
+
+void thread_print_stats(thread_ctx_t *ctx, thread_args_t *t_arg) {
+    for (size_t z = 0; z < ctx->thread_count; z++) {
+        printf("[%zu] %zu slice(s), %.2f Mkeys/s\n", z, t_arg[z].slices_done, thread_rate(&t_arg[z]));
+    }
+    fflush(stdout);
+}
+
 int thread_init(thread_ctx_t *ctx, short type, size_t thread_count) {
     if (!ctx) return THREAD_ERROR_CTX_IS_NULL;
     if (ctx->init) return THREAD_ERROR_CTX_IS_INIT;
@@ -265,6 +318,10 @@ int thread_start_scheduler(thread_ctx_t *ctx, thread_args_t *t_arg, wu_queue_ctx
                 }
 
                 if (cur_status == TH_WAIT) {
+                    if (thread_hold_slow_device(ctx, t_arg, z, queue_ctx)) {
+                        continue;
+                    }
+
                     pthread_mutex_lock(&ctx->thread_mutexs[z]);
 
                     if (wu_queue_done(queue_ctx) != QUEUE_EMPTY) {
@@ -514,19 +571,21 @@ void *computing_process(void *arg) {
         printf("[%zu] Slice %5zu (off %6zu), max %5zu, remain %5zu slice(s)\n", z, wu.id + 1, wu.off, wu.max, wu.rem);
 #else
         float progress = 100.0 - (((wu.rem + 1) * 100.0) / wu.max);
-        printf("\r[%zu] Slice %5zu/%5zu (%5zu remain) ( %2.1f%% )", z, wu.id + 1, wu.max, wu.rem, progress);
+        printf("\r[%zu] Slice %5zu/%5zu (%5zu remain) ( %2.1f%% ) %8.2f Mkeys/s", z, wu.id + 1, wu.max, wu.rem, progress, thread_rate(a));
 #endif // DEBUGME
     } else {
 #if DEBUGME > 0
         printf("[%zu] Slice %zu/%zu, off %zu\n", z, wu.id + 1, wu.max, wu.off);
 #else
         float progress = (((wu.id + 1) * 100.0) / wu.max);
-        printf("\r[%zu] Slice %zu/%zu ( %2.1f%% )", z, wu.id + 1, wu.max, progress);
+        printf("\r[%zu] Slice %zu/%zu ( %2.1f%% ) %8.2f Mkeys/s", z, wu.id + 1, wu.max, progress, thread_rate(a));
 #endif // DEBUGME
     }
     fflush(stdout);
 
+    double t_start = thread_now();
     int ret = runKernel(ctx, (uint32_t) off, matches, matches_found, z);
+    if (ret >= 0) thread_update_rate(a, thread_now() - t_start);
 
     a->r = false;
     a->err = false;
@@ -669,20 +728,26 @@ void *computing_process_async(void *arg) {
                 printf("[%zu] Slice %5zu (off %6zu), max %5zu, remain %5zu slice(s)\n", z, wu.id + 1, wu.off, wu.max, wu.rem);
 #else
                 float progress = 100.0 - (((wu.rem + 1) * 100.0) / wu.max);
-                printf("\r[%zu] Slice %5zu/%5zu (%5zu remain) ( %2.1f%% )", z, wu.id + 1, wu.max, wu.rem, progress);
+                printf("\r[%zu] Slice %5zu/%5zu (%5zu remain) ( %2.1f%% ) %8.2f Mkeys/s", z, wu.id + 1, wu.max, wu.rem, progress, thread_rate(a));
 #endif // DEBUGME
             } else {
 #if DEBUGME > 0
                 printf("[%zu] Slice %zu/%zu, off %zu\n", z, wu.id + 1, wu.max, wu.off);
 #else
                 float progress = (((wu.id + 1) * 100.0) / wu.max);
-                printf("\r[%zu] Slice %zu/%zu ( %2.1f%% )", z, wu.id + 1, wu.max, progress);
+                printf("\r[%zu] Slice %zu/%zu ( %2.1f%% ) %8.2f Mkeys/s", z, wu.id + 1, wu.max, progress, thread_rate(a));
 #endif // DEBUGME
             }
 
             fflush(stdout);
 
+            double t_start = thread_now();
             int ret = runKernel(ctx, off, matches, matches_found, z);
+            if (ret >= 0) {
+                pthread_mutex_lock(&a->thread_ctx->thread_mutexs[z]);
+                thread_update_rate(a, thread_now() - t_start);
+                pthread_mutex_unlock(&a->thread_ctx->thread_mutexs[z]);
+            }
 
             if (ret < 1) { // error or nada
                 if (ret == -1) {
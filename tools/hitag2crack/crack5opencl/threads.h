@@ -117,6 +117,11 @@ typedef struct thread_arg {
 
     uint64_t key;
 
+    // throughput, used by the async scheduler to balance devices of different speed
+    uint64_t keys_per_slice;
+    double slice_time;      // average seconds per slice, 0 until the first slice is done
+    size_t slices_done;
+
     opencl_ctx_t *ocl_ctx;
     thread_ctx_t *thread_ctx;
 
@@ -127,6 +132,7 @@ int thread_start(thread_ctx_t *ctx, thread_args_t *t_arg);
 int thread_stop(thread_ctx_t *ctx);
 int thread_start_scheduler(thread_ctx_t *ctx, thread_args_t *t_arg, wu_queue_ctx_t *queue_ctx);
 bool thread_setEnd(thread_ctx_t *ctx, thread_args_t *t_arg);
+void thread_print_stats(thread_ctx_t *ctx, thread_args_t *t_arg);
 
 const char *thread_strerror(int error);
 const char *thread_status_strdesc(thread_status_t s);
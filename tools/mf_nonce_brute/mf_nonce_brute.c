@@ -9,9 +9,11 @@
 #include <unistd.h>
 #include <ctype.h>
 #include "crapto1/crapto1.h"
+#include "crypto1_bs.h"
 #include "protocol.h"
 #include "iso14443crc.h"
 #include "util_posix.h"
+#include "shard.h"
 
 #define AEND  "\x1b[0m"
 #define _RED_(s) "\x1b[31m" s AEND
@@ -135,6 +137,16 @@ static int global_found_candidate = 0;
 static uint64_t global_candidate_key = 0;
 static int thread_count = 2;
 
+// tag nonces passing the parity checks, consumed by the brute_thread workers
+static uint32_t g_nt_candidates[0x10000];
+static uint32_t g_nt_count = 0;
+static uint32_t g_nt_next = 0;
+
+// --range / --shard / --progress over the upper 16 bits of the tag nonce
+static shard_t g_shard;
+static uint32_t g_nt_first = 0;
+static char g_found_str[32] = {0};
+
 static int param_getptr(const char *line, int *bg, int *en, int paramnum) {
     int i;
     int len = strlen(line);
@@ -391,6 +403,20 @@ static bool candidate_nonce(uint32_t xored, uint32_t nt, bool ev1) {
     return true;
 }
 
+// Runs the cheap parity filter over all 2^16 tag nonces up front.
+// Only the survivors need a lfsr_recovery64(), which is where the time goes.
+static uint32_t collect_nonces(uint16_t xored, bool ev1) {
+    g_nt_count = 0;
+    g_nt_next = 0;
+    for (uint32_t count = g_nt_first; count < g_shard.end; count++) {
+        uint32_t nt = count << 16 | prng_successor(count, 16);
+        if (candidate_nonce(xored, nt, ev1)) {
+            g_nt_candidates[g_nt_count++] = nt;
+        }
+    }
+    return g_nt_count;
+}
+
 static bool checkValidCmd(uint32_t decrypted) {
     uint8_t cmd = (decrypted >> 24) & 0xFF;
     for (int i = 0; i < 8; ++i) {
@@ -481,6 +507,7 @@ static void *check_default_keys(void *arguments) {
         printf("enc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
         printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
         printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
+        snprintf(g_found_str, sizeof(g_found_str), "%012" PRIx64, key);
         pthread_mutex_unlock(&print_lock);
         break;
     }
@@ -500,21 +527,21 @@ static void *brute_thread(void *arguments) {
     uint32_t nt;      // current tag nonce
 
     uint32_t p64 = 0;
-    // TC == 4  (
-    // threads calls 0 ev1 == false
-    // threads calls 0,1,2  ev1 == true
-    for (uint32_t count = args->idx; count <= 0xFFFF; count += thread_count) {
+    // the state recovery dominates, so the workers pull one tag nonce at a time from the
+    // queue instead of a fixed stride. Nobody sits idle while another one still has a backlog
+    for (;;) {
 
         if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
             break;
         }
 
-        nt = count << 16 | prng_successor(count, 16);
-
-        if (candidate_nonce(args->xored, nt, args->ev1) == false) {
-            continue;
+        uint32_t idx = __atomic_fetch_add(&g_nt_next, 1, __ATOMIC_SEQ_CST);
+        if (idx >= g_nt_count) {
+            break;
         }
 
+        nt = g_nt_candidates[idx];
+
         p64 = prng_successor(nt, 64);
         ks2 = ar_enc ^ p64;
         ks3 = at_enc ^ prng_successor(p64, 32);
@@ -576,10 +603,12 @@ static void *brute_thread(void *arguments) {
         if (args->ev1) {
             // if it was EV1,  we know for sure xxxAAAAAAAA recovery
             printf("\nKey candidate [ " _YELLOW_("....%08" PRIx64)" ]\n\n", key & 0xFFFFFFFF);
+            snprintf(g_found_str, sizeof(g_found_str), "....%08" PRIx64, key & 0xFFFFFFFF);
             __sync_fetch_and_add(&global_found_candidate, 1);
         } else {
             printf("\nKey candidate [ " _GREEN_("....%08" PRIx64) " ]", key & 0xFFFFFFFF);
             printf("\nKey candidate [ " _GREEN_("%12" PRIx64) " ]\n\n", key);
+            snprintf(g_found_str, sizeof(g_found_str), "%012" PRIx64, key);
             __sync_fetch_and_add(&global_found, 1);
         }
         // release lock
@@ -591,53 +620,84 @@ static void *brute_thread(void *arguments) {
     return NULL;
 }
 
+// keys run through the bitsliced crypto1 per batch
+#define KEY_BATCH  (1024)
+
 static void *brute_key_thread(void *arguments) {
 
     struct thread_key_args *args = (struct thread_key_args *) arguments;
-    uint64_t key;
     uint8_t local_enc[args->enc_len];
     memcpy(local_enc, args->enc, args->enc_len);
 
-    for (uint64_t count = args->idx; count <= 0xFFFF; count += thread_count) {
+    // checkValidCmdByte looks at 18 bytes at most
+    uint8_t chk_len = (args->enc_len < CRYPTO1_BS_MAX_BYTES) ? args->enc_len : CRYPTO1_BS_MAX_BYTES;
+
+    // NESTED, clock nt, nr, ar, at and then the keystream of the next command
+    crypto1_bs_job_t job = {
+        .nwords = 4,
+        .encrypted = 0x03,
+        .in = { args->nt_enc ^ args->uid, args->nr_enc, 0, 0 },
+        .nbytes = chk_len,
+    };
+
+    uint64_t keys[KEY_BATCH];
+    uint8_t ks[KEY_BATCH * CRYPTO1_BS_MAX_BYTES];
+
+    uint64_t count = args->idx;
+    while (count <= 0xFFFF) {
 
         if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
             break;
         }
 
-        key = args->part_key | (count << 32);
+        uint32_t n = 0;
+        for (; n < KEY_BATCH && count <= 0xFFFF; n++, count += thread_count) {
+            keys[n] = args->part_key | (count << 32);
+        }
 
-        // Init cipher with key
-        struct Crypto1State *pcs = crypto1_create(key);
+        crypto1_bs_run(&job, keys, n, NULL, ks);
 
-        // NESTED decrypt nt with help of new key
-        crypto1_word(pcs, args->nt_enc ^ args->uid, 1);
-        crypto1_word(pcs, args->nr_enc, 1);
-        crypto1_word(pcs, 0, 0);
-        crypto1_word(pcs, 0, 0);
+        for (uint32_t k = 0; k < n; k++) {
 
-        // decrypt 22 bytes
-        uint8_t dec[args->enc_len];
-        for (int i = 0; i < args->enc_len; i++) {
-            dec[i] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[i];
-        }
+            uint8_t *dec = ks + k * chk_len;
+            for (int i = 0; i < chk_len; i++) {
+                dec[i] ^= local_enc[i];
+            }
 
-        crypto1_destroy(pcs);
+            // check if cmd exists
+            if (checkValidCmdByte(dec, chk_len) == false) {
+                continue;
+            }
 
-        // check if cmd exists
-        if (checkValidCmdByte(dec, args->enc_len) == false) {
-            continue;
-        }
+            uint64_t key = keys[k];
 
-        __sync_fetch_and_add(&global_found, 1);
+            // Init cipher with key, decrypt everything for printing
+            struct Crypto1State *pcs = crypto1_create(key);
+            crypto1_word(pcs, args->nt_enc ^ args->uid, 1);
+            crypto1_word(pcs, args->nr_enc, 1);
+            crypto1_word(pcs, 0, 0);
+            crypto1_word(pcs, 0, 0);
 
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
-        printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
-        printf("dec:  %s\n", sprint_hex_inrow_ex(dec, args->enc_len, 0));
-        printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
-        pthread_mutex_unlock(&print_lock);
-        break;
+            uint8_t full[args->enc_len];
+            for (int i = 0; i < args->enc_len; i++) {
+                full[i] = crypto1_byte(pcs, 0x00, 0) ^ local_enc[i];
+            }
+
+            crypto1_destroy(pcs);
+
+            __sync_fetch_and_add(&global_found, 1);
+
+            // lock this section to avoid interlacing prints from different threats
+            pthread_mutex_lock(&print_lock);
+            printf("\nenc:  %s\n", sprint_hex_inrow_ex(local_enc, args->enc_len, 0));
+            printf("dec:  %s\n", sprint_hex_inrow_ex(full, args->enc_len, 0));
+            printf("\nValid Key found [ " _GREEN_("%012" PRIx64) " ]\n\n", key);
+            snprintf(g_found_str, sizeof(g_found_str), "%012" PRIx64, key);
+            pthread_mutex_unlock(&print_lock);
+            goto out;
+        }
     }
+out:
     free(args);
     return NULL;
 }
@@ -662,12 +722,17 @@ static int usage(void) {
     printf("enc:  A4F7F398EBDB4E484D1CB2B174B939D18B469F3FA5D9CAABBFA018EC7E0CC5721DE2E590F64BD0A5B4EFCE71\n");
     printf("dec:  30084A24302F8102F44CA5020500A60881010104763930084A24302F8102F44CA5020500A608810101047639\n");
     printf("Valid Key found: [3b7e4fd575ad]\n\n");
+    printf("the upper 16 bits of the tag nonce are the search index for --range (0:65536)\n");
+    shard_usage();
+    printf("\n");
     return 1;
 }
 
-int main(int argc, const char *argv[]) {
+int main(int argc, char *argv[]) {
     printf("\nMifare classic nested auth key recovery\n\n");
 
+    if (shard_parse_args(&g_shard, "mf_nonce_brute", &argc, argv) == false) return usage();
+
     if (argc < 9) return usage();
 
     sscanf(argv[1], "%x", &uid);
@@ -741,10 +806,12 @@ int main(int argc, const char *argv[]) {
         }
     }
 
+    g_nt_first = shard_apply(&g_shard, 0, 0x10000);
+
     printf("\n----------- " _CYAN_("Phase 2 examine") " -------------------------------\n");
     printf("Looking for the last bytes of the encrypted tagnonce\n");
     printf("\nTarget old MFC...\n");
-    // the rest of available threads to EV1 scenario
+    printf("tag nonce candidates. " _YELLOW_("%u") "\n", collect_nonces(xored, false));
     for (int i = 0; i < thread_count; ++i) {
         struct thread_args *a = calloc(1, sizeof(struct thread_args));
         a->xored = xored;
@@ -766,7 +833,7 @@ int main(int argc, const char *argv[]) {
         printf("\nTarget MFC Ev1...\n");
 
         t1 = msclock();
-        // the rest of available threads to EV1 scenario
+        printf("tag nonce candidates. " _YELLOW_("%u") "\n", collect_nonces(xored, true));
         for (int i = 0; i < thread_count; ++i) {
             struct thread_args *a = calloc(1, sizeof(struct thread_args));
             a->xored = xored;
@@ -833,6 +900,9 @@ int main(int argc, const char *argv[]) {
     }
 
 out:
+    // a run is not resumable half way, it either covered its whole slice or found the key
+    shard_progress(&g_shard, g_shard.end, (g_found_str[0]) ? g_found_str : NULL);
+
     // clean up mutex
     pthread_mutex_destroy(&print_lock);
     return 0;
@@ -1,157 +1,163 @@
 #ifndef __AES_NI_H__
 #define __AES_NI_H__
 
-#include "aes-ni.h"
-// #include <stdint.h>     //for int8_t
-// #include <string.h>     //for memcmp
-// #include <wmmintrin.h>  //for intrinsics for AES-NI
-//compile using gcc and following arguments: -g;-O0;-Wall;-msse2;-msse;-march=native;-maes
+// Multi-buffer AES-128 ECB decryption for the key search tools.
+//
+// Every call expands AES_NI_LANES keys and runs up to AES_NI_MAX_BLOCKS ciphertext
+// blocks through all of them.  The lanes are interleaved round by round, so the
+// latency of the AES instructions is hidden behind the other lanes.
+//
+// x86  needs AES-NI      (-maes, or -march=native on a capable CPU)
+// ARM  needs crypto ext  (-mcpu=native on a capable CPU)
+//
+// AES_NI_AVAILABLE is only defined when this build carries one of the two paths,
+// callers still have to check the CPU at runtime (detectaes.h) on x86.
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AES_NI_LANES      8
+#define AES_NI_MAX_BLOCKS 2
+
+#if defined(__AES__) && (defined(__x86_64__) || defined(__i386__))
+
+#define AES_NI_AVAILABLE
+#include <wmmintrin.h>  // AES-NI intrinsics
+#include <emmintrin.h>
+
+static inline __m128i aes128_assist(__m128i k, __m128i t) {
+    t = _mm_shuffle_epi32(t, 0xff);
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    k = _mm_xor_si128(k, _mm_slli_si128(k, 4));
+    return _mm_xor_si128(k, t);
+}
 
-/*
-static void AES_CBC_decrypt(const uint8_t *in,  uint8_t *out,  uint8_t iv[],  uint8_t len, uint8_t *key) {
+// aeskeygenassist needs the round constant as an immediate
+#define AES128_EXPAND_ROUND(r, rcon) \
+    for (int l = 0; l < AES_NI_LANES; l++) { \
+        rk[l][r] = aes128_assist(rk[l][(r) - 1], _mm_aeskeygenassist_si128(rk[l][(r) - 1], (rcon))); \
+    }
 
-    __m128i data, last_in;
-    __m128i feedback = _mm_loadu_si128 ((__m128i*)iv);
+static inline void aes128_ecb_decrypt_multi(const uint8_t keys[AES_NI_LANES][16], const uint8_t *in, uint8_t nblocks, uint8_t out[AES_NI_LANES][AES_NI_MAX_BLOCKS * 16]) {
 
-    uint j;
-    for (uint8_t i = 0; i < len; i++){
-        last_in =_mm_loadu_si128 (&((__m128i*)in)[i]);
-        data = _mm_xor_si128 (last_in, ((__m128i*)key)[0]);
+    __m128i rk[AES_NI_LANES][11];
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        rk[l][0] = _mm_loadu_si128((const __m128i *)keys[l]);
+    }
 
-        for (j = 1; j < 10; j++){
-            data = _mm_aesdec_si128 (data, ((__m128i*)key)[j]);
+    AES128_EXPAND_ROUND(1, 0x01);
+    AES128_EXPAND_ROUND(2, 0x02);
+    AES128_EXPAND_ROUND(3, 0x04);
+    AES128_EXPAND_ROUND(4, 0x08);
+    AES128_EXPAND_ROUND(5, 0x10);
+    AES128_EXPAND_ROUND(6, 0x20);
+    AES128_EXPAND_ROUND(7, 0x40);
+    AES128_EXPAND_ROUND(8, 0x80);
+    AES128_EXPAND_ROUND(9, 0x1b);
+    AES128_EXPAND_ROUND(10, 0x36);
+
+    // equivalent inverse cipher,  round keys 1..9 go through InvMixColumns
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        for (int r = 1; r < 10; r++) {
+            rk[l][r] = _mm_aesimc_si128(rk[l][r]);
         }
-        data = _mm_aesdeclast_si128 (data,((__m128i*)key)[j]);
-        data = _mm_xor_si128 (data, feedback);
-        _mm_storeu_si128 (&((__m128i*)out)[i], data);
-        feedback = last_in;
     }
-}
-*/
-
-/*
-INLINE static __m128i AES_128_ASSIST (__m128i temp1, __m128i temp2) {
-    __m128i temp3;
-    temp2 = _mm_shuffle_epi32 (temp2 ,0xff);
-    temp3 = _mm_slli_si128 (temp1, 0x4);
-    temp1 = _mm_xor_si128 (temp1, temp3);
-    temp3 = _mm_slli_si128 (temp3, 0x4);
-    temp1 = _mm_xor_si128 (temp1, temp3);
-    temp3 = _mm_slli_si128 (temp3, 0x4);
-    temp1 = _mm_xor_si128 (temp1, temp3);
-    temp1 = _mm_xor_si128 (temp1, temp2);
-    return temp1;
-}
 
-static void AES_128_Key_Expansion (uint8_t *userkey, __m128i *key) {
-    __m128i temp1, temp2;
-    temp1 = _mm_loadu_si128((__m128i*)userkey);
-    key[0] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1 ,0x1);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[1] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x2);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[2] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x4);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[3] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x8);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[4] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x10);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[5] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x20);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[6] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x40);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[7] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x80);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[8] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x1b);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[9] = temp1;
-    temp2 = _mm_aeskeygenassist_si128 (temp1,0x36);
-    temp1 = AES_128_ASSIST(temp1, temp2);
-    key[10] = temp1;
-}
+    __m128i s[AES_NI_LANES][AES_NI_MAX_BLOCKS];
+    for (int b = 0; b < nblocks; b++) {
+        __m128i c = _mm_loadu_si128((const __m128i *)(in + (b * 16)));
+        for (int l = 0; l < AES_NI_LANES; l++) {
+            s[l][b] = _mm_xor_si128(c, rk[l][10]);
+        }
+    }
 
-static void aes_inv_key_10(AESContext * ctx) {
-
-    __m128i* keysched = (__m128i*)ctx->keysched;
-    __m128i* invkeysched = (__m128i*)ctx->invkeysched;
-
-    *(invkeysched + 10) = *(keysched + 0);
-    *(invkeysched + 9) = _mm_aesimc_si128(*(keysched + 1));
-    *(invkeysched + 8) = _mm_aesimc_si128(*(keysched + 2));
-    *(invkeysched + 7) = _mm_aesimc_si128(*(keysched + 3));
-    *(invkeysched + 6) = _mm_aesimc_si128(*(keysched + 4));
-    *(invkeysched + 5) = _mm_aesimc_si128(*(keysched + 5));
-    *(invkeysched + 4) = _mm_aesimc_si128(*(keysched + 6));
-    *(invkeysched + 3) = _mm_aesimc_si128(*(keysched + 7));
-    *(invkeysched + 2) = _mm_aesimc_si128(*(keysched + 8));
-    *(invkeysched + 1) = _mm_aesimc_si128(*(keysched + 9));
-    *(invkeysched + 0) = *(keysched + 10);
+    for (int r = 9; r > 0; r--) {
+        for (int l = 0; l < AES_NI_LANES; l++) {
+            for (int b = 0; b < nblocks; b++) {
+                s[l][b] = _mm_aesdec_si128(s[l][b], rk[l][r]);
+            }
+        }
+    }
+
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        for (int b = 0; b < nblocks; b++) {
+            _mm_storeu_si128((__m128i *)(out[l] + (b * 16)), _mm_aesdeclast_si128(s[l][b], rk[l][0]));
+        }
+    }
 }
 
-static void aes_decrypt_cbc_ni(const uint8_t *in,  uint8_t *out,  uint8_t iv[],  uint8_t len, uint8_t *key) {
+#elif defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
 
-    __m128i dec = _mm_setzero_si128();
-    __m128i* block = (__m128i*)in;
-    const __m128i* finish = (__m128i*)(in + len);
+#define AES_NI_AVAILABLE
+#include <arm_neon.h>
 
-    // Load IV
-    __m128i iv = _mm_loadu_si128((__m128i*)iv);
+// SubWord() of the key schedule.  With the word in every column ShiftRows is a no-op,
+// so AESE with a zero round key leaves SubBytes of the word in each column.
+static inline uint32_t aes128_subword(uint32_t w) {
+    uint8x16_t v = vaeseq_u8(vreinterpretq_u8_u32(vdupq_n_u32(w)), vdupq_n_u8(0));
+    return vgetq_lane_u32(vreinterpretq_u32_u8(v), 0);
+}
 
-    while (block < finish) {
+static inline void aes128_ecb_decrypt_multi(const uint8_t keys[AES_NI_LANES][16], const uint8_t *in, uint8_t nblocks, uint8_t out[AES_NI_LANES][AES_NI_MAX_BLOCKS * 16]) {
 
-        // Key schedule ptr
-        __m128i* keysched = (__m128i*)ctx->invkeysched;
-        __m128i last = _mm_loadu_si128(block);
+    static const uint8_t rcon[10] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1b, 0x36 };
 
-        dec  = _mm_xor_si128(last, *keysched);
+    uint32_t w[AES_NI_LANES][44];
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        for (int i = 0; i < 4; i++) {
+            w[l][i] = (uint32_t)keys[l][(i * 4)] | ((uint32_t)keys[l][(i * 4) + 1] << 8) |
+                      ((uint32_t)keys[l][(i * 4) + 2] << 16) | ((uint32_t)keys[l][(i * 4) + 3] << 24);
+        }
+    }
 
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdec_si128(dec, *(++keysched));
-        dec = _mm_aesdeclast_si128(dec, *(++keysched));
+    for (int r = 0; r < 10; r++) {
+        for (int l = 0; l < AES_NI_LANES; l++) {
+            uint32_t *p = &w[l][r * 4];
+            uint32_t t = p[3];
+            t = aes128_subword((t >> 8) | (t << 24)) ^ rcon[r];
+            p[4] = p[0] ^ t;
+            p[5] = p[1] ^ p[4];
+            p[6] = p[2] ^ p[5];
+            p[7] = p[3] ^ p[6];
+        }
+    }
 
-        /// Xor data with IV
-        dec  = _mm_xor_si128(iv, dec);
+    // equivalent inverse cipher,  round keys 1..9 go through InvMixColumns
+    uint8x16_t rk[AES_NI_LANES][11];
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        for (int r = 0; r < 11; r++) {
+            rk[l][r] = vreinterpretq_u8_u32(vld1q_u32(&w[l][r * 4]));
+            if (r > 0 && r < 10) {
+                rk[l][r] = vaesimcq_u8(rk[l][r]);
+            }
+        }
+    }
 
-        // Store data
-        _mm_storeu_si128(block, dec);
-        iv = last;
+    uint8x16_t s[AES_NI_LANES][AES_NI_MAX_BLOCKS];
+    for (int b = 0; b < nblocks; b++) {
+        uint8x16_t c = vld1q_u8(in + (b * 16));
+        for (int l = 0; l < AES_NI_LANES; l++) {
+            s[l][b] = c;
+        }
+    }
 
-        // Go to next block
-        ++block;
+    // AESD adds the round key first, AESIMC finishes the round
+    for (int r = 10; r > 1; r--) {
+        for (int l = 0; l < AES_NI_LANES; l++) {
+            for (int b = 0; b < nblocks; b++) {
+                s[l][b] = vaesimcq_u8(vaesdq_u8(s[l][b], rk[l][r]));
+            }
+        }
     }
 
-    // Update IV
-    _mm_storeu_si128((__m128i*)iv, dec);
+    for (int l = 0; l < AES_NI_LANES; l++) {
+        for (int b = 0; b < nblocks; b++) {
+            vst1q_u8(out[l] + (b * 16), veorq_u8(vaesdq_u8(s[l][b], rk[l][1]), rk[l][0]));
+        }
+    }
 }
 
-static void aes_setup_ni(AESContext * ctx, uint8_t *key) {
-
-    __m128i *keysched = (__m128i*)ctx->keysched;
-
-    ctx->decrypt_cbc = aes_decrypt_cbc_ni;
-
-    // Now do the key setup itself.
-    AES_128_Key_Expansion (key, keysched);
-
-    // Now prepare the modified keys for the inverse cipher.
-    aes_inv_key_10(ctx);
-}
-*/
+#endif
 
 #endif
@@ -35,6 +35,12 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include "util_posix.h"
+#include "aes-ni.h"
+#include "shard.h"
+
+#if defined(AES_NI_AVAILABLE) && (defined(__x86_64__) || defined(__i386__))
+#include "detectaes.h"
+#endif
 
 #define AEND  "\x1b[0m"
 #define _RED_(s) "\x1b[31m" s AEND
@@ -47,6 +53,13 @@ pthread_mutex_t print_lock;
 
 static int global_found = 0;
 static int thread_count = 2;
+static bool use_aes_hw = false;
+
+// --range / --shard / --progress,  per thread position for the progress watermark
+static shard_t g_shard;
+static uint64_t *g_thread_pos = NULL;
+static int g_threads_done = 0;
+static char g_found[80] = {0};
 
 typedef struct thread_args {
     int thread;
@@ -75,30 +88,24 @@ static void handleErrors(void) {
     abort();
 }
 
-// source https://wiki.openssl.org/index.php/EVP_Symmetric_Encryption_and_Decryption#Decrypting_the_Message
-static int decrypt_aes(uint8_t ciphertext[], int ciphertext_len, uint8_t key[], uint8_t iv[], uint8_t plaintext[]) {
-    EVP_CIPHER_CTX *ctx;
-    if (!(ctx = EVP_CIPHER_CTX_new()))
-        handleErrors();
-
-    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_cbc(), NULL, key, iv))
-        handleErrors();
-
-    EVP_CIPHER_CTX_set_padding(ctx, 0);
-
-    int len = 0;
-    if (1 != EVP_DecryptUpdate(ctx, plaintext, &len, ciphertext, ciphertext_len))
-        handleErrors();
-
-    int plaintext_len = len;
+// ECB decrypt of the same blocks with each key, one reused OpenSSL context per thread
+static void decrypt_aes_multi(EVP_CIPHER_CTX *ctx, const uint8_t keys[AES_NI_LANES][16], uint8_t n, const uint8_t *in, uint8_t nblocks, uint8_t out[AES_NI_LANES][AES_NI_MAX_BLOCKS * 16]) {
 
-    if (1 != EVP_DecryptFinal_ex(ctx, plaintext + len, &len))
-        handleErrors();
+#if defined(AES_NI_AVAILABLE)
+    if (use_aes_hw) {
+        aes128_ecb_decrypt_multi(keys, in, nblocks, out);
+        return;
+    }
+#endif
 
-    plaintext_len += len;
+    for (uint8_t l = 0; l < n; l++) {
+        if (1 != EVP_DecryptInit_ex(ctx, NULL, NULL, keys[l], NULL))
+            handleErrors();
 
-    EVP_CIPHER_CTX_free(ctx);
-    return plaintext_len;
+        int len = 0;
+        if (1 != EVP_DecryptUpdate(ctx, out[l], &len, in, nblocks * 16))
+            handleErrors();
+    }
 }
 
 static int hexstr_to_byte_array(char hexstr[], uint8_t bytes[], size_t byte_len) {
@@ -156,63 +163,94 @@ static void *brute_thread(void *arguments) {
     uint64_t starttime = args->starttime;
 
     uint64_t stoptime = args->stoptime;
-    uint8_t local_tag[16];
+
+    // Only two block decryptions per key are needed.
+    // With a zero IV the tag challenge decrypts to D(tag), and the second
+    // reader block decrypts to D(rdr[16..31]) ^ rdr[0..15]. That second block
+    // has to be the tag challenge rotated left by one byte.
+    uint8_t local_in[32];
     uint8_t local_rdr[32];
-    memcpy(local_tag, args->tag, 16);
+    memcpy(local_in, args->tag, 16);
+    memcpy(local_in + 16, args->rdr + 16, 16);
     memcpy(local_rdr, args->rdr, 32);
 
-    for (uint64_t i = starttime + args->idx; i < stoptime; i += thread_count) {
+    EVP_CIPHER_CTX *ctx;
+    if (!(ctx = EVP_CIPHER_CTX_new()))
+        handleErrors();
+
+    if (1 != EVP_DecryptInit_ex(ctx, EVP_aes_128_ecb(), NULL, NULL, NULL))
+        handleErrors();
+
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+    uint8_t keys[AES_NI_LANES][16] = {{0x00}};
+    uint8_t dec[AES_NI_LANES][AES_NI_MAX_BLOCKS * 16];
+
+    // each thread takes AES_NI_LANES consecutive timestamps at a time
+    uint64_t step = (uint64_t)thread_count * AES_NI_LANES;
+    for (uint64_t base = starttime + ((uint64_t)args->idx * AES_NI_LANES); base < stoptime; base += step) {
 
         if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 1) {
             break;
         }
 
-        uint8_t key[16] = {0x00};
-        make_key(i, key);
-
-        uint8_t iv[16] = {0x00};
-        uint8_t dec_tag[16] = {0x00};
-        decrypt_aes(local_tag, 16, key, iv, dec_tag);
-
-        uint8_t dec_rdr[32] = {0x00};
-        decrypt_aes(local_rdr, 32, key, local_tag, dec_rdr);
-
-        // check rol byte first
-        if (dec_tag[0] != dec_rdr[31]) continue;
-
-        // compare rest
-        if (dec_tag[1] != dec_rdr[16]) continue;
-        if (dec_tag[2] != dec_rdr[17]) continue;
-        if (dec_tag[3] != dec_rdr[18]) continue;
-        if (dec_tag[4] != dec_rdr[19]) continue;
-        if (dec_tag[5] != dec_rdr[20]) continue;
-        if (dec_tag[6] != dec_rdr[21]) continue;
-        if (dec_tag[7] != dec_rdr[22]) continue;
-        if (dec_tag[8] != dec_rdr[23]) continue;
-        if (dec_tag[9] != dec_rdr[24]) continue;
-        if (dec_tag[10] != dec_rdr[25]) continue;
-        if (dec_tag[11] != dec_rdr[26]) continue;
-        if (dec_tag[12] != dec_rdr[27]) continue;
-        if (dec_tag[13] != dec_rdr[28]) continue;
-        if (dec_tag[14] != dec_rdr[29]) continue;
-        if (dec_tag[15] != dec_rdr[30]) continue;
-
-        __sync_fetch_and_add(&global_found, 1);
-
-        // lock this section to avoid interlacing prints from different threats
-        pthread_mutex_lock(&print_lock);
-
-        printf("Found timestamp........ ");
-        print_time(i);
-
-        printf("key.................... \x1b[32m");
-        print_hex(key, sizeof(key));
-        printf(AEND);
-
-        pthread_mutex_unlock(&print_lock);
-        break;
+        __atomic_store_n(&g_thread_pos[args->idx], base, __ATOMIC_RELEASE);
+
+        uint8_t n = ((stoptime - base) < AES_NI_LANES) ? (stoptime - base) : AES_NI_LANES;
+        for (uint8_t l = 0; l < n; l++) {
+            make_key(base + l, keys[l]);
+        }
+
+        decrypt_aes_multi(ctx, keys, n, local_in, 2, dec);
+
+        for (uint8_t l = 0; l < n; l++) {
+
+            uint8_t *dec_tag = dec[l];
+            uint8_t *dec_rdr = dec[l] + 16;
+
+            // check rol byte first
+            if (dec_tag[0] != (dec_rdr[15] ^ local_rdr[15])) continue;
+
+            // compare rest
+            bool ok = true;
+            for (int j = 0; j < 15; j++) {
+                if (dec_tag[j + 1] != (dec_rdr[j] ^ local_rdr[j])) {
+                    ok = false;
+                    break;
+                }
+            }
+
+            if (ok == false) continue;
+
+            __sync_fetch_and_add(&global_found, 1);
+
+            // lock this section to avoid interlacing prints from different threats
+            pthread_mutex_lock(&print_lock);
+
+            printf("Found timestamp........ ");
+            print_time(base + l);
+
+            printf("key.................... \x1b[32m");
+            print_hex(keys[l], sizeof(keys[l]));
+            printf(AEND);
+
+            int off = snprintf(g_found, sizeof(g_found), "%" PRIu64 " ", base + l);
+            for (size_t j = 0; j < sizeof(keys[l]); j++) {
+                off += snprintf(g_found + off, sizeof(g_found) - off, "%02X", keys[l][j]);
+            }
+
+            pthread_mutex_unlock(&print_lock);
+            break;
+        }
     }
 
+    // a thread leaving early because of a find keeps its last position
+    if (__atomic_load_n(&global_found, __ATOMIC_ACQUIRE) == 0) {
+        __atomic_store_n(&g_thread_pos[args->idx], stoptime, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&g_threads_done, 1, __ATOMIC_SEQ_CST);
+
+    EVP_CIPHER_CTX_free(ctx);
     free(args);
     return NULL;
 }
@@ -223,10 +261,26 @@ static int usage(const char *s) {
     printf("\n");
     printf(_YELLOW_("example:") "\n");
     printf("    ./mfd_aes_brute 1605394800 bb6aea729414a5b1eff7b16328ce37fd 82f5f498dbc29f7570102397a2e5ef2b6dc14a864f665b3c54d11765af81e95c\n");
+    printf("    ./mfd_aes_brute 1605394800 bb6aea729414a5b1eff7b16328ce37fd 82f5f498dbc29f7570102397a2e5ef2b6dc14a864f665b3c54d11765af81e95c --shard 2/4 --progress shard2.txt\n");
+    printf("\n");
+    printf("timestamps are the search index for --range\n");
+    shard_usage();
     printf("\n");
     return 1;
 }
 
+// every timestamp below the slowest thread has been tested
+static uint64_t progress_watermark(uint64_t stoptime) {
+    uint64_t low = stoptime;
+    for (int i = 0; i < thread_count; i++) {
+        uint64_t p = __atomic_load_n(&g_thread_pos[i], __ATOMIC_ACQUIRE);
+        if (p < low) {
+            low = p;
+        }
+    }
+    return low;
+}
+
 int main(int argc, char *argv[]) {
 
     printf("\n");
@@ -235,6 +289,8 @@ int main(int argc, char *argv[]) {
     printf("-----------------------------------------------------\n");
     printf("\n");
 
+    if (shard_parse_args(&g_shard, "mfd_aes_brute", &argc, argv) == false) return usage(argv[0]);
+
     if (argc != 4) return usage(argv[0]);
 
     uint64_t start_time = 0;
@@ -248,6 +304,13 @@ int main(int argc, char *argv[]) {
     if (hexstr_to_byte_array(argv[3], rdr_resp_challenge, sizeof(rdr_resp_challenge)))
         return 3;
 
+#if defined(AES_NI_AVAILABLE) && (defined(__x86_64__) || defined(__i386__))
+    use_aes_hw = platform_aes_hw_available();
+#elif defined(AES_NI_AVAILABLE)
+    use_aes_hw = true;
+#endif
+    printf("AES hardware........... " _GREEN_("%s") "\n", (use_aes_hw) ? "yes" : "no");
+
     printf("Starting timestamp..... ");
     print_time(start_time);
 
@@ -275,22 +338,43 @@ int main(int argc, char *argv[]) {
 
     // threads
     uint64_t stop_time = time(NULL);
+    uint64_t resume_time = shard_apply(&g_shard, start_time, stop_time);
+    stop_time = g_shard.end;
+
+    g_thread_pos = calloc(thread_count, sizeof(uint64_t));
+    for (int i = 0; i < thread_count; ++i) {
+        g_thread_pos[i] = resume_time;
+    }
+
     for (int i = 0; i < thread_count; ++i) {
         struct thread_args *a = calloc(1, sizeof(struct thread_args));
         a->thread = i;
         a->idx = i;
-        a->starttime = start_time;
+        a->starttime = resume_time;
         a->stoptime = stop_time;
         memcpy(a->tag, tag_challenge, 16);
         memcpy(a->rdr, rdr_resp_challenge, 32);
         pthread_create(&threads[i], NULL, brute_thread, (void *)a);
     }
 
+    // refresh the progress file every 10 seconds while the threads run
+    uint64_t t_progress = msclock();
+    while (__atomic_load_n(&g_threads_done, __ATOMIC_SEQ_CST) < thread_count) {
+        msleep(100);
+        if (msclock() - t_progress > 10000) {
+            shard_progress(&g_shard, progress_watermark(stop_time), NULL);
+            t_progress = msclock();
+        }
+    }
+
     // wait for threads to terminate:
     for (int i = 0; i < thread_count; ++i) {
         pthread_join(threads[i], NULL);
     }
 
+    shard_progress(&g_shard, progress_watermark(stop_time), (global_found) ? g_found : NULL);
+    free(g_thread_pos);
+
     if (global_found == false) {
         printf("\n" _RED_("!!!") " failed to find a key\n\n");
     }
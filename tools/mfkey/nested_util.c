@@ -14,6 +14,7 @@
 
 #include "pthread.h"
 #include "nested_util.h"
+#include "bucketsort.h"
 
 
 #define MEM_CHUNK               10000
@@ -53,7 +54,9 @@ static countKeys *uniqsort(uint64_t *possibleKeys, uint32_t size) {
     int count = 0;
     countKeys *our_counts;
 
-    qsort(possibleKeys, size, sizeof(uint64_t), compar_int);
+    if (radix_sort_u64(possibleKeys, size, UINT64_MAX, false) == false) {
+        qsort(possibleKeys, size, sizeof(uint64_t), compar_int);
+    }
 
     our_counts = calloc(size, sizeof(countKeys));
     if (our_counts == NULL) {
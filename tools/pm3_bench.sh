@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+
+# Host benchmarks: `hw bench` of the client, then wall time of the tools/ crackers
+# on the same vectors as pm3_tests.sh. Missing binaries are skipped.
+
+PM3PATH="$(dirname "$0")/.."
+cd "$PM3PATH" || exit 1
+
+C_BLUE='\033[0;34m'
+C_YELLOW='\033[0;33m'
+C_NC='\033[0m'
+
+CLIENTBIN=${CLIENTBIN:=./client/proxmark3}
+BENCHARGS=${BENCHARGS:=}
+
+# TimeExecute <title> <command line>
+function TimeExecute() {
+  local start end
+  start=$(date +%s%N)
+  eval "$2" >/dev/null 2>&1
+  end=$(date +%s%N)
+  printf "  %-32s ${C_YELLOW}%8d${C_NC} ms\n" "$1" $(( (end - start) / 1000000 ))
+}
+
+# TimeTool <binary> <title> <args>
+function TimeTool() {
+  if [ -x "$1" ]; then
+    TimeExecute "$2" "$1 $3"
+  else
+    printf "  %-32s skipped, %s not built\n" "$2" "$1"
+  fi
+}
+
+echo -e "${C_BLUE}Client cores:${C_NC} $CLIENTBIN hw bench $BENCHARGS"
+if [ -x "$CLIENTBIN" ]; then
+  "$CLIENTBIN" --incognito -c "hw bench $BENCHARGS"
+else
+  echo "  skipped, $CLIENTBIN not built"
+fi
+
+echo -e "\n${C_BLUE}Tools:${C_NC}"
+TimeTool ./tools/mfkey/mfkey32v2 "mfkey32v2" "12345678 1AD8DF2B 1D316024 620EF048 30D6CB07 C52077E2 837AC61A"
+TimeTool ./tools/mfkey/mfkey64 "mfkey64" "9c599b32 82a4166c a1e458ce 6eea41e0 5cadf439"
+TimeTool ./tools/mfkey/staticnested "staticnested" "461dce03 7eef3586 7fa28c7e 322bc14d 7f62b3d6"
+TimeTool ./tools/nonce2key/nonce2key "nonce2key" "e9cadd9c a8bf4a12 a020a8285858b090 050f010607060e07 5693be6c00000000"
+TimeTool ./tools/mf_nonce_brute/mf_nonce_brute "mf_nonce_brute" "9c599b32 5a920d85 1011 98d76b77 d6c6e870 0000 ca7e0b63 0111 3e709c8a"
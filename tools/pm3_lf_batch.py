@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+
+#-----------------------------------------------------------------------------
+# Copyright (C) Proxmark3 contributors. See AUTHORS.md for details.
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# See LICENSE.txt for the text of the license.
+#-----------------------------------------------------------------------------
+#
+# Offline batch decoding of LF captures.
+#
+# Runs `data load` + `lf search` in an offline client for every .pm3 / .wav
+# capture found, one client per core, and writes a JSON summary per file.
+#
+#   ./tools/pm3_lf_batch.py traces/
+#   ./tools/pm3_lf_batch.py -r -j 8 -o results/ /archive/captures
+#
+# One JSON object per capture goes to stdout (JSON lines), with -o also to
+# <outdir>/<capture name>.json
+#
+#-----------------------------------------------------------------------------
+
+import argparse
+import concurrent.futures
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import wave
+
+CAPTURE_EXT = ('.pm3', '.wav')
+ANSI = re.compile(r'\x1b\[[0-9;]*m')
+PREFIX = re.compile(r'^\[[^\]]*\] ?')
+VALID = re.compile(r'Valid (.+?) ID found!')
+LOADED = re.compile(r'loaded ([0-9,]+) samples')
+
+
+def find_captures(paths, recursive):
+    files = []
+    for p in paths:
+        if os.path.isfile(p):
+            files.append(p)
+            continue
+        for root, dirs, names in os.walk(p):
+            for n in sorted(names):
+                if n.lower().endswith(CAPTURE_EXT):
+                    files.append(os.path.join(root, n))
+            if not recursive:
+                break
+    return files
+
+
+def wav_to_pm3(fn, out):
+    # saveFileWAVE writes 8 bit unsigned mono, 16 bit files are scaled down
+    with wave.open(fn, 'rb') as w:
+        width = w.getsampwidth()
+        channels = w.getnchannels()
+        frames = w.readframes(w.getnframes())
+
+    step = width * channels
+    for i in range(0, len(frames) - step + 1, step):
+        if width == 1:
+            v = frames[i] - 128
+        else:
+            v = int.from_bytes(frames[i + width - 2:i + width], 'little', signed=True) >> 8
+        out.write('%d\n' % v)
+
+
+def parse_search(lines):
+    tags = []
+    data = []
+    block = []
+    in_search = False
+    for line in lines:
+        if 'pm3 --> lf search' in line:
+            in_search = True
+            continue
+        if in_search is False:
+            continue
+
+        text = PREFIX.sub('', line).strip()
+        m = VALID.search(text)
+        if m:
+            tags.append(m.group(1))
+            data.append(block)
+            block = []
+        elif text and not text.startswith(('Note:', 'Checking for known tags', 'Couldn\'t identify')):
+            block.append(text)
+
+    return tags, data
+
+
+def decode(fn, args):
+    result = {'file': fn, 'format': os.path.splitext(fn)[1].lower().lstrip('.')}
+
+    tmp = None
+    load = fn
+    try:
+        if result['format'] == 'wav':
+            tmp = tempfile.NamedTemporaryFile('w', suffix='.pm3', delete=False)
+            wav_to_pm3(fn, tmp)
+            tmp.close()
+            load = tmp.name
+
+        search = 'lf search -1u' if args.unknown else 'lf search -1'
+        cmd = [args.pm3, '--incognito', '--ncpu', '1', '-c', 'data load -f %s; %s' % (load, search)]
+        p = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, timeout=args.timeout)
+        lines = [ANSI.sub('', l) for l in p.stdout.decode('utf-8', 'replace').splitlines()]
+
+    except (OSError, EOFError, wave.Error, subprocess.TimeoutExpired) as e:
+        result['status'] = 'error'
+        result['error'] = str(e)
+        return result
+
+    finally:
+        if tmp is not None:
+            os.unlink(tmp.name)
+
+    samples = 0
+    for l in lines:
+        m = LOADED.search(l)
+        if m:
+            samples = int(m.group(1).replace(',', ''))
+            break
+
+    tags, data = parse_search(lines)
+    result['samples'] = samples
+    result['status'] = 'found' if tags else ('not found' if samples else 'error')
+    result['tags'] = [{'type': t, 'output': d} for t, d in zip(tags, data)]
+    if args.verbose or samples == 0:
+        result['log'] = lines
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a directory of LF captures (.pm3 / .wav) with an offline client, in parallel.')
+    parser.add_argument('paths', nargs='+', help='capture files or directories')
+    parser.add_argument('-r', '--recursive', action='store_true', help='walk into sub directories')
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count() or 1, help='clients running at once (default: number of cores)')
+    parser.add_argument('-o', '--outdir', help='also write <outdir>/<capture name>.json per capture')
+    parser.add_argument('-u', '--unknown', action='store_true', help='also run the unknown tag / chipset detection of lf search')
+    parser.add_argument('-t', '--timeout', type=int, default=120, help='seconds per capture (default: 120)')
+    parser.add_argument('-v', '--verbose', action='store_true', help='keep the full client output in the JSON')
+    parser.add_argument('--pm3', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'client', 'proxmark3'),
+                        help='client binary (default: ../client/proxmark3 next to this script)')
+    args = parser.parse_args()
+
+    files = find_captures(args.paths, args.recursive)
+    if not files:
+        print('no .pm3 / .wav captures found', file=sys.stderr)
+        return 1
+
+    if args.outdir:
+        os.makedirs(args.outdir, exist_ok=True)
+
+    found = 0
+    with concurrent.futures.ThreadPoolExecutor(max_workers=max(args.jobs, 1)) as ex:
+        for r in ex.map(lambda f: decode(f, args), files):
+            if r['status'] == 'found':
+                found += 1
+            print(json.dumps(r), flush=True)
+            if args.outdir:
+                name = os.path.splitext(os.path.basename(r['file']))[0] + '.json'
+                with open(os.path.join(args.outdir, name), 'w') as f:
+                    json.dump(r, f, indent=2)
+
+    print('%d captures, %d with a known tag' % (len(files), found), file=sys.stderr)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())